@@ -77,6 +77,13 @@ public:
         _In_  UINT NumPostbuildInfoDescs,
         _In_reads_opt_(NumPostbuildInfoDescs)  const D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_DESC *pPostbuildInfoDescs) = 0;
 
+    // Builds several acceleration structures in one call. The Fallback Layer records each stage of
+    // the build once for consecutive acceleration structures of the same type, so they share the
+    // barriers between stages instead of paying for them one build at a time.
+    virtual void BuildRaytracingAccelerationStructures(
+        _In_  UINT NumDescs,
+        _In_reads_(NumDescs)  const D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC *pDescs) = 0;
+
     virtual void STDMETHODCALLTYPE EmitRaytracingAccelerationStructurePostbuildInfo(
         _In_  const D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_DESC *pDesc,
         _In_  UINT NumSourceAccelerationStructures,
@@ -161,7 +168,11 @@ enum CreateRaytracingFallbackDeviceFlags
 {
     None = 0x0,
     ForceComputeFallback = 0x1,
-    EnableRootDescriptorsInShaderRecords = 0x2
+    EnableRootDescriptorsInShaderRecords = 0x2,
+    EnableShaderCache = 0x4,
+    // Links a traversal with a short stack that backtracks through parent links into each state
+    // object, trading some extra node visits for fewer registers per ray
+    EnableShortStackTraversal = 0x8
 };
 
 HRESULT D3D12CreateRaytracingFallbackDevice(
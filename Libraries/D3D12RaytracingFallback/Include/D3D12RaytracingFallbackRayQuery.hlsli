@@ -0,0 +1,259 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+#pragma once
+
+// Traces rays against a Fallback Layer acceleration structure from any compute or pixel shader,
+// without a state object or shader tables. The acceleration structures are read through the same
+// emulated pointers DispatchRays uses, so the shader must see the descriptor heap they were
+// created in as an unbounded table of raw UAVs starting at the heap's first descriptor. Define
+// FALLBACK_RAY_QUERY_DESCRIPTOR_HEAP_REGISTER and FALLBACK_RAY_QUERY_DESCRIPTOR_HEAP_SPACE before
+// including this to choose where that table is bound.
+//
+// Every triangle is treated as opaque since there is no any hit shader to run, and procedural
+// primitives are skipped since there is no intersection shader. The ray flags still cull
+// triangles by facing, and by opacity after the instance and ray flags force it. Only acceleration
+// structures built by the compute-based path can be traced this way.
+
+#ifndef FALLBACK_RAY_QUERY_DESCRIPTOR_HEAP_REGISTER
+#define FALLBACK_RAY_QUERY_DESCRIPTOR_HEAP_REGISTER 0
+#endif
+
+#ifndef FALLBACK_RAY_QUERY_DESCRIPTOR_HEAP_SPACE
+#define FALLBACK_RAY_QUERY_DESCRIPTOR_HEAP_SPACE 214743648
+#endif
+
+#ifndef HLSL
+#define HLSL
+#endif
+
+#include "../src/RayTracingHelper.hlsli"
+
+RWByteAddressBuffer DescriptorHeapBufferTable[] : UAV_REGISTER_SPACE(FALLBACK_RAY_QUERY_DESCRIPTOR_HEAP_REGISTER, FALLBACK_RAY_QUERY_DESCRIPTOR_HEAP_SPACE);
+
+#include "../src/EmulatedPointerIntrinsics.hlsli"
+#include "../src/TraversalIntersection.hlsli"
+
+struct FallbackRay
+{
+    float3 Origin;
+    float TMin;
+    float3 Direction;
+    float TMax;
+};
+
+struct FallbackRayHit
+{
+    float T;
+    float2 Barycentrics;
+    uint PrimitiveIndex;
+    uint GeometryContributionToHitGroupIndex;
+    uint InstanceIndex;
+    uint InstanceID;
+    uint InstanceContributionToHitGroupIndex;
+};
+
+bool FallbackTraverse(
+    GpuVA topLevelAccelerationStructureGpuVA,
+    FallbackRay ray,
+    uint rayFlags,
+    uint instanceInclusionMask,
+    bool acceptFirstHit,
+    out FallbackRayHit hit)
+{
+    hit = (FallbackRayHit)0;
+    hit.T = ray.TMax;
+
+    // Forcing everything opaque makes culling opaque geometry cull all of it
+    if (Cull(true, rayFlags))
+    {
+        return false;
+    }
+
+    uint stack[TRAVERSAL_MAX_STACK_DEPTH];
+    uint stackPointer = 0;
+    bool isHit = false;
+
+    RWByteAddressBufferPointer topLevelAccelerationStructure = CreateRWByteAddressBufferPointerFromGpuVA(topLevelAccelerationStructureGpuVA);
+    const TraversalOffsets topLevelOffsets = LoadTraversalOffsets(topLevelAccelerationStructure);
+    uint offsetToInstanceDescs = topLevelOffsets.offsetToPrimitives;
+
+    RayData worldRayData = GetRayData(ray.Origin, ray.Direction);
+    uint2 rootFlags;
+    float unusedT;
+    BoundingBox topLevelBox = BVHReadBoundingBox(topLevelAccelerationStructure, 0, rootFlags);
+    if (!RayBoxTest(unusedT,
+        ray.TMax,
+        worldRayData.OriginTimesRayInverseDirection,
+        worldRayData.InverseDirection,
+        topLevelBox.center,
+        topLevelBox.halfDim))
+    {
+        return false;
+    }
+
+    stack[stackPointer++] = 0;
+    while (stackPointer != 0)
+    {
+        uint thisNodeIndex = stack[--stackPointer];
+        uint2 flags = GetLeafFlagsFromReference(thisNodeIndex);
+
+        if (!IsLeafReference(thisNodeIndex))
+        {
+            float childT[WIDE_NODE_MAX_CHILDREN];
+            uint childReference[WIDE_NODE_MAX_CHILDREN];
+            IntersectWideNodeChildren(topLevelAccelerationStructure, topLevelOffsets, thisNodeIndex, worldRayData, hit.T, childT, childReference);
+
+            if (!acceptFirstHit)
+            {
+                SortChildrenByT(childT, childReference, 0, 1);
+                SortChildrenByT(childT, childReference, 2, 3);
+                SortChildrenByT(childT, childReference, 0, 2);
+                SortChildrenByT(childT, childReference, 1, 3);
+                SortChildrenByT(childT, childReference, 1, 2);
+            }
+
+            // Push the farthest first so the nearest is popped next
+            [unroll]
+            for (int i = WIDE_NODE_MAX_CHILDREN - 1; i >= 0; i--)
+            {
+                if (childT[i] != FLT_MAX)
+                {
+                    stack[stackPointer++] = childReference[i];
+                }
+            }
+            continue;
+        }
+
+        BVHMetadata metadata = GetBVHMetadataFromLeafIndex(
+            topLevelAccelerationStructure,
+            offsetToInstanceDescs,
+            GetLeafIndexFromFlag(flags));
+        RaytracingInstanceDesc instanceDesc = metadata.instanceDesc;
+        if ((GetInstanceMask(instanceDesc) & instanceInclusionMask) == 0)
+        {
+            continue;
+        }
+
+        // The bottom level is traversed in object space, where the unnormalized direction keeps T
+        // the same as in world space
+        const uint instanceFlags = GetInstanceFlags(instanceDesc);
+        const float3x4 worldToObject = CreateMatrix(instanceDesc.Transform);
+        const float3 objectRayOrigin = mul(worldToObject, float4(ray.Origin, 1));
+        const float3 objectRayDirection = mul(worldToObject, float4(ray.Direction, 0));
+        RayData objectRayData = GetRayData(objectRayOrigin, objectRayDirection);
+        RWByteAddressBufferPointer bottomLevelAccelerationStructure = CreateRWByteAddressBufferPointerFromGpuVA(instanceDesc.AccelerationStructure);
+        const TraversalOffsets bottomLevelOffsets = LoadTraversalOffsets(bottomLevelAccelerationStructure);
+
+        // The bottom level's nodes go above the top level's on the stack and are all popped first
+        const uint bottomLevelStackBase = stackPointer;
+        stack[stackPointer++] = 0;
+        while (stackPointer != bottomLevelStackBase)
+        {
+            uint bottomLevelNodeIndex = stack[--stackPointer];
+            uint2 bottomLevelFlags = GetLeafFlagsFromReference(bottomLevelNodeIndex);
+
+            if (!IsLeafReference(bottomLevelNodeIndex))
+            {
+                float childT[WIDE_NODE_MAX_CHILDREN];
+                uint childReference[WIDE_NODE_MAX_CHILDREN];
+                IntersectWideNodeChildren(bottomLevelAccelerationStructure, bottomLevelOffsets, bottomLevelNodeIndex, objectRayData, hit.T, childT, childReference);
+
+                if (!acceptFirstHit)
+                {
+                    SortChildrenByT(childT, childReference, 0, 1);
+                    SortChildrenByT(childT, childReference, 2, 3);
+                    SortChildrenByT(childT, childReference, 0, 2);
+                    SortChildrenByT(childT, childReference, 1, 3);
+                    SortChildrenByT(childT, childReference, 1, 2);
+                }
+
+                [unroll]
+                for (int i = WIDE_NODE_MAX_CHILDREN - 1; i >= 0; i--)
+                {
+                    if (childT[i] != FLT_MAX)
+                    {
+                        stack[stackPointer++] = childReference[i];
+                    }
+                }
+                continue;
+            }
+
+            if (IsProceduralGeometry(bottomLevelFlags))
+            {
+                continue;
+            }
+
+            PrimitiveMetaData primitiveMetadata = BVHReadPrimitiveMetaData(bottomLevelAccelerationStructure, bottomLevelOffsets, GetLeafIndexFromFlag(bottomLevelFlags));
+            bool geomOpaque = primitiveMetadata.GeometryFlags & D3D12_RAYTRACING_GEOMETRY_FLAG_OPAQUE;
+            if (Cull(IsOpaque(geomOpaque, instanceFlags, rayFlags), rayFlags))
+            {
+                continue;
+            }
+
+            float resultT = hit.T;
+            float2 resultBary;
+            uint resultTriId;
+            if (TestLeafNodeIntersections(
+                bottomLevelAccelerationStructure,
+                bottomLevelOffsets,
+                bottomLevelFlags,
+                instanceFlags,
+                rayFlags,
+                ray.TMin,
+                objectRayOrigin,
+                objectRayDirection,
+                objectRayData.SwizzledIndices,
+                objectRayData.Shear,
+                resultBary,
+                resultT,
+                resultTriId))
+            {
+                isHit = true;
+                hit.T = resultT;
+                hit.Barycentrics = resultBary;
+                hit.PrimitiveIndex = primitiveMetadata.PrimitiveIndex;
+                hit.GeometryContributionToHitGroupIndex = primitiveMetadata.GeometryContributionToHitGroupIndex;
+                hit.InstanceIndex = metadata.InstanceIndex;
+                hit.InstanceID = GetInstanceID(instanceDesc);
+                hit.InstanceContributionToHitGroupIndex = GetInstanceContributionToHitGroupIndex(instanceDesc);
+
+                if (acceptFirstHit || (rayFlags & D3D12_RAY_FLAG_ACCEPT_FIRST_HIT_AND_END_SEARCH))
+                {
+                    return true;
+                }
+            }
+        }
+    }
+    return isHit;
+}
+
+// Returns whether anything lies along the ray. Children are visited in the order they're stored
+// and the first triangle hit ends the search.
+bool TraceOcclusion(
+    GpuVA topLevelAccelerationStructureGpuVA,
+    FallbackRay ray,
+    uint rayFlags = D3D12_RAY_FLAG_NONE,
+    uint instanceInclusionMask = ~0)
+{
+    FallbackRayHit unusedHit;
+    return FallbackTraverse(topLevelAccelerationStructureGpuVA, ray, rayFlags, instanceInclusionMask, true, unusedHit);
+}
+
+// Finds the closest triangle along the ray, visiting the nearest children first
+bool TraceClosest(
+    GpuVA topLevelAccelerationStructureGpuVA,
+    FallbackRay ray,
+    out FallbackRayHit hit,
+    uint rayFlags = D3D12_RAY_FLAG_NONE,
+    uint instanceInclusionMask = ~0)
+{
+    return FallbackTraverse(topLevelAccelerationStructureGpuVA, ray, rayFlags, instanceInclusionMask, false, hit);
+}
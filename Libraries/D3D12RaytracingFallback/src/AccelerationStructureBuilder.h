@@ -30,6 +30,14 @@ namespace FallbackLayer
             _In_  const D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC *pDesc,
             _In_ ID3D12DescriptorHeap *pCbvSrvUavDescriptorHeap) = 0;
 
+        // Builds several acceleration structures at once, sharing the barriers between the stages
+        // of the build across every acceleration structure of the same type
+        virtual void BuildRaytracingAccelerationStructures(
+            _In_  ID3D12GraphicsCommandList *pCommandList,
+            _In_  UINT NumDescs,
+            _In_reads_(NumDescs)  const D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC *pDescs,
+            _In_ ID3D12DescriptorHeap *pCbvSrvUavDescriptorHeap) = 0;
+
         virtual void CopyRaytracingAccelerationStructure(
             _In_  ID3D12GraphicsCommandList *pCommandList,
             _In_  D3D12_GPU_VIRTUAL_ADDRESS DestAccelerationStructureData,
@@ -11,6 +11,8 @@
 #include "pch.h"
 #include "CompiledShaders\TraverseShaderLib.h"
 #include "CompiledShaders\MinimalTraverseShaderLib.h"
+#include "CompiledShaders\ShortStackTraverseShaderLib.h"
+#include "CompiledShaders\MinimalShortStackTraverseShaderLib.h"
 
 #if PROFILE_STATE_MACHINE
 #include "CompiledShaders\NullTraverseLib.h"
@@ -23,8 +25,16 @@ namespace FallbackLayer
             _Out_ TraversalShader &traversalShader)
     {
             traversalShader = {};
-            traversalShader.m_TraversalShaderDxilLib.DXILLibrary.BytecodeLength = IsAnyHitOrIntersectionUsed ? sizeof(g_pTraverseShaderLib) : sizeof(g_pMinimalTraverseShaderLib);
-            traversalShader.m_TraversalShaderDxilLib.DXILLibrary.pShaderBytecode = IsAnyHitOrIntersectionUsed ? g_pTraverseShaderLib : g_pMinimalTraverseShaderLib;
+            if (m_UseShortStack)
+            {
+                traversalShader.m_TraversalShaderDxilLib.DXILLibrary.BytecodeLength = IsAnyHitOrIntersectionUsed ? sizeof(g_pShortStackTraverseShaderLib) : sizeof(g_pMinimalShortStackTraverseShaderLib);
+                traversalShader.m_TraversalShaderDxilLib.DXILLibrary.pShaderBytecode = IsAnyHitOrIntersectionUsed ? g_pShortStackTraverseShaderLib : g_pMinimalShortStackTraverseShaderLib;
+            }
+            else
+            {
+                traversalShader.m_TraversalShaderDxilLib.DXILLibrary.BytecodeLength = IsAnyHitOrIntersectionUsed ? sizeof(g_pTraverseShaderLib) : sizeof(g_pMinimalTraverseShaderLib);
+                traversalShader.m_TraversalShaderDxilLib.DXILLibrary.pShaderBytecode = IsAnyHitOrIntersectionUsed ? g_pTraverseShaderLib : g_pMinimalTraverseShaderLib;
+            }
 #if PROFILE_STATE_MACHINE
             // By providing a null traversal shader, the cost of just running the other states can be measured
             traversalShader.m_TraversalShaderDxilLib.DXILLibrary.BytecodeLength = sizeof(g_pNullTraverseLib);
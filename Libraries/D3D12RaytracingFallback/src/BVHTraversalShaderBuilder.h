@@ -15,11 +15,13 @@ namespace FallbackLayer
     class BVHTraversalShaderBuilder : public ITraversalShaderBuilder
     {
     public:
-        BVHTraversalShaderBuilder(DxilShaderPatcher &dxilShaderPatcher) : m_DxilShaderPatcher(dxilShaderPatcher) {}
+        BVHTraversalShaderBuilder(DxilShaderPatcher &dxilShaderPatcher, bool useShortStack) :
+            m_DxilShaderPatcher(dxilShaderPatcher), m_UseShortStack(useShortStack) {}
 
         void Compile(_In_ bool IsAnyHitOrIntersectionUsed, _Out_ TraversalShader &traversalShader);
 
     private:
         DxilShaderPatcher &m_DxilShaderPatcher;
+        bool m_UseShortStack;
     };
 }
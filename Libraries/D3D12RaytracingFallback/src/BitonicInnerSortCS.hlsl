@@ -29,12 +29,13 @@ cbuffer Constants : register(b0)
 RWByteAddressBuffer g_SortBuffer : register(u0);
 RWByteAddressBuffer g_IndexBuffer : register(u1);
 
-groupshared uint gs_SortKeys[2048];
+groupshared SortKey gs_SortKeys[2048];
 groupshared uint gs_SortIndices[2048];
 
 void LoadKeyIndexPair( uint Element, uint ListCount )
 {
-    uint keyValue = Element < ListCount ? g_SortBuffer.Load(Element * 4) : NullItem;
+    SortKey keyValue = NullItem;
+    if (Element < ListCount) keyValue = LoadSortKey(g_SortBuffer, Element);
     uint index = Element < ListCount ? g_IndexBuffer.Load(Element * 4) : NullItem;
     gs_SortIndices[Element & 2047] = index;
     gs_SortKeys[Element & 2047] = keyValue;
@@ -44,7 +45,7 @@ void StoreKeyIndexPair(uint Element, uint ListCount)
 {
     if (Element < ListCount)
     {
-        g_SortBuffer.Store(Element * 4, gs_SortKeys[Element & 2047]);
+        StoreSortKey(g_SortBuffer, Element, gs_SortKeys[Element & 2047]);
         g_IndexBuffer.Store(Element * 4, gs_SortIndices[Element & 2047]);
     }
 }
@@ -70,8 +71,8 @@ void main( uint3 Gid : SV_GroupID, uint GI : SV_GroupIndex )
         uint Index2 = InsertOneBit(GI, j);
         uint Index1 = Index2 ^ j;
 
-        uint A = gs_SortKeys[Index1];
-        uint B = gs_SortKeys[Index2];
+        SortKey A = gs_SortKeys[Index1];
+        SortKey B = gs_SortKeys[Index2];
         uint indexA = gs_SortIndices[Index1];
         uint indexB = gs_SortIndices[Index2];
 
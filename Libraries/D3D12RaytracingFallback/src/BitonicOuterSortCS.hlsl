@@ -30,14 +30,14 @@ void main( uint3 DTid : SV_DispatchThreadID  )
     if (Index2 >= ListCount)
         return;
 
-    uint A = g_SortBuffer.Load(Index1 * 4);
-    uint B = g_SortBuffer.Load(Index2 * 4);
+    SortKey A = LoadSortKey(g_SortBuffer, Index1);
+    SortKey B = LoadSortKey(g_SortBuffer, Index2);
     uint indexA = g_IndexBuffer.Load(Index1 * 4);
     uint indexB = g_IndexBuffer.Load(Index2 * 4);
     if (ShouldSwap(A, B, indexA, indexB))
     {
-        g_SortBuffer.Store(Index1 * 4, B);
-        g_SortBuffer.Store(Index2 * 4, A);
+        StoreSortKey(g_SortBuffer, Index1, B);
+        StoreSortKey(g_SortBuffer, Index2, A);
 
 
         g_IndexBuffer.Store(Index1 * 4, indexB);
@@ -28,14 +28,14 @@ RWByteAddressBuffer g_SortBuffer : register(u0);
 RWByteAddressBuffer g_IndexBuffer : register(u1);
 
 groupshared uint gs_SortIndices[2048];
-groupshared uint gs_SortKeys[2048];
+groupshared SortKey gs_SortKeys[2048];
 
 void FillSortKey( uint Element, uint ListCount )
 {
     // Unused elements must sort to the end
     if (Element < ListCount)
     {
-        gs_SortKeys[Element & 2047] = g_SortBuffer.Load(Element * 4);
+        gs_SortKeys[Element & 2047] = LoadSortKey(g_SortBuffer, Element);
         gs_SortIndices[Element & 2047] = g_IndexBuffer.Load(Element * 4);
     }
     else
@@ -48,7 +48,7 @@ void StoreKeyIndexPair( uint Element, uint ListCount)
 {
     if (Element < ListCount)
     {
-        g_SortBuffer.Store(Element * 4, gs_SortKeys[Element & 2047]);
+        StoreSortKey(g_SortBuffer, Element, gs_SortKeys[Element & 2047]);
         g_IndexBuffer.Store(Element * 4, gs_SortIndices[Element & 2047]);
     }
 }
@@ -78,8 +78,8 @@ void main( uint3 Gid : SV_GroupID, uint GI : SV_GroupIndex )
             uint Index2 = InsertOneBit(GI, j);
             uint Index1 = Index2 ^ (k == 2 * j ? k - 1 : j);
 
-            uint A = gs_SortKeys[Index1];
-            uint B = gs_SortKeys[Index2];
+            SortKey A = gs_SortKeys[Index1];
+            SortKey B = gs_SortKeys[Index2];
             uint indexA = gs_SortIndices[Index1];
             uint indexB = gs_SortIndices[Index2];
             if (ShouldSwap(A, B, indexA, indexB))
@@ -89,8 +89,6 @@ void main( uint3 Gid : SV_GroupID, uint GI : SV_GroupIndex )
                 gs_SortKeys[Index2] = A;
 
                 // Then swap the indices (for 64-bit sorts)
-                A = gs_SortIndices[Index1];
-                B = gs_SortIndices[Index2];
                 gs_SortIndices[Index1] = indexB;
                 gs_SortIndices[Index2] = indexA;
             }
@@ -23,23 +23,15 @@
 
 #include "pch.h"
 
-#include "CompiledShaders/BitonicIndirectArgsCS.h"
 #include "CompiledShaders/BitonicPreSortCS.h"
 #include "CompiledShaders/BitonicInnerSortCS.h"
 #include "CompiledShaders/BitonicOuterSortCS.h"
+#include "CompiledShaders/BitonicPreSort64BitCS.h"
+#include "CompiledShaders/BitonicInnerSort64BitCS.h"
+#include "CompiledShaders/BitonicOuterSort64BitCS.h"
 
 BitonicSort::BitonicSort(ID3D12Device *pDevice, UINT nodeMask)
 {    
-    auto defaultHeapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
-    auto indirectArgBufferDesc = CD3DX12_RESOURCE_DESC::Buffer(cIndirectArgStride * 22 * 23 / 2, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
-    ThrowInternalFailure(pDevice->CreateCommittedResource(
-        &defaultHeapProperties, 
-        D3D12_HEAP_FLAG_NONE, 
-        &indirectArgBufferDesc, 
-        D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT, 
-        nullptr, 
-        IID_PPV_ARGS(&m_pDispatchArgs)));
-
     CD3DX12_ROOT_PARAMETER1 parameters[NumParameters];
     parameters[ShaderSpecificConstants].InitAsConstants(2, 0);
     parameters[OutputUAV].InitAsUnorderedAccessView(0);
@@ -49,19 +41,13 @@ BitonicSort::BitonicSort(ID3D12Device *pDevice, UINT nodeMask)
     auto rootSignatureDesc = CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC(ARRAYSIZE(parameters), parameters);
     CreateRootSignatureHelper(pDevice, rootSignatureDesc, &m_pRootSignature);
 
-    CreatePSOHelper(pDevice, nodeMask, m_pRootSignature, COMPILED_SHADER(g_pBitonicIndirectArgsCS),&m_pBitonicIndirectArgsCS);
     CreatePSOHelper(pDevice, nodeMask, m_pRootSignature, COMPILED_SHADER(g_pBitonicInnerSortCS), &m_pBitonicInnerSortCS);
     CreatePSOHelper(pDevice, nodeMask, m_pRootSignature, COMPILED_SHADER(g_pBitonicOuterSortCS), &m_pBitonicOuterSortCS);
     CreatePSOHelper(pDevice, nodeMask, m_pRootSignature, COMPILED_SHADER(g_pBitonicPreSortCS),   &m_pBitonicPreSortCS);
-    
-    D3D12_INDIRECT_ARGUMENT_DESC indirectArgDesc = {};
-    indirectArgDesc.Type = D3D12_INDIRECT_ARGUMENT_TYPE_DISPATCH;
-    D3D12_COMMAND_SIGNATURE_DESC commandSignatureDesc;
-    commandSignatureDesc.NodeMask = nodeMask;
-    commandSignatureDesc.pArgumentDescs = &indirectArgDesc;
-    commandSignatureDesc.ByteStride = sizeof(D3D12_DISPATCH_ARGUMENTS);
-    commandSignatureDesc.NumArgumentDescs = 1;
-    pDevice->CreateCommandSignature(&commandSignatureDesc, nullptr, IID_PPV_ARGS(&m_pCommandSignature));
+
+    CreatePSOHelper(pDevice, nodeMask, m_pRootSignature, COMPILED_SHADER(g_pBitonicInnerSort64BitCS), &m_pBitonicInnerSort64BitCS);
+    CreatePSOHelper(pDevice, nodeMask, m_pRootSignature, COMPILED_SHADER(g_pBitonicOuterSort64BitCS), &m_pBitonicOuterSort64BitCS);
+    CreatePSOHelper(pDevice, nodeMask, m_pRootSignature, COMPILED_SHADER(g_pBitonicPreSort64BitCS),   &m_pBitonicPreSort64BitCS);
 }
 
 void BitonicSort::Sort(
@@ -70,12 +56,46 @@ void BitonicSort::Sort(
     D3D12_GPU_VIRTUAL_ADDRESS IndexBuffer,
     UINT ElementCount,
     bool IsPartiallyPreSorted,
+    bool SortAscending,
+    bool Uses64BitKeys)
+{
+    SortList List = { SortKeyBuffer, IndexBuffer, ElementCount, Uses64BitKeys };
+    Sort(pCommandList, 1, &List, IsPartiallyPreSorted, SortAscending);
+}
+
+UINT BitonicSort::GetOuterSortGroupCount(UINT ElementCount, UINT j)
+{
+    // All of the groups of size 2j that are full
+    UINT CompleteGroups = (ElementCount & ~(2 * j - 1)) / 2048;
+
+    // Remaining items must only be sorted if there are more than j of them
+    UINT RemainingElements = ElementCount - CompleteGroups * 2048;
+    UINT PartialGroups = RemainingElements > j ? DivideAndRoundUp(RemainingElements - j, 1024u) : 0;
+
+    return CompleteGroups + PartialGroups;
+}
+
+UINT BitonicSort::GetInnerSortGroupCount(UINT ElementCount)
+{
+    // The inner sort always sorts all groups (rounded up to multiples of 2048)
+    return DivideAndRoundUp(ElementCount, 2048u);
+}
+
+void BitonicSort::Sort(
+    ID3D12GraphicsCommandList *pCommandList,
+    UINT NumLists,
+    const SortList *pLists,
+    bool IsPartiallyPreSorted,
     bool SortAscending)
 {
-    if (ElementCount == 0) return;
+    UINT MaxElementCount = 0;
+    for (UINT ListIndex = 0; ListIndex < NumLists; ListIndex++)
+    {
+        MaxElementCount = std::max(MaxElementCount, pLists[ListIndex].ElementCount);
+    }
+    if (MaxElementCount == 0) return;
 
-    const uint32_t AlignedNumElements = AlignPowerOfTwo(ElementCount);
-    const uint32_t MaxIterations = Log2(std::max(2048u, AlignedNumElements)) - 10;
+    const uint32_t AlignedNumElements = AlignPowerOfTwo(MaxElementCount);
 
     pCommandList->SetComputeRootSignature(m_pRootSignature);
 
@@ -84,44 +104,51 @@ void BitonicSort::Sort(
         UINT NullIndex;
         UINT ListCount;
     };
-    InputConstants constants { SortAscending ? 0xffffffff : 0, ElementCount };
-    pCommandList->SetComputeRoot32BitConstants(GenericConstants, SizeOfInUint32(InputConstants), &constants, 0);
-    
-    // Generate execute indirect arguments
-    pCommandList->SetPipelineState(m_pBitonicIndirectArgsCS);
 
-    auto argToUAVTransition = CD3DX12_RESOURCE_BARRIER::Transition(m_pDispatchArgs, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
-    pCommandList->ResourceBarrier(1, &argToUAVTransition);
+    // The group counts only depend on the element counts, so they are computed here rather than
+    // generated for an indirect dispatch. Every list then records its dispatch for a step before
+    // the one barrier that the step needs, with the pipeline for the width of its keys.
+    auto DispatchLists = [&](uint32_t k, ID3D12PipelineState *pPSO, ID3D12PipelineState *p64BitPSO, auto GetGroupCount)
+    {
+        ID3D12PipelineState *pBoundPSO = nullptr;
+        for (UINT ListIndex = 0; ListIndex < NumLists; ListIndex++)
+        {
+            const SortList &List = pLists[ListIndex];
+            if (List.ElementCount == 0 || k > std::max(2048u, AlignPowerOfTwo(List.ElementCount))) continue;
 
-    pCommandList->SetComputeRoot32BitConstant(ShaderSpecificConstants, MaxIterations, 0);
-    pCommandList->SetComputeRootUnorderedAccessView(OutputUAV, m_pDispatchArgs->GetGPUVirtualAddress());
-    pCommandList->SetComputeRootUnorderedAccessView(IndexBufferUAV, IndexBuffer);
-    pCommandList->Dispatch(1, 1, 1);
+            UINT GroupCount = GetGroupCount(List.ElementCount);
+            if (GroupCount == 0) continue;
+
+            ID3D12PipelineState *pListPSO = List.Uses64BitKeys ? p64BitPSO : pPSO;
+            if (pListPSO != pBoundPSO)
+            {
+                pCommandList->SetPipelineState(pListPSO);
+                pBoundPSO = pListPSO;
+            }
+
+            InputConstants constants { SortAscending ? 0xffffffff : 0, List.ElementCount };
+            pCommandList->SetComputeRoot32BitConstants(GenericConstants, SizeOfInUint32(InputConstants), &constants, 0);
+            pCommandList->SetComputeRootUnorderedAccessView(OutputUAV, List.SortKeyBuffer);
+            pCommandList->SetComputeRootUnorderedAccessView(IndexBufferUAV, List.IndexBuffer);
+            pCommandList->Dispatch(GroupCount, 1, 1);
+        }
+    };
 
     // Pre-Sort the buffer up to k = 2048.  This also pads the list with invalid indices
     // that will drift to the end of the sorted list.
-    auto argToIndirectArgTransition = CD3DX12_RESOURCE_BARRIER::Transition(m_pDispatchArgs, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT);
-    pCommandList->ResourceBarrier(1, &argToIndirectArgTransition);
-    pCommandList->SetComputeRootUnorderedAccessView(OutputUAV, SortKeyBuffer);
-
     auto uavBarrier = CD3DX12_RESOURCE_BARRIER::UAV(nullptr);
     if (!IsPartiallyPreSorted)
     {
-        pCommandList->SetPipelineState(m_pBitonicPreSortCS);
-        pCommandList->ExecuteIndirect(m_pCommandSignature, 1, m_pDispatchArgs, 0, nullptr, 0);
+        DispatchLists(2048, m_pBitonicPreSortCS, m_pBitonicPreSort64BitCS, GetInnerSortGroupCount);
         pCommandList->ResourceBarrier(1, &uavBarrier);
     }
 
-    uint32_t IndirectArgsOffset = cIndirectArgStride;
-
     // We have already pre-sorted up through k = 2048 when first writing our list, so
-    // we continue sorting with k = 4096.  For unnecessarily large values of k, these
-    // indirect dispatches will be skipped over with thread counts of 0.
+    // we continue sorting with k = 4096.  Lists too short for a value of k are already
+    // sorted and skip its dispatches.
 
     for (uint32_t k = 4096; k <= AlignedNumElements; k *= 2)
     {
-        pCommandList->SetPipelineState(m_pBitonicOuterSortCS);
-
         for (uint32_t j = k / 2; j >= 2048; j /= 2)
         {
             struct OuterSortConstants
@@ -131,14 +158,11 @@ void BitonicSort::Sort(
             } constants { k, j };
 
             pCommandList->SetComputeRoot32BitConstants(ShaderSpecificConstants, SizeOfInUint32(OuterSortConstants), &constants, 0);
-            pCommandList->ExecuteIndirect(m_pCommandSignature, 1, m_pDispatchArgs, IndirectArgsOffset, nullptr, 0);
+            DispatchLists(k, m_pBitonicOuterSortCS, m_pBitonicOuterSort64BitCS, [j](UINT ElementCount) { return GetOuterSortGroupCount(ElementCount, j); });
             pCommandList->ResourceBarrier(1, &uavBarrier);
-            IndirectArgsOffset += cIndirectArgStride;
         }
 
-        pCommandList->SetPipelineState(m_pBitonicInnerSortCS);
-        pCommandList->ExecuteIndirect(m_pCommandSignature, 1, m_pDispatchArgs, IndirectArgsOffset, nullptr, 0);
+        DispatchLists(k, m_pBitonicInnerSortCS, m_pBitonicInnerSort64BitCS, GetInnerSortGroupCount);
         pCommandList->ResourceBarrier(1, &uavBarrier);
-        IndirectArgsOffset += cIndirectArgStride;
     }
 }
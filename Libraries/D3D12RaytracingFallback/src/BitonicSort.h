@@ -104,10 +104,34 @@ public:
         bool IsPartiallyPreSorted,
 
         // True to sort in ascending order (smallest to largest).  False to sort in descending order.
+        bool SortAscending,
+
+        // True if the keys are 64-bit, stored as uint2 with the most significant bits in y.
+        bool Uses64BitKeys = false
+    );
+
+    struct SortList
+    {
+        D3D12_GPU_VIRTUAL_ADDRESS SortKeyBuffer;
+        D3D12_GPU_VIRTUAL_ADDRESS IndexBuffer;
+        UINT ElementCount;
+        bool Uses64BitKeys;
+    };
+
+    // Sorts several independent lists together.  Each step of the sort is dispatched for every list
+    // before the barrier it needs, so the lists share barriers rather than sorting one after another.
+    void Sort(
+        ID3D12GraphicsCommandList *pCommandList,
+        UINT NumLists,
+        const SortList *pLists,
+        bool IsPartiallyPreSorted,
         bool SortAscending
     );
 
 private:
+    static UINT GetOuterSortGroupCount(UINT ElementCount, UINT j);
+    static UINT GetInnerSortGroupCount(UINT ElementCount);
+
     enum RootSignatureParams
     {
         GenericConstants,
@@ -118,13 +142,12 @@ private:
     };
 
     CComPtr<ID3D12RootSignature> m_pRootSignature;
-    CComPtr<ID3D12Resource> m_pDispatchArgs;
-
-    CComPtr<ID3D12CommandSignature> m_pCommandSignature;
-    const UINT cIndirectArgStride = 12;
 
-    CComPtr<ID3D12PipelineState> m_pBitonicIndirectArgsCS;
     CComPtr<ID3D12PipelineState> m_pBitonicPreSortCS;
     CComPtr<ID3D12PipelineState> m_pBitonicInnerSortCS;
     CComPtr<ID3D12PipelineState> m_pBitonicOuterSortCS;
+
+    CComPtr<ID3D12PipelineState> m_pBitonicPreSort64BitCS;
+    CComPtr<ID3D12PipelineState> m_pBitonicInnerSort64BitCS;
+    CComPtr<ID3D12PipelineState> m_pBitonicOuterSort64BitCS;
 };
@@ -34,6 +34,32 @@ uint InsertOneBit( uint Value, uint OneBitMask )
 // (effectively a negation) or leave the bits alone.  When the the NullItem is
 // 0, we are sorting descending, so when A < B, they should swap.  For an
 // ascending sort, ~A < ~B should swap.
+#ifdef SORT_64BIT_KEYS
+// 64-bit keys are stored as uint2 with the most significant bits in y
+#define SortKey uint2
+#define SizeOfSortKey 8
+#define LoadSortKey(buffer, element) buffer.Load2((element) * SizeOfSortKey)
+#define StoreSortKey(buffer, element, key) buffer.Store2((element) * SizeOfSortKey, key)
+
+bool ShouldSwap(uint2 A, uint2 B, uint indexA, uint indexB)
+{
+    if (all(A == B))
+    {
+        return indexA > indexB;
+    }
+    else
+    {
+        A ^= NullItem;
+        B ^= NullItem;
+        return A.y != B.y ? A.y < B.y : A.x < B.x;
+    }
+}
+#else
+#define SortKey uint
+#define SizeOfSortKey 4
+#define LoadSortKey(buffer, element) buffer.Load((element) * SizeOfSortKey)
+#define StoreSortKey(buffer, element, key) buffer.Store((element) * SizeOfSortKey, key)
+
 bool ShouldSwap(uint A, uint B, uint indexA, uint indexB)
 {
     if (A == B)
@@ -45,3 +71,4 @@ bool ShouldSwap(uint A, uint B, uint indexA, uint indexB)
         return (A ^ NullItem) < (B ^ NullItem);
     }
 }
+#endif
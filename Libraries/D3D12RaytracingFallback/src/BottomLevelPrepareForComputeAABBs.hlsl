@@ -41,7 +41,8 @@ void main(uint3 DTid : SV_DispatchThreadID)
     uint offsetToBoxes = SizeOfBVHOffsets;
     uint offsetToPrimitives = GetOffsetToPrimitives(Constants.NumberOfElements);
     uint offsetToPrimitiveMetaData = offsetToPrimitives + GetOffsetFromPrimitivesToPrimitiveMetaData(Constants.NumberOfElements);
-    uint totalSize = offsetToPrimitiveMetaData + Constants.NumberOfElements * SizeOfPrimitiveMetaData;
+    uint offsetToWideNodes = offsetToPrimitiveMetaData + Constants.NumberOfElements * SizeOfPrimitiveMetaData;
+    uint totalSize = offsetToWideNodes + GetSizeOfWideNodes(Constants.NumberOfElements);
 
     if (DTid.x == 0)
     {
@@ -49,5 +50,6 @@ void main(uint3 DTid : SV_DispatchThreadID)
         outputBVH.Store(OffsetToPrimitivesOffset, offsetToPrimitives);
         outputBVH.Store(OffsetToPrimitiveMetaDataOffset, offsetToPrimitiveMetaData);
         outputBVH.Store(OffsetToTotalSize, totalSize);
+        outputBVH.Store(OffsetToWideNodesOffset, offsetToWideNodes);
     }
 }
@@ -20,6 +20,20 @@ int CountLeadingZeroes(uint num)
     return 31 - firstbithigh(num);
 }
 
+#ifdef MORTON_CODES_64BIT
+#define MortonCode uint2
+#define MortonCodeBits 64
+
+// The most significant bits are in y
+int CountLeadingZeroes(uint2 num)
+{
+    return num.y ? CountLeadingZeroes(num.y) : 32 + CountLeadingZeroes(num.x);
+}
+#else
+#define MortonCode uint
+#define MortonCodeBits 32
+#endif
+
 void WriteChild(uint childIndex, uint parentIndex)
 {
     // Constructing new hierarchy, so the ParentIndex is already accurate, ie. doesn't need GetActualParentIndex()
@@ -40,16 +54,16 @@ int GetLongestCommonPrefix(uint indexA, uint indexB)
     }
     else
     {
-        uint mortonCodeA = mortonCodes[indexA];
-        uint mortonCodeB = mortonCodes[indexB];
-        if (mortonCodeA != mortonCodeB)
+        MortonCode mortonCodeA = mortonCodes[indexA];
+        MortonCode mortonCodeB = mortonCodes[indexB];
+        if (any(mortonCodeA != mortonCodeB))
         {
-            return CountLeadingZeroes(mortonCodes[indexA] ^ mortonCodes[indexB]);
+            return CountLeadingZeroes(mortonCodeA ^ mortonCodeB);
         }
         else
         {
             // TODO: Technically this should be primitive ID
-            return CountLeadingZeroes(indexA ^ indexB) + 31;
+            return CountLeadingZeroes(indexA ^ indexB) + MortonCodeBits - 1;
         }
     }
 }
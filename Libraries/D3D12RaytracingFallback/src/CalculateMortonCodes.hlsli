@@ -69,6 +69,52 @@ uint CalculateMortonCode(float3 elementCentroid)
 
     return GetMortonCodesFromUnitCoord(unitCoord, numPerIteration);
 }
+#elif defined(MORTON_CODES_64BIT)
+// Interleaves 10 bits of each coordinate, starting at firstBit, into 30 bits
+uint InterleaveBits(uint coords[3], uint firstBit)
+{
+    unsigned int mortonCode = 0;
+    const unsigned int numBits = 10;
+    const unsigned int numAxis = 3;
+    for (uint bitIndex = 0; bitIndex < numBits; bitIndex++)
+    {
+        for (uint axis = 0; axis < numAxis; axis++)
+        {
+            uint bit = BIT(firstBit + bitIndex) & coords[axis];
+            if (bit)
+            {
+                mortonCode |= BIT(bitIndex * numAxis + axis);
+            }
+        }
+    }
+    return mortonCode;
+}
+
+// 60-bit codes with the most significant 30 bits in y
+uint2 GetMortonCodesFromUnitCoord(float3 unitCoord)
+{
+    const unsigned int numBits = 20;
+    const float maxCoord = pow(2, numBits);
+
+    float3 adjustedCoord = min(max(unitCoord * maxCoord, 0.0f), maxCoord - 1);
+    uint coords[3] = { adjustedCoord.y, adjustedCoord.x, adjustedCoord.z };
+    return uint2(InterleaveBits(coords, 0), InterleaveBits(coords, numBits / 2));
+}
+
+uint2 CalculateMortonCode(float3 elementCentroid)
+{
+    const float epsilon = 0.00001;
+
+    // Quantize into cubic cells sized by the longest side of the scene, so a flat or long scene
+    // spends its leading bits splitting its long axes, like a SAH split would. 20 bits per axis
+    // leave enough cells along the short axes to still tell elements apart.
+    AABB sceneAABB = GetSceneAABB();
+    float3 dim = sceneAABB.max - sceneAABB.min;
+    float sceneDimension = max(max(dim.x, max(dim.y, dim.z)), epsilon);
+    float3 unitCoord = (elementCentroid - sceneAABB.min) / sceneDimension;
+
+    return GetMortonCodesFromUnitCoord(unitCoord);
+}
 #else
 uint GetMortonCodesFromUnitCoord(float3 unitCoord)
 {
@@ -112,8 +158,7 @@ void main(uint3 DTid : SV_DispatchThreadID)
     if (elementIndex >= Constants.NumberOfElements) return;
 
     float3 elementCentroid = GetCentroid(elementIndex);
-    uint mortonCode = CalculateMortonCode(elementCentroid);
 
-    OutputMortonCodesBuffer[elementIndex] = mortonCode;
+    OutputMortonCodesBuffer[elementIndex] = CalculateMortonCode(elementCentroid);
     OutputIndicesBuffer[elementIndex] = elementIndex;
 }
\ No newline at end of file
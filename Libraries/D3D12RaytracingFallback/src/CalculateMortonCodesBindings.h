@@ -31,7 +31,11 @@ struct MortonCodeCalculatorConstants
 
 #ifdef HLSL
 RWStructuredBuffer<uint> OutputIndicesBuffer : UAV_REGISTER(MortonCodeCalculatorCalculatorOutputIndices);
+#ifdef MORTON_CODES_64BIT
+RWStructuredBuffer<uint2> OutputMortonCodesBuffer : UAV_REGISTER(MortonCodeCalculatorCalculatorOutputMortonCodes);
+#else
 RWStructuredBuffer<uint> OutputMortonCodesBuffer : UAV_REGISTER(MortonCodeCalculatorCalculatorOutputMortonCodes);
+#endif
 RWByteAddressBuffer SceneAABB : UAV_REGISTER(MortonCodeCalculatorSceneAABBRegister);
 cbuffer MortonCodeCalculatorConstants : CONSTANT_REGISTER(MortonCodeCalculatorConstantsRegister)
 {
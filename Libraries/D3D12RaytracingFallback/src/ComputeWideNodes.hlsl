@@ -0,0 +1,188 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+#define HLSL
+#include "ConstructAABBBindings.h"
+#include "RayTracingHelper.hlsli"
+
+// Collapses the fitted binary hierarchy into 4-wide nodes. Every binary internal node at an even
+// depth becomes a wide node whose children are its grandchildren, or its child where that is a leaf.
+// Runs after the AABBs are fitted, on builds and updates alike, one thread per binary internal node.
+// Each wide node links back to its parent, the wide node made from its binary grandparent.
+
+static const uint rootNodeIndex = 0;
+static const int offsetToBoxes = SizeOfBVHOffsets;
+
+uint2 GetNodeFlags(uint boxIndex)
+{
+    uint nodeAddress = GetBoxAddress(offsetToBoxes, boxIndex);
+    return uint2(outputBVH.Load(nodeAddress + 12), outputBVH.Load(nodeAddress + 28));
+}
+
+uint GetParentIndex(uint boxIndex)
+{
+    if (ShouldPerformUpdate)
+    {
+        return aabbParentBuffer[boxIndex];
+    }
+
+    return GetActualParentIndex(hierarchyBuffer[boxIndex].ParentIndex);
+}
+
+// The slot of the wide node among its parent's children, in the order main() collects them
+uint GetSlotInParent(uint nodeIndex, uint binaryParentIndex, uint parentIndex)
+{
+    const uint2 parentFlags = GetNodeFlags(parentIndex);
+    uint slot = 0;
+    if (binaryParentIndex == GetRightNodeIndex(parentFlags))
+    {
+        slot = IsLeaf(GetNodeFlags(GetLeftNodeIndex(parentFlags))) ? 1 : 2;
+    }
+
+    return slot + (nodeIndex == GetRightNodeIndex(GetNodeFlags(binaryParentIndex)) ? 1 : 0);
+}
+
+// The biased exponent of the smallest power of two that covers the extent in 255 steps
+uint GetQuantizationExponent(float origin, float maxPlane)
+{
+    const uint stepBits = asuint((maxPlane - origin) * (1.0 / 255.0));
+    uint biasedExponent = clamp((stepBits >> 23) + ((stepBits & 0x7fffff) != 0), 1, 253);
+
+    precise float coveredPlane = origin + 255.0 * asfloat(biasedExponent << 23);
+    if (coveredPlane < maxPlane)
+    {
+        biasedExponent++;
+    }
+    return biasedExponent;
+}
+
+// Rounds the planes outwards, correcting by a step where the subtraction rounded the wrong way. The
+// origin and the covered extent bound every plane, so the correction never leaves the 0-255 range.
+uint3 QuantizeMin(float3 plane, float3 origin, float3 step, float3 inverseStep)
+{
+    uint3 steps = (uint3)clamp(floor((plane - origin) * inverseStep), 0, 255);
+    precise float3 dequantized = origin + steps * step;
+    return (dequantized > plane) ? steps - 1 : steps;
+}
+
+uint3 QuantizeMax(float3 plane, float3 origin, float3 step, float3 inverseStep)
+{
+    uint3 steps = (uint3)clamp(ceil((plane - origin) * inverseStep), 0, 255);
+    precise float3 dequantized = origin + steps * step;
+    return (dequantized < plane) ? steps + 1 : steps;
+}
+
+[numthreads(THREAD_GROUP_1D_WIDTH, 1, 1)]
+void main(uint3 DTid : SV_DispatchThreadID)
+{
+    const uint nodeIndex = DTid.x;
+    if (nodeIndex >= GetNumWideNodes(Constants.NumberOfElements))
+    {
+        return;
+    }
+
+    uint depth = 0;
+    for (uint ancestorIndex = nodeIndex; ancestorIndex != rootNodeIndex; depth++)
+    {
+        ancestorIndex = GetParentIndex(ancestorIndex);
+    }
+
+    if (depth & 1)
+    {
+        return;
+    }
+
+    uint childIndices[WIDE_NODE_MAX_CHILDREN];
+    uint childCount = 0;
+
+    const uint2 flags = GetNodeFlags(nodeIndex);
+    if (IsLeaf(flags))
+    {
+        // A single leaf at the root
+        childIndices[childCount++] = nodeIndex;
+    }
+    else
+    {
+        const uint binaryChildren[2] = { GetLeftNodeIndex(flags), GetRightNodeIndex(flags) };
+
+        [unroll]
+        for (uint i = 0; i < 2; i++)
+        {
+            const uint2 childFlags = GetNodeFlags(binaryChildren[i]);
+            if (IsLeaf(childFlags))
+            {
+                childIndices[childCount++] = binaryChildren[i];
+            }
+            else
+            {
+                childIndices[childCount++] = GetLeftNodeIndex(childFlags);
+                childIndices[childCount++] = GetRightNodeIndex(childFlags);
+            }
+        }
+    }
+
+    float3 childMin[WIDE_NODE_MAX_CHILDREN];
+    float3 childMax[WIDE_NODE_MAX_CHILDREN];
+    uint4 childReferences = ~0;
+    float3 origin = FLT_MAX;
+    float3 maxPlane = -FLT_MAX;
+
+    [unroll]
+    for (uint j = 0; j < WIDE_NODE_MAX_CHILDREN; j++)
+    {
+        if (j < childCount)
+        {
+            const BoundingBox box = GetBoxFromBuffer(outputBVH, offsetToBoxes, childIndices[j]);
+            childMin[j] = box.center - box.halfDim;
+            childMax[j] = box.center + box.halfDim;
+            origin = min(origin, childMin[j]);
+            maxPlane = max(maxPlane, childMax[j]);
+
+            const uint2 childFlags = GetNodeFlags(childIndices[j]);
+            childReferences[j] = IsLeaf(childFlags) ? childFlags.x : childIndices[j];
+        }
+    }
+
+    const uint3 biasedExponents = uint3(
+        GetQuantizationExponent(origin.x, maxPlane.x),
+        GetQuantizationExponent(origin.y, maxPlane.y),
+        GetQuantizationExponent(origin.z, maxPlane.z));
+    const float3 step = asfloat(biasedExponents << 23);
+    const float3 inverseStep = asfloat((254 - biasedExponents) << 23);
+
+    uint3 packedMin = 0;
+    uint3 packedMax = 0;
+
+    [unroll]
+    for (uint k = 0; k < WIDE_NODE_MAX_CHILDREN; k++)
+    {
+        if (k < childCount)
+        {
+            packedMin |= QuantizeMin(childMin[k], origin, step, inverseStep) << (k * 8);
+            packedMax |= QuantizeMax(childMax[k], origin, step, inverseStep) << (k * 8);
+        }
+    }
+
+    uint parentIndex = ~0;
+    uint slotInParent = 0;
+    if (nodeIndex != rootNodeIndex)
+    {
+        const uint binaryParentIndex = GetParentIndex(nodeIndex);
+        parentIndex = GetParentIndex(binaryParentIndex);
+        slotInParent = GetSlotInParent(nodeIndex, binaryParentIndex, parentIndex);
+    }
+
+    const uint exponentsAndChildCount = biasedExponents.x | (biasedExponents.y << 8) | (biasedExponents.z << 16) | (childCount << 24);
+    const uint wideNodeAddress = GetWideNodeAddress(outputBVH.Load(OffsetToWideNodesOffset), nodeIndex);
+    outputBVH.Store4(wideNodeAddress, uint4(asuint(origin), exponentsAndChildCount));
+    outputBVH.Store4(wideNodeAddress + 16, childReferences);
+    outputBVH.Store4(wideNodeAddress + 32, uint4(packedMin, packedMax.x));
+    outputBVH.Store4(wideNodeAddress + 48, uint4(packedMax.yz, parentIndex, slotInParent));
+}
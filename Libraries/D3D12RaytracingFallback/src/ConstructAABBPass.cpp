@@ -14,6 +14,7 @@
 #include "CompiledShaders/TopLevelComputeAABBs.h"
 #include "CompiledShaders/BottomLevelComputeAABBs.h"
 #include "CompiledShaders/BottomLevelPrepareForComputeAABBs.h"
+#include "CompiledShaders/ComputeWideNodes.h"
 
 namespace FallbackLayer
 {
@@ -37,6 +38,8 @@ namespace FallbackLayer
 
         CreatePSOHelper(pDevice, nodeMask, m_pRootSignature, COMPILED_SHADER(g_pBottomLevelComputeAABBs), &m_pComputeAABBs[Level::Bottom]);
         CreatePSOHelper(pDevice, nodeMask, m_pRootSignature, COMPILED_SHADER(g_pBottomLevelPrepareForComputeAABBs), &m_pPrepareForComputeAABBs[Level::Bottom]);
+
+        CreatePSOHelper(pDevice, nodeMask, m_pRootSignature, COMPILED_SHADER(g_pComputeWideNodes), &m_pComputeWideNodes);
     }
 
     void ConstructAABBPass::ConstructAABB(ID3D12GraphicsCommandList *pCommandList,
@@ -51,46 +54,87 @@ namespace FallbackLayer
         const bool performUpdate,
         UINT numElements)
     {
-        bool isEmptyAccelerationStructure = numElements == 0;
-        Level level = (sceneType == SceneType::Triangles) ? Level::Bottom : Level::Top;
+        BatchedBuild build = { outputVH, scratchBuffer, childNodesProcessedCountBuffer, hierarchyBuffer, outputAABBParentBuffer, prepareUpdate, performUpdate, numElements };
+        ConstructAABB(pCommandList, sceneType, globalDescriptorHeap, 1, &build);
+    }
+
+    void ConstructAABBPass::SetBuildRootArguments(ID3D12GraphicsCommandList *pCommandList, const BatchedBuild &build)
+    {
+        bool isEmptyAccelerationStructure = build.numElements == 0;
 
         InputConstants constants = {};
-        constants.NumberOfElements = numElements;
-        constants.UpdateFlags = ((UINT) prepareUpdate) | (performUpdate << 1);
+        constants.NumberOfElements = build.numElements;
+        constants.UpdateFlags = ((UINT) build.prepareUpdate) | (build.performUpdate << 1);
 
-        pCommandList->SetComputeRootSignature(m_pRootSignature);
         pCommandList->SetComputeRoot32BitConstants(InputRootConstants, SizeOfInUint32(InputConstants), &constants, 0);
-        pCommandList->SetComputeRootUnorderedAccessView(OutputBVHRootUAVParam, outputVH);
+        pCommandList->SetComputeRootUnorderedAccessView(OutputBVHRootUAVParam, build.outputVH);
         if (!isEmptyAccelerationStructure)
         {
-            pCommandList->SetComputeRootUnorderedAccessView(ScratchUAVParam, scratchBuffer);
-            pCommandList->SetComputeRootUnorderedAccessView(ChildNodesProcessedCountBufferParam, childNodesProcessedCountBuffer);
-            pCommandList->SetComputeRootUnorderedAccessView(HierarchyUAVParam, hierarchyBuffer);
+            pCommandList->SetComputeRootUnorderedAccessView(ScratchUAVParam, build.scratchBuffer);
+            pCommandList->SetComputeRootUnorderedAccessView(ChildNodesProcessedCountBufferParam, build.childNodesProcessedCountBuffer);
+
+            // A refit walks the parent indices saved with the BVH, and has no scratch for a hierarchy
+            pCommandList->SetComputeRootUnorderedAccessView(HierarchyUAVParam, build.performUpdate ? build.scratchBuffer : build.hierarchyBuffer);
         }
 
-        if (prepareUpdate || performUpdate)
+        if (build.prepareUpdate || build.performUpdate)
         {
-            pCommandList->SetComputeRootUnorderedAccessView(AABBParentBufferParam, outputAABBParentBuffer);
+            pCommandList->SetComputeRootUnorderedAccessView(AABBParentBufferParam, build.outputAABBParentBuffer);
         }
+    }
+
+    void ConstructAABBPass::ConstructAABB(ID3D12GraphicsCommandList *pCommandList,
+        SceneType sceneType,
+        D3D12_GPU_DESCRIPTOR_HANDLE globalDescriptorHeap,
+        UINT numBuilds,
+        const BatchedBuild *pBuilds)
+    {
+        Level level = (sceneType == SceneType::Triangles) ? Level::Bottom : Level::Top;
 
+        pCommandList->SetComputeRootSignature(m_pRootSignature);
         if (level == Top)
         {
             pCommandList->SetComputeRootDescriptorTable(GlobalDescriptorHeap, globalDescriptorHeap);
         }
 
         // Only given the GPU VA not the resource itself so need to resort to doing an overarching UAV barrier
-        const UINT dispatchWidth = isEmptyAccelerationStructure ? 1 : DivideAndRoundUp<UINT>(numElements, THREAD_GROUP_1D_WIDTH);
         auto uavBarrier = CD3DX12_RESOURCE_BARRIER::UAV(nullptr);
 
         pCommandList->SetPipelineState(m_pPrepareForComputeAABBs[level]);
-        pCommandList->Dispatch(dispatchWidth, 1, 1);
+        for (UINT buildIndex = 0; buildIndex < numBuilds; buildIndex++)
+        {
+            const BatchedBuild &build = pBuilds[buildIndex];
+            const UINT dispatchWidth = build.numElements == 0 ? 1 : DivideAndRoundUp<UINT>(build.numElements, THREAD_GROUP_1D_WIDTH);
+
+            SetBuildRootArguments(pCommandList, build);
+            pCommandList->Dispatch(dispatchWidth, 1, 1);
+        }
         pCommandList->ResourceBarrier(1, &uavBarrier);
 
-        if (isEmptyAccelerationStructure) return;
+        if (std::none_of(pBuilds, pBuilds + numBuilds, [](const BatchedBuild &build) { return build.numElements > 0; })) return;
 
         // Build the AABBs from the bottom-up
         pCommandList->SetPipelineState(m_pComputeAABBs[level]);
-        pCommandList->Dispatch(dispatchWidth, 1, 1);
+        for (UINT buildIndex = 0; buildIndex < numBuilds; buildIndex++)
+        {
+            const BatchedBuild &build = pBuilds[buildIndex];
+            if (build.numElements == 0) continue;
+
+            SetBuildRootArguments(pCommandList, build);
+            pCommandList->Dispatch(DivideAndRoundUp<UINT>(build.numElements, THREAD_GROUP_1D_WIDTH), 1, 1);
+        }
+        pCommandList->ResourceBarrier(1, &uavBarrier);
+
+        // Collapse the fitted hierarchy into the 4-wide nodes the traversal walks
+        pCommandList->SetPipelineState(m_pComputeWideNodes);
+        for (UINT buildIndex = 0; buildIndex < numBuilds; buildIndex++)
+        {
+            const BatchedBuild &build = pBuilds[buildIndex];
+            if (build.numElements == 0) continue;
+
+            SetBuildRootArguments(pCommandList, build);
+            pCommandList->Dispatch(DivideAndRoundUp<UINT>(GetNumWideNodes(build.numElements), THREAD_GROUP_1D_WIDTH), 1, 1);
+        }
         pCommandList->ResourceBarrier(1, &uavBarrier);
     }
 
@@ -27,6 +27,26 @@ namespace FallbackLayer
             const bool prepareUpdate,
             const bool performUpdate,
             UINT numElements);
+
+        struct BatchedBuild
+        {
+            D3D12_GPU_VIRTUAL_ADDRESS outputVH;
+            D3D12_GPU_VIRTUAL_ADDRESS scratchBuffer;
+            D3D12_GPU_VIRTUAL_ADDRESS childNodesProcessedCountBuffer;
+            D3D12_GPU_VIRTUAL_ADDRESS hierarchyBuffer;
+            D3D12_GPU_VIRTUAL_ADDRESS outputAABBParentBuffer;
+            bool prepareUpdate;
+            bool performUpdate;
+            UINT numElements;
+        };
+
+        // Fits the AABBs of every build, dispatching each of the three steps for the whole batch
+        // before the barrier it needs
+        void ConstructAABB(ID3D12GraphicsCommandList *pCommandList,
+            SceneType sceneType,
+            D3D12_GPU_DESCRIPTOR_HANDLE globalDescriptorHeap,
+            UINT numBuilds,
+            const BatchedBuild *pBuilds);
     private:
         enum RootParameterSlot
         {
@@ -50,5 +70,8 @@ namespace FallbackLayer
         CComPtr<ID3D12RootSignature> m_pRootSignature;
         CComPtr<ID3D12PipelineState> m_pPrepareForComputeAABBs[Level::NumLevels];
         CComPtr<ID3D12PipelineState> m_pComputeAABBs[Level::NumLevels];
+        CComPtr<ID3D12PipelineState> m_pComputeWideNodes;
+
+        void SetBuildRootArguments(ID3D12GraphicsCommandList *pCommandList, const BatchedBuild &build);
     };
 }
@@ -30,7 +30,11 @@ struct InputConstants
 #define InputConstantsRegister 0
 
 #ifdef HLSL
+#ifdef MORTON_CODES_64BIT
+RWStructuredBuffer<uint2> mortonCodes : UAV_REGISTER(MortonCodesBufferRegister);
+#else
 RWStructuredBuffer<uint> mortonCodes : UAV_REGISTER(MortonCodesBufferRegister);
+#endif
 RWStructuredBuffer<HierarchyNode> hierarchyBuffer : UAV_REGISTER(HierarchyBufferRegister);
 RWByteAddressBuffer DescriptorHeapBufferTable[] : UAV_REGISTER_SPACE(GlobalDescriptorHeapRegister, GlobalDescriptorHeapRegisterSpace);
 
@@ -12,6 +12,8 @@
 #include "ConstructHierarchyBindings.h"
 #include "CompiledShaders/TopLevelBuildBVHSplits.h"
 #include "CompiledShaders/BottomLevelBuildBVHSplits.h"
+#include "CompiledShaders/TopLevelBuildBVHSplits64Bit.h"
+#include "CompiledShaders/BottomLevelBuildBVHSplits64Bit.h"
 
 namespace FallbackLayer
 {
@@ -30,6 +32,10 @@ namespace FallbackLayer
         CreatePSOHelper(pDevice, nodeMask, m_pRootSignature, COMPILED_SHADER(g_pTopLevelBuildBVHSplits), &m_pBuildSplits[Level::Top]);
 
         CreatePSOHelper(pDevice, nodeMask, m_pRootSignature, COMPILED_SHADER(g_pBottomLevelBuildBVHSplits), &m_pBuildSplits[Level::Bottom]);
+
+        CreatePSOHelper(pDevice, nodeMask, m_pRootSignature, COMPILED_SHADER(g_pTopLevelBuildBVHSplits64Bit), &m_pBuildSplits64Bit[Level::Top]);
+
+        CreatePSOHelper(pDevice, nodeMask, m_pRootSignature, COMPILED_SHADER(g_pBottomLevelBuildBVHSplits64Bit), &m_pBuildSplits64Bit[Level::Bottom]);
     }
 
     void ConstructHierarchyPass::ConstructHierarchy(ID3D12GraphicsCommandList *pCommandList,
@@ -37,29 +43,53 @@ namespace FallbackLayer
         D3D12_GPU_VIRTUAL_ADDRESS mortonCodeBuffer,
         D3D12_GPU_VIRTUAL_ADDRESS hierarchyBuffer,
         D3D12_GPU_DESCRIPTOR_HANDLE globalDescriptorHeap,
-        UINT numElements)
+        UINT numElements,
+        bool uses64BitMortonCodes)
     {
-        if (numElements == 0) return;
+        BatchedBuild build = { mortonCodeBuffer, hierarchyBuffer, numElements, uses64BitMortonCodes };
+        ConstructHierarchy(pCommandList, sceneType, globalDescriptorHeap, 1, &build);
+    }
 
-        Level level = (sceneType == SceneType::Triangles) ? Level::Bottom : Level::Top;
+    void ConstructHierarchyPass::ConstructHierarchy(ID3D12GraphicsCommandList *pCommandList,
+        SceneType sceneType,
+        D3D12_GPU_DESCRIPTOR_HANDLE globalDescriptorHeap,
+        UINT numBuilds,
+        const BatchedBuild *pBuilds)
+    {
+        if (std::none_of(pBuilds, pBuilds + numBuilds, [](const BatchedBuild &build) { return build.numElements > 0; })) return;
 
-        InputConstants constants = { numElements };
+        Level level = (sceneType == SceneType::Triangles) ? Level::Bottom : Level::Top;
 
         pCommandList->SetComputeRootSignature(m_pRootSignature);
-        pCommandList->SetComputeRoot32BitConstants(InputRootConstants, SizeOfInUint32(InputConstants), &constants, 0);
-        pCommandList->SetComputeRootUnorderedAccessView(MortonCodesBufferParam, mortonCodeBuffer);
-        pCommandList->SetComputeRootUnorderedAccessView(HierarchyUAVParam, hierarchyBuffer);
         if (level == Top)
         {
             pCommandList->SetComputeRootDescriptorTable(GlobalDescriptorHeap, globalDescriptorHeap);
         }
 
+        ID3D12PipelineState *pBoundPSO = nullptr;
+        for (UINT buildIndex = 0; buildIndex < numBuilds; buildIndex++)
+        {
+            const BatchedBuild &build = pBuilds[buildIndex];
+            if (build.numElements == 0) continue;
+
+            ID3D12PipelineState *pBuildPSO = build.uses64BitMortonCodes ? m_pBuildSplits64Bit[level] : m_pBuildSplits[level];
+            if (pBuildPSO != pBoundPSO)
+            {
+                pCommandList->SetPipelineState(pBuildPSO);
+                pBoundPSO = pBuildPSO;
+            }
+
+            InputConstants constants = { build.numElements };
+            pCommandList->SetComputeRoot32BitConstants(InputRootConstants, SizeOfInUint32(InputConstants), &constants, 0);
+            pCommandList->SetComputeRootUnorderedAccessView(MortonCodesBufferParam, build.mortonCodeBuffer);
+            pCommandList->SetComputeRootUnorderedAccessView(HierarchyUAVParam, build.hierarchyBuffer);
+
+            const UINT dispatchWidth = DivideAndRoundUp<UINT>(build.numElements, THREAD_GROUP_1D_WIDTH);
+            pCommandList->Dispatch(dispatchWidth, 1, 1);
+        }
+
         // Only given the GPU VA not the resource itself so need to resort to doing an overarching UAV barrier
-        const UINT dispatchWidth = DivideAndRoundUp<UINT>(numElements, THREAD_GROUP_1D_WIDTH);
         auto uavBarrier = CD3DX12_RESOURCE_BARRIER::UAV(nullptr);
-
-        pCommandList->SetPipelineState(m_pBuildSplits[level]);
-        pCommandList->Dispatch(dispatchWidth, 1, 1);
         pCommandList->ResourceBarrier(1, &uavBarrier);
     }
 
@@ -21,7 +21,23 @@ namespace FallbackLayer
             D3D12_GPU_VIRTUAL_ADDRESS mortonCodeBuffer,
             D3D12_GPU_VIRTUAL_ADDRESS hierarchyBuffer,
             D3D12_GPU_DESCRIPTOR_HANDLE globalDescriptorHeap,
-            UINT numElements);
+            UINT numElements,
+            bool uses64BitMortonCodes = false);
+
+        struct BatchedBuild
+        {
+            D3D12_GPU_VIRTUAL_ADDRESS mortonCodeBuffer;
+            D3D12_GPU_VIRTUAL_ADDRESS hierarchyBuffer;
+            UINT numElements;
+            bool uses64BitMortonCodes;
+        };
+
+        // Splits the hierarchy of every build in one dispatch each, behind a single barrier
+        void ConstructHierarchy(ID3D12GraphicsCommandList *pCommandList,
+            SceneType sceneType,
+            D3D12_GPU_DESCRIPTOR_HANDLE globalDescriptorHeap,
+            UINT numBuilds,
+            const BatchedBuild *pBuilds);
     private:
         enum RootParameterSlot
         {
@@ -41,5 +57,6 @@ namespace FallbackLayer
 
         CComPtr<ID3D12RootSignature> m_pRootSignature;
         CComPtr<ID3D12PipelineState> m_pBuildSplits[Level::NumLevels];
+        CComPtr<ID3D12PipelineState> m_pBuildSplits64Bit[Level::NumLevels];
     };
 }
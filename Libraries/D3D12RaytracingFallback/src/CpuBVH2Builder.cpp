@@ -175,6 +175,7 @@ namespace FallbackLayer
 
         bvh.m_nodes[nodeIndex].leafNode.firstTriangleId = idIndex;
         bvh.m_nodes[nodeIndex].leafNode.numTriangleIds = (UINT32)metadata.size();
+        bvh.m_nodes[nodeIndex].numTriangles = (UINT32)metadata.size();
 
         return nodeIndex;
     }
@@ -221,24 +222,46 @@ namespace FallbackLayer
 
     static
         float ComputeBoxSurfaceArea(
+            DirectX::FXMVECTOR boxMin,
+            DirectX::FXMVECTOR boxMax)
+    {
+        using namespace DirectX;
+        const XMVECTOR dims = XMVectorSubtract(boxMax, boxMin);
+
+        // dims.x * dims.y + dims.y * dims.z + dims.z * dims.x
+        return 2 * XMVectorGetX(XMVector3Dot(dims, XMVectorSwizzle<1, 2, 0, 3>(dims)));
+    }
+
+    static
+        DirectX::XMVECTOR LoadBoxMin(
             const AABB& box)
     {
-        const float dims[3] =
-        {
-            box.max.x - box.min.x,
-            box.max.y - box.min.y,
-            box.max.z - box.min.z
-        };
+        return DirectX::XMLoadFloat3((const DirectX::XMFLOAT3*)box.minArr);
+    }
 
-        return 2 * (dims[0] * dims[1] + dims[0] * dims[2] + dims[1] * dims[2]);
+    static
+        DirectX::XMVECTOR LoadBoxMax(
+            const AABB& box)
+    {
+        return DirectX::XMLoadFloat3((const DirectX::XMFLOAT3*)box.maxArr);
     }
 
+    static const UINT NUM_SAH_BINS = 64;
+
+    //
+    // The bin of a triangle's centroid along each axis
+    //
+
     static
-        void InitBoxToInverseMax(
-            AABB& box)
+        DirectX::XMVECTOR ComputeSahBinIndices(
+            const AABB& triBox,
+            DirectX::FXMVECTOR rangeMin,
+            DirectX::FXMVECTOR binsPerUnit)
     {
-        box.max.x = box.max.y = box.max.z = -10e10f;//FLT_MAX;
-        box.min.x = box.min.y = box.min.z = 10e10f;//FLT_MAX;
+        using namespace DirectX;
+        const XMVECTOR centroid = XMVectorScale(XMVectorAdd(LoadBoxMin(triBox), LoadBoxMax(triBox)), 0.5f);
+        const XMVECTOR binIndices = XMVectorTruncate(XMVectorMultiply(XMVectorSubtract(centroid, rangeMin), binsPerUnit));
+        return XMVectorClamp(binIndices, XMVectorZero(), XMVectorReplicate((float)(NUM_SAH_BINS - 1)));
     }
 
     //
@@ -253,59 +276,70 @@ namespace FallbackLayer
             const AABB& nodeBox,
             const std::vector<AABB>& boxes)
     {
-        static const UINT NUM_SAH_BINS = 64;
+        using namespace DirectX;
 
         struct SahBin
         {
-            AABB    box;
-            UINT    numTriangles;
+            XMVECTOR    boxMin;
+            XMVECTOR    boxMax;
+            UINT        numTriangles;
         };
 
-        // NOTE: use vector if this blows out the stack?
         SahBin  sahBins[3][NUM_SAH_BINS];
 
         // For the score to be meaningful it seems we need to normalize it to something
-        const float normalizeToParent = 1.f / ComputeBoxSurfaceArea(nodeBox);
+        const XMVECTOR nodeMin = LoadBoxMin(nodeBox);
+        const XMVECTOR nodeMax = LoadBoxMax(nodeBox);
+        const float normalizeToParent = 1.f / ComputeBoxSurfaceArea(nodeMin, nodeMax);
 
         const UINT numTris = (UINT)metadata.size();
 
         float bestSah = FLT_MAX;
+        UINT bestBin = 0;
         maxDimension = 0;
-        //numTrisInLeftNode = triangleIds.size() / 2;
+        numTrisInLeftNode = 0;
 
-        // Compute SAH score per axis
+        // Flat axes put everything in the first bin and are never split
+        const XMVECTOR extents = XMVectorSubtract(nodeMax, nodeMin);
+        const XMVECTOR isFlat = XMVectorEqual(extents, XMVectorZero());
+        const XMVECTOR binsPerUnit = XMVectorSelect(XMVectorDivide(XMVectorReplicate((float)NUM_SAH_BINS), extents), XMVectorZero(), isFlat);
+
+        // Init boxes
         for (UINT i = 0; i < 3; ++i)
         {
-            const float extents = nodeBox.maxArr[i] - nodeBox.minArr[i];
-            if (extents == 0)
-                continue;
-
-            const float rangeMin = nodeBox.minArr[i];
-
-            const float inverseExtents = 1.f / extents;
-
-            // Init boxes
             for (UINT j = 0; j < NUM_SAH_BINS; ++j)
             {
                 sahBins[i][j].numTriangles = 0;
-                InitBoxToInverseMax(sahBins[i][j].box);
+                sahBins[i][j].boxMin = XMVectorReplicate(10e10f);
+                sahBins[i][j].boxMax = XMVectorReplicate(-10e10f);
             }
+        }
 
-            // Place triangles into the buckets
-            for (UINT j = 0; j < metadata.size(); ++j)
-            {
-                const UINT triId = metadata[j].PrimitiveIndex;
-
-                const AABB& triBox = boxes[triId];
-
-                const float centroid = (triBox.maxArr[i] + triBox.minArr[i]) * 0.5f;
+        // Place triangles into the buckets of all three axes in one pass
+        for (UINT j = 0; j < numTris; ++j)
+        {
+            const AABB& triBox = boxes[metadata[j].PrimitiveIndex];
+            const XMVECTOR triMin = LoadBoxMin(triBox);
+            const XMVECTOR triMax = LoadBoxMax(triBox);
 
-                const UINT binIndex = std::min(NUM_SAH_BINS - 1,
-                    UINT(NUM_SAH_BINS * ((centroid - rangeMin) * inverseExtents)));
+            XMFLOAT3 binIndices;
+            XMStoreFloat3(&binIndices, ComputeSahBinIndices(triBox, nodeMin, binsPerUnit));
+            const UINT binIndex[3] = { (UINT)binIndices.x, (UINT)binIndices.y, (UINT)binIndices.z };
 
-                sahBins[i][binIndex].numTriangles++;
-                AddExtentToBox(sahBins[i][binIndex].box, triBox);
+            for (UINT i = 0; i < 3; ++i)
+            {
+                SahBin& bin = sahBins[i][binIndex[i]];
+                bin.numTriangles++;
+                bin.boxMin = XMVectorMin(bin.boxMin, triMin);
+                bin.boxMax = XMVectorMax(bin.boxMax, triMax);
             }
+        }
+
+        // Compute SAH score per axis
+        for (UINT i = 0; i < 3; ++i)
+        {
+            if (XMVectorGetByIndex(extents, i) == 0)
+                continue;
 
             // Make sure we caught all of them once
             UINT testTris = 0;
@@ -315,25 +349,21 @@ namespace FallbackLayer
             }
             assert(testTris == numTris);
 
-            // Precompute left and right boxes with counts to be able to test plane positionings
+            // Precompute the boxes to the right of each plane position; the left ones grow as the planes are tested
+            XMVECTOR rightBoxMin[NUM_SAH_BINS];
+            XMVECTOR rightBoxMax[NUM_SAH_BINS];
 
-            AABB leftBoxes[NUM_SAH_BINS];
-            AABB rightBoxes[NUM_SAH_BINS];
-
-            for (UINT j = 0; j < NUM_SAH_BINS; ++j)
+            rightBoxMin[NUM_SAH_BINS - 1] = sahBins[i][NUM_SAH_BINS - 1].boxMin;
+            rightBoxMax[NUM_SAH_BINS - 1] = sahBins[i][NUM_SAH_BINS - 1].boxMax;
+            for (UINT j = NUM_SAH_BINS - 1; j > 0; --j)
             {
-                const UINT rightIdx = NUM_SAH_BINS - j - 1;
-
-                rightBoxes[rightIdx] = sahBins[i][rightIdx].box;
-                leftBoxes[j] = sahBins[i][j].box;
-
-                if (j > 0)
-                {
-                    AddExtentToBox(leftBoxes[j], leftBoxes[j - 1]);
-                    AddExtentToBox(rightBoxes[rightIdx], rightBoxes[rightIdx + 1]);
-                }
+                rightBoxMin[j - 1] = XMVectorMin(rightBoxMin[j], sahBins[i][j - 1].boxMin);
+                rightBoxMax[j - 1] = XMVectorMax(rightBoxMax[j], sahBins[i][j - 1].boxMax);
             }
 
+            XMVECTOR leftBoxMin = XMVectorReplicate(10e10f);
+            XMVECTOR leftBoxMax = XMVectorReplicate(-10e10f);
+
             UINT numTrianglesOnLeft = 0;
             UINT numTrianglesOnRight = numTris;
 
@@ -345,11 +375,19 @@ namespace FallbackLayer
                     continue;
                 }
 
+                leftBoxMin = XMVectorMin(leftBoxMin, sahBins[i][j].boxMin);
+                leftBoxMax = XMVectorMax(leftBoxMax, sahBins[i][j].boxMax);
+
                 numTrianglesOnLeft += sahBins[i][j].numTriangles;
                 numTrianglesOnRight -= sahBins[i][j].numTriangles;
 
-                const float sah = (numTrianglesOnLeft * ComputeBoxSurfaceArea(leftBoxes[j]) +
-                    numTrianglesOnRight * ComputeBoxSurfaceArea(rightBoxes[j + 1])) *
+                if (!numTrianglesOnRight)
+                {
+                    break;
+                }
+
+                const float sah = (numTrianglesOnLeft * ComputeBoxSurfaceArea(leftBoxMin, leftBoxMax) +
+                    numTrianglesOnRight * ComputeBoxSurfaceArea(rightBoxMin[j + 1], rightBoxMax[j + 1])) *
                     normalizeToParent;
 
                 assert(!_isnan(sah));
@@ -357,17 +395,63 @@ namespace FallbackLayer
                 if (sah < bestSah)
                 {
                     bestSah = sah;
+                    bestBin = j;
                     maxDimension = i;
                     numTrisInLeftNode = numTrianglesOnLeft;
                 }
             }
         }
 
+        if (numTrisInLeftNode == 0)
+        {
+            // No plane separates anything, leave a median split to the caller
+            SortByCentroid(metadata, boxes, maxDimension);
+            return;
+        }
+
         //
-        // Split the set to try to get a balanced tree
+        // Move the triangles left of the best plane to the front
         //
 
-        SortByCentroid(metadata, boxes, maxDimension);
+        std::partition(metadata.begin(), metadata.end(), [&](const PrimitiveMetaData& primitive) -> bool
+        {
+            const XMVECTOR binIndices = ComputeSahBinIndices(boxes[primitive.PrimitiveIndex], nodeMin, binsPerUnit);
+            return (UINT)XMVectorGetByIndex(binIndices, maxDimension) <= bestBin;
+        });
+    }
+
+    //
+    // Find separating plane. Use Median for speed.
+    // SAH is better but also more expensive to build.
+    // Returns the number of primitives moved to the front for the left child.
+    //
+
+    static
+        UINT32 SplitPrimitives(
+            std::vector<PrimitiveMetaData>& metadata,
+            UINT32& splitDimension,
+            const AABB& nodeBox,
+            const std::vector<AABB>& boxes)
+    {
+        UINT32 leftChildNumNodes;
+
+        SahSplit(metadata,
+            splitDimension,
+            leftChildNumNodes,
+            nodeBox,
+            boxes);
+
+        assert(leftChildNumNodes <= metadata.size());
+
+        // Try to balance by using the median if SAH failed
+        if ((leftChildNumNodes == 0 ||
+            leftChildNumNodes == metadata.size()) &&
+            metadata.size() > MAX_TRIS_IN_LEAF)
+        {
+            leftChildNumNodes = (UINT)metadata.size() / 2;
+        }
+
+        return leftChildNumNodes;
     }
 
     //
@@ -381,7 +465,7 @@ namespace FallbackLayer
     // -- there could be a varaible number of triangles in leaves
     //
     static
-        void BuildBVH(
+        void BuildSubtreeBVH(
             BVH& bvh,
             const std::vector<AABB>& boxes,
             const std::vector<PrimitiveMetaData>& primitiveMetaData,
@@ -443,30 +527,8 @@ namespace FallbackLayer
             }
             else
             {
-                //
-                // Find separating plane. Use Median for speed.
-                // SAH is better but also more expensive to build.
-                //
-
                 UINT splitDimension;
-                UINT leftChildNumNodes;
-
-                SahSplit(item->primitiveMetaData,
-                    splitDimension,
-                    leftChildNumNodes,
-                    nodeBox,
-                    boxes);
-
-                assert(leftChildNumNodes <= item->primitiveMetaData.size());
-
-                // Try to balance by using the median if SAH failed
-                if ((leftChildNumNodes == 0 ||
-                    leftChildNumNodes == item->primitiveMetaData.size()) &&
-                    item->primitiveMetaData.size() > MAX_TRIS_IN_LEAF)
-                {
-                    leftChildNumNodes = (UINT)item->primitiveMetaData.size() / 2;
-                }
-
+                const UINT32 leftChildNumNodes = SplitPrimitives(item->primitiveMetaData, splitDimension, nodeBox, boxes);
                 const UINT32 rightChildNumNodes = (UINT32)item->primitiveMetaData.size() - leftChildNumNodes;
 
 
@@ -515,6 +577,259 @@ namespace FallbackLayer
         }
     }
 
+    //
+    // Subtrees below the first few splits share nothing, so once there are enough of them to keep
+    // every core busy they're built in parallel and appended after the nodes above them
+    //
+
+    static const UINT32 MIN_PRIMITIVES_TO_SPLIT_BEFORE_PARALLEL_BUILD = 1024;
+    static const UINT32 PARALLEL_SUBTREES_PER_THREAD = 4;
+
+    static
+        void AppendSubtreeBVH(
+            BVH& bvh,
+            const BVH& subtree,
+            UINT32 parentIndex,
+            bool right)
+    {
+        const UINT32 nodeOffset = (UINT32)bvh.m_nodes.size();
+        const UINT32 triangleIdOffset = (UINT32)bvh.m_metadata.size();
+
+        for (AABBNode node : subtree.m_nodes)
+        {
+            if (node.leaf)
+            {
+                node.leafNode.firstTriangleId += triangleIdOffset;
+            }
+            else
+            {
+                node.internalNode.leftNodeIndex += nodeOffset;
+                node.rightNodeIndex += nodeOffset;
+            }
+            bvh.m_nodes.push_back(node);
+        }
+        std::copy(subtree.m_metadata.begin(), subtree.m_metadata.end(), std::back_inserter(bvh.m_metadata));
+
+        if (parentIndex != -1)
+        {
+            if (right)
+            {
+                bvh.m_nodes[parentIndex].rightNodeIndex = nodeOffset;
+            }
+            else
+            {
+                bvh.m_nodes[parentIndex].internalNode.leftNodeIndex = nodeOffset;
+            }
+        }
+    }
+
+    static
+        void BuildBVH(
+            BVH& bvh,
+            const std::vector<AABB>& boxes,
+            const std::vector<PrimitiveMetaData>& primitiveMetaData,
+            UINT32 maxTrisInLeaf)
+    {
+        struct Subtree
+        {
+            std::vector<PrimitiveMetaData> primitiveMetaData;
+            UINT32              parentIndex;
+            bool                right;
+        };
+
+        const UINT32 maxSubtrees = std::max(1u, std::thread::hardware_concurrency()) * PARALLEL_SUBTREES_PER_THREAD;
+
+        std::vector<Subtree> subtrees;
+        std::deque<Subtree> unsplitSubtrees;
+        unsplitSubtrees.push_back({ primitiveMetaData, (UINT32)-1, false });
+
+        // Split breadth first so the subtrees come out about the same size
+        while (!unsplitSubtrees.empty())
+        {
+            Subtree item = std::move(unsplitSubtrees.front());
+            unsplitSubtrees.pop_front();
+
+            const bool enoughSubtrees = subtrees.size() + unsplitSubtrees.size() + 2 > maxSubtrees;
+            if (enoughSubtrees || item.primitiveMetaData.size() < MIN_PRIMITIVES_TO_SPLIT_BEFORE_PARALLEL_BUILD)
+            {
+                subtrees.push_back(std::move(item));
+                continue;
+            }
+
+            AABB nodeBox;
+            ComputeBox(nodeBox, boxes, item.primitiveMetaData);
+
+            UINT splitDimension;
+            const UINT32 leftChildNumNodes = SplitPrimitives(item.primitiveMetaData, splitDimension, nodeBox, boxes);
+            const UINT32 thisNodeIndex = BuildBVHAddNode(bvh, nodeBox, splitDimension);
+
+            if (item.parentIndex != -1)
+            {
+                if (item.right)
+                {
+                    bvh.m_nodes[item.parentIndex].rightNodeIndex = thisNodeIndex;
+                }
+                else
+                {
+                    bvh.m_nodes[item.parentIndex].internalNode.leftNodeIndex = thisNodeIndex;
+                }
+            }
+
+            auto splitPoint = item.primitiveMetaData.begin() + leftChildNumNodes;
+            unsplitSubtrees.push_back({ std::vector<PrimitiveMetaData>(item.primitiveMetaData.begin(), splitPoint), thisNodeIndex, false });
+            unsplitSubtrees.push_back({ std::vector<PrimitiveMetaData>(splitPoint, item.primitiveMetaData.end()), thisNodeIndex, true });
+        }
+
+        std::vector<BVH> subtreeBVHs(subtrees.size());
+        std::vector<std::future<void>> subtreeBuilds;
+        for (size_t i = 1; i < subtrees.size(); ++i)
+        {
+            subtreeBuilds.push_back(std::async(std::launch::async, [&, i]()
+            {
+                BuildSubtreeBVH(subtreeBVHs[i], boxes, subtrees[i].primitiveMetaData, maxTrisInLeaf);
+            }));
+        }
+
+        BuildSubtreeBVH(subtreeBVHs[0], boxes, subtrees[0].primitiveMetaData, maxTrisInLeaf);
+        for (auto& subtreeBuild : subtreeBuilds)
+        {
+            subtreeBuild.get();
+        }
+
+        for (size_t i = 0; i < subtrees.size(); ++i)
+        {
+            AppendSubtreeBVH(bvh, subtreeBVHs[i], subtrees[i].parentIndex, subtrees[i].right);
+        }
+    }
+
+    //
+    // Quantize 4-wide nodes the way ComputeWideNodes.hlsl does, so both builders
+    // produce planes the traversal decodes identically
+    //
+
+    static
+        float AsFloat(UINT bits)
+    {
+        return (float&)bits;
+    }
+
+    static
+        UINT GetQuantizationExponent(float origin, float maxPlane)
+    {
+        const float step = (maxPlane - origin) * (1.0f / 255.0f);
+        const UINT stepBits = (UINT&)step;
+        UINT biasedExponent = std::min(std::max((stepBits >> 23) + ((stepBits & 0x7fffff) != 0), 1u), 253u);
+        if (origin + 255.0f * AsFloat(biasedExponent << 23) < maxPlane)
+        {
+            biasedExponent++;
+        }
+        return biasedExponent;
+    }
+
+    static
+        UINT QuantizeMin(float plane, float origin, float step, float inverseStep)
+    {
+        const UINT steps = (UINT)std::min(std::max(floorf((plane - origin) * inverseStep), 0.0f), 255.0f);
+        return (origin + steps * step > plane) ? steps - 1 : steps;
+    }
+
+    static
+        UINT QuantizeMax(float plane, float origin, float step, float inverseStep)
+    {
+        const UINT steps = (UINT)std::min(std::max(ceilf((plane - origin) * inverseStep), 0.0f), 255.0f);
+        return (origin + steps * step < plane) ? steps + 1 : steps;
+    }
+
+    //
+    // Collapse the binary nodes into 4-wide nodes, depth first. Returns the index of
+    // the wide node made for the subtree at nodeIndex, which links back to its parent.
+    //
+
+    static
+        UINT32 BuildWideNodes(
+            const BVH& bvh,
+            UINT32 nodeIndex,
+            UINT32 parentIndex,
+            UINT32 slotInParent,
+            std::vector<WideNode>& wideNodes)
+    {
+        const UINT32 wideNodeIndex = (UINT32)wideNodes.size();
+        wideNodes.push_back({});
+
+        UINT32 childIndices[WIDE_NODE_MAX_CHILDREN];
+        UINT childCount = 0;
+
+        const AABBNode& node = bvh.m_nodes[nodeIndex];
+        if (node.leaf)
+        {
+            childIndices[childCount++] = nodeIndex;
+        }
+        else
+        {
+            const UINT32 binaryChildren[2] = { node.internalNode.leftNodeIndex, node.rightNodeIndex };
+            for (UINT32 binaryChild : binaryChildren)
+            {
+                const AABBNode& child = bvh.m_nodes[binaryChild];
+                if (child.leaf)
+                {
+                    childIndices[childCount++] = binaryChild;
+                }
+                else
+                {
+                    childIndices[childCount++] = child.internalNode.leftNodeIndex;
+                    childIndices[childCount++] = child.rightNodeIndex;
+                }
+            }
+        }
+
+        float origin[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+        float maxPlane[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+        for (UINT i = 0; i < childCount; ++i)
+        {
+            const AABBNode& child = bvh.m_nodes[childIndices[i]];
+            for (UINT k = 0; k < 3; ++k)
+            {
+                origin[k] = std::min(origin[k], child.center[k] - child.halfDim[k]);
+                maxPlane[k] = std::max(maxPlane[k], child.center[k] + child.halfDim[k]);
+            }
+        }
+
+        WideNode wideNode = {};
+        wideNode.exponentsAndChildCount = childCount << 24;
+        wideNode.parentIndex = parentIndex;
+        wideNode.slotInParent = slotInParent;
+        for (UINT k = 0; k < 3; ++k)
+        {
+            const UINT biasedExponent = GetQuantizationExponent(origin[k], maxPlane[k]);
+            const float step = AsFloat(biasedExponent << 23);
+            const float inverseStep = AsFloat((254 - biasedExponent) << 23);
+
+            wideNode.origin[k] = origin[k];
+            wideNode.exponentsAndChildCount |= biasedExponent << (k * 8);
+            for (UINT i = 0; i < childCount; ++i)
+            {
+                const AABBNode& child = bvh.m_nodes[childIndices[i]];
+                wideNode.quantizedMin[k] |= QuantizeMin(child.center[k] - child.halfDim[k], origin[k], step, inverseStep) << (i * 8);
+                wideNode.quantizedMax[k] |= QuantizeMax(child.center[k] + child.halfDim[k], origin[k], step, inverseStep) << (i * 8);
+            }
+        }
+
+        for (UINT i = 0; i < WIDE_NODE_MAX_CHILDREN; ++i)
+        {
+            if (i >= childCount)
+            {
+                wideNode.childReferences[i] = (UINT)-1;
+                continue;
+            }
+
+            const AABBNode& child = bvh.m_nodes[childIndices[i]];
+            wideNode.childReferences[i] = child.leaf ? child.nodeAllBits : BuildWideNodes(bvh, childIndices[i], wideNodeIndex, i, wideNodes);
+        }
+
+        wideNodes[wideNodeIndex] = wideNode;
+        return wideNodeIndex;
+    }
+
     void BuildUniformBVH(
         _In_  UINT NumElements,
         _In_reads_opt_(NumElements)  const D3D12_RAYTRACING_GEOMETRY_DESC *pGeometries,
@@ -673,7 +988,7 @@ void BuildRaytracingAccelerationStructureOnCpu(
     FallbackLayer::BuildUniformBVH(pDesc->Inputs.NumDescs, pDesc->Inputs.pGeometryDescs, bvh);
 
     BYTE* outputData = (BYTE*)pData;
-    BVHOffsets offsets;
+    BVHOffsets offsets = {};
     offsets.offsetToBoxes = sizeof(BVHOffsets);
     const UINT sizeofBoxes = (UINT)(bvh.m_nodes.size() * sizeof(*bvh.m_nodes.data()));
     offsets.offsetToVertices = offsets.offsetToBoxes + sizeofBoxes;
@@ -683,7 +998,12 @@ void BuildRaytracingAccelerationStructureOnCpu(
     offsets.offsetToPrimitiveMetaData = offsets.offsetToVertices + sizeofVertices;
 
     const UINT sizeofMetadata = (UINT)(bvh.m_metadata.size() * sizeof(*bvh.m_metadata.data()));
-    offsets.totalSize = offsets.offsetToPrimitiveMetaData + sizeofMetadata;
+    offsets.offsetToWideNodes = offsets.offsetToPrimitiveMetaData + sizeofMetadata;
+
+    std::vector<WideNode> wideNodes;
+    FallbackLayer::BuildWideNodes(bvh, 0, (UINT32)-1, 0, wideNodes);
+    const UINT sizeofWideNodes = (UINT)(wideNodes.size() * sizeof(*wideNodes.data()));
+    offsets.totalSize = offsets.offsetToWideNodes + sizeofWideNodes;
 
     memcpy(outputData,  &offsets, sizeof(offsets));
     memcpy(outputData + offsets.offsetToBoxes, bvh.m_nodes.data(), sizeofBoxes);
@@ -696,4 +1016,5 @@ void BuildRaytracingAccelerationStructureOnCpu(
         pPrimitives[i].triangle = *pTriangle;
     }
     memcpy(outputData + offsets.offsetToPrimitiveMetaData, bvh.m_metadata.data(), sizeofMetadata);
+    memcpy(outputData + offsets.offsetToWideNodes, wideNodes.data(), sizeofWideNodes);
 }
@@ -137,6 +137,16 @@ public:
         }
     }
 
+    virtual void STDMETHODCALLTYPE BuildRaytracingAccelerationStructures(
+        _In_  UINT NumDescs,
+        _In_reads_(NumDescs)  const D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC *pDescs)
+    {
+        for (UINT i = 0; i < NumDescs; i++)
+        {
+            BuildRaytracingAccelerationStructure(&pDescs[i], 0, nullptr);
+        }
+    }
+
     virtual void STDMETHODCALLTYPE EmitRaytracingAccelerationStructurePostbuildInfo(
         _In_  const D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_DESC *pDesc,
         _In_  UINT NumSourceAccelerationStructures,
@@ -16,3 +16,11 @@
 // the Fallback Layer must have an output that is used by the application defined and
 // an application shaders must disable writing to the output (i.e. in a miss/hit shaders).
 #define ENABLE_ACCELERATION_STRUCTURE_VISUALIZATION 0
+
+// Set to 1 to check every acceleration structure on the GPU after it's built. Errors are read
+// back a few builds later and written to the debug output, so this is cheap enough to leave on.
+#ifdef _DEBUG
+#define ENABLE_GPU_ACCELERATION_STRUCTURE_VALIDATION 1
+#else
+#define ENABLE_GPU_ACCELERATION_STRUCTURE_VALIDATION 0
+#endif
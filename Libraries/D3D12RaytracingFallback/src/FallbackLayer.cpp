@@ -16,7 +16,7 @@ namespace FallbackLayer
     GUID FallbackLayerPatchedParameterStartGUID = { 0xea063348, 0x974e, 0x4227, 0x82, 0x55, 0x34, 0x5e, 0x29, 0x14, 0xeb, 0x7f };
 
     RaytracingDevice::RaytracingDevice(ID3D12Device *pDevice, UINT NodeMask, DWORD createRaytracingFallbackDeviceFlags) :
-        m_pDevice(pDevice), m_RaytracingProgramFactory(pDevice), m_AccelerationStructureBuilderFactory(pDevice, NodeMask),
+        m_pDevice(pDevice), m_RaytracingProgramFactory(pDevice, createRaytracingFallbackDeviceFlags), m_AccelerationStructureBuilderFactory(pDevice, NodeMask),
         m_flags(createRaytracingFallbackDeviceFlags)
     {
         // Earlier builds of windows may not support checking shader model yet so this cannot 
@@ -338,6 +338,21 @@ namespace FallbackLayer
         }
     }
 
+    void STDMETHODCALLTYPE D3D12RaytracingCommandList::BuildRaytracingAccelerationStructures(
+        _In_  UINT NumDescs,
+        _In_reads_(NumDescs)  const D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC *pDescs)
+    {
+#if USE_PIX_MARKERS
+        PIXScopedEvent(m_pCommandList.p, FallbackPixColor, L"BuildRaytracingAccelerationStructures");
+#endif
+        auto &accelerationStructureBuilder = m_device.m_AccelerationStructureBuilderFactory.GetAccelerationStructureBuilder();
+        accelerationStructureBuilder.BuildRaytracingAccelerationStructures(
+            m_pCommandList,
+            NumDescs,
+            pDescs,
+            m_pBoundDescriptorHeaps[SrvUavCbvType]);
+    }
+
     ShaderAssociations RaytracingDevice::ProcessAssociations(_In_ LPCWSTR exportName, _Inout_ RaytracingStateObject &rayTracingStateObject)
     {
         auto &stateObjectCollection = rayTracingStateObject.m_collection;
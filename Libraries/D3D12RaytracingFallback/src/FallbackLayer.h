@@ -32,6 +32,10 @@ namespace FallbackLayer
             _In_  UINT NumPostbuildInfoDescs,
             _In_reads_opt_(NumPostbuildInfoDescs)  const D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_DESC *pPostbuildInfoDescs);
 
+        virtual void STDMETHODCALLTYPE BuildRaytracingAccelerationStructures(
+            _In_  UINT NumDescs,
+            _In_reads_(NumDescs)  const D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC *pDescs);
+
         virtual void STDMETHODCALLTYPE EmitRaytracingAccelerationStructurePostbuildInfo(
             _In_  const D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_DESC *pDesc,
             _In_  UINT NumSourceAccelerationStructures,
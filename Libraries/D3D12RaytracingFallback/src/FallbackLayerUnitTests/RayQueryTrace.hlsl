@@ -0,0 +1,60 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+#define FALLBACK_RAY_QUERY_DESCRIPTOR_HEAP_REGISTER 0
+#define FALLBACK_RAY_QUERY_DESCRIPTOR_HEAP_SPACE 1
+#include "../../Include/D3D12RaytracingFallbackRayQuery.hlsli"
+
+RWTexture2D<float4> RenderTarget : register(u0);
+
+cbuffer Viewport : register(b0)
+{
+    float2 TopLeft;
+    float2 BottomRight;
+    int2 Dim;
+    uint TestRayFlags;
+    uint InstanceInclusionMask;
+    uint2 TopLevelAccelerationStructureGpuVA;
+    uint UseClosestHit;
+}
+
+// Writes the same colors as SimpleRayTracing.hlsl so the results verify the same way
+[numthreads(8, 8, 1)]
+void main(uint3 DTid : SV_DispatchThreadID)
+{
+    if (any(DTid.xy >= (uint2)Dim))
+    {
+        return;
+    }
+
+    float2 lerpValues = (DTid.xy + 0.5) / Dim;
+
+    FallbackRay ray;
+    ray.Origin = float3(
+        lerp(TopLeft.x, BottomRight.x, lerpValues.x),
+        lerp(TopLeft.y, BottomRight.y, lerpValues.y),
+        0.0f);
+    ray.TMin = 0.0f;
+    ray.Direction = float3(0.0, 0.0, 1);
+    ray.TMax = 10000.0f;
+
+    bool isHit;
+    if (UseClosestHit)
+    {
+        FallbackRayHit hit;
+        isHit = TraceClosest(TopLevelAccelerationStructureGpuVA, ray, hit, TestRayFlags, InstanceInclusionMask);
+    }
+    else
+    {
+        isHit = TraceOcclusion(TopLevelAccelerationStructureGpuVA, ray, TestRayFlags, InstanceInclusionMask);
+    }
+
+    RenderTarget[DTid.xy] = isHit ? float4(1, 0, 1, 1) : float4(1, 0, 0, 1);
+}
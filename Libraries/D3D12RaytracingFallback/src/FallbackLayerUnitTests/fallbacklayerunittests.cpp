@@ -242,7 +242,9 @@ namespace FallbackLayerUnitTests
             CComPtr<ID3D12Heap> &pHeap,
             CComPtr<ID3D12Resource> &pTopLevelResource,
             D3D12_ELEMENTS_LAYOUT layoutToTest,
-            bool performUpdate = false
+            bool performUpdate = false,
+            float **ppUpdateTransformations = nullptr,
+            UINT numUpdates = 1
         )
         {
             ID3D12Device &device = m_d3d12Context.GetDevice();
@@ -349,6 +351,27 @@ namespace FallbackLayerUnitTests
             auto transitionBarrier = CD3DX12_RESOURCE_BARRIER::Transition(pInstanceDescsResource, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_COMMON);
             pCommandList->ResourceBarrier(1, &transitionBarrier);
 
+            // Instances moved by the updates are read from instance descs of their own
+            CComPtr<ID3D12Resource> pUpdateInstanceDescsResource;
+            CComPtr<ID3D12Resource> pUpdateInstanceUploadResource;
+            if (ppUpdateTransformations)
+            {
+                Assert::IsTrue(layoutToTest == D3D12_ELEMENTS_LAYOUT_ARRAY, L"Instances are only moved on update with the array layout.");
+
+                std::vector<D3D12_RAYTRACING_FALLBACK_INSTANCE_DESC> updateInstanceDescs = instanceDescs;
+                for (UINT i = 0; i < numGeoms; i++)
+                {
+                    memcpy(updateInstanceDescs[i].Transform, ppUpdateTransformations[i], sizeof(D3D12_RAYTRACING_FALLBACK_INSTANCE_DESC::Transform));
+                }
+
+                AssertSucceeded(device.CreateCommittedResource(&defaultHeapProperties, D3D12_HEAP_FLAG_NONE, &instanceResourceDesc, D3D12_RESOURCE_STATE_COMMON, nullptr, IID_PPV_ARGS(&pUpdateInstanceDescsResource)));
+                m_d3d12Context.CreateResourceWithInitialData(updateInstanceDescs.data(), instanceDataSize, &pUpdateInstanceUploadResource);
+                pCommandList->CopyBufferRegion(pUpdateInstanceDescsResource, 0, pUpdateInstanceUploadResource, 0, instanceDataSize);
+
+                auto updateTransitionBarrier = CD3DX12_RESOURCE_BARRIER::Transition(pUpdateInstanceDescsResource, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_COMMON);
+                pCommandList->ResourceBarrier(1, &updateTransitionBarrier);
+            }
+
             CComPtr<ID3D12Resource> pScratchResource;
             auto scratchResourceDesc = CD3DX12_RESOURCE_DESC::Buffer(topLevelPrebuildInfo.ScratchDataSizeInBytes);
             AssertSucceeded(device.CreatePlacedResource(pHeap, heapOffset, &scratchResourceDesc, D3D12_RESOURCE_STATE_COMMON, nullptr, IID_PPV_ARGS(&pScratchResource)));
@@ -376,7 +399,15 @@ namespace FallbackLayerUnitTests
             if (performUpdate)
             {
                 topLevelInput.Flags |= D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PERFORM_UPDATE;
-                builder.BuildRaytracingAccelerationStructure(pCommandList, &topLevelDesc, &m_descriptorHeapStack.GetDescriptorHeap());
+                if (pUpdateInstanceDescsResource)
+                {
+                    topLevelInput.InstanceDescs = pUpdateInstanceDescsResource->GetGPUVirtualAddress();
+                }
+
+                for (UINT update = 0; update < numUpdates; update++)
+                {
+                    builder.BuildRaytracingAccelerationStructure(pCommandList, &topLevelDesc, &m_descriptorHeapStack.GetDescriptorHeap());
+                }
             }
 
             AssertSucceeded(pCommandList->Close());
@@ -750,6 +781,119 @@ namespace FallbackLayerUnitTests
                 testCase);
         }
 
+        TEST_METHOD(StressBottomLevelGpuBVHBuilderFastTrace)
+        {
+            // WARP TDRs when running treelet re-ordering, which runs after the clustering
+            m_d3d12Context = D3D12Context(D3D12Context::CreationFlags::ForceHardware);
+            MethodSetup();
+
+            std::vector<float> AutoGeneratedReferenceVertices;
+            std::vector<UINT16> AutoGeneratedReferenceIndicies;
+            for (UINT i = 0; i < 500; i++)
+            {
+                for (float f : ReferenceVerticies0)
+                {
+                    AutoGeneratedReferenceVertices.push_back(f + i);
+                }
+
+                for (UINT16 index : ReferenceIndices0)
+                {
+                    AutoGeneratedReferenceIndicies.push_back(index + (UINT16)ARRAYSIZE(ReferenceIndices0) * i);
+                }
+            }
+            CpuGeometryDescriptor testCases[] =
+            {
+                CpuGeometryDescriptor(ReferenceVerticies1, VERTEX_COUNT(ReferenceVerticies1)),
+                CpuGeometryDescriptor(AutoGeneratedReferenceVertices.data(),
+                    (UINT)(AutoGeneratedReferenceVertices.size() / 3),
+                    AutoGeneratedReferenceIndicies.data(),
+                    (UINT)AutoGeneratedReferenceIndicies.size())
+            };
+
+            for (CpuGeometryDescriptor &testCase : testCases)
+            {
+                TestGpuBvh2Builder(&testCase, 1, D3D12_ELEMENTS_LAYOUT_ARRAY, D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_TRACE);
+            }
+        }
+
+        TEST_METHOD(GpuBVHValidatorFindsBrokenHierarchy)
+        {
+            std::vector<float> AutoGeneratedReferenceVertices;
+            std::vector<UINT16> AutoGeneratedReferenceIndicies;
+            for (UINT i = 0; i < 500; i++)
+            {
+                for (float f : ReferenceVerticies0)
+                {
+                    AutoGeneratedReferenceVertices.push_back(f + i);
+                }
+
+                for (UINT16 index : ReferenceIndices0)
+                {
+                    AutoGeneratedReferenceIndicies.push_back(index + (UINT16)ARRAYSIZE(ReferenceIndices0) * i);
+                }
+            }
+            CpuGeometryDescriptor testCase(AutoGeneratedReferenceVertices.data(),
+                (UINT)(AutoGeneratedReferenceVertices.size() / 3),
+                AutoGeneratedReferenceIndicies.data(),
+                (UINT)AutoGeneratedReferenceIndicies.size());
+            const UINT numTriangles = (UINT)AutoGeneratedReferenceIndicies.size() / 3;
+
+            ID3D12Device &device = m_d3d12Context.GetDevice();
+            std::unique_ptr<FallbackLayer::IAccelerationStructureBuilder> pBuilder =
+                std::unique_ptr<FallbackLayer::IAccelerationStructureBuilder>(
+                    new FallbackLayer::GpuBvh2Builder(&device, m_d3d12Context.GetTotalLaneCount(), 0));
+            InternalFallbackBuilder builderWrapper(pBuilder.get());
+
+            CComPtr<ID3D12Resource> pResource;
+            m_pBuilderHelper->BuildBottomLevelAccelerationStructure(builderWrapper, &testCase, 1, &pResource);
+
+            FallbackLayer::GpuBvh2Validator validator(&device, 0);
+            std::vector<BVHValidationError> errors;
+            {
+                CComPtr<ID3D12GraphicsCommandList> pCommandList;
+                m_d3d12Context.GetGraphicsCommandList(&pCommandList);
+                validator.Validate(pCommandList, pResource->GetGPUVirtualAddress(), numTriangles, true);
+                pCommandList->Close();
+                m_d3d12Context.ExecuteCommandList(pCommandList);
+                m_d3d12Context.WaitForGpuWork();
+            }
+            Assert::AreEqual(1u, validator.ReadBackErrors(errors), L"Validation didn't finish");
+            Assert::AreEqual((size_t)0, errors.size(), L"Validation found errors in a correct BVH");
+
+            // Point both of the root's children at the same node, which leaves the other without a parent
+            const UINT bvhSize = (UINT)pResource->GetDesc().Width;
+            std::unique_ptr<BYTE[]> pData(new BYTE[bvhSize]);
+            m_d3d12Context.ReadbackResource(pResource, pData.get(), bvhSize);
+            AABBNode *pRoot = (AABBNode *)(pData.get() + ((BVHOffsets *)pData.get())->offsetToBoxes);
+            pRoot->rightNodeIndex = pRoot->internalNode.leftNodeIndex;
+
+            CComPtr<ID3D12Resource> pUploadResource;
+            m_d3d12Context.CreateResourceWithInitialData(pData.get(), bvhSize, &pUploadResource);
+
+            CComPtr<ID3D12Resource> pBrokenResource;
+            const auto defaultHeapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
+            const auto bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(bvhSize, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+            AssertSucceeded(device.CreateCommittedResource(&defaultHeapProperties, D3D12_HEAP_FLAG_NONE, &bufferDesc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&pBrokenResource)));
+            {
+                CComPtr<ID3D12GraphicsCommandList> pCommandList;
+                m_d3d12Context.GetGraphicsCommandList(&pCommandList);
+                pCommandList->CopyBufferRegion(pBrokenResource, 0, pUploadResource, 0, bvhSize);
+                auto barrier = CD3DX12_RESOURCE_BARRIER::Transition(pBrokenResource, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+                pCommandList->ResourceBarrier(1, &barrier);
+                validator.Validate(pCommandList, pBrokenResource->GetGPUVirtualAddress(), numTriangles, true);
+                pCommandList->Close();
+                m_d3d12Context.ExecuteCommandList(pCommandList);
+                m_d3d12Context.WaitForGpuWork();
+            }
+            Assert::AreEqual(2u, validator.ReadBackErrors(errors), L"Validation didn't finish");
+            Assert::AreEqual((size_t)2, errors.size(), L"Expected the doubly and the un-referenced children to be reported");
+            for (const BVHValidationError &error : errors)
+            {
+                Assert::AreEqual((UINT)BVHValidationInvalidParentCount, error.Type, L"Unexpected validation error");
+                Assert::AreEqual(pBrokenResource->GetGPUVirtualAddress(), error.BVHAddress, L"Error logged for the wrong BVH");
+            }
+        }
+
         TEST_METHOD(StressBottomLevelCpuBVHBuilder)
         {
             std::vector<float> AutoGeneratedReferenceVertices;
@@ -780,7 +924,9 @@ namespace FallbackLayerUnitTests
             D3D12_ELEMENTS_LAYOUT layoutToTest,
             bool applyRandomInstanceTransforms,
             bool testCopyAccelerationStructure = false,
-            bool testWithUpdate = false) {
+            bool testWithUpdate = false,
+            UINT numUpdatesMovingInstances = 0,
+            BVHOffsets *pOutputOffsets = nullptr) {
             const UINT referenceVertexArraySize = ARRAYSIZE(ReferenceVerticies0);
             const UINT referenceIndexArraySize = ARRAYSIZE(ReferenceIndices0);
 
@@ -806,6 +952,28 @@ namespace FallbackLayerUnitTests
 
             }
 
+            // Scatters the instances, which a refit can only fit the old hierarchy around
+            float* pUpdateTransformations[numBottomLevels];
+            if (numUpdatesMovingInstances)
+            {
+                for (UINT i = 0; i < numBottomLevels; i++)
+                {
+                    matrixStorage.push_back(std::unique_ptr<float[]>(new float[FloatsPerMatrix]));
+                    float *pMatrix = matrixStorage.back().get();
+                    pUpdateTransformations[i] = pMatrix;
+
+                    ZeroMemory(pMatrix, sizeof(float) * FloatsPerMatrix);
+                    pMatrix[0] = 1;
+                    pMatrix[5] = 1;
+                    pMatrix[10] = 1;
+                    pMatrix[3] = (rand() / (float)RAND_MAX) * 100.0f - 50.0f;
+                    pMatrix[7] = (rand() / (float)RAND_MAX) * 100.0f - 50.0f;
+                    pMatrix[11] = (rand() / (float)RAND_MAX) * 100.0f - 50.0f;
+                }
+            }
+            float **ppFinalTransformations = numUpdatesMovingInstances ? pUpdateTransformations :
+                (applyRandomInstanceTransforms ? pTransformations : nullptr);
+
             AABB containingBoxes[numBottomLevels] = {};
             for (UINT i = 0; i < numBottomLevels; i++) {
                 for (UINT axis = 0; axis < 3; axis++) {
@@ -852,7 +1020,9 @@ namespace FallbackLayerUnitTests
                 pHeap,
                 pTopLevelResource,
                 layoutToTest,
-                testWithUpdate);
+                testWithUpdate,
+                numUpdatesMovingInstances ? pUpdateTransformations : nullptr,
+                numUpdatesMovingInstances ? numUpdatesMovingInstances : 1);
 
             const UINT dataSize = (UINT)pTopLevelResource->GetDesc().Width;
 
@@ -876,9 +1046,14 @@ namespace FallbackLayerUnitTests
 
             std::wstring errorMessage;
             auto &validator = FallbackLayer::GetAccelerationStructureValidator(pBuilder->GetAccelerationStructureType());
-            if (!validator.VerifyTopLevelOutput(containingBoxes, applyRandomInstanceTransforms ? pTransformations : nullptr, numBottomLevels, pData.get(), errorMessage)) {
+            if (!validator.VerifyTopLevelOutput(containingBoxes, ppFinalTransformations, numBottomLevels, pData.get(), errorMessage)) {
                 Assert::Fail(errorMessage.c_str());
             }
+
+            if (pOutputOffsets)
+            {
+                memcpy(pOutputOffsets, pData.get(), sizeof(BVHOffsets));
+            }
         }
 
         TEST_METHOD(SimpleTopLevelGpuBVHBuilderSingleBottomLevel)
@@ -934,6 +1109,21 @@ namespace FallbackLayerUnitTests
             SimpleTopLevelGpuBVHBuilder<50>(D3D12_ELEMENTS_LAYOUT_ARRAY_OF_POINTERS, true, true);
         }
 
+        TEST_METHOD(TopLevelGpuBVHBuilderRebuildsDegradedHierarchyOnUpdate)
+        {
+            // Refitting around the scattered instances raises the SAH cost well past the build's
+            BVHOffsets refitOffsets;
+            SimpleTopLevelGpuBVHBuilder<50>(D3D12_ELEMENTS_LAYOUT_ARRAY, false, false, true, 1, &refitOffsets);
+            Assert::IsTrue(refitOffsets.buildCost > 0, L"The SAH cost of the build wasn't measured.");
+            Assert::IsTrue(refitOffsets.refitCost > refitOffsets.buildCost * 1.5f, L"Scattering the instances didn't degrade the refit hierarchy.");
+
+            // So the next update rebuilds it instead
+            BVHOffsets rebuildOffsets;
+            SimpleTopLevelGpuBVHBuilder<50>(D3D12_ELEMENTS_LAYOUT_ARRAY, false, false, true, 2, &rebuildOffsets);
+            Assert::AreEqual(rebuildOffsets.buildCost, rebuildOffsets.refitCost, L"The second update didn't rebuild the hierarchy.");
+            Assert::IsTrue(rebuildOffsets.buildCost < refitOffsets.refitCost, L"Rebuilding didn't lower the SAH cost of the refit hierarchy.");
+        }
+
         TEST_METHOD(EmitRaytracingAccelerationStructurePostBuildInfoTest)
         {
             const UINT numBottomLevels = 70;
@@ -1083,6 +1273,9 @@ namespace FallbackLayerUnitTests
             pBuilder->GetRaytracingAccelerationStructurePrebuildInfo(&bottomLevelDesc, &infoWithUpdate);
 
             Assert::AreEqual(infoNoUpdate.ScratchDataSizeInBytes, infoWithUpdate.ScratchDataSizeInBytes, L"Allowing update allocated scratch data.");
+            Assert::AreEqual(infoNoUpdate.UpdateScratchDataSizeInBytes, (UINT64)0, L"Update scratch data was allocated without allowing updates.");
+            Assert::IsTrue(infoWithUpdate.UpdateScratchDataSizeInBytes > 0, L"No update scratch data was allocated for a refit.");
+            Assert::IsTrue(infoWithUpdate.UpdateScratchDataSizeInBytes < infoWithUpdate.ScratchDataSizeInBytes, L"A refit needs as much scratch data as a rebuild.");
             Assert::IsTrue(infoWithUpdate.ResultDataMaxSizeInBytes == infoNoUpdate.ResultDataMaxSizeInBytes + updateExtraDataSize, L"Data allocated for update doesn't match expected.");
         }
 
@@ -1165,6 +1358,187 @@ namespace FallbackLayerUnitTests
             }
         }
 
+        TEST_METHOD(CollapseToWideNodes) {
+            ID3D12Device &device = m_d3d12Context.GetDevice();
+            std::unique_ptr<FallbackLayer::IAccelerationStructureBuilder> pBuilder =
+                std::unique_ptr<FallbackLayer::IAccelerationStructureBuilder>(
+                    new FallbackLayer::GpuBvh2Builder(&device, m_d3d12Context.GetTotalLaneCount(), 0));
+            InternalFallbackBuilder builderWrapper(pBuilder.get());
+
+            UINT numVertices = VERTEX_COUNT(ReferenceVerticies1);
+            UINT numTriangles = numVertices / 3;
+            UINT numInternalNodes = numTriangles - 1;
+
+            CpuGeometryDescriptor geomDesc = CpuGeometryDescriptor(ReferenceVerticies1, VERTEX_COUNT(ReferenceVerticies1));
+
+            std::unique_ptr<BYTE[]> pData;
+            BuildBottomLevelAccelerationStructureAndGetCpuData(
+                builderWrapper,
+                &geomDesc,
+                1,
+                pData,
+                D3D12_ELEMENTS_LAYOUT_ARRAY,
+                D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_TRACE);
+
+            const BYTE *pOutputBVH = pData.get();
+            BVHOffsets offsets = *(BVHOffsets*)pOutputBVH;
+            AABBNode *pNodeArray = (AABBNode*)((BYTE *)pOutputBVH + offsets.offsetToBoxes);
+            WideNode *pWideNodeArray = (WideNode*)((BYTE *)pOutputBVH + offsets.offsetToWideNodes);
+
+            // Every child's decoded bounds must hold the binary node it references, every
+            // leaf must be reached exactly once and every wide node must link back to its parent
+            std::vector<bool> isLeafReached(numTriangles, false);
+            Assert::AreEqual(pWideNodeArray[0].parentIndex, (UINT)-1, L"Root wide node has a parent");
+            std::deque<UINT> wideNodeQueue = { 0 };
+            while (wideNodeQueue.size())
+            {
+                const UINT wideNodeIndex = wideNodeQueue.front();
+                const WideNode &wideNode = pWideNodeArray[wideNodeIndex];
+                wideNodeQueue.pop_front();
+
+                const UINT childCount = wideNode.exponentsAndChildCount >> 24;
+                Assert::IsTrue(childCount >= 2 && childCount <= WIDE_NODE_MAX_CHILDREN, L"Wide node has an invalid child count");
+
+                for (UINT childIndex = 0; childIndex < childCount; childIndex++)
+                {
+                    AABB childAABB;
+                    for (UINT axis = 0; axis < 3; axis++)
+                    {
+                        const UINT stepBits = ((wideNode.exponentsAndChildCount >> (axis * 8)) & 0xff) << 23;
+                        const float step = (float&)stepBits;
+                        childAABB.minArr[axis] = wideNode.origin[axis] + ((wideNode.quantizedMin[axis] >> (childIndex * 8)) & 0xff) * step;
+                        childAABB.maxArr[axis] = wideNode.origin[axis] + ((wideNode.quantizedMax[axis] >> (childIndex * 8)) & 0xff) * step;
+                    }
+
+                    const UINT childReference = wideNode.childReferences[childIndex];
+                    const bool isLeaf = (childReference & 0x80000000) != 0;
+                    const UINT leafIndex = childReference & 0x00ffffff;
+                    const UINT nodeIndex = isLeaf ? numInternalNodes + leafIndex : childReference;
+
+                    AABB nodeAABB;
+                    FallbackLayer::DecompressAABB(nodeAABB, pNodeArray[nodeIndex]);
+                    Assert::IsTrue(IsChildContainedByParent(childAABB, nodeAABB), L"Quantized child bounds don't contain the node");
+
+                    if (isLeaf)
+                    {
+                        Assert::IsFalse(isLeafReached[leafIndex], L"Leaf referenced by more than one wide node");
+                        isLeafReached[leafIndex] = true;
+                    }
+                    else
+                    {
+                        Assert::AreEqual(pWideNodeArray[nodeIndex].parentIndex, wideNodeIndex, L"Wide node links to the wrong parent");
+                        Assert::AreEqual(pWideNodeArray[nodeIndex].slotInParent, childIndex, L"Wide node links to the wrong slot in its parent");
+                        wideNodeQueue.push_back(nodeIndex);
+                    }
+                }
+            }
+
+            for (UINT leafIndex = 0; leafIndex < numTriangles; leafIndex++)
+            {
+                Assert::IsTrue(isLeafReached[leafIndex], L"Leaf not reachable from the wide nodes");
+            }
+        }
+
+        TEST_METHOD(BatchedBottomLevelGpuBVHBuilder) {
+            // WARP TDRs when running treelet re-ordering, which all but the fast-build flags ask for
+            m_d3d12Context = D3D12Context(D3D12Context::CreationFlags::ForceHardware);
+            MethodSetup();
+
+            ID3D12Device &device = m_d3d12Context.GetDevice();
+            std::unique_ptr<FallbackLayer::IAccelerationStructureBuilder> pBuilder =
+                std::unique_ptr<FallbackLayer::IAccelerationStructureBuilder>(
+                    new FallbackLayer::GpuBvh2Builder(&device, m_d3d12Context.GetTotalLaneCount(), 0));
+
+            // Large enough to need sort passes past k = 2048 that the smaller builds skip
+            std::vector<float> stressVertices;
+            for (UINT i = 0; i < 1000; i++)
+            {
+                for (float f : ReferenceVerticies0)
+                {
+                    stressVertices.push_back(f + i);
+                }
+            }
+
+            CpuGeometryDescriptor testCases[] =
+            {
+                CpuGeometryDescriptor(ReferenceVerticies0, VERTEX_COUNT(ReferenceVerticies0), ReferenceIndices0, ARRAYSIZE(ReferenceIndices0)),
+                CpuGeometryDescriptor(ReferenceVerticies1, VERTEX_COUNT(ReferenceVerticies1)),
+                CpuGeometryDescriptor(stressVertices.data(), (UINT)(stressVertices.size() / 3))
+            };
+            const UINT numBuilds = ARRAYSIZE(testCases);
+
+            // Builds in the same batch run different numbers of treelet reordering passes
+            const D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAGS buildFlags[numBuilds] =
+            {
+                D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_BUILD,
+                D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_NONE,
+                D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_TRACE
+            };
+
+            auto heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
+            std::vector<CComPtr<ID3D12Resource>> pVertexBuffers(numBuilds);
+            std::vector<CComPtr<ID3D12Resource>> pIndexBuffers(numBuilds);
+            std::vector<CComPtr<ID3D12Resource>> pBottomLevelResources(numBuilds);
+            std::vector<CComPtr<ID3D12Resource>> pScratchBufferResources(numBuilds);
+            std::vector<D3D12_RAYTRACING_GEOMETRY_DESC> geometryDescs(numBuilds);
+            std::vector<D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC> bottomLevelDescs(numBuilds);
+            for (UINT i = 0; i < numBuilds; i++)
+            {
+                CpuGeometryDescriptor &testCase = testCases[i];
+                m_d3d12Context.CreateResourceWithInitialData(testCase.m_pVertexData, sizeof(float) * 3 * testCase.m_numVerticies, &pVertexBuffers[i]);
+                if (testCase.m_pIndexBuffer)
+                {
+                    m_d3d12Context.CreateResourceWithInitialData(testCase.m_pIndexBuffer, testCase.GetSizeOfIndex() * testCase.m_numIndicies, &pIndexBuffers[i]);
+                }
+                geometryDescs[i] = GetGeometryDesc(testCase, pVertexBuffers[i], pIndexBuffers[i]);
+
+                D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS &bottomLevelInputs = bottomLevelDescs[i].Inputs;
+                bottomLevelInputs.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
+                bottomLevelInputs.NumDescs = 1;
+                bottomLevelInputs.pGeometryDescs = &geometryDescs[i];
+                bottomLevelInputs.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL;
+                bottomLevelInputs.Flags = buildFlags[i];
+
+                D3D12_RAYTRACING_ACCELERATION_STRUCTURE_PREBUILD_INFO prebuildInfo;
+                pBuilder->GetRaytracingAccelerationStructurePrebuildInfo(&bottomLevelInputs, &prebuildInfo);
+
+                auto accelerationStructureDesc = CD3DX12_RESOURCE_DESC::Buffer(prebuildInfo.ResultDataMaxSizeInBytes, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+                auto scratchBufferDesc = CD3DX12_RESOURCE_DESC::Buffer(prebuildInfo.ScratchDataSizeInBytes, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+                AssertSucceeded(device.CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &accelerationStructureDesc, D3D12_RESOURCE_STATE_COMMON, nullptr, IID_PPV_ARGS(&pBottomLevelResources[i])));
+                AssertSucceeded(device.CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &scratchBufferDesc, D3D12_RESOURCE_STATE_COMMON, nullptr, IID_PPV_ARGS(&pScratchBufferResources[i])));
+
+                bottomLevelDescs[i].DestAccelerationStructureData = pBottomLevelResources[i]->GetGPUVirtualAddress();
+                bottomLevelDescs[i].ScratchAccelerationStructureData = pScratchBufferResources[i]->GetGPUVirtualAddress();
+            }
+
+            CComPtr<ID3D12GraphicsCommandList> pCommandList;
+            m_d3d12Context.GetGraphicsCommandList(&pCommandList);
+
+            pBuilder->BuildRaytracingAccelerationStructures(
+                pCommandList,
+                numBuilds,
+                bottomLevelDescs.data(),
+                nullptr);
+
+            AssertSucceeded(pCommandList->Close());
+            m_d3d12Context.ExecuteCommandList(pCommandList);
+            m_d3d12Context.WaitForGpuWork();
+
+            auto &validator = FallbackLayer::GetAccelerationStructureValidator(pBuilder->GetAccelerationStructureType());
+            for (UINT i = 0; i < numBuilds; i++)
+            {
+                const UINT outputSize = (UINT)pBottomLevelResources[i]->GetDesc().Width;
+                std::unique_ptr<BYTE[]> outputData = std::unique_ptr<BYTE[]>(new BYTE[outputSize]);
+                m_d3d12Context.ReadbackResource(pBottomLevelResources[i], outputData.get(), outputSize);
+
+                std::wstring errorMessage;
+                if (!validator.VerifyBottomLevelOutput(&testCases[i], 1, outputData.get(), errorMessage))
+                {
+                    Assert::Fail(errorMessage.c_str());
+                }
+            }
+        }
+
         void BuildAndUpdateBottomLevelAccelerationStructure(
             const float *startVertices,
             const float *updatedVertices,
@@ -1227,10 +1601,12 @@ namespace FallbackLayerUnitTests
             device.CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &accelerationStructureDesc, D3D12_RESOURCE_STATE_COMMON, nullptr, IID_PPV_ARGS(&pBottomLevelResource));
             bottomLevelGpuVA = pBottomLevelResource->GetGPUVirtualAddress();
 
+            // The update only gets as much scratch as the prebuild info asks for
             CComPtr<ID3D12Resource> pScratchBufferResources[2];
             auto scratchBufferDesc = CD3DX12_RESOURCE_DESC::Buffer(prebuildInfo.ScratchDataSizeInBytes, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+            auto updateScratchBufferDesc = CD3DX12_RESOURCE_DESC::Buffer(prebuildInfo.UpdateScratchDataSizeInBytes, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
             device.CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &scratchBufferDesc, D3D12_RESOURCE_STATE_COMMON, nullptr, IID_PPV_ARGS(&pScratchBufferResources[0]));
-            device.CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &scratchBufferDesc, D3D12_RESOURCE_STATE_COMMON, nullptr, IID_PPV_ARGS(&pScratchBufferResources[1]));
+            device.CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &updateScratchBufferDesc, D3D12_RESOURCE_STATE_COMMON, nullptr, IID_PPV_ARGS(&pScratchBufferResources[1]));
 
             CComPtr<ID3D12GraphicsCommandList> pCommandList;
             m_d3d12Context.GetGraphicsCommandList(&pCommandList);
@@ -1392,7 +1768,11 @@ namespace FallbackLayerUnitTests
             TestCpuBvh2Builder(&geomDesc, 1);
         }
 
-        void TestGpuBvh2Builder(CpuGeometryDescriptor *pGeomDescs, UINT numGeoms, D3D12_ELEMENTS_LAYOUT layoutToTest = D3D12_ELEMENTS_LAYOUT_ARRAY)
+        void TestGpuBvh2Builder(
+            CpuGeometryDescriptor *pGeomDescs,
+            UINT numGeoms,
+            D3D12_ELEMENTS_LAYOUT layoutToTest = D3D12_ELEMENTS_LAYOUT_ARRAY,
+            D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAGS buildFlags = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_BUILD)
         {
             ID3D12Device &device = m_d3d12Context.GetDevice();
             std::unique_ptr<FallbackLayer::IAccelerationStructureBuilder> pBuilder =
@@ -1407,7 +1787,8 @@ namespace FallbackLayerUnitTests
                 pGeomDescs,
                 numGeoms,
                 pData,
-                layoutToTest);
+                layoutToTest,
+                buildFlags);
 
             std::wstring errorMessage;
             auto &validator = FallbackLayer::GetAccelerationStructureValidator(pBuilder->GetAccelerationStructureType());
@@ -2236,6 +2617,7 @@ namespace FallbackLayerUnitTests
     };
 
 #include "CompiledShaders/SimpleRaytracing.h"
+#include "CompiledShaders/RayQueryTrace.h"
 
     enum ParameterSlots
     {
@@ -3067,6 +3449,286 @@ namespace FallbackLayerUnitTests
             Assert::IsTrue(leafNodesFound == numLeafNodes, L"Incorrectly constructed hierarchy");
         }
 
+        // Walks the hierarchy from the root, checking every node is reached once from its parent,
+        // and returns its SAH cost with the same intersection costs treelet reordering uses
+        float ComputeHierarchySAHCost(const std::vector<HierarchyNode> &hierarchy, const std::vector<Primitive> &sortedTriangles)
+        {
+            const float costOfRayBoxIntersection = 1.2f;
+            const float costOfRayTriangleIntersection = 1.0f;
+            const UINT numInternalNodes = (UINT)sortedTriangles.size() - 1;
+
+            std::vector<UINT> nodeOrder;
+            std::vector<UINT> nodeStack;
+            nodeStack.push_back(0);
+            while (nodeStack.size() > 0)
+            {
+                auto nodeIndex = nodeStack.back();
+                nodeStack.pop_back();
+                nodeOrder.push_back(nodeIndex);
+                if (nodeIndex < numInternalNodes)
+                {
+                    UINT leftNodeIndex = hierarchy[nodeIndex].LeftChildIndex;
+                    UINT rightNodeIndex = hierarchy[nodeIndex].RightChildIndex;
+                    Assert::IsTrue(hierarchy[leftNodeIndex].ParentIndex == nodeIndex, L"Incorrectly Parent Index");
+                    Assert::IsTrue(hierarchy[rightNodeIndex].ParentIndex == nodeIndex, L"Incorrectly Parent Index");
+
+                    nodeStack.push_back(leftNodeIndex);
+                    nodeStack.push_back(rightNodeIndex);
+                }
+            }
+            Assert::IsTrue(nodeOrder.size() == hierarchy.size(), L"Incorrectly constructed hierarchy");
+
+            // Children always come after their parent in the walk, so fitting in reverse is bottom-up
+            std::vector<AABB> nodeAABBs(hierarchy.size());
+            float cost = 0.0f;
+            for (auto nodeIt = nodeOrder.rbegin(); nodeIt != nodeOrder.rend(); nodeIt++)
+            {
+                UINT nodeIndex = *nodeIt;
+                AABB &aabb = nodeAABBs[nodeIndex];
+                float intersectionCost;
+                if (nodeIndex < numInternalNodes)
+                {
+                    const AABB &leftAABB = nodeAABBs[hierarchy[nodeIndex].LeftChildIndex];
+                    const AABB &rightAABB = nodeAABBs[hierarchy[nodeIndex].RightChildIndex];
+                    aabb.min = min(leftAABB.min, rightAABB.min);
+                    aabb.max = max(leftAABB.max, rightAABB.max);
+                    intersectionCost = costOfRayBoxIntersection;
+                }
+                else
+                {
+                    const Triangle &tri = sortedTriangles[nodeIndex - numInternalNodes].triangle;
+                    aabb.min = min(min(tri.v0, tri.v1), tri.v2);
+                    aabb.max = max(max(tri.v0, tri.v1), tri.v2);
+                    intersectionCost = costOfRayTriangleIntersection;
+                }
+
+                float3 dim = aabb.max - aabb.min;
+                cost += intersectionCost * 2.0f * (dim.x * dim.y + dim.x * dim.z + dim.y * dim.z);
+            }
+
+            float3 rootDim = nodeAABBs[0].max - nodeAABBs[0].min;
+            return cost / (2.0f * (rootDim.x * rootDim.y + rootDim.x * rootDim.z + rootDim.y * rootDim.z));
+        }
+
+        TEST_METHOD(PLOCHierarchyLowersSAHCost)
+        {
+            auto &d3d12Device = m_d3d12Context.GetDevice();
+            ConstructHierarchyPass constructHierarchyPass(&d3d12Device, 0);
+            PLOCHierarchyPass plocHierarchyPass(&d3d12Device, 0);
+
+            // Small triangles scattered through the scene, sorted the way the builder sorts them
+            const UINT numTriangles = 4096;
+            std::vector<Primitive> triangles(numTriangles);
+            AABB sceneAABB;
+            sceneAABB.min = { FLT_MAX, FLT_MAX, FLT_MAX };
+            sceneAABB.max = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+            srand(42);
+            for (Primitive &primitive : triangles)
+            {
+                primitive.PrimitiveType = TRIANGLE_TYPE;
+                Triangle &tri = primitive.triangle;
+                float3 center;
+                center.x = (rand() / (float)RAND_MAX) * 1000.0f - 500.0f;
+                center.y = (rand() / (float)RAND_MAX) * 1000.0f - 500.0f;
+                center.z = (rand() / (float)RAND_MAX) * 1000.0f - 500.0f;
+                for (uint vIdx = 0; vIdx < 3; vIdx++)
+                {
+                    tri.v[vIdx].x = center.x + (rand() / (float)RAND_MAX) * 10.0f - 5.0f;
+                    tri.v[vIdx].y = center.y + (rand() / (float)RAND_MAX) * 10.0f - 5.0f;
+                    tri.v[vIdx].z = center.z + (rand() / (float)RAND_MAX) * 10.0f - 5.0f;
+                    sceneAABB.min = min(sceneAABB.min, tri.v[vIdx]);
+                    sceneAABB.max = max(sceneAABB.max, tri.v[vIdx]);
+                }
+            }
+
+            std::vector<MortonCodeIndexPair> mortonCodes(numTriangles);
+            for (UINT i = 0; i < numTriangles; i++)
+            {
+                mortonCodes[i].MortonCode = CalculateMortonCode(triangles[i].triangle, sceneAABB);
+                mortonCodes[i].Index = i;
+            }
+            std::sort(mortonCodes.begin(), mortonCodes.end());
+
+            std::vector<Primitive> sortedTriangles(numTriangles);
+            std::vector<UINT> sortedMortonCodes(numTriangles);
+            for (UINT i = 0; i < numTriangles; i++)
+            {
+                sortedTriangles[i] = triangles[mortonCodes[i].Index];
+                sortedMortonCodes[i] = mortonCodes[i].MortonCode;
+            }
+
+            CComPtr<ID3D12Resource> pTriangleBuffer;
+            m_d3d12Context.CreateResourceWithInitialData(
+                sortedTriangles.data(),
+                (UINT)(sortedTriangles.size() * sizeof(*sortedTriangles.data())),
+                &pTriangleBuffer);
+
+            CComPtr<ID3D12Resource> pMortonCodeBuffer;
+            m_d3d12Context.CreateResourceWithInitialData(
+                sortedMortonCodes.data(),
+                (UINT)(sortedMortonCodes.size() * sizeof(*sortedMortonCodes.data())),
+                &pMortonCodeBuffer);
+
+            const UINT numNodes = numTriangles * 2 - 1;
+            auto hierarchyBufferDesc = CD3DX12_RESOURCE_DESC::Buffer(sizeof(HierarchyNode) * numNodes, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+            D3D12_HEAP_PROPERTIES defaultHeapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
+            CComPtr<ID3D12Resource> pSplitHierarchyBuffer;
+            AssertSucceeded(d3d12Device.CreateCommittedResource(&defaultHeapProperties, D3D12_HEAP_FLAG_NONE, &hierarchyBufferDesc, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, nullptr, IID_PPV_ARGS(&pSplitHierarchyBuffer)));
+            CComPtr<ID3D12Resource> pClusteredHierarchyBuffer;
+            AssertSucceeded(d3d12Device.CreateCommittedResource(&defaultHeapProperties, D3D12_HEAP_FLAG_NONE, &hierarchyBufferDesc, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, nullptr, IID_PPV_ARGS(&pClusteredHierarchyBuffer)));
+
+            auto scratchBufferDesc = CD3DX12_RESOURCE_DESC::Buffer(PLOCHierarchyPass::RequiredScratchSize(numTriangles), D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+            CComPtr<ID3D12Resource> pScratchBuffer;
+            AssertSucceeded(d3d12Device.CreateCommittedResource(&defaultHeapProperties, D3D12_HEAP_FLAG_NONE, &scratchBufferDesc, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, nullptr, IID_PPV_ARGS(&pScratchBuffer)));
+
+            CComPtr<ID3D12GraphicsCommandList> pCommandList;
+            m_d3d12Context.GetGraphicsCommandList(&pCommandList);
+
+            constructHierarchyPass.ConstructHierarchy(
+                pCommandList,
+                SceneType::Triangles,
+                pMortonCodeBuffer->GetGPUVirtualAddress(),
+                pSplitHierarchyBuffer->GetGPUVirtualAddress(),
+                D3D12_GPU_DESCRIPTOR_HANDLE(),
+                numTriangles);
+
+            PLOCHierarchyPass::BatchedBuild plocBuild = {
+                numTriangles,
+                pTriangleBuffer->GetGPUVirtualAddress(),
+                pClusteredHierarchyBuffer->GetGPUVirtualAddress(),
+                pScratchBuffer->GetGPUVirtualAddress() };
+            plocHierarchyPass.ConstructHierarchy(pCommandList, 1, &plocBuild);
+
+            pCommandList->Close();
+            m_d3d12Context.ExecuteCommandList(pCommandList);
+
+            std::vector<HierarchyNode> splitHierarchy(numNodes);
+            m_d3d12Context.ReadbackResource(pSplitHierarchyBuffer, splitHierarchy.data(), (UINT)(splitHierarchy.size() * sizeof(*splitHierarchy.data())));
+            std::vector<HierarchyNode> clusteredHierarchy(numNodes);
+            m_d3d12Context.ReadbackResource(pClusteredHierarchyBuffer, clusteredHierarchy.data(), (UINT)(clusteredHierarchy.size() * sizeof(*clusteredHierarchy.data())));
+
+            float splitCost = ComputeHierarchySAHCost(splitHierarchy, sortedTriangles);
+            float clusteredCost = ComputeHierarchySAHCost(clusteredHierarchy, sortedTriangles);
+
+            std::wstringstream costMessage;
+            costMessage << L"SAH cost with Morton code splits: " << splitCost << L", with clustering: " << clusteredCost;
+            Logger::WriteMessage(costMessage.str().c_str());
+
+            Assert::IsTrue(clusteredCost <= splitCost, L"Clustering gave a higher SAH cost than splitting on the Morton codes");
+        }
+
+        // Calculates, sorts and splits on the Morton codes the same way the builder does, and returns
+        // the SAH cost of the hierarchy
+        float ComputeMortonCodeHierarchySAHCost(const std::vector<Primitive> &triangles, const AABB &sceneAABB, bool uses64BitMortonCodes)
+        {
+            auto &d3d12Device = m_d3d12Context.GetDevice();
+            MortonCodesCalculator mortonCodeCalculator(&d3d12Device, 0);
+            BitonicSort bitonicSorter(&d3d12Device, 0);
+            ConstructHierarchyPass constructHierarchyPass(&d3d12Device, 0);
+
+            const UINT numTriangles = (UINT)triangles.size();
+            const UINT numNodes = numTriangles * 2 - 1;
+            D3D12_HEAP_PROPERTIES defaultHeapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
+
+            CComPtr<ID3D12Resource> pTriangleBuffer;
+            m_d3d12Context.CreateResourceWithInitialData(triangles.data(), (UINT)(triangles.size() * sizeof(*triangles.data())), &pTriangleBuffer);
+
+            CComPtr<ID3D12Resource> pSceneAABB;
+            m_d3d12Context.CreateResourceWithInitialData(&sceneAABB, sizeof(sceneAABB), &pSceneAABB);
+
+            CComPtr<ID3D12Resource> pMortonCodeBuffer;
+            auto mortonCodeBufferDesc = CD3DX12_RESOURCE_DESC::Buffer(numTriangles * (uses64BitMortonCodes ? sizeof(UINT64) : sizeof(UINT32)), D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+            AssertSucceeded(d3d12Device.CreateCommittedResource(&defaultHeapProperties, D3D12_HEAP_FLAG_NONE, &mortonCodeBufferDesc, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, nullptr, IID_PPV_ARGS(&pMortonCodeBuffer)));
+
+            CComPtr<ID3D12Resource> pIndexBuffer;
+            auto indexBufferDesc = CD3DX12_RESOURCE_DESC::Buffer(numTriangles * sizeof(UINT32), D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+            AssertSucceeded(d3d12Device.CreateCommittedResource(&defaultHeapProperties, D3D12_HEAP_FLAG_NONE, &indexBufferDesc, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, nullptr, IID_PPV_ARGS(&pIndexBuffer)));
+
+            CComPtr<ID3D12Resource> pHierarchyBuffer;
+            auto hierarchyBufferDesc = CD3DX12_RESOURCE_DESC::Buffer(sizeof(HierarchyNode) * numNodes, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+            AssertSucceeded(d3d12Device.CreateCommittedResource(&defaultHeapProperties, D3D12_HEAP_FLAG_NONE, &hierarchyBufferDesc, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, nullptr, IID_PPV_ARGS(&pHierarchyBuffer)));
+
+            CComPtr<ID3D12GraphicsCommandList> pCommandList;
+            m_d3d12Context.GetGraphicsCommandList(&pCommandList);
+
+            mortonCodeCalculator.CalculateMortonCodes(
+                pCommandList,
+                SceneType::Triangles,
+                pTriangleBuffer->GetGPUVirtualAddress(),
+                numTriangles,
+                pSceneAABB->GetGPUVirtualAddress(),
+                pIndexBuffer->GetGPUVirtualAddress(),
+                pMortonCodeBuffer->GetGPUVirtualAddress(),
+                uses64BitMortonCodes);
+            bitonicSorter.Sort(pCommandList, pMortonCodeBuffer->GetGPUVirtualAddress(), pIndexBuffer->GetGPUVirtualAddress(), numTriangles, false, true, uses64BitMortonCodes);
+            constructHierarchyPass.ConstructHierarchy(
+                pCommandList,
+                SceneType::Triangles,
+                pMortonCodeBuffer->GetGPUVirtualAddress(),
+                pHierarchyBuffer->GetGPUVirtualAddress(),
+                D3D12_GPU_DESCRIPTOR_HANDLE(),
+                numTriangles,
+                uses64BitMortonCodes);
+
+            pCommandList->Close();
+            m_d3d12Context.ExecuteCommandList(pCommandList);
+
+            std::vector<UINT32> sortedIndices(numTriangles);
+            m_d3d12Context.ReadbackResource(pIndexBuffer, sortedIndices.data(), (UINT)(sortedIndices.size() * sizeof(*sortedIndices.data())));
+            std::vector<HierarchyNode> hierarchy(numNodes);
+            m_d3d12Context.ReadbackResource(pHierarchyBuffer, hierarchy.data(), (UINT)(hierarchy.size() * sizeof(*hierarchy.data())));
+
+            std::vector<Primitive> sortedTriangles(numTriangles);
+            for (UINT i = 0; i < numTriangles; i++)
+            {
+                sortedTriangles[i] = triangles[sortedIndices[i]];
+            }
+            return ComputeHierarchySAHCost(hierarchy, sortedTriangles);
+        }
+
+        TEST_METHOD(WideMortonCodesLowerSAHCost)
+        {
+            // A wide, flat terrain with a small dense cluster of detail in its middle
+            const UINT numTerrainTriangles = 6144;
+            const UINT numDetailTriangles = 2048;
+            std::vector<Primitive> triangles(numTerrainTriangles + numDetailTriangles);
+            AABB sceneAABB;
+            sceneAABB.min = { FLT_MAX, FLT_MAX, FLT_MAX };
+            sceneAABB.max = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+            srand(42);
+            for (UINT i = 0; i < (UINT)triangles.size(); i++)
+            {
+                const bool isDetail = i >= numTerrainTriangles;
+                const float3 extents = isDetail ? float3{ 1.0f, 1.0f, 1.0f } : float3{ 10000.0f, 20.0f, 10000.0f };
+                const float triangleSize = isDetail ? 0.01f : 50.0f;
+
+                Primitive &primitive = triangles[i];
+                primitive.PrimitiveType = TRIANGLE_TYPE;
+                Triangle &tri = primitive.triangle;
+                float3 center;
+                center.x = (rand() / (float)RAND_MAX - 0.5f) * extents.x;
+                center.y = (rand() / (float)RAND_MAX - 0.5f) * extents.y;
+                center.z = (rand() / (float)RAND_MAX - 0.5f) * extents.z;
+                for (uint vIdx = 0; vIdx < 3; vIdx++)
+                {
+                    tri.v[vIdx].x = center.x + (rand() / (float)RAND_MAX - 0.5f) * triangleSize;
+                    tri.v[vIdx].y = center.y + (rand() / (float)RAND_MAX - 0.5f) * triangleSize;
+                    tri.v[vIdx].z = center.z + (rand() / (float)RAND_MAX - 0.5f) * triangleSize;
+                    sceneAABB.min = min(sceneAABB.min, tri.v[vIdx]);
+                    sceneAABB.max = max(sceneAABB.max, tri.v[vIdx]);
+                }
+            }
+
+            float cost32Bit = ComputeMortonCodeHierarchySAHCost(triangles, sceneAABB, false);
+            float cost64Bit = ComputeMortonCodeHierarchySAHCost(triangles, sceneAABB, true);
+
+            std::wstringstream costMessage;
+            costMessage << L"SAH cost with 30-bit Morton codes: " << cost32Bit << L", with 60-bit Morton codes: " << cost64Bit;
+            Logger::WriteMessage(costMessage.str().c_str());
+
+            Assert::IsTrue(cost64Bit <= cost32Bit, L"60-bit Morton codes gave a higher SAH cost than 30-bit codes");
+        }
+
         TEST_METHOD(LoadAABBs)
         {
             TestLoadPrimitives<AABB>(PROCEDURAL_PRIMITIVE_TYPE);
@@ -3552,6 +4214,69 @@ namespace FallbackLayerUnitTests
             m_d3d12Context.WaitForGpuWork();
         }
 
+        struct RayQueryConstants
+        {
+            RayGenViewport Viewport;
+            EMULATED_GPU_POINTER TopLevelAccelerationStructure;
+            UINT UseClosestHit;
+        };
+
+        // Traces the same rays as TraceRay from a compute shader using the ray query functions
+        void TraceRayQuery(bool useClosestHit, UINT rayFlags = 0, UINT InstanceInclusionMask = 0xff)
+        {
+            auto &d3d12device = m_d3d12Context.GetDevice();
+            enum RayQueryRootSignatureParams
+            {
+                RayQueryConstantSlot = 0,
+                RayQueryOutputViewSlot,
+                DescriptorHeapSlot,
+                NumRayQueryParameters
+            };
+
+            // The emulated pointers index into the whole descriptor heap
+            CD3DX12_DESCRIPTOR_RANGE outputDescriptor(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 1, 0);
+            CD3DX12_DESCRIPTOR_RANGE descriptorHeapRange(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, UINT_MAX, 0, 1);
+            CD3DX12_ROOT_PARAMETER rootParameters[NumRayQueryParameters];
+            rootParameters[RayQueryConstantSlot].InitAsConstants(SizeOfInUint32(RayQueryConstants), 0, 0);
+            rootParameters[RayQueryOutputViewSlot].InitAsDescriptorTable(1, &outputDescriptor);
+            rootParameters[DescriptorHeapSlot].InitAsDescriptorTable(1, &descriptorHeapRange);
+
+            CD3DX12_ROOT_SIGNATURE_DESC rootSignatureDesc(ARRAYSIZE(rootParameters), rootParameters);
+            CComPtr<ID3DBlob> pRootSignatureBlob;
+            AssertSucceeded(D3D12SerializeRootSignature(&rootSignatureDesc, D3D_ROOT_SIGNATURE_VERSION_1, &pRootSignatureBlob, nullptr));
+
+            CComPtr<ID3D12RootSignature> pRootSignature;
+            AssertSucceeded(d3d12device.CreateRootSignature(0, pRootSignatureBlob->GetBufferPointer(), pRootSignatureBlob->GetBufferSize(), IID_PPV_ARGS(&pRootSignature)));
+
+            D3D12_COMPUTE_PIPELINE_STATE_DESC psoDesc = {};
+            psoDesc.pRootSignature = pRootSignature;
+            psoDesc.CS = CD3DX12_SHADER_BYTECODE((void *)g_pRayQueryTrace, sizeof(g_pRayQueryTrace));
+            CComPtr<ID3D12PipelineState> pPipelineState;
+            AssertSucceeded(d3d12device.CreateComputePipelineState(&psoDesc, IID_PPV_ARGS(&pPipelineState)));
+
+            CComPtr<ID3D12GraphicsCommandList> pCommandList;
+            m_d3d12Context.GetGraphicsCommandList(&pCommandList);
+
+            ID3D12DescriptorHeap *pDescriptorHeaps[] = { &m_pDescriptorHeapStack->GetDescriptorHeap() };
+            pCommandList->SetDescriptorHeaps(ARRAYSIZE(pDescriptorHeaps), pDescriptorHeaps);
+
+            RayQueryConstants constants = { viewport, m_TopLevelAccelerationStructurePointer.EmulatedGpuPtr, useClosestHit };
+            constants.Viewport.RayFlags = rayFlags;
+            constants.Viewport.InstanceInclusionMask = InstanceInclusionMask;
+
+            pCommandList->SetComputeRootSignature(pRootSignature);
+            pCommandList->SetPipelineState(pPipelineState);
+            pCommandList->SetComputeRoot32BitConstants(RayQueryConstantSlot, SizeOfInUint32(constants), &constants, 0);
+            pCommandList->SetComputeRootDescriptorTable(RayQueryOutputViewSlot, m_UAVGpuDescriptor);
+            pCommandList->SetComputeRootDescriptorTable(DescriptorHeapSlot, m_pDescriptorHeapStack->GetDescriptorHeap().GetGPUDescriptorHandleForHeapStart());
+            pCommandList->Dispatch((cOutputBufferWidth + 7) / 8, (cOutputBufferHeight + 7) / 8, 1);
+
+            pCommandList->Close();
+            m_d3d12Context.ExecuteCommandList(pCommandList);
+
+            m_d3d12Context.WaitForGpuWork();
+        }
+
         BYTE hitColor[4] = { 255, 0, 255, 255 };
         BYTE missColor[4] = { 255, 0, 0, 255 };
         void VerifyOutput(std::vector<bool> isHitExpected)
@@ -3832,11 +4557,19 @@ namespace FallbackLayerUnitTests
         }
 
         TEST_METHOD_INITIALIZE(MethodSetup)
+        {
+            CreateDeviceResources(CreateRaytracingFallbackDeviceFlags::ForceComputeFallback);
+        }
+
+        void CreateDeviceResources(DWORD createRaytracingFallbackDeviceFlags)
         {
             auto &d3d12device = m_d3d12Context.GetDevice();
+            m_pRaytracingOutputResource = nullptr;
+            m_pRootSignature = nullptr;
+            m_pRaytracingDevice = nullptr;
             D3D12CreateRaytracingFallbackDevice(
                 &d3d12device,
-                CreateRaytracingFallbackDeviceFlags::ForceComputeFallback,
+                createRaytracingFallbackDeviceFlags,
                 0,
                 IID_PPV_ARGS(&m_pRaytracingDevice));
 
@@ -3955,7 +4688,7 @@ namespace FallbackLayerUnitTests
             memcpy(pTransform, transform, sizeof(transform));
         }
 
-        void TestCulling(RAY_FLAG cullFlag)
+        void TestCulling(RAY_FLAG cullFlag, bool useRayQuery = false)
         {
             BuildSimpleStateObject();
             const UINT numTests = 6;
@@ -4007,7 +4740,14 @@ namespace FallbackLayerUnitTests
             }
 
             BuildTopLevelAccelerationStructure(bottomLevelResources, transformationsList, instanceFlags);
-            TraceRay(cullFlag);
+            if (useRayQuery)
+            {
+                TraceRayQuery(true, cullFlag);
+            }
+            else
+            {
+                TraceRay(cullFlag);
+            }
 
             VerifyOutput(hitExpected);
         }
@@ -4037,6 +4777,57 @@ namespace FallbackLayerUnitTests
             TestCulling(RAY_FLAG_NONE);
         }
 
+        TEST_METHOD(BasicTraceWithShortStack)
+        {
+            CreateDeviceResources(CreateRaytracingFallbackDeviceFlags::ForceComputeFallback | CreateRaytracingFallbackDeviceFlags::EnableShortStackTraversal);
+            TestLeftScreenFillingSingleBottomLevel(IdentityMatrix, HITS_ON_LEFT_HALF_OF_SCREEN);
+        }
+
+        TEST_METHOD(TraceBackFaceCullingWithShortStack)
+        {
+            CreateDeviceResources(CreateRaytracingFallbackDeviceFlags::ForceComputeFallback | CreateRaytracingFallbackDeviceFlags::EnableShortStackTraversal);
+            TestCulling(RAY_FLAG_CULL_BACK_FACING_TRIANGLES);
+        }
+
+        TEST_METHOD(RayQueryTraceClosest)
+        {
+            std::vector<CComPtr<ID3D12Resource>> bottomLevelResources;
+            std::vector<const float *> transformations = { IdentityMatrix };
+            BuildBottomLevelAccelerationStructure(LEFT_HALF_SCREEN_QUAD, Clockwise, bottomLevelResources);
+            BuildTopLevelAccelerationStructure(bottomLevelResources, transformations);
+
+            TraceRayQuery(true);
+            VerifyOutput(HITS_ON_LEFT_HALF_OF_SCREEN);
+        }
+
+        TEST_METHOD(RayQueryTraceOcclusionWithInstanceTranslation)
+        {
+            float translateToRightHalf[12] = {
+                1, 0, 0, 1,
+                0, 1, 0, 0,
+                0, 0, 1, 0
+            };
+            std::vector<CComPtr<ID3D12Resource>> bottomLevelResources;
+            std::vector<const float *> transformations = { translateToRightHalf };
+            BuildBottomLevelAccelerationStructure(LEFT_HALF_SCREEN_QUAD, Clockwise, bottomLevelResources);
+            BuildTopLevelAccelerationStructure(bottomLevelResources, transformations);
+
+            TraceRayQuery(false);
+            VerifyOutput(HITS_ON_RIGHT_HALF_OF_SCREEN);
+        }
+
+        TEST_METHOD(RayQueryTraceEmptyAccelerationStructure)
+        {
+            BuildEmptyTopLevelAccelerationStructure();
+            TraceRayQuery(true);
+            VerifyOutput(ALL_MISS);
+        }
+
+        TEST_METHOD(RayQueryTraceBackFaceCulling)
+        {
+            TestCulling(RAY_FLAG_CULL_BACK_FACING_TRIANGLES, true);
+        }
+
         TEST_METHOD(TraceInstanceMasks)
         {
             BuildSimpleStateObject();
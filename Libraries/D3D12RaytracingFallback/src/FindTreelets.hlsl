@@ -15,17 +15,7 @@
 
 AABB ComputeLeafAABB(uint triangleIndex)
 {
-    uint2 unused;
-    Primitive primitive = InputBuffer[triangleIndex];
-    if (primitive.PrimitiveType == TRIANGLE_TYPE)
-    {
-        Triangle tri = GetTriangle(primitive);
-        return BoundingBoxToAABB(GetBoxDataFromTriangle(tri.v0, tri.v1, tri.v2, triangleIndex, unused));
-    }
-    else // if(primitiveType == PROCEDURAL_PRIMITIVE_TYPE)
-    {
-        return GetProceduralPrimitiveAABB(primitive);
-    }
+    return GetPrimitiveAABB(InputBuffer[triangleIndex], triangleIndex);
 }
 
 [numthreads(THREAD_GROUP_1D_WIDTH, 1, 1)]
@@ -22,10 +22,15 @@ namespace FallbackLayer
         m_loadInstancesPass(pDevice, nodeMask),
         m_loadPrimitivesPass(pDevice, nodeMask),
         m_constructHierarchyPass(pDevice, nodeMask),
+        m_plocHierarchyPass(pDevice, nodeMask),
         m_constructAABBPass(pDevice, nodeMask),
         m_postBuildInfoQuery(pDevice, nodeMask),
         m_copyPass(pDevice, totalLaneCount, nodeMask),
-        m_treeletReorder(pDevice, nodeMask)
+        m_treeletReorder(pDevice, nodeMask),
+        m_topLevelUpdatePass(pDevice, nodeMask)
+#if ENABLE_GPU_ACCELERATION_STRUCTURE_VALIDATION
+        , m_validator(pDevice, nodeMask)
+#endif
     {}
 
     void GpuBvh2Builder::BuildRaytracingAccelerationStructure(
@@ -33,19 +38,67 @@ namespace FallbackLayer
         _In_  const D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC *pDesc,
         _In_ ID3D12DescriptorHeap *pCbvSrvUavDescriptorHeap)
     {
-        switch (pDesc->Inputs.Type)
+        BuildRaytracingAccelerationStructures(pCommandList, 1, pDesc, pCbvSrvUavDescriptorHeap);
+    }
+
+    void GpuBvh2Builder::BuildRaytracingAccelerationStructures(
+        _In_  ID3D12GraphicsCommandList *pCommandList,
+        _In_  UINT NumDescs,
+        _In_reads_(NumDescs)  const D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC *pDescs,
+        _In_ ID3D12DescriptorHeap *pCbvSrvUavDescriptorHeap)
+    {
+        // Consecutive builds of the same type are batched, so each stage of the build is recorded
+        // once for all of them behind a single barrier. A change of type ends the batch since a
+        // top-level build may be reading the bottom-level builds that came before it.
+        for (UINT batchStart = 0, batchEnd = 0; batchStart < NumDescs; batchStart = batchEnd)
         {
-            case D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL:
-                BuildBottomLevelBVH(pCommandList, pDesc);
-            break;
-            case D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL:
-                BuildTopLevelBVH(pCommandList, pDesc, pCbvSrvUavDescriptorHeap);
-            break;
-            default:
-                ThrowFailure(E_INVALIDARG, L"Unrecognized D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE provided");
+            const D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE type = pDescs[batchStart].Inputs.Type;
+            while (batchEnd < NumDescs && pDescs[batchEnd].Inputs.Type == type)
+            {
+                batchEnd++;
+            }
+
+            switch (type)
+            {
+                case D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL:
+                    BuildBVHs(pCommandList, batchEnd - batchStart, &pDescs[batchStart], Level::Bottom, SceneType::Triangles, D3D12_GPU_DESCRIPTOR_HANDLE());
+                break;
+                case D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL:
+                    BuildBVHs(pCommandList, batchEnd - batchStart, &pDescs[batchStart], Level::Top, SceneType::BottomLevelBVHs, pCbvSrvUavDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
+                break;
+                default:
+                    ThrowFailure(E_INVALIDARG, L"Unrecognized D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE provided");
+            }
+        }
+
+#if ENABLE_GPU_ACCELERATION_STRUCTURE_VALIDATION
+        ValidateBVHs(pCommandList, NumDescs, pDescs);
+#endif
+    }
+
+#if ENABLE_GPU_ACCELERATION_STRUCTURE_VALIDATION
+    void GpuBvh2Builder::ValidateBVHs(
+        _In_  ID3D12GraphicsCommandList *pCommandList,
+        UINT numDescs,
+        _In_reads_(numDescs)  const D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC *pDescs)
+    {
+        m_validator.ReportErrors();
+
+        auto uavBarrier = CD3DX12_RESOURCE_BARRIER::UAV(nullptr);
+        pCommandList->ResourceBarrier(1, &uavBarrier);
+
+        for (UINT i = 0; i < numDescs; i++)
+        {
+            const D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS &inputs = pDescs[i].Inputs;
+            const bool isBottomLevel = inputs.Type == D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL;
+            const UINT numElements = isBottomLevel ? GetTotalPrimitiveCount(inputs) : inputs.NumDescs;
+            m_validator.Validate(pCommandList, pDescs[i].DestAccelerationStructureData, numElements, isBottomLevel);
         }
     }
+#endif
 
+#define updatesAllowed(flags) ((flags & D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_ALLOW_UPDATE) != 0)
+#define shouldPerformUpdate(flags) ((flags & D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PERFORM_UPDATE) != 0)
     void GpuBvh2Builder::LoadGpuBVHBuffers(
         _In_  const D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC *pDesc,
         Level bvhLevel,
@@ -53,22 +106,18 @@ namespace FallbackLayer
         GpuBVHBuffers &buffers)
     {
         D3D12_GPU_VIRTUAL_ADDRESS bvhGpuVA = pDesc->DestAccelerationStructureData;
-        ScratchMemoryPartitions scratchMemoryPartition = CalculateScratchMemoryUsage(bvhLevel, numElements);
         D3D12_GPU_VIRTUAL_ADDRESS scratchGpuVA = pDesc->ScratchAccelerationStructureData;
-        
-        buffers.scratchElementBuffer = scratchGpuVA + scratchMemoryPartition.OffsetToElements;
-        buffers.mortonCodeBuffer = scratchGpuVA + scratchMemoryPartition.OffsetToMortonCodes;
-        buffers.sceneAABB = scratchGpuVA + scratchMemoryPartition.OffsetToSceneAABB;
-        buffers.sceneAABBScratchMemory = scratchGpuVA + scratchMemoryPartition.OffsetToSceneAABBScratchMemory;
-        buffers.indexBuffer = scratchGpuVA + scratchMemoryPartition.OffsetToIndexBuffer;
-        buffers.hierarchyBuffer = scratchGpuVA + scratchMemoryPartition.OffsetToHierarchy;
-        buffers.calculateAABBScratchBuffer = scratchGpuVA + scratchMemoryPartition.OffsetToCalculateAABBDispatchArgs;
-        buffers.nodeCountBuffer = scratchGpuVA + scratchMemoryPartition.OffsetToPerNodeCounter;
 
-        if (SupportsTreeletReordering(bvhLevel))
+        if (shouldPerformUpdate(pDesc->Inputs.Flags))
         {
-            buffers.baseTreeletsCountBuffer = scratchGpuVA + scratchMemoryPartition.OffsetToBaseTreeletsCount;
-            buffers.baseTreeletsIndexBuffer = buffers.baseTreeletsCountBuffer + sizeof(UINT);
+            // A refit only fits the AABBs again, so the update scratch holds nothing else
+            ScratchMemoryPartitions updateScratchMemoryPartition = CalculateUpdateScratchMemoryUsage(numElements);
+            buffers.calculateAABBScratchBuffer = scratchGpuVA + updateScratchMemoryPartition.OffsetToCalculateAABBDispatchArgs;
+            buffers.nodeCountBuffer = scratchGpuVA + updateScratchMemoryPartition.OffsetToPerNodeCounter;
+        }
+        else
+        {
+            LoadGpuBVHScratchBuffers(bvhLevel, numElements, pDesc->Inputs.Flags, scratchGpuVA, buffers);
         }
 
         switch(bvhLevel) 
@@ -76,7 +125,6 @@ namespace FallbackLayer
             case Level::Top:
             {
                 UINT offsetFromElementsToMetadata = GetOffsetFromLeafNodesToBottomLevelMetadata(numElements);
-                buffers.scratchMetadataBuffer = buffers.scratchElementBuffer + offsetFromElementsToMetadata;
                 buffers.outputElementBuffer = bvhGpuVA + GetOffsetToLeafNodeAABBs(numElements);
                 buffers.outputMetadataBuffer = buffers.outputElementBuffer + offsetFromElementsToMetadata;
                 buffers.outputSortCacheBuffer = bvhGpuVA + GetOffsetToBVHSortedIndices(numElements);
@@ -85,7 +133,6 @@ namespace FallbackLayer
             break;
             case Level::Bottom:
             {
-                buffers.scratchMetadataBuffer = buffers.scratchElementBuffer + GetOffsetFromPrimitivesToPrimitiveMetaData(numElements);
                 buffers.outputElementBuffer = bvhGpuVA + GetOffsetToPrimitives(numElements);
                 buffers.outputMetadataBuffer = buffers.outputElementBuffer + GetOffsetFromPrimitivesToPrimitiveMetaData(numElements);
                 buffers.outputSortCacheBuffer = buffers.outputMetadataBuffer + GetOffsetFromPrimitiveMetaDataToSortedIndices(numElements);
@@ -95,125 +142,182 @@ namespace FallbackLayer
         }
     }
 
-    void GpuBvh2Builder::BuildTopLevelBVH(
-        _In_  ID3D12GraphicsCommandList *pCommandList,
-        _In_  const D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC *pDesc,
-        _In_ ID3D12DescriptorHeap *pCbvSrvUavDescriptorHeap)
+    void GpuBvh2Builder::LoadGpuBVHScratchBuffers(
+        Level bvhLevel,
+        UINT numElements,
+        D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAGS buildFlags,
+        D3D12_GPU_VIRTUAL_ADDRESS scratchGpuVA,
+        GpuBVHBuffers &buffers)
     {
-        const SceneType sceneType = SceneType::BottomLevelBVHs;
-        UINT numElements = pDesc->Inputs.NumDescs;
-        D3D12_GPU_DESCRIPTOR_HANDLE globalDescriptorHeap = pCbvSrvUavDescriptorHeap->GetGPUDescriptorHandleForHeapStart();
+        ScratchMemoryPartitions scratchMemoryPartition = CalculateScratchMemoryUsage(bvhLevel, numElements, buildFlags);
 
-        BuildBVH(
-            pCommandList,
-            pDesc,
-            Level::Top,
-            sceneType,
-            numElements,
-            globalDescriptorHeap
-        );
-    }
+        buffers.scratchElementBuffer = scratchGpuVA + scratchMemoryPartition.OffsetToElements;
+        buffers.mortonCodeBuffer = scratchGpuVA + scratchMemoryPartition.OffsetToMortonCodes;
+        buffers.sceneAABB = scratchGpuVA + scratchMemoryPartition.OffsetToSceneAABB;
+        buffers.sceneAABBScratchMemory = scratchGpuVA + scratchMemoryPartition.OffsetToSceneAABBScratchMemory;
+        buffers.indexBuffer = scratchGpuVA + scratchMemoryPartition.OffsetToIndexBuffer;
+        buffers.hierarchyBuffer = scratchGpuVA + scratchMemoryPartition.OffsetToHierarchy;
+        buffers.calculateAABBScratchBuffer = scratchGpuVA + scratchMemoryPartition.OffsetToCalculateAABBDispatchArgs;
+        buffers.nodeCountBuffer = scratchGpuVA + scratchMemoryPartition.OffsetToPerNodeCounter;
 
-    void GpuBvh2Builder::BuildBottomLevelBVH(
-        _In_  ID3D12GraphicsCommandList *pCommandList,
-        _In_  const D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC *pDesc)
-    {
-        const SceneType sceneType = SceneType::Triangles;
-        UINT numElements = GetTotalPrimitiveCount(pDesc->Inputs);
-        D3D12_GPU_DESCRIPTOR_HANDLE globalDescriptorHeap = D3D12_GPU_DESCRIPTOR_HANDLE();
+        if (SupportsTreeletReordering(bvhLevel))
+        {
+            buffers.baseTreeletsCountBuffer = scratchGpuVA + scratchMemoryPartition.OffsetToBaseTreeletsCount;
+            buffers.baseTreeletsIndexBuffer = buffers.baseTreeletsCountBuffer + sizeof(UINT);
+        }
 
-        BuildBVH(
-            pCommandList,
-            pDesc,
-            Level::Bottom,
-            sceneType,
-            numElements,
-            globalDescriptorHeap
-        );
+        if (UsesPLOCHierarchy(bvhLevel, buildFlags))
+        {
+            buffers.plocScratchBuffer = scratchGpuVA + scratchMemoryPartition.OffsetToPLOCScratchMemory;
+        }
+
+        buffers.scratchMetadataBuffer = buffers.scratchElementBuffer + (bvhLevel == Level::Top ?
+            GetOffsetFromLeafNodesToBottomLevelMetadata(numElements) :
+            GetOffsetFromPrimitivesToPrimitiveMetaData(numElements));
     }
 
-#define updatesAllowed(flags) ((flags & D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_ALLOW_UPDATE) != 0)
-#define shouldPerformUpdate(flags) ((flags & D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PERFORM_UPDATE) != 0)
-    void GpuBvh2Builder::BuildBVH(
+    void GpuBvh2Builder::BuildBVHs(
         _In_  ID3D12GraphicsCommandList *pCommandList,
-        _In_  const D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC *pDesc,
+        UINT numDescs,
+        _In_reads_(numDescs)  const D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC *pDescs,
         Level bvhLevel,
         SceneType sceneType,
-        UINT numElements,
         D3D12_GPU_DESCRIPTOR_HANDLE globalDescriptorHeap)
     {
-        if (pDesc->DestAccelerationStructureData == 0)
+        std::vector<BVHBuild> builds(numDescs);
+        for (UINT descIndex = 0; descIndex < numDescs; descIndex++)
         {
-            ThrowFailure(E_INVALIDARG, L"DestAccelerationStructureData.StartAddress must be non-zero");
+            const D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC *pDesc = &pDescs[descIndex];
+            if (pDesc->DestAccelerationStructureData == 0)
+            {
+                ThrowFailure(E_INVALIDARG, L"DestAccelerationStructureData.StartAddress must be non-zero");
+            }
+
+            BVHBuild &build = builds[descIndex];
+            build.pDesc = pDesc;
+            build.numElements = (bvhLevel == Level::Top) ? pDesc->Inputs.NumDescs : GetTotalPrimitiveCount(pDesc->Inputs);
+            build.updatesAllowed = updatesAllowed(pDesc->Inputs.Flags);
+            build.performUpdate = shouldPerformUpdate(pDesc->Inputs.Flags);
+            LoadGpuBVHBuffers(pDesc, bvhLevel, build.numElements, build.buffers);
         }
 
-        GpuBVHBuffers buffers = {}; LoadGpuBVHBuffers(pDesc, bvhLevel, numElements, buffers);
+        if (bvhLevel == Level::Bottom)
+        {
+            BuildBVHBatch(pCommandList, sceneType, builds, globalDescriptorHeap);
+            return;
+        }
 
-        const bool updatesAllowed = updatesAllowed(pDesc->Inputs.Flags);
-        const bool performUpdate = shouldPerformUpdate(pDesc->Inputs.Flags);
+        // Top levels that allow updates measure the SAH cost they're built with, and
+        // each update chooses on the GPU between refitting them and rebuilding them
+        std::vector<BVHBuild> topLevelBuilds;
+        std::vector<BVHBuild> topLevelUpdates;
+        for (const BVHBuild &build : builds)
+        {
+            if (build.performUpdate)
+            {
+                topLevelUpdates.push_back(build);
+            }
+            else
+            {
+                if (build.updatesAllowed)
+                {
+                    m_topLevelUpdatePass.ChooseUpdate(pCommandList, build.pDesc->DestAccelerationStructureData, false, TopLevelRebuildCostRatio);
+                }
+                topLevelBuilds.push_back(build);
+            }
+        }
 
-        // Load in the leaf-node elements of the BVH and calculate the entire scene's AABB.
-        LoadBVHElements(
-            pCommandList,
-            pDesc,
-            sceneType,
-            numElements,
-            performUpdate ? buffers.outputElementBuffer   : buffers.scratchElementBuffer, // If we're updating, write straight to output.
-            performUpdate ? buffers.outputMetadataBuffer  : buffers.scratchMetadataBuffer, 
-            performUpdate ? buffers.outputSortCacheBuffer : 0,
-            buffers.sceneAABBScratchMemory,
-            buffers.sceneAABB,
-            globalDescriptorHeap);
-
-        // If we don't have PERFORM_UPDATE set, rebuild the entire hierarchy.
-        // (i.e. calc morton codes, sort, rearrange, build hierarchy, treelet reorder)
-        if (!performUpdate) {
-            BuildBVHHierarchy(
-                pCommandList,
-                pDesc,
-                sceneType,
-                numElements,
-                buffers.scratchElementBuffer,
-                buffers.outputElementBuffer,
-                buffers.scratchMetadataBuffer,
-                buffers.outputMetadataBuffer,
-                buffers.sceneAABBScratchMemory,
-                buffers.sceneAABB,
-                buffers.mortonCodeBuffer,
-                buffers.indexBuffer,
-                updatesAllowed ? buffers.outputSortCacheBuffer : 0,
-                buffers.hierarchyBuffer,
-                buffers.nodeCountBuffer,
-                buffers.baseTreeletsCountBuffer,
-                buffers.baseTreeletsIndexBuffer,
-                globalDescriptorHeap);
+        if (!topLevelBuilds.empty())
+        {
+            BuildBVHBatch(pCommandList, sceneType, topLevelBuilds, globalDescriptorHeap);
+            for (const BVHBuild &build : topLevelBuilds)
+            {
+                if (build.updatesAllowed)
+                {
+                    m_topLevelUpdatePass.ComputeSAHCost(pCommandList, build.pDesc->DestAccelerationStructureData, build.numElements);
+                }
+            }
+        }
+
+        for (const BVHBuild &build : topLevelUpdates)
+        {
+            UpdateTopLevelBVH(pCommandList, build, globalDescriptorHeap);
+        }
+    }
+
+    void GpuBvh2Builder::UpdateTopLevelBVH(
+        _In_ ID3D12GraphicsCommandList *pCommandList,
+        const BVHBuild &build,
+        D3D12_GPU_DESCRIPTOR_HANDLE globalDescriptorHeap)
+    {
+        const D3D12_GPU_VIRTUAL_ADDRESS outputBVH = build.pDesc->DestAccelerationStructureData;
+
+        // The update scratch of a top level is sized for a rebuild
+        BVHBuild rebuild = build;
+        rebuild.performUpdate = false;
+        LoadGpuBVHScratchBuffers(Level::Top, build.numElements, build.pDesc->Inputs.Flags, build.pDesc->ScratchAccelerationStructureData, rebuild.buffers);
+
+        m_topLevelUpdatePass.ChooseUpdate(pCommandList, outputBVH, true, TopLevelRebuildCostRatio);
+
+        m_topLevelUpdatePass.PredicateOnChoice(pCommandList, true);
+        BuildBVHBatch(pCommandList, SceneType::BottomLevelBVHs, { rebuild }, globalDescriptorHeap);
+
+        m_topLevelUpdatePass.PredicateOnChoice(pCommandList, false);
+        BuildBVHBatch(pCommandList, SceneType::BottomLevelBVHs, { build }, globalDescriptorHeap);
+
+        m_topLevelUpdatePass.EndPredication(pCommandList);
+
+        m_topLevelUpdatePass.ComputeSAHCost(pCommandList, outputBVH, build.numElements);
+    }
+
+    void GpuBvh2Builder::BuildBVHBatch(
+        _In_ ID3D12GraphicsCommandList *pCommandList,
+        const SceneType sceneType,
+        const std::vector<BVHBuild> &builds,
+        D3D12_GPU_DESCRIPTOR_HANDLE globalDescriptorHeap)
+    {
+        // Load in the leaf-node elements of the BVH.
+        LoadBVHElements(pCommandList, sceneType, builds, globalDescriptorHeap);
+
+        // Builds without PERFORM_UPDATE set rebuild the entire hierarchy.
+        // (i.e. calc scene AABB and morton codes, sort, rearrange, build hierarchy, treelet reorder)
+        // Updates already have their elements in the sorted slots and only the AABBs are refit.
+        std::vector<BVHBuild> rebuilds;
+        for (const BVHBuild &build : builds)
+        {
+            if (!build.performUpdate)
+            {
+                rebuilds.push_back(build);
+            }
         }
+        BuildBVHHierarchy(pCommandList, sceneType, rebuilds, globalDescriptorHeap);
 
         // Fit AABBs around each node in the hierarchy.
+        std::vector<ConstructAABBPass::BatchedBuild> aabbBuilds;
+        for (const BVHBuild &build : builds)
+        {
+            aabbBuilds.push_back({
+                build.pDesc->DestAccelerationStructureData,
+                build.buffers.calculateAABBScratchBuffer,
+                build.buffers.nodeCountBuffer,
+                build.buffers.hierarchyBuffer,
+                build.buffers.outputAABBParentBuffer,
+                build.updatesAllowed && !build.performUpdate,
+                build.performUpdate,
+                build.numElements });
+        }
         m_constructAABBPass.ConstructAABB(
             pCommandList,
             sceneType,
-            pDesc->DestAccelerationStructureData,
-            buffers.calculateAABBScratchBuffer,
-            buffers.nodeCountBuffer,
-            buffers.hierarchyBuffer,
-            buffers.outputAABBParentBuffer,
             globalDescriptorHeap,
-            updatesAllowed && !performUpdate,
-            performUpdate,
-            numElements);
+            (UINT)aabbBuilds.size(),
+            aabbBuilds.data());
     }
 
     void GpuBvh2Builder::LoadBVHElements(
         _In_ ID3D12GraphicsCommandList *pCommandList,
-        _In_  const D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC *pDesc,
         const SceneType sceneType,
-        const UINT numElements,
-        D3D12_GPU_VIRTUAL_ADDRESS elementBuffer,
-        D3D12_GPU_VIRTUAL_ADDRESS metadataBuffer,
-        D3D12_GPU_VIRTUAL_ADDRESS indexBuffer,
-        D3D12_GPU_VIRTUAL_ADDRESS sceneAABBScratchMemory,
-        D3D12_GPU_VIRTUAL_ADDRESS sceneAABB,
+        const std::vector<BVHBuild> &builds,
         D3D12_GPU_DESCRIPTOR_HANDLE globalDescriptorHeap)
     {
         switch(sceneType) 
@@ -222,107 +326,106 @@ namespace FallbackLayer
             // Note that the load instances pass does load metadata even though it doesn't take a metadata
             // buffer address. Users don't specify BVH instance metadata, so the shader takes care of
             // putting the metadata where it needs to go on its own.
-            m_loadInstancesPass.LoadInstances(
-                pCommandList, 
-                elementBuffer, 
-                pDesc->Inputs.InstanceDescs, 
-                pDesc->Inputs.DescsLayout,
-                numElements, 
-                globalDescriptorHeap,
-                indexBuffer);
+            for (const BVHBuild &build : builds)
+            {
+                m_loadInstancesPass.LoadInstances(
+                    pCommandList, 
+                    build.performUpdate ? build.buffers.outputElementBuffer : build.buffers.scratchElementBuffer, // If we're updating, write straight to output.
+                    build.pDesc->Inputs.InstanceDescs, 
+                    build.pDesc->Inputs.DescsLayout,
+                    build.numElements, 
+                    globalDescriptorHeap,
+                    build.performUpdate ? build.buffers.outputSortCacheBuffer : 0);
+            }
             break;
             case SceneType::Triangles:
-            // Load all the triangles into the bottom-level acceleration structure. This loading is done 
-            // one VB/IB pair at a time since each VB will have unique characteristics (topology type/IB format)
-            // and will generally have enough verticies to go completely wide
-            m_loadPrimitivesPass.LoadPrimitives(
-                pCommandList, 
-                pDesc->Inputs, 
-                numElements, 
-                elementBuffer,
-                metadataBuffer,
-                indexBuffer);
+            {
+                // Load all the triangles into the bottom-level acceleration structure. This loading is done 
+                // one VB/IB pair at a time since each VB will have unique characteristics (topology type/IB format)
+                // and will generally have enough verticies to go completely wide
+                std::vector<LoadPrimitivesPass::BatchedBuild> loadBuilds;
+                for (const BVHBuild &build : builds)
+                {
+                    loadBuilds.push_back({
+                        &build.pDesc->Inputs,
+                        build.numElements,
+                        build.performUpdate ? build.buffers.outputElementBuffer   : build.buffers.scratchElementBuffer, // If we're updating, write straight to output.
+                        build.performUpdate ? build.buffers.outputMetadataBuffer  : build.buffers.scratchMetadataBuffer,
+                        build.performUpdate ? build.buffers.outputSortCacheBuffer : 0 });
+                }
+                m_loadPrimitivesPass.LoadPrimitives(pCommandList, (UINT)loadBuilds.size(), loadBuilds.data());
+            }
             break;
         }
-
-        m_sceneAABBCalculator.CalculateSceneAABB(
-            pCommandList, 
-            sceneType, 
-            elementBuffer, 
-            numElements, 
-            sceneAABBScratchMemory, 
-            sceneAABB);
     }
 
     void GpuBvh2Builder::BuildBVHHierarchy(
         _In_ ID3D12GraphicsCommandList *pCommandList,
-        _In_  const D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC *pDesc,
         const SceneType sceneType,
-        const uint numElements,
-        D3D12_GPU_VIRTUAL_ADDRESS scratchElementBuffer,
-        D3D12_GPU_VIRTUAL_ADDRESS outputElementBuffer,
-        D3D12_GPU_VIRTUAL_ADDRESS scratchMetadataBuffer,
-        D3D12_GPU_VIRTUAL_ADDRESS outputMetadataBuffer,
-        D3D12_GPU_VIRTUAL_ADDRESS sceneAABBScratchMemory,
-        D3D12_GPU_VIRTUAL_ADDRESS sceneAABB,
-        D3D12_GPU_VIRTUAL_ADDRESS mortonCodeBuffer,
-        D3D12_GPU_VIRTUAL_ADDRESS indexBuffer,
-        D3D12_GPU_VIRTUAL_ADDRESS outputSortCacheBuffer,
-        D3D12_GPU_VIRTUAL_ADDRESS hierarchyBuffer,
-        D3D12_GPU_VIRTUAL_ADDRESS nodeCountBuffer,
-        D3D12_GPU_VIRTUAL_ADDRESS baseTreeletsCountBuffer,
-        D3D12_GPU_VIRTUAL_ADDRESS baseTreeletsIndexBuffer,
+        const std::vector<BVHBuild> &builds,
         D3D12_GPU_DESCRIPTOR_HANDLE globalDescriptorHeap) 
     {
-        m_mortonCodeCalculator.CalculateMortonCodes(
-            pCommandList, 
-            sceneType, 
-            scratchElementBuffer, 
-            numElements, 
-            sceneAABB, 
-            indexBuffer, 
-            mortonCodeBuffer);
-
-        m_sorterPass.Sort(
-            pCommandList, 
-            mortonCodeBuffer, 
-            indexBuffer, 
-            numElements, 
-            false, 
-            true);
-
-        m_rearrangePass.Rearrange(
-            pCommandList,
-            sceneType,
-            numElements,
-            scratchElementBuffer,
-            scratchMetadataBuffer,
-            indexBuffer,
-            outputElementBuffer,
-            outputMetadataBuffer,
-            outputSortCacheBuffer);
-
-        m_constructHierarchyPass.ConstructHierarchy(
-            pCommandList,
-            sceneType,
-            mortonCodeBuffer,
-            hierarchyBuffer,
-            globalDescriptorHeap,
-            numElements);
+        if (builds.empty()) return;
+
+        const UINT numBuilds = (UINT)builds.size();
+        std::vector<SceneAABBCalculator::BatchedBuild> sceneAABBBuilds;
+        std::vector<MortonCodesCalculator::BatchedBuild> mortonCodeBuilds;
+        std::vector<BitonicSort::SortList> sortLists;
+        std::vector<RearrangeElementsPass::BatchedBuild> rearrangeBuilds;
+        std::vector<ConstructHierarchyPass::BatchedBuild> hierarchyBuilds;
+        std::vector<PLOCHierarchyPass::BatchedBuild> plocHierarchyBuilds;
+        std::vector<TreeletReorder::BatchedBuild> treeletReorderBuilds;
+        const Level level = (sceneType == SceneType::Triangles) ? Level::Bottom : Level::Top;
+        for (const BVHBuild &build : builds)
+        {
+            const GpuBVHBuffers &buffers = build.buffers;
+            sceneAABBBuilds.push_back({ buffers.scratchElementBuffer, build.numElements, buffers.sceneAABBScratchMemory, buffers.sceneAABB });
+            const bool uses64BitMortonCodes = Uses64BitMortonCodes(build.pDesc->Inputs.Flags);
+            mortonCodeBuilds.push_back({ buffers.scratchElementBuffer, build.numElements, buffers.sceneAABB, buffers.indexBuffer, buffers.mortonCodeBuffer, uses64BitMortonCodes });
+            sortLists.push_back({ buffers.mortonCodeBuffer, buffers.indexBuffer, build.numElements, uses64BitMortonCodes });
+            rearrangeBuilds.push_back({
+                build.numElements,
+                buffers.scratchElementBuffer,
+                buffers.scratchMetadataBuffer,
+                buffers.indexBuffer,
+                buffers.outputElementBuffer,
+                buffers.outputMetadataBuffer,
+                build.updatesAllowed ? buffers.outputSortCacheBuffer : 0 });
+            if (UsesPLOCHierarchy(level, build.pDesc->Inputs.Flags) && build.numElements > 1)
+            {
+                plocHierarchyBuilds.push_back({ build.numElements, buffers.outputElementBuffer, buffers.hierarchyBuffer, buffers.plocScratchBuffer });
+            }
+            else
+            {
+                hierarchyBuilds.push_back({ buffers.mortonCodeBuffer, buffers.hierarchyBuffer, build.numElements, uses64BitMortonCodes });
+            }
+            treeletReorderBuilds.push_back({
+                build.numElements,
+                buffers.hierarchyBuffer,
+                buffers.nodeCountBuffer,
+                buffers.sceneAABBScratchMemory,
+                buffers.outputElementBuffer,
+                buffers.baseTreeletsCountBuffer,
+                buffers.baseTreeletsIndexBuffer,
+                build.pDesc->Inputs.Flags });
+        }
+
+        m_sceneAABBCalculator.CalculateSceneAABB(pCommandList, sceneType, numBuilds, sceneAABBBuilds.data());
+
+        m_mortonCodeCalculator.CalculateMortonCodes(pCommandList, sceneType, numBuilds, mortonCodeBuilds.data());
+
+        m_sorterPass.Sort(pCommandList, numBuilds, sortLists.data(), false, true);
+
+        m_rearrangePass.Rearrange(pCommandList, sceneType, numBuilds, rearrangeBuilds.data());
+
+        m_constructHierarchyPass.ConstructHierarchy(pCommandList, sceneType, globalDescriptorHeap, (UINT)hierarchyBuilds.size(), hierarchyBuilds.data());
+
+        m_plocHierarchyPass.ConstructHierarchy(pCommandList, (UINT)plocHierarchyBuilds.size(), plocHierarchyBuilds.data());
 
         if (sceneType == SceneType::Triangles) 
         {
 #if ENABLE_TREELET_REORDERING
-            m_treeletReorder.Optimize(
-                pCommandList,
-                numElements,
-                hierarchyBuffer,                
-                nodeCountBuffer,
-                sceneAABBScratchMemory,
-                outputElementBuffer,
-                baseTreeletsCountBuffer,
-                baseTreeletsIndexBuffer,
-                pDesc->Inputs.Flags);
+            m_treeletReorder.Optimize(pCommandList, numBuilds, treeletReorderBuilds.data());
 #endif
         }
     }
@@ -346,7 +449,7 @@ namespace FallbackLayer
         }
     }
 
-    GpuBvh2Builder::ScratchMemoryPartitions GpuBvh2Builder::CalculateScratchMemoryUsage(Level level, UINT numPrimitives)
+    GpuBvh2Builder::ScratchMemoryPartitions GpuBvh2Builder::CalculateScratchMemoryUsage(Level level, UINT numPrimitives, D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAGS buildFlags)
     {
 #define ALIGN(alignment, num) (((num + alignment - 1) / alignment) * alignment)
 #define ALIGN_GPU_VA_OFFSET(num) ALIGN(4, num)
@@ -365,11 +468,12 @@ namespace FallbackLayer
         scratchMemoryPartitions.OffsetToElements = totalSize;
         totalSize += ALIGN_GPU_VA_OFFSET(sizePerElement * numPrimitives);
 
-        const UINT mortonCodeBufferSize = ALIGN_GPU_VA_OFFSET(sizeof(UINT) * numPrimitives);
+        const UINT mortonCodeSize = Uses64BitMortonCodes(buildFlags) ? sizeof(UINT64) : sizeof(UINT);
+        const UINT mortonCodeBufferSize = ALIGN_GPU_VA_OFFSET(mortonCodeSize * numPrimitives);
         scratchMemoryPartitions.OffsetToMortonCodes = totalSize;
 
         const UINT indexBufferSize = ALIGN_GPU_VA_OFFSET(sizeof(UINT) * numPrimitives);
-        scratchMemoryPartitions.OffsetToIndexBuffer = scratchMemoryPartitions.OffsetToMortonCodes + indexBufferSize;
+        scratchMemoryPartitions.OffsetToIndexBuffer = scratchMemoryPartitions.OffsetToMortonCodes + mortonCodeBufferSize;
 
         {
             // The scratch buffer used for calculating AABBs can alias over the MortonCode/IndexBuffer
@@ -385,14 +489,23 @@ namespace FallbackLayer
         }
 
         {
-            UINT64 sizeNeededForAABBCalculation = 0;
-            scratchMemoryPartitions.OffsetToCalculateAABBDispatchArgs = sizeNeededForAABBCalculation;
-            sizeNeededForAABBCalculation += ALIGN_GPU_VA_OFFSET(sizeof(UINT) * numPrimitives);
+            // AABBs are fit last so their scratch can alias over everything before the hierarchy,
+            // laid out the same as a refit's
+            ScratchMemoryPartitions aabbCalculationPartitions = CalculateUpdateScratchMemoryUsage(numPrimitives);
+            scratchMemoryPartitions.OffsetToCalculateAABBDispatchArgs = aabbCalculationPartitions.OffsetToCalculateAABBDispatchArgs;
+            scratchMemoryPartitions.OffsetToPerNodeCounter = aabbCalculationPartitions.OffsetToPerNodeCounter;
 
-            scratchMemoryPartitions.OffsetToPerNodeCounter = sizeNeededForAABBCalculation;
-            sizeNeededForAABBCalculation += ALIGN_GPU_VA_OFFSET(sizeof(UINT) * (numInternalNodes));
+            totalSize = std::max(aabbCalculationPartitions.TotalSize, totalSize);
+        }
+
+        if (UsesPLOCHierarchy(level, buildFlags))
+        {
+            // Clustering starts once the elements have been rearranged into the output, so its
+            // scratch can alias over everything from the scratch elements up to the hierarchy
+            scratchMemoryPartitions.OffsetToPLOCScratchMemory = scratchMemoryPartitions.OffsetToElements;
+            UINT64 plocScratchSize = ALIGN_GPU_VA_OFFSET(PLOCHierarchyPass::RequiredScratchSize(numPrimitives));
 
-            totalSize = std::max(sizeNeededForAABBCalculation, totalSize);
+            totalSize = std::max(scratchMemoryPartitions.OffsetToPLOCScratchMemory + plocScratchSize, totalSize);
         }
 
         const UINT64 hierarchySize = ALIGN_GPU_VA_OFFSET(sizeof(HierarchyNode) * totalNumNodes);
@@ -409,6 +522,20 @@ namespace FallbackLayer
         return scratchMemoryPartitions;
     }
 
+    GpuBvh2Builder::ScratchMemoryPartitions GpuBvh2Builder::CalculateUpdateScratchMemoryUsage(UINT numPrimitives)
+    {
+        ScratchMemoryPartitions scratchMemoryPartitions = {};
+        UINT64 &totalSize = scratchMemoryPartitions.TotalSize;
+
+        scratchMemoryPartitions.OffsetToCalculateAABBDispatchArgs = totalSize;
+        totalSize += ALIGN_GPU_VA_OFFSET(sizeof(UINT) * numPrimitives);
+
+        scratchMemoryPartitions.OffsetToPerNodeCounter = totalSize;
+        totalSize += ALIGN_GPU_VA_OFFSET(sizeof(UINT) * GetNumberOfInternalNodes(numPrimitives));
+
+        return scratchMemoryPartitions;
+    }
+
     void GpuBvh2Builder::GetRaytracingAccelerationStructurePrebuildInfo(
         _In_  const D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS *pDesc,
         _Out_  D3D12_RAYTRACING_ACCELERATION_STRUCTURE_PREBUILD_INFO *pInfo)
@@ -428,7 +555,7 @@ namespace FallbackLayer
             numLeaves = GetTotalPrimitiveCount(*pDesc);
             totalNumNodes = numLeaves + GetNumberOfInternalNodes(numLeaves);
 
-            pInfo->ResultDataMaxSizeInBytes = sizeof(BVHOffsets) + totalNumNodes * sizeof(AABBNode) + numLeaves * (sizeof(Primitive) + sizeof(PrimitiveMetaData));
+            pInfo->ResultDataMaxSizeInBytes = sizeof(BVHOffsets) + totalNumNodes * sizeof(AABBNode) + numLeaves * (sizeof(Primitive) + sizeof(PrimitiveMetaData)) + GetSizeOfWideNodes(numLeaves);
         }
         break;
         case D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL:
@@ -437,7 +564,7 @@ namespace FallbackLayer
             numLeaves = NumElements;
             totalNumNodes = numLeaves + GetNumberOfInternalNodes(numLeaves);
 
-            pInfo->ResultDataMaxSizeInBytes = sizeof(BVHOffsets) + sizeof(AABBNode) * totalNumNodes + sizeof(BVHMetadata) * numLeaves;
+            pInfo->ResultDataMaxSizeInBytes = sizeof(BVHOffsets) + sizeof(AABBNode) * totalNumNodes + sizeof(BVHMetadata) * numLeaves + GetSizeOfWideNodes(numLeaves);
         }
         break;
         default:
@@ -450,8 +577,18 @@ namespace FallbackLayer
             pInfo->ResultDataMaxSizeInBytes += totalNumNodes * sizeof(UINT); // Parent indices for nodes in hierarchy
         }
 
-        pInfo->ScratchDataSizeInBytes = CalculateScratchMemoryUsage(level, numLeaves).TotalSize;
-        pInfo->UpdateScratchDataSizeInBytes = 0;
+        pInfo->ScratchDataSizeInBytes = CalculateScratchMemoryUsage(level, numLeaves, pDesc->Flags).TotalSize;
+        if (updatesAllowed(pDesc->Flags))
+        {
+            // A top-level update rebuilds once refits have degraded the hierarchy too far
+            pInfo->UpdateScratchDataSizeInBytes = level == Level::Top ?
+                pInfo->ScratchDataSizeInBytes :
+                CalculateUpdateScratchMemoryUsage(numLeaves).TotalSize;
+        }
+        else
+        {
+            pInfo->UpdateScratchDataSizeInBytes = 0;
+        }
     }
 
     void GpuBvh2Builder::EmitRaytracingAccelerationStructurePostbuildInfo(
@@ -471,4 +608,17 @@ namespace FallbackLayer
     {
         return level == Level::Bottom;
     }
+
+    bool GpuBvh2Builder::UsesPLOCHierarchy(Level level, D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAGS buildFlags)
+    {
+        // Build speed wins out when both are asked for, the same as for treelet reordering
+        bool bPrioritizeTrace = buildFlags & D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_TRACE;
+        bool bPrioritizeBuild = buildFlags & D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_BUILD;
+        return level == Level::Bottom && bPrioritizeTrace && !bPrioritizeBuild;
+    }
+
+    bool GpuBvh2Builder::Uses64BitMortonCodes(D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAGS buildFlags)
+    {
+        return !(buildFlags & D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_BUILD);
+    }
 }
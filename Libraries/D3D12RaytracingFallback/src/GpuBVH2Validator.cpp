@@ -0,0 +1,181 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+#include "pch.h"
+#include "CompiledShaders/ValidateBVHNodes.h"
+#include "CompiledShaders/ValidateBVHReferences.h"
+
+namespace FallbackLayer
+{
+    GpuBvh2Validator::GpuBvh2Validator(ID3D12Device *pDevice, UINT nodeMask) :
+        m_pDevice(pDevice),
+        m_nodeMask(nodeMask),
+        m_referenceCountsCapacity(0),
+        m_nextReadbackBuffer(0),
+        m_errorsReadBack(0)
+    {
+        CD3DX12_ROOT_PARAMETER1 rootParameters[NumParameters];
+        rootParameters[BVHParam].InitAsUnorderedAccessView(BVHToValidateRegister);
+        rootParameters[ReferenceCountsParam].InitAsUnorderedAccessView(ReferenceCountsRegister);
+        rootParameters[ErrorLogParam].InitAsUnorderedAccessView(ValidationErrorLogRegister);
+        rootParameters[InputRootConstants].InitAsConstants(SizeOfInUint32(ValidateBVHInputConstants), ValidateBVHConstantsRegister);
+
+        auto rootSignatureDesc = CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC(ARRAYSIZE(rootParameters), rootParameters);
+        CreateRootSignatureHelper(pDevice, rootSignatureDesc, &m_pRootSignature);
+
+        CreatePSOHelper(pDevice, nodeMask, m_pRootSignature, COMPILED_SHADER(g_pValidateBVHNodes), &m_pValidateNodesPSO);
+        CreatePSOHelper(pDevice, nodeMask, m_pRootSignature, COMPILED_SHADER(g_pValidateBVHReferences), &m_pValidateReferencesPSO);
+
+        const D3D12_HEAP_PROPERTIES defaultHeapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT, nodeMask, nodeMask);
+        const D3D12_RESOURCE_DESC errorLogDesc = CD3DX12_RESOURCE_DESC::Buffer(SizeOfBVHValidationLog, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+        ThrowInternalFailure(pDevice->CreateCommittedResource(&defaultHeapProperties, D3D12_HEAP_FLAG_NONE, &errorLogDesc, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, nullptr, IID_PPV_ARGS(&m_pErrorLog)));
+
+        const D3D12_HEAP_PROPERTIES readbackHeapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_READBACK, nodeMask, nodeMask);
+        const D3D12_RESOURCE_DESC readbackBufferDesc = CD3DX12_RESOURCE_DESC::Buffer(SizeOfBVHValidationLog);
+        for (UINT i = 0; i < NumReadbackBuffers; i++)
+        {
+            ThrowInternalFailure(pDevice->CreateCommittedResource(&readbackHeapProperties, D3D12_HEAP_FLAG_NONE, &readbackBufferDesc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&m_pReadbackBuffers[i])));
+        }
+    }
+
+    void GpuBvh2Validator::Validate(
+        ID3D12GraphicsCommandList *pCommandList,
+        D3D12_GPU_VIRTUAL_ADDRESS bvh,
+        UINT numElements,
+        bool isBottomLevel)
+    {
+        if (numElements == 0) return;
+
+        // A count for every node's parents, then for every leaf index
+        const UINT numNodes = numElements + GetNumberOfInternalNodes(numElements);
+        const UINT numReferenceCounts = numNodes + numElements;
+        if (numReferenceCounts > m_referenceCountsCapacity)
+        {
+            if (m_pReferenceCounts)
+            {
+                m_retiredReferenceCounts.push_back(m_pReferenceCounts);
+                m_pReferenceCounts = nullptr;
+            }
+
+            m_referenceCountsCapacity = AlignPowerOfTwo(numReferenceCounts);
+            const D3D12_HEAP_PROPERTIES defaultHeapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT, m_nodeMask, m_nodeMask);
+            const D3D12_RESOURCE_DESC referenceCountsDesc = CD3DX12_RESOURCE_DESC::Buffer(sizeof(UINT) * m_referenceCountsCapacity, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+            ThrowInternalFailure(m_pDevice->CreateCommittedResource(&defaultHeapProperties, D3D12_HEAP_FLAG_NONE, &referenceCountsDesc, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, nullptr, IID_PPV_ARGS(&m_pReferenceCounts)));
+        }
+
+        ValidateBVHInputConstants constants = {};
+        constants.NumberOfElements = numElements;
+        constants.IsBottomLevel = isBottomLevel;
+        constants.BVHAddressLow = (UINT)bvh;
+        constants.BVHAddressHigh = (UINT)(bvh >> 32);
+
+        pCommandList->SetComputeRootSignature(m_pRootSignature);
+        pCommandList->SetComputeRoot32BitConstants(InputRootConstants, SizeOfInUint32(ValidateBVHInputConstants), &constants, 0);
+        pCommandList->SetComputeRootUnorderedAccessView(BVHParam, bvh);
+        pCommandList->SetComputeRootUnorderedAccessView(ReferenceCountsParam, m_pReferenceCounts->GetGPUVirtualAddress());
+        pCommandList->SetComputeRootUnorderedAccessView(ErrorLogParam, m_pErrorLog->GetGPUVirtualAddress());
+
+        pCommandList->SetPipelineState(m_pValidateNodesPSO);
+        pCommandList->Dispatch(DivideAndRoundUp<UINT>(numNodes, THREAD_GROUP_1D_WIDTH), 1, 1);
+
+        auto uavBarrier = CD3DX12_RESOURCE_BARRIER::UAV(nullptr);
+        pCommandList->ResourceBarrier(1, &uavBarrier);
+
+        pCommandList->SetPipelineState(m_pValidateReferencesPSO);
+        pCommandList->Dispatch(DivideAndRoundUp<UINT>(numReferenceCounts, THREAD_GROUP_1D_WIDTH), 1, 1);
+
+        D3D12_RESOURCE_BARRIER toCopySourceBarriers[] = {
+            CD3DX12_RESOURCE_BARRIER::UAV(nullptr),
+            CD3DX12_RESOURCE_BARRIER::Transition(m_pErrorLog, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_SOURCE)
+        };
+        pCommandList->ResourceBarrier(ARRAYSIZE(toCopySourceBarriers), toCopySourceBarriers);
+
+        pCommandList->CopyBufferRegion(m_pReadbackBuffers[m_nextReadbackBuffer], 0, m_pErrorLog, 0, SizeOfBVHValidationLog);
+        m_nextReadbackBuffer = (m_nextReadbackBuffer + 1) % NumReadbackBuffers;
+
+        auto toUAVBarrier = CD3DX12_RESOURCE_BARRIER::Transition(m_pErrorLog, D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+        pCommandList->ResourceBarrier(1, &toUAVBarrier);
+    }
+
+    UINT GpuBvh2Validator::ReadBackErrors(std::vector<BVHValidationError> &errors)
+    {
+        // The log only grows, so the copy with the most validations in it is the latest
+        const CD3DX12_RANGE readRange(0, SizeOfBVHValidationLog);
+        const CD3DX12_RANGE noWriteRange(0, 0);
+        BYTE *pLatestLog = nullptr;
+        UINT latestValidationCount = 0;
+        std::vector<BYTE *> mappedLogs(NumReadbackBuffers);
+        for (UINT i = 0; i < NumReadbackBuffers; i++)
+        {
+            ThrowInternalFailure(m_pReadbackBuffers[i]->Map(0, &readRange, (void **)&mappedLogs[i]));
+            const UINT validationCount = *(UINT *)(mappedLogs[i] + OffsetToValidationCount);
+            if (!pLatestLog || validationCount > latestValidationCount)
+            {
+                pLatestLog = mappedLogs[i];
+                latestValidationCount = validationCount;
+            }
+        }
+
+        const UINT errorCount = *(UINT *)(pLatestLog + OffsetToErrorCount);
+        const BVHValidationError *pErrors = (const BVHValidationError *)(pLatestLog + OffsetToErrors);
+        for (UINT errorIndex = m_errorsReadBack; errorIndex < std::min<UINT>(errorCount, MaxBVHValidationErrors); errorIndex++)
+        {
+            errors.push_back(pErrors[errorIndex]);
+        }
+        m_errorsReadBack = std::max(m_errorsReadBack, errorCount);
+
+        for (UINT i = 0; i < NumReadbackBuffers; i++)
+        {
+            m_pReadbackBuffers[i]->Unmap(0, &noWriteRange);
+        }
+        return latestValidationCount;
+    }
+
+    void GpuBvh2Validator::ReportErrors()
+    {
+        const UINT errorsAlreadyReported = m_errorsReadBack;
+        std::vector<BVHValidationError> errors;
+        ReadBackErrors(errors);
+
+        for (const BVHValidationError &error : errors)
+        {
+            std::wstringstream message;
+            message << L"D3D12 Raytracing Fallback: Acceleration structure at 0x" << std::hex << error.BVHAddress << std::dec << L" failed validation: ";
+            switch (error.Type)
+            {
+            case BVHValidationInvalidChildIndex:
+                message << L"node " << error.NodeIndex << L" has an invalid child index " << error.Value;
+                break;
+            case BVHValidationChildNotContained:
+                message << L"child " << error.Value << L" is not contained by node " << error.NodeIndex;
+                break;
+            case BVHValidationInvalidParentCount:
+                message << L"node " << error.NodeIndex << L" is referenced by " << error.Value << L" parents";
+                break;
+            case BVHValidationInvalidLeafIndex:
+                message << L"leaf node " << error.NodeIndex << L" has an invalid leaf index " << error.Value;
+                break;
+            case BVHValidationPrimitiveNotContained:
+                message << L"primitive " << error.Value << L" is not contained by leaf node " << error.NodeIndex;
+                break;
+            case BVHValidationInvalidLeafCount:
+                message << L"leaf index " << error.NodeIndex << L" is used by " << error.Value << L" leaves";
+                break;
+            }
+            message << L"\n";
+            OutputDebugStringW(message.str().c_str());
+        }
+
+        if (errorsAlreadyReported <= MaxBVHValidationErrors && m_errorsReadBack > MaxBVHValidationErrors)
+        {
+            OutputDebugStringW(L"D3D12 Raytracing Fallback: Acceleration structure validation log is full, further errors are not reported\n");
+        }
+    }
+}
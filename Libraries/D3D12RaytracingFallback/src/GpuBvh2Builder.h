@@ -24,6 +24,13 @@ namespace FallbackLayer
             _In_ ID3D12DescriptorHeap *pCbvSrvUavDescriptorHeap
         );
 
+        virtual void BuildRaytracingAccelerationStructures(
+            _In_  ID3D12GraphicsCommandList *pCommandList,
+            _In_  UINT NumDescs,
+            _In_reads_(NumDescs)  const D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC *pDescs,
+            _In_ ID3D12DescriptorHeap *pCbvSrvUavDescriptorHeap
+        );
+
         virtual void CopyRaytracingAccelerationStructure(
             _In_  ID3D12GraphicsCommandList *pCommandList,
             _In_  D3D12_GPU_VIRTUAL_ADDRESS DestAccelerationStructureData,
@@ -59,13 +66,15 @@ namespace FallbackLayer
             UINT64 OffsetToBaseTreeletsCount;
 
             UINT64 OffsetToSceneAABBScratchMemory;
+            UINT64 OffsetToPLOCScratchMemory;
 
             UINT64 OffsetToCalculateAABBDispatchArgs;
             UINT64 OffsetToPerNodeCounter;
             UINT64 TotalSize;
         };
 
-        ScratchMemoryPartitions CalculateScratchMemoryUsage(Level level, UINT numTriangles);
+        ScratchMemoryPartitions CalculateScratchMemoryUsage(Level level, UINT numTriangles, D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAGS buildFlags);
+        ScratchMemoryPartitions CalculateUpdateScratchMemoryUsage(UINT numTriangles);
 
         SceneAABBCalculator m_sceneAABBCalculator;
         MortonCodesCalculator m_mortonCodeCalculator;
@@ -75,11 +84,24 @@ namespace FallbackLayer
         LoadPrimitivesPass m_loadPrimitivesPass;
         ConstructAABBPass m_constructAABBPass;
         ConstructHierarchyPass m_constructHierarchyPass;
+        PLOCHierarchyPass m_plocHierarchyPass;
         TreeletReorder m_treeletReorder;
+        TopLevelUpdatePass m_topLevelUpdatePass;
 
         PostBuildInfoQuery m_postBuildInfoQuery;
         GpuBvh2Copy m_copyPass;
 
+#if ENABLE_GPU_ACCELERATION_STRUCTURE_VALIDATION
+        GpuBvh2Validator m_validator;
+
+        // Reports what earlier validations found, then validates the new builds
+        void GpuBvh2Builder::ValidateBVHs(
+            _In_  ID3D12GraphicsCommandList *pCommandList,
+            UINT numDescs,
+            _In_reads_(numDescs)  const D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC *pDescs
+        );
+#endif
+
         struct GpuBVHBuffers {
             D3D12_GPU_VIRTUAL_ADDRESS scratchElementBuffer;
             D3D12_GPU_VIRTUAL_ADDRESS outputElementBuffer;
@@ -94,6 +116,7 @@ namespace FallbackLayer
             D3D12_GPU_VIRTUAL_ADDRESS nodeCountBuffer;
             D3D12_GPU_VIRTUAL_ADDRESS baseTreeletsCountBuffer;
             D3D12_GPU_VIRTUAL_ADDRESS baseTreeletsIndexBuffer;
+            D3D12_GPU_VIRTUAL_ADDRESS plocScratchBuffer;
             D3D12_GPU_VIRTUAL_ADDRESS calculateAABBScratchBuffer;
             D3D12_GPU_VIRTUAL_ADDRESS outputAABBParentBuffer;
         };
@@ -104,61 +127,72 @@ namespace FallbackLayer
             UINT numElements,
             GpuBVHBuffers &buffers
         );
-        
-        void BuildTopLevelBVH(
-            _In_  ID3D12GraphicsCommandList *pCommandList,
-            _In_  const D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC *pDesc,
-            _In_ ID3D12DescriptorHeap *pCbvSrvUavDescriptorHeap
-        );
 
-        void BuildBottomLevelBVH(
-            _In_  ID3D12GraphicsCommandList *pCommandList,
-            _In_  const D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC *pDesc
+        void GpuBvh2Builder::LoadGpuBVHScratchBuffers(
+            Level bvhLevel,
+            UINT numElements,
+            D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAGS buildFlags,
+            D3D12_GPU_VIRTUAL_ADDRESS scratchGpuVA,
+            GpuBVHBuffers &buffers
         );
+        
+        struct BVHBuild {
+            const D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC *pDesc;
+            UINT numElements;
+            bool updatesAllowed;
+            bool performUpdate;
+            GpuBVHBuffers buffers;
+        };
 
-        void GpuBvh2Builder::BuildBVH(
+        void GpuBvh2Builder::BuildBVHs(
             _In_  ID3D12GraphicsCommandList *pCommandList,
-            _In_  const D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC *pDesc,
+            UINT numDescs,
+            _In_reads_(numDescs)  const D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC *pDescs,
             Level bvhLevel,
             SceneType sceneType,
-            UINT numElements,
             D3D12_GPU_DESCRIPTOR_HANDLE globalDescriptorHeap
         );
 
+        // Loads, builds and fits the builds together, each stage behind a single barrier
+        void GpuBvh2Builder::BuildBVHBatch(
+            _In_ ID3D12GraphicsCommandList *pCommandList,
+            const SceneType sceneType,
+            const std::vector<BVHBuild> &builds,
+            D3D12_GPU_DESCRIPTOR_HANDLE globalDescriptorHeap
+        );
+
+        // Records both a refit and a rebuild of the top level, and lets the GPU run the one
+        // the SAH cost of the hierarchy calls for
+        void GpuBvh2Builder::UpdateTopLevelBVH(
+            _In_ ID3D12GraphicsCommandList *pCommandList,
+            const BVHBuild &build,
+            D3D12_GPU_DESCRIPTOR_HANDLE globalDescriptorHeap
+        );
+
+        // How much a refit may raise the SAH cost of a top level over its last rebuild
+        static constexpr float TopLevelRebuildCostRatio = 1.5f;
+
         void GpuBvh2Builder::LoadBVHElements(
             _In_ ID3D12GraphicsCommandList *pCommandList,
-            _In_  const D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC *pDesc,
             const SceneType sceneType,
-            const uint totalElements,
-            D3D12_GPU_VIRTUAL_ADDRESS elementBuffer,
-            D3D12_GPU_VIRTUAL_ADDRESS metadataBuffer,
-            D3D12_GPU_VIRTUAL_ADDRESS indexBuffer,
-            D3D12_GPU_VIRTUAL_ADDRESS sceneAABBScratchMemory,
-            D3D12_GPU_VIRTUAL_ADDRESS sceneAABB,
+            const std::vector<BVHBuild> &builds,
             D3D12_GPU_DESCRIPTOR_HANDLE globalDescriptorHeap
         );
 
         void GpuBvh2Builder::BuildBVHHierarchy(
             _In_ ID3D12GraphicsCommandList *pCommandList,
-            _In_  const D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC *pDesc,
             const SceneType sceneType,
-            const uint numElements,
-            D3D12_GPU_VIRTUAL_ADDRESS scratchElementBuffer,
-            D3D12_GPU_VIRTUAL_ADDRESS outputElementBuffer,
-            D3D12_GPU_VIRTUAL_ADDRESS scratchMetadataBuffer,
-            D3D12_GPU_VIRTUAL_ADDRESS outputMetadataBuffer,
-            D3D12_GPU_VIRTUAL_ADDRESS sceneAABBScratchMemory,
-            D3D12_GPU_VIRTUAL_ADDRESS sceneAABB,
-            D3D12_GPU_VIRTUAL_ADDRESS mortonCodeBuffer,
-            D3D12_GPU_VIRTUAL_ADDRESS indexBuffer,
-            D3D12_GPU_VIRTUAL_ADDRESS outputSortCacheBuffer,
-            D3D12_GPU_VIRTUAL_ADDRESS hierarchyBuffer,
-            D3D12_GPU_VIRTUAL_ADDRESS nodeCountBuffer,
-            D3D12_GPU_VIRTUAL_ADDRESS baseTreeletsCountBuffer,
-            D3D12_GPU_VIRTUAL_ADDRESS baseTreeletsIndexBuffer,
+            const std::vector<BVHBuild> &builds,
             D3D12_GPU_DESCRIPTOR_HANDLE globalDescriptorHeap
         );
 
         bool GpuBvh2Builder::SupportsTreeletReordering(Level level);
+
+        // Fast-trace bottom levels cluster their hierarchy instead of splitting it on the Morton codes
+        bool GpuBvh2Builder::UsesPLOCHierarchy(Level level, D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAGS buildFlags);
+
+        // Fast-build scenes keep 30-bit codes, which halve the bandwidth of the sort. Everything else
+        // sorts 60-bit codes so large scenes with dense detail don't collapse into shared codes.
+        bool GpuBvh2Builder::Uses64BitMortonCodes(D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAGS buildFlags);
     };
 }
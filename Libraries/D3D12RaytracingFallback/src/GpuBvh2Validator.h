@@ -0,0 +1,65 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+#pragma once
+namespace FallbackLayer
+{
+    // Checks acceleration structures on the GPU: children are contained by their parents, every node
+    // but the root has one parent, and every element has one leaf. Errors go to a small log that is
+    // copied to a readback buffer after each validation, so reading them never waits on the GPU.
+    class GpuBvh2Validator
+    {
+    public:
+        GpuBvh2Validator(ID3D12Device *pDevice, UINT nodeMask);
+
+        void Validate(
+            ID3D12GraphicsCommandList *pCommandList,
+            D3D12_GPU_VIRTUAL_ADDRESS bvh,
+            UINT numElements,
+            bool isBottomLevel);
+
+        // Adds the errors read back since the last call, and returns how many validations the GPU
+        // had finished by the latest copy of the log. Copies the GPU is still making are read as is.
+        UINT ReadBackErrors(std::vector<BVHValidationError> &errors);
+
+        // Writes the errors read back since the last call to the debug output
+        void ReportErrors();
+
+    private:
+        enum RootParameterSlot
+        {
+            BVHParam = 0,
+            ReferenceCountsParam,
+            ErrorLogParam,
+            InputRootConstants,
+            NumParameters
+        };
+
+        static const UINT NumReadbackBuffers = 3;
+
+        ID3D12Device *m_pDevice;
+        UINT m_nodeMask;
+
+        CComPtr<ID3D12RootSignature> m_pRootSignature;
+        CComPtr<ID3D12PipelineState> m_pValidateNodesPSO;
+        CComPtr<ID3D12PipelineState> m_pValidateReferencesPSO;
+
+        // Each validation leaves the counts cleared for the next. Outgrown buffers may still be in
+        // use by the GPU, so they're kept until the validator goes away.
+        CComPtr<ID3D12Resource> m_pReferenceCounts;
+        UINT m_referenceCountsCapacity;
+        std::vector<CComPtr<ID3D12Resource>> m_retiredReferenceCounts;
+
+        CComPtr<ID3D12Resource> m_pErrorLog;
+        CComPtr<ID3D12Resource> m_pReadbackBuffers[NumReadbackBuffers];
+        UINT m_nextReadbackBuffer;
+        UINT m_errorsReadBack;
+    };
+}
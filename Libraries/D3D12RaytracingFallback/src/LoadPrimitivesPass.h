@@ -21,6 +21,20 @@ namespace FallbackLayer
             D3D12_GPU_VIRTUAL_ADDRESS outputTriangleBuffer,
             D3D12_GPU_VIRTUAL_ADDRESS outputMetadataBuffer,
             D3D12_GPU_VIRTUAL_ADDRESS cachedSortBuffer);
+
+        struct BatchedBuild
+        {
+            const D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS *pInputs;
+            UINT totalPrimitiveCount;
+            D3D12_GPU_VIRTUAL_ADDRESS outputTriangleBuffer;
+            D3D12_GPU_VIRTUAL_ADDRESS outputMetadataBuffer;
+            D3D12_GPU_VIRTUAL_ADDRESS cachedSortBuffer;
+        };
+
+        // Loads the geometry of every build behind a single barrier
+        void LoadPrimitives(ID3D12GraphicsCommandList *pCommandList,
+            UINT numBuilds,
+            const BatchedBuild *pBuilds);
     private:
         enum RootParameterSlot
         {
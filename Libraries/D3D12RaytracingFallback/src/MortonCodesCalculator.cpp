@@ -12,6 +12,8 @@
 #include "CalculateMortonCodesBindings.h"
 #include "CompiledShaders/CalculateMortonCodesForPrimitives.h"
 #include "CompiledShaders/CalculateMortonCodesForAABBs.h"
+#include "CompiledShaders/Calculate64BitMortonCodesForPrimitives.h"
+#include "CompiledShaders/Calculate64BitMortonCodesForAABBs.h"
 
 namespace FallbackLayer
 {
@@ -29,36 +31,62 @@ namespace FallbackLayer
 
         CreatePSOHelper(pDevice, nodeMask, m_pRootSignature, COMPILED_SHADER(g_pCalculateMortonCodesForPrimitives), &m_pCalcuateMortonCodesForPrimitivesPSO);
         CreatePSOHelper(pDevice, nodeMask, m_pRootSignature, COMPILED_SHADER(g_pCalculateMortonCodesForAABBs), &m_pCalcuateMortonCodesForAABBsPSO);
+        CreatePSOHelper(pDevice, nodeMask, m_pRootSignature, COMPILED_SHADER(g_pCalculate64BitMortonCodesForPrimitives), &m_pCalcuate64BitMortonCodesForPrimitivesPSO);
+        CreatePSOHelper(pDevice, nodeMask, m_pRootSignature, COMPILED_SHADER(g_pCalculate64BitMortonCodesForAABBs), &m_pCalcuate64BitMortonCodesForAABBsPSO);
     }
 
 
-    void MortonCodesCalculator::CalculateMortonCodes(ID3D12GraphicsCommandList *pCommandList, SceneType sceneType, D3D12_GPU_VIRTUAL_ADDRESS elementsBuffer, UINT numElements, D3D12_GPU_VIRTUAL_ADDRESS sceneAABB, D3D12_GPU_VIRTUAL_ADDRESS outputIndices, D3D12_GPU_VIRTUAL_ADDRESS outputMortonCodes)
+    void MortonCodesCalculator::CalculateMortonCodes(ID3D12GraphicsCommandList *pCommandList, SceneType sceneType, D3D12_GPU_VIRTUAL_ADDRESS elementsBuffer, UINT numElements, D3D12_GPU_VIRTUAL_ADDRESS sceneAABB, D3D12_GPU_VIRTUAL_ADDRESS outputIndices, D3D12_GPU_VIRTUAL_ADDRESS outputMortonCodes, bool uses64BitMortonCodes)
     {
-        if (numElements == 0) return;
+        BatchedBuild build = { elementsBuffer, numElements, sceneAABB, outputIndices, outputMortonCodes, uses64BitMortonCodes };
+        CalculateMortonCodes(pCommandList, sceneType, 1, &build);
+    }
 
-        pCommandList->SetComputeRootSignature(m_pRootSignature);
+    void MortonCodesCalculator::CalculateMortonCodes(ID3D12GraphicsCommandList *pCommandList, SceneType sceneType, UINT numBuilds, const BatchedBuild *pBuilds)
+    {
+        if (std::none_of(pBuilds, pBuilds + numBuilds, [](const BatchedBuild &build) { return build.numElements > 0; })) return;
+
+        ID3D12PipelineState *pPSO = nullptr;
+        ID3D12PipelineState *p64BitPSO = nullptr;
         switch (sceneType)
         {
         case SceneType::Triangles:
-            pCommandList->SetPipelineState(m_pCalcuateMortonCodesForPrimitivesPSO);
+            pPSO = m_pCalcuateMortonCodesForPrimitivesPSO;
+            p64BitPSO = m_pCalcuate64BitMortonCodesForPrimitivesPSO;
             break;
         case SceneType::BottomLevelBVHs:
-            pCommandList->SetPipelineState(m_pCalcuateMortonCodesForAABBsPSO);
+            pPSO = m_pCalcuateMortonCodesForAABBsPSO;
+            p64BitPSO = m_pCalcuate64BitMortonCodesForAABBsPSO;
             break;
         default:
             assert(false);
         }
 
-        MortonCodeCalculatorConstants constants{ numElements };
+        pCommandList->SetComputeRootSignature(m_pRootSignature);
+        ID3D12PipelineState *pBoundPSO = nullptr;
+        for (UINT buildIndex = 0; buildIndex < numBuilds; buildIndex++)
+        {
+            const BatchedBuild &build = pBuilds[buildIndex];
+            if (build.numElements == 0) continue;
+
+            ID3D12PipelineState *pBuildPSO = build.uses64BitMortonCodes ? p64BitPSO : pPSO;
+            if (pBuildPSO != pBoundPSO)
+            {
+                pCommandList->SetPipelineState(pBuildPSO);
+                pBoundPSO = pBuildPSO;
+            }
 
-        pCommandList->SetComputeRootUnorderedAccessView(InputElementsList, elementsBuffer);
-        pCommandList->SetComputeRootUnorderedAccessView(OutputIndices, outputIndices);
-        pCommandList->SetComputeRootUnorderedAccessView(OutputMortonCodes, outputMortonCodes);
-        pCommandList->SetComputeRootUnorderedAccessView(SceneAABB, sceneAABB);
-        pCommandList->SetComputeRoot32BitConstants(InputConstants, SizeOfInUint32(constants), &constants, 0);
+            MortonCodeCalculatorConstants constants{ build.numElements };
 
-        const UINT dispatchWidth = DivideAndRoundUp<UINT>(numElements, THREAD_GROUP_1D_WIDTH);
-        pCommandList->Dispatch(dispatchWidth, 1, 1);
+            pCommandList->SetComputeRootUnorderedAccessView(InputElementsList, build.elementsBuffer);
+            pCommandList->SetComputeRootUnorderedAccessView(OutputIndices, build.outputIndices);
+            pCommandList->SetComputeRootUnorderedAccessView(OutputMortonCodes, build.outputMortonCodes);
+            pCommandList->SetComputeRootUnorderedAccessView(SceneAABB, build.sceneAABB);
+            pCommandList->SetComputeRoot32BitConstants(InputConstants, SizeOfInUint32(constants), &constants, 0);
+
+            const UINT dispatchWidth = DivideAndRoundUp<UINT>(build.numElements, THREAD_GROUP_1D_WIDTH);
+            pCommandList->Dispatch(dispatchWidth, 1, 1);
+        }
 
         auto uavBarrier = CD3DX12_RESOURCE_BARRIER::UAV(nullptr);
         pCommandList->ResourceBarrier(1, &uavBarrier);
@@ -15,7 +15,22 @@ namespace FallbackLayer
     {
     public:
         MortonCodesCalculator(ID3D12Device *pDevice, UINT nodeMask);
-        void CalculateMortonCodes(ID3D12GraphicsCommandList *pCommandList, SceneType sceneType, D3D12_GPU_VIRTUAL_ADDRESS triangleBuffer, UINT numTriangles, D3D12_GPU_VIRTUAL_ADDRESS sceneAABB, D3D12_GPU_VIRTUAL_ADDRESS outputIndices, D3D12_GPU_VIRTUAL_ADDRESS outputMortonCodes);
+        void CalculateMortonCodes(ID3D12GraphicsCommandList *pCommandList, SceneType sceneType, D3D12_GPU_VIRTUAL_ADDRESS triangleBuffer, UINT numTriangles, D3D12_GPU_VIRTUAL_ADDRESS sceneAABB, D3D12_GPU_VIRTUAL_ADDRESS outputIndices, D3D12_GPU_VIRTUAL_ADDRESS outputMortonCodes, bool uses64BitMortonCodes = false);
+
+        struct BatchedBuild
+        {
+            D3D12_GPU_VIRTUAL_ADDRESS elementsBuffer;
+            UINT numElements;
+            D3D12_GPU_VIRTUAL_ADDRESS sceneAABB;
+            D3D12_GPU_VIRTUAL_ADDRESS outputIndices;
+            D3D12_GPU_VIRTUAL_ADDRESS outputMortonCodes;
+
+            // 60-bit codes stored as uint2, quantized into cubic cells sized by the scene's longest side
+            bool uses64BitMortonCodes;
+        };
+
+        // Calculates the codes of every build in one dispatch each, behind a single barrier
+        void CalculateMortonCodes(ID3D12GraphicsCommandList *pCommandList, SceneType sceneType, UINT numBuilds, const BatchedBuild *pBuilds);
     
     private:
         enum RootParameterSlot
@@ -31,5 +46,7 @@ namespace FallbackLayer
         CComPtr<ID3D12RootSignature> m_pRootSignature;
         CComPtr<ID3D12PipelineState> m_pCalcuateMortonCodesForPrimitivesPSO;
         CComPtr<ID3D12PipelineState> m_pCalcuateMortonCodesForAABBsPSO;
+        CComPtr<ID3D12PipelineState> m_pCalcuate64BitMortonCodesForPrimitivesPSO;
+        CComPtr<ID3D12PipelineState> m_pCalcuate64BitMortonCodesForAABBsPSO;
     };
 }
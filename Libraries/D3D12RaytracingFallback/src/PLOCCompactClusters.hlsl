@@ -0,0 +1,36 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+#define HLSL
+#include "PLOCHierarchyBindings.h"
+#include "PLOCHierarchy.hlsli"
+
+// Writes the clusters left after merging into the other cluster buffer, keeping them in order
+[numthreads(THREAD_GROUP_1D_WIDTH, 1, 1)]
+void main(uint3 DTid : SV_DispatchThreadID, uint3 GTid : SV_GroupThreadID, uint3 Gid : SV_GroupID)
+{
+    const uint parity = Constants.ClusterBufferParity;
+    const uint clusterCount = GetClusterCount(parity);
+    if (Gid.x * THREAD_GROUP_1D_WIDTH >= clusterCount)
+    {
+        return;
+    }
+
+    const uint clusterIndex = DTid.x;
+    const uint mergedCluster = clusterIndex < clusterCount ? MergedClusterBuffer[clusterIndex] : InvalidCluster;
+    const bool isClusterLeft = mergedCluster != InvalidCluster;
+
+    uint unused;
+    const uint offsetInGroup = GroupExclusivePrefixSum(isClusterLeft ? 1 : 0, GTid.x, unused);
+    if (isClusterLeft)
+    {
+        ClusterBuffer[GetClusterBufferOffset(parity ^ 1) + GroupOffsetBuffer[Gid.x] + offsetInGroup] = mergedCluster;
+    }
+}
@@ -0,0 +1,61 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+#define HLSL
+#include "PLOCHierarchyBindings.h"
+#include "PLOCHierarchy.hlsli"
+
+// The nearest neighbor of a cluster is the one within the search radius that it would make the
+// smallest box with. When merging adjacent clusters, clusters are paired off in order instead so
+// that every pass is guaranteed to halve the clusters left.
+[numthreads(THREAD_GROUP_1D_WIDTH, 1, 1)]
+void main(uint3 DTid : SV_DispatchThreadID)
+{
+    const uint parity = Constants.ClusterBufferParity;
+    const uint clusterCount = GetClusterCount(parity);
+    const uint clusterIndex = DTid.x;
+    if (clusterIndex >= clusterCount)
+    {
+        return;
+    }
+
+    uint nearestNeighbor = clusterIndex;
+    if (Constants.MergeAdjacentClusters)
+    {
+        if ((clusterIndex ^ 1) < clusterCount)
+        {
+            nearestNeighbor = clusterIndex ^ 1;
+        }
+    }
+    else
+    {
+        const uint clusterOffset = GetClusterBufferOffset(parity);
+        const AABB clusterAABB = AABBBuffer[ClusterBuffer[clusterOffset + clusterIndex]];
+        const uint firstNeighbor = clusterIndex > SearchRadius ? clusterIndex - SearchRadius : 0;
+        const uint lastNeighbor = min(clusterIndex + SearchRadius, clusterCount - 1);
+
+        // Ties go to the lower index so that both clusters of a pair settle on each other
+        float minSurfaceArea = FLT_MAX;
+        for (uint neighborIndex = firstNeighbor; neighborIndex <= lastNeighbor; neighborIndex++)
+        {
+            if (neighborIndex == clusterIndex) continue;
+
+            const AABB neighborAABB = AABBBuffer[ClusterBuffer[clusterOffset + neighborIndex]];
+            const float surfaceArea = ComputeBoxSurfaceArea(CombineAABB(clusterAABB, neighborAABB));
+            if (surfaceArea < minSurfaceArea)
+            {
+                minSurfaceArea = surfaceArea;
+                nearestNeighbor = neighborIndex;
+            }
+        }
+    }
+
+    NearestNeighborBuffer[clusterIndex] = nearestNeighbor;
+}
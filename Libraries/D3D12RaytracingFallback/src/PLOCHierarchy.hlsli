@@ -0,0 +1,54 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+// Builds the hierarchy bottom-up with the parallel locally-ordered clustering outlined in
+// Meister and Bittner's 2018 "Parallel Locally-Ordered Clustering for Bounding Volume
+// Hierarchy Construction". The clusters start as the Morton-sorted leaves, and each pass
+// merges every pair of clusters that are each other's nearest neighbor within a small
+// window of the sorted order. Internal nodes are handed out from the back, so the final
+// merge lands on the root at index 0 the same as the top-down split.
+#include "RayTracingHelper.hlsli"
+
+static const uint SearchRadius = 16;
+static const uint InvalidCluster = 0xffffffff;
+
+uint GetClusterCount(uint parity)
+{
+    return ClusterStateBuffer.Load(OffsetToClusterCounts + parity * SizeOfUINT32);
+}
+
+uint GetClusterBufferOffset(uint parity)
+{
+    return parity * Constants.NumberOfElements;
+}
+
+groupshared uint groupPrefix[THREAD_GROUP_1D_WIDTH];
+
+// Exclusive prefix sum over the thread group, called by every thread in the group
+uint GroupExclusivePrefixSum(uint value, uint groupThreadIndex, out uint groupTotal)
+{
+    groupPrefix[groupThreadIndex] = value;
+    GroupMemoryBarrierWithGroupSync();
+
+    [unroll]
+    for (uint offset = 1; offset < THREAD_GROUP_1D_WIDTH; offset *= 2)
+    {
+        uint addend = groupThreadIndex >= offset ? groupPrefix[groupThreadIndex - offset] : 0;
+        GroupMemoryBarrierWithGroupSync();
+        groupPrefix[groupThreadIndex] += addend;
+        GroupMemoryBarrierWithGroupSync();
+    }
+
+    groupTotal = groupPrefix[THREAD_GROUP_1D_WIDTH - 1];
+    uint inclusivePrefix = groupPrefix[groupThreadIndex];
+    GroupMemoryBarrierWithGroupSync();
+    return inclusivePrefix - value;
+}
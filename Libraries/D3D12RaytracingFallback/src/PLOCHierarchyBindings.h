@@ -0,0 +1,59 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+#pragma once
+#include "RaytracingHlslCompat.h"
+#ifdef HLSL
+#include "ShaderUtil.hlsli"
+#endif
+
+struct InputConstants
+{
+    uint NumberOfElements;
+    uint ClusterBufferParity;
+    uint MergeAdjacentClusters;
+};
+
+// CBVs
+#define ConstantsRegister 0
+
+// UAVs
+#define HierarchyBufferRegister 0
+#define ElementBufferRegister 1
+#define ClusterStateBufferRegister 2
+#define AABBBufferRegister 3
+#define ClusterBufferRegister 4
+#define NearestNeighborBufferRegister 5
+#define MergedClusterBufferRegister 6
+#define GroupOffsetBufferRegister 7
+
+// Offsets into the cluster state buffer. The cluster count is double buffered along with the clusters.
+#define OffsetToClusterCounts 0
+#define OffsetToNextInternalNode 8
+#define SizeOfClusterState 16
+
+#ifdef HLSL
+// These need to be UAVs despite being read-only because the fallback layer only gets a 
+// GPU VA and the API doesn't allow any way to transition that GPU VA from UAV->SRV
+RWStructuredBuffer<Primitive> InputBuffer : UAV_REGISTER(ElementBufferRegister);
+
+RWStructuredBuffer<HierarchyNode> hierarchyBuffer : UAV_REGISTER(HierarchyBufferRegister);
+RWByteAddressBuffer ClusterStateBuffer : UAV_REGISTER(ClusterStateBufferRegister);
+RWStructuredBuffer<AABB> AABBBuffer : UAV_REGISTER(AABBBufferRegister);
+RWStructuredBuffer<uint> ClusterBuffer : UAV_REGISTER(ClusterBufferRegister);
+RWStructuredBuffer<uint> NearestNeighborBuffer : UAV_REGISTER(NearestNeighborBufferRegister);
+RWStructuredBuffer<uint> MergedClusterBuffer : UAV_REGISTER(MergedClusterBufferRegister);
+RWStructuredBuffer<uint> GroupOffsetBuffer : UAV_REGISTER(GroupOffsetBufferRegister);
+
+cbuffer PLOCConstants : CONSTANT_REGISTER(ConstantsRegister)
+{
+    InputConstants Constants;
+};
+#endif
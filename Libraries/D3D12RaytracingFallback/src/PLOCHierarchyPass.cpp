@@ -0,0 +1,159 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+#include "pch.h"
+#include "CompiledShaders/PLOCInitializeClusters.h"
+#include "CompiledShaders/PLOCFindNearestNeighbors.h"
+#include "CompiledShaders/PLOCMergeClusters.h"
+#include "CompiledShaders/PLOCScanClusterCounts.h"
+#include "CompiledShaders/PLOCCompactClusters.h"
+#include "PLOCHierarchyBindings.h"
+
+namespace FallbackLayer
+{
+    PLOCHierarchyPass::PLOCHierarchyPass(ID3D12Device *pDevice, UINT nodeMask)
+    {
+        CD3DX12_ROOT_PARAMETER1 parameters[RootParameterSlot::NumParameters];
+        parameters[HierarchyBufferSlot].InitAsUnorderedAccessView(HierarchyBufferRegister);
+        parameters[InputElementSlot].InitAsUnorderedAccessView(ElementBufferRegister);
+        parameters[ClusterStateBufferSlot].InitAsUnorderedAccessView(ClusterStateBufferRegister);
+        parameters[AABBBufferSlot].InitAsUnorderedAccessView(AABBBufferRegister);
+        parameters[ClusterBufferSlot].InitAsUnorderedAccessView(ClusterBufferRegister);
+        parameters[NearestNeighborBufferSlot].InitAsUnorderedAccessView(NearestNeighborBufferRegister);
+        parameters[MergedClusterBufferSlot].InitAsUnorderedAccessView(MergedClusterBufferRegister);
+        parameters[GroupOffsetBufferSlot].InitAsUnorderedAccessView(GroupOffsetBufferRegister);
+        parameters[ConstantsSlot].InitAsConstants(SizeOfInUint32(InputConstants), ConstantsRegister);
+
+        auto rootSignatureDesc = CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC(ARRAYSIZE(parameters), parameters);
+        CreateRootSignatureHelper(pDevice, rootSignatureDesc, &m_pRootSignature);
+
+        CreatePSOHelper(pDevice, nodeMask, m_pRootSignature, COMPILED_SHADER(g_pPLOCInitializeClusters), &m_pInitializeClustersPSO);
+        CreatePSOHelper(pDevice, nodeMask, m_pRootSignature, COMPILED_SHADER(g_pPLOCFindNearestNeighbors), &m_pFindNearestNeighborsPSO);
+        CreatePSOHelper(pDevice, nodeMask, m_pRootSignature, COMPILED_SHADER(g_pPLOCMergeClusters), &m_pMergeClustersPSO);
+        CreatePSOHelper(pDevice, nodeMask, m_pRootSignature, COMPILED_SHADER(g_pPLOCScanClusterCounts), &m_pScanClusterCountsPSO);
+        CreatePSOHelper(pDevice, nodeMask, m_pRootSignature, COMPILED_SHADER(g_pPLOCCompactClusters), &m_pCompactClustersPSO);
+    }
+
+    void PLOCHierarchyPass::ConstructHierarchy(
+        ID3D12GraphicsCommandList *pCommandList,
+        UINT numBuilds,
+        const BatchedBuild *pBuilds)
+    {
+        // A single element is its own hierarchy
+        auto isBuildClustered = [](const BatchedBuild &build) { return build.numElements > 1; };
+        if (std::none_of(pBuilds, pBuilds + numBuilds, isBuildClustered)) return;
+
+        UINT maxPasses = 0;
+        for (UINT buildIndex = 0; buildIndex < numBuilds; buildIndex++)
+        {
+            const UINT numElements = pBuilds[buildIndex].numElements;
+            maxPasses = std::max(maxPasses, NumClusteringPasses(numElements) + NumMergeAdjacentPasses(numElements));
+        }
+
+        pCommandList->SetComputeRootSignature(m_pRootSignature);
+
+        auto uavBarrier = CD3DX12_RESOURCE_BARRIER::UAV(nullptr);
+        auto dispatchBuilds = [&](ID3D12PipelineState *pPSO, UINT passIndex, bool dispatchSingleGroup)
+        {
+            pCommandList->SetPipelineState(pPSO);
+            for (UINT buildIndex = 0; buildIndex < numBuilds; buildIndex++)
+            {
+                const BatchedBuild &build = pBuilds[buildIndex];
+                const UINT numClusteringPasses = NumClusteringPasses(build.numElements);
+                if (!isBuildClustered(build) || passIndex >= numClusteringPasses + NumMergeAdjacentPasses(build.numElements)) continue;
+
+                InputConstants constants;
+                constants.NumberOfElements = build.numElements;
+                constants.ClusterBufferParity = passIndex & 1;
+                constants.MergeAdjacentClusters = passIndex >= numClusteringPasses;
+
+                const ScratchMemoryPartitions partitions = CalculateScratchMemoryUsage(build.numElements);
+                pCommandList->SetComputeRoot32BitConstants(ConstantsSlot, SizeOfInUint32(InputConstants), &constants, 0);
+                pCommandList->SetComputeRootUnorderedAccessView(HierarchyBufferSlot, build.hierarchyBuffer);
+                pCommandList->SetComputeRootUnorderedAccessView(InputElementSlot, build.sortedElementBuffer);
+                pCommandList->SetComputeRootUnorderedAccessView(ClusterStateBufferSlot, build.scratchBuffer + partitions.OffsetToClusterState);
+                pCommandList->SetComputeRootUnorderedAccessView(AABBBufferSlot, build.scratchBuffer + partitions.OffsetToAABBs);
+                pCommandList->SetComputeRootUnorderedAccessView(ClusterBufferSlot, build.scratchBuffer + partitions.OffsetToClusters);
+                pCommandList->SetComputeRootUnorderedAccessView(NearestNeighborBufferSlot, build.scratchBuffer + partitions.OffsetToNearestNeighbors);
+                pCommandList->SetComputeRootUnorderedAccessView(MergedClusterBufferSlot, build.scratchBuffer + partitions.OffsetToMergedClusters);
+                pCommandList->SetComputeRootUnorderedAccessView(GroupOffsetBufferSlot, build.scratchBuffer + partitions.OffsetToGroupOffsets);
+
+                pCommandList->Dispatch(dispatchSingleGroup ? 1 : DivideAndRoundUp<UINT>(build.numElements, THREAD_GROUP_1D_WIDTH), 1, 1);
+            }
+            pCommandList->ResourceBarrier(1, &uavBarrier);
+        };
+
+        dispatchBuilds(m_pInitializeClustersPSO, 0, false);
+
+        // The pass counts are planned on the CPU since the cluster count stays on the GPU. Passes
+        // that start with a single cluster left exit early.
+        for (UINT passIndex = 0; passIndex < maxPasses; passIndex++)
+        {
+            dispatchBuilds(m_pFindNearestNeighborsPSO, passIndex, false);
+            dispatchBuilds(m_pMergeClustersPSO, passIndex, false);
+            dispatchBuilds(m_pScanClusterCountsPSO, passIndex, true);
+            dispatchBuilds(m_pCompactClustersPSO, passIndex, false);
+        }
+    }
+
+    UINT PLOCHierarchyPass::NumClusteringPasses(UINT numElements)
+    {
+        // Clustering merges a good share of the clusters each pass, so this leaves few if any
+        return 2 * NumMergeAdjacentPasses(numElements);
+    }
+
+    UINT PLOCHierarchyPass::NumMergeAdjacentPasses(UINT numElements)
+    {
+        // Pairing off adjacent clusters at least halves them each pass, which bounds the passes
+        // needed to finish whatever clustering left over
+        UINT numPasses = 0;
+        for (UINT numClusters = numElements; numClusters > 1; numClusters = DivideAndRoundUp<UINT>(numClusters, 2))
+        {
+            numPasses++;
+        }
+        return numPasses;
+    }
+
+    PLOCHierarchyPass::ScratchMemoryPartitions PLOCHierarchyPass::CalculateScratchMemoryUsage(UINT numElements)
+    {
+        ScratchMemoryPartitions scratchMemoryPartitions = {};
+        UINT64 &totalSize = scratchMemoryPartitions.TotalSize;
+        const UINT totalNumNodes = numElements + GetNumInternalNodes(numElements);
+
+        scratchMemoryPartitions.OffsetToClusterState = totalSize;
+        totalSize += SizeOfClusterState;
+
+        scratchMemoryPartitions.OffsetToAABBs = totalSize;
+        totalSize += sizeof(AABB) * totalNumNodes;
+
+        // Double buffered so each pass compacts into the buffer the next pass reads
+        scratchMemoryPartitions.OffsetToClusters = totalSize;
+        totalSize += sizeof(UINT) * numElements * 2;
+
+        scratchMemoryPartitions.OffsetToNearestNeighbors = totalSize;
+        totalSize += sizeof(UINT) * numElements;
+
+        scratchMemoryPartitions.OffsetToMergedClusters = totalSize;
+        totalSize += sizeof(UINT) * numElements;
+
+        scratchMemoryPartitions.OffsetToGroupOffsets = totalSize;
+        totalSize += sizeof(UINT) * DivideAndRoundUp<UINT>(numElements, THREAD_GROUP_1D_WIDTH);
+
+        return scratchMemoryPartitions;
+    }
+
+    UINT64 PLOCHierarchyPass::RequiredScratchSize(UINT numElements)
+    {
+        if (numElements <= 1)
+            return 0;
+
+        return CalculateScratchMemoryUsage(numElements).TotalSize;
+    }
+}
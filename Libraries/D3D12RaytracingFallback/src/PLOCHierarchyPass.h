@@ -0,0 +1,73 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+#pragma once
+namespace FallbackLayer
+{
+    // Builds the hierarchy by clustering the sorted elements bottom-up. Slower to build than
+    // splitting on the Morton codes but gives trees with a noticeably lower SAH cost.
+    class PLOCHierarchyPass
+    {
+    public:
+        PLOCHierarchyPass(ID3D12Device *pDevice, UINT nodeMask);
+
+        struct BatchedBuild
+        {
+            UINT numElements;
+            D3D12_GPU_VIRTUAL_ADDRESS sortedElementBuffer;
+            D3D12_GPU_VIRTUAL_ADDRESS hierarchyBuffer;
+            D3D12_GPU_VIRTUAL_ADDRESS scratchBuffer;
+        };
+
+        // Runs each step of a clustering pass for every build before the barrier it needs
+        void ConstructHierarchy(
+            ID3D12GraphicsCommandList *pCommandList,
+            UINT numBuilds,
+            const BatchedBuild *pBuilds);
+
+        static UINT64 RequiredScratchSize(UINT numElements);
+    private:
+        enum RootParameterSlot
+        {
+            HierarchyBufferSlot = 0,
+            InputElementSlot,
+            ClusterStateBufferSlot,
+            AABBBufferSlot,
+            ClusterBufferSlot,
+            NearestNeighborBufferSlot,
+            MergedClusterBufferSlot,
+            GroupOffsetBufferSlot,
+            ConstantsSlot,
+            NumParameters
+        };
+
+        struct ScratchMemoryPartitions
+        {
+            UINT64 OffsetToClusterState;
+            UINT64 OffsetToAABBs;
+            UINT64 OffsetToClusters;
+            UINT64 OffsetToNearestNeighbors;
+            UINT64 OffsetToMergedClusters;
+            UINT64 OffsetToGroupOffsets;
+            UINT64 TotalSize;
+        };
+
+        static ScratchMemoryPartitions CalculateScratchMemoryUsage(UINT numElements);
+        static UINT NumClusteringPasses(UINT numElements);
+        static UINT NumMergeAdjacentPasses(UINT numElements);
+
+        CComPtr<ID3D12RootSignature> m_pRootSignature;
+        CComPtr<ID3D12PipelineState> m_pInitializeClustersPSO;
+        CComPtr<ID3D12PipelineState> m_pFindNearestNeighborsPSO;
+        CComPtr<ID3D12PipelineState> m_pMergeClustersPSO;
+        CComPtr<ID3D12PipelineState> m_pScanClusterCountsPSO;
+        CComPtr<ID3D12PipelineState> m_pCompactClustersPSO;
+    };
+}
@@ -0,0 +1,35 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+#define HLSL
+#include "PLOCHierarchyBindings.h"
+#include "PLOCHierarchy.hlsli"
+
+// Every leaf starts out as its own cluster, in the Morton order the leaves were sorted into
+[numthreads(THREAD_GROUP_1D_WIDTH, 1, 1)]
+void main(uint3 DTid : SV_DispatchThreadID)
+{
+    const uint elementIndex = DTid.x;
+    const uint NumberOfInternalNodes = GetNumInternalNodes(Constants.NumberOfElements);
+    if (elementIndex == 0)
+    {
+        ClusterStateBuffer.Store2(OffsetToClusterCounts, uint2(Constants.NumberOfElements, 0));
+        ClusterStateBuffer.Store(OffsetToNextInternalNode, NumberOfInternalNodes - 1);
+    }
+
+    if (elementIndex >= Constants.NumberOfElements)
+    {
+        return;
+    }
+
+    const uint leafNodeIndex = NumberOfInternalNodes + elementIndex;
+    AABBBuffer[leafNodeIndex] = GetPrimitiveAABB(InputBuffer[elementIndex], elementIndex);
+    ClusterBuffer[elementIndex] = leafNodeIndex;
+}
@@ -0,0 +1,62 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+#define HLSL
+#include "PLOCHierarchyBindings.h"
+#include "PLOCHierarchy.hlsli"
+
+// Clusters that are each other's nearest neighbor merge into a new internal node, made by the
+// lower of the two. The other drops out, and every group counts the clusters it has left.
+[numthreads(THREAD_GROUP_1D_WIDTH, 1, 1)]
+void main(uint3 DTid : SV_DispatchThreadID, uint3 GTid : SV_GroupThreadID, uint3 Gid : SV_GroupID)
+{
+    const uint parity = Constants.ClusterBufferParity;
+    const uint clusterCount = GetClusterCount(parity);
+    if (Gid.x * THREAD_GROUP_1D_WIDTH >= clusterCount)
+    {
+        return;
+    }
+
+    const uint clusterIndex = DTid.x;
+    bool isClusterLeft = false;
+    if (clusterIndex < clusterCount)
+    {
+        const uint clusterOffset = GetClusterBufferOffset(parity);
+        const uint nodeIndex = ClusterBuffer[clusterOffset + clusterIndex];
+        const uint neighborIndex = NearestNeighborBuffer[clusterIndex];
+
+        uint mergedCluster = nodeIndex;
+        if (neighborIndex != clusterIndex && NearestNeighborBuffer[neighborIndex] == clusterIndex)
+        {
+            mergedCluster = InvalidCluster;
+            if (clusterIndex < neighborIndex)
+            {
+                const uint neighborNodeIndex = ClusterBuffer[clusterOffset + neighborIndex];
+                ClusterStateBuffer.InterlockedAdd(OffsetToNextInternalNode, (uint)-1, mergedCluster);
+
+                hierarchyBuffer[mergedCluster].LeftChildIndex = nodeIndex;
+                hierarchyBuffer[mergedCluster].RightChildIndex = neighborNodeIndex;
+                hierarchyBuffer[nodeIndex].ParentIndex = mergedCluster;
+                hierarchyBuffer[neighborNodeIndex].ParentIndex = mergedCluster;
+                AABBBuffer[mergedCluster] = CombineAABB(AABBBuffer[nodeIndex], AABBBuffer[neighborNodeIndex]);
+            }
+        }
+
+        MergedClusterBuffer[clusterIndex] = mergedCluster;
+        isClusterLeft = mergedCluster != InvalidCluster;
+    }
+
+    uint groupClusterCount;
+    GroupExclusivePrefixSum(isClusterLeft ? 1 : 0, GTid.x, groupClusterCount);
+    if (GTid.x == 0)
+    {
+        GroupOffsetBuffer[Gid.x] = groupClusterCount;
+    }
+}
@@ -0,0 +1,42 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+#define HLSL
+#include "PLOCHierarchyBindings.h"
+#include "PLOCHierarchy.hlsli"
+
+// Dispatched as a single group. Turns the cluster count of every group into the offset its
+// clusters are compacted to, and sets the cluster count of the next pass.
+[numthreads(THREAD_GROUP_1D_WIDTH, 1, 1)]
+void main(uint3 GTid : SV_GroupThreadID)
+{
+    const uint parity = Constants.ClusterBufferParity;
+    const uint numGroups = (GetClusterCount(parity) + THREAD_GROUP_1D_WIDTH - 1) / THREAD_GROUP_1D_WIDTH;
+
+    uint groupOffset = 0;
+    for (uint firstGroup = 0; firstGroup < numGroups; firstGroup += THREAD_GROUP_1D_WIDTH)
+    {
+        const uint groupIndex = firstGroup + GTid.x;
+        const uint groupClusterCount = groupIndex < numGroups ? GroupOffsetBuffer[groupIndex] : 0;
+
+        uint clusterCountOfGroups;
+        const uint prefix = GroupExclusivePrefixSum(groupClusterCount, GTid.x, clusterCountOfGroups);
+        if (groupIndex < numGroups)
+        {
+            GroupOffsetBuffer[groupIndex] = groupOffset + prefix;
+        }
+        groupOffset += clusterCountOfGroups;
+    }
+
+    if (GTid.x == 0)
+    {
+        ClusterStateBuffer.Store(OffsetToClusterCounts + (parity ^ 1) * SizeOfUINT32, groupOffset);
+    }
+}
@@ -46,8 +46,12 @@ static const int OffsetToPrimitiveMetaDataOffset = 8;
 
 // Top Level
 static const int OffsetToLeafNodeMetaDataOffset = 4;
+static const int OffsetToBuildCost = 20;
+static const int OffsetToRefitCost = 24;
+static const int OffsetToIsRebuilt = 28;
 
 static const int OffsetToTotalSize = 12;
+static const int OffsetToWideNodesOffset = 16;
 
 
 int GetLeafIndexFromFlag(uint2 flag)
@@ -99,6 +103,34 @@ int GetOffsetToPrimitiveMetaData(RWByteAddressBufferPointer pointer)
     return GetOffsetToOffset(pointer, OffsetToPrimitiveMetaDataOffset);
 }
 
+static
+int GetOffsetToWideNodes(RWByteAddressBufferPointer pointer)
+{
+    return GetOffsetToOffset(pointer, OffsetToWideNodesOffset);
+}
+
+// The offsets traversal needs on every node and leaf fetch, loaded once as it enters a BVH
+// rather than from the BVH's header on each fetch
+struct TraversalOffsets
+{
+    uint offsetToPrimitives;        // The instance descs of a top level
+    uint offsetToPrimitiveMetaData;
+    uint offsetToWideNodes;
+};
+
+static
+TraversalOffsets LoadTraversalOffsets(RWByteAddressBufferPointer pointer)
+{
+    // The header holds the offsets to primitives, primitive metadata, the total size and wide nodes in a row
+    const uint4 header = pointer.buffer.Load4(pointer.offsetInBytes + OffsetToPrimitivesOffset) + pointer.offsetInBytes;
+
+    TraversalOffsets offsets;
+    offsets.offsetToPrimitives = header.x;
+    offsets.offsetToPrimitiveMetaData = header.y;
+    offsets.offsetToWideNodes = header.w;
+    return offsets;
+}
+
 bool IsLeaf(uint2 flag)
 {
     return (flag.x & IsLeafFlag);
@@ -189,15 +221,51 @@ void CompressBox(BoundingBox box, uint2 flags, out uint4 data1, out uint4 data2)
     data2.w = flags.y;
 }
 
+uint GetWideNodeAddress(uint startAddress, uint wideNodeIndex)
+{
+    return startAddress + wideNodeIndex * SizeOfWideNode;
+}
+
+// A wide node's child reference to a leaf holds the leaf's flags.x
+bool IsLeafReference(uint childReference)
+{
+    return (childReference & IsLeafFlag);
+}
+
+uint2 GetLeafFlagsFromReference(uint childReference)
+{
+    return uint2(childReference, 1);
+}
+
+uint GetWideNodeChildCount(uint exponentsAndChildCount)
+{
+    return exponentsAndChildCount >> 24;
+}
+
+// The quantization steps are powers of two, so a step count times the step is exact
+// and the builder and the traversal decode the same planes
+float3 GetQuantizationStep(uint exponentsAndChildCount)
+{
+    const uint3 biasedExponents = uint3(exponentsAndChildCount, exponentsAndChildCount >> 8, exponentsAndChildCount >> 16) & 0xff;
+    return asfloat(biasedExponents << 23);
+}
+
+float3 DequantizePlanes(float3 origin, float3 step, uint3 packedPlanes, uint childIndex)
+{
+    const uint3 steps = (packedPlanes >> (childIndex * 8)) & 0xff;
+    precise float3 planes = origin + steps * step;
+    return planes;
+}
+
 uint GetPrimitiveMetaDataAddress(uint startAddress, uint triangleIndex)
 {
     return startAddress + triangleIndex * SizeOfPrimitiveMetaData;
 }
 
 static
-PrimitiveMetaData BVHReadPrimitiveMetaData(RWByteAddressBufferPointer pointer, int primitiveIndex)
+PrimitiveMetaData BVHReadPrimitiveMetaData(RWByteAddressBufferPointer pointer, TraversalOffsets offsets, int primitiveIndex)
 {
-    const uint readAddress = GetPrimitiveMetaDataAddress(GetOffsetToPrimitiveMetaData(pointer), primitiveIndex);
+    const uint readAddress = GetPrimitiveMetaDataAddress(offsets.offsetToPrimitiveMetaData, primitiveIndex);
 
     PrimitiveMetaData metadata;
     const uint3 a = pointer.buffer.Load3(readAddress);
@@ -231,12 +299,13 @@ void WriteBoxToBuffer(RWByteAddressBuffer buffer, uint boxStartOffset, uint boxI
 static
 void BVHReadTriangle(
     RWByteAddressBufferPointer pointer,
+    TraversalOffsets offsets,
     out float3 v0,
     out float3 v1,
     out float3 v2,
     uint triId)
 {
-    uint baseOffset = GetOffsetToVertices(pointer) + triId * SizeOfPrimitive
+    uint baseOffset = offsets.offsetToPrimitives + triId * SizeOfPrimitive
         + OffsetToPrimitiveData;
 
     const float4 a = asfloat(pointer.buffer.Load4(baseOffset));
@@ -284,6 +353,34 @@ BoundingBox GetBoxDataFromTriangle(float3 v0, float3 v1, float3 v2, int triangle
     return box;
 }
 
+AABB GetPrimitiveAABB(Primitive primitive, uint primitiveIndex)
+{
+    if (primitive.PrimitiveType == TRIANGLE_TYPE)
+    {
+        uint2 unused;
+        Triangle tri = GetTriangle(primitive);
+        return BoundingBoxToAABB(GetBoxDataFromTriangle(tri.v0, tri.v1, tri.v2, primitiveIndex, unused));
+    }
+    else // if(primitiveType == PROCEDURAL_PRIMITIVE_TYPE)
+    {
+        return GetProceduralPrimitiveAABB(primitive);
+    }
+}
+
+float ComputeBoxSurfaceArea(AABB aabb)
+{
+    float3 dim = aabb.max - aabb.min;
+    return 2.0f * (dim.x * dim.y + dim.x * dim.z + dim.y * dim.z);
+}
+
+AABB CombineAABB(AABB aabb0, AABB aabb1)
+{
+    AABB parentAABB;
+    parentAABB.min = min(aabb0.min, aabb1.min);
+    parentAABB.max = max(aabb0.max, aabb1.max);
+    return parentAABB;
+}
+
 float3 GetMinCorner(BoundingBox box)
 {
     return box.center - box.halfDim;
@@ -25,7 +25,11 @@
 //*************************************************************************
 
 
-#define     TRAVERSAL_MAX_STACK_DEPTH       32
+// A 4-wide node pushes up to 3 more entries than it pops, in half as many levels as the binary tree
+#define     TRAVERSAL_MAX_STACK_DEPTH       48
+
+// Entries the short stack traversal keeps per ray. Must be a power of two.
+#define     SHORT_STACK_SIZE                8
 
 #define     MAX_TRIS_IN_LEAF                1
 
@@ -234,6 +238,17 @@ static const uint D3D12_RAYTRACING_GEOMETRY_FLAG_NONE = 0;
 static const uint D3D12_RAYTRACING_GEOMETRY_FLAG_OPAQUE = 0x1;
 static const uint D3D12_RAYTRACING_GEOMETRY_FLAG_NO_DUPLICATE_ANYHIT_INVOCATION = 0x2;
 
+// The RAY_FLAG_* intrinsics only exist when compiling libraries
+static const uint D3D12_RAY_FLAG_NONE = 0;
+static const uint D3D12_RAY_FLAG_FORCE_OPAQUE = 0x1;
+static const uint D3D12_RAY_FLAG_FORCE_NON_OPAQUE = 0x2;
+static const uint D3D12_RAY_FLAG_ACCEPT_FIRST_HIT_AND_END_SEARCH = 0x4;
+static const uint D3D12_RAY_FLAG_SKIP_CLOSEST_HIT_SHADER = 0x8;
+static const uint D3D12_RAY_FLAG_CULL_BACK_FACING_TRIANGLES = 0x10;
+static const uint D3D12_RAY_FLAG_CULL_FRONT_FACING_TRIANGLES = 0x20;
+static const uint D3D12_RAY_FLAG_CULL_OPAQUE = 0x40;
+static const uint D3D12_RAY_FLAG_CULL_NON_OPAQUE = 0x80;
+
 struct RaytracingInstanceDesc
 {
     float4 Transform[3];
@@ -418,12 +433,56 @@ struct BVHOffsets
     uint    offsetToVertices;
     uint    offsetToPrimitiveMetaData;
     uint    totalSize;
+    uint    offsetToWideNodes;
+
+    // Top levels that allow updates keep the SAH cost of their hierarchy as last built and as last
+    // refit, scaled by SAHCostScale, and rebuild on an update once the refits have degraded it
+    uint    buildCost;
+    uint    refitCost;
+    uint    isRebuilt;  // Set while the build cost is being measured
 };
-#define SizeOfBVHOffsets (4 * 4)
+#define SizeOfBVHOffsets (4 * 8)
 #ifndef HLSL
 static_assert(sizeof(BVHOffsets) == SizeOfBVHOffsets, L"Incorrect sizeof for BVHOffsets");
 #endif
 
+// Fixed point steps per unit of SAH cost, since the cost is summed with integer atomics
+#define SAHCostScale 256
+
+// The binary hierarchy collapsed into nodes of up to 4 children for traversal. A node is stored in
+// the slot of the binary internal node it replaces, and references a child either by the slot of its
+// wide node or, for a leaf, by the leaf's flags, which carry IsLeafFlag. Child bounds are quantized
+// to 8 bits per plane, as steps of a power of two above the origin, rounded outwards. Each node
+// also links back to the wide node holding it, which the short stack traversal backtracks through.
+#define WIDE_NODE_MAX_CHILDREN 4
+struct WideNode
+{
+    float   origin[3];
+    uint    exponentsAndChildCount;   // Biased float exponent of each axis' step in bytes 0-2, child count in byte 3
+    uint    childReferences[WIDE_NODE_MAX_CHILDREN];
+    uint    quantizedMin[3];          // One byte per child for each axis
+    uint    quantizedMax[3];
+    uint    parentIndex;              // ~0 at the root
+    uint    slotInParent;             // Which of the parent's children this node is
+};
+#define SizeOfWideNode (4 * 16)
+#ifndef HLSL
+static_assert(sizeof(WideNode) == SizeOfWideNode, L"Incorrect sizeof for WideNode");
+#endif
+
+inline
+uint GetNumWideNodes(uint numElements)
+{
+    // One per binary internal node, or a root holding the single leaf (or none)
+    return numElements > 1 ? numElements - 1 : 1;
+}
+
+inline
+uint GetSizeOfWideNodes(uint numElements)
+{
+    return SizeOfWideNode * GetNumWideNodes(numElements);
+}
+
 inline
 uint GetNumInternalNodes(uint numLeaves)
 {
@@ -438,13 +497,13 @@ uint GetOffsetFromSortedIndicesToAABBParents(uint numPrimitives) {
 inline
 uint GetOffsetToBVHSortedIndices(uint numElements) {
     uint totalNodes = numElements + GetNumInternalNodes(numElements);
-    return SizeOfBVHOffsets + SizeOfAABBNode * totalNodes + SizeOfBVHMetadata * numElements;
+    return SizeOfBVHOffsets + SizeOfAABBNode * totalNodes + SizeOfBVHMetadata * numElements + GetSizeOfWideNodes(numElements);
 }
 
 inline
 uint GetOffsetFromPrimitiveMetaDataToSortedIndices(uint numPrimitives)
 {
-    return SizeOfPrimitiveMetaData * numPrimitives;
+    return SizeOfPrimitiveMetaData * numPrimitives + GetSizeOfWideNodes(numPrimitives);
 }
 
 inline
@@ -13,12 +13,12 @@
 namespace FallbackLayer
 {
 
-    ITraversalShaderBuilder *RaytracingProgramFactory::NewTraversalShaderBuilder(AccelerationStructureLayoutType type)
+    ITraversalShaderBuilder *RaytracingProgramFactory::NewTraversalShaderBuilder(AccelerationStructureLayoutType type, bool useShortStack)
     {
         switch (type)
         {
         case BVH2:
-            return new BVHTraversalShaderBuilder(m_DxilShaderPatcher);
+            return new BVHTraversalShaderBuilder(m_DxilShaderPatcher, useShortStack);
         default:
             ThrowInternalFailure(E_INVALIDARG);
             return nullptr;
@@ -30,7 +30,7 @@ namespace FallbackLayer
         switch (programType)
         {
         case RaytracingProgramFactory::UberShader:
-                return new UberShaderRaytracingProgram(m_pDevice, m_DxilShaderPatcher, stateObjectCollection);
+                return new UberShaderRaytracingProgram(m_pDevice, m_DxilShaderPatcher, m_spShaderCache.get(), stateObjectCollection);
             default:
                 ThrowInternalFailure(E_INVALIDARG);
                 return nullptr;
@@ -51,9 +51,14 @@ namespace FallbackLayer
         return NewRaytracingProgram(programType, stateObjectCollection);
     }
 
-    RaytracingProgramFactory::RaytracingProgramFactory(ID3D12Device *pDevice) : m_pDevice(pDevice)
+    RaytracingProgramFactory::RaytracingProgramFactory(ID3D12Device *pDevice, DWORD createRaytracingFallbackDeviceFlags) : m_pDevice(pDevice)
     {
-        m_spTraversalShaderBuilder.reset(NewTraversalShaderBuilder(m_DefaultAccelerationStructureLayoutType));
+        if (createRaytracingFallbackDeviceFlags & CreateRaytracingFallbackDeviceFlags::EnableShaderCache)
+        {
+            m_spShaderCache = std::make_unique<ShaderCache>();
+        }
+        const bool useShortStack = (createRaytracingFallbackDeviceFlags & CreateRaytracingFallbackDeviceFlags::EnableShortStackTraversal) != 0;
+        m_spTraversalShaderBuilder.reset(NewTraversalShaderBuilder(m_DefaultAccelerationStructureLayoutType, useShortStack));
     }
 
     RaytracingProgramFactory::ProgramTypes RaytracingProgramFactory::DetermineBestProgram(
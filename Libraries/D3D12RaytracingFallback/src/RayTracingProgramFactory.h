@@ -48,7 +48,7 @@ namespace FallbackLayer
     class RaytracingProgramFactory
     {
     public:
-        RaytracingProgramFactory(ID3D12Device *pDevice);
+        RaytracingProgramFactory(ID3D12Device *pDevice, DWORD createRaytracingFallbackDeviceFlags);
         IRaytracingProgram *GetRaytracingProgram(
             const StateObjectCollection &stateObjectCollection);
 
@@ -61,10 +61,11 @@ namespace FallbackLayer
         };
 
         DxilShaderPatcher m_DxilShaderPatcher;
+        std::unique_ptr<ShaderCache> m_spShaderCache;
 
         ProgramTypes DetermineBestProgram(const StateObjectCollection &stateObjectCollection);
         IRaytracingProgram *NewRaytracingProgram(ProgramTypes programTypes, const StateObjectCollection &stateObjectCollection);
-        ITraversalShaderBuilder *NewTraversalShaderBuilder(AccelerationStructureLayoutType type);
+        ITraversalShaderBuilder *NewTraversalShaderBuilder(AccelerationStructureLayoutType type, bool useShortStack);
 
         const AccelerationStructureLayoutType m_DefaultAccelerationStructureLayoutType = BVH2;
         std::unique_ptr<ITraversalShaderBuilder> m_spTraversalShaderBuilder;
@@ -19,6 +19,9 @@ void OutputDebugLog(ID3D12RaytracingFallbackDevice *pDevice);
 void VisualizeAccelerationStructureLevel(ID3D12RaytracingFallbackDevice *pDevice, UINT level);
 #endif
 
+// Builds a bottom level with a binned SAH, splitting the top of the tree in parallel. The output
+// has the same layout as the GPU builder's, so for static geometry it can be uploaded into a buffer
+// sized by the prebuild info in place of a GPU build.
 void BuildRaytracingAccelerationStructureOnCpu(
     _In_  const D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC *pDesc,
     _Out_ void *pData);
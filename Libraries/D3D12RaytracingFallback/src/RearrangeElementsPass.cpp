@@ -44,12 +44,17 @@ namespace FallbackLayer
         D3D12_GPU_VIRTUAL_ADDRESS outputMetadataBuffer,
         D3D12_GPU_VIRTUAL_ADDRESS outputIndexBuffer)
     {
-        if (numTriangles == 0) return;
+        BatchedBuild build = { numTriangles, inputElements, inputMetadataBuffer, indexBuffer, outputTriangles, outputMetadataBuffer, outputIndexBuffer };
+        Rearrange(pCommandList, sceneType, 1, &build);
+    }
 
-        bool updatesAllowed = outputIndexBuffer != 0;
-        InputConstants constants = {};
-        constants.NumberOfTriangles = numTriangles;
-        constants.UpdatesAllowed = (UINT) (updatesAllowed);
+    void RearrangeElementsPass::Rearrange(
+        ID3D12GraphicsCommandList *pCommandList,
+        SceneType sceneType,
+        UINT numBuilds,
+        const BatchedBuild *pBuilds)
+    {
+        if (std::none_of(pBuilds, pBuilds + numBuilds, [](const BatchedBuild &build) { return build.numTriangles > 0; })) return;
 
         pCommandList->SetComputeRootSignature(m_pRootSignature);
         switch (sceneType)
@@ -64,23 +69,34 @@ namespace FallbackLayer
             assert(false);
         }
 
-        pCommandList->SetComputeRoot32BitConstants(InputRootConstants, SizeOfInUint32(InputConstants), &constants, 0);
-
-        pCommandList->SetComputeRootUnorderedAccessView(InputElements, inputElements);
-        pCommandList->SetComputeRootUnorderedAccessView(IndexBuffer, indexBuffer);
-        pCommandList->SetComputeRootUnorderedAccessView(OutputElements, outputTriangles);
-        if (inputMetadataBuffer)
+        for (UINT buildIndex = 0; buildIndex < numBuilds; buildIndex++)
         {
-            pCommandList->SetComputeRootUnorderedAccessView(InputMetadata, inputMetadataBuffer);
-            pCommandList->SetComputeRootUnorderedAccessView(OutputMetadata, outputMetadataBuffer);
-        }
-        if (updatesAllowed)
-        {
-            pCommandList->SetComputeRootUnorderedAccessView(OutputIndexBuffer, outputIndexBuffer);
-        }
+            const BatchedBuild &build = pBuilds[buildIndex];
+            if (build.numTriangles == 0) continue;
+
+            bool updatesAllowed = build.outputIndexBuffer != 0;
+            InputConstants constants = {};
+            constants.NumberOfTriangles = build.numTriangles;
+            constants.UpdatesAllowed = (UINT) (updatesAllowed);
 
-        const UINT dispatchWidth = DivideAndRoundUp<UINT>(numTriangles, THREAD_GROUP_1D_WIDTH);
-        pCommandList->Dispatch(dispatchWidth, 1, 1);
+            pCommandList->SetComputeRoot32BitConstants(InputRootConstants, SizeOfInUint32(InputConstants), &constants, 0);
+
+            pCommandList->SetComputeRootUnorderedAccessView(InputElements, build.inputElements);
+            pCommandList->SetComputeRootUnorderedAccessView(IndexBuffer, build.indexBuffer);
+            pCommandList->SetComputeRootUnorderedAccessView(OutputElements, build.outputTriangles);
+            if (build.inputMetadataBuffer)
+            {
+                pCommandList->SetComputeRootUnorderedAccessView(InputMetadata, build.inputMetadataBuffer);
+                pCommandList->SetComputeRootUnorderedAccessView(OutputMetadata, build.outputMetadataBuffer);
+            }
+            if (updatesAllowed)
+            {
+                pCommandList->SetComputeRootUnorderedAccessView(OutputIndexBuffer, build.outputIndexBuffer);
+            }
+
+            const UINT dispatchWidth = DivideAndRoundUp<UINT>(build.numTriangles, THREAD_GROUP_1D_WIDTH);
+            pCommandList->Dispatch(dispatchWidth, 1, 1);
+        }
 
         auto uavBarrier = CD3DX12_RESOURCE_BARRIER::UAV(nullptr);
         pCommandList->ResourceBarrier(1, &uavBarrier);
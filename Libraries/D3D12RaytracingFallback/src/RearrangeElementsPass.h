@@ -29,6 +29,25 @@ namespace FallbackLayer
             D3D12_GPU_VIRTUAL_ADDRESS outputIndexBuffer
         );
 
+        struct BatchedBuild
+        {
+            UINT numTriangles;
+            D3D12_GPU_VIRTUAL_ADDRESS inputElements;
+            D3D12_GPU_VIRTUAL_ADDRESS inputMetadataBuffer;
+            D3D12_GPU_VIRTUAL_ADDRESS indexBuffer;
+            D3D12_GPU_VIRTUAL_ADDRESS outputTriangles;
+            D3D12_GPU_VIRTUAL_ADDRESS outputMetadataBuffer;
+            D3D12_GPU_VIRTUAL_ADDRESS outputIndexBuffer;
+        };
+
+        // Rearranges the elements of every build in one dispatch each, behind a single barrier
+        void Rearrange(
+            ID3D12GraphicsCommandList *pCommandList,
+            SceneType sceneType,
+            UINT numBuilds,
+            const BatchedBuild *pBuilds
+        );
+
     private:
         enum RootParameterSlot
         {
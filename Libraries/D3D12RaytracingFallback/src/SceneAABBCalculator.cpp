@@ -35,7 +35,19 @@ namespace FallbackLayer
 
     void SceneAABBCalculator::CalculateSceneAABB(ID3D12GraphicsCommandList *pCommandList, SceneType sceneType, D3D12_GPU_VIRTUAL_ADDRESS inputBuffer, UINT numElements, D3D12_GPU_VIRTUAL_ADDRESS scratchBuffer, D3D12_GPU_VIRTUAL_ADDRESS outputAABB)
     {
-        if (numElements == 0) return;
+        BatchedBuild build = { inputBuffer, numElements, scratchBuffer, outputAABB };
+        CalculateSceneAABB(pCommandList, sceneType, 1, &build);
+    }
+
+    void SceneAABBCalculator::CalculateSceneAABB(ID3D12GraphicsCommandList *pCommandList, SceneType sceneType, UINT numBuilds, const BatchedBuild *pBuilds)
+    {
+        std::vector<UINT> elementsToProcess(numBuilds);
+        for (UINT buildIndex = 0; buildIndex < numBuilds; buildIndex++)
+        {
+            elementsToProcess[buildIndex] = pBuilds[buildIndex].numElements;
+        }
+        auto anyElementsToProcess = [&elementsToProcess]() { return std::any_of(elementsToProcess.begin(), elementsToProcess.end(), [](UINT count) { return count > 1; }); };
+        if (!anyElementsToProcess()) return;
 
         pCommandList->SetComputeRootSignature(m_pRootSignature);
         switch (sceneType)
@@ -51,34 +63,42 @@ namespace FallbackLayer
         }
 
         SceneAABBCalculatorConstants constants = {};
-        pCommandList->SetComputeRootUnorderedAccessView(InputBuffer, inputBuffer);
-
-        D3D12_GPU_VIRTUAL_ADDRESS scratchBuffers[2];
-        scratchBuffers[0] = scratchBuffer;
-        scratchBuffers[1] = scratchBuffer + GetNumAABBsOutputFromPass(numElements) * sizeof(AABB);
 
         UINT outputScratchBufferIndex = 0;
         UINT inputScratchBufferIndex = 1;
 
+        // Every build reduces a level per pass, so the ping-pong halves line up across the batch
         auto uavBarrier = CD3DX12_RESOURCE_BARRIER::UAV(nullptr);
-        UINT threadsNeeded;
-        UINT elementsToProcess = numElements;
-        for (; elementsToProcess > 1; elementsToProcess = threadsNeeded)
+        for (bool bFirstPass = true; anyElementsToProcess(); bFirstPass = false)
         {
-            threadsNeeded = GetNumAABBsOutputFromPass(elementsToProcess);
-
-            const bool bFirstPass = (elementsToProcess == numElements);
-            const bool bLastPass = (threadsNeeded == 1);
-
-            constants.NumberOfElements = elementsToProcess;
-            pCommandList->SetComputeRoot32BitConstants(InputConstants, SizeOfInUint32(constants), &constants, 0);
-            pCommandList->SetComputeRootUnorderedAccessView(OutputBuffer, bLastPass ? outputAABB : scratchBuffers[outputScratchBufferIndex]);
-            if (!bFirstPass)
+            for (UINT buildIndex = 0; buildIndex < numBuilds; buildIndex++)
             {
-                pCommandList->SetComputeRootUnorderedAccessView(InputAABBBuffer, scratchBuffers[inputScratchBufferIndex]);
+                const BatchedBuild &build = pBuilds[buildIndex];
+                if (elementsToProcess[buildIndex] <= 1) continue;
+
+                const UINT threadsNeeded = GetNumAABBsOutputFromPass(elementsToProcess[buildIndex]);
+                const bool bLastPass = (threadsNeeded == 1);
+
+                D3D12_GPU_VIRTUAL_ADDRESS scratchBuffers[2];
+                scratchBuffers[0] = build.scratchBuffer;
+                scratchBuffers[1] = build.scratchBuffer + GetNumAABBsOutputFromPass(build.numElements) * sizeof(AABB);
+
+                constants.NumberOfElements = elementsToProcess[buildIndex];
+                pCommandList->SetComputeRoot32BitConstants(InputConstants, SizeOfInUint32(constants), &constants, 0);
+                pCommandList->SetComputeRootUnorderedAccessView(OutputBuffer, bLastPass ? build.outputAABB : scratchBuffers[outputScratchBufferIndex]);
+                if (bFirstPass)
+                {
+                    pCommandList->SetComputeRootUnorderedAccessView(InputBuffer, build.inputBuffer);
+                }
+                else
+                {
+                    pCommandList->SetComputeRootUnorderedAccessView(InputAABBBuffer, scratchBuffers[inputScratchBufferIndex]);
+                }
+                const UINT dispatchWidth = DivideAndRoundUp<UINT>(threadsNeeded, THREAD_GROUP_1D_WIDTH);
+                pCommandList->Dispatch(dispatchWidth, 1, 1);
+
+                elementsToProcess[buildIndex] = threadsNeeded;
             }
-            const UINT dispatchWidth = DivideAndRoundUp<UINT>(threadsNeeded, THREAD_GROUP_1D_WIDTH);
-            pCommandList->Dispatch(dispatchWidth, 1, 1);
             pCommandList->ResourceBarrier(1, &uavBarrier);
 
             std::swap(outputScratchBufferIndex, inputScratchBufferIndex);
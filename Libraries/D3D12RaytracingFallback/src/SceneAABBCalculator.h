@@ -16,6 +16,17 @@ namespace FallbackLayer
     public:
         SceneAABBCalculator(ID3D12Device *pDevice, UINT nodeMask);
         void CalculateSceneAABB(ID3D12GraphicsCommandList *pCommandList, SceneType sceneType, D3D12_GPU_VIRTUAL_ADDRESS inputBuffer, UINT numElements, D3D12_GPU_VIRTUAL_ADDRESS scratchBuffer, D3D12_GPU_VIRTUAL_ADDRESS outputAABB);
+
+        struct BatchedBuild
+        {
+            D3D12_GPU_VIRTUAL_ADDRESS inputBuffer;
+            UINT numElements;
+            D3D12_GPU_VIRTUAL_ADDRESS scratchBuffer;
+            D3D12_GPU_VIRTUAL_ADDRESS outputAABB;
+        };
+
+        // Reduces every build a level at a time, sharing one barrier per level across the batch
+        void CalculateSceneAABB(ID3D12GraphicsCommandList *pCommandList, SceneType sceneType, UINT numBuilds, const BatchedBuild *pBuilds);
         static UINT ScratchBufferSizeNeeded(UINT numElements);
 
     private:
@@ -0,0 +1,118 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+#include "pch.h"
+
+namespace FallbackLayer
+{
+    static const UINT32 ShaderCacheFileVersion = 1;
+
+    struct ShaderCacheFileHeader
+    {
+        UINT32 Version;
+        UINT32 NumShaderInfos;
+        UINT64 Hash;
+        UINT64 LinkedShaderSize;
+    };
+
+    ShaderCache::ShaderCache()
+    {
+        wchar_t tempPath[MAX_PATH];
+        DWORD length = GetTempPathW(ARRAYSIZE(tempPath), tempPath);
+        if (length == 0 || length > ARRAYSIZE(tempPath))
+        {
+            return;
+        }
+
+        m_directory = std::wstring(tempPath) + L"D3D12RaytracingFallbackShaderCache\\";
+        if (!CreateDirectoryW(m_directory.c_str(), nullptr) && GetLastError() != ERROR_ALREADY_EXISTS)
+        {
+            m_directory.clear();
+            return;
+        }
+
+        // A different DxrFallbackCompiler.dll may link the same inputs differently
+        wchar_t compilerPath[MAX_PATH];
+        HMODULE compilerModule = GetModuleHandleW(L"DxrFallbackCompiler.dll");
+        WIN32_FILE_ATTRIBUTE_DATA compilerAttributes;
+        if (compilerModule &&
+            GetModuleFileNameW(compilerModule, compilerPath, ARRAYSIZE(compilerPath)) &&
+            GetFileAttributesExW(compilerPath, GetFileExInfoStandard, &compilerAttributes))
+        {
+            ShaderCacheKey compilerVersion;
+            compilerVersion.Append(compilerAttributes.ftLastWriteTime);
+            compilerVersion.Append(compilerAttributes.nFileSizeLow);
+            compilerVersion.Append(compilerAttributes.nFileSizeHigh);
+            m_compilerVersion = compilerVersion.GetHash();
+        }
+    }
+
+    std::wstring ShaderCache::GetFilePath(const ShaderCacheKey &key)
+    {
+        ShaderCacheKey fileKey = key;
+        fileKey.Append(m_compilerVersion);
+
+        wchar_t fileName[32];
+        StringCchPrintfW(fileName, ARRAYSIZE(fileName), L"%016llx.bin", fileKey.GetHash());
+        return m_directory + fileName;
+    }
+
+    bool ShaderCache::Load(const ShaderCacheKey &key, std::vector<DxcShaderInfo> &shaderInfo, std::vector<BYTE> &linkedShader)
+    {
+        if (m_directory.empty())
+        {
+            return false;
+        }
+
+        std::ifstream file(GetFilePath(key), std::ios::binary);
+        ShaderCacheFileHeader header;
+        if (!file.read((char *)&header, sizeof(header)) ||
+            header.Version != ShaderCacheFileVersion ||
+            header.Hash != key.GetHash())
+        {
+            return false;
+        }
+
+        shaderInfo.resize(header.NumShaderInfos);
+        linkedShader.resize((size_t)header.LinkedShaderSize);
+        return file.read((char *)shaderInfo.data(), shaderInfo.size() * sizeof(DxcShaderInfo)) &&
+            file.read((char *)linkedShader.data(), linkedShader.size());
+    }
+
+    void ShaderCache::Store(const ShaderCacheKey &key, const std::vector<DxcShaderInfo> &shaderInfo, const void *pLinkedShader, size_t linkedShaderSize)
+    {
+        if (m_directory.empty())
+        {
+            return;
+        }
+
+        // Written to a temporary file and renamed so another process never reads a partial entry
+        const std::wstring filePath = GetFilePath(key);
+        const std::wstring tempFilePath = filePath + L"." + std::to_wstring(GetCurrentProcessId()) + L".tmp";
+        {
+            std::ofstream file(tempFilePath, std::ios::binary | std::ios::trunc);
+            ShaderCacheFileHeader header = { ShaderCacheFileVersion, (UINT32)shaderInfo.size(), key.GetHash(), linkedShaderSize };
+            file.write((const char *)&header, sizeof(header));
+            file.write((const char *)shaderInfo.data(), shaderInfo.size() * sizeof(DxcShaderInfo));
+            file.write((const char *)pLinkedShader, linkedShaderSize);
+            if (!file)
+            {
+                file.close();
+                DeleteFileW(tempFilePath.c_str());
+                return;
+            }
+        }
+
+        if (!MoveFileExW(tempFilePath.c_str(), filePath.c_str(), MOVEFILE_REPLACE_EXISTING))
+        {
+            DeleteFileW(tempFilePath.c_str());
+        }
+    }
+}
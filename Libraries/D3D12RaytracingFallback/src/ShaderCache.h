@@ -0,0 +1,59 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+#pragma once
+
+namespace FallbackLayer
+{
+    // 64-bit FNV-1a over everything that goes into a compile
+    class ShaderCacheKey
+    {
+    public:
+        void Append(const void *pData, size_t size)
+        {
+            const BYTE *pBytes = (const BYTE *)pData;
+            for (size_t i = 0; i < size; i++)
+            {
+                m_hash = (m_hash ^ pBytes[i]) * 0x100000001b3ull;
+            }
+        }
+
+        template <typename T> void Append(const T &value) { Append(&value, sizeof(value)); }
+
+        void Append(LPCWSTR pString)
+        {
+            // The terminator keeps consecutive strings from running together
+            Append(pString, pString ? (wcslen(pString) + 1) * sizeof(wchar_t) : 0);
+        }
+
+        UINT64 GetHash() const { return m_hash; }
+
+    private:
+        UINT64 m_hash = 0xcbf29ce484222325ull;
+    };
+
+    // Keeps linked state object shaders on disk so later launches skip the DXIL patching and
+    // linking. Keys should cover every input to the compile; the compiler DLL version is folded
+    // in here.
+    class ShaderCache
+    {
+    public:
+        ShaderCache();
+
+        bool Load(const ShaderCacheKey &key, std::vector<DxcShaderInfo> &shaderInfo, std::vector<BYTE> &linkedShader);
+        void Store(const ShaderCacheKey &key, const std::vector<DxcShaderInfo> &shaderInfo, const void *pLinkedShader, size_t linkedShaderSize);
+
+    private:
+        std::wstring GetFilePath(const ShaderCacheKey &key);
+
+        std::wstring m_directory;
+        UINT64 m_compilerVersion = 0;
+    };
+}
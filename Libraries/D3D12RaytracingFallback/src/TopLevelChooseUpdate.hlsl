@@ -0,0 +1,37 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+#define HLSL
+#include "TopLevelUpdateBindings.h"
+#include "RayTracingHelper.hlsli"
+
+[numthreads(1, 1, 1)]
+void main()
+{
+    bool rebuild = true;
+    if (Constants.PerformUpdate)
+    {
+        // Costs are from the previous update, so a degraded hierarchy is
+        // traced with for at most one more update before it's rebuilt
+        float buildCost = outputBVH.Load(OffsetToBuildCost);
+        float refitCost = outputBVH.Load(OffsetToRefitCost);
+        rebuild = refitCost > buildCost * Constants.RebuildCostRatio;
+
+        // Predicates are 64 bits.
+        predicateBuffer.Store2(0, uint2(rebuild ? 1 : 0, 0));
+    }
+
+    if (rebuild)
+    {
+        outputBVH.Store(OffsetToBuildCost, 0);
+    }
+    outputBVH.Store(OffsetToRefitCost, 0);
+    outputBVH.Store(OffsetToIsRebuilt, rebuild ? 1 : 0);
+}
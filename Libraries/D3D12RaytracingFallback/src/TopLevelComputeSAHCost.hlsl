@@ -0,0 +1,49 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+#define HLSL
+#include "TopLevelUpdateBindings.h"
+#include "RayTracingHelper.hlsli"
+
+static const uint offsetToBoxes = SizeOfBVHOffsets;
+static const uint rootNodeIndex = 0;
+
+AABB GetNodeAABB(uint nodeIndex)
+{
+    return BoundingBoxToAABB(GetBoxFromBuffer(outputBVH, offsetToBoxes, nodeIndex));
+}
+
+[numthreads(THREAD_GROUP_1D_WIDTH, 1, 1)]
+void main(uint3 DTid : SV_DispatchThreadID)
+{
+    const uint NumberOfAABBs = GetNumInternalNodes(Constants.NumberOfElements) + Constants.NumberOfElements;
+
+    // Each node costs the chance that a ray through the root also
+    // hits it, which is the ratio of their surface areas
+    uint nodeCost = 0;
+    if (DTid.x < NumberOfAABBs)
+    {
+        const float rootSurfaceArea = ComputeBoxSurfaceArea(GetNodeAABB(rootNodeIndex));
+        if (rootSurfaceArea > 0.0)
+        {
+            nodeCost = (uint)(ComputeBoxSurfaceArea(GetNodeAABB(DTid.x)) / rootSurfaceArea * SAHCostScale);
+        }
+    }
+
+    const uint waveCost = WaveActiveSum(nodeCost);
+    if (WaveIsFirstLane())
+    {
+        outputBVH.InterlockedAdd(OffsetToRefitCost, waveCost);
+        if (outputBVH.Load(OffsetToIsRebuilt))
+        {
+            outputBVH.InterlockedAdd(OffsetToBuildCost, waveCost);
+        }
+    }
+}
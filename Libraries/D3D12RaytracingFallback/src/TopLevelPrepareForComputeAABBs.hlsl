@@ -29,13 +29,15 @@ void main(uint3 DTid : SV_DispatchThreadID)
     const uint offsetToBoxes = SizeOfBVHOffsets;
     const uint offsetToLeafNodes = GetOffsetToLeafNodeAABBs(Constants.NumberOfElements);
     const uint offsetToLeafNodeMetadata = offsetToLeafNodes + GetOffsetFromLeafNodesToBottomLevelMetadata(Constants.NumberOfElements);
-    const uint totalSize = offsetToLeafNodeMetadata + Constants.NumberOfElements * SizeOfBVHMetadata;
+    const uint offsetToWideNodes = offsetToLeafNodeMetadata + Constants.NumberOfElements * SizeOfBVHMetadata;
+    const uint totalSize = offsetToWideNodes + GetSizeOfWideNodes(Constants.NumberOfElements);
 
     if (DTid.x == 0)
     {
         outputBVH.Store(OffsetToBoxesOffset, offsetToBoxes);
         outputBVH.Store(OffsetToLeafNodeMetaDataOffset, offsetToLeafNodeMetadata);
         outputBVH.Store(OffsetToTotalSize, totalSize);
+        outputBVH.Store(OffsetToWideNodesOffset, offsetToWideNodes);
 
         if (IsEmptyAccelerationStructure)
         {
@@ -44,6 +46,9 @@ void main(uint3 DTid : SV_DispatchThreadID)
             boxData.halfDim = 0;
             uint2 flags = 0;
             WriteBoxToBuffer(outputBVH, offsetToBoxes, 0, boxData, flags);
+
+            // A wide root without children
+            outputBVH.Store4(offsetToWideNodes, uint4(0, 0, 0, 0));
             return;
         }
     }
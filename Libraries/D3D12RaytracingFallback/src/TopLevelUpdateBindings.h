@@ -0,0 +1,39 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+#pragma once
+#include "RaytracingHlslCompat.h"
+#ifdef HLSL
+#include "ShaderUtil.hlsli"
+#endif
+
+struct InputConstants
+{
+    uint NumberOfElements;
+    uint PerformUpdate;
+    float RebuildCostRatio;
+};
+
+// UAVs
+#define OutputBVHRegister 0
+#define PredicateBufferRegister 1
+
+// CBVs
+#define InputConstantsRegister 0
+
+#ifdef HLSL
+RWByteAddressBuffer outputBVH : UAV_REGISTER(OutputBVHRegister);
+RWByteAddressBuffer predicateBuffer : UAV_REGISTER(PredicateBufferRegister);
+
+cbuffer TopLevelUpdateConstants : CONSTANT_REGISTER(InputConstantsRegister)
+{
+    InputConstants Constants;
+};
+#endif
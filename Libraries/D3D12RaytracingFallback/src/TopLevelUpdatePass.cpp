@@ -0,0 +1,103 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+#include "pch.h"
+#include "TopLevelUpdateBindings.h"
+#include "CompiledShaders/TopLevelChooseUpdate.h"
+#include "CompiledShaders/TopLevelComputeSAHCost.h"
+
+namespace FallbackLayer
+{
+    TopLevelUpdatePass::TopLevelUpdatePass(ID3D12Device *pDevice, UINT nodeMask)
+    {
+        CD3DX12_ROOT_PARAMETER1 rootParameters[NumParameters];
+        rootParameters[OutputBVHParam].InitAsUnorderedAccessView(OutputBVHRegister);
+        rootParameters[PredicateBufferParam].InitAsUnorderedAccessView(PredicateBufferRegister);
+        rootParameters[InputRootConstants].InitAsConstants(SizeOfInUint32(InputConstants), InputConstantsRegister);
+
+        auto rootSignatureDesc = CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC(ARRAYSIZE(rootParameters), rootParameters);
+        CreateRootSignatureHelper(pDevice, rootSignatureDesc, &m_pRootSignature);
+
+        CreatePSOHelper(pDevice, nodeMask, m_pRootSignature, COMPILED_SHADER(g_pTopLevelChooseUpdate), &m_pChooseUpdatePSO);
+        CreatePSOHelper(pDevice, nodeMask, m_pRootSignature, COMPILED_SHADER(g_pTopLevelComputeSAHCost), &m_pComputeSAHCostPSO);
+
+        const D3D12_HEAP_PROPERTIES defaultHeapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT, nodeMask, nodeMask);
+        const D3D12_RESOURCE_DESC predicateBufferDesc = CD3DX12_RESOURCE_DESC::Buffer(sizeof(UINT64), D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+        ThrowInternalFailure(pDevice->CreateCommittedResource(&defaultHeapProperties, D3D12_HEAP_FLAG_NONE, &predicateBufferDesc, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, nullptr, IID_PPV_ARGS(&m_pPredicateBuffer)));
+    }
+
+    void TopLevelUpdatePass::SetRootArguments(
+        ID3D12GraphicsCommandList *pCommandList,
+        D3D12_GPU_VIRTUAL_ADDRESS outputBVH,
+        UINT numElements,
+        bool performUpdate,
+        float rebuildCostRatio)
+    {
+        InputConstants constants = {};
+        constants.NumberOfElements = numElements;
+        constants.PerformUpdate = performUpdate;
+        constants.RebuildCostRatio = rebuildCostRatio;
+
+        pCommandList->SetComputeRootSignature(m_pRootSignature);
+        pCommandList->SetComputeRoot32BitConstants(InputRootConstants, SizeOfInUint32(InputConstants), &constants, 0);
+        pCommandList->SetComputeRootUnorderedAccessView(OutputBVHParam, outputBVH);
+        pCommandList->SetComputeRootUnorderedAccessView(PredicateBufferParam, m_pPredicateBuffer->GetGPUVirtualAddress());
+    }
+
+    void TopLevelUpdatePass::ChooseUpdate(
+        ID3D12GraphicsCommandList *pCommandList,
+        D3D12_GPU_VIRTUAL_ADDRESS outputBVH,
+        bool performUpdate,
+        float rebuildCostRatio)
+    {
+        SetRootArguments(pCommandList, outputBVH, 0, performUpdate, rebuildCostRatio);
+        pCommandList->SetPipelineState(m_pChooseUpdatePSO);
+        pCommandList->Dispatch(1, 1, 1);
+
+        if (performUpdate)
+        {
+            D3D12_RESOURCE_BARRIER barriers[] = {
+                CD3DX12_RESOURCE_BARRIER::UAV(nullptr),
+                CD3DX12_RESOURCE_BARRIER::Transition(m_pPredicateBuffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_PREDICATION)
+            };
+            pCommandList->ResourceBarrier(ARRAYSIZE(barriers), barriers);
+        }
+    }
+
+    void TopLevelUpdatePass::PredicateOnChoice(ID3D12GraphicsCommandList *pCommandList, bool rebuild)
+    {
+        // The predicate is non-zero for a rebuild, and predication skips work when the op holds
+        pCommandList->SetPredication(m_pPredicateBuffer, 0, rebuild ? D3D12_PREDICATION_OP_EQUAL_ZERO : D3D12_PREDICATION_OP_NOT_EQUAL_ZERO);
+    }
+
+    void TopLevelUpdatePass::EndPredication(ID3D12GraphicsCommandList *pCommandList)
+    {
+        pCommandList->SetPredication(nullptr, 0, D3D12_PREDICATION_OP_EQUAL_ZERO);
+
+        auto transitionBarrier = CD3DX12_RESOURCE_BARRIER::Transition(m_pPredicateBuffer, D3D12_RESOURCE_STATE_PREDICATION, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+        pCommandList->ResourceBarrier(1, &transitionBarrier);
+    }
+
+    void TopLevelUpdatePass::ComputeSAHCost(
+        ID3D12GraphicsCommandList *pCommandList,
+        D3D12_GPU_VIRTUAL_ADDRESS outputBVH,
+        UINT numElements)
+    {
+        if (numElements == 0) return;
+
+        const UINT numNodes = numElements + GetNumberOfInternalNodes(numElements);
+        SetRootArguments(pCommandList, outputBVH, numElements, false, 0.0f);
+        pCommandList->SetPipelineState(m_pComputeSAHCostPSO);
+        pCommandList->Dispatch(DivideAndRoundUp<UINT>(numNodes, THREAD_GROUP_1D_WIDTH), 1, 1);
+
+        auto uavBarrier = CD3DX12_RESOURCE_BARRIER::UAV(nullptr);
+        pCommandList->ResourceBarrier(1, &uavBarrier);
+    }
+}
@@ -0,0 +1,62 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+#pragma once
+namespace FallbackLayer
+{
+    // Tracks the SAH cost of top levels that allow updates, and chooses on the GPU whether an update
+    // refits the hierarchy or rebuilds it. Both are recorded, predicated on the choice, so the CPU
+    // never waits to read it back.
+    class TopLevelUpdatePass
+    {
+    public:
+        TopLevelUpdatePass(ID3D12Device *pDevice, UINT nodeMask);
+
+        // Resets the costs the build measures. An update also chooses between a refit and a rebuild,
+        // which the predicate is left holding.
+        void ChooseUpdate(
+            ID3D12GraphicsCommandList *pCommandList,
+            D3D12_GPU_VIRTUAL_ADDRESS outputBVH,
+            bool performUpdate,
+            float rebuildCostRatio);
+
+        // Skips what's recorded next unless the last update chose a rebuild, or a refit
+        void PredicateOnChoice(ID3D12GraphicsCommandList *pCommandList, bool rebuild);
+        void EndPredication(ID3D12GraphicsCommandList *pCommandList);
+
+        void ComputeSAHCost(
+            ID3D12GraphicsCommandList *pCommandList,
+            D3D12_GPU_VIRTUAL_ADDRESS outputBVH,
+            UINT numElements);
+
+    private:
+        enum RootParameterSlot
+        {
+            OutputBVHParam = 0,
+            PredicateBufferParam,
+            InputRootConstants,
+            NumParameters
+        };
+
+        void SetRootArguments(
+            ID3D12GraphicsCommandList *pCommandList,
+            D3D12_GPU_VIRTUAL_ADDRESS outputBVH,
+            UINT numElements,
+            bool performUpdate,
+            float rebuildCostRatio);
+
+        CComPtr<ID3D12RootSignature> m_pRootSignature;
+        CComPtr<ID3D12PipelineState> m_pChooseUpdatePSO;
+        CComPtr<ID3D12PipelineState> m_pComputeSAHCostPSO;
+
+        // Each update writes the predicate and is done with it before the next, so one is enough
+        CComPtr<ID3D12Resource> m_pPredicateBuffer;
+    };
+}
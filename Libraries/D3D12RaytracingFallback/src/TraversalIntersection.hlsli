@@ -0,0 +1,403 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+#pragma once
+
+// Ray/box and ray/triangle tests shared by the traversal shader and the ray query functions
+// applications call from their own shaders. Nothing here reads ray state from the state machine,
+// so the ray flags and TMin are passed in.
+
+bool IsOpaque(bool geomOpaque, uint instanceFlags, uint rayFlags)
+{
+    bool opaque = geomOpaque;
+
+    if (instanceFlags & D3D12_RAYTRACING_INSTANCE_FLAG_FORCE_OPAQUE)
+        opaque = true;
+    else if (instanceFlags & D3D12_RAYTRACING_INSTANCE_FLAG_FORCE_NON_OPAQUE)
+        opaque = false;
+
+    if (rayFlags & D3D12_RAY_FLAG_FORCE_OPAQUE)
+        opaque = true;
+    else if (rayFlags & D3D12_RAY_FLAG_FORCE_NON_OPAQUE)
+        opaque = false;
+
+    return opaque;
+}
+
+bool Cull(bool opaque, uint rayFlags)
+{
+    return (opaque && (rayFlags & D3D12_RAY_FLAG_CULL_OPAQUE)) || (!opaque && (rayFlags & D3D12_RAY_FLAG_CULL_NON_OPAQUE));
+}
+
+//
+// Ray/AABB intersection, separating axes theorem
+//
+
+inline
+bool RayBoxTest(
+    out float resultT,
+    float closestT,
+    float3 rayOriginTimesRayInverseDirection,
+    float3 rayInverseDirection,
+    float3 boxCenter,
+    float3 boxHalfDim)
+{
+    const float3 relativeMiddle = boxCenter * rayInverseDirection - rayOriginTimesRayInverseDirection; // 3
+    const float3 maxL = relativeMiddle + boxHalfDim * abs(rayInverseDirection); // 3
+    const float3 minL = relativeMiddle - boxHalfDim * abs(rayInverseDirection); // 3
+
+    const float minT = max(max(minL.x, minL.y), minL.z); // 1
+    const float maxT = min(min(maxL.x, maxL.y), maxL.z); // 1
+
+    resultT = max(minT, 0);
+    return max(minT, 0) < min(maxT, closestT);
+}
+
+inline
+bool RayBoxTestMinMax(
+    out float resultT,
+    float closestT,
+    float3 rayOriginTimesRayInverseDirection,
+    float3 rayInverseDirection,
+    float3 boxMin,
+    float3 boxMax)
+{
+    const float3 t0 = boxMin * rayInverseDirection - rayOriginTimesRayInverseDirection;
+    const float3 t1 = boxMax * rayInverseDirection - rayOriginTimesRayInverseDirection;
+    const float3 minL = min(t0, t1);
+    const float3 maxL = max(t0, t1);
+
+    const float minT = max(max(minL.x, minL.y), minL.z);
+    const float maxT = min(min(maxL.x, maxL.y), maxL.z);
+
+    resultT = max(minT, 0);
+    return max(minT, 0) < min(maxT, closestT);
+}
+
+void SortChildrenByT(inout float childT[WIDE_NODE_MAX_CHILDREN], inout uint childReference[WIDE_NODE_MAX_CHILDREN], uint a, uint b)
+{
+    if (childT[b] < childT[a])
+    {
+        const float t = childT[a];
+        childT[a] = childT[b];
+        childT[b] = t;
+
+        const uint reference = childReference[a];
+        childReference[a] = childReference[b];
+        childReference[b] = reference;
+    }
+}
+
+float3 Swizzle(float3 v, int3 swizzleOrder)
+{
+    return float3(v[swizzleOrder.x], v[swizzleOrder.y], v[swizzleOrder.z]);
+}
+
+bool IsPositive(float f) { return f > 0.0f; }
+
+// Using Woop/Benthin/Wald 2013: "Watertight Ray/Triangle Intersection"
+inline
+void RayTriangleIntersect(
+    inout float hitT,
+    in uint instanceFlags,
+    in uint rayFlags,
+    out float2 bary,
+    float3 rayOrigin,
+    float3 rayDirection,
+    int3 swizzledIndicies,
+    float3 shear,
+    float3 v0,
+    float3 v1,
+    float3 v2)
+{
+    // Woop Triangle Intersection
+    bool useCulling = !(instanceFlags & D3D12_RAYTRACING_INSTANCE_FLAG_TRIANGLE_CULL_DISABLE);
+    bool flipFaces = instanceFlags & D3D12_RAYTRACING_INSTANCE_FLAG_TRIANGLE_FRONT_COUNTERCLOCKWISE;
+    uint backFaceCullingFlag = flipFaces ? D3D12_RAY_FLAG_CULL_FRONT_FACING_TRIANGLES : D3D12_RAY_FLAG_CULL_BACK_FACING_TRIANGLES;
+    uint frontFaceCullingFlag = flipFaces ? D3D12_RAY_FLAG_CULL_BACK_FACING_TRIANGLES : D3D12_RAY_FLAG_CULL_FRONT_FACING_TRIANGLES;
+    bool useBackfaceCulling = useCulling && (rayFlags & backFaceCullingFlag);
+    bool useFrontfaceCulling = useCulling && (rayFlags & frontFaceCullingFlag);
+
+    float3 A = Swizzle(v0 - rayOrigin, swizzledIndicies);
+    float3 B = Swizzle(v1 - rayOrigin, swizzledIndicies);
+    float3 C = Swizzle(v2 - rayOrigin, swizzledIndicies);
+
+    A.xy = A.xy - shear.xy * A.z;
+    B.xy = B.xy - shear.xy * B.z;
+    C.xy = C.xy - shear.xy * C.z;
+    precise float U = C.x * B.y - C.y * B.x;
+    precise float V = A.x * C.y - A.y * C.x;
+    precise float W = B.x * A.y - B.y * A.x;
+
+    float det = U + V + W;
+    if (useFrontfaceCulling)
+    {
+        if (U > 0.0f || V > 0.0f || W > 0.0f) return;
+    }
+    else if (useBackfaceCulling)
+    {
+        if (U < 0.0f || V < 0.0f || W < 0.0f) return;
+    }
+    else
+    {
+        if ((U < 0.0f || V < 0.0f || W < 0.0f) &&
+            (U > 0.0f || V > 0.0f || W > 0.0f)) return;
+    }
+
+    if (det == 0.0f) return;
+    A.z = shear.z * A.z;
+    B.z = shear.z * B.z;
+    C.z = shear.z * C.z;
+    const float T = U * A.z + V * B.z + W * C.z;
+
+    if (useFrontfaceCulling)
+    {
+        if (T > 0.0f || T < hitT * det)
+            return;
+    }
+    else if (useBackfaceCulling)
+    {
+        if (T < 0.0f || T > hitT * det)
+            return;
+    }
+    else
+    {
+        float signCorrectedT = abs(T);
+        if (IsPositive(T) != IsPositive(det))
+        {
+            signCorrectedT = -signCorrectedT;
+        }
+
+        if (signCorrectedT < 0.0f || signCorrectedT > hitT * abs(det))
+        {
+            return;
+        }
+    }
+
+    const float rcpDet = rcp(det);
+    bary.x = V * rcpDet;
+    bary.y = W * rcpDet;
+    hitT = T * rcpDet;
+}
+
+#define MULTIPLE_LEAVES_PER_NODE 0
+static
+bool TestLeafNodeIntersections(
+    RWByteAddressBufferPointer accelStruct,
+    TraversalOffsets offsets,
+    uint2 flags,
+    uint instanceFlags,
+    uint rayFlags,
+    float rayTMin,
+    float3 rayOrigin,
+    float3 rayDirection,
+    int3 swizzledIndicies,
+    float3 shear,
+    inout float2 resultBary,
+    inout float resultT,
+    inout uint resultTriId)
+{
+    // Intersect a bunch of triangles
+    const uint firstId = flags.x & 0x00ffffff;
+    const uint numTris = flags.y; // referencing AABBNode::numTriangles
+
+    // Unroll mildly, it'd be awesome if we had some helpers here to intersect.
+    uint i = 0;
+    bool bIsIntersect = false;
+#if MULTIPLE_LEAVES_PER_NODE
+    const uint evenTris = numTris & ~1;
+    for (i = 0; i < evenTris; i += 2)
+    {
+        const uint id0 = firstId + i;
+
+        const uint2 triIds = uint2(id0, id0 + 1);
+
+        // Read 3 vertices
+        // This is pumping too much via SQC
+        float3 v00, v01, v02;
+        float3 v10, v11, v12;
+        BVHReadTriangle(accelStruct, offsets, v00, v01, v02, triIds.x);
+        BVHReadTriangle(accelStruct, offsets, v10, v11, v12, triIds.y);
+
+        // Intersect
+        float2 bary0, bary1;
+        float t0 = resultT;
+        RayTriangleIntersect(
+            t0,
+            instanceFlags,
+            rayFlags,
+            bary0,
+            rayOrigin,
+            rayDirection,
+            swizzledIndicies,
+            shear,
+            v00, v01, v02);
+
+        float t1 = resultT;
+        RayTriangleIntersect(
+            t1,
+            instanceFlags,
+            rayFlags,
+            bary1,
+            rayOrigin,
+            rayDirection,
+            swizzledIndicies,
+            shear,
+            v10, v11, v12);
+
+        // Record nearest
+        if (t0 < resultT)
+        {
+            resultBary = bary0.xy;
+            resultT = t0;
+            resultTriId = triIds.x;
+            bIsIntersect = true;
+        }
+
+        if (t1 < resultT)
+        {
+            resultBary = bary1.xy;
+            resultT = t1;
+            resultTriId = triIds.y;
+            bIsIntersect = true;
+        }
+    }
+
+    if (numTris & 1)
+#endif
+    {
+        const uint triId0 = firstId + i;
+
+        // Read 3 vertices
+        float3 v0, v1, v2;
+        BVHReadTriangle(accelStruct, offsets, v0, v1, v2, triId0);
+
+        // Intersect
+        float2  bary0;
+        float t0 = resultT;
+        RayTriangleIntersect(
+            t0,
+            instanceFlags,
+            rayFlags,
+            bary0,
+            rayOrigin,
+            rayDirection,
+            swizzledIndicies,
+            shear,
+            v0, v1, v2);
+
+        // Record nearest
+        if (t0 < resultT && t0 > rayTMin)
+        {
+            resultBary = bary0.xy;
+            resultT = t0;
+            resultTriId = triId0;
+            bIsIntersect = true;
+        }
+    }
+    return bIsIntersect;
+}
+
+int GetIndexOfBiggestChannel(float3 vec)
+{
+    if (vec.x > vec.y && vec.x > vec.z)
+    {
+        return 0;
+    }
+    else if (vec.y > vec.z)
+    {
+        return 1;
+    }
+    else
+    {
+        return 2;
+    }
+}
+
+void swap(inout int a, inout int b)
+{
+    int temp = a;
+    a = b;
+    b = temp;
+}
+
+struct RayData
+{
+    // Precalculated Stuff for intersection tests
+    float3 InverseDirection;
+    float3 OriginTimesRayInverseDirection;
+    float3 Shear;
+    int3   SwizzledIndices;
+};
+
+RayData GetRayData(float3 rayOrigin, float3 rayDirection)
+{
+    RayData data;
+
+    // Precompute stuff
+    data.InverseDirection = rcp(rayDirection);
+    data.OriginTimesRayInverseDirection = rayOrigin * data.InverseDirection;
+
+    int zIndex = GetIndexOfBiggestChannel(abs(rayDirection));
+    data.SwizzledIndices = int3(
+        (zIndex + 1) % 3,
+        (zIndex + 2) % 3,
+        zIndex);
+
+    if (rayDirection[data.SwizzledIndices.z] < 0.0f) swap(data.SwizzledIndices.x, data.SwizzledIndices.y);
+
+    data.Shear = float3(
+        rayDirection[data.SwizzledIndices.x] / rayDirection[data.SwizzledIndices.z],
+        rayDirection[data.SwizzledIndices.y] / rayDirection[data.SwizzledIndices.z],
+        1.0 / rayDirection[data.SwizzledIndices.z]);
+
+    return data;
+}
+
+// Tests the ray against every child of a wide node. A child the ray misses gets FLT_MAX,
+// which sorts after every hit.
+void IntersectWideNodeChildren(
+    RWByteAddressBufferPointer bvh,
+    TraversalOffsets offsets,
+    uint wideNodeIndex,
+    RayData rayData,
+    float closestT,
+    out float childT[WIDE_NODE_MAX_CHILDREN],
+    out uint childReference[WIDE_NODE_MAX_CHILDREN])
+{
+    const uint wideNodeAddress = GetWideNodeAddress(offsets.offsetToWideNodes, wideNodeIndex);
+    const uint4 header = bvh.buffer.Load4(wideNodeAddress);
+    const uint4 childReferences = bvh.buffer.Load4(wideNodeAddress + 16);
+    const uint4 quantized0 = bvh.buffer.Load4(wideNodeAddress + 32);
+    const uint2 quantized1 = bvh.buffer.Load2(wideNodeAddress + 48);
+
+    const float3 origin = asfloat(header.xyz);
+    const float3 step = GetQuantizationStep(header.w);
+    const uint childCount = GetWideNodeChildCount(header.w);
+
+    [unroll]
+    for (uint i = 0; i < WIDE_NODE_MAX_CHILDREN; i++)
+    {
+        const float3 boxMin = DequantizePlanes(origin, step, quantized0.xyz, i);
+        const float3 boxMax = DequantizePlanes(origin, step, uint3(quantized0.w, quantized1), i);
+
+        float t = 0;
+        bool test = i < childCount && RayBoxTestMinMax(
+            t,
+            closestT,
+            rayData.OriginTimesRayInverseDirection,
+            rayData.InverseDirection,
+            boxMin,
+            boxMax);
+
+        childT[i] = test ? t : FLT_MAX;
+        childReference[i] = childReferences[i];
+    }
+}
@@ -12,6 +12,8 @@
 #define IGNORE      0
 #define ACCEPT      1
 
+#include "TraversalIntersection.hlsli"
+
 static
 uint    stack[TRAVERSAL_MAX_STACK_DEPTH];
 
@@ -116,23 +118,6 @@ void Fallback_AcceptHitAndEndSearch()
     Fallback_SetAnyHitResult(END_SEARCH);
 }
 
-bool IsOpaque(bool geomOpaque, uint instanceFlags, uint rayFlags)
-{
-    bool opaque = geomOpaque;
-
-    if (instanceFlags & INSTANCE_FLAG_FORCE_OPAQUE)
-        opaque = true;
-    else if (instanceFlags & INSTANCE_FLAG_FORCE_NON_OPAQUE)
-        opaque = false;
-
-    if (rayFlags & RAY_FLAG_FORCE_OPAQUE)
-        opaque = true;
-    else if (rayFlags & RAY_FLAG_FORCE_NON_OPAQUE)
-        opaque = false;
-
-    return opaque;
-}
-
 export int Fallback_ReportHit(float tHit, uint hitKind)
 {
     if (tHit < RayTMin() || Fallback_RayTCurrent() <= tHit)
@@ -166,256 +151,6 @@ void UpdateObjectSpaceProperties(float3 objectRayOrigin, float3 objectRayDirecti
     Fallback_SetObjectToWorld(objectToWorld);
 }
 
-//
-// Ray/AABB intersection, separating axes theorem
-//
-
-inline
-bool RayBoxTest(
-    out float resultT,
-    float closestT,
-    float3 rayOriginTimesRayInverseDirection,
-    float3 rayInverseDirection,
-    float3 boxCenter,
-    float3 boxHalfDim)
-{
-    const float3 relativeMiddle = boxCenter * rayInverseDirection - rayOriginTimesRayInverseDirection; // 3
-    const float3 maxL = relativeMiddle + boxHalfDim * abs(rayInverseDirection); // 3
-    const float3 minL = relativeMiddle - boxHalfDim * abs(rayInverseDirection); // 3
-
-    const float minT = max(max(minL.x, minL.y), minL.z); // 1
-    const float maxT = min(min(maxL.x, maxL.y), maxL.z); // 1
-
-    resultT = max(minT, 0);
-    return max(minT, 0) < min(maxT, closestT);
-}
-
-float3 Swizzle(float3 v, int3 swizzleOrder)
-{
-    return float3(v[swizzleOrder.x], v[swizzleOrder.y], v[swizzleOrder.z]);
-}
-
-bool IsPositive(float f) { return f > 0.0f; }
-
-// Using Woop/Benthin/Wald 2013: "Watertight Ray/Triangle Intersection"
-inline
-void RayTriangleIntersect(
-    inout float hitT,
-    in uint instanceFlags,
-    out float2 bary,
-    float3 rayOrigin,
-    float3 rayDirection,
-    int3 swizzledIndicies,
-    float3 shear,
-    float3 v0,
-    float3 v1,
-    float3 v2)
-{
-    // Woop Triangle Intersection
-    bool useCulling = !(instanceFlags & D3D12_RAYTRACING_INSTANCE_FLAG_TRIANGLE_CULL_DISABLE);
-    bool flipFaces = instanceFlags & D3D12_RAYTRACING_INSTANCE_FLAG_TRIANGLE_FRONT_COUNTERCLOCKWISE;
-    uint backFaceCullingFlag = flipFaces ? RAY_FLAG_CULL_FRONT_FACING_TRIANGLES : RAY_FLAG_CULL_BACK_FACING_TRIANGLES;
-    uint frontFaceCullingFlag = flipFaces ? RAY_FLAG_CULL_BACK_FACING_TRIANGLES : RAY_FLAG_CULL_FRONT_FACING_TRIANGLES;
-    bool useBackfaceCulling = useCulling && (RayFlags() & backFaceCullingFlag);
-    bool useFrontfaceCulling = useCulling && (RayFlags() & frontFaceCullingFlag);
-
-    float3 A = Swizzle(v0 - rayOrigin, swizzledIndicies);
-    float3 B = Swizzle(v1 - rayOrigin, swizzledIndicies);
-    float3 C = Swizzle(v2 - rayOrigin, swizzledIndicies);
-
-    A.xy = A.xy - shear.xy * A.z;
-    B.xy = B.xy - shear.xy * B.z;
-    C.xy = C.xy - shear.xy * C.z;
-    precise float U = C.x * B.y - C.y * B.x;
-    precise float V = A.x * C.y - A.y * C.x;
-    precise float W = B.x * A.y - B.y * A.x;
-
-    float det = U + V + W;
-    if (useFrontfaceCulling)
-    {
-        if (U > 0.0f || V > 0.0f || W > 0.0f) return;
-    }
-    else if (useBackfaceCulling)
-    {
-        if (U < 0.0f || V < 0.0f || W < 0.0f) return;
-    }
-    else
-    {
-        if ((U < 0.0f || V < 0.0f || W < 0.0f) &&
-            (U > 0.0f || V > 0.0f || W > 0.0f)) return;
-    }
-
-    if (det == 0.0f) return;
-    A.z = shear.z * A.z;
-    B.z = shear.z * B.z;
-    C.z = shear.z * C.z;
-    const float T = U * A.z + V * B.z + W * C.z;
-
-    if (useFrontfaceCulling)
-    {
-        if (T > 0.0f || T < hitT * det)
-            return;
-    }
-    else if (useBackfaceCulling)
-    {
-        if (T < 0.0f || T > hitT * det)
-            return;
-    }
-    else
-    {
-        float signCorrectedT = abs(T);
-        if (IsPositive(T) != IsPositive(det))
-        {
-            signCorrectedT = -signCorrectedT;
-        }
-
-        if (signCorrectedT < 0.0f || signCorrectedT > hitT * abs(det))
-        {
-            return;
-        }
-    }
-
-    const float rcpDet = rcp(det);
-    bary.x = V * rcpDet;
-    bary.y = W * rcpDet;
-    hitT = T * rcpDet;
-}
-
-#define MULTIPLE_LEAVES_PER_NODE 0
-static
-bool TestLeafNodeIntersections(
-    RWByteAddressBufferPointer accelStruct,
-    uint2 flags,
-    uint instanceFlags,
-    float3 rayOrigin,
-    float3 rayDirection,
-    int3 swizzledIndicies,
-    float3 shear,
-    inout float2 resultBary,
-    inout float resultT,
-    inout uint resultTriId)
-{
-    // Intersect a bunch of triangles
-    const uint firstId = flags.x & 0x00ffffff;
-    const uint numTris = flags.y; // referencing AABBNode::numTriangles
-
-    // Unroll mildly, it'd be awesome if we had some helpers here to intersect.
-    uint i = 0;
-    bool bIsIntersect = false;
-#if MULTIPLE_LEAVES_PER_NODE
-    const uint evenTris = numTris & ~1;
-    for (i = 0; i < evenTris; i += 2)
-    {
-        const uint id0 = firstId + i;
-
-        const uint2 triIds = uint2(id0, id0 + 1);
-
-        // Read 3 vertices
-        // This is pumping too much via SQC
-        float3 v00, v01, v02;
-        float3 v10, v11, v12;
-        BVHReadTriangle(accelStruct, v00, v01, v02, triIds.x);
-        BVHReadTriangle(accelStruct, v10, v11, v12, triIds.y);
-
-        // Intersect
-        float2 bary0, bary1;
-        float t0 = resultT;
-        RayTriangleIntersect(
-            t0,
-            instanceFlags,
-            bary0,
-            rayOrigin,
-            rayDirection,
-            swizzledIndicies,
-            shear,
-            v00, v01, v02);
-
-        float t1 = resultT;
-        RayTriangleIntersect(
-            t1,
-            instanceFlags,
-            bary1,
-            rayOrigin,
-            rayDirection,
-            swizzledIndicies,
-            shear,
-            v10, v11, v12);
-
-        // Record nearest
-        if (t0 < resultT)
-        {
-            resultBary = bary0.xy;
-            resultT = t0;
-            resultTriId = triIds.x;
-            bIsIntersect = true;
-        }
-
-        if (t1 < resultT)
-        {
-            resultBary = bary1.xy;
-            resultT = t1;
-            resultTriId = triIds.y;
-            bIsIntersect = true;
-        }
-    }
-
-    if (numTris & 1)
-#endif
-    {
-        const uint triId0 = firstId + i;
-
-        // Read 3 vertices
-        float3 v0, v1, v2;
-        BVHReadTriangle(accelStruct, v0, v1, v2, triId0);
-
-        // Intersect
-        float2  bary0;
-        float t0 = resultT;
-        RayTriangleIntersect(
-            t0,
-            instanceFlags,
-            bary0,
-            rayOrigin,
-            rayDirection,
-            swizzledIndicies,
-            shear,
-            v0, v1, v2);
-
-        // Record nearest
-        if (t0 < resultT && t0 > RayTMin())
-        {
-            resultBary = bary0.xy;
-            resultT = t0;
-            resultTriId = triId0;
-            bIsIntersect = true;
-        }
-    }
-    return bIsIntersect;
-}
-
-int GetIndexOfBiggestChannel(float3 vec)
-{
-    if (vec.x > vec.y && vec.x > vec.z)
-    {
-        return 0;
-    }
-    else if (vec.y > vec.z)
-    {
-        return 1;
-    }
-    else
-    {
-        return 2;
-    }
-}
-
-void swap(inout int a, inout int b)
-{
-    int temp = a;
-    a = b;
-    b = temp;
-}
-
 #define TOP_LEVEL_INDEX 0
 #define BOTTOM_LEVEL_INDEX 1
 #define NUM_BVH_LEVELS 2
@@ -426,44 +161,6 @@ struct HitData
     uint PrimitiveIndex;
 };
 
-struct RayData
-{
-    // Precalculated Stuff for intersection tests
-    float3 InverseDirection;
-    float3 OriginTimesRayInverseDirection;
-    float3 Shear;
-    int3   SwizzledIndices;
-};
-
-RayData GetRayData(float3 rayOrigin, float3 rayDirection)
-{
-    RayData data;
-
-    // Precompute stuff
-    data.InverseDirection = rcp(rayDirection);
-    data.OriginTimesRayInverseDirection = rayOrigin * data.InverseDirection;
-
-    int zIndex = GetIndexOfBiggestChannel(abs(rayDirection));
-    data.SwizzledIndices = int3(
-        (zIndex + 1) % 3,
-        (zIndex + 2) % 3,
-        zIndex);
-
-    if (rayDirection[data.SwizzledIndices.z] < 0.0f) swap(data.SwizzledIndices.x, data.SwizzledIndices.y);
-
-    data.Shear = float3(
-        rayDirection[data.SwizzledIndices.x] / rayDirection[data.SwizzledIndices.z],
-        rayDirection[data.SwizzledIndices.y] / rayDirection[data.SwizzledIndices.z],
-        1.0 / rayDirection[data.SwizzledIndices.z]);
-
-    return data;
-}
-
-bool Cull(bool opaque, uint rayFlags)
-{
-    return (opaque && (rayFlags & RAY_FLAG_CULL_OPAQUE)) || (!opaque && (rayFlags & RAY_FLAG_CULL_NON_OPAQUE));
-}
-
 float ComputeCullFaceDir(uint instanceFlags, uint rayFlags)
 {
     float cullFaceDir = 0;
@@ -542,7 +239,9 @@ bool Traverse(
     nodesToProcess[TOP_LEVEL_INDEX] = 0;
 
     RWByteAddressBufferPointer topLevelAccelerationStructure = CreateRWByteAddressBufferPointerFromGpuVA(TopLevelAccelerationStructureGpuVA);
-    uint offsetToInstanceDescs = GetOffsetToInstanceDesc(topLevelAccelerationStructure);
+    const TraversalOffsets topLevelOffsets = LoadTraversalOffsets(topLevelAccelerationStructure);
+    uint offsetToInstanceDescs = topLevelOffsets.offsetToPrimitives;
+    TraversalOffsets currentOffsets = topLevelOffsets;
 
     RWByteAddressBufferPointer currentBVH = CreateRWByteAddressBufferPointerFromGpuVA(currentGpuVA);
     uint2 flags;
@@ -583,16 +282,12 @@ bool Traverse(
 
             RWByteAddressBufferPointer currentBVH = CreateRWByteAddressBufferPointerFromGpuVA(currentGpuVA);
 
-            uint2 flags;
-
-            BoundingBox box = BVHReadBoundingBox(
-                currentBVH,
-                thisNodeIndex,
-                flags);
+            // The stack holds wide node indices, and leaves by their flags
+            uint2 flags = GetLeafFlagsFromReference(thisNodeIndex);
 
             {
                 MARK(4, 0);
-                if (IsLeaf(flags))
+                if (IsLeafReference(thisNodeIndex))
                 {
                     MARK(5, 0);
                     if (!GetBoolFlag(flagContainer, ProcessingBottomLevel))
@@ -615,6 +310,7 @@ bool Traverse(
                             SetBoolFlag(flagContainer, ProcessingBottomLevel, true);
                             StackPush(stackPointer, 0, currentLevel + 1, GI);
                             currentGpuVA = instanceDesc.AccelerationStructure;
+                            currentOffsets = LoadTraversalOffsets(CreateRWByteAddressBufferPointerFromGpuVA(currentGpuVA));
                             instanceFlags = GetInstanceFlags(instanceDesc);
 
                             float3x4 CurrentWorldToObject = CreateMatrix(instanceDesc.Transform);
@@ -635,10 +331,9 @@ bool Traverse(
                     else // if it's a bottom level
                     {
                         MARK(8, 0);
-                        
-                        RWByteAddressBufferPointer bottomLevelAccelerationStructure = CreateRWByteAddressBufferPointerFromGpuVA(currentGpuVA);
+
                         const uint leafIndex = GetLeafIndexFromFlag(flags);
-                        PrimitiveMetaData primitiveMetadata = BVHReadPrimitiveMetaData(bottomLevelAccelerationStructure, leafIndex);
+                        PrimitiveMetaData primitiveMetadata = BVHReadPrimitiveMetaData(currentBVH, currentOffsets, leafIndex);
 
                         bool geomOpaque = primitiveMetadata.GeometryFlags & D3D12_RAYTRACING_GEOMETRY_FLAG_OPAQUE;
                         bool opaque = IsOpaque(geomOpaque, instanceFlags, RayFlags());
@@ -671,8 +366,11 @@ bool Traverse(
                         }
                         else if (!culled && TestLeafNodeIntersections( // TODO: We need to break out this function so we can run anyhit on each triangle
                             currentBVH,
+                            currentOffsets,
                             flags,
                             instanceFlags,
+                            RayFlags(),
+                            RayTMin(),
                             ObjectRayOrigin(),
                             ObjectRayDirection(),
                             currentRayData.SwizzledIndices,
@@ -737,51 +435,35 @@ bool Traverse(
                 else
                 {
                     MARK(9, 0);
-                    const uint leftChildIndex = GetLeftNodeIndex(flags);
-                    const uint rightChildIndex = GetRightNodeIndex(flags);
-
-                    float resultT = RayTCurrent();
-                    uint2 flags;
-                    float leftT, rightT;
-                    BoundingBox leftBox = BVHReadBoundingBox(
-                        currentBVH,
-                        leftChildIndex,
-                        flags);
-
-                    BoundingBox rightBox = BVHReadBoundingBox(
-                        currentBVH,
-                        rightChildIndex,
-                        flags);
-
-                    bool leftTest = RayBoxTest(
-                        leftT,
-                        resultT,
-                        currentRayData.OriginTimesRayInverseDirection,
-                        currentRayData.InverseDirection,
-                        leftBox.center,
-                        leftBox.halfDim);
-
-                    bool rightTest = RayBoxTest(
-                        rightT,
-                        resultT,
-                        currentRayData.OriginTimesRayInverseDirection,
-                        currentRayData.InverseDirection,
-                        rightBox.center,
-                        rightBox.halfDim);
-
-                    RecordClosestBox(currentLevel, leftTest, leftT, rightTest, rightT, closestBoxT);
-                    bool isBottomLevel = GetBoolFlag(flagContainer, ProcessingBottomLevel);
-                    if (leftTest && rightTest)
+                    float childT[WIDE_NODE_MAX_CHILDREN];
+                    uint childReference[WIDE_NODE_MAX_CHILDREN];
+                    IntersectWideNodeChildren(currentBVH, currentOffsets, thisNodeIndex, currentRayData, RayTCurrent(), childT, childReference);
+
+                    [unroll]
+                    for (uint i = 0; i < WIDE_NODE_MAX_CHILDREN; i++)
                     {
-                        // If equal, traverse the left side first since it's encoded to have less triangles
-                        bool traverseRightSideFirst = rightT < leftT;
-                        StackPush2(stackPointer, traverseRightSideFirst, leftChildIndex, rightChildIndex, currentLevel + 1, GI);
-                        nodesToProcess[isBottomLevel] += 2;
+                        bool test = childT[i] != FLT_MAX;
+                        bool unused = false;
+                        RecordClosestBox(currentLevel, test, childT[i], unused, 0, closestBoxT);
+                        childT[i] = test ? childT[i] : FLT_MAX;
                     }
-                    else if (leftTest || rightTest)
+
+                    SortChildrenByT(childT, childReference, 0, 1);
+                    SortChildrenByT(childT, childReference, 2, 3);
+                    SortChildrenByT(childT, childReference, 0, 2);
+                    SortChildrenByT(childT, childReference, 1, 3);
+                    SortChildrenByT(childT, childReference, 1, 2);
+
+                    // Push the farthest first so the nearest is popped next
+                    bool isBottomLevel = GetBoolFlag(flagContainer, ProcessingBottomLevel);
+                    [unroll]
+                    for (int j = WIDE_NODE_MAX_CHILDREN - 1; j >= 0; j--)
                     {
-                        StackPush(stackPointer, rightTest ? rightChildIndex : leftChildIndex, currentLevel + 1, GI);
-                        nodesToProcess[isBottomLevel] += 1;
+                        if (childT[j] != FLT_MAX)
+                        {
+                            StackPush(stackPointer, childReference[j], currentLevel + 1, GI);
+                            nodesToProcess[isBottomLevel] += 1;
+                        }
                     }
                 }
             }
@@ -789,6 +471,7 @@ bool Traverse(
         SetBoolFlag(flagContainer, ProcessingBottomLevel, false);
         currentRayData = GetRayData(WorldRayOrigin(), WorldRayDirection());
         currentGpuVA = TopLevelAccelerationStructureGpuVA;
+        currentOffsets = topLevelOffsets;
     } 
     MARK(10,0);
     bool isHit = Fallback_InstanceIndex() != NO_HIT_SENTINEL;
@@ -797,3 +480,192 @@ bool Traverse(
 #endif
     return isHit;   
 }
+
+//
+// Occlusion rays only ask whether anything lies along the ray. Every hit is opaque and accepted,
+// no closest hit shader runs and nothing about the hit is read afterwards, so children are visited
+// in the order they're stored and the first triangle hit ends the search without being committed.
+//
+
+#define OCCLUSION_RAY_FLAGS (RAY_FLAG_ACCEPT_FIRST_HIT_AND_END_SEARCH | RAY_FLAG_FORCE_OPAQUE | RAY_FLAG_SKIP_CLOSEST_HIT_SHADER)
+
+bool IsOcclusionRay(uint rayFlags)
+{
+    return (rayFlags & OCCLUSION_RAY_FLAGS) == OCCLUSION_RAY_FLAGS;
+}
+
+bool TraverseOcclusion(
+    uint InstanceInclusionMask,
+    uint RayContributionToHitGroupIndex,
+    uint MultiplierForGeometryContributionToHitGroupIndex
+)
+{
+    // Forcing everything opaque makes culling opaque geometry cull all of it
+    if (Cull(true, RayFlags()))
+    {
+        return false;
+    }
+
+    uint GI = Fallback_GroupIndex();
+    RayData currentRayData = GetRayData(WorldRayOrigin(), WorldRayDirection());
+
+    bool processingBottomLevel = false;
+    uint nodesToProcess[NUM_BVH_LEVELS];
+    GpuVA currentGpuVA = TopLevelAccelerationStructureGpuVA;
+    uint instanceIndex = 0;
+    uint instanceFlags = 0;
+    uint instanceOffset = 0;
+    uint instanceId = 0;
+
+    uint stackPointer = 0;
+    nodesToProcess[TOP_LEVEL_INDEX] = 0;
+
+    RWByteAddressBufferPointer topLevelAccelerationStructure = CreateRWByteAddressBufferPointerFromGpuVA(TopLevelAccelerationStructureGpuVA);
+    const TraversalOffsets topLevelOffsets = LoadTraversalOffsets(topLevelAccelerationStructure);
+    uint offsetToInstanceDescs = topLevelOffsets.offsetToPrimitives;
+    TraversalOffsets currentOffsets = topLevelOffsets;
+
+    uint2 flags;
+    float unusedT;
+    BoundingBox topLevelBox = BVHReadBoundingBox(
+        topLevelAccelerationStructure,
+        0,
+        flags);
+
+    if (RayBoxTest(unusedT,
+        Fallback_RayTCurrent(),
+        currentRayData.OriginTimesRayInverseDirection,
+        currentRayData.InverseDirection,
+        topLevelBox.center,
+        topLevelBox.halfDim))
+    {
+        StackPush(stackPointer, 0, 0, GI);
+        nodesToProcess[TOP_LEVEL_INDEX]++;
+    }
+
+    int NO_HIT_SENTINEL = ~0;
+    Fallback_SetInstanceIndex(NO_HIT_SENTINEL);
+
+    while (nodesToProcess[TOP_LEVEL_INDEX] != 0)
+    {
+        do
+        {
+            uint unusedLevel;
+            uint thisNodeIndex = StackPop(stackPointer, unusedLevel, GI);
+            nodesToProcess[processingBottomLevel]--;
+
+            RWByteAddressBufferPointer currentBVH = CreateRWByteAddressBufferPointerFromGpuVA(currentGpuVA);
+            uint2 flags = GetLeafFlagsFromReference(thisNodeIndex);
+
+            if (IsLeafReference(thisNodeIndex))
+            {
+                if (!processingBottomLevel)
+                {
+                    BVHMetadata metadata = GetBVHMetadataFromLeafIndex(
+                        topLevelAccelerationStructure,
+                        offsetToInstanceDescs,
+                        GetLeafIndexFromFlag(flags));
+                    RaytracingInstanceDesc instanceDesc = metadata.instanceDesc;
+
+                    if (GetInstanceMask(instanceDesc) & InstanceInclusionMask)
+                    {
+                        processingBottomLevel = true;
+                        StackPush(stackPointer, 0, 0, GI);
+                        nodesToProcess[BOTTOM_LEVEL_INDEX] = 1;
+
+                        currentGpuVA = instanceDesc.AccelerationStructure;
+                        currentOffsets = LoadTraversalOffsets(CreateRWByteAddressBufferPointerFromGpuVA(currentGpuVA));
+                        instanceIndex = metadata.InstanceIndex;
+                        instanceOffset = GetInstanceContributionToHitGroupIndex(instanceDesc);
+                        instanceId = GetInstanceID(instanceDesc);
+                        instanceFlags = GetInstanceFlags(instanceDesc);
+
+                        float3x4 CurrentWorldToObject = CreateMatrix(instanceDesc.Transform);
+                        float3x4 CurrentObjectToWorld = CreateMatrix(metadata.ObjectToWorld);
+
+                        float3 objectSpaceOrigin = mul(CurrentWorldToObject, float4(WorldRayOrigin(), 1));
+                        float3 objectSpaceDirection = mul(CurrentWorldToObject, float4(WorldRayDirection(), 0));
+
+                        currentRayData = GetRayData(
+                            objectSpaceOrigin,
+                            objectSpaceDirection);
+
+                        UpdateObjectSpaceProperties(objectSpaceOrigin, objectSpaceDirection, CurrentWorldToObject, CurrentObjectToWorld);
+                    }
+                }
+                else
+                {
+                    bool isProceduralGeometry = IsProceduralGeometry(flags);
+#ifdef DISABLE_PROCEDURAL_GEOMETRY
+                    isProceduralGeometry = false;
+#endif
+                    if (isProceduralGeometry)
+                    {
+                        // The intersection shader reports the hit, which commits it without an any hit shader
+                        PrimitiveMetaData primitiveMetadata = BVHReadPrimitiveMetaData(currentBVH, currentOffsets, GetLeafIndexFromFlag(flags));
+                        uint hitGroupRecordOffset =
+                            HitGroupShaderRecordStride * (RayContributionToHitGroupIndex +
+                            primitiveMetadata.GeometryContributionToHitGroupIndex * MultiplierForGeometryContributionToHitGroupIndex +
+                            instanceOffset);
+
+                        Fallback_SetPendingCustomVals(hitGroupRecordOffset, primitiveMetadata.PrimitiveIndex, instanceIndex, instanceId);
+                        uint intersectionStateId, anyHitStateId;
+                        GetAnyHitAndIntersectionStateId(HitGroupShaderTable, hitGroupRecordOffset, anyHitStateId, intersectionStateId);
+
+                        Fallback_SetAnyHitStateId(anyHitStateId);
+                        Fallback_SetAnyHitResult(ACCEPT);
+                        Fallback_CallIndirect(intersectionStateId);
+                        if (Fallback_InstanceIndex() != NO_HIT_SENTINEL)
+                        {
+                            return true;
+                        }
+                    }
+                    else
+                    {
+                        float resultT = Fallback_RayTCurrent();
+                        float2 unusedBary = 0;
+                        uint unusedTriId = 0;
+                        if (TestLeafNodeIntersections(
+                            currentBVH,
+                            currentOffsets,
+                            flags,
+                            instanceFlags,
+                            RayFlags(),
+                            RayTMin(),
+                            ObjectRayOrigin(),
+                            ObjectRayDirection(),
+                            currentRayData.SwizzledIndices,
+                            currentRayData.Shear,
+                            unusedBary,
+                            resultT,
+                            unusedTriId))
+                        {
+                            return true;
+                        }
+                    }
+                }
+            }
+            else
+            {
+                float childT[WIDE_NODE_MAX_CHILDREN];
+                uint childReference[WIDE_NODE_MAX_CHILDREN];
+                IntersectWideNodeChildren(currentBVH, currentOffsets, thisNodeIndex, currentRayData, RayTCurrent(), childT, childReference);
+
+                [unroll]
+                for (uint i = 0; i < WIDE_NODE_MAX_CHILDREN; i++)
+                {
+                    if (childT[i] != FLT_MAX)
+                    {
+                        StackPush(stackPointer, childReference[i], 0, GI);
+                        nodesToProcess[processingBottomLevel] += 1;
+                    }
+                }
+            }
+        } while (nodesToProcess[processingBottomLevel] != 0);
+        processingBottomLevel = false;
+        currentRayData = GetRayData(WorldRayOrigin(), WorldRayDirection());
+        currentGpuVA = TopLevelAccelerationStructureGpuVA;
+        currentOffsets = topLevelOffsets;
+    }
+    return false;
+}
@@ -17,6 +17,9 @@
 #include "RayTracingHelper.hlsli"
 #include "EmulatedPointerIntrinsics.hlsli"
 #include "TraverseFunction.hlsli"
+#ifdef SHORT_STACK_TRAVERSAL
+#include "TraverseShortStack.hlsli"
+#endif
 
 SHADER_internal
 export void Fallback_TraceRay(
@@ -38,11 +41,33 @@ export void Fallback_TraceRay(
     LogTraceRayStart();
     uint oldPayloadOffset = Fallback_TraceRayBegin(rayFlags, float3(originX, originY, originZ), tMin, float3(directionX, directionY, directionZ), tMax, payloadOffset);
     
-    bool hit = Traverse(
+    // The uber shader compiles a single program, so the occlusion path is picked per ray
+    bool hit;
+#ifdef SHORT_STACK_TRAVERSAL
+    // The occlusion path keeps a full stack, which would cost the registers the short stack saves
+    hit = TraverseShortStack(
         instanceInclusionMask,
         rayContributionToHitGroupIndex,
         multiplierForGeometryContributionToHitGroupIndex
     );
+#else
+    if (IsOcclusionRay(rayFlags))
+    {
+        hit = TraverseOcclusion(
+            instanceInclusionMask,
+            rayContributionToHitGroupIndex,
+            multiplierForGeometryContributionToHitGroupIndex
+        );
+    }
+    else
+    {
+        hit = Traverse(
+            instanceInclusionMask,
+            rayContributionToHitGroupIndex,
+            multiplierForGeometryContributionToHitGroupIndex
+        );
+    }
+#endif
 
     uint stateID;
     if (hit)
@@ -0,0 +1,342 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+//
+// Traversal with a short stack of SHORT_STACK_SIZE entries in place of the full stack, for the
+// registers and occupancy it saves. A push onto a full stack overwrites the oldest entry, which is
+// the last node in visiting order. Once a level's stack runs dry having lost entries, the next node
+// is found again by walking the wide nodes' parent links up from the last node visited.
+//
+// Children are visited in order of a key made of their entry t and their slot, so that the walk
+// back up can tell which siblings come after a node without any state of its own.
+//
+
+#define SHORT_STACK_MASK (SHORT_STACK_SIZE - 1)
+
+// Names the root of the level being traversed
+#define ROOT_ENTRY 0xffffffff
+#define NO_CHILD_KEY 0xffffffff
+
+static
+uint shortStack[SHORT_STACK_SIZE];
+
+// Entries name a node by the wide node holding it and its slot there
+uint MakeEntry(uint parentIndex, uint slot)
+{
+    return (parentIndex << 2) | slot;
+}
+
+// The entry t keeps its order as a uint, as it's never negative
+uint GetChildKey(float childT, uint slot)
+{
+    return (asuint(childT) & ~3u) | slot;
+}
+
+uint GetEntryReference(RWByteAddressBufferPointer bvh, TraversalOffsets offsets, uint entry)
+{
+    if (entry == ROOT_ENTRY)
+    {
+        return 0;
+    }
+
+    const uint wideNodeAddress = GetWideNodeAddress(offsets.offsetToWideNodes, entry >> 2);
+    return bvh.buffer.Load(wideNodeAddress + 16 + (entry & 3) * 4);
+}
+
+uint GetParentEntry(RWByteAddressBufferPointer bvh, TraversalOffsets offsets, uint wideNodeIndex)
+{
+    const uint wideNodeAddress = GetWideNodeAddress(offsets.offsetToWideNodes, wideNodeIndex);
+    const uint2 parentLink = bvh.buffer.Load2(wideNodeAddress + 56);
+    return parentLink.x == ~0 ? ROOT_ENTRY : MakeEntry(parentLink.x, parentLink.y);
+}
+
+void ShortStackPush(inout uint stackTop, inout uint nodesToProcess[NUM_BVH_LEVELS], inout uint droppedLevels, uint entry, uint level)
+{
+    if (nodesToProcess[TOP_LEVEL_INDEX] + nodesToProcess[BOTTOM_LEVEL_INDEX] == SHORT_STACK_SIZE)
+    {
+        // The top level's entries are all older than the bottom level's
+        const uint oldestLevel = nodesToProcess[TOP_LEVEL_INDEX] != 0 ? TOP_LEVEL_INDEX : BOTTOM_LEVEL_INDEX;
+        nodesToProcess[oldestLevel]--;
+        droppedLevels |= 1 << oldestLevel;
+    }
+
+    shortStack[stackTop & SHORT_STACK_MASK] = entry;
+    stackTop++;
+    nodesToProcess[level]++;
+}
+
+uint ShortStackPop(inout uint stackTop, inout uint nodesToProcess[NUM_BVH_LEVELS], uint level)
+{
+    stackTop--;
+    nodesToProcess[level]--;
+    return shortStack[stackTop & SHORT_STACK_MASK];
+}
+
+// Finds the node visited after the subtree at entry, or returns false if the level is done
+bool FindNextEntry(RWByteAddressBufferPointer bvh, TraversalOffsets offsets, RayData rayData, uint entry, out uint nextEntry)
+{
+    nextEntry = ROOT_ENTRY;
+    while (entry != ROOT_ENTRY)
+    {
+        const uint parentIndex = entry >> 2;
+        const uint slot = entry & 3;
+
+        // Unbounded so the node itself is hit again, whatever has been hit since
+        float childT[WIDE_NODE_MAX_CHILDREN];
+        uint childReference[WIDE_NODE_MAX_CHILDREN];
+        IntersectWideNodeChildren(bvh, offsets, parentIndex, rayData, FLT_MAX, childT, childReference);
+
+        const uint currentKey = GetChildKey(childT[slot], slot);
+        uint nextKey = NO_CHILD_KEY;
+
+        [unroll]
+        for (uint i = 0; i < WIDE_NODE_MAX_CHILDREN; i++)
+        {
+            const uint key = GetChildKey(childT[i], i);
+            if (childT[i] != FLT_MAX && childT[i] < RayTCurrent() && key > currentKey)
+            {
+                nextKey = min(nextKey, key);
+            }
+        }
+
+        if (nextKey != NO_CHILD_KEY)
+        {
+            nextEntry = MakeEntry(parentIndex, nextKey & 3);
+            return true;
+        }
+
+        entry = GetParentEntry(bvh, offsets, parentIndex);
+    }
+    return false;
+}
+
+void SortChildKeys(inout uint childKey[WIDE_NODE_MAX_CHILDREN], uint a, uint b)
+{
+    const uint minKey = min(childKey[a], childKey[b]);
+    childKey[b] = max(childKey[a], childKey[b]);
+    childKey[a] = minKey;
+}
+
+bool TraverseShortStack(
+    uint InstanceInclusionMask,
+    uint RayContributionToHitGroupIndex,
+    uint MultiplierForGeometryContributionToHitGroupIndex
+)
+{
+    RayData currentRayData = GetRayData(WorldRayOrigin(), WorldRayDirection());
+
+    uint level = TOP_LEVEL_INDEX;
+    uint nodesToProcess[NUM_BVH_LEVELS] = { 0, 0 };
+    uint lastEntry[NUM_BVH_LEVELS] = { ROOT_ENTRY, ROOT_ENTRY };
+    uint droppedLevels = 0;
+    uint stackTop = 0;
+
+    GpuVA currentGpuVA = TopLevelAccelerationStructureGpuVA;
+    uint instanceIndex = 0;
+    uint instanceFlags = 0;
+    uint instanceOffset = 0;
+    uint instanceId = 0;
+
+    RWByteAddressBufferPointer topLevelAccelerationStructure = CreateRWByteAddressBufferPointerFromGpuVA(TopLevelAccelerationStructureGpuVA);
+    const TraversalOffsets topLevelOffsets = LoadTraversalOffsets(topLevelAccelerationStructure);
+    uint offsetToInstanceDescs = topLevelOffsets.offsetToPrimitives;
+    TraversalOffsets currentOffsets = topLevelOffsets;
+
+    uint2 flags;
+    float unusedT;
+    BoundingBox topLevelBox = BVHReadBoundingBox(
+        topLevelAccelerationStructure,
+        0,
+        flags);
+
+    if (RayBoxTest(unusedT,
+        Fallback_RayTCurrent(),
+        currentRayData.OriginTimesRayInverseDirection,
+        currentRayData.InverseDirection,
+        topLevelBox.center,
+        topLevelBox.halfDim))
+    {
+        ShortStackPush(stackTop, nodesToProcess, droppedLevels, ROOT_ENTRY, TOP_LEVEL_INDEX);
+    }
+
+    int NO_HIT_SENTINEL = ~0;
+    Fallback_SetInstanceIndex(NO_HIT_SENTINEL);
+
+    bool endSearch = false;
+    while (!endSearch)
+    {
+        RWByteAddressBufferPointer currentBVH = CreateRWByteAddressBufferPointerFromGpuVA(currentGpuVA);
+
+        uint entry;
+        if (nodesToProcess[level] != 0)
+        {
+            entry = ShortStackPop(stackTop, nodesToProcess, level);
+        }
+        else if (!((droppedLevels >> level) & 1) || !FindNextEntry(currentBVH, currentOffsets, currentRayData, lastEntry[level], entry))
+        {
+            if (level == TOP_LEVEL_INDEX)
+            {
+                break;
+            }
+
+            // Back to the top level, past the instance just traversed
+            level = TOP_LEVEL_INDEX;
+            currentRayData = GetRayData(WorldRayOrigin(), WorldRayDirection());
+            currentGpuVA = TopLevelAccelerationStructureGpuVA;
+            currentOffsets = topLevelOffsets;
+            continue;
+        }
+        lastEntry[level] = entry;
+
+        const uint nodeReference = GetEntryReference(currentBVH, currentOffsets, entry);
+        if (IsLeafReference(nodeReference))
+        {
+            uint2 flags = GetLeafFlagsFromReference(nodeReference);
+            if (level == TOP_LEVEL_INDEX)
+            {
+                BVHMetadata metadata = GetBVHMetadataFromLeafIndex(
+                    topLevelAccelerationStructure,
+                    offsetToInstanceDescs,
+                    GetLeafIndexFromFlag(flags));
+                RaytracingInstanceDesc instanceDesc = metadata.instanceDesc;
+
+                if (GetInstanceMask(instanceDesc) & InstanceInclusionMask)
+                {
+                    level = BOTTOM_LEVEL_INDEX;
+                    lastEntry[BOTTOM_LEVEL_INDEX] = ROOT_ENTRY;
+                    droppedLevels &= ~(1 << BOTTOM_LEVEL_INDEX);
+                    ShortStackPush(stackTop, nodesToProcess, droppedLevels, ROOT_ENTRY, BOTTOM_LEVEL_INDEX);
+
+                    currentGpuVA = instanceDesc.AccelerationStructure;
+                    currentOffsets = LoadTraversalOffsets(CreateRWByteAddressBufferPointerFromGpuVA(currentGpuVA));
+                    instanceIndex = metadata.InstanceIndex;
+                    instanceOffset = GetInstanceContributionToHitGroupIndex(instanceDesc);
+                    instanceId = GetInstanceID(instanceDesc);
+                    instanceFlags = GetInstanceFlags(instanceDesc);
+
+                    float3x4 CurrentWorldToObject = CreateMatrix(instanceDesc.Transform);
+                    float3x4 CurrentObjectToWorld = CreateMatrix(metadata.ObjectToWorld);
+
+                    float3 objectSpaceOrigin = mul(CurrentWorldToObject, float4(WorldRayOrigin(), 1));
+                    float3 objectSpaceDirection = mul(CurrentWorldToObject, float4(WorldRayDirection(), 0));
+
+                    currentRayData = GetRayData(
+                        objectSpaceOrigin,
+                        objectSpaceDirection);
+
+                    UpdateObjectSpaceProperties(objectSpaceOrigin, objectSpaceDirection, CurrentWorldToObject, CurrentObjectToWorld);
+                }
+            }
+            else
+            {
+                PrimitiveMetaData primitiveMetadata = BVHReadPrimitiveMetaData(currentBVH, currentOffsets, GetLeafIndexFromFlag(flags));
+
+                bool geomOpaque = primitiveMetadata.GeometryFlags & D3D12_RAYTRACING_GEOMETRY_FLAG_OPAQUE;
+                bool opaque = IsOpaque(geomOpaque, instanceFlags, RayFlags());
+                bool culled = Cull(opaque, RayFlags());
+
+                float resultT = Fallback_RayTCurrent();
+                float2 resultBary;
+                uint resultTriId;
+
+                uint hitGroupRecordOffset =
+                    HitGroupShaderRecordStride * (RayContributionToHitGroupIndex +
+                    primitiveMetadata.GeometryContributionToHitGroupIndex * MultiplierForGeometryContributionToHitGroupIndex +
+                    instanceOffset);
+
+                bool isProceduralGeometry = IsProceduralGeometry(flags);
+#ifdef DISABLE_PROCEDURAL_GEOMETRY
+                isProceduralGeometry = false;
+#endif
+                if (!culled && isProceduralGeometry)
+                {
+                    Fallback_SetPendingCustomVals(hitGroupRecordOffset, primitiveMetadata.PrimitiveIndex, instanceIndex, instanceId);
+                    uint intersectionStateId, anyHitStateId;
+                    GetAnyHitAndIntersectionStateId(HitGroupShaderTable, hitGroupRecordOffset, anyHitStateId, intersectionStateId);
+
+                    Fallback_SetAnyHitStateId(anyHitStateId);
+                    Fallback_SetAnyHitResult(ACCEPT);
+                    Fallback_CallIndirect(intersectionStateId);
+                    endSearch = Fallback_AnyHitResult() == END_SEARCH;
+                }
+                else if (!culled && TestLeafNodeIntersections(
+                    currentBVH,
+                    currentOffsets,
+                    flags,
+                    instanceFlags,
+                    RayFlags(),
+                    RayTMin(),
+                    ObjectRayOrigin(),
+                    ObjectRayDirection(),
+                    currentRayData.SwizzledIndices,
+                    currentRayData.Shear,
+                    resultBary,
+                    resultT,
+                    resultTriId))
+                {
+                    BuiltInTriangleIntersectionAttributes attr;
+                    attr.barycentrics = resultBary;
+                    Fallback_SetPendingAttr(attr);
+                    Fallback_SetPendingTriVals(hitGroupRecordOffset, primitiveMetadata.PrimitiveIndex, instanceIndex, instanceId, resultT, HIT_KIND_TRIANGLE_FRONT_FACE);
+
+#ifdef DISABLE_ANYHIT
+                    bool skipAnyHit = true;
+#else
+                    bool skipAnyHit = opaque;
+#endif
+                    int ret = ACCEPT;
+                    if (!skipAnyHit)
+                    {
+                        uint anyhitStateId = GetAnyHitStateId(HitGroupShaderTable, hitGroupRecordOffset);
+                        if (anyhitStateId)
+                            ret = InvokeAnyHit(anyhitStateId);
+                    }
+
+                    if (ret != IGNORE)
+                        Fallback_CommitHit();
+
+                    endSearch = (ret == END_SEARCH) || (RayFlags() & RAY_FLAG_ACCEPT_FIRST_HIT_AND_END_SEARCH);
+                }
+            }
+        }
+        else
+        {
+            float childT[WIDE_NODE_MAX_CHILDREN];
+            uint childReference[WIDE_NODE_MAX_CHILDREN];
+            IntersectWideNodeChildren(currentBVH, currentOffsets, nodeReference, currentRayData, RayTCurrent(), childT, childReference);
+
+            uint childKey[WIDE_NODE_MAX_CHILDREN];
+            [unroll]
+            for (uint i = 0; i < WIDE_NODE_MAX_CHILDREN; i++)
+            {
+                childKey[i] = childT[i] != FLT_MAX ? GetChildKey(childT[i], i) : NO_CHILD_KEY;
+            }
+
+            SortChildKeys(childKey, 0, 1);
+            SortChildKeys(childKey, 2, 3);
+            SortChildKeys(childKey, 0, 2);
+            SortChildKeys(childKey, 1, 3);
+            SortChildKeys(childKey, 1, 2);
+
+            // Push the farthest first so the nearest is popped next, and the farthest is lost first
+            [unroll]
+            for (int j = WIDE_NODE_MAX_CHILDREN - 1; j >= 0; j--)
+            {
+                if (childKey[j] != NO_CHILD_KEY)
+                {
+                    ShortStackPush(stackTop, nodesToProcess, droppedLevels, MakeEntry(nodeReference, childKey[j] & 3), level);
+                }
+            }
+        }
+    }
+
+    return Fallback_InstanceIndex() != NO_HIT_SENTINEL;
+}
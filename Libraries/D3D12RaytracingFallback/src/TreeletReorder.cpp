@@ -46,65 +46,85 @@ namespace FallbackLayer
         D3D12_GPU_VIRTUAL_ADDRESS baseTreeletsIndexBuffer,
         D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAGS buildFlag)
     {
-        if (numElements == 0) return;
+        BatchedBuild build = { numElements, hierarchyBuffer, triangleCountBuffer, aabbBuffer, inputElementBuffer, baseTreeletsCountBuffer, baseTreeletsIndexBuffer, buildFlag };
+        Optimize(pCommandList, 1, &build);
+    }
 
-        InputConstants constants;
-        constants.NumberOfElements = numElements;
-        constants.MinTrianglesPerTreelet = FullTreeletSize;
+    void TreeletReorder::Optimize(
+        ID3D12GraphicsCommandList *pCommandList,
+        UINT numBuilds,
+        const BatchedBuild *pBuilds)
+    {
+        UINT maxOptimizationPasses = 0;
+        for (UINT buildIndex = 0; buildIndex < numBuilds; buildIndex++)
+        {
+            maxOptimizationPasses = std::max(maxOptimizationPasses, NumOptimizationPasses(pBuilds[buildIndex].buildFlag));
+        }
 
         pCommandList->SetComputeRootSignature(m_pRootSignature);
-        pCommandList->SetComputeRootUnorderedAccessView(HierarchyBufferSlot, hierarchyBuffer);
-        pCommandList->SetComputeRootUnorderedAccessView(TriangleCountBufferSlot, triangleCountBuffer);
-        pCommandList->SetComputeRootUnorderedAccessView(AABBBufferSlot, aabbBuffer);
-        pCommandList->SetComputeRootUnorderedAccessView(InputElementSlot, inputElementBuffer);
-        pCommandList->SetComputeRootUnorderedAccessView(BaseTreeletsCountBufferSlot, baseTreeletsCountBuffer);
-        pCommandList->SetComputeRootUnorderedAccessView(BaseTreeletsIndexBufferSlot, baseTreeletsIndexBuffer);
 
+        auto uavBarrier = CD3DX12_RESOURCE_BARRIER::UAV(nullptr);
+        UINT minTrianglesPerTreelet = FullTreeletSize;
+        for (UINT i = 0; i < maxOptimizationPasses; i++, minTrianglesPerTreelet *= 2)
+        {
+            auto isBuildOptimized = [&](const BatchedBuild &build)
+            {
+                return build.numElements > 0 && i < NumOptimizationPasses(build.buildFlag) && minTrianglesPerTreelet <= build.numElements;
+            };
+            if (std::none_of(pBuilds, pBuilds + numBuilds, isBuildOptimized))
+            {
+                break;
+            }
+
+            auto dispatchBuilds = [&](ID3D12PipelineState *pPSO, bool dispatchPerTreelet)
+            {
+                pCommandList->SetPipelineState(pPSO);
+                for (UINT buildIndex = 0; buildIndex < numBuilds; buildIndex++)
+                {
+                    const BatchedBuild &build = pBuilds[buildIndex];
+                    if (!isBuildOptimized(build)) continue;
+
+                    InputConstants constants;
+                    constants.NumberOfElements = build.numElements;
+                    constants.MinTrianglesPerTreelet = minTrianglesPerTreelet;
+
+                    pCommandList->SetComputeRoot32BitConstants(ConstantsSlot, SizeOfInUint32(InputConstants), &constants, 0);
+                    pCommandList->SetComputeRootUnorderedAccessView(HierarchyBufferSlot, build.hierarchyBuffer);
+                    pCommandList->SetComputeRootUnorderedAccessView(TriangleCountBufferSlot, build.triangleCountBuffer);
+                    pCommandList->SetComputeRootUnorderedAccessView(AABBBufferSlot, build.aabbBuffer);
+                    pCommandList->SetComputeRootUnorderedAccessView(InputElementSlot, build.inputElementBuffer);
+                    pCommandList->SetComputeRootUnorderedAccessView(BaseTreeletsCountBufferSlot, build.baseTreeletsCountBuffer);
+                    pCommandList->SetComputeRootUnorderedAccessView(BaseTreeletsIndexBufferSlot, build.baseTreeletsIndexBuffer);
+
+                    UINT numGroupsForElements = DivideAndRoundUp<UINT>(build.numElements, THREAD_GROUP_1D_WIDTH);
+                    UINT maxNumTreelets = MaxNumTreelets(build.numElements, minTrianglesPerTreelet);
+                    pCommandList->Dispatch(dispatchPerTreelet ? maxNumTreelets : numGroupsForElements, 1, 1);
+                }
+                pCommandList->ResourceBarrier(1, &uavBarrier);
+            };
+
+            dispatchBuilds(m_pClearBuffersPSO, false);
+            dispatchBuilds(m_pFindTreeletsPSO, false);
+            dispatchBuilds(m_pTreeletReorderPSO, true);
+        }
+    }
+
+    UINT TreeletReorder::NumOptimizationPasses(D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAGS buildFlag)
+    {
         bool bPrioritizeTrace = buildFlag & D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_TRACE;
         bool bPrioritizeBuild = buildFlag & D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_BUILD;
 
-        UINT numOptimizationPasses;
-
         if (bPrioritizeBuild)
         {
-            numOptimizationPasses = 0;
+            return 0;
         }
         else if (bPrioritizeTrace)
         {
-            numOptimizationPasses = 3;
+            return 3;
         }
         else
         {
-            numOptimizationPasses = 1;
-        }
-
-        for (UINT i = 0; i < numOptimizationPasses; i++)
-        {
-            if (constants.MinTrianglesPerTreelet > numElements)
-            {
-                break;
-            }
-
-            pCommandList->SetComputeRoot32BitConstants(ConstantsSlot, SizeOfInUint32(InputConstants), &constants, 0);
-            
-            auto uavBarrier = CD3DX12_RESOURCE_BARRIER::UAV(nullptr);
-            
-            UINT numGroupsForElements = DivideAndRoundUp<UINT>(numElements, THREAD_GROUP_1D_WIDTH);
-            UINT maxNumTreelets = MaxNumTreelets(numElements, constants.MinTrianglesPerTreelet);
-
-            pCommandList->SetPipelineState(m_pClearBuffersPSO);
-            pCommandList->Dispatch(numGroupsForElements, 1, 1);
-            pCommandList->ResourceBarrier(1, &uavBarrier);
-
-            pCommandList->SetPipelineState(m_pFindTreeletsPSO);
-            pCommandList->Dispatch(numGroupsForElements, 1, 1);
-            pCommandList->ResourceBarrier(1, &uavBarrier);
-                
-            pCommandList->SetPipelineState(m_pTreeletReorderPSO);
-            pCommandList->Dispatch(maxNumTreelets, 1, 1);
-            pCommandList->ResourceBarrier(1, &uavBarrier);
-
-            constants.MinTrianglesPerTreelet *= 2;
+            return 1;
         }
     }
 
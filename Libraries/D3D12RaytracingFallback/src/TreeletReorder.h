@@ -27,6 +27,25 @@ namespace FallbackLayer
             D3D12_GPU_VIRTUAL_ADDRESS baseTreeletsBuffer,
             D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAGS buildFlag);
 
+        struct BatchedBuild
+        {
+            UINT numElements;
+            D3D12_GPU_VIRTUAL_ADDRESS hierarchyBuffer;
+            D3D12_GPU_VIRTUAL_ADDRESS triangleCountBuffer;
+            D3D12_GPU_VIRTUAL_ADDRESS aabbBuffer;
+            D3D12_GPU_VIRTUAL_ADDRESS inputElementBuffer;
+            D3D12_GPU_VIRTUAL_ADDRESS baseTreeletsCountBuffer;
+            D3D12_GPU_VIRTUAL_ADDRESS baseTreeletsIndexBuffer;
+            D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAGS buildFlag;
+        };
+
+        // Runs each step of an optimization pass for every build before the barrier it needs. Builds
+        // take as many passes as their flags ask for.
+        void Optimize(
+            ID3D12GraphicsCommandList *pCommandList,
+            UINT numBuilds,
+            const BatchedBuild *pBuilds);
+
         static UINT RequiredSizeForAABBBuffer(UINT numElements);
         static UINT RequiredSizeForBaseTreeletBuffers(UINT numElements);
     private:
@@ -48,6 +67,7 @@ namespace FallbackLayer
         };
 
         static UINT MaxNumTreelets(UINT numElements, UINT minElementsPerTreelet);
+        static UINT NumOptimizationPasses(D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAGS buildFlag);
     };
 }
 
@@ -88,18 +88,4 @@ bool IsLeafIndex(uint nodeIndex)
     return nodeIndex >= NumberOfInternalNodes;
 }
 
-float ComputeBoxSurfaceArea(AABB aabb)
-{
-    float3 dim = aabb.max - aabb.min;
-    return 2.0f * (dim.x * dim.y + dim.x * dim.z + dim.y * dim.z);
-}
-
-AABB CombineAABB(AABB aabb0, AABB aabb1)
-{
-    AABB parentAABB;
-    parentAABB.min = min(aabb0.min, aabb1.min);
-    parentAABB.max = max(aabb0.max, aabb1.max);
-    return parentAABB;
-}
-
 #endif
\ No newline at end of file
@@ -49,8 +49,12 @@ namespace FallbackLayer
     }
 
 
-    UberShaderRaytracingProgram::UberShaderRaytracingProgram(ID3D12Device *pDevice, DxilShaderPatcher &dxilShaderPatcher, const StateObjectCollection &stateObjectCollection) :
-        m_DxilShaderPatcher(dxilShaderPatcher)
+    void UberShaderRaytracingProgram::LinkCollection(
+        ID3D12Device *pDevice,
+        const StateObjectCollection &stateObjectCollection,
+        const std::vector<LPCWSTR> &exportNames,
+        std::vector<DxcShaderInfo> &shaderInfo,
+        IDxcBlob **ppCollectionBlob)
     {
         UINT numLibraries = (UINT)stateObjectCollection.m_dxilLibraries.size();
 
@@ -86,11 +90,9 @@ namespace FallbackLayer
         std::vector<DxilLibraryInfo> librariesInfo;
         DxilLibraryInfo outputLibInfo((void *)pAppLibrariesBlob->GetBufferPointer(), (UINT)pAppLibrariesBlob->GetBufferSize());
         CComPtr<IDxcBlob> pOutputBlob;
-        std::vector<LPCWSTR> exportNames;
         for (auto &associationPair : stateObjectCollection.m_shaderAssociations)
         {
             auto &exportName = associationPair.first;
-            exportNames.push_back(exportName.c_str());
             auto &shaderAssociation = associationPair.second;
 
             if (shaderAssociation.m_pRootSignature)
@@ -127,16 +129,93 @@ namespace FallbackLayer
         {
             auto &traversalShader = stateObjectCollection.m_traversalShader.DXILLibrary;
             librariesInfo.emplace_back((void *)traversalShader.pShaderBytecode, traversalShader.BytecodeLength);
-            exportNames.push_back(L"Fallback_TraceRay");
         }
 
         {
             librariesInfo.emplace_back((void *)g_pStateMachineLib, ARRAYSIZE(g_pStateMachineLib));
         }
 
-        CComPtr<IDxcBlob> pCollectionBlob;
+        m_DxilShaderPatcher.LinkCollection(stateObjectCollection.m_maxAttributeSizeInBytes, librariesInfo, exportNames, shaderInfo, ppCollectionBlob);
+    }
+
+    ShaderCacheKey GetShaderCacheKey(ID3D12Device *pDevice, const StateObjectCollection &stateObjectCollection, const std::vector<LPCWSTR> &exportNames)
+    {
+        ShaderCacheKey key;
+        for (auto &library : stateObjectCollection.m_dxilLibraries)
+        {
+            key.Append(library.DXILLibrary.BytecodeLength);
+            key.Append(library.DXILLibrary.pShaderBytecode, library.DXILLibrary.BytecodeLength);
+        }
+
+        for (auto &exportDesc : stateObjectCollection.m_exportDescs)
+        {
+            key.Append(exportDesc.ExportName);
+            key.Append(exportDesc.ExportToRename);
+        }
+
+        // The shader info comes back in the order of the export names
+        for (auto exportName : exportNames)
+        {
+            key.Append(exportName);
+
+            const auto shaderAssociation = stateObjectCollection.m_shaderAssociations.find(exportName);
+            ID3D12RootSignature *pRootSignature = shaderAssociation != stateObjectCollection.m_shaderAssociations.end() ?
+                shaderAssociation->second.m_pRootSignature : nullptr;
+            UINT blobSize = 0;
+            if (pRootSignature && SUCCEEDED(pRootSignature->GetPrivateData(FallbackLayerBlobPrivateDataGUID, &blobSize, nullptr)))
+            {
+                std::vector<BYTE> blob(blobSize);
+                pRootSignature->GetPrivateData(FallbackLayerBlobPrivateDataGUID, &blobSize, blob.data());
+                key.Append(blob.data(), blob.size());
+            }
+            key.Append(blobSize);
+        }
+
+        for (auto &hitGroupMapEntry : stateObjectCollection.m_hitGroups)
+        {
+            key.Append(hitGroupMapEntry.first.c_str());
+            key.Append(hitGroupMapEntry.second.ClosestHitShaderImport);
+            key.Append(hitGroupMapEntry.second.AnyHitShaderImport);
+            key.Append(hitGroupMapEntry.second.IntersectionShaderImport);
+        }
+
+        auto &traversalShader = stateObjectCollection.m_traversalShader.DXILLibrary;
+        key.Append(traversalShader.pShaderBytecode, traversalShader.BytecodeLength);
+        key.Append(g_pStateMachineLib, sizeof(g_pStateMachineLib));
+
+        key.Append(stateObjectCollection.m_maxAttributeSizeInBytes);
+        key.Append(stateObjectCollection.m_config.MaxTraceRecursionDepth);
+        key.Append(pDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV));
+        key.Append(pDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER));
+        key.Append(sizeof(ShaderIdentifier));
+        return key;
+    }
+
+    UberShaderRaytracingProgram::UberShaderRaytracingProgram(ID3D12Device *pDevice, DxilShaderPatcher &dxilShaderPatcher, ShaderCache *pShaderCache, const StateObjectCollection &stateObjectCollection) :
+        m_DxilShaderPatcher(dxilShaderPatcher)
+    {
+        std::vector<LPCWSTR> exportNames;
+        for (auto &associationPair : stateObjectCollection.m_shaderAssociations)
+        {
+            exportNames.push_back(associationPair.first.c_str());
+        }
+        exportNames.push_back(L"Fallback_TraceRay");
+
+        ShaderCacheKey cacheKey;
         std::vector<DxcShaderInfo> shaderInfo;
-        m_DxilShaderPatcher.LinkCollection(stateObjectCollection.m_maxAttributeSizeInBytes, librariesInfo, exportNames, shaderInfo, &pCollectionBlob);
+        std::vector<BYTE> cachedLinkedShader;
+        bool isCached = false;
+        if (pShaderCache)
+        {
+            cacheKey = GetShaderCacheKey(pDevice, stateObjectCollection, exportNames);
+            isCached = pShaderCache->Load(cacheKey, shaderInfo, cachedLinkedShader) && shaderInfo.size() == exportNames.size();
+        }
+
+        CComPtr<IDxcBlob> pCollectionBlob;
+        if (!isCached)
+        {
+            LinkCollection(pDevice, stateObjectCollection, exportNames, shaderInfo, &pCollectionBlob);
+        }
 
         UINT traceRayStackSize = shaderInfo[exportNames.size() - 1].StackSize;
         for (size_t i = 0; i < exportNames.size() - 1; ++i)
@@ -175,13 +254,23 @@ namespace FallbackLayer
             m_ExportNameToShaderData[hitGroupName] = { shaderId, shaderStackSize };
         }
 
-        UINT stackSize = stateObjectCollection.m_config.MaxTraceRecursionDepth * m_largestNonRayGenStackSize + m_largestRayGenStackSize;
+        D3D12_SHADER_BYTECODE linkedShader = CD3DX12_SHADER_BYTECODE(cachedLinkedShader.data(), cachedLinkedShader.size());
         CComPtr<IDxcBlob> pLinkedBlob;
-        m_DxilShaderPatcher.LinkStateObject(stateObjectCollection.m_maxAttributeSizeInBytes, stackSize, pCollectionBlob, exportNames, shaderInfo, &pLinkedBlob);
+        if (!isCached)
+        {
+            UINT stackSize = stateObjectCollection.m_config.MaxTraceRecursionDepth * m_largestNonRayGenStackSize + m_largestRayGenStackSize;
+            m_DxilShaderPatcher.LinkStateObject(stateObjectCollection.m_maxAttributeSizeInBytes, stackSize, pCollectionBlob, exportNames, shaderInfo, &pLinkedBlob);
+            linkedShader = CD3DX12_SHADER_BYTECODE(pLinkedBlob->GetBufferPointer(), pLinkedBlob->GetBufferSize());
+
+            if (pShaderCache)
+            {
+                pShaderCache->Store(cacheKey, shaderInfo, linkedShader.pShaderBytecode, linkedShader.BytecodeLength);
+            }
+        }
 
         CompilePSO(
             pDevice, 
-            CD3DX12_SHADER_BYTECODE(pLinkedBlob->GetBufferPointer(), pLinkedBlob->GetBufferSize()), 
+            linkedShader, 
             stateObjectCollection, 
             &m_pRayTracePSO);
         
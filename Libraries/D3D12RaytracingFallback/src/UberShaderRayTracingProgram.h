@@ -15,7 +15,7 @@ namespace FallbackLayer
     class UberShaderRaytracingProgram : public IRaytracingProgram
     {
     public:
-        UberShaderRaytracingProgram(ID3D12Device *m_pDevice, DxilShaderPatcher &dxilShaderPatcher, const StateObjectCollection &stateObjectCollection);
+        UberShaderRaytracingProgram(ID3D12Device *m_pDevice, DxilShaderPatcher &dxilShaderPatcher, ShaderCache *pShaderCache, const StateObjectCollection &stateObjectCollection);
         virtual ~UberShaderRaytracingProgram() {}
         virtual void DispatchRays(
             ID3D12GraphicsCommandList *pCommandList, 
@@ -34,6 +34,12 @@ namespace FallbackLayer
         std::function<void(ID3D12GraphicsCommandList *, UINT)> m_pPredispatchCallback;
     private:
         StateIdentifier GetStateIdentfier(LPCWSTR pExportName);
+        void LinkCollection(
+            ID3D12Device *pDevice,
+            const StateObjectCollection &stateObjectCollection,
+            const std::vector<LPCWSTR> &exportNames,
+            std::vector<DxcShaderInfo> &shaderInfo,
+            IDxcBlob **ppCollectionBlob);
 
         DxilShaderPatcher &m_DxilShaderPatcher;
         struct ShaderData
@@ -0,0 +1,91 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+#pragma once
+#include "RaytracingHlslCompat.h"
+#ifdef HLSL
+#include "ShaderUtil.hlsli"
+#endif
+
+struct ValidateBVHInputConstants
+{
+    uint NumberOfElements;
+    uint IsBottomLevel;
+    uint BVHAddressLow;
+    uint BVHAddressHigh;
+};
+
+// The kinds of error the validator records
+#define BVHValidationInvalidChildIndex 1      // Value is the child index
+#define BVHValidationChildNotContained 2      // Value is the child index
+#define BVHValidationInvalidParentCount 3     // Value is the number of parents found
+#define BVHValidationInvalidLeafIndex 4       // Value is the leaf index
+#define BVHValidationPrimitiveNotContained 5  // Value is the leaf index
+#define BVHValidationInvalidLeafCount 6       // NodeIndex is the leaf index, Value is the number of leaves found
+
+struct BVHValidationError
+{
+    uint Type;
+    uint NodeIndex;
+    uint Value;
+    uint Padding;
+#ifdef HLSL
+    uint2 BVHAddress;
+#else
+    D3D12_GPU_VIRTUAL_ADDRESS BVHAddress;
+#endif
+};
+#define SizeOfBVHValidationError 24
+#ifndef HLSL
+static_assert(sizeof(BVHValidationError) == SizeOfBVHValidationError, L"Incorrect sizeof for BVHValidationError");
+#endif
+
+// The error log is never cleared. It counts the validations that have finished and the errors they
+// found, and records the first MaxBVHValidationErrors of them.
+#define OffsetToValidationCount 0
+#define OffsetToErrorCount 4
+#define OffsetToErrors 16
+#define MaxBVHValidationErrors 256
+#define SizeOfBVHValidationLog (OffsetToErrors + MaxBVHValidationErrors * SizeOfBVHValidationError)
+
+// Boxes are fit in floating point, so containment allows for this much error relative to the
+// size of the coordinates
+#define BVHValidationEpsilon 0.0001
+
+// UAVs
+#define BVHToValidateRegister 0
+#define ReferenceCountsRegister 1
+#define ValidationErrorLogRegister 2
+
+// CBVs
+#define ValidateBVHConstantsRegister 0
+
+#ifdef HLSL
+RWByteAddressBuffer BVH : UAV_REGISTER(BVHToValidateRegister);
+RWStructuredBuffer<uint> ReferenceCounts : UAV_REGISTER(ReferenceCountsRegister);
+RWByteAddressBuffer ErrorLog : UAV_REGISTER(ValidationErrorLogRegister);
+
+cbuffer ValidateBVHConstants : CONSTANT_REGISTER(ValidateBVHConstantsRegister)
+{
+    ValidateBVHInputConstants Constants;
+};
+
+void LogError(uint type, uint nodeIndex, uint value)
+{
+    uint errorIndex;
+    ErrorLog.InterlockedAdd(OffsetToErrorCount, 1, errorIndex);
+    if (errorIndex < MaxBVHValidationErrors)
+    {
+        const uint errorAddress = OffsetToErrors + errorIndex * SizeOfBVHValidationError;
+        ErrorLog.Store4(errorAddress, uint4(type, nodeIndex, value, 0));
+        ErrorLog.Store2(errorAddress + 16, uint2(Constants.BVHAddressLow, Constants.BVHAddressHigh));
+    }
+}
+#endif
@@ -0,0 +1,90 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+#define HLSL
+#include "ValidateBVHBindings.h"
+#include "RayTracingHelper.hlsli"
+
+// Checks each node against its own data, and counts the references to every node and leaf
+// so ValidateBVHReferences can check each is referenced once.
+static const uint offsetToBoxes = SizeOfBVHOffsets;
+
+bool IsContained(AABB parent, AABB child)
+{
+    const float3 tolerance = BVHValidationEpsilon * max(1.0, max(abs(parent.min), abs(parent.max)));
+    return all(child.min >= parent.min - tolerance) && all(child.max <= parent.max + tolerance);
+}
+
+AABB ReadNodeAABB(uint nodeIndex, out uint2 flags)
+{
+    const uint nodeAddress = GetBoxAddress(offsetToBoxes, nodeIndex);
+    return BoundingBoxToAABB(RawDataToBoundingBox(BVH.Load4(nodeAddress), BVH.Load4(nodeAddress + 16), flags));
+}
+
+Primitive ReadPrimitive(uint primitiveIndex)
+{
+    const uint primitiveAddress = BVH.Load(OffsetToPrimitivesOffset) + primitiveIndex * SizeOfPrimitive;
+
+    Primitive primitive;
+    primitive.PrimitiveType = BVH.Load(primitiveAddress);
+    primitive.data0 = BVH.Load4(primitiveAddress + 4);
+    primitive.data1 = BVH.Load4(primitiveAddress + 20);
+    primitive.data2 = BVH.Load(primitiveAddress + 36);
+    return primitive;
+}
+
+[numthreads(THREAD_GROUP_1D_WIDTH, 1, 1)]
+void main(uint3 DTid : SV_DispatchThreadID)
+{
+    const uint numberOfNodes = GetNumInternalNodes(Constants.NumberOfElements) + Constants.NumberOfElements;
+    const uint nodeIndex = DTid.x;
+    if (nodeIndex >= numberOfNodes) return;
+
+    uint2 flags;
+    const AABB nodeAABB = ReadNodeAABB(nodeIndex, flags);
+    if (IsLeaf(flags))
+    {
+        // Leaf references are counted after the nodes
+        const uint leafIndex = GetLeafIndexFromFlag(flags);
+        if (leafIndex >= Constants.NumberOfElements)
+        {
+            LogError(BVHValidationInvalidLeafIndex, nodeIndex, leafIndex);
+            return;
+        }
+        InterlockedAdd(ReferenceCounts[numberOfNodes + leafIndex], 1);
+
+        // A top level's leaves are fit to transformed bottom levels, which only their builds know
+        if (Constants.IsBottomLevel && !IsContained(nodeAABB, GetPrimitiveAABB(ReadPrimitive(leafIndex), leafIndex)))
+        {
+            LogError(BVHValidationPrimitiveNotContained, nodeIndex, leafIndex);
+        }
+    }
+    else
+    {
+        const uint childIndices[2] = { GetLeftNodeIndex(flags), GetRightNodeIndex(flags) };
+        for (uint i = 0; i < 2; i++)
+        {
+            // Nothing can point back at the root
+            const uint childIndex = childIndices[i];
+            if (childIndex == 0 || childIndex >= numberOfNodes)
+            {
+                LogError(BVHValidationInvalidChildIndex, nodeIndex, childIndex);
+                continue;
+            }
+            InterlockedAdd(ReferenceCounts[childIndex], 1);
+
+            uint2 childFlags;
+            if (!IsContained(nodeAABB, ReadNodeAABB(childIndex, childFlags)))
+            {
+                LogError(BVHValidationChildNotContained, nodeIndex, childIndex);
+            }
+        }
+    }
+}
@@ -0,0 +1,44 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+#define HLSL
+#include "ValidateBVHBindings.h"
+#include "RayTracingHelper.hlsli"
+
+// Checks every node but the root has one parent and every leaf index is used once, and clears the
+// counts for the next validation. Together with the node checks this catches any hierarchy that
+// isn't a tree over all the elements, except for a cycle detached from the root.
+[numthreads(THREAD_GROUP_1D_WIDTH, 1, 1)]
+void main(uint3 DTid : SV_DispatchThreadID)
+{
+    const uint numberOfNodes = GetNumInternalNodes(Constants.NumberOfElements) + Constants.NumberOfElements;
+    const uint countIndex = DTid.x;
+    if (countIndex == 0)
+    {
+        ErrorLog.InterlockedAdd(OffsetToValidationCount, 1);
+    }
+    if (countIndex >= numberOfNodes + Constants.NumberOfElements) return;
+
+    const uint referenceCount = ReferenceCounts[countIndex];
+    ReferenceCounts[countIndex] = 0;
+
+    if (countIndex < numberOfNodes)
+    {
+        const uint expectedParents = (countIndex == 0) ? 0 : 1;
+        if (referenceCount != expectedParents)
+        {
+            LogError(BVHValidationInvalidParentCount, countIndex, referenceCount);
+        }
+    }
+    else if (referenceCount != 1)
+    {
+        LogError(BVHValidationInvalidLeafCount, countIndex - numberOfNodes, referenceCount);
+    }
+}
@@ -25,7 +25,10 @@
 #include <unordered_set>
 #include <map>
 #include <deque>
+#include <thread>
+#include <future>
 #include <string>
+#include <fstream>
 #include <strsafe.h>
 #include "d3d12_1.h"
 #include "d3dx12.h"
@@ -57,6 +60,7 @@
 #include "FallbackDxil.h"
 #include "RaytracingHlslCompat.h"
 #include "DxilShaderPatcher.h"
+#include "ShaderCache.h"
 #include "AccelerationStructureValidator.h"
 #include "AccelerationStructureBuilder.h"
 #include "AccelerationStructureBuilderFactory.h"
@@ -73,6 +77,7 @@
 
 // Acceleration Structure Builders
 #include "GetBVHCompactedSizeBindings.h"
+#include "ValidateBVHBindings.h"
 #include "ShaderPass.h"
 #include "BitonicSort.h"
 #include "SceneAABBCalculator.h"
@@ -85,6 +90,9 @@
 #include "PostBuildInfoQuery.h"
 #include "GpuBvh2Copy.h"
 #include "TreeletReorder.h"
+#include "PLOCHierarchyPass.h"
+#include "TopLevelUpdatePass.h"
+#include "GpuBvh2Validator.h"
 #include "GpuBvh2Builder.h"
 
 // Dispatchers
@@ -69,6 +69,14 @@ public:
         bool UseActiveQueueOnly = false,
         _In_opt_  UINT AffinityMask = EAffinityMask::AllNodes);
 
+    // Waits on the fence instance signaled by another node's queue, so work handed off
+    // to an offload node can be consumed on the primary.
+    HRESULT STDMETHODCALLTYPE WaitForNode(
+        CD3DX12AffinityFence* pFence,
+        UINT64 Value,
+        UINT SrcAffinityIndex,
+        _In_opt_  UINT AffinityMask = EAffinityMask::AllNodes);
+
     HRESULT STDMETHODCALLTYPE GetTimestampFrequency(
         _Out_  UINT64* pFrequency,
         UINT AffinityIndex = 0);
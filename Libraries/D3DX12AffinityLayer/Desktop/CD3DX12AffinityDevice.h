@@ -302,6 +302,23 @@ public:
     UINT GetActiveNodeMask();
     void SwitchToNextNode();
 
+    // Work split: the node frames are rendered on, and the nodes work can be offloaded to.
+    UINT GetPrimaryNodeIndex();
+    UINT GetOffloadNodeMask();
+
+    // AFR: resources the next frame reads back (e.g. TAA history, cached shadow maps), which have to
+    // be copied to the node rendering it. Unregister them before releasing them.
+    void RegisterTemporalResource(CD3DX12AffinityResource* pResource);
+    void UnregisterTemporalResource(CD3DX12AffinityResource* pResource);
+
+    // Copies the temporal resources from the active node to the next one on its copy queue. Call after
+    // the frame's last ExecuteCommandLists on pQueue and before SwitchToNextNode(). The resources have
+    // to be in the COMMON state at the end of the frame.
+    HRESULT SyncTemporalResources(CD3DX12AffinityCommandQueue* pQueue);
+
+    // Bytes copied by the last sync, and the copy queue time of the most recent one that completed.
+    void GetTemporalSyncStats(UINT64* pBytes, float* pMilliseconds);
+
     D3D12_CPU_DESCRIPTOR_HANDLE GetCPUHeapPointer(D3D12_CPU_DESCRIPTOR_HANDLE const& Original, UINT const NodeIndex);
     D3D12_GPU_DESCRIPTOR_HANDLE GetGPUHeapPointer(D3D12_GPU_DESCRIPTOR_HANDLE const& Original, UINT const NodeIndex);
     D3D12_GPU_VIRTUAL_ADDRESS GetGPUVirtualAddress(D3D12_GPU_VIRTUAL_ADDRESS const& Original, UINT const NodeIndex);
@@ -336,8 +353,16 @@ private:
 
     ID3D12CommandQueue* mSyncCommandQueues[D3DX12_MAX_ACTIVE_NODES];
     ID3D12Fence* mSyncFences[D3DX12_MAX_ACTIVE_NODES];
+    UINT64 mSyncFenceValues[D3DX12_MAX_ACTIVE_NODES];
+    UINT64 mSyncFenceValue = 0;
+    ID3D12CommandAllocator* mSyncCommandAllocators[D3DX12_MAX_ACTIVE_NODES];
+    ID3D12GraphicsCommandList* mSyncCommandLists[D3DX12_MAX_ACTIVE_NODES];
+    ID3D12QueryHeap* mSyncQueryHeaps[D3DX12_MAX_ACTIVE_NODES];
+    ID3D12Resource* mSyncTimestampBuffers[D3DX12_MAX_ACTIVE_NODES];
     std::mutex MutexSyncResources;
     std::vector<CD3DX12AffinityResource*> mSyncResources;
+    UINT64 mTemporalSyncBytes = 0;
+    float mTemporalSyncMilliseconds = 0.0f;
     ID3D12InfoQueue* InfoQueue = nullptr;
 
 public:
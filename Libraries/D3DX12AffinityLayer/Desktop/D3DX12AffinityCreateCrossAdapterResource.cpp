@@ -0,0 +1,118 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+/**
+ * Unlinked adapters (e.g. an integrated GPU next to a discrete one) are separate devices with
+ * no node masks in common, so they can't share affinity objects. What they can share are heaps
+ * and fences. These methods create a resource or fence on the producing device and open it on
+ * the consuming device, so e.g. the discrete GPU can hand its frame to the integrated GPU for
+ * post processing while it renders the next one.
+ */
+
+#include "d3dx12affinity.h"
+#include "d3dx12.h"
+#include "Utils.h"
+
+HRESULT WINAPI D3DX12AffinityCreateCrossAdapterResource(
+    ID3D12Device* pProducerDevice,
+    ID3D12Device* pConsumerDevice,
+    const D3D12_RESOURCE_DESC* pDesc,
+    D3D12_RESOURCE_STATES InitialState,
+    ID3D12Heap** ppProducerHeap,
+    ID3D12Resource** ppProducerResource,
+    ID3D12Heap** ppConsumerHeap,
+    ID3D12Resource** ppConsumerResource)
+{
+    // Cross-adapter textures have to be row major so both adapters agree on the layout.
+    D3D12_RESOURCE_DESC ResourceDesc = *pDesc;
+    ResourceDesc.Flags |= D3D12_RESOURCE_FLAG_ALLOW_CROSS_ADAPTER;
+    if (ResourceDesc.Dimension != D3D12_RESOURCE_DIMENSION_BUFFER)
+    {
+        ResourceDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+    }
+
+    D3D12_RESOURCE_ALLOCATION_INFO const AllocationInfo = pProducerDevice->GetResourceAllocationInfo(0, 1, &ResourceDesc);
+    CD3DX12_HEAP_DESC const HeapDesc(AllocationInfo.SizeInBytes, D3D12_HEAP_TYPE_DEFAULT, 0, D3D12_HEAP_FLAG_SHARED | D3D12_HEAP_FLAG_SHARED_CROSS_ADAPTER);
+
+    ID3D12Heap* ProducerHeap = nullptr;
+    RETURN_IF_FAILED(pProducerDevice->CreateHeap(&HeapDesc, IID_PPV_ARGS(&ProducerHeap)));
+
+    HANDLE SharedHandle = nullptr;
+    HRESULT hr = pProducerDevice->CreateSharedHandle(ProducerHeap, nullptr, GENERIC_ALL, nullptr, &SharedHandle);
+
+    ID3D12Heap* ConsumerHeap = nullptr;
+    if (SUCCEEDED(hr))
+    {
+        hr = pConsumerDevice->OpenSharedHandle(SharedHandle, IID_PPV_ARGS(&ConsumerHeap));
+        CloseHandle(SharedHandle);
+    }
+
+    ID3D12Resource* ProducerResource = nullptr;
+    ID3D12Resource* ConsumerResource = nullptr;
+    if (SUCCEEDED(hr))
+    {
+        hr = pProducerDevice->CreatePlacedResource(ProducerHeap, 0, &ResourceDesc, InitialState, nullptr, IID_PPV_ARGS(&ProducerResource));
+    }
+    if (SUCCEEDED(hr))
+    {
+        hr = pConsumerDevice->CreatePlacedResource(ConsumerHeap, 0, &ResourceDesc, InitialState, nullptr, IID_PPV_ARGS(&ConsumerResource));
+    }
+
+    if (FAILED(hr))
+    {
+        WriteHRESULTError(hr);
+        if (ProducerResource) ProducerResource->Release();
+        if (ConsumerHeap) ConsumerHeap->Release();
+        ProducerHeap->Release();
+        return hr;
+    }
+
+    (*ppProducerHeap) = ProducerHeap;
+    (*ppProducerResource) = ProducerResource;
+    (*ppConsumerHeap) = ConsumerHeap;
+    (*ppConsumerResource) = ConsumerResource;
+    return S_OK;
+}
+
+HRESULT WINAPI D3DX12AffinityCreateCrossAdapterFence(
+    ID3D12Device* pProducerDevice,
+    ID3D12Device* pConsumerDevice,
+    UINT64 InitialValue,
+    ID3D12Fence** ppProducerFence,
+    ID3D12Fence** ppConsumerFence)
+{
+    ID3D12Fence* ProducerFence = nullptr;
+    RETURN_IF_FAILED(pProducerDevice->CreateFence(
+        InitialValue,
+        D3D12_FENCE_FLAG_SHARED | D3D12_FENCE_FLAG_SHARED_CROSS_ADAPTER,
+        IID_PPV_ARGS(&ProducerFence)));
+
+    HANDLE SharedHandle = nullptr;
+    HRESULT hr = pProducerDevice->CreateSharedHandle(ProducerFence, nullptr, GENERIC_ALL, nullptr, &SharedHandle);
+
+    ID3D12Fence* ConsumerFence = nullptr;
+    if (SUCCEEDED(hr))
+    {
+        hr = pConsumerDevice->OpenSharedHandle(SharedHandle, IID_PPV_ARGS(&ConsumerFence));
+        CloseHandle(SharedHandle);
+    }
+
+    if (FAILED(hr))
+    {
+        WriteHRESULTError(hr);
+        ProducerFence->Release();
+        return hr;
+    }
+
+    (*ppProducerFence) = ProducerFence;
+    (*ppConsumerFence) = ConsumerFence;
+    return S_OK;
+}
@@ -40,8 +40,6 @@
 // useful for debugging the source command-list when a TDR occurs.
 //#define SERIALIZE_COMMNANDLIST_EXECUTION
 
-//#define SYNC_CROSS_FRAME_RESOURCES
-
 //#define DEBUG_OBJECT_NAME
 
 // On LDA devices, makes all buffers have a single GPUVA by either having a single
@@ -72,6 +70,7 @@
 ////////////////////////////
 
 #include <windows.h>
+#include <algorithm>
 #include <vector>
 #include <map>
 #include <set>
@@ -104,6 +103,9 @@ struct EAffinityRenderingMode
     enum Mask
     {
         AFR,
+        // Every frame renders on the primary node. The other nodes take explicitly
+        // affinitized work (e.g. shadow maps) whose results are copied to the primary.
+        WorkSplit,
     };
 };
 
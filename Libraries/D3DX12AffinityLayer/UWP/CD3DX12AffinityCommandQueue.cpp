@@ -216,6 +216,28 @@ HRESULT STDMETHODCALLTYPE CD3DX12AffinityCommandQueue::Wait(
     return S_OK;
 }
 
+HRESULT STDMETHODCALLTYPE CD3DX12AffinityCommandQueue::WaitForNode(
+    CD3DX12AffinityFence* pFence,
+    UINT64 Value,
+    UINT SrcAffinityIndex,
+    UINT AffinityMask)
+{
+    UINT EffectiveAffinityMask = (AffinityMask == 0) ? GetNodeMask() : AffinityMask & GetNodeMask();
+    for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
+    {
+        if (((1 << i) & EffectiveAffinityMask) != 0)
+        {
+            HRESULT const hr = mCommandQueues[i]->Wait(pFence->mFences[SrcAffinityIndex], Value);
+
+            if (hr != S_OK)
+            {
+                return hr;
+            }
+        }
+    }
+    return S_OK;
+}
+
 HRESULT STDMETHODCALLTYPE CD3DX12AffinityCommandQueue::GetTimestampFrequency(
     UINT64* pFrequency,
     UINT AffinityIndex)
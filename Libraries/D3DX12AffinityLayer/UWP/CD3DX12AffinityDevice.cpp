@@ -1374,6 +1374,26 @@ CD3DX12AffinityDevice::CD3DX12AffinityDevice(ID3D12Device** devices, UINT Count,
 
             mDevices[0]->CreateCommandQueue(&desc, IID_PPV_ARGS(&mSyncCommandQueues[i]));
             mDevices[0]->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&mSyncFences[i]));
+            mSyncFenceValues[i] = 0;
+
+            mDevices[0]->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COPY, IID_PPV_ARGS(&mSyncCommandAllocators[i]));
+            mDevices[0]->CreateCommandList(1 << i, D3D12_COMMAND_LIST_TYPE_COPY, mSyncCommandAllocators[i], nullptr, IID_PPV_ARGS(&mSyncCommandLists[i]));
+            mSyncCommandLists[i]->Close();
+
+            // Copy queue timestamps are optional, temporal syncs just go untimed without them.
+            D3D12_QUERY_HEAP_DESC QueryHeapDesc = { D3D12_QUERY_HEAP_TYPE_COPY_QUEUE_TIMESTAMP, 2, desc.NodeMask };
+            if (FAILED(mDevices[0]->CreateQueryHeap(&QueryHeapDesc, IID_PPV_ARGS(&mSyncQueryHeaps[i]))))
+            {
+                mSyncQueryHeaps[i] = nullptr;
+            }
+
+            D3D12_HEAP_PROPERTIES ReadbackProperties = { D3D12_HEAP_TYPE_READBACK, D3D12_CPU_PAGE_PROPERTY_UNKNOWN, D3D12_MEMORY_POOL_UNKNOWN, desc.NodeMask, desc.NodeMask };
+            D3D12_RESOURCE_DESC ReadbackDesc = { D3D12_RESOURCE_DIMENSION_BUFFER, 0, 2 * sizeof(UINT64), 1, 1, 1, DXGI_FORMAT_UNKNOWN, { 1, 0 }, D3D12_TEXTURE_LAYOUT_ROW_MAJOR, D3D12_RESOURCE_FLAG_NONE };
+            mSyncTimestampBuffers[i] = nullptr;
+            if (mSyncQueryHeaps[i])
+            {
+                mDevices[0]->CreateCommittedResource(&ReadbackProperties, D3D12_HEAP_FLAG_NONE, &ReadbackDesc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&mSyncTimestampBuffers[i]));
+            }
         }
     }
 }
@@ -1384,6 +1404,16 @@ CD3DX12AffinityDevice::~CD3DX12AffinityDevice()
     {
         mSyncCommandQueues[i]->Release();
         mSyncFences[i]->Release();
+        mSyncCommandLists[i]->Release();
+        mSyncCommandAllocators[i]->Release();
+        if (mSyncQueryHeaps[i])
+        {
+            mSyncQueryHeaps[i]->Release();
+        }
+        if (mSyncTimestampBuffers[i])
+        {
+            mSyncTimestampBuffers[i]->Release();
+        }
     }
 }
 
@@ -1538,6 +1568,12 @@ EAffinityRenderingMode::Mask CD3DX12AffinityDevice::GetAffinityRenderingMode()
 void CD3DX12AffinityDevice::SetAffinityRenderingMode(EAffinityRenderingMode::Mask renderingmode)
 {
     mAffinityRenderingMode = renderingmode;
+
+    // Work split records frames on the primary node only, so stop wherever AFR left off.
+    if (renderingmode == EAffinityRenderingMode::WorkSplit)
+    {
+        g_ActiveNodeIndex = GetPrimaryNodeIndex();
+    }
 }
 
 UINT CD3DX12AffinityDevice::GetActiveNodeMask()
@@ -1545,33 +1581,126 @@ UINT CD3DX12AffinityDevice::GetActiveNodeMask()
     return 1 << g_ActiveNodeIndex;
 }
 
-void CD3DX12AffinityDevice::SwitchToNextNode()
+UINT CD3DX12AffinityDevice::GetPrimaryNodeIndex()
+{
+    return 0;
+}
+
+UINT CD3DX12AffinityDevice::GetOffloadNodeMask()
 {
-#ifdef SYNC_CROSS_FRAME_RESOURCES
-    // Sync all cross frame resources.
+    return GetNodeMask() & ~(1 << GetPrimaryNodeIndex());
+}
+
+void CD3DX12AffinityDevice::RegisterTemporalResource(CD3DX12AffinityResource* pResource)
+{
+    std::lock_guard<std::mutex> lock(MutexSyncResources);
+    if (std::find(mSyncResources.begin(), mSyncResources.end(), pResource) == mSyncResources.end())
     {
-        std::lock_guard<std::mutex> lock(MutexSyncResources);
-        for (UINT i = 0; i < mSyncResources.size(); i++)
-        {
-            mSyncResources[i]->BroadcastResourceForCrossGPUSync();
-        }
+        mSyncResources.push_back(pResource);
+    }
+}
+
+void CD3DX12AffinityDevice::UnregisterTemporalResource(CD3DX12AffinityResource* pResource)
+{
+    std::lock_guard<std::mutex> lock(MutexSyncResources);
+    mSyncResources.erase(std::remove(mSyncResources.begin(), mSyncResources.end(), pResource), mSyncResources.end());
+}
+
+HRESULT CD3DX12AffinityDevice::SyncTemporalResources(CD3DX12AffinityCommandQueue* pQueue)
+{
+    if (GetAffinityMode() != EAffinityMode::LDA || mAffinityRenderingMode != EAffinityRenderingMode::AFR || GetNodeCount() == 1)
+    {
+        return S_OK;
+    }
+
+    std::lock_guard<std::mutex> lock(MutexSyncResources);
+    if (mSyncResources.empty())
+    {
+        return S_OK;
+    }
+
+    UINT const SrcIndex = g_ActiveNodeIndex;
+    UINT const DstIndex = (g_ActiveNodeIndex + 1) % GetNodeCount();
+    UINT64 const Value = ++mSyncFenceValue;
+
+    // The copy waits for this frame on the source node, and the next frame waits for the copy, both on the GPU.
+    RETURN_IF_FAILED(pQueue->GetChildObject(SrcIndex)->Signal(mSyncFences[SrcIndex], Value));
+    RETURN_IF_FAILED(mSyncCommandQueues[DstIndex]->Wait(mSyncFences[SrcIndex], Value));
 
-        //#ifdef SERIALIZE_COMMNANDLIST_EXECUTION
-        ID3D12Fence* pFence;
-        GetParentDevice()->mDevices[0]->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&pFence));
-        mSyncCommandQueues[mActiveNodeIndex]->Signal(pFence, 1);
+    // The destination's allocator and timestamps are reused once its last copy is done, normally frames ago.
+    if (mSyncFences[DstIndex]->GetCompletedValue() < mSyncFenceValues[DstIndex])
+    {
         HANDLE hEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
-        pFence->SetEventOnCompletion(1, hEvent);
+        mSyncFences[DstIndex]->SetEventOnCompletion(mSyncFenceValues[DstIndex], hEvent);
         WaitForSingleObject(hEvent, INFINITE);
         CloseHandle(hEvent);
-        pFence->Release();
-        if (FAILED(mDevices[0]->GetDeviceRemovedReason()))
+    }
+
+    ID3D12QueryHeap* QueryHeap = mSyncTimestampBuffers[DstIndex] ? mSyncQueryHeaps[DstIndex] : nullptr;
+    if (QueryHeap && mSyncFenceValues[DstIndex] != 0)
+    {
+        UINT64* Timestamps = nullptr;
+        D3D12_RANGE ReadRange = { 0, 2 * sizeof(UINT64) };
+        if (SUCCEEDED(mSyncTimestampBuffers[DstIndex]->Map(0, &ReadRange, reinterpret_cast<void**>(&Timestamps))))
         {
-            __debugbreak();
+            UINT64 Frequency = 0;
+            if (SUCCEEDED(mSyncCommandQueues[DstIndex]->GetTimestampFrequency(&Frequency)) && Frequency != 0)
+            {
+                mTemporalSyncMilliseconds = static_cast<float>((Timestamps[1] - Timestamps[0]) * 1000.0 / Frequency);
+            }
+            D3D12_RANGE WrittenRange = { 0, 0 };
+            mSyncTimestampBuffers[DstIndex]->Unmap(0, &WrittenRange);
         }
-        //#endif
     }
-#endif
+
+    ID3D12GraphicsCommandList* List = mSyncCommandLists[DstIndex];
+    RETURN_IF_FAILED(mSyncCommandAllocators[DstIndex]->Reset());
+    RETURN_IF_FAILED(List->Reset(mSyncCommandAllocators[DstIndex], nullptr));
+
+    if (QueryHeap)
+    {
+        List->EndQuery(QueryHeap, D3D12_QUERY_TYPE_TIMESTAMP, 0);
+    }
+
+    UINT64 Bytes = 0;
+    for (CD3DX12AffinityResource* Resource : mSyncResources)
+    {
+        List->CopyResource(Resource->mResources[DstIndex], Resource->mResources[SrcIndex]);
+        Bytes += GetBufferSizeForResource(Resource->mResources[SrcIndex]);
+    }
+
+    if (QueryHeap)
+    {
+        List->EndQuery(QueryHeap, D3D12_QUERY_TYPE_TIMESTAMP, 1);
+        List->ResolveQueryData(QueryHeap, D3D12_QUERY_TYPE_TIMESTAMP, 0, 2, mSyncTimestampBuffers[DstIndex], 0);
+    }
+
+    RETURN_IF_FAILED(List->Close());
+
+    ID3D12CommandList* CommandLists[] = { List };
+    mSyncCommandQueues[DstIndex]->ExecuteCommandLists(1, CommandLists);
+    RETURN_IF_FAILED(mSyncCommandQueues[DstIndex]->Signal(mSyncFences[DstIndex], Value));
+    mSyncFenceValues[DstIndex] = Value;
+
+    RETURN_IF_FAILED(pQueue->GetChildObject(DstIndex)->Wait(mSyncFences[DstIndex], Value));
+
+    mTemporalSyncBytes = Bytes;
+    ReleaseLog(L"D3DX12AffinityLayer: [event] SyncTemporalResources %llu bytes, %f ms\n", Bytes, mTemporalSyncMilliseconds);
+    return S_OK;
+}
+
+void CD3DX12AffinityDevice::GetTemporalSyncStats(UINT64* pBytes, float* pMilliseconds)
+{
+    *pBytes = mTemporalSyncBytes;
+    *pMilliseconds = mTemporalSyncMilliseconds;
+}
+
+void CD3DX12AffinityDevice::SwitchToNextNode()
+{
+    if (mAffinityRenderingMode == EAffinityRenderingMode::WorkSplit)
+    {
+        return;
+    }
 
     g_ActiveNodeIndex = (g_ActiveNodeIndex + 1) % GetNodeCount();
 }
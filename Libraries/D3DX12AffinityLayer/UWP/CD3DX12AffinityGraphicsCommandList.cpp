@@ -107,6 +107,12 @@ void CD3DX12AffinityGraphicsCommandList::DrawInstanced(
     UINT StartVertexLocation,
     UINT StartInstanceLocation)
 {
+    if (mSingleNodeList)
+    {
+        mSingleNodeList->DrawInstanced(VertexCountPerInstance, InstanceCount, StartVertexLocation, StartInstanceLocation);
+        return;
+    }
+
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
     {
         if (((1 << i) & mAffinityMask) != 0)
@@ -123,6 +129,12 @@ void CD3DX12AffinityGraphicsCommandList::Dispatch(
     UINT ThreadGroupCountY,
     UINT ThreadGroupCountZ)
 {
+    if (mSingleNodeList)
+    {
+        mSingleNodeList->Dispatch(ThreadGroupCountX, ThreadGroupCountY, ThreadGroupCountZ);
+        return;
+    }
+
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
     {
         if (((1 << i) & mAffinityMask) != 0)
@@ -196,6 +208,22 @@ void CD3DX12AffinityGraphicsCommandList::CopyResource(
     }
 }
 
+void CD3DX12AffinityGraphicsCommandList::CopyResourceFromNode(
+    CD3DX12AffinityResource* pDstResource,
+    CD3DX12AffinityResource* pSrcResource,
+    UINT SrcAffinityIndex)
+{
+    for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
+    {
+        if (((1 << i) & mAffinityMask) != 0)
+        {
+            ID3D12GraphicsCommandList* List = mGraphicsCommandLists[i];
+
+            List->CopyResource(pDstResource->mResources[i], pSrcResource->mResources[SrcAffinityIndex]);
+        }
+    }
+}
+
 void CD3DX12AffinityGraphicsCommandList::CopyTiles(
     CD3DX12AffinityResource* pTiledResource,
     const D3D12_TILED_RESOURCE_COORDINATE* pTileRegionStartCoordinate,
@@ -243,6 +271,12 @@ void CD3DX12AffinityGraphicsCommandList::ResolveSubresource(
 void CD3DX12AffinityGraphicsCommandList::IASetPrimitiveTopology(
     D3D12_PRIMITIVE_TOPOLOGY PrimitiveTopology)
 {
+    if (mSingleNodeList)
+    {
+        mSingleNodeList->IASetPrimitiveTopology(PrimitiveTopology);
+        return;
+    }
+
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
     {
         if (((1 << i) & mAffinityMask) != 0)
@@ -257,6 +291,12 @@ void CD3DX12AffinityGraphicsCommandList::RSSetViewports(
     UINT NumViewports,
     const D3D12_VIEWPORT* pViewports)
 {
+    if (mSingleNodeList)
+    {
+        mSingleNodeList->RSSetViewports(NumViewports, pViewports);
+        return;
+    }
+
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
     {
         if (((1 << i) & mAffinityMask) != 0)
@@ -271,6 +311,12 @@ void CD3DX12AffinityGraphicsCommandList::RSSetScissorRects(
     UINT NumRects,
     const D3D12_RECT* pRects)
 {
+    if (mSingleNodeList)
+    {
+        mSingleNodeList->RSSetScissorRects(NumRects, pRects);
+        return;
+    }
+
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
     {
         if (((1 << i) & mAffinityMask) != 0)
@@ -284,6 +330,12 @@ void CD3DX12AffinityGraphicsCommandList::RSSetScissorRects(
 void CD3DX12AffinityGraphicsCommandList::OMSetBlendFactor(
     const FLOAT BlendFactor[4])
 {
+    if (mSingleNodeList)
+    {
+        mSingleNodeList->OMSetBlendFactor(BlendFactor);
+        return;
+    }
+
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
     {
         if (((1 << i) & mAffinityMask) != 0)
@@ -297,6 +349,12 @@ void CD3DX12AffinityGraphicsCommandList::OMSetBlendFactor(
 void CD3DX12AffinityGraphicsCommandList::OMSetStencilRef(
     UINT StencilRef)
 {
+    if (mSingleNodeList)
+    {
+        mSingleNodeList->OMSetStencilRef(StencilRef);
+        return;
+    }
+
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
     {
         if (((1 << i) & mAffinityMask) != 0)
@@ -400,6 +458,12 @@ void CD3DX12AffinityGraphicsCommandList::SetDescriptorHeaps(
 void CD3DX12AffinityGraphicsCommandList::SetComputeRootSignature(
     CD3DX12AffinityRootSignature* pRootSignature)
 {
+    if (mSingleNodeList)
+    {
+        mSingleNodeList->SetComputeRootSignature(pRootSignature->mRootSignatures[0]);
+        return;
+    }
+
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
     {
         if (((1 << i) & mAffinityMask) != 0)
@@ -414,6 +478,12 @@ void CD3DX12AffinityGraphicsCommandList::SetComputeRootSignature(
 void CD3DX12AffinityGraphicsCommandList::SetGraphicsRootSignature(
     CD3DX12AffinityRootSignature* pRootSignature)
 {
+    if (mSingleNodeList)
+    {
+        mSingleNodeList->SetGraphicsRootSignature(pRootSignature->mRootSignatures[0]);
+        return;
+    }
+
     CD3DX12AffinityRootSignature* AffinityRootSignature = static_cast<CD3DX12AffinityRootSignature*>(pRootSignature);
 
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
@@ -432,6 +502,12 @@ void CD3DX12AffinityGraphicsCommandList::SetComputeRoot32BitConstant(
     UINT SrcData,
     UINT DestOffsetIn32BitValues)
 {
+    if (mSingleNodeList)
+    {
+        mSingleNodeList->SetComputeRoot32BitConstant(RootParameterIndex, SrcData, DestOffsetIn32BitValues);
+        return;
+    }
+
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
     {
         if (((1 << i) & mAffinityMask) != 0)
@@ -448,6 +524,12 @@ void CD3DX12AffinityGraphicsCommandList::SetGraphicsRoot32BitConstant(
     UINT SrcData,
     UINT DestOffsetIn32BitValues)
 {
+    if (mSingleNodeList)
+    {
+        mSingleNodeList->SetGraphicsRoot32BitConstant(RootParameterIndex, SrcData, DestOffsetIn32BitValues);
+        return;
+    }
+
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
     {
         if (((1 << i) & mAffinityMask) != 0)
@@ -465,6 +547,12 @@ void CD3DX12AffinityGraphicsCommandList::SetComputeRoot32BitConstants(
     const void* pSrcData,
     UINT DestOffsetIn32BitValues)
 {
+    if (mSingleNodeList)
+    {
+        mSingleNodeList->SetComputeRoot32BitConstants(RootParameterIndex, Num32BitValuesToSet, pSrcData, DestOffsetIn32BitValues);
+        return;
+    }
+
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
     {
         if (((1 << i) & mAffinityMask) != 0)
@@ -482,6 +570,12 @@ void CD3DX12AffinityGraphicsCommandList::SetGraphicsRoot32BitConstants(
     const void* pSrcData,
     UINT DestOffsetIn32BitValues)
 {
+    if (mSingleNodeList)
+    {
+        mSingleNodeList->SetGraphicsRoot32BitConstants(RootParameterIndex, Num32BitValuesToSet, pSrcData, DestOffsetIn32BitValues);
+        return;
+    }
+
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
     {
         if (((1 << i) & mAffinityMask) != 0)
@@ -497,6 +591,12 @@ void CD3DX12AffinityGraphicsCommandList::SetComputeRootConstantBufferView(
     UINT RootParameterIndex,
     D3D12_GPU_VIRTUAL_ADDRESS BufferLocation)
 {
+    if (mSingleNodeList)
+    {
+        mSingleNodeList->SetComputeRootConstantBufferView(RootParameterIndex, BufferLocation);
+        return;
+    }
+
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
     {
         if (((1 << i) & mAffinityMask) != 0)
@@ -512,6 +612,12 @@ void CD3DX12AffinityGraphicsCommandList::SetGraphicsRootConstantBufferView(
     UINT RootParameterIndex,
     D3D12_GPU_VIRTUAL_ADDRESS BufferLocation)
 {
+    if (mSingleNodeList)
+    {
+        mSingleNodeList->SetGraphicsRootConstantBufferView(RootParameterIndex, BufferLocation);
+        return;
+    }
+
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
     {
         if (((1 << i) & mAffinityMask) != 0)
@@ -527,6 +633,12 @@ void CD3DX12AffinityGraphicsCommandList::SetComputeRootShaderResourceView(
     UINT RootParameterIndex,
     D3D12_GPU_VIRTUAL_ADDRESS BufferLocation)
 {
+    if (mSingleNodeList)
+    {
+        mSingleNodeList->SetComputeRootShaderResourceView(RootParameterIndex, BufferLocation);
+        return;
+    }
+
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
     {
         if (((1 << i) & mAffinityMask) != 0)
@@ -542,6 +654,12 @@ void CD3DX12AffinityGraphicsCommandList::SetGraphicsRootShaderResourceView(
     UINT RootParameterIndex,
     D3D12_GPU_VIRTUAL_ADDRESS BufferLocation)
 {
+    if (mSingleNodeList)
+    {
+        mSingleNodeList->SetGraphicsRootShaderResourceView(RootParameterIndex, BufferLocation);
+        return;
+    }
+
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
     {
         if (((1 << i) & mAffinityMask) != 0)
@@ -557,6 +675,12 @@ void CD3DX12AffinityGraphicsCommandList::SetComputeRootUnorderedAccessView(
     UINT RootParameterIndex,
     D3D12_GPU_VIRTUAL_ADDRESS BufferLocation)
 {
+    if (mSingleNodeList)
+    {
+        mSingleNodeList->SetComputeRootUnorderedAccessView(RootParameterIndex, BufferLocation);
+        return;
+    }
+
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
     {
         if (((1 << i) & mAffinityMask) != 0)
@@ -572,6 +696,12 @@ void CD3DX12AffinityGraphicsCommandList::SetGraphicsRootUnorderedAccessView(
     UINT RootParameterIndex,
     D3D12_GPU_VIRTUAL_ADDRESS BufferLocation)
 {
+    if (mSingleNodeList)
+    {
+        mSingleNodeList->SetGraphicsRootUnorderedAccessView(RootParameterIndex, BufferLocation);
+        return;
+    }
+
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
     {
         if (((1 << i) & mAffinityMask) != 0)
@@ -588,6 +718,12 @@ void CD3DX12AffinityGraphicsCommandList::IASetVertexBuffers(
     UINT NumViews,
     const D3D12_VERTEX_BUFFER_VIEW* pViews)
 {
+    if (mSingleNodeList)
+    {
+        mSingleNodeList->IASetVertexBuffers(StartSlot, NumViews, pViews);
+        return;
+    }
+
     mCachedBufferViews.resize(NumViews);
 
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
@@ -638,6 +774,12 @@ void CD3DX12AffinityGraphicsCommandList::OMSetRenderTargets(
     BOOL RTsSingleHandleToDescriptorRange,
     const D3D12_CPU_DESCRIPTOR_HANDLE* pDepthStencilDescriptor)
 {
+    if (mSingleNodeList)
+    {
+        mSingleNodeList->OMSetRenderTargets(NumRenderTargetDescriptors, pRenderTargetDescriptors, RTsSingleHandleToDescriptorRange, pDepthStencilDescriptor);
+        return;
+    }
+
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
     {
         if (((1 << i) & mAffinityMask) != 0)
@@ -946,6 +1088,9 @@ CD3DX12AffinityGraphicsCommandList::CD3DX12AffinityGraphicsCommandList(CD3DX12Af
     mObjectTypeName = L"GraphicsCommandList";
 #endif
 
+    // With a single node there is nothing to translate, so hot calls forward straight to the child list.
+    mSingleNodeList = (GetNodeCount() == 1) ? mGraphicsCommandLists[0] : nullptr;
+
     if (UseDeviceActiveMaskOnReset)
     {
         SetAffinity(1 << GetActiveNodeIndex());
@@ -959,6 +1104,12 @@ CD3DX12AffinityGraphicsCommandList::CD3DX12AffinityGraphicsCommandList(CD3DX12Af
 void CD3DX12AffinityGraphicsCommandList::SetPipelineState(
     CD3DX12AffinityPipelineState* pPipelineState)
 {
+    if (mSingleNodeList)
+    {
+        mSingleNodeList->SetPipelineState(pPipelineState->mPipelineStates[0]);
+        return;
+    }
+
     CD3DX12AffinityPipelineState* PipelineState = static_cast<CD3DX12AffinityPipelineState*>(pPipelineState);
 
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
@@ -976,6 +1127,12 @@ void CD3DX12AffinityGraphicsCommandList::SetComputeRootDescriptorTable(
     UINT RootParameterIndex,
     D3D12_GPU_DESCRIPTOR_HANDLE BaseDescriptor)
 {
+    if (mSingleNodeList)
+    {
+        mSingleNodeList->SetComputeRootDescriptorTable(RootParameterIndex, BaseDescriptor);
+        return;
+    }
+
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
     {
         if (((1 << i) & mAffinityMask) != 0)
@@ -991,6 +1148,12 @@ void CD3DX12AffinityGraphicsCommandList::SetGraphicsRootDescriptorTable(
     UINT RootParameterIndex,
     D3D12_GPU_DESCRIPTOR_HANDLE BaseDescriptor)
 {
+    if (mSingleNodeList)
+    {
+        mSingleNodeList->SetGraphicsRootDescriptorTable(RootParameterIndex, BaseDescriptor);
+        return;
+    }
+
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
     {
         if (((1 << i) & mAffinityMask) != 0)
@@ -1005,6 +1168,12 @@ void CD3DX12AffinityGraphicsCommandList::SetGraphicsRootDescriptorTable(
 void CD3DX12AffinityGraphicsCommandList::IASetIndexBuffer(
     const D3D12_INDEX_BUFFER_VIEW* pView)
 {
+    if (mSingleNodeList)
+    {
+        mSingleNodeList->IASetIndexBuffer(pView);
+        return;
+    }
+
     if (pView)
     {
         D3D12_INDEX_BUFFER_VIEW View = *pView;
@@ -1040,6 +1209,12 @@ void CD3DX12AffinityGraphicsCommandList::DrawIndexedInstanced(
     INT BaseVertexLocation,
     UINT StartInstanceLocation)
 {
+    if (mSingleNodeList)
+    {
+        mSingleNodeList->DrawIndexedInstanced(IndexCountPerInstance, InstanceCount, StartIndexLocation, BaseVertexLocation, StartInstanceLocation);
+        return;
+    }
+
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
     {
         if (((1 << i) & mAffinityMask) != 0)
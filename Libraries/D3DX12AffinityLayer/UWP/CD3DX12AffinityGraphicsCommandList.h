@@ -70,6 +70,13 @@ public:
         _In_  CD3DX12AffinityResource* pDstResource,
         _In_  CD3DX12AffinityResource* pSrcResource);
 
+    // Copies the source's instance on another node into the destination's instance on each
+    // node this list records for, e.g. a shadow map rendered on an offload node.
+    void CopyResourceFromNode(
+        _In_  CD3DX12AffinityResource* pDstResource,
+        _In_  CD3DX12AffinityResource* pSrcResource,
+        _In_  UINT SrcAffinityIndex);
+
     void CopyTiles(
         _In_  CD3DX12AffinityResource* pTiledResource,
         _In_  const D3D12_TILED_RESOURCE_COORDINATE* pTileRegionStartCoordinate,
@@ -281,6 +288,7 @@ public:
 
 private:
     ID3D12GraphicsCommandList* mGraphicsCommandLists[D3DX12_MAX_ACTIVE_NODES];
+    ID3D12GraphicsCommandList* mSingleNodeList;
     UINT mAccumulatedAffinityMask;
     bool mUseDeviceActiveMaskOnReset;
     std::vector<D3D12_RESOURCE_BARRIER> mCachedResourceBarriers;
@@ -64,6 +64,25 @@ HRESULT WINAPI D3DX12AffinityCreateLDADevice(
     _In_ ID3D12Device* Device,
     _Outptr_  CD3DX12AffinityDevice** ppDevice);
 
+// Shares a resource or fence between unlinked adapters. The consumer objects are opened
+// from the producer's cross-adapter heap or shared fence.
+HRESULT WINAPI D3DX12AffinityCreateCrossAdapterResource(
+    _In_ ID3D12Device* pProducerDevice,
+    _In_ ID3D12Device* pConsumerDevice,
+    _In_ const D3D12_RESOURCE_DESC* pDesc,
+    D3D12_RESOURCE_STATES InitialState,
+    _Outptr_ ID3D12Heap** ppProducerHeap,
+    _Outptr_ ID3D12Resource** ppProducerResource,
+    _Outptr_ ID3D12Heap** ppConsumerHeap,
+    _Outptr_ ID3D12Resource** ppConsumerResource);
+
+HRESULT WINAPI D3DX12AffinityCreateCrossAdapterFence(
+    _In_ ID3D12Device* pProducerDevice,
+    _In_ ID3D12Device* pConsumerDevice,
+    UINT64 InitialValue,
+    _Outptr_ ID3D12Fence** ppProducerFence,
+    _Outptr_ ID3D12Fence** ppConsumerFence);
+
 HRESULT STDMETHODCALLTYPE DXGIXAffinityCreateSingleWindowSwapChain(
     _In_  IDXGISwapChain3* pSwapChain,
     _In_  CD3DX12AffinityCommandQueue* pQueue,
@@ -88,6 +88,7 @@ namespace D3DX12Residency
                 for (UINT32 i = 0; i < ARRAYSIZE(AvailableCommandLists); i++)
                 {
                     AvailableCommandLists[i] = false;
+                    CommandListGenerations[i] = 0;
                 }
             }
 
@@ -96,6 +97,8 @@ namespace D3DX12Residency
             static const UINT32 sUnsetValue = UINT32(-1);
             // Represents which command lists are currently open for recording
             bool AvailableCommandLists[MAX_NUM_CONCURRENT_CMD_LISTS];
+            // Counts the times each command list slot was opened, so sets never have to clear what they marked
+            UINT32 CommandListGenerations[MAX_NUM_CONCURRENT_CMD_LISTS];
         };
 
         //Forward Declaration
@@ -118,7 +121,8 @@ namespace D3DX12Residency
             Size(0),
             ResidencyStatus(RESIDENCY_STATUS::RESIDENT),
             LastGPUSyncPoint(0),
-            LastUsedTimestamp(0)
+            LastUsedTimestamp(0),
+            Priority(D3D12_RESIDENCY_PRIORITY_NORMAL)
         {
             memset(CommandListsUsedOn, 0, sizeof(CommandListsUsedOn));
         }
@@ -144,13 +148,32 @@ namespace D3DX12Residency
         UINT64 LastGPUSyncPoint;
         UINT64 LastUsedTimestamp;
 
-        // This is used to track which open command lists this resource is currently used on.
-        bool CommandListsUsedOn[MAX_NUM_CONCURRENT_CMD_LISTS];
+        // Lower priorities are evicted first. Set before tracking begins, or through ResidencyManager::SetResidencyPriority after
+        D3D12_RESIDENCY_PRIORITY Priority;
+
+        // This is used to track which open command lists this resource is currently used on. Each entry holds
+        // the generation of the set that last inserted the object in that slot; 0 is never.
+        UINT32 CommandListsUsedOn[MAX_NUM_CONCURRENT_CMD_LISTS];
 
         // Linked list entry
         LIST_ENTRY ListEntry;
     };
 
+    // Totals of the paging work done since the manager was initialized or its statistics were last reset
+    struct ResidencyStatistics
+    {
+        UINT64 NumMakeResidentCalls;
+        UINT64 NumObjectsMadeResident;
+        UINT64 BytesMadeResident;
+        UINT32 LargestMakeResidentBatch;
+        // Time spent blocked in MakeResident on the paging thread
+        UINT64 TotalMakeResidentMicroseconds;
+        UINT64 LongestMakeResidentMicroseconds;
+
+        UINT64 NumEvictCalls;
+        UINT64 NumObjectsEvicted;
+    };
+
     // This represents a set of objects which are referenced by a command list i.e. every time a resource
     // is bound for rendering, clearing, copy etc. the set must be updated to ensure the it is resident 
     // for execution.
@@ -167,9 +190,11 @@ namespace D3DX12Residency
             MaxResidencySetSize(0),
             CurrentSetSize(0),
             ppSet(nullptr),
+            Generation(0),
             IsOpen(false),
             OutOfMemory(false),
-            pSyncManager(nullptr)
+            pSyncManager(nullptr),
+            pNextFree(nullptr)
         {
         };
 
@@ -185,9 +210,9 @@ namespace D3DX12Residency
             RESIDENCY_CHECK(CommandListIndex != InvalidIndex);
 
             // If we haven't seen this object on this command list mark it
-            if (pObject->CommandListsUsedOn[CommandListIndex] == false)
+            if (pObject->CommandListsUsedOn[CommandListIndex] != Generation)
             {
-                pObject->CommandListsUsedOn[CommandListIndex] = true;
+                pObject->CommandListsUsedOn[CommandListIndex] = Generation;
                 if (ppSet == nullptr || CurrentSetSize >= MaxResidencySetSize)
                 {
                     Realloc();
@@ -229,6 +254,13 @@ namespace D3DX12Residency
                     CommandListIndex = i;
                     pSyncManager->AvailableCommandLists[i] = true;
                     CommandlistAvailable = true;
+
+                    // Skip 0 when the count wraps, as that marks objects never inserted
+                    Generation = ++pSyncManager->CommandListGenerations[i];
+                    if (Generation == 0)
+                    {
+                        Generation = ++pSyncManager->CommandListGenerations[i];
+                    }
                     break;
                 }
             }
@@ -259,11 +291,7 @@ namespace D3DX12Residency
                 return E_OUTOFMEMORY;
             }
 
-            for (INT32 i = 0; i < CurrentSetSize; i++)
-            {
-                Remove(ppSet[i]);
-            }
-
+            // The objects keep this set's generation, which the next set opened in this slot won't match
             ReturnCommandListReservation();
 
             IsOpen = false;
@@ -273,11 +301,6 @@ namespace D3DX12Residency
 
     private:
 
-        inline void Remove(ManagedObject* pObject)
-        {
-            pObject->CommandListsUsedOn[CommandListIndex] = false;
-        }
-
         inline void ReturnCommandListReservation()
         {
             Internal::ScopedLock Lock(&pSyncManager->MaskCriticalSection);
@@ -294,11 +317,16 @@ namespace D3DX12Residency
             pSyncManager = pSyncManagerIn;
         }
 
-        bool Initialize(Internal::SyncManager* pSyncManagerIn, UINT32 MaxSize)
+        // Grows the set to hold at least MaxSize objects, keeping the storage of a set that is reused
+        bool Reserve(UINT32 MaxSize)
         {
-            pSyncManager = pSyncManagerIn;
-            MaxResidencySetSize = MaxSize;
+            if (ppSet != nullptr && MaxResidencySetSize >= INT32(MaxSize))
+            {
+                return true;
+            }
 
+            delete[](ppSet);
+            MaxResidencySetSize = MaxSize;
             ppSet = new ManagedObject*[MaxResidencySetSize];
 
             return ppSet != nullptr;
@@ -319,6 +347,7 @@ namespace D3DX12Residency
         }
 
         UINT32 CommandListIndex;
+        UINT32 Generation;
 
         ManagedObject** ppSet;
         INT32 MaxResidencySetSize;
@@ -328,6 +357,9 @@ namespace D3DX12Residency
         bool OutOfMemory;
 
         Internal::SyncManager* pSyncManager;
+
+        // Links the residency manager's pool of sets that gather each submission's objects
+        ResidencySet* pNextFree;
     };
 
     namespace Internal
@@ -490,32 +522,64 @@ namespace D3DX12Residency
                 }
             }
 
-            const UINT64 GenerationID;
+            UINT64 GenerationID;    // Reset when the sync point is reused
             const UINT32 NumQueueSyncPoints;
             LIST_ENTRY ListEntry;
             // NumQueueSyncPoints QueueSyncPoints will be placed below here
             QueueSyncPoint pQueueSyncPoints[1];
         };
 
-        // A Least Recently Used Cache. Tracks all of the objects requested by the app so that objects
-        // that aren't used freqently can get evicted to help the app stay under buget.
+        // A Least Recently Used Cache per priority band. Objects in lower bands are evicted first when the
+        // budget is exceeded; within a band, the least recently used go first.
         class LRUCache
         {
         public:
+            static const UINT32 NumPriorityBands = 5;
+
             LRUCache() :
                 NumResidentObjects(0),
                 NumEvictedObjects(0),
                 ResidentSize(0)
             {
-                Internal::InitializeListHead(&ResidentObjectListHead);
+                for (UINT32 i = 0; i < NumPriorityBands; i++)
+                {
+                    Internal::InitializeListHead(&ResidentObjectListHeads[i]);
+                }
                 Internal::InitializeListHead(&EvictedObjectListHead);
             };
 
+            // Buckets the priorities D3D12 defines, and anything between them, into bands
+            static UINT32 GetPriorityBand(D3D12_RESIDENCY_PRIORITY Priority)
+            {
+                if (Priority < D3D12_RESIDENCY_PRIORITY_LOW)
+                {
+                    return 0;
+                }
+                else if (Priority < D3D12_RESIDENCY_PRIORITY_NORMAL)
+                {
+                    return 1;
+                }
+                else if (Priority < D3D12_RESIDENCY_PRIORITY_HIGH)
+                {
+                    return 2;
+                }
+                else if (Priority < D3D12_RESIDENCY_PRIORITY_MAXIMUM)
+                {
+                    return 3;
+                }
+                return 4;
+            }
+
+            LIST_ENTRY* GetResidentList(ManagedObject* pObject)
+            {
+                return &ResidentObjectListHeads[GetPriorityBand(pObject->Priority)];
+            }
+
             void Insert(ManagedObject* pObject)
             {
                 if (pObject->ResidencyStatus == ManagedObject::RESIDENCY_STATUS::RESIDENT)
                 {
-                    Internal::InsertHeadList(&ResidentObjectListHead, &pObject->ListEntry);
+                    Internal::InsertHeadList(GetResidentList(pObject), &pObject->ListEntry);
                     NumResidentObjects++;
                     ResidentSize += pObject->Size;
                 }
@@ -540,6 +604,28 @@ namespace D3DX12Residency
                 }
             }
 
+            // A resident object moves to the band of its new priority, keeping its place by age
+            void SetPriority(ManagedObject* pObject, D3D12_RESIDENCY_PRIORITY Priority)
+            {
+                const bool ChangesBand = GetPriorityBand(Priority) != GetPriorityBand(pObject->Priority);
+                pObject->Priority = Priority;
+
+                if (ChangesBand && pObject->ResidencyStatus == ManagedObject::RESIDENCY_STATUS::RESIDENT)
+                {
+                    Internal::RemoveEntryList(&pObject->ListEntry);
+
+                    // Sync points only increase along a band, so insert after the last object used no later
+                    LIST_ENTRY* pHead = GetResidentList(pObject);
+                    LIST_ENTRY* pEntry = pHead->Blink;
+                    while (pEntry != pHead &&
+                        CONTAINING_RECORD(pEntry, ManagedObject, ListEntry)->LastGPUSyncPoint > pObject->LastGPUSyncPoint)
+                    {
+                        pEntry = pEntry->Blink;
+                    }
+                    Internal::InsertHeadList(pEntry, &pObject->ListEntry);
+                }
+            }
+
             // When an object is used by the GPU we move it to the end of the list.
             // This way things closer to the head of the list are the objects which
             // are stale and better candidates for eviction
@@ -548,7 +634,7 @@ namespace D3DX12Residency
                 RESIDENCY_CHECK(pObject->ResidencyStatus == ManagedObject::RESIDENCY_STATUS::RESIDENT);
 
                 Internal::RemoveEntryList(&pObject->ListEntry);
-                Internal::InsertTailList(&ResidentObjectListHead, &pObject->ListEntry);
+                Internal::InsertTailList(GetResidentList(pObject), &pObject->ListEntry);
             }
 
             void MakeResident(ManagedObject* pObject)
@@ -557,7 +643,7 @@ namespace D3DX12Residency
 
                 pObject->ResidencyStatus = ManagedObject::RESIDENCY_STATUS::RESIDENT;
                 Internal::RemoveEntryList(&pObject->ListEntry);
-                Internal::InsertTailList(&ResidentObjectListHead, &pObject->ListEntry);
+                Internal::InsertTailList(GetResidentList(pObject), &pObject->ListEntry);
 
                 NumEvictedObjects--;
                 NumResidentObjects++;
@@ -577,64 +663,81 @@ namespace D3DX12Residency
                 NumEvictedObjects++;
             }
 
-            // Evict all of the resident objects used in sync points up to the specficied one (inclusive)
+            // Evict all of the resident objects used in sync points up to the specficied one (inclusive), lowest priority first
             void TrimToSyncPointInclusive(INT64 CurrentUsage, INT64 CurrentBudget, ID3D12Pageable** EvictionList, UINT32& NumObjectsToEvict, UINT64 SyncPoint)
             {
                 NumObjectsToEvict = 0;
 
-                LIST_ENTRY* pResourceEntry = ResidentObjectListHead.Flink;
-                while (pResourceEntry != &ResidentObjectListHead)
+                for (UINT32 Band = 0; Band < NumPriorityBands && CurrentUsage >= CurrentBudget; Band++)
                 {
-                    ManagedObject* pObject = CONTAINING_RECORD(pResourceEntry, ManagedObject, ListEntry);
-
-                    if (pObject->LastGPUSyncPoint > SyncPoint || CurrentUsage < CurrentBudget)
+                    LIST_ENTRY* pHead = &ResidentObjectListHeads[Band];
+                    LIST_ENTRY* pResourceEntry = pHead->Flink;
+                    while (pResourceEntry != pHead)
                     {
-                        break;
-                    }
+                        ManagedObject* pObject = CONTAINING_RECORD(pResourceEntry, ManagedObject, ListEntry);
+
+                        if (pObject->LastGPUSyncPoint > SyncPoint || CurrentUsage < CurrentBudget)
+                        {
+                            break;
+                        }
 
-                    RESIDENCY_CHECK(pObject->ResidencyStatus == ManagedObject::RESIDENCY_STATUS::RESIDENT);
+                        RESIDENCY_CHECK(pObject->ResidencyStatus == ManagedObject::RESIDENCY_STATUS::RESIDENT);
 
-                    EvictionList[NumObjectsToEvict++] = pObject->pUnderlying;
-                    Evict(pObject);
+                        EvictionList[NumObjectsToEvict++] = pObject->pUnderlying;
+                        Evict(pObject);
 
-                    CurrentUsage -= pObject->Size;
+                        CurrentUsage -= pObject->Size;
 
-                    pResourceEntry = ResidentObjectListHead.Flink;
+                        pResourceEntry = pHead->Flink;
+                    }
                 }
             }
 
             // Trim all objects which are older than the specified time
             void TrimAgedAllocations(DeviceWideSyncPoint* MaxSyncPoint, ID3D12Pageable** EvictionList, UINT32& NumObjectsToEvict, UINT64 CurrentTimeStamp, UINT64 MinDelta)
             {
-                LIST_ENTRY* pResourceEntry = ResidentObjectListHead.Flink;
-                while (pResourceEntry != &ResidentObjectListHead)
+                for (UINT32 Band = 0; Band < NumPriorityBands; Band++)
                 {
-                    ManagedObject* pObject = CONTAINING_RECORD(pResourceEntry, ManagedObject, ListEntry);
-
-                    if ((MaxSyncPoint && pObject->LastGPUSyncPoint >= MaxSyncPoint->GenerationID) || // Only trim allocations done on the GPU
-                        CurrentTimeStamp - pObject->LastUsedTimestamp <= MinDelta) // Don't evict things which have been used recently
+                    LIST_ENTRY* pHead = &ResidentObjectListHeads[Band];
+                    LIST_ENTRY* pResourceEntry = pHead->Flink;
+                    while (pResourceEntry != pHead)
                     {
-                        break;
-                    }
+                        ManagedObject* pObject = CONTAINING_RECORD(pResourceEntry, ManagedObject, ListEntry);
 
-                    RESIDENCY_CHECK(pObject->ResidencyStatus == ManagedObject::RESIDENCY_STATUS::RESIDENT);
-                    EvictionList[NumObjectsToEvict++] = pObject->pUnderlying;
-                    Evict(pObject);
+                        if ((MaxSyncPoint && pObject->LastGPUSyncPoint >= MaxSyncPoint->GenerationID) || // Only trim allocations done on the GPU
+                            CurrentTimeStamp - pObject->LastUsedTimestamp <= MinDelta) // Don't evict things which have been used recently
+                        {
+                            break;
+                        }
 
-                    pResourceEntry = ResidentObjectListHead.Flink;
+                        RESIDENCY_CHECK(pObject->ResidencyStatus == ManagedObject::RESIDENCY_STATUS::RESIDENT);
+                        EvictionList[NumObjectsToEvict++] = pObject->pUnderlying;
+                        Evict(pObject);
+
+                        pResourceEntry = pHead->Flink;
+                    }
                 }
             }
 
+            // The resident object used longest ago, of any priority
             ManagedObject* GetResidentListHead()
             {
-                if (IsListEmpty(&ResidentObjectListHead))
+                ManagedObject* pOldest = nullptr;
+                for (UINT32 Band = 0; Band < NumPriorityBands; Band++)
                 {
-                    return nullptr;
+                    if (IsListEmpty(&ResidentObjectListHeads[Band]) == false)
+                    {
+                        ManagedObject* pObject = CONTAINING_RECORD(ResidentObjectListHeads[Band].Flink, ManagedObject, ListEntry);
+                        if (pOldest == nullptr || pObject->LastGPUSyncPoint < pOldest->LastGPUSyncPoint)
+                        {
+                            pOldest = pObject;
+                        }
+                    }
                 }
-                return CONTAINING_RECORD(ResidentObjectListHead.Flink, ManagedObject, ListEntry);
+                return pOldest;
             }
 
-            LIST_ENTRY ResidentObjectListHead;
+            LIST_ENTRY ResidentObjectListHeads[NumPriorityBands];
             LIST_ENTRY EvictedObjectListHead;
 
             UINT32 NumResidentObjects;
@@ -648,6 +751,7 @@ namespace D3DX12Residency
         public:
             ResidencyManagerInternal(SyncManager* pSyncManagerIn) :
                 Device(nullptr),
+                Device1(nullptr),
                 AsyncThreadFence(1),
                 CompletionEvent(INVALID_HANDLE_VALUE),
                 AsyncThreadWorkCompletionEvent(INVALID_HANDLE_VALUE),
@@ -667,10 +771,18 @@ namespace D3DX12Residency
                 AsyncWorkQueue(nullptr),
                 MaxSoftwareQueueLatency(6),
                 AsyncWorkQueueSize(7),
-                pSyncManager(pSyncManagerIn)
+                pSyncManager(pSyncManagerIn),
+                pFreeMasterSets(nullptr),
+                pMakeResidentScratch(nullptr),
+                MakeResidentScratchSize(0),
+                pEvictionScratch(nullptr),
+                EvictionScratchSize(0),
+                TicksPerSecond(1)
             {
+                ZeroMemory(&Statistics, sizeof(Statistics));
                 Internal::InitializeListHead(&QueueFencesListHead);
                 Internal::InitializeListHead(&InFlightSyncPointsHead);
+                Internal::InitializeListHead(&FreeSyncPointsHead);
 
                 ResidencyManagerUniqueID = InterlockedIncrement64(&g_ResidencyManagerUniqueID);
             };
@@ -680,6 +792,13 @@ namespace D3DX12Residency
             {
                 Device = ParentDevice;
                 NodeIndex = DeviceNodeIndex;
+
+                // Priorities still order eviction without ID3D12Device1, the OS just doesn't see them
+                if (FAILED(Device->QueryInterface(IID_PPV_ARGS(&Device1))))
+                {
+                    Device1 = nullptr;
+                }
+
                 Adapter = ParentAdapter;
                 MaxSoftwareQueueLatency = MaxLatency;
 
@@ -693,6 +812,7 @@ namespace D3DX12Residency
 
                 LARGE_INTEGER Frequency;
                 QueryPerformanceFrequency(&Frequency);
+                TicksPerSecond = UINT64(Frequency.QuadPart);
 
                 // Calculate how many QPC ticks are equivalent to the given time in seconds
                 MinEvictionGracePeriodTicks = UINT64(Frequency.QuadPart * cMinEvictionGracePeriod);
@@ -747,6 +867,12 @@ namespace D3DX12Residency
             {
                 AsyncThreadFence.Destroy();
 
+                if (Device1)
+                {
+                    Device1->Release();
+                    Device1 = nullptr;
+                }
+
                 if (CompletionEvent != INVALID_HANDLE_VALUE)
                 {
                     CloseHandle(CompletionEvent);
@@ -798,6 +924,35 @@ namespace D3DX12Residency
                     Internal::RemoveHeadList(&QueueFencesListHead);
                     delete(pObject);
                 }
+
+                while (pFreeMasterSets)
+                {
+                    ResidencySet* pSet = pFreeMasterSets;
+                    pFreeMasterSets = pSet->pNextFree;
+                    delete(pSet);
+                }
+
+                FreeSyncPoints();
+
+                delete[](pMakeResidentScratch);
+                pMakeResidentScratch = nullptr;
+                MakeResidentScratchSize = 0;
+
+                delete[](pEvictionScratch);
+                pEvictionScratch = nullptr;
+                EvictionScratchSize = 0;
+            }
+
+            void GetStatistics(ResidencyStatistics* pStatistics)
+            {
+                Internal::ScopedLock Lock(&Mutex);
+                *pStatistics = Statistics;
+            }
+
+            void ResetStatistics()
+            {
+                Internal::ScopedLock Lock(&Mutex);
+                ZeroMemory(&Statistics, sizeof(Statistics));
             }
 
             void BeginTrackingObject(ManagedObject* pObject)
@@ -814,6 +969,11 @@ namespace D3DX12Residency
                     }
 
                     LRU.Insert(pObject);
+
+                    if (Device1 && pObject->Priority != D3D12_RESIDENCY_PRIORITY_NORMAL)
+                    {
+                        RESIDENCY_CHECK_RESULT(Device1->SetResidencyPriority(1, &pObject->pUnderlying, &pObject->Priority));
+                    }
                 }
             }
 
@@ -824,6 +984,57 @@ namespace D3DX12Residency
                 LRU.Remove(pObject);
             }
 
+            void SetResidencyPriority(ManagedObject* pObject, D3D12_RESIDENCY_PRIORITY Priority)
+            {
+                Internal::ScopedLock Lock(&Mutex);
+
+                LRU.SetPriority(pObject, Priority);
+
+                if (Device1)
+                {
+                    RESIDENCY_CHECK_RESULT(Device1->SetResidencyPriority(1, &pObject->pUnderlying, &Priority));
+                }
+            }
+
+            // Queues the objects to be made resident on the paging thread without making any queue wait for them. They
+            // count as used by the next submission, so they won't be trimmed before it if they were prefetched for it.
+            HRESULT Prefetch(ManagedObject** ppObjects, UINT32 Count)
+            {
+                ResidencySet* pMasterSet = AcquireMasterSet(Count);
+                if (pMasterSet == nullptr)
+                {
+                    return E_OUTOFMEMORY;
+                }
+
+                HRESULT hr = pMasterSet->Open();
+                if (SUCCEEDED(hr))
+                {
+                    for (UINT32 i = 0; i < Count; i++)
+                    {
+                        pMasterSet->Insert(ppObjects[i]);
+                    }
+                    hr = pMasterSet->Close();
+                }
+
+                if (FAILED(hr))
+                {
+                    ReleaseMasterSet(pMasterSet);
+                    return hr;
+                }
+
+                Internal::ScopedLock Lock(&ExecutionCS);
+
+                // The paging thread signals the fence once it's done, but nothing waits on this value; the next submission's
+                // wait on a later one still covers it as the work is processed in order
+                hr = EnqueueAsyncWork(pMasterSet, AsyncThreadFence.FenceValue, CurrentSyncPointGeneration);
+#if RESIDENCY_SINGLE_THREADED
+                AsyncWorkload* pWorkload = DequeueAsyncWork();
+                ProcessPagingWork(pWorkload);
+#endif
+                AsyncThreadFence.Increment();
+                return hr;
+            }
+
             // One residency set per command-list
             HRESULT ExecuteCommandLists(ID3D12CommandQueue* Queue, ID3D12CommandList** CommandLists, ResidencySet** ResidencySets, UINT32 Count)
             {
@@ -934,9 +1145,9 @@ namespace D3DX12Residency
                     }
                 }
 
-                // Create a set to gather up all unique resources required by this call
-                ResidencySet* pMasterSet = new ResidencySet();
-                if (pMasterSet == nullptr || pMasterSet->Initialize(pSyncManager, MaxObjectsReferenced) == false)
+                // Gather up all unique resources required by this call into a set from the pool
+                ResidencySet* pMasterSet = AcquireMasterSet(MaxObjectsReferenced);
+                if (pMasterSet == nullptr)
                 {
                     return E_OUTOFMEMORY;
                 }
@@ -944,6 +1155,7 @@ namespace D3DX12Residency
                 hr = pMasterSet->Open();
                 if (FAILED(hr))
                 {
+                    ReleaseMasterSet(pMasterSet);
                     return hr;
                 }
 
@@ -966,6 +1178,7 @@ namespace D3DX12Residency
                 hr = pMasterSet->Close();
                 if (FAILED(hr))
                 {
+                    ReleaseMasterSet(pMasterSet);
                     return hr;
                 }
 
@@ -973,7 +1186,7 @@ namespace D3DX12Residency
                 // nothing we can do
                 if (Count > 1 && TotalSizeNeeded > LocalMemory.Budget + NonLocalMemory.Budget)
                 {
-                    delete(pMasterSet);
+                    ReleaseMasterSet(pMasterSet);
 
                     // Recursively try to find a small enough set to fit in memory
                     const UINT32 Half = Count / 2;
@@ -987,7 +1200,11 @@ namespace D3DX12Residency
                 Internal::Fence* QueueFence = nullptr;
                 hr = GetFence(Queue, QueueFence);
 
-                if (SUCCEEDED(hr))
+                if (FAILED(hr))
+                {
+                    ReleaseMasterSet(pMasterSet);
+                }
+                else
                 {
                     // The following code must be atomic so that things get ordered correctly
 
@@ -1088,13 +1305,6 @@ namespace D3DX12Residency
             {
                 Internal::DeviceWideSyncPoint* FirstUncompletedSyncPoint = DequeueCompletedSyncPoints();
 
-                // Use a union so that we only need 1 allocation
-                union ResidentScratchSpace
-                {
-                    ManagedObject* pManagedObject;
-                    ID3D12Pageable* pUnderlying;
-                };
-
                 ResidentScratchSpace* pMakeResidentList = nullptr;
                 UINT32 NumObjectsToMakeResident = 0;
 
@@ -1111,8 +1321,9 @@ namespace D3DX12Residency
                     // A lock must be taken here as the state of the objects will be altered
                     Internal::ScopedLock Lock(&Mutex);
 
-                    pMakeResidentList = new ResidentScratchSpace[pWork->pMasterSet->CurrentSetSize];
-                    pEvictionList = new ID3D12Pageable*[LRU.NumResidentObjects];
+                    // The scratch space is only touched on this thread under the lock, so it is kept between workloads
+                    pMakeResidentList = ReserveScratch(pMakeResidentScratch, MakeResidentScratchSize, pWork->pMasterSet->CurrentSetSize);
+                    pEvictionList = ReserveScratch(pEvictionScratch, EvictionScratchSize, LRU.NumResidentObjects + pWork->pMasterSet->CurrentSetSize);
 
                     // Mark the objects used by this command list to be made resident
                     for (INT32 i = 0; i < pWork->pMasterSet->CurrentSetSize; i++)
@@ -1143,7 +1354,7 @@ namespace D3DX12Residency
 
                     if (NumObjectsToEvict)
                     {
-                        RESIDENCY_CHECK_RESULT(Device->Evict(NumObjectsToEvict, pEvictionList));
+                        RESIDENCY_CHECK_RESULT(Evict(NumObjectsToEvict, pEvictionList));
                         NumObjectsToEvict = 0;
                     }
 
@@ -1191,7 +1402,7 @@ namespace D3DX12Residency
                                     }
                                 }
 
-                                hr = Device->MakeResident(NumObjectsInBatch, &pMakeResidentList[BatchStart].pUnderlying);
+                                hr = MakeResident(NumObjectsInBatch, &pMakeResidentList[BatchStart].pUnderlying, BatchSize);
                                 if (SUCCEEDED(hr))
                                 {
                                     SizeToMakeResident -= BatchSize;
@@ -1219,7 +1430,7 @@ namespace D3DX12Residency
                                         pMakeResidentList[i].pUnderlying = pMakeResidentList[i].pManagedObject->pUnderlying;
                                     }
 
-                                    hr = Device->MakeResident(NumObjects, &pMakeResidentList[MakeResidentIndex].pUnderlying);
+                                    hr = MakeResident(NumObjects, &pMakeResidentList[MakeResidentIndex].pUnderlying, SizeToMakeResident);
                                     if (FAILED(hr))
                                     {
                                         // TODO: What should we do if this fails? This is a catastrophic failure in which the app is trying to use more memory
@@ -1242,7 +1453,7 @@ namespace D3DX12Residency
 
                                 LRU.TrimToSyncPointInclusive(TotalUsage + INT64(SizeToMakeResident), TotalBudget, pEvictionList, NumObjectsToEvict, GenerationToWaitFor);
 
-                                RESIDENCY_CHECK_RESULT(Device->Evict(NumObjectsToEvict, pEvictionList));
+                                RESIDENCY_CHECK_RESULT(Evict(NumObjectsToEvict, pEvictionList));
                             }
                             else
                             {
@@ -1251,17 +1462,96 @@ namespace D3DX12Residency
                             }
                         }
                     }
-
-                    delete[](pMakeResidentList);
-                    delete[](pEvictionList);
                 }
 
                 // Tell the GPU that it's safe to execute since we made things resident
                 RESIDENCY_CHECK_RESULT(AsyncThreadFence.pFence->Signal(pWork->FenceValueToSignal));
 
-                delete(pWork->pMasterSet);
+                ReleaseMasterSet(pWork->pMasterSet);
                 pWork->pMasterSet = nullptr;
             }
+
+            ResidencySet* AcquireMasterSet(UINT32 MaxSize)
+            {
+                ResidencySet* pSet = nullptr;
+                {
+                    Internal::ScopedLock Lock(&MasterSetPoolCS);
+                    pSet = pFreeMasterSets;
+                    if (pSet)
+                    {
+                        pFreeMasterSets = pSet->pNextFree;
+                    }
+                }
+
+                if (pSet == nullptr)
+                {
+                    pSet = new ResidencySet();
+                    if (pSet == nullptr)
+                    {
+                        return nullptr;
+                    }
+                    pSet->Initialize(pSyncManager);
+                }
+
+                if (pSet->Reserve(MaxSize) == false)
+                {
+                    delete(pSet);
+                    return nullptr;
+                }
+                return pSet;
+            }
+
+            void ReleaseMasterSet(ResidencySet* pSet)
+            {
+                Internal::ScopedLock Lock(&MasterSetPoolCS);
+                pSet->pNextFree = pFreeMasterSets;
+                pFreeMasterSets = pSet;
+            }
+
+            template <typename T>
+            static T* ReserveScratch(T*& pScratch, UINT32& ScratchSize, UINT32 Size)
+            {
+                if (ScratchSize < Size || pScratch == nullptr)
+                {
+                    delete[](pScratch);
+                    ScratchSize = RESIDENCY_MAX(Size, ScratchSize + ScratchSize / 2);
+                    pScratch = new T[ScratchSize];
+                }
+                return pScratch;
+            }
+
+            // Must be called with the lock held
+            HRESULT MakeResident(UINT32 NumObjects, ID3D12Pageable** ppObjects, UINT64 Size)
+            {
+                LARGE_INTEGER Start, End;
+                QueryPerformanceCounter(&Start);
+                HRESULT hr = Device->MakeResident(NumObjects, ppObjects);
+                QueryPerformanceCounter(&End);
+
+                if (SUCCEEDED(hr) && NumObjects > 0)
+                {
+                    const UINT64 Microseconds = UINT64(End.QuadPart - Start.QuadPart) * 1000000 / TicksPerSecond;
+                    Statistics.NumMakeResidentCalls++;
+                    Statistics.NumObjectsMadeResident += NumObjects;
+                    Statistics.BytesMadeResident += Size;
+                    Statistics.LargestMakeResidentBatch = RESIDENCY_MAX(Statistics.LargestMakeResidentBatch, NumObjects);
+                    Statistics.TotalMakeResidentMicroseconds += Microseconds;
+                    Statistics.LongestMakeResidentMicroseconds = RESIDENCY_MAX(Statistics.LongestMakeResidentMicroseconds, Microseconds);
+                }
+                return hr;
+            }
+
+            // Must be called with the lock held
+            HRESULT Evict(UINT32 NumObjects, ID3D12Pageable** ppObjects)
+            {
+                HRESULT hr = Device->Evict(NumObjects, ppObjects);
+                if (SUCCEEDED(hr) && NumObjects > 0)
+                {
+                    Statistics.NumEvictCalls++;
+                    Statistics.NumObjectsEvicted += NumObjects;
+                }
+                return hr;
+            }
             // The Enqueue and Dequeue Async Work functions are threadsafe as there is only 1 producer and 1 consumer, if that changes
             // Synchronisation will be required
             HRESULT EnqueueAsyncWork(ResidencySet* pMasterSet, UINT64 FenceValueToSignal, UINT64 SyncPointGeneration)
@@ -1311,7 +1601,7 @@ namespace D3DX12Residency
             {
                 Internal::ScopedLock Lock(&AsyncWorkMutex);
 
-                Internal::DeviceWideSyncPoint* pPoint = Internal::DeviceWideSyncPoint::CreateSyncPoint(NumQueuesSeen, CurrentSyncPointGeneration);
+                Internal::DeviceWideSyncPoint* pPoint = AllocateSyncPoint();
                 if (pPoint == nullptr)
                 {
                     return E_OUTOFMEMORY;
@@ -1336,6 +1626,41 @@ namespace D3DX12Residency
                 return S_OK;
             }
 
+            // Sync points are taken from those already retired while they are sized for the queues seen so far.
+            // Called with AsyncWorkMutex held.
+            Internal::DeviceWideSyncPoint* AllocateSyncPoint()
+            {
+                if (Internal::IsListEmpty(&FreeSyncPointsHead) == false)
+                {
+                    Internal::DeviceWideSyncPoint* pPoint =
+                        CONTAINING_RECORD(FreeSyncPointsHead.Flink, Internal::DeviceWideSyncPoint, ListEntry);
+
+                    if (pPoint->NumQueueSyncPoints == NumQueuesSeen)
+                    {
+                        Internal::RemoveHeadList(&FreeSyncPointsHead);
+                        pPoint->GenerationID = CurrentSyncPointGeneration;
+                        return pPoint;
+                    }
+
+                    // A queue was added since these were made
+                    FreeSyncPoints();
+                }
+
+                return Internal::DeviceWideSyncPoint::CreateSyncPoint(NumQueuesSeen, CurrentSyncPointGeneration);
+            }
+
+            void FreeSyncPoints()
+            {
+                while (Internal::IsListEmpty(&FreeSyncPointsHead) == false)
+                {
+                    Internal::DeviceWideSyncPoint* pPoint =
+                        CONTAINING_RECORD(FreeSyncPointsHead.Flink, Internal::DeviceWideSyncPoint, ListEntry);
+
+                    Internal::RemoveHeadList(&FreeSyncPointsHead);
+                    delete[]((BYTE*)pPoint);
+                }
+            }
+
             // Returns a pointer to the first synch point which is not completed
             Internal::DeviceWideSyncPoint* DequeueCompletedSyncPoints()
             {
@@ -1349,7 +1674,7 @@ namespace D3DX12Residency
                     if (pPoint->IsCompleted())
                     {
                         Internal::RemoveHeadList(&InFlightSyncPointsHead);
-                        delete pPoint;
+                        Internal::InsertTailList(&FreeSyncPointsHead, &pPoint->ListEntry);
                     }
                     else
                     {
@@ -1379,13 +1704,13 @@ namespace D3DX12Residency
                     {
                         // Keep popping off until we find the one to wait on
                         Internal::RemoveHeadList(&InFlightSyncPointsHead);
-                        delete(pPoint);
+                        Internal::InsertTailList(&FreeSyncPointsHead, &pPoint->ListEntry);
                     }
                     else
                     {
                         pPoint->WaitForCompletion(CompletionEvent);
                         Internal::RemoveHeadList(&InFlightSyncPointsHead);
-                        delete(pPoint);
+                        Internal::InsertTailList(&FreeSyncPointsHead, &pPoint->ListEntry);
                         return;
                     }
                 }
@@ -1420,12 +1745,15 @@ namespace D3DX12Residency
             Internal::Fence AsyncThreadFence;
 
             LIST_ENTRY InFlightSyncPointsHead;
+            LIST_ENTRY FreeSyncPointsHead;
             UINT64 CurrentSyncPointGeneration;
 
             HANDLE CompletionEvent;
             HANDLE AsyncThreadWorkCompletionEvent;
 
             ID3D12Device* Device;
+            // Only held when the device supports residency priorities
+            ID3D12Device1* Device1;
             // NOTE: This is an index not a mask. The majority of D3D12 uses bit masks to identify a GPU node whereas DXGI uses 0 based indices.
             UINT NodeIndex;
             IDXGIAdapter3* Adapter;
@@ -1449,6 +1777,26 @@ namespace D3DX12Residency
             INT64 ResidencyManagerUniqueID;
 
             SyncManager* pSyncManager;
+
+            // Sets that gather up each submission's objects, reused once the paging thread is done with them
+            Internal::CriticalSection MasterSetPoolCS;
+            ResidencySet* pFreeMasterSets;
+
+            // Use a union so that the objects to make resident and their underlying pageables share storage
+            union ResidentScratchSpace
+            {
+                ManagedObject* pManagedObject;
+                ID3D12Pageable* pUnderlying;
+            };
+
+            ResidentScratchSpace* pMakeResidentScratch;
+            UINT32 MakeResidentScratchSize;
+            ID3D12Pageable** pEvictionScratch;
+            UINT32 EvictionScratchSize;
+
+            // Guarded by Mutex
+            ResidencyStatistics Statistics;
+            UINT64 TicksPerSecond;
         };
     }
 
@@ -1481,6 +1829,18 @@ namespace D3DX12Residency
             Manager.EndTrackingObject(pObject);
         }
 
+        // Also tells the OS, so it can weigh the object against other processes' when it has to demote memory
+        FORCEINLINE void SetResidencyPriority(ManagedObject* pObject, D3D12_RESIDENCY_PRIORITY Priority)
+        {
+            Manager.SetResidencyPriority(pObject, Priority);
+        }
+
+        // Make the objects resident ahead of the submission that needs them, off the submitting thread
+        FORCEINLINE HRESULT Prefetch(ManagedObject** ppObjects, UINT32 Count)
+        {
+            return Manager.Prefetch(ppObjects, Count);
+        }
+
         HRESULT GetCurrentGPUSyncPoint(ID3D12CommandQueue* Queue, UINT64 *pCurrentGPUSyncPoint)
         {
             return Manager.GetCurrentGPUSyncPoint(Queue, pCurrentGPUSyncPoint);
@@ -1492,6 +1852,16 @@ namespace D3DX12Residency
             return Manager.ExecuteCommandLists(Queue, CommandLists, ResidencySets, Count);
         }
 
+        void GetStatistics(ResidencyStatistics* pStatistics)
+        {
+            Manager.GetStatistics(pStatistics);
+        }
+
+        void ResetStatistics()
+        {
+            Manager.ResetStatistics();
+        }
+
         FORCEINLINE ResidencySet* CreateResidencySet()
         {
             ResidencySet* pSet = new ResidencySet();
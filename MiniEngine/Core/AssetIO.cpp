@@ -0,0 +1,473 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "pch.h"
+#include "AssetIO.h"
+#include "GraphicsCore.h"
+#include "CommandListManager.h"
+#include "CommandContext.h"
+#include "GpuResource.h"
+#include "SystemTime.h"
+#include <deque>
+#include <thread>
+
+using namespace Graphics;
+
+namespace AssetIO
+{
+    IntVar ReadsInFlight("Graphics/Asset I/O/Reads In Flight", 32, 1, 128);
+    IntVar CopiesPerBatch("Graphics/Asset I/O/Copies Per Batch", 32, 1, 1024);
+
+    // Uploads that do not fit in a quarter of the ring are split, or for textures, uploaded on their own
+    const uint64_t kStagingRingSize = 64 * 1024 * 1024;
+    const size_t kMaxStagedUpload = kStagingRingSize / 4;
+    const size_t kMaxBatchesInFlight = 8;
+
+    // A size of 0 reads the whole file
+    struct ReadRequest
+    {
+        std::wstring FileName;
+        uint64_t Offset;
+        size_t Size;
+        ReadCallback Callback;
+        JobSystem::Counter* Group;
+    };
+
+    // The OVERLAPPED comes first so that a completion packet leads back to its read
+    struct PendingRead
+    {
+        OVERLAPPED Overlapped;
+        HANDLE File;
+        std::vector<unsigned char> Data;
+        ReadRequest Request;
+    };
+
+    // Read requests wait here until the I/O thread has room for them in flight
+    std::mutex s_ReadMutex;
+    std::deque<ReadRequest> s_ReadQueue[kNumPriorities];
+    bool s_Quit = false;
+
+    HANDLE s_CompletionPort = nullptr;
+    std::thread s_IOThread;
+    uint32_t s_NumReadsInFlight = 0;        // Only touched by the I/O thread
+
+    struct CopyBatch
+    {
+        ID3D12CommandAllocator* Allocator;
+        uint64_t FenceValue;
+        uint64_t RingEnd;                   // Ring head when the batch was submitted
+    };
+
+    // The ring's head and tail count bytes since initialization, so the used space is Head - Tail
+    std::mutex s_UploadMutex;
+    ID3D12Resource* s_StagingRing = nullptr;
+    uint8_t* s_StagingData = nullptr;
+    uint64_t s_RingHead = 0;
+    uint64_t s_RingTail = 0;
+
+    ID3D12GraphicsCommandList* s_CopyList = nullptr;
+    ID3D12CommandAllocator* s_OpenAllocator = nullptr;
+    uint32_t s_PendingCopies = 0;
+    std::deque<CopyBatch> s_BatchesInFlight;
+    std::vector<ID3D12CommandAllocator*> s_FreeAllocators;
+    uint64_t s_LastFenceValue = 0;
+
+    std::mutex s_StatsMutex;
+    Stats s_Stats = {};
+    Stats s_LastReport = {};
+    uint32_t s_OutstandingReads = 0;
+    int64_t s_BusyStartTick = 0;
+
+    void IOThreadMain( void );
+    void StartRead( ReadRequest& Request );
+    void CompleteRead( PendingRead* Read, bool Succeeded );
+
+    uint64_t AllocateStaging( size_t NumBytes, size_t Alignment );
+    ID3D12GraphicsCommandList* OpenBatch( void );
+    void CloseCopy( size_t NumBytes );
+    void SubmitBatch( void );
+    void RetireBatch( bool Wait );
+}
+
+using namespace AssetIO;
+
+void AssetIO::Initialize( void )
+{
+    ASSERT(s_CompletionPort == nullptr, "Asset I/O is already running");
+
+    s_CompletionPort = CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 1);
+    ASSERT(s_CompletionPort != nullptr);
+
+    D3D12_HEAP_PROPERTIES HeapProps = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+    D3D12_RESOURCE_DESC BufferDesc = CD3DX12_RESOURCE_DESC::Buffer(kStagingRingSize);
+    ASSERT_SUCCEEDED(g_Device->CreateCommittedResource(&HeapProps, D3D12_HEAP_FLAG_NONE, &BufferDesc,
+        D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, MY_IID_PPV_ARGS(&s_StagingRing)));
+    s_StagingRing->SetName(L"Asset I/O Staging Ring");
+    ASSERT_SUCCEEDED(s_StagingRing->Map(0, nullptr, (void**)&s_StagingData));
+
+    ID3D12CommandAllocator* Allocator = nullptr;
+    ASSERT_SUCCEEDED(g_Device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COPY, MY_IID_PPV_ARGS(&Allocator)));
+    ASSERT_SUCCEEDED(g_Device->CreateCommandList(1, D3D12_COMMAND_LIST_TYPE_COPY, Allocator, nullptr, MY_IID_PPV_ARGS(&s_CopyList)));
+    s_CopyList->SetName(L"Asset I/O Copies");
+    s_CopyList->Close();
+    s_FreeAllocators.push_back(Allocator);
+
+    s_Quit = false;
+    s_IOThread = std::thread(IOThreadMain);
+}
+
+void AssetIO::Shutdown( void )
+{
+    {
+        std::lock_guard<std::mutex> LockGuard(s_ReadMutex);
+        s_Quit = true;
+    }
+    PostQueuedCompletionStatus(s_CompletionPort, 0, 0, nullptr);
+    s_IOThread.join();
+
+    Flush();
+    while (!s_BatchesInFlight.empty())
+        RetireBatch(true);
+
+    for (auto Allocator : s_FreeAllocators)
+        Allocator->Release();
+    s_FreeAllocators.clear();
+
+    SAFE_RELEASE(s_CopyList);
+    s_StagingRing->Unmap(0, nullptr);
+    s_StagingData = nullptr;
+    SAFE_RELEASE(s_StagingRing);
+
+    CloseHandle(s_CompletionPort);
+    s_CompletionPort = nullptr;
+}
+
+bool AssetIO::IsRunning( void )
+{
+    return s_StagingRing != nullptr;
+}
+
+void AssetIO::ReadFile( const std::wstring& FileName, Priority Priority, const ReadCallback& Callback,
+    JobSystem::Counter* Group )
+{
+    ReadFileRange(FileName, 0, 0, Priority, Callback, Group);
+}
+
+void AssetIO::ReadFileRange( const std::wstring& FileName, uint64_t Offset, size_t Size, Priority Priority,
+    const ReadCallback& Callback, JobSystem::Counter* Group )
+{
+    ASSERT(Priority < kNumPriorities);
+
+    if (Group != nullptr)
+        JobSystem::AddExternal(*Group);
+
+    {
+        std::lock_guard<std::mutex> LockGuard(s_StatsMutex);
+        if (s_OutstandingReads++ == 0)
+            s_BusyStartTick = SystemTime::GetCurrentTick();
+    }
+
+    {
+        std::lock_guard<std::mutex> LockGuard(s_ReadMutex);
+        s_ReadQueue[Priority].push_back({ FileName, Offset, Size, Callback, Group });
+    }
+
+    // Wake the I/O thread to issue it
+    PostQueuedCompletionStatus(s_CompletionPort, 0, 0, nullptr);
+}
+
+void AssetIO::IOThreadMain( void )
+{
+    for (;;)
+    {
+        // Issue the most important requests that fit in flight
+        while (s_NumReadsInFlight < (uint32_t)ReadsInFlight)
+        {
+            ReadRequest Request;
+            {
+                std::lock_guard<std::mutex> LockGuard(s_ReadMutex);
+                uint32_t Level = 0;
+                while (Level < kNumPriorities && s_ReadQueue[Level].empty())
+                    ++Level;
+                if (Level == kNumPriorities)
+                    break;
+
+                Request = std::move(s_ReadQueue[Level].front());
+                s_ReadQueue[Level].pop_front();
+            }
+            StartRead(Request);
+        }
+
+        if (s_NumReadsInFlight == 0)
+        {
+            std::lock_guard<std::mutex> LockGuard(s_ReadMutex);
+            bool QueueEmpty = true;
+            for (uint32_t Level = 0; Level < kNumPriorities; ++Level)
+                QueueEmpty = QueueEmpty && s_ReadQueue[Level].empty();
+            if (s_Quit && QueueEmpty)
+                return;
+        }
+
+        DWORD NumBytes = 0;
+        ULONG_PTR Key = 0;
+        OVERLAPPED* Overlapped = nullptr;
+        BOOL Succeeded = GetQueuedCompletionStatus(s_CompletionPort, &NumBytes, &Key, &Overlapped, INFINITE);
+
+        // Packets without an OVERLAPPED only wake the thread up for new requests or shutdown
+        if (Overlapped == nullptr)
+            continue;
+
+        PendingRead* Read = (PendingRead*)Overlapped;
+        --s_NumReadsInFlight;
+        CompleteRead(Read, Succeeded && NumBytes == Read->Data.size());
+    }
+}
+
+void AssetIO::StartRead( ReadRequest& Request )
+{
+    PendingRead* Read = new PendingRead;
+    ZeroMemory(&Read->Overlapped, sizeof(OVERLAPPED));
+    Read->Request = std::move(Request);
+    Read->File = CreateFileW(Read->Request.FileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+        FILE_FLAG_OVERLAPPED | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+    // A single read covers the whole range
+    LARGE_INTEGER FileSize;
+    if (Read->File == INVALID_HANDLE_VALUE || !GetFileSizeEx(Read->File, &FileSize) ||
+        (uint64_t)FileSize.QuadPart <= Read->Request.Offset ||
+        CreateIoCompletionPort(Read->File, s_CompletionPort, 0, 0) == nullptr)
+    {
+        CompleteRead(Read, false);
+        return;
+    }
+
+    uint64_t ReadSize = (uint64_t)FileSize.QuadPart - Read->Request.Offset;
+    if (Read->Request.Size != 0)
+        ReadSize = std::min<uint64_t>(ReadSize, Read->Request.Size);
+    if (ReadSize > MAXDWORD)
+    {
+        CompleteRead(Read, false);
+        return;
+    }
+
+    Read->Overlapped.Offset = (DWORD)Read->Request.Offset;
+    Read->Overlapped.OffsetHigh = (DWORD)(Read->Request.Offset >> 32);
+    Read->Data.resize((size_t)ReadSize);
+    if (!::ReadFile(Read->File, Read->Data.data(), (DWORD)ReadSize, nullptr, &Read->Overlapped) &&
+        GetLastError() != ERROR_IO_PENDING)
+    {
+        CompleteRead(Read, false);
+        return;
+    }
+
+    ++s_NumReadsInFlight;
+}
+
+void AssetIO::CompleteRead( PendingRead* Read, bool Succeeded )
+{
+    if (Read->File != INVALID_HANDLE_VALUE)
+        CloseHandle(Read->File);
+
+    if (!Succeeded)
+        Read->Data.clear();
+
+    JobSystem::Counter* Group = Read->Request.Group;
+    JobSystem::Run([Read]
+    {
+        Read->Request.Callback(Read->Data.data(), Read->Data.size());
+
+        {
+            std::lock_guard<std::mutex> LockGuard(s_StatsMutex);
+            s_Stats.FilesRead += Read->Data.empty() ? 0 : 1;
+            s_Stats.BytesRead += Read->Data.size();
+            if (--s_OutstandingReads == 0)
+                s_Stats.BusySeconds += SystemTime::TimeBetweenTicks(s_BusyStartTick, SystemTime::GetCurrentTick());
+        }
+
+        delete Read;
+    }, Group);
+
+    // The callback's job now holds the group open
+    if (Group != nullptr)
+        JobSystem::FinishExternal(*Group);
+}
+
+uint64_t AssetIO::AllocateStaging( size_t NumBytes, size_t Alignment )
+{
+    ASSERT(NumBytes <= kMaxStagedUpload);
+
+    // Skip to the start of the ring rather than split an upload across its end
+    uint64_t Offset = Math::AlignUp(s_RingHead % kStagingRingSize, Alignment);
+    if (Offset + NumBytes > kStagingRingSize)
+        s_RingHead = Math::AlignUp(s_RingHead, kStagingRingSize);
+    else
+        s_RingHead += Offset - s_RingHead % kStagingRingSize;
+
+    while (s_RingHead + NumBytes - s_RingTail > kStagingRingSize)
+    {
+        // Only skipped space is left when no copies use the ring
+        if (s_BatchesInFlight.empty() && s_OpenAllocator == nullptr)
+        {
+            s_RingTail = s_RingHead;
+            break;
+        }
+
+        // The pending copies may be what holds the space
+        if (s_BatchesInFlight.empty())
+            SubmitBatch();
+        RetireBatch(true);
+    }
+
+    Offset = s_RingHead % kStagingRingSize;
+    s_RingHead += NumBytes;
+    return Offset;
+}
+
+ID3D12GraphicsCommandList* AssetIO::OpenBatch( void )
+{
+    if (s_OpenAllocator != nullptr)
+        return s_CopyList;
+
+    while (!s_BatchesInFlight.empty() && g_CommandManager.IsFenceComplete(s_BatchesInFlight.front().FenceValue))
+        RetireBatch(false);
+
+    if (s_FreeAllocators.empty())
+    {
+        ID3D12CommandAllocator* Allocator = nullptr;
+        ASSERT_SUCCEEDED(g_Device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COPY, MY_IID_PPV_ARGS(&Allocator)));
+        s_FreeAllocators.push_back(Allocator);
+    }
+
+    s_OpenAllocator = s_FreeAllocators.back();
+    s_FreeAllocators.pop_back();
+    ASSERT_SUCCEEDED(s_CopyList->Reset(s_OpenAllocator, nullptr));
+    return s_CopyList;
+}
+
+void AssetIO::CloseCopy( size_t NumBytes )
+{
+    {
+        std::lock_guard<std::mutex> LockGuard(s_StatsMutex);
+        s_Stats.BytesUploaded += NumBytes;
+    }
+
+    if (++s_PendingCopies >= (uint32_t)CopiesPerBatch)
+        SubmitBatch();
+}
+
+void AssetIO::SubmitBatch( void )
+{
+    if (s_OpenAllocator == nullptr)
+        return;
+
+    if (s_BatchesInFlight.size() >= kMaxBatchesInFlight)
+        RetireBatch(true);
+
+    CommandQueue& CopyQueue = g_CommandManager.GetCopyQueue();
+    ASSERT_SUCCEEDED(s_CopyList->Close());
+    ID3D12CommandList* List = s_CopyList;
+    CopyQueue.GetCommandQueue()->ExecuteCommandLists(1, &List);
+    s_LastFenceValue = CopyQueue.IncrementFence();
+
+    s_BatchesInFlight.push_back({ s_OpenAllocator, s_LastFenceValue, s_RingHead });
+    s_OpenAllocator = nullptr;
+    s_PendingCopies = 0;
+}
+
+void AssetIO::RetireBatch( bool Wait )
+{
+    CopyBatch& Batch = s_BatchesInFlight.front();
+    if (Wait)
+        g_CommandManager.WaitForFence(Batch.FenceValue);
+
+    ASSERT_SUCCEEDED(Batch.Allocator->Reset());
+    s_FreeAllocators.push_back(Batch.Allocator);
+    s_RingTail = Batch.RingEnd;
+    s_BatchesInFlight.pop_front();
+}
+
+void AssetIO::UploadBuffer( GpuResource& Dest, size_t DestOffset, const void* Data, size_t NumBytes )
+{
+    std::lock_guard<std::mutex> LockGuard(s_UploadMutex);
+
+    for (size_t Copied = 0; Copied < NumBytes; Copied += kMaxStagedUpload)
+    {
+        const size_t ChunkSize = std::min(NumBytes - Copied, kMaxStagedUpload);
+        const uint64_t Offset = AllocateStaging(ChunkSize, 16);
+        memcpy(s_StagingData + Offset, (const uint8_t*)Data + Copied, ChunkSize);
+
+        OpenBatch()->CopyBufferRegion(Dest.GetResource(), DestOffset + Copied, s_StagingRing, Offset, ChunkSize);
+        CloseCopy(ChunkSize);
+    }
+}
+
+void AssetIO::UploadTexture( GpuResource& Dest, UINT NumSubresources, D3D12_SUBRESOURCE_DATA SubData[],
+    UINT FirstSubresource )
+{
+    const UINT64 UploadSize = GetRequiredIntermediateSize(Dest.GetResource(), FirstSubresource, NumSubresources);
+    if (UploadSize > kMaxStagedUpload)
+    {
+        CommandContext::InitializeTexture(Dest, NumSubresources, SubData, FirstSubresource);
+        return;
+    }
+
+    std::lock_guard<std::mutex> LockGuard(s_UploadMutex);
+
+    const uint64_t Offset = AllocateStaging((size_t)UploadSize, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+    UpdateSubresources(OpenBatch(), Dest.GetResource(), s_StagingRing, Offset, FirstSubresource, NumSubresources, SubData);
+    CloseCopy((size_t)UploadSize);
+}
+
+size_t AssetIO::GetMaxStagedUpload( void )
+{
+    return kMaxStagedUpload;
+}
+
+void AssetIO::Flush( void )
+{
+    std::lock_guard<std::mutex> LockGuard(s_UploadMutex);
+
+    SubmitBatch();
+    if (s_LastFenceValue == 0)
+        return;
+
+    // Resources leave the copy queue in the common state, which the shader read states are promoted from
+    g_CommandManager.GetGraphicsQueue().StallForFence(s_LastFenceValue);
+    g_CommandManager.GetComputeQueue().StallForFence(s_LastFenceValue);
+}
+
+uint64_t AssetIO::Submit( void )
+{
+    std::lock_guard<std::mutex> LockGuard(s_UploadMutex);
+
+    SubmitBatch();
+    return s_LastFenceValue;
+}
+
+AssetIO::Stats AssetIO::GetStats( void )
+{
+    std::lock_guard<std::mutex> LockGuard(s_StatsMutex);
+
+    Stats Current = s_Stats;
+    if (s_OutstandingReads > 0)
+        Current.BusySeconds += SystemTime::TimeBetweenTicks(s_BusyStartTick, SystemTime::GetCurrentTick());
+    return Current;
+}
+
+void AssetIO::ReportThroughput( const char* Label )
+{
+    Stats Current = GetStats();
+
+    const double MegaBytes = (double)(Current.BytesRead - s_LastReport.BytesRead) / (1024.0 * 1024.0);
+    const double Seconds = Current.BusySeconds - s_LastReport.BusySeconds;
+    Utility::Printf("%s: read %u files, %.1f MB in %.3f s (%.1f MB/s)\n", Label, Current.FilesRead - s_LastReport.FilesRead,
+        MegaBytes, Seconds, Seconds > 0.0 ? MegaBytes / Seconds : 0.0);
+
+    s_LastReport = Current;
+}
@@ -0,0 +1,73 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#pragma once
+
+#include "pch.h"
+#include "JobSystem.h"
+#include <functional>
+
+class GpuResource;
+
+// Batched asset I/O.  File reads are queued by priority and many of them are kept in flight with overlapped
+// I/O, so that loading is not bound by the latency of each read.  Uploads are staged in a fixed ring of
+// upload memory and copied on the copy queue, with the copies submitted in batches.
+namespace AssetIO
+{
+    enum Priority { kPriorityHigh, kPriorityNormal, kPriorityLow, kNumPriorities };
+
+    // Given the file's contents, which are only valid during the call.  Size is 0 when the file could not be read.
+    typedef std::function<void(const void* Data, size_t Size)> ReadCallback;
+
+    void Initialize( void );
+
+    // Finishes the queued reads and uploads first
+    void Shutdown( void );
+
+    // Uploads may only be staged between Initialize() and Shutdown()
+    bool IsRunning( void );
+
+    // Queue a read of a whole file.  The callback runs on a job system worker once the read completes.  A
+    // group counts the request until its callback returns.
+    void ReadFile( const std::wstring& FileName, Priority Priority, const ReadCallback& Callback,
+        JobSystem::Counter* Group = nullptr );
+
+    // Queue a read of part of a file.  A range that runs past the end of the file is cut short.
+    void ReadFileRange( const std::wstring& FileName, uint64_t Offset, size_t Size, Priority Priority,
+        const ReadCallback& Callback, JobSystem::Counter* Group = nullptr );
+
+    // Copy data into the staging ring and record its copy to Dest, which must be in a state the copy queue can
+    // write.  Uploads may be called from any thread.  Nothing may read Dest until the uploads are flushed.
+    void UploadBuffer( GpuResource& Dest, size_t DestOffset, const void* Data, size_t NumBytes );
+    void UploadTexture( GpuResource& Dest, UINT NumSubresources, D3D12_SUBRESOURCE_DATA SubData[],
+        UINT FirstSubresource = 0 );
+
+    // Larger uploads are not staged, but copied on the graphics queue before the upload call returns
+    size_t GetMaxStagedUpload( void );
+
+    // Submits the pending copies and makes the graphics and compute queues wait for every upload so far
+    void Flush( void );
+
+    // Submits the pending copies without making other queues wait.  Returns the copy queue fence value that
+    // covers every upload so far.
+    uint64_t Submit( void );
+
+    // Totals since initialization.  Busy time is the time during which reads were queued or in flight.
+    struct Stats
+    {
+        uint32_t FilesRead;
+        uint64_t BytesRead;
+        uint64_t BytesUploaded;
+        double BusySeconds;
+    };
+    Stats GetStats( void );
+
+    // Prints the read throughput in MB/s since the last report
+    void ReportThroughput( const char* Label );
+}
@@ -0,0 +1,149 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "pch.h"
+#include "AsyncReadback.h"
+#include "GraphicsCore.h"
+#include "CommandContext.h"
+#include "CommandListManager.h"
+#include "ReadbackBuffer.h"
+#include "EngineProfiling.h"
+#include <mutex>
+#include <vector>
+
+using namespace Graphics;
+
+namespace AsyncReadback
+{
+    const uint32_t kNumSegments = 4;
+    const size_t kAlignment = 16;
+
+    struct PendingRequest
+    {
+        size_t Offset;      // In the segment
+        size_t Size;
+        Callback OnReady;
+    };
+
+    struct Segment
+    {
+        std::vector<PendingRequest> Requests;
+        size_t Used;
+        uint64_t Fence;
+        bool InFlight;      // Closed by EndFrame() and not yet called back
+    };
+
+    ReadbackBuffer s_Buffer;
+    size_t s_SegmentSize = 0;
+    Segment s_Segments[kNumSegments];
+    uint32_t s_CurrentSegment = 0;
+    uint32_t s_OldestSegment = 0;
+    uint32_t s_NumDropped = 0;
+    std::mutex s_Mutex;
+}
+
+void AsyncReadback::Initialize( size_t SegmentSize )
+{
+    s_SegmentSize = Math::AlignUp(SegmentSize, kAlignment);
+    s_Buffer.Create(L"Async Readback Ring", (uint32_t)(kNumSegments * s_SegmentSize / kAlignment), (uint32_t)kAlignment);
+
+    for (Segment& S : s_Segments)
+    {
+        S.Used = 0;
+        S.Fence = 0;
+        S.InFlight = false;
+    }
+    s_CurrentSegment = s_OldestSegment = 0;
+}
+
+void AsyncReadback::Shutdown( void )
+{
+    // The GPU is idle, but the data is of no use to anyone anymore
+    for (Segment& S : s_Segments)
+    {
+        S.Requests.clear();
+        S.InFlight = false;
+    }
+    s_Buffer.Destroy();
+    s_SegmentSize = 0;
+}
+
+bool AsyncReadback::Request( CommandContext& Context, GpuResource& Src, size_t SrcOffset, size_t NumBytes, const Callback& OnReady )
+{
+    size_t Offset;
+    uint32_t SegmentIndex;
+    {
+        std::lock_guard<std::mutex> Guard(s_Mutex);
+
+        SegmentIndex = s_CurrentSegment;
+        Segment& S = s_Segments[SegmentIndex];
+        Offset = Math::AlignUp(S.Used, kAlignment);
+        if (s_SegmentSize == 0 || S.InFlight || Offset + NumBytes > s_SegmentSize)
+        {
+            ++s_NumDropped;
+            return false;
+        }
+
+        S.Used = Offset + NumBytes;
+        S.Requests.push_back({ Offset, NumBytes, OnReady });
+    }
+
+    if (NumBytes > 0)
+        Context.CopyBufferRegion(s_Buffer, SegmentIndex * s_SegmentSize + Offset, Src, SrcOffset, NumBytes);
+
+    return true;
+}
+
+void AsyncReadback::EndFrame( void )
+{
+    std::lock_guard<std::mutex> Guard(s_Mutex);
+
+    // A frame that found every segment in flight made no requests, and tries the same segment again
+    Segment& S = s_Segments[s_CurrentSegment];
+    if (S.InFlight || s_SegmentSize == 0)
+        return;
+
+    S.Fence = g_CommandManager.GetGraphicsQueue().GetNextFenceValue() - 1;
+    S.InFlight = true;
+    s_CurrentSegment = (s_CurrentSegment + 1) % kNumSegments;
+}
+
+void AsyncReadback::Update( void )
+{
+    if (s_NumDropped > 0)
+        EngineProfiling::SetCounter("Dropped Readbacks", s_NumDropped);
+
+    // Segments in flight are never touched by requests, so their callbacks run without the lock
+    while (s_Segments[s_OldestSegment].InFlight && g_CommandManager.IsFenceComplete(s_Segments[s_OldestSegment].Fence))
+    {
+        Segment& S = s_Segments[s_OldestSegment];
+        if (S.Used > 0)
+        {
+            const size_t Begin = s_OldestSegment * s_SegmentSize;
+            const D3D12_RANGE ReadRange = { Begin, Begin + S.Used };
+            const D3D12_RANGE WrittenRange = { 0, 0 };
+            uint8_t* Data = nullptr;
+            ASSERT_SUCCEEDED(s_Buffer.GetResource()->Map(0, &ReadRange, (void**)&Data));
+            for (const PendingRequest& Request : S.Requests)
+                Request.OnReady(Data + Begin + Request.Offset, Request.Size);
+            s_Buffer.GetResource()->Unmap(0, &WrittenRange);
+        }
+        else
+        {
+            for (const PendingRequest& Request : S.Requests)
+                Request.OnReady(nullptr, 0);
+        }
+
+        std::lock_guard<std::mutex> Guard(s_Mutex);
+        S.Requests.clear();
+        S.Used = 0;
+        S.InFlight = false;
+        s_OldestSegment = (s_OldestSegment + 1) % kNumSegments;
+    }
+}
@@ -0,0 +1,42 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Reads GPU data back to the CPU without waiting on the GPU.  A request copies part of a buffer into a readback
+// heap split into one segment per frame in flight, and its callback runs with the data once the GPU has passed
+// the fence of the frame that made it.  Requests that do not fit in the frame's segment, or that come while every
+// segment is still in flight, fail rather than wait.  The copies are recorded on the context that produced the
+// data, so they need no synchronization with another queue.
+//
+
+#pragma once
+
+#include "pch.h"
+#include <functional>
+
+class CommandContext;
+class GpuResource;
+
+namespace AsyncReadback
+{
+    typedef std::function<void(const void* Data, size_t Size)> Callback;
+
+    void Initialize( size_t SegmentSize = 1024 * 1024 );
+    void Shutdown( void );
+
+    // Copies NumBytes at SrcOffset in Src, which must be in a state that can be copied from, on a context of the
+    // graphics queue.  Requests with no bytes just call back in their turn.  Any thread may make requests.
+    bool Request( CommandContext& Context, GpuResource& Src, size_t SrcOffset, size_t NumBytes, const Callback& OnReady );
+
+    // Closes the frame's segment with the fence of the graphics queue's last command list.  Call this once per
+    // frame after the frame's command lists are submitted.
+    void EndFrame( void );
+
+    // Calls back the requests of every frame the GPU has finished, in the order they were made, on the calling
+    // thread
+    void Update( void );
+}
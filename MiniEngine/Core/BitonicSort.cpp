@@ -13,12 +13,14 @@
 
 #include "pch.h"
 #include "BitonicSort.h"
+#include "RadixSort.h"
 #include "RootSignature.h"
 #include "PipelineState.h"
 #include "CommandContext.h"
 #include "ReadbackBuffer.h"
 #include "Math/Common.h"
 #include "Math/Random.h"
+#include "SystemTime.h"
 
 #include "CompiledShaders/BitonicIndirectArgsCS.h"
 #include "CompiledShaders/Bitonic32PreSortCS.h"
@@ -232,6 +234,45 @@ void TestBitonicSort(uint32_t ListSize, bool b64Bit, bool bAscending)
     //IndirectArgs.Unmap();
 }
 
+// Returns the milliseconds each sort of the list took, averaged over a batch of sorts submitted together so that
+// the submission and the wait for it are a small part of the time
+double TimeSort(uint32_t ListSize, bool b64Bit, bool bRadix)
+{
+    const uint32_t kNumIterations = 16;
+    const uint32_t SizeOfElem = b64Bit ? sizeof(uint64_t) : sizeof(uint32_t);
+
+    // Both sorts take the same time whatever the order of the keys, so the list is sorted over and over
+    std::vector<uint32_t> Keys(ListSize * SizeOfElem / sizeof(uint32_t));
+    for (uint32_t& Key : Keys)
+        Key = (uint32_t)Math::g_RNG.NextInt();
+
+    ByteAddressBuffer List, ScratchList, ListCount;
+    List.Create(L"GPU Sort List", ListSize, SizeOfElem, Keys.data());
+    ScratchList.Create(L"GPU Sort Scratch List", ListSize, SizeOfElem);
+    ListCount.Create(L"GPU List Counter", 1, sizeof(uint32_t), &ListSize);
+
+    // Warm up, so that neither sort pays for first use
+    ComputeContext& WarmUp = ComputeContext::Begin(L"Sort Benchmark");
+    BitonicSort::Sort(WarmUp, List, ListCount, 0, false, true);
+    RadixSort::Sort(WarmUp, List, ScratchList, ListCount, 0, true);
+    WarmUp.Finish(true);
+
+    ComputeContext& Ctx = ComputeContext::Begin(L"Sort Benchmark");
+    for (uint32_t i = 0; i < kNumIterations; ++i)
+    {
+        if (bRadix)
+            RadixSort::Sort(Ctx, List, ScratchList, ListCount, 0, true);
+        else
+            BitonicSort::Sort(Ctx, List, ListCount, 0, false, true);
+    }
+
+    const int64_t StartTick = SystemTime::GetCurrentTick();
+    Ctx.Finish(true);
+    const int64_t EndTick = SystemTime::GetCurrentTick();
+
+    return SystemTime::TimeBetweenTicks(StartTick, EndTick) * 1000.0 / kNumIterations;
+}
+
 void BitonicSort::Test( void )
 {
     for (uint32_t ThreadGroupCount = 1; ThreadGroupCount < 256; ++ThreadGroupCount)
@@ -242,4 +283,18 @@ void BitonicSort::Test( void )
         TestBitonicSort(ListSize, false, true);
         TestBitonicSort(ListSize, false, false);
     }
+
+    RadixSort::Test();
+
+    // Compare the throughput of both sorts as the lists grow past where radix sort is expected to win
+    for (uint32_t ListSize = 64 * 1024; ListSize <= 4 * 1024 * 1024; ListSize *= 2)
+    {
+        for (uint32_t b64Bit = 0; b64Bit < 2; ++b64Bit)
+        {
+            const double BitonicTime = TimeSort(ListSize, b64Bit != 0, false);
+            const double RadixTime = TimeSort(ListSize, b64Bit != 0, true);
+            Utility::Printf("Sorting %u %u-bit elements:  bitonic %.3f ms (%.0f M/s), radix %.3f ms (%.0f M/s)\n",
+                ListSize, b64Bit ? 64 : 32, BitonicTime, ListSize * 0.001 / BitonicTime, RadixTime, ListSize * 0.001 / RadixTime);
+        }
+    }
 }
@@ -74,6 +74,55 @@ BuddyAllocator::BuddyAllocator(kBuddyAllocationStrategy allocationStrategy, D3D1
     Reset();
 }
 
+void BuddyAllocator::FreeBitmap::Resize(size_t numBlocks)
+{
+    Words.assign((numBlocks + 63) / 64, 0);
+    Summary.assign((Words.size() + 63) / 64, 0);
+}
+
+void BuddyAllocator::FreeBitmap::Set(size_t index)
+{
+    const size_t word = index / 64;
+    Words[word] |= 1ull << (index % 64);
+    Summary[word / 64] |= 1ull << (word % 64);
+}
+
+void BuddyAllocator::FreeBitmap::Clear(size_t index)
+{
+    const size_t word = index / 64;
+    Words[word] &= ~(1ull << (index % 64));
+    if (Words[word] == 0)
+        Summary[word / 64] &= ~(1ull << (word % 64));
+}
+
+size_t BuddyAllocator::FreeBitmap::FindFirst() const
+{
+    // A summary word covers 4096 blocks, so this is a single pass for all but the largest ranges
+    for (size_t i = 0; i < Summary.size(); ++i)
+    {
+        unsigned long summaryBit, bit;
+        if (_BitScanForward64(&summaryBit, Summary[i]))
+        {
+            const size_t word = i * 64 + summaryBit;
+            _BitScanForward64(&bit, Words[word]);
+            return word * 64 + bit;
+        }
+    }
+    return ~(size_t)0;
+}
+
+void BuddyAllocator::Reset()
+{
+    lock_guard<mutex> guard(m_mutex);
+
+    // An order has half as many blocks as the one below it, and the pool starts out as one free block of the
+    // largest order
+    m_freeBlocks.resize(m_maxOrder + 1);
+    for (UINT order = 0; order <= m_maxOrder; ++order)
+        m_freeBlocks[order].Resize(((size_t)1) << (m_maxOrder - order));
+    m_freeBlocks[m_maxOrder].Set(0);
+}
+
 void BuddyAllocator::Initialize()
 {
     if (m_allocationStrategy == kBuddyAllocationStrategy::kPlacedResourceStrategy)
@@ -115,9 +164,9 @@ size_t BuddyAllocator::AllocateBlock(UINT order)
         throw(std::bad_alloc()); // Can't allocate a block that large  
     }
 
-    auto it = m_freeBlocks[order].begin();
+    size_t index = m_freeBlocks[order].FindFirst();
 
-    if (it == m_freeBlocks[order].end())
+    if (index == ~(size_t)0)
     {
         // No free nodes in the requested pool.  Try to find a higher-order block and split it.  
         size_t left = AllocateBlock(order + 1);
@@ -126,17 +175,17 @@ size_t BuddyAllocator::AllocateBlock(UINT order)
 
         size_t right = left + size;
 
-        m_freeBlocks[order].insert(right); // Add the right block to the free pool  
+        m_freeBlocks[order].Set(right >> order); // Add the right block to the free pool  
 
         offset = left; // Return the left block  
     }
 
     else
     {
-        offset = *it;
+        offset = index << order;
 
         // Remove the block from the free list  
-        m_freeBlocks[order].erase(it);
+        m_freeBlocks[order].Clear(index);
     }
 
     return offset;
@@ -149,19 +198,18 @@ void BuddyAllocator::DeallocateBlock(size_t offset, UINT order)
 
     size_t buddy = GetBuddyOffset(offset, size);
 
-    auto it = m_freeBlocks[order].find(buddy);
-
-    if (it != m_freeBlocks[order].end())
+    // The largest block has no buddy
+    if (order < m_maxOrder && m_freeBlocks[order].Test(buddy >> order))
     {
+        // Remove the buddy from the free list  
+        m_freeBlocks[order].Clear(buddy >> order);
         // Deallocate merged blocks  
         DeallocateBlock(min(offset, buddy), order + 1);
-        // Remove the buddy from the free list  
-        m_freeBlocks[order].erase(it);
     }
     else
     {
         // Add the block to the free list  
-        m_freeBlocks[order].insert(offset); // throw(std::bad_alloc) 
+        m_freeBlocks[order].Set(offset >> order);
     }
 }
 
@@ -173,13 +221,17 @@ BuddyBlock* BuddyAllocator::Allocate(uint32_t numElements, uint32_t elementSize,
 
     try
     {
-        size_t offset = AllocateBlock(order);
         uint32_t paddedSize = uint32_t(OrderToUnitSize(order) * m_minBlockSize);
+        uint32_t blockOffset;
+        {
+            lock_guard<mutex> guard(m_mutex);
 
-        uint32_t blockOffset = uint32_t(m_baseOffset + (offset * m_minBlockSize));
+            size_t offset = AllocateBlock(order);
+            blockOffset = uint32_t(m_baseOffset + (offset * m_minBlockSize));
 
-        INCREASE_BUDDY_COUNTER(m_SpaceUsed, paddedSize);
-        INCREASE_BUDDY_COUNTER(m_InternalFragmentation, (paddedSize - size));
+            INCREASE_BUDDY_COUNTER(m_SpaceUsed, paddedSize);
+            INCREASE_BUDDY_COUNTER(m_InternalFragmentation, (paddedSize - size));
+        }
 
         BuddyBlock* pBlock = new BuddyBlock(blockOffset, //offset
             paddedSize, //total size (padded to fit a block)
@@ -191,9 +243,9 @@ BuddyBlock* BuddyAllocator::Allocate(uint32_t numElements, uint32_t elementSize,
         }
         else
         {
-            //TODO: To be truely thread-safe this operation should be atomic to guard against
-            //      the case in which blocks from this allocator are used on multiple threads 
-            //      (because it's really only 1 resource underneath)
+            // Every block shares the one resource and its state, so only one thread may initialize a block of it
+            // at a time
+            lock_guard<mutex> guard(m_backingMutex);
             pBlock->InitFromResource(&m_BackingResource, numElements, elementSize, initialData);
         }
 
@@ -208,13 +260,50 @@ BuddyBlock* BuddyAllocator::Allocate(uint32_t numElements, uint32_t elementSize,
     }
 }
 
-/*
+bool BuddyAllocator::AllocateRange(size_t size, size_t& offset, size_t& paddedSize)
+{
+    UINT order = UnitSizeToOrder(SizeToUnitSize(size));
+
+    lock_guard<mutex> guard(m_mutex);
+
+    try
+    {
+        offset = m_baseOffset + AllocateBlock(order) * m_minBlockSize;
+        paddedSize = OrderToUnitSize(order) * m_minBlockSize;
+
+        INCREASE_BUDDY_COUNTER(m_SpaceUsed, paddedSize);
+        INCREASE_BUDDY_COUNTER(m_InternalFragmentation, (paddedSize - size));
+
+        return true;
+    }
+
+    catch (std::bad_alloc&)
+    {
+        return false;
+    }
+}
+
+void BuddyAllocator::DeallocateRange(size_t offset, size_t size)
+{
+    UINT order = UnitSizeToOrder(SizeToUnitSize(size));
+
+    lock_guard<mutex> guard(m_mutex);
+
+    // Marking blocks free allocates nothing, so unlike allocating this cannot fail
+    DeallocateBlock((offset - m_baseOffset) / m_minBlockSize, order);
+
+    DECREASE_BUDDY_COUNTER(m_SpaceUsed, OrderToUnitSize(order) * m_minBlockSize);
+    DECREASE_BUDDY_COUNTER(m_InternalFragmentation, (OrderToUnitSize(order) * m_minBlockSize - size));
+}
+
 void BuddyAllocator::Deallocate(BuddyBlock* pBlock)
 {
-    pBlock->m_fenceValue = g_CommandManager.GetNextFenceValue();
+    // Any command list that uses the block has been submitted already
+    pBlock->m_fenceValue = g_CommandManager.GetGraphicsQueue().GetNextFenceValue() - 1;
+
+    lock_guard<mutex> guard(m_mutex);
     m_deferredDeletionQueue.push(pBlock);
 }
-*/
 
 void BuddyAllocator::DeallocateInternal(BuddyBlock* pBlock)
 {
@@ -226,39 +315,37 @@ void BuddyAllocator::DeallocateInternal(BuddyBlock* pBlock)
 
     UINT order = UnitSizeToOrder(size);
 
-    try
     {
-        DeallocateBlock(offset, order); // throw(std::bad_alloc)
+        lock_guard<mutex> guard(m_mutex);
 
-        DECREASE_BUDDY_COUNTER(m_SpaceUsed, size);
-        DECREASE_BUDDY_COUNTER(m_InternalFragmentation, (size - pBlock->m_unpaddedSize));
-        
-        if (m_allocationStrategy == kBuddyAllocationStrategy::kPlacedResourceStrategy)
-        {
-            // Release the resource
-            pBlock->Destroy();
-        }
-        delete(pBlock);
+        DeallocateBlock(offset, order);
+
+        DECREASE_BUDDY_COUNTER(m_SpaceUsed, pBlock->GetSize());
+        DECREASE_BUDDY_COUNTER(m_InternalFragmentation, (pBlock->GetSize() - pBlock->m_unpaddedSize));
     }
 
-    catch (std::bad_alloc&)
+    if (m_allocationStrategy == kBuddyAllocationStrategy::kPlacedResourceStrategy)
     {
-        // Deallocate failed trying to add the free block to the pool  
-        // resulting in a leak.  Unfortunately there is not much we can do.  
-        // Fortunately this is expected to be extremely rare as the storage  
-        // needed for each deallocate is very small.  
+        // Release the resource
+        pBlock->Destroy();
     }
+    delete(pBlock);
 };
 
-/*
 void BuddyAllocator::CleanUpAllocations()
 {
-    while (m_deferredDeletionQueue.empty() == false &&
-        g_CommandManager.IsFenceComplete(m_deferredDeletionQueue.front()->m_fenceValue))
+    vector<BuddyBlock*> completedBlocks;
     {
-        BuddyBlock* pBlock = m_deferredDeletionQueue.front();
-        m_deferredDeletionQueue.pop();
+        lock_guard<mutex> guard(m_mutex);
 
-        DeallocateInternal(pBlock);
+        while (m_deferredDeletionQueue.empty() == false &&
+            g_CommandManager.IsFenceComplete(m_deferredDeletionQueue.front()->m_fenceValue))
+        {
+            completedBlocks.push_back(m_deferredDeletionQueue.front());
+            m_deferredDeletionQueue.pop();
+        }
     }
-}*/
+
+    for (BuddyBlock* pBlock : completedBlocks)
+        DeallocateInternal(pBlock);
+}
@@ -16,6 +16,9 @@
 // When a block is de-allocated an attempt is made to merge it with it's 
 // neighbour (buddy) if it is contiguous and free.
 // Based on reference implementation by Bill Kristiansen
+//
+// The free blocks of each order are kept in a bitmap, so that finding the lowest free block takes a couple of
+// bit scans and freeing one allocates nothing.  Every method can be called from any thread.
 //  
 
 #pragma once
@@ -24,7 +27,6 @@
 #include <vector>
 #include <queue>
 #include <mutex>
-#include <set>
 
 // Unfortunately the api restricts the minimum size of a placed buffer resource to 64k
 #define MIN_PLACED_BUFFER_SIZE (64 * 1024)
@@ -89,21 +91,22 @@ public:
 
     void Deallocate(BuddyBlock* pBlock);
 
+    // Reserves a range without creating anything in it, for callers that place their own resources.  The range
+    // is padded to a power of two number of blocks, and its offset is a multiple of its padded size.  Free it
+    // with the size that was asked for.
+    bool AllocateRange(size_t size, size_t& offset, size_t& paddedSize);
+
+    void DeallocateRange(size_t offset, size_t size);
+
     inline bool IsOwner(const BuddyBlock &block)
     {
         return block.GetOffset() >= m_baseOffset && block.GetSize() <= m_maxBlockSize;
     }
 
-    inline void Reset()
-    {
-        // Clear the free blocks collection  
-        m_freeBlocks.clear();
-
-        // Initialize the pool with a free inner block of max inner block size  
-        m_freeBlocks.resize(m_maxOrder + 1);
-        m_freeBlocks[m_maxOrder].insert((size_t)0);
-    }
+    void Reset();
 
+    // Frees the blocks passed to Deallocate() whose fences have completed.  They are queued in fence order, so
+    // this stops at the first one the GPU may still be using.
     void CleanUpAllocations();
 
 private:
@@ -112,8 +115,27 @@ private:
 
     const D3D12_HEAP_TYPE m_heapType;
 
+    // One bit per block of an order, set while the block is free, and a summary bit per word of them that has
+    // any bit set
+    struct FreeBitmap
+    {
+        std::vector<uint64_t> Words;
+        std::vector<uint64_t> Summary;
+
+        void Resize(size_t numBlocks);
+        void Set(size_t index);
+        void Clear(size_t index);
+        bool Test(size_t index) const { return (Words[index / 64] >> (index % 64)) & 1; }
+
+        // The lowest free block, or ~0 when there is none
+        size_t FindFirst() const;
+    };
+
+    std::mutex m_mutex;             // Guards the free blocks, the deferred deletions and the counters
+    std::mutex m_backingMutex;      // Serializes initializing blocks of the one backing resource
+
     std::queue<BuddyBlock*> m_deferredDeletionQueue;
-    std::vector<std::set<size_t>> m_freeBlocks;
+    std::vector<FreeBitmap> m_freeBlocks;
     UINT m_maxOrder;
     const size_t m_baseOffset;
     const size_t m_maxBlockSize;
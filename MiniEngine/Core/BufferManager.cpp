@@ -17,6 +17,7 @@
 #include "CommandContext.h"
 #include "EsramAllocator.h"
 #include "TemporalEffects.h"
+#include "CascadedShadowCamera.h"
 
 namespace Graphics
 {
@@ -24,12 +25,18 @@ namespace Graphics
     ColorBuffer g_SceneColorBuffer;
     ColorBuffer g_PostEffectsBuffer;
     ColorBuffer g_VelocityBuffer;
+    ColorBuffer g_VelocityBufferHalf;
     ColorBuffer g_OverlayBuffer;
     ColorBuffer g_HorizontalBuffer;
 
     ShadowBuffer g_ShadowBuffer;
+    ShadowBuffer g_StaticShadowBuffer;
+    ShadowBuffer g_CascadedShadowBuffer;
 
     ColorBuffer g_SSAOFullScreen(Color(1.0f, 1.0f, 1.0f));
+    ColorBuffer g_SunShadowMask(Color(1.0f, 1.0f, 1.0f));
+    ColorBuffer g_SunShadowMaskHalf(Color(1.0f, 1.0f, 1.0f));
+    ColorBuffer g_ShadingRateImage;
     ColorBuffer g_LinearDepth[2];
     ColorBuffer g_MinMaxDepth8;
     ColorBuffer g_MinMaxDepth16;
@@ -53,19 +60,26 @@ namespace Graphics
     ColorBuffer g_AOHighQuality2;
     ColorBuffer g_AOHighQuality3;
     ColorBuffer g_AOHighQuality4;
+    ColorBuffer g_AOHistory[2];
 
     ColorBuffer g_DoFTileClass[2];
     ColorBuffer g_DoFPresortBuffer;
     ColorBuffer g_DoFPrefilter;
     ColorBuffer g_DoFBlurColor[2];
     ColorBuffer g_DoFBlurAlpha[2];
+    ColorBuffer g_DoFBlurQuarter;
     StructuredBuffer g_DoFWorkQueue;
     StructuredBuffer g_DoFFastQueue;
     StructuredBuffer g_DoFFixupQueue;
+    StructuredBuffer g_DoFFarQueue;
 
     ColorBuffer g_MotionPrepBuffer;
+    ColorBuffer g_MotionTileMax;
+    StructuredBuffer g_MotionUniformQueue;
+    StructuredBuffer g_MotionComplexQueue;
     ColorBuffer g_LumaBuffer;
     ColorBuffer g_TemporalColor[2];
+    ColorBuffer g_TemporalWeight[2];
     ColorBuffer g_aBloomUAV1[2];    // 640x384 (1/3)
     ColorBuffer g_aBloomUAV2[2];    // 320x192 (1/6)  
     ColorBuffer g_aBloomUAV3[2];    // 160x96  (1/12)
@@ -80,12 +94,26 @@ namespace Graphics
     // For testing GenerateMipMaps()
     ColorBuffer g_GenMipsBuffer;
 
+    FrameGraph g_FrameGraph;
+
     DXGI_FORMAT DefaultHdrColorFormat = DXGI_FORMAT_R11G11B10_FLOAT;
 }
 
 #define T2X_COLOR_FORMAT DXGI_FORMAT_R10G10B10A2_UNORM
 #define HDR_MOTION_FORMAT DXGI_FORMAT_R16G16B16A16_FLOAT
 #define DSV_FORMAT DXGI_FORMAT_D32_FLOAT
+#define SHADOW_FORMAT DXGI_FORMAT_D16_UNORM
+
+namespace
+{
+    // Transient buffers are written first by the pass that they belong to
+    void CreateTransient( Graphics::TransientPass Pass, ColorBuffer& Buffer, const std::wstring& Name, uint32_t Width,
+        uint32_t Height, uint32_t ArrayCount, DXGI_FORMAT Format )
+    {
+        Graphics::g_FrameGraph.AddTransient(Buffer, Name, Width, Height, ArrayCount, Format);
+        Graphics::g_FrameGraph.Writes(Pass, Buffer);
+    }
+}
 
 void Graphics::InitializeRenderingBuffers( uint32_t bufferWidth, uint32_t bufferHeight )
 {
@@ -106,10 +134,18 @@ void Graphics::InitializeRenderingBuffers( uint32_t bufferWidth, uint32_t buffer
 
     EsramAllocator esram;
 
+    // In the order of TransientPass, which is the order the frame runs them in
+    g_FrameGraph.Destroy();
+    g_FrameGraph.AddPass(L"SSAO");
+    g_FrameGraph.AddPass(L"Depth of Field");
+    g_FrameGraph.AddPass(L"Motion Blur");
+    g_FrameGraph.AddPass(L"Post Effects");
+
     esram.PushStack();
 
         g_SceneColorBuffer.Create( L"Main Color Buffer", bufferWidth, bufferHeight, 1, DefaultHdrColorFormat, esram );
         g_VelocityBuffer.Create( L"Motion Vectors", bufferWidth, bufferHeight, 1, DXGI_FORMAT_R32_UINT );
+        g_VelocityBufferHalf.Create( L"Motion Vectors Half Res", bufferWidth1, bufferHeight1, 1, DXGI_FORMAT_R32_UINT );
         g_PostEffectsBuffer.Create( L"Post Effects Buffer", bufferWidth, bufferHeight, 1, DXGI_FORMAT_R32_UINT );
 
         esram.PushStack();    // Render HDR image
@@ -127,30 +163,42 @@ void Graphics::InitializeRenderingBuffers( uint32_t bufferWidth, uint32_t buffer
                 esram.PushStack();    // Begin Shading
 
                     g_SSAOFullScreen.Create( L"SSAO Full Res", bufferWidth, bufferHeight, 1, DXGI_FORMAT_R8_UNORM );
+                    g_SunShadowMask.Create( L"Sun Shadow Mask", bufferWidth, bufferHeight, 1, DXGI_FORMAT_R8_UNORM );
+                    g_SunShadowMaskHalf.Create( L"Sun Shadow Mask Half Res", bufferWidth1, bufferHeight1, 1, DXGI_FORMAT_R8_UNORM );
+                    g_AOHistory[0].Create( L"AO History 0", bufferWidth1, bufferHeight1, 1, DXGI_FORMAT_R8_UNORM );
+                    g_AOHistory[1].Create( L"AO History 1", bufferWidth1, bufferHeight1, 1, DXGI_FORMAT_R8_UNORM );
+                    if (g_bVariableRateShadingTier2)
+                    {
+                        const uint32_t TileSize = g_ShadingRateTileSize;
+                        g_ShadingRateImage.Create( L"Shading Rate Image", (bufferWidth + TileSize - 1) / TileSize,
+                            (bufferHeight + TileSize - 1) / TileSize, 1, DXGI_FORMAT_R8_UINT );
+                    }
 
                     esram.PushStack();    // Begin generating SSAO
-                        g_DepthDownsize1.Create( L"Depth Down-Sized 1", bufferWidth1, bufferHeight1, 1, DXGI_FORMAT_R32_FLOAT, esram );
-                        g_DepthDownsize2.Create( L"Depth Down-Sized 2", bufferWidth2, bufferHeight2, 1, DXGI_FORMAT_R32_FLOAT, esram );
-                        g_DepthDownsize3.Create( L"Depth Down-Sized 3", bufferWidth3, bufferHeight3, 1, DXGI_FORMAT_R32_FLOAT, esram );
-                        g_DepthDownsize4.Create( L"Depth Down-Sized 4", bufferWidth4, bufferHeight4, 1, DXGI_FORMAT_R32_FLOAT, esram );
-                        g_DepthTiled1.CreateArray( L"Depth De-Interleaved 1", bufferWidth3, bufferHeight3, 16, DXGI_FORMAT_R16_FLOAT, esram );
-                        g_DepthTiled2.CreateArray( L"Depth De-Interleaved 2", bufferWidth4, bufferHeight4, 16, DXGI_FORMAT_R16_FLOAT, esram );
-                        g_DepthTiled3.CreateArray( L"Depth De-Interleaved 3", bufferWidth5, bufferHeight5, 16, DXGI_FORMAT_R16_FLOAT, esram );
-                        g_DepthTiled4.CreateArray( L"Depth De-Interleaved 4", bufferWidth6, bufferHeight6, 16, DXGI_FORMAT_R16_FLOAT, esram );
-                        g_AOMerged1.Create( L"AO Re-Interleaved 1", bufferWidth1, bufferHeight1, 1, DXGI_FORMAT_R8_UNORM, esram );
-                        g_AOMerged2.Create( L"AO Re-Interleaved 2", bufferWidth2, bufferHeight2, 1, DXGI_FORMAT_R8_UNORM, esram );
-                        g_AOMerged3.Create( L"AO Re-Interleaved 3", bufferWidth3, bufferHeight3, 1, DXGI_FORMAT_R8_UNORM, esram );
-                        g_AOMerged4.Create( L"AO Re-Interleaved 4", bufferWidth4, bufferHeight4, 1, DXGI_FORMAT_R8_UNORM, esram );
-                        g_AOSmooth1.Create( L"AO Smoothed 1", bufferWidth1, bufferHeight1, 1, DXGI_FORMAT_R8_UNORM, esram );
-                        g_AOSmooth2.Create( L"AO Smoothed 2", bufferWidth2, bufferHeight2, 1, DXGI_FORMAT_R8_UNORM, esram );
-                        g_AOSmooth3.Create( L"AO Smoothed 3", bufferWidth3, bufferHeight3, 1, DXGI_FORMAT_R8_UNORM, esram );
-                        g_AOHighQuality1.Create( L"AO High Quality 1", bufferWidth1, bufferHeight1, 1, DXGI_FORMAT_R8_UNORM, esram );
-                        g_AOHighQuality2.Create( L"AO High Quality 2", bufferWidth2, bufferHeight2, 1, DXGI_FORMAT_R8_UNORM, esram );
-                        g_AOHighQuality3.Create( L"AO High Quality 3", bufferWidth3, bufferHeight3, 1, DXGI_FORMAT_R8_UNORM, esram );
-                        g_AOHighQuality4.Create( L"AO High Quality 4", bufferWidth4, bufferHeight4, 1, DXGI_FORMAT_R8_UNORM, esram );
+                        CreateTransient( kSSAOPass, g_DepthDownsize1, L"Depth Down-Sized 1", bufferWidth1, bufferHeight1, 1, DXGI_FORMAT_R32_FLOAT );
+                        CreateTransient( kSSAOPass, g_DepthDownsize2, L"Depth Down-Sized 2", bufferWidth2, bufferHeight2, 1, DXGI_FORMAT_R32_FLOAT );
+                        CreateTransient( kSSAOPass, g_DepthDownsize3, L"Depth Down-Sized 3", bufferWidth3, bufferHeight3, 1, DXGI_FORMAT_R32_FLOAT );
+                        CreateTransient( kSSAOPass, g_DepthDownsize4, L"Depth Down-Sized 4", bufferWidth4, bufferHeight4, 1, DXGI_FORMAT_R32_FLOAT );
+                        CreateTransient( kSSAOPass, g_DepthTiled1, L"Depth De-Interleaved 1", bufferWidth3, bufferHeight3, 16, DXGI_FORMAT_R16_FLOAT );
+                        CreateTransient( kSSAOPass, g_DepthTiled2, L"Depth De-Interleaved 2", bufferWidth4, bufferHeight4, 16, DXGI_FORMAT_R16_FLOAT );
+                        CreateTransient( kSSAOPass, g_DepthTiled3, L"Depth De-Interleaved 3", bufferWidth5, bufferHeight5, 16, DXGI_FORMAT_R16_FLOAT );
+                        CreateTransient( kSSAOPass, g_DepthTiled4, L"Depth De-Interleaved 4", bufferWidth6, bufferHeight6, 16, DXGI_FORMAT_R16_FLOAT );
+                        CreateTransient( kSSAOPass, g_AOMerged1, L"AO Re-Interleaved 1", bufferWidth1, bufferHeight1, 1, DXGI_FORMAT_R8_UNORM );
+                        CreateTransient( kSSAOPass, g_AOMerged2, L"AO Re-Interleaved 2", bufferWidth2, bufferHeight2, 1, DXGI_FORMAT_R8_UNORM );
+                        CreateTransient( kSSAOPass, g_AOMerged3, L"AO Re-Interleaved 3", bufferWidth3, bufferHeight3, 1, DXGI_FORMAT_R8_UNORM );
+                        CreateTransient( kSSAOPass, g_AOMerged4, L"AO Re-Interleaved 4", bufferWidth4, bufferHeight4, 1, DXGI_FORMAT_R8_UNORM );
+                        CreateTransient( kSSAOPass, g_AOSmooth1, L"AO Smoothed 1", bufferWidth1, bufferHeight1, 1, DXGI_FORMAT_R8_UNORM );
+                        CreateTransient( kSSAOPass, g_AOSmooth2, L"AO Smoothed 2", bufferWidth2, bufferHeight2, 1, DXGI_FORMAT_R8_UNORM );
+                        CreateTransient( kSSAOPass, g_AOSmooth3, L"AO Smoothed 3", bufferWidth3, bufferHeight3, 1, DXGI_FORMAT_R8_UNORM );
+                        CreateTransient( kSSAOPass, g_AOHighQuality1, L"AO High Quality 1", bufferWidth1, bufferHeight1, 1, DXGI_FORMAT_R8_UNORM );
+                        CreateTransient( kSSAOPass, g_AOHighQuality2, L"AO High Quality 2", bufferWidth2, bufferHeight2, 1, DXGI_FORMAT_R8_UNORM );
+                        CreateTransient( kSSAOPass, g_AOHighQuality3, L"AO High Quality 3", bufferWidth3, bufferHeight3, 1, DXGI_FORMAT_R8_UNORM );
+                        CreateTransient( kSSAOPass, g_AOHighQuality4, L"AO High Quality 4", bufferWidth4, bufferHeight4, 1, DXGI_FORMAT_R8_UNORM );
                     esram.PopStack();    // End generating SSAO
 
-                    g_ShadowBuffer.Create( L"Shadow Map", 2048, 2048, esram );
+                    g_ShadowBuffer.Create( L"Shadow Map", 2048, 2048, SHADOW_FORMAT, esram );
+                    g_StaticShadowBuffer.Create( L"Static Shadow Map", 2048, 2048, SHADOW_FORMAT );
+                    g_CascadedShadowBuffer.CreateArray( L"Cascaded Shadow Map", 1024, 1024, GameCore::CascadedShadowCamera::kMaxCascades, SHADOW_FORMAT );
 
                 esram.PopStack();    // End Shading
 
@@ -158,23 +206,26 @@ void Graphics::InitializeRenderingBuffers( uint32_t bufferWidth, uint32_t buffer
                     g_DoFTileClass[0].Create(L"DoF Tile Classification Buffer 0", bufferWidth4, bufferHeight4, 1, DXGI_FORMAT_R11G11B10_FLOAT);
                     g_DoFTileClass[1].Create(L"DoF Tile Classification Buffer 1", bufferWidth4, bufferHeight4, 1, DXGI_FORMAT_R11G11B10_FLOAT);
 
-                    g_DoFPresortBuffer.Create(L"DoF Presort Buffer", bufferWidth1, bufferHeight1, 1, DXGI_FORMAT_R11G11B10_FLOAT, esram );
-                    g_DoFPrefilter.Create(L"DoF PreFilter Buffer", bufferWidth1, bufferHeight1, 1, DXGI_FORMAT_R11G11B10_FLOAT, esram );
-                    g_DoFBlurColor[0].Create(L"DoF Blur Color", bufferWidth1, bufferHeight1, 1, DXGI_FORMAT_R11G11B10_FLOAT, esram );
-                    g_DoFBlurColor[1].Create(L"DoF Blur Color", bufferWidth1, bufferHeight1, 1, DXGI_FORMAT_R11G11B10_FLOAT, esram );
-                    g_DoFBlurAlpha[0].Create(L"DoF FG Alpha", bufferWidth1, bufferHeight1, 1, DXGI_FORMAT_R8_UNORM, esram );
-                    g_DoFBlurAlpha[1].Create(L"DoF FG Alpha", bufferWidth1, bufferHeight1, 1, DXGI_FORMAT_R8_UNORM, esram );
+                    CreateTransient( kDepthOfFieldPass, g_DoFPresortBuffer, L"DoF Presort Buffer", bufferWidth1, bufferHeight1, 1, DXGI_FORMAT_R11G11B10_FLOAT );
+                    CreateTransient( kDepthOfFieldPass, g_DoFPrefilter, L"DoF PreFilter Buffer", bufferWidth1, bufferHeight1, 1, DXGI_FORMAT_R11G11B10_FLOAT );
+                    CreateTransient( kDepthOfFieldPass, g_DoFBlurColor[0], L"DoF Blur Color", bufferWidth1, bufferHeight1, 1, DXGI_FORMAT_R11G11B10_FLOAT );
+                    CreateTransient( kDepthOfFieldPass, g_DoFBlurColor[1], L"DoF Blur Color", bufferWidth1, bufferHeight1, 1, DXGI_FORMAT_R11G11B10_FLOAT );
+                    CreateTransient( kDepthOfFieldPass, g_DoFBlurAlpha[0], L"DoF FG Alpha", bufferWidth1, bufferHeight1, 1, DXGI_FORMAT_R8_UNORM );
+                    CreateTransient( kDepthOfFieldPass, g_DoFBlurAlpha[1], L"DoF FG Alpha", bufferWidth1, bufferHeight1, 1, DXGI_FORMAT_R8_UNORM );
+                    CreateTransient( kDepthOfFieldPass, g_DoFBlurQuarter, L"DoF Quarter Blur", bufferWidth2, bufferHeight2, 1, DXGI_FORMAT_R16G16B16A16_FLOAT );
                     g_DoFWorkQueue.Create(L"DoF Work Queue", bufferWidth4 * bufferHeight4, 4, esram );
                     g_DoFFastQueue.Create(L"DoF Fast Queue", bufferWidth4 * bufferHeight4, 4, esram );
                     g_DoFFixupQueue.Create(L"DoF Fixup Queue", bufferWidth4 * bufferHeight4, 4, esram );
+                    g_DoFFarQueue.Create(L"DoF Far Queue", bufferWidth4 * bufferHeight4, 4, esram );
                 esram.PopStack();    // End depth of field
 
-                g_TemporalColor[0].Create( L"Temporal Color 0", bufferWidth, bufferHeight, 1, DXGI_FORMAT_R16G16B16A16_FLOAT);
-                g_TemporalColor[1].Create( L"Temporal Color 1", bufferWidth, bufferHeight, 1, DXGI_FORMAT_R16G16B16A16_FLOAT);
-                TemporalEffects::ClearHistory(InitContext);
+                TemporalEffects::CreateHistory(InitContext, bufferWidth, bufferHeight);
 
                 esram.PushStack();    // Begin motion blur
-                    g_MotionPrepBuffer.Create( L"Motion Blur Prep", bufferWidth1, bufferHeight1, 1, HDR_MOTION_FORMAT, esram );
+                    CreateTransient( kMotionBlurPass, g_MotionPrepBuffer, L"Motion Blur Prep", bufferWidth1, bufferHeight1, 1, HDR_MOTION_FORMAT );
+                    g_MotionTileMax.Create( L"Motion Blur Tile Max", bufferWidth4, bufferHeight4, 1, DXGI_FORMAT_R16G16_FLOAT );
+                    g_MotionUniformQueue.Create(L"Motion Blur Uniform Queue", bufferWidth4 * bufferHeight4, 4, esram );
+                    g_MotionComplexQueue.Create(L"Motion Blur Complex Queue", bufferWidth4 * bufferHeight4, 4, esram );
                 esram.PopStack();    // End motion blur
 
             esram.PopStack();    // End opaque geometry
@@ -195,17 +246,17 @@ void Graphics::InitializeRenderingBuffers( uint32_t bufferWidth, uint32_t buffer
             uint32_t kBloomHeight = bufferHeight > 1440 ? 768 : 384;
 
             esram.PushStack();    // Begin bloom and tone mapping
-                g_LumaLR.Create( L"Luma Buffer", kBloomWidth, kBloomHeight, 1, DXGI_FORMAT_R8_UINT, esram );
-                g_aBloomUAV1[0].Create( L"Bloom Buffer 1a", kBloomWidth,    kBloomHeight,    1, DefaultHdrColorFormat, esram );
-                g_aBloomUAV1[1].Create( L"Bloom Buffer 1b", kBloomWidth,    kBloomHeight,    1, DefaultHdrColorFormat, esram);
-                g_aBloomUAV2[0].Create( L"Bloom Buffer 2a", kBloomWidth/2,  kBloomHeight/2,  1, DefaultHdrColorFormat, esram );
-                g_aBloomUAV2[1].Create( L"Bloom Buffer 2b", kBloomWidth/2,  kBloomHeight/2,  1, DefaultHdrColorFormat, esram );
-                g_aBloomUAV3[0].Create( L"Bloom Buffer 3a", kBloomWidth/4,  kBloomHeight/4,  1, DefaultHdrColorFormat, esram );
-                g_aBloomUAV3[1].Create( L"Bloom Buffer 3b", kBloomWidth/4,  kBloomHeight/4,  1, DefaultHdrColorFormat, esram );
-                g_aBloomUAV4[0].Create( L"Bloom Buffer 4a", kBloomWidth/8,  kBloomHeight/8,  1, DefaultHdrColorFormat, esram );
-                g_aBloomUAV4[1].Create( L"Bloom Buffer 4b", kBloomWidth/8,  kBloomHeight/8,  1, DefaultHdrColorFormat, esram );
-                g_aBloomUAV5[0].Create( L"Bloom Buffer 5a", kBloomWidth/16, kBloomHeight/16, 1, DefaultHdrColorFormat, esram );
-                g_aBloomUAV5[1].Create( L"Bloom Buffer 5b", kBloomWidth/16, kBloomHeight/16, 1, DefaultHdrColorFormat, esram );
+                CreateTransient( kPostProcessPass, g_LumaLR, L"Luma Buffer", kBloomWidth, kBloomHeight, 1, DXGI_FORMAT_R8_UINT );
+                CreateTransient( kPostProcessPass, g_aBloomUAV1[0], L"Bloom Buffer 1a", kBloomWidth,    kBloomHeight,    1, DefaultHdrColorFormat );
+                CreateTransient( kPostProcessPass, g_aBloomUAV1[1], L"Bloom Buffer 1b", kBloomWidth,    kBloomHeight,    1, DefaultHdrColorFormat );
+                CreateTransient( kPostProcessPass, g_aBloomUAV2[0], L"Bloom Buffer 2a", kBloomWidth/2,  kBloomHeight/2,  1, DefaultHdrColorFormat );
+                CreateTransient( kPostProcessPass, g_aBloomUAV2[1], L"Bloom Buffer 2b", kBloomWidth/2,  kBloomHeight/2,  1, DefaultHdrColorFormat );
+                CreateTransient( kPostProcessPass, g_aBloomUAV3[0], L"Bloom Buffer 3a", kBloomWidth/4,  kBloomHeight/4,  1, DefaultHdrColorFormat );
+                CreateTransient( kPostProcessPass, g_aBloomUAV3[1], L"Bloom Buffer 3b", kBloomWidth/4,  kBloomHeight/4,  1, DefaultHdrColorFormat );
+                CreateTransient( kPostProcessPass, g_aBloomUAV4[0], L"Bloom Buffer 4a", kBloomWidth/8,  kBloomHeight/8,  1, DefaultHdrColorFormat );
+                CreateTransient( kPostProcessPass, g_aBloomUAV4[1], L"Bloom Buffer 4b", kBloomWidth/8,  kBloomHeight/8,  1, DefaultHdrColorFormat );
+                CreateTransient( kPostProcessPass, g_aBloomUAV5[0], L"Bloom Buffer 5a", kBloomWidth/16, kBloomHeight/16, 1, DefaultHdrColorFormat );
+                CreateTransient( kPostProcessPass, g_aBloomUAV5[1], L"Bloom Buffer 5b", kBloomWidth/16, kBloomHeight/16, 1, DefaultHdrColorFormat );
             esram.PopStack();    // End tone mapping
 
             esram.PushStack();    // Begin antialiasing
@@ -227,6 +278,11 @@ void Graphics::InitializeRenderingBuffers( uint32_t bufferWidth, uint32_t buffer
 
     esram.PopStack(); // End final image
 
+    g_FrameGraph.Compile();
+
+    // The SSAO chain lives in the transient heap, so the heap is what goes in the fast tier
+    esram.Place(g_FrameGraph.GetHeap(), g_FrameGraph.GetHeapSize(), L"Transient Heap");
+
     InitContext.Finish();
 }
 
@@ -241,13 +297,19 @@ void Graphics::DestroyRenderingBuffers()
     g_SceneDepthBuffer.Destroy();
     g_SceneColorBuffer.Destroy();
     g_VelocityBuffer.Destroy();
+    g_VelocityBufferHalf.Destroy();
     g_OverlayBuffer.Destroy();
     g_HorizontalBuffer.Destroy();
     g_PostEffectsBuffer.Destroy();
 
     g_ShadowBuffer.Destroy();
+    g_StaticShadowBuffer.Destroy();
+    g_CascadedShadowBuffer.Destroy();
 
     g_SSAOFullScreen.Destroy();
+    g_SunShadowMask.Destroy();
+    g_SunShadowMaskHalf.Destroy();
+    g_ShadingRateImage.Destroy();
     g_LinearDepth[0].Destroy();
     g_LinearDepth[1].Destroy();
     g_MinMaxDepth8.Destroy();
@@ -272,6 +334,8 @@ void Graphics::DestroyRenderingBuffers()
     g_AOHighQuality2.Destroy();
     g_AOHighQuality3.Destroy();
     g_AOHighQuality4.Destroy();
+    g_AOHistory[0].Destroy();
+    g_AOHistory[1].Destroy();
 
     g_DoFTileClass[0].Destroy();
     g_DoFTileClass[1].Destroy();
@@ -281,14 +345,21 @@ void Graphics::DestroyRenderingBuffers()
     g_DoFBlurColor[1].Destroy();
     g_DoFBlurAlpha[0].Destroy();
     g_DoFBlurAlpha[1].Destroy();
+    g_DoFBlurQuarter.Destroy();
     g_DoFWorkQueue.Destroy();
     g_DoFFastQueue.Destroy();
     g_DoFFixupQueue.Destroy();
+    g_DoFFarQueue.Destroy();
 
     g_MotionPrepBuffer.Destroy();
+    g_MotionTileMax.Destroy();
+    g_MotionUniformQueue.Destroy();
+    g_MotionComplexQueue.Destroy();
     g_LumaBuffer.Destroy();
     g_TemporalColor[0].Destroy();
     g_TemporalColor[1].Destroy();
+    g_TemporalWeight[0].Destroy();
+    g_TemporalWeight[1].Destroy();
     g_aBloomUAV1[0].Destroy();
     g_aBloomUAV1[1].Destroy();
     g_aBloomUAV2[0].Destroy();
@@ -306,4 +377,6 @@ void Graphics::DestroyRenderingBuffers()
     g_FXAAColorQueue.Destroy();
 
     g_GenMipsBuffer.Destroy();
+
+    g_FrameGraph.Destroy();
 }
@@ -18,6 +18,7 @@
 #include "ShadowBuffer.h"
 #include "GpuBuffer.h"
 #include "GraphicsCore.h"
+#include "FrameGraph.h"
 
 namespace Graphics
 {
@@ -28,9 +29,15 @@ namespace Graphics
     extern ColorBuffer g_HorizontalBuffer;    // For separable (bicubic) upsampling
 
     extern ColorBuffer g_VelocityBuffer;    // R10G10B10  (3D velocity)
-    extern ShadowBuffer g_ShadowBuffer;
+    extern ColorBuffer g_VelocityBufferHalf;    // The velocity of the closest pixel of each 2x2 quad, for TAA
+    extern ShadowBuffer g_ShadowBuffer;        // D16_UNORM by default; applications may recreate it as D32_FLOAT
+    extern ShadowBuffer g_StaticShadowBuffer;    // Persistent cache of static casters, never aliased in ESRAM
+    extern ShadowBuffer g_CascadedShadowBuffer;    // D16_UNORM array, one slice per cascade
 
     extern ColorBuffer g_SSAOFullScreen;    // R8_UNORM
+    extern ColorBuffer g_SunShadowMask;        // R8_UNORM screen-space sun shadow
+    extern ColorBuffer g_SunShadowMaskHalf;    // R8_UNORM, evaluated at half resolution and upsampled into g_SunShadowMask
+    extern ColorBuffer g_ShadingRateImage;    // R8_UINT D3D12_SHADING_RATE per tile, created with variable rate shading tier 2
     extern ColorBuffer g_LinearDepth[2];    // Normalized planar distance (0 at eye, 1 at far plane) computed from the SceneDepthBuffer
     extern ColorBuffer g_MinMaxDepth8;        // Min and max depth values of 8x8 tiles
     extern ColorBuffer g_MinMaxDepth16;        // Min and max depth values of 16x16 tiles
@@ -54,19 +61,26 @@ namespace Graphics
     extern ColorBuffer g_AOHighQuality2;
     extern ColorBuffer g_AOHighQuality3;
     extern ColorBuffer g_AOHighQuality4;
+    extern ColorBuffer g_AOHistory[2];        // R8_UNORM half resolution AO accumulated by the temporal mode
 
     extern ColorBuffer g_DoFTileClass[2];
     extern ColorBuffer g_DoFPresortBuffer;
     extern ColorBuffer g_DoFPrefilter;
     extern ColorBuffer g_DoFBlurColor[2];
     extern ColorBuffer g_DoFBlurAlpha[2];
+    extern ColorBuffer g_DoFBlurQuarter;    // Quarter resolution far field blur, with its depth in alpha
     extern StructuredBuffer g_DoFWorkQueue;
     extern StructuredBuffer g_DoFFastQueue;
     extern StructuredBuffer g_DoFFixupQueue;
+    extern StructuredBuffer g_DoFFarQueue;
 
     extern ColorBuffer g_MotionPrepBuffer;        // R10G10B10A2
+    extern ColorBuffer g_MotionTileMax;           // Max and min speed of each 16x16 tile
+    extern StructuredBuffer g_MotionUniformQueue;
+    extern StructuredBuffer g_MotionComplexQueue;
     extern ColorBuffer g_LumaBuffer;
     extern ColorBuffer g_TemporalColor[2];
+    extern ColorBuffer g_TemporalWeight[2];    // R8_UNORM confidence, when the history color is R11G11B10
 
     extern ColorBuffer g_aBloomUAV1[2];        // 640x384 (1/3)
     extern ColorBuffer g_aBloomUAV2[2];        // 320x192 (1/6)  
@@ -79,6 +93,11 @@ namespace Graphics
     extern ByteAddressBuffer g_FXAAWorkQueue;
     extern TypedBuffer g_FXAAColorQueue;
 
+    // The working buffers of SSAO, depth of field, motion blur and post processing only live while those passes
+    // run, so they share memory.  Each of the passes begins with g_FrameGraph.BeginPass().
+    enum TransientPass { kSSAOPass, kDepthOfFieldPass, kMotionBlurPass, kPostProcessPass, kNumTransientPasses };
+    extern FrameGraph g_FrameGraph;
+
     void InitializeRenderingBuffers(uint32_t NativeWidth, uint32_t NativeHeight );
     void ResizeDisplayDependentBuffers(uint32_t NativeWidth, uint32_t NativeHeight);
     void DestroyRenderingBuffers();
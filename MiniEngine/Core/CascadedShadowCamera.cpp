@@ -0,0 +1,135 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "pch.h"
+#include "CascadedShadowCamera.h"
+#include <cmath>
+
+using namespace Math;
+
+void GameCore::CascadedShadowCamera::UpdateMatrices(
+    const Camera& ViewCamera, Vector3 LightDirection, uint32_t NumCascades, float SplitLambda,
+    float ShadowDistance, float ShadowDepth, uint32_t BufferWidth, uint32_t BufferHeight, uint32_t BufferPrecision,
+    uint32_t FirstScrollingCascade )
+{
+    ASSERT(NumCascades > 0 && NumCascades <= kMaxCascades);
+    m_NumCascades = NumCascades;
+    m_FirstScrollingCascade = FirstScrollingCascade;
+    m_BufferWidth = BufferWidth;
+    m_BufferHeight = BufferHeight;
+
+    const float NearClip = ViewCamera.GetNearClip();
+    const float FarClip = ViewCamera.GetFarClip() < ShadowDistance ? ViewCamera.GetFarClip() : ShadowDistance;
+
+    // Rays from the eye through the four far corners, scaled so that a view distance of d lands on the
+    // plane at depth d.  This lets us get the corners of any slice of the frustum without the aspect ratio.
+    const Vector3 Eye = ViewCamera.GetPosition();
+    const Frustum& ViewFrustum = ViewCamera.GetWorldSpaceFrustum();
+    const Scalar RcpFar = Recip(Scalar(ViewCamera.GetFarClip()));
+    Vector3 CornerRays[4];
+    CornerRays[0] = (ViewFrustum.GetFrustumCorner(Frustum::kFarLowerLeft) - Eye) * RcpFar;
+    CornerRays[1] = (ViewFrustum.GetFrustumCorner(Frustum::kFarUpperLeft) - Eye) * RcpFar;
+    CornerRays[2] = (ViewFrustum.GetFrustumCorner(Frustum::kFarLowerRight) - Eye) * RcpFar;
+    CornerRays[3] = (ViewFrustum.GetFrustumCorner(Frustum::kFarUpperRight) - Eye) * RcpFar;
+
+    float SliceNear = NearClip;
+
+    for (uint32_t i = 0; i < NumCascades; ++i)
+    {
+        // Practical split scheme:  blend between logarithmic and uniform partitions
+        const float t = (float)(i + 1) / (float)NumCascades;
+        const float LogSplit = NearClip * std::pow(FarClip / NearClip, t);
+        const float UniformSplit = NearClip + (FarClip - NearClip) * t;
+        const float SliceFar = UniformSplit + (LogSplit - UniformSplit) * SplitLambda;
+
+        m_SplitDistances[i] = SliceFar;
+
+        Vector3 Corners[8];
+        for (uint32_t c = 0; c < 4; ++c)
+        {
+            Corners[c] = Eye + CornerRays[c] * SliceNear;
+            Corners[c + 4] = Eye + CornerRays[c] * SliceFar;
+        }
+
+        // Fit a sphere rather than a box so that the cascade size does not change as the camera rotates.
+        // Combined with the texel snapping in ShadowCamera, this keeps shadow edges from shimmering.
+        Vector3 Center(kZero);
+        for (uint32_t c = 0; c < 8; ++c)
+            Center = Center + Corners[c];
+        Center = Center * 0.125f;
+
+        float Radius = 0.0f;
+        for (uint32_t c = 0; c < 8; ++c)
+        {
+            float Dist = Length(Corners[c] - Center);
+            Radius = Dist > Radius ? Dist : Radius;
+        }
+        Radius = std::ceil(Radius * 16.0f) / 16.0f;
+
+        const float Diameter = Radius * 2.0f;
+        float Depth = ShadowDepth > Diameter ? ShadowDepth : Diameter;
+
+        // ShadowCamera expects the center of the far (away from the light) bounding plane
+        Vector3 FarCenter = Center + LightDirection * Radius;
+
+        if (IsScrolling(i))
+        {
+            // Stored depths are only comparable if the depth range stays put, so the far plane advances along
+            // the light in quarters of the cascade.  The range grows by one step to still enclose the slice.
+            const float DepthStep = Diameter * 0.25f;
+            const float Along = Dot(FarCenter, LightDirection);
+            const float StepIndex = std::ceil(Along / DepthStep);
+            FarCenter = FarCenter + LightDirection * (StepIndex * DepthStep - Along);
+            Depth += DepthStep;
+
+            ScrollState State;
+            State.LightDirection[0] = LightDirection.GetX();
+            State.LightDirection[1] = LightDirection.GetY();
+            State.LightDirection[2] = LightDirection.GetZ();
+            State.Radius = Radius;
+            State.DepthStep = (int32_t)StepIndex;
+            State.BufferWidth = BufferWidth;
+            State.BufferHeight = BufferHeight;
+            State.BufferPrecision = BufferPrecision;
+            if (memcmp(&State, &m_ScrollState[i], sizeof(ScrollState)) != 0)
+            {
+                m_ScrollState[i] = State;
+                ++m_ScrollEpoch[i];
+            }
+        }
+        else if (m_ScrollState[i].BufferWidth != 0)
+        {
+            // Scrolling again later starts over
+            memset(&m_ScrollState[i], 0, sizeof(ScrollState));
+            ++m_ScrollEpoch[i];
+        }
+
+        m_Cascades[i].UpdateMatrix(LightDirection, FarCenter, Vector3(Diameter, Diameter, Depth),
+            BufferWidth, BufferHeight, BufferPrecision);
+
+        // The view's left and top edges sit at these texels of the light's unbounded texel grid, which the
+        // buffer tiles.  Rows count down the light's up axis like texture coordinates.
+        if (IsScrolling(i))
+        {
+            const int32_t Width = (int32_t)BufferWidth;
+            const int32_t Height = (int32_t)BufferHeight;
+            const int32_t Left = m_Cascades[i].GetTexelCenterX() - Width / 2;
+            const int32_t Top = -m_Cascades[i].GetTexelCenterY() - Height / 2;
+            m_WrapOffset[i][0] = (uint32_t)((Left % Width + Width) % Width);
+            m_WrapOffset[i][1] = (uint32_t)((Top % Height + Height) % Height);
+        }
+        else
+        {
+            m_WrapOffset[i][0] = 0;
+            m_WrapOffset[i][1] = 0;
+        }
+
+        SliceNear = SliceFar;
+    }
+}
@@ -0,0 +1,97 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#pragma once
+
+#include "ShadowCamera.h"
+
+namespace GameCore
+{
+    using namespace Math;
+
+    // Splits the view frustum of a camera into depth slices and fits a texel-snapped orthographic
+    // ShadowCamera around each one.  Each cascade is meant to be rendered into one slice of a
+    // shadow buffer array.
+    //
+    // Cascades from FirstScrollingCascade on can scroll:  their depth range only moves along the light in
+    // coarse steps, so after the camera moves they differ from the last update only by a whole number of
+    // texels across the light.  Their buffers are addressed toroidally, so what was already rendered stays
+    // valid and only the strips that came into view need to be drawn.
+    class CascadedShadowCamera
+    {
+    public:
+
+        enum { kMaxCascades = 8 };
+
+        CascadedShadowCamera() : m_NumCascades(0), m_FirstScrollingCascade(kMaxCascades), m_BufferWidth(0), m_BufferHeight(0)
+        {
+            memset(m_ScrollState, 0, sizeof(m_ScrollState));
+            memset(m_ScrollEpoch, 0, sizeof(m_ScrollEpoch));
+            memset(m_WrapOffset, 0, sizeof(m_WrapOffset));
+        }
+
+        void UpdateMatrices(
+            const Camera& ViewCamera,    // Camera whose view frustum will be partitioned
+            Vector3 LightDirection,        // Direction parallel to light, in direction of travel
+            uint32_t NumCascades,        // Number of frustum partitions in [1, kMaxCascades]
+            float SplitLambda,            // Split distribution:  0 is uniform, 1 is logarithmic
+            float ShadowDistance,        // View distance past which nothing is shadowed
+            float ShadowDepth,            // Extent toward the light so that off-screen casters are captured
+            uint32_t BufferWidth,        // Shadow buffer slice width
+            uint32_t BufferHeight,        // Shadow buffer slice height--usually same as width
+            uint32_t BufferPrecision,    // Bit depth of shadow buffer--usually 16 or 24
+            uint32_t FirstScrollingCascade = kMaxCascades    // Cascades from this one on scroll
+            );
+
+        uint32_t GetNumCascades() const { return m_NumCascades; }
+
+        const ShadowCamera& GetCascade( uint32_t Index ) const { return m_Cascades[Index]; }
+
+        // View space distance at which the cascade ends and the next one begins
+        float GetSplitDistance( uint32_t Index ) const { return m_SplitDistances[Index]; }
+
+        bool IsScrolling( uint32_t Index ) const { return Index >= m_FirstScrollingCascade; }
+
+        uint32_t GetBufferWidth() const { return m_BufferWidth; }
+        uint32_t GetBufferHeight() const { return m_BufferHeight; }
+
+        // Texel (x, y) of a scrolling cascade's view is stored at ((x + WrapX) % Width, (y + WrapY) % Height).
+        // Both are zero for cascades that do not scroll.
+        uint32_t GetWrapOffsetX( uint32_t Index ) const { return m_WrapOffset[Index][0]; }
+        uint32_t GetWrapOffsetY( uint32_t Index ) const { return m_WrapOffset[Index][1]; }
+
+        // Changes whenever a scrolling cascade cannot be scrolled from its previous contents--its size, depth
+        // range, orientation or buffer changed--and so must be redrawn in full
+        uint32_t GetScrollEpoch( uint32_t Index ) const { return m_ScrollEpoch[Index]; }
+
+    private:
+
+        // Everything but the texel center that must match for a cascade's contents to be reused
+        struct ScrollState
+        {
+            float LightDirection[3];
+            float Radius;
+            int32_t DepthStep;
+            uint32_t BufferWidth;
+            uint32_t BufferHeight;
+            uint32_t BufferPrecision;
+        };
+
+        ShadowCamera m_Cascades[kMaxCascades];
+        float m_SplitDistances[kMaxCascades];
+        uint32_t m_NumCascades;
+        uint32_t m_FirstScrollingCascade;
+        uint32_t m_BufferWidth;
+        uint32_t m_BufferHeight;
+        ScrollState m_ScrollState[kMaxCascades];
+        uint32_t m_ScrollEpoch[kMaxCascades];
+        uint32_t m_WrapOffset[kMaxCascades][2];
+    };
+
+}
@@ -16,6 +16,7 @@
 #include "GraphicsCore.h"
 #include "CommandContext.h"
 #include "EsramAllocator.h"
+#include "SinglePassDownsample.h"
 
 using namespace Graphics;
 
@@ -104,11 +105,17 @@ void ColorBuffer::CreateFromSwapChain( const std::wstring& Name, ID3D12Resource*
 {
     AssociateWithResource(Graphics::g_Device, Name, BaseResource, D3D12_RESOURCE_STATE_PRESENT);
 
-    //m_UAVHandle[0] = Graphics::AllocateDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
-    //Graphics::g_Device->CreateUnorderedAccessView(m_pResource.Get(), nullptr, nullptr, m_UAVHandle[0]);
-
-    m_RTVHandle = Graphics::AllocateDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
+    // The swap chain's buffers are created again on every resize, and keep their views
+    if (m_RTVHandle.ptr == D3D12_GPU_VIRTUAL_ADDRESS_UNKNOWN)
+        m_RTVHandle = Graphics::AllocateDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
     Graphics::g_Device->CreateRenderTargetView(m_pResource.Get(), nullptr, m_RTVHandle);
+
+    if (BaseResource->GetDesc().Flags & D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS)
+    {
+        if (m_UAVHandle[0].ptr == D3D12_GPU_VIRTUAL_ADDRESS_UNKNOWN)
+            m_UAVHandle[0] = Graphics::AllocateDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+        Graphics::g_Device->CreateUnorderedAccessView(m_pResource.Get(), nullptr, nullptr, m_UAVHandle[0]);
+    }
 }
 
 void ColorBuffer::Create(const std::wstring& Name, uint32_t Width, uint32_t Height, uint32_t NumMips,
@@ -133,9 +140,40 @@ void ColorBuffer::Create(const std::wstring& Name, uint32_t Width, uint32_t Heig
 }
 
 void ColorBuffer::Create(const std::wstring& Name, uint32_t Width, uint32_t Height, uint32_t NumMips,
-    DXGI_FORMAT Format, EsramAllocator&)
+    DXGI_FORMAT Format, EsramAllocator& Allocator)
 {
     Create(Name, Width, Height, NumMips, Format);
+    Allocator.Place(m_pResource.Get(), Name);
+}
+
+void ColorBuffer::CreatePlaced(const std::wstring& Name, uint32_t Width, uint32_t Height, uint32_t ArrayCount,
+    DXGI_FORMAT Format, ID3D12Heap* Heap, uint64_t HeapOffset)
+{
+    D3D12_RESOURCE_FLAGS Flags = CombineResourceFlags();
+    D3D12_RESOURCE_DESC ResourceDesc = DescribeTex2D(Width, Height, ArrayCount, 1, Format, Flags);
+
+    ResourceDesc.SampleDesc.Count = m_FragmentCount;
+    ResourceDesc.SampleDesc.Quality = 0;
+
+    D3D12_CLEAR_VALUE ClearValue = {};
+    ClearValue.Format = Format;
+    ClearValue.Color[0] = m_ClearColor.R();
+    ClearValue.Color[1] = m_ClearColor.G();
+    ClearValue.Color[2] = m_ClearColor.B();
+    ClearValue.Color[3] = m_ClearColor.A();
+
+    CreatePlacedTextureResource(Graphics::g_Device, Name, ResourceDesc, ClearValue, Heap, HeapOffset);
+    CreateDerivedViews(Graphics::g_Device, Format, ArrayCount, 1);
+}
+
+D3D12_RESOURCE_ALLOCATION_INFO ColorBuffer::GetPlacedAllocationInfo(uint32_t Width, uint32_t Height, uint32_t ArrayCount,
+    DXGI_FORMAT Format)
+{
+    D3D12_RESOURCE_DESC ResourceDesc = DescribeTex2D(Width, Height, ArrayCount, 1, Format, CombineResourceFlags());
+    ResourceDesc.SampleDesc.Count = m_FragmentCount;
+    ResourceDesc.SampleDesc.Quality = 0;
+
+    return Graphics::g_Device->GetResourceAllocationInfo(1, 1, &ResourceDesc);
 }
 
 void ColorBuffer::CreateArray( const std::wstring& Name, uint32_t Width, uint32_t Height, uint32_t ArrayCount,
@@ -156,9 +194,57 @@ void ColorBuffer::CreateArray( const std::wstring& Name, uint32_t Width, uint32_
 }
 
 void ColorBuffer::CreateArray( const std::wstring& Name, uint32_t Width, uint32_t Height, uint32_t ArrayCount,
-    DXGI_FORMAT Format, EsramAllocator& )
+    DXGI_FORMAT Format, EsramAllocator& Allocator )
 {
     CreateArray(Name, Width, Height, ArrayCount, Format);
+    Allocator.Place(m_pResource.Get(), Name);
+}
+
+void ColorBuffer::CreateVolume( const std::wstring& Name, uint32_t Width, uint32_t Height, uint32_t Depth,
+    DXGI_FORMAT Format )
+{
+    D3D12_RESOURCE_DESC ResourceDesc = DescribeTex2D(Width, Height, Depth, 1, Format, CombineResourceFlags());
+    ResourceDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE3D;
+
+    D3D12_CLEAR_VALUE ClearValue = {};
+    ClearValue.Format = Format;
+    ClearValue.Color[0] = m_ClearColor.R();
+    ClearValue.Color[1] = m_ClearColor.G();
+    ClearValue.Color[2] = m_ClearColor.B();
+    ClearValue.Color[3] = m_ClearColor.A();
+
+    CreateTextureResource(Graphics::g_Device, Name, ResourceDesc, ClearValue);
+
+    m_NumMipMaps = 0;
+
+    D3D12_RENDER_TARGET_VIEW_DESC RTVDesc = {};
+    RTVDesc.Format = Format;
+    RTVDesc.ViewDimension = D3D12_RTV_DIMENSION_TEXTURE3D;
+    RTVDesc.Texture3D.WSize = (UINT)-1;
+
+    D3D12_UNORDERED_ACCESS_VIEW_DESC UAVDesc = {};
+    UAVDesc.Format = GetUAVFormat(Format);
+    UAVDesc.ViewDimension = D3D12_UAV_DIMENSION_TEXTURE3D;
+    UAVDesc.Texture3D.WSize = (UINT)-1;
+
+    D3D12_SHADER_RESOURCE_VIEW_DESC SRVDesc = {};
+    SRVDesc.Format = Format;
+    SRVDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+    SRVDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE3D;
+    SRVDesc.Texture3D.MipLevels = 1;
+
+    if (m_SRVHandle.ptr == D3D12_GPU_VIRTUAL_ADDRESS_UNKNOWN)
+    {
+        m_RTVHandle = Graphics::AllocateDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
+        m_SRVHandle = Graphics::AllocateDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+    }
+    if (m_UAVHandle[0].ptr == D3D12_GPU_VIRTUAL_ADDRESS_UNKNOWN)
+        m_UAVHandle[0] = Graphics::AllocateDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+
+    ID3D12Resource* Resource = m_pResource.Get();
+    Graphics::g_Device->CreateRenderTargetView(Resource, &RTVDesc, m_RTVHandle);
+    Graphics::g_Device->CreateShaderResourceView(Resource, &SRVDesc, m_SRVHandle);
+    Graphics::g_Device->CreateUnorderedAccessView(Resource, nullptr, &UAVDesc, m_UAVHandle[0]);
 }
 
 void ColorBuffer::GenerateMipMaps(CommandContext& BaseContext)
@@ -168,6 +254,18 @@ void ColorBuffer::GenerateMipMaps(CommandContext& BaseContext)
 
     ComputeContext& Context = BaseContext.GetComputeContext();
 
+    // A square power of two halves exactly down to 1x1, so the whole chain can come from a single dispatch
+    if (m_Width == m_Height && (m_Width & (m_Width - 1)) == 0 && m_Width <= SinglePassDownsample::kMaxSourceSize)
+    {
+        Context.TransitionResource(*this, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+        SinglePassDownsample::Downsample(Context,
+            m_Format == DXGI_FORMAT_R8G8B8A8_UNORM_SRGB ? SinglePassDownsample::kAverageGamma : SinglePassDownsample::kAverage,
+            m_SRVHandle, m_Width, m_Height, m_UAVHandle + 1, m_NumMipMaps);
+        Context.TransitionResource(*this, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE |
+            D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        return;
+    }
+
     Context.SetRootSignature(Graphics::g_GenerateMipsRS);
 
     Context.TransitionResource(*this, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
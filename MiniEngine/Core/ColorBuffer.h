@@ -29,7 +29,7 @@ public:
         std::memset(m_UAVHandle, 0xFF, sizeof(m_UAVHandle));
     }
 
-    // Create a color buffer from a swap chain buffer.  Unordered access is restricted.
+    // Create a color buffer from a swap chain buffer.  It has a UAV only when the swap chain allows unordered access.
     void CreateFromSwapChain( const std::wstring& Name, ID3D12Resource* BaseResource );
 
     // Create a color buffer.  If an address is supplied, memory will not be allocated.
@@ -54,10 +54,23 @@ public:
     void CreateArray(const std::wstring& Name, uint32_t Width, uint32_t Height, uint32_t ArrayCount,
         DXGI_FORMAT Format, EsramAllocator& Allocator);
 
+    // Create a volume texture of Depth slices, viewed as a Texture3D and RWTexture3D.  GetDepth() returns
+    // the slice count.
+    void CreateVolume(const std::wstring& Name, uint32_t Width, uint32_t Height, uint32_t Depth, DXGI_FORMAT Format);
+
+    // Create a color buffer at an offset in a heap that other resources may share.  See FrameGraph.
+    void CreatePlaced(const std::wstring& Name, uint32_t Width, uint32_t Height, uint32_t ArrayCount,
+        DXGI_FORMAT Format, ID3D12Heap* Heap, uint64_t HeapOffset);
+
+    // The size and alignment of the heap memory that CreatePlaced() needs
+    D3D12_RESOURCE_ALLOCATION_INFO GetPlacedAllocationInfo(uint32_t Width, uint32_t Height, uint32_t ArrayCount,
+        DXGI_FORMAT Format);
+
     // Get pre-created CPU-visible descriptor handles
     const D3D12_CPU_DESCRIPTOR_HANDLE& GetSRV(void) const { return m_SRVHandle; }
     const D3D12_CPU_DESCRIPTOR_HANDLE& GetRTV(void) const { return m_RTVHandle; }
     const D3D12_CPU_DESCRIPTOR_HANDLE& GetUAV(void) const { return m_UAVHandle[0]; }
+    const D3D12_CPU_DESCRIPTOR_HANDLE& GetMipUAV(uint32_t Mip) const { ASSERT(Mip <= m_NumMipMaps); return m_UAVHandle[Mip]; }
 
     void SetClearColor( Color ClearColor ) { m_ClearColor = ClearColor; }
 
@@ -103,7 +116,7 @@ protected:
     Color m_ClearColor;
     D3D12_CPU_DESCRIPTOR_HANDLE m_SRVHandle;
     D3D12_CPU_DESCRIPTOR_HANDLE m_RTVHandle;
-    D3D12_CPU_DESCRIPTOR_HANDLE m_UAVHandle[12];
+    D3D12_CPU_DESCRIPTOR_HANDLE m_UAVHandle[D3D12_REQ_MIP_LEVELS];
     uint32_t m_NumMipMaps; // number of texture sublevels
     uint32_t m_FragmentCount;
     uint32_t m_SampleCount;
@@ -13,10 +13,35 @@
 
 #include "pch.h"
 #include "CommandAllocatorPool.h"
+#include "EngineProfiling.h"
+
+using namespace std;
+
+namespace
+{
+    // The ready allocators a thread took from each pool and hasn't used yet
+    const uint32_t kMaxCachedAllocators = 2;
+
+    struct ThreadAllocatorCache
+    {
+        uint32_t Generation;
+        uint32_t NumAllocators;
+        ID3D12CommandAllocator* Allocators[kMaxCachedAllocators];
+    };
+
+    // By command list type, which has one pool per queue
+    thread_local ThreadAllocatorCache t_AllocatorCache[4][kNumCommandAllocatorSizeClasses];
+}
+
+atomic<uint32_t> CommandAllocatorPool::sm_NumAllocators[kNumCommandAllocatorSizeClasses];
+atomic<uint32_t> CommandAllocatorPool::sm_NumCreated(0);
+atomic<uint32_t> CommandAllocatorPool::sm_NumPromoted(0);
 
 CommandAllocatorPool::CommandAllocatorPool(D3D12_COMMAND_LIST_TYPE Type) :
     m_cCommandListType(Type),
-    m_Device(nullptr)
+    m_Device(nullptr),
+    m_RetiredAllocators(nullptr),
+    m_Generation(1)
 {
 }
 
@@ -32,47 +57,132 @@ void CommandAllocatorPool::Create(ID3D12Device * pDevice)
 
 void CommandAllocatorPool::Shutdown()
 {
+    lock_guard<mutex> LockGuard(m_AllocatorMutex);
+
+    ReclaimRetiredAllocators();
+
     for (size_t i = 0; i < m_AllocatorPool.size(); ++i)
         m_AllocatorPool[i]->Release();
 
+    for (uint32_t i = 0; i < kNumCommandAllocatorSizeClasses; ++i)
+        m_ReadyAllocators[i] = {};
+
     m_AllocatorPool.clear();
+    m_Generation.fetch_add(1, memory_order_relaxed);
 }
 
-ID3D12CommandAllocator * CommandAllocatorPool::RequestAllocator(uint64_t CompletedFenceValue)
+void CommandAllocatorPool::ReclaimRetiredAllocators( void )
 {
-    std::lock_guard<std::mutex> LockGuard(m_AllocatorMutex);
+    RetiredAllocator* Oldest = nullptr;
+    RetiredAllocator* Retired = m_RetiredAllocators.exchange(nullptr, memory_order_acquire);
+    while (Retired != nullptr)
+    {
+        RetiredAllocator* Next = Retired->Next;
+        Retired->Next = Oldest;
+        Oldest = Retired;
+        Retired = Next;
+    }
+
+    while (Oldest != nullptr)
+    {
+        m_ReadyAllocators[Oldest->SizeClass].push(make_pair(Oldest->FenceValue, Oldest->Allocator));
+
+        RetiredAllocator* Next = Oldest->Next;
+        delete Oldest;
+        Oldest = Next;
+    }
+}
+
+ID3D12CommandAllocator * CommandAllocatorPool::RequestAllocator(uint64_t CompletedFenceValue, CommandAllocatorSizeClass SizeClass)
+{
+    ThreadAllocatorCache& Cache = t_AllocatorCache[m_cCommandListType][SizeClass];
+    const uint32_t Generation = m_Generation.load(memory_order_relaxed);
+    if (Cache.Generation != Generation)
+    {
+        Cache.Generation = Generation;
+        Cache.NumAllocators = 0;
+    }
 
     ID3D12CommandAllocator* pAllocator = nullptr;
 
-    if (!m_ReadyAllocators.empty())
+    if (Cache.NumAllocators > 0)
     {
-        std::pair<uint64_t, ID3D12CommandAllocator*>& AllocatorPair = m_ReadyAllocators.front();
-
-        if (AllocatorPair.first <= CompletedFenceValue)
-        {
-            pAllocator = AllocatorPair.second;
-            ASSERT_SUCCEEDED(pAllocator->Reset());
-            m_ReadyAllocators.pop();
-        }
+        pAllocator = Cache.Allocators[--Cache.NumAllocators];
+        ASSERT_SUCCEEDED(pAllocator->Reset());
+        return pAllocator;
     }
 
-    // If no allocator's were ready to be reused, create a new one
-    if (pAllocator == nullptr)
+    lock_guard<mutex> LockGuard(m_AllocatorMutex);
+
+    ReclaimRetiredAllocators();
+
+    // Take the ready allocators of the class, up to the cache size
+    auto& ReadyAllocators = m_ReadyAllocators[SizeClass];
+    while (!ReadyAllocators.empty() && ReadyAllocators.front().first <= CompletedFenceValue)
     {
-        ASSERT_SUCCEEDED(m_Device->CreateCommandAllocator(m_cCommandListType, MY_IID_PPV_ARGS(&pAllocator)));
-        wchar_t AllocatorName[32];
-        swprintf(AllocatorName, 32, L"CommandAllocator %zu", m_AllocatorPool.size());
-        pAllocator->SetName(AllocatorName);
-        m_AllocatorPool.push_back(pAllocator);
+        if (pAllocator == nullptr)
+            pAllocator = ReadyAllocators.front().second;
+        else if (Cache.NumAllocators < kMaxCachedAllocators)
+            Cache.Allocators[Cache.NumAllocators++] = ReadyAllocators.front().second;
+        else
+            break;
+        ReadyAllocators.pop();
     }
 
+    // A large list may grow a small allocator rather than create one, but a small list never takes a large one
+    auto& SmallAllocators = m_ReadyAllocators[kSmallCommandAllocator];
+    if (pAllocator == nullptr && SizeClass == kLargeCommandAllocator &&
+        !SmallAllocators.empty() && SmallAllocators.front().first <= CompletedFenceValue)
+    {
+        pAllocator = SmallAllocators.front().second;
+        SmallAllocators.pop();
+        sm_NumAllocators[kSmallCommandAllocator].fetch_sub(1, memory_order_relaxed);
+        sm_NumAllocators[kLargeCommandAllocator].fetch_add(1, memory_order_relaxed);
+        sm_NumPromoted.fetch_add(1, memory_order_relaxed);
+    }
+
+    if (pAllocator != nullptr)
+    {
+        ASSERT_SUCCEEDED(pAllocator->Reset());
+        return pAllocator;
+    }
+
+    // If no allocator's were ready to be reused, create a new one
+    ASSERT_SUCCEEDED(m_Device->CreateCommandAllocator(m_cCommandListType, MY_IID_PPV_ARGS(&pAllocator)));
+    wchar_t AllocatorName[32];
+    swprintf(AllocatorName, 32, L"CommandAllocator %zu", m_AllocatorPool.size());
+    pAllocator->SetName(AllocatorName);
+    m_AllocatorPool.push_back(pAllocator);
+
+    sm_NumAllocators[SizeClass].fetch_add(1, memory_order_relaxed);
+    sm_NumCreated.fetch_add(1, memory_order_relaxed);
+
     return pAllocator;
 }
 
-void CommandAllocatorPool::DiscardAllocator(uint64_t FenceValue, ID3D12CommandAllocator * Allocator)
+void CommandAllocatorPool::DiscardAllocator(uint64_t FenceValue, ID3D12CommandAllocator * Allocator,
+    CommandAllocatorSizeClass SizeClass, uint32_t NumCommands)
 {
-    std::lock_guard<std::mutex> LockGuard(m_AllocatorMutex);
+    // The allocator keeps the memory of the largest list recorded with it
+    if (SizeClass == kSmallCommandAllocator && GetSizeClass(NumCommands) == kLargeCommandAllocator)
+    {
+        SizeClass = kLargeCommandAllocator;
+        sm_NumAllocators[kSmallCommandAllocator].fetch_sub(1, memory_order_relaxed);
+        sm_NumAllocators[kLargeCommandAllocator].fetch_add(1, memory_order_relaxed);
+        sm_NumPromoted.fetch_add(1, memory_order_relaxed);
+    }
 
     // That fence value indicates we are free to reset the allocator
-    m_ReadyAllocators.push(std::make_pair(FenceValue, Allocator));
+    RetiredAllocator* Retired = new RetiredAllocator{ FenceValue, Allocator, SizeClass, nullptr };
+    Retired->Next = m_RetiredAllocators.load(memory_order_relaxed);
+    while (!m_RetiredAllocators.compare_exchange_weak(Retired->Next, Retired, memory_order_release, memory_order_relaxed))
+        ;
+}
+
+void CommandAllocatorPool::ReportStatistics( void )
+{
+    EngineProfiling::SetCounter("Small Command Allocators", sm_NumAllocators[kSmallCommandAllocator].load(memory_order_relaxed));
+    EngineProfiling::SetCounter("Large Command Allocators", sm_NumAllocators[kLargeCommandAllocator].load(memory_order_relaxed));
+    EngineProfiling::SetCounter("Command Allocators Created", sm_NumCreated.exchange(0));
+    EngineProfiling::SetCounter("Command Allocators Promoted", sm_NumPromoted.exchange(0));
 }
@@ -16,8 +16,18 @@
 #include <vector>
 #include <queue>
 #include <mutex>
+#include <atomic>
 #include <stdint.h>
 
+// An allocator keeps the memory of the largest list recorded with it, so allocators are reused by size class:
+// small post-effect lists don't pin the memory of a scene pass, and scene passes don't regrow small allocators.
+enum CommandAllocatorSizeClass
+{
+    kSmallCommandAllocator,
+    kLargeCommandAllocator,
+    kNumCommandAllocatorSizeClasses
+};
+
 class CommandAllocatorPool
 {
 public:
@@ -27,16 +37,52 @@ public:
     void Create(ID3D12Device* pDevice);
     void Shutdown();
 
-    ID3D12CommandAllocator* RequestAllocator(uint64_t CompletedFenceValue);
-    void DiscardAllocator(uint64_t FenceValue, ID3D12CommandAllocator* Allocator);
+    // Lists with this many draws and dispatches use large allocators
+    static const uint32_t kLargeListCommands = 256;
+
+    static CommandAllocatorSizeClass GetSizeClass(uint32_t NumCommands)
+    {
+        return NumCommands >= kLargeListCommands ? kLargeCommandAllocator : kSmallCommandAllocator;
+    }
+
+    // Each thread keeps a few allocators whose fences have passed, so most requests take no lock.  Discarding
+    // never locks; retired allocators are collected by the next request that misses its thread's cache.  An
+    // allocator is discarded with the class it was requested with and the number of commands recorded with it,
+    // and is promoted to large when that was a large list.
+    ID3D12CommandAllocator* RequestAllocator(uint64_t CompletedFenceValue, CommandAllocatorSizeClass SizeClass);
+    void DiscardAllocator(uint64_t FenceValue, ID3D12CommandAllocator* Allocator, CommandAllocatorSizeClass SizeClass,
+        uint32_t NumCommands);
 
     inline size_t Size() { return m_AllocatorPool.size(); }
 
+    // Lists the allocators of each size class, and those created and promoted to large since the last call,
+    // with the profiler's counters
+    static void ReportStatistics(void);
+
 private:
+    struct RetiredAllocator
+    {
+        uint64_t FenceValue;
+        ID3D12CommandAllocator* Allocator;
+        CommandAllocatorSizeClass SizeClass;
+        RetiredAllocator* Next;
+    };
+
+    // Moves the retired allocators to the ready queues in the order they were retired.  Requires the mutex.
+    void ReclaimRetiredAllocators(void);
+
     const D3D12_COMMAND_LIST_TYPE m_cCommandListType;
 
     ID3D12Device* m_Device;
     std::vector<ID3D12CommandAllocator*> m_AllocatorPool;
-    std::queue<std::pair<uint64_t, ID3D12CommandAllocator*>> m_ReadyAllocators;
+    std::queue<std::pair<uint64_t, ID3D12CommandAllocator*>> m_ReadyAllocators[kNumCommandAllocatorSizeClasses];
+    std::atomic<RetiredAllocator*> m_RetiredAllocators;
     std::mutex m_AllocatorMutex;
+
+    // Bumped on shutdown so that threads drop the allocators they cached
+    std::atomic<uint32_t> m_Generation;
+
+    static std::atomic<uint32_t> sm_NumAllocators[kNumCommandAllocatorSizeClasses];
+    static std::atomic<uint32_t> sm_NumCreated;
+    static std::atomic<uint32_t> sm_NumPromoted;
 };
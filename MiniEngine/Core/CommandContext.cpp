@@ -18,6 +18,10 @@
 #include "GraphicsCore.h"
 #include "DescriptorHeap.h"
 #include "EngineProfiling.h"
+#include "AssetIO.h"
+#include "FrameArena.h"
+#include <atomic>
+#include <unordered_map>
 
 #ifndef RELEASE
     #include <d3d11_2.h>
@@ -26,6 +30,48 @@
 
 using namespace Graphics;
 
+namespace
+{
+    BoolVar s_MergeBarriers("Graphics/Merge Resource Barriers", true);
+
+    std::atomic<uint32_t> s_NumBarriersIssued(0);
+    std::atomic<uint32_t> s_NumBarriersMerged(0);
+
+    // GENERIC_READ is every one of these, and DEPTH_READ can be combined with them too
+    const D3D12_RESOURCE_STATES kReadOnlyStates = D3D12_RESOURCE_STATE_GENERIC_READ | D3D12_RESOURCE_STATE_DEPTH_READ;
+
+    // The allocator size class the last list recorded under each context name needed
+    std::mutex s_SizeClassMutex;
+    std::unordered_map<std::wstring, CommandAllocatorSizeClass> s_SizeClassByID;
+
+    CommandAllocatorSizeClass PredictSizeClass( const std::wstring& ID, CommandAllocatorSizeClass SizeClass )
+    {
+        if (ID.length() == 0 || SizeClass == kLargeCommandAllocator)
+            return SizeClass;
+
+        std::lock_guard<std::mutex> LockGuard(s_SizeClassMutex);
+        auto iter = s_SizeClassByID.find(ID);
+        return iter == s_SizeClassByID.end() ? SizeClass : iter->second;
+    }
+
+    // Set while resources initialized on the copy queue have not been waited for by the other queues
+    std::atomic<bool> s_CopyInitializationPending(false);
+
+    // Submits the staged initializations and makes the graphics and compute queues wait for them once, before
+    // the first command list that could read them
+    void WaitForCopyInitialization( void )
+    {
+        if (s_CopyInitializationPending.exchange(false))
+            AssetIO::Flush();
+    }
+
+    // Only whole resources in the state they were created in are initialized on the copy queue, because other
+    // queues may still be using a resource that has been written before
+    bool CanInitializeOnCopyQueue( D3D12_RESOURCE_STATES State )
+    {
+        return AssetIO::IsRunning() && (State == D3D12_RESOURCE_STATE_COMMON || State == D3D12_RESOURCE_STATE_COPY_DEST);
+    }
+}
 
 void ContextManager::DestroyAllContexts(void)
 {
@@ -33,7 +79,7 @@ void ContextManager::DestroyAllContexts(void)
         sm_ContextPool[i].clear();
 }
 
-CommandContext* ContextManager::AllocateContext(D3D12_COMMAND_LIST_TYPE Type)
+CommandContext* ContextManager::AllocateContext(D3D12_COMMAND_LIST_TYPE Type, CommandAllocatorSizeClass SizeClass)
 {
     std::lock_guard<std::mutex> LockGuard(sm_ContextAllocationMutex);
 
@@ -44,12 +90,14 @@ CommandContext* ContextManager::AllocateContext(D3D12_COMMAND_LIST_TYPE Type)
     {
         ret = new CommandContext(Type);
         sm_ContextPool[Type].emplace_back(ret);
+        ret->m_AllocatorSizeClass = SizeClass;
         ret->Initialize();
     }
     else
     {
         ret = AvailableContexts.front();
         AvailableContexts.pop();
+        ret->m_AllocatorSizeClass = SizeClass;
         ret->Reset();
     }
     ASSERT(ret != nullptr);
@@ -73,9 +121,15 @@ void CommandContext::DestroyAllContexts(void)
     g_ContextManager.DestroyAllContexts();
 }
 
-CommandContext& CommandContext::Begin( const std::wstring ID )
+void CommandContext::ReportStatistics(void)
 {
-    CommandContext* NewContext = g_ContextManager.AllocateContext(D3D12_COMMAND_LIST_TYPE_DIRECT);
+    EngineProfiling::SetCounter("Resource Barriers", s_NumBarriersIssued.exchange(0));
+    EngineProfiling::SetCounter("Resource Barriers Merged", s_NumBarriersMerged.exchange(0));
+}
+
+CommandContext& CommandContext::Begin( const std::wstring ID, CommandAllocatorSizeClass SizeClass )
+{
+    CommandContext* NewContext = g_ContextManager.AllocateContext(D3D12_COMMAND_LIST_TYPE_DIRECT, PredictSizeClass(ID, SizeClass));
     NewContext->SetID(ID);
     if (ID.length() > 0)
         EngineProfiling::BeginBlock(ID, NewContext);
@@ -85,7 +139,8 @@ CommandContext& CommandContext::Begin( const std::wstring ID )
 ComputeContext& ComputeContext::Begin(const std::wstring& ID, bool Async)
 {
     ComputeContext& NewContext = g_ContextManager.AllocateContext(
-        Async ? D3D12_COMMAND_LIST_TYPE_COMPUTE : D3D12_COMMAND_LIST_TYPE_DIRECT)->GetComputeContext();
+        Async ? D3D12_COMMAND_LIST_TYPE_COMPUTE : D3D12_COMMAND_LIST_TYPE_DIRECT,
+        PredictSizeClass(ID, kSmallCommandAllocator))->GetComputeContext();
     NewContext.SetID(ID);
     if (ID.length() > 0)
         EngineProfiling::BeginBlock(ID, &NewContext);
@@ -98,11 +153,18 @@ uint64_t CommandContext::Flush(bool WaitForCompletion)
 
     ASSERT(m_CurrentAllocator != nullptr);
 
-    uint64_t FenceValue = g_CommandManager.GetQueue(m_Type).ExecuteCommandList(m_CommandList);
+    if (m_ResidencySet != nullptr)
+        ASSERT_SUCCEEDED(m_ResidencySet->Close());
+
+    WaitForCopyInitialization();
+    uint64_t FenceValue = g_CommandManager.GetQueue(m_Type).ExecuteCommandList(m_CommandList, m_ResidencySet);
 
     if (WaitForCompletion)
         g_CommandManager.WaitForFence(FenceValue);
 
+    if (m_ResidencySet != nullptr)
+        ASSERT_SUCCEEDED(m_ResidencySet->Open());
+
     //
     // Reset the command list and restore previous state
     //
@@ -138,14 +200,12 @@ uint64_t CommandContext::Finish( bool WaitForCompletion )
 
     CommandQueue& Queue = g_CommandManager.GetQueue(m_Type);
 
-    uint64_t FenceValue = Queue.ExecuteCommandList(m_CommandList);
-    Queue.DiscardAllocator(FenceValue, m_CurrentAllocator);
-    m_CurrentAllocator = nullptr;
+    if (m_ResidencySet != nullptr)
+        ASSERT_SUCCEEDED(m_ResidencySet->Close());
 
-    m_CpuLinearAllocator.CleanupUsedPages(FenceValue);
-    m_GpuLinearAllocator.CleanupUsedPages(FenceValue);
-    m_DynamicViewDescriptorHeap.CleanupUsedHeaps(FenceValue);
-    m_DynamicSamplerDescriptorHeap.CleanupUsedHeaps(FenceValue);
+    WaitForCopyInitialization();
+    uint64_t FenceValue = Queue.ExecuteCommandList(m_CommandList, m_ResidencySet);
+    RetireAllocations(FenceValue);
 
     if (WaitForCompletion)
         g_CommandManager.WaitForFence(FenceValue);
@@ -155,6 +215,69 @@ uint64_t CommandContext::Finish( bool WaitForCompletion )
     return FenceValue;
 }
 
+uint64_t CommandContext::FinishParallel( CommandContext* const* Contexts, uint32_t Count, bool WaitForCompletion )
+{
+    ASSERT(Count > 0);
+
+    const D3D12_COMMAND_LIST_TYPE Type = Contexts[0]->m_Type;
+    ASSERT(Type == D3D12_COMMAND_LIST_TYPE_DIRECT || Type == D3D12_COMMAND_LIST_TYPE_COMPUTE);
+
+    ID3D12CommandList** Lists = FrameArena::AllocateArray<ID3D12CommandList*>(Count);
+    D3DX12Residency::ResidencySet** ResidencySets = FrameArena::AllocateArray<D3DX12Residency::ResidencySet*>(Count);
+    for (uint32_t i = 0; i < Count; ++i)
+    {
+        CommandContext* Context = Contexts[i];
+        ASSERT(Context->m_Type == Type, "Contexts submitted together must share a queue");
+        ASSERT(Context->m_ID.length() == 0, "Profiled contexts cannot be recorded in parallel");
+        ASSERT(Context->m_CurrentAllocator != nullptr);
+
+        Context->FlushResourceBarriers();
+        Lists[i] = Context->m_CommandList;
+
+        if (Context->m_ResidencySet != nullptr)
+            ASSERT_SUCCEEDED(Context->m_ResidencySet->Close());
+        ResidencySets[i] = Context->m_ResidencySet;
+    }
+
+    WaitForCopyInitialization();
+    uint64_t FenceValue = g_CommandManager.GetQueue(Type).ExecuteCommandLists(Count, Lists, ResidencySets);
+
+    for (uint32_t i = 0; i < Count; ++i)
+        Contexts[i]->RetireAllocations(FenceValue);
+
+    if (WaitForCompletion)
+        g_CommandManager.WaitForFence(FenceValue);
+
+    for (uint32_t i = 0; i < Count; ++i)
+        g_ContextManager.FreeContext(Contexts[i]);
+
+    return FenceValue;
+}
+
+void CommandContext::RetireAllocations( uint64_t FenceValue )
+{
+    if (m_ID.length() > 0)
+    {
+        std::lock_guard<std::mutex> LockGuard(s_SizeClassMutex);
+        s_SizeClassByID[m_ID] = CommandAllocatorPool::GetSizeClass(m_NumCommands);
+    }
+
+    g_CommandManager.GetQueue(m_Type).DiscardAllocator(FenceValue, m_CurrentAllocator, m_AllocatorSizeClass, m_NumCommands);
+    m_CurrentAllocator = nullptr;
+    m_NumCommands = 0;
+
+    m_CpuLinearAllocator.CleanupUsedPages(FenceValue);
+    m_GpuLinearAllocator.CleanupUsedPages(FenceValue);
+    m_UploadRing.Retire(FenceValue);
+    m_DynamicViewDescriptorHeap.CleanupUsedHeaps(FenceValue);
+    m_DynamicSamplerDescriptorHeap.CleanupUsedHeaps(FenceValue);
+
+    s_NumBarriersIssued.fetch_add(m_NumBarriersIssued, std::memory_order_relaxed);
+    s_NumBarriersMerged.fetch_add(m_NumBarriersMerged, std::memory_order_relaxed);
+    m_NumBarriersIssued = 0;
+    m_NumBarriersMerged = 0;
+}
+
 CommandContext::CommandContext(D3D12_COMMAND_LIST_TYPE Type) :
     m_Type(Type),
     m_DynamicViewDescriptorHeap(*this, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV),
@@ -164,7 +287,10 @@ CommandContext::CommandContext(D3D12_COMMAND_LIST_TYPE Type) :
 {
     m_OwningManager = nullptr;
     m_CommandList = nullptr;
+    m_CommandList5 = nullptr;
     m_CurrentAllocator = nullptr;
+    m_AllocatorSizeClass = kSmallCommandAllocator;
+    m_NumCommands = 0;
     ZeroMemory(m_CurrentDescriptorHeaps, sizeof(m_CurrentDescriptorHeaps));
 
     m_CurGraphicsRootSignature = nullptr;
@@ -172,17 +298,33 @@ CommandContext::CommandContext(D3D12_COMMAND_LIST_TYPE Type) :
     m_CurComputeRootSignature = nullptr;
     m_CurComputePipelineState = nullptr;
     m_NumBarriersToFlush = 0;
+    m_NumBarriersIssued = 0;
+    m_NumBarriersMerged = 0;
+    m_ResidencySet = nullptr;
 }
 
 CommandContext::~CommandContext( void )
 {
+    if (m_ResidencySet != nullptr)
+        g_CommandManager.GetResidencyManager()->DestroyResidencySet(m_ResidencySet);
+    if (m_CommandList5 != nullptr)
+        m_CommandList5->Release();
     if (m_CommandList != nullptr)
         m_CommandList->Release();
 }
 
 void CommandContext::Initialize(void)
 {
-    g_CommandManager.CreateNewCommandList(m_Type, &m_CommandList, &m_CurrentAllocator);
+    g_CommandManager.CreateNewCommandList(m_Type, &m_CommandList, &m_CurrentAllocator, m_AllocatorSizeClass);
+    if (FAILED(m_CommandList->QueryInterface(MY_IID_PPV_ARGS(&m_CommandList5))))
+        m_CommandList5 = nullptr;
+
+    D3DX12Residency::ResidencyManager* ResidencyManager = g_CommandManager.GetResidencyManager();
+    if (ResidencyManager != nullptr)
+    {
+        m_ResidencySet = ResidencyManager->CreateResidencySet();
+        ASSERT_SUCCEEDED(m_ResidencySet->Open());
+    }
 }
 
 void CommandContext::Reset( void )
@@ -190,7 +332,7 @@ void CommandContext::Reset( void )
     // We only call Reset() on previously freed contexts.  The command list persists, but we must
     // request a new allocator.
     ASSERT(m_CommandList != nullptr && m_CurrentAllocator == nullptr);
-    m_CurrentAllocator = g_CommandManager.GetQueue(m_Type).RequestAllocator();
+    m_CurrentAllocator = g_CommandManager.GetQueue(m_Type).RequestAllocator(m_AllocatorSizeClass);
     m_CommandList->Reset(m_CurrentAllocator, nullptr);
 
     m_CurGraphicsRootSignature = nullptr;
@@ -199,6 +341,9 @@ void CommandContext::Reset( void )
     m_CurComputePipelineState = nullptr;
     m_NumBarriersToFlush = 0;
 
+    if (m_ResidencySet != nullptr)
+        ASSERT_SUCCEEDED(m_ResidencySet->Open());
+
     BindDescriptorHeaps();
 }
 
@@ -244,6 +389,8 @@ void GraphicsContext::ResolveQueryData(ID3D12QueryHeap* QueryHeap, D3D12_QUERY_T
 
 void GraphicsContext::ClearUAV( GpuBuffer& Target )
 {
+    ReferenceResource(Target);
+
     // After binding a UAV, we can get a GPU handle that is required to clear it as a UAV (because it essentially runs
     // a shader to set all of the values).
     D3D12_GPU_DESCRIPTOR_HANDLE GpuVisibleHandle = m_DynamicViewDescriptorHeap.UploadDirect(Target.GetUAV());
@@ -253,6 +400,8 @@ void GraphicsContext::ClearUAV( GpuBuffer& Target )
 
 void ComputeContext::ClearUAV( GpuBuffer& Target )
 {
+    ReferenceResource(Target);
+
     // After binding a UAV, we can get a GPU handle that is required to clear it as a UAV (because it essentially runs
     // a shader to set all of the values).
     D3D12_GPU_DESCRIPTOR_HANDLE GpuVisibleHandle = m_DynamicViewDescriptorHeap.UploadDirect(Target.GetUAV());
@@ -262,6 +411,8 @@ void ComputeContext::ClearUAV( GpuBuffer& Target )
 
 void GraphicsContext::ClearUAV( ColorBuffer& Target )
 {
+    ReferenceResource(Target);
+
     // After binding a UAV, we can get a GPU handle that is required to clear it as a UAV (because it essentially runs
     // a shader to set all of the values).
     D3D12_GPU_DESCRIPTOR_HANDLE GpuVisibleHandle = m_DynamicViewDescriptorHeap.UploadDirect(Target.GetUAV());
@@ -274,6 +425,8 @@ void GraphicsContext::ClearUAV( ColorBuffer& Target )
 
 void ComputeContext::ClearUAV( ColorBuffer& Target )
 {
+    ReferenceResource(Target);
+
     // After binding a UAV, we can get a GPU handle that is required to clear it as a UAV (because it essentially runs
     // a shader to set all of the values).
     D3D12_GPU_DESCRIPTOR_HANDLE GpuVisibleHandle = m_DynamicViewDescriptorHeap.UploadDirect(Target.GetUAV());
@@ -286,21 +439,37 @@ void ComputeContext::ClearUAV( ColorBuffer& Target )
 
 void GraphicsContext::ClearColor( ColorBuffer& Target )
 {
+    ReferenceResource(Target);
     m_CommandList->ClearRenderTargetView(Target.GetRTV(), Target.GetClearColor().GetPtr(), 0, nullptr);
 }
 
 void GraphicsContext::ClearDepth( DepthBuffer& Target )
 {
+    ReferenceResource(Target);
     m_CommandList->ClearDepthStencilView(Target.GetDSV(), D3D12_CLEAR_FLAG_DEPTH, Target.GetClearDepth(), Target.GetClearStencil(), 0, nullptr );
 }
 
+void GraphicsContext::ClearDepth( DepthBuffer& Target, const D3D12_RECT& Rect )
+{
+    ReferenceResource(Target);
+    m_CommandList->ClearDepthStencilView(Target.GetDSV(), D3D12_CLEAR_FLAG_DEPTH, Target.GetClearDepth(), Target.GetClearStencil(), 1, &Rect );
+}
+
+void GraphicsContext::ClearDepth( DepthBuffer& Target, uint32_t Slice, const D3D12_RECT& Rect )
+{
+    ReferenceResource(Target);
+    m_CommandList->ClearDepthStencilView(Target.GetSliceDSV(Slice), D3D12_CLEAR_FLAG_DEPTH, Target.GetClearDepth(), Target.GetClearStencil(), 1, &Rect );
+}
+
 void GraphicsContext::ClearStencil( DepthBuffer& Target )
 {
+    ReferenceResource(Target);
     m_CommandList->ClearDepthStencilView(Target.GetDSV(), D3D12_CLEAR_FLAG_STENCIL, Target.GetClearDepth(), Target.GetClearStencil(), 0, nullptr);
 }
 
 void GraphicsContext::ClearDepthAndStencil( DepthBuffer& Target )
 {
+    ReferenceResource(Target);
     m_CommandList->ClearDepthStencilView(Target.GetDSV(), D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, Target.GetClearDepth(), Target.GetClearStencil(), 0, nullptr);
 }
 
@@ -311,6 +480,15 @@ void GraphicsContext::SetViewportAndScissor( const D3D12_VIEWPORT& vp, const D3D
     m_CommandList->RSSetScissorRects( 1, &rect );
 }
 
+void GraphicsContext::SetViewportsAndScissors( UINT Count, const D3D12_VIEWPORT* vps, const D3D12_RECT* rects )
+{
+    ASSERT(Count > 0 && Count <= D3D12_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE);
+    for (UINT i = 0; i < Count; ++i)
+        ASSERT(rects[i].left < rects[i].right && rects[i].top < rects[i].bottom);
+    m_CommandList->RSSetViewports( Count, vps );
+    m_CommandList->RSSetScissorRects( Count, rects );
+}
+
 void GraphicsContext::SetViewport( const D3D12_VIEWPORT& vp )
 {
     m_CommandList->RSSetViewports( 1, &vp );
@@ -334,8 +512,27 @@ void GraphicsContext::SetScissor( const D3D12_RECT& rect )
     m_CommandList->RSSetScissorRects( 1, &rect );
 }
 
+void GraphicsContext::SetShadingRateImage( ColorBuffer* RateImage )
+{
+    ASSERT(g_bVariableRateShadingTier2 && m_CommandList5 != nullptr);
+
+    // The image overrides the base rate, and the per-primitive rate is left out of the combination
+    const D3D12_SHADING_RATE_COMBINER Combiners[D3D12_RS_SET_SHADING_RATE_COMBINER_COUNT] =
+    {
+        D3D12_SHADING_RATE_COMBINER_PASSTHROUGH,
+        RateImage != nullptr ? D3D12_SHADING_RATE_COMBINER_OVERRIDE : D3D12_SHADING_RATE_COMBINER_PASSTHROUGH
+    };
+    m_CommandList5->RSSetShadingRate( D3D12_SHADING_RATE_1X1, Combiners );
+    if (RateImage != nullptr)
+        ReferenceResource(*RateImage);
+    m_CommandList5->RSSetShadingRateImage( RateImage != nullptr ? RateImage->GetResource() : nullptr );
+}
+
 void CommandContext::TransitionResource(GpuResource& Resource, D3D12_RESOURCE_STATES NewState, bool FlushImmediate)
 {
+    // Even a transition that is dropped marks the resource as used here
+    ReferenceResource(Resource);
+
     D3D12_RESOURCE_STATES OldState = Resource.m_UsageState;
 
     if (m_Type == D3D12_COMMAND_LIST_TYPE_COMPUTE)
@@ -346,25 +543,74 @@ void CommandContext::TransitionResource(GpuResource& Resource, D3D12_RESOURCE_ST
 
     if (OldState != NewState)
     {
-        ASSERT(m_NumBarriersToFlush < 16, "Exceeded arbitrary limit on buffered barriers");
-        D3D12_RESOURCE_BARRIER& BarrierDesc = m_ResourceBarrierBuffer[m_NumBarriersToFlush++];
-
-        BarrierDesc.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
-        BarrierDesc.Transition.pResource = Resource.GetResource();
-        BarrierDesc.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
-        BarrierDesc.Transition.StateBefore = OldState;
-        BarrierDesc.Transition.StateAfter = NewState;
+        const bool Merge = s_MergeBarriers;
+        D3D12_RESOURCE_BARRIER* Buffered = Merge ?
+            FindBufferedBarrier(Resource.GetResource(), D3D12_RESOURCE_BARRIER_TYPE_TRANSITION) : nullptr;
 
-        // Check to see if we already started the transition
         if (NewState == Resource.m_TransitioningState)
         {
-            BarrierDesc.Flags = D3D12_RESOURCE_BARRIER_FLAG_END_ONLY;
+            // When nothing was recorded since the transition began, there is no work to overlap it with
+            if (Buffered != nullptr && Buffered->Flags == D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY)
+            {
+                Buffered->Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+                ++m_NumBarriersMerged;
+            }
+            else
+            {
+                ASSERT(m_NumBarriersToFlush < 16, "Exceeded arbitrary limit on buffered barriers");
+                D3D12_RESOURCE_BARRIER& BarrierDesc = m_ResourceBarrierBuffer[m_NumBarriersToFlush++];
+
+                BarrierDesc.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+                BarrierDesc.Transition.pResource = Resource.GetResource();
+                BarrierDesc.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+                BarrierDesc.Transition.StateBefore = OldState;
+                BarrierDesc.Transition.StateAfter = NewState;
+                BarrierDesc.Flags = D3D12_RESOURCE_BARRIER_FLAG_END_ONLY;
+            }
             Resource.m_TransitioningState = (D3D12_RESOURCE_STATES)-1;
+            Resource.m_UsageState = NewState;
+        }
+        else if (Merge && Resource.m_TransitioningState == (D3D12_RESOURCE_STATES)-1 &&
+            (OldState & ~kReadOnlyStates) == 0 && NewState != 0 && (OldState & NewState) == NewState)
+        {
+            // The resource is in a combination of read states that includes the new one
+            ++m_NumBarriersMerged;
+        }
+        else if (Buffered != nullptr && Buffered->Flags == D3D12_RESOURCE_BARRIER_FLAG_NONE)
+        {
+            // Go straight from the state before the buffered transition to the new one
+            ++m_NumBarriersMerged;
+            Buffered->Transition.StateAfter = NewState;
+            if (Buffered->Transition.StateBefore == NewState)
+            {
+                // Writes before the round trip still have to finish before UAV accesses after it
+                if (NewState == D3D12_RESOURCE_STATE_UNORDERED_ACCESS)
+                {
+                    Buffered->Type = D3D12_RESOURCE_BARRIER_TYPE_UAV;
+                    Buffered->UAV.pResource = Resource.GetResource();
+                }
+                else
+                {
+                    RemoveBufferedBarrier(Buffered);
+                    ++m_NumBarriersMerged;
+                }
+            }
+            Resource.m_UsageState = NewState;
         }
         else
+        {
+            ASSERT(m_NumBarriersToFlush < 16, "Exceeded arbitrary limit on buffered barriers");
+            D3D12_RESOURCE_BARRIER& BarrierDesc = m_ResourceBarrierBuffer[m_NumBarriersToFlush++];
+
+            BarrierDesc.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+            BarrierDesc.Transition.pResource = Resource.GetResource();
+            BarrierDesc.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+            BarrierDesc.Transition.StateBefore = OldState;
+            BarrierDesc.Transition.StateAfter = NewState;
             BarrierDesc.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
 
-        Resource.m_UsageState = NewState;
+            Resource.m_UsageState = NewState;
+        }
     }
     else if (NewState == D3D12_RESOURCE_STATE_UNORDERED_ACCESS)
         InsertUAVBarrier(Resource, FlushImmediate);
@@ -375,6 +621,8 @@ void CommandContext::TransitionResource(GpuResource& Resource, D3D12_RESOURCE_ST
 
 void CommandContext::BeginResourceTransition(GpuResource& Resource, D3D12_RESOURCE_STATES NewState, bool FlushImmediate)
 {
+    ReferenceResource(Resource);
+
     // If it's already transitioning, finish that transition
     if (Resource.m_TransitioningState != (D3D12_RESOURCE_STATES)-1)
         TransitionResource(Resource, Resource.m_TransitioningState);
@@ -403,6 +651,23 @@ void CommandContext::BeginResourceTransition(GpuResource& Resource, D3D12_RESOUR
 
 void CommandContext::InsertUAVBarrier(GpuResource& Resource, bool FlushImmediate)
 {
+    ReferenceResource(Resource);
+
+    // A buffered UAV barrier, or a transition to UAV access, already orders this against earlier writes
+    if (s_MergeBarriers)
+    {
+        D3D12_RESOURCE_BARRIER* Transition = FindBufferedBarrier(Resource.GetResource(), D3D12_RESOURCE_BARRIER_TYPE_TRANSITION);
+        if (FindBufferedBarrier(Resource.GetResource(), D3D12_RESOURCE_BARRIER_TYPE_UAV) != nullptr ||
+            (Transition != nullptr && Transition->Flags != D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY &&
+            Transition->Transition.StateAfter == D3D12_RESOURCE_STATE_UNORDERED_ACCESS))
+        {
+            ++m_NumBarriersMerged;
+            if (FlushImmediate)
+                FlushResourceBarriers();
+            return;
+        }
+    }
+
     ASSERT(m_NumBarriersToFlush < 16, "Exceeded arbitrary limit on buffered barriers");
     D3D12_RESOURCE_BARRIER& BarrierDesc = m_ResourceBarrierBuffer[m_NumBarriersToFlush++];
 
@@ -414,8 +679,39 @@ void CommandContext::InsertUAVBarrier(GpuResource& Resource, bool FlushImmediate
         FlushResourceBarriers();
 }
 
+D3D12_RESOURCE_BARRIER* CommandContext::FindBufferedBarrier(ID3D12Resource* Resource, D3D12_RESOURCE_BARRIER_TYPE Type)
+{
+    // Search from the newest, which is the one that determines the resource's state
+    for (UINT i = m_NumBarriersToFlush; i > 0; --i)
+    {
+        D3D12_RESOURCE_BARRIER& Barrier = m_ResourceBarrierBuffer[i - 1];
+        if (Barrier.Type != Type)
+            continue;
+
+        if (Type == D3D12_RESOURCE_BARRIER_TYPE_TRANSITION && Barrier.Transition.pResource == Resource &&
+            Barrier.Transition.Subresource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES)
+            return &Barrier;
+        else if (Type == D3D12_RESOURCE_BARRIER_TYPE_UAV && Barrier.UAV.pResource == Resource)
+            return &Barrier;
+    }
+    return nullptr;
+}
+
+void CommandContext::RemoveBufferedBarrier(D3D12_RESOURCE_BARRIER* Barrier)
+{
+    // Barriers of the same resource must stay in order
+    const UINT Index = (UINT)(Barrier - m_ResourceBarrierBuffer);
+    ASSERT(Index < m_NumBarriersToFlush);
+    for (UINT i = Index + 1; i < m_NumBarriersToFlush; ++i)
+        m_ResourceBarrierBuffer[i - 1] = m_ResourceBarrierBuffer[i];
+    --m_NumBarriersToFlush;
+}
+
 void CommandContext::InsertAliasBarrier(GpuResource& Before, GpuResource& After, bool FlushImmediate)
 {
+    ReferenceResource(Before);
+    ReferenceResource(After);
+
     ASSERT(m_NumBarriersToFlush < 16, "Exceeded arbitrary limit on buffered barriers");
     D3D12_RESOURCE_BARRIER& BarrierDesc = m_ResourceBarrierBuffer[m_NumBarriersToFlush++];
 
@@ -428,6 +724,22 @@ void CommandContext::InsertAliasBarrier(GpuResource& Before, GpuResource& After,
         FlushResourceBarriers();
 }
 
+void CommandContext::InsertAliasBarrier(bool FlushImmediate)
+{
+    if (m_NumBarriersToFlush == 16)
+        FlushResourceBarriers();
+
+    D3D12_RESOURCE_BARRIER& BarrierDesc = m_ResourceBarrierBuffer[m_NumBarriersToFlush++];
+
+    BarrierDesc.Type = D3D12_RESOURCE_BARRIER_TYPE_ALIASING;
+    BarrierDesc.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+    BarrierDesc.Aliasing.pResourceBefore = nullptr;
+    BarrierDesc.Aliasing.pResourceAfter = nullptr;
+
+    if (FlushImmediate || m_NumBarriersToFlush == 16)
+        FlushResourceBarriers();
+}
+
 void CommandContext::WriteBuffer( GpuResource& Dest, size_t DestOffset, const void* BufferData, size_t NumBytes )
 {
     ASSERT(BufferData != nullptr && Math::IsAligned(BufferData, 16));
@@ -444,23 +756,36 @@ void CommandContext::FillBuffer( GpuResource& Dest, size_t DestOffset, DWParam V
     CopyBufferRegion(Dest, DestOffset, TempSpace.Buffer, TempSpace.Offset, NumBytes );
 }
 
-void CommandContext::InitializeTexture( GpuResource& Dest, UINT NumSubresources, D3D12_SUBRESOURCE_DATA SubData[] )
+void CommandContext::InitializeTexture( GpuResource& Dest, UINT NumSubresources, D3D12_SUBRESOURCE_DATA SubData[],
+    UINT FirstSubresource )
 {
-    UINT64 uploadBufferSize = GetRequiredIntermediateSize(Dest.GetResource(), 0, NumSubresources);
+    UINT64 uploadBufferSize = GetRequiredIntermediateSize(Dest.GetResource(), FirstSubresource, NumSubresources);
+
+    // Textures too large to stage are left to the graphics queue
+    if (CanInitializeOnCopyQueue(Dest.m_UsageState) && uploadBufferSize <= AssetIO::GetMaxStagedUpload())
+    {
+        // The copy queue leaves the texture in the common state
+        AssetIO::UploadTexture(Dest, NumSubresources, SubData, FirstSubresource);
+        Dest.m_UsageState = D3D12_RESOURCE_STATE_COMMON;
+        s_CopyInitializationPending = true;
+        return;
+    }
 
     CommandContext& InitContext = CommandContext::Begin();
 
     // copy data to the intermediate upload heap and then schedule a copy from the upload heap to the default texture
     DynAlloc mem = InitContext.ReserveUploadMemory(uploadBufferSize);
-    UpdateSubresources(InitContext.m_CommandList, Dest.GetResource(), mem.Buffer.GetResource(), 0, 0, NumSubresources, SubData);
+    UpdateSubresources(InitContext.m_CommandList, Dest.GetResource(), mem.Buffer.GetResource(), 0, FirstSubresource, NumSubresources, SubData);
     InitContext.TransitionResource(Dest, D3D12_RESOURCE_STATE_GENERIC_READ);
 
-    // Execute the command list and wait for it to finish so we can release the upload buffer
-    InitContext.Finish(true);
+    // The upload memory is retired with the command list's fence, so there is nothing to wait for
+    InitContext.Finish();
 }
 
 void CommandContext::CopySubresource(GpuResource& Dest, UINT DestSubIndex, GpuResource& Src, UINT SrcSubIndex)
 {
+    ReferenceResource(Dest);
+    ReferenceResource(Src);
     FlushResourceBarriers();
 
     D3D12_TEXTURE_COPY_LOCATION DestLocation =
@@ -519,7 +844,7 @@ void CommandContext::InitializeTextureArraySlice(GpuResource& Dest, UINT SliceIn
     }
 
     Context.TransitionResource(Dest, D3D12_RESOURCE_STATE_GENERIC_READ);
-    Context.Finish(true);
+    Context.Finish();
 }
 
 void CommandContext::ReadbackTexture2D(GpuResource& ReadbackBuffer, PixelBuffer& SrcBuffer)
@@ -543,6 +868,15 @@ void CommandContext::ReadbackTexture2D(GpuResource& ReadbackBuffer, PixelBuffer&
 
 void CommandContext::InitializeBuffer( GpuResource& Dest, const void* BufferData, size_t NumBytes, size_t Offset)
 {
+    if (Offset == 0 && CanInitializeOnCopyQueue(Dest.m_UsageState))
+    {
+        // Buffers are promoted to the copy destination state and decay back to the common state
+        AssetIO::UploadBuffer(Dest, 0, BufferData, NumBytes);
+        Dest.m_UsageState = D3D12_RESOURCE_STATE_COMMON;
+        s_CopyInitializationPending = true;
+        return;
+    }
+
     CommandContext& InitContext = CommandContext::Begin();
 
     DynAlloc mem = InitContext.ReserveUploadMemory(NumBytes);
@@ -553,8 +887,8 @@ void CommandContext::InitializeBuffer( GpuResource& Dest, const void* BufferData
     InitContext.m_CommandList->CopyBufferRegion(Dest.GetResource(), Offset, mem.Buffer.GetResource(), 0, NumBytes);
     InitContext.TransitionResource(Dest, D3D12_RESOURCE_STATE_GENERIC_READ, true);
 
-    // Execute the command list and wait for it to finish so we can release the upload buffer
-    InitContext.Finish(true);
+    // The upload memory is retired with the command list's fence, so there is nothing to wait for
+    InitContext.Finish();
 }
 
 void CommandContext::PIXBeginEvent(const wchar_t* label)
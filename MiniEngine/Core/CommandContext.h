@@ -23,6 +23,7 @@
 #include "PixelBuffer.h"
 #include "DynamicDescriptorHeap.h"
 #include "LinearAllocator.h"
+#include "UploadRing.h"
 #include "CommandSignature.h"
 #include "GraphicsCore.h"
 #include <vector>
@@ -54,6 +55,7 @@ struct DWParam
 #define VALID_COMPUTE_QUEUE_RESOURCE_STATES \
     ( D3D12_RESOURCE_STATE_UNORDERED_ACCESS \
     | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE \
+    | D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT \
     | D3D12_RESOURCE_STATE_COPY_DEST \
     | D3D12_RESOURCE_STATE_COPY_SOURCE )
 
@@ -62,7 +64,7 @@ class ContextManager
 public:
     ContextManager(void) {}
 
-    CommandContext* AllocateContext(D3D12_COMMAND_LIST_TYPE Type);
+    CommandContext* AllocateContext(D3D12_COMMAND_LIST_TYPE Type, CommandAllocatorSizeClass SizeClass = kSmallCommandAllocator);
     void FreeContext(CommandContext*);
     void DestroyAllContexts();
 
@@ -94,7 +96,13 @@ public:
 
     static void DestroyAllContexts(void);
 
-    static CommandContext& Begin(const std::wstring ID = L"");
+    // Lists the resource barriers submitted, and those merged away, since the last call with the profiler's
+    // counters.  They are counted when their context finishes.
+    static void ReportStatistics(void);
+
+    // Contexts that will record many draws or dispatches should be begun with large allocators.  Named contexts
+    // also get them when their last list under the same name was large.
+    static CommandContext& Begin(const std::wstring ID = L"", CommandAllocatorSizeClass SizeClass = kSmallCommandAllocator);
 
     // Flush existing commands to the GPU but keep the context alive
     uint64_t Flush( bool WaitForCompletion = false );
@@ -102,6 +110,13 @@ public:
     // Flush existing commands and release the current context
     uint64_t Finish( bool WaitForCompletion = false );
 
+    // Contexts may be recorded on worker threads, as long as they are begun and finished on the main
+    // thread.  They must be begun without an ID (profiling is not thread-safe) and must not transition
+    // resources, because resource states are tracked on the resources rather than per context; make all
+    // transitions on the main thread before handing contexts to workers.  This submits such contexts in
+    // a single batch, in array order, and releases them.
+    static uint64_t FinishParallel( CommandContext* const* Contexts, uint32_t Count, bool WaitForCompletion = false );
+
     // Prepare to render by reserving a command list and command allocator
     void Initialize(void);
 
@@ -118,6 +133,10 @@ public:
         return m_CommandList;
     }
 
+    D3D12_COMMAND_LIST_TYPE GetType() const {
+        return m_Type;
+    }
+
     void CopyBuffer( GpuResource& Dest, GpuResource& Src );
     void CopyBufferRegion( GpuResource& Dest, size_t DestOffset, GpuResource& Src, size_t SrcOffset, size_t NumBytes );
     void CopySubresource(GpuResource& Dest, UINT DestSubIndex, GpuResource& Src, UINT SrcSubIndex);
@@ -129,7 +148,32 @@ public:
         return m_CpuLinearAllocator.Allocate(SizeInBytes);
     }
 
-    static void InitializeTexture( GpuResource& Dest, UINT NumSubresources, D3D12_SUBRESOURCE_DATA SubData[] );
+    // Reserves dynamic data in the frame's part of the upload ring when the upload strategy puts it there, or in a
+    // linear allocator page otherwise and when the ring is full
+    void* AllocateDynamicData(size_t BufferSize, bool IsConstants, D3D12_GPU_VIRTUAL_ADDRESS& GpuAddress)
+    {
+        void* DataPtr;
+        if (UploadRing::UsesRing(IsConstants) && m_UploadRing.Allocate(BufferSize, DEFAULT_ALIGN, DataPtr, GpuAddress))
+            return DataPtr;
+
+        DynAlloc Alloc = m_CpuLinearAllocator.Allocate(BufferSize);
+        GpuAddress = Alloc.GpuAddress;
+        return Alloc.DataPtr;
+    }
+
+    D3D12_GPU_VIRTUAL_ADDRESS UploadDynamicConstants(size_t BufferSize, const void* BufferData)
+    {
+        D3D12_GPU_VIRTUAL_ADDRESS GpuAddress;
+        memcpy(AllocateDynamicData(BufferSize, true, GpuAddress), BufferData, BufferSize);
+        return GpuAddress;
+    }
+
+    // Resources in the common or copy destination state, as they are created, are initialized on the copy queue
+    // in batches, and left in the common state.  The graphics and compute queues wait for the copies before the
+    // next command list they run.  Anything else, including part of a buffer past its start, is initialized on the
+    // graphics queue.  None of these wait on the CPU.
+    static void InitializeTexture( GpuResource& Dest, UINT NumSubresources, D3D12_SUBRESOURCE_DATA SubData[],
+        UINT FirstSubresource = 0 );
     static void InitializeBuffer( GpuResource& Dest, const void* Data, size_t NumBytes, size_t Offset = 0);
     static void InitializeTextureArraySlice(GpuResource& Dest, UINT SliceIndex, GpuResource& Src);
     static void ReadbackTexture2D(GpuResource& ReadbackBuffer, PixelBuffer& SrcBuffer);
@@ -137,14 +181,24 @@ public:
     void WriteBuffer( GpuResource& Dest, size_t DestOffset, const void* Data, size_t NumBytes );
     void FillBuffer( GpuResource& Dest, size_t DestOffset, DWParam Value, size_t NumBytes );
 
+    // Barriers are buffered until the next command that needs them.  A transition of a resource that already has
+    // one buffered is folded into it, a transition between read states that the resource is already in is
+    // dropped, and a split transition that is ended before anything is recorded becomes a single barrier.
     void TransitionResource(GpuResource& Resource, D3D12_RESOURCE_STATES NewState, bool FlushImmediate = false);
     void BeginResourceTransition(GpuResource& Resource, D3D12_RESOURCE_STATES NewState, bool FlushImmediate = false);
     void InsertUAVBarrier(GpuResource& Resource, bool FlushImmediate = false);
     void InsertAliasBarrier(GpuResource& Before, GpuResource& After, bool FlushImmediate = false);
+    // Orders every access to placed memory before the barrier against those after it, whatever resource they use
+    void InsertAliasBarrier(bool FlushImmediate = false);
     inline void FlushResourceBarriers(void);
 
+    // Keeps a resource that residency is managed for resident while this context's work runs.  Transitions, copies
+    // and clears reference their resources, so this is only needed for those the context uses through descriptors alone.
+    inline void ReferenceResource(GpuResource& Resource);
+
     void InsertTimeStamp( ID3D12QueryHeap* pQueryHeap, uint32_t QueryIdx );
     void ResolveTimeStamps( ID3D12Resource* pReadbackHeap, ID3D12QueryHeap* pQueryHeap, uint32_t NumQueries );
+    void ResolvePipelineStatistics( ID3D12Resource* pReadbackHeap, ID3D12QueryHeap* pQueryHeap, uint32_t NumQueries );
     void PIXBeginEvent(const wchar_t* label);
     void PIXEndEvent(void);
     void PIXSetMarker(const wchar_t* label);
@@ -158,9 +212,15 @@ protected:
 
     void BindDescriptorHeaps( void );
 
+    // Hands the allocators and memory used so far back to their pools once FenceValue is reached
+    void RetireAllocations( uint64_t FenceValue );
+
     CommandListManager* m_OwningManager;
     ID3D12GraphicsCommandList* m_CommandList;
+    ID3D12GraphicsCommandList5* m_CommandList5;  // Null where the runtime predates variable rate shading
     ID3D12CommandAllocator* m_CurrentAllocator;
+    CommandAllocatorSizeClass m_AllocatorSizeClass;
+    uint32_t m_NumCommands;     // Draws and dispatches recorded with the current allocator
 
     ID3D12RootSignature* m_CurGraphicsRootSignature;
     ID3D12PipelineState* m_CurGraphicsPipelineState;
@@ -172,11 +232,21 @@ protected:
 
     D3D12_RESOURCE_BARRIER m_ResourceBarrierBuffer[16];
     UINT m_NumBarriersToFlush;
+    uint32_t m_NumBarriersIssued;
+    uint32_t m_NumBarriersMerged;
+
+    // Returns the buffered barrier of the type for the resource, or null
+    D3D12_RESOURCE_BARRIER* FindBufferedBarrier(ID3D12Resource* Resource, D3D12_RESOURCE_BARRIER_TYPE Type);
+    void RemoveBufferedBarrier(D3D12_RESOURCE_BARRIER* Barrier);
 
     ID3D12DescriptorHeap* m_CurrentDescriptorHeaps[D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES];
 
     LinearAllocator m_CpuLinearAllocator;
     LinearAllocator m_GpuLinearAllocator;
+    UploadRingAllocator m_UploadRing;
+
+    // The tracked resources the context references, open from when it begins until it is submitted
+    D3DX12Residency::ResidencySet* m_ResidencySet;
 
     std::wstring m_ID;
     void SetID(const std::wstring& ID) { m_ID = ID; }
@@ -188,15 +258,17 @@ class GraphicsContext : public CommandContext
 {
 public:
 
-    static GraphicsContext& Begin(const std::wstring& ID = L"")
+    static GraphicsContext& Begin(const std::wstring& ID = L"", CommandAllocatorSizeClass SizeClass = kSmallCommandAllocator)
     {
-        return CommandContext::Begin(ID).GetGraphicsContext();
+        return CommandContext::Begin(ID, SizeClass).GetGraphicsContext();
     }
 
     void ClearUAV( GpuBuffer& Target );
     void ClearUAV( ColorBuffer& Target );
     void ClearColor( ColorBuffer& Target );
     void ClearDepth( DepthBuffer& Target );
+    void ClearDepth( DepthBuffer& Target, const D3D12_RECT& Rect );
+    void ClearDepth( DepthBuffer& Target, uint32_t Slice, const D3D12_RECT& Rect );
     void ClearStencil( DepthBuffer& Target );
     void ClearDepthAndStencil( DepthBuffer& Target );
 
@@ -218,10 +290,16 @@ public:
     void SetScissor( UINT left, UINT top, UINT right, UINT bottom );
     void SetViewportAndScissor( const D3D12_VIEWPORT& vp, const D3D12_RECT& rect );
     void SetViewportAndScissor( UINT x, UINT y, UINT w, UINT h );
+    // For shaders that output SV_ViewportArrayIndex.  Each viewport uses the scissor with the same index.
+    void SetViewportsAndScissors( UINT Count, const D3D12_VIEWPORT* vps, const D3D12_RECT* rects );
     void SetStencilRef( UINT StencilRef );
     void SetBlendFactor( Color BlendFactor );
     void SetPrimitiveTopology( D3D12_PRIMITIVE_TOPOLOGY Topology );
 
+    // Shades each tile of the render target at the rate the R8_UINT image holds for it, which must be in the
+    // shading rate source state.  Null goes back to shading every pixel.  Requires g_bVariableRateShadingTier2.
+    void SetShadingRateImage( ColorBuffer* RateImage );
+
     void SetPipelineState( const GraphicsPSO& PSO );
     void SetConstantArray( UINT RootIndex, UINT NumConstants, const void* pConstants );
     void SetConstant( UINT RootIndex, DWParam Val, UINT Offset = 0 );
@@ -237,6 +315,9 @@ public:
 
     void SetDynamicDescriptor( UINT RootIndex, UINT Offset, D3D12_CPU_DESCRIPTOR_HANDLE Handle );
     void SetDynamicDescriptors( UINT RootIndex, UINT Offset, UINT Count, const D3D12_CPU_DESCRIPTOR_HANDLE Handles[] );
+    void SetPersistentDescriptorTable( UINT RootIndex, UINT Offset );
+    // The start of a table in this context's copy of the persistent region, for recording into bundles
+    D3D12_GPU_DESCRIPTOR_HANDLE GetPersistentDescriptorTable( UINT Offset );
     void SetDynamicSampler( UINT RootIndex, UINT Offset, D3D12_CPU_DESCRIPTOR_HANDLE Handle );
     void SetDynamicSamplers( UINT RootIndex, UINT Offset, UINT Count, const D3D12_CPU_DESCRIPTOR_HANDLE Handles[] );
 
@@ -257,6 +338,12 @@ public:
     void ExecuteIndirect(CommandSignature& CommandSig, GpuBuffer& ArgumentBuffer, uint64_t ArgumentStartOffset = 0,
         uint32_t MaxCommands = 1, GpuBuffer* CommandCounterBuffer = nullptr, uint64_t CounterOffset = 0);
 
+    // Bundles inherit the root signature, its arguments, the render targets and the input assembler buffers.  They
+    // set their own PSO, topology and descriptor heaps, which must be those of DynamicDescriptorHeap, and whatever
+    // they set stays set afterwards.
+    void ExecuteBundle( ID3D12GraphicsCommandList* Bundle );
+    ID3D12PipelineState* GetPipelineState( void ) const { return m_CurGraphicsPipelineState; }
+
 private:
 };
 
@@ -287,6 +374,7 @@ public:
 
     void SetDynamicDescriptor( UINT RootIndex, UINT Offset, D3D12_CPU_DESCRIPTOR_HANDLE Handle );
     void SetDynamicDescriptors( UINT RootIndex, UINT Offset, UINT Count, const D3D12_CPU_DESCRIPTOR_HANDLE Handles[] );
+    void SetPersistentDescriptorTable( UINT RootIndex, UINT Offset );
     void SetDynamicSampler( UINT RootIndex, UINT Offset, D3D12_CPU_DESCRIPTOR_HANDLE Handle );
     void SetDynamicSamplers( UINT RootIndex, UINT Offset, UINT Count, const D3D12_CPU_DESCRIPTOR_HANDLE Handles[] );
 
@@ -306,6 +394,7 @@ inline void CommandContext::FlushResourceBarriers( void )
     if (m_NumBarriersToFlush > 0)
     {
         m_CommandList->ResourceBarrier(m_NumBarriersToFlush, m_ResourceBarrierBuffer);
+        m_NumBarriersIssued += m_NumBarriersToFlush;
         m_NumBarriersToFlush = 0;
     }
 }
@@ -463,19 +552,13 @@ inline void GraphicsContext::SetConstantBuffer( UINT RootIndex, D3D12_GPU_VIRTUA
 inline void GraphicsContext::SetDynamicConstantBufferView( UINT RootIndex, size_t BufferSize, const void* BufferData )
 {
     ASSERT(BufferData != nullptr && Math::IsAligned(BufferData, 16));
-    DynAlloc cb = m_CpuLinearAllocator.Allocate(BufferSize);
-    //SIMDMemCopy(cb.DataPtr, BufferData, Math::AlignUp(BufferSize, 16) >> 4);
-    memcpy(cb.DataPtr, BufferData, BufferSize);
-    m_CommandList->SetGraphicsRootConstantBufferView(RootIndex, cb.GpuAddress);
+    m_CommandList->SetGraphicsRootConstantBufferView(RootIndex, UploadDynamicConstants(BufferSize, BufferData));
 }
 
 inline void ComputeContext::SetDynamicConstantBufferView( UINT RootIndex, size_t BufferSize, const void* BufferData )
 {
     ASSERT(BufferData != nullptr && Math::IsAligned(BufferData, 16));
-    DynAlloc cb = m_CpuLinearAllocator.Allocate(BufferSize);
-    //SIMDMemCopy(cb.DataPtr, BufferData, Math::AlignUp(BufferSize, 16) >> 4);
-    memcpy(cb.DataPtr, BufferData, BufferSize);
-    m_CommandList->SetComputeRootConstantBufferView(RootIndex, cb.GpuAddress);
+    m_CommandList->SetComputeRootConstantBufferView(RootIndex, UploadDynamicConstants(BufferSize, BufferData));
 }
 
 inline void GraphicsContext::SetDynamicVB( UINT Slot, size_t NumVertices, size_t VertexStride, const void* VertexData )
@@ -483,12 +566,10 @@ inline void GraphicsContext::SetDynamicVB( UINT Slot, size_t NumVertices, size_t
     ASSERT(VertexData != nullptr && Math::IsAligned(VertexData, 16));
 
     size_t BufferSize = Math::AlignUp(NumVertices * VertexStride, 16);
-    DynAlloc vb = m_CpuLinearAllocator.Allocate(BufferSize);
+    D3D12_VERTEX_BUFFER_VIEW VBView;
 
-    SIMDMemCopy(vb.DataPtr, VertexData, BufferSize >> 4);
+    SIMDMemCopy(AllocateDynamicData(BufferSize, false, VBView.BufferLocation), VertexData, BufferSize >> 4);
 
-    D3D12_VERTEX_BUFFER_VIEW VBView;
-    VBView.BufferLocation = vb.GpuAddress;
     VBView.SizeInBytes = (UINT)BufferSize;
     VBView.StrideInBytes = (UINT)VertexStride;
 
@@ -500,12 +581,10 @@ inline void GraphicsContext::SetDynamicIB( size_t IndexCount, const uint16_t* In
     ASSERT(IndexData != nullptr && Math::IsAligned(IndexData, 16));
 
     size_t BufferSize = Math::AlignUp(IndexCount * sizeof(uint16_t), 16);
-    DynAlloc ib = m_CpuLinearAllocator.Allocate(BufferSize);
+    D3D12_INDEX_BUFFER_VIEW IBView;
 
-    SIMDMemCopy(ib.DataPtr, IndexData, BufferSize >> 4);
+    SIMDMemCopy(AllocateDynamicData(BufferSize, false, IBView.BufferLocation), IndexData, BufferSize >> 4);
 
-    D3D12_INDEX_BUFFER_VIEW IBView;
-    IBView.BufferLocation = ib.GpuAddress;
     IBView.SizeInBytes = (UINT)(IndexCount * sizeof(uint16_t));
     IBView.Format = DXGI_FORMAT_R16_UINT;
 
@@ -515,17 +594,17 @@ inline void GraphicsContext::SetDynamicIB( size_t IndexCount, const uint16_t* In
 inline void GraphicsContext::SetDynamicSRV(UINT RootIndex, size_t BufferSize, const void* BufferData)
 {
     ASSERT(BufferData != nullptr && Math::IsAligned(BufferData, 16));
-    DynAlloc cb = m_CpuLinearAllocator.Allocate(BufferSize);
-    SIMDMemCopy(cb.DataPtr, BufferData, Math::AlignUp(BufferSize, 16) >> 4);
-    m_CommandList->SetGraphicsRootShaderResourceView(RootIndex, cb.GpuAddress);
+    D3D12_GPU_VIRTUAL_ADDRESS GpuAddress;
+    SIMDMemCopy(AllocateDynamicData(BufferSize, false, GpuAddress), BufferData, Math::AlignUp(BufferSize, 16) >> 4);
+    m_CommandList->SetGraphicsRootShaderResourceView(RootIndex, GpuAddress);
 }
 
 inline void ComputeContext::SetDynamicSRV(UINT RootIndex, size_t BufferSize, const void* BufferData)
 {
     ASSERT(BufferData != nullptr && Math::IsAligned(BufferData, 16));
-    DynAlloc cb = m_CpuLinearAllocator.Allocate(BufferSize);
-    SIMDMemCopy(cb.DataPtr, BufferData, Math::AlignUp(BufferSize, 16) >> 4);
-    m_CommandList->SetComputeRootShaderResourceView(RootIndex, cb.GpuAddress);
+    D3D12_GPU_VIRTUAL_ADDRESS GpuAddress;
+    SIMDMemCopy(AllocateDynamicData(BufferSize, false, GpuAddress), BufferData, Math::AlignUp(BufferSize, 16) >> 4);
+    m_CommandList->SetComputeRootShaderResourceView(RootIndex, GpuAddress);
 }
 
 inline void GraphicsContext::SetBufferSRV( UINT RootIndex, const GpuBuffer& SRV, UINT64 Offset)
@@ -558,6 +637,7 @@ inline void ComputeContext::Dispatch( size_t GroupCountX, size_t GroupCountY, si
     m_DynamicViewDescriptorHeap.CommitComputeRootDescriptorTables(m_CommandList);
     m_DynamicSamplerDescriptorHeap.CommitComputeRootDescriptorTables(m_CommandList);
     m_CommandList->Dispatch((UINT)GroupCountX, (UINT)GroupCountY, (UINT)GroupCountZ);
+    ++m_NumCommands;
 }
 
 inline void ComputeContext::Dispatch1D( size_t ThreadCountX, size_t GroupSizeX )
@@ -631,6 +711,21 @@ inline void ComputeContext::SetDynamicDescriptors( UINT RootIndex, UINT Offset,
     m_DynamicViewDescriptorHeap.SetComputeDescriptorHandles(RootIndex, Offset, Count, Handles);
 }
 
+inline void GraphicsContext::SetPersistentDescriptorTable( UINT RootIndex, UINT Offset )
+{
+    m_DynamicViewDescriptorHeap.SetGraphicsPersistentTable(RootIndex, Offset);
+}
+
+inline void ComputeContext::SetPersistentDescriptorTable( UINT RootIndex, UINT Offset )
+{
+    m_DynamicViewDescriptorHeap.SetComputePersistentTable(RootIndex, Offset);
+}
+
+inline D3D12_GPU_DESCRIPTOR_HANDLE GraphicsContext::GetPersistentDescriptorTable( UINT Offset )
+{
+    return m_DynamicViewDescriptorHeap.GetPersistentHandle(Offset);
+}
+
 inline void GraphicsContext::SetDynamicSampler( UINT RootIndex, UINT Offset, D3D12_CPU_DESCRIPTOR_HANDLE Handle )
 {
     SetDynamicSamplers(RootIndex, Offset, 1, &Handle);
@@ -693,6 +788,7 @@ inline void GraphicsContext::DrawInstanced(UINT VertexCountPerInstance, UINT Ins
     m_DynamicViewDescriptorHeap.CommitGraphicsRootDescriptorTables(m_CommandList);
     m_DynamicSamplerDescriptorHeap.CommitGraphicsRootDescriptorTables(m_CommandList);
     m_CommandList->DrawInstanced(VertexCountPerInstance, InstanceCount, StartVertexLocation, StartInstanceLocation);
+    ++m_NumCommands;
 }
 
 inline void GraphicsContext::DrawIndexedInstanced(UINT IndexCountPerInstance, UINT InstanceCount, UINT StartIndexLocation,
@@ -702,6 +798,7 @@ inline void GraphicsContext::DrawIndexedInstanced(UINT IndexCountPerInstance, UI
     m_DynamicViewDescriptorHeap.CommitGraphicsRootDescriptorTables(m_CommandList);
     m_DynamicSamplerDescriptorHeap.CommitGraphicsRootDescriptorTables(m_CommandList);
     m_CommandList->DrawIndexedInstanced(IndexCountPerInstance, InstanceCount, StartIndexLocation, BaseVertexLocation, StartInstanceLocation);
+    ++m_NumCommands;
 }
 
 inline void GraphicsContext::ExecuteIndirect(CommandSignature& CommandSig,
@@ -714,6 +811,7 @@ inline void GraphicsContext::ExecuteIndirect(CommandSignature& CommandSig,
     m_CommandList->ExecuteIndirect(CommandSig.GetSignature(), MaxCommands,
         ArgumentBuffer.GetResource(), ArgumentStartOffset,
         CommandCounterBuffer == nullptr ? nullptr : CommandCounterBuffer->GetResource(), CounterOffset);
+    ++m_NumCommands;
 }
 
 inline void GraphicsContext::DrawIndirect(GpuBuffer& ArgumentBuffer, uint64_t ArgumentBufferOffset)
@@ -721,6 +819,21 @@ inline void GraphicsContext::DrawIndirect(GpuBuffer& ArgumentBuffer, uint64_t Ar
     ExecuteIndirect(Graphics::DrawIndirectCommandSignature, ArgumentBuffer, ArgumentBufferOffset);
 }
 
+inline void GraphicsContext::ExecuteBundle( ID3D12GraphicsCommandList* Bundle )
+{
+    FlushResourceBarriers();
+    m_DynamicViewDescriptorHeap.CommitGraphicsRootDescriptorTables(m_CommandList);
+    m_DynamicSamplerDescriptorHeap.CommitGraphicsRootDescriptorTables(m_CommandList);
+
+    D3D12_DESCRIPTOR_HEAP_TYPE HeapTypes[] = { D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER };
+    ID3D12DescriptorHeap* Heaps[] = {
+        DynamicDescriptorHeap::GetShaderVisibleHeap(HeapTypes[0]), DynamicDescriptorHeap::GetShaderVisibleHeap(HeapTypes[1]) };
+    SetDescriptorHeaps(_countof(Heaps), HeapTypes, Heaps);
+
+    m_CommandList->ExecuteBundle(Bundle);
+    ++m_NumCommands;
+}
+
 inline void ComputeContext::ExecuteIndirect(CommandSignature& CommandSig,
     GpuBuffer& ArgumentBuffer, uint64_t ArgumentStartOffset,
     uint32_t MaxCommands, GpuBuffer* CommandCounterBuffer, uint64_t CounterOffset)
@@ -731,6 +844,7 @@ inline void ComputeContext::ExecuteIndirect(CommandSignature& CommandSig,
     m_CommandList->ExecuteIndirect(CommandSig.GetSignature(), MaxCommands,
         ArgumentBuffer.GetResource(), ArgumentStartOffset,
         CommandCounterBuffer == nullptr ? nullptr : CommandCounterBuffer->GetResource(), CounterOffset);
+    ++m_NumCommands;
 }
 
 inline void ComputeContext::DispatchIndirect( GpuBuffer& ArgumentBuffer, uint64_t ArgumentBufferOffset )
@@ -750,6 +864,7 @@ inline void CommandContext::CopyBufferRegion( GpuResource& Dest, size_t DestOffs
 {
     TransitionResource(Dest, D3D12_RESOURCE_STATE_COPY_DEST);
     //TransitionResource(Src, D3D12_RESOURCE_STATE_COPY_SOURCE);
+    ReferenceResource(Src);
     FlushResourceBarriers();
     m_CommandList->CopyBufferRegion( Dest.GetResource(), DestOffset, Src.GetResource(), SrcOffset, NumBytes);
 }
@@ -768,6 +883,12 @@ inline void CommandContext::ResetCounter(StructuredBuffer& Buf, uint32_t Value )
     TransitionResource(Buf.GetCounterBuffer(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
 }
 
+inline void CommandContext::ReferenceResource(GpuResource& Resource)
+{
+    if (m_ResidencySet != nullptr && Resource.m_ResidencyHandle.IsInitialized())
+        m_ResidencySet->Insert(&Resource.m_ResidencyHandle);
+}
+
 inline void CommandContext::InsertTimeStamp(ID3D12QueryHeap* pQueryHeap, uint32_t QueryIdx)
 {
     m_CommandList->EndQuery(pQueryHeap, D3D12_QUERY_TYPE_TIMESTAMP, QueryIdx);
@@ -777,3 +898,8 @@ inline void CommandContext::ResolveTimeStamps(ID3D12Resource* pReadbackHeap, ID3
 {
     m_CommandList->ResolveQueryData(pQueryHeap, D3D12_QUERY_TYPE_TIMESTAMP, 0, NumQueries, pReadbackHeap, 0);
 }
+
+inline void CommandContext::ResolvePipelineStatistics(ID3D12Resource* pReadbackHeap, ID3D12QueryHeap* pQueryHeap, uint32_t NumQueries)
+{
+    m_CommandList->ResolveQueryData(pQueryHeap, D3D12_QUERY_TYPE_PIPELINE_STATISTICS, 0, NumQueries, pReadbackHeap, 0);
+}
@@ -13,6 +13,8 @@
 
 #include "pch.h"
 #include "CommandListManager.h"
+#include "SystemTime.h"
+#include "StartupProfile.h"
 
 CommandQueue::CommandQueue(D3D12_COMMAND_LIST_TYPE Type) :
     m_Type(Type),
@@ -20,6 +22,9 @@ CommandQueue::CommandQueue(D3D12_COMMAND_LIST_TYPE Type) :
     m_pFence(nullptr),
     m_NextFenceValue((uint64_t)Type << 56 | 1),
     m_LastCompletedFenceValue((uint64_t)Type << 56),
+    m_CallbackEvent(nullptr),
+    m_CallbackWait(nullptr),
+    m_ResidencyManager(nullptr),
     m_AllocatorPool(Type)
 {
 }
@@ -36,7 +41,17 @@ void CommandQueue::Shutdown()
 
     m_AllocatorPool.Shutdown();
 
-    CloseHandle(m_FenceEventHandle);
+    // Wait for a callback that is running, and then run the rest, whose fences the idle GPU has passed
+    UnregisterWaitEx(m_CallbackWait, INVALID_HANDLE_VALUE);
+    m_CallbackWait = nullptr;
+    RunFenceCallbacks();
+    ASSERT(m_FenceCallbacks.empty(), "Fence callbacks are waiting on work that never finished");
+    CloseHandle(m_CallbackEvent);
+    m_CallbackEvent = nullptr;
+
+    for (HANDLE Event : m_FenceEventPool)
+        CloseHandle(Event);
+    m_FenceEventPool.clear();
 
     m_pFence->Release();
     m_pFence = nullptr;
@@ -60,6 +75,15 @@ CommandListManager::~CommandListManager()
 
 void CommandListManager::Shutdown()
 {
+    if (m_ResidencyManager != nullptr)
+    {
+        m_ResidencyManager->Destroy();
+        m_ResidencyManager = nullptr;
+        m_GraphicsQueue.m_ResidencyManager = nullptr;
+        m_ComputeQueue.m_ResidencyManager = nullptr;
+        m_CopyQueue.m_ResidencyManager = nullptr;
+    }
+
     m_GraphicsQueue.Shutdown();
     m_ComputeQueue.Shutdown();
     m_CopyQueue.Shutdown();
@@ -81,15 +105,16 @@ void CommandQueue::Create(ID3D12Device* pDevice)
     m_pFence->SetName(L"CommandListManager::m_pFence");
     m_pFence->Signal((uint64_t)m_Type << 56);
 
-    m_FenceEventHandle = CreateEvent(nullptr, false, false, nullptr);
-    ASSERT(m_FenceEventHandle != INVALID_HANDLE_VALUE);
+    m_CallbackEvent = CreateEvent(nullptr, false, false, nullptr);
+    ASSERT(m_CallbackEvent != nullptr);
+    ASSERT(RegisterWaitForSingleObject(&m_CallbackWait, m_CallbackEvent, FenceCallbackWait, this, INFINITE, WT_EXECUTEDEFAULT));
 
     m_AllocatorPool.Create(pDevice);
 
     ASSERT(IsReady());
 }
 
-void CommandListManager::Create(ID3D12Device* pDevice)
+void CommandListManager::Create(ID3D12Device* pDevice, IDXGIAdapter3* pAdapter)
 {
     ASSERT(pDevice != nullptr);
 
@@ -98,31 +123,66 @@ void CommandListManager::Create(ID3D12Device* pDevice)
     m_GraphicsQueue.Create(pDevice);
     m_ComputeQueue.Create(pDevice);
     m_CopyQueue.Create(pDevice);
+
+    if (pAdapter != nullptr)
+    {
+        // Paging work may run as far ahead of the GPU as the frames the CPU queues up
+        static const UINT32 kMaxLatency = 3;
+
+        m_ResidencyManager.reset(new D3DX12Residency::ResidencyManager);
+        if (SUCCEEDED(m_ResidencyManager->Initialize(pDevice, 0, pAdapter, kMaxLatency)))
+        {
+            m_GraphicsQueue.m_ResidencyManager = m_ResidencyManager.get();
+            m_ComputeQueue.m_ResidencyManager = m_ResidencyManager.get();
+            m_CopyQueue.m_ResidencyManager = m_ResidencyManager.get();
+        }
+        else
+        {
+            Utility::Print("WARNING:  Unable to create the residency manager\n");
+            m_ResidencyManager = nullptr;
+        }
+    }
 }
 
-void CommandListManager::CreateNewCommandList( D3D12_COMMAND_LIST_TYPE Type, ID3D12GraphicsCommandList** List, ID3D12CommandAllocator** Allocator )
+void CommandListManager::CreateNewCommandList( D3D12_COMMAND_LIST_TYPE Type, ID3D12GraphicsCommandList** List, ID3D12CommandAllocator** Allocator,
+    CommandAllocatorSizeClass SizeClass )
 {
     ASSERT(Type != D3D12_COMMAND_LIST_TYPE_BUNDLE, "Bundles are not yet supported");
     switch (Type)
     {
-    case D3D12_COMMAND_LIST_TYPE_DIRECT: *Allocator = m_GraphicsQueue.RequestAllocator(); break;
+    case D3D12_COMMAND_LIST_TYPE_DIRECT: *Allocator = m_GraphicsQueue.RequestAllocator(SizeClass); break;
     case D3D12_COMMAND_LIST_TYPE_BUNDLE: break;
-    case D3D12_COMMAND_LIST_TYPE_COMPUTE: *Allocator = m_ComputeQueue.RequestAllocator(); break;
-    case D3D12_COMMAND_LIST_TYPE_COPY: *Allocator = m_CopyQueue.RequestAllocator(); break;
+    case D3D12_COMMAND_LIST_TYPE_COMPUTE: *Allocator = m_ComputeQueue.RequestAllocator(SizeClass); break;
+    case D3D12_COMMAND_LIST_TYPE_COPY: *Allocator = m_CopyQueue.RequestAllocator(SizeClass); break;
     }
     
     ASSERT_SUCCEEDED( m_Device->CreateCommandList(1, Type, *Allocator, nullptr, MY_IID_PPV_ARGS(List)) );
     (*List)->SetName(L"CommandList");
 }
 
-uint64_t CommandQueue::ExecuteCommandList( ID3D12CommandList* List )
+uint64_t CommandQueue::ExecuteCommandList( ID3D12CommandList* List, D3DX12Residency::ResidencySet* ResidencySet )
+{
+    return ExecuteCommandLists(1, &List, &ResidencySet);
+}
+
+uint64_t CommandQueue::ExecuteCommandLists( UINT Count, ID3D12CommandList* const* Lists, D3DX12Residency::ResidencySet* const* ResidencySets )
 {
     std::lock_guard<std::mutex> LockGuard(m_FenceMutex);
 
-    ASSERT_SUCCEEDED(((ID3D12GraphicsCommandList*)List)->Close());
+    for (UINT i = 0; i < Count; ++i)
+        ASSERT_SUCCEEDED(((ID3D12GraphicsCommandList*)Lists[i])->Close());
 
-    // Kickoff the command list
-    m_CommandQueue->ExecuteCommandLists(1, &List);
+    // Kickoff the command lists in order, after the paging work that makes their resources resident
+    if (m_ResidencyManager != nullptr && ResidencySets != nullptr)
+    {
+        StartupProfile::ScopedSpan Span(StartupProfile::kResidency);
+        ASSERT_SUCCEEDED(m_ResidencyManager->ExecuteCommandLists(m_CommandQueue, const_cast<ID3D12CommandList**>(Lists),
+            const_cast<D3DX12Residency::ResidencySet**>(ResidencySets), Count));
+    }
+    else
+    {
+        m_CommandQueue->ExecuteCommandLists(Count, Lists);
+    }
 
     // Signal the next fence value (with the GPU)
     m_CommandQueue->Signal(m_pFence, m_NextFenceValue);
@@ -143,10 +203,17 @@ bool CommandQueue::IsFenceComplete(uint64_t FenceValue)
     // Avoid querying the fence value by testing against the last one seen.
     // The max() is to protect against an unlikely race condition that could cause the last
     // completed fence value to regress.
-    if (FenceValue > m_LastCompletedFenceValue)
-        m_LastCompletedFenceValue = std::max(m_LastCompletedFenceValue, m_pFence->GetCompletedValue());
+    if (FenceValue > m_LastCompletedFenceValue.load(std::memory_order_relaxed))
+        UpdateCompletedFence(m_pFence->GetCompletedValue());
 
-    return FenceValue <= m_LastCompletedFenceValue;
+    return FenceValue <= m_LastCompletedFenceValue.load(std::memory_order_relaxed);
+}
+
+void CommandQueue::UpdateCompletedFence(uint64_t CompletedValue)
+{
+    uint64_t LastValue = m_LastCompletedFenceValue.load(std::memory_order_relaxed);
+    while (CompletedValue > LastValue && !m_LastCompletedFenceValue.compare_exchange_weak(LastValue, CompletedValue))
+        ;
 }
 
 namespace Graphics
@@ -171,17 +238,75 @@ void CommandQueue::WaitForFence(uint64_t FenceValue)
     if (IsFenceComplete(FenceValue))
         return;
 
-    // TODO:  Think about how this might affect a multi-threaded situation.  Suppose thread A
-    // wants to wait for fence 100, then thread B comes along and wants to wait for 99.  If
-    // the fence can only have one event set on completion, then thread B has to wait for 
-    // 100 before it knows 99 is ready.  Maybe insert sequential events?
+    HANDLE Event = nullptr;
     {
         std::lock_guard<std::mutex> LockGuard(m_EventMutex);
+        if (!m_FenceEventPool.empty())
+        {
+            Event = m_FenceEventPool.back();
+            m_FenceEventPool.pop_back();
+        }
+    }
 
-        m_pFence->SetEventOnCompletion(FenceValue, m_FenceEventHandle);
-        WaitForSingleObject(m_FenceEventHandle, INFINITE);
-        m_LastCompletedFenceValue = FenceValue;
+    if (Event == nullptr)
+    {
+        Event = CreateEvent(nullptr, false, false, nullptr);
+        ASSERT(Event != nullptr);
     }
+
+    // A fence can set any number of events, each at its own value
+    ASSERT_SUCCEEDED(m_pFence->SetEventOnCompletion(FenceValue, Event));
+
+    // Stalls on the GPU show up in a profile capture next to the GPU work they waited for
+    const int64_t StartTick = SystemTime::GetCurrentTick();
+    WaitForSingleObject(Event, INFINITE);
+    EngineProfiling::RecordCpuEvent(L"Wait For Fence", StartTick, SystemTime::GetCurrentTick());
+    UpdateCompletedFence(FenceValue);
+
+    std::lock_guard<std::mutex> LockGuard(m_EventMutex);
+    m_FenceEventPool.push_back(Event);
+}
+
+void CommandQueue::OnFenceComplete(uint64_t FenceValue, const FenceCallback& Callback)
+{
+    if (IsFenceComplete(FenceValue))
+    {
+        Callback();
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> LockGuard(m_CallbackMutex);
+        m_FenceCallbacks.emplace(FenceValue, Callback);
+    }
+
+    // Setting the event for an earlier value than another callback's, or for one that was just reached, only
+    // wakes the wait early
+    ASSERT_SUCCEEDED(m_pFence->SetEventOnCompletion(FenceValue, m_CallbackEvent));
+}
+
+void CommandQueue::RunFenceCallbacks(void)
+{
+    UpdateCompletedFence(m_pFence->GetCompletedValue());
+    const uint64_t CompletedValue = m_LastCompletedFenceValue.load(std::memory_order_relaxed);
+
+    // Callbacks may add callbacks, so none is called with the lock held
+    std::vector<FenceCallback> Ready;
+    {
+        std::lock_guard<std::mutex> LockGuard(m_CallbackMutex);
+        auto ReadyEnd = m_FenceCallbacks.upper_bound(CompletedValue);
+        for (auto Iter = m_FenceCallbacks.begin(); Iter != ReadyEnd; ++Iter)
+            Ready.push_back(std::move(Iter->second));
+        m_FenceCallbacks.erase(m_FenceCallbacks.begin(), ReadyEnd);
+    }
+
+    for (FenceCallback& Callback : Ready)
+        Callback();
+}
+
+void CALLBACK CommandQueue::FenceCallbackWait(void* Queue, BOOLEAN)
+{
+    ((CommandQueue*)Queue)->RunFenceCallbacks();
 }
 
 void CommandListManager::WaitForFence(uint64_t FenceValue)
@@ -190,14 +315,15 @@ void CommandListManager::WaitForFence(uint64_t FenceValue)
     Producer.WaitForFence(FenceValue);
 }
 
-ID3D12CommandAllocator* CommandQueue::RequestAllocator()
+ID3D12CommandAllocator* CommandQueue::RequestAllocator(CommandAllocatorSizeClass SizeClass)
 {
     uint64_t CompletedFence = m_pFence->GetCompletedValue();
 
-    return m_AllocatorPool.RequestAllocator(CompletedFence);
+    return m_AllocatorPool.RequestAllocator(CompletedFence, SizeClass);
 }
 
-void CommandQueue::DiscardAllocator(uint64_t FenceValue, ID3D12CommandAllocator* Allocator)
+void CommandQueue::DiscardAllocator(uint64_t FenceValue, ID3D12CommandAllocator* Allocator, CommandAllocatorSizeClass SizeClass,
+    uint32_t NumCommands)
 {
-    m_AllocatorPool.DiscardAllocator(FenceValue, Allocator);
+    m_AllocatorPool.DiscardAllocator(FenceValue, Allocator, SizeClass, NumCommands);
 }
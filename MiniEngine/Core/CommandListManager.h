@@ -16,6 +16,9 @@
 #include <vector>
 #include <queue>
 #include <mutex>
+#include <map>
+#include <atomic>
+#include <functional>
 #include <stdint.h>
 #include "CommandAllocatorPool.h"
 
@@ -43,15 +46,27 @@ public:
     void WaitForFence(uint64_t FenceValue);
     void WaitForIdle(void) { WaitForFence(IncrementFence()); }
 
+    // Calls back once the fence reaches the value, right away when it already has.  Callbacks run on a thread
+    // pool thread in fence order, so they should be short and queue anything longer on the job system.
+    typedef std::function<void(void)> FenceCallback;
+    void OnFenceComplete(uint64_t FenceValue, const FenceCallback& Callback);
+
     ID3D12CommandQueue* GetCommandQueue() { return m_CommandQueue; }
 
     uint64_t GetNextFenceValue() { return m_NextFenceValue; }
 
 private:
 
-    uint64_t ExecuteCommandList(ID3D12CommandList* List);
-    ID3D12CommandAllocator* RequestAllocator(void);
-    void DiscardAllocator(uint64_t FenceValueForReset, ID3D12CommandAllocator* Allocator);
+    // With a residency manager, each list's set is made resident before the list runs.  Sets must be closed.
+    uint64_t ExecuteCommandList(ID3D12CommandList* List, D3DX12Residency::ResidencySet* ResidencySet = nullptr);
+    uint64_t ExecuteCommandLists(UINT Count, ID3D12CommandList* const* Lists, D3DX12Residency::ResidencySet* const* ResidencySets = nullptr);
+    ID3D12CommandAllocator* RequestAllocator(CommandAllocatorSizeClass SizeClass);
+    void DiscardAllocator(uint64_t FenceValueForReset, ID3D12CommandAllocator* Allocator, CommandAllocatorSizeClass SizeClass,
+        uint32_t NumCommands);
+
+    void UpdateCompletedFence(uint64_t CompletedValue);
+    void RunFenceCallbacks(void);
+    static void CALLBACK FenceCallbackWait(void* Queue, BOOLEAN TimedOut);
 
     ID3D12CommandQueue* m_CommandQueue;
 
@@ -59,14 +74,23 @@ private:
 
     CommandAllocatorPool m_AllocatorPool;
     std::mutex m_FenceMutex;
-    std::mutex m_EventMutex;
+
+    D3DX12Residency::ResidencyManager* m_ResidencyManager;
 
     // Lifetime of these objects is managed by the descriptor cache
     ID3D12Fence* m_pFence;
     uint64_t m_NextFenceValue;
-    uint64_t m_LastCompletedFenceValue;
-    HANDLE m_FenceEventHandle;
+    std::atomic<uint64_t> m_LastCompletedFenceValue;
+
+    // Every waiting thread takes its own event, so that no thread waits on a later fence than its own
+    std::mutex m_EventMutex;
+    std::vector<HANDLE> m_FenceEventPool;
 
+    // Callbacks by fence value, and the thread pool wait their event wakes
+    std::mutex m_CallbackMutex;
+    std::multimap<uint64_t, FenceCallback> m_FenceCallbacks;
+    HANDLE m_CallbackEvent;
+    HANDLE m_CallbackWait;
 };
 
 class CommandListManager
@@ -77,9 +101,14 @@ public:
     CommandListManager();
     ~CommandListManager();
 
-    void Create(ID3D12Device* pDevice);
+    // Given the device's adapter, committed resources that are tracked are made resident by the command lists
+    // that reference them and evicted by least recent use when the process is over its video memory budget.
+    void Create(ID3D12Device* pDevice, IDXGIAdapter3* pAdapter = nullptr);
     void Shutdown();
 
+    // Null when residency is not managed
+    D3DX12Residency::ResidencyManager* GetResidencyManager(void) { return m_ResidencyManager.get(); }
+
     CommandQueue& GetGraphicsQueue(void) { return m_GraphicsQueue; }
     CommandQueue& GetComputeQueue(void) { return m_ComputeQueue; }
     CommandQueue& GetCopyQueue(void) { return m_CopyQueue; }
@@ -102,7 +131,8 @@ public:
     void CreateNewCommandList(
         D3D12_COMMAND_LIST_TYPE Type,
         ID3D12GraphicsCommandList** List,
-        ID3D12CommandAllocator** Allocator);
+        ID3D12CommandAllocator** Allocator,
+        CommandAllocatorSizeClass SizeClass = kSmallCommandAllocator);
 
     // Test to see if a fence has already been reached
     bool IsFenceComplete(uint64_t FenceValue)
@@ -113,6 +143,12 @@ public:
     // The CPU will wait for a fence to reach a specified value
     void WaitForFence(uint64_t FenceValue);
 
+    // Call back without blocking once a fence reaches a specified value
+    void OnFenceComplete(uint64_t FenceValue, const CommandQueue::FenceCallback& Callback)
+    {
+        GetQueue(D3D12_COMMAND_LIST_TYPE(FenceValue >> 56)).OnFenceComplete(FenceValue, Callback);
+    }
+
     // The CPU will wait for all command queues to empty (so that the GPU is idle)
     void IdleGPU(void)
     {
@@ -128,4 +164,6 @@ private:
     CommandQueue m_GraphicsQueue;
     CommandQueue m_ComputeQueue;
     CommandQueue m_CopyQueue;
+
+    std::unique_ptr<D3DX12Residency::ResidencyManager> m_ResidencyManager;
 };
@@ -0,0 +1,159 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Open addressing hash table for caches that are looked up far more often than they grow, such as the PSO and
+// root signature caches.  Keys are hash codes, and each one maps to a value that is allocated once and never
+// moves.  Lookups take no lock.  Inserts are serialized, and a table that gets half full is copied into one twice
+// its size while readers may still be probing the old one, which is kept until Clear().
+template <typename Value>
+class ConcurrentHashMap
+{
+public:
+
+    explicit ConcurrentHashMap( uint32_t InitialCapacity = 256 ) :
+        m_InitialCapacity(InitialCapacity), m_NumValues(0), m_NumHits(0), m_NumMisses(0)
+    {
+        ASSERT(Math::IsPowerOfTwo(InitialCapacity));
+        m_Tables.emplace_back(new Table(InitialCapacity));
+        m_Table = m_Tables.back().get();
+    }
+
+    ~ConcurrentHashMap() { Clear(); }
+
+    ConcurrentHashMap( const ConcurrentHashMap& ) = delete;
+    ConcurrentHashMap& operator=( const ConcurrentHashMap& ) = delete;
+
+    // Returns null when nothing is stored for the key
+    Value* Find( size_t Key ) const
+    {
+        return Find(*m_Table.load(std::memory_order_acquire), Key);
+    }
+
+    // Returns the value stored for the key, default constructing one when there is none.  Inserted tells the one
+    // thread that created the value apart from all of the others that found it.
+    Value* FindOrInsert( size_t Key, bool& Inserted )
+    {
+        Inserted = false;
+        if (Value* Found = Find(Key))
+        {
+            m_NumHits.fetch_add(1, std::memory_order_relaxed);
+            return Found;
+        }
+
+        std::lock_guard<std::mutex> Guard(m_InsertMutex);
+
+        // Another thread may have inserted the key after the lookup above
+        Table* Current = m_Table.load(std::memory_order_relaxed);
+        if (Value* Found = Find(*Current, Key))
+        {
+            m_NumHits.fetch_add(1, std::memory_order_relaxed);
+            return Found;
+        }
+
+        if ((m_NumValues + 1) * 2 > Current->Mask + 1)
+            Current = Grow(*Current);
+
+        Value* NewValue = new Value();
+        Insert(*Current, Key, NewValue);
+        ++m_NumValues;
+        m_NumMisses.fetch_add(1, std::memory_order_relaxed);
+        Inserted = true;
+        return NewValue;
+    }
+
+    // Destroys every value.  No other thread may use the table meanwhile.
+    void Clear( void )
+    {
+        std::lock_guard<std::mutex> Guard(m_InsertMutex);
+
+        // Values are only ever in the newest table, since growing moves all of them to it
+        Table& Current = *m_Table.load(std::memory_order_relaxed);
+        for (uint32_t i = 0; i <= Current.Mask; ++i)
+            delete Current.Slots[i].Node.load(std::memory_order_relaxed);
+
+        m_Tables.clear();
+        m_Tables.emplace_back(new Table(m_InitialCapacity));
+        m_Table = m_Tables.back().get();
+        m_NumValues = 0;
+    }
+
+    uint32_t GetHitCount( void ) const { return m_NumHits.load(std::memory_order_relaxed); }
+    uint32_t GetMissCount( void ) const { return m_NumMisses.load(std::memory_order_relaxed); }
+
+private:
+
+    // The value is written last, and an empty slot ends every probe sequence
+    struct Slot
+    {
+        Slot() : Key(0), Node(nullptr) {}
+
+        size_t Key;
+        std::atomic<Value*> Node;
+    };
+
+    struct Table
+    {
+        explicit Table( uint32_t Capacity ) : Mask(Capacity - 1), Slots(new Slot[Capacity]) {}
+
+        uint32_t Mask;
+        std::unique_ptr<Slot[]> Slots;
+    };
+
+    static Value* Find( const Table& Probe, size_t Key )
+    {
+        for (uint32_t i = (uint32_t)Key & Probe.Mask; ; i = (i + 1) & Probe.Mask)
+        {
+            Value* Node = Probe.Slots[i].Node.load(std::memory_order_acquire);
+            if (Node == nullptr)
+                return nullptr;
+            if (Probe.Slots[i].Key == Key)
+                return Node;
+        }
+    }
+
+    static void Insert( Table& Dest, size_t Key, Value* NewValue )
+    {
+        uint32_t i = (uint32_t)Key & Dest.Mask;
+        while (Dest.Slots[i].Node.load(std::memory_order_relaxed) != nullptr)
+            i = (i + 1) & Dest.Mask;
+
+        Dest.Slots[i].Key = Key;
+        Dest.Slots[i].Node.store(NewValue, std::memory_order_release);
+    }
+
+    Table* Grow( const Table& Current )
+    {
+        Table* Larger = new Table((Current.Mask + 1) * 2);
+        for (uint32_t i = 0; i <= Current.Mask; ++i)
+        {
+            if (Value* Node = Current.Slots[i].Node.load(std::memory_order_relaxed))
+                Insert(*Larger, Current.Slots[i].Key, Node);
+        }
+
+        m_Tables.emplace_back(Larger);
+        m_Table.store(Larger, std::memory_order_release);
+        return Larger;
+    }
+
+    const uint32_t m_InitialCapacity;
+    std::atomic<Table*> m_Table;
+    std::vector<std::unique_ptr<Table>> m_Tables;
+    std::mutex m_InsertMutex;
+    uint32_t m_NumValues;
+    std::atomic<uint32_t> m_NumHits;
+    std::atomic<uint32_t> m_NumMisses;
+};
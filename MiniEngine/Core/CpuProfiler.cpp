@@ -0,0 +1,162 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "pch.h"
+#include "CpuProfiler.h"
+#include "SystemTime.h"
+#include <intrin.h>
+#include <atomic>
+#include <mutex>
+
+namespace CpuProfiler
+{
+    const uint32_t kRingSize = 16 * 1024;   // Events, which must be a power of two
+
+    struct Event
+    {
+        uint64_t Stamp;
+        const wchar_t* Name;    // Null for the end of the innermost open scope
+    };
+
+    // Only its thread writes events, and only the drain reads them
+    struct ThreadRing
+    {
+        ThreadRing() : Head(0), Tail(0), OpenScopes(0), DroppedDepth(0), ThreadId(GetCurrentThreadId()) {}
+
+        Event Events[kRingSize];
+        std::atomic<uint32_t> Head;
+        std::atomic<uint32_t> Tail;
+        uint32_t OpenScopes;        // The ring always has room left to end these
+        uint32_t DroppedDepth;      // Scopes skipped while the ring was full, whose ends are skipped too
+        uint32_t ThreadId;
+
+        // The scopes the drain has seen begin and not end, which may span any number of frames
+        std::vector<const wchar_t*> OpenNames;
+        std::vector<int64_t> OpenTicks;
+    };
+
+    std::mutex s_RingMutex;
+    std::vector<std::unique_ptr<ThreadRing>> s_Rings;
+    thread_local ThreadRing* t_Ring = nullptr;
+    std::atomic<uint32_t> s_NumDropped(0);
+
+    // Stamps are mapped to ticks through the first ring's creation, and the rate is measured again at every drain
+    uint64_t s_BaseStamp = 0;
+    int64_t s_BaseTick = 0;
+    double s_TicksPerStamp = 1.0;
+
+    // The time stamp counter is invariant on the CPUs that run D3D12, and far cheaper to read than QPC
+    inline uint64_t ReadStamp( void )
+    {
+#if defined(_M_X64) || defined(_M_IX86)
+        return __rdtsc();
+#else
+        return (uint64_t)SystemTime::GetCurrentTick();
+#endif
+    }
+
+    ThreadRing& CreateRing( void )
+    {
+        std::lock_guard<std::mutex> Guard(s_RingMutex);
+        if (s_Rings.empty())
+        {
+            s_BaseTick = SystemTime::GetCurrentTick();
+            s_BaseStamp = ReadStamp();
+        }
+        s_Rings.emplace_back(new ThreadRing);
+        t_Ring = s_Rings.back().get();
+        return *t_Ring;
+    }
+
+    inline ThreadRing& GetRing( void )
+    {
+        return t_Ring != nullptr ? *t_Ring : CreateRing();
+    }
+}
+
+void CpuProfiler::BeginScope( const wchar_t* Name )
+{
+    ThreadRing& Ring = GetRing();
+    const uint32_t Head = Ring.Head.load(std::memory_order_relaxed);
+
+    // Keep room for the end of this scope and of every scope it is nested in
+    if (Ring.DroppedDepth > 0 || Head - Ring.Tail.load(std::memory_order_acquire) + Ring.OpenScopes + 2 > kRingSize)
+    {
+        ++Ring.DroppedDepth;
+        s_NumDropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    Event& NewEvent = Ring.Events[Head & (kRingSize - 1)];
+    NewEvent.Stamp = ReadStamp();
+    NewEvent.Name = Name;
+    Ring.Head.store(Head + 1, std::memory_order_release);
+    ++Ring.OpenScopes;
+}
+
+void CpuProfiler::EndScope( void )
+{
+    ThreadRing& Ring = GetRing();
+    if (Ring.DroppedDepth > 0)
+    {
+        --Ring.DroppedDepth;
+        return;
+    }
+
+    const uint32_t Head = Ring.Head.load(std::memory_order_relaxed);
+    Event& NewEvent = Ring.Events[Head & (kRingSize - 1)];
+    NewEvent.Stamp = ReadStamp();
+    NewEvent.Name = nullptr;
+    Ring.Head.store(Head + 1, std::memory_order_release);
+    --Ring.OpenScopes;
+}
+
+void CpuProfiler::Drain( ScopeCallback Callback )
+{
+    std::lock_guard<std::mutex> Guard(s_RingMutex);
+    if (s_Rings.empty())
+        return;
+
+    const uint64_t NowStamp = ReadStamp();
+    const int64_t NowTick = SystemTime::GetCurrentTick();
+    if (NowStamp > s_BaseStamp)
+        s_TicksPerStamp = (double)(NowTick - s_BaseTick) / (double)(NowStamp - s_BaseStamp);
+
+    for (auto& RingPtr : s_Rings)
+    {
+        ThreadRing& Ring = *RingPtr;
+        const uint32_t Head = Ring.Head.load(std::memory_order_acquire);
+
+        for (uint32_t i = Ring.Tail.load(std::memory_order_relaxed); i != Head; ++i)
+        {
+            const Event& Scope = Ring.Events[i & (kRingSize - 1)];
+            const int64_t Tick = s_BaseTick + (int64_t)((double)(int64_t)(Scope.Stamp - s_BaseStamp) * s_TicksPerStamp);
+
+            if (Scope.Name != nullptr)
+            {
+                Ring.OpenNames.push_back(Scope.Name);
+                Ring.OpenTicks.push_back(Tick);
+            }
+            else if (!Ring.OpenNames.empty())
+            {
+                Callback(Ring.OpenNames.data(), (uint32_t)Ring.OpenNames.size() - 1, Ring.OpenTicks.back(), Tick,
+                    Ring.ThreadId);
+                Ring.OpenNames.pop_back();
+                Ring.OpenTicks.pop_back();
+            }
+        }
+
+        Ring.Tail.store(Head, std::memory_order_release);
+    }
+}
+
+uint32_t CpuProfiler::GetDroppedScopeCount( void )
+{
+    return s_NumDropped.load(std::memory_order_relaxed);
+}
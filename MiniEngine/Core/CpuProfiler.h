@@ -0,0 +1,50 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// CPU scopes that any thread can time, unlike ScopedTimer, which only the main thread may use.  Each thread
+// writes begin and end events stamped with the time stamp counter into a ring of its own, without locks.  Once a
+// frame, EngineProfiling drains the rings on the main thread and adds the scopes to the timing tree, under
+// "CPU Threads" with the times of all threads summed, and to any trace capture.
+//
+
+#pragma once
+
+#include <cstdint>
+
+namespace CpuProfiler
+{
+    // The name must outlive the profiler, which string literals do
+    void BeginScope( const wchar_t* Name );
+    void EndScope( void );
+
+    // Path holds the names of the enclosing scopes of the thread, outermost first, followed by the scope's own
+    typedef void (*ScopeCallback)( const wchar_t* const* Path, uint32_t Depth, int64_t StartTick, int64_t EndTick,
+        uint32_t ThreadId );
+
+    // Passes every scope that ended since the last drain, with SystemTime ticks.  Only one thread may drain.
+    void Drain( ScopeCallback Callback );
+
+    // Scopes skipped because their thread's ring was full
+    uint32_t GetDroppedScopeCount( void );
+}
+
+class CpuScope
+{
+public:
+    explicit CpuScope( const wchar_t* Name ) { CpuProfiler::BeginScope(Name); }
+    ~CpuScope() { CpuProfiler::EndScope(); }
+
+    CpuScope( const CpuScope& ) = delete;
+    CpuScope& operator=( const CpuScope& ) = delete;
+};
+
+#ifdef RELEASE
+#define CPU_PROFILE_SCOPE(Name)
+#else
+#define CPU_PROFILE_SCOPE(Name) CpuScope _cpuScope(Name)
+#endif
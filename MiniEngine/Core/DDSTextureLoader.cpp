@@ -26,6 +26,8 @@
 #include "GpuResource.h"
 #include "GraphicsCore.h"
 #include "CommandContext.h"
+#include "AssetIO.h"
+#include "GpuMemoryPool.h"
 #include "Utility.h"
 
 struct handle_closer { void operator()(HANDLE h) { if (h) CloseHandle(h); } };
@@ -807,13 +809,6 @@ static HRESULT CreateD3DResources( _In_ ID3D12Device* d3dDevice,
         format = MakeSRGB( format );
     }
 
-    D3D12_HEAP_PROPERTIES HeapProps;
-    HeapProps.Type = D3D12_HEAP_TYPE_DEFAULT;
-    HeapProps.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
-    HeapProps.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
-    HeapProps.CreationNodeMask = 1;
-    HeapProps.VisibleNodeMask = 1;
-
     D3D12_RESOURCE_DESC ResourceDesc;
     ResourceDesc.Alignment = 0;
     ResourceDesc.Width = static_cast<UINT64>( width );
@@ -833,8 +828,7 @@ static HRESULT CreateD3DResources( _In_ ID3D12Device* d3dDevice,
                 ResourceDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE1D;
 
                 ID3D12Resource* tex = nullptr;
-                hr = d3dDevice->CreateCommittedResource( &HeapProps, D3D12_HEAP_FLAG_NONE, &ResourceDesc,
-                    D3D12_RESOURCE_STATE_COPY_DEST, nullptr, MY_IID_PPV_ARGS(&tex));
+                hr = GpuMemoryPool::CreateResource( ResourceDesc, D3D12_RESOURCE_STATE_COPY_DEST, MY_IID_PPV_ARGS(&tex));
 
                 if (SUCCEEDED( hr ) && tex != nullptr)
                 {
@@ -874,8 +868,7 @@ static HRESULT CreateD3DResources( _In_ ID3D12Device* d3dDevice,
                 ResourceDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
 
                 ID3D12Resource* tex = nullptr;
-                hr = d3dDevice->CreateCommittedResource( &HeapProps, D3D12_HEAP_FLAG_NONE, &ResourceDesc,
-                    D3D12_RESOURCE_STATE_COPY_DEST, nullptr, MY_IID_PPV_ARGS(&tex));
+                hr = GpuMemoryPool::CreateResource( ResourceDesc, D3D12_RESOURCE_STATE_COPY_DEST, MY_IID_PPV_ARGS(&tex));
 
                 if (SUCCEEDED( hr ) && tex != 0)
                 {
@@ -933,8 +926,7 @@ static HRESULT CreateD3DResources( _In_ ID3D12Device* d3dDevice,
                 ResourceDesc.DepthOrArraySize = static_cast<UINT16>( depth );
 
                 ID3D12Resource* tex = nullptr;
-                hr = d3dDevice->CreateCommittedResource( &HeapProps, D3D12_HEAP_FLAG_NONE, &ResourceDesc,
-                    D3D12_RESOURCE_STATE_COPY_DEST, nullptr, MY_IID_PPV_ARGS(&tex));
+                hr = GpuMemoryPool::CreateResource( ResourceDesc, D3D12_RESOURCE_STATE_COPY_DEST, MY_IID_PPV_ARGS(&tex));
 
                 if (SUCCEEDED( hr ) && tex != nullptr)
                 {
@@ -973,7 +965,8 @@ static HRESULT CreateTextureFromDDS( _In_ ID3D12Device* d3dDevice,
                                      _In_ size_t maxsize,
                                      _In_ bool forceSRGB,
                                      _Outptr_opt_ ID3D12Resource** texture,
-                                     _In_ D3D12_CPU_DESCRIPTOR_HANDLE textureView )
+                                     _In_ D3D12_CPU_DESCRIPTOR_HANDLE textureView,
+                                     _In_ bool batchedUpload = false )
 {
     HRESULT hr = S_OK;
 
@@ -1185,7 +1178,10 @@ static HRESULT CreateTextureFromDDS( _In_ ID3D12Device* d3dDevice,
         if (SUCCEEDED(hr))
         {
             GpuResource DestTexture(*texture, D3D12_RESOURCE_STATE_COPY_DEST);
-            CommandContext::InitializeTexture(DestTexture, subresourceCount, initData.get());
+            if (batchedUpload)
+                AssetIO::UploadTexture(DestTexture, subresourceCount, initData.get());
+            else
+                CommandContext::InitializeTexture(DestTexture, subresourceCount, initData.get());
         }
     }
 
@@ -1231,7 +1227,8 @@ HRESULT CreateDDSTextureFromMemory(
     bool forceSRGB,
     ID3D12Resource** texture,
     D3D12_CPU_DESCRIPTOR_HANDLE textureView,
-    DDS_ALPHA_MODE* alphaMode )
+    DDS_ALPHA_MODE* alphaMode,
+    bool batchedUpload )
 {
     if ( texture )
     {
@@ -1284,7 +1281,7 @@ HRESULT CreateDDSTextureFromMemory(
 
     HRESULT hr = CreateTextureFromDDS( d3dDevice,
                                        header, ddsData + offset, ddsDataSize - offset, maxsize,
-                                       forceSRGB, texture, textureView );
+                                       forceSRGB, texture, textureView, batchedUpload );
     if ( SUCCEEDED(hr) )
     {
         if (texture != nullptr && *texture != nullptr)
@@ -1345,3 +1342,95 @@ HRESULT CreateDDSTextureFromFile(
 
     return hr;
 }
+
+
+_Use_decl_annotations_
+HRESULT GetDDSTextureLayout(
+    const uint8_t* headerData,
+    size_t headerSize,
+    bool forceSRGB,
+    DDS_TEXTURE_LAYOUT* layout )
+{
+    if (!headerData || !layout)
+    {
+        return E_INVALIDARG;
+    }
+
+    if (headerSize < (sizeof(uint32_t) + sizeof(DDS_HEADER)) ||
+        *( const uint32_t* )( headerData ) != DDS_MAGIC)
+    {
+        return E_FAIL;
+    }
+
+    auto header = reinterpret_cast<const DDS_HEADER*>( headerData + sizeof( uint32_t ) );
+    if (header->size != sizeof(DDS_HEADER) ||
+        header->ddspf.size != sizeof(DDS_PIXELFORMAT))
+    {
+        return E_FAIL;
+    }
+
+    size_t offset = sizeof(DDS_HEADER) + sizeof(uint32_t);
+    DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+
+    if ((header->ddspf.flags & DDS_FOURCC) && (MAKEFOURCC( 'D', 'X', '1', '0' ) == header->ddspf.fourCC))
+    {
+        offset += sizeof(DDS_HEADER_DXT10);
+        if (headerSize < offset)
+        {
+            return E_FAIL;
+        }
+
+        auto d3d10ext = reinterpret_cast<const DDS_HEADER_DXT10*>( (const char*)header + sizeof(DDS_HEADER) );
+        if (d3d10ext->resourceDimension != D3D12_RESOURCE_DIMENSION_TEXTURE2D ||
+            d3d10ext->arraySize != 1 || (d3d10ext->miscFlag & DDS_RESOURCE_MISC_TEXTURECUBE))
+        {
+            return HRESULT_FROM_WIN32( ERROR_NOT_SUPPORTED );
+        }
+
+        format = d3d10ext->dxgiFormat;
+    }
+    else
+    {
+        if ((header->flags & DDS_HEADER_FLAGS_VOLUME) || (header->caps2 & DDS_CUBEMAP))
+        {
+            return HRESULT_FROM_WIN32( ERROR_NOT_SUPPORTED );
+        }
+
+        format = GetDXGIFormat( header->ddspf );
+    }
+
+    // Palettized and video formats have no simple mip chain
+    if (BitsPerPixel( format ) == 0 || format == DXGI_FORMAT_AI44 || format == DXGI_FORMAT_IA44 ||
+        format == DXGI_FORMAT_P8 || format == DXGI_FORMAT_A8P8)
+    {
+        return HRESULT_FROM_WIN32( ERROR_NOT_SUPPORTED );
+    }
+
+    size_t mipCount = header->mipMapCount == 0 ? 1 : header->mipMapCount;
+    if (mipCount > D3D12_REQ_MIP_LEVELS || header->width == 0 || header->height == 0 ||
+        header->width > D3D12_REQ_TEXTURE2D_U_OR_V_DIMENSION ||
+        header->height > D3D12_REQ_TEXTURE2D_U_OR_V_DIMENSION)
+    {
+        return HRESULT_FROM_WIN32( ERROR_NOT_SUPPORTED );
+    }
+
+    layout->format = forceSRGB ? MakeSRGB( format ) : format;
+    layout->width = header->width;
+    layout->height = header->height;
+    layout->mipCount = (UINT)mipCount;
+
+    size_t w = header->width;
+    size_t h = header->height;
+    for (size_t j = 0; j < mipCount; ++j)
+    {
+        DDS_MIP_LAYOUT& mip = layout->mips[j];
+        GetSurfaceInfo( w, h, format, &mip.numBytes, &mip.rowBytes, &mip.numRows );
+        mip.offset = offset;
+        offset += mip.numBytes;
+
+        w = std::max<size_t>(w >> 1, 1);
+        h = std::max<size_t>(h >> 1, 1);
+    }
+
+    return S_OK;
+}
@@ -36,6 +36,7 @@ enum DDS_ALPHA_MODE
     DDS_ALPHA_MODE_CUSTOM        = 4,
 };
 
+// A batched upload goes through AssetIO, and the texture must not be read until AssetIO::Flush()
 HRESULT __cdecl CreateDDSTextureFromMemory( _In_ ID3D12Device* d3dDevice,
                                                 _In_reads_bytes_(ddsDataSize) const uint8_t* ddsData,
                                                 _In_ size_t ddsDataSize,
@@ -43,7 +44,8 @@ HRESULT __cdecl CreateDDSTextureFromMemory( _In_ ID3D12Device* d3dDevice,
                                                 _In_ bool forceSRGB,
                                                 _Outptr_opt_ ID3D12Resource** texture,
                                                 _In_ D3D12_CPU_DESCRIPTOR_HANDLE textureView,
-                                                _Out_opt_ DDS_ALPHA_MODE* alphaMode = nullptr
+                                                _Out_opt_ DDS_ALPHA_MODE* alphaMode = nullptr,
+                                                _In_ bool batchedUpload = false
                                             );
 
 HRESULT __cdecl CreateDDSTextureFromFile( _In_ ID3D12Device* d3dDevice,
@@ -55,4 +57,32 @@ HRESULT __cdecl CreateDDSTextureFromFile( _In_ ID3D12Device* d3dDevice,
                                             _Out_opt_ DDS_ALPHA_MODE* alphaMode = nullptr
                                             );
 
+// Where each mip of a 2D DDS texture without array slices lies in the file, so that the mips can be read on their
+// own.  The header takes at most DDS_MAX_HEADER_SIZE bytes at the start of the file.
+#define DDS_MAX_HEADER_SIZE 148
+
+struct DDS_MIP_LAYOUT
+{
+    size_t offset;
+    size_t numBytes;
+    size_t rowBytes;
+    size_t numRows;
+};
+
+struct DDS_TEXTURE_LAYOUT
+{
+    DXGI_FORMAT format;
+    UINT width;
+    UINT height;
+    UINT mipCount;
+    DDS_MIP_LAYOUT mips[D3D12_REQ_MIP_LEVELS];
+};
+
+// Fails with ERROR_NOT_SUPPORTED for cube maps, volumes, 1D textures and texture arrays
+HRESULT __cdecl GetDDSTextureLayout( _In_reads_bytes_(headerSize) const uint8_t* headerData,
+                                     _In_ size_t headerSize,
+                                     _In_ bool forceSRGB,
+                                     _Out_ DDS_TEXTURE_LAYOUT* layout
+                                     );
+
 size_t BitsPerPixel(_In_ DXGI_FORMAT fmt);
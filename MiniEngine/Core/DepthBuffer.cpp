@@ -40,23 +40,52 @@ void DepthBuffer::Create( const std::wstring& Name, uint32_t Width, uint32_t Hei
     CreateDerivedViews(Graphics::g_Device, Format);
 }
 
-void DepthBuffer::Create( const std::wstring& Name, uint32_t Width, uint32_t Height, DXGI_FORMAT Format, EsramAllocator& )
+void DepthBuffer::CreateArray( const std::wstring& Name, uint32_t Width, uint32_t Height, uint32_t ArrayCount, DXGI_FORMAT Format, D3D12_GPU_VIRTUAL_ADDRESS VidMemPtr )
+{
+    D3D12_RESOURCE_DESC ResourceDesc = DescribeTex2D(Width, Height, ArrayCount, 1, Format, D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL);
+
+    D3D12_CLEAR_VALUE ClearValue = {};
+    ClearValue.Format = Format;
+    CreateTextureResource(Graphics::g_Device, Name, ResourceDesc, ClearValue, VidMemPtr);
+    CreateDerivedViews(Graphics::g_Device, Format, ArrayCount);
+}
+
+void DepthBuffer::CreateReserved( const std::wstring& Name, uint32_t Width, uint32_t Height, DXGI_FORMAT Format )
+{
+    D3D12_RESOURCE_DESC ResourceDesc = DescribeTex2D(Width, Height, 1, 1, Format, D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL);
+
+    D3D12_CLEAR_VALUE ClearValue = {};
+    ClearValue.Format = Format;
+    CreateReservedTextureResource(Graphics::g_Device, Name, ResourceDesc, ClearValue);
+    CreateDerivedViews(Graphics::g_Device, Format);
+}
+
+void DepthBuffer::Create( const std::wstring& Name, uint32_t Width, uint32_t Height, DXGI_FORMAT Format, EsramAllocator& Allocator )
 {
     Create(Name, Width, Height, Format);
+    Allocator.Place(m_pResource.Get(), Name);
 }
 
-void DepthBuffer::Create( const std::wstring& Name, uint32_t Width, uint32_t Height, uint32_t Samples, DXGI_FORMAT Format, EsramAllocator& )
+void DepthBuffer::Create( const std::wstring& Name, uint32_t Width, uint32_t Height, uint32_t Samples, DXGI_FORMAT Format, EsramAllocator& Allocator )
 {
     Create(Name, Width, Height, Samples, Format);
+    Allocator.Place(m_pResource.Get(), Name);
 }
 
-void DepthBuffer::CreateDerivedViews( ID3D12Device* Device, DXGI_FORMAT Format )
+void DepthBuffer::CreateDerivedViews( ID3D12Device* Device, DXGI_FORMAT Format, uint32_t ArraySize )
 {
     ID3D12Resource* Resource = m_pResource.Get();
 
     D3D12_DEPTH_STENCIL_VIEW_DESC dsvDesc;
     dsvDesc.Format = GetDSVFormat(Format);
-    if (Resource->GetDesc().SampleDesc.Count == 1)
+    if (ArraySize > 1)
+    {
+        dsvDesc.ViewDimension = D3D12_DSV_DIMENSION_TEXTURE2DARRAY;
+        dsvDesc.Texture2DArray.MipSlice = 0;
+        dsvDesc.Texture2DArray.FirstArraySlice = 0;
+        dsvDesc.Texture2DArray.ArraySize = (UINT)ArraySize;
+    }
+    else if (Resource->GetDesc().SampleDesc.Count == 1)
     {
         dsvDesc.ViewDimension = D3D12_DSV_DIMENSION_TEXTURE2D;
         dsvDesc.Texture2D.MipSlice = 0;
@@ -99,13 +128,43 @@ void DepthBuffer::CreateDerivedViews( ID3D12Device* Device, DXGI_FORMAT Format )
         m_hDSV[3] = m_hDSV[1];
     }
 
+    // Per-slice views for rendering into one array slice at a time
+    if (ArraySize > 1)
+    {
+        m_hSliceDSV.resize(ArraySize);
+
+        D3D12_DEPTH_STENCIL_VIEW_DESC sliceDesc = dsvDesc;
+        sliceDesc.Flags = D3D12_DSV_FLAG_NONE;
+        sliceDesc.Texture2DArray.ArraySize = 1;
+
+        for (uint32_t Slice = 0; Slice < ArraySize; ++Slice)
+        {
+            if (m_hSliceDSV[Slice].ptr == 0)
+                m_hSliceDSV[Slice] = Graphics::AllocateDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_DSV);
+
+            sliceDesc.Texture2DArray.FirstArraySlice = Slice;
+            Device->CreateDepthStencilView(Resource, &sliceDesc, m_hSliceDSV[Slice]);
+        }
+    }
+    else
+    {
+        m_hSliceDSV.clear();
+    }
+
     if (m_hDepthSRV.ptr == D3D12_GPU_VIRTUAL_ADDRESS_UNKNOWN)
         m_hDepthSRV = Graphics::AllocateDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
 
     // Create the shader resource view
     D3D12_SHADER_RESOURCE_VIEW_DESC SRVDesc = {};
     SRVDesc.Format = GetDepthFormat(Format);
-    if (dsvDesc.ViewDimension == D3D12_DSV_DIMENSION_TEXTURE2D)
+    if (dsvDesc.ViewDimension == D3D12_DSV_DIMENSION_TEXTURE2DARRAY)
+    {
+        SRVDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
+        SRVDesc.Texture2DArray.MipLevels = 1;
+        SRVDesc.Texture2DArray.FirstArraySlice = 0;
+        SRVDesc.Texture2DArray.ArraySize = (UINT)ArraySize;
+    }
+    else if (dsvDesc.ViewDimension == D3D12_DSV_DIMENSION_TEXTURE2D)
     {
         SRVDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
         SRVDesc.Texture2D.MipLevels = 1;
@@ -47,6 +47,15 @@ public:
     void Create( const std::wstring& Name, uint32_t Width, uint32_t Height, uint32_t NumSamples, DXGI_FORMAT Format,
         EsramAllocator& Allocator );
 
+    // Create a depth buffer array.  The default DSVs and SRV cover every slice, and an additional
+    // DSV is created for each slice so that slices can also be rendered one at a time.
+    void CreateArray( const std::wstring& Name, uint32_t Width, uint32_t Height, uint32_t ArrayCount, DXGI_FORMAT Format,
+        D3D12_GPU_VIRTUAL_ADDRESS VidMemPtr = D3D12_GPU_VIRTUAL_ADDRESS_UNKNOWN );
+
+    // Create a depth buffer backed by a reserved (tiled) resource.  No memory is allocated; the caller
+    // maps 64KB tiles from its own heaps.
+    void CreateReserved( const std::wstring& Name, uint32_t Width, uint32_t Height, DXGI_FORMAT Format );
+
     // Get pre-created CPU-visible descriptor handles
     const D3D12_CPU_DESCRIPTOR_HANDLE& GetDSV() const { return m_hDSV[0]; }
     const D3D12_CPU_DESCRIPTOR_HANDLE& GetDSV_DepthReadOnly() const { return m_hDSV[1]; }
@@ -54,17 +63,19 @@ public:
     const D3D12_CPU_DESCRIPTOR_HANDLE& GetDSV_ReadOnly() const { return m_hDSV[3]; }
     const D3D12_CPU_DESCRIPTOR_HANDLE& GetDepthSRV() const { return m_hDepthSRV; }
     const D3D12_CPU_DESCRIPTOR_HANDLE& GetStencilSRV() const { return m_hStencilSRV; }
+    const D3D12_CPU_DESCRIPTOR_HANDLE& GetSliceDSV( uint32_t Slice ) const { return m_hSliceDSV.empty() ? m_hDSV[0] : m_hSliceDSV[Slice]; }
 
     float GetClearDepth() const { return m_ClearDepth; }
     uint8_t GetClearStencil() const { return m_ClearStencil; }
 
 private:
 
-    void CreateDerivedViews( ID3D12Device* Device, DXGI_FORMAT Format );
+    void CreateDerivedViews( ID3D12Device* Device, DXGI_FORMAT Format, uint32_t ArraySize = 1 );
 
     float m_ClearDepth;
     uint8_t m_ClearStencil;
     D3D12_CPU_DESCRIPTOR_HANDLE m_hDSV[4];
     D3D12_CPU_DESCRIPTOR_HANDLE m_hDepthSRV;
     D3D12_CPU_DESCRIPTOR_HANDLE m_hStencilSRV;
+    std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> m_hSliceDSV;
 };
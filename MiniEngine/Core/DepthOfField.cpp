@@ -28,6 +28,8 @@
 #include "CompiledShaders/DoFPass2FastCS.h"
 #include "CompiledShaders/DoFPass2FixupCS.h"
 #include "CompiledShaders/DoFPass2DebugCS.h"
+#include "CompiledShaders/DoFPass2QuarterCS.h"
+#include "CompiledShaders/DoFUpsampleQuarterCS.h"
 #include "CompiledShaders/DoFMedianFilterCS.h"
 #include "CompiledShaders/DoFMedianFilterSepAlphaCS.h"
 #include "CompiledShaders/DoFMedianFilterFixupCS.h"
@@ -56,6 +58,7 @@ namespace DepthOfField
     BoolVar DebugTiles("Graphics/Depth of Field/Debug Tiles", false);
     BoolVar ForceSlow("Graphics/Depth of Field/Force Slow Path", false);
     BoolVar ForceFast("Graphics/Depth of Field/Force Fast Path", false);
+    BoolVar QuarterResFarField("Graphics/Depth of Field/Quarter Res Far Field", true);
 
     RootSignature s_RootSignature;
 
@@ -71,6 +74,8 @@ namespace DepthOfField
     ComputePSO s_DoFPass2FastCS;            // Perform color-only convolution for near-constant focus
     ComputePSO s_DoFPass2FixupCS;            // Pass through colors again
     ComputePSO s_DoFPass2DebugCS;            // Full pass 2 shader with options for debugging
+    ComputePSO s_DoFPass2QuarterCS;            // Color-only convolution at quarter resolution for the far field
+    ComputePSO s_DoFUpsampleQuarterCS;        // Depth-aware upsample of the far field to half resolution
 
     ComputePSO s_DoFMedianFilterCS;            // 3x3 median filter to reduce fireflies
     ComputePSO s_DoFMedianFilterSepAlphaCS;    // 3x3 median filter to reduce fireflies (separate filter on alpha)
@@ -83,6 +88,15 @@ namespace DepthOfField
     ComputePSO s_DoFDebugBlueCS;            // Output blue to entire tile for debugging
 
     IndirectArgsBuffer s_IndirectParameters;
+    uint64_t s_ClassifiedFrame = ~0ull;        // The frame whose tiles ClassifyTiles() already sorted into queues
+
+    ColorBuffer& GetLinearDepth( void )
+    {
+        return g_LinearDepth[ Graphics::GetFrameCount() % 2 ];
+    }
+
+    void SetConstants( ComputeContext& Context, float FarClipDist );
+    void RenderTiling( ComputeContext& Context );
 }
 
 void DepthOfField::Initialize( void )
@@ -93,7 +107,7 @@ void DepthOfField::Initialize( void )
     s_RootSignature.InitStaticSampler(2, SamplerLinearClampDesc);
     s_RootSignature[0].InitAsConstantBuffer(0);
     s_RootSignature[1].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 0, 6);
-    s_RootSignature[2].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 0, 3);
+    s_RootSignature[2].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 0, 4);
     s_RootSignature[3].InitAsConstants(1, 1);
     s_RootSignature.Finalize(L"Depth of Field");
 
@@ -112,6 +126,8 @@ void DepthOfField::Initialize( void )
     CreatePSO( s_DoFPass2FastCS, g_pDoFPass2FastCS);
     CreatePSO( s_DoFPass2FixupCS, g_pDoFPass2FixupCS);
     CreatePSO( s_DoFPass2DebugCS, g_pDoFPass2DebugCS);
+    CreatePSO( s_DoFPass2QuarterCS, g_pDoFPass2QuarterCS);
+    CreatePSO( s_DoFUpsampleQuarterCS, g_pDoFUpsampleQuarterCS);
     CreatePSO( s_DoFMedianFilterCS, g_pDoFMedianFilterCS );
     CreatePSO( s_DoFMedianFilterSepAlphaCS, g_pDoFMedianFilterSepAlphaCS );
     CreatePSO( s_DoFMedianFilterFixupCS, g_pDoFMedianFilterFixupCS );
@@ -131,8 +147,8 @@ void DepthOfField::Initialize( void )
 
 #undef CreatePSO
 
-    __declspec(align(16)) const uint32_t initArgs[9] = { 0, 1, 1, 0, 1, 1, 0, 1, 1 };
-    s_IndirectParameters.Create(L"DoF Indirect Parameters", 3, sizeof(D3D12_DISPATCH_ARGUMENTS), initArgs);
+    __declspec(align(16)) const uint32_t initArgs[12] = { 0, 1, 1, 0, 1, 1, 0, 1, 1, 0, 1, 1 };
+    s_IndirectParameters.Create(L"DoF Indirect Parameters", 4, sizeof(D3D12_DISPATCH_ARGUMENTS), initArgs);
 }
 
 void DepthOfField::Shutdown( void )
@@ -140,26 +156,18 @@ void DepthOfField::Shutdown( void )
     s_IndirectParameters.Destroy();
 }
 
-void DepthOfField::Render( CommandContext& BaseContext, float /*NearClipDist*/, float FarClipDist )
+void DepthOfField::SetConstants( ComputeContext& Context, float FarClipDist )
 {
-    ScopedTimer _prof(L"Depth of Field", BaseContext);
-
-    if (!g_bTypedUAVLoadSupport_R11G11B10_FLOAT)
-    {
-        WARN_ONCE_IF(!g_bTypedUAVLoadSupport_R11G11B10_FLOAT, "Unable to perform final pass of DoF without support for R11G11B10F UAV loads");
-        Enable = false;
-    }
-
-    ComputeContext& Context = BaseContext.GetComputeContext();
-    Context.SetRootSignature(s_RootSignature);
-
-    ColorBuffer& LinearDepth = g_LinearDepth[ Graphics::GetFrameCount() % 2 ];
+    ColorBuffer& LinearDepth = GetLinearDepth();
 
     uint32_t BufferWidth = (uint32_t)LinearDepth.GetWidth();
     uint32_t BufferHeight = (uint32_t)LinearDepth.GetHeight();
     uint32_t TiledWidth = (uint32_t)g_DoFTileClass[0].GetWidth();
     uint32_t TiledHeight = (uint32_t)g_DoFTileClass[0].GetHeight();
 
+    // Debugging and forcing the slow path want every blurred tile at half resolution
+    const bool UseQuarterRes = QuarterResFarField && !ForceSlow && !DebugMode;
+
     __declspec(align(16)) struct DoFConstantBuffer
     {
         float FocalCenter, FocalSpread;
@@ -171,6 +179,7 @@ void DepthOfField::Render( CommandContext& BaseContext, float /*NearClipDist*/,
         float RcpTiledWidth, RcpTiledHeight;
         uint32_t DebugState, DisablePreFilter;
         float FGRange, RcpFGRange, AntiSparkleFilterStrength;
+        uint32_t QuarterResFarField;
     };
     DoFConstantBuffer cbuffer =
     {
@@ -182,56 +191,103 @@ void DepthOfField::Render( CommandContext& BaseContext, float /*NearClipDist*/,
         TiledWidth, TiledHeight,
         1.0f / TiledWidth, 1.0f / TiledHeight,
         (uint32_t)DebugMode, EnablePreFilter ? 0u : 1u,
-        ForegroundRange / FarClipDist, FarClipDist / ForegroundRange, (float)AntiSparkleWeight
+        ForegroundRange / FarClipDist, FarClipDist / ForegroundRange, (float)AntiSparkleWeight,
+        UseQuarterRes ? 1u : 0u
     };
+    Context.SetRootSignature(s_RootSignature);
     Context.SetDynamicConstantBufferView(0, sizeof(cbuffer), &cbuffer);
+}
 
-    {
-        ScopedTimer _prof2(L"DoF Tiling", Context);
+void DepthOfField::RenderTiling( ComputeContext& Context )
+{
+    ScopedTimer _prof2(L"DoF Tiling", Context);
 
-        // Initial pass to discover max CoC and closest depth in 16x16 tiles
-        Context.TransitionResource(LinearDepth, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
-        Context.TransitionResource(g_DoFTileClass[0], D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
-        Context.SetPipelineState(s_DoFPass1CS);
-        Context.SetDynamicDescriptor(1, 0, LinearDepth.GetSRV());
-        Context.SetDynamicDescriptor(2, 0, g_DoFTileClass[0].GetUAV());
-        Context.Dispatch2D(BufferWidth, BufferHeight, 16, 16);
-
-        Context.ResetCounter(g_DoFWorkQueue);
-        Context.ResetCounter(g_DoFFastQueue);
-        Context.ResetCounter(g_DoFFixupQueue);
-
-        // 3x3 filter to spread max CoC and closest depth to neighboring tiles
-        Context.TransitionResource(g_DoFTileClass[0], D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
-        Context.TransitionResource(g_DoFTileClass[1], D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
-        Context.TransitionResource(g_DoFWorkQueue, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
-        Context.TransitionResource(g_DoFFastQueue, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
-        Context.SetPipelineState(s_DoFTilePassCS);
-        Context.SetDynamicDescriptor(1, 0, g_DoFTileClass[0].GetSRV());
-        Context.SetDynamicDescriptor(2, 0, g_DoFTileClass[1].GetUAV());
-        Context.SetDynamicDescriptor(2, 1, g_DoFWorkQueue.GetUAV());
-        Context.SetDynamicDescriptor(2, 2, g_DoFFastQueue.GetUAV());
-        Context.Dispatch2D(TiledWidth, TiledHeight);
-
-        Context.TransitionResource(g_DoFTileClass[1], D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
-        Context.TransitionResource(g_DoFFixupQueue, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
-        Context.SetPipelineState(s_DoFTilePassFixupCS);
-        Context.SetDynamicDescriptor(1, 0, g_DoFTileClass[1].GetSRV());
-        Context.SetDynamicDescriptor(2, 0, g_DoFFixupQueue.GetUAV());
-        Context.Dispatch2D(TiledWidth, TiledHeight);
-
-        Context.TransitionResource(g_DoFWorkQueue, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
-        Context.CopyCounter(s_IndirectParameters, 0, g_DoFWorkQueue);
-
-        Context.TransitionResource(g_DoFFastQueue, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
-        Context.CopyCounter(s_IndirectParameters, 12, g_DoFFastQueue);
-
-        Context.TransitionResource(g_DoFFixupQueue, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
-        Context.CopyCounter(s_IndirectParameters, 24, g_DoFFixupQueue);
-
-        Context.TransitionResource(s_IndirectParameters, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT);
+    ColorBuffer& LinearDepth = GetLinearDepth();
+
+    uint32_t BufferWidth = (uint32_t)LinearDepth.GetWidth();
+    uint32_t BufferHeight = (uint32_t)LinearDepth.GetHeight();
+    uint32_t TiledWidth = (uint32_t)g_DoFTileClass[0].GetWidth();
+    uint32_t TiledHeight = (uint32_t)g_DoFTileClass[0].GetHeight();
+
+    // Initial pass to discover max CoC and closest depth in 16x16 tiles
+    Context.TransitionResource(LinearDepth, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    Context.TransitionResource(g_DoFTileClass[0], D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    Context.SetPipelineState(s_DoFPass1CS);
+    Context.SetDynamicDescriptor(1, 0, LinearDepth.GetSRV());
+    Context.SetDynamicDescriptor(2, 0, g_DoFTileClass[0].GetUAV());
+    Context.Dispatch2D(BufferWidth, BufferHeight, 16, 16);
+
+    Context.ResetCounter(g_DoFWorkQueue);
+    Context.ResetCounter(g_DoFFastQueue);
+    Context.ResetCounter(g_DoFFixupQueue);
+    Context.ResetCounter(g_DoFFarQueue);
+
+    // 3x3 filter to spread max CoC and closest depth to neighboring tiles
+    Context.TransitionResource(g_DoFTileClass[0], D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    Context.TransitionResource(g_DoFTileClass[1], D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    Context.TransitionResource(g_DoFWorkQueue, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    Context.TransitionResource(g_DoFFastQueue, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    Context.TransitionResource(g_DoFFarQueue, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    Context.SetPipelineState(s_DoFTilePassCS);
+    Context.SetDynamicDescriptor(1, 0, g_DoFTileClass[0].GetSRV());
+    Context.SetDynamicDescriptor(2, 0, g_DoFTileClass[1].GetUAV());
+    Context.SetDynamicDescriptor(2, 1, g_DoFWorkQueue.GetUAV());
+    Context.SetDynamicDescriptor(2, 2, g_DoFFastQueue.GetUAV());
+    Context.SetDynamicDescriptor(2, 3, g_DoFFarQueue.GetUAV());
+    Context.Dispatch2D(TiledWidth, TiledHeight);
+
+    Context.TransitionResource(g_DoFTileClass[1], D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    Context.TransitionResource(g_DoFFixupQueue, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    Context.SetPipelineState(s_DoFTilePassFixupCS);
+    Context.SetDynamicDescriptor(1, 0, g_DoFTileClass[1].GetSRV());
+    Context.SetDynamicDescriptor(2, 0, g_DoFFixupQueue.GetUAV());
+    Context.Dispatch2D(TiledWidth, TiledHeight);
+
+    Context.TransitionResource(g_DoFWorkQueue, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    Context.CopyCounter(s_IndirectParameters, 0, g_DoFWorkQueue);
+
+    Context.TransitionResource(g_DoFFastQueue, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    Context.CopyCounter(s_IndirectParameters, 12, g_DoFFastQueue);
+
+    Context.TransitionResource(g_DoFFixupQueue, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    Context.CopyCounter(s_IndirectParameters, 24, g_DoFFixupQueue);
+
+    Context.TransitionResource(g_DoFFarQueue, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    Context.CopyCounter(s_IndirectParameters, 36, g_DoFFarQueue);
+
+    Context.TransitionResource(s_IndirectParameters, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT);
+}
+
+void DepthOfField::ClassifyTiles( ComputeContext& Context, float FarClipDist )
+{
+    if (!Enable || !g_bTypedUAVLoadSupport_R11G11B10_FLOAT)
+        return;
+
+    SetConstants(Context, FarClipDist);
+    RenderTiling(Context);
+    s_ClassifiedFrame = Graphics::GetFrameCount();
+}
+
+void DepthOfField::Render( CommandContext& BaseContext, float /*NearClipDist*/, float FarClipDist )
+{
+    ScopedTimer _prof(L"Depth of Field", BaseContext);
+
+    if (!g_bTypedUAVLoadSupport_R11G11B10_FLOAT)
+    {
+        WARN_ONCE_IF(!g_bTypedUAVLoadSupport_R11G11B10_FLOAT, "Unable to perform final pass of DoF without support for R11G11B10F UAV loads");
+        Enable = false;
     }
 
+    ComputeContext& Context = BaseContext.GetComputeContext();
+    SetConstants(Context, FarClipDist);
+    g_FrameGraph.BeginPass(Context, kDepthOfFieldPass);
+
+    ColorBuffer& LinearDepth = GetLinearDepth();
+
+    // The tiles only depend on the depth, so they may have been classified on the async compute queue
+    if (s_ClassifiedFrame != Graphics::GetFrameCount())
+        RenderTiling(Context);
+
     {
         ScopedTimer _prof2(L"DoF PreFilter", Context);
 
@@ -255,6 +311,9 @@ void DepthOfField::Render( CommandContext& BaseContext, float /*NearClipDist*/,
         Context.SetDynamicDescriptor(1, 3, g_DoFFastQueue.GetSRV());
         Context.DispatchIndirect(s_IndirectParameters, 12);
 
+        Context.SetDynamicDescriptor(1, 3, g_DoFFarQueue.GetSRV());
+        Context.DispatchIndirect(s_IndirectParameters, 36);
+
         Context.SetPipelineState(s_DoFPreFilterFixupCS);
         Context.SetDynamicDescriptor(1, 3, g_DoFFixupQueue.GetSRV());
         Context.DispatchIndirect(s_IndirectParameters, 24);
@@ -286,6 +345,19 @@ void DepthOfField::Render( CommandContext& BaseContext, float /*NearClipDist*/,
         Context.SetPipelineState(s_DoFPass2FixupCS);
         Context.SetDynamicDescriptor(1, 3, g_DoFFixupQueue.GetSRV());
         Context.DispatchIndirect(s_IndirectParameters, 24);
+
+        // Far field tiles gather at quarter resolution, then upsample into the blur buffers
+        Context.TransitionResource(g_DoFBlurQuarter, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+        Context.SetPipelineState(s_DoFPass2QuarterCS);
+        Context.SetDynamicDescriptor(1, 3, g_DoFFarQueue.GetSRV());
+        Context.SetDynamicDescriptor(2, 0, g_DoFBlurQuarter.GetUAV());
+        Context.DispatchIndirect(s_IndirectParameters, 36);
+
+        Context.TransitionResource(g_DoFBlurQuarter, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        Context.SetPipelineState(s_DoFUpsampleQuarterCS);
+        Context.SetDynamicDescriptor(1, 0, g_DoFBlurQuarter.GetSRV());
+        Context.SetDynamicDescriptor(2, 0, g_DoFBlurColor[0].GetUAV());
+        Context.DispatchIndirect(s_IndirectParameters, 36);
     }
 
     {
@@ -308,6 +380,9 @@ void DepthOfField::Render( CommandContext& BaseContext, float /*NearClipDist*/,
             Context.SetDynamicDescriptor(1, 2, g_DoFFastQueue.GetSRV());
             Context.DispatchIndirect(s_IndirectParameters, 12);
 
+            Context.SetDynamicDescriptor(1, 2, g_DoFFarQueue.GetSRV());
+            Context.DispatchIndirect(s_IndirectParameters, 36);
+
             Context.SetPipelineState(s_DoFMedianFilterFixupCS);
             Context.SetDynamicDescriptor(1, 2, g_DoFFixupQueue.GetSRV());
             Context.DispatchIndirect(s_IndirectParameters, 24);
@@ -332,6 +407,9 @@ void DepthOfField::Render( CommandContext& BaseContext, float /*NearClipDist*/,
             Context.SetDynamicDescriptor(1, 5, g_DoFFastQueue.GetSRV());
             Context.DispatchIndirect(s_IndirectParameters, 12);
 
+            Context.SetDynamicDescriptor(1, 5, g_DoFFarQueue.GetSRV());
+            Context.DispatchIndirect(s_IndirectParameters, 36);
+
             Context.SetPipelineState(s_DoFDebugBlueCS);
             Context.SetDynamicDescriptor(1, 5, g_DoFFixupQueue.GetSRV());
             Context.DispatchIndirect(s_IndirectParameters, 24);
@@ -350,6 +428,9 @@ void DepthOfField::Render( CommandContext& BaseContext, float /*NearClipDist*/,
             Context.SetPipelineState(s_DoFCombineFastCS);
             Context.SetDynamicDescriptor(1, 4, g_DoFFastQueue.GetSRV());
             Context.DispatchIndirect(s_IndirectParameters, 12);
+
+            Context.SetDynamicDescriptor(1, 4, g_DoFFarQueue.GetSRV());
+            Context.DispatchIndirect(s_IndirectParameters, 36);
         }
 
         Context.InsertUAVBarrier(g_SceneColorBuffer);
@@ -22,5 +22,9 @@ namespace DepthOfField
     void Initialize( void );
     void Shutdown( void );
 
+    // Sorts the tiles into the queues of each path ahead of Render(), on any compute context once the linear
+    // depth exists, such as the async compute queue's.  Render() classifies them itself otherwise.
+    void ClassifyTiles( ComputeContext& Context, float FarClipDist );
+
     void Render( CommandContext& BaseContext, float NearClipDist, float FarClipDist );
 }
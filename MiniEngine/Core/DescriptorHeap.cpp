@@ -15,24 +15,52 @@
 #include "DescriptorHeap.h"
 #include "GraphicsCore.h"
 #include "CommandListManager.h"
+#include "GpuMemoryTracker.h"
 
 using namespace Graphics;
 
+namespace
+{
+    // The single descriptors a thread took from each allocator and hasn't handed out yet
+    const uint32_t kMaxCachedDescriptors = 8;
+
+    struct ThreadDescriptorCache
+    {
+        uint32_t Generation;
+        uint32_t NumHandles;
+        D3D12_CPU_DESCRIPTOR_HANDLE Handles[kMaxCachedDescriptors];
+    };
+
+    thread_local ThreadDescriptorCache t_DescriptorCache[D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES];
+}
+
 //
 // DescriptorAllocator implementation
 //
 std::mutex DescriptorAllocator::sm_AllocationMutex;
 std::vector<Microsoft::WRL::ComPtr<ID3D12DescriptorHeap>> DescriptorAllocator::sm_DescriptorHeapPool;
+std::atomic<uint32_t> DescriptorAllocator::sm_Generation(1);
 
 void DescriptorAllocator::DestroyAll(void)
 {
+    std::lock_guard<std::mutex> LockGuard(sm_AllocationMutex);
+
     sm_DescriptorHeapPool.clear();
+    sm_Generation.fetch_add(1, std::memory_order_relaxed);
 }
 
-ID3D12DescriptorHeap* DescriptorAllocator::RequestNewHeap(D3D12_DESCRIPTOR_HEAP_TYPE Type)
+void DescriptorAllocator::ReportStatistics(void)
 {
-    std::lock_guard<std::mutex> LockGuard(sm_AllocationMutex);
+    uint32_t NumHeaps;
+    {
+        std::lock_guard<std::mutex> LockGuard(sm_AllocationMutex);
+        NumHeaps = (uint32_t)sm_DescriptorHeapPool.size();
+    }
+    EngineProfiling::SetCounter("CPU Descriptor Heaps", NumHeaps);
+}
 
+ID3D12DescriptorHeap* DescriptorAllocator::RequestNewHeap(D3D12_DESCRIPTOR_HEAP_TYPE Type)
+{
     D3D12_DESCRIPTOR_HEAP_DESC Desc;
     Desc.Type = Type;
     Desc.NumDescriptors = sm_NumDescriptorsPerHeap;
@@ -41,14 +69,81 @@ ID3D12DescriptorHeap* DescriptorAllocator::RequestNewHeap(D3D12_DESCRIPTOR_HEAP_
 
     Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> pHeap;
     ASSERT_SUCCEEDED(Graphics::g_Device->CreateDescriptorHeap(&Desc, MY_IID_PPV_ARGS(&pHeap)));
+    GpuMemoryTracker::TrackDescriptorHeap(pHeap.Get());
     sm_DescriptorHeapPool.emplace_back(pHeap);
     return pHeap.Get();
 }
 
-D3D12_CPU_DESCRIPTOR_HANDLE DescriptorAllocator::Allocate( uint32_t Count )
+uint32_t DescriptorAllocator::GetSizeClass( uint32_t Count )
+{
+    ASSERT(Count > 0 && Count <= sm_NumDescriptorsPerHeap, "A run of descriptors must fit in one heap");
+
+    uint32_t SizeClass = 0;
+    while ((1u << SizeClass) < Count)
+        ++SizeClass;
+    return SizeClass;
+}
+
+void DescriptorAllocator::ResetIfDestroyed( void )
+{
+    const uint32_t Generation = sm_Generation.load(std::memory_order_relaxed);
+    if (m_Generation == Generation)
+        return;
+
+    m_Generation = Generation;
+    m_CurrentHeap = nullptr;
+    m_RemainingFreeHandles = 0;
+    for (auto& FreeRuns : m_FreeRuns)
+        FreeRuns.clear();
+    m_FreedRuns = std::queue<FreedRun>();
+}
+
+void DescriptorAllocator::RetireFreedRuns( void )
+{
+    while (!m_FreedRuns.empty() && g_CommandManager.IsFenceComplete(m_FreedRuns.front().FenceValue))
+    {
+        m_FreeRuns[m_FreedRuns.front().SizeClass].push_back(m_FreedRuns.front().Handle);
+        m_FreedRuns.pop();
+    }
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE DescriptorAllocator::AllocateRun( uint32_t SizeClass )
 {
+    // Split the smallest free run that is large enough.  Runs are not merged again once freed.
+    for (uint32_t LargerClass = SizeClass; LargerClass < sm_NumSizeClasses; ++LargerClass)
+    {
+        std::vector<D3D12_CPU_DESCRIPTOR_HANDLE>& FreeRuns = m_FreeRuns[LargerClass];
+        if (FreeRuns.empty())
+            continue;
+
+        D3D12_CPU_DESCRIPTOR_HANDLE ret = FreeRuns.back();
+        FreeRuns.pop_back();
+
+        // The upper halves go back on the lists below it
+        while (LargerClass-- > SizeClass)
+        {
+            D3D12_CPU_DESCRIPTOR_HANDLE UpperHalf = ret;
+            UpperHalf.ptr += (1u << LargerClass) * m_DescriptorSize;
+            m_FreeRuns[LargerClass].push_back(UpperHalf);
+        }
+        return ret;
+    }
+
+    const uint32_t Count = 1u << SizeClass;
     if (m_CurrentHeap == nullptr || m_RemainingFreeHandles < Count)
     {
+        // The rest of the last heap is kept for smaller runs
+        while (m_RemainingFreeHandles > 0)
+        {
+            uint32_t TailClass = GetSizeClass(m_RemainingFreeHandles);
+            if ((1u << TailClass) > m_RemainingFreeHandles)
+                --TailClass;
+
+            m_FreeRuns[TailClass].push_back(m_CurrentHandle);
+            m_CurrentHandle.ptr += (1u << TailClass) * m_DescriptorSize;
+            m_RemainingFreeHandles -= 1u << TailClass;
+        }
+
         m_CurrentHeap = RequestNewHeap(m_Type);
         m_CurrentHandle = m_CurrentHeap->GetCPUDescriptorHandleForHeapStart();
         m_RemainingFreeHandles = sm_NumDescriptorsPerHeap;
@@ -63,6 +158,53 @@ D3D12_CPU_DESCRIPTOR_HANDLE DescriptorAllocator::Allocate( uint32_t Count )
     return ret;
 }
 
+D3D12_CPU_DESCRIPTOR_HANDLE DescriptorAllocator::Allocate( uint32_t Count )
+{
+    const uint32_t SizeClass = GetSizeClass(Count);
+
+    if (SizeClass > 0)
+    {
+        std::lock_guard<std::mutex> LockGuard(sm_AllocationMutex);
+        ResetIfDestroyed();
+        RetireFreedRuns();
+        return AllocateRun(SizeClass);
+    }
+
+    ThreadDescriptorCache& Cache = t_DescriptorCache[m_Type];
+    const uint32_t Generation = sm_Generation.load(std::memory_order_relaxed);
+    if (Cache.Generation != Generation)
+    {
+        Cache.Generation = Generation;
+        Cache.NumHandles = 0;
+    }
+
+    if (Cache.NumHandles == 0)
+    {
+        std::lock_guard<std::mutex> LockGuard(sm_AllocationMutex);
+        ResetIfDestroyed();
+        RetireFreedRuns();
+        while (Cache.NumHandles < kMaxCachedDescriptors)
+            Cache.Handles[Cache.NumHandles++] = AllocateRun(0);
+    }
+
+    return Cache.Handles[--Cache.NumHandles];
+}
+
+void DescriptorAllocator::Free( D3D12_CPU_DESCRIPTOR_HANDLE Handle, uint32_t Count )
+{
+    ASSERT(Handle.ptr != 0 && Handle.ptr != D3D12_GPU_VIRTUAL_ADDRESS_UNKNOWN);
+
+    // Contexts copy descriptors while they record, so wait for the next submission as well as the ones before it
+    FreedRun Run;
+    Run.Handle = Handle;
+    Run.SizeClass = GetSizeClass(Count);
+    Run.FenceValue = g_CommandManager.GetGraphicsQueue().GetNextFenceValue();
+
+    std::lock_guard<std::mutex> LockGuard(sm_AllocationMutex);
+    ResetIfDestroyed();
+    m_FreedRuns.push(Run);
+}
+
 //
 // UserDescriptorHeap implementation
 //
@@ -70,6 +212,7 @@ D3D12_CPU_DESCRIPTOR_HANDLE DescriptorAllocator::Allocate( uint32_t Count )
 void UserDescriptorHeap::Create( const std::wstring& DebugHeapName )
 {
     ASSERT_SUCCEEDED(Graphics::g_Device->CreateDescriptorHeap(&m_HeapDesc, MY_IID_PPV_ARGS(m_Heap.ReleaseAndGetAddressOf())));
+    GpuMemoryTracker::TrackDescriptorHeap(m_Heap.Get());
 #ifdef RELEASE
     (void)DebugHeapName;
 #else
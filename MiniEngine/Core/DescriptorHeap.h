@@ -13,6 +13,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <mutex>
 #include <vector>
 #include <queue>
@@ -22,27 +23,59 @@
 // This is an unbounded resource descriptor allocator.  It is intended to provide space for CPU-visible resource descriptors
 // as resources are created.  For those that need to be made shader-visible, they will need to be copied to a UserDescriptorHeap
 // or a DynamicDescriptorHeap.
+//
+// Freed runs of descriptors are recycled, so that resources created and destroyed over a long session don't keep adding
+// heaps.  Runs are sized in powers of two, with a free list per size, and a free run is reused once the GPU has finished
+// the work submitted before it was freed.  Each thread keeps a few single descriptors on hand, which most allocations
+// take without a lock.  Every method can be called from any thread.
 class DescriptorAllocator
 {
 public:
-    DescriptorAllocator(D3D12_DESCRIPTOR_HEAP_TYPE Type) : m_Type(Type), m_CurrentHeap(nullptr) {}
+    DescriptorAllocator(D3D12_DESCRIPTOR_HEAP_TYPE Type) : m_Type(Type), m_CurrentHeap(nullptr), m_DescriptorSize(0),
+        m_RemainingFreeHandles(0), m_Generation(0) {}
 
     D3D12_CPU_DESCRIPTOR_HANDLE Allocate( uint32_t Count );
 
+    // Gives back descriptors from Allocate(), with the count they were allocated with.  Work that uses them must have
+    // been submitted, and they must not be in the persistent region of the DynamicDescriptorHeap.
+    void Free( D3D12_CPU_DESCRIPTOR_HANDLE Handle, uint32_t Count );
+
     static void DestroyAll(void);
 
+    // Lists the descriptor heaps created so far with the profiler's counters
+    static void ReportStatistics(void);
+
 protected:
 
     static const uint32_t sm_NumDescriptorsPerHeap = 256;
-    static std::mutex sm_AllocationMutex;
+    static const uint32_t sm_NumSizeClasses = 9;        // Runs of 1 through sm_NumDescriptorsPerHeap descriptors
+    static std::mutex sm_AllocationMutex;               // Guards the heap pool and the state of every allocator
     static std::vector<Microsoft::WRL::ComPtr<ID3D12DescriptorHeap>> sm_DescriptorHeapPool;
+    static std::atomic<uint32_t> sm_Generation;         // Changes when DestroyAll() releases every heap
     static ID3D12DescriptorHeap* RequestNewHeap( D3D12_DESCRIPTOR_HEAP_TYPE Type );
 
+    static uint32_t GetSizeClass( uint32_t Count );
+
+    // Each of these is called with sm_AllocationMutex held
+    void ResetIfDestroyed( void );
+    void RetireFreedRuns( void );
+    D3D12_CPU_DESCRIPTOR_HANDLE AllocateRun( uint32_t SizeClass );
+
+    struct FreedRun
+    {
+        D3D12_CPU_DESCRIPTOR_HANDLE Handle;
+        uint32_t SizeClass;
+        uint64_t FenceValue;
+    };
+
     D3D12_DESCRIPTOR_HEAP_TYPE m_Type;
     ID3D12DescriptorHeap* m_CurrentHeap;
     D3D12_CPU_DESCRIPTOR_HANDLE m_CurrentHandle;
     uint32_t m_DescriptorSize;
     uint32_t m_RemainingFreeHandles;
+    uint32_t m_Generation;
+    std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> m_FreeRuns[sm_NumSizeClasses];
+    std::queue<FreedRun> m_FreedRuns;                   // Waiting on their fences, in the order they were freed
 };
 
 
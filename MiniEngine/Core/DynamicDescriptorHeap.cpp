@@ -17,6 +17,11 @@
 #include "GraphicsCore.h"
 #include "CommandListManager.h"
 #include "RootSignature.h"
+#include "GpuMemoryTracker.h"
+#include "Hash.h"
+#include <atomic>
+#include <map>
+#include <thread>
 
 using namespace Graphics;
 
@@ -24,78 +29,262 @@ using namespace Graphics;
 // DynamicDescriptorHeap Implementation
 //
 
-std::mutex DynamicDescriptorHeap::sm_Mutex;
-std::vector<Microsoft::WRL::ComPtr<ID3D12DescriptorHeap>> DynamicDescriptorHeap::sm_DescriptorHeapPool[2];
-std::queue<std::pair<uint64_t, ID3D12DescriptorHeap*>> DynamicDescriptorHeap::sm_RetiredDescriptorHeaps[2];
-std::queue<ID3D12DescriptorHeap*> DynamicDescriptorHeap::sm_AvailableDescriptorHeaps[2];
-
-ID3D12DescriptorHeap* DynamicDescriptorHeap::RequestDescriptorHeap(D3D12_DESCRIPTOR_HEAP_TYPE HeapType)
+namespace
 {
-    std::lock_guard<std::mutex> LockGuard(sm_Mutex);
+    // The CBV_SRV_UAV ring is in blocks as large as a table can need.  Shader-visible sampler heaps are limited
+    // to 2048 descriptors.
+    const uint32_t kViewBlockSize = 1024;
+    const uint32_t kNumViewBlocks = 256;
+    const uint32_t kSamplerBlockSize = 256;
+    const uint32_t kNumSamplerBlocks = 7;
+
+    // The sampler heap starts with every distinct sampler table that has been bound.  There are few, and their
+    // handles never change, so each is copied once and bound from there.  Tables only go through the ring once
+    // the region is full.
+    const uint32_t kNumPersistentSamplers = 256;
+
+    // There is one copy of the persistent region per frame in flight, so that it can be refreshed while the GPU
+    // still reads an older copy
+    const uint32_t kNumPersistentCopies = 3;
+
+    struct RingBlock
+    {
+        // The block numbers handed out by the ring grow forever, and one of them uses the slot once the context
+        // before it releases the slot and its fence passes
+        std::atomic<uint64_t> NextUser;
+        std::atomic<uint64_t> Fence;
+    };
+
+    struct DescriptorRing
+    {
+        Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> Heap;
+        DescriptorHandle FirstBlock;
+        uint32_t BlockSize;
+        uint32_t NumBlocks;
+        std::atomic<uint64_t> NextBlock;
+        std::unique_ptr<RingBlock[]> Blocks;
+    };
+
+    struct PersistentCopy
+    {
+        uint64_t Version;
+        uint32_t NumOpenContexts;
+        uint64_t Fences[4];         // The last fence of each queue type that used the copy
+    };
+
+    std::mutex s_Mutex;
+    DescriptorRing s_Rings[2];
+    std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> s_PersistentHandles;
+    PersistentCopy s_PersistentCopies[kNumPersistentCopies];
+    uint32_t s_CurrentPersistentCopy = 0;
+    uint64_t s_PersistentVersion = 0;
+    std::atomic<uint32_t> s_DescriptorsCopied[2];
+    std::map<size_t, uint32_t> s_SamplerTables;     // Hash of the handles to the table's offset in the region
+    uint32_t s_NumPersistentSamplers = 0;
+
+    void CreateRing( D3D12_DESCRIPTOR_HEAP_TYPE Type, uint32_t BlockSize, uint32_t NumBlocks, uint32_t NumReserved )
+    {
+        DescriptorRing& Ring = s_Rings[Type == D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER ? 1 : 0];
 
-    uint32_t idx = HeapType == D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER ? 1 : 0;
+        D3D12_DESCRIPTOR_HEAP_DESC HeapDesc = {};
+        HeapDesc.Type = Type;
+        HeapDesc.NumDescriptors = NumReserved + BlockSize * NumBlocks;
+        HeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+        HeapDesc.NodeMask = 1;
+        ASSERT_SUCCEEDED(g_Device->CreateDescriptorHeap(&HeapDesc, MY_IID_PPV_ARGS(&Ring.Heap)));
+        GpuMemoryTracker::TrackDescriptorHeap(Ring.Heap.Get());
+        Ring.Heap->SetName(Type == D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER ? L"Dynamic Sampler Ring" : L"Dynamic Descriptor Ring");
+
+        Ring.FirstBlock = DescriptorHandle(Ring.Heap->GetCPUDescriptorHandleForHeapStart(), Ring.Heap->GetGPUDescriptorHandleForHeapStart());
+        Ring.FirstBlock += NumReserved * g_Device->GetDescriptorHandleIncrementSize(Type);
+        Ring.BlockSize = BlockSize;
+        Ring.NumBlocks = NumBlocks;
+        Ring.NextBlock = 0;
+        Ring.Blocks.reset(new RingBlock[NumBlocks]);
+        for (uint32_t i = 0; i < NumBlocks; ++i)
+        {
+            Ring.Blocks[i].NextUser = i;
+            Ring.Blocks[i].Fence = 0;
+        }
+    }
 
-    while (!sm_RetiredDescriptorHeaps[idx].empty() && g_CommandManager.IsFenceComplete(sm_RetiredDescriptorHeaps[idx].front().first))
+    void CopyPersistentDescriptors( uint32_t Copy, UINT Offset, UINT NumHandles )
     {
-        sm_AvailableDescriptorHeaps[idx].push(sm_RetiredDescriptorHeaps[idx].front().second);
-        sm_RetiredDescriptorHeaps[idx].pop();
+        const uint32_t DescriptorSize = g_Device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+        D3D12_CPU_DESCRIPTOR_HANDLE Dest = s_Rings[0].Heap->GetCPUDescriptorHandleForHeapStart();
+        Dest.ptr += (Copy * DynamicDescriptorHeap::kNumPersistentDescriptors + Offset) * DescriptorSize;
+
+        // Skip over descriptors that were never set
+        for (UINT i = Offset; i < Offset + NumHandles; ++i, Dest.ptr += DescriptorSize)
+        {
+            if (s_PersistentHandles[i].ptr != 0)
+                g_Device->CopyDescriptorsSimple(1, Dest, s_PersistentHandles[i], D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+        }
     }
 
-    if (!sm_AvailableDescriptorHeaps[idx].empty())
+    // Returns the copy of the persistent region that a context should use, bringing the next copy up to date
+    // first when the region was refreshed and the GPU is done with that copy.  The caller holds the lock.
+    uint32_t OpenPersistentCopy( void )
     {
-        ID3D12DescriptorHeap* HeapPtr = sm_AvailableDescriptorHeaps[idx].front();
-        sm_AvailableDescriptorHeaps[idx].pop();
-        return HeapPtr;
+        if (s_PersistentCopies[s_CurrentPersistentCopy].Version != s_PersistentVersion)
+        {
+            const uint32_t Next = (s_CurrentPersistentCopy + 1) % kNumPersistentCopies;
+            PersistentCopy& Copy = s_PersistentCopies[Next];
+
+            bool Idle = Copy.NumOpenContexts == 0;
+            for (uint64_t Fence : Copy.Fences)
+                Idle = Idle && (Fence == 0 || g_CommandManager.IsFenceComplete(Fence));
+
+            if (Idle)
+            {
+                CopyPersistentDescriptors(Next, 0, (UINT)s_PersistentHandles.size());
+                Copy.Version = s_PersistentVersion;
+                for (uint64_t& Fence : Copy.Fences)
+                    Fence = 0;
+                s_CurrentPersistentCopy = Next;
+            }
+        }
+
+        ++s_PersistentCopies[s_CurrentPersistentCopy].NumOpenContexts;
+        return s_CurrentPersistentCopy;
     }
-    else
+
+    // Finds the offset of the sampler table in the persistent region, copying it there the first time it is
+    // seen.  Returns false when the region has no room left.
+    bool FindPersistentSamplerTable( UINT NumHandles, const D3D12_CPU_DESCRIPTOR_HANDLE Handles[], uint32_t& Offset, uint32_t& NumCopied )
     {
-        D3D12_DESCRIPTOR_HEAP_DESC HeapDesc = {};
-        HeapDesc.Type = HeapType;
-        HeapDesc.NumDescriptors = kNumDescriptorsPerHeap;
-        HeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
-        HeapDesc.NodeMask = 1;
-        Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> HeapPtr;
-        ASSERT_SUCCEEDED(g_Device->CreateDescriptorHeap(&HeapDesc, MY_IID_PPV_ARGS(&HeapPtr)));
-        sm_DescriptorHeapPool[idx].emplace_back(HeapPtr);
-        return HeapPtr.Get();
+        const size_t HashValue = Utility::HashState(Handles, NumHandles);
+
+        std::lock_guard<std::mutex> LockGuard(s_Mutex);
+
+        auto iter = s_SamplerTables.find(HashValue);
+        if (iter != s_SamplerTables.end())
+        {
+            Offset = iter->second;
+            return true;
+        }
+
+        if (s_NumPersistentSamplers + NumHandles > kNumPersistentSamplers)
+            return false;
+
+        Offset = s_NumPersistentSamplers;
+        s_NumPersistentSamplers += NumHandles;
+        s_SamplerTables[HashValue] = Offset;
+
+        const uint32_t DescriptorSize = g_Device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER);
+        D3D12_CPU_DESCRIPTOR_HANDLE Dest = s_Rings[1].Heap->GetCPUDescriptorHandleForHeapStart();
+        Dest.ptr += Offset * DescriptorSize;
+
+        for (UINT i = 0; i < NumHandles; ++i, Dest.ptr += DescriptorSize)
+        {
+            if (Handles[i].ptr != 0)
+            {
+                g_Device->CopyDescriptorsSimple(1, Dest, Handles[i], D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER);
+                ++NumCopied;
+            }
+        }
+        return true;
     }
 }
 
-void DynamicDescriptorHeap::DiscardDescriptorHeaps( D3D12_DESCRIPTOR_HEAP_TYPE HeapType, uint64_t FenceValue, const std::vector<ID3D12DescriptorHeap*>& UsedHeaps )
+void DynamicDescriptorHeap::Initialize( void )
 {
-    uint32_t idx = HeapType == D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER ? 1 : 0;
-    std::lock_guard<std::mutex> LockGuard(sm_Mutex);
-    for (auto iter = UsedHeaps.begin(); iter != UsedHeaps.end(); ++iter)
-        sm_RetiredDescriptorHeaps[idx].push(std::make_pair(FenceValue, *iter));
+    CreateRing(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, kViewBlockSize, kNumViewBlocks, kNumPersistentDescriptors * kNumPersistentCopies);
+    CreateRing(D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER, kSamplerBlockSize, kNumSamplerBlocks, kNumPersistentSamplers);
+    s_SamplerTables.clear();
+    s_NumPersistentSamplers = 0;
+
+    for (PersistentCopy& Copy : s_PersistentCopies)
+        Copy = {};
+    s_CurrentPersistentCopy = 0;
+    s_PersistentVersion = 0;
 }
 
-void DynamicDescriptorHeap::RetireCurrentHeap( void )
+void DynamicDescriptorHeap::DestroyAll( void )
 {
-    // Don't retire unused heaps.
-    if (m_CurrentOffset == 0)
+    for (DescriptorRing& Ring : s_Rings)
     {
-        ASSERT(m_CurrentHeapPtr == nullptr);
-        return;
+        Ring.Heap = nullptr;
+        Ring.Blocks.reset();
     }
+    s_PersistentHandles.clear();
+    s_SamplerTables.clear();
+    s_NumPersistentSamplers = 0;
+}
 
-    ASSERT(m_CurrentHeapPtr != nullptr);
-    m_RetiredHeaps.push_back(m_CurrentHeapPtr);
-    m_CurrentHeapPtr = nullptr;
+void DynamicDescriptorHeap::ReportStatistics( void )
+{
+    EngineProfiling::SetCounter("View Descriptors Copied", s_DescriptorsCopied[0].exchange(0));
+    EngineProfiling::SetCounter("Sampler Descriptors Copied", s_DescriptorsCopied[1].exchange(0));
+}
+
+void DynamicDescriptorHeap::SetPersistentDescriptors( UINT Offset, UINT NumHandles, const D3D12_CPU_DESCRIPTOR_HANDLE Handles[] )
+{
+    ASSERT(Offset + NumHandles <= kNumPersistentDescriptors, "Exceeded the persistent descriptor region");
+
+    // Every copy may still be in use by the GPU
+    g_CommandManager.IdleGPU();
+
+    std::lock_guard<std::mutex> LockGuard(s_Mutex);
+
+    if (s_PersistentHandles.size() < Offset + NumHandles)
+        s_PersistentHandles.resize(Offset + NumHandles, D3D12_CPU_DESCRIPTOR_HANDLE{ 0 });
+    for (UINT i = 0; i < NumHandles; ++i)
+        s_PersistentHandles[Offset + i] = Handles[i];
+
+    for (uint32_t Copy = 0; Copy < kNumPersistentCopies; ++Copy)
+        CopyPersistentDescriptors(Copy, Offset, NumHandles);
+}
+
+void DynamicDescriptorHeap::RefreshPersistentDescriptors( void )
+{
+    std::lock_guard<std::mutex> LockGuard(s_Mutex);
+    ++s_PersistentVersion;
+}
+
+void DynamicDescriptorHeap::RequestBlock( void )
+{
+    RetireCurrentBlock();
+
+    DescriptorRing& Ring = s_Rings[m_DescriptorType == D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER ? 1 : 0];
+    ASSERT(Ring.Heap != nullptr, "DynamicDescriptorHeap::Initialize() has not been called");
+
+    const uint64_t Block = Ring.NextBlock.fetch_add(1);
+    RingBlock& Slot = Ring.Blocks[Block % Ring.NumBlocks];
+
+    // The context that had the slot one lap ago may still be recording
+    while (Slot.NextUser.load(std::memory_order_acquire) != Block)
+        std::this_thread::yield();
+
+    const uint64_t Fence = Slot.Fence.load(std::memory_order_relaxed);
+    if (Fence != 0)
+        g_CommandManager.WaitForFence(Fence);
+
+    m_CurrentBlock = Block;
     m_CurrentOffset = 0;
+    m_FirstDescriptor = Ring.FirstBlock + (uint32_t)(Block % Ring.NumBlocks) * Ring.BlockSize * m_DescriptorSize;
 }
 
-void DynamicDescriptorHeap::RetireUsedHeaps( uint64_t fenceValue )
+void DynamicDescriptorHeap::RetireCurrentBlock( void )
 {
-    DiscardDescriptorHeaps(m_DescriptorType, fenceValue, m_RetiredHeaps);
-    m_RetiredHeaps.clear();
+    if (m_CurrentBlock == kNoBlock)
+        return;
+
+    m_RetiredBlocks.push_back(m_CurrentBlock);
+    m_CurrentBlock = kNoBlock;
+    m_CurrentOffset = 0;
 }
 
 DynamicDescriptorHeap::DynamicDescriptorHeap(CommandContext& OwningContext, D3D12_DESCRIPTOR_HEAP_TYPE HeapType)
     : m_OwningContext(OwningContext), m_DescriptorType(HeapType)
 {
     m_CurrentHeapPtr = nullptr;
+    m_CurrentBlock = kNoBlock;
     m_CurrentOffset = 0;
+    m_PersistentCopy = kNoPersistentCopy;
+    m_NumDescriptorsCopied = 0;
     m_DescriptorSize = Graphics::g_Device->GetDescriptorHandleIncrementSize(HeapType);
+    m_BlockSize = HeapType == D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER ? kSamplerBlockSize : kViewBlockSize;
 }
 
 DynamicDescriptorHeap::~DynamicDescriptorHeap()
@@ -104,8 +293,35 @@ DynamicDescriptorHeap::~DynamicDescriptorHeap()
 
 void DynamicDescriptorHeap::CleanupUsedHeaps( uint64_t fenceValue )
 {
-    RetireCurrentHeap();
-    RetireUsedHeaps(fenceValue);
+    const uint32_t idx = m_DescriptorType == D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER ? 1 : 0;
+    DescriptorRing& Ring = s_Rings[idx];
+
+    RetireCurrentBlock();
+    for (uint64_t Block : m_RetiredBlocks)
+    {
+        RingBlock& Slot = Ring.Blocks[Block % Ring.NumBlocks];
+        Slot.Fence.store(fenceValue, std::memory_order_relaxed);
+        Slot.NextUser.store(Block + Ring.NumBlocks, std::memory_order_release);
+    }
+    m_RetiredBlocks.clear();
+
+    if (m_PersistentCopy != kNoPersistentCopy)
+    {
+        std::lock_guard<std::mutex> LockGuard(s_Mutex);
+        PersistentCopy& Copy = s_PersistentCopies[m_PersistentCopy];
+        uint64_t& Fence = Copy.Fences[fenceValue >> 56];
+        Fence = std::max(Fence, fenceValue);
+        --Copy.NumOpenContexts;
+        m_PersistentCopy = kNoPersistentCopy;
+    }
+
+    if (m_NumDescriptorsCopied > 0)
+    {
+        s_DescriptorsCopied[idx].fetch_add(m_NumDescriptorsCopied, std::memory_order_relaxed);
+        m_NumDescriptorsCopied = 0;
+    }
+
+    m_CurrentHeapPtr = nullptr;
     m_GraphicsHandleCache.ClearCache();
     m_ComputeHandleCache.ClearCache();
 }
@@ -114,16 +330,44 @@ inline ID3D12DescriptorHeap* DynamicDescriptorHeap::GetHeapPointer()
 {
     if (m_CurrentHeapPtr == nullptr)
     {
-        ASSERT(m_CurrentOffset == 0);
-        m_CurrentHeapPtr = RequestDescriptorHeap(m_DescriptorType);
-        m_FirstDescriptor = DescriptorHandle(
-            m_CurrentHeapPtr->GetCPUDescriptorHandleForHeapStart(),
-            m_CurrentHeapPtr->GetGPUDescriptorHandleForHeapStart());
+        m_CurrentHeapPtr = s_Rings[m_DescriptorType == D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER ? 1 : 0].Heap.Get();
+        ASSERT(m_CurrentHeapPtr != nullptr, "DynamicDescriptorHeap::Initialize() has not been called");
+
+        // The context uses the same copy of the persistent region until it finishes
+        if (m_DescriptorType == D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV)
+        {
+            {
+                std::lock_guard<std::mutex> LockGuard(s_Mutex);
+                m_PersistentCopy = OpenPersistentCopy();
+            }
+            m_PersistentStart = m_CurrentHeapPtr->GetGPUDescriptorHandleForHeapStart();
+            m_PersistentStart.ptr += m_PersistentCopy * kNumPersistentDescriptors * m_DescriptorSize;
+        }
+        else
+        {
+            m_PersistentStart = m_CurrentHeapPtr->GetGPUDescriptorHandleForHeapStart();
+        }
     }
 
     return m_CurrentHeapPtr;
 }
 
+ID3D12DescriptorHeap* DynamicDescriptorHeap::GetShaderVisibleHeap( D3D12_DESCRIPTOR_HEAP_TYPE Type )
+{
+    return s_Rings[Type == D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER ? 1 : 0].Heap.Get();
+}
+
+D3D12_GPU_DESCRIPTOR_HANDLE DynamicDescriptorHeap::GetPersistentHandle( UINT Offset )
+{
+    ASSERT(m_DescriptorType == D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, "Only the view heap has a persistent region");
+    ASSERT(Offset < kNumPersistentDescriptors);
+
+    GetHeapPointer();
+    D3D12_GPU_DESCRIPTOR_HANDLE Handle = m_PersistentStart;
+    Handle.ptr += Offset * m_DescriptorSize;
+    return Handle;
+}
+
 uint32_t DynamicDescriptorHeap::DescriptorHandleCache::ComputeStagedSize()
 {
     // Sum the maximum assigned offsets of stale descriptor tables to determine total needed space.
@@ -245,21 +489,66 @@ void DynamicDescriptorHeap::DescriptorHandleCache::CopyAndBindStaleTables(
         NumSrcDescriptorRanges, pSrcDescriptorRangeStarts, pSrcDescriptorRangeSizes,
         Type);
 }
+
+void DynamicDescriptorHeap::DescriptorHandleCache::BindStalePersistentTables(
+    uint32_t DescriptorSize, D3D12_GPU_DESCRIPTOR_HANDLE PersistentStart, ID3D12GraphicsCommandList* CmdList,
+    void (STDMETHODCALLTYPE ID3D12GraphicsCommandList::*SetFunc)(UINT, D3D12_GPU_DESCRIPTOR_HANDLE))
+{
+    unsigned long RootIndex;
+    while (_BitScanForward(&RootIndex, m_StalePersistentTablesBitMap))
+    {
+        m_StalePersistentTablesBitMap ^= (1 << RootIndex);
+
+        D3D12_GPU_DESCRIPTOR_HANDLE TableStart = PersistentStart;
+        TableStart.ptr += m_PersistentTableOffset[RootIndex] * DescriptorSize;
+        (CmdList->*SetFunc)(RootIndex, TableStart);
+    }
+}
     
 void DynamicDescriptorHeap::CopyAndBindStagedTables( DescriptorHandleCache& HandleCache, ID3D12GraphicsCommandList* CmdList,
     void (STDMETHODCALLTYPE ID3D12GraphicsCommandList::*SetFunc)(UINT, D3D12_GPU_DESCRIPTOR_HANDLE))
 {
-    uint32_t NeededSize = HandleCache.ComputeStagedSize();
-    if (!HasSpace(NeededSize))
+    // Tables already bound stay valid when a new block is needed, since every block is in the same heap
+    m_OwningContext.SetDescriptorHeap(m_DescriptorType, GetHeapPointer());
+    HandleCache.BindStalePersistentTables(m_DescriptorSize, m_PersistentStart, CmdList, SetFunc);
+    if (m_DescriptorType == D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER)
+        HandleCache.BindStaleSamplerTables(m_DescriptorSize, m_PersistentStart, m_NumDescriptorsCopied, CmdList, SetFunc);
+    if (HandleCache.m_StaleRootParamsBitMap != 0)
+        HandleCache.CopyAndBindStaleTables(m_DescriptorType, m_DescriptorSize, Allocate(HandleCache.ComputeStagedSize()), CmdList, SetFunc);
+}
+
+void DynamicDescriptorHeap::DescriptorHandleCache::BindStaleSamplerTables(
+    uint32_t DescriptorSize, D3D12_GPU_DESCRIPTOR_HANDLE PersistentStart, uint32_t& NumCopied, ID3D12GraphicsCommandList* CmdList,
+    void (STDMETHODCALLTYPE ID3D12GraphicsCommandList::*SetFunc)(UINT, D3D12_GPU_DESCRIPTOR_HANDLE))
+{
+    D3D12_CPU_DESCRIPTOR_HANDLE Table[kMaxNumDescriptors];
+
+    unsigned long RootIndex;
+    uint32_t StaleParams = m_StaleRootParamsBitMap;
+    while (_BitScanForward(&RootIndex, StaleParams))
     {
-        RetireCurrentHeap();
-        UnbindAllValid();
-        NeededSize = HandleCache.ComputeStagedSize();
-    }
+        StaleParams ^= (1 << RootIndex);
 
-    // This can trigger the creation of a new heap
-    m_OwningContext.SetDescriptorHeap(m_DescriptorType, GetHeapPointer());
-    HandleCache.CopyAndBindStaleTables(m_DescriptorType, m_DescriptorSize, Allocate(NeededSize), CmdList, SetFunc);
+        // Handles left unset by this table may be from an earlier root signature
+        const DescriptorTableCache& RootDescTable = m_RootDescriptorTable[RootIndex];
+        unsigned long MaxSetHandle;
+        _BitScanReverse(&MaxSetHandle, RootDescTable.AssignedHandlesBitMap);
+        for (uint32_t i = 0; i <= MaxSetHandle; ++i)
+        {
+            const bool IsSet = (RootDescTable.AssignedHandlesBitMap & (1 << i)) != 0;
+            Table[i].ptr = IsSet ? RootDescTable.TableStart[i].ptr : 0;
+        }
+
+        uint32_t Offset;
+        if (!FindPersistentSamplerTable(MaxSetHandle + 1, Table, Offset, NumCopied))
+            continue;
+
+        m_StaleRootParamsBitMap ^= (1 << RootIndex);
+
+        D3D12_GPU_DESCRIPTOR_HANDLE TableStart = PersistentStart;
+        TableStart.ptr += Offset * DescriptorSize;
+        (CmdList->*SetFunc)(RootIndex, TableStart);
+    }
 }
 
 void DynamicDescriptorHeap::UnbindAllValid( void )
@@ -270,16 +559,9 @@ void DynamicDescriptorHeap::UnbindAllValid( void )
 
 D3D12_GPU_DESCRIPTOR_HANDLE DynamicDescriptorHeap::UploadDirect( D3D12_CPU_DESCRIPTOR_HANDLE Handle )
 {
-    if (!HasSpace(1))
-    {
-        RetireCurrentHeap();
-        UnbindAllValid();
-    }
-
     m_OwningContext.SetDescriptorHeap(m_DescriptorType, GetHeapPointer());
 
-    DescriptorHandle DestHandle = m_FirstDescriptor + m_CurrentOffset * m_DescriptorSize;
-    m_CurrentOffset += 1;
+    DescriptorHandle DestHandle = Allocate(1);
 
     g_Device->CopyDescriptorsSimple(1, DestHandle.GetCpuHandle(), Handle, m_DescriptorType);
 
@@ -289,6 +571,7 @@ D3D12_GPU_DESCRIPTOR_HANDLE DynamicDescriptorHeap::UploadDirect( D3D12_CPU_DESCR
 void DynamicDescriptorHeap::DescriptorHandleCache::UnbindAllValid()
 {
     m_StaleRootParamsBitMap = 0;
+    m_StalePersistentTablesBitMap = m_PersistentTablesBitMap;
 
     unsigned long TableParams = m_RootDescriptorTablesBitMap;
     unsigned long RootIndex;
@@ -313,6 +596,16 @@ void DynamicDescriptorHeap::DescriptorHandleCache::StageDescriptorHandles( UINT
     m_StaleRootParamsBitMap |= (1 << RootIndex);
 }
 
+void DynamicDescriptorHeap::DescriptorHandleCache::StagePersistentTable( UINT RootIndex, UINT Offset )
+{
+    ASSERT(((1 << RootIndex) & m_PersistentRootParamsBitMap) != 0, "Root parameter is not a persistent descriptor table");
+    ASSERT(Offset < kNumPersistentDescriptors);
+
+    m_PersistentTableOffset[RootIndex] = Offset;
+    m_PersistentTablesBitMap |= (1 << RootIndex);
+    m_StalePersistentTablesBitMap |= (1 << RootIndex);
+}
+
 void DynamicDescriptorHeap::DescriptorHandleCache::ParseRootSignature( D3D12_DESCRIPTOR_HEAP_TYPE Type, const RootSignature& RootSig )
 {
     UINT CurrentOffset = 0;
@@ -320,6 +613,9 @@ void DynamicDescriptorHeap::DescriptorHandleCache::ParseRootSignature( D3D12_DES
     ASSERT(RootSig.m_NumParameters <= 16, "Maybe we need to support something greater");
 
     m_StaleRootParamsBitMap = 0;
+    m_PersistentTablesBitMap = 0;
+    m_StalePersistentTablesBitMap = 0;
+    m_PersistentRootParamsBitMap = (Type == D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER ? 0 : RootSig.m_PersistentTableBitMap);
     m_RootDescriptorTablesBitMap = (Type == D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER ?
         RootSig.m_SamplerTableBitMap : RootSig.m_DescriptorTableBitMap);
 
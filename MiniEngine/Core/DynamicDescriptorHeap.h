@@ -16,27 +16,48 @@
 #include "DescriptorHeap.h"
 #include "RootSignature.h"
 #include <vector>
-#include <queue>
 
 namespace Graphics
 {
     extern ID3D12Device* g_Device;
 }
 
-// This class is a linear allocation system for dynamically generated descriptor tables.  It internally caches
-// CPU descriptor handles so that when not enough space is available in the current heap, necessary descriptors
-// can be re-copied to the new heap.
+// This class is a linear allocation system for dynamically generated descriptor tables.  Every context allocates
+// from one shader-visible heap per descriptor type, which is managed as a ring of blocks.  A context reserves a
+// block at a time with an atomic increment, and a block is reused once the fence of the context that last used
+// it has passed.  Since the heap never changes, tables bound from an earlier block stay valid, and command lists
+// never switch descriptor heaps.  Sampler tables are instead copied once into the start of the sampler heap, the
+// first time each distinct table is bound, and bound from there.
 class DynamicDescriptorHeap
 {
 public:
     DynamicDescriptorHeap(CommandContext& OwningContext, D3D12_DESCRIPTOR_HEAP_TYPE HeapType);
     ~DynamicDescriptorHeap();
 
-    static void DestroyAll(void)
-    {
-        sm_DescriptorHeapPool[0].clear();
-        sm_DescriptorHeapPool[1].clear();
-    }
+    static void Initialize(void);
+    static void DestroyAll(void);
+
+    // Lists the descriptors copied since the last call with the profiler's counters.  They are counted when
+    // their context finishes.
+    static void ReportStatistics(void);
+
+    // The CBV_SRV_UAV heap starts with copies of a region of descriptors that stay put, so that descriptor tables
+    // can point into it without re-copying anything.  Copies the handles into every copy of the region.  The
+    // application decides how the region is divided up.  Waits for the GPU.
+    static const uint32_t kNumPersistentDescriptors = 2048;
+    static void SetPersistentDescriptors( UINT Offset, UINT NumHandles, const D3D12_CPU_DESCRIPTOR_HANDLE Handles[] );
+
+    // Call after rewriting the descriptors a persistent handle points to.  Does not wait: the region is copied
+    // again into a copy the GPU is done with, which contexts use from then on, so work recorded before the call
+    // keeps seeing the old descriptors.
+    static void RefreshPersistentDescriptors( void );
+
+    // The shader-visible heap every context binds for the type, which bundles that set tables must also set
+    static ID3D12DescriptorHeap* GetShaderVisibleHeap( D3D12_DESCRIPTOR_HEAP_TYPE Type );
+
+    // The GPU handle of a descriptor in the context's copy of the persistent region, for tables bound outside of
+    // the cache, as bundles do.  It is only valid for work recorded on this context until it finishes.
+    D3D12_GPU_DESCRIPTOR_HANDLE GetPersistentHandle( UINT Offset );
 
     void CleanupUsedHeaps( uint64_t fenceValue );
 
@@ -51,6 +72,17 @@ public:
         m_ComputeHandleCache.StageDescriptorHandles(RootIndex, Offset, NumHandles, Handles);
     }
 
+    // Point a persistent descriptor table of the root signature at a descriptor of the persistent region
+    void SetGraphicsPersistentTable( UINT RootIndex, UINT Offset )
+    {
+        m_GraphicsHandleCache.StagePersistentTable(RootIndex, Offset);
+    }
+
+    void SetComputePersistentTable( UINT RootIndex, UINT Offset )
+    {
+        m_ComputeHandleCache.StagePersistentTable(RootIndex, Offset);
+    }
+
     // Bypass the cache and upload directly to the shader-visible heap
     D3D12_GPU_DESCRIPTOR_HANDLE UploadDirect( D3D12_CPU_DESCRIPTOR_HANDLE Handles );
 
@@ -68,37 +100,34 @@ public:
     // Upload any new descriptors in the cache to the shader-visible heap.
     inline void CommitGraphicsRootDescriptorTables( ID3D12GraphicsCommandList* CmdList )
     {
-        if (m_GraphicsHandleCache.m_StaleRootParamsBitMap != 0)
+        if ((m_GraphicsHandleCache.m_StaleRootParamsBitMap | m_GraphicsHandleCache.m_StalePersistentTablesBitMap) != 0)
             CopyAndBindStagedTables(m_GraphicsHandleCache, CmdList, &ID3D12GraphicsCommandList::SetGraphicsRootDescriptorTable);
     }
 
     inline void CommitComputeRootDescriptorTables( ID3D12GraphicsCommandList* CmdList )
     {
-        if (m_ComputeHandleCache.m_StaleRootParamsBitMap != 0)
+        if ((m_ComputeHandleCache.m_StaleRootParamsBitMap | m_ComputeHandleCache.m_StalePersistentTablesBitMap) != 0)
             CopyAndBindStagedTables(m_ComputeHandleCache, CmdList, &ID3D12GraphicsCommandList::SetComputeRootDescriptorTable);
     }
 
 private:
 
-    // Static members
-    static const uint32_t kNumDescriptorsPerHeap = 1024;
-    static std::mutex sm_Mutex;
-    static std::vector<Microsoft::WRL::ComPtr<ID3D12DescriptorHeap>> sm_DescriptorHeapPool[2];
-    static std::queue<std::pair<uint64_t, ID3D12DescriptorHeap*>> sm_RetiredDescriptorHeaps[2];
-    static std::queue<ID3D12DescriptorHeap*> sm_AvailableDescriptorHeaps[2];
-
-    // Static methods
-    static ID3D12DescriptorHeap* RequestDescriptorHeap(D3D12_DESCRIPTOR_HEAP_TYPE HeapType);
-    static void DiscardDescriptorHeaps( D3D12_DESCRIPTOR_HEAP_TYPE HeapType, uint64_t FenceValueForReset, const std::vector<ID3D12DescriptorHeap*>& UsedHeaps );
+    static const uint64_t kNoBlock = ~0ull;
+    static const uint32_t kNoPersistentCopy = ~0u;
 
     // Non-static members
     CommandContext& m_OwningContext;
     ID3D12DescriptorHeap* m_CurrentHeapPtr;
     const D3D12_DESCRIPTOR_HEAP_TYPE m_DescriptorType;
     uint32_t m_DescriptorSize;
+    uint32_t m_BlockSize;
+    uint64_t m_CurrentBlock;                // The number of the block in the ring's sequence, or kNoBlock
     uint32_t m_CurrentOffset;
-    DescriptorHandle m_FirstDescriptor;
-    std::vector<ID3D12DescriptorHeap*> m_RetiredHeaps;
+    DescriptorHandle m_FirstDescriptor;     // Of the current block
+    uint32_t m_PersistentCopy;
+    D3D12_GPU_DESCRIPTOR_HANDLE m_PersistentStart;    // Of the context's persistent copy, or the sampler tables
+    std::vector<uint64_t> m_RetiredBlocks;
+    uint32_t m_NumDescriptorsCopied;
 
     // Describes a descriptor table entry:  a region of the handle cache and which handles have been set
     struct DescriptorTableCache
@@ -119,11 +148,16 @@ private:
         void ClearCache()
         {
             m_RootDescriptorTablesBitMap = 0;
+            m_PersistentRootParamsBitMap = 0;
+            m_PersistentTablesBitMap = 0;
+            m_StalePersistentTablesBitMap = 0;
             m_MaxCachedDescriptors = 0;
         }
 
         uint32_t m_RootDescriptorTablesBitMap;
         uint32_t m_StaleRootParamsBitMap;
+        uint32_t m_PersistentTablesBitMap;        // Persistent tables that have been set
+        uint32_t m_StalePersistentTablesBitMap;
         uint32_t m_MaxCachedDescriptors;
 
         static const uint32_t kMaxNumDescriptors = 256;
@@ -133,11 +167,21 @@ private:
         void CopyAndBindStaleTables( D3D12_DESCRIPTOR_HEAP_TYPE Type, uint32_t DescriptorSize, DescriptorHandle DestHandleStart, ID3D12GraphicsCommandList* CmdList,
             void (STDMETHODCALLTYPE ID3D12GraphicsCommandList::*SetFunc)(UINT, D3D12_GPU_DESCRIPTOR_HANDLE));
 
+        void BindStalePersistentTables( uint32_t DescriptorSize, D3D12_GPU_DESCRIPTOR_HANDLE PersistentStart, ID3D12GraphicsCommandList* CmdList,
+            void (STDMETHODCALLTYPE ID3D12GraphicsCommandList::*SetFunc)(UINT, D3D12_GPU_DESCRIPTOR_HANDLE));
+
+        // Binds stale sampler tables from the persistent sampler region, adding the ones not seen before
+        void BindStaleSamplerTables( uint32_t DescriptorSize, D3D12_GPU_DESCRIPTOR_HANDLE PersistentStart, uint32_t& NumCopied, ID3D12GraphicsCommandList* CmdList,
+            void (STDMETHODCALLTYPE ID3D12GraphicsCommandList::*SetFunc)(UINT, D3D12_GPU_DESCRIPTOR_HANDLE));
+
         DescriptorTableCache m_RootDescriptorTable[kMaxNumDescriptorTables];
+        uint32_t m_PersistentTableOffset[kMaxNumDescriptorTables];
+        uint32_t m_PersistentRootParamsBitMap;    // Tables of the root signature that point into the persistent region
         D3D12_CPU_DESCRIPTOR_HANDLE m_HandleCache[kMaxNumDescriptors];
 
         void UnbindAllValid();
         void StageDescriptorHandles( UINT RootIndex, UINT Offset, UINT NumHandles, const D3D12_CPU_DESCRIPTOR_HANDLE Handles[] );
+        void StagePersistentTable( UINT RootIndex, UINT Offset );
         void ParseRootSignature( D3D12_DESCRIPTOR_HEAP_TYPE Type, const RootSignature& RootSig );
     };
 
@@ -146,17 +190,23 @@ private:
 
     bool HasSpace( uint32_t Count )
     {
-        return (m_CurrentHeapPtr != nullptr && m_CurrentOffset + Count <= kNumDescriptorsPerHeap);
+        return (m_CurrentBlock != kNoBlock && m_CurrentOffset + Count <= m_BlockSize);
     }
 
-    void RetireCurrentHeap(void);
-    void RetireUsedHeaps( uint64_t fenceValue );
+    // Moves on to the next block of the ring, waiting for the GPU to finish with it when it has to
+    void RequestBlock(void);
+    void RetireCurrentBlock(void);
     ID3D12DescriptorHeap* GetHeapPointer();
 
     DescriptorHandle Allocate( UINT Count )
     {
+        ASSERT(Count <= m_BlockSize);
+        if (!HasSpace(Count))
+            RequestBlock();
+
         DescriptorHandle ret = m_FirstDescriptor + m_CurrentOffset * m_DescriptorSize;
         m_CurrentOffset += Count;
+        m_NumDescriptorsCopied += Count;
         return ret;
     }
 
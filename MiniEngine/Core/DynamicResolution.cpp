@@ -0,0 +1,113 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "pch.h"
+#include "DynamicResolution.h"
+#include "BufferManager.h"
+#include "GraphicsCore.h"
+#include "EngineProfiling.h"
+#include "TemporalEffects.h"
+
+using namespace Graphics;
+
+namespace DynamicResolution
+{
+    BoolVar Enable("Graphics/Dynamic Resolution/Enable", false);
+    NumVar TargetFrameTime("Graphics/Dynamic Resolution/Target Frame Time (ms)", 16.0f, 4.0f, 100.0f, 0.5f);
+    NumVar MinScale("Graphics/Dynamic Resolution/Min Scale", 0.5f, 0.25f, 1.0f, 0.05f);
+    NumVar Headroom("Graphics/Dynamic Resolution/Headroom %", 10.0f, 0.0f, 50.0f, 1.0f);
+
+    const uint32_t kSizeMultiple = 8;   // Render sizes are rounded to whole light grid and TAA tiles
+    const float kDamping = 0.1f;        // The fraction of the step toward the target scale taken each frame
+
+    float s_Scale = 1.0f;
+    uint32_t s_PrevWidth = 0;
+    uint32_t s_PrevHeight = 0;
+
+    uint32_t ScaleSize( uint32_t Size )
+    {
+        if (s_Scale >= 1.0f)
+            return Size;
+        uint32_t Scaled = (uint32_t)(Size * s_Scale) / kSizeMultiple * kSizeMultiple;
+        return std::min(std::max(Scaled, kSizeMultiple), Size);
+    }
+}
+
+void DynamicResolution::Update( void )
+{
+    s_PrevWidth = GetWidth();
+    s_PrevHeight = GetHeight();
+
+    // The upscale is the only way to present a lower resolution with HDR output
+    const float MaxScale = TemporalEffects::GetUpscaleResolution();
+    if (!Enable || (g_bEnableHDROutput && !TemporalEffects::IsUpscaling()))
+    {
+        s_Scale = MaxScale;
+        return;
+    }
+    s_Scale = std::min(s_Scale, MaxScale);
+
+    const float GpuTime = EngineProfiling::GetGraphicsQueueTime();
+    if (GpuTime <= 0.0f)
+        return;
+
+    // Within the band between the target and the headroom below it, the scale holds, so that it does not
+    // chase the noise of every frame
+    const float Target = TargetFrameTime;
+    const float Low = Target * (1.0f - Headroom * 0.01f);
+    if (GpuTime >= Low && GpuTime <= Target)
+        return;
+
+    // Most of the frame's cost grows with the pixel count, so each side scales with the square root of the time
+    // ratio.  Aiming between the band's edges keeps a step from overshooting through the other one.
+    const float Ratio = 0.5f * (Target + Low) / GpuTime;
+    const float Goal = s_Scale * std::sqrt(Ratio);
+    s_Scale = std::min(std::max(s_Scale + (Goal - s_Scale) * kDamping, std::min((float)MinScale, MaxScale)), MaxScale);
+}
+
+float DynamicResolution::GetScale( void )
+{
+    return s_Scale;
+}
+
+uint32_t DynamicResolution::GetWidth( void )
+{
+    return ScaleSize(g_SceneColorBuffer.GetWidth());
+}
+
+uint32_t DynamicResolution::GetHeight( void )
+{
+    return ScaleSize(g_SceneColorBuffer.GetHeight());
+}
+
+uint32_t DynamicResolution::GetPrevWidth( void )
+{
+    // The buffers may have been resized since
+    return s_PrevWidth == 0 ? GetWidth() : std::min(s_PrevWidth, (uint32_t)g_SceneColorBuffer.GetWidth());
+}
+
+uint32_t DynamicResolution::GetPrevHeight( void )
+{
+    return s_PrevHeight == 0 ? GetHeight() : std::min(s_PrevHeight, (uint32_t)g_SceneColorBuffer.GetHeight());
+}
+
+bool DynamicResolution::IsScaled( void )
+{
+    return GetWidth() < g_SceneColorBuffer.GetWidth() || GetHeight() < g_SceneColorBuffer.GetHeight();
+}
+
+uint32_t DynamicResolution::GetOutputWidth( void )
+{
+    return TemporalEffects::IsUpscaling() ? (uint32_t)g_SceneColorBuffer.GetWidth() : GetWidth();
+}
+
+uint32_t DynamicResolution::GetOutputHeight( void )
+{
+    return TemporalEffects::IsUpscaling() ? (uint32_t)g_SceneColorBuffer.GetHeight() : GetHeight();
+}
@@ -0,0 +1,49 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Lowers the resolution the scene renders at while the GPU takes longer than the target frame time, and raises
+// it again once there is headroom.  The buffers stay allocated at the native resolution, and the scene renders
+// into the rectangle of GetWidth() by GetHeight() pixels at their top left corner, which the present upsamples to
+// the display.  Passes that size their viewports, dispatches and screen space constants by the render size see
+// the change, while a pass that works on the whole buffer keeps working, only on pixels nobody displays.
+//
+// The GPU time is the time timed scopes kept the graphics queue busy, which the profiler reads back a few frames
+// late, so the scale moves toward its target gradually.  It holds in release builds, which time no scopes.
+//
+// Temporal upscaling caps the scale at its upscale resolution, and leaves the scene color at the buffer size
+// after TemporalEffects::ResolveImage(), which the passes after it then work on.  Without it the scale stays
+// at 1 for HDR output, which presents the scene buffer without upsampling.
+//
+
+#pragma once
+
+#include "EngineTuning.h"
+
+namespace DynamicResolution
+{
+    extern BoolVar Enable;
+
+    // Call once per frame after the present to choose the scale of the next frame
+    void Update( void );
+
+    // The fraction of the native width and height the scene renders at
+    float GetScale( void );
+
+    // The render size of the current frame, and of the previous one, which rendered the temporal history
+    uint32_t GetWidth( void );
+    uint32_t GetHeight( void );
+    uint32_t GetPrevWidth( void );
+    uint32_t GetPrevHeight( void );
+
+    // Whether the render size is smaller than the buffers
+    bool IsScaled( void );
+
+    // The size of the scene color after the temporal resolve, which is the buffer size when upscaling
+    uint32_t GetOutputWidth( void );
+    uint32_t GetOutputHeight( void );
+}
@@ -14,6 +14,7 @@
 #include "pch.h"
 #include "GraphicsCore.h"
 #include "DynamicUploadBuffer.h"
+#include "GpuMemoryTracker.h"
 
 using namespace Graphics;
 
@@ -41,6 +42,7 @@ void DynamicUploadBuffer::Create(const std::wstring& name, uint32_t NumElements,
 
     ASSERT_SUCCEEDED( g_Device->CreateCommittedResource(&HeapProps, D3D12_HEAP_FLAG_NONE, &ResourceDesc,
         D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, MY_IID_PPV_ARGS(&m_pResource)) );
+    GpuMemoryTracker::TrackResource(m_pResource.Get(), GpuMemoryTracker::kUploadBuffers);
 
     m_pResource->SetName(name.c_str());
 
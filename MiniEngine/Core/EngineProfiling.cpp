@@ -19,9 +19,21 @@
 #include "GameInput.h"
 #include "GpuTimeManager.h"
 #include "CommandContext.h"
+#include "CpuProfiler.h"
+#include "CommandListManager.h"
+#include <dxgi1_3.h>
+#include <DXProgrammableCapture.h>
 #include <vector>
 #include <unordered_map>
+#include <map>
 #include <array>
+#include <atomic>
+#include <mutex>
+#include <fstream>
+
+#ifndef RELEASE
+    #include <pix3.h>
+#endif
 
 using namespace Graphics;
 using namespace GraphRenderer;
@@ -32,6 +44,116 @@ using namespace std;
 namespace EngineProfiling
 {
     bool Paused = false;
+
+    // Wraps every graphics queue scope in a pipeline statistics query, which costs a little GPU time
+    BoolVar CollectPipelineStats("Profiling/Pipeline Statistics", false);
+}
+
+// The scopes recorded for a trace capture.  CPU scopes come from whichever thread timed them, and GPU scopes are
+// added once their time stamps are read back.
+namespace TraceCapture
+{
+    struct Event
+    {
+        const wchar_t* Name;    // Timing tree names never change or move, and the rest are literals
+        int64_t StartTick;
+        int64_t EndTick;
+        uint32_t Track;         // The thread ID of a CPU scope, or the queue of a GPU scope
+        bool OnGpu;
+        bool HasStats;
+        D3D12_QUERY_DATA_PIPELINE_STATISTICS Stats;
+    };
+
+    NumVar CaptureSeconds("Profiling/Capture Seconds", 5.0f, 1.0f, 60.0f, 1.0f);
+
+    atomic<bool> s_Capturing(false);
+    int64_t s_StartTick = 0;
+    int64_t s_EndTick = 0;
+    uint32_t s_MainThread = 0;
+    uint32_t s_NumCaptures = 0;
+    mutex s_EventMutex;
+    vector<Event> s_Events;
+
+    void Record( const wchar_t* Name, int64_t StartTick, int64_t EndTick, uint32_t Track, bool OnGpu,
+        const D3D12_QUERY_DATA_PIPELINE_STATISTICS* Stats = nullptr )
+    {
+        Event NewEvent = { Name, StartTick, EndTick, Track, OnGpu, Stats != nullptr };
+        if (Stats != nullptr)
+            NewEvent.Stats = *Stats;
+        lock_guard<mutex> Guard(s_EventMutex);
+        s_Events.push_back(NewEvent);
+    }
+
+    void WriteString( ofstream& File, const wchar_t* Str )
+    {
+        File << '"';
+        for (; *Str != L'\0'; ++Str)
+        {
+            if (*Str == L'"' || *Str == L'\\')
+                File << '\\' << (char)*Str;
+            else
+                File << (*Str >= L' ' && *Str < 0x80 ? (char)*Str : '?');
+        }
+        File << '"';
+    }
+
+    // Times are in microseconds from the start of the capture
+    double ToMicroseconds( int64_t Ticks )
+    {
+        return SystemTime::TicksToMillisecs(Ticks) * 1000.0;
+    }
+
+    void Write( void )
+    {
+        vector<Event> Events;
+        {
+            lock_guard<mutex> Guard(s_EventMutex);
+            Events.swap(s_Events);
+        }
+
+        wchar_t FileName[64];
+        swprintf_s(FileName, L"ProfileCapture%u.json", s_NumCaptures++);
+
+        ofstream File(FileName, ios::out);
+        if (!File)
+        {
+            Utility::Printf(L"Unable to write profile capture %s\n", FileName);
+            return;
+        }
+        File.precision(3);
+        File << fixed << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+        // Name the tracks, which are threads of the CPU process and queues of the GPU one
+        File << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"CPU\"}},\n";
+        File << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":2,\"args\":{\"name\":\"GPU\"}},\n";
+        File << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":2,\"tid\":0,\"args\":{\"name\":\"Graphics Queue\"}},\n";
+        File << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":2,\"tid\":1,\"args\":{\"name\":\"Compute Queue\"}},\n";
+        File << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << s_MainThread <<
+            ",\"args\":{\"name\":\"Main Thread\"}}";
+
+        for (const Event& Scope : Events)
+        {
+            File << ",\n{\"name\":";
+            WriteString(File, Scope.Name);
+            File << ",\"ph\":\"X\",\"pid\":" << (Scope.OnGpu ? 2 : 1) << ",\"tid\":" << Scope.Track <<
+                ",\"ts\":" << ToMicroseconds(Scope.StartTick - s_StartTick) <<
+                ",\"dur\":" << ToMicroseconds(Scope.EndTick - Scope.StartTick);
+            if (Scope.HasStats)
+            {
+                const D3D12_QUERY_DATA_PIPELINE_STATISTICS& Stats = Scope.Stats;
+                File << ",\"args\":{\"primitives\":" << Stats.IAPrimitives <<
+                    ",\"vsInvocations\":" << Stats.VSInvocations <<
+                    ",\"clipperPrimitives\":" << Stats.CInvocations <<
+                    ",\"rasterizedPrimitives\":" << Stats.CPrimitives <<
+                    ",\"psInvocations\":" << Stats.PSInvocations <<
+                    ",\"csInvocations\":" << Stats.CSInvocations << "}";
+            }
+            File << "}";
+        }
+
+        File << "\n]}\n";
+        Utility::Printf(L"Wrote %u profiling events to %s\n", (uint32_t)Events.size(), FileName);
+    }
 }
 
 class StatHistory
@@ -43,6 +165,7 @@ public:
             m_RecentHistory[i] = 0.0f;
         for (uint32_t i = 0; i < kExtendedHistorySize; ++i)
             m_ExtendedHistory[i] = 0.0f;
+        m_Recent = 0.0f;
         m_Average = 0.0f;
         m_Minimum = 0.0f;
         m_Maximum = 0.0f;
@@ -194,8 +317,12 @@ private:
 class NestedTimingTree
 {
 public:
+    // The queue whose command lists a node's GPU timer was last written on
+    enum { kGraphicsQueue, kComputeQueue, kNumQueues, kNoQueue = kNumQueues };
+
     NestedTimingTree( const wstring& name, NestedTimingTree* parent = nullptr )
-        : m_Name(name), m_Parent(parent), m_IsExpanded(false), m_IsGraphed(false), m_GraphHandle(PERF_GRAPH_ERROR) {}
+        : m_Name(name), m_Parent(parent), m_IsExpanded(false), m_IsGraphed(false), m_GraphHandle(PERF_GRAPH_ERROR),
+        m_Queue(kNoQueue), m_StatsStarted(false), m_HasStats(false), m_MergedTicks(0) {}
 
     NestedTimingTree* GetChild( const wstring& name )
     {
@@ -289,15 +416,35 @@ public:
 
         m_GpuTimer.Start(*Context);
 
+        m_StatsStarted = EngineProfiling::CollectPipelineStats && Context->GetType() == D3D12_COMMAND_LIST_TYPE_DIRECT;
+        if (m_StatsStarted)
+            GpuTimeManager::BeginPipelineStats(*Context, m_GpuTimer.GetTimerIndex());
+
+        switch (Context->GetType())
+        {
+        case D3D12_COMMAND_LIST_TYPE_DIRECT:  m_Queue = kGraphicsQueue; break;
+        case D3D12_COMMAND_LIST_TYPE_COMPUTE: m_Queue = kComputeQueue; break;
+        default: m_Queue = kNoQueue; break;
+        }
+
         Context->PIXBeginEvent(m_Name.c_str());
     }
 
     void StopTiming( CommandContext* Context )
     {
         m_EndTick = SystemTime::GetCurrentTick();
+        if (TraceCapture::s_Capturing)
+            TraceCapture::Record(m_Name.c_str(), m_StartTick, m_EndTick, GetCurrentThreadId(), false);
+
         if (Context == nullptr)
             return;
 
+        if (m_StatsStarted)
+        {
+            GpuTimeManager::EndPipelineStats(*Context, m_GpuTimer.GetTimerIndex());
+            m_StatsStarted = false;
+        }
+
         m_GpuTimer.Stop(*Context);
 
         Context->PIXEndEvent();
@@ -311,18 +458,36 @@ public:
         }
         if (EngineProfiling::Paused)
         {
+            m_MergedTicks = 0;
             for (auto node : m_Children)
                 node->GatherTimes(FrameIndex);
             return;
         }
-        m_CpuTime.RecordStat(FrameIndex, 1000.0f * (float)SystemTime::TimeBetweenTicks(m_StartTick, m_EndTick));
+        m_CpuTime.RecordStat(FrameIndex, 1000.0f * (float)SystemTime::TimeBetweenTicks(m_StartTick, m_EndTick + m_MergedTicks));
         m_GpuTime.RecordStat(FrameIndex, 1000.0f * m_GpuTimer.GetTime());
+        m_HasStats = GpuTimeManager::GetPipelineStats(m_GpuTimer.GetTimerIndex(), m_Stats);
+
+        // Only the innermost timers of a queue count towards its busy time, because an outer timer also spans
+        // any time the queue spent waiting on another one
+        if (m_Queue != kNoQueue && !HasChildOnQueue(m_Queue))
+            s_QueueTimers[m_Queue].push_back(m_GpuTimer.GetTimerIndex());
 
         for (auto node : m_Children)
             node->GatherTimes(FrameIndex);
 
         m_StartTick = 0;
         m_EndTick = 0;
+        m_MergedTicks = 0;
+    }
+
+    bool HasChildOnQueue(uint32_t Queue) const
+    {
+        for (auto node : m_Children)
+        {
+            if (node->m_Queue == Queue)
+                return true;
+        }
+        return false;
     }
 
     void SumInclusiveTimes(float& cpuTime, float& gpuTime)
@@ -331,6 +496,9 @@ public:
         gpuTime = 0.0f;
         for (auto iter = m_Children.begin(); iter != m_Children.end(); ++iter)
         {
+            // Other threads run alongside the main thread's scopes
+            if (*iter == sm_ThreadScopes)
+                continue;
             cpuTime += (*iter)->m_CpuTime.GetLast();
             gpuTime += (*iter)->m_GpuTime.GetLast();
         }
@@ -338,14 +506,55 @@ public:
 
     static void PushProfilingMarker( const wstring& name, CommandContext* Context );
     static void PopProfilingMarker( CommandContext* Context );
+
+    // Adds a scope of CpuProfiler to the subtree of the thread scopes
+    static void MergeThreadScope( const wchar_t* const* Path, uint32_t Depth, int64_t StartTick, int64_t EndTick,
+        uint32_t ThreadId )
+    {
+        if (sm_ThreadScopes == nullptr)
+            sm_ThreadScopes = sm_RootScope.GetChild(L"CPU Threads");
+
+        NestedTimingTree* Node = sm_ThreadScopes;
+        for (uint32_t i = 0; i <= Depth; ++i)
+            Node = Node->GetChild(Path[i]);
+        Node->m_MergedTicks += EndTick - StartTick;
+
+        // The subtree's own time is the one of all outermost scopes
+        if (Depth == 0)
+            sm_ThreadScopes->m_MergedTicks += EndTick - StartTick;
+
+        if (TraceCapture::s_Capturing)
+            TraceCapture::Record(Path[Depth], StartTick, EndTick, ThreadId, false);
+    }
+
     static void Update( void );
     static void UpdateTimes( void )
     {
         uint32_t FrameIndex = (uint32_t)Graphics::GetFrameCount();
 
-        GpuTimeManager::BeginReadBack();
+        for (auto& Timers : s_QueueTimers)
+            Timers.clear();
+
+        const bool NewTimes = GpuTimeManager::BeginReadBack();
         sm_RootScope.GatherTimes(FrameIndex);
+
+        // A frame that was read back already would add its GPU scopes twice
+        if (NewTimes && TraceCapture::s_Capturing)
+            sm_RootScope.CaptureGpuTimes();
         s_FrameDelta.RecordStat(FrameIndex, GpuTimeManager::GetTime(0));
+
+        // Timers on a queue may still overlap, so each queue's busy time is the span its timers cover
+        if (!EngineProfiling::Paused)
+        {
+            for (uint32_t i = 0; i < kNumQueues; ++i)
+            {
+                s_QueueGpuTime[i].RecordStat(FrameIndex, 1000.0f *
+                    GpuTimeManager::GetCoveredTime(s_QueueTimers[i].data(), (uint32_t)s_QueueTimers[i].size()));
+            }
+            s_QueueOverlapTime.RecordStat(FrameIndex, 1000.0f * GpuTimeManager::GetOverlappedTime(
+                s_QueueTimers[kGraphicsQueue].data(), (uint32_t)s_QueueTimers[kGraphicsQueue].size(),
+                s_QueueTimers[kComputeQueue].data(), (uint32_t)s_QueueTimers[kComputeQueue].size()));
+        }
         GpuTimeManager::EndReadBack();
 
         float TotalCpuTime, TotalGpuTime;
@@ -356,9 +565,62 @@ public:
         GraphRenderer::Update(XMFLOAT2(TotalCpuTime, TotalGpuTime), 0, GraphType::Global);
     }
 
+    // Searches depth first, since a scope name may sit under a different parent from one frame to the next
+    NestedTimingTree* FindScope( const wstring& name )
+    {
+        if (m_Name == name)
+            return this;
+
+        for (auto node : m_Children)
+        {
+            if (NestedTimingTree* found = node->FindScope(name))
+                return found;
+        }
+        return nullptr;
+    }
+
+    static bool GetScopeTimes( const wstring& name, float& cpuTime, float& gpuTime )
+    {
+        NestedTimingTree* node = sm_RootScope.FindScope(name);
+        if (node == nullptr)
+            return false;
+
+        cpuTime = node->m_CpuTime.GetLast();
+        gpuTime = node->m_GpuTime.GetLast();
+        return true;
+    }
+
+    // The innermost GPU scope that took longest in the last frame, when it took longer than ThresholdMs
+    static bool GetGpuHotSpot( float ThresholdMs, wstring& name, float& gpuTime )
+    {
+        NestedTimingTree* HotSpot = nullptr;
+        sm_RootScope.FindGpuHotSpot(ThresholdMs, HotSpot);
+        if (HotSpot == nullptr)
+            return false;
+
+        name = HotSpot->m_Name;
+        gpuTime = HotSpot->m_GpuTime.GetLast();
+        return true;
+    }
+
+    void FindGpuHotSpot( float ThresholdMs, NestedTimingTree*& HotSpot )
+    {
+        if (m_Queue != kNoQueue && !HasChildOnQueue(m_Queue) && m_GpuTime.GetLast() > ThresholdMs &&
+            (HotSpot == nullptr || m_GpuTime.GetLast() > HotSpot->m_GpuTime.GetLast()))
+        {
+            HotSpot = this;
+        }
+
+        for (auto node : m_Children)
+            node->FindGpuHotSpot(ThresholdMs, HotSpot);
+    }
+
     static float GetTotalCpuTime(void) { return s_TotalCpuTime.GetAvg(); }
     static float GetTotalGpuTime(void) { return s_TotalGpuTime.GetAvg(); }
     static float GetFrameDelta(void) { return s_FrameDelta.GetAvg(); }
+    static float GetQueueGpuTime(uint32_t Queue) { return s_QueueGpuTime[Queue].GetAvg(); }
+    static float GetLastGraphicsQueueTime(void) { return s_QueueGpuTime[kGraphicsQueue].GetLast(); }
+    static float GetQueueOverlapTime(void) { return s_QueueOverlapTime.GetAvg(); }
 
     static void Display( TextContext& Text, float x )
     {
@@ -378,6 +640,16 @@ public:
     }
     bool IsGraphed(){ return m_IsGraphed;}
 
+    void CaptureGpuTimes(void)
+    {
+        int64_t StartTick, EndTick;
+        if (m_Queue != kNoQueue && GpuTimeManager::GetTimerTicks(m_GpuTimer.GetTimerIndex(), StartTick, EndTick))
+            TraceCapture::Record(m_Name.c_str(), StartTick, EndTick, m_Queue, true, m_HasStats ? &m_Stats : nullptr);
+
+        for (auto node : m_Children)
+            node->CaptureGpuTimes();
+    }
+
 private:
 
     void DisplayNode( TextContext& Text, float x, float indent );
@@ -401,12 +673,21 @@ private:
     GpuTimer m_GpuTimer;
     bool m_IsGraphed;
     GraphHandle m_GraphHandle;
+    uint32_t m_Queue;
+    bool m_StatsStarted;
+    bool m_HasStats;    // Whether the scope's statistics were read back with its last GPU time
+    D3D12_QUERY_DATA_PIPELINE_STATISTICS m_Stats;
+    int64_t m_MergedTicks;      // Summed CpuProfiler scopes of all threads
     static StatHistory s_TotalCpuTime;
     static StatHistory s_TotalGpuTime;
     static StatHistory s_FrameDelta;
+    static StatHistory s_QueueGpuTime[kNumQueues];
+    static StatHistory s_QueueOverlapTime;
+    static vector<uint32_t> s_QueueTimers[kNumQueues];
     static NestedTimingTree sm_RootScope;
     static NestedTimingTree* sm_CurrentNode;
     static NestedTimingTree* sm_SelectedScope;
+    static NestedTimingTree* sm_ThreadScopes;
 
     static bool sm_CursorOnGraph;
 
@@ -415,16 +696,75 @@ private:
 StatHistory NestedTimingTree::s_TotalCpuTime;
 StatHistory NestedTimingTree::s_TotalGpuTime;
 StatHistory NestedTimingTree::s_FrameDelta;
+StatHistory NestedTimingTree::s_QueueGpuTime[NestedTimingTree::kNumQueues];
+StatHistory NestedTimingTree::s_QueueOverlapTime;
+vector<uint32_t> NestedTimingTree::s_QueueTimers[NestedTimingTree::kNumQueues];
 NestedTimingTree NestedTimingTree::sm_RootScope(L"");
 NestedTimingTree* NestedTimingTree::sm_CurrentNode = &NestedTimingTree::sm_RootScope;
 NestedTimingTree* NestedTimingTree::sm_SelectedScope = &NestedTimingTree::sm_RootScope;
+NestedTimingTree* NestedTimingTree::sm_ThreadScopes = nullptr;
 bool NestedTimingTree::sm_CursorOnGraph = false;
+
+// Captures the frame after one where a GPU scope ran over a threshold, to catch rare spikes.  Programmatic
+// captures need the application to have been launched from PIX, or another graphics debugger implementing
+// IDXGraphicsAnalysis, so without one a hot spot is only logged.
+namespace HotSpotCapture
+{
+    BoolVar Enable("Profiling/Hot Spot Capture/Enable", false);
+    NumVar ThresholdMs("Profiling/Hot Spot Capture/Threshold (ms)", 5.0f, 0.5f, 100.0f, 0.5f);
+    IntVar MaxCaptures("Profiling/Hot Spot Capture/Max Captures", 1, 1, 32);
+
+    Microsoft::WRL::ComPtr<IDXGraphicsAnalysis> s_GraphicsAnalysis;
+    bool s_LookedForDebugger = false;
+    bool s_Capturing = false;
+    uint32_t s_NumHotSpots = 0;
+
+    void Update( void )
+    {
+        // A capture started at the beginning of the last frame ends at the beginning of this one
+        if (s_Capturing)
+        {
+            s_GraphicsAnalysis->EndCapture();
+            s_Capturing = false;
+        }
+
+        wstring Name;
+        float GpuTime;
+        if (!Enable || s_NumHotSpots >= (uint32_t)MaxCaptures || !NestedTimingTree::GetGpuHotSpot(ThresholdMs, Name, GpuTime))
+            return;
+
+        ++s_NumHotSpots;
+
+        // Only succeeds while a graphics debugger is attached
+        if (!s_LookedForDebugger)
+        {
+            s_LookedForDebugger = true;
+            if (FAILED(DXGIGetDebugInterface1(0, MY_IID_PPV_ARGS(&s_GraphicsAnalysis))))
+                s_GraphicsAnalysis = nullptr;
+        }
+
+        Utility::Printf(L"GPU hot spot in frame %llu: %s took %.2f ms%s\n", Graphics::GetFrameCount(), Name.c_str(),
+            GpuTime, s_GraphicsAnalysis != nullptr ? L", capturing the next frame" : L"");
+
+        if (s_GraphicsAnalysis == nullptr)
+            return;
+
+        s_GraphicsAnalysis->BeginCapture();
+        s_Capturing = true;
+
+        // Names the capture's frame after the pass, since captures themselves cannot be named
+#ifndef RELEASE
+        PIXSetMarker(g_CommandManager.GetCommandQueue(), 0, L"Hot Spot: %s %.2f ms", Name.c_str(), GpuTime);
+#endif
+    }
+}
 namespace EngineProfiling
 {
     BoolVar DrawFrameRate("Display Frame Rate", true);
     BoolVar DrawProfiler("Display Profiler", false);
     //BoolVar DrawPerfGraph("Display Performance Graph", false);
     const bool DrawPerfGraph = false;
+    std::map<std::string, uint32_t> s_Counters;
     
     void Update( void )
     {
@@ -433,7 +773,54 @@ namespace EngineProfiling
         {
             Paused = !Paused;
         }
+
+        if (GameInput::IsFirstPressed( GameInput::kKey_f12 ) && !IsCapturing())
+            StartCapture();
+
+        CpuProfiler::Drain(NestedTimingTree::MergeThreadScope);
+        if (uint32_t NumDropped = CpuProfiler::GetDroppedScopeCount())
+            SetCounter("Dropped CPU Scopes", NumDropped);
+
         NestedTimingTree::UpdateTimes();
+        HotSpotCapture::Update();
+
+        if (TraceCapture::s_Capturing && SystemTime::GetCurrentTick() >= TraceCapture::s_EndTick)
+        {
+            TraceCapture::s_Capturing = false;
+            TraceCapture::Write();
+        }
+    }
+
+    void StartCapture( void )
+    {
+        using namespace TraceCapture;
+
+        if (s_Capturing)
+            return;
+
+        GpuTimeManager::CalibrateClocks();
+        {
+            lock_guard<mutex> Guard(s_EventMutex);
+            s_Events.clear();
+        }
+
+        s_MainThread = GetCurrentThreadId();
+        s_StartTick = SystemTime::GetCurrentTick();
+        s_EndTick = s_StartTick + (int64_t)(CaptureSeconds / SystemTime::TicksToSeconds(1));
+        s_Capturing = true;
+
+        Utility::Printf("Capturing %.0f seconds of profiling events\n", (float)CaptureSeconds);
+    }
+
+    bool IsCapturing( void )
+    {
+        return TraceCapture::s_Capturing;
+    }
+
+    void RecordCpuEvent( const wchar_t* name, int64_t startTick, int64_t endTick )
+    {
+        if (TraceCapture::s_Capturing)
+            TraceCapture::Record(name, startTick, endTick, GetCurrentThreadId(), false);
     }
 
     void BeginBlock(const wstring& name, CommandContext* Context)
@@ -446,6 +833,21 @@ namespace EngineProfiling
         NestedTimingTree::PopProfilingMarker(Context);
     }
 
+    bool GetScopeTimes(const wstring& name, float& cpuTime, float& gpuTime)
+    {
+        return NestedTimingTree::GetScopeTimes(name, cpuTime, gpuTime);
+    }
+
+    float GetGraphicsQueueTime(void)
+    {
+        return NestedTimingTree::GetLastGraphicsQueueTime();
+    }
+
+    void SetCounter(const std::string& name, uint32_t value)
+    {
+        s_Counters[name] = value;
+    }
+
     bool IsPaused()
     {
         return Paused;
@@ -462,6 +864,15 @@ namespace EngineProfiling
 
         Text.DrawFormattedString( "CPU %7.3f ms, GPU %7.3f ms, %3u Hz\n",
             cpuTime, gpuTime, (uint32_t)(frameRate + 0.5f));
+
+        // Per queue busy time, shown once something is timed on the compute queue
+        float computeTime = NestedTimingTree::GetQueueGpuTime(NestedTimingTree::kComputeQueue);
+        if (computeTime > 0.0f)
+        {
+            Text.DrawFormattedString( "GPU queues: 3D %7.3f ms, Compute %7.3f ms, Overlap %7.3f ms\n",
+                NestedTimingTree::GetQueueGpuTime(NestedTimingTree::kGraphicsQueue), computeTime,
+                NestedTimingTree::GetQueueOverlapTime());
+        }
     }
 
     void DisplayPerfGraph( GraphicsContext& Context )
@@ -485,12 +896,29 @@ namespace EngineProfiling
             Text.SetColor(Color(0.8f, 0.8f, 0.8f));
             Text.SetTextSize(20.0f);
             Text.DrawString("           CPU    GPU");
+            if (CollectPipelineStats)
+                Text.DrawString("    Prims  Culled   Pixels");
             Text.SetTextSize(24.0f);
             Text.NewLine();
             Text.SetTextSize(20.0f);
             Text.SetColor( Color(1.0f, 1.0f, 1.0f) );
 
             NestedTimingTree::Display( Text, x );
+
+            if (!s_Counters.empty())
+            {
+                Text.NewLine();
+                Text.SetColor( Color(0.5f, 1.0f, 1.0f) );
+                Text.DrawString("Counters\n");
+                Text.SetColor( Color(1.0f, 1.0f, 1.0f) );
+                for (auto& Counter : s_Counters)
+                {
+                    Text.SetCursorX(x);
+                    Text.DrawString(Counter.first);
+                    Text.SetCursorX(x + 300.0f);
+                    Text.DrawFormattedString("%6u\n", Counter.second);
+                }
+            }
         }
 
         Text.GetCommandContext().SetScissor(0, 0, g_DisplayWidth, g_DisplayHeight);
@@ -558,6 +986,17 @@ void NestedTimingTree::Update( void )
 
 }
 
+// Counts get a K or M suffix to fit the column
+static void FormatCount( char (&Str)[16], uint64_t Count )
+{
+    if (Count >= 10000000)
+        sprintf_s(Str, "%.1fM", Count / 1000000.0);
+    else if (Count >= 10000)
+        sprintf_s(Str, "%.1fK", Count / 1000.0);
+    else
+        sprintf_s(Str, "%u", (uint32_t)Count);
+}
+
 void NestedTimingTree::DisplayNode( TextContext& Text, float leftMargin, float indent )
 {
     if (this == &sm_RootScope)
@@ -587,6 +1026,17 @@ void NestedTimingTree::DisplayNode( TextContext& Text, float leftMargin, float i
         Text.SetCursorX(leftMargin + 300.0f);
         Text.DrawFormattedString("%6.3f %6.3f   ", m_CpuTime.GetAvg(), m_GpuTime.GetAvg());
 
+        // Primitives input, primitives the clipper dropped, and pixel shader invocations of the last frame
+        if (EngineProfiling::CollectPipelineStats && m_HasStats)
+        {
+            char Prims[16], Culled[16], Pixels[16];
+            FormatCount(Prims, m_Stats.IAPrimitives);
+            // Clipping can split primitives, so more may leave the clipper than entered it
+            FormatCount(Culled, m_Stats.CInvocations > m_Stats.CPrimitives ? m_Stats.CInvocations - m_Stats.CPrimitives : 0);
+            FormatCount(Pixels, m_Stats.PSInvocations);
+            Text.DrawFormattedString("%7s %7s %7s", Prims, Culled, Pixels);
+        }
+
         if (IsGraphed())
         {
             Text.SetColor(GraphRenderer::GetGraphColor(m_GraphHandle, GraphType::Profile));
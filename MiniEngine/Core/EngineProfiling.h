@@ -25,6 +25,24 @@ namespace EngineProfiling
     void BeginBlock(const std::wstring& name, CommandContext* Context = nullptr);
     void EndBlock(CommandContext* Context = nullptr);
 
+    // Named per-frame counts listed under the timings
+    void SetCounter(const std::string& name, uint32_t value);
+
+    // Records every CPU and GPU scope for a few seconds, then writes them to a Chrome trace file that
+    // chrome://tracing and Perfetto open.  F12 starts one as well.
+    void StartCapture(void);
+    bool IsCapturing(void);
+
+    // Adds a span of CPU time to the capture that is not a timed scope, such as a wait on the GPU
+    void RecordCpuEvent(const wchar_t* name, int64_t startTick, int64_t endTick);
+
+    // The last frame's times in milliseconds of the first scope found with the name.  Returns false when no
+    // scope has ever had it.
+    bool GetScopeTimes(const std::wstring& name, float& cpuTime, float& gpuTime);
+
+    // The last frame's time in milliseconds during which timed scopes kept the graphics queue busy
+    float GetGraphicsQueueTime(void);
+
     void DisplayFrameRate(TextContext& Text);
     void DisplayPerfGraph(GraphicsContext& Text);
     void Display(TextContext& Text, float x, float y, float w, float h);
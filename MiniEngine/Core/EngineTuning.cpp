@@ -19,6 +19,10 @@
 #include "GraphicsCore.h"
 #include "CommandContext.h"
 #include "GraphRenderer.h"
+#include "GpuMemoryTracker.h"
+#include "FramePacing.h"
+#include <algorithm>
+#include <fstream>
 
 using namespace std;
 using namespace Math;
@@ -43,6 +47,23 @@ namespace EngineTuning
 
     EngineVar* sm_SelectedVariable = nullptr;
     bool sm_IsVisible = false;
+
+    // Scripted settings, sorted by the frame they apply at
+    struct ScriptEntry
+    {
+        uint64_t Frame;
+        string Path;
+        string Value;
+    };
+    vector<ScriptEntry> s_Script;
+    size_t s_NextScriptEntry = 0;
+    uint64_t s_UpdateCount = 0;     // Updates started
+    uint64_t s_CurrentFrame = 0;
+    FILE* s_RecordFile = nullptr;
+
+    void ParseCommandLine( void );
+    void ApplyScript( void );
+    void RecordChange( EngineVar* var );
 }
 
 // Not open to the public.  Groups are auto-created when a tweaker's path includes the group name.
@@ -68,6 +89,9 @@ public:
     void SaveToFile( FILE* file, int fileMargin );
     void LoadSettingsFromFile( FILE* file );
 
+    void GetValues( const string& prefix, EngineTuning::Snapshot& values );
+    string GetPath( const EngineVar* var ) const;
+
     EngineVar* NextVariable( EngineVar* currentVariable );
     EngineVar* PrevVariable( EngineVar* currentVariable );
     EngineVar* FirstVariable( void );
@@ -190,6 +214,28 @@ void VariableGroup::LoadSettingsFromFile( FILE* file )
     }
 }
 
+void VariableGroup::GetValues( const string& prefix, EngineTuning::Snapshot& values )
+{
+    for (auto iter = m_Children.begin(); iter != m_Children.end(); ++iter)
+    {
+        VariableGroup* subGroup = dynamic_cast<VariableGroup*>(iter->second);
+        if (subGroup != nullptr)
+            subGroup->GetValues(prefix + iter->first + "/", values);
+        else if (dynamic_cast<CallbackTrigger*>(iter->second) == nullptr)
+            values[prefix + iter->first] = iter->second->ToString();
+    }
+}
+
+string VariableGroup::GetPath( const EngineVar* var ) const
+{
+    for (auto iter = m_Children.begin(); iter != m_Children.end(); ++iter)
+    {
+        if (iter->second == var)
+            return this == &sm_RootGroup ? iter->first : m_GroupPtr->GetPath(this) + "/" + iter->first;
+    }
+    return "";
+}
+
 EngineVar* VariableGroup::FirstVariable( void )
 {
     return m_Children.size() == 0 ? nullptr : m_Children.begin()->second;
@@ -324,6 +370,18 @@ void BoolVar::SetValue(FILE* file, const std::string& setting)
         0 == _stricmp(valstr, "true") );
 }
 
+bool BoolVar::FromString( const std::string& value )
+{
+    const char* str = value.c_str();
+    if (0 == _stricmp(str, "1") || 0 == _stricmp(str, "on") || 0 == _stricmp(str, "yes") || 0 == _stricmp(str, "true"))
+        m_Flag = true;
+    else if (0 == _stricmp(str, "0") || 0 == _stricmp(str, "off") || 0 == _stricmp(str, "no") || 0 == _stricmp(str, "false"))
+        m_Flag = false;
+    else
+        return false;
+    return true;
+}
+
 NumVar::NumVar( const std::string& path, float val, float minVal, float maxVal, float stepSize )
     : EngineVar(path)
 {
@@ -356,6 +414,15 @@ void NumVar::SetValue(FILE* file, const std::string& setting)
         *this = valueRead; 
 }
 
+bool NumVar::FromString( const std::string& value )
+{
+    float valueRead;
+    if (sscanf_s(value.c_str(), "%f", &valueRead) != 1)
+        return false;
+    *this = valueRead;
+    return true;
+}
+
 #if _MSC_VER < 1800
 __forceinline float log2( float x ) { return log(x) / log(2.0f); }
 __forceinline float exp2( float x ) { return pow(2.0f, x); }
@@ -399,6 +466,15 @@ void ExpVar::SetValue(FILE* file, const std::string& setting)
         *this = valueRead;
 }
 
+bool ExpVar::FromString( const std::string& value )
+{
+    float valueRead;
+    if (sscanf_s(value.c_str(), "%f", &valueRead) != 1 || valueRead <= 0.0f)
+        return false;
+    *this = valueRead;
+    return true;
+}
+
 IntVar::IntVar( const std::string& path, int32_t val, int32_t minVal, int32_t maxVal, int32_t stepSize )
     : EngineVar(path)
 {
@@ -430,6 +506,15 @@ void IntVar::SetValue(FILE* file, const std::string& setting)
         *this = valueRead;
 }
 
+bool IntVar::FromString( const std::string& value )
+{
+    int32_t valueRead;
+    if (sscanf_s(value.c_str(), "%d", &valueRead) != 1)
+        return false;
+    *this = valueRead;
+    return true;
+}
+
 
 EnumVar::EnumVar( const std::string& path, int32_t initialVal, int32_t listLength, const char** listLabels )
     : EngineVar(path)
@@ -473,6 +558,25 @@ void EnumVar::SetValue(FILE* file, const std::string& setting)
 
 }
 
+bool EnumVar::FromString( const std::string& value )
+{
+    for (int32_t i = 0; i < m_EnumLength; ++i)
+    {
+        if (0 == _stricmp(m_EnumLabels[i], value.c_str()))
+        {
+            m_Value = i;
+            return true;
+        }
+    }
+
+    // Also accept the index of the label
+    int32_t valueRead;
+    if (sscanf_s(value.c_str(), "%d", &valueRead) != 1 || valueRead < 0 || valueRead >= m_EnumLength)
+        return false;
+    m_Value = valueRead;
+    return true;
+}
+
 CallbackTrigger::CallbackTrigger( const std::string& path, std::function<void (void*)> callback, void* args )
     : EngineVar(path)
 {
@@ -498,6 +602,12 @@ void CallbackTrigger::SetValue(FILE* file, const std::string& setting)
     fscanf_s(file, scanString.c_str(), skippedLines, _countof(skippedLines));
 }
 
+bool CallbackTrigger::FromString( const std::string& )
+{
+    Bang();
+    return true;
+}
+
 //=====================================================================================================================
 // EngineTuning namespace methods
 
@@ -512,6 +622,7 @@ void EngineTuning::Initialize( void )
     }
     s_UnregisteredCount = -1;
 
+    ParseCommandLine();
 }
 
 void HandleDigitalButtonPress( GameInput::DigitalInput button, float timeDelta, std::function<void ()> action )
@@ -540,6 +651,8 @@ void HandleDigitalButtonPress( GameInput::DigitalInput button, float timeDelta,
 
 void EngineTuning::Update( float frameTime )
 {
+    ApplyScript();
+
     if (GameInput::IsFirstPressed( GameInput::kBackButton )
         || GameInput::IsFirstPressed( GameInput::kKey_back ))
         sm_IsVisible = !sm_IsVisible;
@@ -554,13 +667,13 @@ void EngineTuning::Update( float frameTime )
         return;
 
     // Detect a DPad button press
-    HandleDigitalButtonPress(GameInput::kDPadRight, frameTime, []{ sm_SelectedVariable->Increment(); } );
-    HandleDigitalButtonPress(GameInput::kDPadLeft,    frameTime, []{ sm_SelectedVariable->Decrement(); } );
+    HandleDigitalButtonPress(GameInput::kDPadRight, frameTime, []{ sm_SelectedVariable->Increment(); RecordChange(sm_SelectedVariable); } );
+    HandleDigitalButtonPress(GameInput::kDPadLeft,    frameTime, []{ sm_SelectedVariable->Decrement(); RecordChange(sm_SelectedVariable); } );
     HandleDigitalButtonPress(GameInput::kDPadDown,    frameTime, []{ sm_SelectedVariable = sm_SelectedVariable->NextVar(); } );
     HandleDigitalButtonPress(GameInput::kDPadUp,    frameTime, []{ sm_SelectedVariable = sm_SelectedVariable->PrevVar(); } );
 
-    HandleDigitalButtonPress(GameInput::kKey_right, frameTime, []{ sm_SelectedVariable->Increment(); } );
-    HandleDigitalButtonPress(GameInput::kKey_left,    frameTime, []{ sm_SelectedVariable->Decrement(); } );
+    HandleDigitalButtonPress(GameInput::kKey_right, frameTime, []{ sm_SelectedVariable->Increment(); RecordChange(sm_SelectedVariable); } );
+    HandleDigitalButtonPress(GameInput::kKey_left,    frameTime, []{ sm_SelectedVariable->Decrement(); RecordChange(sm_SelectedVariable); } );
     HandleDigitalButtonPress(GameInput::kKey_down,    frameTime, []{ sm_SelectedVariable = sm_SelectedVariable->NextVar(); } );
     HandleDigitalButtonPress(GameInput::kKey_up,    frameTime, []{ sm_SelectedVariable = sm_SelectedVariable->PrevVar(); } );
 
@@ -568,6 +681,7 @@ void EngineTuning::Update( float frameTime )
         || GameInput::IsFirstPressed( GameInput::kKey_return ))
     {
         sm_SelectedVariable->Bang();
+        RecordChange(sm_SelectedVariable);
     }
 }
 
@@ -601,11 +715,13 @@ static CallbackTrigger Load("Load Settings", StartLoadFunc, nullptr);
 void EngineTuning::Display( GraphicsContext& Context, float x, float y, float w, float h )
 {
     GraphRenderer::RenderGraphs(Context, GraphRenderer::GraphType::Profile);
+    FramePacing::Display(Context, x + w * 0.25f, y + h * 0.68f);
 
     TextContext Text(Context);
     Text.Begin();
 
     EngineProfiling::DisplayFrameRate(Text);
+    GpuMemoryTracker::Display(Text, x + w - 440.0f, y);
 
     Text.ResetCursor( x, y );
 
@@ -621,6 +737,7 @@ void EngineTuning::Display( GraphicsContext& Context, float x, float y, float w,
     float hScale = g_DisplayWidth / 1920.0f;
     float vScale = g_DisplayHeight / 1080.0f;
 
+    Text.Flush();
     Context.SetScissor((uint32_t)Floor(x * hScale), (uint32_t)Floor(y * vScale), 
         (uint32_t)Ceiling((x + w) * hScale), (uint32_t)Ceiling((y + h) * vScale));
 
@@ -630,6 +747,7 @@ void EngineTuning::Display( GraphicsContext& Context, float x, float y, float w,
     Text.SetTextSize(20.0f);
 
     VariableGroup::sm_RootGroup.Display( Text, x, sm_SelectedVariable );
+    Text.Flush();
     
     EngineProfiling::DisplayPerfGraph(Context);
 
@@ -699,3 +817,168 @@ bool EngineTuning::IsFocused( void )
 {
     return sm_IsVisible;
 }
+
+EngineVar* EngineTuning::FindVariable( const std::string& path )
+{
+    EngineVar* node = &VariableGroup::sm_RootGroup;
+    size_t start = 0;
+
+    while (node != nullptr)
+    {
+        VariableGroup* group = dynamic_cast<VariableGroup*>(node);
+        if (group == nullptr)
+            return nullptr;
+
+        const size_t end = path.find('/', start);
+        node = group->FindChild(path.substr(start, end == string::npos ? string::npos : end - start));
+        if (end == string::npos)
+            return dynamic_cast<VariableGroup*>(node) == nullptr ? node : nullptr;
+        start = end + 1;
+    }
+    return nullptr;
+}
+
+bool EngineTuning::SetVariable( const std::string& path, const std::string& value )
+{
+    EngineVar* var = FindVariable(path);
+    return var != nullptr && var->FromString(value);
+}
+
+EngineTuning::Snapshot EngineTuning::TakeSnapshot( void )
+{
+    Snapshot values;
+    VariableGroup::sm_RootGroup.GetValues("", values);
+    return values;
+}
+
+void EngineTuning::RestoreSnapshot( const Snapshot& snapshot )
+{
+    for (auto iter = snapshot.begin(); iter != snapshot.end(); ++iter)
+        SetVariable(iter->first, iter->second);
+}
+
+namespace
+{
+    string Trim( const string& str )
+    {
+        const size_t first = str.find_first_not_of(" \t\r\n");
+        const size_t last = str.find_last_not_of(" \t\r\n");
+        return first == string::npos ? "" : str.substr(first, last - first + 1);
+    }
+
+    // Splits "<path> = <value>" at the first '='
+    bool SplitSetting( const string& setting, string& path, string& value )
+    {
+        const size_t equals = setting.find('=');
+        if (equals == string::npos)
+            return false;
+        path = Trim(setting.substr(0, equals));
+        value = Trim(setting.substr(equals + 1));
+        return !path.empty();
+    }
+}
+
+bool EngineTuning::LoadScript( const std::wstring& fileName )
+{
+    ifstream file(fileName);
+    if (!file)
+    {
+        Utility::Printf(L"Unable to open tuning script %s\n", fileName.c_str());
+        return false;
+    }
+
+    string line;
+    uint32_t lineNumber = 0;
+    while (getline(file, line))
+    {
+        ++lineNumber;
+        line = Trim(line);
+        if (line.empty() || line[0] == '#')
+            continue;
+
+        ScriptEntry entry;
+        char* rest = nullptr;
+        entry.Frame = strtoull(line.c_str(), &rest, 10);
+        if (rest == line.c_str() || !SplitSetting(rest, entry.Path, entry.Value))
+        {
+            Utility::Printf(L"%s(%u): expected \"<frame> <path> = <value>\"\n", fileName.c_str(), lineNumber);
+            continue;
+        }
+
+        // Frames already started apply on the next update
+        entry.Frame = max(entry.Frame, s_UpdateCount);
+        auto pos = upper_bound(s_Script.begin() + s_NextScriptEntry, s_Script.end(), entry,
+            []( const ScriptEntry& a, const ScriptEntry& b ) { return a.Frame < b.Frame; });
+        s_Script.insert(pos, entry);
+    }
+    return true;
+}
+
+void EngineTuning::ParseCommandLine( void )
+{
+#if WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_DESKTOP)
+    // Split the arguments at spaces, except inside quotes
+    vector<wstring> args(1);
+    bool quoted = false;
+    for (const wchar_t* c = GetCommandLineW(); *c != L'\0'; ++c)
+    {
+        if (*c == L'"')
+            quoted = !quoted;
+        else if (*c != L' ' || quoted)
+            args.back() += *c;
+        else if (!args.back().empty())
+            args.emplace_back();
+    }
+
+    for (size_t i = 1; i + 1 < args.size(); ++i)
+    {
+        if (args[i] == L"-tune")
+        {
+            string setting;
+            for (wchar_t c : args[++i])
+                setting += (char)c;
+
+            ScriptEntry entry = { 0 };
+            if (SplitSetting(setting, entry.Path, entry.Value))
+                s_Script.insert(s_Script.begin(), entry);
+        }
+        else if (args[i] == L"-tunescript")
+        {
+            LoadScript(args[++i]);
+        }
+        else if (args[i] == L"-tunerecord")
+        {
+            if (_wfopen_s(&s_RecordFile, args[++i].c_str(), L"w") != 0)
+            {
+                Utility::Printf(L"Unable to write tuning record %s\n", args[i].c_str());
+                s_RecordFile = nullptr;
+            }
+        }
+    }
+#endif
+}
+
+void EngineTuning::ApplyScript( void )
+{
+    s_CurrentFrame = s_UpdateCount++;
+
+    // Scripted settings apply before the application updates with them
+    for (; s_NextScriptEntry < s_Script.size() && s_Script[s_NextScriptEntry].Frame <= s_CurrentFrame; ++s_NextScriptEntry)
+    {
+        const ScriptEntry& entry = s_Script[s_NextScriptEntry];
+        if (SetVariable(entry.Path, entry.Value))
+            RecordChange(FindVariable(entry.Path));
+        else
+            Utility::Printf("Unable to set tuning variable %s to %s\n", entry.Path.c_str(), entry.Value.c_str());
+    }
+}
+
+void EngineTuning::RecordChange( EngineVar* var )
+{
+    if (s_RecordFile == nullptr || dynamic_cast<VariableGroup*>(var) != nullptr)
+        return;
+
+    const string value = dynamic_cast<CallbackTrigger*>(var) != nullptr ? "bang" : var->ToString();
+    fprintf(s_RecordFile, "%llu %s = %s\n", s_CurrentFrame, VariableGroup::sm_RootGroup.GetPath(var).c_str(), value.c_str());
+    fflush(s_RecordFile);
+}
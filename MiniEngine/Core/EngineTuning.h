@@ -35,6 +35,7 @@ public:
     virtual void DisplayValue( TextContext& ) const {}
     virtual std::string ToString( void ) const { return ""; }
     virtual void SetValue( FILE* file, const std::string& setting) = 0; //set value read from file
+    virtual bool FromString( const std::string& ) { return false; }    //set value written by ToString
 
     EngineVar* NextVar( void );
     EngineVar* PrevVar( void );
@@ -62,6 +63,7 @@ public:
     virtual void DisplayValue( TextContext& Text ) const override;
     virtual std::string ToString( void ) const override;
     virtual void SetValue( FILE* file, const std::string& setting) override;
+    virtual bool FromString( const std::string& value ) override;
 
 private:
     bool m_Flag;
@@ -80,6 +82,7 @@ public:
     virtual void DisplayValue( TextContext& Text ) const override;
     virtual std::string ToString( void ) const override;
     virtual void SetValue( FILE* file, const std::string& setting)  override;
+    virtual bool FromString( const std::string& value ) override;
 
 protected:
     float Clamp( float val ) { return val > m_MaxValue ? m_MaxValue : val < m_MinValue ? m_MinValue : val; }
@@ -100,6 +103,7 @@ public:
     virtual void DisplayValue( TextContext& Text ) const override;
     virtual std::string ToString( void ) const override;
     virtual void SetValue( FILE* file, const std::string& setting ) override;
+    virtual bool FromString( const std::string& value ) override;
 
 };
 
@@ -116,6 +120,7 @@ public:
     virtual void DisplayValue( TextContext& Text ) const override;
     virtual std::string ToString( void ) const override;
     virtual void SetValue( FILE* file, const std::string& setting ) override;
+    virtual bool FromString( const std::string& value ) override;
 
 protected:
     int32_t Clamp( int32_t val ) { return val > m_MaxValue ? m_MaxValue : val < m_MinValue ? m_MinValue : val; }
@@ -139,6 +144,7 @@ public:
     virtual void DisplayValue( TextContext& Text ) const override;
     virtual std::string ToString( void ) const override;
     virtual void SetValue( FILE* file, const std::string& setting ) override;
+    virtual bool FromString( const std::string& value ) override;
 
     void SetListLength(int32_t listLength) { m_EnumLength = listLength; m_Value = Clamp(m_Value); }
 
@@ -159,6 +165,7 @@ public:
 
     virtual void DisplayValue( TextContext& Text ) const override;
     virtual void SetValue( FILE* file, const std::string& setting ) override;
+    virtual bool FromString( const std::string& value ) override;    // Any value bangs
 
 private:
     std::function<void (void*)> m_Callback;
@@ -175,4 +182,20 @@ namespace EngineTuning
     void Display( GraphicsContext& Context, float x, float y, float w, float h );
     bool IsFocused( void );
 
+    // Variables are named by their full path, such as "Graphics/SSAO/Enable".  Values are written as the
+    // settings file writes them:  on or off, numbers, or an enum's label.
+    EngineVar* FindVariable( const std::string& path );
+    bool SetVariable( const std::string& path, const std::string& value );
+
+    // The value of every variable, keyed by path, to be restored after a scripted run
+    typedef std::map<std::string, std::string> Snapshot;
+    Snapshot TakeSnapshot( void );
+    void RestoreSnapshot( const Snapshot& snapshot );
+
+    // A script has one "<frame> <path> = <value>" per line, applied at the start of that frame, counting from
+    // the first update.  It is also given with -tunescript <file> on the command line, and single settings
+    // with -tune "<path>=<value>", applied before the first frame.  -tunerecord <file> writes the changes made
+    // through the menu as a script that replays them.
+    bool LoadScript( const std::wstring& fileName );
+
 } // namespace EngineTuning
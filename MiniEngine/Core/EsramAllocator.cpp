@@ -0,0 +1,63 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "pch.h"
+#include "EsramAllocator.h"
+#include "GraphicsCore.h"
+
+namespace Graphics
+{
+    BoolVar FastMemoryTier("Graphics/Fast Memory Tier/Enable", true);
+    IntVar FastMemoryTierMB("Graphics/Fast Memory Tier/Budget MB", 128, 0, 4096, 16);
+}
+
+using namespace Graphics;
+
+EsramAllocator::EsramAllocator() : m_Budget(0), m_Used(0)
+{
+    if (!FastMemoryTier)
+        return;
+
+    D3D12_FEATURE_DATA_ARCHITECTURE Architecture = {};
+    if (FAILED(g_Device->CheckFeatureSupport(D3D12_FEATURE_ARCHITECTURE, &Architecture, sizeof(Architecture))) || Architecture.UMA)
+        return;
+
+    m_Budget = (uint64_t)(int32_t)FastMemoryTierMB << 20;
+}
+
+bool EsramAllocator::Place( ID3D12Pageable* Pageable, uint64_t Size, const std::wstring& Name )
+{
+    if (Pageable == nullptr || Size == 0 || m_Used + Size > m_Budget)
+        return false;
+
+    Microsoft::WRL::ComPtr<ID3D12Device1> Device1;
+    if (FAILED(g_Device->QueryInterface(MY_IID_PPV_ARGS(&Device1))))
+        return false;
+
+    const D3D12_RESIDENCY_PRIORITY Priority = D3D12_RESIDENCY_PRIORITY_HIGH;
+    if (FAILED(Device1->SetResidencyPriority(1, &Pageable, &Priority)))
+        return false;
+
+    m_Used += Size;
+    EngineProfiling::SetCounter("Fast Memory Tier KB", (uint32_t)(m_Used >> 10));
+
+    Utility::Printf(L"Fast memory tier:  %s, %llu KB\n", Name.c_str(), Size >> 10);
+
+    return true;
+}
+
+bool EsramAllocator::Place( ID3D12Resource* Resource, const std::wstring& Name )
+{
+    if (Resource == nullptr)
+        return false;
+
+    D3D12_RESOURCE_DESC Desc = Resource->GetDesc();
+    D3D12_RESOURCE_ALLOCATION_INFO Info = g_Device->GetResourceAllocationInfo(0, 1, &Desc);
+    return Place(Resource, Info.SizeInBytes, Name);
+}
@@ -15,11 +15,23 @@
 
 #include "pch.h"
 
+namespace Graphics
+{
+    extern BoolVar FastMemoryTier;
+    extern IntVar FastMemoryTierMB;
+}
+
+// Places the hottest render targets in the fast memory tier.  PC has no ESRAM to carve virtual addresses
+// out of, so Alloc() still returns D3D12_GPU_VIRTUAL_ADDRESS_UNKNOWN and the targets are committed as
+// usual.  What Place() does instead is raise their residency priority, in the order they are placed and
+// until the budget runs out, so that under memory pressure these are the last to be demoted to system
+// memory.  On UMA adapters there is no faster tier and the budget is zero.
 class EsramAllocator
 {
 public:
-    EsramAllocator() {}
+    EsramAllocator();
 
+    // Resources do not alias on PC, so popping a scope gives none of the tier back
     void PushStack() {}
     void PopStack() {}
 
@@ -29,9 +41,18 @@ public:
         return D3D12_GPU_VIRTUAL_ADDRESS_UNKNOWN;
     }
 
+    // Returns true when the pageable was promoted to the fast tier
+    bool Place( ID3D12Pageable* Pageable, uint64_t Size, const std::wstring& Name );
+    bool Place( ID3D12Resource* Resource, const std::wstring& Name );
+
     intptr_t SizeOfFreeSpace( void ) const
     {
-        return 0;
+        return (intptr_t)(m_Budget - m_Used);
     }
 
+    uint64_t GetUsedSize( void ) const { return m_Used; }
+
+private:
+    uint64_t m_Budget;
+    uint64_t m_Used;
 };
@@ -13,8 +13,11 @@
 
 #include "pch.h"
 #include "FileUtility.h"
+#include "JobSystem.h"
+#include "CpuProfiler.h"
 #include <fstream>
 #include <mutex>
+#include <atomic>
 #include <zlib.h> // From NuGet package 
 
 using namespace std;
@@ -26,6 +29,7 @@ namespace Utility
 }
 
 ByteArray DecompressZippedFile( wstring& fileName );
+ByteArray DecompressBlockFile( wstring& fileName );
 
 ByteArray ReadFileHelper(const wstring& fileName)
 {
@@ -49,32 +53,59 @@ ByteArray ReadFileHelper(const wstring& fileName)
 
 ByteArray ReadFileHelperEx( shared_ptr<wstring> fileName)
 {
-    std::wstring zippedFileName = *fileName + L".gz";
-    ByteArray firstTry = DecompressZippedFile(zippedFileName);
+    std::wstring blockFileName = *fileName + kBlockFileSuffix;
+    ByteArray firstTry = DecompressBlockFile(blockFileName);
     if (firstTry != NullFile)
         return firstTry;
 
+    std::wstring zippedFileName = *fileName + L".gz";
+    ByteArray secondTry = DecompressZippedFile(zippedFileName);
+    if (secondTry != NullFile)
+        return secondTry;
+
     return ReadFileHelper(*fileName);
 }
 
 ByteArray Inflate(ByteArray CompressedSource, int& err, uint32_t ChunkSize = 0x100000 ) 
 {
-    // Create a dynamic buffer to hold compressed blocks
-    vector<unique_ptr<byte> > blocks;
+    // A gzip file ends with its decompressed size (modulo 4GB), so the output can be inflated in place without
+    // growing it.  The extra byte leaves room for inflate() to reach the end of the stream in the same pass.
+    size_t OutputSize = ChunkSize;
+    const size_t SourceSize = CompressedSource->size();
+    if (SourceSize >= 18 && (*CompressedSource)[0] == 0x1f && (*CompressedSource)[1] == 0x8b)
+    {
+        uint32_t DecompressedSize;
+        memcpy(&DecompressedSize, CompressedSource->data() + SourceSize - 4, sizeof(DecompressedSize));
+        OutputSize = (size_t)DecompressedSize + 1;
+    }
+
+    Utility::ByteArray byteArray = make_shared<vector<byte> >( OutputSize );
 
     z_stream strm  = {};
     strm.data_type = Z_BINARY;
-    strm.total_in  = strm.avail_in  = (uInt)CompressedSource->size();
+    strm.total_in  = strm.avail_in  = (uInt)SourceSize;
     strm.next_in   = CompressedSource->data();
+    strm.avail_out = (uInt)OutputSize;
+    strm.next_out  = byteArray->data();
 
     err = inflateInit2(&strm, (15 + 32)); //15 window bits, and the +32 tells zlib to to detect if using gzip or zlib
 
-    while (err == Z_OK || err == Z_BUF_ERROR)
+    while (err == Z_OK)
     {
-        strm.avail_out = ChunkSize;
-        strm.next_out = (byte*)malloc(ChunkSize);
-        blocks.emplace_back(strm.next_out);
+        // Only when the size was unknown or wrong
+        if (strm.avail_out == 0)
+        {
+            const size_t Used = strm.total_out;
+            byteArray->resize(byteArray->size() * 2);
+            strm.next_out = byteArray->data() + Used;
+            strm.avail_out = (uInt)(byteArray->size() - Used);
+        }
+
         err = inflate(&strm, Z_NO_FLUSH);
+
+        // A buffer error with output space left means the input was cut short
+        if (err == Z_BUF_ERROR && strm.avail_out == 0)
+            err = Z_OK;
     }
 
     if (err != Z_STREAM_END) 
@@ -85,24 +116,7 @@ ByteArray Inflate(ByteArray CompressedSource, int& err, uint32_t ChunkSize = 0x1
 
     ASSERT(strm.total_out > 0, "Nothing to decompress");
 
-    Utility::ByteArray byteArray = make_shared<vector<byte> >( strm.total_out );
-
-    // Allocate actual memory for this.
-    // copy the bits into that RAM.
-    // Free everything else up!!
-    void* curDest = byteArray->data();
-    size_t remaining = byteArray->size();
-
-    for (size_t i = 0; i < blocks.size(); ++i)
-    {
-        ASSERT(remaining > 0);
-
-        size_t CopySize = min(remaining, (size_t)ChunkSize);
-
-        memcpy(curDest, blocks[i].get(), CopySize);
-        curDest = (byte*)curDest + CopySize;
-        remaining -= CopySize;
-    }
+    byteArray->resize(strm.total_out);
 
     inflateEnd(&strm);
 
@@ -126,6 +140,241 @@ ByteArray DecompressZippedFile( wstring& fileName )
     return DecompressedFile;
 }
 
+namespace
+{
+    // All fields are little-endian.  The header is followed by BlockCount + 1 offsets from the start of the
+    // file, one at the start of each compressed block and one at the end of the last.
+    struct BlockFileHeader
+    {
+        uint32_t Magic;
+        uint16_t Version;
+        uint16_t Codec;
+        uint32_t BlockSize;                 // Decompressed size of every block but the last
+        uint32_t BlockCount;
+        uint64_t DecompressedSize;
+    };
+
+    const uint32_t kBlockFileMagic = 0x4B4C425A;    // "ZBLK"
+    const uint16_t kBlockFileVersion = 1;
+
+    const BlockFileHeader* GetBlockFileHeader( const void* data, size_t size )
+    {
+        if (size < sizeof(BlockFileHeader))
+            return nullptr;
+
+        const BlockFileHeader* header = (const BlockFileHeader*)data;
+        if (header->Magic != kBlockFileMagic || header->Version != kBlockFileVersion ||
+            header->Codec >= kNumBlockCodecs || header->BlockSize == 0 || header->DecompressedSize == 0)
+            return nullptr;
+
+        if (header->BlockCount != (header->DecompressedSize + header->BlockSize - 1) / header->BlockSize)
+            return nullptr;
+
+        if ((size - sizeof(BlockFileHeader)) / sizeof(uint64_t) < (size_t)header->BlockCount + 1)
+            return nullptr;
+
+        return header;
+    }
+
+    // Decodes an LZ4 block (not an LZ4 frame), which must decompress to exactly DestSize bytes
+    bool DecodeLZ4( const byte* src, size_t srcSize, byte* dest, size_t destSize )
+    {
+        const byte* ip = src;
+        const byte* const srcEnd = src + srcSize;
+        byte* op = dest;
+        byte* const destEnd = dest + destSize;
+
+        // Lengths of 15 carry on in bytes that are added until one is less than 255
+        auto ReadLength = [&]( size_t& length ) -> bool
+        {
+            if (length != 15)
+                return true;
+
+            byte b;
+            do
+            {
+                if (ip == srcEnd)
+                    return false;
+                b = *ip++;
+                length += b;
+            } while (b == 255);
+            return true;
+        };
+
+        while (ip < srcEnd)
+        {
+            const uint32_t token = *ip++;
+
+            size_t literalLength = token >> 4;
+            if (!ReadLength(literalLength) || (size_t)(srcEnd - ip) < literalLength ||
+                (size_t)(destEnd - op) < literalLength)
+                return false;
+
+            memcpy(op, ip, literalLength);
+            ip += literalLength;
+            op += literalLength;
+
+            // The last sequence has only literals
+            if (ip == srcEnd)
+                break;
+
+            if (srcEnd - ip < 2)
+                return false;
+
+            const size_t offset = ip[0] | (ip[1] << 8);
+            ip += 2;
+
+            size_t matchLength = token & 15;
+            if (offset == 0 || offset > (size_t)(op - dest) || !ReadLength(matchLength))
+                return false;
+
+            matchLength += 4;
+            if ((size_t)(destEnd - op) < matchLength)
+                return false;
+
+            // A match may overlap the bytes it produces, which repeats the last offset bytes
+            const byte* match = op - offset;
+            if (offset >= matchLength)
+            {
+                memcpy(op, match, matchLength);
+                op += matchLength;
+            }
+            else
+            {
+                for (size_t i = 0; i < matchLength; ++i)
+                    *op++ = *match++;
+            }
+        }
+
+        return op == destEnd;
+    }
+
+    bool DecodeBlock( BlockCodec codec, const byte* src, size_t srcSize, byte* dest, size_t destSize )
+    {
+        switch (codec)
+        {
+        case kCodecStored:
+            if (srcSize != destSize)
+                return false;
+            memcpy(dest, src, destSize);
+            return true;
+
+        case kCodecDeflate:
+        {
+            // Raw deflate without a zlib or gzip wrapper, inflated in one call because the size is known
+            z_stream strm = {};
+            strm.next_in = (byte*)src;
+            strm.avail_in = (uInt)srcSize;
+            strm.next_out = dest;
+            strm.avail_out = (uInt)destSize;
+            if (inflateInit2(&strm, -15) != Z_OK)
+                return false;
+            const int err = inflate(&strm, Z_FINISH);
+            inflateEnd(&strm);
+            return err == Z_STREAM_END && strm.total_out == destSize;
+        }
+
+        case kCodecLZ4:
+            return DecodeLZ4(src, srcSize, dest, destSize);
+
+        default:
+            return false;
+        }
+    }
+
+    // Runs Func(BlockIndex) for every block, in parallel when there are job system workers.  The blocks
+    // are decompressed one per job because each is typically a few hundred KB.
+    bool ForEachBlock( const void* data, size_t size, const function<bool(uint32_t, const byte*, size_t)>& Func )
+    {
+        const BlockFileHeader* header = GetBlockFileHeader(data, size);
+        if (header == nullptr)
+            return false;
+
+        const uint64_t* offsets = (const uint64_t*)(header + 1);
+        const uint64_t indexEnd = sizeof(BlockFileHeader) + ((uint64_t)header->BlockCount + 1) * sizeof(uint64_t);
+
+        atomic<bool> succeeded(true);
+        auto DecodeBlocks = [&]( uint32_t Begin, uint32_t End )
+        {
+            CPU_PROFILE_SCOPE(L"Decode Blocks");
+            for (uint32_t i = Begin; i < End && succeeded.load(memory_order_relaxed); ++i)
+            {
+                if (offsets[i] < indexEnd || offsets[i] > offsets[i + 1] || offsets[i + 1] > size ||
+                    !Func(i, (const byte*)data + offsets[i], (size_t)(offsets[i + 1] - offsets[i])))
+                    succeeded = false;
+            }
+        };
+
+        if (JobSystem::GetWorkerCount() > 0 && header->BlockCount > 1)
+            JobSystem::ParallelFor(header->BlockCount, 1, DecodeBlocks);
+        else
+            DecodeBlocks(0, header->BlockCount);
+
+        return succeeded;
+    }
+}
+
+size_t Utility::GetBlockDecompressedSize( const void* data, size_t size )
+{
+    const BlockFileHeader* header = GetBlockFileHeader(data, size);
+    return header == nullptr ? 0 : (size_t)header->DecompressedSize;
+}
+
+bool Utility::DecompressBlocks( const void* data, size_t size, void* dest )
+{
+    const BlockFileHeader* header = GetBlockFileHeader(data, size);
+    if (header == nullptr)
+        return false;
+
+    return ForEachBlock(data, size, [header, dest]( uint32_t i, const byte* block, size_t blockSize )
+    {
+        const uint64_t offset = (uint64_t)i * header->BlockSize;
+        const size_t decompressedSize = (size_t)min<uint64_t>(header->BlockSize, header->DecompressedSize - offset);
+        return DecodeBlock((BlockCodec)header->Codec, block, blockSize, (byte*)dest + offset, decompressedSize);
+    });
+}
+
+bool Utility::DecompressBlocks( const void* data, size_t size, const BlockCallback& callback )
+{
+    const BlockFileHeader* header = GetBlockFileHeader(data, size);
+    if (header == nullptr)
+        return false;
+
+    return ForEachBlock(data, size, [header, &callback]( uint32_t i, const byte* block, size_t blockSize )
+    {
+        // Each thread keeps its scratch block for the next file
+        thread_local vector<byte> scratch;
+        if (scratch.size() < header->BlockSize)
+            scratch.resize(header->BlockSize);
+
+        const uint64_t offset = (uint64_t)i * header->BlockSize;
+        const size_t decompressedSize = (size_t)min<uint64_t>(header->BlockSize, header->DecompressedSize - offset);
+        if (!DecodeBlock((BlockCodec)header->Codec, block, blockSize, scratch.data(), decompressedSize))
+            return false;
+
+        callback((size_t)offset, scratch.data(), decompressedSize);
+        return true;
+    });
+}
+
+ByteArray DecompressBlockFile( wstring& fileName )
+{
+    ByteArray CompressedFile = ReadFileHelper(fileName);
+    if (CompressedFile == NullFile)
+        return NullFile;
+
+    const size_t DecompressedSize = GetBlockDecompressedSize(CompressedFile->data(), CompressedFile->size());
+    ByteArray DecompressedFile = DecompressedSize > 0 ? make_shared<vector<byte> >(DecompressedSize) : NullFile;
+    if (DecompressedSize == 0 ||
+        !DecompressBlocks(CompressedFile->data(), CompressedFile->size(), DecompressedFile->data()))
+    {
+        Utility::Printf(L"Couldn't decompress block file %s\n", fileName.c_str());
+        return NullFile;
+    }
+
+    return DecompressedFile;
+}
+
 ByteArray Utility::ReadFileSync( const wstring& fileName)
 {
     return ReadFileHelperEx(make_shared<wstring>(fileName));
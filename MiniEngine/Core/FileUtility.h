@@ -16,6 +16,7 @@
 #include "pch.h"
 #include <vector>
 #include <string>
+#include <functional>
 #include <ppl.h>
 
 namespace Utility
@@ -27,11 +28,32 @@ namespace Utility
     extern ByteArray NullFile;
 
     // Reads the entire contents of a binary file.  If the file with the same name except with an additional
-    // ".gz" suffix exists, it will be loaded and decompressed instead.
+    // ".zblk" or ".gz" suffix exists, it will be loaded and decompressed instead, in that order of preference.
     // This operation blocks until the entire file is read.
     ByteArray ReadFileSync(const wstring& fileName);
 
     // Same as previous except that it does not block but instead returns a task.
     task<ByteArray> ReadFileAsync(const wstring& fileName);
 
+    // Block-compressed (".zblk") files are split into blocks that are compressed independently, followed by an
+    // index of them, so that the blocks can be decompressed in parallel on the job system.  They are written by
+    // Tools/Scripts/CompressBlocks.py.  LZ4 decompresses several times faster than deflate for a somewhat
+    // larger file.
+    enum BlockCodec { kCodecStored, kCodecDeflate, kCodecLZ4, kNumBlockCodecs };
+
+    const wchar_t* const kBlockFileSuffix = L".zblk";
+
+    // Returns the decompressed size of block-compressed data, or 0 if the data is not block-compressed
+    size_t GetBlockDecompressedSize(const void* data, size_t size);
+
+    // Decompresses into memory holding GetBlockDecompressedSize() bytes.  It is read back while decompressing,
+    // so it should not be write-combined upload memory.
+    bool DecompressBlocks(const void* data, size_t size, void* dest);
+
+    // Decompresses each block into scratch memory and passes it to the callback, which may copy it anywhere,
+    // such as into upload memory.  Blocks arrive in no particular order and possibly on several threads at
+    // once.  Returns false if any block is corrupt, in which case some blocks may not have been passed on.
+    typedef function<void(size_t offset, const void* data, size_t size)> BlockCallback;
+    bool DecompressBlocks(const void* data, size_t size, const BlockCallback& callback);
+
 } // namespace Utility
@@ -0,0 +1,174 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "pch.h"
+#include "FrameArena.h"
+#include "EngineProfiling.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+using namespace std;
+
+namespace FrameArena
+{
+    static const size_t kChunkSize = 64 * 1024;
+
+    struct Chunk
+    {
+        Chunk* Next;
+        size_t Size;    // Of the memory after the header
+    };
+
+    // One half of a thread's arena, which is rewound the first time it is used in a frame of its parity
+    struct Half
+    {
+        Chunk* Chunks = nullptr;        // Kept from frame to frame
+        Chunk* Oversized = nullptr;     // Freed when the half is rewound
+        Chunk* Current = nullptr;
+        size_t Offset = 0;
+        uint64_t Frame = UINT64_MAX;
+    };
+
+    struct ThreadArena
+    {
+        Half Halves[2];
+
+        ~ThreadArena()
+        {
+            for (Half& H : Halves)
+            {
+                FreeList(H.Chunks);
+                FreeList(H.Oversized);
+            }
+        }
+
+        static void FreeList( Chunk* List )
+        {
+            while (List != nullptr)
+            {
+                Chunk* Next = List->Next;
+                free(List);
+                List = Next;
+            }
+        }
+    };
+
+    atomic<uint64_t> s_FrameIndex(0);
+    atomic<uint64_t> s_BytesAllocated(0);
+    thread_local ThreadArena t_Arena;
+
+    Chunk* NewChunk( size_t Size )
+    {
+        Chunk* NewOne = (Chunk*)malloc(sizeof(Chunk) + Size);
+        if (NewOne == nullptr)
+            throw bad_alloc();
+        NewOne->Next = nullptr;
+        NewOne->Size = Size;
+        return NewOne;
+    }
+
+    inline uint8_t* ChunkData( Chunk* C ) { return (uint8_t*)(C + 1); }
+
+#ifndef RELEASE
+    atomic<uint32_t> s_HeapAllocations(0);
+#endif
+}
+
+void* FrameArena::Allocate( size_t Size, size_t Alignment )
+{
+    ASSERT((Alignment & (Alignment - 1)) == 0, "Alignment must be a power of two");
+    if (Alignment < alignof(Chunk))
+        Alignment = alignof(Chunk);
+
+    const uint64_t Frame = s_FrameIndex.load(memory_order_relaxed);
+    Half& H = t_Arena.Halves[Frame & 1];
+
+    if (H.Frame != Frame)
+    {
+        ThreadArena::FreeList(H.Oversized);
+        H.Oversized = nullptr;
+        H.Current = H.Chunks;
+        H.Offset = 0;
+        H.Frame = Frame;
+    }
+
+    s_BytesAllocated.fetch_add(Size, memory_order_relaxed);
+
+    // Requests bigger than a chunk get one of their own
+    if (Size + Alignment > kChunkSize)
+    {
+        Chunk* Large = NewChunk(Size + Alignment);
+        Large->Next = H.Oversized;
+        H.Oversized = Large;
+        return (void*)Math::AlignUp((size_t)ChunkData(Large), Alignment);
+    }
+
+    for (;;)
+    {
+        if (H.Current != nullptr)
+        {
+            const size_t Base = (size_t)ChunkData(H.Current);
+            const size_t Start = Math::AlignUp(Base + H.Offset, Alignment) - Base;
+            if (Start + Size <= H.Current->Size)
+            {
+                H.Offset = Start + Size;
+                return (void*)(Base + Start);
+            }
+
+            // Move on to the next chunk kept from an earlier frame, or add one
+            if (H.Current->Next == nullptr)
+                H.Current->Next = NewChunk(kChunkSize);
+            H.Current = H.Current->Next;
+        }
+        else
+        {
+            H.Chunks = NewChunk(kChunkSize);
+            H.Current = H.Chunks;
+        }
+        H.Offset = 0;
+    }
+}
+
+void FrameArena::EndFrame( void )
+{
+    s_FrameIndex.fetch_add(1, memory_order_relaxed);
+}
+
+void FrameArena::ReportStatistics( void )
+{
+    EngineProfiling::SetCounter("Frame Arena KB", (uint32_t)(s_BytesAllocated.exchange(0) / 1024));
+#ifndef RELEASE
+    EngineProfiling::SetCounter("Heap Allocs / Frame", s_HeapAllocations.exchange(0));
+#endif
+}
+
+#ifndef RELEASE
+
+// The array and nothrow forms of operator new go through this one
+void* operator new( size_t Size )
+{
+    FrameArena::s_HeapAllocations.fetch_add(1, memory_order_relaxed);
+    void* Memory = malloc(Size == 0 ? 1 : Size);
+    if (Memory == nullptr)
+        throw bad_alloc();
+    return Memory;
+}
+
+void operator delete( void* Memory ) noexcept
+{
+    free(Memory);
+}
+
+void operator delete( void* Memory, size_t ) noexcept
+{
+    free(Memory);
+}
+
+#endif
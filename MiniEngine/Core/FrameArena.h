@@ -0,0 +1,59 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// CPU scratch memory for work that only lives for a frame:  culling lists, command list arrays and the like.
+// Each thread bumps a pointer through chunks of its own, so allocating takes no lock, and nothing is freed one
+// allocation at a time.  Memory stays valid until the end of the frame after the one it was allocated in, so
+// the pipelined Update() may hand what it allocates to the frame that renders it.  Destructors are not run.
+//
+// Outside of release builds, heap allocations made through operator new are counted, and the count for each
+// frame is shown as the "Heap Allocs / Frame" counter.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace FrameArena
+{
+    void* Allocate( size_t Size, size_t Alignment = 16 );
+
+    template <typename T>
+    T* AllocateArray( size_t Count )
+    {
+        return (T*)Allocate(sizeof(T) * Count, alignof(T) > 16 ? alignof(T) : 16);
+    }
+
+    // Starts the next frame.  Called by GameCore after Present().
+    void EndFrame( void );
+
+    void ReportStatistics( void );
+
+    // An STL allocator for containers that do not outlive the next frame
+    template <typename T>
+    class FrameAllocator
+    {
+    public:
+        typedef T value_type;
+
+        FrameAllocator() = default;
+        template <typename U> FrameAllocator( const FrameAllocator<U>& ) {}
+
+        T* allocate( size_t Count ) { return (T*)Allocate(sizeof(T) * Count, alignof(T)); }
+        void deallocate( T*, size_t ) {}
+
+        template <typename U> bool operator==( const FrameAllocator<U>& ) const { return true; }
+        template <typename U> bool operator!=( const FrameAllocator<U>& ) const { return false; }
+    };
+
+    template <typename T>
+    using FrameVector = std::vector<T, FrameAllocator<T>>;
+
+} // namespace FrameArena
@@ -0,0 +1,192 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "pch.h"
+#include "FrameGraph.h"
+#include "ColorBuffer.h"
+#include "CommandContext.h"
+#include "GraphicsCore.h"
+#include "GpuMemoryTracker.h"
+#include <algorithm>
+
+using namespace Graphics;
+
+FrameGraph::PassHandle FrameGraph::AddPass( const std::wstring& Name )
+{
+    ASSERT(m_Heap == nullptr, "Passes must be added before the frame graph is compiled");
+
+    Pass NewPass;
+    NewPass.Name = Name;
+    m_Passes.push_back(NewPass);
+    return (PassHandle)m_Passes.size() - 1;
+}
+
+void FrameGraph::AddTransient( ColorBuffer& Buffer, const std::wstring& Name, uint32_t Width, uint32_t Height,
+    uint32_t ArrayCount, DXGI_FORMAT Format )
+{
+    ASSERT(m_Heap == nullptr, "Transient buffers must be added before the frame graph is compiled");
+    ASSERT(FindTransient(Buffer) == nullptr);
+
+    Transient NewTransient = {};
+    NewTransient.Buffer = &Buffer;
+    NewTransient.Name = Name;
+    NewTransient.Width = Width;
+    NewTransient.Height = Height;
+    NewTransient.ArrayCount = ArrayCount;
+    NewTransient.Format = Format;
+    NewTransient.FirstPass = ~0u;
+    m_Transients.push_back(NewTransient);
+}
+
+void FrameGraph::Reads( PassHandle Pass, ColorBuffer& Buffer )
+{
+    UseTransient(Pass, Buffer, false);
+}
+
+void FrameGraph::Writes( PassHandle Pass, ColorBuffer& Buffer )
+{
+    UseTransient(Pass, Buffer, true);
+}
+
+FrameGraph::Transient* FrameGraph::FindTransient( ColorBuffer& Buffer )
+{
+    for (Transient& T : m_Transients)
+    {
+        if (T.Buffer == &Buffer)
+            return &T;
+    }
+    return nullptr;
+}
+
+void FrameGraph::UseTransient( PassHandle Pass, ColorBuffer& Buffer, bool Write )
+{
+    ASSERT(Pass < m_Passes.size());
+
+    // Buffers that are not transient live for the whole frame, so their uses change nothing
+    Transient* T = FindTransient(Buffer);
+    if (T == nullptr)
+        return;
+
+    if (T->FirstPass == ~0u || Pass < T->FirstPass)
+    {
+        T->FirstPass = Pass;
+        T->WrittenFirst = Write;
+    }
+    else if (Pass == T->FirstPass)
+    {
+        T->WrittenFirst = T->WrittenFirst || Write;
+    }
+    T->LastPass = std::max(T->LastPass, Pass);
+}
+
+void FrameGraph::Compile( void )
+{
+    ASSERT(m_Heap == nullptr);
+
+    m_HeapSize = 0;
+    m_TotalSize = 0;
+
+    std::vector<Transient*> Order;
+    for (Transient& T : m_Transients)
+    {
+        ASSERT(T.FirstPass != ~0u, "A transient buffer is used by no pass");
+        ASSERT(T.WrittenFirst, "A transient buffer is read before it is written");
+
+        const D3D12_RESOURCE_ALLOCATION_INFO Info = T.Buffer->GetPlacedAllocationInfo(T.Width, T.Height, T.ArrayCount, T.Format);
+        T.Size = Info.SizeInBytes;
+        T.Alignment = Info.Alignment;
+        m_TotalSize += T.Size;
+        Order.push_back(&T);
+    }
+
+    if (Order.empty())
+        return;
+
+    // Place the largest buffers first, each at the lowest offset where it overlaps no buffer already placed that
+    // is alive at the same time
+    std::sort(Order.begin(), Order.end(), []( const Transient* A, const Transient* B ) { return A->Size > B->Size; });
+
+    std::vector<Transient*> Placed;
+    for (Transient* T : Order)
+    {
+        uint64_t Offset = 0;
+        for (bool Moved = true; Moved; )
+        {
+            Moved = false;
+            for (const Transient* Other : Placed)
+            {
+                const bool Alive = T->FirstPass <= Other->LastPass && Other->FirstPass <= T->LastPass;
+                const bool Overlaps = Offset < Other->HeapOffset + Other->Size && Other->HeapOffset < Offset + T->Size;
+                if (Alive && Overlaps)
+                {
+                    Offset = Math::AlignUp(Other->HeapOffset + Other->Size, T->Alignment);
+                    Moved = true;
+                }
+            }
+        }
+
+        T->HeapOffset = Offset;
+        m_HeapSize = std::max(m_HeapSize, Offset + T->Size);
+        Placed.push_back(T);
+    }
+
+    // Color buffers are all render targets, which tier 1 heaps keep apart from other resources
+    D3D12_HEAP_DESC HeapDesc = {};
+    HeapDesc.SizeInBytes = m_HeapSize;
+    HeapDesc.Properties.Type = D3D12_HEAP_TYPE_DEFAULT;
+    HeapDesc.Properties.CreationNodeMask = 1;
+    HeapDesc.Properties.VisibleNodeMask = 1;
+    HeapDesc.Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+    HeapDesc.Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES;
+    ASSERT_SUCCEEDED(g_Device->CreateHeap(&HeapDesc, MY_IID_PPV_ARGS(&m_Heap)));
+    m_Heap->SetName(L"Transient Buffer Heap");
+    GpuMemoryTracker::TrackHeap(m_Heap.Get(), GpuMemoryTracker::kRenderTargets);
+
+    for (Transient& T : m_Transients)
+    {
+        T.Buffer->CreatePlaced(T.Name, T.Width, T.Height, T.ArrayCount, T.Format, m_Heap.Get(), T.HeapOffset);
+        m_Passes[T.FirstPass].Activates.push_back(T.Buffer);
+    }
+
+    Utility::Printf("Transient buffers use %llu KB of memory rather than %llu KB\n", m_HeapSize / 1024, m_TotalSize / 1024);
+}
+
+void FrameGraph::BeginPass( CommandContext& Context, PassHandle Pass )
+{
+    ASSERT(Pass < m_Passes.size());
+
+    // Discarding is the first thing done to memory another resource used.  Render targets are discarded in the
+    // render target state, except on the compute queue, where it has to be unordered access.
+    const D3D12_RESOURCE_STATES DiscardState = Context.GetType() == D3D12_COMMAND_LIST_TYPE_COMPUTE ?
+        D3D12_RESOURCE_STATE_UNORDERED_ACCESS : D3D12_RESOURCE_STATE_RENDER_TARGET;
+
+    const std::vector<ColorBuffer*>& Activates = m_Passes[Pass].Activates;
+    if (Activates.empty())
+        return;
+
+    Context.InsertAliasBarrier();
+    for (ColorBuffer* Buffer : Activates)
+        Context.TransitionResource(*Buffer, DiscardState);
+    Context.FlushResourceBarriers();
+
+    for (ColorBuffer* Buffer : Activates)
+        Context.GetCommandList()->DiscardResource(Buffer->GetResource(), nullptr);
+}
+
+void FrameGraph::Destroy( void )
+{
+    for (Transient& T : m_Transients)
+        T.Buffer->Destroy();
+
+    m_Passes.clear();
+    m_Transients.clear();
+    m_Heap = nullptr;
+    m_HeapSize = 0;
+    m_TotalSize = 0;
+}
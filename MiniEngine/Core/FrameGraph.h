@@ -0,0 +1,89 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Lifetimes of the buffers that only live for part of a frame.  The passes of the frame are declared once, in the
+// order that they run, along with the transient buffers each of them reads and writes.  Compile() works out where
+// every transient buffer's lifetime begins and ends, and places all of them in one heap so that buffers whose
+// lifetimes do not overlap share memory.  Passes may be skipped at run time, but never reordered.
+//
+
+#pragma once
+
+#include "pch.h"
+#include <vector>
+
+class ColorBuffer;
+class CommandContext;
+
+class FrameGraph
+{
+public:
+    typedef uint32_t PassHandle;
+
+    FrameGraph() : m_HeapSize(0), m_TotalSize(0) {}
+
+    // Passes are numbered in the order they are added
+    PassHandle AddPass( const std::wstring& Name );
+
+    // Declares a color buffer that holds nothing from one frame to the next.  It is created by Compile().
+    void AddTransient( ColorBuffer& Buffer, const std::wstring& Name, uint32_t Width, uint32_t Height,
+        uint32_t ArrayCount, DXGI_FORMAT Format );
+
+    // A transient buffer must be written by the first pass that uses it
+    void Reads( PassHandle Pass, ColorBuffer& Buffer );
+    void Writes( PassHandle Pass, ColorBuffer& Buffer );
+
+    // Assigns memory to the transient buffers and creates them
+    void Compile( void );
+
+    // Call before the pass records anything.  Hands the memory of the buffers whose lifetimes begin with the pass
+    // over to them, and discards whatever the buffers that used it before left there.
+    void BeginPass( CommandContext& Context, PassHandle Pass );
+
+    // Destroys the transient buffers and their heap, and forgets every pass
+    void Destroy( void );
+
+    // The memory used by the transient buffers, and what they would need without aliasing
+    uint64_t GetHeapSize( void ) const { return m_HeapSize; }
+    uint64_t GetTotalSize( void ) const { return m_TotalSize; }
+
+    ID3D12Heap* GetHeap( void ) const { return m_Heap.Get(); }
+
+private:
+
+    struct Transient
+    {
+        ColorBuffer* Buffer;
+        std::wstring Name;
+        uint32_t Width;
+        uint32_t Height;
+        uint32_t ArrayCount;
+        DXGI_FORMAT Format;
+        uint32_t FirstPass;
+        uint32_t LastPass;
+        bool WrittenFirst;
+        uint64_t Size;
+        uint64_t Alignment;
+        uint64_t HeapOffset;
+    };
+
+    struct Pass
+    {
+        std::wstring Name;
+        std::vector<ColorBuffer*> Activates;
+    };
+
+    Transient* FindTransient( ColorBuffer& Buffer );
+    void UseTransient( PassHandle Pass, ColorBuffer& Buffer, bool Write );
+
+    std::vector<Pass> m_Passes;
+    std::vector<Transient> m_Transients;
+    Microsoft::WRL::ComPtr<ID3D12Heap> m_Heap;
+    uint64_t m_HeapSize;
+    uint64_t m_TotalSize;
+};
@@ -0,0 +1,143 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "pch.h"
+#include "FramePacing.h"
+#include "GraphRenderer.h"
+#include "TextRenderer.h"
+#include "SystemTime.h"
+#include <algorithm>
+
+namespace FramePacing
+{
+    BoolVar DisplayPacing("Display Frame Pacing", false);
+
+    const uint32_t kHistorySize = 512;      // Frames the statistics are taken over, as many as the graph shows
+    const uint32_t kPendingSize = 16;       // Presents that may still be waiting to reach the screen
+
+    struct PendingPresent
+    {
+        UINT PresentId;
+        int64_t InputTick;
+    };
+
+    PendingPresent s_Pending[kPendingSize] = {};
+    UINT s_LastShownId = 0;
+    int64_t s_LastPresentTick = 0;
+
+    float s_IntervalMs[kHistorySize] = {};
+    float s_PhotonMs[kHistorySize] = {};
+    float s_WaitMs = 0.0f;
+    uint32_t s_NumFrames = 0;
+    float s_LastPhotonMs = 0.0f;
+
+    // Returns the input to photon time of the newest present that reached the screen since the last call, or 0
+    float CheckShownPresents( IDXGISwapChain1* SwapChain )
+    {
+        DXGI_FRAME_STATISTICS Stats;
+        if (FAILED(SwapChain->GetFrameStatistics(&Stats)) || Stats.PresentCount == s_LastShownId)
+            return 0.0f;
+
+        s_LastShownId = Stats.PresentCount;
+
+        const PendingPresent& Shown = s_Pending[Stats.PresentCount % kPendingSize];
+        if (Shown.PresentId != Stats.PresentCount || Stats.SyncQPCTime.QuadPart < Shown.InputTick)
+            return 0.0f;
+
+        return (float)SystemTime::TicksToMillisecs(Stats.SyncQPCTime.QuadPart - Shown.InputTick);
+    }
+}
+
+void FramePacing::RecordPresent( IDXGISwapChain1* SwapChain, int64_t InputTick, int64_t WaitTicks )
+{
+    ASSERT(SwapChain != nullptr);
+
+    const int64_t PresentTick = SystemTime::GetCurrentTick();
+
+    UINT PresentId;
+    if (SUCCEEDED(SwapChain->GetLastPresentCount(&PresentId)))
+    {
+        PendingPresent& NewPresent = s_Pending[PresentId % kPendingSize];
+        NewPresent.PresentId = PresentId;
+        NewPresent.InputTick = InputTick;
+    }
+
+    const float PhotonMs = CheckShownPresents(SwapChain);
+    if (PhotonMs > 0.0f)
+        s_LastPhotonMs = PhotonMs;
+
+    s_WaitMs = (float)SystemTime::TicksToMillisecs(WaitTicks);
+
+    if (s_LastPresentTick != 0)
+    {
+        const float IntervalMs = (float)SystemTime::TicksToMillisecs(PresentTick - s_LastPresentTick);
+        s_IntervalMs[s_NumFrames % kHistorySize] = IntervalMs;
+        s_PhotonMs[s_NumFrames % kHistorySize] = PhotonMs;
+        ++s_NumFrames;
+
+        GraphRenderer::Update(XMFLOAT2(IntervalMs, s_LastPhotonMs), 0, GraphRenderer::GraphType::Pacing);
+    }
+    s_LastPresentTick = PresentTick;
+}
+
+void FramePacing::Display( GraphicsContext& Context, float x, float y )
+{
+    if (!DisplayPacing)
+        return;
+
+    GraphRenderer::RenderGraphs(Context, GraphRenderer::GraphType::Pacing);
+
+    const uint32_t NumSamples = std::min(s_NumFrames, kHistorySize);
+    if (NumSamples == 0)
+        return;
+
+    float Sorted[kHistorySize];
+    std::copy(s_IntervalMs, s_IntervalMs + NumSamples, Sorted);
+    std::sort(Sorted, Sorted + NumSamples);
+
+    float Total = 0.0f;
+    for (uint32_t i = 0; i < NumSamples; ++i)
+        Total += Sorted[i];
+
+    const float Median = Sorted[NumSamples / 2];
+    const uint32_t NumHitches = (uint32_t)(Sorted + NumSamples - std::upper_bound(Sorted, Sorted + NumSamples, Median * 1.5f));
+
+    float PhotonTotal = 0.0f;
+    float PhotonMax = 0.0f;
+    uint32_t NumPhotons = 0;
+    for (uint32_t i = 0; i < NumSamples; ++i)
+    {
+        if (s_PhotonMs[i] > 0.0f)
+        {
+            PhotonTotal += s_PhotonMs[i];
+            PhotonMax = std::max(PhotonMax, s_PhotonMs[i]);
+            ++NumPhotons;
+        }
+    }
+
+    TextContext Text(Context);
+    Text.Begin();
+    Text.ResetCursor(x, y);
+    Text.SetTextSize(20.0f);
+
+    Text.SetColor(Color(0.3f, 1.0f, 0.3f));
+    Text.DrawFormattedString("Present interval  avg %5.2f  p50 %5.2f  p99 %5.2f  max %5.2f ms\n",
+        Total / NumSamples, Median, Sorted[(NumSamples * 99) / 100], Sorted[NumSamples - 1]);
+    Text.SetColor(Color(1.0f, 0.8f, 0.2f));
+    if (NumPhotons > 0)
+        Text.DrawFormattedString("Input to photon   avg %5.2f  max %5.2f ms\n", PhotonTotal / NumPhotons, PhotonMax);
+    else
+        Text.DrawString("Input to photon   unavailable without frame statistics\n");
+    Text.SetColor(NumHitches > 0 ? Color(1.0f, 0.3f, 0.3f) : Color(1.0f, 1.0f, 1.0f));
+    Text.DrawFormattedString("Hitches %u of %u frames, latency wait %5.2f ms\n", NumHitches, NumSamples, s_WaitMs);
+
+    Text.SetColor(Color(1.0f, 1.0f, 1.0f));
+    Text.SetTextSize(24.0f);
+    Text.End();
+}
@@ -0,0 +1,30 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Measures how evenly frames are presented and how long input takes to reach the screen.  The present to
+// present interval is timed on the CPU.  Input to photon runs from the tick GameInput sampled the devices at to
+// the vertical blank that DXGI frame statistics report the frame was shown at, so it is only known a few frames
+// later, and not at all in modes where the statistics are unavailable.  Hitches are intervals longer than one
+// and a half times the median of the last 512 frames, which is what users notice rather than the average.
+//
+
+#pragma once
+
+#include "pch.h"
+
+class GraphicsContext;
+
+namespace FramePacing
+{
+    // Records the present just made for a frame that sampled input at InputTick, after waiting WaitTicks for
+    // the swap chain to accept it
+    void RecordPresent( IDXGISwapChain1* SwapChain, int64_t InputTick, int64_t WaitTicks );
+
+    // Draws the pacing graph and statistics when "Display Frame Pacing" is on
+    void Display( GraphicsContext& Context, float x, float y );
+}
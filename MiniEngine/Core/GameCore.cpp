@@ -19,6 +19,19 @@
 #include "BufferManager.h"
 #include "CommandContext.h"
 #include "PostEffects.h"
+#include "JobSystem.h"
+#include "AssetIO.h"
+#include "PagingService.h"
+#include "TextureStreaming.h"
+#include "GeometryStreaming.h"
+#include "TextureManager.h"
+#include "GpuMemoryPool.h"
+#include "GpuMemoryTracker.h"
+#include "ShaderCompiler.h"
+#include "AsyncReadback.h"
+#include "MicroBenchmark.h"
+#include "StartupProfile.h"
+#include "FrameArena.h"
 
 #if WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_DESKTOP)
     #pragma comment(lib, "runtimeobject.lib")
@@ -43,33 +56,164 @@ namespace GameCore
     using namespace Graphics;
     const bool TestGenerateMips = false;
 
+    // Runs the Update() of applications that allow it alongside the rendering of the previous frame.  The
+    // update is at most one frame ahead of the rendering, which in turn is held to the maximum frame latency.
+    BoolVar s_PipelineUpdate("Timing/Pipelined Update", true);
+    JobSystem::Counter s_UpdateJob;
+    IGameApp* s_UpdatingApp = nullptr;
+
+    // Waits for the Update() running on a worker and publishes its state.  Also called before anything that
+    // a pipelined Update() may read changes outside the frame, such as the display size.
+    void FinishPipelinedUpdate( void )
+    {
+        if (s_UpdatingApp == nullptr)
+            return;
+
+        JobSystem::Wait(s_UpdateJob, L"Wait for Update");
+        s_UpdatingApp->LatchFrameState();
+        s_UpdatingApp = nullptr;
+    }
+
+    // Launch is timed to the first frame presented
+    double s_StartupSeconds = 0.0;
+    bool s_FirstFramePresented = false;
+
     void InitializeApplication( IGameApp& game )
     {
-        Graphics::Initialize();
         SystemTime::Initialize();
+        StartupProfile::Initialize();
+
+        // The job system comes first so that the pipelines made while initializing graphics compile in parallel
+        JobSystem::Initialize();
+        Graphics::Initialize();
+        AssetIO::Initialize();
+        PagingService::Initialize();
+        TextureStreaming::Initialize();
+        GeometryStreaming::Initialize();
         GameInput::Initialize();
         EngineTuning::Initialize();
 
+#if WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_DESKTOP)
+        // -ProfileCapture records the first seconds, loading included
+        if (wcsstr(GetCommandLineW(), L"-ProfileCapture") != nullptr)
+            EngineProfiling::StartCapture();
+#endif
+
+        // The graphics subsystems initialize alongside Startup(), which waits for them before it uses them
+        Graphics::InitializeSubsystemsAsync();
+        int64_t StartupTick = SystemTime::GetCurrentTick();
+        game.Startup();
+        Graphics::FinishInitialization();
+        const int64_t StartupEndTick = SystemTime::GetCurrentTick();
+        StartupProfile::Record(StartupProfile::kApplicationStartup, StartupTick, StartupEndTick);
+        s_StartupSeconds = SystemTime::TimeBetweenTicks(StartupTick, StartupEndTick);
+        game.LatchFrameState();
+
+        // Most pipelines are compiled by now, so save them in case the application never exits cleanly
+        PSO::SavePipelineCache();
+
+        // -microbench runs the CPU microbenchmarks here, and the application exits after its first frame
+        MicroBenchmark::Initialize();
+    }
+
+    // Everything made on a lost device is made again in place, which takes far less than a relaunch.  Pipelines
+    // load from the pipeline library on disk when the adapter is the same, and Startup() reads its assets again,
+    // mostly from the file cache and the mapped model.
+    void RecoverDevice( IGameApp& game )
+    {
+        const int64_t StartTick = SystemTime::GetCurrentTick();
+
+        FinishPipelinedUpdate();
+        game.Cleanup();
+        PSO::WaitForCompilation();
+        AssetIO::Shutdown();
+        TextureStreaming::Shutdown();
+        GeometryStreaming::Shutdown();
+        PagingService::Shutdown();
+        Graphics::Terminate();
+        Graphics::Shutdown();
+        const int64_t ShutdownTick = SystemTime::GetCurrentTick();
+
+        Graphics::Initialize();
+        AssetIO::Initialize();
+        PagingService::Initialize();
+        TextureStreaming::Initialize();
+        GeometryStreaming::Initialize();
+        const int64_t DeviceTick = SystemTime::GetCurrentTick();
+
+        Graphics::InitializeSubsystemsAsync();
         game.Startup();
+        Graphics::FinishInitialization();
+        game.LatchFrameState();
+        const int64_t EndTick = SystemTime::GetCurrentTick();
+
+        Utility::Printf("Device recovered in %.1f ms:  %.1f ms shutting down, %.1f ms initializing graphics, %.1f ms in Startup()\n",
+            SystemTime::TimeBetweenTicks(StartTick, EndTick) * 1000.0, SystemTime::TimeBetweenTicks(StartTick, ShutdownTick) * 1000.0,
+            SystemTime::TimeBetweenTicks(ShutdownTick, DeviceTick) * 1000.0, SystemTime::TimeBetweenTicks(DeviceTick, EndTick) * 1000.0);
     }
 
     void TerminateApplication( IGameApp& game )
     {
+        FinishPipelinedUpdate();
         game.Cleanup();
 
+        ShaderCompiler::Shutdown();
         GameInput::Shutdown();
+        AssetIO::Shutdown();
+        PSO::WaitForCompilation();
+        JobSystem::Shutdown();
+        TextureStreaming::Shutdown();
+        GeometryStreaming::Shutdown();
+        PagingService::Shutdown();
     }
 
     bool UpdateApplication( IGameApp& game )
     {
         EngineProfiling::Update();
+        PSO::ReportCacheStatistics();
+        RootSignature::ReportCacheStatistics();
+        LinearAllocator::TrimLargePages();
+        LinearAllocator::ReportStatistics();
+        DynamicDescriptorHeap::ReportStatistics();
+        DescriptorAllocator::ReportStatistics();
+        CommandContext::ReportStatistics();
+        CommandAllocatorPool::ReportStatistics();
+        GpuMemoryPool::ReportStatistics();
+        GpuMemoryTracker::ReportStatistics();
+        FrameArena::ReportStatistics();
+        JobSystem::ProcessMainThreadJobs();
+
+        // Textures loaded since the last frame get their mips before anything samples them
+        TextureManager::GenerateMissingMips();
 
         float DeltaTime = Graphics::GetFrameTime();
-    
+
+        Graphics::WaitForFrameLatency();
+
+        // The data read back by the frames the GPU has finished arrives before anything of this frame is recorded
+        AsyncReadback::Update();
+
+        // This frame renders the state of the Update() that ran alongside the last one
+        FinishPipelinedUpdate();
+
+        // Reloaded shaders finalize their PSOs again before anything records with them
+        ShaderCompiler::Update();
+
         GameInput::Update(DeltaTime);
         EngineTuning::Update(DeltaTime);
-        
-        game.Update(DeltaTime);
+
+        if (s_PipelineUpdate && JobSystem::GetWorkerCount() > 0 && game.CanPipelineUpdate())
+        {
+            s_UpdatingApp = &game;
+            IGameApp* App = &game;
+            JobSystem::Run([App, DeltaTime] { App->Update(DeltaTime); }, &s_UpdateJob);
+        }
+        else
+        {
+            game.Update(DeltaTime);
+            game.LatchFrameState();
+        }
+
         game.RenderScene();
 
         PostEffects::Render();
@@ -102,8 +246,21 @@ namespace GameCore
         UiContext.Finish();
 
         Graphics::Present();
+        FrameArena::EndFrame();
+
+        if (!s_FirstFramePresented)
+        {
+            s_FirstFramePresented = true;
+            Utility::Printf("First frame presented %.1f ms after launch, %.1f ms of it in Startup()\n",
+                SystemTime::TimeBetweenTicks(StartupProfile::GetLaunchTick(), SystemTime::GetCurrentTick()) * 1000.0,
+                s_StartupSeconds * 1000.0);
+            StartupProfile::FirstFramePresented();
+        }
+
+        if (Graphics::IsDeviceLost())
+            RecoverDevice(game);
 
-        return !game.IsDone();
+        return !game.IsDone() && !MicroBenchmark::IsFinished();
     }
 
     // Default implementation to be overridden by the application
@@ -232,6 +389,7 @@ namespace GameCore
 #if !WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_TV_TITLE)
     void MyApplicationView::OnWindowSizeChanged(CoreWindow^ sender, WindowSizeChangedEventArgs^ args)
     {
+        FinishPipelinedUpdate();
         Graphics::Resize((uint32_t)sender->Bounds.Width, (uint32_t)sender->Bounds.Height);
     }
 
@@ -368,6 +526,7 @@ namespace GameCore
         switch( message )
         {
             case WM_SIZE:
+                FinishPipelinedUpdate();
                 Graphics::Resize((UINT)(UINT64)lParam & 0xFFFF, (UINT)(UINT64)lParam >> 16);
                 break;
 
@@ -38,6 +38,39 @@ namespace GameCore
 
         // Optional UI (overlay) rendering pass.  This is LDR.  The buffer is already cleared.
         virtual void RenderUI( class GraphicsContext& ) {};
+
+        // Return true to let Update() for the next frame run on a worker while this frame renders.  Such an
+        // Update() must only write state that the rendering doesn't read, such as the Next() side of a
+        // FrameState, and must not use EngineProfiling or record GPU work.  The frame rendered then shows
+        // the state of the previous Update(), one frame later than without pipelining.
+        virtual bool CanPipelineUpdate( void ) { return false; }
+
+        // Publish the state written by the last Update() to the rendering.  Runs on the main thread after
+        // every Update() has finished, pipelined or not, and once after Startup().
+        virtual void LatchFrameState( void ) {}
+    };
+
+    // Double-buffered state for a pipelined Update().  Update() writes Next() while the frame that was
+    // latched last renders from Current().  Latch() publishes Next() and copies it forward, so that the next
+    // Update() continues from it.
+    template <typename T>
+    class FrameState
+    {
+    public:
+        FrameState() : m_NextIndex(0) {}
+
+        T& Next( void ) { return m_State[m_NextIndex]; }
+        const T& Current( void ) const { return m_State[m_NextIndex ^ 1]; }
+
+        void Latch( void )
+        {
+            m_NextIndex ^= 1;
+            m_State[m_NextIndex] = m_State[m_NextIndex ^ 1];
+        }
+
+    private:
+        T m_State[2];
+        uint32_t m_NextIndex;
     };
 
     void RunApplication( IGameApp& app, const wchar_t* className );
@@ -14,6 +14,7 @@
 #include "pch.h"
 #include "GameCore.h"
 #include "GameInput.h"
+#include "SystemTime.h"
 
 #if WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_DESKTOP)
 
@@ -53,6 +54,7 @@ namespace
     float s_HoldDuration[GameInput::kNumDigitalInputs] = { 0.0f };
     float s_Analogs[GameInput::kNumAnalogInputs];
     float s_AnalogsTC[GameInput::kNumAnalogInputs];
+    int64_t s_SampleTick = 0;
 
 #ifdef USE_KEYBOARD_MOUSE
 
@@ -434,6 +436,8 @@ void GameInput::Shutdown()
 
 void GameInput::Update( float frameDelta )
 {
+    s_SampleTick = SystemTime::GetCurrentTick();
+
     memcpy(s_Buttons[1], s_Buttons[0], sizeof(s_Buttons[0]));
     memset(s_Buttons[0], 0, sizeof(s_Buttons[0]));
     memset(s_Analogs, 0, sizeof(s_Analogs));
@@ -579,3 +583,8 @@ float GameInput::GetTimeCorrectedAnalogInput( AnalogInput ai )
 {
     return s_AnalogsTC[ai];
 }
+
+int64_t GameInput::GetSampleTick( void )
+{
+    return s_SampleTick;
+}
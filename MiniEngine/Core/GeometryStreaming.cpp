@@ -0,0 +1,754 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "pch.h"
+#include "GeometryStreaming.h"
+#include "GraphicsCore.h"
+#include "CommandListManager.h"
+#include "AssetIO.h"
+#include "GpuMemoryTracker.h"
+#include "PagingService.h"
+#include "StartupProfile.h"
+#include "FrameArena.h"
+#include <deque>
+#include <algorithm>
+
+using namespace Graphics;
+
+namespace GeometryStreaming
+{
+    BoolVar Enable("Graphics/Geometry Streaming/Enable", true);
+    IntVar BudgetMB("Graphics/Geometry Streaming/Budget (MB)", 256, 32, 8192, 32);
+    IntVar LoadsInFlight("Graphics/Geometry Streaming/Loads In Flight", 16, 1, 128);
+    IntVar EvictionDelay("Graphics/Geometry Streaming/Eviction Delay (frames)", 120, 1, 1000, 10);
+
+    // 64 MB heaps of 64 KB tiles.  Tiles are mapped one at a time, so the tiles of a part may come from any heap.
+    const uint32_t kTileSize = D3D12_TILED_RESOURCE_TILE_SIZE_IN_BYTES;
+    const uint32_t kTilesPerHeap = 1024;
+    const uint32_t kTilesPerMB = 1024 * 1024 / kTileSize;
+    const uint64_t kHeapBytes = (uint64_t)kTilesPerHeap * kTileSize;
+
+    enum TileState { kTileUnmapped, kTileLoading, kTileResident, kTileFailed };
+    enum PartState { kPartEvicted, kPartLoading, kPartResident, kPartFailed };
+    enum LoadState { kLoadReading, kLoadUploaded, kLoadFailed };
+
+    struct TileHeap
+    {
+        ID3D12Heap* Heap;
+        std::vector<UINT> FreeTiles;
+    };
+
+    // Covers tiles that were released with this fence.  They stay mapped until the GPU has passed it, unless a
+    // part takes them back first.
+    struct PendingUnmap
+    {
+        StreamedGeometry* Geometry;
+        uint32_t Stream;
+        uint32_t FirstTile;
+        uint32_t NumTiles;
+        uint64_t FenceValue;
+    };
+
+    bool s_Supported = false;
+
+    // Guards the geometry list and the tile pool, which the paging thread trims
+    std::mutex s_Mutex;
+    std::vector<std::unique_ptr<StreamedGeometry>> s_Geometries;
+    std::vector<TileHeap> s_TileHeaps;             // Heaps given back to the OS leave a null slot
+    uint32_t s_TilesInUse = 0;
+    uint32_t s_FreeTiles = 0;                      // In the heaps that exist
+    uint32_t s_ResidentTilesInUse = 0;
+
+    // Lowered below the tuning budget when the OS budget shrinks, and raised again a heap at a time once the
+    // memory fits
+    uint32_t s_TrimmedBudgetTiles = UINT32_MAX;
+    uint32_t s_PagingClient = 0;
+
+    // Only touched by Update()
+    std::deque<PendingUnmap> s_PendingUnmaps;
+    uint32_t s_TilesPendingUnmap = 0;
+    uint32_t s_NumLoadsInFlight = 0;
+    uint64_t s_FrameIndex = 0;
+
+    struct PartRef
+    {
+        StreamedGeometry* Geometry;
+        StreamedGeometry::Part* Part;
+    };
+
+    uint32_t GetBudgetTiles( void );
+    uint64_t TrimStreamedGeometry( uint64_t BytesToFree );
+    void ReleaseEmptyHeaps( void );
+    bool ReserveTiles( uint32_t NumTiles, bool IgnoreBudget );
+    void AllocateTile( StreamedGeometry::Tile& Tile );
+    void FreeTile( StreamedGeometry::Tile& Tile );
+    void MapTiles( StreamedGeometry& Geometry, uint32_t Stream, uint32_t FirstTile, uint32_t NumTiles );
+    void UnmapTiles( StreamedGeometry& Geometry, uint32_t Stream, uint32_t FirstTile, uint32_t NumTiles );
+
+    uint32_t CountUnmappedTiles( const StreamedGeometry& Geometry, const std::vector<StreamedGeometry::TileRange>& Ranges );
+    void HoldTiles( StreamedGeometry& Geometry, const std::vector<StreamedGeometry::TileRange>& Ranges, bool Upload );
+    void ReleaseTiles( StreamedGeometry& Geometry, const std::vector<StreamedGeometry::TileRange>& Ranges );
+    void QueueUnmaps( StreamedGeometry& Geometry, uint32_t Stream, uint32_t FirstTile, uint32_t NumTiles );
+    void ProcessPendingUnmaps( void );
+    uint32_t GetRangesState( const StreamedGeometry& Geometry, const std::vector<StreamedGeometry::TileRange>& Ranges );
+    void StartLoads( StreamedGeometry& Geometry, uint32_t Stream, uint32_t FirstTile, uint32_t NumTiles );
+    bool FinishLoads( StreamedGeometry& Geometry, FrameArena::FrameVector<StreamedGeometry::Load*>& AwaitingFence );
+}
+
+using namespace GeometryStreaming;
+
+void GeometryStreaming::Initialize( void )
+{
+    D3D12_FEATURE_DATA_D3D12_OPTIONS Options = {};
+    s_Supported = SUCCEEDED(g_Device->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS, &Options, sizeof(Options))) &&
+        Options.TiledResourcesTier >= D3D12_TILED_RESOURCES_TIER_1;
+
+    if (!s_Supported)
+        return;
+
+    // Streamed geometry can always be read again, and its coarse levels are never trimmed
+    s_PagingClient = PagingService::RegisterClient(PagingService::kPriorityLow, TrimStreamedGeometry);
+}
+
+void GeometryStreaming::Shutdown( void )
+{
+    if (s_PagingClient != 0)
+    {
+        PagingService::UnregisterClient(s_PagingClient);
+        s_PagingClient = 0;
+    }
+
+    g_CommandManager.IdleGPU();
+
+    s_PendingUnmaps.clear();
+    s_Geometries.clear();
+
+    for (auto& Heap : s_TileHeaps)
+    {
+        if (Heap.Heap != nullptr)
+            Heap.Heap->Release();
+    }
+    s_TileHeaps.clear();
+    s_TilesInUse = 0;
+    s_FreeTiles = 0;
+    s_ResidentTilesInUse = 0;
+    s_TrimmedBudgetTiles = UINT32_MAX;
+    s_TilesPendingUnmap = 0;
+    s_NumLoadsInFlight = 0;
+}
+
+bool GeometryStreaming::ShouldStream( uint64_t NumBytes )
+{
+    return s_Supported && Enable && NumBytes > (uint64_t)BudgetMB * 1024 * 1024;
+}
+
+StreamedGeometry* GeometryStreaming::Create( const std::wstring& FileName, uint32_t NumStreams, GpuBuffer* const Buffers[],
+    const uint64_t FileOffsets[], const void* const Data[], uint32_t NumParts )
+{
+    ASSERT(s_Supported);
+
+    StreamedGeometry* Geometry = new StreamedGeometry;
+    Geometry->m_FileName = FileName;
+    Geometry->m_NumResidentTiles = 0;
+    Geometry->m_Streams.resize(NumStreams);
+    for (uint32_t StreamIdx = 0; StreamIdx < NumStreams; ++StreamIdx)
+    {
+        StreamedGeometry::Stream& Stream = Geometry->m_Streams[StreamIdx];
+        Stream.Buffer = Buffers[StreamIdx];
+        Stream.FileOffset = FileOffsets[StreamIdx];
+        Stream.Data = Data[StreamIdx];
+
+        const StreamedGeometry::Tile Unmapped = { 0, kTileUnmapped, 0, 0, 0, 0 };
+        Stream.Tiles.assign((Stream.Buffer->GetBufferSize() + kTileSize - 1) / kTileSize, Unmapped);
+    }
+
+    Geometry->m_Parts.resize(NumParts);
+    for (auto& Part : Geometry->m_Parts)
+    {
+        Part.State = kPartEvicted;
+        Part.RequestedPriority = -1.0f;
+        Part.WantedPriority = 0.0f;
+        Part.WantedFrame = 0;
+    }
+
+    std::lock_guard<std::mutex> LockGuard(s_Mutex);
+    s_Geometries.emplace_back(Geometry);
+    return Geometry;
+}
+
+// Ranges are kept in tiles, and a range that starts within or right after the last one of its stream extends it
+void GeometryStreaming::AddRange( StreamedGeometry* Geometry, uint32_t Part, uint32_t Stream, uint64_t Offset, uint64_t Size )
+{
+    if (Size == 0)
+        return;
+
+    ASSERT(Offset + Size <= Geometry->m_Streams[Stream].Buffer->GetBufferSize());
+    const uint32_t FirstTile = (uint32_t)(Offset / kTileSize);
+    const uint32_t EndTile = (uint32_t)((Offset + Size - 1) / kTileSize) + 1;
+
+    std::vector<StreamedGeometry::TileRange>& Ranges = Part == StreamedGeometry::kResidentPart ?
+        Geometry->m_ResidentRanges : Geometry->m_Parts[Part].Ranges;
+
+    if (!Ranges.empty())
+    {
+        StreamedGeometry::TileRange& Last = Ranges.back();
+        if (Last.Stream == Stream && FirstTile >= Last.FirstTile && FirstTile <= Last.FirstTile + Last.NumTiles)
+        {
+            Last.NumTiles = std::max(Last.NumTiles, EndTile - Last.FirstTile);
+            return;
+        }
+    }
+
+    StreamedGeometry::TileRange Range = { Stream, FirstTile, EndTile - FirstTile };
+    Ranges.push_back(Range);
+}
+
+void GeometryStreaming::FinishCreate( StreamedGeometry* Geometry )
+{
+    std::lock_guard<std::mutex> LockGuard(s_Mutex);
+
+    // The ranges that are always resident ignore the budget, like the packed mips of streamed textures
+    ReserveTiles(CountUnmappedTiles(*Geometry, Geometry->m_ResidentRanges), true);
+    HoldTiles(*Geometry, Geometry->m_ResidentRanges, true);
+
+    for (auto& Stream : Geometry->m_Streams)
+    {
+        for (const auto& Tile : Stream.Tiles)
+            Geometry->m_NumResidentTiles += Tile.RefCount > 0 ? 1 : 0;
+        Stream.Data = nullptr;
+    }
+    s_ResidentTilesInUse += Geometry->m_NumResidentTiles;
+}
+
+void GeometryStreaming::Destroy( StreamedGeometry* Geometry )
+{
+    if (Geometry == nullptr)
+        return;
+
+    // The callbacks of the reads in flight upload into the geometry's buffers
+    JobSystem::Wait(Geometry->m_Reads);
+    g_CommandManager.IdleGPU();
+
+    std::lock_guard<std::mutex> LockGuard(s_Mutex);
+
+    s_PendingUnmaps.erase(std::remove_if(s_PendingUnmaps.begin(), s_PendingUnmaps.end(),
+        [Geometry](const PendingUnmap& Unmap) { return Unmap.Geometry == Geometry; }), s_PendingUnmaps.end());
+
+    for (auto& Stream : Geometry->m_Streams)
+    {
+        for (auto& Tile : Stream.Tiles)
+        {
+            if (Tile.State == kTileUnmapped)
+                continue;
+            if (Tile.Queued)
+                --s_TilesPendingUnmap;
+            FreeTile(Tile);
+        }
+    }
+
+    for (const auto& Part : Geometry->m_Parts)
+    {
+        if (Part.State == kPartLoading)
+            --s_NumLoadsInFlight;
+    }
+    s_ResidentTilesInUse -= Geometry->m_NumResidentTiles;
+
+    s_Geometries.erase(std::find_if(s_Geometries.begin(), s_Geometries.end(),
+        [Geometry](const std::unique_ptr<StreamedGeometry>& Entry) { return Entry.get() == Geometry; }));
+}
+
+void GeometryStreaming::RequestPart( StreamedGeometry* Geometry, uint32_t Part, float Priority )
+{
+    ASSERT(Priority >= 0.0f);
+    StreamedGeometry::Part& Entry = Geometry->m_Parts[Part];
+    Entry.RequestedPriority = std::max(Entry.RequestedPriority, Priority);
+}
+
+bool GeometryStreaming::IsPartResident( const StreamedGeometry* Geometry, uint32_t Part )
+{
+    return Geometry->m_Parts[Part].State == kPartResident;
+}
+
+uint32_t GeometryStreaming::GetBudgetTiles( void )
+{
+    return std::min((uint32_t)BudgetMB * kTilesPerMB, s_TrimmedBudgetTiles);
+}
+
+// Lowers the budget by the tiles asked for, down to the ranges that are always resident, and leaves the evicting
+// to the next Update().  Tiles only go back to the OS with the heaps they empty.
+uint64_t GeometryStreaming::TrimStreamedGeometry( uint64_t BytesToFree )
+{
+    std::lock_guard<std::mutex> LockGuard(s_Mutex);
+
+    const uint32_t TilesHeld = s_TilesInUse - s_TilesPendingUnmap;
+    const uint32_t Evictable = TilesHeld - std::min(s_ResidentTilesInUse, TilesHeld);
+    const uint64_t TilesToFree = (BytesToFree + kTileSize - 1) / kTileSize;
+    const uint32_t Trimmed = (uint32_t)std::min<uint64_t>(TilesToFree, Evictable);
+
+    s_TrimmedBudgetTiles = std::min(s_TrimmedBudgetTiles, TilesHeld - Trimmed);
+    return (uint64_t)Trimmed * kTileSize;
+}
+
+void GeometryStreaming::ReleaseEmptyHeaps( void )
+{
+    for (auto& Heap : s_TileHeaps)
+    {
+        if (Heap.Heap != nullptr && Heap.FreeTiles.size() == kTilesPerHeap)
+        {
+            Heap.Heap->Release();
+            Heap.Heap = nullptr;
+            Heap.FreeTiles.clear();
+            s_FreeTiles -= kTilesPerHeap;
+        }
+    }
+}
+
+// Adds heaps until this many tiles are free
+bool GeometryStreaming::ReserveTiles( uint32_t NumTiles, bool IgnoreBudget )
+{
+    if (!IgnoreBudget && s_TilesInUse + NumTiles > GetBudgetTiles())
+        return false;
+
+    while (s_FreeTiles < NumTiles)
+    {
+        if (!IgnoreBudget && !PagingService::FitsInBudget(kHeapBytes, PagingService::kPriorityLow))
+            return false;
+
+        D3D12_HEAP_DESC HeapDesc = {};
+        HeapDesc.SizeInBytes = kHeapBytes;
+        HeapDesc.Properties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
+        HeapDesc.Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
+
+        TileHeap NewHeap;
+        ASSERT_SUCCEEDED(g_Device->CreateHeap(&HeapDesc, MY_IID_PPV_ARGS(&NewHeap.Heap)));
+        NewHeap.Heap->SetName(L"Geometry Streaming Tiles");
+        GpuMemoryTracker::TrackHeap(NewHeap.Heap, GpuMemoryTracker::kModelGeometry);
+
+        // Hand out the low tiles first
+        for (UINT Tile = kTilesPerHeap; Tile > 0; --Tile)
+            NewHeap.FreeTiles.push_back(Tile - 1);
+
+        // Fill the slot of a heap that was given back before growing the list, as tiles refer to heaps by index
+        size_t HeapIdx = 0;
+        while (HeapIdx < s_TileHeaps.size() && s_TileHeaps[HeapIdx].Heap != nullptr)
+            ++HeapIdx;
+        if (HeapIdx == s_TileHeaps.size())
+            s_TileHeaps.push_back(std::move(NewHeap));
+        else
+            s_TileHeaps[HeapIdx] = std::move(NewHeap);
+
+        s_FreeTiles += kTilesPerHeap;
+    }
+    return true;
+}
+
+// Takes a tile from the first heap with any free, so that later heaps empty out and can be given back
+void GeometryStreaming::AllocateTile( StreamedGeometry::Tile& Tile )
+{
+    uint32_t HeapIdx = 0;
+    while (s_TileHeaps[HeapIdx].FreeTiles.empty())
+        ++HeapIdx;
+
+    std::vector<UINT>& FreeList = s_TileHeaps[HeapIdx].FreeTiles;
+    Tile.Heap = (uint16_t)HeapIdx;
+    Tile.HeapTile = FreeList.back();
+    FreeList.pop_back();
+    --s_FreeTiles;
+    ++s_TilesInUse;
+}
+
+void GeometryStreaming::FreeTile( StreamedGeometry::Tile& Tile )
+{
+    s_TileHeaps[Tile.Heap].FreeTiles.push_back(Tile.HeapTile);
+    ++s_FreeTiles;
+    --s_TilesInUse;
+    Tile.State = kTileUnmapped;
+    Tile.Queued = 0;
+}
+
+// Tile mappings are changed on the copy queue, which orders them before the uploads that follow.  Each call maps
+// a run of tiles from one heap.
+void GeometryStreaming::MapTiles( StreamedGeometry& Geometry, uint32_t Stream, uint32_t FirstTile, uint32_t NumTiles )
+{
+    StartupProfile::ScopedSpan Span(StartupProfile::kResidency);
+    const std::vector<StreamedGeometry::Tile>& Tiles = Geometry.m_Streams[Stream].Tiles;
+    ID3D12Resource* Resource = Geometry.m_Streams[Stream].Buffer->GetResource();
+
+    const uint32_t EndTile = FirstTile + NumTiles;
+    for (uint32_t RunStart = FirstTile; RunStart < EndTile; )
+    {
+        const uint16_t Heap = Tiles[RunStart].Heap;
+        uint32_t RunEnd = RunStart + 1;
+        while (RunEnd < EndTile && Tiles[RunEnd].Heap == Heap)
+            ++RunEnd;
+
+        const UINT NumRanges = RunEnd - RunStart;
+        UINT* HeapTiles = FrameArena::AllocateArray<UINT>(NumRanges);
+        UINT* RangeTileCounts = FrameArena::AllocateArray<UINT>(NumRanges);
+        for (UINT i = 0; i < NumRanges; ++i)
+        {
+            HeapTiles[i] = Tiles[RunStart + i].HeapTile;
+            RangeTileCounts[i] = 1;
+        }
+
+        D3D12_TILED_RESOURCE_COORDINATE Coord = { RunStart, 0, 0, 0 };
+        D3D12_TILE_REGION_SIZE RegionSize = {};
+        RegionSize.NumTiles = NumRanges;
+        g_CommandManager.GetCopyQueue().GetCommandQueue()->UpdateTileMappings(Resource, 1, &Coord, &RegionSize,
+            s_TileHeaps[Heap].Heap, NumRanges, nullptr, HeapTiles, RangeTileCounts, D3D12_TILE_MAPPING_FLAG_NONE);
+
+        RunStart = RunEnd;
+    }
+}
+
+void GeometryStreaming::UnmapTiles( StreamedGeometry& Geometry, uint32_t Stream, uint32_t FirstTile, uint32_t NumTiles )
+{
+    D3D12_TILED_RESOURCE_COORDINATE Coord = { FirstTile, 0, 0, 0 };
+    D3D12_TILE_REGION_SIZE RegionSize = {};
+    RegionSize.NumTiles = NumTiles;
+
+    const D3D12_TILE_RANGE_FLAGS RangeFlags = D3D12_TILE_RANGE_FLAG_NULL;
+    g_CommandManager.GetCopyQueue().GetCommandQueue()->UpdateTileMappings(Geometry.m_Streams[Stream].Buffer->GetResource(),
+        1, &Coord, &RegionSize, nullptr, 1, &RangeFlags, nullptr, &NumTiles, D3D12_TILE_MAPPING_FLAG_NONE);
+}
+
+// Ranges that overlap count their tiles twice, which only makes the reservation larger than needed
+uint32_t GeometryStreaming::CountUnmappedTiles( const StreamedGeometry& Geometry,
+    const std::vector<StreamedGeometry::TileRange>& Ranges )
+{
+    uint32_t NumTiles = 0;
+    for (const auto& Range : Ranges)
+    {
+        const std::vector<StreamedGeometry::Tile>& Tiles = Geometry.m_Streams[Range.Stream].Tiles;
+        for (uint32_t TileIdx = Range.FirstTile; TileIdx < Range.FirstTile + Range.NumTiles; ++TileIdx)
+            NumTiles += Tiles[TileIdx].State == kTileUnmapped ? 1 : 0;
+    }
+    return NumTiles;
+}
+
+// Takes a reference on every tile of the ranges.  Tiles that were not mapped are mapped from the reserved tiles,
+// then uploaded from the contents in memory or read from the file.
+void GeometryStreaming::HoldTiles( StreamedGeometry& Geometry, const std::vector<StreamedGeometry::TileRange>& Ranges, bool Upload )
+{
+    for (const auto& Range : Ranges)
+    {
+        StreamedGeometry::Stream& Stream = Geometry.m_Streams[Range.Stream];
+        const uint32_t EndTile = Range.FirstTile + Range.NumTiles;
+
+        for (uint32_t TileIdx = Range.FirstTile; TileIdx < EndTile; )
+        {
+            StreamedGeometry::Tile& Tile = Stream.Tiles[TileIdx];
+            if (Tile.RefCount++ == 0 && Tile.Queued)
+            {
+                Tile.Queued = 0;
+                --s_TilesPendingUnmap;
+            }
+
+            if (Tile.State != kTileUnmapped)
+            {
+                ++TileIdx;
+                continue;
+            }
+
+            uint32_t RunEnd = TileIdx;
+            while (RunEnd < EndTile && Stream.Tiles[RunEnd].State == kTileUnmapped)
+            {
+                if (RunEnd > TileIdx)
+                    ++Stream.Tiles[RunEnd].RefCount;
+                AllocateTile(Stream.Tiles[RunEnd]);
+                Stream.Tiles[RunEnd].State = Upload ? kTileResident : kTileLoading;
+                ++RunEnd;
+            }
+
+            MapTiles(Geometry, Range.Stream, TileIdx, RunEnd - TileIdx);
+            if (Upload)
+            {
+                const size_t Offset = (size_t)TileIdx * kTileSize;
+                const size_t Size = std::min((size_t)(RunEnd - TileIdx) * kTileSize, Stream.Buffer->GetBufferSize() - Offset);
+                AssetIO::UploadBuffer(*Stream.Buffer, Offset, (const uint8_t*)Stream.Data + Offset, Size);
+            }
+            else
+                StartLoads(Geometry, Range.Stream, TileIdx, RunEnd - TileIdx);
+
+            TileIdx = RunEnd;
+        }
+    }
+}
+
+void GeometryStreaming::ReleaseTiles( StreamedGeometry& Geometry, const std::vector<StreamedGeometry::TileRange>& Ranges )
+{
+    for (const auto& Range : Ranges)
+    {
+        std::vector<StreamedGeometry::Tile>& Tiles = Geometry.m_Streams[Range.Stream].Tiles;
+        for (uint32_t TileIdx = Range.FirstTile; TileIdx < Range.FirstTile + Range.NumTiles; ++TileIdx)
+        {
+            ASSERT(Tiles[TileIdx].RefCount > 0);
+            --Tiles[TileIdx].RefCount;
+        }
+        QueueUnmaps(Geometry, Range.Stream, Range.FirstTile, Range.NumTiles);
+    }
+}
+
+// Queues the tiles of the range that no part holds.  Everything submitted so far may still read them.  Tiles
+// that are still being read are queued once their loads finish.
+void GeometryStreaming::QueueUnmaps( StreamedGeometry& Geometry, uint32_t Stream, uint32_t FirstTile, uint32_t NumTiles )
+{
+    const uint64_t FenceValue = g_CommandManager.GetGraphicsQueue().GetNextFenceValue() - 1;
+    std::vector<StreamedGeometry::Tile>& Tiles = Geometry.m_Streams[Stream].Tiles;
+
+    uint32_t NumQueued = 0;
+    for (uint32_t TileIdx = FirstTile; TileIdx < FirstTile + NumTiles; ++TileIdx)
+    {
+        StreamedGeometry::Tile& Tile = Tiles[TileIdx];
+        if (Tile.RefCount > 0 || Tile.Queued || (Tile.State != kTileResident && Tile.State != kTileFailed))
+            continue;
+
+        Tile.Queued = 1;
+        Tile.ReleaseFence = FenceValue;
+        ++NumQueued;
+    }
+
+    if (NumQueued > 0)
+    {
+        PendingUnmap Unmap = { &Geometry, Stream, FirstTile, NumTiles, FenceValue };
+        s_PendingUnmaps.push_back(Unmap);
+        s_TilesPendingUnmap += NumQueued;
+    }
+}
+
+// A tile is unmapped by the last release that queued it, unless a part took it back since
+void GeometryStreaming::ProcessPendingUnmaps( void )
+{
+    while (!s_PendingUnmaps.empty() && g_CommandManager.IsFenceComplete(s_PendingUnmaps.front().FenceValue))
+    {
+        const PendingUnmap Unmap = s_PendingUnmaps.front();
+        s_PendingUnmaps.pop_front();
+
+        std::vector<StreamedGeometry::Tile>& Tiles = Unmap.Geometry->m_Streams[Unmap.Stream].Tiles;
+        const uint32_t EndTile = Unmap.FirstTile + Unmap.NumTiles;
+        for (uint32_t TileIdx = Unmap.FirstTile; TileIdx < EndTile; )
+        {
+            uint32_t RunEnd = TileIdx;
+            while (RunEnd < EndTile && Tiles[RunEnd].Queued && Tiles[RunEnd].ReleaseFence == Unmap.FenceValue)
+            {
+                FreeTile(Tiles[RunEnd]);
+                --s_TilesPendingUnmap;
+                ++RunEnd;
+            }
+
+            if (RunEnd > TileIdx)
+                UnmapTiles(*Unmap.Geometry, Unmap.Stream, TileIdx, RunEnd - TileIdx);
+            TileIdx = RunEnd + 1;
+        }
+    }
+}
+
+uint32_t GeometryStreaming::GetRangesState( const StreamedGeometry& Geometry, const std::vector<StreamedGeometry::TileRange>& Ranges )
+{
+    uint32_t State = kPartResident;
+    for (const auto& Range : Ranges)
+    {
+        const std::vector<StreamedGeometry::Tile>& Tiles = Geometry.m_Streams[Range.Stream].Tiles;
+        for (uint32_t TileIdx = Range.FirstTile; TileIdx < Range.FirstTile + Range.NumTiles; ++TileIdx)
+        {
+            if (Tiles[TileIdx].State == kTileFailed)
+                return kPartFailed;
+            if (Tiles[TileIdx].State == kTileLoading)
+                State = kPartLoading;
+        }
+    }
+    return State;
+}
+
+// Each read is uploaded in one copy, so a run is split into reads that each fit the staging ring
+void GeometryStreaming::StartLoads( StreamedGeometry& Geometry, uint32_t Stream, uint32_t FirstTile, uint32_t NumTiles )
+{
+    const uint32_t MaxTilesPerLoad = std::max<uint32_t>((uint32_t)(AssetIO::GetMaxStagedUpload() / kTileSize), 1);
+    GpuBuffer* Buffer = Geometry.m_Streams[Stream].Buffer;
+
+    for (uint32_t LoadStart = FirstTile; LoadStart < FirstTile + NumTiles; LoadStart += MaxTilesPerLoad)
+    {
+        StreamedGeometry::Load* Load = new StreamedGeometry::Load;
+        Load->Stream = Stream;
+        Load->FirstTile = LoadStart;
+        Load->NumTiles = std::min(MaxTilesPerLoad, FirstTile + NumTiles - LoadStart);
+        Load->State = kLoadReading;
+        Load->Fence = 0;
+        Geometry.m_Loads.emplace_back(Load);
+
+        const size_t Offset = (size_t)LoadStart * kTileSize;
+        const size_t ReadSize = std::min((size_t)Load->NumTiles * kTileSize, Buffer->GetBufferSize() - Offset);
+        AssetIO::ReadFileRange(Geometry.m_FileName, Geometry.m_Streams[Stream].FileOffset + Offset, ReadSize,
+            AssetIO::kPriorityLow, [Load, Buffer, Offset, ReadSize](const void* Data, size_t Size)
+        {
+            if (Size != ReadSize)
+            {
+                Load->State = kLoadFailed;
+                return;
+            }
+
+            AssetIO::UploadBuffer(*Buffer, Offset, Data, Size);
+            Load->State = kLoadUploaded;
+        }, &Geometry.m_Reads);
+    }
+}
+
+// Makes the tiles of loads whose uploads have finished resident, and returns whether any load failed
+bool GeometryStreaming::FinishLoads( StreamedGeometry& Geometry, FrameArena::FrameVector<StreamedGeometry::Load*>& AwaitingFence )
+{
+    bool AnyFailed = false;
+    for (auto& Load : Geometry.m_Loads)
+    {
+        const uint32_t State = Load->State;
+        if (State == kLoadReading)
+            continue;
+
+        if (State == kLoadUploaded)
+        {
+            if (Load->Fence == 0)
+            {
+                AwaitingFence.push_back(Load.get());
+                continue;
+            }
+            if (!g_CommandManager.IsFenceComplete(Load->Fence))
+                continue;
+        }
+        else
+            AnyFailed = true;
+
+        std::vector<StreamedGeometry::Tile>& Tiles = Geometry.m_Streams[Load->Stream].Tiles;
+        for (uint32_t TileIdx = Load->FirstTile; TileIdx < Load->FirstTile + Load->NumTiles; ++TileIdx)
+            Tiles[TileIdx].State = State == kLoadFailed ? kTileFailed : kTileResident;
+
+        // Parts that failed may have let go of tiles while they were read
+        QueueUnmaps(Geometry, Load->Stream, Load->FirstTile, Load->NumTiles);
+        Load.reset();
+    }
+
+    Geometry.m_Loads.erase(std::remove(Geometry.m_Loads.begin(), Geometry.m_Loads.end(), nullptr), Geometry.m_Loads.end());
+    return AnyFailed;
+}
+
+void GeometryStreaming::Update( void )
+{
+    if (!s_Supported)
+        return;
+
+    std::lock_guard<std::mutex> LockGuard(s_Mutex);
+    ++s_FrameIndex;
+
+    ProcessPendingUnmaps();
+
+    // While trimmed, memory goes back to the OS as heaps empty out, and the budget grows again once it fits
+    if (s_TrimmedBudgetTiles != UINT32_MAX)
+    {
+        ReleaseEmptyHeaps();
+
+        if (PagingService::FitsInBudget(kHeapBytes, PagingService::kPriorityLow))
+        {
+            s_TrimmedBudgetTiles += kTilesPerHeap;
+            if (s_TrimmedBudgetTiles >= (uint32_t)BudgetMB * kTilesPerMB)
+                s_TrimmedBudgetTiles = UINT32_MAX;
+        }
+    }
+
+    FrameArena::FrameVector<StreamedGeometry::Load*> AwaitingFence;
+    FrameArena::FrameVector<PartRef> Wanting;
+    FrameArena::FrameVector<PartRef> Evictable;
+
+    for (auto& Entry : s_Geometries)
+    {
+        StreamedGeometry& Geometry = *Entry;
+        if (FinishLoads(Geometry, AwaitingFence))
+            Utility::Printf(L"Failed to stream geometry of %ws\n", Geometry.m_FileName.c_str());
+
+        for (auto& Part : Geometry.m_Parts)
+        {
+            if (Part.RequestedPriority >= 0.0f)
+            {
+                Part.WantedPriority = Part.RequestedPriority;
+                Part.WantedFrame = s_FrameIndex;
+                Part.RequestedPriority = -1.0f;
+            }
+
+            if (Part.State == kPartLoading)
+            {
+                Part.State = GetRangesState(Geometry, Part.Ranges);
+                if (Part.State != kPartLoading)
+                    --s_NumLoadsInFlight;
+
+                // Nothing has read a part that failed, and it is not asked for again
+                if (Part.State == kPartFailed)
+                    ReleaseTiles(Geometry, Part.Ranges);
+            }
+
+            PartRef Ref = { &Geometry, &Part };
+            if (Part.State == kPartEvicted && Part.WantedFrame == s_FrameIndex)
+                Wanting.push_back(Ref);
+            else if (Part.State == kPartResident && s_FrameIndex - Part.WantedFrame > (uint64_t)EvictionDelay)
+                Evictable.push_back(Ref);
+        }
+    }
+
+    // One submission covers every upload that has been recorded
+    if (!AwaitingFence.empty())
+    {
+        const uint64_t FenceValue = AssetIO::Submit();
+        for (auto Load : AwaitingFence)
+            Load->Fence = FenceValue;
+    }
+
+    std::sort(Wanting.begin(), Wanting.end(), [](const PartRef& A, const PartRef& B)
+    {
+        return A.Part->WantedPriority > B.Part->WantedPriority;
+    });
+
+    uint32_t TilesNeeded = 0;
+    for (const auto& Ref : Wanting)
+    {
+        if (s_NumLoadsInFlight >= (uint32_t)LoadsInFlight)
+            break;
+
+        const uint32_t NumTiles = CountUnmappedTiles(*Ref.Geometry, Ref.Part->Ranges);
+        if (!ReserveTiles(NumTiles, false))
+        {
+            TilesNeeded = NumTiles;
+            break;
+        }
+
+        // A part whose tiles other parts already hold is resident right away
+        HoldTiles(*Ref.Geometry, Ref.Part->Ranges, false);
+        Ref.Part->State = GetRangesState(*Ref.Geometry, Ref.Part->Ranges);
+        if (Ref.Part->State == kPartLoading)
+            ++s_NumLoadsInFlight;
+    }
+
+    // Make room for the part that did not fit, or get back under a budget that was lowered, starting with the
+    // parts that have gone the longest without being asked for
+    std::sort(Evictable.begin(), Evictable.end(), [](const PartRef& A, const PartRef& B)
+    {
+        return A.Part->WantedFrame < B.Part->WantedFrame;
+    });
+
+    const uint32_t BudgetTiles = GetBudgetTiles();
+    for (const auto& Ref : Evictable)
+    {
+        if (s_TilesInUse - s_TilesPendingUnmap + TilesNeeded <= BudgetTiles)
+            break;
+
+        Ref.Part->State = kPartEvicted;
+        ReleaseTiles(*Ref.Geometry, Ref.Part->Ranges);
+    }
+}
+
+uint64_t GeometryStreaming::GetResidentBytes( void )
+{
+    std::lock_guard<std::mutex> LockGuard(s_Mutex);
+    return (uint64_t)s_TilesInUse * kTileSize;
+}
@@ -0,0 +1,127 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#pragma once
+
+#include "pch.h"
+#include "GpuBuffer.h"
+#include "EngineTuning.h"
+#include "JobSystem.h"
+#include <atomic>
+#include <memory>
+
+// Streams the geometry buffers of a model file into reserved buffers.  Each buffer holds one stream of the file,
+// and its 64 KB tiles are mapped from a shared pool.  Ranges that must always be there are uploaded when the
+// geometry is created.  The rest is split into parts, such as the finer levels of detail of one mesh, that the
+// renderer asks for with a priority.  The streamer reads the tiles of the most wanted parts through the asset
+// I/O queue, and a part is resident once all of its tiles are.  A tile shared by several parts stays mapped
+// while any of them holds it.  When the pool reaches its budget, parts that have gone without being asked for
+// the longest are evicted.  The budget shrinks when the paging service asks the pool to trim, like the texture
+// streamer's.  Geometry that cannot be streamed is loaded whole by its owner.
+class StreamedGeometry
+{
+public:
+    enum { kResidentPart = 0xFFFFFFFF };
+
+    // The rest is used by the streamer
+    struct Tile
+    {
+        uint32_t RefCount;                  // Parts holding the tile, and one for ranges that are always resident
+        uint8_t State;
+        uint8_t Queued;                     // Waiting to be unmapped, which a part taking it back cancels
+        uint16_t Heap;
+        UINT HeapTile;
+        uint64_t ReleaseFence;              // Graphics fence of the last work that could read it
+    };
+
+    struct Stream
+    {
+        GpuBuffer* Buffer;
+        uint64_t FileOffset;                // Where the buffer's contents start in the file
+        const void* Data;                   // The contents in memory, only while the geometry is created
+        std::vector<Tile> Tiles;
+    };
+
+    struct TileRange
+    {
+        uint32_t Stream;
+        uint32_t FirstTile;
+        uint32_t NumTiles;
+    };
+
+    struct Part
+    {
+        std::vector<TileRange> Ranges;
+        uint32_t State;
+        float RequestedPriority;            // Highest priority asked for this frame, or negative when not asked
+        float WantedPriority;
+        uint64_t WantedFrame;               // When the part was last asked for
+    };
+
+    // A read of consecutive tiles of one stream
+    struct Load
+    {
+        uint32_t Stream;
+        uint32_t FirstTile;
+        uint32_t NumTiles;
+        std::atomic<uint32_t> State;
+        uint64_t Fence;                     // Copy queue fence of the upload
+    };
+
+    std::wstring m_FileName;
+    std::vector<Stream> m_Streams;
+    std::vector<TileRange> m_ResidentRanges;
+    std::vector<Part> m_Parts;
+    std::vector<std::unique_ptr<Load>> m_Loads;
+    uint32_t m_NumResidentTiles;            // Held by the ranges that are always resident
+    JobSystem::Counter m_Reads;             // Counts the reads whose callbacks have yet to return
+};
+
+namespace GeometryStreaming
+{
+    extern BoolVar Enable;
+
+    // Streaming needs tiled resources
+    void Initialize( void );
+    void Shutdown( void );
+
+    // Whether geometry of this many bytes should be streamed.  Geometry that fits in the budget gains nothing
+    // from streaming and is loaded whole.
+    bool ShouldStream( uint64_t NumBytes );
+
+    // Starts the geometry of a file, given buffers made with GpuBuffer::CreateReserved() and where each buffer's
+    // contents are in the file and in memory.  Ranges are then added to parts, or to kResidentPart, in bytes
+    // of a stream.
+    StreamedGeometry* Create( const std::wstring& FileName, uint32_t NumStreams, GpuBuffer* const Buffers[],
+        const uint64_t FileOffsets[], const void* const Data[], uint32_t NumParts );
+    void AddRange( StreamedGeometry* Geometry, uint32_t Part, uint32_t Stream, uint64_t Offset, uint64_t Size );
+
+    // Uploads the ranges that are always resident, after which the contents in memory are no longer read.
+    // Nothing may read the buffers before AssetIO::Flush().
+    void FinishCreate( StreamedGeometry* Geometry );
+
+    // Waits for the geometry's reads and the GPU, and gives its tiles back to the pool.  The buffers may be
+    // destroyed afterwards.
+    void Destroy( StreamedGeometry* Geometry );
+
+    // Asks for a part to be made resident, where higher priorities load first.  The requests of a frame are
+    // acted upon by the next Update().
+    void RequestPart( StreamedGeometry* Geometry, uint32_t Part, float Priority );
+
+    // Whether every tile of the part is resident.  A part only stops being resident in Update(), and the
+    // work submitted before then may still read it.
+    bool IsPartResident( const StreamedGeometry* Geometry, uint32_t Part );
+
+    // Makes parts whose uploads have finished resident, starts reading the most wanted missing parts, and
+    // evicts parts when over budget.  Call once a frame from the main thread before any rendering is recorded.
+    void Update( void );
+
+    // Bytes of tiles holding streamed geometry
+    uint64_t GetResidentBytes( void );
+}
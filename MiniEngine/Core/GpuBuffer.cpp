@@ -17,6 +17,8 @@
 #include "EsramAllocator.h"
 #include "CommandContext.h"
 #include "BufferManager.h"
+#include "GpuMemoryPool.h"
+#include "GpuMemoryTracker.h"
 
 using namespace Graphics;
 
@@ -26,22 +28,31 @@ void GpuBuffer::Create( const std::wstring& name, uint32_t NumElements, uint32_t
 
     m_ElementCount = NumElements;
     m_ElementSize = ElementSize;
-    m_BufferSize = NumElements * ElementSize;
+    m_BufferSize = (size_t)NumElements * ElementSize;
 
     D3D12_RESOURCE_DESC ResourceDesc = DescribeBuffer();
 
     m_UsageState = D3D12_RESOURCE_STATE_COMMON;
 
-    D3D12_HEAP_PROPERTIES HeapProps;
-    HeapProps.Type = D3D12_HEAP_TYPE_DEFAULT;
-    HeapProps.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
-    HeapProps.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
-    HeapProps.CreationNodeMask = 1;
-    HeapProps.VisibleNodeMask = 1;
-
-    ASSERT_SUCCEEDED( 
-        g_Device->CreateCommittedResource( &HeapProps, D3D12_HEAP_FLAG_NONE,
-        &ResourceDesc, m_UsageState, nullptr, MY_IID_PPV_ARGS(&m_pResource)) );
+    // Buffers the GPU fills itself may count on starting out zeroed, which only committed memory is in practice
+    if (initialData)
+    {
+        ASSERT_SUCCEEDED( GpuMemoryPool::CreateResource(ResourceDesc, m_UsageState, MY_IID_PPV_ARGS(&m_pResource)) );
+    }
+    else
+    {
+        D3D12_HEAP_PROPERTIES HeapProps;
+        HeapProps.Type = D3D12_HEAP_TYPE_DEFAULT;
+        HeapProps.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+        HeapProps.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+        HeapProps.CreationNodeMask = 1;
+        HeapProps.VisibleNodeMask = 1;
+
+        ASSERT_SUCCEEDED( 
+            g_Device->CreateCommittedResource( &HeapProps, D3D12_HEAP_FLAG_NONE,
+            &ResourceDesc, m_UsageState, nullptr, MY_IID_PPV_ARGS(&m_pResource)) );
+    }
+    GpuMemoryTracker::TrackResource(m_pResource.Get(), GpuMemoryTracker::kBuffers);
 
     m_GpuVirtualAddress = m_pResource->GetGPUVirtualAddress();
 
@@ -63,7 +74,7 @@ void GpuBuffer::CreatePlaced(const std::wstring& name, ID3D12Heap* pBackingHeap,
 {
     m_ElementCount = NumElements;
     m_ElementSize = ElementSize;
-    m_BufferSize = NumElements * ElementSize;
+    m_BufferSize = (size_t)NumElements * ElementSize;
 
     D3D12_RESOURCE_DESC ResourceDesc = DescribeBuffer();
 
@@ -86,10 +97,36 @@ void GpuBuffer::CreatePlaced(const std::wstring& name, ID3D12Heap* pBackingHeap,
 
 }
 
+void GpuBuffer::CreateReserved(const std::wstring& name, uint32_t NumElements, uint32_t ElementSize)
+{
+    Destroy();
+
+    m_ElementCount = NumElements;
+    m_ElementSize = ElementSize;
+    m_BufferSize = (size_t)NumElements * ElementSize;
+
+    D3D12_RESOURCE_DESC ResourceDesc = DescribeBuffer();
+
+    m_UsageState = D3D12_RESOURCE_STATE_COMMON;
+
+    ASSERT_SUCCEEDED(g_Device->CreateReservedResource(&ResourceDesc, m_UsageState, nullptr, MY_IID_PPV_ARGS(&m_pResource)));
+
+    m_GpuVirtualAddress = m_pResource->GetGPUVirtualAddress();
+
+#ifdef RELEASE
+    (name);
+#else
+    m_pResource->SetName(name.c_str());
+#endif
+
+    CreateDerivedViews();
+}
+
 void GpuBuffer::Create(const std::wstring& name, uint32_t NumElements, uint32_t ElementSize,
-    EsramAllocator&, const void* initialData)
+    EsramAllocator& Allocator, const void* initialData)
 {
     Create(name, NumElements, ElementSize, initialData);
+    Allocator.Place(m_pResource.Get(), name);
 }
 
 D3D12_CPU_DESCRIPTOR_HANDLE GpuBuffer::CreateConstantBufferView(uint32_t Offset, uint32_t Size) const
@@ -205,7 +242,8 @@ void TypedBuffer::CreateDerivedViews(void)
 
 const D3D12_CPU_DESCRIPTOR_HANDLE& StructuredBuffer::GetCounterSRV(CommandContext& Context)
 {
-    Context.TransitionResource(m_CounterBuffer, D3D12_RESOURCE_STATE_GENERIC_READ);
+    // Counters are only read by compute shaders, which keeps this usable on the compute queue
+    Context.TransitionResource(m_CounterBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
     return m_CounterBuffer.GetSRV();
 }
 
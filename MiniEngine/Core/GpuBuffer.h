@@ -36,6 +36,9 @@ public:
     void CreatePlaced(const std::wstring& name, ID3D12Heap* pBackingHeap, uint32_t HeapOffset, uint32_t NumElements, uint32_t ElementSize,
         const void* initialData = nullptr);
 
+    // Create a buffer as a reserved resource, with no memory behind it until its tiles are mapped
+    void CreateReserved(const std::wstring& name, uint32_t NumElements, uint32_t ElementSize);
+
     const D3D12_CPU_DESCRIPTOR_HANDLE& GetUAV(void) const { return m_UAV; }
     const D3D12_CPU_DESCRIPTOR_HANDLE& GetSRV(void) const { return m_SRV; }
 
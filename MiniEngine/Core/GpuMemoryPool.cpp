@@ -0,0 +1,375 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "pch.h"
+#include "GpuMemoryPool.h"
+#include "GraphicsCore.h"
+#include "CommandListManager.h"
+#include "BuddyAllocator.h"
+#include "TLSFAllocator.h"
+#include <dxgi1_4.h>
+#include <atomic>
+#include <deque>
+#include <mutex>
+
+using namespace Graphics;
+using Microsoft::WRL::ComPtr;
+
+namespace GpuMemoryPool
+{
+    BoolVar Enable("Graphics/Pool GPU Memory", true);
+
+    // Heaps keep the allocator they were created with
+    enum PageAllocator { kBuddyPages, kTLSFPages, kNumPageAllocators };
+    const char* PageAllocatorLabels[kNumPageAllocators] = { "Buddy", "TLSF" };
+    EnumVar PoolAllocator("Graphics/Pool Allocator", kTLSFPages, kNumPageAllocators, PageAllocatorLabels);
+
+    const uint64_t kPageSize = 64 * 1024 * 1024;
+    const uint64_t kMaxPooledSize = kPageSize / 4;
+
+    // Heaps empty for this many frames are released, which keeps a level that loads and unloads the same
+    // textures from creating and destroying heaps over and over
+    const uint32_t kFramesBeforeRelease = 120;
+
+    enum HeapCategory { kBufferHeap, kTextureHeap, kNumHeapCategories };
+
+    struct HeapPage
+    {
+        HeapPage( bool UseTLSF ) : NumAllocations(0), FramesEmpty(0)
+        {
+            if (UseTLSF)
+                TLSFRanges.reset(new TLSFAllocator(kManualSubAllocationStrategy, D3D12_HEAP_TYPE_DEFAULT, kPageSize));
+            else
+                BuddyRanges.reset(new BuddyAllocator(kManualSubAllocationStrategy, D3D12_HEAP_TYPE_DEFAULT, kPageSize));
+        }
+
+        bool AllocateRange( size_t Size, size_t& Offset, size_t& PaddedSize )
+        {
+            return TLSFRanges ? TLSFRanges->AllocateRange(Size, Offset, PaddedSize) :
+                BuddyRanges->AllocateRange(Size, Offset, PaddedSize);
+        }
+
+        void DeallocateRange( size_t Offset, size_t Size )
+        {
+            if (TLSFRanges)
+                TLSFRanges->DeallocateRange(Offset, Size);
+            else
+                BuddyRanges->DeallocateRange(Offset, Size);
+        }
+
+        ComPtr<ID3D12Heap> Heap;
+
+        // One of them tracks the offsets, so it is never initialized
+        std::unique_ptr<BuddyAllocator> BuddyRanges;
+        std::unique_ptr<TLSFAllocator> TLSFRanges;
+
+        uint32_t NumAllocations;    // Counts ranges waiting on the GPU to be freed
+        uint32_t FramesEmpty;
+    };
+
+    struct PendingFree
+    {
+        HeapPage* Page;
+        uint64_t Offset;
+        uint64_t Size;
+        uint64_t Fences[3];         // The last fence submitted to each queue when the resource was released
+    };
+
+    std::mutex s_Mutex;
+    bool s_Initialized = false;     // Resources released after Shutdown() leave their range alone
+    D3D12_HEAP_FLAGS s_HeapFlags[kNumHeapCategories];
+    uint32_t s_NumCategories = kNumHeapCategories;
+    std::vector<std::unique_ptr<HeapPage>> s_Pages[kNumHeapCategories];
+    std::deque<PendingFree> s_PendingFrees;
+    uint64_t s_HeapBytes = 0;
+    uint64_t s_UsedBytes = 0;
+
+    ComPtr<IDXGIAdapter3> s_Adapter;
+    bool s_OverBudget = false;
+    uint64_t s_VideoMemoryUsage = 0;
+    DXGI_QUERY_VIDEO_MEMORY_INFO s_LocalInfo = {};
+    DXGI_QUERY_VIDEO_MEMORY_INFO s_NonLocalInfo = {};
+
+    // {9A2ED0C5-5F87-4C3B-9E4B-3D1F0E6A7C21}
+    const GUID kRangeOwnerGuid = { 0x9a2ed0c5, 0x5f87, 0x4c3b, { 0x9e, 0x4b, 0x3d, 0x1f, 0x0e, 0x6a, 0x7c, 0x21 } };
+
+    void FreeRange( HeapPage* Page, uint64_t Offset, uint64_t Size )
+    {
+        std::lock_guard<std::mutex> Guard(s_Mutex);
+        if (!s_Initialized)
+            return;
+
+        // Any command list that uses the resource has been submitted already, so the last fence of each queue
+        // covers it
+        PendingFree Free = { Page, Offset, Size,
+            g_CommandManager.GetGraphicsQueue().GetNextFenceValue() - 1,
+            g_CommandManager.GetComputeQueue().GetNextFenceValue() - 1,
+            g_CommandManager.GetCopyQueue().GetNextFenceValue() - 1 };
+        s_PendingFrees.push_back(Free);
+    }
+
+    // Attached to a placed resource as private data.  The resource releases it when it is destroyed, which
+    // hands its range back to the pool.
+    class RangeOwner : public IUnknown
+    {
+    public:
+        RangeOwner( HeapPage* Page, uint64_t Offset, uint64_t Size ) :
+            m_RefCount(1), m_Page(Page), m_Offset(Offset), m_Size(Size) {}
+
+        HRESULT STDMETHODCALLTYPE QueryInterface( REFIID riid, void** ppvObject ) override
+        {
+            if (riid != __uuidof(IUnknown))
+            {
+                *ppvObject = nullptr;
+                return E_NOINTERFACE;
+            }
+            AddRef();
+            *ppvObject = this;
+            return S_OK;
+        }
+
+        ULONG STDMETHODCALLTYPE AddRef( void ) override { return ++m_RefCount; }
+
+        ULONG STDMETHODCALLTYPE Release( void ) override
+        {
+            ULONG RefCount = --m_RefCount;
+            if (RefCount == 0)
+            {
+                FreeRange(m_Page, m_Offset, m_Size);
+                delete this;
+            }
+            return RefCount;
+        }
+
+    private:
+        std::atomic<ULONG> m_RefCount;
+        HeapPage* m_Page;
+        uint64_t m_Offset;
+        uint64_t m_Size;
+    };
+
+    // Takes the first heap with room, so that allocations pack into the oldest heaps and the newest ones are the
+    // likeliest to empty out and be released
+    HeapPage* AllocateRange( uint32_t Category, uint64_t Size, uint64_t& Offset )
+    {
+        std::lock_guard<std::mutex> Guard(s_Mutex);
+
+        size_t RangeOffset, RangeSize;
+        HeapPage* Page = nullptr;
+        for (auto& Candidate : s_Pages[Category])
+        {
+            if (Candidate->AllocateRange((size_t)Size, RangeOffset, RangeSize))
+            {
+                Page = Candidate.get();
+                break;
+            }
+        }
+
+        if (Page == nullptr)
+        {
+            D3D12_HEAP_DESC Desc = {};
+            Desc.SizeInBytes = kPageSize;
+            Desc.Properties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
+            Desc.Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+            Desc.Flags = s_HeapFlags[Category];
+
+            std::unique_ptr<HeapPage> NewPage(new HeapPage(PoolAllocator == kTLSFPages));
+            if (FAILED(g_Device->CreateHeap(&Desc, MY_IID_PPV_ARGS(&NewPage->Heap))))
+                return nullptr;
+            NewPage->Heap->SetName(L"GPU Memory Pool");
+
+            Page = NewPage.get();
+            s_Pages[Category].push_back(std::move(NewPage));
+            s_HeapBytes += kPageSize;
+
+            if (!Page->AllocateRange((size_t)Size, RangeOffset, RangeSize))
+                return nullptr;
+        }
+
+        ++Page->NumAllocations;
+        Page->FramesEmpty = 0;
+        s_UsedBytes += Size;
+        Offset = RangeOffset;
+        return Page;
+    }
+
+    void ReleaseRange( HeapPage* Page, uint64_t Offset, uint64_t Size )
+    {
+        Page->DeallocateRange((size_t)Offset, (size_t)Size);
+        --Page->NumAllocations;
+        s_UsedBytes -= Size;
+    }
+}
+
+void GpuMemoryPool::Initialize( void )
+{
+    // Tier 2 heaps hold any kind of resource, so everything shares the buffer heaps
+    D3D12_FEATURE_DATA_D3D12_OPTIONS Options = {};
+    if (SUCCEEDED(g_Device->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS, &Options, sizeof(Options))) &&
+        Options.ResourceHeapTier >= D3D12_RESOURCE_HEAP_TIER_2)
+    {
+        s_NumCategories = 1;
+        s_HeapFlags[kBufferHeap] = D3D12_HEAP_FLAG_ALLOW_ALL_BUFFERS_AND_TEXTURES;
+    }
+    else
+    {
+        s_NumCategories = kNumHeapCategories;
+        s_HeapFlags[kBufferHeap] = D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
+        s_HeapFlags[kTextureHeap] = D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES;
+    }
+
+    // The budget comes from the adapter that the device was created on
+    ComPtr<IDXGIFactory4> Factory;
+    if (FAILED(CreateDXGIFactory2(0, MY_IID_PPV_ARGS(&Factory))) ||
+        FAILED(Factory->EnumAdapterByLuid(g_Device->GetAdapterLuid(), MY_IID_PPV_ARGS(&s_Adapter))))
+    {
+        s_Adapter = nullptr;
+    }
+
+    std::lock_guard<std::mutex> Guard(s_Mutex);
+    s_Initialized = true;
+}
+
+void GpuMemoryPool::Shutdown( void )
+{
+    std::lock_guard<std::mutex> Guard(s_Mutex);
+
+    // The GPU is idle by now.  Heaps that still hold resources are left to them.
+    for (const PendingFree& Free : s_PendingFrees)
+        ReleaseRange(Free.Page, Free.Offset, Free.Size);
+    s_PendingFrees.clear();
+
+    for (auto& Pages : s_Pages)
+    {
+        for (auto& Page : Pages)
+        {
+            if (Page->NumAllocations > 0)
+                Page.release();
+        }
+        Pages.clear();
+    }
+
+    s_HeapBytes = 0;
+    s_UsedBytes = 0;
+    s_Adapter = nullptr;
+    s_Initialized = false;
+}
+
+HRESULT GpuMemoryPool::CreateResource( const D3D12_RESOURCE_DESC& Desc, D3D12_RESOURCE_STATES InitialState,
+    REFIID riid, void** ppResource )
+{
+    const D3D12_RESOURCE_FLAGS kUnpooledFlags = D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET |
+        D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL | D3D12_RESOURCE_FLAG_ALLOW_SIMULTANEOUS_ACCESS;
+
+    if (s_Initialized && Enable && (Desc.Flags & kUnpooledFlags) == 0 && Desc.SampleDesc.Count == 1)
+    {
+        const D3D12_RESOURCE_ALLOCATION_INFO Info = g_Device->GetResourceAllocationInfo(1, 1, &Desc);
+        const uint32_t Category = (s_NumCategories == 1 || Desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER) ?
+            kBufferHeap : kTextureHeap;
+
+        uint64_t Offset;
+        HeapPage* Page = nullptr;
+        if (Info.SizeInBytes <= kMaxPooledSize && Info.Alignment <= D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT)
+            Page = AllocateRange(Category, Info.SizeInBytes, Offset);
+
+        if (Page != nullptr)
+        {
+            ComPtr<ID3D12Resource> Resource;
+            if (SUCCEEDED(g_Device->CreatePlacedResource(Page->Heap.Get(), Offset, &Desc, InitialState, nullptr,
+                MY_IID_PPV_ARGS(&Resource))))
+            {
+                RangeOwner* Owner = new RangeOwner(Page, Offset, Info.SizeInBytes);
+                Resource->SetPrivateDataInterface(kRangeOwnerGuid, Owner);
+                Owner->Release();
+                return Resource->QueryInterface(riid, ppResource);
+            }
+
+            std::lock_guard<std::mutex> Guard(s_Mutex);
+            ReleaseRange(Page, Offset, Info.SizeInBytes);
+        }
+    }
+
+    const D3D12_HEAP_PROPERTIES HeapProps = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
+    return g_Device->CreateCommittedResource(&HeapProps, D3D12_HEAP_FLAG_NONE, &Desc, InitialState, nullptr,
+        riid, ppResource);
+}
+
+void GpuMemoryPool::EndFrame( void )
+{
+    std::lock_guard<std::mutex> Guard(s_Mutex);
+    if (!s_Initialized)
+        return;
+
+    // Fences only move forward, so the frees are ready in the order they were queued
+    while (!s_PendingFrees.empty())
+    {
+        const PendingFree& Free = s_PendingFrees.front();
+        if (!g_CommandManager.IsFenceComplete(Free.Fences[0]) ||
+            !g_CommandManager.IsFenceComplete(Free.Fences[1]) ||
+            !g_CommandManager.IsFenceComplete(Free.Fences[2]))
+            break;
+
+        ReleaseRange(Free.Page, Free.Offset, Free.Size);
+        s_PendingFrees.pop_front();
+    }
+
+    // Going over budget makes the OS demote memory to system RAM, so empty heaps go right away then
+    for (uint32_t Category = 0; Category < s_NumCategories; ++Category)
+    {
+        auto& Pages = s_Pages[Category];
+        for (auto Iter = Pages.begin(); Iter != Pages.end(); )
+        {
+            HeapPage& Page = **Iter;
+            if (Page.NumAllocations == 0 && (++Page.FramesEmpty > kFramesBeforeRelease || s_OverBudget))
+            {
+                s_HeapBytes -= kPageSize;
+                Iter = Pages.erase(Iter);
+            }
+            else
+            {
+                ++Iter;
+            }
+        }
+    }
+}
+
+void GpuMemoryPool::ReportStatistics( void )
+{
+    DXGI_QUERY_VIDEO_MEMORY_INFO Info = {};
+    DXGI_QUERY_VIDEO_MEMORY_INFO NonLocalInfo = {};
+    if (s_Adapter != nullptr)
+    {
+        s_Adapter->QueryVideoMemoryInfo(0, DXGI_MEMORY_SEGMENT_GROUP_LOCAL, &Info);
+        s_Adapter->QueryVideoMemoryInfo(0, DXGI_MEMORY_SEGMENT_GROUP_NON_LOCAL, &NonLocalInfo);
+    }
+
+    std::lock_guard<std::mutex> Guard(s_Mutex);
+    s_OverBudget = Info.CurrentUsage > Info.Budget;
+    s_VideoMemoryUsage = Info.CurrentUsage;
+    s_LocalInfo = Info;
+    s_NonLocalInfo = NonLocalInfo;
+
+    EngineProfiling::SetCounter("Video Memory Budget MB", (uint32_t)(Info.Budget >> 20));
+    EngineProfiling::SetCounter("Video Memory Usage MB", (uint32_t)(Info.CurrentUsage >> 20));
+    EngineProfiling::SetCounter("Pooled Heap MB", (uint32_t)(s_HeapBytes >> 20));
+    EngineProfiling::SetCounter("Pooled Resource MB", (uint32_t)(s_UsedBytes >> 20));
+}
+
+uint64_t GpuMemoryPool::GetVideoMemoryUsage( void )
+{
+    std::lock_guard<std::mutex> Guard(s_Mutex);
+    return s_VideoMemoryUsage;
+}
+
+void GpuMemoryPool::GetVideoMemoryInfo( DXGI_QUERY_VIDEO_MEMORY_INFO& Local, DXGI_QUERY_VIDEO_MEMORY_INFO& NonLocal )
+{
+    std::lock_guard<std::mutex> Guard(s_Mutex);
+    Local = s_LocalInfo;
+    NonLocal = s_NonLocalInfo;
+}
@@ -0,0 +1,47 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Places default heap buffers and textures in 64 MB heaps instead of giving each of them a committed resource
+// of its own.  Each heap is split up by a TLSF allocator, which pads ranges to 64 KB only, or by the buddy allocator
+// that pads them to a power of two, as "Graphics/Pool Allocator" chooses when the heap is created.  With resource
+// heap tier 1, buffers and textures cannot share a heap, so each gets its own list of heaps.  Freeing happens
+// when the last reference to the resource is released, and the range is reused once the GPU has finished every
+// command list submitted by then, so there is nothing for the owner to keep track of.
+//
+// Render targets, depth buffers and MSAA textures are never pooled, because placed ones must be cleared or
+// discarded before their first use, which the code creating them does not do.
+//
+
+#pragma once
+
+#include "pch.h"
+#include <dxgi1_4.h>
+
+namespace GpuMemoryPool
+{
+    void Initialize( void );
+    void Shutdown( void );
+
+    // Creates a resource in a pooled heap when it is small enough, and a committed resource otherwise.  Placed
+    // resources start with undefined contents, so only pass resources that are written in full before use.
+    HRESULT CreateResource( const D3D12_RESOURCE_DESC& Desc, D3D12_RESOURCE_STATES InitialState,
+        REFIID riid, void** ppResource );
+
+    // Reuses the ranges the GPU is done with, and gives heaps that have stayed empty back to the OS.  Call this
+    // once per frame.
+    void EndFrame( void );
+
+    // Sets the pool and video memory budget counters
+    void ReportStatistics( void );
+
+    // The process's use of local video memory in bytes, as of the last ReportStatistics()
+    uint64_t GetVideoMemoryUsage( void );
+
+    // The budgets and usage of local video memory and of system memory, as of the last ReportStatistics()
+    void GetVideoMemoryInfo( DXGI_QUERY_VIDEO_MEMORY_INFO& Local, DXGI_QUERY_VIDEO_MEMORY_INFO& NonLocal );
+}
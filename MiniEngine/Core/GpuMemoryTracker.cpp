@@ -0,0 +1,235 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "pch.h"
+#include "GpuMemoryTracker.h"
+#include "GpuMemoryPool.h"
+#include "GraphicsCore.h"
+#include "TextRenderer.h"
+#include <atomic>
+#include <fstream>
+
+using namespace Graphics;
+
+namespace GpuMemoryTracker
+{
+    BoolVar DisplayUsage("Display Memory Usage", false);
+    NumVar WarningThreshold("Graphics/Memory/Budget Warning %", 90.0f, 50.0f, 100.0f, 1.0f);
+
+    void WriteReportCallback( void* ) { WriteReport(); }
+    CallbackTrigger WriteReportTrigger("Graphics/Memory/Write Report", WriteReportCallback);
+
+    enum Segment { kVideoMemory, kSystemMemory, kNumSegments };
+
+    const char* kCategoryNames[kNumCategories] =
+    {
+        "Render Targets",
+        "Shadow Maps",
+        "Buffers",
+        "Model Geometry",
+        "Textures",
+        "Linear Allocator Pages",
+        "Large Linear Pages",
+        "Upload Buffers",
+        "Readback Buffers",
+        "Descriptor Heaps",
+    };
+
+    std::atomic<uint64_t> s_Bytes[kNumCategories][kNumSegments];
+    std::atomic<uint32_t> s_Objects[kNumCategories];
+    bool s_OverThreshold = false;
+
+    // {4C8E2B71-3A9D-4F06-B5E2-7D1C9A0F3E58}
+    const GUID kTagGuid = { 0x4c8e2b71, 0x3a9d, 0x4f06, { 0xb5, 0xe2, 0x7d, 0x1c, 0x9a, 0x0f, 0x3e, 0x58 } };
+
+    // Attached to a tracked object as private data, which the object releases when it is destroyed or tagged again
+    class MemoryTag : public IUnknown
+    {
+    public:
+        MemoryTag( Category Cat, Segment Seg, uint64_t Bytes ) : m_RefCount(1), m_Category(Cat), m_Segment(Seg), m_Bytes(Bytes)
+        {
+            s_Bytes[m_Category][m_Segment].fetch_add(m_Bytes, std::memory_order_relaxed);
+            s_Objects[m_Category].fetch_add(1, std::memory_order_relaxed);
+        }
+
+        HRESULT STDMETHODCALLTYPE QueryInterface( REFIID riid, void** ppvObject ) override
+        {
+            if (riid != __uuidof(IUnknown))
+            {
+                *ppvObject = nullptr;
+                return E_NOINTERFACE;
+            }
+            AddRef();
+            *ppvObject = this;
+            return S_OK;
+        }
+
+        ULONG STDMETHODCALLTYPE AddRef( void ) override { return ++m_RefCount; }
+
+        ULONG STDMETHODCALLTYPE Release( void ) override
+        {
+            ULONG RefCount = --m_RefCount;
+            if (RefCount == 0)
+            {
+                s_Bytes[m_Category][m_Segment].fetch_sub(m_Bytes, std::memory_order_relaxed);
+                s_Objects[m_Category].fetch_sub(1, std::memory_order_relaxed);
+                delete this;
+            }
+            return RefCount;
+        }
+
+    private:
+        std::atomic<ULONG> m_RefCount;
+        Category m_Category;
+        Segment m_Segment;
+        uint64_t m_Bytes;
+    };
+
+    void Tag( ID3D12Object* Object, Category Cat, Segment Seg, uint64_t Bytes )
+    {
+        MemoryTag* NewTag = new MemoryTag(Cat, Seg, Bytes);
+        Object->SetPrivateDataInterface(kTagGuid, NewTag);
+        NewTag->Release();
+    }
+
+    Segment GetSegment( D3D12_HEAP_TYPE Type )
+    {
+        return Type == D3D12_HEAP_TYPE_DEFAULT ? kVideoMemory : kSystemMemory;
+    }
+
+    uint64_t GetTotal( Segment Seg )
+    {
+        uint64_t Total = 0;
+        for (uint32_t i = 0; i < kNumCategories; ++i)
+            Total += s_Bytes[i][Seg].load(std::memory_order_relaxed);
+        return Total;
+    }
+}
+
+void GpuMemoryTracker::TrackResource( ID3D12Resource* Resource, Category Cat )
+{
+    ASSERT(Resource != nullptr);
+
+    // Reserved resources have no heap of their own
+    D3D12_HEAP_PROPERTIES HeapProps;
+    D3D12_HEAP_FLAGS HeapFlags;
+    if (FAILED(Resource->GetHeapProperties(&HeapProps, &HeapFlags)))
+        return;
+
+    const D3D12_RESOURCE_DESC Desc = Resource->GetDesc();
+    const uint64_t Bytes = g_Device->GetResourceAllocationInfo(0, 1, &Desc).SizeInBytes;
+    Tag(Resource, Cat, GetSegment(HeapProps.Type), Bytes);
+}
+
+void GpuMemoryTracker::TrackHeap( ID3D12Heap* Heap, Category Cat )
+{
+    ASSERT(Heap != nullptr);
+
+    const D3D12_HEAP_DESC Desc = Heap->GetDesc();
+    Tag(Heap, Cat, GetSegment(Desc.Properties.Type), Desc.SizeInBytes);
+}
+
+void GpuMemoryTracker::TrackDescriptorHeap( ID3D12DescriptorHeap* Heap )
+{
+    ASSERT(Heap != nullptr);
+
+    const D3D12_DESCRIPTOR_HEAP_DESC Desc = Heap->GetDesc();
+    const uint64_t Bytes = (uint64_t)Desc.NumDescriptors * g_Device->GetDescriptorHandleIncrementSize(Desc.Type);
+    const bool ShaderVisible = (Desc.Flags & D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE) != 0;
+    Tag(Heap, kDescriptorHeaps, ShaderVisible ? kVideoMemory : kSystemMemory, Bytes);
+}
+
+void GpuMemoryTracker::ReportStatistics( void )
+{
+    DXGI_QUERY_VIDEO_MEMORY_INFO Local, NonLocal;
+    GpuMemoryPool::GetVideoMemoryInfo(Local, NonLocal);
+    if (Local.Budget == 0)
+        return;
+
+    // Only crossing the threshold is logged, so that staying above it does not flood the output
+    const bool OverThreshold = Local.CurrentUsage * 100.0 > Local.Budget * (double)WarningThreshold;
+    if (OverThreshold && !s_OverThreshold)
+    {
+        Utility::Printf("Video memory use of %llu MB is over %.0f%% of the %llu MB budget\n",
+            Local.CurrentUsage >> 20, (float)WarningThreshold, Local.Budget >> 20);
+    }
+    s_OverThreshold = OverThreshold;
+}
+
+void GpuMemoryTracker::Display( TextContext& Text, float x, float y )
+{
+    if (!s_OverThreshold && !DisplayUsage)
+        return;
+
+    DXGI_QUERY_VIDEO_MEMORY_INFO Local, NonLocal;
+    GpuMemoryPool::GetVideoMemoryInfo(Local, NonLocal);
+
+    Text.ResetCursor(x, y);
+
+    if (s_OverThreshold)
+    {
+        Text.SetColor(Color(1.0f, 0.3f, 0.3f));
+        Text.DrawFormattedString("Video memory %llu of %llu MB budget\n", Local.CurrentUsage >> 20, Local.Budget >> 20);
+        Text.SetColor(Color(1.0f, 1.0f, 1.0f));
+    }
+
+    if (!DisplayUsage)
+        return;
+
+    Text.SetTextSize(20.0f);
+    Text.DrawString("GPU memory MB          Video   System\n");
+    for (uint32_t i = 0; i < kNumCategories; ++i)
+    {
+        Text.DrawString(kCategoryNames[i]);
+        Text.SetCursorX(x + 230.0f);
+        Text.DrawFormattedString("%6llu %8llu\n", s_Bytes[i][kVideoMemory].load() >> 20, s_Bytes[i][kSystemMemory].load() >> 20);
+    }
+
+    // Pool heap space that no resource uses, the swap chain and driver allocations are never tagged
+    const uint64_t Tracked = GetTotal(kVideoMemory);
+    Text.DrawString("Untracked");
+    Text.SetCursorX(x + 230.0f);
+    Text.DrawFormattedString("%6llu\n", (Local.CurrentUsage > Tracked ? Local.CurrentUsage - Tracked : 0) >> 20);
+
+    Text.DrawString("Usage / Budget");
+    Text.SetCursorX(x + 230.0f);
+    Text.DrawFormattedString("%6llu %8llu\n", Local.CurrentUsage >> 20, NonLocal.CurrentUsage >> 20);
+    Text.SetCursorX(x + 230.0f);
+    Text.DrawFormattedString("%6llu %8llu\n", Local.Budget >> 20, NonLocal.Budget >> 20);
+    Text.SetTextSize(24.0f);
+}
+
+void GpuMemoryTracker::WriteReport( void )
+{
+    std::ofstream Report("GpuMemoryReport.csv", std::ios::out);
+    if (!Report)
+    {
+        Utility::Printf("Unable to write GpuMemoryReport.csv\n");
+        return;
+    }
+
+    DXGI_QUERY_VIDEO_MEMORY_INFO Local, NonLocal;
+    GpuMemoryPool::GetVideoMemoryInfo(Local, NonLocal);
+
+    Report << "Category,Objects,Video Memory MB,System Memory MB\n";
+    Report.precision(2);
+    Report << std::fixed;
+    for (uint32_t i = 0; i < kNumCategories; ++i)
+    {
+        Report << kCategoryNames[i] << ',' << s_Objects[i].load() << ',' <<
+            s_Bytes[i][kVideoMemory].load() / 1048576.0 << ',' << s_Bytes[i][kSystemMemory].load() / 1048576.0 << '\n';
+    }
+
+    const uint64_t Tracked = GetTotal(kVideoMemory);
+    Report << "Untracked,," << (Local.CurrentUsage > Tracked ? Local.CurrentUsage - Tracked : 0) / 1048576.0 << ",\n";
+    Report << "Usage,," << Local.CurrentUsage / 1048576.0 << ',' << NonLocal.CurrentUsage / 1048576.0 << '\n';
+    Report << "Budget,," << Local.Budget / 1048576.0 << ',' << NonLocal.Budget / 1048576.0 << '\n';
+
+    Utility::Printf("Wrote GpuMemoryReport.csv\n");
+}
@@ -0,0 +1,52 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Counts GPU memory by what it is used for.  The code creating a resource, heap or descriptor heap tags it with
+// a category, and the tag is attached to the object as private data, so the bytes are taken off again when the
+// object is destroyed.  Tagging an object again moves it to the new category.  Memory in default heaps and in
+// shader visible descriptor heaps counts as video memory, and upload, readback and CPU only descriptor heaps as
+// system memory.  Placed and reserved resources are left untagged when the heap they live in is tagged instead.
+//
+
+#pragma once
+
+#include "pch.h"
+
+class TextContext;
+
+namespace GpuMemoryTracker
+{
+    enum Category
+    {
+        kRenderTargets,
+        kShadowMaps,
+        kBuffers,
+        kModelGeometry,
+        kTextures,
+        kLinearAllocatorPages,
+        kLinearAllocatorLargePages,
+        kUploadBuffers,
+        kReadbackBuffers,
+        kDescriptorHeaps,
+        kNumCategories
+    };
+
+    void TrackResource( ID3D12Resource* Resource, Category Cat );
+    void TrackHeap( ID3D12Heap* Heap, Category Cat );
+    void TrackDescriptorHeap( ID3D12DescriptorHeap* Heap );
+
+    // Warns when video memory use crosses the budget threshold.  Call this once per frame after
+    // GpuMemoryPool::ReportStatistics().
+    void ReportStatistics( void );
+
+    // Draws the budget warning, and the usage of every category when "Display Memory Usage" is on
+    void Display( TextContext& Text, float x, float y );
+
+    // Writes the usage of every category and the budgets to GpuMemoryReport.csv
+    void WriteReport( void );
+}
@@ -0,0 +1,538 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "pch.h"
+#include "GpuPrimitives.h"
+#include "RadixSort.h"
+#include "GraphicsCore.h"
+#include "RootSignature.h"
+#include "PipelineState.h"
+#include "CommandContext.h"
+#include "ReadbackBuffer.h"
+#include "ShaderCompiler.h"
+#include "EngineTuning.h"
+#include "SystemTime.h"
+#include "Math/Common.h"
+#include "Math/Random.h"
+#include <functional>
+
+#include "CompiledShaders/PrimitivesIndirectArgsCS.h"
+#include "CompiledShaders/PrimitivesReduceCS.h"
+#include "CompiledShaders/PrimitivesScanBlocksCS.h"
+#include "CompiledShaders/PrimitivesScanCS.h"
+#include "CompiledShaders/PrimitivesSegmentedReduceCS.h"
+#include "CompiledShaders/PrimitivesHistogramCS.h"
+
+using namespace Graphics;
+
+namespace GpuPrimitives
+{
+    // Must match GpuPrimitivesCommon.hlsli
+    const uint32_t kBlockSize = 2048;
+    const uint32_t kMaxBlocks = kMaxElements / kBlockSize;
+    const uint32_t kModeValues = 0;
+    const uint32_t kModeFlags = 1;
+
+    BoolVar UseWaveIntrinsics("Graphics/GPU Primitives/Use Wave Intrinsics", true);
+
+    void RunBenchmarkCallback( void* ) { Test(); Benchmark(); }
+    CallbackTrigger RunBenchmarkTrigger("Graphics/GPU Primitives/Run Benchmark", RunBenchmarkCallback);
+
+    // One group per block, followed by one group per item, up to the group limit
+    IndirectArgsBuffer s_DispatchArgs;
+
+    // The total of every block, replaced by the block's offset
+    ByteAddressBuffer s_BlockTotals;
+
+    enum Shader { kIndirectArgs, kReduce, kScanBlocks, kScan, kSegmentedReduce, kHistogram, kNumShaders };
+
+    RootSignature s_RootSignature;
+    ComputePSO s_PSOs[kNumShaders];
+    ComputePSO s_WavePSOs[kNumShaders];
+    bool s_WaveSupported = false;
+
+    // Called once by Core to initialize shaders
+    void Initialize(void);
+    void Shutdown(void);
+
+    ComputePSO& GetPSO( Shader Index )
+    {
+        return s_WaveSupported && UseWaveIntrinsics ? s_WavePSOs[Index] : s_PSOs[Index];
+    }
+
+    void PrepareDispatchArgs( ComputeContext& Context, GpuBuffer& CountBuffer, uint32_t CounterOffset );
+}
+
+void GpuPrimitives::Initialize( void )
+{
+    s_DispatchArgs.Create(L"GPU primitives dispatch args", 2, 12);
+    s_BlockTotals.Create(L"GPU primitives block totals", kMaxBlocks, sizeof(uint32_t));
+
+    s_RootSignature.Reset(3, 0);
+    s_RootSignature[0].InitAsConstants(0, 4);
+    s_RootSignature[1].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 0, 3);
+    s_RootSignature[2].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 0, 3);
+    s_RootSignature.Finalize(L"GPU Primitives");
+
+    struct ShaderSource
+    {
+        const wchar_t* File;
+        D3D12_SHADER_BYTECODE Embedded;
+    };
+    const ShaderSource Sources[kNumShaders] =
+    {
+        { L"PrimitivesIndirectArgsCS.hlsl",     CD3DX12_SHADER_BYTECODE(g_pPrimitivesIndirectArgsCS, sizeof(g_pPrimitivesIndirectArgsCS)) },
+        { L"PrimitivesReduceCS.hlsl",           CD3DX12_SHADER_BYTECODE(g_pPrimitivesReduceCS, sizeof(g_pPrimitivesReduceCS)) },
+        { L"PrimitivesScanBlocksCS.hlsl",       CD3DX12_SHADER_BYTECODE(g_pPrimitivesScanBlocksCS, sizeof(g_pPrimitivesScanBlocksCS)) },
+        { L"PrimitivesScanCS.hlsl",             CD3DX12_SHADER_BYTECODE(g_pPrimitivesScanCS, sizeof(g_pPrimitivesScanCS)) },
+        { L"PrimitivesSegmentedReduceCS.hlsl",  CD3DX12_SHADER_BYTECODE(g_pPrimitivesSegmentedReduceCS, sizeof(g_pPrimitivesSegmentedReduceCS)) },
+        { L"PrimitivesHistogramCS.hlsl",        CD3DX12_SHADER_BYTECODE(g_pPrimitivesHistogramCS, sizeof(g_pPrimitivesHistogramCS)) },
+    };
+
+    for (uint32_t i = 0; i < kNumShaders; ++i)
+    {
+        s_PSOs[i].SetRootSignature(s_RootSignature);
+        s_PSOs[i].SetComputeShader(Sources[i].Embedded);
+        s_PSOs[i].Finalize();
+    }
+
+    D3D12_FEATURE_DATA_D3D12_OPTIONS1 Options1 = {};
+    s_WaveSupported = SUCCEEDED(g_Device->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS1, &Options1, sizeof(Options1))) &&
+        Options1.WaveOps;
+
+    // Without runtime compilation, the permutations are the embedded shaders, and the wave PSOs are the same
+    // as the others.  The indirect arguments have nothing to combine.
+    for (uint32_t i = 0; i < kNumShaders; ++i)
+    {
+        ComputePSO* PSO = &s_WavePSOs[i];
+        PSO->SetRootSignature(s_RootSignature);
+
+        if (!s_WaveSupported || i == kIndirectArgs)
+        {
+            PSO->SetComputeShader(Sources[i].Embedded);
+            PSO->Finalize();
+            continue;
+        }
+
+        ShaderCompiler::Permutation* Permutation = &ShaderCompiler::GetPermutation(Sources[i].File, L"main", L"cs_6_0",
+            { { L"PRIMITIVES_WAVE_OPS", L"1" } }, Sources[i].Embedded);
+
+        PSO->SetComputeShader(Permutation->GetBytecode());
+        PSO->Finalize();
+
+        Permutation->OnReload([PSO, Permutation]
+        {
+            PSO->SetComputeShader(Permutation->GetBytecode());
+            PSO->Finalize();
+        });
+    }
+}
+
+void GpuPrimitives::Shutdown( void )
+{
+    s_DispatchArgs.Destroy();
+    s_BlockTotals.Destroy();
+}
+
+bool GpuPrimitives::IsWaveSupported( void )
+{
+    return s_WaveSupported;
+}
+
+void GpuPrimitives::PrepareDispatchArgs( ComputeContext& Context, GpuBuffer& CountBuffer, uint32_t CounterOffset )
+{
+    Context.SetRootSignature(s_RootSignature);
+    Context.SetConstants(0, CounterOffset, 0, 0, 0);
+
+    Context.SetPipelineState(s_PSOs[kIndirectArgs]);
+    Context.TransitionResource(CountBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    Context.TransitionResource(s_DispatchArgs, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, true);
+
+    // Every slot is bound, though the shader only reads the count
+    Context.SetDynamicDescriptor(1, 0, CountBuffer.GetSRV());
+    Context.SetDynamicDescriptor(1, 1, CountBuffer.GetSRV());
+    Context.SetDynamicDescriptor(1, 2, CountBuffer.GetSRV());
+    Context.SetDynamicDescriptor(2, 0, s_DispatchArgs.GetUAV());
+    Context.SetDynamicDescriptor(2, 1, s_BlockTotals.GetUAV());
+    Context.SetDynamicDescriptor(2, 2, s_BlockTotals.GetUAV());
+    Context.Dispatch(1, 1, 1);
+
+    Context.TransitionResource(s_DispatchArgs, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT);
+}
+
+static void ScanBlocks( ComputeContext& Context, GpuBuffer& Input, GpuBuffer& Flags, GpuBuffer& Output, GpuBuffer& CountBuffer,
+    uint32_t CounterOffset, uint32_t Mode, GpuBuffer* TotalBuffer, uint32_t TotalOffset )
+{
+    using namespace GpuPrimitives;
+
+    ASSERT(Input.GetElementCount() <= kMaxElements, "List is too long for the GPU primitives block totals");
+    ASSERT(&Input != &Output && &Flags != &Output, "GPU primitives cannot read and write a list at once");
+    ASSERT(TotalBuffer != &CountBuffer, "The total of a scan cannot be written to its counter buffer");
+
+    PrepareDispatchArgs(Context, CountBuffer, CounterOffset);
+
+    GpuBuffer& Total = TotalBuffer != nullptr ? *TotalBuffer : s_BlockTotals;
+
+    Context.TransitionResource(Input, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    Context.TransitionResource(Flags, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    Context.TransitionResource(Output, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    Context.TransitionResource(Total, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    Context.TransitionResource(s_BlockTotals, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    Context.InsertUAVBarrier(s_BlockTotals, true);
+
+    Context.SetConstants(0, CounterOffset, Mode, TotalOffset, TotalBuffer != nullptr ? 1 : 0);
+    Context.SetDynamicDescriptor(1, 0, Input.GetSRV());
+    Context.SetDynamicDescriptor(1, 1, Flags.GetSRV());
+    Context.SetDynamicDescriptor(1, 2, CountBuffer.GetSRV());
+    Context.SetDynamicDescriptor(2, 0, Output.GetUAV());
+    Context.SetDynamicDescriptor(2, 1, s_BlockTotals.GetUAV());
+    Context.SetDynamicDescriptor(2, 2, Total.GetUAV());
+
+    Context.SetPipelineState(GetPSO(kReduce));
+    Context.DispatchIndirect(s_DispatchArgs, 0);
+    Context.InsertUAVBarrier(s_BlockTotals);
+
+    Context.SetPipelineState(GetPSO(kScanBlocks));
+    Context.Dispatch(1, 1, 1);
+    Context.InsertUAVBarrier(s_BlockTotals);
+
+    Context.SetPipelineState(GetPSO(kScan));
+    Context.DispatchIndirect(s_DispatchArgs, 0);
+
+    // Later passes read the output and the total
+    Context.InsertUAVBarrier(Output);
+    Context.InsertUAVBarrier(Total);
+}
+
+void GpuPrimitives::ExclusiveScan( ComputeContext& Context, GpuBuffer& Input, GpuBuffer& Output, GpuBuffer& CountBuffer,
+    uint32_t CounterOffset, GpuBuffer* TotalBuffer, uint32_t TotalOffset )
+{
+    ScanBlocks(Context, Input, Input, Output, CountBuffer, CounterOffset, kModeValues, TotalBuffer, TotalOffset);
+}
+
+void GpuPrimitives::Compact( ComputeContext& Context, GpuBuffer& Input, GpuBuffer& Flags, GpuBuffer& Output, GpuBuffer& CountBuffer,
+    uint32_t CounterOffset, GpuBuffer& OutputCount, uint32_t OutputCountOffset )
+{
+    ASSERT(Flags.GetElementCount() >= Input.GetElementCount(), "Every element to compact needs a flag");
+    ScanBlocks(Context, Input, Flags, Output, CountBuffer, CounterOffset, kModeFlags, &OutputCount, OutputCountOffset);
+}
+
+void GpuPrimitives::SegmentedReduce( ComputeContext& Context, GpuBuffer& Input, GpuBuffer& SegmentOffsets, GpuBuffer& Output,
+    GpuBuffer& CountBuffer, uint32_t CounterOffset, ReduceOp Op )
+{
+    ASSERT(&Input != &Output && &SegmentOffsets != &Output, "GPU primitives cannot read and write a list at once");
+
+    PrepareDispatchArgs(Context, CountBuffer, CounterOffset);
+
+    Context.TransitionResource(Input, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    Context.TransitionResource(SegmentOffsets, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    Context.TransitionResource(Output, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, true);
+
+    Context.SetConstants(0, CounterOffset, (uint32_t)Op, 0, 0);
+    Context.SetDynamicDescriptor(1, 0, Input.GetSRV());
+    Context.SetDynamicDescriptor(1, 1, SegmentOffsets.GetSRV());
+    Context.SetDynamicDescriptor(1, 2, CountBuffer.GetSRV());
+    Context.SetDynamicDescriptor(2, 0, Output.GetUAV());
+    Context.SetDynamicDescriptor(2, 1, s_BlockTotals.GetUAV());
+    Context.SetDynamicDescriptor(2, 2, s_BlockTotals.GetUAV());
+
+    Context.SetPipelineState(GetPSO(kSegmentedReduce));
+    Context.DispatchIndirect(s_DispatchArgs, 12);
+    Context.InsertUAVBarrier(Output);
+}
+
+void GpuPrimitives::Histogram( ComputeContext& Context, GpuBuffer& Input, GpuBuffer& Output, GpuBuffer& CountBuffer,
+    uint32_t CounterOffset, uint32_t NumBins, uint32_t Shift )
+{
+    ASSERT(Math::IsPowerOfTwo(NumBins) && NumBins <= kMaxBins, "Histograms have a power of two number of bins up to kMaxBins");
+    ASSERT(Output.GetElementCount() * Output.GetElementSize() >= NumBins * sizeof(uint32_t), "Histogram is too small for its bins");
+    ASSERT(Input.GetElementCount() <= kMaxElements, "List is too long for the GPU primitives dispatch");
+    ASSERT(&Input != &Output, "GPU primitives cannot read and write a list at once");
+
+    PrepareDispatchArgs(Context, CountBuffer, CounterOffset);
+
+    Context.TransitionResource(Input, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    Context.TransitionResource(Output, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, true);
+    Context.ClearUAV(Output);
+    Context.InsertUAVBarrier(Output);
+
+    Context.SetConstants(0, CounterOffset, 0, Shift, NumBins - 1);
+    Context.SetDynamicDescriptor(1, 0, Input.GetSRV());
+    Context.SetDynamicDescriptor(1, 1, Input.GetSRV());
+    Context.SetDynamicDescriptor(1, 2, CountBuffer.GetSRV());
+    Context.SetDynamicDescriptor(2, 0, Output.GetUAV());
+    Context.SetDynamicDescriptor(2, 1, s_BlockTotals.GetUAV());
+    Context.SetDynamicDescriptor(2, 2, s_BlockTotals.GetUAV());
+
+    Context.SetPipelineState(GetPSO(kHistogram));
+    Context.DispatchIndirect(s_DispatchArgs, 0);
+    Context.InsertUAVBarrier(Output);
+}
+
+static std::vector<uint32_t> ReadBack( ComputeContext& Context, GpuBuffer& Buffer, uint32_t Count )
+{
+    ReadbackBuffer Readback;
+    Readback.Create(L"GPU Primitives Readback", Count, sizeof(uint32_t));
+    Context.CopyBufferRegion(Readback, 0, Buffer, 0, Count * sizeof(uint32_t));
+    Context.Finish(true);
+
+    const uint32_t* Data = (const uint32_t*)Readback.Map();
+    std::vector<uint32_t> Result(Data, Data + Count);
+    Readback.Unmap();
+    return Result;
+}
+
+static std::vector<uint32_t> RandomList( uint32_t ListSize, int32_t MaxValue )
+{
+    std::vector<uint32_t> List(ListSize);
+    for (uint32_t& Value : List)
+        Value = (uint32_t)Math::g_RNG.NextInt(MaxValue);
+    return List;
+}
+
+static void TestScan( uint32_t ListSize )
+{
+    const std::vector<uint32_t> Values = RandomList(ListSize, 255);
+
+    ByteAddressBuffer Input, Output, Count, Total;
+    Input.Create(L"GPU Scan Input", ListSize, sizeof(uint32_t), Values.data());
+    Output.Create(L"GPU Scan Output", ListSize, sizeof(uint32_t));
+    Count.Create(L"GPU List Counter", 1, sizeof(uint32_t), &ListSize);
+    Total.Create(L"GPU Scan Total", 1, sizeof(uint32_t));
+
+    ComputeContext& Ctx = ComputeContext::Begin(L"GPU Scan Test");
+    GpuPrimitives::ExclusiveScan(Ctx, Input, Output, Count, 0, &Total, 0);
+    const std::vector<uint32_t> Result = ReadBack(Ctx, Output, ListSize);
+
+    ComputeContext& TotalCtx = ComputeContext::Begin(L"GPU Scan Test");
+    const uint32_t GpuTotal = ReadBack(TotalCtx, Total, 1)[0];
+
+    uint32_t Sum = 0;
+    for (uint32_t i = 0; i < ListSize; ++i)
+    {
+        ASSERT(Result[i] == Sum, "Invalid exclusive scan");
+        Sum += Values[i];
+    }
+    ASSERT(GpuTotal == Sum, "Invalid scan total");
+}
+
+static void TestCompact( uint32_t ListSize )
+{
+    const std::vector<uint32_t> Values = RandomList(ListSize, 0x7fffffff);
+    const std::vector<uint32_t> Flags = RandomList(ListSize, 1);
+
+    ByteAddressBuffer Input, FlagList, Output, Count, OutputCount;
+    Input.Create(L"GPU Compact Input", ListSize, sizeof(uint32_t), Values.data());
+    FlagList.Create(L"GPU Compact Flags", ListSize, sizeof(uint32_t), Flags.data());
+    Output.Create(L"GPU Compact Output", ListSize, sizeof(uint32_t));
+    Count.Create(L"GPU List Counter", 1, sizeof(uint32_t), &ListSize);
+    OutputCount.Create(L"GPU Compact Counter", 1, sizeof(uint32_t));
+
+    ComputeContext& Ctx = ComputeContext::Begin(L"GPU Compact Test");
+    GpuPrimitives::Compact(Ctx, Input, FlagList, Output, Count, 0, OutputCount, 0);
+    const std::vector<uint32_t> Result = ReadBack(Ctx, Output, ListSize);
+
+    ComputeContext& CountCtx = ComputeContext::Begin(L"GPU Compact Test");
+    const uint32_t GpuCount = ReadBack(CountCtx, OutputCount, 1)[0];
+
+    uint32_t Kept = 0;
+    for (uint32_t i = 0; i < ListSize; ++i)
+    {
+        if (Flags[i] != 0)
+        {
+            ASSERT(Result[Kept] == Values[i], "Invalid stream compaction");
+            ++Kept;
+        }
+    }
+    ASSERT(GpuCount == Kept, "Invalid stream compaction count");
+}
+
+static void TestSegmentedReduce( uint32_t ListSize, GpuPrimitives::ReduceOp Op )
+{
+    const std::vector<uint32_t> Values = RandomList(ListSize, 0x7fffffff);
+
+    // Segments of up to a few groups' worth of elements, with some empty ones
+    std::vector<uint32_t> Offsets(1, 0);
+    while (Offsets.back() < ListSize)
+        Offsets.push_back(std::min<uint32_t>(Offsets.back() + Math::g_RNG.NextInt(1000), ListSize));
+    uint32_t NumSegments = (uint32_t)Offsets.size() - 1;
+
+    ByteAddressBuffer Input, SegmentOffsets, Output, Count;
+    Input.Create(L"GPU Reduce Input", ListSize, sizeof(uint32_t), Values.data());
+    SegmentOffsets.Create(L"GPU Reduce Segments", NumSegments + 1, sizeof(uint32_t), Offsets.data());
+    Output.Create(L"GPU Reduce Output", std::max(NumSegments, 1u), sizeof(uint32_t));
+    Count.Create(L"GPU Segment Counter", 1, sizeof(uint32_t), &NumSegments);
+
+    ComputeContext& Ctx = ComputeContext::Begin(L"GPU Segmented Reduce Test");
+    GpuPrimitives::SegmentedReduce(Ctx, Input, SegmentOffsets, Output, Count, 0, Op);
+    const std::vector<uint32_t> Result = ReadBack(Ctx, Output, NumSegments);
+
+    for (uint32_t Segment = 0; Segment < NumSegments; ++Segment)
+    {
+        uint32_t Expected = Op == GpuPrimitives::kMin ? 0xffffffff : 0;
+        for (uint32_t i = Offsets[Segment]; i < Offsets[Segment + 1]; ++i)
+        {
+            if (Op == GpuPrimitives::kMin)
+                Expected = std::min(Expected, Values[i]);
+            else if (Op == GpuPrimitives::kMax)
+                Expected = std::max(Expected, Values[i]);
+            else
+                Expected += Values[i];
+        }
+        ASSERT(Result[Segment] == Expected, "Invalid segmented reduction");
+    }
+}
+
+static void TestHistogram( uint32_t ListSize, uint32_t NumBins, uint32_t Shift, bool bClustered )
+{
+    // Clustered lists give whole waves the same bin
+    std::vector<uint32_t> Values = RandomList(ListSize, 0x7fffffff);
+    if (bClustered)
+    {
+        for (uint32_t i = 0; i < ListSize; ++i)
+            Values[i] = (i / 100) << Shift;
+    }
+
+    ByteAddressBuffer Input, Output, Count;
+    Input.Create(L"GPU Histogram Input", ListSize, sizeof(uint32_t), Values.data());
+    Output.Create(L"GPU Histogram", NumBins, sizeof(uint32_t));
+    Count.Create(L"GPU List Counter", 1, sizeof(uint32_t), &ListSize);
+
+    ComputeContext& Ctx = ComputeContext::Begin(L"GPU Histogram Test");
+    GpuPrimitives::Histogram(Ctx, Input, Output, Count, 0, NumBins, Shift);
+    const std::vector<uint32_t> Result = ReadBack(Ctx, Output, NumBins);
+
+    std::vector<uint32_t> Expected(NumBins, 0);
+    for (uint32_t Value : Values)
+        ++Expected[(Value >> Shift) & (NumBins - 1)];
+
+    for (uint32_t Bin = 0; Bin < NumBins; ++Bin)
+        ASSERT(Result[Bin] == Expected[Bin], "Invalid histogram");
+}
+
+void GpuPrimitives::Test( void )
+{
+    // Lists of one partial block, of many blocks, and of block totals that scan in several rounds
+    const uint32_t ListSizes[] = { 1, 500, 2048, 2049, 100000, 1500000 };
+
+    const bool bUseWaveIntrinsics = UseWaveIntrinsics;
+
+    for (uint32_t Wave = 0; Wave < (s_WaveSupported ? 2u : 1u); ++Wave)
+    {
+        UseWaveIntrinsics = Wave != 0;
+
+        for (uint32_t ListSize : ListSizes)
+        {
+            TestScan(ListSize);
+            TestCompact(ListSize);
+            TestSegmentedReduce(ListSize, kSum);
+            TestSegmentedReduce(ListSize, kMin);
+            TestSegmentedReduce(ListSize, kMax);
+            TestHistogram(ListSize, 256, 0, false);
+            TestHistogram(ListSize, kMaxBins, 4, false);
+            TestHistogram(ListSize, 64, 2, true);
+        }
+    }
+
+    UseWaveIntrinsics = bUseWaveIntrinsics;
+}
+
+// Returns the milliseconds that Run takes on the GPU, averaged over a batch
+static double TimePrimitive( const std::function<void(ComputeContext&)>& Run )
+{
+    const uint32_t kNumIterations = 16;
+
+    // Warm up, so that the first dispatch pays for nothing the others do not
+    ComputeContext& WarmUp = ComputeContext::Begin(L"GPU Primitives Benchmark");
+    Run(WarmUp);
+    WarmUp.Finish(true);
+
+    ComputeContext& Ctx = ComputeContext::Begin(L"GPU Primitives Benchmark");
+    for (uint32_t i = 0; i < kNumIterations; ++i)
+        Run(Ctx);
+
+    const int64_t StartTick = SystemTime::GetCurrentTick();
+    Ctx.Finish(true);
+    const int64_t EndTick = SystemTime::GetCurrentTick();
+
+    return SystemTime::TimeBetweenTicks(StartTick, EndTick) * 1000.0 / kNumIterations;
+}
+
+static void PrintThroughput( const char* Name, uint32_t ListSize, double BytesPerElement, const double (&Times)[2], bool bWave )
+{
+    // Bytes are what each element costs read once and written once, so the rates compare with the memory bandwidth
+    Utility::Printf("%-18s %8u elements:  LDS %.3f ms (%.0f M/s, %.1f GB/s)", Name, ListSize,
+        Times[0], ListSize * 0.001 / Times[0], ListSize * BytesPerElement * 1e-6 / Times[0]);
+    if (bWave)
+    {
+        Utility::Printf(", wave %.3f ms (%.0f M/s, %.1f GB/s)",
+            Times[1], ListSize * 0.001 / Times[1], ListSize * BytesPerElement * 1e-6 / Times[1]);
+    }
+    Utility::Print("\n");
+}
+
+void GpuPrimitives::Benchmark( void )
+{
+    const bool bUseWaveIntrinsics = UseWaveIntrinsics;
+
+    for (uint32_t ListSize = 64 * 1024; ListSize <= kMaxElements; ListSize *= 4)
+    {
+        const std::vector<uint32_t> Values = RandomList(ListSize, 0x7fffffff);
+        const std::vector<uint32_t> Flags = RandomList(ListSize, 1);
+
+        // Segments of about a thousand elements
+        std::vector<uint32_t> Offsets(1, 0);
+        while (Offsets.back() < ListSize)
+            Offsets.push_back(std::min<uint32_t>(Offsets.back() + Math::g_RNG.NextInt(2000), ListSize));
+        const uint32_t NumSegments = (uint32_t)Offsets.size() - 1;
+
+        const uint32_t Counts[] = { ListSize, NumSegments };
+
+        ByteAddressBuffer Input, FlagList, SegmentOffsets, Output, Scratch, Count, Total;
+        Input.Create(L"GPU Primitives Input", ListSize, sizeof(uint32_t), Values.data());
+        FlagList.Create(L"GPU Primitives Flags", ListSize, sizeof(uint32_t), Flags.data());
+        SegmentOffsets.Create(L"GPU Primitives Segments", NumSegments + 1, sizeof(uint32_t), Offsets.data());
+        Output.Create(L"GPU Primitives Output", ListSize, sizeof(uint32_t));
+        Scratch.Create(L"GPU Primitives Scratch", ListSize, sizeof(uint32_t));
+        Count.Create(L"GPU Primitives Counters", 2, sizeof(uint32_t), Counts);
+        Total.Create(L"GPU Primitives Total", 1, sizeof(uint32_t));
+
+        double ScanTimes[2], CompactTimes[2], ReduceTimes[2], HistogramTimes[2], SortTimes[2];
+
+        for (uint32_t Wave = 0; Wave < (s_WaveSupported ? 2u : 1u); ++Wave)
+        {
+            UseWaveIntrinsics = Wave != 0;
+
+            ScanTimes[Wave] = TimePrimitive([&](ComputeContext& Ctx)
+                { ExclusiveScan(Ctx, Input, Output, Count, 0, &Total, 0); });
+            CompactTimes[Wave] = TimePrimitive([&](ComputeContext& Ctx)
+                { Compact(Ctx, Input, FlagList, Output, Count, 0, Total, 0); });
+            ReduceTimes[Wave] = TimePrimitive([&](ComputeContext& Ctx)
+                { SegmentedReduce(Ctx, Input, SegmentOffsets, Output, Count, 4, kSum); });
+            HistogramTimes[Wave] = TimePrimitive([&](ComputeContext& Ctx)
+                { Histogram(Ctx, Input, Output, Count, 0, 256, 0); });
+
+            // The sort has no wave path and is timed once.  Every pass leaves a sorted list, which sorts as fast.
+            if (Wave == 0)
+            {
+                SortTimes[0] = SortTimes[1] = TimePrimitive([&](ComputeContext& Ctx)
+                    { RadixSort::Sort(Ctx, Output, Scratch, Count, 0, true); });
+            }
+        }
+
+        // Compaction reads a flag and a value and writes half the values
+        PrintThroughput("Exclusive scan", ListSize, 8.0, ScanTimes, s_WaveSupported);
+        PrintThroughput("Stream compaction", ListSize, 10.0, CompactTimes, s_WaveSupported);
+        PrintThroughput("Segmented reduce", ListSize, 4.0, ReduceTimes, s_WaveSupported);
+        PrintThroughput("Histogram", ListSize, 4.0, HistogramTimes, s_WaveSupported);
+        PrintThroughput("Radix sort", ListSize, 8.0, SortTimes, false);
+    }
+
+    UseWaveIntrinsics = bUseWaveIntrinsics;
+}
@@ -0,0 +1,71 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Data parallel building blocks for lists of uints on the GPU:  prefix sums, stream compaction, segmented
+// reductions and histograms.  Sorting is RadixSort's and BitonicSort's.  Lists are read through raw views, as
+// ByteAddressBuffer has, and like the sorts, each takes the count of its items from a GPU buffer, so that
+// lists built on the GPU are processed without a read back.
+//
+// Scans and compaction run in three dispatches over blocks of 2048 elements:  the first sums each block, the
+// second scans the block totals in a single group, and the third scans each block again from its offset.  The
+// shaders have shader model 6 permutations that combine each wave's lanes with wave intrinsics, which are
+// used on adapters that run them once they have compiled.  Until then, and in builds without runtime shader
+// compilation, every group combines its threads in LDS.
+//
+
+#pragma once
+
+#include "GpuBuffer.h"
+
+class BoolVar;
+
+namespace GpuPrimitives
+{
+    // The block totals are allocated for lists of at most this many elements
+    enum { kMaxElements = 2048 * 4096 };
+
+    // Histograms count in LDS, which holds this many bins
+    enum { kMaxBins = 4096 };
+
+    enum ReduceOp { kSum, kMin, kMax };
+
+    extern BoolVar UseWaveIntrinsics;
+
+    // True on adapters that run wave intrinsics
+    bool IsWaveSupported( void );
+
+    // Writes the sum of the elements before each element of Input to the element of Output.  With a TotalBuffer,
+    // the sum of the whole list is also written to it at TotalOffset.
+    void ExclusiveScan( ComputeContext& Context, GpuBuffer& Input, GpuBuffer& Output, GpuBuffer& CountBuffer,
+        uint32_t CounterOffset, GpuBuffer* TotalBuffer = nullptr, uint32_t TotalOffset = 0 );
+
+    // Copies the elements of Input whose element of Flags is non-zero to the start of Output, in their order, and
+    // writes how many there are to OutputCount at OutputCountOffset
+    void Compact( ComputeContext& Context, GpuBuffer& Input, GpuBuffer& Flags, GpuBuffer& Output, GpuBuffer& CountBuffer,
+        uint32_t CounterOffset, GpuBuffer& OutputCount, uint32_t OutputCountOffset );
+
+    // Combines the elements of each segment of Input with Op and writes one result per segment to Output.  The
+    // count is that of the segments, and segment i spans the elements from SegmentOffsets[i] up to
+    // SegmentOffsets[i + 1], so there is one more offset than segments.  Each segment takes a group, which suits
+    // segments of hundreds of elements or more.  Empty segments are the identity of Op.
+    void SegmentedReduce( ComputeContext& Context, GpuBuffer& Input, GpuBuffer& SegmentOffsets, GpuBuffer& Output,
+        GpuBuffer& CountBuffer, uint32_t CounterOffset, ReduceOp Op );
+
+    // Clears Output and counts the elements of Input into NumBins bins, a power of two of at most kMaxBins.  An
+    // element goes to bin (Value >> Shift) & (NumBins - 1).
+    void Histogram( ComputeContext& Context, GpuBuffer& Input, GpuBuffer& Output, GpuBuffer& CountBuffer,
+        uint32_t CounterOffset, uint32_t NumBins, uint32_t Shift = 0 );
+
+    // Checks every primitive against the CPU, with and without wave intrinsics
+    void Test( void );
+
+    // Prints the throughput of every primitive and of the radix sort on the adapter, in elements and in GB of
+    // input read and output written per second, with and without wave intrinsics
+    void Benchmark( void );
+
+} // namespace GpuPrimitives
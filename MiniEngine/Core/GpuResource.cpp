@@ -0,0 +1,43 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "pch.h"
+#include "GpuResource.h"
+#include "GraphicsCore.h"
+#include "CommandListManager.h"
+
+void GpuResource::TrackResidency(void)
+{
+    D3DX12Residency::ResidencyManager* Manager = Graphics::g_CommandManager.GetResidencyManager();
+    if (Manager == nullptr)
+        return;
+
+    ASSERT(m_pResource != nullptr && !m_ResidencyHandle.IsInitialized());
+
+    D3D12_RESOURCE_DESC Desc = m_pResource->GetDesc();
+    D3D12_RESOURCE_ALLOCATION_INFO AllocInfo = Graphics::g_Device->GetResourceAllocationInfo(1, 1, &Desc);
+    m_ResidencyHandle.Initialize(m_pResource.Get(), AllocInfo.SizeInBytes);
+
+    // Render targets and depth buffers are rewritten every frame, so they are the last to be trimmed
+    m_ResidencyHandle.Priority = D3D12_RESIDENCY_PRIORITY_HIGH;
+    Manager->BeginTrackingObject(&m_ResidencyHandle);
+}
+
+void GpuResource::StopTrackingResidency(void)
+{
+    if (!m_ResidencyHandle.IsInitialized())
+        return;
+
+    // Resources destroyed after the manager shut down have nothing left to untrack
+    D3DX12Residency::ResidencyManager* Manager = Graphics::g_CommandManager.GetResidencyManager();
+    if (Manager != nullptr)
+        Manager->EndTrackingObject(&m_ResidencyHandle);
+
+    m_ResidencyHandle = D3DX12Residency::ManagedObject();
+}
@@ -38,6 +38,7 @@ public:
 
     virtual void Destroy()
     {
+        StopTrackingResidency();
         m_pResource = nullptr;
         m_GpuVirtualAddress = D3D12_GPU_VIRTUAL_ADDRESS_NULL;
         if (m_UserAllocatedMemory != nullptr)
@@ -57,6 +58,11 @@ public:
 
 protected:
 
+    // Hands a committed resource to the residency manager, which may evict it under memory pressure once no
+    // submitted work uses it.  Every context that uses it must then reference it, see CommandContext::ReferenceResource().
+    void TrackResidency(void);
+    void StopTrackingResidency(void);
+
     Microsoft::WRL::ComPtr<ID3D12Resource> m_pResource;
     D3D12_RESOURCE_STATES m_UsageState;
     D3D12_RESOURCE_STATES m_TransitioningState;
@@ -65,4 +71,6 @@ protected:
     // When using VirtualAlloc() to allocate memory directly, record the allocation here so that it can be freed.  The
     // GpuVirtualAddress may be offset from the true allocation start.
     void* m_UserAllocatedMemory;
+
+    D3DX12Residency::ManagedObject m_ResidencyHandle;
 };
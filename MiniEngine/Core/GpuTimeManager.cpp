@@ -16,25 +16,109 @@
 #include "GraphicsCore.h"
 #include "CommandContext.h"
 #include "CommandListManager.h"
+#include <algorithm>
 
 namespace
 {
-    ID3D12QueryHeap* sm_QueryHeap = nullptr;
-    ID3D12Resource* sm_ReadBackBuffer = nullptr;
-    uint64_t* sm_TimeStampBuffer = nullptr;
-    uint64_t sm_Fence = 0;
+    using namespace GpuTimeManager;
+
+    struct ReadBackFrame
+    {
+        ID3D12QueryHeap* QueryHeap;
+        ID3D12Resource* ReadBackBuffer;
+        uint64_t Fence;
+        bool Resolved;
+        bool ReadBack;          // BeginReadBack() has mapped it since it was resolved
+
+        // Pipeline statistics are only resolved for frames that gathered some
+        ID3D12QueryHeap* StatsHeap;
+        ID3D12Resource* StatsReadBackBuffer;
+        std::vector<uint8_t> StatsUsed;     // Whether each timer began a statistics query in the frame
+        bool AnyStats;
+        bool StatsResolved;
+    };
+
+    ReadBackFrame sm_Frames[kNumReadBackFrames] = {};
+    uint32_t sm_CurrentFrame = 0;           // The frame whose query heap timers write to
+    ReadBackFrame* sm_MappedFrame = nullptr;
+    const uint64_t* sm_TimeStampBuffer = nullptr;
+    const D3D12_QUERY_DATA_PIPELINE_STATISTICS* sm_StatsBuffer = nullptr;
+    std::vector<uint64_t> sm_NoTimeStamps;  // Read in place of a frame before any has been resolved
     uint32_t sm_MaxNumTimers = 0;
     uint32_t sm_NumTimers = 1;
     uint64_t sm_ValidTimeStart = 0;
     uint64_t sm_ValidTimeEnd = 0;
     double sm_GpuTickDelta = 0.0;
+    std::vector<float> sm_LastTimes;
+
+    // Each queue has its own time stamp clock.  Stamps written on the compute and copy queues are mapped onto
+    // the graphics queue's clock with the calibration of both against the CPU clock.
+    enum { kGraphicsQueue, kComputeQueue, kCopyQueue, kNumQueues };
+    double sm_TickScale[kNumQueues];
+    double sm_TickOffset[kNumQueues];
+    uint64_t sm_CalibrationGpuTime = 0;     // A graphics queue time stamp and the CPU tick it was taken at
+    int64_t sm_CalibrationCpuTime = 0;
+    double sm_GpuToCpuTicks = 0.0;
+    std::vector<uint8_t> sm_TimerQueue;     // The queue each timer was last started on
+
+    uint8_t GetQueueIndex(D3D12_COMMAND_LIST_TYPE Type)
+    {
+        switch (Type)
+        {
+        case D3D12_COMMAND_LIST_TYPE_COMPUTE: return kComputeQueue;
+        case D3D12_COMMAND_LIST_TYPE_COPY: return kCopyQueue;
+        default: return kGraphicsQueue;
+        }
+    }
+
+    // The timer's stamps on the graphics queue's clock
+    bool ReadTimer(uint32_t TimerIdx, uint64_t& TimeStamp1, uint64_t& TimeStamp2)
+    {
+        ASSERT(sm_TimeStampBuffer != nullptr, "Time stamp readback buffer is not mapped");
+        ASSERT(TimerIdx < sm_NumTimers, "Invalid GPU timer index");
+
+        TimeStamp1 = sm_TimeStampBuffer[TimerIdx * 2];
+        TimeStamp2 = sm_TimeStampBuffer[TimerIdx * 2 + 1];
+
+        const uint8_t Queue = sm_TimerQueue[TimerIdx];
+        if (Queue != kGraphicsQueue && TimeStamp2 > TimeStamp1)
+        {
+            TimeStamp1 = (uint64_t)(sm_TickOffset[Queue] + static_cast<double>(TimeStamp1) * sm_TickScale[Queue]);
+            TimeStamp2 = (uint64_t)(sm_TickOffset[Queue] + static_cast<double>(TimeStamp2) * sm_TickScale[Queue]);
+        }
+
+        return TimeStamp1 >= sm_ValidTimeStart && TimeStamp2 <= sm_ValidTimeEnd && TimeStamp2 > TimeStamp1;
+    }
+
+    typedef std::pair<uint64_t, uint64_t> TimeSpan;
+
+    // Sorted, disjoint spans covered by the valid timers of a set
+    void GetCoveredSpans(const uint32_t* TimerIdx, uint32_t NumTimers, std::vector<TimeSpan>& Spans)
+    {
+        std::vector<TimeSpan> Sorted;
+        Sorted.reserve(NumTimers);
+        for (uint32_t i = 0; i < NumTimers; ++i)
+        {
+            uint64_t TimeStamp1, TimeStamp2;
+            if (ReadTimer(TimerIdx[i], TimeStamp1, TimeStamp2))
+                Sorted.push_back(TimeSpan(TimeStamp1, TimeStamp2));
+        }
+        std::sort(Sorted.begin(), Sorted.end());
+
+        Spans.clear();
+        for (auto& Span : Sorted)
+        {
+            if (!Spans.empty() && Span.first <= Spans.back().second)
+                Spans.back().second = std::max(Spans.back().second, Span.second);
+            else
+                Spans.push_back(Span);
+        }
+    }
 }
 
 void GpuTimeManager::Initialize(uint32_t MaxNumTimers)
 {
-    uint64_t GpuFrequency;
-    Graphics::g_CommandManager.GetCommandQueue()->GetTimestampFrequency(&GpuFrequency);
-    sm_GpuTickDelta = 1.0 / static_cast<double>(GpuFrequency);
+    CalibrateClocks();
 
     D3D12_HEAP_PROPERTIES HeapProps;
     HeapProps.Type = D3D12_HEAP_TYPE_READBACK;
@@ -56,27 +140,111 @@ void GpuTimeManager::Initialize(uint32_t MaxNumTimers)
     BufferDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
     BufferDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
 
-    ASSERT_SUCCEEDED(Graphics::g_Device->CreateCommittedResource( &HeapProps, D3D12_HEAP_FLAG_NONE, &BufferDesc,
-        D3D12_RESOURCE_STATE_COPY_DEST, nullptr, MY_IID_PPV_ARGS(&sm_ReadBackBuffer) ));
-    sm_ReadBackBuffer->SetName(L"GpuTimeStamp Buffer");
-
     D3D12_QUERY_HEAP_DESC QueryHeapDesc;
     QueryHeapDesc.Count = MaxNumTimers * 2;
     QueryHeapDesc.NodeMask = 1;
     QueryHeapDesc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
-    ASSERT_SUCCEEDED(Graphics::g_Device->CreateQueryHeap(&QueryHeapDesc, MY_IID_PPV_ARGS(&sm_QueryHeap)));
-    sm_QueryHeap->SetName(L"GpuTimeStamp QueryHeap");
+
+    D3D12_RESOURCE_DESC StatsBufferDesc = BufferDesc;
+    StatsBufferDesc.Width = sizeof(D3D12_QUERY_DATA_PIPELINE_STATISTICS) * MaxNumTimers;
+
+    D3D12_QUERY_HEAP_DESC StatsHeapDesc;
+    StatsHeapDesc.Count = MaxNumTimers;
+    StatsHeapDesc.NodeMask = 1;
+    StatsHeapDesc.Type = D3D12_QUERY_HEAP_TYPE_PIPELINE_STATISTICS;
+
+    for (ReadBackFrame& Frame : sm_Frames)
+    {
+        ASSERT_SUCCEEDED(Graphics::g_Device->CreateCommittedResource( &HeapProps, D3D12_HEAP_FLAG_NONE, &BufferDesc,
+            D3D12_RESOURCE_STATE_COPY_DEST, nullptr, MY_IID_PPV_ARGS(&Frame.ReadBackBuffer) ));
+        Frame.ReadBackBuffer->SetName(L"GpuTimeStamp Buffer");
+
+        ASSERT_SUCCEEDED(Graphics::g_Device->CreateQueryHeap(&QueryHeapDesc, MY_IID_PPV_ARGS(&Frame.QueryHeap)));
+        Frame.QueryHeap->SetName(L"GpuTimeStamp QueryHeap");
+
+        ASSERT_SUCCEEDED(Graphics::g_Device->CreateCommittedResource( &HeapProps, D3D12_HEAP_FLAG_NONE, &StatsBufferDesc,
+            D3D12_RESOURCE_STATE_COPY_DEST, nullptr, MY_IID_PPV_ARGS(&Frame.StatsReadBackBuffer) ));
+        Frame.StatsReadBackBuffer->SetName(L"Pipeline Statistics Buffer");
+
+        ASSERT_SUCCEEDED(Graphics::g_Device->CreateQueryHeap(&StatsHeapDesc, MY_IID_PPV_ARGS(&Frame.StatsHeap)));
+        Frame.StatsHeap->SetName(L"Pipeline Statistics QueryHeap");
+
+        Frame.Fence = 0;
+        Frame.Resolved = false;
+        Frame.ReadBack = false;
+        Frame.StatsUsed.assign(MaxNumTimers, 0);
+        Frame.AnyStats = false;
+        Frame.StatsResolved = false;
+    }
+    sm_CurrentFrame = 0;
 
     sm_MaxNumTimers = (uint32_t)MaxNumTimers;
+    sm_LastTimes.resize(MaxNumTimers, 0.0f);
+    sm_TimerQueue.resize(MaxNumTimers, kGraphicsQueue);
+    sm_NoTimeStamps.resize(MaxNumTimers * 2, 0);
 }
 
 void GpuTimeManager::Shutdown()
 {
-    if (sm_ReadBackBuffer != nullptr)
-        sm_ReadBackBuffer->Release();
+    for (ReadBackFrame& Frame : sm_Frames)
+    {
+        if (Frame.ReadBackBuffer != nullptr)
+            Frame.ReadBackBuffer->Release();
+
+        if (Frame.QueryHeap != nullptr)
+            Frame.QueryHeap->Release();
+
+        if (Frame.StatsReadBackBuffer != nullptr)
+            Frame.StatsReadBackBuffer->Release();
+
+        if (Frame.StatsHeap != nullptr)
+            Frame.StatsHeap->Release();
+
+        Frame = ReadBackFrame();
+    }
+}
+
+void GpuTimeManager::CalibrateClocks(void)
+{
+    LARGE_INTEGER CpuFrequency;
+    QueryPerformanceFrequency(&CpuFrequency);
+
+    ID3D12CommandQueue* GraphicsQueue = Graphics::g_CommandManager.GetGraphicsQueue().GetCommandQueue();
+    uint64_t GraphicsFrequency, GraphicsGpuTime, GraphicsCpuTime;
+    GraphicsQueue->GetTimestampFrequency(&GraphicsFrequency);
+    GraphicsQueue->GetClockCalibration(&GraphicsGpuTime, &GraphicsCpuTime);
+    sm_GpuTickDelta = 1.0 / static_cast<double>(GraphicsFrequency);
 
-    if (sm_QueryHeap != nullptr)
-        sm_QueryHeap->Release();
+    sm_CalibrationGpuTime = GraphicsGpuTime;
+    sm_CalibrationCpuTime = (int64_t)GraphicsCpuTime;
+    sm_GpuToCpuTicks = static_cast<double>(CpuFrequency.QuadPart) / static_cast<double>(GraphicsFrequency);
+
+    sm_TickScale[kGraphicsQueue] = 1.0;
+    sm_TickOffset[kGraphicsQueue] = 0.0;
+
+    const D3D12_COMMAND_LIST_TYPE Types[] = { D3D12_COMMAND_LIST_TYPE_COMPUTE, D3D12_COMMAND_LIST_TYPE_COPY };
+    for (D3D12_COMMAND_LIST_TYPE Type : Types)
+    {
+        const uint8_t Queue = GetQueueIndex(Type);
+        ID3D12CommandQueue* CommandQueue = Graphics::g_CommandManager.GetQueue(Type).GetCommandQueue();
+
+        // Copy queues need not support time stamps, and then their timers are left unscaled
+        uint64_t Frequency, GpuTime, CpuTime;
+        if (FAILED(CommandQueue->GetTimestampFrequency(&Frequency)) ||
+            FAILED(CommandQueue->GetClockCalibration(&GpuTime, &CpuTime)))
+        {
+            sm_TickScale[Queue] = 1.0;
+            sm_TickOffset[Queue] = 0.0;
+            continue;
+        }
+
+        // Graphics ticks = GraphicsGpuTime + (Ticks - GpuTime) * Scale + the CPU time between calibrations
+        const double Scale = static_cast<double>(GraphicsFrequency) / static_cast<double>(Frequency);
+        const double CpuDelta = static_cast<double>((int64_t)(CpuTime - GraphicsCpuTime)) / CpuFrequency.QuadPart;
+        sm_TickScale[Queue] = Scale;
+        sm_TickOffset[Queue] = static_cast<double>(GraphicsGpuTime) - static_cast<double>(GpuTime) * Scale +
+            CpuDelta * static_cast<double>(GraphicsFrequency);
+    }
 }
 
 uint32_t GpuTimeManager::NewTimer(void)
@@ -86,22 +254,98 @@ uint32_t GpuTimeManager::NewTimer(void)
 
 void GpuTimeManager::StartTimer(CommandContext& Context, uint32_t TimerIdx)
 {
-    Context.InsertTimeStamp(sm_QueryHeap, TimerIdx * 2);
+    sm_TimerQueue[TimerIdx] = GetQueueIndex(Context.GetType());
+    Context.InsertTimeStamp(sm_Frames[sm_CurrentFrame].QueryHeap, TimerIdx * 2);
 }
 
 void GpuTimeManager::StopTimer(CommandContext& Context, uint32_t TimerIdx)
 {
-    Context.InsertTimeStamp(sm_QueryHeap, TimerIdx * 2 + 1);
+    Context.InsertTimeStamp(sm_Frames[sm_CurrentFrame].QueryHeap, TimerIdx * 2 + 1);
+}
+
+void GpuTimeManager::BeginPipelineStats(CommandContext& Context, uint32_t TimerIdx)
+{
+    if (Context.GetType() != D3D12_COMMAND_LIST_TYPE_DIRECT)
+        return;
+
+    ReadBackFrame& Frame = sm_Frames[sm_CurrentFrame];
+    Frame.StatsUsed[TimerIdx] = 1;
+    Frame.AnyStats = true;
+    Context.GetGraphicsContext().BeginQuery(Frame.StatsHeap, D3D12_QUERY_TYPE_PIPELINE_STATISTICS, TimerIdx);
+}
+
+void GpuTimeManager::EndPipelineStats(CommandContext& Context, uint32_t TimerIdx)
+{
+    if (Context.GetType() != D3D12_COMMAND_LIST_TYPE_DIRECT)
+        return;
+
+    Context.GetGraphicsContext().EndQuery(sm_Frames[sm_CurrentFrame].StatsHeap, D3D12_QUERY_TYPE_PIPELINE_STATISTICS, TimerIdx);
 }
 
-void GpuTimeManager::BeginReadBack(void)
+void GpuTimeManager::ResolveTimeStamps(CommandContext& Context)
 {
-    Graphics::g_CommandManager.WaitForFence(sm_Fence);
+    ReadBackFrame& Frame = sm_Frames[sm_CurrentFrame];
+    Context.InsertTimeStamp(Frame.QueryHeap, 1);
+    Context.ResolveTimeStamps(Frame.ReadBackBuffer, Frame.QueryHeap, sm_NumTimers * 2);
+
+    Frame.StatsResolved = Frame.AnyStats;
+    if (Frame.AnyStats)
+        Context.ResolvePipelineStatistics(Frame.StatsReadBackBuffer, Frame.StatsHeap, sm_NumTimers);
+
+    // The next frame starts as soon as this one has been resolved
+    sm_CurrentFrame = (sm_CurrentFrame + 1) % kNumReadBackFrames;
+    ReadBackFrame& NextFrame = sm_Frames[sm_CurrentFrame];
+    if (NextFrame.AnyStats)
+    {
+        std::fill(NextFrame.StatsUsed.begin(), NextFrame.StatsUsed.end(), (uint8_t)0);
+        NextFrame.AnyStats = false;
+    }
+    Context.InsertTimeStamp(NextFrame.QueryHeap, 0);
+}
+
+void GpuTimeManager::SetResolveFence(uint64_t FenceValue)
+{
+    ReadBackFrame& Frame = sm_Frames[(sm_CurrentFrame + kNumReadBackFrames - 1) % kNumReadBackFrames];
+    Frame.Fence = FenceValue;
+    Frame.Resolved = true;
+    Frame.ReadBack = false;
+}
+
+bool GpuTimeManager::BeginReadBack(void)
+{
+    // Take the latest frame the GPU has resolved.  The one written right now is the oldest, so it is last.
+    sm_MappedFrame = nullptr;
+    for (uint32_t i = 1; i <= kNumReadBackFrames; ++i)
+    {
+        ReadBackFrame& Frame = sm_Frames[(sm_CurrentFrame + kNumReadBackFrames - i) % kNumReadBackFrames];
+        if (Frame.Resolved && Graphics::g_CommandManager.IsFenceComplete(Frame.Fence))
+        {
+            sm_MappedFrame = &Frame;
+            break;
+        }
+    }
 
-    D3D12_RANGE Range;
-    Range.Begin = 0;
-    Range.End = (sm_NumTimers * 2) * sizeof(uint64_t);
-    ASSERT_SUCCEEDED(sm_ReadBackBuffer->Map(0, &Range, reinterpret_cast<void**>(&sm_TimeStampBuffer)));
+    bool NewFrame = false;
+    if (sm_MappedFrame != nullptr)
+    {
+        NewFrame = !sm_MappedFrame->ReadBack;
+        sm_MappedFrame->ReadBack = true;
+
+        D3D12_RANGE Range;
+        Range.Begin = 0;
+        Range.End = (sm_NumTimers * 2) * sizeof(uint64_t);
+        ASSERT_SUCCEEDED(sm_MappedFrame->ReadBackBuffer->Map(0, &Range, (void**)&sm_TimeStampBuffer));
+
+        if (sm_MappedFrame->StatsResolved)
+        {
+            Range.End = sm_NumTimers * sizeof(D3D12_QUERY_DATA_PIPELINE_STATISTICS);
+            ASSERT_SUCCEEDED(sm_MappedFrame->StatsReadBackBuffer->Map(0, &Range, (void**)&sm_StatsBuffer));
+        }
+    }
+    else
+    {
+        sm_TimeStampBuffer = sm_NoTimeStamps.data();
+    }
 
     sm_ValidTimeStart = sm_TimeStampBuffer[0];
     sm_ValidTimeEnd = sm_TimeStampBuffer[1];
@@ -112,32 +356,98 @@ void GpuTimeManager::BeginReadBack(void)
         sm_ValidTimeStart = 0ull;
         sm_ValidTimeEnd = 0ull;
     }
+
+    for (uint32_t i = 0; i < sm_NumTimers; ++i)
+        sm_LastTimes[i] = GetTime(i);
+
+    return NewFrame;
 }
 
 void GpuTimeManager::EndReadBack(void)
 {
     // Unmap with an empty range to indicate nothing was written by the CPU
-    D3D12_RANGE EmptyRange = {};
-    sm_ReadBackBuffer->Unmap(0, &EmptyRange);
+    if (sm_MappedFrame != nullptr)
+    {
+        D3D12_RANGE EmptyRange = {};
+        sm_MappedFrame->ReadBackBuffer->Unmap(0, &EmptyRange);
+        if (sm_StatsBuffer != nullptr)
+            sm_MappedFrame->StatsReadBackBuffer->Unmap(0, &EmptyRange);
+        sm_MappedFrame = nullptr;
+    }
     sm_TimeStampBuffer = nullptr;
-
-    CommandContext& Context = CommandContext::Begin();
-    Context.InsertTimeStamp(sm_QueryHeap, 1);
-    Context.ResolveTimeStamps(sm_ReadBackBuffer, sm_QueryHeap, sm_NumTimers * 2);
-    Context.InsertTimeStamp(sm_QueryHeap, 0);
-    sm_Fence = Context.Finish();
+    sm_StatsBuffer = nullptr;
 }
 
 float GpuTimeManager::GetTime(uint32_t TimerIdx)
 {
-    ASSERT(sm_TimeStampBuffer != nullptr, "Time stamp readback buffer is not mapped");
+    uint64_t TimeStamp1, TimeStamp2;
+    if (!ReadTimer(TimerIdx, TimeStamp1, TimeStamp2))
+        return 0.0f;
+
+    return static_cast<float>(sm_GpuTickDelta * (TimeStamp2 - TimeStamp1));
+}
+
+bool GpuTimeManager::GetTimerTicks(uint32_t TimerIdx, int64_t& StartTick, int64_t& EndTick)
+{
+    uint64_t TimeStamp1, TimeStamp2;
+    if (!ReadTimer(TimerIdx, TimeStamp1, TimeStamp2))
+        return false;
+
+    StartTick = sm_CalibrationCpuTime + (int64_t)(static_cast<double>((int64_t)(TimeStamp1 - sm_CalibrationGpuTime)) * sm_GpuToCpuTicks);
+    EndTick = sm_CalibrationCpuTime + (int64_t)(static_cast<double>((int64_t)(TimeStamp2 - sm_CalibrationGpuTime)) * sm_GpuToCpuTicks);
+    return true;
+}
+
+bool GpuTimeManager::GetPipelineStats(uint32_t TimerIdx, D3D12_QUERY_DATA_PIPELINE_STATISTICS& Stats)
+{
     ASSERT(TimerIdx < sm_NumTimers, "Invalid GPU timer index");
 
-    uint64_t TimeStamp1 = sm_TimeStampBuffer[TimerIdx * 2];
-    uint64_t TimeStamp2 = sm_TimeStampBuffer[TimerIdx * 2 + 1];
+    if (sm_StatsBuffer == nullptr || sm_MappedFrame->StatsUsed[TimerIdx] == 0)
+        return false;
 
-    if (TimeStamp1 < sm_ValidTimeStart || TimeStamp2 > sm_ValidTimeEnd || TimeStamp2 <= TimeStamp1 )
-        return 0.0f;
+    Stats = sm_StatsBuffer[TimerIdx];
+    return true;
+}
 
-    return static_cast<float>(sm_GpuTickDelta * (TimeStamp2 - TimeStamp1));
+float GpuTimeManager::GetLastTime(uint32_t TimerIdx)
+{
+    ASSERT(TimerIdx < sm_NumTimers, "Invalid GPU timer index");
+    return sm_LastTimes[TimerIdx];
+}
+
+float GpuTimeManager::GetCoveredTime(const uint32_t* TimerIdx, uint32_t NumTimers)
+{
+    std::vector<TimeSpan> Spans;
+    GetCoveredSpans(TimerIdx, NumTimers, Spans);
+
+    uint64_t Ticks = 0;
+    for (auto& Span : Spans)
+        Ticks += Span.second - Span.first;
+
+    return static_cast<float>(sm_GpuTickDelta * Ticks);
+}
+
+float GpuTimeManager::GetOverlappedTime(const uint32_t* TimerIdxA, uint32_t NumTimersA, const uint32_t* TimerIdxB, uint32_t NumTimersB)
+{
+    std::vector<TimeSpan> SpansA, SpansB;
+    GetCoveredSpans(TimerIdxA, NumTimersA, SpansA);
+    GetCoveredSpans(TimerIdxB, NumTimersB, SpansB);
+
+    // Walk both sorted lists, advancing whichever span ends first
+    uint64_t Ticks = 0;
+    size_t a = 0, b = 0;
+    while (a < SpansA.size() && b < SpansB.size())
+    {
+        uint64_t Start = std::max(SpansA[a].first, SpansB[b].first);
+        uint64_t End = std::min(SpansA[a].second, SpansB[b].second);
+        if (End > Start)
+            Ticks += End - Start;
+
+        if (SpansA[a].second < SpansB[b].second)
+            ++a;
+        else
+            ++b;
+    }
+
+    return static_cast<float>(sm_GpuTickDelta * Ticks);
 }
@@ -19,9 +19,16 @@ class CommandContext;
 
 namespace GpuTimeManager
 {
+    // Each frame in flight writes its own query heap and reads back into its own buffer
+    const uint32_t kNumReadBackFrames = 3;
+
     void Initialize( uint32_t MaxNumTimers = 4096 );
     void Shutdown();
 
+    // Measures the time stamp clock of every queue against the CPU clock.  The clocks drift apart slowly, so
+    // this is worth repeating before a capture that lines GPU work up with the CPU.
+    void CalibrateClocks(void);
+
     // Reserve a unique timer index
     uint32_t NewTimer(void);
 
@@ -29,11 +36,44 @@ namespace GpuTimeManager
     void StartTimer(CommandContext& Context, uint32_t TimerIdx);
     void StopTimer(CommandContext& Context, uint32_t TimerIdx);
 
+    // Appends the resolve of the frame's time stamps to the frame's last command list, whose fence must then be
+    // passed to SetResolveFence().  Timers started afterward are counted in the next frame.
+    void ResolveTimeStamps(CommandContext& Context);
+    void SetResolveFence(uint64_t FenceValue);
+
     // Bookend all calls to GetTime() with Begin/End which correspond to Map/Unmap.  This
-    // needs to happen either at the very start or very end of a frame.
-    void BeginReadBack(void);
+    // needs to happen either at the very start or very end of a frame.  The times are those of the latest
+    // frame the GPU has finished, and nothing waits on the GPU while it is still behind.  Returns false when that
+    // frame was read back already.
+    bool BeginReadBack(void);
     void EndReadBack(void);
 
     // Returns the time in milliseconds between start and stop queries
     float GetTime(uint32_t TimerIdx);
+
+    // Returns the start and stop of a timer in SystemTime ticks, so that GPU work lines up with the CPU.  Like
+    // GetTime(), this must be called between Begin/EndReadBack.  Fails when the timer did not run that frame.
+    bool GetTimerTicks(uint32_t TimerIdx, int64_t& StartTick, int64_t& EndTick);
+
+    // Counts the work of the graphics queue between the two calls with a pipeline statistics query, which is read
+    // back with the timer's time stamps.  Both calls must be made on the same command list, and contexts of other
+    // queues are skipped.
+    void BeginPipelineStats(CommandContext& Context, uint32_t TimerIdx);
+    void EndPipelineStats(CommandContext& Context, uint32_t TimerIdx);
+
+    // Like GetTime(), this must be called between Begin/EndReadBack.  Fails when the timer gathered no statistics
+    // that frame.
+    bool GetPipelineStats(uint32_t TimerIdx, D3D12_QUERY_DATA_PIPELINE_STATISTICS& Stats);
+
+    // Returns the time captured by the most recent read back.  Unlike GetTime(), this may be called
+    // at any point in the frame.  Results lag the frame that recorded them by up to kNumReadBackFrames frames.
+    float GetLastTime(uint32_t TimerIdx);
+
+    // Returns the time in milliseconds during which at least one of the timers was running, so nested or
+    // overlapping timers count once.  Like GetTime(), this must be called between Begin/EndReadBack.
+    float GetCoveredTime(const uint32_t* TimerIdx, uint32_t NumTimers);
+
+    // Returns the time in milliseconds during which timers of both sets were running, e.g. to measure how
+    // much work on one queue overlapped another.  Queues are assumed to share a time stamp clock.
+    float GetOverlappedTime(const uint32_t* TimerIdxA, uint32_t NumTimersA, const uint32_t* TimerIdxB, uint32_t NumTimersB);
 }
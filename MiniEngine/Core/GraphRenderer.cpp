@@ -20,10 +20,12 @@
 #include "GameInput.h"
 #include "SystemTime.h"
 #include "EngineProfiling.h"
+#include "GpuBuffer.h"
 
 #include "CompiledShaders/PerfGraphBackgroundVS.h"
 #include "CompiledShaders/PerfGraphVS.h"
 #include "CompiledShaders/PerfGraphPS.h"
+#include "CompiledShaders/PerfGraphUpdateCS.h"
 
 #define PERF_GRAPH_ERROR uint32_t(0xFFFFFFFF)
 #define MAX_GLOBAL_GRAPHS 2
@@ -31,21 +33,54 @@
 #define MAX_ACTIVE_PROFILE_GRAPHS 4
 #define PROFILE_NODE_COUNT 256
 #define GLOBAL_NODE_COUNT 512
+#define PACING_NODE_COUNT 512
 #define PROFILE_DEBUG_VAR_COUNT 2
+#define MAX_GRAPH_INSTANCES (MAX_ACTIVE_PROFILE_GRAPHS * PROFILE_DEBUG_VAR_COUNT)
+#define HISTORY_SIZE (MAX_PROFILE_GRAPHS * PROFILE_DEBUG_VAR_COUNT * PROFILE_NODE_COUNT + \
+    MAX_GLOBAL_GRAPHS * GLOBAL_NODE_COUNT + 2 * PACING_NODE_COUNT)
+#define MAX_PENDING_SAMPLES 4096
 
 using namespace Graphics;
 using namespace std;
 using namespace GraphRenderer;
 using namespace Math;
 
-__declspec(align(16)) struct CBGraph
-{    
+// One line graph in the instanced draw.  The transform takes the graph's viewport to the overlay.
+struct GraphInstance
+{
+    float Transform[4];
     float RGB[3];
-    float RcpXScale;
+    float RcpYScale;
+    uint32_t HistoryOffset;
     uint32_t NodeCount;
     uint32_t FrameID;
+    float RcpXScale;
+};
+
+__declspec(align(16)) struct CBGraphBatch
+{
+    GraphInstance Graphs[MAX_GRAPH_INSTANCES];
 };
 
+// Every graph keeps its samples in one GPU history buffer, at an offset handed out when the graph is created.
+// Only the samples recorded since the graphs were last rendered are uploaded, and a compute shader scatters
+// them into place.
+struct HistorySample
+{
+    uint32_t Index;
+    float Value;
+};
+
+namespace
+{
+    StructuredBuffer s_HistoryBuffer;
+    std::vector<HistorySample> s_PendingSamples;
+    uint32_t s_HistoryUsed = 0;
+    bool s_HistoryIsStale = true;   // Upload every graph in full instead of the pending samples
+    CBGraphBatch s_GraphBatch;
+    uint32_t s_GraphBatchCount = 0;
+}
+
 class GraphVector;
 
 class PerfGraph
@@ -53,10 +88,21 @@ class PerfGraph
 friend GraphVector;
 public:
     PerfGraph( uint32_t NodeCount, uint32_t debugVarCount, Color color = Color(1.0f, 0.0f, 0.5f), bool IsGraphed = false ) : m_IsGraphed(IsGraphed), 
-        m_NodeCount(NodeCount), m_Color(color), m_DebugVarCount(debugVarCount)
+        m_NodeCount(NodeCount), m_Color(color), m_DebugVarCount(debugVarCount), m_HistoryOffset(s_HistoryUsed)
     {
         for (uint32_t i = 0; i < debugVarCount; ++i)        
+        {
             m_PerfTimesCPUBuffer.emplace_back(new float[NodeCount]);
+            memset(m_PerfTimesCPUBuffer.back().get(), 0, sizeof(float) * NodeCount);
+        }
+
+        s_HistoryUsed += NodeCount * debugVarCount;
+        s_HistoryIsStale = true;
+    }
+
+    static bool HistoryHasRoom( uint32_t NodeCount, uint32_t debugVarCount )
+    {
+        return s_HistoryUsed + NodeCount * debugVarCount <= HISTORY_SIZE;
     }
 
     ~PerfGraph()
@@ -70,25 +116,26 @@ public:
     void SetColor(Color color){m_Color = color;}
     void UpdateGraph( float* timeStamps, uint32_t frameID )
     {
+        const uint32_t Node = frameID % m_NodeCount;
+
         for(uint32_t i = 0; i < m_DebugVarCount; i++)
-            m_PerfTimesCPUBuffer[i][frameID % m_NodeCount] = timeStamps[i];
+        {
+            m_PerfTimesCPUBuffer[i][Node] = timeStamps[i];
+
+            // While the graphs go unrendered the samples pile up, so past a point resend everything instead
+            if (s_PendingSamples.size() < MAX_PENDING_SAMPLES)
+                s_PendingSamples.push_back({ m_HistoryOffset + i * m_NodeCount + Node, timeStamps[i] });
+            else
+                s_HistoryIsStale = true;
+        }
     }     
 
-    //RenderGraph renders both graph backgrounds and line graphs 
-    //
-    //To render backgrounds, set s_GraphBackgroundPSO, set primitive topology to triangle strip, 
-    //call RenderGraph without an object and with MaxArray = nullptr.  
-    //
-    //To render line graph, set s_RenderPerfGraphPSO, set primitive topology to line strip,
-    //call RenderGraph on an associated PerfGraph object, and pass in MaxArray
+    // Renders graph backgrounds.  Set s_GraphBackgroundPSO and the triangle strip topology first.
     static void RenderGraph( GraphicsContext& Context, uint32_t vertexCount, D3D12_VIEWPORT& viewport,
         uint32_t debugVarCount, float topMargin);
 
-    void RenderGraph(GraphicsContext& Context, uint32_t vertexCount, D3D12_VIEWPORT& viewport,
-        uint32_t debugVarCount, float topMargin, float MaxValue, uint32_t frameID);
-
-    void RenderGraph(GraphicsContext& Context, uint32_t vertexCount, D3D12_VIEWPORT& viewport,
-        uint32_t debugVarCount, float topMargin, const float* MaxArray, uint32_t frameID);
+    // Adds the line graphs of this object to the batch that DrawGraphBatch() renders in one instanced draw
+    void BatchGraph( D3D12_VIEWPORT viewport, uint32_t debugVarCount, float topMargin, const float* MaxArray, uint32_t frameID );
 
 private:
     std::vector<std::unique_ptr<float[]>> m_PerfTimesCPUBuffer;
@@ -97,6 +144,7 @@ private:
     Color m_Color;
     uint32_t m_ColorKey;
     uint32_t m_DebugVarCount;
+    uint32_t m_HistoryOffset;
 };
 
 
@@ -240,6 +288,19 @@ public:
 
     }
 
+    // Copies every graph's history to the GPU
+    void UploadHistory( CommandContext& Context )
+    {
+        for (auto& Graph : m_Graphs)
+        {
+            for (uint32_t i = 0; i < Graph->m_DebugVarCount; ++i)
+            {
+                Context.WriteBuffer(s_HistoryBuffer, sizeof(float) * (Graph->m_HistoryOffset + i * Graph->m_NodeCount),
+                    Graph->m_PerfTimesCPUBuffer[i].get(), sizeof(float) * Graph->m_NodeCount);
+            }
+        }
+    }
+
     std::vector<std::unique_ptr<PerfGraph>> m_Graphs; // this should be private
 
 private:
@@ -267,8 +328,11 @@ namespace
     RootSignature s_RootSignature;
     GraphicsPSO s_RenderPerfGraphPSO;
     GraphicsPSO s_GraphBackgroundPSO;
+    ComputePSO s_HistoryUpdatePSO;
     uint32_t s_FrameID;
+    uint32_t s_PacingFrameID = 0;   // Pacing graphs are updated every frame, even while they are not rendered
     GraphVector GlobalGraphs = GraphVector(2, 1);
+    GraphVector PacingGraphs = GraphVector(2, 1);
     GraphVector ProfileGraphs = GraphVector(MAX_ACTIVE_PROFILE_GRAPHS, PROFILE_DEBUG_VAR_COUNT);
     uint32_t s_NumStamps = 0;
     uint32_t s_SelectedTimerIndex;
@@ -284,6 +348,7 @@ namespace
 
 static void DrawGraphHeaders(TextContext& Text, float leftMargin, float topMargin, float offsetY, float graphHeight, float* MinArray, 
     float* MaxArray, float* PresetMaxArray, bool GlobalScale,  uint32_t numDebugVar, std::string graphTitles[]);
+static void DrawGraphBatch(GraphicsContext& Context, uint32_t vertexCount);
 
 
 void GraphRenderer::Initialize( void )
@@ -291,7 +356,7 @@ void GraphRenderer::Initialize( void )
     s_RootSignature.Reset(4);
     s_RootSignature[0].InitAsConstantBuffer(0);
     s_RootSignature[1].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 0, 2);
-    s_RootSignature[2].InitAsBufferSRV(0, D3D12_SHADER_VISIBILITY_VERTEX);
+    s_RootSignature[2].InitAsBufferSRV(0);
     s_RootSignature[3].InitAsConstants(1, 3);
     s_RootSignature.Finalize(L"Graph Renderer");
 
@@ -310,6 +375,13 @@ void GraphRenderer::Initialize( void )
     s_GraphBackgroundPSO.SetVertexShader(g_pPerfGraphBackgroundVS, sizeof(g_pPerfGraphBackgroundVS));
     s_GraphBackgroundPSO.Finalize();
 
+    s_HistoryUpdatePSO.SetRootSignature(s_RootSignature);
+    s_HistoryUpdatePSO.SetComputeShader(g_pPerfGraphUpdateCS, sizeof(g_pPerfGraphUpdateCS));
+    s_HistoryUpdatePSO.Finalize();
+
+    s_HistoryBuffer.Create(L"Perf Graph History", HISTORY_SIZE, sizeof(float));
+    s_PendingSamples.reserve(MAX_PENDING_SAMPLES);
+
     s_FrameID = 0;
 
     // Preset max for global and profile graphs
@@ -325,20 +397,38 @@ void GraphRenderer::Initialize( void )
 
     float globalPresetMax[1] = {15.0f};
     GlobalGraphs.PresetMax(globalPresetMax); 
+
+    // Create present interval and input to photon graphs
+    for (uint32_t i = 0; i < 2; ++i)
+    {
+        InitGraph( GraphType::Pacing );
+        PacingGraphs.m_Graphs[i]->SetColor(i == 0 ? Color(0.3f, 1.0f, 0.3f) : Color(1.0f, 0.8f, 0.2f));
+    }
+
+    float pacingPresetMax[1] = {50.0f};
+    PacingGraphs.PresetMax(pacingPresetMax);
 }
 
 void GraphRenderer::Shutdown(void)
 {
     ProfileGraphs.Clear();
     GlobalGraphs.Clear();
+    PacingGraphs.Clear();
+
+    s_HistoryBuffer.Destroy();
+    s_PendingSamples.clear();
+    s_HistoryUsed = 0;
+    s_HistoryIsStale = true;
 }
 
 GraphHandle GraphRenderer::InitGraph( GraphType type)
 {
-    if (type == GraphType::Profile)
+    if (type == GraphType::Profile && PerfGraph::HistoryHasRoom(PROFILE_NODE_COUNT, 2))
         return ProfileGraphs.AddGraph(new PerfGraph(PROFILE_NODE_COUNT, 2));
-    else if (type == GraphType::Global)
+    else if (type == GraphType::Global && PerfGraph::HistoryHasRoom(GLOBAL_NODE_COUNT, 1))
         return GlobalGraphs.AddGraph(new PerfGraph(GLOBAL_NODE_COUNT, 1));
+    else if (type == GraphType::Pacing && PerfGraph::HistoryHasRoom(PACING_NODE_COUNT, 1))
+        return PacingGraphs.AddGraph(new PerfGraph(PACING_NODE_COUNT, 1));
     else
         return PERF_GRAPH_ERROR; 
 }
@@ -378,6 +468,16 @@ void GraphRenderer::Update( XMFLOAT2 InputNode, GraphHandle GraphID, GraphType T
             ProfileGraphs.ManageMax(times, PROFILE_NODE_COUNT, s_FrameID);
         }
     }
+    else if (Type == GraphType::Pacing)
+    {
+        // A frame whose photon time is not known yet is left out of the range
+        PacingGraphs.m_Graphs[0]->UpdateGraph(&InputNode.x, s_PacingFrameID);
+        PacingGraphs.m_Graphs[1]->UpdateGraph(&InputNode.y, s_PacingFrameID);
+        PacingGraphs.ManageMax(&InputNode.x, PACING_NODE_COUNT, s_PacingFrameID);
+        if (InputNode.y > 0.0f)
+            PacingGraphs.ManageMax(&InputNode.y, PACING_NODE_COUNT, s_PacingFrameID);
+        ++s_PacingFrameID;
+    }
     else // Type == PerfGraph::Global
     {
         GlobalGraphs.m_Graphs[0]->UpdateGraph(&InputNode.x, s_FrameID);
@@ -425,8 +525,54 @@ void DrawGraphHeaders(TextContext& Text, float leftMargin, float topMargin, floa
     }
 }
 
+// Unlike the other graphs, these scroll with s_PacingFrameID, so rendering them does not advance s_FrameID
+static void RenderPacingGraphs(GraphicsContext& Context)
+{
+    if (PacingGraphs.Size() == 0)
+        return;
+
+    TextContext Text(Context);
+    Text.Begin();
+
+    D3D12_VIEWPORT viewport;
+    viewport.TopLeftX = (float)g_OverlayBuffer.GetWidth() / 4.0f;
+    viewport.TopLeftY = (float)g_OverlayBuffer.GetHeight() / 1.3f;
+    viewport.Width = (float)g_OverlayBuffer.GetWidth() / 2.0f;
+    viewport.Height = (float)g_OverlayBuffer.GetHeight() / 8.0f;
+    viewport.MinDepth = 0.0f;
+    viewport.MaxDepth = 1.0f;
+
+    float blankSpace = viewport.Height / 8.0f;
+    XMFLOAT2 textSpace = XMFLOAT2(45.0f, 5.0f);
+    std::string graphTitles[] = { "Present - Photon (ms)   " };
+    DrawGraphHeaders( Text, (viewport.TopLeftX), blankSpace,  (viewport.TopLeftY - blankSpace - textSpace.y), (viewport.Height + blankSpace),
+                                    PacingGraphs.GetMinAbs(), PacingGraphs.GetMaxAbs(), PacingGraphs.GetPresetMax(), true, 1, graphTitles);
+    Text.Flush();
+
+    Context.SetRootSignature(s_RootSignature);
+    Context.TransitionResource(g_OverlayBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET);
+    Context.SetRenderTarget(g_OverlayBuffer.GetRTV());
+    Context.SetPipelineState(s_GraphBackgroundPSO);
+    Context.SetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
+
+    PerfGraph::RenderGraph(Context, 4, viewport, 1, 0.0f);
+
+    for (auto iter = PacingGraphs.m_Graphs.begin(); iter != PacingGraphs.m_Graphs.end(); ++iter)
+        (*iter)->BatchGraph(viewport, 1, 0.0f, PacingGraphs.GetPresetMax(), s_PacingFrameID);
+    DrawGraphBatch(Context, PACING_NODE_COUNT);
+
+    Text.End();
+    Context.SetViewport(0, 0, 1920, 1080);
+}
+
 void GraphRenderer::RenderGraphs(GraphicsContext& Context, GraphType Type)
 {
+    if (Type == GraphType::Pacing)
+    {
+        RenderPacingGraphs(Context);
+        return;
+    }
+
     if (Type == GraphType::Global && GlobalGraphs.Size() == 0 ||
         Type == GraphType::Profile && ProfileGraphs.Size() == 0)
     {
@@ -452,6 +598,7 @@ void GraphRenderer::RenderGraphs(GraphicsContext& Context, GraphType Type)
         XMFLOAT2 textSpace = XMFLOAT2(45.0f, 5.0f);
         DrawGraphHeaders(Text, (viewport.TopLeftX),  blankSpace, 0.0f, (viewport.Height + blankSpace), ProfileGraphs.GetMin(), 
             ProfileGraphs.GetMax(), ProfileGraphs.GetPresetMax(), false, PROFILE_DEBUG_VAR_COUNT, graphTitles);
+        Text.Flush();
         
         Context.SetRootSignature(s_RootSignature);
         Context.TransitionResource(g_OverlayBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET);
@@ -461,17 +608,14 @@ void GraphRenderer::RenderGraphs(GraphicsContext& Context, GraphType Type)
 
         // Render backgrounds
         PerfGraph::RenderGraph(Context, 4, viewport, PROFILE_DEBUG_VAR_COUNT, blankSpace);
-        Context.SetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_LINESTRIP);
         viewport.TopLeftY = 0.0f;
     
         for (auto iter = ProfileGraphs.m_Graphs.begin(); iter != ProfileGraphs.m_Graphs.end(); ++iter)
         {
             if ((*iter)->IsGraphed())
-            {
-                (*iter)->RenderGraph(Context, 256, viewport, PROFILE_DEBUG_VAR_COUNT, blankSpace, ProfileGraphs.GetPresetMax(), s_FrameID);
-                viewport.TopLeftY = 0.0f;
-            }
+                (*iter)->BatchGraph(viewport, PROFILE_DEBUG_VAR_COUNT, blankSpace, ProfileGraphs.GetPresetMax(), s_FrameID);
         }
+        DrawGraphBatch(Context, PROFILE_NODE_COUNT);
     }
     else if (Type == GraphType::Global)
     {
@@ -488,6 +632,7 @@ void GraphRenderer::RenderGraphs(GraphicsContext& Context, GraphType Type)
         std::string graphTitles[] = { "CPU - GPU      " };
         DrawGraphHeaders( Text, (viewport.TopLeftX), blankSpace,  (viewport.TopLeftY - blankSpace - textSpace.y), (viewport.Height + blankSpace), 
                                         GlobalGraphs.GetMinAbs(), GlobalGraphs.GetMaxAbs(), GlobalGraphs.GetPresetMax(), true, 1, graphTitles);
+        Text.Flush();
 
         Context.SetRootSignature(s_RootSignature);
         Context.TransitionResource(g_OverlayBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET);
@@ -499,11 +644,9 @@ void GraphRenderer::RenderGraphs(GraphicsContext& Context, GraphType Type)
         PerfGraph::RenderGraph(Context, 4, viewport, 1, 0.0f);
     
         // Render graphs
-        Context.SetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_LINESTRIP);
         for (auto iter = GlobalGraphs.m_Graphs.begin(); iter != GlobalGraphs.m_Graphs.end(); ++iter)
-        {
-            (*iter)->RenderGraph(Context, 512, viewport, 1, 0.0f, GlobalGraphs.GetPresetMax(), s_FrameID);
-        }
+            (*iter)->BatchGraph(viewport, 1, 0.0f, GlobalGraphs.GetPresetMax(), s_FrameID);
+        DrawGraphBatch(Context, GLOBAL_NODE_COUNT);
     }
     s_FrameID++;
     Text.End();
@@ -536,53 +679,72 @@ void PerfGraph::RenderGraph(GraphicsContext& Context, uint32_t vertexCount, D3D1
     }
 }
 
-void PerfGraph::RenderGraph(GraphicsContext& Context, uint32_t vertexCount, D3D12_VIEWPORT& viewport, uint32_t debugVarCount, float topMargin, float YScale, uint32_t frameID)
+void PerfGraph::BatchGraph( D3D12_VIEWPORT viewport, uint32_t debugVarCount, float topMargin, const float* MaxArray, uint32_t frameID )
 {
+    ASSERT(MaxArray != nullptr);
     viewport.TopLeftY += topMargin;
 
-    CBGraph graphConstants;
-    graphConstants.RGB[0] = m_Color.R();
-    graphConstants.RGB[1] = m_Color.G();
-    graphConstants.RGB[2] = m_Color.B();
-    graphConstants.RcpXScale = 2.0f / m_NodeCount;
-    graphConstants.NodeCount = m_NodeCount;
-    graphConstants.FrameID = frameID;
-    Context.SetDynamicConstantBufferView(0, sizeof(CBGraph), &graphConstants);
-    Context.SetPipelineState(s_RenderPerfGraphPSO);
+    const float RcpWidth = 1.0f / g_OverlayBuffer.GetWidth();
+    const float RcpHeight = 1.0f / g_OverlayBuffer.GetHeight();
 
     for (uint32_t i = 0; i < debugVarCount; ++i)
     {
-        Context.SetDynamicSRV(2, sizeof(float) * m_NodeCount, m_PerfTimesCPUBuffer[i].get());
-        Context.SetConstants(3, i, 1.0f / YScale);
-        Context.SetViewport(viewport);
-        Context.Draw(vertexCount);
+        ASSERT(s_GraphBatchCount < MAX_GRAPH_INSTANCES);
+        if (s_GraphBatchCount == MAX_GRAPH_INSTANCES)
+            return;
+
+        GraphInstance& Graph = s_GraphBatch.Graphs[s_GraphBatchCount++];
+        Graph.Transform[0] = viewport.Width * RcpWidth;
+        Graph.Transform[1] = viewport.Height * RcpHeight;
+        Graph.Transform[2] = (2.0f * viewport.TopLeftX + viewport.Width) * RcpWidth - 1.0f;
+        Graph.Transform[3] = 1.0f - (2.0f * viewport.TopLeftY + viewport.Height) * RcpHeight;
+        Graph.RGB[0] = m_Color.R();
+        Graph.RGB[1] = m_Color.G();
+        Graph.RGB[2] = m_Color.B();
+        Graph.RcpYScale = 1.0f / MaxArray[i];
+        Graph.HistoryOffset = m_HistoryOffset + i * m_NodeCount;
+        Graph.NodeCount = m_NodeCount;
+        Graph.FrameID = frameID;
+        Graph.RcpXScale = 2.0f / m_NodeCount;
+
         if (debugVarCount > 1)
             viewport.TopLeftY += viewport.Height + topMargin;
     }
 }
 
-void PerfGraph::RenderGraph( GraphicsContext& Context, uint32_t vertexCount, D3D12_VIEWPORT& viewport, uint32_t debugVarCount, float topMargin, const float* MaxArray, uint32_t frameID)
+// Brings the GPU history up to date and draws every batched line graph in one instanced draw
+static void DrawGraphBatch( GraphicsContext& Context, uint32_t vertexCount )
 {
-    ASSERT(MaxArray != nullptr);
-    viewport.TopLeftY += topMargin;
-
-    CBGraph graphConstants;
-    graphConstants.RGB[0] = m_Color.R();
-    graphConstants.RGB[1] = m_Color.G();
-    graphConstants.RGB[2] = m_Color.B();
-    graphConstants.RcpXScale = 2.0f / m_NodeCount;
-    graphConstants.NodeCount = m_NodeCount;
-    graphConstants.FrameID = frameID;
-    Context.SetDynamicConstantBufferView(0, sizeof(CBGraph), &graphConstants);
-    Context.SetPipelineState(s_RenderPerfGraphPSO);
-    
-    for (uint32_t i = 0; i < debugVarCount; ++i)
+    if (s_HistoryIsStale)
     {
-        Context.SetDynamicSRV(2, sizeof(float) * m_NodeCount, m_PerfTimesCPUBuffer[i].get());
-        Context.SetConstants(3, i, 1.0f / MaxArray[i]);
-        Context.SetViewport(viewport);
-        Context.Draw(vertexCount);
-        if (debugVarCount > 1)
-            viewport.TopLeftY += viewport.Height + topMargin;
+        ProfileGraphs.UploadHistory(Context);
+        GlobalGraphs.UploadHistory(Context);
+        PacingGraphs.UploadHistory(Context);
+        s_PendingSamples.clear();
+        s_HistoryIsStale = false;
+    }
+    else if (!s_PendingSamples.empty())
+    {
+        ComputeContext& Compute = Context.GetComputeContext();
+        Compute.SetRootSignature(s_RootSignature);
+        Compute.SetPipelineState(s_HistoryUpdatePSO);
+        Compute.TransitionResource(s_HistoryBuffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, true);
+        Compute.SetConstants(3, (uint32_t)s_PendingSamples.size());
+        Compute.SetDynamicSRV(2, sizeof(HistorySample) * s_PendingSamples.size(), s_PendingSamples.data());
+        Compute.SetDynamicDescriptor(1, 0, s_HistoryBuffer.GetUAV());
+        Compute.Dispatch1D(s_PendingSamples.size(), 64);
+        s_PendingSamples.clear();
     }
+
+    if (s_GraphBatchCount == 0)
+        return;
+
+    Context.TransitionResource(s_HistoryBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, true);
+    Context.SetPipelineState(s_RenderPerfGraphPSO);
+    Context.SetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_LINESTRIP);
+    Context.SetDynamicConstantBufferView(0, sizeof(GraphInstance) * s_GraphBatchCount, &s_GraphBatch);
+    Context.SetBufferSRV(2, s_HistoryBuffer);
+    Context.SetViewport(0.0f, 0.0f, (float)g_OverlayBuffer.GetWidth(), (float)g_OverlayBuffer.GetHeight());
+    Context.DrawInstanced(vertexCount, s_GraphBatchCount);
+    s_GraphBatchCount = 0;
 }
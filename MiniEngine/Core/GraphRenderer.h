@@ -18,7 +18,7 @@ namespace GraphRenderer
     void Initialize();
     void Shutdown();
 
-    enum class GraphType { Global, Profile };
+    enum class GraphType { Global, Profile, Pacing };
     typedef uint32_t GraphHandle;
 
     bool ManageGraphs( GraphHandle graphID, GraphType Type );
@@ -46,6 +46,9 @@ namespace Graphics
     D3D12_RASTERIZER_DESC RasterizerShadow;
     D3D12_RASTERIZER_DESC RasterizerShadowCW;
     D3D12_RASTERIZER_DESC RasterizerShadowTwoSided;
+    D3D12_RASTERIZER_DESC RasterizerShadowD32;
+    D3D12_RASTERIZER_DESC RasterizerShadowD32CW;
+    D3D12_RASTERIZER_DESC RasterizerShadowD32TwoSided;
 
     D3D12_BLEND_DESC BlendNoColorWrite;
     D3D12_BLEND_DESC BlendDisable;
@@ -70,6 +73,18 @@ namespace BitonicSort
     void Shutdown(void);
 }
 
+namespace RadixSort
+{
+    void Initialize(void);
+    void Shutdown(void);
+}
+
+namespace GpuPrimitives
+{
+    void Initialize(void);
+    void Shutdown(void);
+}
+
 void Graphics::InitializeCommonState(void)
 {
     SamplerLinearWrapDesc.Filter = D3D12_FILTER_MIN_MAG_MIP_LINEAR;
@@ -144,6 +159,18 @@ void Graphics::InitializeCommonState(void)
     RasterizerShadowCW = RasterizerShadow;
     RasterizerShadowCW.FrontCounterClockwise = FALSE;
 
+    // For float depth the constant bias is in units of 2^(exponent - 23) rather than 2^-16, so it is
+    // scaled up to push casters near the light (depth in [0.5, 1)) back by about the same distance.
+    // Farther from the light the bias shrinks along with the depth spacing.
+    RasterizerShadowD32 = RasterizerShadow;
+    RasterizerShadowD32.DepthBias = RasterizerShadow.DepthBias * 256;
+
+    RasterizerShadowD32TwoSided = RasterizerShadowD32;
+    RasterizerShadowD32TwoSided.CullMode = D3D12_CULL_MODE_NONE;
+
+    RasterizerShadowD32CW = RasterizerShadowD32;
+    RasterizerShadowD32CW.FrontCounterClockwise = FALSE;
+
     DepthStateDisabled.DepthEnable = FALSE;
     DepthStateDisabled.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ZERO;
     DepthStateDisabled.DepthFunc = D3D12_COMPARISON_FUNC_ALWAYS;
@@ -204,6 +231,8 @@ void Graphics::InitializeCommonState(void)
     DrawIndirectCommandSignature.Finalize();
 
     BitonicSort::Initialize();
+    RadixSort::Initialize();
+    GpuPrimitives::Initialize();
 }
 
 void Graphics::DestroyCommonState(void)
@@ -212,4 +241,6 @@ void Graphics::DestroyCommonState(void)
     DrawIndirectCommandSignature.Destroy();
     
     BitonicSort::Shutdown();
+    RadixSort::Shutdown();
+    GpuPrimitives::Shutdown();
 }
@@ -45,6 +45,9 @@ namespace Graphics
     extern D3D12_RASTERIZER_DESC RasterizerShadow;
     extern D3D12_RASTERIZER_DESC RasterizerShadowCW;
     extern D3D12_RASTERIZER_DESC RasterizerShadowTwoSided;
+    extern D3D12_RASTERIZER_DESC RasterizerShadowD32;        // Same biases as above, scaled for D32_FLOAT shadow maps
+    extern D3D12_RASTERIZER_DESC RasterizerShadowD32CW;
+    extern D3D12_RASTERIZER_DESC RasterizerShadowD32TwoSided;
 
     extern D3D12_BLEND_DESC BlendNoColorWrite;        // XXX
     extern D3D12_BLEND_DESC BlendDisable;            // 1, 0
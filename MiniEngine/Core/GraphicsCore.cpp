@@ -30,6 +30,16 @@
 #include "ParticleEffectManager.h"
 #include "GraphRenderer.h"
 #include "TemporalEffects.h"
+#include "TextureConverter.h"
+#include "SinglePassDownsample.h"
+#include "UploadRing.h"
+#include "AsyncReadback.h"
+#include "GpuMemoryPool.h"
+#include "GameInput.h"
+#include "FramePacing.h"
+#include "DynamicResolution.h"
+#include "JobSystem.h"
+#include "StartupProfile.h"
 
 // This macro determines whether to detect if there is an HDR display and enable HDR10 output.
 // Currently, with HDR display enabled, the pixel magnfication functionality is broken.
@@ -66,8 +76,10 @@
 #include "CompiledShaders/GenerateMipsGammaOddCS.h"
 #include "CompiledShaders/GenerateMipsGammaOddXCS.h"
 #include "CompiledShaders/GenerateMipsGammaOddYCS.h"
+#include "CompiledShaders/GenerateMipsBatchCS.h"
 
 #define SWAP_CHAIN_BUFFER_COUNT 3
+#define SWAP_CHAIN_FLAGS (DXGI_SWAP_CHAIN_FLAG_ALLOW_MODE_SWITCH | DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT)
 
 DXGI_FORMAT SwapChainFormat = DXGI_FORMAT_R10G10B10A2_UNORM;
 
@@ -91,6 +103,7 @@ namespace
     float s_FrameTime = 0.0f;
     uint64_t s_FrameIndex = 0;
     int64_t s_FrameStartTick = 0;
+    int64_t s_LatencyWaitTicks = 0;
 
     BoolVar s_LimitTo30Hz("Timing/Limit To 30Hz", false);
     BoolVar s_DropRandomFrames("Timing/Drop Random Frames", false);
@@ -115,8 +128,15 @@ namespace Graphics
 
     BoolVar s_EnableVSync("Timing/VSync", true);
 
+    // Frames the CPU may queue ahead of the display.  Fewer frames lower input latency, more absorb hitches.
+    IntVar s_MaxFrameLatency("Timing/Max Frame Latency", 2, 1, SWAP_CHAIN_BUFFER_COUNT);
+    int32_t s_AppliedFrameLatency = 0;
+    HANDLE s_FrameLatencyWaitable = nullptr;
+
     bool g_bTypedUAVLoadSupport_R11G11B10_FLOAT = false;
     bool g_bTypedUAVLoadSupport_R16G16B16A16_FLOAT = false;
+    bool g_bVariableRateShadingTier2 = false;
+    uint32_t g_ShadingRateTileSize = 0;
     bool g_bEnableHDROutput = false;
     NumVar g_HDRPaperWhite("Graphics/Display/Paper White (nits)", 200.0f, 100.0f, 500.0f, 50.0f);
     NumVar g_MaxDisplayLuminance("Graphics/Display/Peak Brightness (nits)", 1000.0f, 500.0f, 10000.0f, 100.0f);
@@ -129,6 +149,30 @@ namespace Graphics
     uint32_t g_DisplayHeight = 1080;
     ColorBuffer g_PreDisplayBuffer;
 
+    // The subsystems that only build pipelines and buffers of their own initialize as jobs, each timed
+    struct SubsystemInit
+    {
+        const char* Name;
+        void (*Initialize)(void);
+        double Seconds;
+    };
+
+    SubsystemInit s_Subsystems[] =
+    {
+        { "TemporalEffects", TemporalEffects::Initialize },
+        { "PostEffects", PostEffects::Initialize },
+        { "SSAO", SSAO::Initialize },
+        { "TextRenderer", TextRenderer::Initialize },
+        { "GraphRenderer", GraphRenderer::Initialize },
+        { "ParticleEffects", [] { ParticleEffects::Initialize(kMaxNativeWidth, kMaxNativeHeight); } },
+    };
+
+    JobSystem::Counter s_SubsystemJobs;
+    bool s_SubsystemsPending = false;
+    int64_t s_InitializeStartTick = 0;
+    double s_InitializeSeconds = 0.0;
+    int64_t s_SubsystemsStartTick = 0;
+
     void SetNativeResolution(void)
     {
         uint32_t NativeWidth, NativeHeight;
@@ -187,6 +231,15 @@ namespace Graphics
 
     IDXGISwapChain1* s_SwapChain1 = nullptr;
 
+    // A lost device is recreated by GameCore after the frame that found it.  The factory tells when adapters
+    // come and go, such as an external GPU being unplugged before the device notices.
+    ComPtr<IDXGIFactory4> s_DxgiFactory;
+    bool s_DeviceLost = false;
+    HRESULT s_DeviceLostReason = S_OK;
+    BoolVar s_SimulateDeviceLost("Graphics/Simulate Device Lost", false);
+
+    void CheckForDeviceLost( HRESULT PresentResult );
+
     DescriptorAllocator g_DescriptorAllocator[D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES] =
     {
         D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV,
@@ -208,6 +261,8 @@ namespace Graphics
     RootSignature g_GenerateMipsRS;
     ComputePSO g_GenerateMipsLinearPSO[4];
     ComputePSO g_GenerateMipsGammaPSO[4];
+    RootSignature g_GenerateMipsBatchRS;
+    ComputePSO g_GenerateMipsBatchPSO;
 
     enum { kBilinear, kBicubic, kSharpening, kFilterCount };
     const char* FilterLabels[] = { "Bilinear", "Bicubic", "Sharpening" };
@@ -220,6 +275,9 @@ namespace Graphics
     enum DebugZoomLevel { kDebugZoomOff, kDebugZoom2x, kDebugZoom4x, kDebugZoom8x, kDebugZoom16x, kDebugZoomCount };
     const char* DebugZoomLabels[] = { "Off", "2x Zoom", "4x Zoom", "8x Zoom", "16x Zoom" };
     EnumVar DebugZoom("Graphics/Display/Magnify Pixels", kDebugZoomOff, kDebugZoomCount, DebugZoomLabels);
+
+    BoolVar s_FuseFinalPass("Graphics/Display/Fuse Final Pass", true);
+    bool s_DisplayWritten = false;
 }
 
 void Graphics::Resize(uint32_t width, uint32_t height)
@@ -238,7 +296,7 @@ void Graphics::Resize(uint32_t width, uint32_t height)
     for (uint32_t i = 0; i < SWAP_CHAIN_BUFFER_COUNT; ++i)
         g_DisplayPlane[i].Destroy();
 
-    ASSERT_SUCCEEDED(s_SwapChain1->ResizeBuffers(SWAP_CHAIN_BUFFER_COUNT, width, height, SwapChainFormat, 0));
+    ASSERT_SUCCEEDED(s_SwapChain1->ResizeBuffers(SWAP_CHAIN_BUFFER_COUNT, width, height, SwapChainFormat, SWAP_CHAIN_FLAGS));
 
     for (uint32_t i = 0; i < SWAP_CHAIN_BUFFER_COUNT; ++i)
     {
@@ -295,6 +353,18 @@ void Graphics::Initialize(void)
 {
     ASSERT(s_SwapChain1 == nullptr, "Graphics has already been initialized");
 
+    s_InitializeStartTick = SystemTime::GetCurrentTick();
+
+    // A recreated device may be on an adapter with other features
+    s_DeviceLost = false;
+    s_DeviceLostReason = S_OK;
+    g_bTypedUAVLoadSupport_R11G11B10_FLOAT = false;
+    g_bTypedUAVLoadSupport_R16G16B16A16_FLOAT = false;
+    g_bVariableRateShadingTier2 = false;
+    g_ShadingRateTileSize = 0;
+    g_bEnableHDROutput = false;
+    g_CurrentBuffer = 0;
+
     Microsoft::WRL::ComPtr<ID3D12Device> pDevice;
 
 #if _DEBUG
@@ -310,6 +380,7 @@ void Graphics::Initialize(void)
     // Obtain the DXGI factory
     Microsoft::WRL::ComPtr<IDXGIFactory4> dxgiFactory;
     ASSERT_SUCCEEDED(CreateDXGIFactory2(0, MY_IID_PPV_ARGS(&dxgiFactory)));
+    s_DxgiFactory = dxgiFactory;
 
     // Create the D3D graphics device
     Microsoft::WRL::ComPtr<IDXGIAdapter1> pAdapter;
@@ -319,6 +390,7 @@ void Graphics::Initialize(void)
     if (!bUseWarpDriver)
     {
         SIZE_T MaxSize = 0;
+        Microsoft::WRL::ComPtr<IDXGIAdapter1> pBestAdapter;
 
         for (uint32_t Idx = 0; DXGI_ERROR_NOT_FOUND != dxgiFactory->EnumAdapters1(Idx, &pAdapter); ++Idx)
         {
@@ -332,9 +404,11 @@ void Graphics::Initialize(void)
                 pAdapter->GetDesc1(&desc);
                 Utility::Printf(L"D3D12-capable hardware found:  %s (%u MB)\n", desc.Description, desc.DedicatedVideoMemory >> 20);
                 MaxSize = desc.DedicatedVideoMemory;
+                pBestAdapter = pAdapter;
             }
         }
 
+        pAdapter = pBestAdapter;
         if (MaxSize > 0)
             g_Device = pDevice.Detach();
     }
@@ -451,7 +525,30 @@ void Graphics::Initialize(void)
         }
     }
 
-    g_CommandManager.Create(g_Device);
+    // Tier 2 adds the screen space image of shading rates, with a tile size the hardware chooses
+    D3D12_FEATURE_DATA_D3D12_OPTIONS6 Options6 = {};
+    if (SUCCEEDED(g_Device->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS6, &Options6, sizeof(Options6))) &&
+        Options6.VariableShadingRateTier >= D3D12_VARIABLE_SHADING_RATE_TIER_2)
+    {
+        g_bVariableRateShadingTier2 = true;
+        g_ShadingRateTileSize = Options6.ShadingRateImageTileSize;
+    }
+
+    // Residency is managed against the budget of the adapter the device was created on
+    Microsoft::WRL::ComPtr<IDXGIAdapter3> pAdapter3;
+    pAdapter.As(&pAdapter3);
+    g_CommandManager.Create(g_Device, pAdapter3.Get());
+    StartupProfile::Record(StartupProfile::kDeviceCreation, s_InitializeStartTick, SystemTime::GetCurrentTick());
+    DynamicDescriptorHeap::Initialize();
+    GpuMemoryPool::Initialize();
+
+    // Pipelines compiled by earlier launches are loaded from the cache instead of compiled again
+    {
+        StartupProfile::ScopedSpan Span(StartupProfile::kPipelineLibraryLoad);
+        PSO::LoadPipelineCache(L"Cache/PipelineLibrary.bin");
+    }
+
+    const int64_t SwapChainTick = SystemTime::GetCurrentTick();
 
     DXGI_SWAP_CHAIN_DESC1 swapChainDesc = {};
     swapChainDesc.Width = g_DisplayWidth;
@@ -460,16 +557,34 @@ void Graphics::Initialize(void)
     swapChainDesc.Scaling = DXGI_SCALING_NONE;
     swapChainDesc.SampleDesc.Quality = 0;
     swapChainDesc.SampleDesc.Count = 1;
-    swapChainDesc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
+    swapChainDesc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT | DXGI_USAGE_UNORDERED_ACCESS;
     swapChainDesc.BufferCount = SWAP_CHAIN_BUFFER_COUNT;
-    swapChainDesc.Flags = DXGI_SWAP_CHAIN_FLAG_ALLOW_MODE_SWITCH;
+    swapChainDesc.Flags = SWAP_CHAIN_FLAGS;
     swapChainDesc.SwapEffect = DXGI_SWAP_EFFECT_FLIP_SEQUENTIAL;
 
+    // Unordered access lets the last post-processing pass write the back buffer.  Without it, Present copies.
+    for (;;)
+    {
 #if WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_DESKTOP) // Win32
-    ASSERT_SUCCEEDED(dxgiFactory->CreateSwapChainForHwnd(g_CommandManager.GetCommandQueue(), GameCore::g_hWnd, &swapChainDesc, nullptr, nullptr, &s_SwapChain1));
+        HRESULT hr = dxgiFactory->CreateSwapChainForHwnd(g_CommandManager.GetCommandQueue(), GameCore::g_hWnd, &swapChainDesc, nullptr, nullptr, &s_SwapChain1);
 #else // UWP
-    ASSERT_SUCCEEDED(dxgiFactory->CreateSwapChainForCoreWindow(g_CommandManager.GetCommandQueue(), (IUnknown*)GameCore::g_window.Get(), &swapChainDesc, nullptr, &s_SwapChain1));
+        HRESULT hr = dxgiFactory->CreateSwapChainForCoreWindow(g_CommandManager.GetCommandQueue(), (IUnknown*)GameCore::g_window.Get(), &swapChainDesc, nullptr, &s_SwapChain1);
 #endif
+        if (SUCCEEDED(hr) || swapChainDesc.BufferUsage == DXGI_USAGE_RENDER_TARGET_OUTPUT)
+        {
+            ASSERT_SUCCEEDED(hr);
+            break;
+        }
+        swapChainDesc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
+    }
+
+    {
+        ComPtr<IDXGISwapChain2> swapChain2;
+        ASSERT_SUCCEEDED(s_SwapChain1->QueryInterface(MY_IID_PPV_ARGS(&swapChain2)));
+        s_AppliedFrameLatency = s_MaxFrameLatency;
+        ASSERT_SUCCEEDED(swapChain2->SetMaximumFrameLatency((UINT)s_AppliedFrameLatency));
+        s_FrameLatencyWaitable = swapChain2->GetFrameLatencyWaitableObject();
+    }
 
 #if CONDITIONALLY_ENABLE_HDR_OUTPUT && defined(NTDDI_WIN10_RS2) && (NTDDI_VERSION >= NTDDI_WIN10_RS2)
     {
@@ -499,13 +614,14 @@ void Graphics::Initialize(void)
         ASSERT_SUCCEEDED(s_SwapChain1->GetBuffer(i, MY_IID_PPV_ARGS(&DisplayPlane)));
         g_DisplayPlane[i].CreateFromSwapChain(L"Primary SwapChain Buffer", DisplayPlane.Detach());
     }
+    StartupProfile::Record(StartupProfile::kSwapChainCreation, SwapChainTick, SystemTime::GetCurrentTick());
 
     // Common state was moved to GraphicsCommon.*
     InitializeCommonState();
 
     s_PresentRS.Reset(4, 2);
     s_PresentRS[0].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 0, 2);
-    s_PresentRS[1].InitAsConstants(0, 6, D3D12_SHADER_VISIBILITY_ALL);
+    s_PresentRS[1].InitAsConstants(0, 10, D3D12_SHADER_VISIBILITY_ALL);
     s_PresentRS[2].InitAsBufferSRV(2, D3D12_SHADER_VISIBILITY_PIXEL);
     s_PresentRS[3].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 0, 1);
     s_PresentRS.InitStaticSampler(0, SamplerLinearClampDesc);
@@ -573,20 +689,80 @@ void Graphics::Initialize(void)
     CreatePSO(g_GenerateMipsGammaPSO[2], g_pGenerateMipsGammaOddYCS);
     CreatePSO(g_GenerateMipsGammaPSO[3], g_pGenerateMipsGammaOddCS);
 
+#undef CreatePSO
+
+    g_GenerateMipsBatchRS.Reset(6, 1);
+    g_GenerateMipsBatchRS[0].InitAsBufferSRV(16);
+    g_GenerateMipsBatchRS[1].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 0, kGenerateMipsBatchSize);
+    for (UINT i = 0; i < 4; ++i)
+        g_GenerateMipsBatchRS[2 + i].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, i * kGenerateMipsBatchSize, kGenerateMipsBatchSize);
+    g_GenerateMipsBatchRS.InitStaticSampler(0, SamplerLinearClampDesc);
+    g_GenerateMipsBatchRS.Finalize(L"Generate Mips Batch");
+
+    g_GenerateMipsBatchPSO.SetRootSignature(g_GenerateMipsBatchRS);
+    g_GenerateMipsBatchPSO.SetComputeShader(g_pGenerateMipsBatchCS, sizeof(g_pGenerateMipsBatchCS));
+    g_GenerateMipsBatchPSO.Finalize();
+
     g_PreDisplayBuffer.Create(L"PreDisplay Buffer", g_DisplayWidth, g_DisplayHeight, 1, SwapChainFormat);
 
     GpuTimeManager::Initialize(4096);
+    UploadRing::Initialize();
+    AsyncReadback::Initialize();
     SetNativeResolution();
-    TemporalEffects::Initialize();
-    PostEffects::Initialize();
-    SSAO::Initialize();
-    TextRenderer::Initialize();
-    GraphRenderer::Initialize();
-    ParticleEffects::Initialize(kMaxNativeWidth, kMaxNativeHeight);
+
+    // Texture loads convert and downsample, so these are ready before the application loads anything
+    TextureConverter::Initialize();
+    SinglePassDownsample::Initialize();
+
+    const int64_t EndTick = SystemTime::GetCurrentTick();
+    StartupProfile::Record(StartupProfile::kGraphicsInitialization, s_InitializeStartTick, EndTick);
+    s_InitializeSeconds = SystemTime::TimeBetweenTicks(s_InitializeStartTick, EndTick);
+}
+
+void Graphics::InitializeSubsystemsAsync( void )
+{
+    ASSERT(!s_SubsystemsPending, "Subsystems are already initializing");
+
+    s_SubsystemsStartTick = SystemTime::GetCurrentTick();
+    s_SubsystemsPending = true;
+
+    // Each subsystem builds its own root signatures, pipelines and buffers, and the allocators, caches and
+    // context pool they use are all locked, so they have no order among them.  Pipelines are compiled by the
+    // job system either way; what runs in parallel here is root signature creation and buffer initialization.
+    for (SubsystemInit& Subsystem : s_Subsystems)
+    {
+        SubsystemInit* Ptr = &Subsystem;
+        JobSystem::Run([Ptr]
+        {
+            int64_t StartTick = SystemTime::GetCurrentTick();
+            Ptr->Initialize();
+            int64_t EndTick = SystemTime::GetCurrentTick();
+            StartupProfile::Record(StartupProfile::kSubsystemInitialization, StartTick, EndTick);
+            Ptr->Seconds = SystemTime::TimeBetweenTicks(StartTick, EndTick);
+        }, &s_SubsystemJobs);
+    }
+}
+
+void Graphics::FinishInitialization( void )
+{
+    if (!s_SubsystemsPending)
+        return;
+
+    int64_t WaitTick = SystemTime::GetCurrentTick();
+    JobSystem::Wait(s_SubsystemJobs);
+    s_SubsystemsPending = false;
+
+    int64_t EndTick = SystemTime::GetCurrentTick();
+    Utility::Printf("Graphics initialized in %.1f ms, then its subsystems in %.1f ms, %.1f ms of it waited for:\n",
+        s_InitializeSeconds * 1000.0, SystemTime::TimeBetweenTicks(s_SubsystemsStartTick, EndTick) * 1000.0,
+        SystemTime::TimeBetweenTicks(WaitTick, EndTick) * 1000.0);
+    for (const SubsystemInit& Subsystem : s_Subsystems)
+        Utility::Printf("    %-16s %6.1f ms\n", Subsystem.Name, Subsystem.Seconds * 1000.0);
 }
 
 void Graphics::Terminate( void )
 {
+    FinishInitialization();
     g_CommandManager.IdleGPU();
 #if WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_DESKTOP)
     s_SwapChain1->SetFullscreenState(FALSE, nullptr);
@@ -598,7 +774,16 @@ void Graphics::Shutdown( void )
     CommandContext::DestroyAllContexts();
     g_CommandManager.Shutdown();
     GpuTimeManager::Shutdown();
+    UploadRing::Shutdown();
+    AsyncReadback::Shutdown();
+    CloseHandle(s_FrameLatencyWaitable);
+    s_FrameLatencyWaitable = nullptr;
     s_SwapChain1->Release();
+    s_SwapChain1 = nullptr;
+
+    // A lost device cannot serialize its library, and the file on disk already holds what it loaded
+    if (!s_DeviceLost)
+        PSO::SavePipelineCache();
     PSO::DestroyAll();
     RootSignature::DestroyAll();
     DescriptorAllocator::DestroyAll();
@@ -611,12 +796,20 @@ void Graphics::Shutdown( void )
     TextRenderer::Shutdown();
     GraphRenderer::Shutdown();
     ParticleEffects::Shutdown();
+    TextureConverter::Shutdown();
+    SinglePassDownsample::Shutdown();
     TextureManager::Shutdown();
 
     for (UINT i = 0; i < SWAP_CHAIN_BUFFER_COUNT; ++i)
         g_DisplayPlane[i].Destroy();
 
     g_PreDisplayBuffer.Destroy();
+    GpuMemoryPool::Shutdown();
+
+    // The rendering buffers are made again at the native resolution if the device is
+    g_NativeWidth = 0;
+    g_NativeHeight = 0;
+    s_DxgiFactory = nullptr;
 
 #if defined(_DEBUG)
     ID3D12DebugDevice* debugInterface;
@@ -667,9 +860,10 @@ void Graphics::PreparePresentHDR(void)
     Context.Draw(3);
 
     Context.TransitionResource(g_DisplayPlane[g_CurrentBuffer], D3D12_RESOURCE_STATE_PRESENT);
+    GpuTimeManager::ResolveTimeStamps(Context);
 
     // Close the final context to be executed before frame present.
-    Context.Finish();
+    GpuTimeManager::SetResolveFence(Context.Finish());
 }
 
 void Graphics::CompositeOverlays( GraphicsContext& Context )
@@ -682,6 +876,25 @@ void Graphics::CompositeOverlays( GraphicsContext& Context )
     Context.Draw(3);
 }
 
+ColorBuffer* Graphics::GetFinalPassTarget(void)
+{
+    ColorBuffer& DisplayPlane = g_DisplayPlane[g_CurrentBuffer];
+
+    if (!s_FuseFinalPass || g_bEnableHDROutput || DebugZoom != kDebugZoomOff ||
+        DisplayPlane.GetUAV().ptr == D3D12_GPU_VIRTUAL_ADDRESS_UNKNOWN ||
+        DynamicResolution::GetOutputWidth() != g_DisplayWidth || DynamicResolution::GetOutputHeight() != g_DisplayHeight)
+    {
+        return nullptr;
+    }
+
+    return &DisplayPlane;
+}
+
+void Graphics::SetDisplayWritten(void)
+{
+    s_DisplayWritten = true;
+}
+
 void Graphics::PreparePresentLDR(void)
 {
     GraphicsContext& Context = GraphicsContext::Begin(L"Present");
@@ -698,21 +911,37 @@ void Graphics::PreparePresentLDR(void)
 
     ColorBuffer& UpsampleDest = (DebugZoom == kDebugZoomOff ? g_DisplayPlane[g_CurrentBuffer] : g_PreDisplayBuffer);
 
-    if (g_NativeWidth == g_DisplayWidth && g_NativeHeight == g_DisplayHeight)
+    // With dynamic resolution the scene fills only the top left of the buffer, which is stretched to the display
+    const uint32_t ImageWidth = DynamicResolution::GetOutputWidth();
+    const uint32_t ImageHeight = DynamicResolution::GetOutputHeight();
+    const float UVScaleX = (float)ImageWidth / g_NativeWidth;
+    const float UVScaleY = (float)ImageHeight / g_NativeHeight;
+    const float UVMaxX = (ImageWidth - 0.5f) / g_NativeWidth;
+    const float UVMaxY = (ImageHeight - 0.5f) / g_NativeHeight;
+
+    if (s_DisplayWritten)
+    {
+        // The last post-processing pass already wrote the image
+        Context.TransitionResource(g_DisplayPlane[g_CurrentBuffer], D3D12_RESOURCE_STATE_RENDER_TARGET);
+        Context.SetRenderTarget(g_DisplayPlane[g_CurrentBuffer].GetRTV());
+        Context.SetViewportAndScissor(0, 0, g_DisplayWidth, g_DisplayHeight);
+        s_DisplayWritten = false;
+    }
+    else if (ImageWidth == g_DisplayWidth && ImageHeight == g_DisplayHeight)
     {
         Context.SetPipelineState(PresentSDRPS);
         Context.TransitionResource(UpsampleDest, D3D12_RESOURCE_STATE_RENDER_TARGET);
         Context.SetRenderTarget(UpsampleDest.GetRTV());
-        Context.SetViewportAndScissor(0, 0, g_NativeWidth, g_NativeHeight);
+        Context.SetViewportAndScissor(0, 0, g_DisplayWidth, g_DisplayHeight);
         Context.Draw(3);
     }
     else if (UpsampleFilter == kBicubic)
     {
         Context.TransitionResource(g_HorizontalBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET);
         Context.SetRenderTarget(g_HorizontalBuffer.GetRTV());
-        Context.SetViewportAndScissor(0, 0, g_DisplayWidth, g_NativeHeight);
+        Context.SetViewportAndScissor(0, 0, g_DisplayWidth, ImageHeight);
         Context.SetPipelineState(BicubicHorizontalUpsamplePS);
-        Context.SetConstants(1, g_NativeWidth, g_NativeHeight, (float)BicubicUpsampleWeight);
+        Context.SetConstants(1, ImageWidth, ImageHeight, (float)BicubicUpsampleWeight);
         Context.Draw(3);
 
         Context.TransitionResource(g_HorizontalBuffer, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
@@ -720,7 +949,7 @@ void Graphics::PreparePresentLDR(void)
         Context.SetRenderTarget(UpsampleDest.GetRTV());
         Context.SetViewportAndScissor(0, 0, g_DisplayWidth, g_DisplayHeight);
         Context.SetPipelineState(BicubicVerticalUpsamplePS);
-        Context.SetConstants(1, g_DisplayWidth, g_NativeHeight, (float)BicubicUpsampleWeight);
+        Context.SetConstants(1, g_DisplayWidth, ImageHeight, (float)BicubicUpsampleWeight);
         Context.SetDynamicDescriptor(0, 0, g_HorizontalBuffer.GetSRV());
         Context.Draw(3);
     }
@@ -736,7 +965,8 @@ void Graphics::PreparePresentLDR(void)
         float Y = Math::Sin((float)SharpeningRotation / 180.0f * 3.14159f) * (float)SharpeningSpread;
         const float WA = (float)SharpeningStrength;
         const float WB = 1.0f + 4.0f * WA;
-        float Constants[] = { X * TexelWidth, Y * TexelHeight, Y * TexelWidth, -X * TexelHeight, WA, WB };
+        float Constants[] = { X * TexelWidth, Y * TexelHeight, Y * TexelWidth, -X * TexelHeight, WA, WB,
+            UVScaleX, UVScaleY, UVMaxX, UVMaxY };
         Context.SetConstantArray(1, _countof(Constants), Constants);
         Context.Draw(3);
     }
@@ -746,6 +976,7 @@ void Graphics::PreparePresentLDR(void)
         Context.TransitionResource(UpsampleDest, D3D12_RESOURCE_STATE_RENDER_TARGET);
         Context.SetRenderTarget(UpsampleDest.GetRTV());
         Context.SetViewportAndScissor(0, 0, g_DisplayWidth, g_DisplayHeight);
+        Context.SetConstants(1, UVScaleX, UVScaleY, UVMaxX, UVMaxY);
         Context.Draw(3);
     }
 
@@ -764,9 +995,10 @@ void Graphics::PreparePresentLDR(void)
     CompositeOverlays(Context);
 
     Context.TransitionResource(g_DisplayPlane[g_CurrentBuffer], D3D12_RESOURCE_STATE_PRESENT);
+    GpuTimeManager::ResolveTimeStamps(Context);
 
     // Close the final context to be executed before frame present.
-    Context.Finish();
+    GpuTimeManager::SetResolveFence(Context.Finish());
 }
 
 void Graphics::Present(void)
@@ -780,7 +1012,12 @@ void Graphics::Present(void)
 
     UINT PresentInterval = s_EnableVSync ? std::min(4, (int)Round(s_FrameTime * 60.0f)) : 0;
 
-    s_SwapChain1->Present(PresentInterval, 0);
+    CheckForDeviceLost(s_SwapChain1->Present(PresentInterval, 0));
+    FramePacing::RecordPresent(s_SwapChain1, GameInput::GetSampleTick(), s_LatencyWaitTicks);
+
+    UploadRing::EndFrame();
+    AsyncReadback::EndFrame();
+    GpuMemoryPool::EndFrame();
 
     // Test robustness to handle spikes in CPU time
     //if (s_DropRandomFrames)
@@ -817,6 +1054,67 @@ void Graphics::Present(void)
     TemporalEffects::Update((uint32_t)s_FrameIndex);
 
     SetNativeResolution();
+    DynamicResolution::Update();
+}
+
+void Graphics::CheckForDeviceLost( HRESULT PresentResult )
+{
+    if (s_DeviceLost)
+        return;
+
+    if (PresentResult == DXGI_ERROR_DEVICE_REMOVED || PresentResult == DXGI_ERROR_DEVICE_RESET)
+    {
+        s_DeviceLost = true;
+        s_DeviceLostReason = PresentResult == DXGI_ERROR_DEVICE_REMOVED ? g_Device->GetDeviceRemovedReason() : PresentResult;
+    }
+    else if (s_SimulateDeviceLost)
+    {
+        s_SimulateDeviceLost = false;
+        s_DeviceLost = true;
+        s_DeviceLostReason = DXGI_ERROR_DEVICE_REMOVED;
+    }
+    else if (!s_DxgiFactory->IsCurrent())
+    {
+        // Adapters were added or removed.  The device is only lost when its own adapter is gone.
+        ComPtr<IDXGIFactory4> Factory;
+        ComPtr<IDXGIAdapter1> Adapter;
+        if (SUCCEEDED(CreateDXGIFactory2(0, MY_IID_PPV_ARGS(&Factory))))
+        {
+            s_DxgiFactory = Factory;
+            if (FAILED(Factory->EnumAdapterByLuid(g_Device->GetAdapterLuid(), MY_IID_PPV_ARGS(&Adapter))))
+            {
+                s_DeviceLost = true;
+                s_DeviceLostReason = DXGI_ERROR_DEVICE_REMOVED;
+            }
+        }
+    }
+
+    if (s_DeviceLost)
+        Utility::Printf("The graphics device was lost (0x%08x)\n", s_DeviceLostReason);
+}
+
+bool Graphics::IsDeviceLost(void)
+{
+    return s_DeviceLost;
+}
+
+void Graphics::WaitForFrameLatency(void)
+{
+    if (s_FrameLatencyWaitable == nullptr)
+        return;
+
+    if (s_AppliedFrameLatency != s_MaxFrameLatency)
+    {
+        ComPtr<IDXGISwapChain2> swapChain2;
+        ASSERT_SUCCEEDED(s_SwapChain1->QueryInterface(MY_IID_PPV_ARGS(&swapChain2)));
+        s_AppliedFrameLatency = s_MaxFrameLatency;
+        ASSERT_SUCCEEDED(swapChain2->SetMaximumFrameLatency((UINT)s_AppliedFrameLatency));
+    }
+
+    // The timeout only keeps a lost display from hanging the application
+    int64_t WaitStart = SystemTime::GetCurrentTick();
+    WaitForSingleObjectEx(s_FrameLatencyWaitable, 1000, TRUE);
+    s_LatencyWaitTicks = SystemTime::GetCurrentTick() - WaitStart;
 }
 
 uint64_t Graphics::GetFrameCount(void)
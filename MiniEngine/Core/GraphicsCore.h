@@ -36,11 +36,33 @@ namespace Graphics
     using namespace Microsoft::WRL;
 
     void Initialize(void);
+
+    // Initialize() sets up the device, the common state and the render targets.  The subsystems that only use
+    // pipelines and buffers of their own (temporal effects, post effects, SSAO, text, graphs and particles) are
+    // then initialized as jobs, alongside the application's Startup(), until FinishInitialization() waits for
+    // them and prints how long each took.  FinishInitialization() can be called more than once.
+    void InitializeSubsystemsAsync(void);
+    void FinishInitialization(void);
+
     void Resize(uint32_t width, uint32_t height);
     void Terminate(void);
     void Shutdown(void);
     void Present(void);
 
+    // The back buffer, when the last post-processing pass can write the SDR image into it in display encoding
+    // and save Present a full-screen copy, or null.  That is at native resolution without pixel magnification.
+    // A pass that writes it calls SetDisplayWritten(), and Present then only composites the overlay.
+    ColorBuffer* GetFinalPassTarget(void);
+    void SetDisplayWritten(void);
+
+    // True once Present() finds the device removed or reset, or its adapter gone.  GameCore then shuts down
+    // everything made on the device and initializes it again, on the best adapter left.
+    bool IsDeviceLost(void);
+
+    // Blocks until the swap chain will accept another frame without exceeding "Timing/Max Frame Latency".
+    // Call this before sampling input so that the wait is not added to the input latency.
+    void WaitForFrameLatency(void);
+
     extern uint32_t g_DisplayWidth;
     extern uint32_t g_DisplayHeight;
 
@@ -61,6 +83,8 @@ namespace Graphics
 
     extern D3D_FEATURE_LEVEL g_D3DFeatureLevel;
     extern bool g_bTypedUAVLoadSupport_R11G11B10_FLOAT;
+    extern bool g_bVariableRateShadingTier2;
+    extern uint32_t g_ShadingRateTileSize;  // The pixels of a render target each shading rate image texel covers
     extern bool g_bEnableHDROutput;
 
     extern DescriptorAllocator g_DescriptorAllocator[];
@@ -68,11 +92,20 @@ namespace Graphics
     {
         return g_DescriptorAllocator[Type].Allocate(Count);
     }
+    inline void FreeDescriptor( D3D12_DESCRIPTOR_HEAP_TYPE Type, D3D12_CPU_DESCRIPTOR_HANDLE Handle, UINT Count = 1 )
+    {
+        g_DescriptorAllocator[Type].Free(Handle, Count);
+    }
 
     extern RootSignature g_GenerateMipsRS;
     extern ComputePSO g_GenerateMipsLinearPSO[4];
     extern ComputePSO g_GenerateMipsGammaPSO[4];
 
+    // Generates mips of many textures at once.  The batch size matches MAX_TEXTURES in GenerateMipsBatchCS.hlsl.
+    const uint32_t kGenerateMipsBatchSize = 16;
+    extern RootSignature g_GenerateMipsBatchRS;
+    extern ComputePSO g_GenerateMipsBatchPSO;
+
     enum eResolution { k720p, k900p, k1080p, k1440p, k1800p, k2160p };
 
     extern BoolVar s_EnableVSync;
@@ -0,0 +1,303 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "pch.h"
+#include "JobSystem.h"
+#include <deque>
+#include <algorithm>
+#include <thread>
+#include <condition_variable>
+
+namespace JobSystem
+{
+    struct Job
+    {
+        JobFunc Func;
+        Counter* Group;
+    };
+
+    // The main thread owns queue 0 and worker N owns queue N
+    struct JobQueue
+    {
+        std::mutex Mutex;
+        std::deque<Job> Jobs;
+    };
+
+    struct CounterAccess
+    {
+        static void Add( Counter& c ) { c.m_Pending.fetch_add(1, std::memory_order_relaxed); }
+        static void Finish( Counter& c );
+        static bool AddContinuation( Counter& c, const JobFunc& Func, Counter* Group );
+    };
+
+    std::vector<std::unique_ptr<JobQueue> > s_Queues;
+    std::vector<std::thread> s_Workers;
+    JobQueue s_MainThreadQueue;
+
+    // Sleeping workers wake when a job is queued.  The count is changed under the lock when a job is
+    // queued so that a worker cannot miss the wake up between checking it and going to sleep.
+    std::mutex s_WakeMutex;
+    std::condition_variable s_WakeCondition;
+    std::atomic<uint32_t> s_QueuedJobs(0);
+    bool s_Quit = false;
+
+    thread_local uint32_t t_QueueIndex = 0;
+    std::thread::id s_MainThreadId;
+
+    void Push( JobQueue& Queue, const JobFunc& Func, Counter* Group );
+    bool TryPop( uint32_t QueueIndex, Job& Out );
+    bool TrySteal( uint32_t QueueIndex, Job& Out );
+    void Execute( Job& job );
+    void WorkerMain( uint32_t QueueIndex );
+}
+
+using namespace JobSystem;
+
+void CounterAccess::Finish( Counter& c )
+{
+    if (c.m_Pending.fetch_sub(1, std::memory_order_acq_rel) != 1)
+        return;
+
+    std::vector<std::pair<JobFunc, Counter*> > Continuations;
+    {
+        std::lock_guard<std::mutex> LockGuard(c.m_ContinuationMutex);
+        Continuations.swap(c.m_Continuations);
+    }
+
+    for (auto& Continuation : Continuations)
+    {
+        Push(*s_Queues[t_QueueIndex], Continuation.first, Continuation.second);
+        if (Continuation.second != nullptr)
+            Finish(*Continuation.second);    // Balances the count taken by RunAfter()
+    }
+}
+
+bool CounterAccess::AddContinuation( Counter& c, const JobFunc& Func, Counter* Group )
+{
+    std::lock_guard<std::mutex> LockGuard(c.m_ContinuationMutex);
+    if (c.IsDone())
+        return false;
+
+    c.m_Continuations.emplace_back(Func, Group);
+    return true;
+}
+
+void JobSystem::Push( JobQueue& Queue, const JobFunc& Func, Counter* Group )
+{
+    if (Group != nullptr)
+        CounterAccess::Add(*Group);
+
+    {
+        std::lock_guard<std::mutex> LockGuard(Queue.Mutex);
+        Queue.Jobs.push_back({ Func, Group });
+    }
+
+    if (&Queue == &s_MainThreadQueue)
+        return;
+
+    {
+        std::lock_guard<std::mutex> LockGuard(s_WakeMutex);
+        s_QueuedJobs.fetch_add(1, std::memory_order_relaxed);
+    }
+    s_WakeCondition.notify_one();
+}
+
+bool JobSystem::TryPop( uint32_t QueueIndex, Job& Out )
+{
+    // The newest job is the most likely to still be in cache
+    JobQueue& Queue = *s_Queues[QueueIndex];
+    std::lock_guard<std::mutex> LockGuard(Queue.Mutex);
+    if (Queue.Jobs.empty())
+        return false;
+
+    Out = std::move(Queue.Jobs.back());
+    Queue.Jobs.pop_back();
+    s_QueuedJobs.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool JobSystem::TrySteal( uint32_t QueueIndex, Job& Out )
+{
+    // Take the oldest job of a victim, which tends to be the biggest piece of its work
+    const uint32_t NumQueues = (uint32_t)s_Queues.size();
+    for (uint32_t i = 1; i < NumQueues; ++i)
+    {
+        JobQueue& Victim = *s_Queues[(QueueIndex + i) % NumQueues];
+        std::lock_guard<std::mutex> LockGuard(Victim.Mutex);
+        if (Victim.Jobs.empty())
+            continue;
+
+        Out = std::move(Victim.Jobs.front());
+        Victim.Jobs.pop_front();
+        s_QueuedJobs.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+void JobSystem::Execute( Job& job )
+{
+    job.Func();
+    if (job.Group != nullptr)
+        CounterAccess::Finish(*job.Group);
+}
+
+void JobSystem::WorkerMain( uint32_t QueueIndex )
+{
+    t_QueueIndex = QueueIndex;
+
+    for (;;)
+    {
+        Job job;
+        if (TryPop(QueueIndex, job) || TrySteal(QueueIndex, job))
+        {
+            Execute(job);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> Lock(s_WakeMutex);
+        s_WakeCondition.wait(Lock, [] { return s_Quit || s_QueuedJobs.load(std::memory_order_relaxed) > 0; });
+        if (s_Quit)
+            return;
+    }
+}
+
+void JobSystem::Initialize( uint32_t NumWorkers )
+{
+    ASSERT(s_Workers.empty(), "The job system is already running");
+
+    if (NumWorkers == 0)
+        NumWorkers = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+
+    s_MainThreadId = std::this_thread::get_id();
+    t_QueueIndex = 0;
+    s_Quit = false;
+
+    for (uint32_t i = 0; i <= NumWorkers; ++i)
+        s_Queues.emplace_back(new JobQueue);
+
+    for (uint32_t i = 1; i <= NumWorkers; ++i)
+        s_Workers.emplace_back(WorkerMain, i);
+}
+
+void JobSystem::Shutdown( void )
+{
+    {
+        std::lock_guard<std::mutex> LockGuard(s_WakeMutex);
+        s_Quit = true;
+    }
+    s_WakeCondition.notify_all();
+
+    for (auto& Worker : s_Workers)
+        Worker.join();
+
+    s_Workers.clear();
+    s_Queues.clear();
+    s_QueuedJobs = 0;
+}
+
+uint32_t JobSystem::GetWorkerCount( void )
+{
+    return (uint32_t)s_Workers.size();
+}
+
+bool JobSystem::IsMainThread( void )
+{
+    return std::this_thread::get_id() == s_MainThreadId;
+}
+
+void JobSystem::Run( const JobFunc& Job, Counter* Group )
+{
+    ASSERT(!s_Queues.empty(), "The job system has not been initialized");
+    Push(*s_Queues[t_QueueIndex], Job, Group);
+}
+
+void JobSystem::RunAfter( Counter& Dependency, const JobFunc& Job, Counter* Group )
+{
+    // The group counts the job from now on, so that waiting on it also waits for the dependency
+    if (Group != nullptr)
+        CounterAccess::Add(*Group);
+
+    if (!CounterAccess::AddContinuation(Dependency, Job, Group))
+    {
+        Run(Job, Group);
+        if (Group != nullptr)
+            CounterAccess::Finish(*Group);
+    }
+}
+
+void JobSystem::AddExternal( Counter& Group )
+{
+    CounterAccess::Add(Group);
+}
+
+void JobSystem::FinishExternal( Counter& Group )
+{
+    CounterAccess::Finish(Group);
+}
+
+void JobSystem::RunOnMainThread( const JobFunc& Job, Counter* Group )
+{
+    Push(s_MainThreadQueue, Job, Group);
+}
+
+void JobSystem::ProcessMainThreadJobs( void )
+{
+    ASSERT(IsMainThread());
+
+    for (;;)
+    {
+        Job job;
+        {
+            std::lock_guard<std::mutex> LockGuard(s_MainThreadQueue.Mutex);
+            if (s_MainThreadQueue.Jobs.empty())
+                return;
+            job = std::move(s_MainThreadQueue.Jobs.front());
+            s_MainThreadQueue.Jobs.pop_front();
+        }
+        Execute(job);
+    }
+}
+
+void JobSystem::Wait( Counter& Group, const wchar_t* ProfileName )
+{
+    const bool OnMainThread = IsMainThread();
+    if (ProfileName != nullptr && OnMainThread)
+        EngineProfiling::BeginBlock(ProfileName);
+
+    while (!Group.IsDone())
+    {
+        if (OnMainThread)
+            ProcessMainThreadJobs();
+
+        Job job;
+        if (TryPop(t_QueueIndex, job) || TrySteal(t_QueueIndex, job))
+            Execute(job);
+        else
+            std::this_thread::yield();
+    }
+
+    if (ProfileName != nullptr && OnMainThread)
+        EngineProfiling::EndBlock();
+}
+
+void JobSystem::ParallelFor( uint32_t Count, uint32_t BatchSize, const std::function<void(uint32_t Begin, uint32_t End)>& Func,
+    const wchar_t* ProfileName )
+{
+    ASSERT(BatchSize > 0);
+
+    Counter Group;
+    for (uint32_t Begin = 0; Begin < Count; Begin += BatchSize)
+    {
+        const uint32_t End = std::min(Begin + BatchSize, Count);
+        Run([&Func, Begin, End] { Func(Begin, End); }, &Group);
+    }
+
+    Wait(Group, ProfileName);
+}
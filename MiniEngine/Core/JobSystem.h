@@ -0,0 +1,77 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// A work-stealing job scheduler.  Every worker thread, and the main thread, owns a queue of jobs.  A thread
+// pushes and pops jobs at the back of its own queue and steals from the front of the others when it runs
+// dry.  Jobs are grouped by counters; waiting on a counter runs other jobs rather than blocking, and jobs
+// can be continued after a counter finishes.  Jobs that need the main thread (e.g. anything touching
+// EngineProfiling or submitting to a command queue) have a queue of their own.
+//
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <vector>
+#include <cstdint>
+
+namespace JobSystem
+{
+    typedef std::function<void(void)> JobFunc;
+
+    // Counts the unfinished jobs of a group.  A counter can be reused once it finishes.
+    class Counter
+    {
+    public:
+        Counter() : m_Pending(0) {}
+        Counter(const Counter&) = delete;
+        Counter& operator=(const Counter&) = delete;
+
+        bool IsDone() const { return m_Pending.load(std::memory_order_acquire) == 0; }
+
+    private:
+        friend struct CounterAccess;
+
+        std::atomic<uint32_t> m_Pending;
+
+        // Jobs to queue when the counter reaches zero
+        std::mutex m_ContinuationMutex;
+        std::vector<std::pair<JobFunc, Counter*> > m_Continuations;
+    };
+
+    // Starts one worker per core beyond the main thread unless told otherwise
+    void Initialize( uint32_t NumWorkers = 0 );
+    void Shutdown( void );
+
+    uint32_t GetWorkerCount( void );
+    bool IsMainThread( void );
+
+    // Queue a job on this thread's queue, to be run here or stolen by any worker
+    void Run( const JobFunc& Job, Counter* Group = nullptr );
+
+    // Queue a job once Dependency finishes (right away if it already has)
+    void RunAfter( Counter& Dependency, const JobFunc& Job, Counter* Group = nullptr );
+
+    // Count work done outside the job system, such as an I/O request, in a group until FinishExternal()
+    void AddExternal( Counter& Group );
+    void FinishExternal( Counter& Group );
+
+    // Queue a job that only the main thread runs, the next time it waits or processes main thread jobs
+    void RunOnMainThread( const JobFunc& Job, Counter* Group = nullptr );
+    void ProcessMainThreadJobs( void );
+
+    // Run jobs on this thread until the group finishes.  On the main thread, a profile name times the
+    // wait with EngineProfiling.
+    void Wait( Counter& Group, const wchar_t* ProfileName = nullptr );
+
+    // Split [0, Count) into batches of at most BatchSize and run them as jobs, waiting for all of them.
+    // The calling thread runs a share of the batches.
+    void ParallelFor( uint32_t Count, uint32_t BatchSize, const std::function<void(uint32_t Begin, uint32_t End)>& Func,
+        const wchar_t* ProfileName = nullptr );
+}
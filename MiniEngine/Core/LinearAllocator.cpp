@@ -16,14 +16,44 @@
 #include "LinearAllocator.h"
 #include "GraphicsCore.h"
 #include "CommandListManager.h"
+#include "GpuMemoryTracker.h"
 #include <thread>
 
 using namespace Graphics;
 using namespace std;
 
+namespace
+{
+    // The pages a thread took from each page manager and hasn't used yet
+    const uint32_t kMaxCachedPages = 4;
+
+    struct ThreadPageCache
+    {
+        uint32_t Generation;
+        uint32_t NumPages;
+        LinearAllocationPage* Pages[kMaxCachedPages];
+    };
+
+    thread_local ThreadPageCache t_PageCache[kNumAllocatorTypes];
+
+    IntVar LargePageIdleFrames("Graphics/Memory/Large Page Idle Frames", 120, 0, 1000, 10);
+
+    // Rounds a large page up to one of four sizes per power of two, so that allocations of similar sizes share
+    // pages while wasting less than a quarter of each
+    size_t GetLargePageBucketSize( size_t SizeInBytes )
+    {
+        size_t Step = 0x10000;
+        while (Step * 8 < SizeInBytes)
+            Step <<= 1;
+        return Math::AlignUp(SizeInBytes, Step);
+    }
+}
+
 LinearAllocatorType LinearAllocatorPageManager::sm_AutoType = kGpuExclusive;
 
-LinearAllocatorPageManager::LinearAllocatorPageManager()
+LinearAllocatorPageManager::LinearAllocatorPageManager() :
+    m_RetiredBatches(nullptr), m_NumPages(0), m_Generation(1), m_NumPooledLargePages(0), m_PooledLargePageBytes(0),
+    m_NumLargePagesCreated(0)
 {
     m_AllocationType = sm_AutoType;
     sm_AutoType = (LinearAllocatorType)(sm_AutoType + 1);
@@ -31,55 +61,174 @@ LinearAllocatorPageManager::LinearAllocatorPageManager()
 }
 
 LinearAllocatorPageManager LinearAllocator::sm_PageManager[2];
+atomic<size_t> LinearAllocator::sm_BytesAllocated[2];
+atomic<uint32_t> LinearAllocator::sm_NumLargePages[2];
 
 LinearAllocationPage* LinearAllocatorPageManager::RequestPage()
 {
+    ThreadPageCache& Cache = t_PageCache[m_AllocationType];
+    const uint32_t Generation = m_Generation.load(memory_order_relaxed);
+    if (Cache.Generation != Generation)
+    {
+        Cache.Generation = Generation;
+        Cache.NumPages = 0;
+    }
+
+    if (Cache.NumPages > 0)
+        return Cache.Pages[--Cache.NumPages];
+
     lock_guard<mutex> LockGuard(m_Mutex);
 
+    ReclaimRetiredPages();
+
+    if (m_AvailablePages.empty())
+    {
+        LinearAllocationPage* PagePtr = CreateNewPage();
+        m_PagePool.emplace_back(PagePtr);
+        m_NumPages.fetch_add(1, memory_order_relaxed);
+        return PagePtr;
+    }
+
+    // Take half of the available pages, up to the cache size, to leave some for other threads
+    uint32_t NumToTake = std::min(((uint32_t)m_AvailablePages.size() + 1) / 2, kMaxCachedPages);
+    while (NumToTake-- > 0)
+    {
+        Cache.Pages[Cache.NumPages++] = m_AvailablePages.front();
+        m_AvailablePages.pop();
+    }
+
+    return Cache.Pages[--Cache.NumPages];
+}
+
+void LinearAllocatorPageManager::PushRetiredBatch( RetiredBatch* Batch )
+{
+    Batch->Next = m_RetiredBatches.load(memory_order_relaxed);
+    while (!m_RetiredBatches.compare_exchange_weak(Batch->Next, Batch, memory_order_release, memory_order_relaxed))
+        ;
+}
+
+void LinearAllocatorPageManager::ReclaimRetiredPages( void )
+{
+    // Reverse the list so that pages are queued in the order they were retired
+    RetiredBatch* Oldest = nullptr;
+    RetiredBatch* Batch = m_RetiredBatches.exchange(nullptr, memory_order_acquire);
+    while (Batch != nullptr)
+    {
+        RetiredBatch* Next = Batch->Next;
+        Batch->Next = Oldest;
+        Oldest = Batch;
+        Batch = Next;
+    }
+
+    while (Oldest != nullptr)
+    {
+        auto& Queue = Oldest->IsLarge ? m_RetiredLargePages : m_RetiredPages;
+        for (LinearAllocationPage* Page : Oldest->Pages)
+            Queue.push(make_pair(Oldest->FenceID, Page));
+
+        RetiredBatch* Next = Oldest->Next;
+        delete Oldest;
+        Oldest = Next;
+    }
+
     while (!m_RetiredPages.empty() && g_CommandManager.IsFenceComplete(m_RetiredPages.front().first))
     {
         m_AvailablePages.push(m_RetiredPages.front().second);
         m_RetiredPages.pop();
     }
 
-    LinearAllocationPage* PagePtr = nullptr;
-
-    if (!m_AvailablePages.empty())
+    const uint64_t FrameIndex = Graphics::GetFrameCount();
+    while (!m_RetiredLargePages.empty() && g_CommandManager.IsFenceComplete(m_RetiredLargePages.front().first))
     {
-        PagePtr = m_AvailablePages.front();
-        m_AvailablePages.pop();
+        LinearAllocationPage* Page = m_RetiredLargePages.front().second;
+        const size_t PageSize = (size_t)Page->GetResource()->GetDesc().Width;
+        m_LargePagePool.emplace(PageSize, PooledLargePage{ FrameIndex, Page });
+        m_NumPooledLargePages.fetch_add(1, memory_order_relaxed);
+        m_PooledLargePageBytes.fetch_add(PageSize, memory_order_relaxed);
+        m_RetiredLargePages.pop();
     }
-    else
+}
+
+void LinearAllocatorPageManager::DeletePooledLargePage( multimap<size_t, PooledLargePage>::iterator Iter )
+{
+    m_NumPooledLargePages.fetch_sub(1, memory_order_relaxed);
+    m_PooledLargePageBytes.fetch_sub(Iter->first, memory_order_relaxed);
+    delete Iter->second.Page;
+    m_LargePagePool.erase(Iter);
+}
+
+LinearAllocationPage* LinearAllocatorPageManager::RequestLargePage( size_t SizeInBytes )
+{
+    const size_t BucketSize = GetLargePageBucketSize(SizeInBytes);
+
     {
-        PagePtr = CreateNewPage();
-        m_PagePool.emplace_back(PagePtr);
+        lock_guard<mutex> LockGuard(m_Mutex);
+
+        ReclaimRetiredPages();
+
+        auto Iter = m_LargePagePool.find(BucketSize);
+        if (Iter != m_LargePagePool.end())
+        {
+            LinearAllocationPage* Page = Iter->second.Page;
+            m_NumPooledLargePages.fetch_sub(1, memory_order_relaxed);
+            m_PooledLargePageBytes.fetch_sub(BucketSize, memory_order_relaxed);
+            m_LargePagePool.erase(Iter);
+            return Page;
+        }
     }
 
-    return PagePtr;
+    // Creating the resource does not need the lock
+    m_NumLargePagesCreated.fetch_add(1, memory_order_relaxed);
+    return CreateNewPage(BucketSize);
 }
 
-void LinearAllocatorPageManager::DiscardPages( uint64_t FenceValue, const vector<LinearAllocationPage*>& UsedPages )
+void LinearAllocatorPageManager::TrimLargePages( void )
 {
     lock_guard<mutex> LockGuard(m_Mutex);
-    for (auto iter = UsedPages.begin(); iter != UsedPages.end(); ++iter)
-        m_RetiredPages.push(make_pair(FenceValue, *iter));
+
+    ReclaimRetiredPages();
+
+    const uint64_t FrameIndex = Graphics::GetFrameCount();
+    for (auto Iter = m_LargePagePool.begin(); Iter != m_LargePagePool.end(); )
+    {
+        auto Next = std::next(Iter);
+        if (FrameIndex - Iter->second.LastUsedFrame >= (uint64_t)(int32_t)LargePageIdleFrames)
+            DeletePooledLargePage(Iter);
+        Iter = Next;
+    }
+}
+
+void LinearAllocatorPageManager::DiscardPages( uint64_t FenceValue, const vector<LinearAllocationPage*>& UsedPages )
+{
+    if (UsedPages.empty())
+        return;
+
+    PushRetiredBatch(new RetiredBatch{ FenceValue, false, UsedPages, nullptr });
 }
 
 void LinearAllocatorPageManager::FreeLargePages( uint64_t FenceValue, const vector<LinearAllocationPage*>& LargePages )
+{
+    if (LargePages.empty())
+        return;
+
+    // Pages stay mapped while they are pooled, like the pages that are recycled
+    PushRetiredBatch(new RetiredBatch{ FenceValue, true, LargePages, nullptr });
+}
+
+void LinearAllocatorPageManager::Destroy( void )
 {
     lock_guard<mutex> LockGuard(m_Mutex);
 
-    while (!m_DeletionQueue.empty() && g_CommandManager.IsFenceComplete(m_DeletionQueue.front().first))
-    {
-        delete m_DeletionQueue.front().second;
-        m_DeletionQueue.pop();
-    }
+    // The GPU is idle, so every fence has passed
+    ReclaimRetiredPages();
+    while (!m_LargePagePool.empty())
+        DeletePooledLargePage(m_LargePagePool.begin());
 
-    for (auto iter = LargePages.begin(); iter != LargePages.end(); ++iter)
-    {
-        (*iter)->Unmap();
-        m_DeletionQueue.push(make_pair(FenceValue, *iter));
-    }
+    m_RetiredPages = {};
+    m_AvailablePages = {};
+    m_PagePool.clear();
+    m_NumPages = 0;
+    m_Generation.fetch_add(1, memory_order_relaxed);
 }
 
 LinearAllocationPage* LinearAllocatorPageManager::CreateNewPage( size_t PageSize  )
@@ -123,12 +272,43 @@ LinearAllocationPage* LinearAllocatorPageManager::CreateNewPage( size_t PageSize
         &ResourceDesc, DefaultUsage, nullptr, MY_IID_PPV_ARGS(&pBuffer)) );
 
     pBuffer->SetName(L"LinearAllocator Page");
+    GpuMemoryTracker::TrackResource(pBuffer, PageSize == 0 ? GpuMemoryTracker::kLinearAllocatorPages :
+        GpuMemoryTracker::kLinearAllocatorLargePages);
 
     return new LinearAllocationPage(pBuffer, DefaultUsage);
 }
 
+void LinearAllocator::ReportStatistics( void )
+{
+    EngineProfiling::SetCounter("Upload Heap KB", (uint32_t)(sm_BytesAllocated[kCpuWritable].exchange(0) / 1024));
+    EngineProfiling::SetCounter("Upload Heap Pages", sm_PageManager[kCpuWritable].GetPageCount());
+    EngineProfiling::SetCounter("Upload Heap Large Pages", sm_NumLargePages[kCpuWritable].exchange(0));
+    EngineProfiling::SetCounter("Upload Heap Large Pages Created", sm_PageManager[kCpuWritable].GetLargePagesCreated());
+    EngineProfiling::SetCounter("Upload Heap Pooled Large Pages", sm_PageManager[kCpuWritable].GetPooledLargePageCount());
+    EngineProfiling::SetCounter("Upload Heap Pooled Large KB", (uint32_t)(sm_PageManager[kCpuWritable].GetPooledLargePageBytes() / 1024));
+    EngineProfiling::SetCounter("GPU Scratch KB", (uint32_t)(sm_BytesAllocated[kGpuExclusive].exchange(0) / 1024));
+    EngineProfiling::SetCounter("GPU Scratch Pages", sm_PageManager[kGpuExclusive].GetPageCount());
+    EngineProfiling::SetCounter("GPU Scratch Large Pages", sm_NumLargePages[kGpuExclusive].exchange(0));
+    EngineProfiling::SetCounter("GPU Scratch Large Pages Created", sm_PageManager[kGpuExclusive].GetLargePagesCreated());
+    EngineProfiling::SetCounter("GPU Scratch Pooled Large Pages", sm_PageManager[kGpuExclusive].GetPooledLargePageCount());
+    EngineProfiling::SetCounter("GPU Scratch Pooled Large KB", (uint32_t)(sm_PageManager[kGpuExclusive].GetPooledLargePageBytes() / 1024));
+}
+
 void LinearAllocator::CleanupUsedPages( uint64_t FenceID )
 {
+    // Statistics are gathered once per context rather than per allocation
+    if (m_BytesAllocated > 0)
+    {
+        sm_BytesAllocated[m_AllocationType].fetch_add(m_BytesAllocated, memory_order_relaxed);
+        sm_NumLargePages[m_AllocationType].fetch_add(m_NumLargePages, memory_order_relaxed);
+        m_BytesAllocated = 0;
+        m_NumLargePages = 0;
+    }
+
+    // Large pages are freed even when no page was requested
+    sm_PageManager[m_AllocationType].FreeLargePages(FenceID, m_LargePageList);
+    m_LargePageList.clear();
+
     if (m_CurPage == nullptr)
         return;
 
@@ -138,15 +318,14 @@ void LinearAllocator::CleanupUsedPages( uint64_t FenceID )
 
     sm_PageManager[m_AllocationType].DiscardPages(FenceID, m_RetiredPages);
     m_RetiredPages.clear();
-
-    sm_PageManager[m_AllocationType].FreeLargePages(FenceID, m_LargePageList);
-    m_LargePageList.clear();
 }
 
 DynAlloc LinearAllocator::AllocateLargePage(size_t SizeInBytes)
 {
-    LinearAllocationPage* OneOff = sm_PageManager[m_AllocationType].CreateNewPage(SizeInBytes);
+    LinearAllocationPage* OneOff = sm_PageManager[m_AllocationType].RequestLargePage(SizeInBytes);
     m_LargePageList.push_back(OneOff);
+    m_BytesAllocated += SizeInBytes;
+    ++m_NumLargePages;
 
     DynAlloc ret(*OneOff, 0, SizeInBytes);
     ret.DataPtr = OneOff->m_CpuVirtualAddress;
@@ -188,6 +367,7 @@ DynAlloc LinearAllocator::Allocate(size_t SizeInBytes, size_t Alignment)
     ret.GpuAddress = m_CurPage->m_GpuVirtualAddress + m_CurOffset;
 
     m_CurOffset += AlignedSize;
+    m_BytesAllocated += AlignedSize;
 
     return ret;
 }
@@ -13,19 +13,25 @@
 // Description:  This is a dynamic graphics memory allocator for DX12.  It's designed to work in concert
 // with the CommandContext class and to do so in a thread-safe manner.  There may be many command contexts,
 // each with its own linear allocators.  They act as windows into a global memory pool by reserving a
-// context-local memory page.  Requesting a new page is done in a thread-safe manner by guarding accesses
-// with a mutex lock.
+// context-local memory page.  Each thread keeps a few ready pages of its own, and only takes the page
+// manager's lock to refill them in a batch.
 //
 // When a command context is finished, it will receive a fence ID that indicates when it's safe to reclaim
 // used resources.  The CleanupUsedPages() method must be invoked at this time so that the used pages can be
-// scheduled for reuse after the fence has cleared.
+// scheduled for reuse after the fence has cleared.  Used pages are pushed onto a lock-free list, which is
+// drained the next time a thread refills its pages.
+//
+// Allocations larger than a page get a page of their own.  Once its fence has cleared, a large page is pooled by
+// its size bucket for later large allocations, and destroyed when it has not been reused for a number of frames.
 
 #pragma once
 
 #include "GpuResource.h"
 #include <vector>
 #include <queue>
+#include <map>
 #include <mutex>
+#include <atomic>
 
 // Constant blocks must be multiples of 16 constants @ 16 bytes each
 #define DEFAULT_ALIGN 256
@@ -101,27 +107,72 @@ class LinearAllocatorPageManager
 public:
 
     LinearAllocatorPageManager();
+
     LinearAllocationPage* RequestPage( void );
     LinearAllocationPage* CreateNewPage( size_t PageSize = 0 );
 
+    // Returns a page of at least this size, reusing a pooled large page of the same size bucket when one is free
+    LinearAllocationPage* RequestLargePage( size_t SizeInBytes );
+
     // Discarded pages will get recycled.  This is for fixed size pages.
     void DiscardPages( uint64_t FenceID, const std::vector<LinearAllocationPage*>& Pages );
 
-    // Freed pages will be destroyed once their fence has passed.  This is for single-use,
-    // "large" pages.
+    // Freed pages will be pooled for reuse once their fence has passed.  This is for "large" pages.
     void FreeLargePages( uint64_t FenceID, const std::vector<LinearAllocationPage*>& Pages );
 
-    void Destroy( void ) { m_PagePool.clear(); }
+    // Destroys pooled large pages that have not been reused for the idle frame count.  Call this once per frame.
+    void TrimLargePages( void );
+
+    void Destroy( void );
+
+    // Pages created for reuse, which counts the ones in use
+    uint32_t GetPageCount( void ) const { return m_NumPages.load(std::memory_order_relaxed); }
+
+    // Large pages waiting in the pool, and their bytes
+    uint32_t GetPooledLargePageCount( void ) const { return m_NumPooledLargePages.load(std::memory_order_relaxed); }
+    size_t GetPooledLargePageBytes( void ) const { return m_PooledLargePageBytes.load(std::memory_order_relaxed); }
+
+    // Large pages created, rather than reused, since the last call
+    uint32_t GetLargePagesCreated( void ) { return m_NumLargePagesCreated.exchange(0, std::memory_order_relaxed); }
 
 private:
 
+    struct RetiredBatch
+    {
+        uint64_t FenceID;
+        bool IsLarge;           // Large pages are pooled by size rather than recycled
+        std::vector<LinearAllocationPage*> Pages;
+        RetiredBatch* Next;
+    };
+
+    void PushRetiredBatch( RetiredBatch* Batch );
+
+    struct PooledLargePage
+    {
+        uint64_t LastUsedFrame;
+        LinearAllocationPage* Page;
+    };
+
+    // Moves retired batches to the queues below, and recycles or pools pages whose fences have passed.
+    // The caller holds the lock.
+    void ReclaimRetiredPages( void );
+
+    void DeletePooledLargePage( std::multimap<size_t, PooledLargePage>::iterator Iter );
+
     static LinearAllocatorType sm_AutoType;
 
     LinearAllocatorType m_AllocationType;
     std::vector<std::unique_ptr<LinearAllocationPage> > m_PagePool;
+    std::atomic<RetiredBatch*> m_RetiredBatches;    // Newest first
+    std::atomic<uint32_t> m_NumPages;
+    std::atomic<uint32_t> m_Generation;             // Changed by Destroy() so threads drop the pages they kept
     std::queue<std::pair<uint64_t, LinearAllocationPage*> > m_RetiredPages;
-    std::queue<std::pair<uint64_t, LinearAllocationPage*> > m_DeletionQueue;
+    std::queue<std::pair<uint64_t, LinearAllocationPage*> > m_RetiredLargePages;
     std::queue<LinearAllocationPage*> m_AvailablePages;
+    std::multimap<size_t, PooledLargePage> m_LargePagePool;    // Keyed by bucket size
+    std::atomic<uint32_t> m_NumPooledLargePages;
+    std::atomic<size_t> m_PooledLargePageBytes;
+    std::atomic<uint32_t> m_NumLargePagesCreated;
     std::mutex m_Mutex;
 };
 
@@ -129,7 +180,8 @@ class LinearAllocator
 {
 public:
 
-    LinearAllocator(LinearAllocatorType Type) : m_AllocationType(Type), m_PageSize(0), m_CurOffset(~(size_t)0), m_CurPage(nullptr)
+    LinearAllocator(LinearAllocatorType Type) : m_AllocationType(Type), m_PageSize(0), m_CurOffset(~(size_t)0), m_CurPage(nullptr),
+        m_BytesAllocated(0), m_NumLargePages(0)
     {
         ASSERT(Type > kInvalidAllocator && Type < kNumAllocatorTypes);
         m_PageSize = (Type == kGpuExclusive ? kGpuAllocatorPageSize : kCpuAllocatorPageSize);
@@ -145,11 +197,23 @@ public:
         sm_PageManager[1].Destroy();
     }
 
+    static void TrimLargePages( void )
+    {
+        sm_PageManager[0].TrimLargePages();
+        sm_PageManager[1].TrimLargePages();
+    }
+
+    // Lists the bytes allocated and large pages used and created since the last call, and the pages in each
+    // pool, with the profiler's counters.  Allocations are counted when their context finishes.
+    static void ReportStatistics( void );
+
 private:
 
     DynAlloc AllocateLargePage( size_t SizeInBytes );
 
     static LinearAllocatorPageManager sm_PageManager[2];
+    static std::atomic<size_t> sm_BytesAllocated[2];
+    static std::atomic<uint32_t> sm_NumLargePages[2];
 
     LinearAllocatorType m_AllocationType;
     size_t m_PageSize;
@@ -157,4 +221,6 @@ private:
     LinearAllocationPage* m_CurPage;
     std::vector<LinearAllocationPage*> m_RetiredPages;
     std::vector<LinearAllocationPage*> m_LargePageList;
+    size_t m_BytesAllocated;
+    uint32_t m_NumLargePages;
 };
@@ -0,0 +1,266 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "pch.h"
+#include "BatchBounds.h"
+#include <intrin.h>
+#include <immintrin.h>
+#include <float.h>
+
+using namespace Math;
+
+namespace
+{
+    SimdLevel DetectSimdLevel( void )
+    {
+        // AVX also needs the OS to save the upper halves of the YMM registers
+        int CpuInfo[4];
+        __cpuid(CpuInfo, 1);
+        const bool HasAVX = (CpuInfo[2] & (1 << 28)) != 0;
+        const bool HasOSXSave = (CpuInfo[2] & (1 << 27)) != 0;
+        const bool HasFMA = (CpuInfo[2] & (1 << 12)) != 0;
+        if (!HasAVX || !HasOSXSave || (_xgetbv(0) & 6) != 6)
+            return kSimdSSE2;
+
+        __cpuidex(CpuInfo, 7, 0);
+        const bool HasAVX2 = (CpuInfo[1] & (1 << 5)) != 0;
+        return HasAVX2 && HasFMA ? kSimdAVX2 : kSimdAVX;
+    }
+
+    // Reads the three floats alone, for the last position of a stream
+    __m128 LoadPosition( const uint8_t* Position )
+    {
+        const float* P = (const float*)Position;
+        return _mm_movelh_ps(_mm_castpd_ps(_mm_load_sd((const double*)P)), _mm_load_ss(P + 2));
+    }
+
+    // Every position but the last is read along with the float after it, which still lies in the stream
+    void ComputeBoundsSSE( const uint8_t* Positions, uint32_t Stride, uint32_t Count, __m128& MinBound, __m128& MaxBound )
+    {
+        __m128 Min0 = _mm_set1_ps(FLT_MAX), Min1 = Min0;
+        __m128 Max0 = _mm_set1_ps(-FLT_MAX), Max1 = Max0;
+
+        uint32_t i = 0;
+        for (; i + 2 < Count; i += 2)
+        {
+            const __m128 P0 = _mm_loadu_ps((const float*)(Positions + i * Stride));
+            const __m128 P1 = _mm_loadu_ps((const float*)(Positions + (i + 1) * Stride));
+            Min0 = _mm_min_ps(Min0, P0); Max0 = _mm_max_ps(Max0, P0);
+            Min1 = _mm_min_ps(Min1, P1); Max1 = _mm_max_ps(Max1, P1);
+        }
+        for (; i + 1 < Count; ++i)
+        {
+            const __m128 P = _mm_loadu_ps((const float*)(Positions + i * Stride));
+            Min0 = _mm_min_ps(Min0, P); Max0 = _mm_max_ps(Max0, P);
+        }
+
+        const __m128 Last = LoadPosition(Positions + (Count - 1) * Stride);
+        MinBound = _mm_min_ps(_mm_min_ps(Min0, Min1), Last);
+        MaxBound = _mm_max_ps(_mm_max_ps(Max0, Max1), Last);
+    }
+
+    // Two positions share a register, and two registers of them are in flight to hide the latency
+    void ComputeBoundsAVX( const uint8_t* Positions, uint32_t Stride, uint32_t Count, __m128& MinBound, __m128& MaxBound )
+    {
+        __m256 Min0 = _mm256_set1_ps(FLT_MAX), Min1 = Min0;
+        __m256 Max0 = _mm256_set1_ps(-FLT_MAX), Max1 = Max0;
+
+        uint32_t i = 0;
+        for (; i + 4 < Count; i += 4)
+        {
+            const uint8_t* P = Positions + i * Stride;
+            const __m256 P01 = _mm256_loadu2_m128((const float*)(P + Stride), (const float*)P);
+            const __m256 P23 = _mm256_loadu2_m128((const float*)(P + 3 * Stride), (const float*)(P + 2 * Stride));
+            Min0 = _mm256_min_ps(Min0, P01); Max0 = _mm256_max_ps(Max0, P01);
+            Min1 = _mm256_min_ps(Min1, P23); Max1 = _mm256_max_ps(Max1, P23);
+        }
+
+        const __m256 Min = _mm256_min_ps(Min0, Min1);
+        const __m256 Max = _mm256_max_ps(Max0, Max1);
+        __m128 TailMin, TailMax;
+        ComputeBoundsSSE(Positions + i * Stride, Stride, Count - i, TailMin, TailMax);
+        MinBound = _mm_min_ps(_mm_min_ps(_mm256_castps256_ps128(Min), _mm256_extractf128_ps(Min, 1)), TailMin);
+        MaxBound = _mm_max_ps(_mm_max_ps(_mm256_castps256_ps128(Max), _mm256_extractf128_ps(Max, 1)), TailMax);
+
+        _mm256_zeroupper();
+    }
+
+    // The clip position of a corner is that of the center plus or minus the extent along each of the box axes.
+    // Depth is reversed, so the nearest depth is the largest, and a depth past 1 is in front of the near plane.
+    void ProjectBoxesSSE( const float* M, const AABBSoA& Boxes, uint32_t Count, ProjectedBoxSoA& Out )
+    {
+        __m128 Row[4][4];
+        for (int r = 0; r < 4; ++r)
+            for (int c = 0; c < 4; ++c)
+                Row[r][c] = _mm_set1_ps(M[r * 4 + c]);
+
+        const __m128 Zero = _mm_setzero_ps();
+        const __m128 Half = _mm_set1_ps(0.5f);
+        const __m128 NegHalf = _mm_set1_ps(-0.5f);
+        const __m128 Crossed = _mm_set1_ps(-FLT_MAX);
+
+        for (uint32_t First = 0; First < Count; First += 4)
+        {
+            const __m128 CenterX = _mm_loadu_ps(Boxes.CenterX.data() + First);
+            const __m128 CenterY = _mm_loadu_ps(Boxes.CenterY.data() + First);
+            const __m128 CenterZ = _mm_loadu_ps(Boxes.CenterZ.data() + First);
+            const __m128 ExtentX = _mm_loadu_ps(Boxes.ExtentX.data() + First);
+            const __m128 ExtentY = _mm_loadu_ps(Boxes.ExtentY.data() + First);
+            const __m128 ExtentZ = _mm_loadu_ps(Boxes.ExtentZ.data() + First);
+
+            __m128 Base[4], AxisX[4], AxisY[4], AxisZ[4];
+            for (int c = 0; c < 4; ++c)
+            {
+                Base[c] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(CenterX, Row[0][c]), _mm_mul_ps(CenterY, Row[1][c])),
+                    _mm_add_ps(_mm_mul_ps(CenterZ, Row[2][c]), Row[3][c]));
+                AxisX[c] = _mm_mul_ps(ExtentX, Row[0][c]);
+                AxisY[c] = _mm_mul_ps(ExtentY, Row[1][c]);
+                AxisZ[c] = _mm_mul_ps(ExtentZ, Row[2][c]);
+            }
+
+            __m128 MinU = _mm_set1_ps(FLT_MAX), MinV = MinU;
+            __m128 MaxU = _mm_set1_ps(-FLT_MAX), MaxV = MaxU;
+            __m128 NearestDepth = Zero;
+            __m128 Crossing = Zero;
+            for (uint32_t Corner = 0; Corner < 8; ++Corner)
+            {
+                __m128 Clip[4];
+                for (int c = 0; c < 4; ++c)
+                {
+                    __m128 Value = Corner & 1 ? _mm_add_ps(Base[c], AxisX[c]) : _mm_sub_ps(Base[c], AxisX[c]);
+                    Value = Corner & 2 ? _mm_add_ps(Value, AxisY[c]) : _mm_sub_ps(Value, AxisY[c]);
+                    Clip[c] = Corner & 4 ? _mm_add_ps(Value, AxisZ[c]) : _mm_sub_ps(Value, AxisZ[c]);
+                }
+                Crossing = _mm_or_ps(Crossing, _mm_or_ps(_mm_cmple_ps(Clip[3], Zero), _mm_cmpge_ps(Clip[2], Clip[3])));
+
+                const __m128 RcpW = _mm_div_ps(_mm_set1_ps(1.0f), Clip[3]);
+                const __m128 U = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(Clip[0], RcpW), Half), Half);
+                const __m128 V = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(Clip[1], RcpW), NegHalf), Half);
+                MinU = _mm_min_ps(MinU, U); MaxU = _mm_max_ps(MaxU, U);
+                MinV = _mm_min_ps(MinV, V); MaxV = _mm_max_ps(MaxV, V);
+                NearestDepth = _mm_max_ps(NearestDepth, _mm_mul_ps(Clip[2], RcpW));
+            }
+
+            MinU = _mm_or_ps(_mm_andnot_ps(Crossing, MinU), _mm_and_ps(Crossing, Crossed));
+            _mm_storeu_ps(Out.MinU.data() + First, MinU);
+            _mm_storeu_ps(Out.MinV.data() + First, MinV);
+            _mm_storeu_ps(Out.MaxU.data() + First, MaxU);
+            _mm_storeu_ps(Out.MaxV.data() + First, MaxV);
+            _mm_storeu_ps(Out.NearestDepth.data() + First, NearestDepth);
+        }
+    }
+
+    void ProjectBoxesAVX2( const float* M, const AABBSoA& Boxes, uint32_t Count, ProjectedBoxSoA& Out )
+    {
+        __m256 Row[4][4];
+        for (int r = 0; r < 4; ++r)
+            for (int c = 0; c < 4; ++c)
+                Row[r][c] = _mm256_set1_ps(M[r * 4 + c]);
+
+        const __m256 Zero = _mm256_setzero_ps();
+        const __m256 Half = _mm256_set1_ps(0.5f);
+        const __m256 NegHalf = _mm256_set1_ps(-0.5f);
+        const __m256 Crossed = _mm256_set1_ps(-FLT_MAX);
+
+        for (uint32_t First = 0; First < Count; First += 8)
+        {
+            const __m256 CenterX = _mm256_loadu_ps(Boxes.CenterX.data() + First);
+            const __m256 CenterY = _mm256_loadu_ps(Boxes.CenterY.data() + First);
+            const __m256 CenterZ = _mm256_loadu_ps(Boxes.CenterZ.data() + First);
+            const __m256 ExtentX = _mm256_loadu_ps(Boxes.ExtentX.data() + First);
+            const __m256 ExtentY = _mm256_loadu_ps(Boxes.ExtentY.data() + First);
+            const __m256 ExtentZ = _mm256_loadu_ps(Boxes.ExtentZ.data() + First);
+
+            __m256 Base[4], AxisX[4], AxisY[4], AxisZ[4];
+            for (int c = 0; c < 4; ++c)
+            {
+                Base[c] = _mm256_fmadd_ps(CenterX, Row[0][c], _mm256_fmadd_ps(CenterY, Row[1][c],
+                    _mm256_fmadd_ps(CenterZ, Row[2][c], Row[3][c])));
+                AxisX[c] = _mm256_mul_ps(ExtentX, Row[0][c]);
+                AxisY[c] = _mm256_mul_ps(ExtentY, Row[1][c]);
+                AxisZ[c] = _mm256_mul_ps(ExtentZ, Row[2][c]);
+            }
+
+            __m256 MinU = _mm256_set1_ps(FLT_MAX), MinV = MinU;
+            __m256 MaxU = _mm256_set1_ps(-FLT_MAX), MaxV = MaxU;
+            __m256 NearestDepth = Zero;
+            __m256 Crossing = Zero;
+            for (uint32_t Corner = 0; Corner < 8; ++Corner)
+            {
+                __m256 Clip[4];
+                for (int c = 0; c < 4; ++c)
+                {
+                    __m256 Value = Corner & 1 ? _mm256_add_ps(Base[c], AxisX[c]) : _mm256_sub_ps(Base[c], AxisX[c]);
+                    Value = Corner & 2 ? _mm256_add_ps(Value, AxisY[c]) : _mm256_sub_ps(Value, AxisY[c]);
+                    Clip[c] = Corner & 4 ? _mm256_add_ps(Value, AxisZ[c]) : _mm256_sub_ps(Value, AxisZ[c]);
+                }
+                Crossing = _mm256_or_ps(Crossing, _mm256_or_ps(_mm256_cmp_ps(Clip[3], Zero, _CMP_LE_OQ),
+                    _mm256_cmp_ps(Clip[2], Clip[3], _CMP_GE_OQ)));
+
+                const __m256 RcpW = _mm256_div_ps(_mm256_set1_ps(1.0f), Clip[3]);
+                const __m256 U = _mm256_fmadd_ps(_mm256_mul_ps(Clip[0], RcpW), Half, Half);
+                const __m256 V = _mm256_fmadd_ps(_mm256_mul_ps(Clip[1], RcpW), NegHalf, Half);
+                MinU = _mm256_min_ps(MinU, U); MaxU = _mm256_max_ps(MaxU, U);
+                MinV = _mm256_min_ps(MinV, V); MaxV = _mm256_max_ps(MaxV, V);
+                NearestDepth = _mm256_max_ps(NearestDepth, _mm256_mul_ps(Clip[2], RcpW));
+            }
+
+            _mm256_storeu_ps(Out.MinU.data() + First, _mm256_blendv_ps(MinU, Crossed, Crossing));
+            _mm256_storeu_ps(Out.MinV.data() + First, MinV);
+            _mm256_storeu_ps(Out.MaxU.data() + First, MaxU);
+            _mm256_storeu_ps(Out.MaxV.data() + First, MaxV);
+            _mm256_storeu_ps(Out.NearestDepth.data() + First, NearestDepth);
+        }
+
+        // Avoid the penalty of switching back to legacy SSE code with dirty upper halves
+        _mm256_zeroupper();
+    }
+}
+
+SimdLevel Math::GetSimdLevel( void )
+{
+    static const SimdLevel s_Level = DetectSimdLevel();
+    return s_Level;
+}
+
+void Math::ComputeBounds( const float* positions, uint32_t stride, uint32_t count, Vector3& minBound, Vector3& maxBound )
+{
+    ASSERT(count > 0 && stride >= 3 * sizeof(float));
+
+    __m128 MinBound, MaxBound;
+    if (GetSimdLevel() >= kSimdAVX)
+        ComputeBoundsAVX((const uint8_t*)positions, stride, count, MinBound, MaxBound);
+    else
+        ComputeBoundsSSE((const uint8_t*)positions, stride, count, MinBound, MaxBound);
+
+    // The fourth lane held whatever followed each position.  Like the Vector3 constructor, repeat Z there.
+    minBound = Vector3(XMVectorSwizzle<0, 1, 2, 2>(MinBound));
+    maxBound = Vector3(XMVectorSwizzle<0, 1, 2, 2>(MaxBound));
+}
+
+void ProjectedBoxSoA::Resize( uint32_t count )
+{
+    const uint32_t PaddedCount = (count + kBatchSize - 1) / kBatchSize * kBatchSize;
+    MinU.assign(PaddedCount, 0.0f);
+    MinV.assign(PaddedCount, 0.0f);
+    MaxU.assign(PaddedCount, 0.0f);
+    MaxV.assign(PaddedCount, 0.0f);
+    NearestDepth.assign(PaddedCount, 0.0f);
+}
+
+void Math::ProjectBoxes( const Matrix4& viewProj, const AABBSoA& boxes, uint32_t count, ProjectedBoxSoA& projected )
+{
+    ASSERT(count <= boxes.CenterX.size() && boxes.CenterX.size() <= projected.MinU.size());
+
+    const float* M = (const float*)&viewProj;
+    if (GetSimdLevel() >= kSimdAVX2)
+        ProjectBoxesAVX2(M, boxes, count, projected);
+    else
+        ProjectBoxesSSE(M, boxes, count, projected);
+}
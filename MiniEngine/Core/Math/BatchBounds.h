@@ -0,0 +1,44 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Kernels that work on many points or boxes at once, for model loading and culling.  Each picks the widest
+// instruction set the CPU supports when it is called, so the libraries still run on CPUs without AVX.
+//
+
+#pragma once
+
+#include "Frustum.h"
+
+namespace Math
+{
+    enum SimdLevel
+    {
+        kSimdSSE2,      // Every x64 CPU
+        kSimdAVX,       // 8-wide floats, when the OS saves the YMM registers too
+        kSimdAVX2       // 8-wide floats with FMA
+    };
+
+    SimdLevel GetSimdLevel( void );
+
+    // The bounds of count positions of three floats each, one every stride bytes.  Count must not be zero.
+    void ComputeBounds( const float* positions, uint32_t stride, uint32_t count, Vector3& minBound, Vector3& maxBound );
+
+    // The screen rectangles of boxes seen through a view projection, with UVs running right and down from the
+    // top left and the nearest of the reversed depths.  A box that crosses the near plane is in front of
+    // everything, so its MinU is -FLT_MAX.  The arrays are padded like a box batch.
+    struct ProjectedBoxSoA
+    {
+        void Resize( uint32_t count );
+
+        std::vector<float> MinU, MinV, MaxU, MaxV;
+        std::vector<float> NearestDepth;
+    };
+
+    void ProjectBoxes( const Matrix4& viewProj, const AABBSoA& boxes, uint32_t count, ProjectedBoxSoA& projected );
+
+} // namespace Math
@@ -13,10 +13,206 @@
 
 #include "pch.h"
 #include "Frustum.h"
+#include "BatchBounds.h"
 #include "Camera.h"
+#include <immintrin.h>
 
 using namespace Math;
 
+namespace
+{
+    // The frustum planes one component at a time, along with the absolute values of the normals, which scale
+    // the extents of a box into its radius along the normal
+    struct BatchPlanes
+    {
+        float X[6], Y[6], Z[6], W[6];
+        float AbsX[6], AbsY[6], AbsZ[6];
+    };
+
+    // Volumes are given as center and extent arrays.  Spheres only have the first extent, their radius.
+    struct BatchVolumes
+    {
+        const float* CenterX;
+        const float* CenterY;
+        const float* CenterZ;
+        const float* ExtentX;
+        const float* ExtentY;
+        const float* ExtentZ;
+    };
+
+    template <bool Spheres>
+    void IntersectSSE( const BatchPlanes& Planes, const BatchVolumes& Volumes, uint32_t Count, uint64_t* VisibleMask )
+    {
+        __m128 PlaneX[6], PlaneY[6], PlaneZ[6], PlaneW[6], AbsX[6], AbsY[6], AbsZ[6];
+        for (int i = 0; i < 6; ++i)
+        {
+            PlaneX[i] = _mm_set1_ps(Planes.X[i]);
+            PlaneY[i] = _mm_set1_ps(Planes.Y[i]);
+            PlaneZ[i] = _mm_set1_ps(Planes.Z[i]);
+            PlaneW[i] = _mm_set1_ps(Planes.W[i]);
+            AbsX[i] = _mm_set1_ps(Planes.AbsX[i]);
+            AbsY[i] = _mm_set1_ps(Planes.AbsY[i]);
+            AbsZ[i] = _mm_set1_ps(Planes.AbsZ[i]);
+        }
+
+        const __m128 Zero = _mm_setzero_ps();
+        for (uint32_t First = 0; First < Count; First += 4)
+        {
+            const __m128 CenterX = _mm_loadu_ps(Volumes.CenterX + First);
+            const __m128 CenterY = _mm_loadu_ps(Volumes.CenterY + First);
+            const __m128 CenterZ = _mm_loadu_ps(Volumes.CenterZ + First);
+            const __m128 ExtentX = _mm_loadu_ps(Volumes.ExtentX + First);
+            const __m128 ExtentY = Spheres ? Zero : _mm_loadu_ps(Volumes.ExtentY + First);
+            const __m128 ExtentZ = Spheres ? Zero : _mm_loadu_ps(Volumes.ExtentZ + First);
+
+            __m128 Outside = Zero;
+            for (int i = 0; i < 6; ++i)
+            {
+                __m128 Distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(CenterX, PlaneX[i]), _mm_mul_ps(CenterY, PlaneY[i])),
+                    _mm_add_ps(_mm_mul_ps(CenterZ, PlaneZ[i]), PlaneW[i]));
+                __m128 Radius = Spheres ? ExtentX : _mm_add_ps(_mm_add_ps(_mm_mul_ps(ExtentX, AbsX[i]),
+                    _mm_mul_ps(ExtentY, AbsY[i])), _mm_mul_ps(ExtentZ, AbsZ[i]));
+                Outside = _mm_or_ps(Outside, _mm_cmplt_ps(_mm_add_ps(Distance, Radius), Zero));
+            }
+
+            const uint64_t Visible = ~_mm_movemask_ps(Outside) & 0xF;
+            VisibleMask[First / 64] |= Visible << (First % 64);
+        }
+    }
+
+    template <bool Spheres>
+    void IntersectAVX( const BatchPlanes& Planes, const BatchVolumes& Volumes, uint32_t Count, uint64_t* VisibleMask )
+    {
+        __m256 PlaneX[6], PlaneY[6], PlaneZ[6], PlaneW[6], AbsX[6], AbsY[6], AbsZ[6];
+        for (int i = 0; i < 6; ++i)
+        {
+            PlaneX[i] = _mm256_set1_ps(Planes.X[i]);
+            PlaneY[i] = _mm256_set1_ps(Planes.Y[i]);
+            PlaneZ[i] = _mm256_set1_ps(Planes.Z[i]);
+            PlaneW[i] = _mm256_set1_ps(Planes.W[i]);
+            AbsX[i] = _mm256_set1_ps(Planes.AbsX[i]);
+            AbsY[i] = _mm256_set1_ps(Planes.AbsY[i]);
+            AbsZ[i] = _mm256_set1_ps(Planes.AbsZ[i]);
+        }
+
+        const __m256 Zero = _mm256_setzero_ps();
+        for (uint32_t First = 0; First < Count; First += 8)
+        {
+            const __m256 CenterX = _mm256_loadu_ps(Volumes.CenterX + First);
+            const __m256 CenterY = _mm256_loadu_ps(Volumes.CenterY + First);
+            const __m256 CenterZ = _mm256_loadu_ps(Volumes.CenterZ + First);
+            const __m256 ExtentX = _mm256_loadu_ps(Volumes.ExtentX + First);
+            const __m256 ExtentY = Spheres ? Zero : _mm256_loadu_ps(Volumes.ExtentY + First);
+            const __m256 ExtentZ = Spheres ? Zero : _mm256_loadu_ps(Volumes.ExtentZ + First);
+
+            __m256 Outside = Zero;
+            for (int i = 0; i < 6; ++i)
+            {
+                __m256 Distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(CenterX, PlaneX[i]), _mm256_mul_ps(CenterY, PlaneY[i])),
+                    _mm256_add_ps(_mm256_mul_ps(CenterZ, PlaneZ[i]), PlaneW[i]));
+                __m256 Radius = Spheres ? ExtentX : _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ExtentX, AbsX[i]),
+                    _mm256_mul_ps(ExtentY, AbsY[i])), _mm256_mul_ps(ExtentZ, AbsZ[i]));
+                Outside = _mm256_or_ps(Outside, _mm256_cmp_ps(_mm256_add_ps(Distance, Radius), Zero, _CMP_LT_OQ));
+            }
+
+            const uint64_t Visible = ~_mm256_movemask_ps(Outside) & 0xFF;
+            VisibleMask[First / 64] |= Visible << (First % 64);
+        }
+
+        // Avoid the penalty of switching back to legacy SSE code with dirty upper halves
+        _mm256_zeroupper();
+    }
+
+    template <bool Spheres>
+    void IntersectBatch( const BoundingPlane* FrustumPlanes, const BatchVolumes& Volumes, uint32_t Count, uint64_t* VisibleMask )
+    {
+        const uint32_t NumWords = (Count + 63) / 64;
+        for (uint32_t i = 0; i < NumWords; ++i)
+            VisibleMask[i] = 0;
+        if (Count == 0)
+            return;
+
+        BatchPlanes Planes;
+        for (int i = 0; i < 6; ++i)
+        {
+            Vector4 Plane = FrustumPlanes[i];
+            Planes.X[i] = Plane.GetX();
+            Planes.Y[i] = Plane.GetY();
+            Planes.Z[i] = Plane.GetZ();
+            Planes.W[i] = Plane.GetW();
+            Planes.AbsX[i] = fabsf(Planes.X[i]);
+            Planes.AbsY[i] = fabsf(Planes.Y[i]);
+            Planes.AbsZ[i] = fabsf(Planes.Z[i]);
+        }
+
+        if (GetSimdLevel() >= kSimdAVX)
+            IntersectAVX<Spheres>(Planes, Volumes, Count, VisibleMask);
+        else
+            IntersectSSE<Spheres>(Planes, Volumes, Count, VisibleMask);
+
+        // The padding past the end of the volumes is tested too
+        if (Count % 64 != 0)
+            VisibleMask[NumWords - 1] &= (1ull << (Count % 64)) - 1;
+    }
+}
+
+void AABBSoA::Resize( uint32_t count )
+{
+    const uint32_t PaddedCount = (count + kBatchSize - 1) / kBatchSize * kBatchSize;
+    CenterX.assign(PaddedCount, 0.0f);
+    CenterY.assign(PaddedCount, 0.0f);
+    CenterZ.assign(PaddedCount, 0.0f);
+    ExtentX.assign(PaddedCount, 0.0f);
+    ExtentY.assign(PaddedCount, 0.0f);
+    ExtentZ.assign(PaddedCount, 0.0f);
+}
+
+void AABBSoA::Set( uint32_t index, Vector3 minBound, Vector3 maxBound )
+{
+    Vector3 Center = (minBound + maxBound) * 0.5f;
+    Vector3 Extent = (maxBound - minBound) * 0.5f;
+    CenterX[index] = Center.GetX();
+    CenterY[index] = Center.GetY();
+    CenterZ[index] = Center.GetZ();
+    ExtentX[index] = Extent.GetX();
+    ExtentY[index] = Extent.GetY();
+    ExtentZ[index] = Extent.GetZ();
+}
+
+void SphereSoA::Resize( uint32_t count )
+{
+    const uint32_t PaddedCount = (count + kBatchSize - 1) / kBatchSize * kBatchSize;
+    CenterX.assign(PaddedCount, 0.0f);
+    CenterY.assign(PaddedCount, 0.0f);
+    CenterZ.assign(PaddedCount, 0.0f);
+    Radius.assign(PaddedCount, 0.0f);
+}
+
+void SphereSoA::Set( uint32_t index, BoundingSphere sphere )
+{
+    Vector3 Center = sphere.GetCenter();
+    CenterX[index] = Center.GetX();
+    CenterY[index] = Center.GetY();
+    CenterZ[index] = Center.GetZ();
+    Radius[index] = sphere.GetRadius();
+}
+
+void Frustum::IntersectBoxes( const AABBSoA& boxes, uint32_t count, uint64_t* visibleMask ) const
+{
+    ASSERT(count <= boxes.CenterX.size());
+    BatchVolumes Volumes = { boxes.CenterX.data(), boxes.CenterY.data(), boxes.CenterZ.data(),
+        boxes.ExtentX.data(), boxes.ExtentY.data(), boxes.ExtentZ.data() };
+    IntersectBatch<false>(m_FrustumPlanes, Volumes, count, visibleMask);
+}
+
+void Frustum::IntersectSpheres( const SphereSoA& spheres, uint32_t count, uint64_t* visibleMask ) const
+{
+    ASSERT(count <= spheres.CenterX.size());
+    BatchVolumes Volumes = { spheres.CenterX.data(), spheres.CenterY.data(), spheres.CenterZ.data(),
+        spheres.Radius.data(), nullptr, nullptr };
+    IntersectBatch<true>(m_FrustumPlanes, Volumes, count, visibleMask);
+}
+
 void Frustum::ConstructPerspectiveFrustum( float HTan, float VTan, float NearClip, float FarClip )
 {
     const float NearX = HTan * NearClip;
@@ -15,9 +15,32 @@
 
 #include "BoundingPlane.h"
 #include "BoundingSphere.h"
+#include <vector>
 
 namespace Math
 {
+    // Bounding volumes laid out for the batch frustum tests, with each component in its own array.  Boxes are
+    // kept as centers and half extents.  The arrays are padded to a multiple of kBatchSize with empty volumes.
+    enum { kBatchSize = 8 };
+
+    struct AABBSoA
+    {
+        void Resize( uint32_t count );
+        void Set( uint32_t index, Vector3 minBound, Vector3 maxBound );
+
+        std::vector<float> CenterX, CenterY, CenterZ;
+        std::vector<float> ExtentX, ExtentY, ExtentZ;
+    };
+
+    struct SphereSoA
+    {
+        void Resize( uint32_t count );
+        void Set( uint32_t index, BoundingSphere sphere );
+
+        std::vector<float> CenterX, CenterY, CenterZ;
+        std::vector<float> Radius;
+    };
+
     class Frustum
     {
     public:
@@ -47,6 +70,11 @@ namespace Math
         // simple struct in the Model project.)
         bool IntersectBoundingBox(const Vector3 minBound, const Vector3 maxBound) const;
 
+        // Batch versions of the tests above.  Bit i of visibleMask is set when volume i intersects the frustum,
+        // so it needs (count + 63) / 64 words.  Uses AVX when the CPU supports it and SSE otherwise.
+        void IntersectBoxes( const AABBSoA& boxes, uint32_t count, uint64_t* visibleMask ) const;
+        void IntersectSpheres( const SphereSoA& spheres, uint32_t count, uint64_t* visibleMask ) const;
+
         friend Frustum  operator* ( const OrthogonalTransform& xform, const Frustum& frustum );    // Fast
         friend Frustum  operator* ( const AffineTransform& xform, const Frustum& frustum );        // Slow
         friend Frustum  operator* ( const Matrix4& xform, const Frustum& frustum );                // Slowest (and most general)
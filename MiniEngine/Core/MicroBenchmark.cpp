@@ -0,0 +1,437 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "pch.h"
+#include "MicroBenchmark.h"
+#include "GraphicsCore.h"
+#include "GraphicsCommon.h"
+#include "BufferManager.h"
+#include "CommandContext.h"
+#include "LinearAllocator.h"
+#include "PipelineState.h"
+#include "RootSignature.h"
+#include "GpuBuffer.h"
+#include "Camera.h"
+#include "SystemTime.h"
+#include "EngineTuning.h"
+#include "Hash.h"
+#include "Math/Random.h"
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+#include "CompiledShaders/ScreenQuadVS.h"
+
+using namespace Graphics;
+using namespace Math;
+using namespace std;
+
+namespace MicroBenchmark
+{
+    const double kMinBatchTime = 0.1;           // Seconds
+    const uint64_t kMaxIterations = 1000000000;
+    const uint32_t kRepetitions = 5;
+
+    // Recording cases submit their context every so many iterations, as a frame would, so that command lists
+    // and upload pages stay the size they are in practice
+    const uint64_t kIterationsPerContext = 1024;
+
+    struct Case
+    {
+        string Name;
+        CaseFunc Body;
+        uint64_t ItemsPerIteration;
+    };
+
+    vector<Case> s_Cases;
+    bool s_EngineCasesAdded = false;
+    bool s_Finished = false;
+
+    // Results are added to this, so that the work that produced them is not optimized away
+    volatile size_t s_Sink = 0;
+
+    void RunCallback( void* ) { Run(L"MicroBenchmark.json"); }
+    CallbackTrigger RunTrigger("Profiling/Run CPU Microbenchmarks", RunCallback);
+
+    // What the engine cases record with.  The PSO has no pixel shader or targets, so the draws cost the GPU
+    // next to nothing.
+    RootSignature s_RootSignature;
+    GraphicsPSO s_PSOs[2];
+    ByteAddressBuffer s_Buffers[16];
+
+    void CreateResources( void );
+    void DestroyResources( void );
+    void AddEngineCases( void );
+
+    double TimeBatch( const Case& Bench, uint64_t Iterations );
+    void WriteReport( ofstream& File, const vector<vector<double>>& Times, const vector<uint64_t>& Iterations );
+}
+
+void MicroBenchmark::Register( const string& Name, const CaseFunc& Body, uint64_t ItemsPerIteration )
+{
+    s_Cases.push_back({ Name, Body, ItemsPerIteration });
+}
+
+void MicroBenchmark::Initialize( void )
+{
+#if WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_DESKTOP)
+    const wchar_t* Arg = wcsstr(GetCommandLineW(), L"-microbench");
+    if (Arg == nullptr)
+        return;
+
+    // The report file is the next argument, unless that is another option
+    wstring ReportFile;
+    Arg += wcslen(L"-microbench");
+    while (*Arg == L' ')
+        ++Arg;
+    if (*Arg == L'"')
+    {
+        for (++Arg; *Arg != L'\0' && *Arg != L'"'; ++Arg)
+            ReportFile += *Arg;
+    }
+    else if (*Arg != L'-')
+    {
+        for (; *Arg != L'\0' && *Arg != L' '; ++Arg)
+            ReportFile += *Arg;
+    }
+
+    Run(ReportFile.empty() ? L"MicroBenchmark.json" : ReportFile);
+    s_Finished = true;
+#endif
+}
+
+bool MicroBenchmark::IsFinished( void )
+{
+    return s_Finished;
+}
+
+void MicroBenchmark::CreateResources( void )
+{
+    s_RootSignature.Reset(3, 0);
+    s_RootSignature[0].InitAsConstants(0, 4);
+    s_RootSignature[1].InitAsConstantBuffer(1);
+    s_RootSignature[2].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 0, 8);
+    s_RootSignature.Finalize(L"Microbenchmark", D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
+
+    // Two PSOs that differ, so that draws can switch between them
+    for (uint32_t i = 0; i < 2; ++i)
+    {
+        s_PSOs[i].SetRootSignature(s_RootSignature);
+        s_PSOs[i].SetRasterizerState(i == 0 ? RasterizerDefault : RasterizerTwoSided);
+        s_PSOs[i].SetBlendState(BlendDisable);
+        s_PSOs[i].SetDepthStencilState(DepthStateDisabled);
+        s_PSOs[i].SetSampleMask(0xFFFFFFFF);
+        s_PSOs[i].SetInputLayout(0, nullptr);
+        s_PSOs[i].SetPrimitiveTopologyType(D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE);
+        s_PSOs[i].SetVertexShader(g_pScreenQuadVS, sizeof(g_pScreenQuadVS));
+        s_PSOs[i].SetRenderTargetFormats(0, nullptr, DXGI_FORMAT_UNKNOWN);
+        s_PSOs[i].Finalize();
+    }
+
+    for (uint32_t i = 0; i < _countof(s_Buffers); ++i)
+        s_Buffers[i].Create(L"Microbenchmark Buffer", 64, sizeof(uint32_t));
+
+    PSO::WaitForCompilation();
+}
+
+void MicroBenchmark::DestroyResources( void )
+{
+    g_CommandManager.IdleGPU();
+
+    for (uint32_t i = 0; i < _countof(s_Buffers); ++i)
+        s_Buffers[i].Destroy();
+}
+
+void MicroBenchmark::AddEngineCases( void )
+{
+    if (s_EngineCasesAdded)
+        return;
+    s_EngineCasesAdded = true;
+
+    // Sub-allocations the size of a draw's constants from a private allocator.  Its pages are retired as a
+    // context's would be when it finishes.
+    Register("LinearAllocator/Allocate/256B", []( uint64_t Iterations )
+    {
+        LinearAllocator Allocator(kCpuWritable);
+        for (uint64_t i = 0; i < Iterations; ++i)
+        {
+            s_Sink += (size_t)Allocator.Allocate(256).DataPtr;
+            if ((i + 1) % kIterationsPerContext == 0)
+                Allocator.CleanupUsedPages(g_CommandManager.GetGraphicsQueue().IncrementFence());
+        }
+        Allocator.CleanupUsedPages(g_CommandManager.GetGraphicsQueue().IncrementFence());
+    });
+
+    // Eight SRVs staged in the dynamic descriptor heap, then copied to the shader visible heap by the draw
+    Register("DynamicDescriptorHeap/StageAndCommit/8 SRVs", []( uint64_t Iterations )
+    {
+        D3D12_CPU_DESCRIPTOR_HANDLE Handles[8];
+        for (uint32_t i = 0; i < 8; ++i)
+            Handles[i] = s_Buffers[i].GetSRV();
+
+        GraphicsContext* Context = &GraphicsContext::Begin(L"Microbenchmark");
+        for (uint64_t i = 0; i < Iterations; ++i)
+        {
+            if (i % kIterationsPerContext == 0)
+            {
+                Context->SetRootSignature(s_RootSignature);
+                Context->SetPipelineState(s_PSOs[0]);
+                Context->SetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+                Context->SetViewportAndScissor(0, 0, 1, 1);
+            }
+
+            Context->SetDynamicDescriptors(2, 0, 8, Handles);
+            Context->Draw(3);
+
+            if ((i + 1) % kIterationsPerContext == 0)
+            {
+                Context->Finish();
+                Context = &GraphicsContext::Begin(L"Microbenchmark");
+            }
+        }
+        Context->Finish();
+    }, 8);
+
+    // The hash every Finalize() takes of a graphics pipeline description
+    Register("Utility/HashState/GraphicsPSODesc", []( uint64_t Iterations )
+    {
+        D3D12_GRAPHICS_PIPELINE_STATE_DESC Desc = {};
+        Desc.BlendState = BlendDisable;
+        Desc.RasterizerState = RasterizerDefault;
+        Desc.DepthStencilState = DepthStateDisabled;
+        Desc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+        for (uint64_t i = 0; i < Iterations; ++i)
+        {
+            Desc.SampleMask = (UINT)i;
+            s_Sink += Utility::HashState(&Desc);
+        }
+    });
+
+    // Finalizing a PSO that is already in the cache, as code that builds its PSOs on the fly does
+    Register("PSO/Finalize/CacheHit", []( uint64_t Iterations )
+    {
+        GraphicsPSO PSO = s_PSOs[1];
+        for (uint64_t i = 0; i < Iterations; ++i)
+            PSO.Finalize();
+        s_Sink += (size_t)PSO.GetPipelineStateObject();
+    });
+
+    // The state a typical draw sets:  its PSO, root constants and dynamic constants
+    Register("GraphicsContext/SetStateAndDraw", []( uint64_t Iterations )
+    {
+        __declspec(align(16)) float Constants[16] = {};
+
+        GraphicsContext* Context = &GraphicsContext::Begin(L"Microbenchmark");
+        for (uint64_t i = 0; i < Iterations; ++i)
+        {
+            if (i % kIterationsPerContext == 0)
+            {
+                Context->SetRootSignature(s_RootSignature);
+                Context->SetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+                Context->SetViewportAndScissor(0, 0, 1, 1);
+            }
+
+            Constants[0] = (float)i;
+            Context->SetPipelineState(s_PSOs[i & 1]);
+            Context->SetConstants(0, (uint32_t)i, 1, 2, 3);
+            Context->SetDynamicConstantBufferView(1, sizeof(Constants), Constants);
+            Context->Draw(3);
+
+            if ((i + 1) % kIterationsPerContext == 0)
+            {
+                Context->Finish();
+                Context = &GraphicsContext::Begin(L"Microbenchmark");
+            }
+        }
+        Context->Finish();
+    });
+
+    // Sixteen buffers switched between UAV and SRV, the batch the context holds before it flushes
+    Register("CommandContext/TransitionResource/16 Buffers", []( uint64_t Iterations )
+    {
+        CommandContext* Context = &CommandContext::Begin(L"Microbenchmark");
+        for (uint64_t i = 0; i < Iterations; ++i)
+        {
+            const D3D12_RESOURCE_STATES State = (i & 1) ? D3D12_RESOURCE_STATE_UNORDERED_ACCESS :
+                D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE;
+            for (uint32_t b = 0; b < _countof(s_Buffers); ++b)
+                Context->TransitionResource(s_Buffers[b], State);
+            Context->FlushResourceBarriers();
+
+            if ((i + 1) % kIterationsPerContext == 0)
+            {
+                Context->Finish();
+                Context = &CommandContext::Begin(L"Microbenchmark");
+            }
+        }
+        Context->Finish();
+    }, _countof(s_Buffers));
+
+    // Culling a scattered set of objects, of which about half are in view
+    struct CullingScene
+    {
+        Camera View;
+        vector<Vector3> Min, Max;
+        vector<BoundingSphere> Spheres;
+    };
+    shared_ptr<CullingScene> Scene = make_shared<CullingScene>();
+    Scene->View.SetEyeAtUp(Vector3(kZero), Vector3(0.0f, 0.0f, -1.0f), Vector3(kYUnitVector));
+    Scene->View.Update();
+
+    RandomNumberGenerator RNG;
+    RNG.SetSeed(1);
+    for (uint32_t i = 0; i < 1024; ++i)
+    {
+        const Vector3 Center(RNG.NextFloat(-400.0f, 400.0f), RNG.NextFloat(-400.0f, 400.0f), RNG.NextFloat(-900.0f, 100.0f));
+        const float Radius = RNG.NextFloat(1.0f, 20.0f);
+        Scene->Min.push_back(Center - Vector3(Radius));
+        Scene->Max.push_back(Center + Vector3(Radius));
+        Scene->Spheres.push_back(BoundingSphere(Center, Scalar(Radius)));
+    }
+
+    Register("Math/Frustum/IntersectBoundingBox", [Scene]( uint64_t Iterations )
+    {
+        const Frustum& ViewFrustum = Scene->View.GetWorldSpaceFrustum();
+        size_t Visible = 0;
+        for (uint64_t i = 0; i < Iterations; ++i)
+        {
+            const size_t Object = i % Scene->Min.size();
+            Visible += ViewFrustum.IntersectBoundingBox(Scene->Min[Object], Scene->Max[Object]) ? 1 : 0;
+        }
+        s_Sink += Visible;
+    });
+
+    Register("Math/Frustum/IntersectSphere", [Scene]( uint64_t Iterations )
+    {
+        const Frustum& ViewFrustum = Scene->View.GetWorldSpaceFrustum();
+        size_t Visible = 0;
+        for (uint64_t i = 0; i < Iterations; ++i)
+            Visible += ViewFrustum.IntersectSphere(Scene->Spheres[i % Scene->Spheres.size()]) ? 1 : 0;
+        s_Sink += Visible;
+    });
+}
+
+double MicroBenchmark::TimeBatch( const Case& Bench, uint64_t Iterations )
+{
+    const int64_t StartTick = SystemTime::GetCurrentTick();
+    Bench.Body(Iterations);
+    const int64_t EndTick = SystemTime::GetCurrentTick();
+    return SystemTime::TimeBetweenTicks(StartTick, EndTick);
+}
+
+void MicroBenchmark::Run( const wstring& ReportFile )
+{
+    CreateResources();
+    AddEngineCases();
+
+    vector<vector<double>> Times(s_Cases.size());
+    vector<uint64_t> Iterations(s_Cases.size());
+
+    for (size_t c = 0; c < s_Cases.size(); ++c)
+    {
+        const Case& Bench = s_Cases[c];
+
+        // Grow the batch until it takes long enough to time, aiming a little past the minimum as Google Benchmark
+        // does, so that the next try is likely the last
+        uint64_t Count = 1;
+        for (;;)
+        {
+            const double Seconds = TimeBatch(Bench, Count);
+            if (Seconds >= kMinBatchTime || Count >= kMaxIterations)
+                break;
+
+            const double Multiplier = Seconds <= kMinBatchTime / 10.0 ? 10.0 : kMinBatchTime * 1.4 / Seconds;
+            Count = min(max((uint64_t)(Count * Multiplier), Count + 1), kMaxIterations);
+        }
+
+        Iterations[c] = Count;
+        for (uint32_t r = 0; r < kRepetitions; ++r)
+            Times[c].push_back(TimeBatch(Bench, Count) * 1e9 / Count);
+
+        vector<double> Sorted = Times[c];
+        sort(Sorted.begin(), Sorted.end());
+        Utility::Printf("%-48s %12.1f ns  %12llu iterations\n", Bench.Name.c_str(), Sorted[kRepetitions / 2], Count);
+    }
+
+    DestroyResources();
+
+    ofstream File(ReportFile, ios::out);
+    if (!File)
+    {
+        Utility::Printf(L"Unable to write %s\n", ReportFile.c_str());
+        return;
+    }
+    WriteReport(File, Times, Iterations);
+    Utility::Printf(L"Microbenchmarks finished, wrote %s\n", ReportFile.c_str());
+}
+
+void MicroBenchmark::WriteReport( ofstream& File, const vector<vector<double>>& Times, const vector<uint64_t>& Iterations )
+{
+    char Date[64];
+    const time_t Now = time(nullptr);
+    tm LocalTime;
+    localtime_s(&LocalTime, &Now);
+    strftime(Date, sizeof(Date), "%Y-%m-%dT%H:%M:%S", &LocalTime);
+
+#ifdef RELEASE
+    const char* BuildType = "release";
+#else
+    const char* BuildType = "debug";
+#endif
+
+    File.precision(3);
+    File << fixed << "{\n  \"context\": {\n    \"date\": \"" << Date << "\",\n    \"num_cpus\": " <<
+        thread::hardware_concurrency() << ",\n    \"library_build_type\": \"" << BuildType << "\"\n  },\n  \"benchmarks\": [";
+
+    bool First = true;
+    auto WriteRun = [&]( size_t c, const string& Name, const char* Aggregate, uint32_t Repetition, uint64_t Count, double Time )
+    {
+        const Case& Bench = s_Cases[c];
+        File << (First ? "\n" : ",\n") << "    {\n      \"name\": \"" << Name << "\",\n      \"family_index\": " << c <<
+            ",\n      \"run_name\": \"" << Bench.Name << "\",\n      \"run_type\": \"" << (Aggregate ? "aggregate" : "iteration") <<
+            "\",\n      \"repetitions\": " << kRepetitions << ",\n      \"threads\": 1";
+        if (Aggregate)
+            File << ",\n      \"aggregate_name\": \"" << Aggregate << "\"";
+        else
+            File << ",\n      \"repetition_index\": " << Repetition;
+        File << ",\n      \"iterations\": " << Count << ",\n      \"real_time\": " << Time << ",\n      \"cpu_time\": " << Time <<
+            ",\n      \"time_unit\": \"ns\"";
+        if (Time > 0.0)
+            File << ",\n      \"items_per_second\": " << Bench.ItemsPerIteration * 1e9 / Time;
+        File << "\n    }";
+        First = false;
+    };
+
+    for (size_t c = 0; c < s_Cases.size(); ++c)
+    {
+        const vector<double>& Samples = Times[c];
+        for (uint32_t r = 0; r < kRepetitions; ++r)
+            WriteRun(c, s_Cases[c].Name, nullptr, r, Iterations[c], Samples[r]);
+
+        double Mean = 0.0;
+        for (double Sample : Samples)
+            Mean += Sample / kRepetitions;
+
+        double Variance = 0.0;
+        for (double Sample : Samples)
+            Variance += (Sample - Mean) * (Sample - Mean) / (kRepetitions - 1);
+
+        vector<double> Sorted = Samples;
+        sort(Sorted.begin(), Sorted.end());
+
+        WriteRun(c, s_Cases[c].Name + "_mean", "mean", 0, kRepetitions, Mean);
+        WriteRun(c, s_Cases[c].Name + "_median", "median", 0, kRepetitions, Sorted[kRepetitions / 2]);
+        WriteRun(c, s_Cases[c].Name + "_stddev", "stddev", 0, kRepetitions, sqrt(Variance));
+    }
+
+    File << "\n  ]\n}\n";
+}
@@ -0,0 +1,44 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Microbenchmarks of the CPU side of the engine:  the linear allocator, descriptor staging, state hashing and
+// PSO lookup, command recording, resource barriers and frustum tests.  Any application runs them with
+// -microbench [Report.json] on the command line, after its startup, and then exits, or from the menu with
+// "Profiling/Run CPU Microbenchmarks".
+//
+// Each case runs in batches of iterations that grow until a batch takes kMinBatchTime, and then repeats at that
+// count.  The report is in the JSON format of Google Benchmark, with every repetition and the mean, median and
+// standard deviation of each case, so that its compare.py can diff two runs, such as before and after a change.
+// Times are wall clock, which is also reported as the CPU time, so runs should be made on an idle machine.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+namespace MicroBenchmark
+{
+    // Runs the given number of iterations of a case.  Items are what each iteration processes, for the rate.
+    typedef std::function<void(uint64_t Iterations)> CaseFunc;
+
+    // Cases added beyond the engine's own, before Run() is called
+    void Register( const std::string& Name, const CaseFunc& Body, uint64_t ItemsPerIteration = 1 );
+
+    // Checks the command line, and runs the cases and writes the report when it asks for them.  Called once by
+    // GameCore after the application has started.
+    void Initialize( void );
+
+    // Set once the cases of -microbench have run and the application should exit
+    bool IsFinished( void );
+
+    // Runs every case and writes the report to the file.  Needs the graphics device and no other thread recording.
+    void Run( const std::wstring& ReportFile );
+
+} // namespace MicroBenchmark
@@ -20,14 +20,21 @@
 #include "Camera.h"
 #include "PostEffects.h"
 #include "SystemTime.h"
+#include "DynamicResolution.h"
+#include "TemporalEffects.h"
 
 #include "CompiledShaders/ScreenQuadVS.h"
 #include "CompiledShaders/CameraMotionBlurPrePassCS.h"
 #include "CompiledShaders/CameraMotionBlurPrePassLinearZCS.h"
 #include "CompiledShaders/MotionBlurPrePassCS.h"
+#include "CompiledShaders/MotionBlurPrePassUniformCS.h"
 #include "CompiledShaders/MotionBlurFinalPassCS.h"
+#include "CompiledShaders/MotionBlurFinalPassUniformCS.h"
+#include "CompiledShaders/MotionBlurTileMaxCS.h"
+#include "CompiledShaders/MotionBlurNeighborMaxCS.h"
 #include "CompiledShaders/MotionBlurFinalPassPS.h"
 #include "CompiledShaders/CameraVelocityCS.h"
+#include "CompiledShaders/CameraVelocityHalfCS.h"
 #include "CompiledShaders/TemporalBlendCS.h"
 #include "CompiledShaders/BoundNeighborhoodCS.h"
 
@@ -40,10 +47,22 @@ namespace MotionBlur
 
     RootSignature s_RootSignature;
     ComputePSO s_CameraMotionBlurPrePassCS[2];
-    ComputePSO s_MotionBlurPrePassCS;
-    ComputePSO s_MotionBlurFinalPassCS;
+    ComputePSO s_MotionBlurPrePassCS[2];        // For complex and uniform tiles
+    ComputePSO s_MotionBlurFinalPassCS[2];      // For complex and uniform tiles
     GraphicsPSO s_MotionBlurFinalPassPS;
     ComputePSO s_CameraVelocityCS[2];
+    ComputePSO s_CameraVelocityHalfCS;          // Also writes the closest velocity of each 2x2 quad
+    ComputePSO s_MotionBlurTileMaxCS;           // Finds the max and min speed of each 16x16 tile
+    ComputePSO s_MotionBlurNeighborMaxCS;       // Sorts the tiles that blur into the uniform and complex queues
+
+    // The pre-pass of the uniform and complex queues, then their final pass
+    IndirectArgsBuffer s_IndirectParameters;
+
+    // The frame whose camera velocity pass last wrote g_VelocityBufferHalf
+    uint64_t s_HalfResVelocityFrame = ~0ull;
+
+    void ClassifyTiles( ComputeContext& Context, ColorBuffer& VelocityBuffer );
+    void BlurTiles( ComputeContext& Context, ColorBuffer& VelocityBuffer );
 }
 
 void MotionBlur::Initialize( void )
@@ -63,7 +82,8 @@ void MotionBlur::Initialize( void )
 
     if (g_bTypedUAVLoadSupport_R11G11B10_FLOAT)
     {
-        CreatePSO(s_MotionBlurFinalPassCS, g_pMotionBlurFinalPassCS);
+        CreatePSO(s_MotionBlurFinalPassCS[0], g_pMotionBlurFinalPassCS);
+        CreatePSO(s_MotionBlurFinalPassCS[1], g_pMotionBlurFinalPassUniformCS);
     }
     else
     {
@@ -82,15 +102,86 @@ void MotionBlur::Initialize( void )
     }
     CreatePSO( s_CameraMotionBlurPrePassCS[0], g_pCameraMotionBlurPrePassCS );
     CreatePSO( s_CameraMotionBlurPrePassCS[1], g_pCameraMotionBlurPrePassLinearZCS );
-    CreatePSO( s_MotionBlurPrePassCS, g_pMotionBlurPrePassCS );
+    CreatePSO( s_MotionBlurPrePassCS[0], g_pMotionBlurPrePassCS );
+    CreatePSO( s_MotionBlurPrePassCS[1], g_pMotionBlurPrePassUniformCS );
     CreatePSO( s_CameraVelocityCS[0], g_pCameraVelocityCS );
     CreatePSO( s_CameraVelocityCS[1], g_pCameraVelocityCS );
+    CreatePSO( s_CameraVelocityHalfCS, g_pCameraVelocityHalfCS );
+    CreatePSO( s_MotionBlurTileMaxCS, g_pMotionBlurTileMaxCS );
+    CreatePSO( s_MotionBlurNeighborMaxCS, g_pMotionBlurNeighborMaxCS );
 
 #undef CreatePSO
+
+    __declspec(align(16)) const uint32_t initArgs[12] = { 0, 1, 1, 0, 1, 1, 0, 4, 1, 0, 4, 1 };
+    s_IndirectParameters.Create(L"Motion Blur Indirect Parameters", 4, sizeof(D3D12_DISPATCH_ARGUMENTS), initArgs);
 }
 
 void MotionBlur::Shutdown( void )
 {
+    s_IndirectParameters.Destroy();
+}
+
+// Static tiles, which have nothing fast enough to blur within two tiles, are left out of both queues.  The
+// passes that follow cost nothing for them.
+void MotionBlur::ClassifyTiles( ComputeContext& Context, ColorBuffer& VelocityBuffer )
+{
+    ScopedTimer _prof(L"Motion Blur Tiling", Context);
+
+    uint32_t TiledWidth = g_MotionTileMax.GetWidth();
+    uint32_t TiledHeight = g_MotionTileMax.GetHeight();
+
+    // One group per tile
+    Context.TransitionResource(VelocityBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    Context.TransitionResource(g_MotionTileMax, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    Context.SetPipelineState(s_MotionBlurTileMaxCS);
+    Context.SetDynamicDescriptor(3, 0, VelocityBuffer.GetSRV());
+    Context.SetDynamicDescriptor(2, 0, g_MotionTileMax.GetUAV());
+    Context.Dispatch(TiledWidth, TiledHeight);
+
+    Context.ResetCounter(g_MotionUniformQueue);
+    Context.ResetCounter(g_MotionComplexQueue);
+
+    Context.TransitionResource(g_MotionTileMax, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    Context.TransitionResource(g_MotionUniformQueue, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    Context.TransitionResource(g_MotionComplexQueue, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    Context.SetPipelineState(s_MotionBlurNeighborMaxCS);
+    Context.SetConstants(0, TiledWidth, TiledHeight);
+    Context.SetDynamicDescriptor(3, 0, g_MotionTileMax.GetSRV());
+    Context.SetDynamicDescriptor(2, 0, g_MotionUniformQueue.GetUAV());
+    Context.SetDynamicDescriptor(2, 1, g_MotionComplexQueue.GetUAV());
+    Context.Dispatch2D(TiledWidth, TiledHeight);
+
+    Context.TransitionResource(g_MotionUniformQueue, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    Context.TransitionResource(g_MotionComplexQueue, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    Context.CopyCounter(s_IndirectParameters, 0, g_MotionUniformQueue);
+    Context.CopyCounter(s_IndirectParameters, 12, g_MotionComplexQueue);
+    Context.CopyCounter(s_IndirectParameters, 24, g_MotionUniformQueue);
+    Context.CopyCounter(s_IndirectParameters, 36, g_MotionComplexQueue);
+    Context.TransitionResource(s_IndirectParameters, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT);
+}
+
+// The final pass over the classified tiles, four groups to a tile.  The queues hold different tiles, so their
+// dispatches need no barrier between them.
+void MotionBlur::BlurTiles( ComputeContext& Context, ColorBuffer& VelocityBuffer )
+{
+    Context.SetConstants(0, 1.0f / g_SceneColorBuffer.GetWidth(), 1.0f / g_SceneColorBuffer.GetHeight());
+
+    Context.TransitionResource(g_SceneColorBuffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    Context.TransitionResource(VelocityBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    Context.TransitionResource(g_MotionPrepBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    Context.SetDynamicDescriptor(2, 0, g_SceneColorBuffer.GetUAV());
+    Context.SetDynamicDescriptor(3, 0, VelocityBuffer.GetSRV());
+    Context.SetDynamicDescriptor(3, 1, g_MotionPrepBuffer.GetSRV());
+
+    Context.SetPipelineState(s_MotionBlurFinalPassCS[1]);
+    Context.SetDynamicDescriptor(3, 2, g_MotionUniformQueue.GetSRV());
+    Context.DispatchIndirect(s_IndirectParameters, 24);
+
+    Context.SetPipelineState(s_MotionBlurFinalPassCS[0]);
+    Context.SetDynamicDescriptor(3, 2, g_MotionComplexQueue.GetSRV());
+    Context.DispatchIndirect(s_IndirectParameters, 36);
+
+    Context.InsertUAVBarrier(g_SceneColorBuffer);
 }
 
 // Linear Z ends up being faster since we haven't officially decompressed the depth buffer.  You 
@@ -111,8 +202,9 @@ void MotionBlur::GenerateCameraVelocityBuffer( CommandContext& BaseContext, cons
 
     Context.SetRootSignature(s_RootSignature);
 
-    uint32_t Width = g_SceneColorBuffer.GetWidth();
-    uint32_t Height = g_SceneColorBuffer.GetHeight();
+    // Velocities are in pixels of the render size
+    uint32_t Width = DynamicResolution::GetWidth();
+    uint32_t Height = DynamicResolution::GetHeight();
 
     float RcpHalfDimX = 2.0f / Width;
     float RcpHalfDimY = 2.0f / Height;
@@ -143,10 +235,24 @@ void MotionBlur::GenerateCameraVelocityBuffer( CommandContext& BaseContext, cons
     else
         Context.TransitionResource(g_SceneDepthBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
 
-    Context.SetPipelineState(s_CameraVelocityCS[UseLinearZ ? 1 : 0]);
+    // Picking the closest pixel of a quad needs linear Z
+    const bool WriteHalfRes = UseLinearZ && TemporalEffects::UsesHalfResVelocity();
+    if (WriteHalfRes)
+        Context.TransitionResource(g_VelocityBufferHalf, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+
+    Context.SetPipelineState(WriteHalfRes ? s_CameraVelocityHalfCS : s_CameraVelocityCS[UseLinearZ ? 1 : 0]);
     Context.SetDynamicDescriptor(3, 0, UseLinearZ ? LinearDepth.GetSRV() : g_SceneDepthBuffer.GetDepthSRV());
     Context.SetDynamicDescriptor(2, 0, g_VelocityBuffer.GetUAV());
+    if (WriteHalfRes)
+        Context.SetDynamicDescriptor(2, 1, g_VelocityBufferHalf.GetUAV());
     Context.Dispatch2D(Width, Height);
+
+    s_HalfResVelocityFrame = WriteHalfRes ? Graphics::GetFrameCount() : ~0ull;
+}
+
+bool MotionBlur::HasHalfResVelocity( void )
+{
+    return s_HalfResVelocityFrame == Graphics::GetFrameCount();
 }
 
 
@@ -165,12 +271,16 @@ void MotionBlur::RenderCameraBlur( CommandContext& BaseContext, const Matrix4& r
     ComputeContext& Context = BaseContext.GetComputeContext();
 
     Context.SetRootSignature(s_RootSignature);
+    g_FrameGraph.BeginPass(Context, kMotionBlurPass);
 
+    // Velocities are in pixels of the render size, while the blur passes still cover the whole buffer
     uint32_t Width = g_SceneColorBuffer.GetWidth();
     uint32_t Height = g_SceneColorBuffer.GetHeight();
+    uint32_t RenderWidth = DynamicResolution::GetWidth();
+    uint32_t RenderHeight = DynamicResolution::GetHeight();
 
-    float RcpHalfDimX = 2.0f / Width;
-    float RcpHalfDimY = 2.0f / Height;
+    float RcpHalfDimX = 2.0f / RenderWidth;
+    float RcpHalfDimY = 2.0f / RenderHeight;
     float RcpZMagic = nearClip / (farClip - nearClip);
 
     Matrix4 preMult = Matrix4(
@@ -209,21 +319,11 @@ void MotionBlur::RenderCameraBlur( CommandContext& BaseContext, const Matrix4& r
         Context.SetDynamicDescriptor(2, 1, g_VelocityBuffer.GetUAV());
         Context.Dispatch2D(g_MotionPrepBuffer.GetWidth(), g_MotionPrepBuffer.GetHeight());
 
+        // The pre-pass writes the velocities, so it still covers the whole screen
         if (g_bTypedUAVLoadSupport_R11G11B10_FLOAT)
         {
-            Context.SetPipelineState(s_MotionBlurFinalPassCS);
-            Context.SetConstants(0, 1.0f / Width, 1.0f / Height);
-
-            Context.TransitionResource(g_SceneColorBuffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
-            Context.TransitionResource(g_VelocityBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
-            Context.TransitionResource(g_MotionPrepBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
-            Context.SetDynamicDescriptor(2, 0, g_SceneColorBuffer.GetUAV());
-            Context.SetDynamicDescriptor(3, 0, g_VelocityBuffer.GetSRV());
-            Context.SetDynamicDescriptor(3, 1, g_MotionPrepBuffer.GetSRV());
-
-            Context.Dispatch2D(Width, Height);
-
-            Context.InsertUAVBarrier(g_SceneColorBuffer);
+            ClassifyTiles(Context, g_VelocityBuffer);
+            BlurTiles(Context, g_VelocityBuffer);
         }
         else
         {
@@ -246,7 +346,7 @@ void MotionBlur::RenderCameraBlur( CommandContext& BaseContext, const Matrix4& r
         Context.SetPipelineState(s_CameraVelocityCS[UseLinearZ ? 1 : 0]);
         Context.SetDynamicDescriptor(3, 0, UseLinearZ ? LinearDepth.GetSRV() : g_SceneDepthBuffer.GetDepthSRV());
         Context.SetDynamicDescriptor(2, 0, g_VelocityBuffer.GetUAV());
-        Context.Dispatch2D(Width, Height);
+        Context.Dispatch2D(RenderWidth, RenderHeight);
     }
 }
 
@@ -263,34 +363,29 @@ void MotionBlur::RenderObjectBlur( CommandContext& BaseContext, ColorBuffer& vel
     ComputeContext& Context = BaseContext.GetComputeContext();
 
     Context.SetRootSignature(s_RootSignature);
+    g_FrameGraph.BeginPass(Context, kMotionBlurPass);
 
+    ClassifyTiles(Context, velocityBuffer);
+
+    // Only the tiles that a blur can reach get prep texels, and those of uniform tiles skip the velocities
     Context.TransitionResource(g_MotionPrepBuffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
     Context.TransitionResource(g_SceneColorBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
-    Context.TransitionResource(velocityBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
 
     Context.SetDynamicDescriptor(2, 0, g_MotionPrepBuffer.GetUAV());
     Context.SetDynamicDescriptor(3, 0, g_SceneColorBuffer.GetSRV());
     Context.SetDynamicDescriptor(3, 1, velocityBuffer.GetSRV());
 
-    Context.SetPipelineState(s_MotionBlurPrePassCS);
-    Context.Dispatch2D(g_MotionPrepBuffer.GetWidth(), g_MotionPrepBuffer.GetHeight());
+    Context.SetPipelineState(s_MotionBlurPrePassCS[1]);
+    Context.SetDynamicDescriptor(3, 2, g_MotionUniformQueue.GetSRV());
+    Context.DispatchIndirect(s_IndirectParameters, 0);
+
+    Context.SetPipelineState(s_MotionBlurPrePassCS[0]);
+    Context.SetDynamicDescriptor(3, 2, g_MotionComplexQueue.GetSRV());
+    Context.DispatchIndirect(s_IndirectParameters, 12);
 
     if (g_bTypedUAVLoadSupport_R11G11B10_FLOAT)
     {
-        Context.SetPipelineState(s_MotionBlurFinalPassCS);
-
-        Context.TransitionResource(g_SceneColorBuffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
-        Context.TransitionResource(velocityBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
-        Context.TransitionResource(g_MotionPrepBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
-
-        Context.SetDynamicDescriptor(2, 0, g_SceneColorBuffer.GetUAV());
-        Context.SetDynamicDescriptor(3, 0, velocityBuffer.GetSRV());
-        Context.SetDynamicDescriptor(3, 1, g_MotionPrepBuffer.GetSRV());
-        Context.SetConstants(0, 1.0f / Width, 1.0f / Height);
-
-        Context.Dispatch2D(Width, Height);
-
-        Context.InsertUAVBarrier(g_SceneColorBuffer);
+        BlurTiles(Context, velocityBuffer);
     }
     else
     {
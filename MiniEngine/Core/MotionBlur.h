@@ -30,6 +30,10 @@ namespace MotionBlur
     void GenerateCameraVelocityBuffer( CommandContext& Context, const Math::Camera& camera, bool UseLinearZ = true );
     void GenerateCameraVelocityBuffer( CommandContext& Context, const Math::Matrix4& reprojectionMatrix, float nearClip, float farClip, bool UseLinearZ = true);
 
+    // Whether this frame's camera velocity also filled g_VelocityBufferHalf, which it does with linear Z when
+    // TemporalEffects::UsesHalfResVelocity()
+    bool HasHalfResVelocity( void );
+
     // Generate motion blur only associated with the camera.  Does not handle fast-moving objects well, but
     // does not require a full screen velocity buffer.
     void RenderCameraBlur( CommandContext& Context, const Math::Camera& camera, bool UseLinearZ = true );
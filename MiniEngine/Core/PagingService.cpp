@@ -0,0 +1,175 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "pch.h"
+#include "PagingService.h"
+#include "GraphicsCore.h"
+#include <dxgi1_4.h>
+#include <algorithm>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace Graphics;
+using Microsoft::WRL::ComPtr;
+
+namespace PagingService
+{
+    // The size the driver gives an allocation can differ from the kernel's, so some room is always kept, and
+    // more of it for each priority below critical
+    const uint64_t kMinBudgetMargin = 1 * 1024 * 1024;
+    const uint64_t kBudgetMarginPerPriority = 8 * 1024 * 1024;
+
+    struct Client
+    {
+        uint32_t Id;
+        Priority Priority;
+        TrimCallback Trim;
+    };
+
+    ComPtr<IDXGIAdapter3> s_Adapter;
+    DWORD s_BudgetCookie = 0;
+
+    // The budget event is signaled by the kernel, and the quit event by Shutdown()
+    enum WakeReason { kWakeBudgetChange, kWakeQuit, kNumWakeReasons };
+    HANDLE s_WakeEvents[kNumWakeReasons] = {};
+    std::thread s_PagingThread;
+
+    // Held while the callbacks run, so that none is called after its client unregisters
+    std::mutex s_ClientMutex;
+    std::vector<Client> s_Clients;
+    uint32_t s_NextClientId = 1;
+
+    bool QueryLocalMemory( DXGI_QUERY_VIDEO_MEMORY_INFO& Info );
+    void PagingThreadMain( void );
+    void TrimToBudget( void );
+}
+
+using namespace PagingService;
+
+void PagingService::Initialize( void )
+{
+    ComPtr<IDXGIFactory4> Factory;
+    if (FAILED(CreateDXGIFactory2(0, MY_IID_PPV_ARGS(&Factory))) ||
+        FAILED(Factory->EnumAdapterByLuid(g_Device->GetAdapterLuid(), MY_IID_PPV_ARGS(&s_Adapter))))
+    {
+        Utility::Print("The video memory budget cannot be queried, so streamed data will not be trimmed to it\n");
+        s_Adapter = nullptr;
+        return;
+    }
+
+    for (uint32_t i = 0; i < kNumWakeReasons; ++i)
+    {
+        s_WakeEvents[i] = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+        ASSERT(s_WakeEvents[i] != nullptr);
+    }
+
+    // The kernel signals the event whenever it recalculates the budget
+    ASSERT_SUCCEEDED(s_Adapter->RegisterVideoMemoryBudgetChangeNotificationEvent(s_WakeEvents[kWakeBudgetChange], &s_BudgetCookie));
+
+    s_PagingThread = std::thread(PagingThreadMain);
+}
+
+void PagingService::Shutdown( void )
+{
+    if (s_Adapter == nullptr)
+        return;
+
+    SetEvent(s_WakeEvents[kWakeQuit]);
+    s_PagingThread.join();
+
+    s_Adapter->UnregisterVideoMemoryBudgetChangeNotification(s_BudgetCookie);
+    s_BudgetCookie = 0;
+
+    for (uint32_t i = 0; i < kNumWakeReasons; ++i)
+    {
+        CloseHandle(s_WakeEvents[i]);
+        s_WakeEvents[i] = nullptr;
+    }
+
+    s_Clients.clear();
+    s_Adapter = nullptr;
+}
+
+uint32_t PagingService::RegisterClient( Priority Priority, const TrimCallback& Trim )
+{
+    ASSERT(Priority < kNumPriorities);
+
+    std::lock_guard<std::mutex> LockGuard(s_ClientMutex);
+    const uint32_t Id = s_NextClientId++;
+    s_Clients.push_back({ Id, Priority, Trim });
+    return Id;
+}
+
+void PagingService::UnregisterClient( uint32_t ClientId )
+{
+    std::lock_guard<std::mutex> LockGuard(s_ClientMutex);
+    for (auto Iter = s_Clients.begin(); Iter != s_Clients.end(); ++Iter)
+    {
+        if (Iter->Id == ClientId)
+        {
+            s_Clients.erase(Iter);
+            return;
+        }
+    }
+}
+
+bool PagingService::FitsInBudget( uint64_t NumBytes, Priority Priority )
+{
+    DXGI_QUERY_VIDEO_MEMORY_INFO Info;
+    if (Priority == kPriorityCritical || !QueryLocalMemory(Info))
+        return true;
+
+    const uint64_t Margin = kMinBudgetMargin + kBudgetMarginPerPriority * Priority;
+    return Info.CurrentUsage + NumBytes + Margin <= Info.Budget;
+}
+
+bool PagingService::QueryLocalMemory( DXGI_QUERY_VIDEO_MEMORY_INFO& Info )
+{
+    return s_Adapter != nullptr && SUCCEEDED(s_Adapter->QueryVideoMemoryInfo(0, DXGI_MEMORY_SEGMENT_GROUP_LOCAL, &Info)) &&
+        Info.Budget > 0;
+}
+
+void PagingService::PagingThreadMain( void )
+{
+    for (;;)
+    {
+        const DWORD WaitResult = WaitForMultipleObjects(kNumWakeReasons, s_WakeEvents, FALSE, INFINITE);
+        if (WaitResult != WAIT_OBJECT_0 + kWakeBudgetChange)
+            break;
+
+        TrimToBudget();
+    }
+}
+
+// Clients of the same priority are asked in the order they registered
+void PagingService::TrimToBudget( void )
+{
+    DXGI_QUERY_VIDEO_MEMORY_INFO Info;
+    if (!QueryLocalMemory(Info) || Info.CurrentUsage <= Info.Budget)
+        return;
+
+    uint64_t BytesToFree = Info.CurrentUsage - Info.Budget + kMinBudgetMargin;
+    Utility::Printf("Video memory budget lowered to %llu MB, trimming %llu MB of streamed data\n",
+        Info.Budget >> 20, BytesToFree >> 20);
+
+    std::lock_guard<std::mutex> LockGuard(s_ClientMutex);
+    for (int Level = kNumPriorities - 1; Level >= 0 && BytesToFree > 0; --Level)
+    {
+        for (const Client& C : s_Clients)
+        {
+            if (C.Priority != Level)
+                continue;
+
+            BytesToFree -= std::min(C.Trim(BytesToFree), BytesToFree);
+            if (BytesToFree == 0)
+                break;
+        }
+    }
+}
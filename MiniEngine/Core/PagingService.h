@@ -0,0 +1,40 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Keeps streamed data within the process's local video memory budget.  Streaming features register as clients
+// with a priority.  A thread of its own waits for the budget change notifications of the adapter, and when the
+// process uses more than its new budget, asks the clients to trim, lowest priority first, until they have agreed
+// to free enough.  Before a client grows, it asks whether the memory fits.  Each priority below critical keeps
+// a larger margin under the budget, so that unimportant data cannot crowd out what is on screen, and critical
+// data, the minimum needed to show anything, is never refused.
+//
+
+#pragma once
+
+#include "pch.h"
+#include <functional>
+
+namespace PagingService
+{
+    enum Priority { kPriorityCritical, kPriorityHigh, kPriorityNormal, kPriorityLow, kNumPriorities };
+
+    // Called on the paging thread with the bytes to free, and returns how many of them the client will free.
+    // The memory may be released later, from any thread.
+    typedef std::function<uint64_t(uint64_t BytesToFree)> TrimCallback;
+
+    void Initialize( void );
+    void Shutdown( void );
+
+    // Trim callbacks are not called once unregistering returns.  Callbacks may not register or unregister.
+    uint32_t RegisterClient( Priority Priority, const TrimCallback& Trim );
+    void UnregisterClient( uint32_t ClientId );
+
+    // Whether the process may allocate this many bytes more of local video memory at the given priority.  It is
+    // always true when the budget cannot be queried.
+    bool FitsInBudget( uint64_t NumBytes, Priority Priority );
+}
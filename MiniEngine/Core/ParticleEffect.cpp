@@ -26,17 +26,18 @@ using namespace ParticleEffects;
 
 namespace ParticleEffects
 {
-    extern ComputePSO s_ParticleSpawnCS;
-    extern ComputePSO s_ParticleUpdateCS;
-    extern ComputePSO s_ParticleDispatchIndirectArgsCS;
-    extern StructuredBuffer SpriteVertexBuffer;
     extern RandomNumberGenerator s_RNG;
+    uint32_t AllocateSpawnData(const ParticleSpawnData* SpawnData, uint32_t Count);
 }
 
-ParticleEffect::ParticleEffect(ParticleEffectProperties& effectProperties)
+ParticleEffect::ParticleEffect(ParticleEffectProperties& effectProperties, UINT effectID)
 {
     m_ElapsedTime = 0.0;
     m_EffectProperties = effectProperties;
+    m_effectID = effectID;
+    m_SpawnDataBase = 0;
+    m_SpawnDataCount = 0;
+    m_BoundingRadius = 0.0f;
 }
 
 inline static Color RandColor( Color c0, Color c1 )
@@ -90,20 +91,23 @@ void ParticleEffect::LoadDeviceResources(ID3D12Device* device)
         SpawnData.Random = s_RNG.NextFloat();
     }
     
-    m_RandomStateBuffer.Create(L"ParticleSystem::SpawnDataBuffer", m_EffectProperties.EmitProperties.MaxParticles, sizeof(ParticleSpawnData), pSpawnData);
+    m_SpawnDataBase = AllocateSpawnData(pSpawnData, m_EffectProperties.EmitProperties.MaxParticles);
+    m_SpawnDataCount = m_SpawnDataBase == ~0u ? 0 : m_EffectProperties.EmitProperties.MaxParticles;
     _freea(pSpawnData);
 
-    m_StateBuffers[0].Create(L"ParticleSystem::Buffer0", m_EffectProperties.EmitProperties.MaxParticles, sizeof(ParticleMotion));
-    m_StateBuffers[1].Create(L"ParticleSystem::Buffer1", m_EffectProperties.EmitProperties.MaxParticles, sizeof(ParticleMotion));
-    m_CurrentStateBuffer = 0;
-
-    //DispatchIndirect args buffer / number of thread groups
-    __declspec(align(16)) UINT DispatchIndirectData[3] = { 0, 1, 1 };
-    m_DispatchIndirectArgs.Create(L"ParticleSystem::DispatchIndirectArgs", 1, sizeof(D3D12_DISPATCH_ARGUMENTS), DispatchIndirectData);
-
+    // How far a particle of a still emitter can get over its life, ignoring the floor
+    const Vector4& Velocity = m_EffectProperties.Velocity;
+    const float MaxLife = m_EffectProperties.LifeMinMax.y;
+    const float MaxSpeed = std::abs(m_EffectProperties.EmitProperties.EmitSpeed) + Length(Vector3(
+        std::max(std::abs((float)Velocity.GetX()), std::abs((float)Velocity.GetY())),
+        std::max(std::abs((float)Velocity.GetZ()), std::abs((float)Velocity.GetW())), 0.0f));
+    const float MaxFall = 0.5f * Length(Vector3(m_EffectProperties.EmitProperties.Gravity)) *
+        m_EffectProperties.MassMinMax.y * MaxLife * MaxLife;
+    m_BoundingRadius = Length(Vector3(m_EffectProperties.Spread)) + MaxSpeed * MaxLife + MaxFall +
+        std::max((float)m_EffectProperties.Size.GetY(), (float)m_EffectProperties.Size.GetW());
 }
 
-void ParticleEffect::Update(ComputeContext& CompContext,  float timeDelta)
+UINT ParticleEffect::Update(float timeDelta, ParticleEffectData& EffectData)
 {
 
     m_ElapsedTime += timeDelta;
@@ -115,46 +119,21 @@ void ParticleEffect::Update(ComputeContext& CompContext,  float timeDelta)
     //m_EffectProperties.EmitProperties.EmitPosW.z += m_EffectProperties.DirectionIncrement.z;
 
 
-    //CPU side random num gen
-    for (uint32_t i = 0; i < 64; i++)
+    EffectData.EmitProperties = m_EffectProperties.EmitProperties;
+    EffectData.SpawnDataBase = m_SpawnDataBase;
+    EffectData.SpawnDataCount = m_SpawnDataCount;
+    EffectData.BoundingRadius = m_BoundingRadius;
+
+    // Without spawn data the effect has no particles
+    if (m_SpawnDataCount == 0)
     {
-        UINT random = (UINT)s_RNG.NextInt(m_EffectProperties.EmitProperties.MaxParticles - 1);
-        m_EffectProperties.EmitProperties.RandIndex[i].x = random;
+        EffectData.EmitProperties.MaxParticles = 0;
+        return 0;
     }
-    CompContext.SetDynamicConstantBufferView(2, sizeof(EmissionProperties), &m_EffectProperties.EmitProperties);    
-
-    CompContext.TransitionResource(m_StateBuffers[m_CurrentStateBuffer], D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
-    CompContext.SetDynamicDescriptor(4, 0, m_RandomStateBuffer.GetSRV());
-    CompContext.SetDynamicDescriptor(4, 1, m_StateBuffers[m_CurrentStateBuffer].GetSRV());
 
-    m_CurrentStateBuffer ^= 1;
-
-    CompContext.ResetCounter(m_StateBuffers[m_CurrentStateBuffer]);
-
-    CompContext.SetPipelineState(s_ParticleUpdateCS);
-    CompContext.TransitionResource(m_StateBuffers[m_CurrentStateBuffer], D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
-    CompContext.TransitionResource(m_DispatchIndirectArgs, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT);
-    CompContext.SetDynamicDescriptor(3, 2, m_StateBuffers[m_CurrentStateBuffer].GetUAV());
-    CompContext.DispatchIndirect(m_DispatchIndirectArgs, 0);
-
-    // Why need a barrier here so long as we are artificially clamping particle count.  This allows living
-    // particles to take precedence over new particles.  The current system always spawns a multiple of 64
-    // particles (To Be Fixed) until the total particle count reaches maximum.
-    CompContext.InsertUAVBarrier(m_StateBuffers[m_CurrentStateBuffer]);
-    
-    // Spawn to replace dead ones 
-    CompContext.SetPipelineState(s_ParticleSpawnCS);
-    CompContext.SetDynamicDescriptor(4, 0, m_RandomStateBuffer.GetSRV());
+    // Spawn in whole waves of 64 until the effect reaches its maximum, as each effect did with a dispatch of its own
     UINT NumSpawnThreads = (UINT)(m_EffectProperties.EmitRate * timeDelta);
-    CompContext.Dispatch((NumSpawnThreads + 63) / 64, 1, 1);
-
-    // Output number of thread groups into m_DispatchIndirectArgs    
-    CompContext.SetPipelineState(s_ParticleDispatchIndirectArgsCS);
-    CompContext.TransitionResource(m_DispatchIndirectArgs, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
-    CompContext.TransitionResource(m_StateBuffers[m_CurrentStateBuffer], D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
-    CompContext.SetDynamicDescriptor(4, 0, m_StateBuffers[m_CurrentStateBuffer].GetCounterSRV(CompContext));
-    CompContext.SetDynamicDescriptor(3, 1, m_DispatchIndirectArgs.GetUAV());
-    CompContext.Dispatch(1, 1, 1);
+    return AlignUp(NumSpawnThreads, 64);
 }
 
 
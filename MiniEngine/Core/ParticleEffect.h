@@ -20,20 +20,24 @@
 class ParticleEffect 
 {
 public:
-    ParticleEffect(ParticleEffectProperties& effectProperties);
+    ParticleEffect(ParticleEffectProperties& effectProperties, UINT effectID);
     void LoadDeviceResources(ID3D12Device* device);
-    void Update(ComputeContext& CompContext, float timeDelta);
+
+    // Advances the effect and fills in what the simulation reads of it.  Returns the number of particles it
+    // tries to spawn this frame.
+    UINT Update(float timeDelta, ParticleEffectData& EffectData);
+
     float GetLifetime(){ return m_EffectProperties.TotalActiveLifetime; }
     float GetElapsedTime(){ return m_ElapsedTime; }
+    UINT GetEffectID(){ return m_effectID; }
     void Reset();
 
 private:
 
-    StructuredBuffer m_StateBuffers[2];
-    uint32_t m_CurrentStateBuffer;
-    StructuredBuffer m_RandomStateBuffer; 
-    IndirectArgsBuffer m_DispatchIndirectArgs;
-    IndirectArgsBuffer m_DrawIndirectArgs;
+    // The effect's range of the shared spawn data buffer
+    UINT m_SpawnDataBase;
+    UINT m_SpawnDataCount;
+    float m_BoundingRadius;
 
     ParticleEffectProperties m_EffectProperties;
     ParticleEffectProperties m_OriginalEffectProperties;
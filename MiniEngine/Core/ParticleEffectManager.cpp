@@ -20,16 +20,18 @@
 #include "CommandContext.h"
 #include "GameCore.h"
 #include "GraphicsCore.h"
+#include "DynamicResolution.h"
 #include "Math/Random.h"
 #include "ParticleEffectManager.h"
 #include "ParticleEffect.h"
 #include "ParticleEffectProperties.h"
+#include "ShadowBuffer.h"
+#include "ShadowCamera.h"
 #include "TextureManager.h"
 #include <mutex>
 
 #include "CompiledShaders/ParticleSpawnCS.h"
 #include "CompiledShaders/ParticleUpdateCS.h"
-#include "CompiledShaders/ParticleDispatchIndirectArgsCS.h"
 #include "CompiledShaders/ParticleFinalDispatchIndirectArgsCS.h"
 #include "CompiledShaders/ParticleLargeBinCullingCS.h"
 #include "CompiledShaders/ParticleBinCullingCS.h"
@@ -56,10 +58,15 @@
 #include "CompiledShaders/ParticlePS.h"
 #include "CompiledShaders/ParticleVS.h"
 #include "CompiledShaders/ParticleNoSortVS.h"
+#include "CompiledShaders/ParticleShadowVS.h"
+#include "CompiledShaders/ParticleShadowPS.h"
 
 #define EFFECTS_ERROR uint32_t(0xFFFFFFFF)
 
 #define MAX_TOTAL_PARTICLES 0x40000        // 256k (18-bit indices)
+#define MAX_EFFECTS 4096
+#define SIMULATION_GROUPS 128               // Of 64 threads, which loop over the particles of every effect
+#define TRANSLUCENCY_SHADOW_SIZE 512
 #define MAX_PARTICLES_PER_BIN 1024
 #define BIN_SIZE_X 128
 #define BIN_SIZE_Y 64
@@ -84,17 +91,35 @@ namespace ParticleEffects
     EnumVar TiledRes("Graphics/Particle Effects/Tiled Sample Rate", 2, 3, ResolutionLabels);
     NumVar DynamicResLevel("Graphics/Particle Effects/Dynamic Resolution Cutoff", 0.0f, -4.0f, 4.0f, 0.5f);
     NumVar MipBias("Graphics/Particle Effects/Mip Bias", 0.0f, -4.0f, 4.0f, 0.5f);
+    BoolVar CullEffects("Graphics/Particle Effects/Cull Effects", true);
+    IntVar SpawnBudget("Graphics/Particle Effects/Spawn Budget", 16384, 0, MAX_TOTAL_PARTICLES, 1024);
+    BoolVar ReceiveShadows("Graphics/Particle Effects/Receive Shadows", true);
+    BoolVar TranslucencyShadows("Graphics/Particle Effects/Translucency Shadows", false);
     
     ComputePSO s_ParticleSpawnCS;
     ComputePSO s_ParticleUpdateCS;
-    ComputePSO s_ParticleDispatchIndirectArgsCS;
 
     StructuredBuffer SpriteVertexBuffer;
     
     UINT s_ReproFrame = 0;//201;
     RandomNumberGenerator s_RNG;
+
+    uint32_t AllocateSpawnData(const ParticleSpawnData* SpawnData, uint32_t Count);
 }
 
+// Must match SimulationConstants in ParticleUpdateCommon.hlsli
+__declspec(align(16)) struct CBSimulation
+{
+    Vector4 FrustumPlanes[6];
+    uint32_t CullEffects;
+    uint32_t MaxTotalParticles;
+    uint32_t NumSimulationThreads;
+    uint32_t NumSpawnThreads;
+    uint32_t NumSpawnRanges;
+    uint32_t SpawnBudget;
+    uint32_t RandomSeed;
+};
+
 struct CBChangesPerView
 {
     Matrix4 gInvView;
@@ -114,6 +139,10 @@ struct CBChangesPerView
     uint32_t gTileRowPitch;
     uint32_t gTilesPerRow;
     uint32_t gTilesPerCol;
+
+    Matrix4 gScreenToShadow;
+    uint32_t gShadowEnable;
+    uint32_t gTranslucencyShadowEnable;
 };
 
 namespace
@@ -126,11 +155,37 @@ namespace
     ComputePSO s_ParticleTileRenderFastCS[3];     // High-Res, Low-Res, Dynamic-Res (disable depth tests)
     ComputePSO s_ParticleDepthBoundsCS;
     GraphicsPSO s_NoTileRasterizationPSO[2];
+    GraphicsPSO s_TranslucencyShadowPSO;
     ComputePSO s_ParticleSortIndirectArgsCS;
     ComputePSO s_ParticlePreSortCS;
 
     RootSignature RootSig;
 
+    // The particles of every effect live in the same buffers, and each effect has a range of the spawn data
+    StructuredBuffer StateBuffers[2];
+    uint32_t CurrentStateBuffer;
+    StructuredBuffer SpawnDataBuffer;
+    uint32_t SpawnDataCursor;
+    StructuredBuffer EffectDataBuffer;
+    StructuredBuffer SpawnRangeBuffer;
+    ByteAddressBuffer EffectCounters;       // This frame's spawn count, then the particle count of each effect
+
+    std::vector<ParticleEffectData> EffectData;
+    std::vector<XMUINT2> SpawnRanges;
+
+    Frustum CullFrustum;
+    bool HasCullFrustum = false;
+
+    // The light left after the particles that cast opacity, and the shadow depth of the one nearest the sun
+    ColorBuffer TranslucencyShadow(Color(1.0f, 1.0f, 1.0f, 1.0f));
+    ColorBuffer TranslucencyShadowDepth;
+
+    ShadowBuffer* SunShadowMap = nullptr;
+    Matrix4 SunShadowMatrix;
+    Matrix4 SunViewProj;
+    Matrix4 SunInvView;
+    D3D12_CPU_DESCRIPTOR_HANDLE ShadowSRVs[3];     // t8 through t10
+
     StructuredBuffer SpriteIndexBuffer;
     IndirectArgsBuffer SortIndirectArgs;
 
@@ -162,7 +217,7 @@ namespace
     {
         CompContext.SetPipelineState(s_ParticleFinalDispatchIndirectArgsCS);
 
-        CompContext.TransitionResource(SpriteVertexBuffer, D3D12_RESOURCE_STATE_GENERIC_READ);
+        CompContext.TransitionResource(SpriteVertexBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
         CompContext.TransitionResource(FinalDispatchIndirectArgs, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
         CompContext.TransitionResource(DrawIndirectArgs, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
         CompContext.SetDynamicDescriptor(3, 0, FinalDispatchIndirectArgs.GetUAV());
@@ -196,6 +251,119 @@ namespace
         CommandContext::InitializeTextureArraySlice(TextureArray, TextureID, ParticleTexture);
     }
 
+    void RenderTranslucencyShadow(GraphicsContext& GrContext)
+    {
+        ScopedTimer _p(L"Translucency Shadow", GrContext);
+
+        // The sprites face the sun, which looks along its shadow's view
+        CBChangesPerView SunView = s_ChangesPerView;
+        SunView.gViewProj = SunViewProj;
+        SunView.gInvView = SunInvView;
+
+        GrContext.TransitionResource(TranslucencyShadow, D3D12_RESOURCE_STATE_RENDER_TARGET);
+        GrContext.TransitionResource(TranslucencyShadowDepth, D3D12_RESOURCE_STATE_RENDER_TARGET, true);
+        GrContext.ClearColor(TranslucencyShadow);
+        GrContext.ClearColor(TranslucencyShadowDepth);
+
+        GrContext.SetRootSignature(RootSig);
+        GrContext.SetPipelineState(s_TranslucencyShadowPSO);
+        GrContext.SetDynamicConstantBufferView(1, sizeof(CBChangesPerView), &SunView);
+        GrContext.TransitionResource(SpriteVertexBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        GrContext.TransitionResource(DrawIndirectArgs, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT);
+        GrContext.TransitionResource(TextureArray, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+        GrContext.SetDynamicDescriptor(4, 0, SpriteVertexBuffer.GetSRV());
+        GrContext.SetDynamicDescriptor(4, 1, TextureArraySRV);
+
+        D3D12_CPU_DESCRIPTOR_HANDLE RTVs[] = { TranslucencyShadow.GetRTV(), TranslucencyShadowDepth.GetRTV() };
+        GrContext.SetRenderTargets(_countof(RTVs), RTVs);
+        GrContext.SetViewportAndScissor(0, 0, TRANSLUCENCY_SHADOW_SIZE, TRANSLUCENCY_SHADOW_SIZE);
+        GrContext.SetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
+        GrContext.DrawIndirect(DrawIndirectArgs);
+    }
+
+    void SimulateEffects(ComputeContext& CompContext, float timeDelta)
+    {
+        // Lay out the spawn threads of the active effects one after another.  Effects in the pool that are not
+        // active keep no MaxParticles, which retires what is left of their particles.
+        EffectData.resize(ParticleEffectsPool.size());
+        for (ParticleEffectData& Data : EffectData)
+            Data.EmitProperties.MaxParticles = 0;
+
+        SpawnRanges.clear();
+        uint32_t NumSpawnThreads = 0;
+
+        for (UINT i = 0; i < ParticleEffectsActive.size(); ++i)
+        {    
+            ParticleEffect* Effect = ParticleEffectsActive[i];
+            UINT EffectSpawnThreads = Effect->Update(timeDelta, EffectData[Effect->GetEffectID()]);
+            if (EffectSpawnThreads > 0)
+            {
+                SpawnRanges.push_back(XMUINT2(NumSpawnThreads, Effect->GetEffectID()));
+                NumSpawnThreads += EffectSpawnThreads;
+            }
+
+            if (Effect->GetLifetime() <= Effect->GetElapsedTime())
+            {
+                //Erase from vector
+                auto iter = ParticleEffectsActive.begin() + i;
+                static std::mutex s_EraseEffectMutex;
+                s_EraseEffectMutex.lock();
+                ParticleEffectsActive.erase(iter);
+                s_EraseEffectMutex.unlock();
+            }
+        }
+
+        CBSimulation Constants;
+        for (int i = 0; i < 6; ++i)
+            Constants.FrustumPlanes[i] = HasCullFrustum ? Vector4(CullFrustum.GetFrustumPlane((Frustum::PlaneID)i)) : Vector4(kZero);
+        Constants.CullEffects = CullEffects && HasCullFrustum;
+        Constants.MaxTotalParticles = MAX_TOTAL_PARTICLES;
+        Constants.NumSimulationThreads = SIMULATION_GROUPS * 64;
+        Constants.NumSpawnThreads = NumSpawnThreads;
+        Constants.NumSpawnRanges = (uint32_t)SpawnRanges.size();
+        Constants.SpawnBudget = (uint32_t)(int32_t)SpawnBudget;
+        Constants.RandomSeed = (uint32_t)s_RNG.NextInt();
+        CompContext.SetDynamicConstantBufferView(2, sizeof(CBSimulation), &Constants);
+
+        CompContext.WriteBuffer(EffectDataBuffer, 0, EffectData.data(), EffectData.size() * sizeof(ParticleEffectData));
+        if (SpawnRanges.size() > 0)
+            CompContext.WriteBuffer(SpawnRangeBuffer, 0, SpawnRanges.data(), SpawnRanges.size() * sizeof(XMUINT2));
+
+        CompContext.TransitionResource(EffectCounters, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, true);
+        CompContext.ClearUAV(EffectCounters);
+
+        CompContext.TransitionResource(SpawnDataBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        CompContext.TransitionResource(EffectDataBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        CompContext.TransitionResource(SpawnRangeBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        CompContext.TransitionResource(StateBuffers[CurrentStateBuffer], D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        CompContext.SetDynamicDescriptor(4, 0, SpawnDataBuffer.GetSRV());
+        CompContext.SetDynamicDescriptor(4, 1, StateBuffers[CurrentStateBuffer].GetSRV());
+        CompContext.SetDynamicDescriptor(4, 2, StateBuffers[CurrentStateBuffer].GetCounterSRV(CompContext));
+        CompContext.SetDynamicDescriptor(4, 3, EffectDataBuffer.GetSRV());
+        CompContext.SetDynamicDescriptor(4, 4, SpawnRangeBuffer.GetSRV());
+
+        CurrentStateBuffer ^= 1;
+
+        CompContext.ResetCounter(StateBuffers[CurrentStateBuffer]);
+
+        CompContext.TransitionResource(StateBuffers[CurrentStateBuffer], D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+        CompContext.SetDynamicDescriptor(3, 1, EffectCounters.GetUAV());
+        CompContext.SetDynamicDescriptor(3, 2, StateBuffers[CurrentStateBuffer].GetUAV());
+
+        CompContext.SetPipelineState(s_ParticleUpdateCS);
+        CompContext.Dispatch(SIMULATION_GROUPS, 1, 1);
+
+        // The living particles count against their effects before the spawn adds new ones
+        CompContext.InsertUAVBarrier(StateBuffers[CurrentStateBuffer]);
+        CompContext.InsertUAVBarrier(EffectCounters);
+
+        if (NumSpawnThreads > 0)
+        {
+            CompContext.SetPipelineState(s_ParticleSpawnCS);
+            CompContext.Dispatch((NumSpawnThreads + 63) / 64, 1, 1);
+        }
+    }
+
 
     void RenderTiles(ComputeContext& CompContext, ColorBuffer& ColorTarget, ColorBuffer& LinearDepth)
     {    
@@ -325,6 +493,7 @@ namespace
                 (TILE_SIZE == 16 ? g_MinMaxDepth16.GetSRV() : g_MinMaxDepth32.GetSRV()),
             };
             CompContext.SetDynamicDescriptors(4, 0, _countof(SRVs), SRVs);
+            CompContext.SetDynamicDescriptors(4, 8, _countof(ShadowSRVs), ShadowSRVs);
 
             CompContext.SetConstants(0, (float)DynamicResLevel, (float)MipBias);
 
@@ -370,17 +539,18 @@ namespace
             BitonicSort::Sort(CompContext, SpriteIndexBuffer, SpriteVertexBuffer.GetCounterBuffer(), 0, true, false);
         }
 
+        // The scene fills only the render size with dynamic resolution
         D3D12_RECT scissor;
         scissor.left = 0;
         scissor.top = 0;
-        scissor.right = (LONG)ColorTarget.GetWidth();
-        scissor.bottom = (LONG)ColorTarget.GetHeight();
+        scissor.right = (LONG)std::min((uint32_t)ColorTarget.GetWidth(), DynamicResolution::GetWidth());
+        scissor.bottom = (LONG)std::min((uint32_t)ColorTarget.GetHeight(), DynamicResolution::GetHeight());
 
         D3D12_VIEWPORT viewport;
         viewport.TopLeftX = 0.0;
         viewport.TopLeftY = 0.0;
-        viewport.Width = (float)ColorTarget.GetWidth();
-        viewport.Height = (float)ColorTarget.GetHeight();
+        viewport.Width = (float)scissor.right;
+        viewport.Height = (float)scissor.bottom;
         viewport.MinDepth = 0.0;
         viewport.MaxDepth = 1.0;
 
@@ -395,6 +565,7 @@ namespace
         GrContext.SetDynamicDescriptor(4, 1, TextureArraySRV);
         GrContext.SetDynamicDescriptor(4, 2, LinearDepth.GetSRV());
         GrContext.SetDynamicDescriptor(4, 3, SpriteIndexBuffer.GetSRV());
+        GrContext.SetDynamicDescriptors(4, 8, _countof(ShadowSRVs), ShadowSRVs);
         GrContext.SetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
         GrContext.TransitionResource(ColorTarget, D3D12_RESOURCE_STATE_RENDER_TARGET);
         GrContext.TransitionResource(DepthTarget, D3D12_RESOURCE_STATE_DEPTH_READ);
@@ -416,15 +587,16 @@ void ParticleEffects::Initialize( uint32_t MaxDisplayWidth, uint32_t MaxDisplayH
     D3D12_SAMPLER_DESC SamplerBilinearBorderDesc = SamplerPointBorderDesc;
     SamplerBilinearBorderDesc.Filter = D3D12_FILTER_COMPARISON_MIN_MAG_LINEAR_MIP_POINT;
 
-    RootSig.Reset(5, 3);
+    RootSig.Reset(5, 4);
     RootSig.InitStaticSampler(0, SamplerBilinearBorderDesc);
     RootSig.InitStaticSampler(1, SamplerPointBorderDesc);
     RootSig.InitStaticSampler(2, SamplerPointClampDesc);
+    RootSig.InitStaticSampler(3, SamplerShadowDesc);
     RootSig[0].InitAsConstants(0, 3);
     RootSig[1].InitAsConstantBuffer(1);
     RootSig[2].InitAsConstantBuffer(2);
     RootSig[3].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 0, 8);
-    RootSig[4].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 0, 10);
+    RootSig[4].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 0, 12);
     RootSig.Finalize(L"Particle Effects");
 
 #define CreatePSO( ObjName, ShaderByteCode ) \
@@ -433,7 +605,6 @@ void ParticleEffects::Initialize( uint32_t MaxDisplayWidth, uint32_t MaxDisplayH
     ObjName.Finalize();
     CreatePSO(s_ParticleSpawnCS, g_pParticleSpawnCS);
     CreatePSO(s_ParticleUpdateCS, g_pParticleUpdateCS);
-    CreatePSO(s_ParticleDispatchIndirectArgsCS, g_pParticleDispatchIndirectArgsCS);
     CreatePSO(s_ParticleFinalDispatchIndirectArgsCS, g_pParticleFinalDispatchIndirectArgsCS);
 
     CreatePSO(s_ParticleLargeBinCullingCS, g_pParticleLargeBinCullingCS);
@@ -479,6 +650,36 @@ void ParticleEffects::Initialize( uint32_t MaxDisplayWidth, uint32_t MaxDisplayH
     s_NoTileRasterizationPSO[1].SetVertexShader(g_pParticleNoSortVS, sizeof(g_pParticleNoSortVS));
     s_NoTileRasterizationPSO[1].Finalize();
 
+    // The light left multiplies by one minus each sprite's opacity, and the depth keeps the sprite nearest the sun
+    D3D12_BLEND_DESC TranslucencyBlend = BlendDisable;
+    TranslucencyBlend.IndependentBlendEnable = TRUE;
+    TranslucencyBlend.RenderTarget[0].BlendEnable = TRUE;
+    TranslucencyBlend.RenderTarget[0].SrcBlend = D3D12_BLEND_ZERO;
+    TranslucencyBlend.RenderTarget[0].DestBlend = D3D12_BLEND_INV_SRC_ALPHA;
+    TranslucencyBlend.RenderTarget[0].BlendOp = D3D12_BLEND_OP_ADD;
+    TranslucencyBlend.RenderTarget[0].SrcBlendAlpha = D3D12_BLEND_ZERO;
+    TranslucencyBlend.RenderTarget[0].DestBlendAlpha = D3D12_BLEND_INV_SRC_ALPHA;
+    TranslucencyBlend.RenderTarget[0].BlendOpAlpha = D3D12_BLEND_OP_ADD;
+    TranslucencyBlend.RenderTarget[1] = TranslucencyBlend.RenderTarget[0];
+    TranslucencyBlend.RenderTarget[1].SrcBlend = D3D12_BLEND_ONE;
+    TranslucencyBlend.RenderTarget[1].DestBlend = D3D12_BLEND_ONE;
+    TranslucencyBlend.RenderTarget[1].BlendOp = D3D12_BLEND_OP_MAX;
+    TranslucencyBlend.RenderTarget[1].SrcBlendAlpha = D3D12_BLEND_ONE;
+    TranslucencyBlend.RenderTarget[1].DestBlendAlpha = D3D12_BLEND_ONE;
+    TranslucencyBlend.RenderTarget[1].BlendOpAlpha = D3D12_BLEND_OP_MAX;
+
+    TranslucencyShadow.Create(L"ParticleEffects::TranslucencyShadow", TRANSLUCENCY_SHADOW_SIZE, TRANSLUCENCY_SHADOW_SIZE, 1, DXGI_FORMAT_R8_UNORM);
+    TranslucencyShadowDepth.Create(L"ParticleEffects::TranslucencyShadowDepth", TRANSLUCENCY_SHADOW_SIZE, TRANSLUCENCY_SHADOW_SIZE, 1, DXGI_FORMAT_R16_UNORM);
+
+    DXGI_FORMAT TranslucencyFormats[] = { TranslucencyShadow.GetFormat(), TranslucencyShadowDepth.GetFormat() };
+    s_TranslucencyShadowPSO = s_NoTileRasterizationPSO[0];
+    s_TranslucencyShadowPSO.SetDepthStencilState(DepthStateDisabled);
+    s_TranslucencyShadowPSO.SetBlendState(TranslucencyBlend);
+    s_TranslucencyShadowPSO.SetRenderTargetFormats(_countof(TranslucencyFormats), TranslucencyFormats, DXGI_FORMAT_UNKNOWN);
+    s_TranslucencyShadowPSO.SetVertexShader(g_pParticleShadowVS, sizeof(g_pParticleShadowVS));
+    s_TranslucencyShadowPSO.SetPixelShader(g_pParticleShadowPS, sizeof(g_pParticleShadowPS));
+    s_TranslucencyShadowPSO.Finalize();
+
     __declspec(align(16)) UINT InitialDrawIndirectArgs[4] = { 4, 0, 0, 0 };
     DrawIndirectArgs.Create(L"ParticleEffects::DrawIndirectArgs", 1, sizeof(D3D12_DRAW_ARGUMENTS), InitialDrawIndirectArgs);
     __declspec(align(16)) UINT InitialDispatchIndirectArgs[6] = { 0, 1, 1, 0, 1, 1 };
@@ -489,6 +690,15 @@ void ParticleEffects::Initialize( uint32_t MaxDisplayWidth, uint32_t MaxDisplayH
     SortIndirectArgs.Create(L"ParticleEffects::SortIndirectArgs", 1, sizeof(D3D12_DISPATCH_ARGUMENTS));
     TileDrawDispatchIndirectArgs.Create(L"ParticleEffects::DrawPackets_IArgs", 2, sizeof(D3D12_DISPATCH_ARGUMENTS), InitialDispatchIndirectArgs);
 
+    StateBuffers[0].Create(L"ParticleEffects::StateBuffer0", MAX_TOTAL_PARTICLES, sizeof(ParticleMotion));
+    StateBuffers[1].Create(L"ParticleEffects::StateBuffer1", MAX_TOTAL_PARTICLES, sizeof(ParticleMotion));
+    CurrentStateBuffer = 0;
+    SpawnDataBuffer.Create(L"ParticleEffects::SpawnDataBuffer", MAX_TOTAL_PARTICLES, sizeof(ParticleSpawnData));
+    SpawnDataCursor = 0;
+    EffectDataBuffer.Create(L"ParticleEffects::EffectDataBuffer", MAX_EFFECTS, sizeof(ParticleEffectData));
+    SpawnRangeBuffer.Create(L"ParticleEffects::SpawnRangeBuffer", MAX_EFFECTS, sizeof(XMUINT2));
+    EffectCounters.Create(L"ParticleEffects::EffectCounters", MAX_EFFECTS + 1, sizeof(uint32_t));
+
     const uint32_t LargeBinsPerRow = DivideByMultiple(MaxDisplayWidth, 4 * BIN_SIZE_X);
     const uint32_t LargeBinsPerCol = DivideByMultiple(MaxDisplayHeight, 4 * BIN_SIZE_Y);
     const uint32_t BinsPerRow = LargeBinsPerRow * 4;
@@ -554,6 +764,7 @@ void ParticleEffects::Initialize( uint32_t MaxDisplayWidth, uint32_t MaxDisplayH
 
 void ParticleEffects::Shutdown( void )
 {
+    s_InitComplete = false;
     ClearAll();
 
     SpriteVertexBuffer.Destroy();
@@ -565,6 +776,15 @@ void ParticleEffects::Shutdown( void )
     SortIndirectArgs.Destroy();
     TileDrawDispatchIndirectArgs.Destroy();
 
+    StateBuffers[0].Destroy();
+    StateBuffers[1].Destroy();
+    SpawnDataBuffer.Destroy();
+    EffectDataBuffer.Destroy();
+    SpawnRangeBuffer.Destroy();
+    EffectCounters.Destroy();
+    TranslucencyShadow.Destroy();
+    TranslucencyShadowDepth.Destroy();
+
     BinParticles[0].Destroy();
     BinParticles[1].Destroy();
     BinCounters[0].Destroy();
@@ -584,8 +804,13 @@ EffectHandle ParticleEffects::PreLoadEffectResources( ParticleEffectProperties&
 
     static std::mutex s_TextureMutex;
     s_TextureMutex.lock();
+    if (ParticleEffectsPool.size() >= MAX_EFFECTS)
+    {
+        s_TextureMutex.unlock();
+        return EFFECTS_ERROR;
+    }
     MaintainTextureList(effectProperties);
-    ParticleEffectsPool.emplace_back(new ParticleEffect(effectProperties));
+    ParticleEffectsPool.emplace_back(new ParticleEffect(effectProperties, (UINT)ParticleEffectsPool.size()));
     s_TextureMutex.unlock();
 
     EffectHandle index = (EffectHandle)ParticleEffectsPool.size() - 1;
@@ -604,6 +829,11 @@ EffectHandle ParticleEffects::InstantiateEffect( EffectHandle effectHandle )
     {
         static std::mutex s_InstantiateEffectFromPoolMutex;
         s_InstantiateEffectFromPoolMutex.lock();
+        if (ParticleEffectsActive.size() >= MAX_EFFECTS)
+        {
+            s_InstantiateEffectFromPoolMutex.unlock();
+            return EFFECTS_ERROR;
+        }
         ParticleEffectsActive.push_back(effect);
         s_InstantiateEffectFromPoolMutex.unlock();
     }
@@ -623,8 +853,13 @@ EffectHandle ParticleEffects::InstantiateEffect( ParticleEffectProperties& effec
 
     static std::mutex s_InstantiateNewEffectMutex;
     s_InstantiateNewEffectMutex.lock();
+    if (ParticleEffectsPool.size() >= MAX_EFFECTS || ParticleEffectsActive.size() >= MAX_EFFECTS)
+    {
+        s_InstantiateNewEffectMutex.unlock();
+        return EFFECTS_ERROR;
+    }
     MaintainTextureList(effectProperties);
-    ParticleEffect* newEffect = new ParticleEffect(effectProperties);
+    ParticleEffect* newEffect = new ParticleEffect(effectProperties, (UINT)ParticleEffectsPool.size());
     ParticleEffectsPool.emplace_back(newEffect);
     ParticleEffectsActive.push_back(newEffect);
     s_InstantiateNewEffectMutex.unlock();
@@ -663,20 +898,7 @@ void ParticleEffects::Update(ComputeContext& Context, float timeDelta )
     Context.TransitionResource(SpriteVertexBuffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
     Context.SetDynamicDescriptor(3, 0, SpriteVertexBuffer.GetUAV());
 
-    for (UINT i = 0; i < ParticleEffectsActive.size(); ++i)
-    {    
-        ParticleEffectsActive[i]->Update(Context, timeDelta);
-
-        if (ParticleEffectsActive[i]->GetLifetime() <= ParticleEffectsActive[i]->GetElapsedTime())
-        {
-            //Erase from vector
-            auto iter = ParticleEffectsActive.begin() + i;
-            static std::mutex s_EraseEffectMutex;
-            s_EraseEffectMutex.lock();
-            ParticleEffectsActive.erase(iter);
-            s_EraseEffectMutex.unlock();
-        }
-    }
+    SimulateEffects(Context, timeDelta);
 
     SetFinalBuffers(Context);
 }
@@ -725,13 +947,46 @@ void ParticleEffects::Render( CommandContext& Context, const Camera& Camera, Col
     s_ChangesPerView.gTilesPerRow = DivideByMultiple(Width, TILE_SIZE);
     s_ChangesPerView.gTilesPerCol = DivideByMultiple(Height, TILE_SIZE);
 
+    // The next update culls effects against this view before they spawn
+    CullFrustum = Camera.GetWorldSpaceFrustum();
+    HasCullFrustum = true;
+
+    // From screen UV and normalized linear depth, with the UV scaled by the depth, to view space and on to the sun
+    // shadow.  The view looks down -Z.
+    const float FarZ = Camera.GetFarClip();
+    const Matrix4 ViewFromScreen(
+        Vector4(2.0f * FarZ / HCot, 0.0f, 0.0f, 0.0f),
+        Vector4(0.0f, -2.0f * FarZ / VCot, 0.0f, 0.0f),
+        Vector4(-FarZ / HCot, FarZ / VCot, -FarZ, 0.0f),
+        Vector4(0.0f, 0.0f, 0.0f, 1.0f));
+
+    const bool ShadowParticles = ReceiveShadows && SunShadowMap != nullptr;
+    const bool CastShadows = ShadowParticles && TranslucencyShadows;
+    s_ChangesPerView.gScreenToShadow = SunShadowMatrix * s_ChangesPerView.gInvView * ViewFromScreen;
+    s_ChangesPerView.gShadowEnable = ShadowParticles ? 1 : 0;
+    s_ChangesPerView.gTranslucencyShadowEnable = CastShadows ? 1 : 0;
+
+    // Unused slots still need valid descriptors
+    ShadowSRVs[0] = ShadowParticles ? SunShadowMap->GetSRV() : TranslucencyShadow.GetSRV();
+    ShadowSRVs[1] = TranslucencyShadow.GetSRV();
+    ShadowSRVs[2] = TranslucencyShadowDepth.GetSRV();
+
+    if (CastShadows)
+        RenderTranslucencyShadow(Context.GetGraphicsContext());
+
+    if (ShadowParticles)
+        Context.TransitionResource(*SunShadowMap, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    Context.TransitionResource(TranslucencyShadow, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    Context.TransitionResource(TranslucencyShadowDepth, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+
     // For now, UAV load support for R11G11B10 is required to read-modify-write the color buffer, but
     // the compositing could be deferred.
     WARN_ONCE_IF(EnableTiledRendering && !g_bTypedUAVLoadSupport_R11G11B10_FLOAT,
         "Unable to composite tiled particles without support for R11G11B10F UAV loads");
     EnableTiledRendering = EnableTiledRendering && g_bTypedUAVLoadSupport_R11G11B10_FLOAT;
 
-    if (EnableTiledRendering)
+    // Tiles are binned over the whole buffer, so frames at a lower dynamic resolution rasterize sprites instead
+    if (EnableTiledRendering && !DynamicResolution::IsScaled())
     {
         ComputeContext& CompContext = Context.GetComputeContext();
         CompContext.TransitionResource(ColorTarget, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
@@ -765,11 +1020,39 @@ void ParticleEffects::Render( CommandContext& Context, const Camera& Camera, Col
 //
 //---------------------------------------------------------------------
 
+void ParticleEffects::SetSunShadow(ShadowBuffer* ShadowMap, const GameCore::ShadowCamera& SunShadow)
+{
+    SunShadowMap = ShadowMap;
+    SunShadowMatrix = SunShadow.GetShadowMatrix();
+    SunViewProj = SunShadow.GetViewProjMatrix();
+    SunInvView = Invert(SunShadow.GetViewMatrix());
+}
+
 void ParticleEffects::ClearAll()
 {
     ParticleEffectsActive.clear();
     ParticleEffectsPool.clear();
     TextureNameArray.clear();
+    SpawnDataCursor = 0;
+}
+
+// Returns the offset of the data in the spawn data buffer, or ~0u when it is full
+uint32_t ParticleEffects::AllocateSpawnData(const ParticleSpawnData* SpawnData, uint32_t Count)
+{
+    static std::mutex s_SpawnDataMutex;
+    s_SpawnDataMutex.lock();
+    uint32_t Offset = SpawnDataCursor;
+    bool Fits = Count > 0 && Offset + Count <= MAX_TOTAL_PARTICLES;
+    if (Fits)
+        SpawnDataCursor += Count;
+    s_SpawnDataMutex.unlock();
+
+    WARN_ONCE_IF(Count > 0 && !Fits, "The particle spawn data buffer is full, so new effects spawn nothing");
+    if (!Fits)
+        return ~0u;
+
+    CommandContext::InitializeBuffer(SpawnDataBuffer, SpawnData, Count * sizeof(ParticleSpawnData), Offset * sizeof(ParticleSpawnData));
+    return Offset;
 }
 
 void ParticleEffects::ResetEffect(EffectHandle EffectID)
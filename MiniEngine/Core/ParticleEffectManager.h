@@ -19,11 +19,18 @@
 #include "CommandContext.h"
 #include "Math/Random.h"
 
+class ShadowBuffer;
+
 namespace Math
 {
     class Camera;
 }
 
+namespace GameCore
+{
+    class ShadowCamera;
+}
+
 namespace ParticleEffects
 {
     void Initialize( uint32_t MaxDisplayWidth, uint32_t MaxDisplayHeight );
@@ -35,6 +42,10 @@ namespace ParticleEffects
     EffectHandle InstantiateEffect( ParticleEffectProperties& effectProperties );
     void Update(ComputeContext& Context, float timeDelta );
     void Render(CommandContext& Context, const Camera& Camera, ColorBuffer& ColorTarget, DepthBuffer& DepthTarget, ColorBuffer& LinearDepth);
+
+    // The sun shadow the next Render() lights effects with a ShadowStrength by, and casts their opacity into the
+    // translucency shadow from.  Pass a null shadow map to render particles unshadowed.
+    void SetSunShadow(ShadowBuffer* ShadowMap, const GameCore::ShadowCamera& SunShadow);
     void ResetEffect(EffectHandle EffectID);
     float GetCurrentLife(EffectHandle EffectID);
 
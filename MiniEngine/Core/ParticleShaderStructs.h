@@ -32,12 +32,22 @@ __declspec(align(16)) struct EmissionProperties
     XMFLOAT3 Gravity;
     UINT TextureID;
     XMFLOAT3 EmissiveColor;
-    float pad1;    
-    XMUINT4 RandIndex[64];
+    float ShadowStrength;   // How much the sun's shadow darkens the effect, and how much of its opacity it casts
 };
 
 EmissionProperties* CreateEmissionProperties();
 
+// What the simulation reads of each effect in the pool, indexed by ParticleMotion::EffectIndex.  An effect that
+// is not active gets no MaxParticles, which retires its particles.
+__declspec(align(16)) struct ParticleEffectData
+{
+    EmissionProperties EmitProperties;
+    UINT SpawnDataBase;     // The effect's range of the shared spawn data buffer
+    UINT SpawnDataCount;
+    float BoundingRadius;   // About the emitter, bounding where its particles can get to
+    float pad;
+};
+
 struct ParticleSpawnData
 {
     float AgeRate;
@@ -59,6 +69,7 @@ struct ParticleMotion
     float Age;
     float Rotation;
     UINT ResetDataIndex;
+    UINT EffectIndex;
 };
 
 struct ParticleVertex
@@ -67,6 +78,7 @@ struct ParticleVertex
     XMFLOAT4 Color;
     float Size;
     UINT TextureID;
+    float ShadowStrength;
 };
 
 struct ParticleScreenData
@@ -78,6 +90,7 @@ struct ParticleScreenData
     float TextureIndex;
     float TextureLevel;
     uint32_t Bounds;
+    float ShadowStrength;
 };
 
 
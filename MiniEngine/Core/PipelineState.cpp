@@ -15,22 +15,254 @@
 #include "PipelineState.h"
 #include "RootSignature.h"
 #include "Hash.h"
-#include <map>
-#include <thread>
+#include "ConcurrentHashMap.h"
+#include "StartupProfile.h"
 #include <mutex>
+#include <fstream>
+
+// ID3D12PipelineLibrary first shipped in the Windows 10 Anniversary Update SDK
+#if defined(NTDDI_WIN10_RS1) && (NTDDI_VERSION >= NTDDI_WIN10_RS1)
+    #include <dxgi1_4.h>
+    #define ENABLE_PIPELINE_LIBRARY 1
+#else
+    #define ENABLE_PIPELINE_LIBRARY 0
+#endif
 
 using Math::IsAligned;
 using namespace Graphics;
 using Microsoft::WRL::ComPtr;
 using namespace std;
 
-static map< size_t, ComPtr<ID3D12PipelineState> > s_GraphicsPSOHashMap;
-static map< size_t, ComPtr<ID3D12PipelineState> > s_ComputePSOHashMap;
+// Cached pipelines never move, so PSOs can point at them
+static ConcurrentHashMap<PSO::CompiledPipeline> s_GraphicsPSOHashMap;
+static ConcurrentHashMap<PSO::CompiledPipeline> s_ComputePSOHashMap;
+
+// Counts every pipeline being compiled on a worker thread
+static JobSystem::Counter s_PendingCompiles;
+
+// Pipelines that were not in the pipeline library
+static atomic<uint32_t> s_NumCompiled(0);
+
+namespace
+{
+    // The cache file starts with this header, and the serialized library follows
+    struct PipelineCacheHeader
+    {
+        uint32_t Magic;
+        uint32_t Version;
+        uint32_t VendorId;
+        uint32_t DeviceId;
+        uint32_t SubSysId;
+        uint32_t Revision;
+        uint64_t DriverVersion;
+    };
+
+    const uint32_t kPipelineCacheMagic = 0x4C4F5350;    // "PSOL"
+    const uint32_t kPipelineCacheVersion = 1;
+
+    mutex s_PipelineLibraryMutex;
+    wstring s_PipelineCachePath;
+    bool s_PipelineCacheDirty = false;
+#if ENABLE_PIPELINE_LIBRARY
+    ComPtr<ID3D12PipelineLibrary> s_PipelineLibrary;
+    Utility::ByteArray s_PipelineCacheFile;     // The library reads from the file's contents for as long as it lives
+#endif
+
+    bool GetAdapterIdentity( PipelineCacheHeader& Header )
+    {
+#if ENABLE_PIPELINE_LIBRARY
+        ComPtr<IDXGIFactory4> Factory;
+        ComPtr<IDXGIAdapter1> Adapter;
+        DXGI_ADAPTER_DESC1 Desc;
+        LARGE_INTEGER DriverVersion;
+        if (FAILED(CreateDXGIFactory2(0, MY_IID_PPV_ARGS(&Factory))) ||
+            FAILED(Factory->EnumAdapterByLuid(g_Device->GetAdapterLuid(), MY_IID_PPV_ARGS(&Adapter))) ||
+            FAILED(Adapter->GetDesc1(&Desc)) ||
+            FAILED(Adapter->CheckInterfaceSupport(__uuidof(IDXGIDevice), &DriverVersion)))
+            return false;
+
+        Header.Magic = kPipelineCacheMagic;
+        Header.Version = kPipelineCacheVersion;
+        Header.VendorId = Desc.VendorId;
+        Header.DeviceId = Desc.DeviceId;
+        Header.SubSysId = Desc.SubSysId;
+        Header.Revision = Desc.Revision;
+        Header.DriverVersion = DriverVersion.QuadPart;
+        return true;
+#else
+        (Header);
+        return false;
+#endif
+    }
+
+    // Descriptions point at shader bytecode and root signatures, which move from one launch to the next.  Cached
+    // pipelines are named by what the pointers point at instead.
+    size_t HashShader( const D3D12_SHADER_BYTECODE& Shader, size_t Hash )
+    {
+        const uint32_t* Bytecode = (const uint32_t*)Shader.pShaderBytecode;
+        Hash = Utility::HashState(&Shader.BytecodeLength, 1, Hash);
+        return Utility::HashRange(Bytecode, Bytecode + Shader.BytecodeLength / 4, Hash);
+    }
+
+    wstring GetPipelineName( wchar_t Kind, size_t Hash )
+    {
+        wchar_t Name[24];
+        swprintf_s(Name, L"%c%016llx", Kind, (uint64_t)Hash);
+        return Name;
+    }
+
+    // These fail when nothing by the name is stored, or when what is stored was made from a different description
+    bool LoadCachedPipeline( const wstring& Name, const D3D12_GRAPHICS_PIPELINE_STATE_DESC& Desc, ID3D12PipelineState** PSO )
+    {
+#if ENABLE_PIPELINE_LIBRARY
+        lock_guard<mutex> Guard(s_PipelineLibraryMutex);
+        return s_PipelineLibrary != nullptr &&
+            SUCCEEDED(s_PipelineLibrary->LoadGraphicsPipeline(Name.c_str(), &Desc, MY_IID_PPV_ARGS(PSO)));
+#else
+        (Name); (Desc); (PSO);
+        return false;
+#endif
+    }
+
+    bool LoadCachedPipeline( const wstring& Name, const D3D12_COMPUTE_PIPELINE_STATE_DESC& Desc, ID3D12PipelineState** PSO )
+    {
+#if ENABLE_PIPELINE_LIBRARY
+        lock_guard<mutex> Guard(s_PipelineLibraryMutex);
+        return s_PipelineLibrary != nullptr &&
+            SUCCEEDED(s_PipelineLibrary->LoadComputePipeline(Name.c_str(), &Desc, MY_IID_PPV_ARGS(PSO)));
+#else
+        (Name); (Desc); (PSO);
+        return false;
+#endif
+    }
+
+    void StoreCachedPipeline( const wstring& Name, ID3D12PipelineState* PSO )
+    {
+#if ENABLE_PIPELINE_LIBRARY
+        lock_guard<mutex> Guard(s_PipelineLibraryMutex);
+        if (s_PipelineLibrary == nullptr)
+            return;
+
+        // A pipeline whose name is taken by a stale entry is simply compiled again each launch
+        if (SUCCEEDED(s_PipelineLibrary->StorePipeline(Name.c_str(), PSO)))
+            s_PipelineCacheDirty = true;
+#else
+        (Name); (PSO);
+#endif
+    }
+}
+
+void PSO::LoadPipelineCache( const std::wstring& FileName )
+{
+#if ENABLE_PIPELINE_LIBRARY
+    lock_guard<mutex> Guard(s_PipelineLibraryMutex);
+    s_PipelineCachePath = FileName;
+
+    ComPtr<ID3D12Device1> Device1;
+    PipelineCacheHeader Identity;
+    if (FAILED(g_Device->QueryInterface(MY_IID_PPV_ARGS(&Device1))) || !GetAdapterIdentity(Identity))
+    {
+        Utility::Print("Pipeline libraries are not supported, so pipelines will not be cached\n");
+        return;
+    }
+
+    s_PipelineCacheFile = Utility::ReadFileSync(FileName);
+    const size_t FileSize = s_PipelineCacheFile->size();
+    if (FileSize > sizeof(PipelineCacheHeader) && memcmp(s_PipelineCacheFile->data(), &Identity, sizeof(Identity)) == 0)
+    {
+        // The driver rejects a library that another driver version wrote, or that is corrupt
+        HRESULT hr = Device1->CreatePipelineLibrary(s_PipelineCacheFile->data() + sizeof(PipelineCacheHeader),
+            FileSize - sizeof(PipelineCacheHeader), MY_IID_PPV_ARGS(&s_PipelineLibrary));
+        if (FAILED(hr))
+            Utility::Printf(L"Discarding pipeline cache %s (0x%08x)\n", FileName.c_str(), hr);
+    }
+
+    if (s_PipelineLibrary == nullptr)
+    {
+        s_PipelineCacheFile.reset();
+        ASSERT_SUCCEEDED(Device1->CreatePipelineLibrary(nullptr, 0, MY_IID_PPV_ARGS(&s_PipelineLibrary)));
+    }
+#else
+    (FileName);
+#endif
+}
+
+void PSO::SavePipelineCache( void )
+{
+#if ENABLE_PIPELINE_LIBRARY
+    WaitForCompilation();
+
+    lock_guard<mutex> Guard(s_PipelineLibraryMutex);
+    if (s_PipelineLibrary == nullptr || !s_PipelineCacheDirty)
+        return;
+
+    PipelineCacheHeader Header;
+    if (!GetAdapterIdentity(Header))
+        return;
+
+    // The library holds everything it was loaded with as well as what was stored since
+    const size_t LibrarySize = s_PipelineLibrary->GetSerializedSize();
+    vector<uint8_t> Contents(sizeof(Header) + LibrarySize);
+    memcpy(Contents.data(), &Header, sizeof(Header));
+    if (FAILED(s_PipelineLibrary->Serialize(Contents.data() + sizeof(Header), LibrarySize)))
+        return;
+
+    const size_t DirEnd = s_PipelineCachePath.find_last_of(L"/\\");
+    if (DirEnd != wstring::npos)
+        CreateDirectoryW(s_PipelineCachePath.substr(0, DirEnd).c_str(), nullptr);
+
+    ofstream CacheFile(s_PipelineCachePath, ios::out | ios::binary);
+    if (CacheFile)
+    {
+        CacheFile.write((const char*)Contents.data(), Contents.size());
+        s_PipelineCacheDirty = false;
+    }
+    else
+        Utility::Printf(L"Couldn't write pipeline cache %s\n", s_PipelineCachePath.c_str());
+#endif
+}
+
+void PSO::WaitForCompilation( void )
+{
+    if (!s_PendingCompiles.IsDone())
+        JobSystem::Wait(s_PendingCompiles, L"Wait for Pipelines");
+}
+
+void PSO::ReportCacheStatistics( void )
+{
+    EngineProfiling::SetCounter("PSO Cache Hits", s_GraphicsPSOHashMap.GetHitCount() + s_ComputePSOHashMap.GetHitCount());
+    EngineProfiling::SetCounter("PSO Cache Misses", s_GraphicsPSOHashMap.GetMissCount() + s_ComputePSOHashMap.GetMissCount());
+    EngineProfiling::SetCounter("PSOs Compiled", s_NumCompiled.load(memory_order_relaxed));
+}
+
+void PSO::Compile( CompiledPipeline& Pipeline, const JobSystem::JobFunc& CompileFunc )
+{
+    if (JobSystem::GetWorkerCount() == 0)
+    {
+        CompileFunc();
+        return;
+    }
+
+    JobSystem::AddExternal(s_PendingCompiles);
+    JobSystem::Run([CompileFunc]
+    {
+        CompileFunc();
+        JobSystem::FinishExternal(s_PendingCompiles);
+    }, &Pipeline.Compiled);
+}
 
 void PSO::DestroyAll(void)
 {
-    s_GraphicsPSOHashMap.clear();
-    s_ComputePSOHashMap.clear();
+    WaitForCompilation();
+
+    s_GraphicsPSOHashMap.Clear();
+    s_ComputePSOHashMap.Clear();
+
+#if ENABLE_PIPELINE_LIBRARY
+    lock_guard<mutex> Guard(s_PipelineLibraryMutex);
+    s_PipelineLibrary = nullptr;
+    s_PipelineCacheFile.reset();
+#endif
 }
 
 
@@ -117,34 +349,70 @@ void GraphicsPSO::Finalize()
     HashCode = Utility::HashState(m_InputLayouts.get(), m_PSODesc.InputLayout.NumElements, HashCode);
     m_PSODesc.InputLayout.pInputElementDescs = m_InputLayouts.get();
 
-    ID3D12PipelineState** PSORef = nullptr;
+    // Reserve space so the next inquiry will find that someone got here first.
     bool firstCompile = false;
-    {
-        static mutex s_HashMapMutex;
-        lock_guard<mutex> CS(s_HashMapMutex);
-        auto iter = s_GraphicsPSOHashMap.find(HashCode);
+    m_Pipeline = s_GraphicsPSOHashMap.FindOrInsert(HashCode, firstCompile);
+
+    if (!firstCompile)
+        return;
 
-        // Reserve space so the next inquiry will find that someone got here first.
-        if (iter == s_GraphicsPSOHashMap.end())
+    // The job works from copies, since this PSO may be changed and finalized again before it runs.  The input
+    // layout copy shares the elements the description points at.
+    CompiledPipeline* Pipeline = m_Pipeline;
+    const wstring Name = GetPipelineName(L'G', GetCacheHash());
+    const D3D12_GRAPHICS_PIPELINE_STATE_DESC Desc = m_PSODesc;
+    const shared_ptr<const D3D12_INPUT_ELEMENT_DESC> InputLayouts = m_InputLayouts;
+
+    Compile(*Pipeline, [Pipeline, Name, Desc, InputLayouts]
+    {
+        const int64_t StartTick = SystemTime::GetCurrentTick();
+        StartupProfile::Category Type = StartupProfile::kPipelineCacheLoad;
+        if (!LoadCachedPipeline(Name, Desc, Pipeline->PSO.GetAddressOf()))
         {
-            firstCompile = true;
-            PSORef = s_GraphicsPSOHashMap[HashCode].GetAddressOf();
+            ASSERT_SUCCEEDED( g_Device->CreateGraphicsPipelineState(&Desc, MY_IID_PPV_ARGS(Pipeline->PSO.GetAddressOf())) );
+            s_NumCompiled.fetch_add(1, memory_order_relaxed);
+            StoreCachedPipeline(Name, Pipeline->PSO.Get());
+            Type = StartupProfile::kPipelineCompile;
         }
-        else
-            PSORef = iter->second.GetAddressOf();
-    }
+        StartupProfile::Record(Type, StartTick, SystemTime::GetCurrentTick());
+    });
+}
 
-    if (firstCompile)
-    {
-        ASSERT_SUCCEEDED( g_Device->CreateGraphicsPipelineState(&m_PSODesc, MY_IID_PPV_ARGS(&m_PSO)) );
-        s_GraphicsPSOHashMap[HashCode].Attach(m_PSO);
-    }
-    else
+size_t GraphicsPSO::GetCacheHash( void ) const
+{
+    D3D12_GRAPHICS_PIPELINE_STATE_DESC Desc;
+    memcpy(&Desc, &m_PSODesc, sizeof(Desc));
+    Desc.pRootSignature = nullptr;
+    Desc.VS.pShaderBytecode = nullptr;
+    Desc.PS.pShaderBytecode = nullptr;
+    Desc.DS.pShaderBytecode = nullptr;
+    Desc.HS.pShaderBytecode = nullptr;
+    Desc.GS.pShaderBytecode = nullptr;
+    Desc.StreamOutput.pSODeclaration = nullptr;
+    Desc.StreamOutput.pBufferStrides = nullptr;
+    Desc.InputLayout.pInputElementDescs = nullptr;
+
+    size_t Hash = Utility::HashState(&Desc);
+    Hash = HashShader(m_PSODesc.VS, Hash);
+    Hash = HashShader(m_PSODesc.PS, Hash);
+    Hash = HashShader(m_PSODesc.DS, Hash);
+    Hash = HashShader(m_PSODesc.HS, Hash);
+    Hash = HashShader(m_PSODesc.GS, Hash);
+
+    // Stream output is not used, so only its counts are hashed
+    for (UINT i = 0; i < m_PSODesc.InputLayout.NumElements; ++i)
     {
-        while (*PSORef == nullptr)
-            this_thread::yield();
-        m_PSO = *PSORef;
+        const D3D12_INPUT_ELEMENT_DESC& Element = m_InputLayouts.get()[i];
+        for (const char* Semantic = Element.SemanticName; *Semantic != '\0'; ++Semantic)
+        {
+            const uint32_t Char = *Semantic;
+            Hash = Utility::HashState(&Char, 1, Hash);
+        }
+        Hash = Utility::HashRange((const uint32_t*)&Element.SemanticIndex, (const uint32_t*)(&Element + 1), Hash);
     }
+
+    const size_t RootSignatureHash = m_RootSignature->GetHashCode();
+    return Utility::HashState(&RootSignatureHash, 1, Hash);
 }
 
 void ComputePSO::Finalize()
@@ -155,34 +423,44 @@ void ComputePSO::Finalize()
 
     size_t HashCode = Utility::HashState(&m_PSODesc);
 
-    ID3D12PipelineState** PSORef = nullptr;
+    // Reserve space so the next inquiry will find that someone got here first.
     bool firstCompile = false;
-    {
-        static mutex s_HashMapMutex;
-        lock_guard<mutex> CS(s_HashMapMutex);
-        auto iter = s_ComputePSOHashMap.find(HashCode);
+    m_Pipeline = s_ComputePSOHashMap.FindOrInsert(HashCode, firstCompile);
+
+    if (!firstCompile)
+        return;
 
-        // Reserve space so the next inquiry will find that someone got here first.
-        if (iter == s_ComputePSOHashMap.end())
+    CompiledPipeline* Pipeline = m_Pipeline;
+    const wstring Name = GetPipelineName(L'C', GetCacheHash());
+    const D3D12_COMPUTE_PIPELINE_STATE_DESC Desc = m_PSODesc;
+
+    Compile(*Pipeline, [Pipeline, Name, Desc]
+    {
+        const int64_t StartTick = SystemTime::GetCurrentTick();
+        StartupProfile::Category Type = StartupProfile::kPipelineCacheLoad;
+        if (!LoadCachedPipeline(Name, Desc, Pipeline->PSO.GetAddressOf()))
         {
-            firstCompile = true;
-            PSORef = s_ComputePSOHashMap[HashCode].GetAddressOf();
+            ASSERT_SUCCEEDED( g_Device->CreateComputePipelineState(&Desc, MY_IID_PPV_ARGS(Pipeline->PSO.GetAddressOf())) );
+            s_NumCompiled.fetch_add(1, memory_order_relaxed);
+            StoreCachedPipeline(Name, Pipeline->PSO.Get());
+            Type = StartupProfile::kPipelineCompile;
         }
-        else
-            PSORef = iter->second.GetAddressOf();
-    }
+        StartupProfile::Record(Type, StartTick, SystemTime::GetCurrentTick());
+    });
+}
 
-    if (firstCompile)
-    {
-        ASSERT_SUCCEEDED( g_Device->CreateComputePipelineState(&m_PSODesc, MY_IID_PPV_ARGS(&m_PSO)) );
-        s_ComputePSOHashMap[HashCode].Attach(m_PSO);
-    }
-    else
-    {
-        while (*PSORef == nullptr)
-            this_thread::yield();
-        m_PSO = *PSORef;
-    }
+size_t ComputePSO::GetCacheHash( void ) const
+{
+    D3D12_COMPUTE_PIPELINE_STATE_DESC Desc;
+    memcpy(&Desc, &m_PSODesc, sizeof(Desc));
+    Desc.pRootSignature = nullptr;
+    Desc.CS.pShaderBytecode = nullptr;
+
+    size_t Hash = Utility::HashState(&Desc);
+    Hash = HashShader(m_PSODesc.CS, Hash);
+
+    const size_t RootSignatureHash = m_RootSignature->GetHashCode();
+    return Utility::HashState(&RootSignatureHash, 1, Hash);
 }
 
 ComputePSO::ComputePSO()
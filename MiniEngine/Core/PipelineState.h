@@ -14,6 +14,7 @@
 #pragma once
 
 #include "pch.h"
+#include "JobSystem.h"
 
 class CommandContext;
 class RootSignature;
@@ -28,10 +29,31 @@ class PSO
 {
 public:
 
-    PSO() : m_RootSignature(nullptr) {}
+    // Every PSO with the same description shares one of these, which is done once its pipeline is compiled
+    struct CompiledPipeline
+    {
+        Microsoft::WRL::ComPtr<ID3D12PipelineState> PSO;
+        JobSystem::Counter Compiled;
+    };
+
+    PSO() : m_RootSignature(nullptr), m_Pipeline(nullptr) {}
 
     static void DestroyAll( void );
 
+    // Once the job system is running, Finalize() queues compilation on a worker thread and returns right away, so
+    // that all of the pipelines made during initialization compile in parallel.  A PSO waits for its pipeline the
+    // first time it is bound.  This waits for every pipeline still compiling.
+    static void WaitForCompilation( void );
+
+    // Lists the cache's hits and misses, and how many pipelines were compiled, with the profiler's counters
+    static void ReportCacheStatistics( void );
+
+    // Compiled pipelines are kept in an ID3D12PipelineLibrary that is read from a file at startup, so that later
+    // launches load them instead of compiling them again.  New pipelines are added to the library as they are
+    // compiled, and saving writes the whole library back.  The file is ignored after an adapter or driver change.
+    static void LoadPipelineCache( const std::wstring& FileName );
+    static void SavePipelineCache( void );
+
     void SetRootSignature( const RootSignature& BindMappings )
     {
         m_RootSignature = &BindMappings;
@@ -43,13 +65,29 @@ public:
         return *m_RootSignature;
     }
 
-    ID3D12PipelineState* GetPipelineStateObject( void ) const { return m_PSO; }
+    // Whether the pipeline has finished compiling, for callers that would rather skip work than wait for it
+    bool IsReady( void ) const
+    {
+        ASSERT(m_Pipeline != nullptr, "PSO has not been finalized");
+        return m_Pipeline->Compiled.IsDone();
+    }
+
+    ID3D12PipelineState* GetPipelineStateObject( void ) const
+    {
+        ASSERT(m_Pipeline != nullptr, "PSO has not been finalized");
+        if (!m_Pipeline->Compiled.IsDone())
+            JobSystem::Wait(m_Pipeline->Compiled);
+        return m_Pipeline->PSO.Get();
+    }
 
 protected:
 
+    // Compiles on a worker thread when there are any, and otherwise right away
+    static void Compile( CompiledPipeline& Pipeline, const JobSystem::JobFunc& CompileFunc );
+
     const RootSignature* m_RootSignature;
 
-    ID3D12PipelineState* m_PSO;
+    CompiledPipeline* m_Pipeline;
 };
 
 class GraphicsPSO : public PSO
@@ -89,6 +127,9 @@ public:
 
 private:
 
+    // Names the pipeline in the pipeline cache
+    size_t GetCacheHash( void ) const;
+
     D3D12_GRAPHICS_PIPELINE_STATE_DESC m_PSODesc;
     std::shared_ptr<const D3D12_INPUT_ELEMENT_DESC> m_InputLayouts;
 };
@@ -108,5 +149,8 @@ public:
 
 private:
 
+    // Names the pipeline in the pipeline cache
+    size_t GetCacheHash( void ) const;
+
     D3D12_COMPUTE_PIPELINE_STATE_DESC m_PSODesc;
 };
@@ -18,6 +18,7 @@
 #include "BufferManager.h"
 #include "CommandContext.h"
 #include "ReadbackBuffer.h"
+#include "GpuMemoryTracker.h"
 #include <fstream>
 
 using namespace Graphics;
@@ -361,6 +362,8 @@ void PixelBuffer::CreateTextureResource( ID3D12Device* Device, const std::wstrin
     CD3DX12_HEAP_PROPERTIES HeapProps(D3D12_HEAP_TYPE_DEFAULT);
     ASSERT_SUCCEEDED( Device->CreateCommittedResource( &HeapProps, D3D12_HEAP_FLAG_NONE,
         &ResourceDesc, D3D12_RESOURCE_STATE_COMMON, &ClearValue, MY_IID_PPV_ARGS(&m_pResource) ));
+    GpuMemoryTracker::TrackResource(m_pResource.Get(), GpuMemoryTracker::kRenderTargets);
+    TrackResidency();
 
     m_UsageState = D3D12_RESOURCE_STATE_COMMON;
     m_GpuVirtualAddress = D3D12_GPU_VIRTUAL_ADDRESS_NULL;
@@ -373,9 +376,49 @@ void PixelBuffer::CreateTextureResource( ID3D12Device* Device, const std::wstrin
 }
 
 void PixelBuffer::CreateTextureResource( ID3D12Device* Device, const std::wstring& Name,
-    const D3D12_RESOURCE_DESC& ResourceDesc, D3D12_CLEAR_VALUE ClearValue, EsramAllocator& /*Allocator*/ )
+    const D3D12_RESOURCE_DESC& ResourceDesc, D3D12_CLEAR_VALUE ClearValue, EsramAllocator& Allocator )
 {
     CreateTextureResource(Device, Name, ResourceDesc, ClearValue);
+    Allocator.Place(m_pResource.Get(), Name);
+}
+
+void PixelBuffer::CreatePlacedTextureResource( ID3D12Device* Device, const std::wstring& Name,
+    const D3D12_RESOURCE_DESC& ResourceDesc, D3D12_CLEAR_VALUE ClearValue, ID3D12Heap* Heap, uint64_t HeapOffset )
+{
+    Destroy();
+
+    ASSERT_SUCCEEDED( Device->CreatePlacedResource( Heap, HeapOffset, &ResourceDesc, D3D12_RESOURCE_STATE_COMMON,
+        &ClearValue, MY_IID_PPV_ARGS(&m_pResource) ));
+
+    m_UsageState = D3D12_RESOURCE_STATE_COMMON;
+    m_GpuVirtualAddress = D3D12_GPU_VIRTUAL_ADDRESS_NULL;
+
+#ifndef RELEASE
+    m_pResource->SetName(Name.c_str());
+#else
+    (Name);
+#endif
+}
+
+void PixelBuffer::CreateReservedTextureResource( ID3D12Device* Device, const std::wstring& Name,
+    const D3D12_RESOURCE_DESC& ResourceDesc, D3D12_CLEAR_VALUE ClearValue )
+{
+    Destroy();
+
+    D3D12_RESOURCE_DESC TiledDesc = ResourceDesc;
+    TiledDesc.Layout = D3D12_TEXTURE_LAYOUT_64KB_UNDEFINED_SWIZZLE;
+
+    ASSERT_SUCCEEDED( Device->CreateReservedResource( &TiledDesc, D3D12_RESOURCE_STATE_COMMON,
+        &ClearValue, MY_IID_PPV_ARGS(&m_pResource) ));
+
+    m_UsageState = D3D12_RESOURCE_STATE_COMMON;
+    m_GpuVirtualAddress = D3D12_GPU_VIRTUAL_ADDRESS_NULL;
+
+#ifndef RELEASE
+    m_pResource->SetName(Name.c_str());
+#else
+    (Name);
+#endif
 }
 
 void PixelBuffer::ExportToFile( const std::wstring& FilePath )
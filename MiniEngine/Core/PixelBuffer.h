@@ -46,6 +46,16 @@ protected:
     void CreateTextureResource( ID3D12Device* Device, const std::wstring& Name, const D3D12_RESOURCE_DESC& ResourceDesc,
         D3D12_CLEAR_VALUE ClearValue, EsramAllocator& Allocator );
 
+    // Create a resource in memory that other resources may share.  It holds nothing until it is cleared, copied to,
+    // or discarded.
+    void CreatePlacedTextureResource( ID3D12Device* Device, const std::wstring& Name, const D3D12_RESOURCE_DESC& ResourceDesc,
+        D3D12_CLEAR_VALUE ClearValue, ID3D12Heap* Heap, uint64_t HeapOffset );
+
+    // Create a tiled resource with no memory behind it.  Tiles must be mapped with UpdateTileMappings()
+    // before they are rendered to or sampled.
+    void CreateReservedTextureResource( ID3D12Device* Device, const std::wstring& Name, const D3D12_RESOURCE_DESC& ResourceDesc,
+        D3D12_CLEAR_VALUE ClearValue );
+
     static DXGI_FORMAT GetBaseFormat( DXGI_FORMAT Format );
     static DXGI_FORMAT GetUAVFormat( DXGI_FORMAT Format );
     static DXGI_FORMAT GetDSVFormat( DXGI_FORMAT Format );
@@ -23,11 +23,13 @@
 #include "MotionBlur.h"
 #include "DepthOfField.h"
 #include "FXAA.h"
+#include "DynamicResolution.h"
 
 #include "CompiledShaders/ToneMapCS.h"
 #include "CompiledShaders/ToneMap2CS.h"
 #include "CompiledShaders/ToneMapHDRCS.h"
 #include "CompiledShaders/ToneMapHDR2CS.h"
+#include "CompiledShaders/ToneMapDisplayCS.h"
 #include "CompiledShaders/ApplyBloomCS.h"
 #include "CompiledShaders/ApplyBloom2CS.h"
 #include "CompiledShaders/DebugLuminanceHdrCS.h"
@@ -85,9 +87,14 @@ namespace PostEffects
     NumVar BloomUpsampleFactor("Graphics/Bloom/Scatter", 0.65f, 0.0f, 1.0f, 0.05f);    // Controls the "focus" of the blur.  High values spread out more causing a haze.
     BoolVar HighQualityBloom("Graphics/Bloom/High Quality", true);                    // High quality blurs 5 octaves of bloom; low quality only blurs 3.
 
+    BoolVar ColorGrading("Graphics/Color Grading/Enable", false);
+    NumVar GradeSaturation("Graphics/Color Grading/Saturation", 1.0f, 0.0f, 2.0f, 0.05f);
+    NumVar GradeContrast("Graphics/Color Grading/Contrast", 1.0f, 0.5f, 2.0f, 0.05f);
+
     RootSignature PostEffectsRS;
     ComputePSO ToneMapCS;
     ComputePSO ToneMapHDRCS;
+    ComputePSO ToneMapDisplayCS;
     ComputePSO ApplyBloomCS;
     ComputePSO DebugLuminanceHdrCS;
     ComputePSO DebugLuminanceLdrCS;
@@ -110,7 +117,7 @@ namespace PostEffects
     void BlurBuffer(ComputeContext&, ColorBuffer buffer[2], const ColorBuffer& lowerResBuf, float upsampleBlendFactor );
     void GenerateBloom(ComputeContext&);
     void ExtractLuma(ComputeContext&);
-    void ProcessHDR(ComputeContext&);
+    void ProcessHDR(ComputeContext&, ColorBuffer* DisplayTarget);
     void ProcessLDR(CommandContext&);
 }
 
@@ -146,6 +153,7 @@ void PostEffects::Initialize( void )
         CreatePSO(DebugLuminanceHdrCS, g_pDebugLuminanceHdrCS);
         CreatePSO(DebugLuminanceLdrCS, g_pDebugLuminanceLdrCS);
     }
+    CreatePSO( ToneMapDisplayCS, g_pToneMapDisplayCS );
     CreatePSO( GenerateHistogramCS, g_pGenerateHistogramCS );
     CreatePSO( DrawHistogramCS, g_pDebugDrawHistogramCS );
     CreatePSO( AdaptExposureCS, g_pAdaptExposureCS );
@@ -225,7 +233,11 @@ void PostEffects::GenerateBloom( ComputeContext& Context )
     ASSERT(kBloomWidth % 16 == 0 && kBloomHeight % 16 == 0, "Bloom buffer dimensions must be multiples of 16");
 
 
-    Context.SetConstants(0, 1.0f / kBloomWidth, 1.0f / kBloomHeight, (float)BloomThreshold );
+    // With dynamic resolution, the bloom buffer covers only the part of the buffer holding the image
+    const float ScaleX = (float)DynamicResolution::GetOutputWidth() / g_SceneColorBuffer.GetWidth();
+    const float ScaleY = (float)DynamicResolution::GetOutputHeight() / g_SceneColorBuffer.GetHeight();
+
+    Context.SetConstants(0, ScaleX / kBloomWidth, ScaleY / kBloomHeight, (float)BloomThreshold );
     Context.TransitionResource(g_aBloomUAV1[0], D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
     Context.TransitionResource(g_LumaLR, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
     Context.TransitionResource(g_SceneColorBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
@@ -308,7 +320,9 @@ void PostEffects::ExtractLuma( ComputeContext& Context )
 
     Context.TransitionResource(g_LumaLR, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
     Context.TransitionResource(g_Exposure, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
-    Context.SetConstants(0, 1.0f / g_LumaLR.GetWidth(), 1.0f / g_LumaLR.GetHeight());
+    const float ScaleX = (float)DynamicResolution::GetOutputWidth() / g_SceneColorBuffer.GetWidth();
+    const float ScaleY = (float)DynamicResolution::GetOutputHeight() / g_SceneColorBuffer.GetHeight();
+    Context.SetConstants(0, ScaleX / g_LumaLR.GetWidth(), ScaleY / g_LumaLR.GetHeight());
     Context.SetDynamicDescriptor(1, 0, g_LumaLR.GetUAV());
     Context.SetDynamicDescriptor(2, 0, g_SceneColorBuffer.GetSRV());
     Context.SetDynamicDescriptor(2, 1, g_Exposure.GetSRV());
@@ -364,7 +378,7 @@ void PostEffects::UpdateExposure( ComputeContext& Context )
     Context.TransitionResource(g_Exposure, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
 }
 
-void PostEffects::ProcessHDR( ComputeContext& Context )
+void PostEffects::ProcessHDR( ComputeContext& Context, ColorBuffer* DisplayTarget )
 {
     ScopedTimer _prof(L"HDR Tone Mapping", Context);
 
@@ -376,7 +390,9 @@ void PostEffects::ProcessHDR( ComputeContext& Context )
     else if (EnableAdaptation)
         ExtractLuma(Context);
 
-    if (g_bTypedUAVLoadSupport_R11G11B10_FLOAT)
+    if (DisplayTarget != nullptr)
+        Context.TransitionResource(*DisplayTarget, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    else if (g_bTypedUAVLoadSupport_R11G11B10_FLOAT)
         Context.TransitionResource(g_SceneColorBuffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
     else
         Context.TransitionResource(g_PostEffectsBuffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
@@ -384,14 +400,30 @@ void PostEffects::ProcessHDR( ComputeContext& Context )
     Context.TransitionResource(g_LumaBuffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
     Context.TransitionResource(g_Exposure, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
 
-    Context.SetPipelineState(FXAA::DebugDraw ? DebugLuminanceHdrCS : (g_bEnableHDROutput ? ToneMapHDRCS : ToneMapCS));
+    if (DisplayTarget != nullptr)
+        Context.SetPipelineState(ToneMapDisplayCS);
+    else
+        Context.SetPipelineState(FXAA::DebugDraw ? DebugLuminanceHdrCS : (g_bEnableHDROutput ? ToneMapHDRCS : ToneMapCS));
+
+    // Set constants, which map the render size to the whole bloom buffer
+    const uint32_t Width = DynamicResolution::GetOutputWidth(), Height = DynamicResolution::GetOutputHeight();
+    Context.SetConstants(0, 1.0f / Width, 1.0f / Height, (float)BloomStrength);
 
-    // Set constants
-    Context.SetConstants(0, 1.0f / g_SceneColorBuffer.GetWidth(), 1.0f / g_SceneColorBuffer.GetHeight(),
-        (float)BloomStrength);
+    // Tone mapping applies the grade on the way, which is the identity when grading is off
+    __declspec(align(16)) float GradeConstants[2] =
+    {
+        ColorGrading ? (float)GradeSaturation : 1.0f,
+        ColorGrading ? (float)GradeContrast : 1.0f
+    };
+    Context.SetDynamicConstantBufferView(3, sizeof(GradeConstants), GradeConstants);
 
     // Separate out SDR result from its perceived luminance
-    if (g_bTypedUAVLoadSupport_R11G11B10_FLOAT)
+    if (DisplayTarget != nullptr)
+    {
+        Context.SetDynamicDescriptor(1, 0, DisplayTarget->GetUAV());
+        Context.SetDynamicDescriptor(2, 2, g_SceneColorBuffer.GetSRV());
+    }
+    else if (g_bTypedUAVLoadSupport_R11G11B10_FLOAT)
         Context.SetDynamicDescriptor(1, 0, g_SceneColorBuffer.GetUAV());
     else
     {
@@ -404,7 +436,7 @@ void PostEffects::ProcessHDR( ComputeContext& Context )
     Context.SetDynamicDescriptor(2, 0, g_Exposure.GetSRV());
     Context.SetDynamicDescriptor(2, 1, BloomEnable ? g_aBloomUAV1[1].GetSRV() : TextureManager::GetBlackTex2D().GetSRV());
     
-    Context.Dispatch2D(g_SceneColorBuffer.GetWidth(), g_SceneColorBuffer.GetHeight());
+    Context.Dispatch2D(Width, Height);
 
     // Do this last so that the bright pass uses the same exposure as tone mapping
     UpdateExposure(Context);
@@ -430,9 +462,9 @@ void PostEffects::ProcessLDR(CommandContext& BaseContext)
         Context.TransitionResource(g_aBloomUAV1[1], D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
         Context.TransitionResource(g_LumaBuffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
 
-        // Set constants
-        Context.SetConstants(0, 1.0f / g_SceneColorBuffer.GetWidth(), 1.0f / g_SceneColorBuffer.GetHeight(),
-            (float)BloomStrength);
+        // Set constants, which map the render size to the whole bloom buffer
+        const uint32_t Width = DynamicResolution::GetOutputWidth(), Height = DynamicResolution::GetOutputHeight();
+        Context.SetConstants(0, 1.0f / Width, 1.0f / Height, (float)BloomStrength);
 
         // Separate out SDR result from its perceived luminance
         if (g_bTypedUAVLoadSupport_R11G11B10_FLOAT)
@@ -448,7 +480,7 @@ void PostEffects::ProcessLDR(CommandContext& BaseContext)
         Context.SetDynamicDescriptor(2, 0, bGenerateBloom ? g_aBloomUAV1[1].GetSRV() : TextureManager::GetBlackTex2D().GetSRV());
 
         Context.SetPipelineState(FXAA::DebugDraw ? DebugLuminanceLdrCS : ApplyBloomCS);
-        Context.Dispatch2D(g_SceneColorBuffer.GetWidth(), g_SceneColorBuffer.GetHeight());
+        Context.Dispatch2D(Width, Height);
 
         Context.TransitionResource(g_LumaBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
     }
@@ -463,7 +495,7 @@ void PostEffects::CopyBackPostBuffer( ComputeContext& Context )
     Context.TransitionResource(g_PostEffectsBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
     Context.SetDynamicDescriptor(1, 0, g_SceneColorBuffer.GetUAV());
     Context.SetDynamicDescriptor(2, 0, g_PostEffectsBuffer.GetSRV());
-    Context.Dispatch2D(g_SceneColorBuffer.GetWidth(), g_SceneColorBuffer.GetHeight());
+    Context.Dispatch2D(DynamicResolution::GetOutputWidth(), DynamicResolution::GetOutputHeight());
 }
 
 void PostEffects::Render( void )
@@ -471,11 +503,20 @@ void PostEffects::Render( void )
     ComputeContext& Context = ComputeContext::Begin(L"Post Effects");
 
     Context.SetRootSignature(PostEffectsRS);
+    g_FrameGraph.BeginPass(Context, kPostProcessPass);
+    EngineProfiling::BeginBlock(L"Post Effects", &Context);
 
     Context.TransitionResource(g_SceneColorBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
 
-    if (EnableHDR && !SSAO::DebugDraw && !(DepthOfField::Enable && DepthOfField::DebugMode >= 3))
-        ProcessHDR(Context);
+    // When tone mapping is the last pass over the image, it writes the back buffer in display encoding.  FXAA
+    // only rewrites the pixels on edges, so it still needs the scene buffer and the copy to the display.
+    const bool bProcessHDR = EnableHDR && !SSAO::DebugDraw && !(DepthOfField::Enable && DepthOfField::DebugMode >= 3);
+    ColorBuffer* DisplayTarget = nullptr;
+    if (bProcessHDR && !FXAA::Enable && !FXAA::DebugDraw && !DrawHistogram)
+        DisplayTarget = Graphics::GetFinalPassTarget();
+
+    if (bProcessHDR)
+        ProcessHDR(Context, DisplayTarget);
     else
         ProcessLDR(Context);
 
@@ -489,7 +530,9 @@ void PostEffects::Render( void )
     // changed, and some of them rely on texture filtering, which won't work with UINT.  Since this
     // is only to support legacy hardware and a single buffer copy isn't that big of a deal, this
     // is the most economical solution.
-    if (!g_bTypedUAVLoadSupport_R11G11B10_FLOAT)
+    if (DisplayTarget != nullptr)
+        Graphics::SetDisplayWritten();
+    else if (!g_bTypedUAVLoadSupport_R11G11B10_FLOAT)
         CopyBackPostBuffer(Context);
 
     if (DrawHistogram)
@@ -507,5 +550,6 @@ void PostEffects::Render( void )
         Context.TransitionResource(g_SceneColorBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
     }
 
+    EngineProfiling::EndBlock(&Context);
     Context.Finish();
 }
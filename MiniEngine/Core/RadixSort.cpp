@@ -0,0 +1,243 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "pch.h"
+#include "RadixSort.h"
+#include "RootSignature.h"
+#include "PipelineState.h"
+#include "CommandContext.h"
+#include "ReadbackBuffer.h"
+#include "Math/Common.h"
+#include "Math/Random.h"
+
+#include "CompiledShaders/RadixIndirectArgsCS.h"
+#include "CompiledShaders/Radix32CountCS.h"
+#include "CompiledShaders/Radix64CountCS.h"
+#include "CompiledShaders/RadixScanCS.h"
+#include "CompiledShaders/Radix32ScatterCS.h"
+#include "CompiledShaders/Radix64ScatterCS.h"
+
+namespace RadixSort
+{
+    // Must match RadixSortCommon.hlsli
+    const uint32_t kBlockSize = 2048;
+    const uint32_t kMaxBlocks = kMaxElements / kBlockSize;
+
+    IndirectArgsBuffer s_DispatchArgs;
+
+    // The digit counts of every block, followed by each digit's total
+    ByteAddressBuffer s_Histograms;
+
+    RootSignature s_RootSignature;
+    ComputePSO s_RadixIndirectArgsCS;
+    ComputePSO s_Radix32CountCS;
+    ComputePSO s_Radix64CountCS;
+    ComputePSO s_RadixScanCS;
+    ComputePSO s_Radix32ScatterCS;
+    ComputePSO s_Radix64ScatterCS;
+
+    // Called once by Core to initialize shaders
+    void Initialize(void);
+    void Shutdown(void);
+}
+
+void RadixSort::Initialize( void )
+{
+    s_DispatchArgs.Create(L"Radix sort dispatch args", 1, 12);
+    s_Histograms.Create(L"Radix sort histograms", 256 * kMaxBlocks + 256, sizeof(uint32_t));
+
+    s_RootSignature.Reset(4, 0);
+    s_RootSignature[0].InitAsConstants(0, 3);
+    s_RootSignature[1].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 0, 1);
+    s_RootSignature[2].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 0, 3);
+    s_RootSignature[3].InitAsConstants(1, 1);
+    s_RootSignature.Finalize(L"Radix Sort");
+
+#define CreatePSO( ObjName, ShaderByteCode ) \
+    ObjName.SetRootSignature(s_RootSignature); \
+    ObjName.SetComputeShader(ShaderByteCode, sizeof(ShaderByteCode) ); \
+    ObjName.Finalize();
+
+    CreatePSO(s_RadixIndirectArgsCS, g_pRadixIndirectArgsCS);
+    CreatePSO(s_Radix32CountCS,      g_pRadix32CountCS);
+    CreatePSO(s_Radix64CountCS,      g_pRadix64CountCS);
+    CreatePSO(s_RadixScanCS,         g_pRadixScanCS);
+    CreatePSO(s_Radix32ScatterCS,    g_pRadix32ScatterCS);
+    CreatePSO(s_Radix64ScatterCS,    g_pRadix64ScatterCS);
+
+#undef CreatePSO
+}
+
+void RadixSort::Shutdown( void )
+{
+    s_DispatchArgs.Destroy();
+    s_Histograms.Destroy();
+}
+
+void RadixSort::Sort(
+    ComputeContext& Context,
+    GpuBuffer& KeyIndexList,
+    GpuBuffer& ScratchList,
+    GpuBuffer& CounterBuffer,
+    uint32_t CounterOffset,
+    bool SortAscending,
+    bool Is64BitKey
+)
+{
+    const uint32_t ElementSizeBytes = KeyIndexList.GetElementSize();
+
+    ASSERT(ElementSizeBytes == 4 || ElementSizeBytes == 8, "Invalid key-index list for radix sort");
+    ASSERT(!Is64BitKey || ElementSizeBytes == 8, "64-bit keys require 8-byte elements");
+    ASSERT(KeyIndexList.GetElementCount() <= kMaxElements, "List is too long for the radix sort histograms");
+    ASSERT(ScratchList.GetElementSize() == ElementSizeBytes && ScratchList.GetElementCount() >= KeyIndexList.GetElementCount(),
+        "Radix sort scratch list is too small");
+
+    Context.SetRootSignature(s_RootSignature);
+    Context.SetConstants(3, CounterOffset);
+
+    // Generate execute indirect arguments
+    Context.SetPipelineState(s_RadixIndirectArgsCS);
+    Context.TransitionResource(CounterBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    Context.TransitionResource(s_DispatchArgs, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, true);
+    Context.SetDynamicDescriptor(1, 0, CounterBuffer.GetSRV());
+    Context.SetDynamicDescriptor(2, 0, s_DispatchArgs.GetUAV());
+    Context.Dispatch(1, 1, 1);
+
+    Context.TransitionResource(s_DispatchArgs, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT);
+    Context.TransitionResource(KeyIndexList, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    Context.TransitionResource(ScratchList, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    Context.TransitionResource(s_Histograms, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    Context.InsertUAVBarrier(KeyIndexList);
+    Context.InsertUAVBarrier(s_Histograms, true);
+
+    const bool b64BitElements = ElementSizeBytes == 8;
+    const uint32_t NumPasses = Is64BitKey ? 8 : 4;
+
+    GpuBuffer* Src = &KeyIndexList;
+    GpuBuffer* Dst = &ScratchList;
+
+    for (uint32_t Pass = 0; Pass < NumPasses; ++Pass)
+    {
+        // A 32-bit key in 8-byte elements is in the upper word, and a 64-bit key starts with the lower one
+        const uint32_t KeyWord = b64BitElements && !(Is64BitKey && Pass < 4) ? 1 : 0;
+        Context.SetConstants(0, (Pass % 4) * 8, KeyWord, SortAscending ? 0 : 0xff);
+        Context.SetDynamicDescriptor(2, 0, Src->GetUAV());
+        Context.SetDynamicDescriptor(2, 1, Dst->GetUAV());
+        Context.SetDynamicDescriptor(2, 2, s_Histograms.GetUAV());
+
+        Context.SetPipelineState(b64BitElements ? s_Radix64CountCS : s_Radix32CountCS);
+        Context.DispatchIndirect(s_DispatchArgs, 0);
+        Context.InsertUAVBarrier(s_Histograms);
+
+        Context.SetPipelineState(s_RadixScanCS);
+        Context.Dispatch(256, 1, 1);
+        Context.InsertUAVBarrier(s_Histograms);
+
+        Context.SetPipelineState(b64BitElements ? s_Radix64ScatterCS : s_Radix32ScatterCS);
+        Context.DispatchIndirect(s_DispatchArgs, 0);
+
+        // The next pass reads this one's output and overwrites its input
+        Context.InsertUAVBarrier(*Src);
+        Context.InsertUAVBarrier(*Dst);
+
+        std::swap(Src, Dst);
+    }
+}
+
+template <typename T>
+inline void VerifyRadixSort(const T* List, uint32_t ListLength, T KeyMask, T IndexMask, bool bAscending)
+{
+    for (uint32_t i = 0; i < ListLength; ++i)
+    {
+        ASSERT((List[i] & IndexMask) < ListLength, "Corrupted list index detected");
+
+        if (i + 1 == ListLength)
+            break;
+
+        if (bAscending)
+        {
+            ASSERT((List[i] & KeyMask) <= (List[i + 1] & KeyMask), "Invalid sort order:  non-ascending");
+        }
+        else
+        {
+            ASSERT((List[i] & KeyMask) >= (List[i + 1] & KeyMask), "Invalid sort order:  non-descending");
+        }
+    }
+}
+
+void TestRadixSort(uint32_t ListSize, bool b64Bit, bool b64BitKey, bool bAscending)
+{
+    const uint32_t SizeOfElem = b64Bit ? sizeof(uint64_t) : sizeof(uint32_t);
+    const uint32_t IndexMask = Math::AlignPowerOfTwo(ListSize) - 1;
+
+    // Initialize list with random keys and valid indices.  A 64-bit key spans the index, whose bits are random.
+    void* BufferPtr = std::malloc(ListSize * SizeOfElem);
+
+    if (b64Bit)
+    {
+        uint64_t* BufferPtr64 = (uint64_t*)BufferPtr;
+        for (uint32_t i = 0; i < ListSize; ++i)
+            BufferPtr64[i] = ((uint64_t)(uint32_t)Math::g_RNG.NextInt() << 32 | ((uint32_t)Math::g_RNG.NextInt() & ~IndexMask) | i);
+    }
+    else
+    {
+        uint32_t* BufferPtr32 = (uint32_t*)BufferPtr;
+        for (uint32_t i = 0; i < ListSize; ++i)
+            BufferPtr32[i] = (((uint32_t)Math::g_RNG.NextInt() & ~IndexMask) | i);
+    }
+
+    ByteAddressBuffer RandomListGpu;
+    RandomListGpu.Create(L"GPU Sort List", ListSize, SizeOfElem, BufferPtr);
+    std::free(BufferPtr);
+
+    ByteAddressBuffer ScratchListGpu;
+    ScratchListGpu.Create(L"GPU Sort Scratch List", ListSize, SizeOfElem);
+
+    __declspec(align(16)) uint32_t ListCounter[1] = { ListSize };
+    ByteAddressBuffer RandomListCount;
+    RandomListCount.Create(L"GPU List Counter", 1, sizeof(uint32_t), ListCounter);
+
+    ReadbackBuffer ReadbackList;
+    ReadbackList.Create(L"Random List For Sort", ListSize, SizeOfElem);
+
+    ComputeContext& Ctx = ComputeContext::Begin(L"Radix Sort Test");
+    RadixSort::Sort(Ctx, RandomListGpu, ScratchListGpu, RandomListCount, 0, bAscending, b64BitKey);
+    Ctx.CopyBuffer(ReadbackList, RandomListGpu);
+    Ctx.Finish(true);
+
+    BufferPtr = ReadbackList.Map();
+
+    if (b64Bit)
+    {
+        const uint64_t KeyMask = b64BitKey ? ~0ull : 0xffffffff00000000ull;
+        VerifyRadixSort((uint64_t*)BufferPtr, ListSize, KeyMask, (uint64_t)IndexMask, bAscending);
+    }
+    else
+    {
+        VerifyRadixSort((uint32_t*)BufferPtr, ListSize, ~0u, IndexMask, bAscending);
+    }
+
+    ReadbackList.Unmap();
+}
+
+void RadixSort::Test( void )
+{
+    // Lists of one partial block, of many blocks, and of blocks that scan in several rounds
+    const uint32_t ListSizes[] = { 1, 500, 2048, 2049, 100000, 1500000 };
+
+    for (uint32_t ListSize : ListSizes)
+    {
+        TestRadixSort(ListSize, true, true, true);
+        TestRadixSort(ListSize, true, true, false);
+        TestRadixSort(ListSize, true, false, true);
+        TestRadixSort(ListSize, true, false, false);
+        TestRadixSort(ListSize, false, false, true);
+        TestRadixSort(ListSize, false, false, false);
+    }
+}
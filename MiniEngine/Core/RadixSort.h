@@ -0,0 +1,67 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Radix sort orders a list in O( N ) work by distributing it over 256
+// buckets, one 8-bit digit of the key at a time, from the least significant
+// digit to the most.  Each pass is stable, so a pass keeps the order that the
+// earlier digits established among elements whose digit is equal.  A 32-bit
+// key takes four passes and a 64-bit key eight.
+//
+// Every pass takes three dispatches.  The list is cut into blocks of 2048
+// elements, and the first dispatch counts each block's digits.  The second
+// scans the counts of each digit across the blocks, so that every block
+// knows where its elements of each digit go.  The third sorts each block by
+// the digit in LDS and writes it to those offsets in a second buffer.  The
+// passes alternate between the two buffers, and with an even number of
+// passes the list ends up back where it started.
+//
+// Bitonic sort does O( N*(log N)^2 ) work, but with all of it in a few
+// dispatches for each doubling of the list.  Radix sort's fixed number of
+// passes wins once lists grow past a few hundred thousand elements, which
+// BitonicSort::Test() measures.
+//
+// The list layout matches BitonicSort's, and the count of items is read from
+// a GPU buffer in the same way.
+
+#pragma once
+
+#include "GpuBuffer.h"
+
+namespace RadixSort
+{
+    // The histograms are allocated for lists of at most this many elements
+    enum { kMaxElements = 2048 * 4096 };
+
+    void Sort(
+        // An existing compute context
+        ComputeContext& Context,
+
+        // List to be sorted.  If element size is 4 bytes, it is assumed the key and index are packed
+        // together with the key in the most significant bytes.  If element size is 8 bytes, the key
+        // is assumed in the upper 4 bytes (i.e. uint2.y), unless Is64BitKey is set.
+        GpuBuffer& KeyIndexList,
+
+        // A buffer of the same element size and at least as many elements, whose contents are lost
+        GpuBuffer& ScratchList,
+
+        // A buffer containing the count of items to be sorted.
+        GpuBuffer& CountBuffer,
+
+        // Offset into counter buffer to find count for this list.  Must be a multiple of 4 bytes.
+        uint32_t CounterOffset,
+
+        // True to sort in ascending order (smallest to largest).  False to sort in descending order.
+        bool SortAscending,
+
+        // True to sort 8-byte elements by the whole element, with uint2.y the most significant word
+        bool Is64BitKey = false
+    );
+
+    void Test( void );
+
+} // namespace RadixSort
@@ -14,6 +14,7 @@
 #include "pch.h"
 #include "ReadbackBuffer.h"
 #include "GraphicsCore.h"
+#include "GpuMemoryTracker.h"
 
 using namespace Graphics;
 
@@ -49,6 +50,7 @@ void ReadbackBuffer::Create( const std::wstring& name, uint32_t NumElements, uin
 
     ASSERT_SUCCEEDED( g_Device->CreateCommittedResource(&HeapProps, D3D12_HEAP_FLAG_NONE, &ResourceDesc,
         D3D12_RESOURCE_STATE_COPY_DEST, nullptr, MY_IID_PPV_ARGS(&m_pResource)) );
+    GpuMemoryTracker::TrackResource(m_pResource.Get(), GpuMemoryTracker::kReadbackBuffers);
 
     m_GpuVirtualAddress = m_pResource->GetGPUVirtualAddress();
 
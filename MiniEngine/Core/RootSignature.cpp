@@ -15,19 +15,41 @@
 #include "RootSignature.h"
 #include "GraphicsCore.h"
 #include "Hash.h"
-#include <map>
+#include "ConcurrentHashMap.h"
+#include "StartupProfile.h"
 #include <thread>
-#include <mutex>
 
 using namespace Graphics;
 using namespace std;
 using Microsoft::WRL::ComPtr;
 
-static std::map< size_t, ComPtr<ID3D12RootSignature> > s_RootSignatureHashMap;
+namespace
+{
+    struct CachedSignature
+    {
+        CachedSignature() : Signature(nullptr) {}
+        ~CachedSignature()
+        {
+            if (ID3D12RootSignature* Created = Signature.load())
+                Created->Release();
+        }
+
+        // Null until the thread that inserted the entry has created it
+        std::atomic<ID3D12RootSignature*> Signature;
+    };
+}
+
+static ConcurrentHashMap<CachedSignature> s_RootSignatureHashMap;
 
 void RootSignature::DestroyAll(void)
 {
-    s_RootSignatureHashMap.clear();
+    s_RootSignatureHashMap.Clear();
+}
+
+void RootSignature::ReportCacheStatistics(void)
+{
+    EngineProfiling::SetCounter("Root Signature Cache Hits", s_RootSignatureHashMap.GetHitCount());
+    EngineProfiling::SetCounter("Root Signature Cache Misses", s_RootSignatureHashMap.GetMissCount());
 }
 
 void RootSignature::InitStaticSampler(
@@ -106,11 +128,16 @@ void RootSignature::Finalize(const std::wstring& name, D3D12_ROOT_SIGNATURE_FLAG
     size_t HashCode = Utility::HashState(&RootDesc.Flags);
     HashCode = Utility::HashState( RootDesc.pStaticSamplers, m_NumSamplers, HashCode );
 
+    // Only the members of each parameter are hashed, never its padding or pointers, so that the hash is the same
+    // from one launch to the next.  The pipeline cache names pipelines with it.
     for (UINT Param = 0; Param < m_NumParameters; ++Param)
     {
         const D3D12_ROOT_PARAMETER& RootParam = RootDesc.pParameters[Param];
         m_DescriptorTableSize[Param] = 0;
 
+        HashCode = Utility::HashState( &RootParam.ParameterType, 1, HashCode );
+        HashCode = Utility::HashState( &RootParam.ShaderVisibility, 1, HashCode );
+
         if (RootParam.ParameterType == D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE)
         {
             ASSERT(RootParam.DescriptorTable.pDescriptorRanges != nullptr);
@@ -121,35 +148,27 @@ void RootSignature::Finalize(const std::wstring& name, D3D12_ROOT_SIGNATURE_FLAG
             // We keep track of sampler descriptor tables separately from CBV_SRV_UAV descriptor tables
             if (RootParam.DescriptorTable.pDescriptorRanges->RangeType == D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER)
                 m_SamplerTableBitMap |= (1 << Param);
-            else
+            else if ((m_PersistentTableBitMap & (1 << Param)) == 0)
                 m_DescriptorTableBitMap |= (1 << Param);
 
             for (UINT TableRange = 0; TableRange < RootParam.DescriptorTable.NumDescriptorRanges; ++TableRange)
                 m_DescriptorTableSize[Param] += RootParam.DescriptorTable.pDescriptorRanges[TableRange].NumDescriptors;
         }
+        else if (RootParam.ParameterType == D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS)
+            HashCode = Utility::HashState( &RootParam.Constants, 1, HashCode );
         else
-            HashCode = Utility::HashState( &RootParam, 1, HashCode );
+            HashCode = Utility::HashState( &RootParam.Descriptor, 1, HashCode );
     }
 
-    ID3D12RootSignature** RSRef = nullptr;
-    bool firstCompile = false;
-    {
-        static mutex s_HashMapMutex;
-        lock_guard<mutex> CS(s_HashMapMutex);
-        auto iter = s_RootSignatureHashMap.find(HashCode);
+    m_HashCode = HashCode;
 
-        // Reserve space so the next inquiry will find that someone got here first.
-        if (iter == s_RootSignatureHashMap.end())
-        {
-            RSRef = s_RootSignatureHashMap[HashCode].GetAddressOf();
-            firstCompile = true;
-        }
-        else
-            RSRef = iter->second.GetAddressOf();
-    }
+    // Reserve space so the next inquiry will find that someone got here first.
+    bool firstCompile = false;
+    CachedSignature* Cached = s_RootSignatureHashMap.FindOrInsert(HashCode, firstCompile);
 
     if (firstCompile)
     {
+        StartupProfile::ScopedSpan Span(StartupProfile::kRootSignatureCreation);
         ComPtr<ID3DBlob> pOutBlob, pErrorBlob;
 
         ASSERT_SUCCEEDED( D3D12SerializeRootSignature(&RootDesc, D3D_ROOT_SIGNATURE_VERSION_1,
@@ -160,14 +179,12 @@ void RootSignature::Finalize(const std::wstring& name, D3D12_ROOT_SIGNATURE_FLAG
 
         m_Signature->SetName(name.c_str());
 
-        s_RootSignatureHashMap[HashCode].Attach(m_Signature);
-        ASSERT(*RSRef == m_Signature);
+        Cached->Signature.store(m_Signature, std::memory_order_release);
     }
     else
     {
-        while (*RSRef == nullptr)
+        while ((m_Signature = Cached->Signature.load(std::memory_order_acquire)) == nullptr)
             this_thread::yield();
-        m_Signature = *RSRef;
     }
 
     m_Finalized = TRUE;
@@ -127,6 +127,9 @@ public:
 
     static void DestroyAll(void);
 
+    // Lists the cache's hits and misses with the profiler's counters
+    static void ReportCacheStatistics(void);
+
     void Reset( UINT NumRootParams, UINT NumStaticSamplers = 0 )
     {
         if (NumRootParams > 0)
@@ -141,6 +144,7 @@ public:
             m_SamplerArray = nullptr;
         m_NumSamplers = NumStaticSamplers;
         m_NumInitializedStaticSamplers = 0;
+        m_PersistentTableBitMap = 0;
     }
 
     RootParameter& operator[] ( size_t EntryIndex )
@@ -158,10 +162,21 @@ public:
     void InitStaticSampler( UINT Register, const D3D12_SAMPLER_DESC& NonStaticSamplerDesc,
         D3D12_SHADER_VISIBILITY Visibility = D3D12_SHADER_VISIBILITY_ALL );
 
+    // Marks a CBV_SRV_UAV descriptor table as pointing into the persistent region of the dynamic descriptor
+    // heaps rather than at descriptors staged each draw.  See DynamicDescriptorHeap::SetPersistentDescriptors().
+    void SetPersistentTable( UINT RootIndex )
+    {
+        ASSERT(RootIndex < m_NumParameters && !m_Finalized);
+        m_PersistentTableBitMap |= (1 << RootIndex);
+    }
+
     void Finalize(const std::wstring& name, D3D12_ROOT_SIGNATURE_FLAGS Flags = D3D12_ROOT_SIGNATURE_FLAG_NONE);
 
     ID3D12RootSignature* GetSignature() const { return m_Signature; }
 
+    // Identifies the layout across launches.  Valid once finalized.
+    size_t GetHashCode() const { return m_HashCode; }
+
 protected:
 
     BOOL m_Finalized;
@@ -170,8 +185,10 @@ protected:
     UINT m_NumInitializedStaticSamplers;
     uint32_t m_DescriptorTableBitMap;        // One bit is set for root parameters that are non-sampler descriptor tables
     uint32_t m_SamplerTableBitMap;            // One bit is set for root parameters that are sampler descriptor tables
+    uint32_t m_PersistentTableBitMap;        // One bit is set for descriptor tables bound to the persistent region
     uint32_t m_DescriptorTableSize[16];        // Non-sampler descriptor tables need to know their descriptor count
     std::unique_ptr<RootParameter[]> m_ParamArray;
     std::unique_ptr<D3D12_STATIC_SAMPLER_DESC[]> m_SamplerArray;
     ID3D12RootSignature* m_Signature;
+    size_t m_HashCode;
 };
@@ -18,6 +18,7 @@
 #include "CommandContext.h"
 #include "Camera.h"
 #include "TemporalEffects.h"
+#include "DynamicResolution.h"
 
 #include "CompiledShaders/AoPrepareDepthBuffers1CS.h"
 #include "CompiledShaders/AoPrepareDepthBuffers2CS.h"
@@ -29,6 +30,7 @@
 #include "CompiledShaders/AoBlurUpsamplePreMinBlendOutCS.h"
 #include "CompiledShaders/AoBlurUpsampleCS.h"
 #include "CompiledShaders/AoBlurUpsamplePreMinCS.h"
+#include "CompiledShaders/AoTemporalCS.h"
 
 using namespace Graphics;
 using namespace Math;
@@ -65,6 +67,10 @@ namespace SSAO
     NumVar Accentuation("Graphics/SSAO/Accentuation", 0.1f, 0.0f, 1.0f, 0.1f);
 
     IntVar HierarchyDepth("Graphics/SSAO/Hierarchy Depth", 3, 1, 4);
+
+    // Renders half of the interleaved slices each frame and blends with the reprojected result of the last
+    BoolVar Temporal("Graphics/SSAO/Temporal", false);
+    NumVar TemporalBlend("Graphics/SSAO/Temporal Blend", 0.5f, 0.0f, 0.9f, 0.05f);
 }
 
 namespace
@@ -78,8 +84,26 @@ namespace
     ComputePSO s_BlurUpsampleFinal[2];    // Don't blend the result, just upsample it
     ComputePSO s_LinearizeDepthCS;
     ComputePSO s_DebugSSAOCS;
+    ComputePSO s_TemporalCS;
+
+    // Whether g_AOHistory holds last frame's temporal result
+    bool s_HistoryValid = false;
 
     float SampleThickness[12];    // Pre-computed sample thicknesses
+
+    void DispatchLinearizeDepth( ComputeContext& Context, float zMagic, ColorBuffer& LinearDepth )
+    {
+        Context.SetRootSignature(s_RootSignature);
+
+        Context.TransitionResource(g_SceneDepthBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        Context.SetConstants(0, zMagic);
+        Context.SetDynamicDescriptor(3, 0, g_SceneDepthBuffer.GetDepthSRV());
+
+        Context.TransitionResource(LinearDepth, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+        Context.SetDynamicDescriptors(2, 0, 1, &LinearDepth.GetUAV());
+        Context.SetPipelineState(s_LinearizeDepthCS);
+        Context.Dispatch2D(LinearDepth.GetWidth(), LinearDepth.GetHeight(), 16, 16);
+    }
 }
 
 void SSAO::Initialize( void )
@@ -110,6 +134,7 @@ void SSAO::Initialize( void )
     CreatePSO( s_BlurUpsampleBlend[1], g_pAoBlurUpsamplePreMinBlendOutCS );
     CreatePSO( s_BlurUpsampleFinal[0], g_pAoBlurUpsampleCS );
     CreatePSO( s_BlurUpsampleFinal[1], g_pAoBlurUpsamplePreMinCS );
+    CreatePSO( s_TemporalCS, g_pAoTemporalCS );
 
     SampleThickness[ 0] = sqrt(1.0f - 0.2f * 0.2f);
     SampleThickness[ 1] = sqrt(1.0f - 0.4f * 0.4f);
@@ -131,7 +156,9 @@ void SSAO::Shutdown(void)
 
 namespace SSAO
 {
-    void ComputeAO( ComputeContext& Context, ColorBuffer& Destination, ColorBuffer& DepthBuffer, const float TanHalfFovH )
+    // SliceParity is 1 + the parity of the interleaved slices to render in the temporal mode, or 0 for all of them
+    void ComputeAO( ComputeContext& Context, ColorBuffer& Destination, ColorBuffer& DepthBuffer, const float TanHalfFovH,
+        uint32_t SliceParity = 0 )
     {
         size_t BufferWidth = DepthBuffer.GetWidth();
         size_t BufferHeight = DepthBuffer.GetHeight();
@@ -161,7 +188,7 @@ namespace SSAO
         // This will transform a depth value from [0, thickness] to [0, 1].
         float InverseRangeFactor = 1.0f / ThicknessMultiplier;
 
-        __declspec(align(16)) float SsaoCB[28];
+        __declspec(align(16)) float SsaoCB[29];
 
         // The thicknesses are smaller for all off-center samples of the sphere.  Compute thicknesses relative
         // to the center sample.
@@ -219,6 +246,7 @@ namespace SSAO
         SsaoCB[25] = 1.0f / BufferHeight;
         SsaoCB[26] = 1.0f / -RejectionFalloff;
         SsaoCB[27] = 1.0f / (1.0f + Accentuation);
+        reinterpret_cast<uint32_t&>(SsaoCB[28]) = SliceParity;
 
         Context.SetDynamicConstantBufferView(1, sizeof(SsaoCB), SsaoCB);
         Context.SetDynamicDescriptor(2, 0, Destination.GetUAV());
@@ -227,7 +255,7 @@ namespace SSAO
         if (ArrayCount == 1)
             Context.Dispatch2D(BufferWidth, BufferHeight, 16, 16);
         else
-            Context.Dispatch3D(BufferWidth, BufferHeight, ArrayCount, 8, 8, 1);
+            Context.Dispatch3D(BufferWidth, BufferHeight, SliceParity != 0 ? ArrayCount / 2 : ArrayCount, 8, 8, 1);
     }
     
     void BlurAndUpsample( ComputeContext& Context,
@@ -286,22 +314,113 @@ namespace SSAO
 
         Context.Dispatch2D(HiWidth+2, HiHeight+2, 16, 16);
     }
+
+    // Blends the half resolution AO with the history at its reprojected position and returns the result
+    ColorBuffer& ResolveTemporal( ComputeContext& Context, ColorBuffer& CurrentAO, const Camera& camera, uint32_t FrameIndex )
+    {
+        ScopedTimer _prof(L"Temporal Resolve", Context);
+
+        ColorBuffer& History = g_AOHistory[FrameIndex ^ 1];
+        ColorBuffer& Destination = g_AOHistory[FrameIndex];
+        ColorBuffer& PrevDepth = g_LinearDepth[FrameIndex ^ 1];
+
+        // The same transform as the camera velocity, from pixels of the render size and linear depth.  The
+        // buffers are addressed over their whole size.
+        const float RcpHalfDimX = 2.0f / DynamicResolution::GetWidth();
+        const float RcpHalfDimY = 2.0f / DynamicResolution::GetHeight();
+        const float RcpZMagic = camera.GetNearClip() / (camera.GetFarClip() - camera.GetNearClip());
+
+        Matrix4 preMult = Matrix4(
+            Vector4( RcpHalfDimX, 0.0f, 0.0f, 0.0f ),
+            Vector4( 0.0f, -RcpHalfDimY, 0.0f, 0.0f ),
+            Vector4( 0.0f, 0.0f, RcpZMagic, 0.0f ),
+            Vector4( -1.0f, 1.0f, -RcpZMagic, 1.0f )
+        );
+
+        Matrix4 postMult = Matrix4(
+            Vector4( 1.0f / RcpHalfDimX, 0.0f, 0.0f, 0.0f ),
+            Vector4( 0.0f, -1.0f / RcpHalfDimY, 0.0f, 0.0f ),
+            Vector4( 0.0f, 0.0f, 1.0f, 0.0f ),
+            Vector4( 1.0f / RcpHalfDimX, 1.0f / RcpHalfDimY, 0.0f, 1.0f ) );
+
+        __declspec(align(16)) struct
+        {
+            Matrix4 CurToPrevXForm;
+            float RcpFullDimension[2];
+            float HistoryWeight;
+            float DepthTolerance;
+        } cbData;
+
+        cbData.CurToPrevXForm = postMult * camera.GetReprojectionMatrix() * preMult;
+        cbData.RcpFullDimension[0] = 1.0f / PrevDepth.GetWidth();
+        cbData.RcpFullDimension[1] = 1.0f / PrevDepth.GetHeight();
+        cbData.HistoryWeight = s_HistoryValid ? (float)TemporalBlend : 0.0f;
+        cbData.DepthTolerance = 0.05f;
+
+        Context.SetPipelineState(s_TemporalCS);
+        Context.SetDynamicConstantBufferView(1, sizeof(cbData), &cbData);
+
+        Context.TransitionResource(CurrentAO, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        Context.TransitionResource(History, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        Context.TransitionResource(PrevDepth, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        Context.TransitionResource(Destination, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, true);
+        D3D12_CPU_DESCRIPTOR_HANDLE SRVs[4] = { CurrentAO.GetSRV(), History.GetSRV(), g_DepthDownsize1.GetSRV(), PrevDepth.GetSRV() };
+        Context.SetDynamicDescriptors(3, 0, 4, SRVs);
+        Context.SetDynamicDescriptor(2, 0, Destination.GetUAV());
+        Context.Dispatch2D(Destination.GetWidth(), Destination.GetHeight());
+
+        s_HistoryValid = true;
+        return Destination;
+    }
+
+    // AsyncContext is a compute queue context owned by the caller, or null to record on GfxContext (or an
+    // async context of our own when AsyncCompute is set)
+    // The camera, when there is one, allows for the temporal mode.
+    void RenderAO( GraphicsContext& GfxContext, ComputeContext* AsyncContext, const float* ProjMat, float NearClipDist,
+        float FarClipDist, const Camera* camera );
 }
 
 void SSAO::Render( GraphicsContext& GfxContext, const Camera& camera )
 {
     const float* pProjMat = reinterpret_cast<const float*>(&camera.GetProjMatrix());
-    Render(GfxContext, pProjMat, camera.GetNearClip(), camera.GetFarClip() );
+    RenderAO(GfxContext, nullptr, pProjMat, camera.GetNearClip(), camera.GetFarClip(), &camera );
+}
+
+void SSAO::Render( GraphicsContext& GfxContext, ComputeContext& AsyncContext, const Camera& camera )
+{
+    const float* pProjMat = reinterpret_cast<const float*>(&camera.GetProjMatrix());
+    RenderAO(GfxContext, &AsyncContext, pProjMat, camera.GetNearClip(), camera.GetFarClip(), &camera );
 }
 
 void SSAO::Render( GraphicsContext& GfxContext, const float* ProjMat, float NearClipDist, float FarClipDist )
 {
+    RenderAO(GfxContext, nullptr, ProjMat, NearClipDist, FarClipDist, nullptr);
+}
+
+void SSAO::LinearizeDepth( ComputeContext& Context, const Camera& camera )
+{
+    ScopedTimer _prof(L"Linearize Depth", Context);
+
+    const float zMagic = (camera.GetFarClip() - camera.GetNearClip()) / camera.GetNearClip();
+    DispatchLinearizeDepth(Context, zMagic, g_LinearDepth[TemporalEffects::GetFrameIndexMod2()]);
+}
+
+void SSAO::RenderAO( GraphicsContext& GfxContext, ComputeContext* AsyncContext, const float* ProjMat, float NearClipDist,
+    float FarClipDist, const Camera* camera )
+{
+    // The debug view composites on the graphics queue, which a caller owned context has not reached yet
+    ASSERT(!DebugDraw || AsyncContext == nullptr, "SSAO debug draw cannot be recorded on a caller's async context");
+
     uint32_t FrameIndex = TemporalEffects::GetFrameIndexMod2();
 
     ColorBuffer& LinearDepth = g_LinearDepth[FrameIndex];
 
     const float zMagic = (FarClipDist - NearClipDist) / NearClipDist;
 
+    const bool UseTemporal = Temporal && camera != nullptr;
+    if (!Enable || !UseTemporal)
+        s_HistoryValid = false;
+
     if (!Enable)
     {
         ScopedTimer _prof(L"Generate SSAO", GfxContext);
@@ -313,17 +432,8 @@ void SSAO::Render( GraphicsContext& GfxContext, const float* ProjMat, float Near
         if (!ComputeLinearZ)
             return;
 
-        ComputeContext& Context = GfxContext.GetComputeContext();
-        Context.SetRootSignature(s_RootSignature);
-
-        Context.TransitionResource(g_SceneDepthBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
-        Context.SetConstants(0, zMagic);
-        Context.SetDynamicDescriptor(3, 0, g_SceneDepthBuffer.GetDepthSRV());
-
-        Context.TransitionResource(LinearDepth, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
-        Context.SetDynamicDescriptors(2, 0, 1, &LinearDepth.GetUAV());
-        Context.SetPipelineState(s_LinearizeDepthCS);
-        Context.Dispatch2D(LinearDepth.GetWidth(), LinearDepth.GetHeight(), 16, 16);
+        ComputeContext& Context = AsyncContext != nullptr ? *AsyncContext : GfxContext.GetComputeContext();
+        DispatchLinearizeDepth(Context, zMagic, LinearDepth);
 
         if (DebugDraw)
         {
@@ -338,21 +448,29 @@ void SSAO::Render( GraphicsContext& GfxContext, const float* ProjMat, float Near
         return;
     }
 
-    GfxContext.TransitionResource(g_SceneDepthBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
-    GfxContext.TransitionResource(g_SSAOFullScreen, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    // A caller owned async context was fenced against the depth pre-pass after these transitions were made
+    if (AsyncContext == nullptr)
+    {
+        GfxContext.TransitionResource(g_SceneDepthBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        GfxContext.TransitionResource(g_SSAOFullScreen, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    }
+
+    const bool OwnAsyncContext = AsyncContext == nullptr && AsyncCompute;
 
-    if (AsyncCompute)
+    if (OwnAsyncContext)
     {
         // Flush the ZPrePass and wait for it on the compute queue
         g_CommandManager.GetComputeQueue().StallForFence(GfxContext.Flush());
     }
     else
     {
-        EngineProfiling::BeginBlock(L"Generate SSAO", &GfxContext);
+        EngineProfiling::BeginBlock(L"Generate SSAO", AsyncContext != nullptr ? AsyncContext : &GfxContext);
     }
 
-    ComputeContext& Context = AsyncCompute ? ComputeContext::Begin(L"Async SSAO", true) : GfxContext.GetComputeContext();
+    ComputeContext& Context = AsyncContext != nullptr ? *AsyncContext :
+        AsyncCompute ? ComputeContext::Begin(L"Async SSAO", true) : GfxContext.GetComputeContext();
     Context.SetRootSignature(s_RootSignature);
+    g_FrameGraph.BeginPass(Context, kSSAOPass);
 
     { ScopedTimer _prof(L"Decompress and downsample", Context);
 
@@ -394,6 +512,9 @@ void SSAO::Render( GraphicsContext& GfxContext, const float* ProjMat, float Near
     // Load first element of projection matrix which is the cotangent of the horizontal FOV divided by 2.
     const float FovTangent = 1.0f / ProjMat[0];
 
+    // The interleaved passes alternate between the two checkerboards of slices
+    const uint32_t SliceParity = UseTemporal ? 1 + (FrameIndex & 1) : 0;
+
     Context.TransitionResource(g_AOMerged1, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
     Context.TransitionResource(g_AOMerged2, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
     Context.TransitionResource(g_AOMerged3, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
@@ -415,7 +536,7 @@ void SSAO::Render( GraphicsContext& GfxContext, const float* ProjMat, float Near
     if (HierarchyDepth > 3)
     {
         Context.SetPipelineState( s_Render1CS );
-        ComputeAO( Context, g_AOMerged4, g_DepthTiled4, FovTangent );
+        ComputeAO( Context, g_AOMerged4, g_DepthTiled4, FovTangent, SliceParity );
         if (g_QualityLevel >= kSsaoQualityLow)
         {
             Context.SetPipelineState( s_Render2CS );
@@ -425,7 +546,7 @@ void SSAO::Render( GraphicsContext& GfxContext, const float* ProjMat, float Near
     if (HierarchyDepth > 2)
     {
         Context.SetPipelineState( s_Render1CS );
-        ComputeAO( Context, g_AOMerged3, g_DepthTiled3, FovTangent );
+        ComputeAO( Context, g_AOMerged3, g_DepthTiled3, FovTangent, SliceParity );
         if (g_QualityLevel >= kSsaoQualityMedium)  
         {
             Context.SetPipelineState( s_Render2CS );
@@ -435,7 +556,7 @@ void SSAO::Render( GraphicsContext& GfxContext, const float* ProjMat, float Near
     if (HierarchyDepth > 1)
     {
         Context.SetPipelineState( s_Render1CS );
-        ComputeAO( Context, g_AOMerged2, g_DepthTiled2, FovTangent );
+        ComputeAO( Context, g_AOMerged2, g_DepthTiled2, FovTangent, SliceParity );
         if (g_QualityLevel >= kSsaoQualityHigh)       
         {
             Context.SetPipelineState( s_Render2CS );
@@ -444,7 +565,7 @@ void SSAO::Render( GraphicsContext& GfxContext, const float* ProjMat, float Near
     }
     {
         Context.SetPipelineState( s_Render1CS );
-        ComputeAO( Context, g_AOMerged1, g_DepthTiled1, FovTangent );
+        ComputeAO( Context, g_AOMerged1, g_DepthTiled1, FovTangent, SliceParity );
         if (g_QualityLevel >= kSsaoQualityVeryHigh)
         {
             Context.SetPipelineState( s_Render2CS );
@@ -494,20 +615,23 @@ void SSAO::Render( GraphicsContext& GfxContext, const float* ProjMat, float Near
     else
         NextSRV = &g_AOMerged1;
 
+    if (UseTemporal)
+        NextSRV = &ResolveTemporal(Context, *NextSRV, *camera, FrameIndex);
+
     // 960 x 540 -> 1920 x 1080
     BlurAndUpsample( Context, g_SSAOFullScreen, LinearDepth, g_DepthDownsize1, NextSRV,
         g_QualityLevel >= kSsaoQualityVeryHigh ? &g_AOHighQuality1 : nullptr, nullptr );
 
     } // End blur and upsample
 
-    if (AsyncCompute)
+    if (OwnAsyncContext)
         Context.Finish();
     else
-        EngineProfiling::EndBlock(&GfxContext);
+        EngineProfiling::EndBlock(AsyncContext != nullptr ? AsyncContext : &GfxContext);
 
     if (DebugDraw)
     {
-        if (AsyncCompute)
+        if (OwnAsyncContext)
         {
             g_CommandManager.GetGraphicsQueue().StallForProducer(
                 g_CommandManager.GetComputeQueue());
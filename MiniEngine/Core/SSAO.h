@@ -22,6 +22,14 @@ namespace SSAO
     void Render(GraphicsContext& Context, const float* ProjMat, float NearClipDist, float FarClipDist );
     void Render(GraphicsContext& Context, const Math::Camera& camera );
 
+    // Records SSAO (or just the linear depth when disabled) into a compute queue context that the caller submits.
+    // Before flushing the graphics context for the compute queue to wait on, the caller transitions the depth
+    // buffer to a non-pixel shader resource and the AO target to unordered access.
+    void Render(GraphicsContext& Context, ComputeContext& AsyncContext, const Math::Camera& camera );
+
+    // Linearizes the depth buffer again without the AO, for a depth buffer that changed after Render()
+    void LinearizeDepth(ComputeContext& Context, const Math::Camera& camera );
+
     extern BoolVar Enable;
     extern BoolVar DebugDraw;
     extern BoolVar AsyncCompute;
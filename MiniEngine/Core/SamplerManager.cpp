@@ -17,6 +17,7 @@
 #include "GraphicsCore.h"
 #include "Hash.h"
 #include <map>
+#include <mutex>
 
 using namespace std;
 using namespace Graphics;
@@ -24,11 +25,15 @@ using namespace Graphics;
 namespace
 {
     map< size_t, D3D12_CPU_DESCRIPTOR_HANDLE > s_SamplerCache;
+    mutex s_SamplerMutex;
 }
 
 D3D12_CPU_DESCRIPTOR_HANDLE SamplerDesc::CreateDescriptor()
 {
     size_t hashValue = Utility::HashState(this);
+
+    lock_guard<mutex> LockGuard(s_SamplerMutex);
+
     auto iter = s_SamplerCache.find(hashValue);
     if (iter != s_SamplerCache.end())
     {
@@ -37,6 +42,7 @@ D3D12_CPU_DESCRIPTOR_HANDLE SamplerDesc::CreateDescriptor()
 
     D3D12_CPU_DESCRIPTOR_HANDLE Handle = AllocateDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER);
     g_Device->CreateSampler(this, Handle);
+    s_SamplerCache[hashValue] = Handle;
     return Handle;
 }
 
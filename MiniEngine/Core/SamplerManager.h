@@ -54,9 +54,10 @@ public:
         BorderColor[3] = Border.A();
     }
 
-    // Allocate new descriptor as needed; return handle to existing descriptor when possible
+    // Allocate new descriptor as needed; return handle to existing descriptor when possible.  The handle never
+    // changes, so sampler tables made of such handles are copied once into the shader-visible heap and shared.
     D3D12_CPU_DESCRIPTOR_HANDLE CreateDescriptor( void );
 
-    // Create descriptor in place (no deduplication)
+    // Create descriptor in place (no deduplication).  Don't rewrite a handle a sampler table has been set with.
     void CreateDescriptor( D3D12_CPU_DESCRIPTOR_HANDLE& Handle );
 };
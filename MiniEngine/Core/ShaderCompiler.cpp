@@ -0,0 +1,533 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "pch.h"
+#include "ShaderCompiler.h"
+#include "Hash.h"
+#include "SystemTime.h"
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <mutex>
+
+#if ENABLE_RUNTIME_SHADERS
+#include <dxcapi.h>
+#endif
+
+using namespace std;
+using Microsoft::WRL::ComPtr;
+
+namespace ShaderCompiler
+{
+    // Does the work on a permutation for the functions below
+    struct PermutationAccess
+    {
+        static void Create( Permutation& P, const wstring& SourcePath, const wstring& EntryPoint, const wstring& Target,
+            const vector<Define>& Defines, const D3D12_SHADER_BYTECODE& Embedded );
+        static void StartCompile( Permutation& P );
+        static void WaitForCompile( Permutation& P );
+        static bool Compile( Permutation& P, shared_ptr<vector<uint8_t>>& Bytecode, vector<Permutation::SourceFile>& Files );
+        static void CompileFirst( Permutation& P );
+        static void CheckForEdits( Permutation& P );
+        static void Reload( Permutation& P, const shared_ptr<vector<uint8_t>>& Bytecode );
+        static bool IsWatched( const Permutation& P ) { return !P.m_Files.empty(); }
+    };
+}
+
+using namespace ShaderCompiler;
+
+namespace
+{
+    BoolVar s_HotReload("Shaders/Hot Reload", true);
+
+    const double kCheckInterval = 0.5;
+
+    // The cache file of a permutation starts with this header.  Then for each file it was compiled from, the hash
+    // of its contents, the length of its path and the path, and then the bytecode.
+    struct CacheHeader
+    {
+        uint32_t Magic;
+        uint32_t Version;
+        uint64_t Key;
+        uint32_t NumFiles;
+        uint32_t BytecodeSize;
+    };
+
+    const uint32_t kCacheMagic = 0x4C495844;    // "DXIL"
+    const uint32_t kCacheVersion = 1;
+
+    struct FileRecord
+    {
+        wstring Path;
+        uint64_t Hash;
+    };
+
+    mutex s_Mutex;
+    vector<wstring> s_SourceDirectories = { L"Shaders/", L"../Core/Shaders/" };
+    map<wstring, unique_ptr<Permutation>> s_Permutations;
+
+    // Permutations recompiled by the check job, swapped in by the next Update()
+    JobSystem::Counter s_CheckJob;
+    vector<pair<Permutation*, shared_ptr<vector<uint8_t>>>> s_Reloaded;
+    int64_t s_LastCheckTick = 0;
+
+    atomic<uint32_t> s_NumCompiled(0);
+    atomic<uint32_t> s_NumCacheHits(0);
+
+#if ENABLE_RUNTIME_SHADERS
+    uint64_t HashBytes( const void* Data, size_t Size, uint64_t Hash )
+    {
+        const uint32_t* Words = (const uint32_t*)Data;
+        Hash = Utility::HashRange(Words, Words + Size / 4, (size_t)Hash);
+
+        uint32_t Tail = 0;
+        memcpy(&Tail, Words + Size / 4, Size & 3);
+        return Utility::HashState(&Tail, 1, (size_t)Hash);
+    }
+
+    uint64_t HashString( const wstring& String, uint64_t Hash )
+    {
+        return HashBytes(String.c_str(), (String.size() + 1) * sizeof(wchar_t), Hash);
+    }
+
+    bool ReadSource( const wstring& Path, vector<char>& Contents )
+    {
+        ifstream File(Path, ios::in | ios::binary);
+        if (!File)
+            return false;
+
+        Contents.assign(istreambuf_iterator<char>(File), istreambuf_iterator<char>());
+        return true;
+    }
+
+    uint64_t GetWriteTime( const wstring& Path )
+    {
+        WIN32_FILE_ATTRIBUTE_DATA Attributes;
+        if (!GetFileAttributesExW(Path.c_str(), GetFileExInfoStandard, &Attributes))
+            return 0;
+
+        return (uint64_t)Attributes.ftLastWriteTime.dwHighDateTime << 32 | Attributes.ftLastWriteTime.dwLowDateTime;
+    }
+
+    wstring GetCachePath( uint64_t Key )
+    {
+        wchar_t Name[48];
+        swprintf_s(Name, L"Cache/Shaders/%016llx.dxil", Key);
+        return Name;
+    }
+
+    // Fails when there is no file for the key, or when one of the includes has changed since.  Files are only
+    // returned on success.
+    bool LoadCachedShaderFile( uint64_t Key, vector<FileRecord>& Files, shared_ptr<vector<uint8_t>>& Bytecode )
+    {
+        ifstream File(GetCachePath(Key), ios::in | ios::binary);
+        if (!File)
+            return false;
+
+        CacheHeader Header;
+        if (!File.read((char*)&Header, sizeof(Header)) || Header.Magic != kCacheMagic || Header.Version != kCacheVersion || Header.Key != Key)
+            return false;
+
+        Files.resize(Header.NumFiles);
+        for (FileRecord& Record : Files)
+        {
+            uint32_t PathLength;
+            if (!File.read((char*)&Record.Hash, sizeof(Record.Hash)) || !File.read((char*)&PathLength, sizeof(PathLength)))
+                return false;
+
+            Record.Path.resize(PathLength);
+            if (!File.read((char*)&Record.Path[0], PathLength * sizeof(wchar_t)))
+                return false;
+
+            vector<char> Contents;
+            if (!ReadSource(Record.Path, Contents) || HashBytes(Contents.data(), Contents.size(), 0) != Record.Hash)
+                return false;
+        }
+
+        Bytecode = make_shared<vector<uint8_t>>(Header.BytecodeSize);
+        return (bool)File.read((char*)Bytecode->data(), Header.BytecodeSize);
+    }
+
+    bool LoadCachedShader( uint64_t Key, vector<FileRecord>& Files, shared_ptr<vector<uint8_t>>& Bytecode )
+    {
+        vector<FileRecord> CachedFiles;
+        if (!LoadCachedShaderFile(Key, CachedFiles, Bytecode))
+            return false;
+
+        Files = move(CachedFiles);
+        return true;
+    }
+
+    void StoreCachedShader( uint64_t Key, const vector<FileRecord>& Files, const vector<uint8_t>& Bytecode )
+    {
+        CreateDirectoryW(L"Cache", nullptr);
+        CreateDirectoryW(L"Cache/Shaders", nullptr);
+
+        ofstream File(GetCachePath(Key), ios::out | ios::binary);
+        if (!File)
+            return;
+
+        CacheHeader Header = { kCacheMagic, kCacheVersion, Key, (uint32_t)Files.size(), (uint32_t)Bytecode.size() };
+        File.write((const char*)&Header, sizeof(Header));
+        for (const FileRecord& Record : Files)
+        {
+            const uint32_t PathLength = (uint32_t)Record.Path.size();
+            File.write((const char*)&Record.Hash, sizeof(Record.Hash));
+            File.write((const char*)&PathLength, sizeof(PathLength));
+            File.write((const char*)Record.Path.c_str(), PathLength * sizeof(wchar_t));
+        }
+        File.write((const char*)Bytecode.data(), Bytecode.size());
+    }
+
+    once_flag s_CompilerLoaded;
+    HMODULE s_CompilerModule = nullptr;
+    DxcCreateInstanceProc s_DxcCreateInstance = nullptr;
+
+    bool LoadCompiler( void )
+    {
+        call_once(s_CompilerLoaded, []
+        {
+            s_CompilerModule = LoadLibraryW(L"dxcompiler.dll");
+            if (s_CompilerModule != nullptr)
+                s_DxcCreateInstance = (DxcCreateInstanceProc)GetProcAddress(s_CompilerModule, "DxcCreateInstance");
+            if (s_DxcCreateInstance == nullptr)
+                Utility::Print("dxcompiler.dll was not found, so the embedded shaders are used\n");
+        });
+        return s_DxcCreateInstance != nullptr;
+    }
+
+    // Reads includes for the compiler, noting each file and the hash of its contents.  It lives on the stack for
+    // the length of one compile.
+    class IncludeHandler : public IDxcIncludeHandler
+    {
+    public:
+        IncludeHandler( IDxcLibrary* Library, vector<FileRecord>& Files ) : m_Library(Library), m_Files(Files) {}
+
+        HRESULT STDMETHODCALLTYPE LoadSource( LPCWSTR FileName, IDxcBlob** IncludeSource ) override
+        {
+            vector<char> Contents;
+            if (!ReadSource(FileName, Contents))
+                return E_FAIL;
+
+            m_Files.push_back({ FileName, HashBytes(Contents.data(), Contents.size(), 0) });
+
+            ComPtr<IDxcBlobEncoding> Blob;
+            HRESULT hr = m_Library->CreateBlobWithEncodingOnHeapCopy(Contents.data(), (UINT32)Contents.size(), CP_UTF8, &Blob);
+            if (SUCCEEDED(hr))
+                *IncludeSource = Blob.Detach();
+            return hr;
+        }
+
+        HRESULT STDMETHODCALLTYPE QueryInterface( REFIID Riid, void** Object ) override
+        {
+            if (Riid == __uuidof(IDxcIncludeHandler) || Riid == __uuidof(IUnknown))
+            {
+                *Object = this;
+                return S_OK;
+            }
+            *Object = nullptr;
+            return E_NOINTERFACE;
+        }
+
+        ULONG STDMETHODCALLTYPE AddRef( void ) override { return 1; }
+        ULONG STDMETHODCALLTYPE Release( void ) override { return 1; }
+
+    private:
+        IDxcLibrary* m_Library;
+        vector<FileRecord>& m_Files;
+    };
+#endif
+}
+
+void PermutationAccess::Create( Permutation& P, const wstring& SourcePath, const wstring& EntryPoint, const wstring& Target,
+    const vector<Define>& Defines, const D3D12_SHADER_BYTECODE& Embedded )
+{
+    P.m_SourcePath = SourcePath;
+    P.m_EntryPoint = EntryPoint;
+    P.m_Target = Target;
+    for (const Define& D : Defines)
+        P.m_Defines.push_back(wstring(D.Name) + L"=" + D.Value);
+    P.m_Embedded = Embedded;
+    P.m_Bytecode = Embedded;
+}
+
+void PermutationAccess::StartCompile( Permutation& P )
+{
+    Permutation* Ptr = &P;
+    JobSystem::Run([Ptr] { CompileFirst(*Ptr); }, &P.m_Compiled);
+}
+
+void PermutationAccess::WaitForCompile( Permutation& P )
+{
+    if (!P.m_Compiled.IsDone())
+        JobSystem::Wait(P.m_Compiled);
+}
+
+bool PermutationAccess::Compile( Permutation& P, shared_ptr<vector<uint8_t>>& Bytecode, vector<Permutation::SourceFile>& Files )
+{
+    bool Compiled = false;
+    vector<FileRecord> Records;
+
+#if ENABLE_RUNTIME_SHADERS
+    vector<char> Source;
+    if (!ReadSource(P.m_SourcePath, Source))
+    {
+        Utility::Printf(L"Couldn't read shader source %s\n", P.m_SourcePath.c_str());
+        return false;
+    }
+
+    vector<wstring> Directories;
+    {
+        lock_guard<mutex> Guard(s_Mutex);
+        Directories = s_SourceDirectories;
+    }
+
+    // Includes are checked against the hashes kept in the cache file instead
+    uint64_t Key = HashBytes(Source.data(), Source.size(), 2166136261U);
+    Key = HashString(P.m_EntryPoint, Key);
+    Key = HashString(P.m_Target, Key);
+    for (const wstring& D : P.m_Defines)
+        Key = HashString(D, Key);
+    for (const wstring& D : Directories)
+        Key = HashString(D, Key);
+#ifdef _DEBUG
+    Key = HashString(L"-Od", Key);
+#endif
+
+    if (LoadCachedShader(Key, Records, Bytecode))
+    {
+        s_NumCacheHits.fetch_add(1, memory_order_relaxed);
+        Compiled = true;
+    }
+    else if (LoadCompiler())
+    {
+        Records.push_back({ P.m_SourcePath, HashBytes(Source.data(), Source.size(), 0) });
+
+        ComPtr<IDxcLibrary> Library;
+        ComPtr<IDxcCompiler> Compiler;
+        ComPtr<IDxcBlobEncoding> SourceBlob;
+        ASSERT_SUCCEEDED(s_DxcCreateInstance(CLSID_DxcLibrary, MY_IID_PPV_ARGS(&Library)));
+        ASSERT_SUCCEEDED(s_DxcCreateInstance(CLSID_DxcCompiler, MY_IID_PPV_ARGS(&Compiler)));
+        ASSERT_SUCCEEDED(Library->CreateBlobWithEncodingFromPinned(Source.data(), (UINT32)Source.size(), CP_UTF8, &SourceBlob));
+
+        vector<LPCWSTR> Arguments;
+        for (const wstring& D : P.m_Defines)
+        {
+            Arguments.push_back(L"-D");
+            Arguments.push_back(D.c_str());
+        }
+        for (const wstring& D : Directories)
+        {
+            Arguments.push_back(L"-I");
+            Arguments.push_back(D.c_str());
+        }
+#ifdef _DEBUG
+        Arguments.push_back(L"-Od");
+        Arguments.push_back(L"-Zi");
+        Arguments.push_back(L"-Qembed_debug");
+#endif
+
+        IncludeHandler Includes(Library.Get(), Records);
+        ComPtr<IDxcOperationResult> Result;
+        HRESULT Status = E_FAIL;
+        if (SUCCEEDED(Compiler->Compile(SourceBlob.Get(), P.m_SourcePath.c_str(), P.m_EntryPoint.c_str(), P.m_Target.c_str(),
+            Arguments.data(), (UINT32)Arguments.size(), nullptr, 0, &Includes, &Result)))
+        {
+            Result->GetStatus(&Status);
+        }
+
+        ComPtr<IDxcBlob> Dxil;
+        if (SUCCEEDED(Status) && SUCCEEDED(Result->GetResult(&Dxil)) && Dxil != nullptr)
+        {
+            const uint8_t* Data = (const uint8_t*)Dxil->GetBufferPointer();
+            Bytecode = make_shared<vector<uint8_t>>(Data, Data + Dxil->GetBufferSize());
+            StoreCachedShader(Key, Records, *Bytecode);
+            s_NumCompiled.fetch_add(1, memory_order_relaxed);
+            Compiled = true;
+        }
+        else
+        {
+            ComPtr<IDxcBlobEncoding> Errors;
+            if (Result != nullptr && SUCCEEDED(Result->GetErrorBuffer(&Errors)) && Errors != nullptr)
+                Utility::Print(string((const char*)Errors->GetBufferPointer(), Errors->GetBufferSize()).c_str());
+            Utility::Printf(L"Failed to compile %s (%s)\n", P.m_SourcePath.c_str(), P.m_EntryPoint.c_str());
+        }
+    }
+#endif
+
+    // Even a failed compile watches the files it got to, so that fixing them compiles it again
+    Files.clear();
+    for (const FileRecord& Record : Records)
+        Files.push_back({ Record.Path, GetWriteTime(Record.Path) });
+
+    return Compiled;
+}
+
+void PermutationAccess::CompileFirst( Permutation& P )
+{
+    shared_ptr<vector<uint8_t>> Bytecode;
+    if (Compile(P, Bytecode, P.m_Files))
+    {
+        P.m_Versions.push_back(Bytecode);
+        P.m_Bytecode = CD3DX12_SHADER_BYTECODE(Bytecode->data(), Bytecode->size());
+    }
+}
+
+void PermutationAccess::CheckForEdits( Permutation& P )
+{
+    bool Edited = false;
+    for (Permutation::SourceFile& File : P.m_Files)
+        Edited = Edited || GetWriteTime(File.Path) != File.WriteTime;
+
+    if (!Edited)
+        return;
+
+    Utility::Printf(L"Reloading %s (%s)\n", P.m_SourcePath.c_str(), P.m_EntryPoint.c_str());
+
+    shared_ptr<vector<uint8_t>> Bytecode;
+    vector<Permutation::SourceFile> Files;
+    const bool Compiled = Compile(P, Bytecode, Files);
+
+    // When the source couldn't be read, wait for it to change again
+    if (Files.empty())
+    {
+        for (Permutation::SourceFile& File : P.m_Files)
+            File.WriteTime = GetWriteTime(File.Path);
+    }
+    else
+        P.m_Files = move(Files);
+
+    if (Compiled)
+    {
+        lock_guard<mutex> Guard(s_Mutex);
+        s_Reloaded.push_back(make_pair(&P, Bytecode));
+    }
+}
+
+void PermutationAccess::Reload( Permutation& P, const shared_ptr<vector<uint8_t>>& Bytecode )
+{
+    P.m_Versions.push_back(Bytecode);
+    P.m_Bytecode = CD3DX12_SHADER_BYTECODE(Bytecode->data(), Bytecode->size());
+    for (const function<void(void)>& Callback : P.m_ReloadCallbacks)
+        Callback();
+}
+
+D3D12_SHADER_BYTECODE Permutation::GetBytecode( void )
+{
+    if (!m_Compiled.IsDone())
+        JobSystem::Wait(m_Compiled);
+
+    ASSERT(m_Bytecode.pShaderBytecode != nullptr, "The shader neither compiled nor has an embedded version");
+    return m_Bytecode;
+}
+
+void ShaderCompiler::AddSourceDirectory( const wstring& Directory )
+{
+    lock_guard<mutex> Guard(s_Mutex);
+    s_SourceDirectories.push_back(Directory.back() == L'/' || Directory.back() == L'\\' ? Directory : Directory + L"/");
+}
+
+Permutation& ShaderCompiler::GetPermutation( const wstring& SourceFile, const wstring& EntryPoint, const wstring& Target,
+    const vector<Define>& Defines, const D3D12_SHADER_BYTECODE& Embedded )
+{
+    wstring Name = SourceFile + L"|" + EntryPoint + L"|" + Target;
+    for (const Define& D : Defines)
+        Name += wstring(L"|") + D.Name + L"=" + D.Value;
+
+    Permutation* P;
+    wstring SourcePath;
+    {
+        lock_guard<mutex> Guard(s_Mutex);
+
+        unique_ptr<Permutation>& Entry = s_Permutations[Name];
+        if (Entry != nullptr)
+            return *Entry;
+
+        Entry.reset(new Permutation);
+        P = Entry.get();
+
+#if ENABLE_RUNTIME_SHADERS
+        for (const wstring& Directory : s_SourceDirectories)
+        {
+            if (GetWriteTime(Directory + SourceFile) != 0)
+            {
+                SourcePath = Directory + SourceFile;
+                break;
+            }
+        }
+#endif
+
+        PermutationAccess::Create(*P, SourcePath, EntryPoint, Target, Defines, Embedded);
+    }
+
+#if ENABLE_RUNTIME_SHADERS
+    if (!SourcePath.empty())
+        PermutationAccess::StartCompile(*P);
+    else
+        Utility::Printf(L"Couldn't find shader source %s, so the embedded shader is used\n", SourceFile.c_str());
+#endif
+
+    return *P;
+}
+
+void ShaderCompiler::Update( void )
+{
+#if ENABLE_RUNTIME_SHADERS
+    EngineProfiling::SetCounter("Shaders Compiled", s_NumCompiled.load(memory_order_relaxed));
+    EngineProfiling::SetCounter("Shader Cache Hits", s_NumCacheHits.load(memory_order_relaxed));
+
+    if (!s_CheckJob.IsDone())
+        return;
+
+    vector<pair<Permutation*, shared_ptr<vector<uint8_t>>>> Reloaded;
+    vector<Permutation*> Watched;
+    {
+        lock_guard<mutex> Guard(s_Mutex);
+        Reloaded.swap(s_Reloaded);
+        for (auto& Entry : s_Permutations)
+        {
+            if (Entry.second->IsReady() && PermutationAccess::IsWatched(*Entry.second))
+                Watched.push_back(Entry.second.get());
+        }
+    }
+
+    for (auto& Entry : Reloaded)
+        PermutationAccess::Reload(*Entry.first, Entry.second);
+
+    const int64_t CurrentTick = SystemTime::GetCurrentTick();
+    if (!s_HotReload || Watched.empty() || SystemTime::TimeBetweenTicks(s_LastCheckTick, CurrentTick) < kCheckInterval)
+        return;
+
+    s_LastCheckTick = CurrentTick;
+    JobSystem::Run([Watched]
+    {
+        for (Permutation* P : Watched)
+            PermutationAccess::CheckForEdits(*P);
+    }, &s_CheckJob);
+#endif
+}
+
+void ShaderCompiler::Shutdown( void )
+{
+    vector<Permutation*> Pending;
+    {
+        lock_guard<mutex> Guard(s_Mutex);
+        for (auto& Entry : s_Permutations)
+            Pending.push_back(Entry.second.get());
+    }
+
+    for (Permutation* P : Pending)
+        PermutationAccess::WaitForCompile(*P);
+    if (!s_CheckJob.IsDone())
+        JobSystem::Wait(s_CheckJob);
+
+    lock_guard<mutex> Guard(s_Mutex);
+    s_Reloaded.clear();
+    s_Permutations.clear();
+}
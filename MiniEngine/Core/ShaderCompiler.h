@@ -0,0 +1,95 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Compiles permutations of a shader from its HLSL source at runtime with DXC, so that a variant is a set of
+// defines rather than a file and an embedded header of its own, and so that edited shaders reload while the
+// application runs.  Compiled DXIL is cached on disk under Cache/Shaders, keyed by a hash of the source, the
+// entry point, the target and the defines, and checked against the includes it was compiled with, so a later
+// launch only compiles what changed.
+//
+// Each permutation is given the embedded bytecode from CompiledShaders/*.h it stands for.  Release builds use
+// that and never compile anything, and so do other builds when dxcompiler.dll is missing or the first compile
+// fails.  Runtime permutations are DXIL, so every stage of a pipeline should come from one.
+//
+
+#pragma once
+
+#include "pch.h"
+#include "JobSystem.h"
+#include <functional>
+
+#ifndef ENABLE_RUNTIME_SHADERS
+    #if !defined(RELEASE) && WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_DESKTOP)
+        #define ENABLE_RUNTIME_SHADERS 1
+    #else
+        #define ENABLE_RUNTIME_SHADERS 0
+    #endif
+#endif
+
+namespace ShaderCompiler
+{
+    struct Define
+    {
+        const wchar_t* Name;
+        const wchar_t* Value;
+    };
+
+    class Permutation
+    {
+    public:
+        Permutation() : m_Bytecode{} {}
+        Permutation(const Permutation&) = delete;
+        Permutation& operator=(const Permutation&) = delete;
+
+        bool IsReady( void ) const { return m_Compiled.IsDone(); }
+
+        // Waits for the first compile.  Bytecode stays valid until shutdown, even after it has been reloaded.
+        D3D12_SHADER_BYTECODE GetBytecode( void );
+
+        // Called on the main thread when a reload replaces the bytecode, to finalize the PSOs made from it again
+        void OnReload( const std::function<void(void)>& Callback ) { m_ReloadCallbacks.push_back(Callback); }
+
+    private:
+        friend struct PermutationAccess;
+
+        struct SourceFile
+        {
+            std::wstring Path;
+            uint64_t WriteTime;
+        };
+
+        std::wstring m_SourcePath;
+        std::wstring m_EntryPoint;
+        std::wstring m_Target;
+        std::vector<std::wstring> m_Defines;    // As NAME=VALUE
+        D3D12_SHADER_BYTECODE m_Embedded;
+
+        // PSOs are cached by the address of their bytecode, so no version is freed while the application runs
+        std::vector<std::shared_ptr<std::vector<uint8_t>>> m_Versions;
+        D3D12_SHADER_BYTECODE m_Bytecode;
+        std::vector<SourceFile> m_Files;        // The source and its includes, as of the last compile
+        std::vector<std::function<void(void)>> m_ReloadCallbacks;
+        JobSystem::Counter m_Compiled;
+    };
+
+    // Sources are looked for in each directory in turn.  The working directory's Shaders and ../Core/Shaders are
+    // searched by default.
+    void AddSourceDirectory( const std::wstring& Directory );
+
+    // Returns the permutation of the source with the defines, queuing its compile on the job system the first
+    // time it is asked for.  The target is a shader model 6 profile, such as L"cs_6_0".
+    Permutation& GetPermutation( const std::wstring& SourceFile, const std::wstring& EntryPoint, const std::wstring& Target,
+        const std::vector<Define>& Defines, const D3D12_SHADER_BYTECODE& Embedded );
+
+    // Every so often checks the sources of the permutations for edits on a worker thread and compiles the ones
+    // that changed, then swaps in their bytecode and calls their reload callbacks.  Called once a frame.
+    void Update( void );
+
+    void Shutdown( void );
+
+} // namespace ShaderCompiler
@@ -31,6 +31,7 @@ cbuffer CB1 : register(b1)
     float2 gInvSliceDimension;
     float  gRejectFadeoff;
     float  gRcpAccentuation;
+    uint   gSliceParity;    // 1 + the parity of the checkerboard of slices to render, or 0 to render all of them
 }
 
 #if WIDE_SAMPLING
@@ -115,7 +116,14 @@ void main( uint3 Gid : SV_GroupID, uint GI : SV_GroupIndex, uint3 GTid : SV_Grou
 
     // Fetch four depths and store them in LDS
 #ifdef INTERLEAVE_RESULT
-    float4 depths = DepthTex.Gather(LinearBorderSampler, float3(QuadCenterUV, DTid.z));
+    // Half of the 4x4 slices in a checkerboard, two to each row
+    uint slice = DTid.z;
+    if (gSliceParity != 0)
+    {
+        uint row = DTid.z >> 1;
+        slice = row * 4 + (DTid.z & 1) * 2 + ((row + gSliceParity - 1) & 1);
+    }
+    float4 depths = DepthTex.Gather(LinearBorderSampler, float3(QuadCenterUV, slice));
 #else
     float4 depths = DepthTex.Gather(LinearBorderSampler, QuadCenterUV);
 #endif
@@ -164,7 +172,11 @@ void main( uint3 Gid : SV_GroupID, uint GI : SV_GroupIndex, uint3 GTid : SV_Grou
 #endif
 
 #ifdef INTERLEAVE_RESULT
-    uint2 OutPixel = DTid.xy << 2 | uint2(DTid.z & 3, DTid.z >> 2);
+    uint2 OutPixel = DTid.xy << 2 | uint2(slice & 3, slice >> 2);
+
+    // The horizontal neighbor belongs to a slice of the other parity, which the next frame renders
+    if (gSliceParity != 0)
+        Occlusion[OutPixel ^ uint2(1, 0)] = ao * gRcpAccentuation;
 #else
     uint2 OutPixel = DTid.xy;
 #endif
@@ -0,0 +1,49 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Blends the half resolution AO with last frame's, reprojected through the camera motion.  In the temporal mode
+// each frame renders half of the interleaved slices, so the blend gathers all of them over two frames.  History
+// whose depth no longer matches is disoccluded and dropped.
+//
+
+#include "SSAORS.hlsli"
+
+Texture2D<float> CurrentAO : register(t0);
+Texture2D<float> HistoryAO : register(t1);
+Texture2D<float> CurrentDepth : register(t2);  // Half resolution linear depth
+Texture2D<float> PreviousDepth : register(t3); // Last frame's full resolution linear depth
+RWTexture2D<float> OutAO : register(u0);
+
+SamplerState LinearSampler : register(s0);
+
+cbuffer CB1 : register(b1)
+{
+    matrix CurToPrevXForm;      // Full resolution pixels and linear depth to last frame's
+    float2 RcpFullDimension;
+    float HistoryWeight;        // 0 when there is no history to blend
+    float DepthTolerance;       // Relative difference in depth beyond which the history is rejected
+}
+
+[RootSignature(SSAO_RootSig)]
+[numthreads( 8, 8, 1 )]
+void main( uint3 DTid : SV_DispatchThreadID )
+{
+    float AO = CurrentAO[DTid.xy];
+    float Depth = CurrentDepth[DTid.xy];
+
+    // Half resolution pixel st covers full resolution pixels 2 * st through 2 * st + 1
+    float2 CurPixel = (DTid.xy + 0.5) * 2.0;
+    float4 PrevHPos = mul(CurToPrevXForm, float4(CurPixel * Depth, 1.0, Depth));
+    float2 PrevUV = PrevHPos.xy / PrevHPos.w * RcpFullDimension;
+
+    float PrevDepth = PreviousDepth.SampleLevel(LinearSampler, PrevUV, 0);
+    bool Valid = all(PrevUV == saturate(PrevUV)) && abs(PrevDepth - PrevHPos.w) <= DepthTolerance * PrevHPos.w;
+
+    float History = HistoryAO.SampleLevel(LinearSampler, PrevUV, 0);
+    OutAO[DTid.xy] = Valid ? lerp(AO, History, HistoryWeight) : AO;
+}
@@ -17,9 +17,15 @@ Texture2D<float3> ColorTex : register(t0);
 
 SamplerState BilinearFilter : register(s0);
 
+cbuffer Constants : register(b0)
+{
+    float2 UVScale;     // The part of the texture holding the image, which is smaller with dynamic resolution
+    float2 UVMax;
+}
+
 [RootSignature(Present_RootSig)]
 float3 main( float4 position : SV_Position, float2 uv : TexCoord0 ) : SV_Target0
 {
-    float3 LinearRGB = RemoveDisplayProfile(ColorTex.SampleLevel(BilinearFilter, uv, 0), LDR_COLOR_FORMAT);
+    float3 LinearRGB = RemoveDisplayProfile(ColorTex.SampleLevel(BilinearFilter, min(uv * UVScale, UVMax), 0), LDR_COLOR_FORMAT);
     return ApplyDisplayProfile(LinearRGB, DISPLAY_PLANE_FORMAT);
 }
@@ -0,0 +1,160 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Compresses one mip of a texture to BC1, or to BC3 when BC3 is defined.  Each thread encodes a 4x4 block
+// with bounding box endpoints, which is fast and good enough for textures that were never compressed by hand.
+// The blocks are written tightly packed, row by row, as they are laid out in a DDS file.
+//
+
+#include "ColorSpaceUtility.hlsli"
+
+#define RootSig \
+    "RootFlags(0), " \
+    "RootConstants(b0, num32BitConstants = 5), " \
+    "DescriptorTable(SRV(t0, numDescriptors = 1))," \
+    "UAV(u0)"
+
+#ifndef BC3
+#define BC3 0
+#endif
+
+Texture2D<float4> SrcTex : register(t0);
+RWByteAddressBuffer OutBlocks : register(u0);
+
+cbuffer CB0 : register(b0)
+{
+    uint SrcMip;
+    uint EncodeSRGB;        // The texture is sRGB, so endpoints are chosen in gamma space
+    uint2 MipSize;
+    uint DestOffset;        // Byte offset of the mip's first block
+}
+
+uint QuantizeRGB565( float3 Color )
+{
+    uint3 q = uint3(round(saturate(Color) * float3(31, 63, 31)));
+    return q.r << 11 | q.g << 5 | q.b;
+}
+
+float3 DequantizeRGB565( uint Color )
+{
+    return float3(Color >> 11, (Color >> 5) & 63, Color & 31) / float3(31, 63, 31);
+}
+
+// Two RGB565 endpoints and 2-bit indices.  The first endpoint is the larger, which selects the four color
+// palette of both endpoints and two colors between them.
+uint2 EncodeColorBlock( float3 Texels[16] )
+{
+    float3 MinColor = Texels[0];
+    float3 MaxColor = Texels[0];
+    for (uint i = 1; i < 16; ++i)
+    {
+        MinColor = min(MinColor, Texels[i]);
+        MaxColor = max(MaxColor, Texels[i]);
+    }
+
+    // Insetting the box moves the endpoints toward where most of the colors are
+    float3 Inset = (MaxColor - MinColor) / 16.0;
+    uint c0 = QuantizeRGB565(MaxColor - Inset);
+    uint c1 = QuantizeRGB565(MinColor + Inset);
+    if (c0 < c1)
+    {
+        uint Temp = c0;
+        c0 = c1;
+        c1 = Temp;
+    }
+
+    if (c0 == c1)
+        return uint2(c0 | c1 << 16, 0);
+
+    float3 p0 = DequantizeRGB565(c0);
+    float3 p1 = DequantizeRGB565(c1);
+    float3 Axis = p0 - p1;
+    float Scale = 3.0 / dot(Axis, Axis);
+
+    // Palette indices of the steps from p1 to p0
+    static const uint IndexOfStep[4] = { 1, 3, 2, 0 };
+
+    uint Indices = 0;
+    for (uint j = 0; j < 16; ++j)
+    {
+        uint Step = (uint)clamp(round(dot(Texels[j] - p1, Axis) * Scale), 0.0, 3.0);
+        Indices |= IndexOfStep[Step] << (2 * j);
+    }
+
+    return uint2(c0 | c1 << 16, Indices);
+}
+
+// Two 8-bit endpoints and 3-bit indices.  The first endpoint is the larger, which selects the eight alpha
+// palette of both endpoints and six values between them.
+uint2 EncodeAlphaBlock( float Alpha[16] )
+{
+    float MinAlpha = Alpha[0];
+    float MaxAlpha = Alpha[0];
+    for (uint i = 1; i < 16; ++i)
+    {
+        MinAlpha = min(MinAlpha, Alpha[i]);
+        MaxAlpha = max(MaxAlpha, Alpha[i]);
+    }
+
+    uint a0 = (uint)round(saturate(MaxAlpha) * 255.0);
+    uint a1 = (uint)round(saturate(MinAlpha) * 255.0);
+    uint2 Bits = uint2(a0 | a1 << 8, 0);
+    if (a0 == a1)
+        return Bits;
+
+    float Scale = 7.0 / (a0 - a1);
+    for (uint j = 0; j < 16; ++j)
+    {
+        // Index 0 is a0, 1 is a1, and 2 through 7 step from a0 toward a1
+        uint Step = (uint)clamp(round((Alpha[j] * 255.0 - a1) * Scale), 0.0, 7.0);
+        uint Index = Step == 7 ? 0 : (Step == 0 ? 1 : 8 - Step);
+
+        // The 48 bits of indices start at bit 16, and the one at bit 31 straddles both words
+        uint Bit = 16 + 3 * j;
+        if (Bit < 32)
+        {
+            Bits.x |= Index << Bit;
+            if (Bit > 29)
+                Bits.y |= Index >> (32 - Bit);
+        }
+        else
+        {
+            Bits.y |= Index << (Bit - 32);
+        }
+    }
+
+    return Bits;
+}
+
+[RootSignature(RootSig)]
+[numthreads( 8, 8, 1 )]
+void main( uint3 DTid : SV_DispatchThreadID )
+{
+    uint2 BlockCount = (MipSize + 3) / 4;
+    if (any(DTid.xy >= BlockCount))
+        return;
+
+    float3 Colors[16];
+    float Alpha[16];
+    for (uint i = 0; i < 16; ++i)
+    {
+        // Blocks that hang off the edge of the mip repeat its last row and column
+        uint2 Texel = min(DTid.xy * 4 + uint2(i % 4, i / 4), MipSize - 1);
+        float4 Color = SrcTex.Load(int3(Texel, SrcMip));
+        Colors[i] = EncodeSRGB ? ApplySRGBCurve(Color.rgb) : Color.rgb;
+        Alpha[i] = Color.a;
+    }
+
+#if BC3
+    uint Address = DestOffset + (DTid.y * BlockCount.x + DTid.x) * 16;
+    OutBlocks.Store4(Address, uint4(EncodeAlphaBlock(Alpha), EncodeColorBlock(Colors)));
+#else
+    uint Address = DestOffset + (DTid.y * BlockCount.x + DTid.x) * 8;
+    OutBlocks.Store2(Address, EncodeColorBlock(Colors));
+#endif
+}
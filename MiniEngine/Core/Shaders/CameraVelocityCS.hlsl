@@ -23,6 +23,13 @@
 Texture2D<float> DepthBuffer : register(t0);
 RWTexture2D<packed_velocity_t> VelocityBuffer : register(u0);
 
+#ifdef HALF_RES_VELOCITY
+RWTexture2D<packed_velocity_t> VelocityHalf : register(u1);
+
+groupshared float gs_Depth[64];
+groupshared packed_velocity_t gs_Velocity[64];
+#endif
+
 cbuffer CBuffer : register(b1)
 {
     matrix CurToPrevXForm;
@@ -30,7 +37,7 @@ cbuffer CBuffer : register(b1)
 
 [RootSignature(MotionBlur_RootSig)]
 [numthreads( 8, 8, 1 )]
-void main( uint3 DTid : SV_DispatchThreadID )
+void main( uint3 DTid : SV_DispatchThreadID, uint3 GTid : SV_GroupThreadID, uint GI : SV_GroupIndex )
 {
     uint2 st = DTid.xy;
     float2 CurPixel = st + 0.5;
@@ -48,5 +55,27 @@ void main( uint3 DTid : SV_DispatchThreadID )
     PrevHPos.z = PrevHPos.w;
 #endif
 
-    VelocityBuffer[st] = PackVelocity(PrevHPos.xyz - float3(CurPixel, Depth));
+    packed_velocity_t Velocity = PackVelocity(PrevHPos.xyz - float3(CurPixel, Depth));
+    VelocityBuffer[st] = Velocity;
+
+#ifdef HALF_RES_VELOCITY
+    // Each 2x2 quad keeps the velocity of its closest pixel, so that TAA reads a quarter of the velocities and
+    // does not dilate them itself.  Linear Z is 0 at the eye.
+    gs_Depth[GI] = Depth;
+    gs_Velocity[GI] = Velocity;
+
+    GroupMemoryBarrierWithGroupSync();
+
+    if (((GTid.x | GTid.y) & 1) == 0)
+    {
+        uint Closest = GI;
+        if (gs_Depth[GI + 1] < gs_Depth[Closest])
+            Closest = GI + 1;
+        if (gs_Depth[GI + 8] < gs_Depth[Closest])
+            Closest = GI + 8;
+        if (gs_Depth[GI + 9] < gs_Depth[Closest])
+            Closest = GI + 9;
+        VelocityHalf[st >> 1] = gs_Velocity[Closest];
+    }
+#endif
 }
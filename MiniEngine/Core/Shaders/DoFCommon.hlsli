@@ -35,6 +35,7 @@ cbuffer CB0 : register(b0)
     float ForegroundRange;
     float RcpForegroundRange;
     float AntiSparkleFilterStrength;
+    uint QuarterResFarField;
 }
 
 #define DEPTH_FOREGROUND_RANGE 0.01
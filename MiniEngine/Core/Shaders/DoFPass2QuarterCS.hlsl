@@ -0,0 +1,65 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// The color-only convolution of the fast pass at quarter resolution, for tiles whose whole neighborhood lies
+// blurred behind the focal plane.  Each thread sits on the corner shared by four half resolution pixels, so every
+// bilinear tap averages a quad of them.  DoFUpsampleQuarterCS brings the result back to half resolution.
+//
+
+#include "DoFCommon.hlsli"
+
+Texture2D<float3> ColorBuffer : register(t0);
+Texture2D<float3> PresortBuffer : register(t1);
+Texture2D<float3> TileClass : register(t2);
+StructuredBuffer<uint> WorkQueue : register(t3);
+RWTexture2D<float4> OutputColor : register(u0);     // Color and depth
+
+[RootSignature(DoF_RootSig)]
+[numthreads( 4, 4, 1 )]
+void main( uint3 Gid : SV_GroupID, uint3 GTid : SV_GroupThreadID )
+{
+    uint TileCoord = WorkQueue[Gid.x];
+    uint2 Tile = uint2(TileCoord & 0xFFFF, TileCoord >> 16);
+    uint2 st = Tile * 4 + GTid.xy;
+
+    // The rings of the fast pass, in half resolution pixels
+    float2 RcpHalfDim = rcp(float2(HalfDimensionMinusOne + 1));
+    float2 Center = st * 2 + 1;
+
+    float4 Foreground = float4(ColorBuffer.SampleLevel(BilinearSampler, Center * RcpHalfDim, 0), 1);
+    float Depth = PresortBuffer.SampleLevel(BilinearSampler, Center * RcpHalfDim, 0).z;
+
+    float TileCoC = TileClass[Tile].x;
+    float RingCount = (TileCoC - 1.0) / 5.0;
+
+    float3 RingSamples = 0;
+    [unroll]
+    for (uint i = 0; i < 8; i++)
+        RingSamples += ColorBuffer.SampleLevel(BilinearSampler, (Center + 0.5 * s_Ring1[i]) * RcpHalfDim, 0);
+    Foreground += saturate(RingCount) * float4(RingSamples, 8);
+
+    if (RingCount > 1.0)
+    {
+        RingSamples = 0;
+        [unroll]
+        for (uint j = 0; j < 16; j++)
+            RingSamples += ColorBuffer.SampleLevel(BilinearSampler, (Center + 0.5 * s_Ring2[j]) * RcpHalfDim, 0);
+        Foreground += saturate(RingCount - 1.0) * float4(RingSamples, 16);
+    }
+
+    if (RingCount > 2.0)
+    {
+        RingSamples = 0;
+        [unroll]
+        for (uint k = 0; k < 24; k++)
+            RingSamples += ColorBuffer.SampleLevel(BilinearSampler, (Center + 0.5 * s_Ring3[k]) * RcpHalfDim, 0);
+        Foreground += saturate(RingCount - 2.0) * float4(RingSamples, 24);
+    }
+
+    OutputColor[st] = float4(Foreground.rgb / Foreground.w, Depth);
+}
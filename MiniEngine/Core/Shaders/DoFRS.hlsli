@@ -15,7 +15,7 @@
     "RootFlags(0), " \
     "CBV(b0), " \
     "DescriptorTable(SRV(t0, numDescriptors = 6))," \
-    "DescriptorTable(UAV(u0, numDescriptors = 3))," \
+    "DescriptorTable(UAV(u0, numDescriptors = 4))," \
     "RootConstants(b1, num32BitConstants = 1), " \
     "StaticSampler(s0," \
         "addressU = TEXTURE_ADDRESS_BORDER," \
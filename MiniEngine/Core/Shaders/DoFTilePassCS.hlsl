@@ -17,6 +17,7 @@ Texture2D<float3> InputClass : register(t0);
 RWTexture2D<float3> TileClass : register(u0);
 RWStructuredBuffer<uint> WorkQueue : register(u1);
 RWStructuredBuffer<uint> FastQueue : register(u2);
+RWStructuredBuffer<uint> FarQueue : register(u3);
 
 groupshared float gs_MaxCoC[100];
 groupshared float gs_MinDepth[100];
@@ -79,6 +80,8 @@ void main( uint3 Gid : SV_GroupID, uint GI : SV_GroupIndex, uint3 GTid : SV_Grou
     {
         if (FinalMaxDepth - FinalMinDepth > ForegroundRange)
             WorkQueue[WorkQueue.IncrementCounter()] = DTid.x | DTid.y << 16;
+        else if (QuarterResFarField != 0 && FinalMinDepth > FocusCenter && ComputeCoC(FinalMinDepth) >= RING2_THRESHOLD)
+            FarQueue[FarQueue.IncrementCounter()] = DTid.x | DTid.y << 16;     // Blurred enough for quarter resolution
         else
             FastQueue[FastQueue.IncrementCounter()] = DTid.x | DTid.y << 16;
     }
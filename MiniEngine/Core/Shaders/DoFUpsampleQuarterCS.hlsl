@@ -0,0 +1,52 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Upsamples the quarter resolution blur of the far field tiles into the half resolution blur buffers.  The
+// bilinear weights of the four nearest quarter resolution pixels fall off with their difference in depth, so the
+// blur of one background layer does not bleed across an edge into another.
+//
+
+#include "DoFCommon.hlsli"
+
+Texture2D<float4> QuarterColor : register(t0);
+Texture2D<float3> PresortBuffer : register(t1);
+StructuredBuffer<uint> WorkQueue : register(t3);
+RWTexture2D<float3> OutputColor : register(u0);
+RWTexture2D<float> OutputAlpha : register(u1);
+
+[RootSignature(DoF_RootSig)]
+[numthreads( 8, 8, 1 )]
+void main( uint3 Gid : SV_GroupID, uint3 GTid : SV_GroupThreadID )
+{
+    uint TileCoord = WorkQueue[Gid.x];
+    uint2 Tile = uint2(TileCoord & 0xFFFF, TileCoord >> 16);
+    uint2 st = Tile * 8 + GTid.xy;
+
+    float Depth = PresortBuffer[st].z;
+
+    // Quarter resolution pixel q is centered on half resolution position 2 * q + 1
+    float2 Pos = st * 0.5 - 0.25;
+    int2 Base = (int2)floor(Pos);
+    float2 Frac = Pos - Base;
+    int2 QuarterMax = HalfDimensionMinusOne / 2;
+
+    float4 Accum = 0;
+
+    [unroll]
+    for (uint i = 0; i < 4; ++i)
+    {
+        int2 Offset = int2(i & 1, i >> 1);
+        float4 Sample = QuarterColor[clamp(Base + Offset, 0, QuarterMax)];
+        float2 Bilinear = lerp(1.0 - Frac, Frac, (float2)Offset);
+        float DepthWeight = 1.0 - saturate(abs(Sample.w - Depth) * RcpForegroundRange - 1.0);
+        Accum += float4(Sample.rgb, 1) * Bilinear.x * Bilinear.y * max(DepthWeight, 1e-3);
+    }
+
+    OutputColor[st] = Accum.rgb / Accum.w;
+    OutputAlpha[st] = 1.0;
+}
@@ -0,0 +1,171 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Generates up to four mips of each of a batch of textures in one dispatch.  It works like GenerateMipsCS.hlsli,
+// but the Z group index selects the texture, and whether the texture is sRGB or has odd dimensions is read from
+// its entry rather than compiled into a permutation.  Every branch on the entry is uniform across the group.
+//
+
+#include "ColorSpaceUtility.hlsli"
+
+#define RootSig \
+    "RootFlags(0), " \
+    "SRV(t16), " \
+    "DescriptorTable(SRV(t0, numDescriptors = 16))," \
+    "DescriptorTable(UAV(u0, numDescriptors = 16))," \
+    "DescriptorTable(UAV(u16, numDescriptors = 16))," \
+    "DescriptorTable(UAV(u32, numDescriptors = 16))," \
+    "DescriptorTable(UAV(u48, numDescriptors = 16))," \
+    "StaticSampler(s0," \
+        "addressU = TEXTURE_ADDRESS_CLAMP," \
+        "addressV = TEXTURE_ADDRESS_CLAMP," \
+        "addressW = TEXTURE_ADDRESS_CLAMP," \
+        "filter = FILTER_MIN_MAG_MIP_LINEAR)"
+
+#define MAX_TEXTURES 16
+
+struct MipBatchEntry
+{
+    uint SrcMipLevel;       // Texture level of source mip
+    uint NumMipLevels;      // Number of OutMips to write: [0, 4]
+    float2 TexelSize;       // 1.0 / OutMip1.Dimensions
+    uint2 DstSize;          // OutMip1.Dimensions
+    uint NonPowerOfTwo;     // Bit 0 when the source width is odd, and bit 1 when its height is
+    uint ConvertToSRGB;
+};
+
+RWTexture2D<float4> OutMip1[MAX_TEXTURES] : register(u0);
+RWTexture2D<float4> OutMip2[MAX_TEXTURES] : register(u16);
+RWTexture2D<float4> OutMip3[MAX_TEXTURES] : register(u32);
+RWTexture2D<float4> OutMip4[MAX_TEXTURES] : register(u48);
+Texture2D<float4> SrcMip[MAX_TEXTURES] : register(t0);
+StructuredBuffer<MipBatchEntry> Entries : register(t16);
+SamplerState BilinearClamp : register(s0);
+
+groupshared float gs_R[64];
+groupshared float gs_G[64];
+groupshared float gs_B[64];
+groupshared float gs_A[64];
+
+void StoreColor( uint Index, float4 Color )
+{
+    gs_R[Index] = Color.r;
+    gs_G[Index] = Color.g;
+    gs_B[Index] = Color.b;
+    gs_A[Index] = Color.a;
+}
+
+float4 LoadColor( uint Index )
+{
+    return float4( gs_R[Index], gs_G[Index], gs_B[Index], gs_A[Index]);
+}
+
+float4 PackColor( float4 Linear, uint ConvertToSRGB )
+{
+    return ConvertToSRGB ? float4(ApplySRGBCurve_Fast(Linear.rgb), Linear.a) : Linear;
+}
+
+[RootSignature(RootSig)]
+[numthreads( 8, 8, 1 )]
+void main( uint GI : SV_GroupIndex, uint3 Gid : SV_GroupID, uint3 GTid : SV_GroupThreadID )
+{
+    const uint Tex = Gid.z;
+    const MipBatchEntry Entry = Entries[Tex];
+
+    // The dispatch covers the largest texture of the batch.  Whole groups past the end of a smaller texture, or
+    // of one with no more mips, exit together, so no thread is left waiting at a barrier.
+    const uint2 DTid = Gid.xy * 8 + GTid.xy;
+    if (Entry.NumMipLevels == 0 || any(Gid.xy * 8 >= Entry.DstSize))
+        return;
+
+    // When an odd source dimension makes the first downsample more than 2:1, two samples in that dimension
+    // keep it from undersampling.  See GenerateMipsCS.hlsli.
+    const float2 TexelSize = Entry.TexelSize;
+    float4 Src1;
+    if (Entry.NonPowerOfTwo == 0)
+    {
+        float2 UV = TexelSize * (DTid.xy + 0.5);
+        Src1 = SrcMip[Tex].SampleLevel(BilinearClamp, UV, Entry.SrcMipLevel);
+    }
+    else if (Entry.NonPowerOfTwo == 1)
+    {
+        float2 UV1 = TexelSize * (DTid.xy + float2(0.25, 0.5));
+        float2 Off = TexelSize * float2(0.5, 0.0);
+        Src1 = 0.5 * (SrcMip[Tex].SampleLevel(BilinearClamp, UV1, Entry.SrcMipLevel) +
+            SrcMip[Tex].SampleLevel(BilinearClamp, UV1 + Off, Entry.SrcMipLevel));
+    }
+    else if (Entry.NonPowerOfTwo == 2)
+    {
+        float2 UV1 = TexelSize * (DTid.xy + float2(0.5, 0.25));
+        float2 Off = TexelSize * float2(0.0, 0.5);
+        Src1 = 0.5 * (SrcMip[Tex].SampleLevel(BilinearClamp, UV1, Entry.SrcMipLevel) +
+            SrcMip[Tex].SampleLevel(BilinearClamp, UV1 + Off, Entry.SrcMipLevel));
+    }
+    else
+    {
+        float2 UV1 = TexelSize * (DTid.xy + float2(0.25, 0.25));
+        float2 O = TexelSize * 0.5;
+        Src1 = SrcMip[Tex].SampleLevel(BilinearClamp, UV1, Entry.SrcMipLevel);
+        Src1 += SrcMip[Tex].SampleLevel(BilinearClamp, UV1 + float2(O.x, 0.0), Entry.SrcMipLevel);
+        Src1 += SrcMip[Tex].SampleLevel(BilinearClamp, UV1 + float2(0.0, O.y), Entry.SrcMipLevel);
+        Src1 += SrcMip[Tex].SampleLevel(BilinearClamp, UV1 + float2(O.x, O.y), Entry.SrcMipLevel);
+        Src1 *= 0.25;
+    }
+
+    OutMip1[Tex][DTid.xy] = PackColor(Src1, Entry.ConvertToSRGB);
+
+    if (Entry.NumMipLevels == 1)
+        return;
+
+    StoreColor(GI, Src1);
+    GroupMemoryBarrierWithGroupSync();
+
+    // X and Y are even
+    if ((GI & 0x9) == 0)
+    {
+        float4 Src2 = LoadColor(GI + 0x01);
+        float4 Src3 = LoadColor(GI + 0x08);
+        float4 Src4 = LoadColor(GI + 0x09);
+        Src1 = 0.25 * (Src1 + Src2 + Src3 + Src4);
+
+        OutMip2[Tex][DTid.xy / 2] = PackColor(Src1, Entry.ConvertToSRGB);
+        StoreColor(GI, Src1);
+    }
+
+    if (Entry.NumMipLevels == 2)
+        return;
+
+    GroupMemoryBarrierWithGroupSync();
+
+    // X and Y are multiples of four
+    if ((GI & 0x1B) == 0)
+    {
+        float4 Src2 = LoadColor(GI + 0x02);
+        float4 Src3 = LoadColor(GI + 0x10);
+        float4 Src4 = LoadColor(GI + 0x12);
+        Src1 = 0.25 * (Src1 + Src2 + Src3 + Src4);
+
+        OutMip3[Tex][DTid.xy / 4] = PackColor(Src1, Entry.ConvertToSRGB);
+        StoreColor(GI, Src1);
+    }
+
+    if (Entry.NumMipLevels == 3)
+        return;
+
+    GroupMemoryBarrierWithGroupSync();
+
+    if (GI == 0)
+    {
+        float4 Src2 = LoadColor(GI + 0x04);
+        float4 Src3 = LoadColor(GI + 0x20);
+        float4 Src4 = LoadColor(GI + 0x24);
+        Src1 = 0.25 * (Src1 + Src2 + Src3 + Src4);
+
+        OutMip4[Tex][DTid.xy / 8] = PackColor(Src1, Entry.ConvertToSRGB);
+    }
+}
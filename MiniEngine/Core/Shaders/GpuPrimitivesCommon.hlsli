@@ -0,0 +1,167 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// The group-wide building blocks of the GPU primitives.  Lists are of uints in byte address buffers, and their
+// count is read from a counter buffer.  Scans and compaction reduce each block of 2048 elements, scan the block
+// totals, then scan each block again from its offset.
+//
+// PRIMITIVES_WAVE_OPS is defined in the shader model 6 permutations, which combine the lanes of each wave with
+// wave intrinsics and only go through LDS to combine the waves.  Waves are assumed to hold consecutive threads.
+//
+
+#define GpuPrimitives_RootSig \
+    "RootFlags(0), " \
+    "RootConstants(b0, num32BitConstants = 4)," \
+    "DescriptorTable(SRV(t0, numDescriptors = 3))," \
+    "DescriptorTable(UAV(u0, numDescriptors = 3))"
+
+// Must match GpuPrimitives.cpp
+#define BLOCK_SIZE 2048
+#define MAX_BLOCKS 4096
+#define THREADS_PER_GROUP 256
+#define ELEMENTS_PER_THREAD 8
+#define MAX_GROUPS 65535
+
+// What the reduce and scan passes read from each element
+#define MODE_VALUES 0   // The element's value
+#define MODE_FLAGS 1    // One where the element's flag is non-zero, for compaction
+
+// The operators of the segmented reduction
+#define OP_SUM 0
+#define OP_MIN 1
+#define OP_MAX 2
+
+ByteAddressBuffer g_Input : register(t0);
+ByteAddressBuffer g_Flags : register(t1);           // Compaction flags, or the offsets of the segments
+ByteAddressBuffer g_CounterBuffer : register(t2);
+
+RWByteAddressBuffer g_Output : register(u0);
+RWByteAddressBuffer g_BlockTotals : register(u1);   // The total of every block, replaced by its offset
+RWByteAddressBuffer g_TotalBuffer : register(u2);   // Where the sum of the whole list is written
+
+cbuffer CB0 : register(b0)
+{
+    uint CounterOffset;     // Of the list's count in g_CounterBuffer
+    uint Operation;         // A MODE_ or OP_ value
+    uint2 Params;           // Particular to each shader
+}
+
+uint GetListCount( void )
+{
+    return min(g_CounterBuffer.Load(CounterOffset), BLOCK_SIZE * MAX_BLOCKS);
+}
+
+uint GetNumBlocks( void )
+{
+    return (GetListCount() + BLOCK_SIZE - 1) / BLOCK_SIZE;
+}
+
+uint ReduceOperator( uint A, uint B, uint Op )
+{
+    return Op == OP_MIN ? min(A, B) : Op == OP_MAX ? max(A, B) : A + B;
+}
+
+uint ReduceIdentity( uint Op )
+{
+    return Op == OP_MIN ? 0xffffffff : 0;
+}
+
+groupshared uint gs_Scan[2][THREADS_PER_GROUP];
+
+// Returns the combination of every thread's value with Op.  Every thread must call it.
+uint GroupReduce( uint GI, uint Value, uint Op )
+{
+#ifdef PRIMITIVES_WAVE_OPS
+    const uint LaneCount = WaveGetLaneCount();
+    const uint NumWaves = THREADS_PER_GROUP / LaneCount;
+
+    const uint WaveResult = Op == OP_MIN ? WaveActiveMin(Value) : Op == OP_MAX ? WaveActiveMax(Value) : WaveActiveSum(Value);
+    if (WaveIsFirstLane())
+        gs_Scan[0][GI / LaneCount] = WaveResult;
+    GroupMemoryBarrierWithGroupSync();
+
+    uint Result = ReduceIdentity(Op);
+    for (uint Wave = 0; Wave < NumWaves; ++Wave)
+        Result = ReduceOperator(Result, gs_Scan[0][Wave], Op);
+#else
+    gs_Scan[0][GI] = Value;
+    GroupMemoryBarrierWithGroupSync();
+
+    [unroll]
+    for (uint Stride = THREADS_PER_GROUP / 2; Stride > 0; Stride /= 2)
+    {
+        if (GI < Stride)
+            gs_Scan[0][GI] = ReduceOperator(gs_Scan[0][GI], gs_Scan[0][GI + Stride], Op);
+        GroupMemoryBarrierWithGroupSync();
+    }
+
+    uint Result = gs_Scan[0][0];
+#endif
+
+    // The next reduction overwrites the results
+    GroupMemoryBarrierWithGroupSync();
+
+    return Result;
+}
+
+// Returns the sum of the values of the threads before this one, and the sum of all of them in Total.  Every
+// thread must call it.
+uint GroupExclusiveScan( uint GI, uint Value, out uint Total )
+{
+#ifdef PRIMITIVES_WAVE_OPS
+    const uint LaneCount = WaveGetLaneCount();
+    const uint NumWaves = THREADS_PER_GROUP / LaneCount;
+    const uint WaveIndex = GI / LaneCount;
+
+    const uint Prefix = WavePrefixSum(Value);
+    if (WaveGetLaneIndex() == LaneCount - 1)
+        gs_Scan[0][WaveIndex] = Prefix + Value;
+    GroupMemoryBarrierWithGroupSync();
+
+    uint WaveOffset = 0;
+    Total = 0;
+    for (uint Wave = 0; Wave < NumWaves; ++Wave)
+    {
+        const uint WaveTotal = gs_Scan[0][Wave];
+        WaveOffset += Wave < WaveIndex ? WaveTotal : 0;
+        Total += WaveTotal;
+    }
+
+    const uint Result = WaveOffset + Prefix;
+#else
+    gs_Scan[0][GI] = Value;
+    GroupMemoryBarrierWithGroupSync();
+
+    uint Buf = 0;
+
+    [unroll]
+    for (uint Step = 1; Step < THREADS_PER_GROUP; Step *= 2)
+    {
+        uint Sum = gs_Scan[Buf][GI];
+        if (GI >= Step)
+            Sum += gs_Scan[Buf][GI - Step];
+        gs_Scan[Buf ^ 1][GI] = Sum;
+        Buf ^= 1;
+        GroupMemoryBarrierWithGroupSync();
+    }
+
+    Total = gs_Scan[Buf][THREADS_PER_GROUP - 1];
+    const uint Result = gs_Scan[Buf][GI] - Value;
+#endif
+
+    // The next scan overwrites the sums
+    GroupMemoryBarrierWithGroupSync();
+
+    return Result;
+}
+
+// What the reduce and scan passes count for an element in range
+uint LoadScanValue( uint Index, uint Mode )
+{
+    return Mode == MODE_FLAGS ? (g_Flags.Load(Index * 4) != 0 ? 1 : 0) : g_Input.Load(Index * 4);
+}
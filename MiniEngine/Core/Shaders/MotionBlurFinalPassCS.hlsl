@@ -19,6 +19,7 @@
 
 Texture2D<packed_velocity_t> VelocityBuffer : register(t0);        // full resolution motion vectors
 Texture2D<float4> PrepBuffer : register(t1);        // 1/4 resolution pre-weighted blurred color samples
+StructuredBuffer<uint> TileQueue : register(t2);    // 16x16 tiles, each covered by four groups
 RWTexture2D<float3> DstColor : register(u0);        // final output color (blurred and temporally blended)
 SamplerState LinearSampler : register(s0);
 
@@ -29,9 +30,10 @@ cbuffer c0 : register(b0)
 
 [RootSignature(MotionBlur_RootSig)]
 [numthreads( 8, 8, 1 )]
-void main( uint3 Gid : SV_GroupID, uint GI : SV_GroupIndex, uint3 GTid : SV_GroupThreadID, uint3 DTid : SV_DispatchThreadID )
+void main( uint3 Gid : SV_GroupID, uint GI : SV_GroupIndex, uint3 GTid : SV_GroupThreadID )
 {
-    uint2 st = DTid.xy;
+    uint Tile = TileQueue[Gid.x];
+    uint2 st = uint2(Tile & 0xFFFF, Tile >> 16) * 16 + uint2(Gid.y & 1, Gid.y >> 1) * 8 + GTid.xy;
     float2 position = st + 0.5;
     float2 uv = position * RcpBufferDim;
 
@@ -42,8 +44,11 @@ void main( uint3 Gid : SV_GroupID, uint GI : SV_GroupIndex, uint3 GTid : SV_Grou
     // direction.
     float Speed = length(Velocity);
 
+    // Every pixel of a uniform tile is fast enough to blur
+#ifndef UNIFORM_TILE
     [branch]
     if (Speed >= 4.0)
+#endif
     {
         float4 accum = float4(thisColor, 1);
 
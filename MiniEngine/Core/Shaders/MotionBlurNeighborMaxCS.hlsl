@@ -0,0 +1,51 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Sorts the tiles into work queues by the speeds around them.  Tiles with nothing fast enough to blur nearby
+// are static and left out.  Tiles whose pixels all blur are uniform, and the rest are complex.
+//
+
+#include "MotionBlurRS.hlsli"
+
+// Pixels that move at least this many pixels blur, as in MotionBlurFinalPassCS
+#define MIN_BLUR_SPEED 4.0
+
+Texture2D<float2> TileMax : register(t0);
+RWStructuredBuffer<uint> UniformQueue : register(u0);
+RWStructuredBuffer<uint> ComplexQueue : register(u1);
+
+cbuffer c0 : register(b0)
+{
+    uint2 TiledDimension;
+}
+
+[RootSignature(MotionBlur_RootSig)]
+[numthreads( 8, 8, 1 )]
+void main( uint3 DTid : SV_DispatchThreadID )
+{
+    if (any(DTid.xy >= TiledDimension))
+        return;
+
+    // A blur gathers prep texels up to 17 pixels away, so a tile's prep texels are needed two tiles out.  Loads
+    // past the edges return zero.
+    float NeighborMax = 0.0;
+    for (int y = -2; y <= 2; ++y)
+    {
+        for (int x = -2; x <= 2; ++x)
+            NeighborMax = max(NeighborMax, TileMax[int2(DTid.xy) + int2(x, y)].x);
+    }
+
+    if (NeighborMax < MIN_BLUR_SPEED)
+        return;
+
+    uint TileCoord = DTid.x | DTid.y << 16;
+    if (TileMax[DTid.xy].y >= MIN_BLUR_SPEED)
+        UniformQueue[UniformQueue.IncrementCounter()] = TileCoord;
+    else
+        ComplexQueue[ComplexQueue.IncrementCounter()] = TileCoord;
+}
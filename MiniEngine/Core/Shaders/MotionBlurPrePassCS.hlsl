@@ -16,25 +16,34 @@
 
 Texture2D<float3> ColorBuffer : register(t0);
 Texture2D<packed_velocity_t> VelocityBuffer : register(t1);
+StructuredBuffer<uint> TileQueue : register(t2);    // 16x16 tiles, each the 8x8 texels of a group
 RWTexture2D<float4> PrepBuffer : register(u0);
 
 float4 GetSampleData( uint2 st )
 {
+#ifdef UNIFORM_TILE
+    // Every pixel of a uniform tile moves fast enough to have its full weight
+    return float4(ColorBuffer[st], 1.0);
+#else
     float Speed = length(UnpackVelocity(VelocityBuffer[st]).xy);
     return float4(ColorBuffer[st], 1.0) * saturate(Speed * 32.0 / 4.0);
+#endif
 }
 
 [RootSignature(MotionBlur_RootSig)]
 [numthreads( 8, 8, 1 )]
-void main( uint3 Gid : SV_GroupID, uint GI : SV_GroupIndex, uint3 GTid : SV_GroupThreadID, uint3 DTid : SV_DispatchThreadID )
+void main( uint3 Gid : SV_GroupID, uint GI : SV_GroupIndex, uint3 GTid : SV_GroupThreadID )
 {
-    uint2 corner = DTid.xy << 1;
+    uint Tile = TileQueue[Gid.x];
+    uint2 st = uint2(Tile & 0xFFFF, Tile >> 16) * 8 + GTid.xy;
+
+    uint2 corner = st << 1;
     float4 sample0 = GetSampleData( corner + uint2(0, 0) );
     float4 sample1 = GetSampleData( corner + uint2(1, 0) );
     float4 sample2 = GetSampleData( corner + uint2(0, 1) );
     float4 sample3 = GetSampleData( corner + uint2(1, 1) );
 
     float combinedMotionWeight = sample0.a + sample1.a + sample2.a + sample3.a + 0.0001;
-    PrepBuffer[DTid.xy] = floor(0.25 * combinedMotionWeight * 3.0) / 3.0 * float4(
+    PrepBuffer[st] = floor(0.25 * combinedMotionWeight * 3.0) / 3.0 * float4(
         (sample0.rgb + sample1.rgb + sample2.rgb + sample3.rgb) / combinedMotionWeight, 1.0 );
 }
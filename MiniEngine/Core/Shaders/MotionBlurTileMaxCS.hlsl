@@ -0,0 +1,52 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Finds the fastest and slowest pixels of each 16x16 tile, with each thread of a group reading 2x2 of them.
+//
+
+#include "MotionBlurRS.hlsli"
+#include "PixelPacking_Velocity.hlsli"
+
+Texture2D<packed_velocity_t> VelocityBuffer : register(t0);
+RWTexture2D<float2> TileMax : register(u0);
+
+// Speeds are never negative, so they order the same as their bits
+groupshared uint gs_MaxSpeed;
+groupshared uint gs_MinSpeed;
+
+float GetSpeed( uint2 st )
+{
+    return length(UnpackVelocity(VelocityBuffer[st]).xy);
+}
+
+[RootSignature(MotionBlur_RootSig)]
+[numthreads( 8, 8, 1 )]
+void main( uint3 Gid : SV_GroupID, uint GI : SV_GroupIndex, uint3 GTid : SV_GroupThreadID )
+{
+    if (GI == 0)
+    {
+        gs_MaxSpeed = 0;
+        gs_MinSpeed = 0x7F7FFFFF;
+    }
+
+    GroupMemoryBarrierWithGroupSync();
+
+    uint2 corner = Gid.xy * 16 + GTid.xy * 2;
+    float Speed0 = GetSpeed( corner + uint2(0, 0) );
+    float Speed1 = GetSpeed( corner + uint2(1, 0) );
+    float Speed2 = GetSpeed( corner + uint2(0, 1) );
+    float Speed3 = GetSpeed( corner + uint2(1, 1) );
+
+    InterlockedMax(gs_MaxSpeed, asuint(max(max(Speed0, Speed1), max(Speed2, Speed3))));
+    InterlockedMin(gs_MinSpeed, asuint(min(min(Speed0, Speed1), min(Speed2, Speed3))));
+
+    GroupMemoryBarrierWithGroupSync();
+
+    if (GI == 0)
+        TileMax[Gid.xy] = float2(asfloat(gs_MaxSpeed), asfloat(gs_MinSpeed));
+}
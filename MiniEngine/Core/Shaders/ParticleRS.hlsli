@@ -17,7 +17,7 @@
     "CBV(b1)," \
     "CBV(b2)," \
     "DescriptorTable(UAV(u0, numDescriptors = 8))," \
-    "DescriptorTable(SRV(t0, numDescriptors = 10))," \
+    "DescriptorTable(SRV(t0, numDescriptors = 12))," \
     "StaticSampler(s0," \
         "addressU = TEXTURE_ADDRESS_BORDER," \
         "addressV = TEXTURE_ADDRESS_BORDER," \
@@ -34,4 +34,10 @@
         "addressU = TEXTURE_ADDRESS_CLAMP," \
         "addressV = TEXTURE_ADDRESS_CLAMP," \
         "addressW = TEXTURE_ADDRESS_CLAMP," \
-        "filter = FILTER_MIN_MAG_MIP_POINT)"
+        "filter = FILTER_MIN_MAG_MIP_POINT)," \
+    "StaticSampler(s3," \
+        "addressU = TEXTURE_ADDRESS_CLAMP," \
+        "addressV = TEXTURE_ADDRESS_CLAMP," \
+        "addressW = TEXTURE_ADDRESS_CLAMP," \
+        "comparisonFunc = COMPARISON_GREATER_EQUAL," \
+        "filter = FILTER_COMPARISON_MIN_MAG_LINEAR_MIP_POINT)"
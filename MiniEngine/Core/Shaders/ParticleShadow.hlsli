@@ -0,0 +1,37 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// The sun's light reaching a particle.  The translucency shadow holds the light left after the particles that
+// cast opacity, with the shadow depth of the one nearest the sun, so only what lies past it is darkened.
+// Include after ParticleUtility.hlsli.
+//
+
+Texture2D<float> g_SunShadow : register(t8);
+Texture2D<float> g_TranslucencyShadow : register(t9);
+Texture2D<float> g_TranslucencyShadowDepth : register(t10);
+
+// Shadow depth is 1 nearest the sun
+static const float kTranslucencyShadowBias = 0.001;
+
+float GetParticleShadow( float2 ScreenUV, float Depth )
+{
+    if (gShadowEnable == 0)
+        return 1.0;
+
+    float3 ShadowCoord = mul(gScreenToShadow, float4(ScreenUV * Depth, Depth, 1.0)).xyz;
+    float Light = g_SunShadow.SampleCmpLevelZero(gSampShadow, ShadowCoord.xy, ShadowCoord.z);
+
+    if (gTranslucencyShadowEnable != 0)
+    {
+        float NearestDepth = g_TranslucencyShadowDepth.SampleLevel(gSampPointClamp, ShadowCoord.xy, 0);
+        if (ShadowCoord.z < NearestDepth - kTranslucencyShadowBias)
+            Light *= g_TranslucencyShadow.SampleLevel(gSampPointClamp, ShadowCoord.xy, 0);
+    }
+
+    return Light;
+}
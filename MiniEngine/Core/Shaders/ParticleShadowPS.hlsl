@@ -0,0 +1,33 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// The first target blends the light left by multiplying it by one minus the opacity, and the second keeps the
+// largest shadow depth, which is that of the sprite nearest the sun.
+
+#include "ParticleUpdateCommon.hlsli"
+#include "ParticleUtility.hlsli"
+
+Texture2DArray<float4> ColorTex : register(t1);
+
+struct PSOutput
+{
+    float4 Opacity : SV_Target0;
+    float Depth : SV_Target1;
+};
+
+[RootSignature(Particle_RootSig)]
+PSOutput main( ParticleVertexOutput input )
+{
+    float Opacity = ColorTex.Sample( gSampLinearBorder, float3(input.TexCoord.xy, input.TexID) ).a * input.Color.a;
+    clip(Opacity - 1.0 / 255.0);
+
+    PSOutput Out;
+    Out.Opacity = float4(0.0, 0.0, 0.0, saturate(Opacity));
+    Out.Depth = input.Pos.z;
+    return Out;
+}
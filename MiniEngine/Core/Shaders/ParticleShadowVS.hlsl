@@ -0,0 +1,13 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Renders the sprites from the sun into the translucency shadow.  The opacity multiplies, so no sort is needed.
+
+#define DISABLE_PARTICLE_SORT 1
+#define TRANSLUCENCY_SHADOW 1
+#include "ParticleVS.hlsl"
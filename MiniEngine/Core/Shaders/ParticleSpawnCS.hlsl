@@ -16,30 +16,84 @@
 #include "ParticleUtility.hlsli"
 
 StructuredBuffer< ParticleSpawnData > g_ResetData : register( t0 );
+StructuredBuffer< ParticleEffectData > g_EffectData : register( t3 );
+StructuredBuffer< uint2 > g_SpawnRanges : register( t4 );     // The first spawn thread and index of each effect
+RWByteAddressBuffer g_EffectCounters : register( u1 );
 RWStructuredBuffer< ParticleMotion > g_OutputBuffer : register( u2 );
 
+uint Hash( uint x )
+{
+    x = (x ^ 61) ^ (x >> 16);
+    x *= 9;
+    x ^= x >> 4;
+    x *= 0x27d4eb2d;
+    return x ^ (x >> 15);
+}
+
+bool IsEffectVisible( float3 Center, float Radius )
+{
+    for (uint i = 0; i < 6; ++i)
+    {
+        if (dot(FrustumPlanes[i].xyz, Center) + FrustumPlanes[i].w + Radius < 0.0)
+            return false;
+    }
+    return true;
+}
+
 [RootSignature(Particle_RootSig)]
 [numthreads(64, 1, 1)]
 void main( uint3 DTid : SV_DispatchThreadID )
 {
+    if (DTid.x >= NumSpawnThreads)
+        return;
+
+    // The effects' spawn threads follow each other, so find the last one starting at or before this thread
+    uint First = 0, Last = NumSpawnRanges - 1;
+    while (First < Last)
+    {
+        uint Mid = (First + Last + 1) / 2;
+        if (g_SpawnRanges[Mid].x <= DTid.x)
+            First = Mid;
+        else
+            Last = Mid - 1;
+    }
+    const uint EffectIndex = g_SpawnRanges[First].y;
+    ParticleEffectData Effect = g_EffectData[EffectIndex];
+
+    // An effect that can't reach the view spawns nothing.  The particles it already has go on updating.
+    if (CullEffects && !IsEffectVisible(Effect.EmitPosW, Effect.BoundingRadius))
+        return;
+
+    // The update counted the living particles first, so they take precedence over new ones
+    uint EffectCount;
+    g_EffectCounters.InterlockedAdd(4 + EffectIndex * 4, 1, EffectCount);
+    if (EffectCount >= Effect.MaxParticles)
+        return;
+
+    uint SpawnCount;
+    g_EffectCounters.InterlockedAdd(0, 1, SpawnCount);
+    if (SpawnCount >= SpawnBudget)
+        return;
+
     uint index = g_OutputBuffer.IncrementCounter();
-    if (index >= MaxParticles)
+    if (index >= MaxTotalParticles)
         return;
     
-    uint ResetDataIndex = RandIndex[DTid.x].x; 
+    uint ResetDataIndex = Effect.SpawnDataBase + Hash(DTid.x ^ RandomSeed) % Effect.SpawnDataCount;
     ParticleSpawnData rd  = g_ResetData[ResetDataIndex];
         
-    float3 emitterVelocity = EmitPosW - LastEmitPosW; 
-    float3 randDir = rd.Velocity.x * EmitRightW + rd.Velocity.y * EmitUpW + rd.Velocity.z * EmitDirW;
-    float3 newVelocity = emitterVelocity * EmitterVelocitySensitivity + randDir;
-    float3 adjustedPosition = EmitPosW - emitterVelocity * rd.Random + rd.SpreadOffset;
+    float3 emitterVelocity = Effect.EmitPosW - Effect.LastEmitPosW; 
+    float3 randDir = rd.Velocity.x * Effect.EmitRightW + rd.Velocity.y * Effect.EmitUpW + rd.Velocity.z * Effect.EmitDirW;
+    float3 newVelocity = emitterVelocity * Effect.EmitterVelocitySensitivity + randDir;
+    float3 adjustedPosition = Effect.EmitPosW - emitterVelocity * rd.Random + rd.SpreadOffset;
 
     ParticleMotion newParticle;
     newParticle.Position = adjustedPosition;
     newParticle.Rotation = 0.0;
-    newParticle.Velocity = newVelocity + EmitDirW * EmitSpeed; 
+    newParticle.Velocity = newVelocity + Effect.EmitDirW * Effect.EmitSpeed; 
     newParticle.Mass = rd.Mass; 
     newParticle.Age = 0.0;
     newParticle.ResetDataIndex = ResetDataIndex; 
+    newParticle.EffectIndex = EffectIndex;
     g_OutputBuffer[index] = newParticle;
 }
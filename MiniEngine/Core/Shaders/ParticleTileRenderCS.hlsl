@@ -14,6 +14,7 @@
 //
 
 #include "ParticleUtility.hlsli"
+#include "ParticleShadow.hlsli"
 #include "PixelPacking.hlsli"
 
 //#define DEBUG_LOW_RES
@@ -127,6 +128,10 @@ float4x4 RenderParticles( uint2 TileCoord, uint2 ST, uint NumParticles, uint Hit
     float4x4 Quad = 0.0;
     const float2 PixelCoord = (ST + 1) * gRcpBufferDim;
 
+    // Every thread of the tile walks the same particles, so the sun shadow is looked up once per particle per
+    // tile, at the tile's center, rather than for every pixel
+    const float2 TileCenter = (TileCoord * TILE_SIZE + TILE_SIZE / 2) * gRcpBufferDim;
+
     uint BlendedParticles = 0;
 
     while (BlendedParticles < NumParticles)
@@ -142,6 +147,10 @@ float4x4 RenderParticles( uint2 TileCoord, uint2 ST, uint NumParticles, uint Hit
             uint ParticleIdx = SortKey & 0x3FFFF;
             ParticleScreenData Particle = g_VisibleParticles[ParticleIdx];
 
+            [branch]
+            if (Particle.ShadowStrength > 0.0)
+                Particle.Color.rgb *= lerp(1.0, GetParticleShadow(TileCenter, Particle.Depth), Particle.ShadowStrength);
+
 #if defined(DYNAMIC_RESOLUTION)
             bool DoFullRes = (Particle.TextureLevel > gDynamicResLevel);
 #elif defined(LOW_RESOLUTION)
@@ -22,18 +22,17 @@ cbuffer CB0 : register(b0)
 
 StructuredBuffer< ParticleSpawnData > g_ResetData : register( t0 );
 StructuredBuffer< ParticleMotion > g_InputBuffer : register( t1 );
+ByteAddressBuffer g_InputCounter : register( t2 );
+StructuredBuffer< ParticleEffectData > g_EffectData : register( t3 );
 RWStructuredBuffer< ParticleVertex > g_VertexBuffer : register( u0 );
+RWByteAddressBuffer g_EffectCounters : register( u1 );
 RWStructuredBuffer< ParticleMotion > g_OutputBuffer : register( u2 );
 
-[RootSignature(Particle_RootSig)]
-[numthreads(64, 1, 1)]
-void main( uint3 DTid : SV_DispatchThreadID )
+void UpdateParticle( uint InputIndex )
 {
-    if (DTid.x >= MaxParticles)
-        return;
-
-    ParticleMotion ParticleState = g_InputBuffer[ DTid.x ];
+    ParticleMotion ParticleState = g_InputBuffer[ InputIndex ];
     ParticleSpawnData rd = g_ResetData[ ParticleState.ResetDataIndex ];
+    ParticleEffectData Effect = g_EffectData[ ParticleState.EffectIndex ];
 
     // Update age.  If normalized age exceeds 1, the particle does not renew its lease on life.
     ParticleState.Age += gElapsedTime * rd.AgeRate;
@@ -45,20 +44,26 @@ void main( uint3 DTid : SV_DispatchThreadID )
         min(gElapsedTime, ParticleState.Position.y / -ParticleState.Velocity.y) : gElapsedTime;
 
     ParticleState.Position += ParticleState.Velocity * StepSize;
-    ParticleState.Velocity += Gravity * ParticleState.Mass * StepSize;
+    ParticleState.Velocity += Effect.Gravity * ParticleState.Mass * StepSize;
 
     // Rebound off the ground if we didn't consume all of the elapsed time
     StepSize = gElapsedTime - StepSize;
     if (StepSize > 0.0)
     {
-        ParticleState.Velocity = reflect(ParticleState.Velocity, float3(0, 1, 0)) * Restitution;
+        ParticleState.Velocity = reflect(ParticleState.Velocity, float3(0, 1, 0)) * Effect.Restitution;
         ParticleState.Position += ParticleState.Velocity * StepSize;
-        ParticleState.Velocity += Gravity * ParticleState.Mass * StepSize;
+        ParticleState.Velocity += Effect.Gravity * ParticleState.Mass * StepSize;
     }
 
-    // The spawn dispatch will be simultaneously adding particles as well.  It's possible to overflow.
+    // Count the particle against its effect's limit, which also retires the particles of effects that are no
+    // longer active.  The count of each effect starts at zero every frame, at offset 4 past the spawn count.
+    uint EffectCount;
+    g_EffectCounters.InterlockedAdd(4 + ParticleState.EffectIndex * 4, 1, EffectCount);
+    if (EffectCount >= Effect.MaxParticles)
+        return;
+
     uint index = g_OutputBuffer.IncrementCounter();    
-    if (index >= MaxParticles)
+    if (index >= MaxTotalParticles)
         return;
 
     g_OutputBuffer[index] = ParticleState;
@@ -70,7 +75,8 @@ void main( uint3 DTid : SV_DispatchThreadID )
     ParticleVertex Sprite;
 
     Sprite.Position = ParticleState.Position;
-    Sprite.TextureID = TextureID;
+    Sprite.TextureID = Effect.TextureID;
+    Sprite.ShadowStrength = Effect.ShadowStrength;
 
     // Update size and color
     Sprite.Size = lerp(rd.StartSize, rd.EndSize, ParticleState.Age);
@@ -82,3 +88,15 @@ void main( uint3 DTid : SV_DispatchThreadID )
 
     g_VertexBuffer[ g_VertexBuffer.IncrementCounter() ] = Sprite;
 }
+
+// A fixed number of threads strides over the particles of every effect, so that the update needs no indirect
+// arguments built from last frame's count
+[RootSignature(Particle_RootSig)]
+[numthreads(64, 1, 1)]
+void main( uint3 DTid : SV_DispatchThreadID )
+{
+    const uint NumParticles = min(g_InputCounter.Load(0), MaxTotalParticles);
+
+    for (uint i = DTid.x; i < NumParticles; i += NumSimulationThreads)
+        UpdateParticle(i);
+}
@@ -12,8 +12,8 @@
 //              James Stanard
 //
 
-cbuffer EmissionProperties : register(b2)
-{    
+struct ParticleEffectData
+{
     float3 LastEmitPosW;
     float EmitSpeed;
     float3 EmitPosW;
@@ -27,8 +27,24 @@ cbuffer EmissionProperties : register(b2)
     float3 Gravity;
     uint TextureID;
     float3 EmissiveColor;
-    float pad;
-    uint4 RandIndex[64];
+    float ShadowStrength;
+    uint SpawnDataBase;
+    uint SpawnDataCount;
+    float BoundingRadius;
+    float pad1;
+};
+
+// The simulation of every active effect runs in one update and one spawn dispatch
+cbuffer SimulationConstants : register(b2)
+{
+    float4 FrustumPlanes[6];        // World space, pointing inward, of the camera that last rendered particles
+    uint CullEffects;
+    uint MaxTotalParticles;
+    uint NumSimulationThreads;      // The update loops over the particles with this many threads
+    uint NumSpawnThreads;
+    uint NumSpawnRanges;
+    uint SpawnBudget;               // The most particles spawned in a frame by all effects together
+    uint RandomSeed;
 };
 
 struct ParticleSpawnData
@@ -53,6 +69,7 @@ struct ParticleMotion
     float Age;
     float Rotation;
     uint ResetDataIndex;
+    uint EffectIndex;
 };
 
 struct ParticleVertexOutput
@@ -28,6 +28,7 @@
 SamplerState gSampLinearBorder : register(s0);
 SamplerState gSampPointBorder : register(s1);
 SamplerState gSampPointClamp : register(s2);
+SamplerComparisonState gSampShadow : register(s3);
 
 cbuffer CBChangesPerView : register(b1)
 {
@@ -46,6 +47,10 @@ cbuffer CBChangesPerView : register(b1)
     uint gTileRowPitch;
     uint gTilesPerRow;
     uint gTilesPerCol;
+
+    float4x4 gScreenToShadow;   // From screen UV and normalized depth, each UV scaled by the depth, to sun shadow space
+    uint gShadowEnable;
+    uint gTranslucencyShadowEnable;
 };
 
 struct ParticleVertex
@@ -54,6 +59,7 @@ struct ParticleVertex
     float4 Color;
     float Size;
     uint TextureID;
+    float ShadowStrength;
 };
 
 // Intentionally left unpacked to allow scalar register loads and ops
@@ -66,6 +72,7 @@ struct ParticleScreenData
     float TextureIndex;
     float TextureLevel;
     uint Bounds;
+    float ShadowStrength;
 };
 
 uint InsertZeroBit( uint Value, uint BitIdx )
@@ -12,6 +12,7 @@
 
 #include "ParticleUpdateCommon.hlsli"
 #include "ParticleUtility.hlsli"
+#include "ParticleShadow.hlsli"
 
 StructuredBuffer<ParticleVertex> g_VertexBuffer : register( t0 );
 StructuredBuffer<uint> g_IndexBuffer : register( t3 );
@@ -30,6 +31,21 @@ ParticleVertexOutput main( uint BillboardVertex : SV_VertexID, uint InstanceId :
     Out.Color = In.Color;
     Out.TexID = In.TextureID;
 
+#ifdef TRANSLUCENCY_SHADOW
+    // Seen from the sun, only the opacity the effect casts matters
+    Out.Color.a *= In.ShadowStrength;
+#else
+    // The color does not interpolate, so the whole sprite takes the shadow at its center
+    [branch]
+    if (In.ShadowStrength > 0.0)
+    {
+        float4 Center = mul( gViewProj, float4(In.Position, 1) );
+        float2 CenterUV = Center.xy / Center.w * float2(0.5, -0.5) + 0.5;
+        float Shadow = GetParticleShadow(CenterUV, Center.w * gRcpFarZ);
+        Out.Color.rgb *= lerp(1.0, Shadow, In.ShadowStrength);
+    }
+#endif
+
     float2 Corner = lerp( float2(-1, 1), float2(1, -1), Out.TexCoord );
     float3 Position = mul( (float3x3)gInvView, float3(Corner * In.Size, 0) ) + In.Position;
 
@@ -0,0 +1,37 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Scatters the samples recorded since the graphs were last rendered into the history buffer.
+//
+
+#include "PerfGraphRS.hlsli"
+
+struct HistorySample
+{
+    uint Index;
+    float Value;
+};
+
+StructuredBuffer<HistorySample> Samples : register(t0);
+RWStructuredBuffer<float> History : register(u0);
+
+cbuffer constants : register(b1)
+{
+    uint SampleCount;
+}
+
+[RootSignature(PerfGraph_RootSig)]
+[numthreads( 64, 1, 1 )]
+void main( uint3 DTid : SV_DispatchThreadID )
+{
+    if (DTid.x >= SampleCount)
+        return;
+
+    HistorySample Sample = Samples[DTid.x];
+    History[Sample.Index] = Sample.Value;
+}
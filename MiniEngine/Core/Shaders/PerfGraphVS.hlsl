@@ -13,19 +13,22 @@
 
 #include "PerfGraphRS.hlsli"
 
-cbuffer CBGraphColor : register(b0)
+// One line graph per instance, reading its nodes from the shared history buffer
+struct GraphInstance
 {
+    float4 Transform;       // From the graph's viewport to the render target, scale then offset
     float3 Color;
-    float RcpXScale;
+    float RcpYScale;
+    uint HistoryOffset;
     uint NodeCount;
     uint FrameID;
+    float RcpXScale;
 };
 
-cbuffer constants : register(b1)
+cbuffer CBGraphs : register(b0)
 {
-    uint Instance;
-    float RcpYScale;
-}
+    GraphInstance Graphs[8];    // MAX_GRAPH_INSTANCES
+};
 
 struct VSOutput
 {
@@ -36,18 +39,22 @@ struct VSOutput
 StructuredBuffer<float> PerfTimes : register(t0);
 
 [RootSignature(PerfGraph_RootSig)]
-VSOutput main( uint VertexID : SV_VertexID )
+VSOutput main( uint VertexID : SV_VertexID, uint InstanceID : SV_InstanceID )
 {
+    GraphInstance Graph = Graphs[InstanceID];
+
+    // Graphs with fewer nodes than the draw has vertices repeat their last node
+    uint Node = min(VertexID, Graph.NodeCount - 1);
+
     // Assume NodeCount is a power of 2
-    uint offset = (FrameID + VertexID) & (NodeCount - 1);
-        
-    // TODO:  Stop interleaving data
-    float perfTime = saturate(PerfTimes[offset] * RcpYScale) * 2.0 - 1.0;
-    float frame = VertexID * RcpXScale - 1.0; 
+    uint offset = Graph.HistoryOffset + ((Graph.FrameID + Node) & (Graph.NodeCount - 1));
+
+    float perfTime = saturate(PerfTimes[offset] * Graph.RcpYScale) * 2.0 - 1.0;
+    float frame = Node * Graph.RcpXScale - 1.0; 
 
     VSOutput output;
-    output.pos = float4(frame, perfTime, 1, 1);
-    output.col = Color;
+    output.pos = float4(float2(frame, perfTime) * Graph.Transform.xy + Graph.Transform.zw, 1, 1);
+    output.col = Graph.Color;
     return output;
 
 }
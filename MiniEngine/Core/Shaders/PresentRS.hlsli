@@ -14,7 +14,7 @@
 #define Present_RootSig \
     "RootFlags(0), " \
     "DescriptorTable(SRV(t0, numDescriptors = 2))," \
-    "RootConstants(b0, num32BitConstants = 6), " \
+    "RootConstants(b0, num32BitConstants = 10), " \
     "SRV(t2, visibility = SHADER_VISIBILITY_PIXEL)," \
     "DescriptorTable(UAV(u0, numDescriptors = 1)), " \
     "StaticSampler(s0," \
@@ -0,0 +1,58 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Counts each block's elements into bins in LDS and adds the bins to the histogram in g_Output.  An element's bin
+// is (Value >> Params.x) & Params.y, where the mask is one less than the power of two number of bins.
+//
+
+#include "GpuPrimitivesCommon.hlsli"
+
+// Must match GpuPrimitives.cpp
+#define MAX_BINS 4096
+
+groupshared uint gs_Bins[MAX_BINS];
+
+[RootSignature(GpuPrimitives_RootSig)]
+[numthreads(THREADS_PER_GROUP, 1, 1)]
+void main( uint3 Gid : SV_GroupID, uint GI : SV_GroupIndex )
+{
+    const uint Count = GetListCount();
+    const uint NumBins = Params.y + 1;
+
+    for (uint ClearBin = GI; ClearBin < NumBins; ClearBin += THREADS_PER_GROUP)
+        gs_Bins[ClearBin] = 0;
+    GroupMemoryBarrierWithGroupSync();
+
+    [unroll]
+    for (uint i = 0; i < ELEMENTS_PER_THREAD; ++i)
+    {
+        const uint Index = Gid.x * BLOCK_SIZE + i * THREADS_PER_GROUP + GI;
+        const bool InRange = Index < Count;
+        const uint Bin = InRange ? (g_Input.Load(Index * 4) >> Params.x) & Params.y : 0;
+
+#ifdef PRIMITIVES_WAVE_OPS
+        // Sorted and clustered lists often give a whole wave the same bin, which then takes one atomic
+        if (WaveActiveAllTrue(InRange) && WaveActiveAllEqual(Bin))
+        {
+            if (WaveIsFirstLane())
+                InterlockedAdd(gs_Bins[Bin], WaveGetLaneCount());
+            continue;
+        }
+#endif
+
+        if (InRange)
+            InterlockedAdd(gs_Bins[Bin], 1);
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    for (uint GroupBin = GI; GroupBin < NumBins; GroupBin += THREADS_PER_GROUP)
+    {
+        if (gs_Bins[GroupBin] != 0)
+            g_Output.InterlockedAdd(GroupBin * 4, gs_Bins[GroupBin]);
+    }
+}
@@ -0,0 +1,20 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "GpuPrimitivesCommon.hlsli"
+
+[RootSignature(GpuPrimitives_RootSig)]
+[numthreads(1, 1, 1)]
+void main( void )
+{
+    // One group per block, then one group per item for the segmented reduction, which loops past the group limit
+    const uint Count = GetListCount();
+    g_Output.Store3(0, uint3(GetNumBlocks(), 1, 1));
+    g_Output.Store3(12, uint3(clamp(Count, 1, MAX_GROUPS), 1, 1));
+}
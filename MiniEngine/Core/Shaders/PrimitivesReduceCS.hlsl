@@ -0,0 +1,36 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// The first pass of a scan or compaction sums each block, or counts the flags set in it.
+//
+
+#include "GpuPrimitivesCommon.hlsli"
+
+[RootSignature(GpuPrimitives_RootSig)]
+[numthreads(THREADS_PER_GROUP, 1, 1)]
+void main( uint3 Gid : SV_GroupID, uint GI : SV_GroupIndex )
+{
+    const uint Count = GetListCount();
+    const uint BlockStart = Gid.x * BLOCK_SIZE;
+
+    // The order of a sum does not matter, so neighboring threads read neighboring elements
+    uint Sum = 0;
+
+    [unroll]
+    for (uint i = 0; i < ELEMENTS_PER_THREAD; ++i)
+    {
+        const uint Index = BlockStart + i * THREADS_PER_GROUP + GI;
+        if (Index < Count)
+            Sum += LoadScanValue(Index, Operation);
+    }
+
+    Sum = GroupReduce(GI, Sum, OP_SUM);
+
+    if (GI == 0)
+        g_BlockTotals.Store(Gid.x * 4, Sum);
+}
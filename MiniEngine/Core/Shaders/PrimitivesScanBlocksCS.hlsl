@@ -0,0 +1,39 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// A single group turns the block totals into the offset of each block.  Params.x is the byte offset in
+// g_TotalBuffer to write the sum of the list to, and Params.y is non-zero to write it.
+//
+
+#include "GpuPrimitivesCommon.hlsli"
+
+[RootSignature(GpuPrimitives_RootSig)]
+[numthreads(THREADS_PER_GROUP, 1, 1)]
+void main( uint GI : SV_GroupIndex )
+{
+    const uint NumBlocks = GetNumBlocks();
+
+    uint Carry = 0;
+
+    for (uint Base = 0; Base < NumBlocks; Base += THREADS_PER_GROUP)
+    {
+        const uint Block = Base + GI;
+        const uint BlockTotal = Block < NumBlocks ? g_BlockTotals.Load(Block * 4) : 0;
+
+        uint Total;
+        const uint Offset = GroupExclusiveScan(GI, BlockTotal, Total);
+
+        if (Block < NumBlocks)
+            g_BlockTotals.Store(Block * 4, Carry + Offset);
+
+        Carry += Total;
+    }
+
+    if (GI == 0 && Params.y != 0)
+        g_TotalBuffer.Store(Params.x, Carry);
+}
@@ -0,0 +1,55 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// The last pass of a scan or compaction scans each block again from its offset.  A scan writes every element's
+// exclusive prefix sum, and compaction writes each element whose flag is set to its prefix.
+//
+
+#include "GpuPrimitivesCommon.hlsli"
+
+[RootSignature(GpuPrimitives_RootSig)]
+[numthreads(THREADS_PER_GROUP, 1, 1)]
+void main( uint3 Gid : SV_GroupID, uint GI : SV_GroupIndex )
+{
+    const uint Count = GetListCount();
+
+    // Each thread scans a run of consecutive elements in registers, so that only the run totals go through the
+    // group scan
+    const uint RunStart = Gid.x * BLOCK_SIZE + GI * ELEMENTS_PER_THREAD;
+
+    uint Values[ELEMENTS_PER_THREAD];
+    uint RunTotal = 0;
+
+    [unroll]
+    for (uint i = 0; i < ELEMENTS_PER_THREAD; ++i)
+    {
+        Values[i] = RunStart + i < Count ? LoadScanValue(RunStart + i, Operation) : 0;
+        RunTotal += Values[i];
+    }
+
+    uint BlockTotal;
+    uint Prefix = g_BlockTotals.Load(Gid.x * 4) + GroupExclusiveScan(GI, RunTotal, BlockTotal);
+
+    [unroll]
+    for (uint j = 0; j < ELEMENTS_PER_THREAD; ++j)
+    {
+        const uint Index = RunStart + j;
+
+        if (Operation == MODE_FLAGS)
+        {
+            if (Values[j] != 0)
+                g_Output.Store(Prefix * 4, g_Input.Load(Index * 4));
+        }
+        else if (Index < Count)
+        {
+            g_Output.Store(Index * 4, Prefix);
+        }
+
+        Prefix += Values[j];
+    }
+}
@@ -0,0 +1,36 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Reduces each segment of the list with one group.  Segment i spans the elements from offset i to offset i + 1
+// of g_Flags, and the counter holds the number of segments.  Groups take every MAX_GROUPS-th segment when there
+// are more.
+//
+
+#include "GpuPrimitivesCommon.hlsli"
+
+[RootSignature(GpuPrimitives_RootSig)]
+[numthreads(THREADS_PER_GROUP, 1, 1)]
+void main( uint3 Gid : SV_GroupID, uint GI : SV_GroupIndex )
+{
+    const uint NumSegments = g_CounterBuffer.Load(CounterOffset);
+    const uint NumGroups = clamp(NumSegments, 1, MAX_GROUPS);
+
+    for (uint Segment = Gid.x; Segment < NumSegments; Segment += NumGroups)
+    {
+        const uint2 Range = g_Flags.Load2(Segment * 4);
+
+        uint Result = ReduceIdentity(Operation);
+        for (uint Index = Range.x + GI; Index < Range.y; Index += THREADS_PER_GROUP)
+            Result = ReduceOperator(Result, g_Input.Load(Index * 4), Operation);
+
+        Result = GroupReduce(GI, Result, Operation);
+
+        if (GI == 0)
+            g_Output.Store(Segment * 4, Result);
+    }
+}
@@ -0,0 +1,38 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "RadixSortCommon.hlsli"
+
+groupshared uint gs_Counts[256];
+
+[RootSignature(RadixSort_RootSig)]
+[numthreads(THREADS_PER_GROUP, 1, 1)]
+void main( uint3 Gid : SV_GroupID, uint GI : SV_GroupIndex )
+{
+    const uint BlockStart = Gid.x * BLOCK_SIZE;
+    const uint ListCount = GetListCount();
+
+    if (GI < 256)
+        gs_Counts[GI] = 0;
+
+    GroupMemoryBarrierWithGroupSync();
+
+    [unroll]
+    for (uint i = 0; i < ELEMENTS_PER_THREAD; ++i)
+    {
+        uint Index = BlockStart + i * THREADS_PER_GROUP + GI;
+        if (Index < ListCount)
+            InterlockedAdd(gs_Counts[GetDigit(LoadElement(Index))], 1);
+    }
+
+    GroupMemoryBarrierWithGroupSync();
+
+    if (GI < 256)
+        g_Histograms.Store(HistogramAddress(GI, Gid.x), gs_Counts[GI]);
+}
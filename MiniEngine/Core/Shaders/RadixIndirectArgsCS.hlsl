@@ -0,0 +1,21 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "RadixSortCommon.hlsli"
+
+RWByteAddressBuffer g_IndirectArgsBuffer : register(u0);
+
+[RootSignature(RadixSort_RootSig)]
+[numthreads(1, 1, 1)]
+void main( void )
+{
+    // The count and scatter passes take one group per block
+    uint NumBlocks = (GetListCount() + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    g_IndirectArgsBuffer.Store3(0, uint3(NumBlocks, 1, 1));
+}
@@ -0,0 +1,38 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "RadixSortCommon.hlsli"
+
+[RootSignature(RadixSort_RootSig)]
+[numthreads(THREADS_PER_GROUP, 1, 1)]
+void main( uint3 Gid : SV_GroupID, uint GI : SV_GroupIndex )
+{
+    // One group per digit turns the digit's block counts into offsets
+    const uint Digit = Gid.x;
+    const uint NumBlocks = (GetListCount() + BLOCK_SIZE - 1) / BLOCK_SIZE;
+
+    uint Carry = 0;
+
+    for (uint Base = 0; Base < NumBlocks; Base += THREADS_PER_GROUP)
+    {
+        uint Block = Base + GI;
+        uint Count = Block < NumBlocks ? g_Histograms.Load(HistogramAddress(Digit, Block)) : 0;
+
+        uint Total;
+        uint Offset = GroupExclusiveScan(GI, Count, Total);
+
+        if (Block < NumBlocks)
+            g_Histograms.Store(HistogramAddress(Digit, Block), Carry + Offset);
+
+        Carry += Total;
+    }
+
+    if (GI == 0)
+        g_Histograms.Store(DigitTotalAddress(Digit), Carry);
+}
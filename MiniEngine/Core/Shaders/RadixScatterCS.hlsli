@@ -0,0 +1,112 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "RadixSortCommon.hlsli"
+
+#ifdef RADIXSORT_64BIT
+groupshared uint2 gs_Elements[BLOCK_SIZE];
+#else
+groupshared uint gs_Elements[BLOCK_SIZE];
+#endif
+
+groupshared uint gs_DigitStart[256];    // Where each digit begins in the sorted block
+groupshared uint gs_DigitBase[256];     // Where the block's elements of each digit go in the list
+
+[RootSignature(RadixSort_RootSig)]
+[numthreads(THREADS_PER_GROUP, 1, 1)]
+void main( uint3 Gid : SV_GroupID, uint GI : SV_GroupIndex )
+{
+    const uint BlockStart = Gid.x * BLOCK_SIZE;
+    const uint ValidCount = min(GetListCount() - BlockStart, BLOCK_SIZE);
+
+    // Each thread holds four neighboring elements of the block.  Those past the end of the list take the largest
+    // digit, so the stable sort keeps them at the end of the block.
+    element_t Elements[ELEMENTS_PER_THREAD];
+    uint Digits[ELEMENTS_PER_THREAD];
+
+    [unroll]
+    for (uint e = 0; e < ELEMENTS_PER_THREAD; ++e)
+    {
+        uint Local = GI * ELEMENTS_PER_THREAD + e;
+        Elements[e] = Local < ValidCount ? LoadElement(BlockStart + Local) : (element_t)0;
+        Digits[e] = Local < ValidCount ? GetDigit(Elements[e]) : 0xff;
+    }
+
+    // Sort the block by the digit one bit at a time.  Elements whose bit is clear move ahead of those whose bit
+    // is set, and each side keeps its order.
+    [unroll]
+    for (uint Bit = 0; Bit < 8; ++Bit)
+    {
+        uint Clear[ELEMENTS_PER_THREAD];
+        uint ClearCount = 0;
+
+        [unroll]
+        for (uint i = 0; i < ELEMENTS_PER_THREAD; ++i)
+        {
+            Clear[i] = ClearCount;
+            ClearCount += (Digits[i] >> Bit & 1) ^ 1;
+        }
+
+        uint TotalClear;
+        uint ClearBefore = GroupExclusiveScan(GI, ClearCount, TotalClear);
+
+        [unroll]
+        for (uint j = 0; j < ELEMENTS_PER_THREAD; ++j)
+        {
+            uint Local = GI * ELEMENTS_PER_THREAD + j;
+            uint ClearAhead = ClearBefore + Clear[j];
+            uint Dest = (Digits[j] >> Bit & 1) ? TotalClear + Local - ClearAhead : ClearAhead;
+            gs_Elements[Dest] = Elements[j];
+        }
+
+        GroupMemoryBarrierWithGroupSync();
+
+        [unroll]
+        for (uint k = 0; k < ELEMENTS_PER_THREAD; ++k)
+        {
+            uint Local = GI * ELEMENTS_PER_THREAD + k;
+            Elements[k] = gs_Elements[Local];
+            Digits[k] = Local < ValidCount ? GetDigit(Elements[k]) : 0xff;
+        }
+
+        // The next bit overwrites the elements
+        GroupMemoryBarrierWithGroupSync();
+    }
+
+    // After the scan, the histogram holds where the block's elements of each digit go among all of that digit's
+    uint BlockOffset = GI < 256 ? g_Histograms.Load(HistogramAddress(GI, Gid.x)) : 0;
+    uint DigitTotal = GI < 256 ? g_Histograms.Load(DigitTotalAddress(GI)) : 0;
+
+    uint ListCount;
+    uint ListDigitStart = GroupExclusiveScan(GI, DigitTotal, ListCount);
+
+    // The first element of each digit records where the digit starts.  Nothing writes the sorted block anymore,
+    // so the element before a thread's first one can be read back.
+    [unroll]
+    for (uint m = 0; m < ELEMENTS_PER_THREAD; ++m)
+    {
+        uint Local = GI * ELEMENTS_PER_THREAD + m;
+        uint PrevDigit = Local == 0 ? 0x100 : (m > 0 ? Digits[m - 1] : GetDigit(gs_Elements[Local - 1]));
+        if (Local < ValidCount && Digits[m] != PrevDigit)
+            gs_DigitStart[Digits[m]] = Local;
+    }
+
+    if (GI < 256)
+        gs_DigitBase[GI] = ListDigitStart + BlockOffset;
+
+    GroupMemoryBarrierWithGroupSync();
+
+    [unroll]
+    for (uint n = 0; n < ELEMENTS_PER_THREAD; ++n)
+    {
+        uint Local = GI * ELEMENTS_PER_THREAD + n;
+        if (Local < ValidCount)
+            StoreElement(gs_DigitBase[Digits[n]] + Local - gs_DigitStart[Digits[n]], Elements[n]);
+    }
+}
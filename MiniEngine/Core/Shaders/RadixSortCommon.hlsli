@@ -0,0 +1,113 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// A least significant digit radix sort takes 8 bits of the key per pass.  Each pass counts the digits of every
+// block of 2048 elements, scans the counts of each digit across the blocks, and scatters every block to the
+// offsets of its digits.  Blocks sort themselves by the digit before scattering, so that the pass is stable.
+//
+
+#define RadixSort_RootSig \
+    "RootFlags(0), " \
+    "RootConstants(b0, num32BitConstants = 3)," \
+    "DescriptorTable(SRV(t0, numDescriptors = 1))," \
+    "DescriptorTable(UAV(u0, numDescriptors = 3))," \
+    "RootConstants(b1, num32BitConstants = 1)"
+
+// Must match RadixSort.cpp
+#define BLOCK_SIZE 2048
+#define MAX_BLOCKS 4096
+#define THREADS_PER_GROUP 512
+#define ELEMENTS_PER_THREAD 4
+
+ByteAddressBuffer g_CounterBuffer : register(t0);
+
+cbuffer CB0 : register(b0)
+{
+    uint DigitShift;    // Bit offset of the pass's digit in its key word
+    uint KeyWord;       // Which word of a 64-bit element holds the digit; 64-bit keys take .x before .y
+    uint DigitFlip;     // 0xff to sort descending
+}
+
+cbuffer CB1 : register(b1)
+{
+    // Offset into counter buffer where this list's item count is stored
+    uint CounterOffset;
+}
+
+// The digit counts of every block, digit by digit, followed by the total of each digit.  The scan replaces the
+// counts with the offset of each block's digits among all of that digit's elements.
+RWByteAddressBuffer g_Histograms : register(u2);
+
+uint HistogramAddress( uint Digit, uint Block )
+{
+    return (Digit * MAX_BLOCKS + Block) * 4;
+}
+
+uint DigitTotalAddress( uint Digit )
+{
+    return (256 * MAX_BLOCKS + Digit) * 4;
+}
+
+uint GetListCount( void )
+{
+    return g_CounterBuffer.Load(CounterOffset);
+}
+
+groupshared uint gs_Scan[2][THREADS_PER_GROUP];
+
+// Returns the sum of the values of the threads before this one, and the sum of all of them in Total
+uint GroupExclusiveScan( uint GI, uint Value, out uint Total )
+{
+    gs_Scan[0][GI] = Value;
+    GroupMemoryBarrierWithGroupSync();
+
+    uint Buf = 0;
+
+    [unroll]
+    for (uint Step = 1; Step < THREADS_PER_GROUP; Step *= 2)
+    {
+        uint Sum = gs_Scan[Buf][GI];
+        if (GI >= Step)
+            Sum += gs_Scan[Buf][GI - Step];
+        gs_Scan[Buf ^ 1][GI] = Sum;
+        Buf ^= 1;
+        GroupMemoryBarrierWithGroupSync();
+    }
+
+    Total = gs_Scan[Buf][THREADS_PER_GROUP - 1];
+    uint Inclusive = gs_Scan[Buf][GI];
+
+    // The next scan overwrites the sums
+    GroupMemoryBarrierWithGroupSync();
+
+    return Inclusive - Value;
+}
+
+#ifdef RADIXSORT_64BIT
+
+typedef uint2 element_t;
+
+RWByteAddressBuffer g_SrcList : register(u0);
+RWByteAddressBuffer g_DstList : register(u1);
+
+element_t LoadElement( uint Index ) { return g_SrcList.Load2(Index * 8); }
+void StoreElement( uint Index, element_t Element ) { g_DstList.Store2(Index * 8, Element); }
+uint GetDigit( element_t Element ) { return ((KeyWord ? Element.y : Element.x) >> DigitShift & 0xff) ^ DigitFlip; }
+
+#else // 32-bit packed key/index pairs
+
+typedef uint element_t;
+
+RWByteAddressBuffer g_SrcList : register(u0);
+RWByteAddressBuffer g_DstList : register(u1);
+
+element_t LoadElement( uint Index ) { return g_SrcList.Load(Index * 4); }
+void StoreElement( uint Index, element_t Element ) { g_DstList.Store(Index * 4, Element); }
+uint GetDigit( element_t Element ) { return (Element >> DigitShift & 0xff) ^ DigitFlip; }
+
+#endif
@@ -30,11 +30,13 @@ cbuffer Constants : register(b0)
     float2 UVOffset0;
     float2 UVOffset1;
     float WA, WB;
+    float2 UVScale;     // The part of the texture holding the image, which is smaller with dynamic resolution
+    float2 UVMax;
 }
 
 float3 GetColor(float2 UV)
 {
-    float3 Color = ColorTex.SampleLevel(BilinearClamp, UV, 0);
+    float3 Color = ColorTex.SampleLevel(BilinearClamp, min(UV, UVMax), 0);
 #ifdef GAMMA_SPACE
     return ApplyDisplayProfile(Color, DISPLAY_PLANE_FORMAT);
 #else
@@ -45,6 +47,7 @@ float3 GetColor(float2 UV)
 [RootSignature(Present_RootSig)]
 float3 main(float4 position : SV_Position, float2 uv : TexCoord0) : SV_Target0
 {
+    uv *= UVScale;
     float3 Color = WB * GetColor(uv) - WA * (
         GetColor(uv + UVOffset0) + GetColor(uv - UVOffset0) +
         GetColor(uv + UVOffset1) + GetColor(uv - UVOffset1));
@@ -0,0 +1,143 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Builds up to 12 mips in one dispatch.  Every group reduces a 64x64 tile of the source through six mips in
+// group shared memory, and leaves its last texel in a buffer.  The last group to finish, which it learns from
+// an atomic counter, reduces those texels through the remaining six mips.  Reads past the source return 0.
+//
+
+#define SinglePassDownsample_RootSig \
+    "RootFlags(0), " \
+    "RootConstants(b0, num32BitConstants = 3), " \
+    "DescriptorTable(SRV(t0, numDescriptors = 1)), " \
+    "DescriptorTable(UAV(u0, numDescriptors = 12)), " \
+    "UAV(u12), " \
+    "UAV(u13)"
+
+#if defined(REDUCE_MIN) || defined(REDUCE_MAX)
+    typedef float value_t;
+#else
+    typedef float4 value_t;
+#endif
+
+cbuffer CSConstants : register(b0)
+{
+    uint2 GroupCount;   // Groups in the dispatch, each of which covers 64x64 source texels
+    uint NumMips;       // Number of OutMips to write: [1, 12]
+};
+
+Texture2D<value_t> Source : register(t0);
+RWTexture2D<value_t> OutMip[12] : register(u0);
+globallycoherent RWStructuredBuffer<value_t> GroupResults : register(u12);  // The sixth mip, one texel per group
+globallycoherent RWByteAddressBuffer GroupCounter : register(u13);         // Reset by the last group
+
+// A 32x32 tile of the latest mip
+groupshared value_t gs_Values[1024];
+groupshared uint gs_IsLastGroup;
+
+float3 ApplySRGBCurve(float3 x)
+{
+    return x < 0.0031308 ? 12.92 * x : 1.13005 * sqrt(abs(x - 0.00228)) - 0.13448 * x + 0.005719;
+}
+
+value_t PackValue( value_t Linear )
+{
+#ifdef CONVERT_TO_SRGB
+    return float4(ApplySRGBCurve(Linear.rgb), Linear.a);
+#else
+    return Linear;
+#endif
+}
+
+value_t Reduce( value_t v0, value_t v1, value_t v2, value_t v3 )
+{
+#if defined(REDUCE_MIN)
+    return min(min(v0, v1), min(v2, v3));
+#elif defined(REDUCE_MAX)
+    return max(max(v0, v1), max(v2, v3));
+#else
+    return 0.25 * (v0 + v1 + v2 + v3);
+#endif
+}
+
+value_t LoadSource( uint2 ST, bool FromGroups )
+{
+    if (FromGroups)
+        return all(ST < GroupCount) ? GroupResults[ST.y * GroupCount.x + ST.x] : 0;
+    else
+        return Source[ST];
+}
+
+// Writes mips FirstMip onward from the 64x64 texels of the level below them in Tile.  The mip count is the same
+// for every thread, so the barriers are reached by the whole group.
+void DownsampleTile( uint2 Tile, uint GI, uint FirstMip, bool FromGroups )
+{
+    // Each thread reduces four 2x2 quads, 16 texels apart so that neighboring threads read neighboring quads
+    [unroll]
+    for (uint i = 0; i < 4; ++i)
+    {
+        uint2 ST = uint2(GI % 16, GI / 16) + uint2(i & 1, i >> 1) * 16;
+        uint2 Src = Tile * 64 + ST * 2;
+        value_t Value = Reduce(LoadSource(Src, FromGroups), LoadSource(Src + uint2(1, 0), FromGroups),
+            LoadSource(Src + uint2(0, 1), FromGroups), LoadSource(Src + uint2(1, 1), FromGroups));
+
+        OutMip[FirstMip][Tile * 32 + ST] = PackValue(Value);
+        gs_Values[ST.y * 32 + ST.x] = Value;
+    }
+
+    for (uint Mip = 1, Size = 16; Mip < 6 && FirstMip + Mip < NumMips; ++Mip, Size /= 2)
+    {
+        GroupMemoryBarrierWithGroupSync();
+
+        uint2 ST = uint2(GI % Size, GI / Size);
+        uint Index = ST.y * 64 + ST.x * 2;
+        value_t Value = 0;
+        if (GI < Size * Size)
+        {
+            Value = Reduce(gs_Values[Index], gs_Values[Index + 1], gs_Values[Index + 32], gs_Values[Index + 33]);
+            OutMip[FirstMip + Mip][Tile * Size + ST] = PackValue(Value);
+        }
+
+        // Other threads may still be reading the texels this one overwrites
+        GroupMemoryBarrierWithGroupSync();
+
+        if (GI < Size * Size)
+            gs_Values[ST.y * 32 + ST.x] = Value;
+    }
+}
+
+[RootSignature(SinglePassDownsample_RootSig)]
+[numthreads( 256, 1, 1 )]
+void main( uint GI : SV_GroupIndex, uint3 Gid : SV_GroupID )
+{
+    DownsampleTile(Gid.xy, GI, 0, false);
+
+    if (NumMips <= 6)
+        return;
+
+    // The first thread wrote the tile's sixth mip texel itself, so it may read it back without a barrier
+    if (GI == 0)
+    {
+        GroupResults[Gid.y * GroupCount.x + Gid.x] = gs_Values[0];
+        DeviceMemoryBarrier();
+
+        uint FinishedGroups;
+        GroupCounter.InterlockedAdd(0, 1, FinishedGroups);
+        gs_IsLastGroup = FinishedGroups == GroupCount.x * GroupCount.y - 1;
+    }
+
+    GroupMemoryBarrierWithGroupSync();
+
+    if (!gs_IsLastGroup)
+        return;
+
+    DownsampleTile(uint2(0, 0), GI, 6, true);
+
+    if (GI == 0)
+        GroupCounter.Store(0, 0);
+}
@@ -18,13 +18,23 @@
 static const uint kLdsPitch = 18;
 static const uint kLdsRows = 10;
 
+// A compressed history keeps R11G11B10 color, which has no alpha, and its confidence in a buffer of its own
+#ifdef COMPRESSED_HISTORY
+RWTexture2D<float3> OutTemporal : register(u0);
+RWTexture2D<float> OutWeight : register(u1);
+#else
 RWTexture2D<float4> OutTemporal : register(u0);
+#endif
 
+// With HALF_RES_VELOCITY, this holds the velocity of the closest pixel of each 2x2 quad
 Texture2D<packed_velocity_t> VelocityBuffer : register(t0);
 Texture2D<float3> InColor : register(t1);
 Texture2D<float4> InTemporal : register(t2);
 Texture2D<float> CurDepth : register(t3);
 Texture2D<float> PreDepth : register(t4);
+#ifdef COMPRESSED_HISTORY
+Texture2D<float> InWeight : register(t5);
+#endif
 
 SamplerState LinearSampler : register(s0);
 SamplerState PointSampler : register(s1);
@@ -41,6 +51,8 @@ cbuffer CB1 : register(b1)
     float TemporalBlendFactor;
     float RcpSpeedLimiter;
     float2 ViewportJitter;
+    float2 HistoryScale;    // Previous render size / current render size, which dynamic resolution changes
+    float2 HistoryUVMax;    // Keeps history fetches inside the previous render size
 }
 
 void StoreRGB(uint ldsIdx, float3 RGB)
@@ -60,6 +72,12 @@ float2 STtoUV(float2 ST)
     return (ST + 0.5) * RcpBufferDim;
 }
 
+// The history was rendered at the previous frame's scale
+float2 HistoryUV(float2 ST)
+{
+    return min((ST + 0.5) * HistoryScale * RcpBufferDim, HistoryUVMax);
+}
+
 float3 ClipColor(float3 Color, float3 BoxMin, float3 BoxMax, float Dilation = 1.0)
 {
     float3 BoxCenter = (BoxMax + BoxMin) * 0.5;
@@ -118,23 +136,35 @@ void ApplyTemporalBlend(uint2 ST, uint ldsIdx, float3 BoxMin, float3 BoxMax)
     float CompareDepth;
 
     // Get the velocity of the closest pixel in the '+' formation
+#ifdef HALF_RES_VELOCITY
+    GetClosestPixel(ldsIdx, CompareDepth);
+    float3 Velocity = UnpackVelocity(VelocityBuffer[ST >> 1]);
+#else
     float3 Velocity = UnpackVelocity(VelocityBuffer[ST + GetClosestPixel(ldsIdx, CompareDepth)]);
+#endif
 
     CompareDepth += Velocity.z;
 
     // The temporal depth is the actual depth of the pixel found at the same reprojected location.
-    float TemporalDepth = MaxOf(PreDepth.Gather(LinearSampler, STtoUV(ST + Velocity.xy + ViewportJitter))) + 1e-3;
+    float TemporalDepth = MaxOf(PreDepth.Gather(LinearSampler, HistoryUV(ST + Velocity.xy + ViewportJitter))) + 1e-3;
 
     // Fast-moving pixels cause motion blur and probably don't need TAA
     float SpeedFactor = saturate(1.0 - length(Velocity.xy) * RcpSpeedLimiter);
 
+#ifdef COMPRESSED_HISTORY
+    // The color is not pre-multiplied, and the neighborhood clip below bounds what a pixel without history
+    // filters into it
+    float3 TemporalColor = InTemporal.SampleLevel(LinearSampler, HistoryUV(ST + Velocity.xy), 0).rgb;
+    float TemporalWeight = InWeight.SampleLevel(LinearSampler, HistoryUV(ST + Velocity.xy), 0);
+#else
     // Fetch temporal color.  Its "confidence" weight is stored in alpha.
-    float4 Temp = InTemporal.SampleLevel(LinearSampler, STtoUV(ST + Velocity.xy), 0);
+    float4 Temp = InTemporal.SampleLevel(LinearSampler, HistoryUV(ST + Velocity.xy), 0);
     float3 TemporalColor = Temp.rgb;
     float TemporalWeight = Temp.w;
 
     // Pixel colors are pre-multiplied by their weight to enable bilinear filtering.  Divide by weight to recover color.
     TemporalColor /= max(TemporalWeight, 1e-6);
+#endif
 
     // Clip the temporal color to the current neighborhood's bounding box.  Increase the size of the bounding box for
     // stationary pixels to avoid rejecting noisy specular highlights.
@@ -151,11 +181,16 @@ void ApplyTemporalBlend(uint2 ST, uint ldsIdx, float3 BoxMin, float3 BoxMax)
     // Update weight
     TemporalWeight = saturate(rcp(2.0 - TemporalWeight));
 
+#ifdef COMPRESSED_HISTORY
+    OutTemporal[ST] = TemporalColor;
+    OutWeight[ST] = TemporalWeight;
+#else
     // Quantize weight to what is representable
     TemporalWeight = f16tof32(f32tof16(TemporalWeight));
 
     // Breaking this up into two buffers means it can be 40 bits instead of 64.
     OutTemporal[ST] = float4(TemporalColor, 1) * TemporalWeight;
+#endif
 }
 
 [RootSignature(Temporal_RootSig)]
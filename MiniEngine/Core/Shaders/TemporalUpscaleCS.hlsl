@@ -0,0 +1,135 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Accumulates jittered samples rendered below the output resolution into a history at the output resolution.
+// Each output pixel takes the render pixel whose sample landed closest to its center this frame, weighted by
+// how close it landed, so that over the jitter sequence every output pixel gathers samples of its own.
+//
+
+#include "TemporalRS.hlsli"
+#include "ShaderUtility.hlsli"
+#include "PixelPacking_Velocity.hlsli"
+
+RWTexture2D<float4> OutTemporal : register(u0);
+
+Texture2D<packed_velocity_t> VelocityBuffer : register(t0);
+Texture2D<float3> InColor : register(t1);
+Texture2D<float4> InTemporal : register(t2);
+Texture2D<float> CurDepth : register(t3);
+Texture2D<float> PreDepth : register(t4);
+
+SamplerState LinearSampler : register(s0);
+
+cbuffer CB1 : register(b1)
+{
+    float2 RcpBufferDim;    // 1 / width, 1 / height
+    float2 RenderScale;     // Render size / output size
+    float2 ViewportJitter;  // The jitter of the previous frame minus this one's
+    float2 CurrentJitter;   // This frame's jitter away from the pixel center, in render pixels
+    float2 HistoryScale;    // Previous render size / current render size, for the previous depth
+    float2 HistoryUVMax;
+    uint2 RenderMax;        // The last render pixel
+    float RcpSpeedLimiter;
+}
+
+// Keeps a pixel from ignoring new samples entirely
+static const float kMaxTemporalWeight = 0.96;
+
+float3 ClipColor(float3 Color, float3 BoxMin, float3 BoxMax, float Dilation = 1.0)
+{
+    float3 BoxCenter = (BoxMax + BoxMin) * 0.5;
+    float3 HalfDim = (BoxMax - BoxMin) * 0.5 * Dilation + 0.001;
+    float3 Displacement = Color - BoxCenter;
+    float3 Units = abs(Displacement / HalfDim);
+    float MaxUnit = max(max(Units.x, Units.y), max(Units.z, 1.0));
+    return BoxCenter + Displacement / MaxUnit;
+}
+
+float MaxOf(float4 Depths) { return max(max(Depths.x, Depths.y), max(Depths.z, Depths.w)); }
+
+uint2 ClampST(int2 ST)
+{
+    return (uint2)clamp(ST, int2(0, 0), (int2)RenderMax);
+}
+
+[RootSignature(Temporal_RootSig)]
+[numthreads(8, 8, 1)]
+void main(uint3 DTid : SV_DispatchThreadID)
+{
+    // The output pixel's center in render pixels.  Render pixel ST sampled the scene at ST + 0.5 - CurrentJitter.
+    float2 RenderPos = (DTid.xy + 0.5) * RenderScale;
+    int2 Nearest = (int2)floor(RenderPos + CurrentJitter);
+    float2 SampleOffset = RenderPos + CurrentJitter - (Nearest + 0.5);
+
+    // Bound the history by the render pixels around the sample, and take the velocity of the closest one in
+    // the '+' formation
+    uint2 CenterST = ClampST(Nearest);
+    float3 CurrentColor = InColor[CenterST];
+    float3 BoxMin = CurrentColor;
+    float3 BoxMax = CurrentColor;
+    float ClosestDepth = CurDepth[CenterST];
+    uint2 ClosestST = CenterST;
+
+    [unroll]
+    for (int y = -1; y <= 1; ++y)
+    {
+        [unroll]
+        for (int x = -1; x <= 1; ++x)
+        {
+            if (x == 0 && y == 0)
+                continue;
+
+            uint2 ST = ClampST(Nearest + int2(x, y));
+            float3 Color = InColor[ST];
+            BoxMin = min(BoxMin, Color);
+            BoxMax = max(BoxMax, Color);
+
+            if (x == 0 || y == 0)
+            {
+                float Depth = CurDepth[ST];
+                if (Depth < ClosestDepth)
+                {
+                    ClosestDepth = Depth;
+                    ClosestST = ST;
+                }
+            }
+        }
+    }
+
+    float3 Velocity = UnpackVelocity(VelocityBuffer[ClosestST]);
+    float CompareDepth = ClosestDepth + Velocity.z;
+
+    // The previous depth was rendered at the previous render size
+    float2 DepthUV = min((CenterST + 0.5 + Velocity.xy + ViewportJitter) * HistoryScale * RcpBufferDim, HistoryUVMax);
+    float TemporalDepth = MaxOf(PreDepth.Gather(LinearSampler, DepthUV)) + 1e-3;
+
+    // Fast-moving pixels cause motion blur and probably don't need TAA
+    float SpeedFactor = saturate(1.0 - length(Velocity.xy) * RcpSpeedLimiter);
+
+    // Velocities are in render pixels, while the history is at the output resolution.  Outside of the screen the
+    // border color has no weight.
+    float2 HistoryUV = (DTid.xy + 0.5 + Velocity.xy / RenderScale) * RcpBufferDim;
+    float4 Temp = InTemporal.SampleLevel(LinearSampler, HistoryUV, 0);
+    float3 TemporalColor = Temp.rgb / max(Temp.w, 1e-6);
+    float TemporalWeight = min(Temp.w, kMaxTemporalWeight);
+
+    TemporalColor = ClipColor(TemporalColor, BoxMin, BoxMax, lerp(1.0, 4.0, SpeedFactor * SpeedFactor));
+    TemporalWeight *= SpeedFactor * step(CompareDepth, TemporalDepth);
+
+    // A sample landing near the center counts as much as a TAA sample, and one at the edge of its render pixel
+    // barely counts.  A pixel with no history takes the sample whatever its weight.
+    float SampleWeight = exp(-2.29 * dot(SampleOffset, SampleOffset));
+    float Blend = TemporalWeight / (TemporalWeight + SampleWeight * (1.0 - TemporalWeight));
+    TemporalColor = ITM(lerp(TM(CurrentColor), TM(TemporalColor), Blend));
+
+    // The confidence grows by as much of a sample as this one counted for
+    TemporalWeight = lerp(TemporalWeight, saturate(rcp(2.0 - TemporalWeight)), SampleWeight);
+    TemporalWeight = f16tof32(f32tof16(TemporalWeight));
+
+    OutTemporal[DTid.xy] = float4(TemporalColor, 1) * TemporalWeight;
+}
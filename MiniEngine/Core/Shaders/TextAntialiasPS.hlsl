@@ -15,29 +15,36 @@
 
 cbuffer cbFontParams : register(b0)
 {
-    float4 Color;
     float2 ShadowOffset;
     float ShadowHardness;
     float ShadowOpacity;
-    float HeightRange;    // The range of the signed distance field.
+    uint MultiChannel;      // RGB hold per-edge distances whose median keeps corners sharp, A the true distance
 }
 
-Texture2D<float> SignedDistanceFieldTex : register( t0 );
+Texture2D<float4> SignedDistanceFieldTex : register( t0 );
 SamplerState LinearSampler : register( s0 );
 
 struct PS_INPUT
 {
     float4 pos : SV_POSITION;
     float2 uv : TEXCOORD0;
+    float4 color : COLOR;
+    float range : TEXCOORD1;    // The range of the signed distance field.
 };
 
-float GetAlpha( float2 uv )
+float GetDistance( float2 uv )
 {
-    return saturate(SignedDistanceFieldTex.Sample(LinearSampler, uv) * HeightRange + 0.5);
+    float4 d = SignedDistanceFieldTex.Sample(LinearSampler, uv);
+    return MultiChannel ? max(min(d.r, d.g), min(max(d.r, d.g), d.b)) : d.r;
+}
+
+float GetAlpha( float2 uv, float range )
+{
+    return saturate(GetDistance(uv) * range + 0.5);
 }
 
 [RootSignature(Text_RootSig)]
 float4 main( PS_INPUT Input ) : SV_Target
 {
-    return float4(Color.rgb, 1) * GetAlpha(Input.uv) * Color.a;
+    return float4(Input.color.rgb, 1) * GetAlpha(Input.uv, Input.range) * Input.color.a;
 }
@@ -15,31 +15,45 @@
 
 cbuffer cbFontParams : register(b0)
 {
-    float4 Color;
     float2 ShadowOffset;
     float ShadowHardness;
     float ShadowOpacity;
-    float HeightRange;    // The range of the signed distance field.
+    uint MultiChannel;      // RGB hold per-edge distances whose median keeps corners sharp, A the true distance
 }
 
-Texture2D<float> SignedDistanceFieldTex : register( t0 );
+Texture2D<float4> SignedDistanceFieldTex : register( t0 );
 SamplerState LinearSampler : register( s0 );
 
 struct PS_INPUT
 {
     float4 pos : SV_POSITION;
     float2 uv : TEXCOORD0;
+    float4 color : COLOR;
+    float range : TEXCOORD1;    // The range of the signed distance field.
 };
 
+float GetDistance( float2 uv )
+{
+    float4 d = SignedDistanceFieldTex.Sample(LinearSampler, uv);
+    return MultiChannel ? max(min(d.r, d.g), min(max(d.r, d.g), d.b)) : d.r;
+}
+
 float GetAlpha( float2 uv, float range )
 {
-    return saturate(SignedDistanceFieldTex.Sample(LinearSampler, uv) * range + 0.5);
+    return saturate(GetDistance(uv) * range + 0.5);
+}
+
+// The soft shadow reads the true distance, which stays rounded around corners
+float GetShadowAlpha( float2 uv, float range )
+{
+    float4 d = SignedDistanceFieldTex.Sample(LinearSampler, uv);
+    return saturate((MultiChannel ? d.a : d.r) * range + 0.5);
 }
 
 [RootSignature(Text_RootSig)]
 float4 main( PS_INPUT Input ) : SV_Target
 {
-    float alpha1 = GetAlpha(Input.uv, HeightRange) * Color.a;
-    float alpha2 = GetAlpha(Input.uv - ShadowOffset, HeightRange * ShadowHardness) * ShadowOpacity * Color.a;
-    return float4( Color.rgb * alpha1, lerp(alpha2, 1, alpha1) );
+    float alpha1 = GetAlpha(Input.uv, Input.range) * Input.color.a;
+    float alpha2 = GetShadowAlpha(Input.uv - ShadowOffset, Input.range * ShadowHardness) * ShadowOpacity * Input.color.a;
+    return float4( Input.color.rgb * alpha1, lerp(alpha2, 1, alpha1) );
 }
@@ -17,7 +17,10 @@
 
 StructuredBuffer<float> Exposure : register( t0 );
 Texture2D<float3> Bloom : register( t1 );
-#if SUPPORT_TYPED_UAV_LOADS
+#if OUTPUT_TO_DISPLAY
+RWTexture2D<float3> DisplayOut : register( u0 );
+Texture2D<float3> SrcColor : register( t2 );
+#elif SUPPORT_TYPED_UAV_LOADS
 RWTexture2D<float3> ColorRW : register( u0 );
 #else
 RWTexture2D<uint> DstColor : register( u0 );
@@ -32,6 +35,12 @@ cbuffer CB0 : register(b0)
     float g_BloomStrength;
 };
 
+cbuffer CB1 : register(b1)
+{
+    float g_Saturation;
+    float g_Contrast;
+};
+
 [RootSignature(PostEffects_RootSig)]
 [numthreads( 8, 8, 1 )]
 void main( uint3 DTid : SV_DispatchThreadID )
@@ -39,7 +48,7 @@ void main( uint3 DTid : SV_DispatchThreadID )
     float2 TexCoord = (DTid.xy + 0.5) * g_RcpBufferDim;
 
     // Load HDR and bloom
-#if SUPPORT_TYPED_UAV_LOADS
+#if SUPPORT_TYPED_UAV_LOADS && !OUTPUT_TO_DISPLAY
     float3 hdrColor = ColorRW[DTid.xy];
 #else
     float3 hdrColor = SrcColor[DTid.xy];
@@ -48,6 +57,9 @@ void main( uint3 DTid : SV_DispatchThreadID )
     hdrColor += g_BloomStrength * Bloom.SampleLevel(LinearSampler, TexCoord, 0);
     hdrColor *= Exposure[0];
 
+    // Grading here costs no pass or buffer of its own
+    hdrColor = ColorGrade(hdrColor, g_Saturation, g_Contrast);
+
 #if ENABLE_HDR_DISPLAY_MAPPING
 
     // Write the HDR color as-is and defer display mapping until we composite with UI
@@ -63,12 +75,17 @@ void main( uint3 DTid : SV_DispatchThreadID )
     // Tone map to SDR
     float3 sdrColor = TM_Stanard(hdrColor);
 
+#if OUTPUT_TO_DISPLAY
+    // Present has nothing left to do but composite the overlay, and nothing reads the luma
+    DisplayOut[DTid.xy] = ApplyDisplayProfile(sdrColor, DISPLAY_PLANE_FORMAT);
+#else
 #if SUPPORT_TYPED_UAV_LOADS
     ColorRW[DTid.xy] = sdrColor;
 #else
     DstColor[DTid.xy] = Pack_R11G11B10_FLOAT(sdrColor);
 #endif
     OutLuma[DTid.xy] = RGBToLogLuminance(sdrColor);
+#endif
 
 #endif
 }
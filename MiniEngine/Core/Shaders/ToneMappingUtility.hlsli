@@ -127,4 +127,16 @@ float3 InverseToneMapACES( float3 sdr )
     return 0.5 * (D * sdr - sqrt(((D*D - 4*C*E) * sdr + 4*A*E-2*B*D) * sdr + B*B) - B) / (A - C * sdr);
 }
 
+//
+// Color grading
+//
+
+// A scene referred grade of the exposed color, ahead of tone mapping or display mapping.  Contrast pivots
+// around middle grey, so it spreads the tones without brightening or darkening the image as a whole.
+float3 ColorGrade( float3 hdr, float Saturation, float Contrast )
+{
+    hdr = max(lerp(RGBToLuminance(hdr), hdr, Saturation), 0.0);
+    return 0.18 * pow(hdr / 0.18, Contrast);
+}
+
 #endif // __TONE_MAPPING_UTILITY_HLSLI__
@@ -0,0 +1,76 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "pch.h"
+#include "ShadowAtlasAllocator.h"
+
+void ShadowAtlasAllocator::Reset( uint32_t AtlasSize, uint32_t MinTileSize )
+{
+    ASSERT(Math::IsPowerOfTwo(AtlasSize) && Math::IsPowerOfTwo(MinTileSize) && MinTileSize <= AtlasSize);
+
+    m_AtlasSize = AtlasSize;
+    m_NumLevels = 1;
+    while ((AtlasSize >> m_NumLevels) >= MinTileSize && m_NumLevels < kMaxLevels)
+        ++m_NumLevels;
+
+    m_RootAllocated = false;
+    for (uint32_t i = 0; i < kMaxLevels; ++i)
+        m_FreeTiles[i].clear();
+}
+
+bool ShadowAtlasAllocator::Allocate( uint32_t TileSize, Tile& Result )
+{
+    ASSERT(Math::IsPowerOfTwo(TileSize));
+
+    if (TileSize > m_AtlasSize || TileSize < GetMinTileSize())
+        return false;
+
+    uint32_t Level = 0;
+    while ((m_AtlasSize >> Level) > TileSize)
+        ++Level;
+
+    return AllocateLevel(Level, Result);
+}
+
+bool ShadowAtlasAllocator::AllocateLevel( uint32_t Level, Tile& Result )
+{
+    std::vector<Tile>& FreeList = m_FreeTiles[Level];
+
+    if (!FreeList.empty())
+    {
+        Result = FreeList.back();
+        FreeList.pop_back();
+        return true;
+    }
+
+    if (Level == 0)
+    {
+        if (m_RootAllocated)
+            return false;
+
+        m_RootAllocated = true;
+        Result.X = Result.Y = 0;
+        Result.Size = m_AtlasSize;
+        return true;
+    }
+
+    // Split a tile from the level above into four.  The siblings are pushed in reverse so that
+    // tiles are handed out in Z order.
+    Tile Parent;
+    if (!AllocateLevel(Level - 1, Parent))
+        return false;
+
+    const uint32_t HalfSize = Parent.Size / 2;
+    FreeList.push_back({ Parent.X + HalfSize, Parent.Y + HalfSize, HalfSize });
+    FreeList.push_back({ Parent.X, Parent.Y + HalfSize, HalfSize });
+    FreeList.push_back({ Parent.X + HalfSize, Parent.Y, HalfSize });
+
+    Result = { Parent.X, Parent.Y, HalfSize };
+    return true;
+}
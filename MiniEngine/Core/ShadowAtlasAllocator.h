@@ -0,0 +1,53 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Quadtree allocator that packs power-of-two square tiles into a square shadow map atlas.  It is
+// rebuilt whenever the requested tile sizes change.  Allocating in order of decreasing size packs
+// tightly, and the same sequence of requests always produces the same layout, so callers can tell
+// which tiles moved by comparing with the previous layout.
+class ShadowAtlasAllocator
+{
+public:
+
+    struct Tile
+    {
+        uint32_t X, Y, Size;
+
+        bool operator==( const Tile& rhs ) const { return X == rhs.X && Y == rhs.Y && Size == rhs.Size; }
+        bool operator!=( const Tile& rhs ) const { return !(*this == rhs); }
+    };
+
+    ShadowAtlasAllocator() : m_AtlasSize(0), m_NumLevels(0), m_RootAllocated(false) {}
+
+    // Free every tile.  Both sizes must be powers of two.
+    void Reset( uint32_t AtlasSize, uint32_t MinTileSize );
+
+    // Returns false if no tile of the requested size is free
+    bool Allocate( uint32_t TileSize, Tile& Result );
+
+    uint32_t GetAtlasSize() const { return m_AtlasSize; }
+    uint32_t GetMinTileSize() const { return m_AtlasSize >> (m_NumLevels - 1); }
+    uint32_t GetMaxTileSize() const { return m_AtlasSize; }
+
+private:
+
+    enum { kMaxLevels = 16 };
+
+    bool AllocateLevel( uint32_t Level, Tile& Result );
+
+    uint32_t m_AtlasSize;
+    uint32_t m_NumLevels;
+    bool m_RootAllocated;
+    std::vector<Tile> m_FreeTiles[kMaxLevels];
+};
@@ -15,11 +15,10 @@
 #include "ShadowBuffer.h"
 #include "EsramAllocator.h"
 #include "CommandContext.h"
+#include "GpuMemoryTracker.h"
 
-void ShadowBuffer::Create( const std::wstring& Name, uint32_t Width, uint32_t Height, D3D12_GPU_VIRTUAL_ADDRESS VidMemPtr )
+void ShadowBuffer::InitViewportAndScissor( uint32_t Width, uint32_t Height )
 {
-    DepthBuffer::Create( Name, Width, Height, DXGI_FORMAT_D16_UNORM, VidMemPtr );
-
     m_Viewport.TopLeftX = 0.0f;
     m_Viewport.TopLeftY = 0.0f;
     m_Viewport.Width = (float)Width;
@@ -34,32 +33,70 @@ void ShadowBuffer::Create( const std::wstring& Name, uint32_t Width, uint32_t He
     m_Scissor.bottom = (LONG)Height - 2;
 }
 
-void ShadowBuffer::Create( const std::wstring& Name, uint32_t Width, uint32_t Height, EsramAllocator& Allocator )
+void ShadowBuffer::Create( const std::wstring& Name, uint32_t Width, uint32_t Height, DXGI_FORMAT Format, D3D12_GPU_VIRTUAL_ADDRESS VidMemPtr )
 {
-    DepthBuffer::Create( Name, Width, Height, DXGI_FORMAT_D16_UNORM, Allocator );
+    DepthBuffer::Create( Name, Width, Height, Format, VidMemPtr );
+    GpuMemoryTracker::TrackResource(m_pResource.Get(), GpuMemoryTracker::kShadowMaps);
+    InitViewportAndScissor( Width, Height );
+}
 
-    m_Viewport.TopLeftX = 0.0f;
-    m_Viewport.TopLeftY = 0.0f;
-    m_Viewport.Width = (float)Width;
-    m_Viewport.Height = (float)Height;
-    m_Viewport.MinDepth = 0.0f;
-    m_Viewport.MaxDepth = 1.0f;
+void ShadowBuffer::Create( const std::wstring& Name, uint32_t Width, uint32_t Height, DXGI_FORMAT Format, EsramAllocator& Allocator )
+{
+    DepthBuffer::Create( Name, Width, Height, Format, Allocator );
+    GpuMemoryTracker::TrackResource(m_pResource.Get(), GpuMemoryTracker::kShadowMaps);
+    InitViewportAndScissor( Width, Height );
+}
 
-    // Prevent drawing to the boundary pixels so that we don't have to worry about shadows stretching
-    m_Scissor.left = 1;
-    m_Scissor.top = 1;
-    m_Scissor.right = (LONG)Width - 2;
-    m_Scissor.bottom = (LONG)Height - 2;
+void ShadowBuffer::CreateArray( const std::wstring& Name, uint32_t Width, uint32_t Height, uint32_t ArrayCount, DXGI_FORMAT Format, D3D12_GPU_VIRTUAL_ADDRESS VidMemPtr )
+{
+    DepthBuffer::CreateArray( Name, Width, Height, ArrayCount, Format, VidMemPtr );
+    GpuMemoryTracker::TrackResource(m_pResource.Get(), GpuMemoryTracker::kShadowMaps);
+    InitViewportAndScissor( Width, Height );
 }
 
-void ShadowBuffer::BeginRendering( GraphicsContext& Context )
+void ShadowBuffer::CreateReserved( const std::wstring& Name, uint32_t Width, uint32_t Height, DXGI_FORMAT Format )
+{
+    DepthBuffer::CreateReserved( Name, Width, Height, Format );
+    InitViewportAndScissor( Width, Height );
+}
+
+uint32_t ShadowBuffer::GetDepthPrecision( void ) const
+{
+    switch (m_Format)
+    {
+    case DXGI_FORMAT_D16_UNORM:
+        return 16;
+
+    // A float's mantissa in [0.5, 1) has the same spacing as 24-bit fixed point.  With reversed Z
+    // that is the range nearest the light; precision only improves farther away.
+    case DXGI_FORMAT_D32_FLOAT:
+    case DXGI_FORMAT_D24_UNORM_S8_UINT:
+    default:
+        return 24;
+    }
+}
+
+void ShadowBuffer::BeginRendering( GraphicsContext& Context, bool ClearDepth )
 {
     Context.TransitionResource(*this, D3D12_RESOURCE_STATE_DEPTH_WRITE, true);
-    Context.ClearDepth(*this);
+    if (ClearDepth)
+        Context.ClearDepth(*this);
+    Context.SetDepthStencilTarget(GetDSV());
+    Context.SetViewportAndScissor(m_Viewport, m_Scissor);
+}
+
+void ShadowBuffer::SetRenderTarget( GraphicsContext& Context )
+{
     Context.SetDepthStencilTarget(GetDSV());
     Context.SetViewportAndScissor(m_Viewport, m_Scissor);
 }
 
+void ShadowBuffer::SetRenderSlice( GraphicsContext& Context, uint32_t Slice )
+{
+    Context.SetDepthStencilTarget(GetSliceDSV(Slice));
+    Context.SetViewportAndScissor(m_Viewport, m_Scissor);
+}
+
 void ShadowBuffer::EndRendering( GraphicsContext& Context )
 {
     Context.TransitionResource(*this, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
@@ -23,17 +23,41 @@ class ShadowBuffer : public DepthBuffer
 {
 public:
     ShadowBuffer() {}
-        
-    void Create( const std::wstring& Name, uint32_t Width, uint32_t Height,
+
+    // D16_UNORM halves the bandwidth of D32_FLOAT and is enough for short depth ranges such as near
+    // cascades.  Either format is rendered with reversed Z, i.e. 1.0 is nearest to the light.
+    void Create( const std::wstring& Name, uint32_t Width, uint32_t Height, DXGI_FORMAT Format = DXGI_FORMAT_D16_UNORM,
         D3D12_GPU_VIRTUAL_ADDRESS VidMemPtr = D3D12_GPU_VIRTUAL_ADDRESS_UNKNOWN );
-    void Create( const std::wstring& Name, uint32_t Width, uint32_t Height, EsramAllocator& Allocator );
+    void Create( const std::wstring& Name, uint32_t Width, uint32_t Height, DXGI_FORMAT Format, EsramAllocator& Allocator );
+
+    // Create an array of shadow maps (e.g. one slice per cascade) sampled as a Texture2DArray
+    void CreateArray( const std::wstring& Name, uint32_t Width, uint32_t Height, uint32_t ArrayCount,
+        DXGI_FORMAT Format = DXGI_FORMAT_D16_UNORM, D3D12_GPU_VIRTUAL_ADDRESS VidMemPtr = D3D12_GPU_VIRTUAL_ADDRESS_UNKNOWN );
+
+    // Create a shadow map backed by a reserved resource whose tiles are mapped on demand
+    void CreateReserved( const std::wstring& Name, uint32_t Width, uint32_t Height, DXGI_FORMAT Format = DXGI_FORMAT_D16_UNORM );
 
     D3D12_CPU_DESCRIPTOR_HANDLE GetSRV() const { return GetDepthSRV(); }
 
-    void BeginRendering( GraphicsContext& context );
+    // Bits of depth precision near the light, which is what ShadowCamera::UpdateMatrix() quantizes to
+    uint32_t GetDepthPrecision() const;
+
+    // Binds the whole buffer as the depth target.  Every slice is cleared unless the caller wants to
+    // render on top of existing contents (e.g. dynamic casters over a copy of cached static casters.)
+    void BeginRendering( GraphicsContext& context, bool ClearDepth = true );
+
+    // Bind a single array slice as the depth target.  Call between BeginRendering() and EndRendering().
+    void SetRenderSlice( GraphicsContext& context, uint32_t Slice );
+
+    // Bind the whole buffer on another context without a transition, e.g. one recorded on a worker thread.
+    // Call between BeginRendering() and EndRendering() on the main context.
+    void SetRenderTarget( GraphicsContext& context );
+
     void EndRendering( GraphicsContext& context );
 
 private:
+    void InitViewportAndScissor( uint32_t Width, uint32_t Height );
+
     D3D12_VIEWPORT m_Viewport;
     D3D12_RECT m_Scissor;
 };
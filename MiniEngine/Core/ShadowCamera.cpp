@@ -33,16 +33,26 @@ void GameCore::ShadowCamera::UpdateMatrix(
     // Transform to view space
     ShadowCenter = ~GetRotation() * ShadowCenter;
     // Scale to texel units, truncate fractional part, and scale back to world units
-    ShadowCenter = Floor( ShadowCenter * QuantizeScale ) / QuantizeScale;
+    ShadowCenter = Floor( ShadowCenter * QuantizeScale );
+    m_TexelCenterX = (int32_t)(float)ShadowCenter.GetX();
+    m_TexelCenterY = (int32_t)(float)ShadowCenter.GetY();
+    ShadowCenter = ShadowCenter / QuantizeScale;
     // Transform back into world space
     ShadowCenter = GetRotation() * ShadowCenter;
 
     SetPosition( ShadowCenter );
 
+    // The camera sits on the far bounding plane looking away from the light, so casters map to depth
+    // in [0, 1] with 1 nearest the light.  This reversed Z matches the GREATER_EQUAL depth test and
+    // shadow comparison, and lets D32_FLOAT spend its finest precision away from the light.
     SetProjMatrix( Matrix4::MakeScale(Vector3(2.0f, 2.0f, 1.0f) * RcpDimensions) );
 
     Update();
 
+    const Matrix4 PrevShadowMatrix = m_ShadowMatrix;
+
     // Transform from clip space to texture space
     m_ShadowMatrix =  Matrix4( AffineTransform( Matrix3::MakeScale( 0.5f, -0.5f, 1.0f ), Vector3(0.5f, 0.5f, 0.0f) ) ) * m_ViewProjMatrix;
+
+    m_MatrixChanged = memcmp(&PrevShadowMatrix, &m_ShadowMatrix, sizeof(Matrix4)) != 0;
 }
@@ -23,7 +23,7 @@ namespace GameCore
     {
     public:
 
-        ShadowCamera() {}
+        ShadowCamera() : m_ShadowMatrix(kZero), m_MatrixChanged(true), m_TexelCenterX(0), m_TexelCenterY(0) {}
 
         void UpdateMatrix( 
             Vector3 LightDirection,        // Direction parallel to light, in direction of travel
@@ -31,15 +31,27 @@ namespace GameCore
             Vector3 ShadowBounds,        // Width, height, and depth in world space represented by the shadow buffer
             uint32_t BufferWidth,        // Shadow buffer width
             uint32_t BufferHeight,        // Shadow buffer height--usually same as width
-            uint32_t BufferPrecision    // Bit depth of shadow buffer--usually 16 or 24
+            uint32_t BufferPrecision    // Bit depth of shadow buffer--see ShadowBuffer::GetDepthPrecision()
             );
 
         // Used to transform world space to texture space for shadow sampling
         const Matrix4& GetShadowMatrix() const { return m_ShadowMatrix; }
 
+        // True if the last UpdateMatrix() produced a different projection than the one before it.
+        // Because the center is snapped to texels, small light movements often leave it unchanged.
+        bool HasMatrixChanged() const { return m_MatrixChanged; }
+
+        // The snapped center in whole texels along the light's right and up axes.  Between two updates with
+        // the same bounds, light and buffer size, the difference is how far the projection slid.
+        int32_t GetTexelCenterX() const { return m_TexelCenterX; }
+        int32_t GetTexelCenterY() const { return m_TexelCenterY; }
+
     private:
 
         Matrix4 m_ShadowMatrix;
+        bool m_MatrixChanged;
+        int32_t m_TexelCenterX;
+        int32_t m_TexelCenterY;
     };
 
 }
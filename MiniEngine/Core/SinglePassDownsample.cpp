@@ -0,0 +1,93 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "pch.h"
+#include "SinglePassDownsample.h"
+#include "GraphicsCore.h"
+#include "CommandContext.h"
+#include "GpuBuffer.h"
+
+#include "CompiledShaders/SinglePassDownsampleLinearCS.h"
+#include "CompiledShaders/SinglePassDownsampleGammaCS.h"
+#include "CompiledShaders/SinglePassDownsampleMinCS.h"
+#include "CompiledShaders/SinglePassDownsampleMaxCS.h"
+
+using namespace Graphics;
+
+namespace SinglePassDownsample
+{
+    // Each group covers 64x64 source texels, and the last group reduces one texel of each through six more mips
+    const uint32_t kTileSize = 64;
+    const uint32_t kMaxGroups = kMaxSourceSize / kTileSize;
+
+    RootSignature s_RootSignature;
+    ComputePSO s_DownsampleCS[4];
+
+    StructuredBuffer s_GroupResults;
+    ByteAddressBuffer s_GroupCounter;
+}
+
+void SinglePassDownsample::Initialize( void )
+{
+    s_RootSignature.Reset(5, 0);
+    s_RootSignature[0].InitAsConstants(0, 3);
+    s_RootSignature[1].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 0, 1);
+    s_RootSignature[2].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 0, kMaxMips);
+    s_RootSignature[3].InitAsBufferUAV(12);
+    s_RootSignature[4].InitAsBufferUAV(13);
+    s_RootSignature.Finalize(L"Single Pass Downsample");
+
+#define CreatePSO( ObjName, ShaderByteCode ) \
+    ObjName.SetRootSignature(s_RootSignature); \
+    ObjName.SetComputeShader(ShaderByteCode, sizeof(ShaderByteCode) ); \
+    ObjName.Finalize();
+
+    CreatePSO(s_DownsampleCS[kAverage], g_pSinglePassDownsampleLinearCS);
+    CreatePSO(s_DownsampleCS[kAverageGamma], g_pSinglePassDownsampleGammaCS);
+    CreatePSO(s_DownsampleCS[kMinimum], g_pSinglePassDownsampleMinCS);
+    CreatePSO(s_DownsampleCS[kMaximum], g_pSinglePassDownsampleMaxCS);
+
+#undef CreatePSO
+
+    // The counter starts at 0, and the last group of each dispatch puts it back
+    const uint32_t Zero = 0;
+    s_GroupResults.Create(L"Single Pass Downsample Group Results", kMaxGroups * kMaxGroups, 4 * sizeof(float));
+    s_GroupCounter.Create(L"Single Pass Downsample Counter", 1, sizeof(uint32_t), &Zero);
+}
+
+void SinglePassDownsample::Shutdown( void )
+{
+    s_GroupResults.Destroy();
+    s_GroupCounter.Destroy();
+}
+
+void SinglePassDownsample::Downsample( ComputeContext& Context, ReduceOp Op, D3D12_CPU_DESCRIPTOR_HANDLE Source,
+    uint32_t SrcWidth, uint32_t SrcHeight, const D3D12_CPU_DESCRIPTOR_HANDLE* DestMips, uint32_t NumMips )
+{
+    ASSERT(NumMips > 0 && NumMips <= kMaxMips);
+    ASSERT(SrcWidth <= kMaxSourceSize && SrcHeight <= kMaxSourceSize, "The last group reduces at most 64x64 tiles");
+
+    const uint32_t GroupsX = Math::DivideByMultiple(SrcWidth, kTileSize);
+    const uint32_t GroupsY = Math::DivideByMultiple(SrcHeight, kTileSize);
+
+    // The last group of the previous dispatch may still be reading the results and resetting the counter
+    Context.TransitionResource(s_GroupResults, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    Context.TransitionResource(s_GroupCounter, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    Context.InsertUAVBarrier(s_GroupResults);
+    Context.InsertUAVBarrier(s_GroupCounter, true);
+
+    Context.SetRootSignature(s_RootSignature);
+    Context.SetPipelineState(s_DownsampleCS[Op]);
+    Context.SetConstants(0, GroupsX, GroupsY, NumMips);
+    Context.SetDynamicDescriptor(1, 0, Source);
+    Context.SetDynamicDescriptors(2, 0, NumMips, DestMips);
+    Context.SetBufferUAV(3, s_GroupResults);
+    Context.SetBufferUAV(4, s_GroupCounter);
+    Context.Dispatch(GroupsX, GroupsY, 1);
+}
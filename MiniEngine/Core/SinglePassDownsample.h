@@ -0,0 +1,38 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#pragma once
+
+#include "pch.h"
+
+class ComputeContext;
+
+// Builds a chain of up to 12 mips with a single dispatch, so that the levels need no barriers between them.  The
+// groups share an atomic counter and a buffer of their results, so dispatches must not overlap on two queues.
+namespace SinglePassDownsample
+{
+    enum { kMaxMips = 12, kMaxSourceSize = 4096 };
+
+    enum ReduceOp
+    {
+        kAverage,       // Box filter of float4 texels
+        kAverageGamma,  // Box filter of linear texels written to the UNORM view of an sRGB texture
+        kMinimum,       // Smallest of single channel texels, such as reversed depth
+        kMaximum,       // Largest of single channel texels
+    };
+
+    void Initialize( void );
+    void Shutdown( void );
+
+    // Writes each of the UAVs of DestMips, in order, with half the resolution of the one before, the first being
+    // half of the SrcWidth by SrcHeight texels of the SRV Source.  Texels past the source read 0, so sizes that
+    // are not powers of two skew the average.  The caller transitions the resources.
+    void Downsample( ComputeContext& Context, ReduceOp Op, D3D12_CPU_DESCRIPTOR_HANDLE Source,
+        uint32_t SrcWidth, uint32_t SrcHeight, const D3D12_CPU_DESCRIPTOR_HANDLE* DestMips, uint32_t NumMips );
+}
@@ -0,0 +1,176 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "pch.h"
+#include "StartupProfile.h"
+#include "EngineProfiling.h"
+#include "JobSystem.h"
+#include "AssetIO.h"
+#include <atomic>
+#include <climits>
+#include <fstream>
+
+using namespace std;
+
+namespace StartupProfile
+{
+    // JSON names, and trace names, which the capture keeps pointers to
+    const char* kCategoryNames[kNumCategories] =
+    {
+        "Device creation", "Pipeline library load", "Swap chain creation", "Graphics initialization",
+        "Subsystem initialization", "Application startup", "Root signature creation", "Pipeline compile",
+        "Pipeline cache load", "Model read", "Model parse", "Model upload", "Texture read", "Texture decompress",
+        "Texture decode", "Texture upload", "Residency"
+    };
+    const wchar_t* kTraceNames[kNumCategories] =
+    {
+        L"Device creation", L"Pipeline library load", L"Swap chain creation", L"Graphics initialization",
+        L"Subsystem initialization", L"Application startup", L"Root signature creation", L"Pipeline compile",
+        L"Pipeline cache load", L"Model read", L"Model parse", L"Model upload", L"Texture read", L"Texture decompress",
+        L"Texture decode", L"Texture upload", L"Residency"
+    };
+
+    struct CategoryStats
+    {
+        atomic<uint32_t> Count;
+        atomic<int64_t> Ticks;
+        atomic<uint64_t> Bytes;
+        atomic<int64_t> FirstTick;
+        atomic<int64_t> LastTick;
+    };
+
+    CategoryStats s_Stats[kNumCategories];
+    atomic<bool> s_Recording(false);
+    int64_t s_LaunchTick = 0;
+    wstring s_ReportFile;
+
+    void WriteReport( void );
+}
+
+using namespace StartupProfile;
+
+void StartupProfile::Initialize( void )
+{
+    s_LaunchTick = SystemTime::GetCurrentTick();
+
+    for (CategoryStats& Stats : s_Stats)
+    {
+        Stats.Count = 0;
+        Stats.Ticks = 0;
+        Stats.Bytes = 0;
+        Stats.FirstTick = LLONG_MAX;
+        Stats.LastTick = 0;
+    }
+
+#if WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_DESKTOP)
+    const wchar_t* Arg = wcsstr(GetCommandLineW(), L"-startupreport");
+    if (Arg != nullptr)
+    {
+        // The report file is the next argument, unless that is another option
+        Arg += wcslen(L"-startupreport");
+        while (*Arg == L' ')
+            ++Arg;
+        if (*Arg == L'"')
+        {
+            for (++Arg; *Arg != L'\0' && *Arg != L'"'; ++Arg)
+                s_ReportFile += *Arg;
+        }
+        else if (*Arg != L'-')
+        {
+            for (; *Arg != L'\0' && *Arg != L' '; ++Arg)
+                s_ReportFile += *Arg;
+        }
+        if (s_ReportFile.empty())
+            s_ReportFile = L"StartupReport.json";
+    }
+
+    s_Recording = !s_ReportFile.empty() || wcsstr(GetCommandLineW(), L"-ProfileCapture") != nullptr;
+#endif
+}
+
+int64_t StartupProfile::GetLaunchTick( void )
+{
+    return s_LaunchTick;
+}
+
+bool StartupProfile::IsRecording( void )
+{
+    return s_Recording.load(memory_order_relaxed);
+}
+
+void StartupProfile::Record( Category Type, int64_t StartTick, int64_t EndTick, uint64_t Bytes )
+{
+    if (!IsRecording())
+        return;
+
+    CategoryStats& Stats = s_Stats[Type];
+    Stats.Count.fetch_add(1, memory_order_relaxed);
+    Stats.Ticks.fetch_add(EndTick - StartTick, memory_order_relaxed);
+    Stats.Bytes.fetch_add(Bytes, memory_order_relaxed);
+
+    int64_t First = Stats.FirstTick.load(memory_order_relaxed);
+    while (StartTick < First && !Stats.FirstTick.compare_exchange_weak(First, StartTick, memory_order_relaxed))
+        ;
+    int64_t Last = Stats.LastTick.load(memory_order_relaxed);
+    while (EndTick > Last && !Stats.LastTick.compare_exchange_weak(Last, EndTick, memory_order_relaxed))
+        ;
+
+    EngineProfiling::RecordCpuEvent(kTraceNames[Type], StartTick, EndTick);
+}
+
+void StartupProfile::FirstFramePresented( void )
+{
+    if (!IsRecording())
+        return;
+
+    // Work that is still in flight, such as pipeline compiles for later frames, is left out
+    s_Recording = false;
+
+    if (!s_ReportFile.empty())
+        WriteReport();
+}
+
+void StartupProfile::WriteReport( void )
+{
+    ofstream File(s_ReportFile, ios::out);
+    if (!File)
+    {
+        Utility::Printf(L"Unable to write %s\n", s_ReportFile.c_str());
+        return;
+    }
+
+    const int64_t NowTick = SystemTime::GetCurrentTick();
+    const AssetIO::Stats IOStats = AssetIO::GetStats();
+
+    File.precision(3);
+    File << fixed << "{\n  \"launch_to_first_frame_ms\": " << SystemTime::TicksToMillisecs(NowTick - s_LaunchTick) <<
+        ",\n  \"worker_threads\": " << JobSystem::GetWorkerCount() << ",\n  \"categories\": [";
+
+    // Times are in milliseconds from launch
+    for (uint32_t c = 0; c < kNumCategories; ++c)
+    {
+        const CategoryStats& Stats = s_Stats[c];
+        const uint32_t Count = Stats.Count.load();
+        File << (c == 0 ? "\n" : ",\n") << "    {\n      \"name\": \"" << kCategoryNames[c] << "\",\n      \"count\": " << Count <<
+            ",\n      \"total_ms\": " << SystemTime::TicksToMillisecs(Stats.Ticks.load()) <<
+            ",\n      \"bytes\": " << Stats.Bytes.load();
+        if (Count > 0)
+        {
+            File << ",\n      \"first_start_ms\": " << SystemTime::TicksToMillisecs(Stats.FirstTick.load() - s_LaunchTick) <<
+                ",\n      \"last_end_ms\": " << SystemTime::TicksToMillisecs(Stats.LastTick.load() - s_LaunchTick);
+        }
+        File << "\n    }";
+    }
+
+    File << "\n  ],\n  \"asset_io\": {\n    \"files_read\": " << IOStats.FilesRead << ",\n    \"bytes_read\": " << IOStats.BytesRead <<
+        ",\n    \"bytes_uploaded\": " << IOStats.BytesUploaded << ",\n    \"busy_ms\": " << IOStats.BusySeconds * 1000.0 <<
+        "\n  }\n}\n";
+
+    Utility::Printf(L"Wrote the startup report to %s\n", s_ReportFile.c_str());
+}
@@ -0,0 +1,85 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Where the time from launch to the first presented frame goes.  The engine records spans of startup work by
+// category, from any thread:  device creation, pipeline compiles and cache loads, model and texture reads,
+// decompression, decoding and uploads, and residency work.  With -startupreport [Report.json] on the command
+// line, each category's count, total time, bytes and the window from its first span to its last are written
+// once the first frame is presented, along with the asset I/O totals, and recording stops.
+//
+// Totals add up the spans of every thread, so for work done in parallel they can exceed the window.  When
+// -ProfileCapture is also given, the spans recorded after the capture starts are in the Chrome trace as well.
+//
+
+#pragma once
+
+#include "SystemTime.h"
+#include <cstdint>
+
+namespace StartupProfile
+{
+    enum Category
+    {
+        kDeviceCreation,
+        kPipelineLibraryLoad,
+        kSwapChainCreation,
+        kGraphicsInitialization,
+        kSubsystemInitialization,
+        kApplicationStartup,
+        kRootSignatureCreation,
+        kPipelineCompile,
+        kPipelineCacheLoad,
+        kModelRead,
+        kModelParse,
+        kModelUpload,
+        kTextureRead,
+        kTextureDecompress,
+        kTextureDecode,
+        kTextureUpload,
+        kResidency,
+        kNumCategories
+    };
+
+    // Starts the clock and checks the command line.  Called by GameCore first thing at launch.
+    void Initialize( void );
+
+    int64_t GetLaunchTick( void );
+
+    // True until the first frame is presented when a report or a capture was asked for
+    bool IsRecording( void );
+
+    // Adds a span of work to its category.  May be called from any thread.
+    void Record( Category Type, int64_t StartTick, int64_t EndTick, uint64_t Bytes = 0 );
+
+    // Writes the report and stops recording.  Called by GameCore after the first Present().
+    void FirstFramePresented( void );
+
+    // Records the span of its lifetime
+    class ScopedSpan
+    {
+    public:
+        ScopedSpan( Category Type, uint64_t Bytes = 0 ) : m_Category(Type), m_Bytes(Bytes),
+            m_StartTick(IsRecording() ? SystemTime::GetCurrentTick() : 0) {}
+        ~ScopedSpan()
+        {
+            if (m_StartTick != 0)
+                Record(m_Category, m_StartTick, SystemTime::GetCurrentTick(), m_Bytes);
+        }
+
+        void AddBytes( uint64_t Bytes ) { m_Bytes += Bytes; }
+
+    private:
+        ScopedSpan( const ScopedSpan& ) = delete;
+        ScopedSpan& operator=( const ScopedSpan& ) = delete;
+
+        Category m_Category;
+        uint64_t m_Bytes;
+        int64_t m_StartTick;
+    };
+
+} // namespace StartupProfile
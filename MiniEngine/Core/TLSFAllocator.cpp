@@ -0,0 +1,513 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "pch.h"
+#include "TLSFAllocator.h"
+#include "GraphicsCore.h"
+#include "CommandListManager.h"
+#include "CommandContext.h"
+
+using namespace Graphics;
+using namespace std;
+
+namespace
+{
+    inline uint32_t HighestBit(uint64_t value)
+    {
+        unsigned long bit;
+        _BitScanReverse64(&bit, value);
+        return bit;
+    }
+
+    inline uint32_t LowestBit(uint64_t value)
+    {
+        unsigned long bit;
+        _BitScanForward64(&bit, value);
+        return bit;
+    }
+}
+
+TLSFAllocator::TLSFAllocator(kBuddyAllocationStrategy allocationStrategy, D3D12_HEAP_TYPE heapType, size_t maxBlockSize, size_t minBlockSize, size_t baseOffset)
+    : m_allocationStrategy(allocationStrategy)
+    , m_heapType(heapType)
+    , m_baseOffset(baseOffset)
+    , m_maxBlockSize(maxBlockSize)
+    , m_minBlockSize(minBlockSize)
+    , m_pBackingHeap(nullptr)
+    , m_StagingFence(0)
+#if defined(PROFILE) || defined(_DEBUG)
+    , m_SpaceUsed(0)
+    , m_InternalFragmentation(0)
+#endif
+{
+    ASSERT(Math::IsDivisible(maxBlockSize, m_minBlockSize));
+
+    Reset();
+}
+
+void TLSFAllocator::Initialize()
+{
+    if (m_allocationStrategy == kBuddyAllocationStrategy::kPlacedResourceStrategy)
+    {
+        D3D12_HEAP_PROPERTIES heapProps = CD3DX12_HEAP_PROPERTIES(m_heapType);
+
+        D3D12_HEAP_DESC desc = {};
+        desc.SizeInBytes = m_maxBlockSize;
+        desc.Properties = heapProps;
+        desc.Alignment = MIN_PLACED_BUFFER_SIZE;
+        desc.Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
+
+        ASSERT_SUCCEEDED(g_Device->CreateHeap(&desc, MY_IID_PPV_ARGS(&m_pBackingHeap)));
+    }
+    else
+    {
+        m_BackingResource.Create(L"TLSF Allocator Backing Resource", uint32_t(m_maxBlockSize), 1, nullptr);
+    }
+}
+
+void TLSFAllocator::Destroy()
+{
+    if (m_allocationStrategy == kBuddyAllocationStrategy::kPlacedResourceStrategy)
+    {
+        m_pBackingHeap->Release();
+    }
+    else
+    {
+        m_BackingResource.Destroy();
+        m_StagingBuffer.Destroy();
+    }
+}
+
+void TLSFAllocator::Reset()
+{
+    lock_guard<mutex> guard(m_mutex);
+
+    m_nodes.clear();
+    m_unusedNodes.clear();
+    m_nodeAtUnit.assign(m_maxBlockSize / m_minBlockSize, kNoNode);
+
+    m_firstLevelBitmap = 0;
+    for (uint32_t firstLevel = 0; firstLevel < kFirstLevelCount; ++firstLevel)
+    {
+        m_secondLevelBitmaps[firstLevel] = 0;
+        for (uint32_t secondLevel = 0; secondLevel < kSecondLevelCount; ++secondLevel)
+            m_freeLists[firstLevel][secondLevel] = kNoNode;
+    }
+
+    // The pool starts out as one free block of the whole range
+    InsertFree(NewNode(0, m_nodeAtUnit.size()));
+}
+
+// Sizes below kSecondLevelCount units each have a bin of their own in the first row.  Larger sizes are binned by
+// their top bit and the four bits below it.
+void TLSFAllocator::Mapping(size_t size, uint32_t& firstLevel, uint32_t& secondLevel)
+{
+    if (size < kSecondLevelCount)
+    {
+        firstLevel = 0;
+        secondLevel = (uint32_t)size;
+    }
+    else
+    {
+        const uint32_t topBit = HighestBit(size);
+        firstLevel = topBit - kSecondLevelBits + 1;
+        secondLevel = (uint32_t)(size >> (topBit - kSecondLevelBits)) - kSecondLevelCount;
+    }
+}
+
+// Every block in the bin the size rounds up to, or in any bin above it, is at least as large
+uint32_t TLSFAllocator::FindFreeNode(size_t size) const
+{
+    if (size >= kSecondLevelCount)
+        size += (((size_t)1) << (HighestBit(size) - kSecondLevelBits)) - 1;
+
+    uint32_t firstLevel, secondLevel;
+    Mapping(size, firstLevel, secondLevel);
+    if (firstLevel >= kFirstLevelCount)
+        return kNoNode;
+
+    uint32_t secondLevelMap = m_secondLevelBitmaps[firstLevel] & (~0u << secondLevel);
+    if (secondLevelMap == 0)
+    {
+        const uint64_t firstLevelMap = firstLevel + 1 < 64 ? m_firstLevelBitmap & (~0ull << (firstLevel + 1)) : 0;
+        if (firstLevelMap == 0)
+            return kNoNode;
+
+        firstLevel = LowestBit(firstLevelMap);
+        secondLevelMap = m_secondLevelBitmaps[firstLevel];
+    }
+
+    return m_freeLists[firstLevel][LowestBit(secondLevelMap)];
+}
+
+void TLSFAllocator::InsertFree(uint32_t node)
+{
+    Node& n = m_nodes[node];
+    uint32_t firstLevel, secondLevel;
+    Mapping(n.Size, firstLevel, secondLevel);
+
+    n.IsFree = true;
+    n.pOwner = nullptr;
+    n.PrevFree = kNoNode;
+    n.NextFree = m_freeLists[firstLevel][secondLevel];
+    if (n.NextFree != kNoNode)
+        m_nodes[n.NextFree].PrevFree = node;
+    m_freeLists[firstLevel][secondLevel] = node;
+
+    m_firstLevelBitmap |= 1ull << firstLevel;
+    m_secondLevelBitmaps[firstLevel] |= 1u << secondLevel;
+}
+
+void TLSFAllocator::RemoveFree(uint32_t node)
+{
+    Node& n = m_nodes[node];
+    uint32_t firstLevel, secondLevel;
+    Mapping(n.Size, firstLevel, secondLevel);
+
+    if (n.PrevFree != kNoNode)
+        m_nodes[n.PrevFree].NextFree = n.NextFree;
+    else
+        m_freeLists[firstLevel][secondLevel] = n.NextFree;
+    if (n.NextFree != kNoNode)
+        m_nodes[n.NextFree].PrevFree = n.PrevFree;
+
+    if (m_freeLists[firstLevel][secondLevel] == kNoNode)
+    {
+        m_secondLevelBitmaps[firstLevel] &= ~(1u << secondLevel);
+        if (m_secondLevelBitmaps[firstLevel] == 0)
+            m_firstLevelBitmap &= ~(1ull << firstLevel);
+    }
+
+    n.IsFree = false;
+}
+
+uint32_t TLSFAllocator::NewNode(size_t offset, size_t size)
+{
+    uint32_t node;
+    if (m_unusedNodes.empty())
+    {
+        node = (uint32_t)m_nodes.size();
+        m_nodes.emplace_back();
+    }
+    else
+    {
+        node = m_unusedNodes.back();
+        m_unusedNodes.pop_back();
+    }
+
+    Node& n = m_nodes[node];
+    n.Offset = offset;
+    n.Size = size;
+    n.PrevPhysical = kNoNode;
+    n.NextPhysical = kNoNode;
+    n.PrevFree = kNoNode;
+    n.NextFree = kNoNode;
+    n.pOwner = nullptr;
+    n.IsFree = false;
+    m_nodeAtUnit[offset] = node;
+    return node;
+}
+
+// Cuts the node down to the size and returns the node after it, which holds the rest
+uint32_t TLSFAllocator::Split(uint32_t node, size_t size)
+{
+    const uint32_t rest = NewNode(m_nodes[node].Offset + size, m_nodes[node].Size - size);
+
+    Node& n = m_nodes[node];
+    Node& r = m_nodes[rest];
+    r.PrevPhysical = node;
+    r.NextPhysical = n.NextPhysical;
+    if (n.NextPhysical != kNoNode)
+        m_nodes[n.NextPhysical].PrevPhysical = rest;
+    n.NextPhysical = rest;
+    n.Size = size;
+    return rest;
+}
+
+uint32_t TLSFAllocator::AllocateUnits(size_t size, size_t alignment)
+{
+    // Room for the alignment is asked for up front, and what it skips is given back
+    uint32_t node = FindFreeNode(size + alignment - 1);
+    if (node == kNoNode)
+        return kNoNode;
+
+    RemoveFree(node);
+
+    const size_t alignedOffset = Math::AlignUp(m_nodes[node].Offset, alignment);
+    if (alignedOffset != m_nodes[node].Offset)
+    {
+        const uint32_t aligned = Split(node, alignedOffset - m_nodes[node].Offset);
+        InsertFree(node);
+        node = aligned;
+    }
+
+    if (m_nodes[node].Size > size)
+        InsertFree(Split(node, size));
+
+    return node;
+}
+
+void TLSFAllocator::FreeUnits(size_t offset)
+{
+    uint32_t node = m_nodeAtUnit[offset];
+    ASSERT(node != kNoNode && !m_nodes[node].IsFree);
+
+    // Merge with the free blocks on either side
+    const uint32_t prev = m_nodes[node].PrevPhysical;
+    if (prev != kNoNode && m_nodes[prev].IsFree)
+    {
+        RemoveFree(prev);
+        m_nodes[prev].Size += m_nodes[node].Size;
+        m_nodes[prev].NextPhysical = m_nodes[node].NextPhysical;
+        if (m_nodes[node].NextPhysical != kNoNode)
+            m_nodes[m_nodes[node].NextPhysical].PrevPhysical = prev;
+        m_nodeAtUnit[offset] = kNoNode;
+        m_unusedNodes.push_back(node);
+        node = prev;
+    }
+
+    const uint32_t next = m_nodes[node].NextPhysical;
+    if (next != kNoNode && m_nodes[next].IsFree)
+    {
+        RemoveFree(next);
+        m_nodes[node].Size += m_nodes[next].Size;
+        m_nodes[node].NextPhysical = m_nodes[next].NextPhysical;
+        if (m_nodes[next].NextPhysical != kNoNode)
+            m_nodes[m_nodes[next].NextPhysical].PrevPhysical = node;
+        m_nodeAtUnit[m_nodes[next].Offset] = kNoNode;
+        m_unusedNodes.push_back(next);
+    }
+
+    InsertFree(node);
+}
+
+BuddyBlock* TLSFAllocator::Allocate(uint32_t numElements, uint32_t elementSize, const void* initialData)
+{
+    size_t size = numElements * elementSize;
+    size_t unitSize = SizeToUnitSize(size);
+    if (unitSize == 0)
+        unitSize = 1;
+    uint32_t paddedSize = uint32_t(unitSize * m_minBlockSize);
+
+    BuddyBlock* pBlock;
+    {
+        lock_guard<mutex> guard(m_mutex);
+
+        uint32_t node = AllocateUnits(unitSize, 1);
+        if (node == kNoNode)
+        {
+            // There are no blocks available for the requested size so  
+            // return the NULL block type  
+            return new BuddyBlock();
+        }
+
+        pBlock = new BuddyBlock(uint32_t(m_baseOffset + m_nodes[node].Offset * m_minBlockSize), paddedSize, uint32_t(size));
+        m_nodes[node].pOwner = pBlock;
+
+        INCREASE_BUDDY_COUNTER(m_SpaceUsed, paddedSize);
+        INCREASE_BUDDY_COUNTER(m_InternalFragmentation, (paddedSize - size));
+    }
+
+    if (m_allocationStrategy == kBuddyAllocationStrategy::kPlacedResourceStrategy)
+    {
+        pBlock->InitPlaced(m_pBackingHeap, numElements, elementSize, initialData);
+    }
+    else
+    {
+        // Every block shares the one resource and its state, so only one thread may initialize a block of it
+        // at a time
+        lock_guard<mutex> guard(m_backingMutex);
+        pBlock->InitFromResource(&m_BackingResource, numElements, elementSize, initialData);
+    }
+
+    return pBlock;
+}
+
+bool TLSFAllocator::AllocateRange(size_t size, size_t& offset, size_t& paddedSize, size_t alignment)
+{
+    ASSERT(Math::IsDivisible(alignment, m_minBlockSize));
+
+    size_t unitSize = SizeToUnitSize(size);
+    if (unitSize == 0)
+        unitSize = 1;
+    size_t unitAlignment = alignment > m_minBlockSize ? alignment / m_minBlockSize : 1;
+
+    lock_guard<mutex> guard(m_mutex);
+
+    uint32_t node = AllocateUnits(unitSize, unitAlignment);
+    if (node == kNoNode)
+        return false;
+
+    offset = m_baseOffset + m_nodes[node].Offset * m_minBlockSize;
+    paddedSize = unitSize * m_minBlockSize;
+
+    INCREASE_BUDDY_COUNTER(m_SpaceUsed, paddedSize);
+    INCREASE_BUDDY_COUNTER(m_InternalFragmentation, (paddedSize - size));
+
+    return true;
+}
+
+void TLSFAllocator::DeallocateRange(size_t offset, size_t size)
+{
+    lock_guard<mutex> guard(m_mutex);
+
+    FreeUnits((offset - m_baseOffset) / m_minBlockSize);
+
+    DECREASE_BUDDY_COUNTER(m_SpaceUsed, SizeToUnitSize(size) * m_minBlockSize);
+    DECREASE_BUDDY_COUNTER(m_InternalFragmentation, (SizeToUnitSize(size) * m_minBlockSize - size));
+}
+
+void TLSFAllocator::Deallocate(BuddyBlock* pBlock)
+{
+    // Any command list that uses the block has been submitted already
+    pBlock->m_fenceValue = g_CommandManager.GetGraphicsQueue().GetNextFenceValue() - 1;
+
+    lock_guard<mutex> guard(m_mutex);
+    m_deferredDeletionQueue.push(pBlock);
+}
+
+void TLSFAllocator::DeallocateInternal(BuddyBlock* pBlock)
+{
+    ASSERT(IsOwner(*pBlock));
+
+    {
+        lock_guard<mutex> guard(m_mutex);
+
+        FreeUnits((pBlock->GetOffset() - m_baseOffset) / m_minBlockSize);
+
+        DECREASE_BUDDY_COUNTER(m_SpaceUsed, pBlock->GetSize());
+        DECREASE_BUDDY_COUNTER(m_InternalFragmentation, (pBlock->GetSize() - pBlock->m_unpaddedSize));
+    }
+
+    if (m_allocationStrategy == kBuddyAllocationStrategy::kPlacedResourceStrategy)
+    {
+        // Release the resource
+        pBlock->Destroy();
+    }
+    delete(pBlock);
+}
+
+void TLSFAllocator::CleanUpAllocations()
+{
+    vector<BuddyBlock*> completedBlocks;
+    {
+        lock_guard<mutex> guard(m_mutex);
+
+        while (m_deferredDeletionQueue.empty() == false &&
+            g_CommandManager.IsFenceComplete(m_deferredDeletionQueue.front()->m_fenceValue))
+        {
+            completedBlocks.push_back(m_deferredDeletionQueue.front());
+            m_deferredDeletionQueue.pop();
+        }
+
+        // The ranges blocks were moved out of are already counted as used by the blocks' new ranges
+        while (m_deferredRanges.empty() == false &&
+            g_CommandManager.IsFenceComplete(m_deferredRanges.front().FenceValue))
+        {
+            FreeUnits(m_deferredRanges.front().Offset);
+            m_deferredRanges.pop();
+        }
+    }
+
+    for (BuddyBlock* pBlock : completedBlocks)
+        DeallocateInternal(pBlock);
+}
+
+size_t TLSFAllocator::Defragment(size_t maxBytes)
+{
+    if (m_allocationStrategy != kBuddyAllocationStrategy::kManualSubAllocationStrategy)
+        return 0;
+
+    struct Move
+    {
+        size_t From;
+        size_t To;
+        size_t Size;
+    };
+    vector<Move> moves;
+    size_t movedBytes = 0;
+
+    lock_guard<mutex> backingGuard(m_backingMutex);
+    {
+        lock_guard<mutex> guard(m_mutex);
+
+        vector<uint32_t> candidates;
+        for (uint32_t node = m_nodeAtUnit[0]; node != kNoNode; node = m_nodes[node].NextPhysical)
+        {
+            if (m_nodes[node].pOwner != nullptr)
+                candidates.push_back(node);
+        }
+
+        // The blocks nearest the end go first, and only into free space below them
+        for (auto it = candidates.rbegin(); it != candidates.rend(); ++it)
+        {
+            const size_t size = m_nodes[*it].Size;
+            if (movedBytes + size * m_minBlockSize > maxBytes)
+                continue;
+
+            const uint32_t target = AllocateUnits(size, 1);
+            if (target == kNoNode)
+                continue;
+            if (m_nodes[target].Offset > m_nodes[*it].Offset)
+            {
+                FreeUnits(m_nodes[target].Offset);
+                continue;
+            }
+
+            BuddyBlock* pBlock = m_nodes[*it].pOwner;
+            m_nodes[*it].pOwner = nullptr;
+            m_nodes[target].pOwner = pBlock;
+            pBlock->m_offset = m_baseOffset + m_nodes[target].Offset * m_minBlockSize;
+
+            moves.push_back({ m_nodes[*it].Offset, m_nodes[target].Offset, size });
+            movedBytes += size * m_minBlockSize;
+        }
+    }
+
+    if (moves.empty())
+        return 0;
+
+    // The staging buffer may still be read by the last defragmentation when it has to grow
+    if (m_StagingBuffer.GetBufferSize() < movedBytes)
+    {
+        g_CommandManager.WaitForFence(m_StagingFence);
+        m_StagingBuffer.Destroy();
+        m_StagingBuffer.Create(L"TLSF Allocator Staging Buffer", uint32_t(movedBytes), 1, nullptr);
+    }
+
+    CommandContext& Context = CommandContext::Begin(L"TLSF Defragment");
+
+    Context.TransitionResource(m_BackingResource, D3D12_RESOURCE_STATE_COPY_SOURCE);
+    Context.TransitionResource(m_StagingBuffer, D3D12_RESOURCE_STATE_COPY_DEST, true);
+    size_t stagingOffset = 0;
+    for (const Move& move : moves)
+    {
+        Context.CopyBufferRegion(m_StagingBuffer, stagingOffset, m_BackingResource, move.From * m_minBlockSize, move.Size * m_minBlockSize);
+        stagingOffset += move.Size * m_minBlockSize;
+    }
+
+    Context.TransitionResource(m_BackingResource, D3D12_RESOURCE_STATE_COPY_DEST);
+    Context.TransitionResource(m_StagingBuffer, D3D12_RESOURCE_STATE_COPY_SOURCE, true);
+    stagingOffset = 0;
+    for (const Move& move : moves)
+    {
+        Context.CopyBufferRegion(m_BackingResource, move.To * m_minBlockSize, m_StagingBuffer, stagingOffset, move.Size * m_minBlockSize);
+        stagingOffset += move.Size * m_minBlockSize;
+    }
+
+    Context.TransitionResource(m_BackingResource, D3D12_RESOURCE_STATE_GENERIC_READ, true);
+    m_StagingFence = Context.Finish();
+
+    // The old ranges are free once the copies, and everything submitted before them, are done
+    lock_guard<mutex> guard(m_mutex);
+    for (const Move& move : moves)
+        m_deferredRanges.push({ move.From, m_StagingFence });
+
+    return movedBytes;
+}
@@ -0,0 +1,130 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Allocates blocks from a fixed range with a two-level segregated fit, the same way BuddyAllocator is used.
+// Blocks are only rounded up to the minimum block size, where buddy allocation pads them to a power of two.
+// The free blocks are binned by the top bit of their size and the next four bits below it, and a bitmap over
+// the bins finds a block that fits in a couple of bit scans.  A freed block is merged with the free blocks on
+// either side of it.  Every method can be called from any thread.
+//
+
+#pragma once
+
+#include "BuddyAllocator.h"
+
+class TLSFAllocator
+{
+public:
+
+    TLSFAllocator(kBuddyAllocationStrategy allocationStrategy, D3D12_HEAP_TYPE heapType, size_t maxBlockSize, size_t minBlockSize = MIN_PLACED_BUFFER_SIZE, size_t baseOffset = 0);
+
+    void Initialize();
+
+    void Destroy();
+
+    BuddyBlock* Allocate(uint32_t numElements, uint32_t elementSize, const void* initialData = nullptr);
+
+    void Deallocate(BuddyBlock* pBlock);
+
+    // Reserves a range without creating anything in it, for callers that place their own resources.  The range
+    // is padded to a multiple of the minimum block size, and its offset is a multiple of the alignment, which
+    // must be one too.  Free it with the size that was asked for.
+    bool AllocateRange(size_t size, size_t& offset, size_t& paddedSize, size_t alignment = 0);
+
+    void DeallocateRange(size_t offset, size_t size);
+
+    inline bool IsOwner(const BuddyBlock &block)
+    {
+        return block.GetOffset() >= m_baseOffset && block.GetOffset() + block.GetSize() <= m_baseOffset + m_maxBlockSize;
+    }
+
+    void Reset();
+
+    // Frees the blocks passed to Deallocate(), and the ranges that Defragment() moved blocks out of, once their
+    // fences have completed
+    void CleanUpAllocations();
+
+    // Moves up to maxBytes of blocks from the end of the range into free space below them, with GPU copies
+    // submitted on the graphics queue, and returns the bytes moved.  The blocks keep their BuddyBlock, whose
+    // offset changes right away, so call this before recording anything that uses them this frame.  Only the
+    // manual sub-allocation strategy moves blocks, since placed resources are referenced directly.
+    size_t Defragment(size_t maxBytes);
+
+private:
+
+    static const uint32_t kNoNode = ~0u;
+    static const uint32_t kSecondLevelBits = 4;
+    static const uint32_t kSecondLevelCount = 1 << kSecondLevelBits;
+    static const uint32_t kFirstLevelCount = 64 - kSecondLevelBits;
+
+    // A run of units in the range, either free and in the list of its bin, or allocated
+    struct Node
+    {
+        size_t Offset;
+        size_t Size;
+        uint32_t PrevPhysical;
+        uint32_t NextPhysical;
+        uint32_t PrevFree;
+        uint32_t NextFree;
+        BuddyBlock* pOwner;         // The block allocated in it, which Defragment() may move
+        bool IsFree;
+    };
+
+    struct DeferredRange
+    {
+        size_t Offset;
+        uint64_t FenceValue;
+    };
+
+    ID3D12Heap* m_pBackingHeap;
+    ByteAddressBuffer m_BackingResource;
+    ByteAddressBuffer m_StagingBuffer;  // Holds moved blocks in between, as one buffer cannot copy to itself
+    uint64_t m_StagingFence;
+
+    const D3D12_HEAP_TYPE m_heapType;
+
+    std::mutex m_mutex;             // Guards the nodes, the deferred deletions and the counters
+    std::mutex m_backingMutex;      // Serializes initializing blocks of the one backing resource and moving them
+
+    std::queue<BuddyBlock*> m_deferredDeletionQueue;
+    std::queue<DeferredRange> m_deferredRanges;
+
+    std::vector<Node> m_nodes;
+    std::vector<uint32_t> m_unusedNodes;
+    std::vector<uint32_t> m_nodeAtUnit;     // The node that starts at each unit, valid at the start of a node only
+    uint64_t m_firstLevelBitmap;
+    uint32_t m_secondLevelBitmaps[kFirstLevelCount];
+    uint32_t m_freeLists[kFirstLevelCount][kSecondLevelCount];
+
+    const size_t m_baseOffset;
+    const size_t m_maxBlockSize;
+    const size_t m_minBlockSize;
+
+    const kBuddyAllocationStrategy m_allocationStrategy;
+
+    inline size_t SizeToUnitSize(size_t size) const
+    {
+        return (size + (m_minBlockSize - 1)) / m_minBlockSize;
+    }
+
+    static void Mapping(size_t size, uint32_t& firstLevel, uint32_t& secondLevel);
+    uint32_t FindFreeNode(size_t size) const;
+    void InsertFree(uint32_t node);
+    void RemoveFree(uint32_t node);
+    uint32_t NewNode(size_t offset, size_t size);
+    uint32_t Split(uint32_t node, size_t size);
+    uint32_t AllocateUnits(size_t size, size_t alignment);
+    void FreeUnits(size_t offset);
+
+    void DeallocateInternal(BuddyBlock* pBlock);
+
+#if defined(PROFILE) || defined(_DEBUG)
+    size_t m_SpaceUsed;
+    size_t m_InternalFragmentation;
+#endif
+};
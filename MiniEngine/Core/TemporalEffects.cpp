@@ -18,8 +18,14 @@
 #include "CommandContext.h"
 #include "SystemTime.h"
 #include "PostEffects.h"
+#include "DynamicResolution.h"
+#include "MotionBlur.h"
 
 #include "CompiledShaders/TemporalBlendCS.h"
+#include "CompiledShaders/TemporalBlendPackedCS.h"
+#include "CompiledShaders/TemporalBlendHalfVelocityCS.h"
+#include "CompiledShaders/TemporalBlendPackedHalfVelocityCS.h"
+#include "CompiledShaders/TemporalUpscaleCS.h"
 #include "CompiledShaders/BoundNeighborhoodCS.h"
 #include "CompiledShaders/ResolveTAACS.h"
 #include "CompiledShaders/SharpenTAACS.h"
@@ -35,10 +41,15 @@ namespace TemporalEffects
     NumVar TemporalMaxLerp("Graphics/AA/TAA/Blend Factor", 1.0f, 0.0f, 1.0f, 0.01f);
     ExpVar TemporalSpeedLimit("Graphics/AA/TAA/Speed Limit", 64.0f, 1.0f, 1024.0f, 1.0f);
     BoolVar TriggerReset("Graphics/AA/TAA/Reset", false);
+    BoolVar EnableUpscaling("Graphics/AA/TAA/Upscaling", false);
+    NumVar UpscaleResolution("Graphics/AA/TAA/Upscale Resolution", 0.67f, 0.5f, 0.77f, 0.01f);
+    BoolVar CompressedHistory("Graphics/AA/TAA/Compressed History", false);
+    BoolVar HalfResVelocity("Graphics/AA/TAA/Half Res Velocity", false);
 
     RootSignature s_RootSignature;
 
-    ComputePSO s_TemporalBlendCS;
+    ComputePSO s_TemporalBlendCS[4];    // Indexed by compressed history, plus 2 for half resolution velocity
+    ComputePSO s_TemporalUpscaleCS;
     ComputePSO s_BoundNeighborhoodCS;
     ComputePSO s_SharpenTAACS;
     ComputePSO s_ResolveTAACS;
@@ -50,8 +61,50 @@ namespace TemporalEffects
     float s_JitterDeltaX = 0.0f;
     float s_JitterDeltaY = 0.0f;
 
-    void ApplyTemporalAA(ComputeContext& Context);
+    // Whether g_TemporalColor holds R11G11B10 color, with the confidence in g_TemporalWeight
+    bool s_HistoryCompressed = false;
+
+    // Smoothed GPU times of the velocity pass and the resolve for each TAA variant, and the variant that ran
+    // in the last frame, so that the profiler can show what the bandwidth options save
+    float s_VariantGpuTime[4] = {};
+    uint32_t s_MeasuredVariant = ~0u;
+
+    void ApplyTemporalAA(ComputeContext& Context, uint32_t Variant);
+    void ApplyTemporalUpscale(ComputeContext& Context);
+
+    float Halton( uint32_t Index, uint32_t Base )
+    {
+        float Result = 0.0f;
+        float Fraction = 1.0f;
+        for (; Index > 0; Index /= Base)
+        {
+            Fraction /= Base;
+            Result += Fraction * (Index % Base);
+        }
+        return Result;
+    }
+
     void SharpenImage(ComputeContext& Context, ColorBuffer& TemporalColor);
+
+    void ReportTimeSaved( uint32_t Variant )
+    {
+        float CpuTime, ResolveTime, VelocityTime;
+        if (s_MeasuredVariant < 4 && EngineProfiling::GetScopeTimes(L"Temporal Resolve", CpuTime, ResolveTime) &&
+            EngineProfiling::GetScopeTimes(L"Generate Camera Velocity", CpuTime, VelocityTime))
+        {
+            float& Average = s_VariantGpuTime[s_MeasuredVariant];
+            const float Time = ResolveTime + VelocityTime;
+            Average = Average == 0.0f ? Time : Average + (Time - Average) * 0.05f;
+        }
+        s_MeasuredVariant = Variant;
+
+        // Against the full precision history and velocity, once both have been measured
+        if (Variant < 4 && s_VariantGpuTime[0] > 0.0f && s_VariantGpuTime[Variant] > 0.0f)
+        {
+            const float Saved = s_VariantGpuTime[0] - s_VariantGpuTime[Variant];
+            EngineProfiling::SetCounter("TAA GPU Time Saved (us)", (uint32_t)(std::max(Saved, 0.0f) * 1000.0f));
+        }
+    }
 }
 
 void TemporalEffects::Initialize( void )
@@ -70,7 +123,11 @@ void TemporalEffects::Initialize( void )
     ObjName.SetComputeShader(ShaderByteCode, sizeof(ShaderByteCode) ); \
     ObjName.Finalize();
 
-    CreatePSO( s_TemporalBlendCS, g_pTemporalBlendCS );
+    CreatePSO( s_TemporalBlendCS[0], g_pTemporalBlendCS );
+    CreatePSO( s_TemporalBlendCS[1], g_pTemporalBlendPackedCS );
+    CreatePSO( s_TemporalBlendCS[2], g_pTemporalBlendHalfVelocityCS );
+    CreatePSO( s_TemporalBlendCS[3], g_pTemporalBlendPackedHalfVelocityCS );
+    CreatePSO( s_TemporalUpscaleCS, g_pTemporalUpscaleCS );
     CreatePSO( s_BoundNeighborhoodCS, g_pBoundNeighborhoodCS );
     CreatePSO( s_SharpenTAACS, g_pSharpenTAACS );
     CreatePSO( s_ResolveTAACS, g_pResolveTAACS );
@@ -97,7 +154,18 @@ void TemporalEffects::Update( uint64_t FrameIndex )
             { 3.0f / 8.0f, 2.0f / 9.0f }, { 7.0f / 8.0f, 5.0f / 9.0f }
         };
 
-        const float* Offset = Halton23[s_FrameIndex % 8];
+        float Offset[2] = { Halton23[s_FrameIndex % 8][0], Halton23[s_FrameIndex % 8][1] };
+
+        // Each output pixel should still see about eight samples land in it, so the sequence grows with the
+        // number of output pixels every render pixel covers
+        if (IsUpscaling())
+        {
+            const float Ratio = 1.0f / UpscaleResolution;
+            const uint32_t Phases = (uint32_t)std::ceil(8.0f * Ratio * Ratio);
+            const uint32_t Index = s_FrameIndex % Phases + 1;
+            Offset[0] = Halton(Index, 2);
+            Offset[1] = Halton(Index, 3);
+        }
 
         s_JitterDeltaX = s_JitterX - Offset[0];
         s_JitterDeltaY = s_JitterY - Offset[1];
@@ -114,17 +182,55 @@ void TemporalEffects::Update( uint64_t FrameIndex )
 
 }
 
+bool TemporalEffects::IsUpscaling( void )
+{
+    return EnableTAA && EnableUpscaling;
+}
+
+float TemporalEffects::GetUpscaleResolution( void )
+{
+    return IsUpscaling() ? (float)UpscaleResolution : 1.0f;
+}
+
 uint32_t TemporalEffects::GetFrameIndexMod2( void )
 {
     return s_FrameIndexMod2;
 }
 
+bool TemporalEffects::UsesHalfResVelocity( void )
+{
+    return EnableTAA && HalfResVelocity && !IsUpscaling();
+}
+
 void TemporalEffects::GetJitterOffset( float& JitterX, float& JitterY )
 {
     JitterX = s_JitterX;
     JitterY = s_JitterY;
 }
 
+void TemporalEffects::CreateHistory( CommandContext& Context, uint32_t Width, uint32_t Height )
+{
+    // The upscaler keeps its confidence in the alpha of the history
+    s_HistoryCompressed = CompressedHistory && !EnableUpscaling;
+
+    const DXGI_FORMAT Format = s_HistoryCompressed ? DXGI_FORMAT_R11G11B10_FLOAT : DXGI_FORMAT_R16G16B16A16_FLOAT;
+    g_TemporalColor[0].Create( L"Temporal Color 0", Width, Height, 1, Format );
+    g_TemporalColor[1].Create( L"Temporal Color 1", Width, Height, 1, Format );
+
+    if (s_HistoryCompressed)
+    {
+        g_TemporalWeight[0].Create( L"Temporal Weight 0", Width, Height, 1, DXGI_FORMAT_R8_UNORM );
+        g_TemporalWeight[1].Create( L"Temporal Weight 1", Width, Height, 1, DXGI_FORMAT_R8_UNORM );
+    }
+    else
+    {
+        g_TemporalWeight[0].Destroy();
+        g_TemporalWeight[1].Destroy();
+    }
+
+    ClearHistory(Context);
+}
+
 void TemporalEffects::ClearHistory( CommandContext& Context )
 {
     GraphicsContext& gfxContext = Context.GetGraphicsContext();
@@ -132,9 +238,19 @@ void TemporalEffects::ClearHistory( CommandContext& Context )
     if (EnableTAA)
     {
         gfxContext.TransitionResource(g_TemporalColor[0], D3D12_RESOURCE_STATE_RENDER_TARGET);
-        gfxContext.TransitionResource(g_TemporalColor[1], D3D12_RESOURCE_STATE_RENDER_TARGET, true);
+        gfxContext.TransitionResource(g_TemporalColor[1], D3D12_RESOURCE_STATE_RENDER_TARGET, !s_HistoryCompressed);
+        if (s_HistoryCompressed)
+        {
+            gfxContext.TransitionResource(g_TemporalWeight[0], D3D12_RESOURCE_STATE_RENDER_TARGET);
+            gfxContext.TransitionResource(g_TemporalWeight[1], D3D12_RESOURCE_STATE_RENDER_TARGET, true);
+        }
         gfxContext.ClearColor(g_TemporalColor[0]);
         gfxContext.ClearColor(g_TemporalColor[1]);
+        if (s_HistoryCompressed)
+        {
+            gfxContext.ClearColor(g_TemporalWeight[0]);
+            gfxContext.ClearColor(g_TemporalWeight[1]);
+        }
     }
 }
 
@@ -145,11 +261,21 @@ void TemporalEffects::ResolveImage( CommandContext& BaseContext )
     ComputeContext& Context = BaseContext.GetComputeContext();
 
     static bool s_EnableTAA = false;
+    static bool s_Upscaling = false;
 
-    if (EnableTAA != s_EnableTAA || TriggerReset)
+    // Changing the history format recreates it, while the previous frames may still read it
+    if ((CompressedHistory && !EnableUpscaling) != s_HistoryCompressed)
+    {
+        g_CommandManager.IdleGPU();
+        CreateHistory(Context, g_TemporalColor[0].GetWidth(), g_TemporalColor[0].GetHeight());
+    }
+
+    // The history of one mode is at a different resolution than the other's
+    if (EnableTAA != s_EnableTAA || IsUpscaling() != s_Upscaling || TriggerReset)
     {
         ClearHistory(Context);
         s_EnableTAA = EnableTAA;
+        s_Upscaling = IsUpscaling();
         TriggerReset = false;
     }
 
@@ -158,12 +284,22 @@ void TemporalEffects::ResolveImage( CommandContext& BaseContext )
 
     if (EnableTAA)
     {
-        ApplyTemporalAA(Context);
+        if (s_Upscaling)
+        {
+            ReportTimeSaved(~0u);
+            ApplyTemporalUpscale(Context);
+        }
+        else
+        {
+            const uint32_t Variant = (s_HistoryCompressed ? 1 : 0) + (MotionBlur::HasHalfResVelocity() ? 2 : 0);
+            ReportTimeSaved(Variant);
+            ApplyTemporalAA(Context, Variant);
+        }
         SharpenImage(Context, g_TemporalColor[Dst]);
     }
 }
 
-void TemporalEffects::ApplyTemporalAA(ComputeContext& Context)
+void TemporalEffects::ApplyTemporalAA(ComputeContext& Context, uint32_t Variant)
 {
     ScopedTimer _prof(L"Resolve Image", Context);
 
@@ -171,7 +307,7 @@ void TemporalEffects::ApplyTemporalAA(ComputeContext& Context)
     uint32_t Dst = Src ^ 1;
 
     Context.SetRootSignature(s_RootSignature);
-    Context.SetPipelineState(s_TemporalBlendCS);
+    Context.SetPipelineState(s_TemporalBlendCS[Variant]);
 
     __declspec(align(16)) struct ConstantBuffer
     {
@@ -179,11 +315,80 @@ void TemporalEffects::ApplyTemporalAA(ComputeContext& Context)
         float TemporalBlendFactor;
         float RcpSeedLimiter;
         float CombinedJitter[2];
+        float HistoryScale[2];
+        float HistoryUVMax[2];
     };
+    const uint32_t Width = DynamicResolution::GetWidth(), Height = DynamicResolution::GetHeight();
+    const uint32_t PrevWidth = DynamicResolution::GetPrevWidth(), PrevHeight = DynamicResolution::GetPrevHeight();
     ConstantBuffer cbv = {
         1.0f / g_SceneColorBuffer.GetWidth(), 1.0f / g_SceneColorBuffer.GetHeight(),
         (float)TemporalMaxLerp, 1.0f / TemporalSpeedLimit,
-        s_JitterDeltaX, s_JitterDeltaY
+        s_JitterDeltaX, s_JitterDeltaY,
+        (float)PrevWidth / Width, (float)PrevHeight / Height,
+        (PrevWidth - 0.5f) / g_SceneColorBuffer.GetWidth(), (PrevHeight - 0.5f) / g_SceneColorBuffer.GetHeight()
+    };
+
+    Context.SetDynamicConstantBufferView(3, sizeof(cbv), &cbv);
+
+    ColorBuffer& Velocity = (Variant & 2) ? g_VelocityBufferHalf : g_VelocityBuffer;
+
+    Context.TransitionResource(Velocity, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    Context.TransitionResource(g_SceneColorBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    Context.TransitionResource(g_TemporalColor[Src], D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    Context.TransitionResource(g_TemporalColor[Dst], D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    Context.TransitionResource(g_LinearDepth[Src], D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    Context.TransitionResource(g_LinearDepth[Dst], D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    Context.SetDynamicDescriptor(1, 0, Velocity.GetSRV());
+    Context.SetDynamicDescriptor(1, 1, g_SceneColorBuffer.GetSRV());
+    Context.SetDynamicDescriptor(1, 2, g_TemporalColor[Src].GetSRV());
+    Context.SetDynamicDescriptor(1, 3, g_LinearDepth[Src].GetSRV());
+    Context.SetDynamicDescriptor(1, 4, g_LinearDepth[Dst].GetSRV());
+    Context.SetDynamicDescriptor(2, 0, g_TemporalColor[Dst].GetUAV());
+
+    if (Variant & 1)
+    {
+        Context.TransitionResource(g_TemporalWeight[Src], D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        Context.TransitionResource(g_TemporalWeight[Dst], D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+        Context.SetDynamicDescriptor(1, 5, g_TemporalWeight[Src].GetSRV());
+        Context.SetDynamicDescriptor(2, 1, g_TemporalWeight[Dst].GetUAV());
+    }
+
+    Context.Dispatch2D(Width, Height, 16, 8);
+}
+
+void TemporalEffects::ApplyTemporalUpscale(ComputeContext& Context)
+{
+    ScopedTimer _prof(L"Temporal Upscale", Context);
+
+    uint32_t Src = s_FrameIndexMod2;
+    uint32_t Dst = Src ^ 1;
+
+    Context.SetRootSignature(s_RootSignature);
+    Context.SetPipelineState(s_TemporalUpscaleCS);
+
+    __declspec(align(16)) struct ConstantBuffer
+    {
+        float RcpBufferDim[2];
+        float RenderScale[2];
+        float CombinedJitter[2];
+        float CurrentJitter[2];
+        float HistoryScale[2];
+        float HistoryUVMax[2];
+        uint32_t RenderMax[2];
+        float RcpSpeedLimiter;
+    };
+    const uint32_t OutputWidth = (uint32_t)g_SceneColorBuffer.GetWidth(), OutputHeight = (uint32_t)g_SceneColorBuffer.GetHeight();
+    const uint32_t Width = DynamicResolution::GetWidth(), Height = DynamicResolution::GetHeight();
+    const uint32_t PrevWidth = DynamicResolution::GetPrevWidth(), PrevHeight = DynamicResolution::GetPrevHeight();
+    ConstantBuffer cbv = {
+        1.0f / OutputWidth, 1.0f / OutputHeight,
+        (float)Width / OutputWidth, (float)Height / OutputHeight,
+        s_JitterDeltaX, s_JitterDeltaY,
+        s_JitterX - 0.5f, s_JitterY - 0.5f,
+        (float)PrevWidth / Width, (float)PrevHeight / Height,
+        (PrevWidth - 0.5f) / OutputWidth, (PrevHeight - 0.5f) / OutputHeight,
+        Width - 1, Height - 1,
+        1.0f / TemporalSpeedLimit
     };
 
     Context.SetDynamicConstantBufferView(3, sizeof(cbv), &cbv);
@@ -201,7 +406,7 @@ void TemporalEffects::ApplyTemporalAA(ComputeContext& Context)
     Context.SetDynamicDescriptor(1, 4, g_LinearDepth[Dst].GetSRV());
     Context.SetDynamicDescriptor(2, 0, g_TemporalColor[Dst].GetUAV());
 
-    Context.Dispatch2D(g_SceneColorBuffer.GetWidth(), g_SceneColorBuffer.GetHeight(), 16, 8);
+    Context.Dispatch2D(OutputWidth, OutputHeight);
 }
 
 void TemporalEffects::SharpenImage(ComputeContext& Context, ColorBuffer& TemporalColor)
@@ -215,5 +420,5 @@ void TemporalEffects::SharpenImage(ComputeContext& Context, ColorBuffer& Tempora
     Context.SetConstants(0, 1.0f + Sharpness, 0.25f * Sharpness);
     Context.SetDynamicDescriptor(1, 0, TemporalColor.GetSRV());
     Context.SetDynamicDescriptor(2, 0, g_SceneColorBuffer.GetUAV());
-    Context.Dispatch2D(g_SceneColorBuffer.GetWidth(), g_SceneColorBuffer.GetHeight());
+    Context.Dispatch2D(DynamicResolution::GetOutputWidth(), DynamicResolution::GetOutputHeight());
 }
@@ -24,6 +24,18 @@ namespace TemporalEffects
     // effectively supersample the image.
     extern BoolVar EnableTAA;
 
+    // Temporal upscaling renders below the output resolution and accumulates the jittered samples into a history
+    // at the output resolution, which then replaces the scene color.  It requires TAA.
+    extern BoolVar EnableUpscaling;
+
+    // Stores the TAA history as R11G11B10 color with an 8-bit confidence, 40 bits per pixel instead of 64.  The
+    // upscaler keeps its full precision history.
+    extern BoolVar CompressedHistory;
+
+    // Resolves TAA with the velocity of the closest pixel of each 2x2 quad, which the camera velocity pass writes
+    // at half resolution, instead of dilating the full resolution velocity
+    extern BoolVar HalfResVelocity;
+
     void Initialize( void );
 
     void Shutdown( void );
@@ -39,6 +51,18 @@ namespace TemporalEffects
     // is enabled.  You can use these values to jitter your viewport or projection matrix.
     void GetJitterOffset( float& JitterX, float& JitterY );
 
+    // Whether this frame renders below the output resolution for ResolveImage() to upscale
+    bool IsUpscaling( void );
+
+    // The fraction of the output width and height the scene renders at when upscaling, or 1
+    float GetUpscaleResolution( void );
+
+    // Creates the history buffers in the format that the options ask for, and clears them
+    void CreateHistory( CommandContext& Context, uint32_t Width, uint32_t Height );
+
+    // Whether the TAA resolve wants g_VelocityBufferHalf this frame
+    bool UsesHalfResVelocity( void );
+
     void ClearHistory(CommandContext& Context);
 
     void ResolveImage(CommandContext& Context);
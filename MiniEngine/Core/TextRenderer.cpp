@@ -21,15 +21,18 @@
 #include "PipelineState.h"
 #include "RootSignature.h"
 #include "BufferManager.h"
+#include "Hash.h"
 #include "CompiledShaders/TextVS.h"
 #include "CompiledShaders/TextAntialiasPS.h"
 #include "CompiledShaders/TextShadowPS.h"
 #include "Fonts/consola24.h"
 #include <map>
+#include <unordered_map>
 #include <string>
 #include <cstdio>
 #include <memory>
-#include <malloc.h>
+#include <mutex>
+#include <DirectXPackedVector.h>
 
 using namespace Graphics;
 using namespace Math;
@@ -50,6 +53,7 @@ namespace TextRenderer
             m_BorderSize = 0;
             m_TextureWidth = 0;
             m_TextureHeight = 0;
+            m_NumChannels = 1;
         }
 
         ~Font()
@@ -61,14 +65,14 @@ namespace TextRenderer
         {
             (fontName);
 
-            // We should at least use this to assert that we have a complete file
+            // Only used to assert that we have a complete file
             (binarySize);
 
             struct FontHeader
             {
                 char FileDescriptor[8];        // "SDFFONT\0"
                 uint8_t  majorVersion;        // '1'
-                uint8_t  minorVersion;        // '0'
+                uint8_t  minorVersion;        // '0' or '1'
                 uint16_t borderSize;        // Pixel empty space border width
                 uint16_t textureWidth;        // Width of texture buffer
                 uint16_t textureHeight;        // Height of texture buffer
@@ -78,7 +82,22 @@ namespace TextRenderer
                 uint16_t searchDist;        // Range of search space 12.4
             };
 
+            // Version 1.1 adds the texture space each glyph covers within the line and multi-channel fields
+            struct FontHeaderExt
+            {
+                uint16_t numChannels;        // 1 (R8) or 4 (RGBA8, median of RGB with the true distance in A)
+                uint16_t reserved;
+            };
+
+            struct GlyphV10
+            {
+                uint16_t x, y, w;
+                int16_t bearing;
+                uint16_t advance;
+            };
+
             FontHeader* header = (FontHeader*)pBinary;
+            const bool HasExtension = header->majorVersion > 1 || header->minorVersion >= 1;
             m_NormalizeXCoord = 1.0f / (header->textureWidth * 16);
             m_NormalizeYCoord = 1.0f / (header->textureHeight * 16);
             m_FontHeight = header->fontHeight;
@@ -88,15 +107,46 @@ namespace TextRenderer
             uint16_t textureWidth = header->textureWidth;
             uint16_t textureHeight = header->textureHeight;
             uint16_t NumGlyphs = header->numGlyphs;
+            m_TextureWidth = textureWidth;
+            m_TextureHeight = textureHeight;
 
-            const wchar_t* wcharList = (wchar_t*)(pBinary + sizeof(FontHeader));
-            const Glyph* glyphData = (Glyph*)(wcharList + NumGlyphs);
-            const void* texelData = glyphData + NumGlyphs;
+            const uint8_t* headerEnd = pBinary + sizeof(FontHeader);
+            if (HasExtension)
+            {
+                m_NumChannels = ((const FontHeaderExt*)headerEnd)->numChannels;
+                headerEnd += sizeof(FontHeaderExt);
+            }
 
-            for (uint16_t i = 0; i < NumGlyphs; ++i)
-                m_Dictionary[wcharList[i]] = glyphData[i];
+            const wchar_t* wcharList = (wchar_t*)headerEnd;
+            const void* texelData = nullptr;
 
-            m_Texture.Create( textureWidth, textureHeight, DXGI_FORMAT_R8_SNORM, texelData );
+            if (HasExtension)
+            {
+                const Glyph* glyphData = (Glyph*)(wcharList + NumGlyphs);
+                texelData = glyphData + NumGlyphs;
+
+                for (uint16_t i = 0; i < NumGlyphs; ++i)
+                    m_Dictionary[wcharList[i]] = glyphData[i];
+            }
+            else
+            {
+                // Older fonts reserve the whole line for every glyph
+                const GlyphV10* glyphData = (GlyphV10*)(wcharList + NumGlyphs);
+                texelData = glyphData + NumGlyphs;
+
+                for (uint16_t i = 0; i < NumGlyphs; ++i)
+                {
+                    const GlyphV10& g = glyphData[i];
+                    m_Dictionary[wcharList[i]] = { g.x, g.y, g.w, g.bearing, g.advance, 0, m_FontHeight };
+                }
+            }
+
+            ASSERT(m_NumChannels == 1 || m_NumChannels == 4, "Unsupported SDF font channel count");
+            ASSERT((const uint8_t*)texelData + textureWidth * textureHeight * m_NumChannels <= pBinary + binarySize,
+                "SDF font file is truncated");
+
+            m_Texture.Create( textureWidth, textureHeight,
+                m_NumChannels == 4 ? DXGI_FORMAT_R8G8B8A8_SNORM : DXGI_FORMAT_R8_SNORM, texelData );
 
             DEBUGPRINT( "Loaded SDF font:  %ls (ver. %d.%d)", fontName, header->majorVersion, header->minorVersion);
         }
@@ -116,12 +166,13 @@ namespace TextRenderer
             return true;
         }
 
-        // Each character has an XY start offset, a width, and they all share the same height
+        // Each character has an XY start offset, a width, and the rows of the line it covers
         struct Glyph
         {
             uint16_t x, y, w;
             int16_t bearing;
             uint16_t advance;
+            uint16_t top, h;    // Offset below the top of the line and height
         };
 
         const Glyph* GetGlyph( wchar_t ch ) const
@@ -142,6 +193,9 @@ namespace TextRenderer
         // Get the texture object
         const Texture& GetTexture( void ) const { return m_Texture; }
 
+        // Multi-channel fields keep corners sharp by taking the median of RGB
+        bool IsMultiChannel( void ) const { return m_NumChannels > 1; }
+
         float GetXNormalizationFactor() const { return m_NormalizeXCoord; }
         float GetYNormalizationFactor() const { return m_NormalizeYCoord; }
 
@@ -149,6 +203,7 @@ namespace TextRenderer
         // in screen space (according to the specified font size.)
         // The pixel alpha should range from 0 to 1 over the height range 0.5 +/- 0.5 * aaRange.
         float GetAntialiasRange( float size ) const { return Max( 1.0f, size * m_AntialiasRange ); }
+        float GetAntialiasScale( void ) const { return m_AntialiasRange; }
 
     private:
         float m_NormalizeXCoord;
@@ -159,6 +214,7 @@ namespace TextRenderer
         uint16_t m_BorderSize;
         uint16_t m_TextureWidth;
         uint16_t m_TextureHeight;
+        uint16_t m_NumChannels;
         Texture m_Texture;
         map<wchar_t, Glyph> m_Dictionary;
     };
@@ -180,6 +236,49 @@ namespace TextRenderer
         return newFont;
     }
 
+    // A string laid out from a cursor at the origin.  Strings are matched on their characters, font, size, and
+    // left margin, so a line that did not change since the last frame is copied rather than laid out again.
+    struct GlyphRun
+    {
+        struct Quad
+        {
+            float X, Y;
+            uint16_t U, V, W, H;
+        };
+
+        GlyphRun() : RunFont(nullptr), TextSize(0.0f), LeftMargin(0.0f), Stride(0), EndX(0.0f), EndY(0.0f), LastFrame(0) {}
+
+        std::string Text;
+        const Font* RunFont;
+        float TextSize;
+        float LeftMargin;           // Relative to the cursor
+        uint32_t Stride;
+        float EndX, EndY;           // Where the cursor moved to
+        uint64_t LastFrame;
+        std::vector<Quad> Glyphs;
+    };
+
+    // Runs not drawn for a few frames are released once there are more than this
+    const size_t kMaxGlyphRuns = 1024;
+
+    unordered_map<size_t, GlyphRun> s_GlyphRuns;
+    mutex s_GlyphRunMutex;
+
+    size_t HashGlyphRun( const char* str, size_t bytes, const Font* font, float size, float margin, uint32_t stride )
+    {
+        struct
+        {
+            uint64_t Font;
+            float Size, Margin;
+            uint32_t Stride, Pad;
+        } Key = { (uint64_t)font, size, margin, stride, 0 };
+
+        size_t Hash = Utility::HashState(&Key);
+        for (size_t i = 0; i < bytes; ++i)
+            Hash = 16777619U * Hash ^ (uint8_t)str[i];
+        return Hash;
+    }
+
     RootSignature s_RootSignature;
     GraphicsPSO s_TextPSO[2];    // 0: R8G8B8A8_UNORM   1: R11G11B10_FLOAT
     GraphicsPSO s_ShadowPSO[2];    // 0: R8G8B8A8_UNORM   1: R11G11B10_FLOAT
@@ -199,8 +298,10 @@ void TextRenderer::Initialize( void )
     // The glyph vertex description.  One vertex will correspond to a single character.
     D3D12_INPUT_ELEMENT_DESC vertElem[] =
     {
-        { "POSITION", 0, DXGI_FORMAT_R32G32_FLOAT     , 0, 0, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 },
-        { "TEXCOORD", 0, DXGI_FORMAT_R16G16B16A16_UINT, 0, 8, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 }
+        { "POSITION", 0, DXGI_FORMAT_R32G32_FLOAT      , 0,  0, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 },
+        { "TEXCOORD", 0, DXGI_FORMAT_R16G16B16A16_UINT , 0,  8, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 },
+        { "TEXCOORD", 1, DXGI_FORMAT_R32_FLOAT         , 0, 16, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 },
+        { "COLOR",    0, DXGI_FORMAT_R16G16B16A16_FLOAT, 0, 20, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 }
     };
 
     s_TextPSO[0].SetRootSignature(s_RootSignature);
@@ -229,6 +330,7 @@ void TextRenderer::Initialize( void )
 
 void TextRenderer::Shutdown( void )
 {
+    s_GlyphRuns.clear();
     LoadedFonts.clear();
 }
 
@@ -237,6 +339,8 @@ TextContext::TextContext( GraphicsContext& CmdContext, float ViewWidth, float Vi
 {
     m_HDR = FALSE;
     m_CurrentFont = nullptr;
+    m_TextSize = 0.0f;
+    m_TextScale = 1.0f;
     m_ViewWidth = ViewWidth;
     m_ViewHeight = ViewHeight;
 
@@ -250,10 +354,16 @@ TextContext::TextContext( GraphicsContext& CmdContext, float ViewWidth, float Vi
     // The font texture dimensions are still unknown
     m_VSParams.NormalizeX = 1.0f;
     m_VSParams.NormalizeY = 1.0f;
+    m_PSParams.MultiChannel = 0;
 
     ResetSettings();
 }
 
+TextContext::~TextContext()
+{
+    Flush();
+}
+
 void TextContext::ResetSettings( void )
 {
     m_EnableShadow = true;
@@ -262,7 +372,7 @@ void TextContext::ResetSettings( void )
     m_ShadowOffsetY = 0.05f;
     m_PSParams.ShadowHardness = 0.5f;
     m_PSParams.ShadowOpacity = 1.0f;
-    m_PSParams.TextColor = Color(1.0f, 1.0f, 1.0f, 1.0f);
+    SetColor(Color(1.0f, 1.0f, 1.0f, 1.0f));
 
     m_VSConstantBufferIsStale = true;
     m_PSConstantBufferIsStale = true;
@@ -294,6 +404,7 @@ void TextContext::EnableDropShadow(bool enable)
 
     m_EnableShadow = enable;
 
+    Flush();
     m_Context.SetPipelineState( m_EnableShadow ? TextRenderer::s_ShadowPSO[m_HDR] : TextRenderer::s_TextPSO[m_HDR] );
 }
 
@@ -315,8 +426,7 @@ void TextContext::SetShadowParams(float opacity, float width)
 
 void TextContext::SetColor( Color c )
 {
-    m_PSParams.TextColor = c;
-    m_PSConstantBufferIsStale = true;
+    DirectX::PackedVector::XMStoreHalf4((DirectX::PackedVector::XMHALF4*)m_TextColor, c);
 }
 
 float TextContext::GetVerticalSpacing( void )
@@ -326,6 +436,7 @@ float TextContext::GetVerticalSpacing( void )
 
 void TextContext::Begin( bool EnableHDR )
 {
+    Flush();
     ResetSettings();
 
     m_HDR = (BOOL)EnableHDR;
@@ -351,18 +462,20 @@ void TextContext::SetFont( const wstring& fontName, float size )
 
     // Check to see if a new size was specified
     if (size > 0.0f)
-        m_VSParams.TextSize = size;
+        m_TextSize = size;
 
     // Update constants directly tied to the font or the font size
-    m_LineHeight = NextFont->GetVerticalSpacing( m_VSParams.TextSize );
+    m_LineHeight = NextFont->GetVerticalSpacing( m_TextSize );
+    m_TextScale = m_TextSize / m_CurrentFont->GetHeight();
     m_VSParams.NormalizeX = m_CurrentFont->GetXNormalizationFactor();
     m_VSParams.NormalizeY = m_CurrentFont->GetYNormalizationFactor();
-    m_VSParams.Scale = m_VSParams.TextSize / m_CurrentFont->GetHeight();
-    m_VSParams.DstBorder = m_CurrentFont->GetBorderSize() * m_VSParams.Scale;
+    m_VSParams.RcpFontHeight = 1.0f / m_CurrentFont->GetHeight();
+    m_VSParams.BorderScale = m_CurrentFont->GetBorderSize() * m_VSParams.RcpFontHeight;
+    m_VSParams.AntialiasScale = m_CurrentFont->GetAntialiasScale();
     m_VSParams.SrcBorder = m_CurrentFont->GetBorderSize();
     m_PSParams.ShadowOffsetX = m_CurrentFont->GetHeight() * m_ShadowOffsetX * m_VSParams.NormalizeX;
     m_PSParams.ShadowOffsetY = m_CurrentFont->GetHeight() * m_ShadowOffsetY * m_VSParams.NormalizeY;
-    m_PSParams.HeightRange = m_CurrentFont->GetAntialiasRange( m_VSParams.TextSize );
+    m_PSParams.MultiChannel = m_CurrentFont->IsMultiChannel() ? 1 : 0;
     m_VSConstantBufferIsStale = true;
     m_PSConstantBufferIsStale = true;
     m_TextureIsStale = true;
@@ -370,18 +483,15 @@ void TextContext::SetFont( const wstring& fontName, float size )
 
 void TextContext::SetTextSize( float size )
 {
-    if (m_VSParams.TextSize == size)
+    if (m_TextSize == size)
         return;
 
-    m_VSParams.TextSize = size;
-    m_VSConstantBufferIsStale = true;
+    // The size travels with each glyph, so changing it does not break the batch
+    m_TextSize = size;
 
     if (m_CurrentFont != nullptr)
     {
-        m_PSParams.HeightRange = m_CurrentFont->GetAntialiasRange( m_VSParams.TextSize );
-        m_VSParams.Scale = m_VSParams.TextSize / m_CurrentFont->GetHeight();
-        m_VSParams.DstBorder = m_CurrentFont->GetBorderSize() * m_VSParams.Scale;
-        m_PSConstantBufferIsStale = true;
+        m_TextScale = m_TextSize / m_CurrentFont->GetHeight();
         m_LineHeight = m_CurrentFont->GetVerticalSpacing( size );
     }
     else
@@ -405,9 +515,35 @@ void TextContext::SetViewSize( float ViewWidth, float ViewHeight )
 
 void TextContext::End( void )
 {
+    Flush();
+
     m_VSConstantBufferIsStale = true;
     m_PSConstantBufferIsStale = true;
     m_TextureIsStale = true;
+
+    lock_guard<mutex> Lock(TextRenderer::s_GlyphRunMutex);
+
+    if (TextRenderer::s_GlyphRuns.size() > TextRenderer::kMaxGlyphRuns)
+    {
+        const uint64_t FrameCount = Graphics::GetFrameCount();
+        for (auto Iter = TextRenderer::s_GlyphRuns.begin(); Iter != TextRenderer::s_GlyphRuns.end(); )
+        {
+            if (Iter->second.LastFrame + 2 < FrameCount)
+                Iter = TextRenderer::s_GlyphRuns.erase(Iter);
+            else
+                ++Iter;
+        }
+    }
+}
+
+void TextContext::Flush( void )
+{
+    if (m_Batch.empty())
+        return;
+
+    m_Context.SetDynamicVB(0, m_Batch.size(), sizeof(TextVert), m_Batch.data());
+    m_Context.DrawInstanced( 4, (UINT)m_Batch.size() );
+    m_Batch.clear();
 }
 
 void TextContext::SetRenderState( void )
@@ -433,17 +569,15 @@ void TextContext::SetRenderState( void )
     }
 }
 
-// These are made with templates to handle char and wchar_t simultaneously.
-UINT TextContext::FillVertexBuffer( TextVert volatile* verts, const char* str, size_t stride, size_t slen )
+// Lays the string out from a cursor at the origin.  The characters are char or wchar_t according to stride.
+void TextContext::BuildGlyphRun( TextRenderer::GlyphRun& Run, const char* str, size_t stride, size_t slen )
 {
-    UINT charsDrawn = 0;
-
-    const float UVtoPixel = m_VSParams.Scale;
+    Run.Glyphs.clear();
 
-    float curX = m_TextPosX;
-    float curY = m_TextPosY;
+    const float UVtoPixel = m_TextScale;
 
-    const uint16_t texelHeight = m_CurrentFont->GetHeight();
+    float curX = 0.0f;
+    float curY = 0.0f;
 
     const char* iter = str;
     for (size_t i = 0; i < slen; ++i)
@@ -458,7 +592,7 @@ UINT TextContext::FillVertexBuffer( TextVert volatile* verts, const char* str, s
         // Handle newlines by inserting a carriage return and line feed
         if (wc == L'\n')
         {
-            curX = m_LeftMargin;
+            curX = Run.LeftMargin;
             curY += m_LineHeight;
             continue;
         }
@@ -469,57 +603,83 @@ UINT TextContext::FillVertexBuffer( TextVert volatile* verts, const char* str, s
         if (nullptr == gi)
             continue;
 
-        verts->X = curX + (float)gi->bearing * UVtoPixel;
-        verts->Y = curY;
-        verts->U = gi->x;
-        verts->V = gi->y;
-        verts->W = gi->w;
-        verts->H = texelHeight;
-        ++verts;
+        TextRenderer::GlyphRun::Quad Quad;
+        Quad.X = curX + (float)gi->bearing * UVtoPixel;
+        Quad.Y = curY + (float)gi->top * UVtoPixel;
+        Quad.U = gi->x;
+        Quad.V = gi->y;
+        Quad.W = gi->w;
+        Quad.H = gi->h;
+        Run.Glyphs.push_back(Quad);
 
         // Advance the cursor position
         curX += (float)gi->advance * UVtoPixel;
-        ++charsDrawn;
     }
 
-    m_TextPosX = curX;
-    m_TextPosY = curY;
-
-    return charsDrawn;
+    Run.EndX = curX;
+    Run.EndY = curY;
 }
 
-void TextContext::DrawString( const std::wstring& str )
+void TextContext::DrawStringInternal( const char* str, size_t stride, size_t slen )
 {
-    SetRenderState();
-
-    void* stackMem = _malloca((str.size() + 1) * 16);
-    TextVert* vbPtr = Math::AlignUp((TextVert*)stackMem, 16);
-    UINT primCount = FillVertexBuffer(vbPtr, (char*)str.c_str(), 2, str.size());
-
-    if (primCount > 0)
+    if (m_VSConstantBufferIsStale || m_PSConstantBufferIsStale || m_TextureIsStale)
     {
-        m_Context.SetDynamicVB(0, primCount, sizeof(TextVert), vbPtr);
-        m_Context.DrawInstanced( 4, primCount );
+        Flush();
+        SetRenderState();
     }
 
-    _freea(stackMem);
-}
+    if (m_CurrentFont == nullptr || slen == 0)
+        return;
 
-void TextContext::DrawString( const std::string& str )
-{
-    SetRenderState();
+    const size_t bytes = slen * stride;
+    const float LeftMargin = m_LeftMargin - m_TextPosX;
+    const size_t Hash = TextRenderer::HashGlyphRun(str, bytes, m_CurrentFont, m_TextSize, LeftMargin, (uint32_t)stride);
+
+    lock_guard<mutex> Lock(TextRenderer::s_GlyphRunMutex);
+
+    // Only strings that changed since they were last drawn are laid out again
+    TextRenderer::GlyphRun& Run = TextRenderer::s_GlyphRuns[Hash];
+    if (Run.RunFont != m_CurrentFont || Run.TextSize != m_TextSize || Run.LeftMargin != LeftMargin ||
+        Run.Stride != (uint32_t)stride || Run.Text.size() != bytes || memcmp(Run.Text.data(), str, bytes) != 0)
+    {
+        Run.Text.assign(str, bytes);
+        Run.RunFont = m_CurrentFont;
+        Run.TextSize = m_TextSize;
+        Run.LeftMargin = LeftMargin;
+        Run.Stride = (uint32_t)stride;
+        BuildGlyphRun(Run, str, stride, slen);
+    }
+    Run.LastFrame = Graphics::GetFrameCount();
 
-    void* stackMem = _malloca((str.size() + 1) * 16);
-    TextVert* vbPtr = Math::AlignUp((TextVert*)stackMem, 16);
-    UINT primCount = FillVertexBuffer(vbPtr, (char*)str.c_str(), 1, str.size());
+    const size_t First = m_Batch.size();
+    m_Batch.resize(First + Run.Glyphs.size());
 
-    if (primCount > 0)
+    for (size_t i = 0; i < Run.Glyphs.size(); ++i)
     {
-        m_Context.SetDynamicVB(0, primCount, sizeof(TextVert), vbPtr);
-        m_Context.DrawInstanced( 4, primCount );
+        const TextRenderer::GlyphRun::Quad& Quad = Run.Glyphs[i];
+        TextVert& Vert = m_Batch[First + i];
+        Vert.X = m_TextPosX + Quad.X;
+        Vert.Y = m_TextPosY + Quad.Y;
+        Vert.U = Quad.U;
+        Vert.V = Quad.V;
+        Vert.W = Quad.W;
+        Vert.H = Quad.H;
+        Vert.Size = m_TextSize;
+        memcpy(Vert.Color, m_TextColor, sizeof(m_TextColor));
     }
 
-    _freea(stackMem);
+    m_TextPosX += Run.EndX;
+    m_TextPosY += Run.EndY;
+}
+
+void TextContext::DrawString( const std::wstring& str )
+{
+    DrawStringInternal((const char*)str.c_str(), 2, str.size());
+}
+
+void TextContext::DrawString( const std::string& str )
+{
+    DrawStringInternal(str.c_str(), 1, str.size());
 }
 
 void TextContext::DrawFormattedString( const wchar_t* format, ... )
@@ -16,6 +16,7 @@
 #include "Color.h"
 #include "Math/Vector.h"
 #include <string>
+#include <vector>
 
 class Color;
 class GraphicsContext;
@@ -31,14 +32,17 @@ namespace TextRenderer
     void Shutdown( void );
 
     class Font;
+    struct GlyphRun;
 }
 
 class TextContext
 {
 public:
     TextContext( GraphicsContext& CmdContext, float CanvasWidth = 1920.0f, float CanvasHeight = 1080.0f );
+    ~TextContext();
 
-    GraphicsContext& GetCommandContext() const { return m_Context; }
+    // Batched text is submitted first, so that commands recorded on the context land after it
+    GraphicsContext& GetCommandContext() { Flush(); return m_Context; }
 
     // Put settings back to the defaults.
     void ResetSettings( void );
@@ -90,6 +94,10 @@ public:
     void Begin( bool EnableHDR = false );
     void End( void );
 
+    // Strings are batched until the font, the shadow parameters, or the pipeline change, and then drawn with
+    // one instanced draw.  Flush before drawing with the command context directly.
+    void Flush( void );
+
     // Draw a string
     void DrawString( const std::wstring& str );
     void DrawString( const std::string& str );
@@ -104,37 +112,41 @@ private:
     __declspec(align(16)) struct VertexShaderParams
     {
         Math::Vector4 ViewportTransform;
-        float NormalizeX, NormalizeY, TextSize;
-        float Scale, DstBorder;
+        float NormalizeX, NormalizeY;
+        float RcpFontHeight;        // Text size to the screen space size of a texel
+        float BorderScale;          // Screen space border per unit of text size
+        float AntialiasScale;       // Signed distance field range per unit of text size
         uint32_t SrcBorder;
     };
 
     __declspec(align(16)) struct PixelShaderParams
     {
-        Color TextColor;
         float ShadowOffsetX, ShadowOffsetY;
         float ShadowHardness;        // More than 1 will cause aliasing
         float ShadowOpacity;        // Should make less opaque when making softer
-        float HeightRange;
+        uint32_t MultiChannel;        // The font texture is a multi-channel distance field
     };
 
     void SetRenderState(void);
 
-    // 16 Byte structure to represent an entire glyph in the text vertex buffer
+    // 32 Byte structure to represent an entire glyph in the text vertex buffer
     __declspec(align(16)) struct TextVert
     {
         float X, Y;                // Upper-left glyph position in screen space
         uint16_t U, V, W, H;    // Upper-left glyph UV and the width in texture space
+        float Size;                // Text size in screen space
+        uint16_t Color[4];        // Text color in half precision
     };
 
-    UINT FillVertexBuffer( TextVert volatile* verts, const char* str, size_t stride, size_t slen );
-    void DrawStringInternal( const std::string& str );
-    void DrawStringInternal( const std::wstring& str );
+    void BuildGlyphRun( TextRenderer::GlyphRun& Run, const char* str, size_t stride, size_t slen );
+    void DrawStringInternal( const char* str, size_t stride, size_t slen );
 
     GraphicsContext& m_Context;
     const TextRenderer::Font* m_CurrentFont;
     VertexShaderParams m_VSParams;
     PixelShaderParams m_PSParams;
+    std::vector<TextVert> m_Batch;
+    uint16_t m_TextColor[4];
     bool m_VSConstantBufferIsStale;    // Tracks when the CB needs updating
     bool m_PSConstantBufferIsStale;    // Tracks when the CB needs updating
     bool m_TextureIsStale;
@@ -143,6 +155,8 @@ private:
     float m_TextPosX;
     float m_TextPosY;
     float m_LineHeight;
+    float m_TextSize;
+    float m_TextScale;                // TextSize / FontHeight
     float m_ViewWidth;                // Width of the drawable area
     float m_ViewHeight;                // Height of the drawable area
     float m_ShadowOffsetX;            // Percentage of the font's TextSize should the shadow be offset
@@ -0,0 +1,161 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "pch.h"
+#include "TextureConverter.h"
+#include "GraphicsCore.h"
+#include "CommandContext.h"
+#include "ColorBuffer.h"
+#include "GpuBuffer.h"
+#include "ReadbackBuffer.h"
+#include "dds.h"
+
+#include "CompiledShaders/BC1CompressCS.h"
+#include "CompiledShaders/BC3CompressCS.h"
+
+using namespace Graphics;
+using namespace DirectX;
+
+namespace TextureConverter
+{
+    RootSignature s_RootSignature;
+    ComputePSO s_BC1CompressCS;
+    ComputePSO s_BC3CompressCS;
+
+    struct MipLayout
+    {
+        uint32_t Width;
+        uint32_t Height;
+        uint32_t Offset;
+        uint32_t NumBytes;
+    };
+}
+
+void TextureConverter::Initialize( void )
+{
+    s_RootSignature.Reset(3, 0);
+    s_RootSignature[0].InitAsConstants(0, 5);
+    s_RootSignature[1].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 0, 1);
+    s_RootSignature[2].InitAsBufferUAV(0);
+    s_RootSignature.Finalize(L"Texture Converter");
+
+#define CreatePSO( ObjName, ShaderByteCode ) \
+    ObjName.SetRootSignature(s_RootSignature); \
+    ObjName.SetComputeShader(ShaderByteCode, sizeof(ShaderByteCode) ); \
+    ObjName.Finalize();
+
+    CreatePSO(s_BC1CompressCS, g_pBC1CompressCS);
+    CreatePSO(s_BC3CompressCS, g_pBC3CompressCS);
+
+#undef CreatePSO
+}
+
+void TextureConverter::Shutdown( void )
+{
+}
+
+bool TextureConverter::CanConvert( uint32_t Width, uint32_t Height )
+{
+    return Width > 0 && Height > 0 && (Width & 3) == 0 && (Height & 3) == 0 &&
+        Width <= D3D12_REQ_TEXTURE2D_U_OR_V_DIMENSION && Height <= D3D12_REQ_TEXTURE2D_U_OR_V_DIMENSION;
+}
+
+bool TextureConverter::ConvertToDDS( const uint32_t* Pixels, uint32_t Width, uint32_t Height, bool sRGB, bool HasAlpha,
+    std::vector<uint8_t>& DDSFile )
+{
+    if (!CanConvert(Width, Height))
+        return false;
+
+    DXGI_FORMAT Format;
+    if (HasAlpha)
+        Format = sRGB ? DXGI_FORMAT_BC3_UNORM_SRGB : DXGI_FORMAT_BC3_UNORM;
+    else
+        Format = sRGB ? DXGI_FORMAT_BC1_UNORM_SRGB : DXGI_FORMAT_BC1_UNORM;
+
+    const uint32_t BlockBytes = HasAlpha ? 16 : 8;
+
+    ColorBuffer Source;
+    Source.Create(L"Texture Conversion Source", Width, Height, 0,
+        sRGB ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM);
+    const uint32_t NumMips = Source.GetResource()->GetDesc().MipLevels;
+
+    // The mips are packed one after another with no padding between rows, as in a DDS file
+    MipLayout Mips[D3D12_REQ_MIP_LEVELS];
+    uint32_t TotalBytes = 0;
+    for (uint32_t Mip = 0; Mip < NumMips; ++Mip)
+    {
+        Mips[Mip].Width = std::max(Width >> Mip, 1u);
+        Mips[Mip].Height = std::max(Height >> Mip, 1u);
+        Mips[Mip].Offset = TotalBytes;
+        Mips[Mip].NumBytes = ((Mips[Mip].Width + 3) / 4) * ((Mips[Mip].Height + 3) / 4) * BlockBytes;
+        TotalBytes += Mips[Mip].NumBytes;
+    }
+
+    ByteAddressBuffer Blocks;
+    Blocks.Create(L"Texture Conversion Blocks", TotalBytes / 4, 4);
+
+    ReadbackBuffer Readback;
+    Readback.Create(L"Texture Conversion Readback", TotalBytes / 4, 4);
+
+    // The new texture is in the common state, so it is initialized on the copy queue
+    D3D12_SUBRESOURCE_DATA SubData;
+    SubData.pData = Pixels;
+    SubData.RowPitch = Width * 4;
+    SubData.SlicePitch = SubData.RowPitch * Height;
+    CommandContext::InitializeTexture(Source, 1, &SubData);
+
+    ComputeContext& Context = ComputeContext::Begin(L"Texture Conversion");
+
+    Source.GenerateMipMaps(Context);
+
+    Context.SetRootSignature(s_RootSignature);
+    Context.SetPipelineState(HasAlpha ? s_BC3CompressCS : s_BC1CompressCS);
+    Context.TransitionResource(Blocks, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    Context.SetDynamicDescriptor(1, 0, Source.GetSRV());
+    Context.SetBufferUAV(2, Blocks);
+
+    for (uint32_t Mip = 0; Mip < NumMips; ++Mip)
+    {
+        const uint32_t Constants[5] = { Mip, sRGB ? 1u : 0u, Mips[Mip].Width, Mips[Mip].Height, Mips[Mip].Offset };
+        Context.SetConstantArray(0, 5, Constants);
+        Context.Dispatch2D((Mips[Mip].Width + 3) / 4, (Mips[Mip].Height + 3) / 4);
+    }
+
+    Context.TransitionResource(Blocks, D3D12_RESOURCE_STATE_COPY_SOURCE, true);
+    Context.CopyBufferRegion(Readback, 0, Blocks, 0, TotalBytes);
+    Context.Finish(true);
+
+    DDS_HEADER Header = {};
+    Header.size = sizeof(DDS_HEADER);
+    Header.flags = DDS_HEADER_FLAGS_TEXTURE | DDS_HEADER_FLAGS_MIPMAP | DDS_HEADER_FLAGS_LINEARSIZE;
+    Header.height = Height;
+    Header.width = Width;
+    Header.pitchOrLinearSize = Mips[0].NumBytes;
+    Header.mipMapCount = NumMips;
+    Header.ddspf.size = sizeof(DDS_PIXELFORMAT);
+    Header.ddspf.flags = DDS_FOURCC;
+    Header.ddspf.fourCC = MAKEFOURCC('D', 'X', '1', '0');
+    Header.caps = DDS_SURFACE_FLAGS_TEXTURE | DDS_SURFACE_FLAGS_MIPMAP;
+
+    // The DX10 header is needed to tell the sRGB formats apart
+    DDS_HEADER_DXT10 Header10 = {};
+    Header10.dxgiFormat = Format;
+    Header10.resourceDimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+    Header10.arraySize = 1;
+
+    DDSFile.resize(sizeof(uint32_t) + sizeof(Header) + sizeof(Header10) + TotalBytes);
+    uint8_t* Dest = DDSFile.data();
+    memcpy(Dest, &DDS_MAGIC, sizeof(uint32_t));
+    memcpy(Dest + sizeof(uint32_t), &Header, sizeof(Header));
+    memcpy(Dest + sizeof(uint32_t) + sizeof(Header), &Header10, sizeof(Header10));
+    memcpy(Dest + sizeof(uint32_t) + sizeof(Header) + sizeof(Header10), Readback.Map(), TotalBytes);
+    Readback.Unmap();
+
+    return true;
+}
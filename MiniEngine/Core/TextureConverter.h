@@ -0,0 +1,29 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#pragma once
+
+#include "pch.h"
+#include <vector>
+
+// Converts uncompressed images to block-compressed DDS files on the GPU.  The mip chain is generated with
+// ColorBuffer::GenerateMipMaps(), and every mip is compressed by a compute shader and read back.
+namespace TextureConverter
+{
+    void Initialize( void );
+    void Shutdown( void );
+
+    // Block compression requires both dimensions of the top mip to be multiples of 4
+    bool CanConvert( uint32_t Width, uint32_t Height );
+
+    // Compresses 8-bit RGBA pixels, with red in the low byte, to BC1 or, when the image has alpha, to BC3.  The
+    // returned DDS file has a full mip chain.  This waits for the GPU, and may be called from any thread.
+    bool ConvertToDDS( const uint32_t* Pixels, uint32_t Width, uint32_t Height, bool sRGB, bool HasAlpha,
+        std::vector<uint8_t>& DDSFile );
+}
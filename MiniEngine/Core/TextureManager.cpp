@@ -18,8 +18,19 @@
 #include "DDSTextureLoader.h"
 #include "GraphicsCore.h"
 #include "CommandContext.h"
+#include "TextureConverter.h"
+#include "EngineTuning.h"
+#include "Hash.h"
+#include "DynamicDescriptorHeap.h"
+#include "GpuMemoryPool.h"
+#include "GpuMemoryTracker.h"
+#include "StartupProfile.h"
 #include <map>
+#include <algorithm>
 #include <thread>
+#include <fstream>
+#include <functional>
+#include <tuple>
 
 using namespace std;
 using namespace Graphics;
@@ -29,47 +40,159 @@ static UINT BytesPerPixel( DXGI_FORMAT Format )
     return (UINT)BitsPerPixel(Format) / 8;
 };
 
+// The typeless format of a texture whose mips GenerateMissingMips() can write, or DXGI_FORMAT_UNKNOWN
+static DXGI_FORMAT GetMipGenerationFormat( DXGI_FORMAT Format )
+{
+    switch (Format)
+    {
+    case DXGI_FORMAT_R8G8B8A8_UNORM:
+    case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+        return DXGI_FORMAT_R8G8B8A8_TYPELESS;
+    case DXGI_FORMAT_R10G10B10A2_UNORM:
+        return DXGI_FORMAT_R10G10B10A2_TYPELESS;
+    case DXGI_FORMAT_R16G16B16A16_FLOAT:
+        return DXGI_FORMAT_R16G16B16A16_TYPELESS;
+    case DXGI_FORMAT_R32G32B32A32_FLOAT:
+        return DXGI_FORMAT_R32G32B32A32_TYPELESS;
+    default:
+        return DXGI_FORMAT_UNKNOWN;
+    }
+}
+
+// The format to view a texture in, which for the typeless resources of generated mips depends on the texture
+static DXGI_FORMAT GetViewFormat( DXGI_FORMAT ResourceFormat, bool sRGB )
+{
+    switch (ResourceFormat)
+    {
+    case DXGI_FORMAT_R8G8B8A8_TYPELESS:
+        return sRGB ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM;
+    case DXGI_FORMAT_R10G10B10A2_TYPELESS:
+        return DXGI_FORMAT_R10G10B10A2_UNORM;
+    case DXGI_FORMAT_R16G16B16A16_TYPELESS:
+        return DXGI_FORMAT_R16G16B16A16_FLOAT;
+    case DXGI_FORMAT_R32G32B32A32_TYPELESS:
+        return DXGI_FORMAT_R32G32B32A32_FLOAT;
+    default:
+        return ResourceFormat;
+    }
+}
+
+// A texture whose top mip has been uploaded and whose other mips are left to GenerateMissingMips()
+struct PendingMips
+{
+    GpuResource Resource;               // Tracks the state the upload left the texture in
+    D3D12_CPU_DESCRIPTOR_HANDLE SRV;
+    DXGI_FORMAT Format;
+    uint32_t Width;
+    uint32_t Height;
+    uint32_t NumMips;
+};
+
+static mutex s_PendingMipsMutex;
+static vector<PendingMips> s_PendingMips;
+
+void Texture::Destroy()
+{
+    GpuResource::Destroy();
+    if (m_hCpuDescriptorHandle.ptr != 0 && m_hCpuDescriptorHandle.ptr != D3D12_GPU_VIRTUAL_ADDRESS_UNKNOWN)
+        FreeDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, m_hCpuDescriptorHandle);
+    m_hCpuDescriptorHandle.ptr = 0;
+}
+
 void Texture::Create( size_t Pitch, size_t Width, size_t Height, DXGI_FORMAT Format, const void* InitialData )
 {
+    Create2D(Pitch * BytesPerPixel(Format), Width, Height, Format, InitialData, false);
+}
+
+void Texture::Create2D( size_t RowPitch, size_t Width, size_t Height, DXGI_FORMAT Format, const void* InitialData,
+    bool ReserveMips, bool BatchedUpload )
+{
+    const DXGI_FORMAT MipFormat = GetMipGenerationFormat(Format);
+    ReserveMips = ReserveMips && MipFormat != DXGI_FORMAT_UNKNOWN && (Width > 1 || Height > 1);
+
     m_UsageState = D3D12_RESOURCE_STATE_COPY_DEST;
 
+    // The mips are written through UAVs, which cannot be sRGB, so the resource is typeless
     D3D12_RESOURCE_DESC texDesc = {};
     texDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
     texDesc.Width = Width;
     texDesc.Height = (UINT)Height;
     texDesc.DepthOrArraySize = 1;
-    texDesc.MipLevels = 1;
-    texDesc.Format = Format;
+    texDesc.MipLevels = ReserveMips ? 0 : 1;
+    texDesc.Format = ReserveMips ? MipFormat : Format;
     texDesc.SampleDesc.Count = 1;
     texDesc.SampleDesc.Quality = 0;
     texDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
-    texDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
-
-    D3D12_HEAP_PROPERTIES HeapProps;
-    HeapProps.Type = D3D12_HEAP_TYPE_DEFAULT;
-    HeapProps.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
-    HeapProps.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
-    HeapProps.CreationNodeMask = 1;
-    HeapProps.VisibleNodeMask = 1;
+    texDesc.Flags = ReserveMips ? D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS : D3D12_RESOURCE_FLAG_NONE;
 
-    ASSERT_SUCCEEDED(g_Device->CreateCommittedResource(&HeapProps, D3D12_HEAP_FLAG_NONE, &texDesc,
-        m_UsageState, nullptr, MY_IID_PPV_ARGS(m_pResource.ReleaseAndGetAddressOf())));
+    ASSERT_SUCCEEDED(GpuMemoryPool::CreateResource(texDesc, m_UsageState,
+        MY_IID_PPV_ARGS(m_pResource.ReleaseAndGetAddressOf())));
+    GpuMemoryTracker::TrackResource(m_pResource.Get(), GpuMemoryTracker::kTextures);
 
     m_pResource->SetName(L"Texture");
 
     D3D12_SUBRESOURCE_DATA texResource;
     texResource.pData = InitialData;
-    texResource.RowPitch = Pitch * BytesPerPixel(Format);
+    texResource.RowPitch = RowPitch;
     texResource.SlicePitch = texResource.RowPitch * Height;
 
-    CommandContext::InitializeTexture(*this, 1, &texResource);
+    if (BatchedUpload && GetRequiredIntermediateSize(m_pResource.Get(), 0, 1) <= AssetIO::GetMaxStagedUpload())
+    {
+        // The copy queue leaves the texture in the common state
+        AssetIO::UploadTexture(*this, 1, &texResource);
+        m_UsageState = D3D12_RESOURCE_STATE_COMMON;
+    }
+    else
+    {
+        CommandContext::InitializeTexture(*this, 1, &texResource);
+    }
+
+    // The handle is only published once the view exists, because threads waiting on a load watch for it
+    D3D12_CPU_DESCRIPTOR_HANDLE Handle = m_hCpuDescriptorHandle;
+    if (Handle.ptr == D3D12_GPU_VIRTUAL_ADDRESS_UNKNOWN)
+        Handle = AllocateDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
 
-    if (m_hCpuDescriptorHandle.ptr == D3D12_GPU_VIRTUAL_ADDRESS_UNKNOWN)
-        m_hCpuDescriptorHandle = AllocateDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
-    g_Device->CreateShaderResourceView(m_pResource.Get(), nullptr, m_hCpuDescriptorHandle);
+    if (ReserveMips)
+    {
+        D3D12_SHADER_RESOURCE_VIEW_DESC SRVDesc = {};
+        SRVDesc.Format = Format;
+        SRVDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+        SRVDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+        SRVDesc.Texture2D.MipLevels = 1;
+        g_Device->CreateShaderResourceView(m_pResource.Get(), &SRVDesc, Handle);
+
+        PendingMips Pending = { GpuResource(m_pResource.Get(), m_UsageState), Handle, Format,
+            (uint32_t)Width, (uint32_t)Height, m_pResource->GetDesc().MipLevels };
+
+        lock_guard<mutex> Guard(s_PendingMipsMutex);
+        s_PendingMips.push_back(Pending);
+    }
+    else
+    {
+        g_Device->CreateShaderResourceView(m_pResource.Get(), nullptr, Handle);
+    }
+
+    m_hCpuDescriptorHandle = Handle;
 }
 
-void Texture::CreateTGAFromMemory( const void* _filePtr, size_t, bool sRGB )
+// An uncompressed image as 8-bit RGBA, with red in the low byte
+struct DecodedImage
+{
+    uint32_t Width;
+    uint32_t Height;
+    vector<uint32_t> Pixels;
+    bool HasAlpha;              // Some texel is not fully opaque
+};
+
+struct PIXImageHeader
+{
+    DXGI_FORMAT Format;
+    uint32_t Pitch;
+    uint32_t Width;
+    uint32_t Height;
+};
+
+static void DecodeTGA( const void* _filePtr, DecodedImage& Image )
 {
     const uint8_t* filePtr = (const uint8_t*)_filePtr;
 
@@ -90,8 +213,11 @@ void Texture::CreateTGAFromMemory( const void* _filePtr, size_t, bool sRGB )
     // Ignore another byte
     filePtr++;
 
-    uint32_t* formattedData = new uint32_t[imageWidth * imageHeight];
-    uint32_t* iter = formattedData;
+    Image.Width = imageWidth;
+    Image.Height = imageHeight;
+    Image.Pixels.resize(imageWidth * imageHeight);
+    Image.HasAlpha = false;
+    uint32_t* iter = Image.Pixels.data();
 
     uint8_t numChannels = bitCount / 8;
     uint32_t numBytes = imageWidth * imageHeight * numChannels;
@@ -111,48 +237,104 @@ void Texture::CreateTGAFromMemory( const void* _filePtr, size_t, bool sRGB )
         for (uint32_t byteIdx = 0; byteIdx < numBytes; byteIdx += 4)
         {
             *iter++ = filePtr[3] << 24 | filePtr[0] << 16 | filePtr[1] << 8 | filePtr[2];
+            Image.HasAlpha |= filePtr[3] != 0xff;
             filePtr += 4;
         }
         break;
     }
+}
+
+// Only 8-bit RGBA images can be decoded for conversion
+static bool DecodePIXImage( const void* memBuffer, size_t fileSize, DecodedImage& Image )
+{
+    if (fileSize < sizeof(PIXImageHeader))
+        return false;
 
-    Create( imageWidth, imageHeight, sRGB ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM, formattedData );
+    const PIXImageHeader& header = *(const PIXImageHeader*)memBuffer;
+    if ((header.Format != DXGI_FORMAT_R8G8B8A8_UNORM && header.Format != DXGI_FORMAT_R8G8B8A8_UNORM_SRGB) ||
+        header.Pitch < header.Width || fileSize < header.Pitch * 4ull * header.Height + sizeof(PIXImageHeader))
+        return false;
 
-    delete [] formattedData;
+    Image.Width = header.Width;
+    Image.Height = header.Height;
+    Image.Pixels.resize(header.Width * header.Height);
+    Image.HasAlpha = false;
+
+    const uint32_t* Rows = (const uint32_t*)((const uint8_t*)memBuffer + sizeof(PIXImageHeader));
+    for (uint32_t y = 0; y < header.Height; ++y)
+    {
+        for (uint32_t x = 0; x < header.Width; ++x)
+        {
+            const uint32_t Pixel = Rows[y * header.Pitch + x];
+            Image.Pixels[y * header.Width + x] = Pixel;
+            Image.HasAlpha |= (Pixel >> 24) != 0xff;
+        }
+    }
+
+    return true;
 }
 
-bool Texture::CreateDDSFromMemory( const void* filePtr, size_t fileSize, bool sRGB )
+void Texture::CreateTGAFromMemory( const void* filePtr, size_t, bool sRGB )
 {
-    if (m_hCpuDescriptorHandle.ptr == D3D12_GPU_VIRTUAL_ADDRESS_UNKNOWN)
-        m_hCpuDescriptorHandle = AllocateDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+    DecodedImage Image;
+    DecodeTGA(filePtr, Image);
+
+    Create2D( Image.Width * 4, Image.Width, Image.Height,
+        sRGB ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM, Image.Pixels.data(), true );
+}
+
+bool Texture::CreateDDSFromMemory( const void* filePtr, size_t fileSize, bool sRGB, bool BatchedUpload )
+{
+    // A file with only its top mip gets the rest generated when the format allows it
+    DDS_TEXTURE_LAYOUT Layout;
+    if (SUCCEEDED(GetDDSTextureLayout((const uint8_t*)filePtr, fileSize, sRGB, &Layout)) && Layout.mipCount == 1 &&
+        (Layout.width > 1 || Layout.height > 1) && GetMipGenerationFormat(Layout.format) != DXGI_FORMAT_UNKNOWN &&
+        Layout.mips[0].offset + Layout.mips[0].numBytes <= fileSize)
+    {
+        Create2D(Layout.mips[0].rowBytes, Layout.width, Layout.height, Layout.format,
+            (const uint8_t*)filePtr + Layout.mips[0].offset, true, BatchedUpload);
+        return true;
+    }
+
+    // The handle is only published once the texture exists, because threads waiting on a load watch for it
+    D3D12_CPU_DESCRIPTOR_HANDLE Handle = m_hCpuDescriptorHandle;
+    if (Handle.ptr == D3D12_GPU_VIRTUAL_ADDRESS_UNKNOWN)
+        Handle = AllocateDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
 
     HRESULT hr = CreateDDSTextureFromMemory( Graphics::g_Device,
-        (const uint8_t*)filePtr, fileSize, 0, sRGB, &m_pResource, m_hCpuDescriptorHandle );
+        (const uint8_t*)filePtr, fileSize, 0, sRGB, &m_pResource, Handle, nullptr, BatchedUpload );
+
+    if (SUCCEEDED(hr))
+    {
+        GpuMemoryTracker::TrackResource(m_pResource.Get(), GpuMemoryTracker::kTextures);
+        m_hCpuDescriptorHandle = Handle;
+    }
 
     return SUCCEEDED(hr);
 }
 
 void Texture::CreatePIXImageFromMemory( const void* memBuffer, size_t fileSize )
 {
-    struct Header
-    {
-        DXGI_FORMAT Format;
-        uint32_t Pitch;
-        uint32_t Width;
-        uint32_t Height;
-    };
-    const Header& header = *(Header*)memBuffer;
+    const PIXImageHeader& header = *(PIXImageHeader*)memBuffer;
 
-    ASSERT(fileSize >= header.Pitch * BytesPerPixel(header.Format) * header.Height + sizeof(Header),
+    ASSERT(fileSize >= header.Pitch * BytesPerPixel(header.Format) * header.Height + sizeof(PIXImageHeader),
         "Raw PIX image dump has an invalid file size");
 
-    Create(header.Pitch, header.Width, header.Height, header.Format, (uint8_t*)memBuffer + sizeof(Header));
+    Create2D(header.Pitch * BytesPerPixel(header.Format), header.Width, header.Height, header.Format,
+        (uint8_t*)memBuffer + sizeof(PIXImageHeader), true);
 }
 
 namespace TextureManager
 {
     wstring s_RootPath = L"";
     map< wstring, unique_ptr<ManagedTexture> > s_TextureCache;
+    mutex s_TextureCacheMutex;
+
+    // Uncompressed images are converted to BC-compressed DDS files with mips, which are kept in a directory
+    // under the root path.  Bump the version when the conversion changes to convert every image again.
+    BoolVar s_EnableTextureCache("Graphics/Texture Cache/Enable", true);
+    const wchar_t* const kCacheDirectory = L"Cache/";
+    const uint32_t kCacheVersion = 1;
 
     void Initialize( const std::wstring& TextureLibRoot )
     {
@@ -161,13 +343,18 @@ namespace TextureManager
 
     void Shutdown( void )
     {
+        s_PendingMips.clear();
         s_TextureCache.clear();
     }
 
+    const std::wstring& GetRootPath( void )
+    {
+        return s_RootPath;
+    }
+
     pair<ManagedTexture*, bool> FindOrLoadTexture( const wstring& fileName )
     {
-        static mutex s_Mutex;
-        lock_guard<mutex> Guard(s_Mutex);
+        lock_guard<mutex> Guard(s_TextureCacheMutex);
 
         auto iter = s_TextureCache.find(fileName);
 
@@ -182,6 +369,373 @@ namespace TextureManager
         return make_pair(NewTexture, true);
     }
 
+    // The cached file is named after the image and a hash of its contents, so an edited image is converted again
+    wstring GetCachePath( const wstring& fileName, const Utility::ByteArray& Source, bool sRGB )
+    {
+        const uint8_t* Data = (const uint8_t*)Source->data();
+        const size_t Size = Source->size();
+
+        uint32_t Tail[3] = { 0, (uint32_t)Size, kCacheVersion };
+        memcpy(Tail, Data + (Size & ~3ull), Size & 3);
+        size_t Hash = Utility::HashRange((const uint32_t*)Data, (const uint32_t*)Data + Size / 4, 2166136261U);
+        Hash = Utility::HashState(Tail, 3, Hash);
+
+        wchar_t Suffix[32];
+        swprintf_s(Suffix, L"-%08x%s.dds", (uint32_t)Hash, sRGB ? L"-srgb" : L"");
+        return s_RootPath + kCacheDirectory + fileName.substr(fileName.find_last_of(L"/\\") + 1) + Suffix;
+    }
+
+    // Creates the texture from the converted image in the cache, converting the image and adding it to the
+    // cache when it is not there.  Returns false when the image cannot be converted, so it is created as is.
+    bool LoadConvertedImage( ManagedTexture& Tex, const wstring& fileName, const Utility::ByteArray& Source,
+        bool sRGB, const function<bool(DecodedImage&)>& Decode )
+    {
+        if (!s_EnableTextureCache)
+            return false;
+
+        const wstring CachePath = GetCachePath(fileName, Source, sRGB);
+        Utility::ByteArray Cached = Utility::ReadFileSync(CachePath);
+        if (Cached->size() > 0 && Tex.CreateDDSFromMemory(Cached->data(), Cached->size(), sRGB))
+            return true;
+
+        DecodedImage Image;
+        vector<uint8_t> DDSFile;
+        if (!Decode(Image) ||
+            !TextureConverter::ConvertToDDS(Image.Pixels.data(), Image.Width, Image.Height, sRGB, Image.HasAlpha, DDSFile))
+            return false;
+
+        // Failing to write the cache only means converting again next time
+        CreateDirectoryW((s_RootPath + kCacheDirectory).c_str(), nullptr);
+        ofstream CacheFile(CachePath, ios::out | ios::binary);
+        if (CacheFile)
+            CacheFile.write((const char*)DDSFile.data(), DDSFile.size());
+        else
+            Utility::Printf(L"Couldn't write texture cache file %s\n", CachePath.c_str());
+
+        return Tex.CreateDDSFromMemory(DDSFile.data(), DDSFile.size(), sRGB);
+    }
+
+    // Matches MipBatchEntry in GenerateMipsBatchCS.hlsl
+    struct MipBatchEntry
+    {
+        uint32_t SrcMipLevel;
+        uint32_t NumMipLevels;
+        float TexelSize[2];
+        uint32_t DstSize[2];
+        uint32_t NonPowerOfTwo;
+        uint32_t ConvertToSRGB;
+    };
+
+    // Views written for each batch.  They are copied to the dynamic descriptor heap when each dispatch is
+    // recorded, so they can be rewritten for the next one.
+    D3D12_CPU_DESCRIPTOR_HANDLE s_MipBatchSRVs = { 0 };
+    D3D12_CPU_DESCRIPTOR_HANDLE s_MipBatchUAVs = { 0 };
+    D3D12_CPU_DESCRIPTOR_HANDLE s_NullUAV = { 0 };
+
+    D3D12_CPU_DESCRIPTOR_HANDLE OffsetHandle( D3D12_CPU_DESCRIPTOR_HANDLE Handle, uint32_t Index )
+    {
+        static const UINT DescriptorSize = g_Device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+        Handle.ptr += Index * DescriptorSize;
+        return Handle;
+    }
+
+    // Each pass generates up to four mips of every texture in the batch with one dispatch, which covers the
+    // largest of them, and is followed by one set of UAV barriers.  Like ColorBuffer::GenerateMipMaps(), a texture
+    // stops a pass early at an odd dimension, so textures of a batch may take different numbers of passes.
+    void GenerateMipsBatch( ComputeContext& Context, PendingMips* Textures, uint32_t Count )
+    {
+        D3D12_CPU_DESCRIPTOR_HANDLE SrcMips[kGenerateMipsBatchSize];
+        uint32_t TopMip[kGenerateMipsBatchSize];
+
+        for (uint32_t i = 0; i < Count; ++i)
+        {
+            D3D12_SHADER_RESOURCE_VIEW_DESC SRVDesc = {};
+            SRVDesc.Format = Textures[i].Format;
+            SRVDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+            SRVDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+            SRVDesc.Texture2D.MipLevels = (UINT)-1;
+
+            SrcMips[i] = OffsetHandle(s_MipBatchSRVs, i);
+            g_Device->CreateShaderResourceView(Textures[i].Resource.GetResource(), &SRVDesc, SrcMips[i]);
+            Context.TransitionResource(Textures[i].Resource, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+            TopMip[i] = 0;
+        }
+
+        Context.SetDynamicDescriptors(1, 0, Count, SrcMips);
+
+        for (;;)
+        {
+            MipBatchEntry Entries[kGenerateMipsBatchSize] = {};
+            D3D12_CPU_DESCRIPTOR_HANDLE OutMips[4][kGenerateMipsBatchSize];
+            uint32_t GroupsX = 0;
+            uint32_t GroupsY = 0;
+
+            for (uint32_t i = 0; i < Count; ++i)
+            {
+                for (uint32_t Level = 0; Level < 4; ++Level)
+                    OutMips[Level][i] = s_NullUAV;
+
+                const PendingMips& Tex = Textures[i];
+                if (TopMip[i] + 1 >= Tex.NumMips)
+                    continue;
+
+                uint32_t SrcWidth = Tex.Width >> TopMip[i];
+                uint32_t SrcHeight = Tex.Height >> TopMip[i];
+                uint32_t DstWidth = SrcWidth >> 1;
+                uint32_t DstHeight = SrcHeight >> 1;
+
+                // Zeros in the low bits of the destination size tell how many more times it halves exactly
+                uint32_t AdditionalMips;
+                _BitScanForward((unsigned long*)&AdditionalMips,
+                    (DstWidth == 1 ? DstHeight : DstWidth) | (DstHeight == 1 ? DstWidth : DstHeight));
+                uint32_t NumMips = std::min(1 + std::min(AdditionalMips, 3u), Tex.NumMips - 1 - TopMip[i]);
+
+                DstWidth = std::max(DstWidth, 1u);
+                DstHeight = std::max(DstHeight, 1u);
+
+                MipBatchEntry& Entry = Entries[i];
+                Entry.SrcMipLevel = TopMip[i];
+                Entry.NumMipLevels = NumMips;
+                Entry.TexelSize[0] = 1.0f / DstWidth;
+                Entry.TexelSize[1] = 1.0f / DstHeight;
+                Entry.DstSize[0] = DstWidth;
+                Entry.DstSize[1] = DstHeight;
+                Entry.NonPowerOfTwo = (SrcWidth & 1) | (SrcHeight & 1) << 1;
+                Entry.ConvertToSRGB = Tex.Format == DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+
+                for (uint32_t Level = 0; Level < NumMips; ++Level)
+                {
+                    D3D12_UNORDERED_ACCESS_VIEW_DESC UAVDesc = {};
+                    UAVDesc.Format = Entry.ConvertToSRGB ? DXGI_FORMAT_R8G8B8A8_UNORM : Tex.Format;
+                    UAVDesc.ViewDimension = D3D12_UAV_DIMENSION_TEXTURE2D;
+                    UAVDesc.Texture2D.MipSlice = TopMip[i] + 1 + Level;
+
+                    OutMips[Level][i] = OffsetHandle(s_MipBatchUAVs, Level * kGenerateMipsBatchSize + i);
+                    g_Device->CreateUnorderedAccessView(Textures[i].Resource.GetResource(), nullptr, &UAVDesc, OutMips[Level][i]);
+                }
+
+                GroupsX = std::max(GroupsX, (DstWidth + 7) / 8);
+                GroupsY = std::max(GroupsY, (DstHeight + 7) / 8);
+                TopMip[i] += NumMips;
+            }
+
+            if (GroupsX == 0)
+                break;
+
+            Context.SetDynamicSRV(0, sizeof(MipBatchEntry) * Count, Entries);
+            for (uint32_t Level = 0; Level < 4; ++Level)
+                Context.SetDynamicDescriptors(2 + Level, 0, Count, OutMips[Level]);
+            Context.Dispatch(GroupsX, GroupsY, Count);
+
+            for (uint32_t i = 0; i < Count; ++i)
+                Context.InsertUAVBarrier(Textures[i].Resource);
+            Context.FlushResourceBarriers();
+        }
+
+        for (uint32_t i = 0; i < Count; ++i)
+        {
+            Context.TransitionResource(Textures[i].Resource, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE |
+                D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        }
+    }
+
+    void GenerateMissingMips( void )
+    {
+        vector<PendingMips> Pending;
+        {
+            lock_guard<mutex> Guard(s_PendingMipsMutex);
+            Pending.swap(s_PendingMips);
+        }
+
+        if (Pending.empty())
+            return;
+
+        if (s_NullUAV.ptr == 0)
+        {
+            s_MipBatchSRVs = AllocateDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, kGenerateMipsBatchSize);
+            s_MipBatchUAVs = AllocateDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, kGenerateMipsBatchSize * 4);
+            s_NullUAV = AllocateDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+
+            // Mips past the end of a texture's pass are never written, but every slot of a table needs a view
+            D3D12_UNORDERED_ACCESS_VIEW_DESC UAVDesc = {};
+            UAVDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+            UAVDesc.ViewDimension = D3D12_UAV_DIMENSION_TEXTURE2D;
+            g_Device->CreateUnorderedAccessView(nullptr, nullptr, &UAVDesc, s_NullUAV);
+        }
+
+        // The top mips of batched loads must land before they are read
+        AssetIO::Flush();
+
+        // Batching textures of similar sizes leaves fewer idle groups in each dispatch
+        sort(Pending.begin(), Pending.end(), []( const PendingMips& A, const PendingMips& B )
+        {
+            return (uint64_t)A.Width * A.Height > (uint64_t)B.Width * B.Height;
+        });
+
+        ComputeContext& Context = ComputeContext::Begin(L"Generate Missing Mips");
+        Context.SetRootSignature(g_GenerateMipsBatchRS);
+        Context.SetPipelineState(g_GenerateMipsBatchPSO);
+
+        for (size_t First = 0; First < Pending.size(); First += kGenerateMipsBatchSize)
+        {
+            const uint32_t Count = (uint32_t)std::min<size_t>(kGenerateMipsBatchSize, Pending.size() - First);
+            GenerateMipsBatch(Context, Pending.data() + First, Count);
+        }
+
+        Context.Finish();
+
+        // Work recorded from here on samples the whole mip chains.  Bindless tables hold copies of the views.
+        for (PendingMips& Tex : Pending)
+        {
+            D3D12_SHADER_RESOURCE_VIEW_DESC SRVDesc = {};
+            SRVDesc.Format = Tex.Format;
+            SRVDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+            SRVDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+            SRVDesc.Texture2D.MipLevels = (UINT)-1;
+            g_Device->CreateShaderResourceView(Tex.Resource.GetResource(), &SRVDesc, Tex.SRV);
+        }
+        DynamicDescriptorHeap::RefreshPersistentDescriptors();
+    }
+
+    void PackedTextures::Create( const Source* Sources, uint32_t Count )
+    {
+        Destroy();
+
+        // Arrays are copied a mip at a time, so the chains must be complete
+        GenerateMissingMips();
+
+        const Texture* Magenta = &GetMagentaTex2D();
+        const Texture* BuiltIns[] = { Magenta, &GetBlackTex2D(), &GetWhiteTex2D() };
+
+        // A texture used by several sources is packed once
+        struct Member
+        {
+            const Texture* Tex;
+            D3D12_RESOURCE_DESC Desc;
+            uint32_t Array;     // Into m_Arrays, or ~0u when viewed in its own resource
+            uint32_t Slice;
+        };
+        vector<Member> Members;
+        vector<uint32_t> MemberOfSource(Count);
+        map<const Texture*, uint32_t> MemberOfTexture;
+        map<tuple<DXGI_FORMAT, UINT64, UINT, UINT16>, vector<uint32_t>> Groups;
+
+        for (uint32_t i = 0; i < Count; ++i)
+        {
+            const Texture* Tex = Sources[i].Tex->GetResource() != nullptr ? Sources[i].Tex : Magenta;
+
+            auto Found = MemberOfTexture.emplace(Tex, (uint32_t)Members.size());
+            MemberOfSource[i] = Found.first->second;
+            if (!Found.second)
+                continue;
+
+            Member NewMember = { Tex, const_cast<ID3D12Resource*>(Tex->GetResource())->GetDesc(), ~0u, 0 };
+            Members.push_back(NewMember);
+
+            // Generated mips leave a texture in a state that it does not track
+            const D3D12_RESOURCE_DESC& Desc = NewMember.Desc;
+            if (find(begin(BuiltIns), end(BuiltIns), Tex) != end(BuiltIns) ||
+                Desc.Dimension != D3D12_RESOURCE_DIMENSION_TEXTURE2D || Desc.DepthOrArraySize != 1 ||
+                (Desc.Flags & D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS) != 0)
+                continue;
+
+            Groups[make_tuple(Desc.Format, Desc.Width, Desc.Height, Desc.MipLevels)].push_back(MemberOfSource[i]);
+        }
+
+        vector<const Texture*> Packed;
+        GraphicsContext& Context = GraphicsContext::Begin(L"Pack Textures");
+
+        for (auto& Group : Groups)
+        {
+            const vector<uint32_t>& Textures = Group.second;
+            uint32_t Slices = 0;
+            for (size_t First = 0; Textures.size() - First >= 2; First += Slices)
+            {
+                Slices = (uint32_t)std::min<size_t>(D3D12_REQ_TEXTURE2D_ARRAY_AXIS_DIMENSION, Textures.size() - First);
+
+                D3D12_RESOURCE_DESC ArrayDesc = Members[Textures[First]].Desc;
+                ArrayDesc.DepthOrArraySize = (UINT16)Slices;
+
+                // Every subresource is copied over, so the array may be placed
+                Microsoft::WRL::ComPtr<ID3D12Resource> Resource;
+                ASSERT_SUCCEEDED(GpuMemoryPool::CreateResource(ArrayDesc, D3D12_RESOURCE_STATE_COPY_DEST,
+                    MY_IID_PPV_ARGS(Resource.GetAddressOf())));
+                GpuMemoryTracker::TrackResource(Resource.Get(), GpuMemoryTracker::kTextures);
+                Resource->SetName(L"Packed Textures");
+
+                m_Arrays.emplace_back(Resource.Get(), D3D12_RESOURCE_STATE_COPY_DEST);
+                GpuResource& Array = m_Arrays.back();
+
+                for (uint32_t Slice = 0; Slice < Slices; ++Slice)
+                {
+                    Member& Tex = Members[Textures[First + Slice]];
+                    Tex.Array = (uint32_t)m_Arrays.size() - 1;
+                    Tex.Slice = Slice;
+
+                    // The texture is unloaded once copied, so a copy of it can track its state
+                    GpuResource Source = *Tex.Tex;
+                    Context.TransitionResource(Source, D3D12_RESOURCE_STATE_COPY_SOURCE);
+                    for (UINT Mip = 0; Mip < ArrayDesc.MipLevels; ++Mip)
+                    {
+                        Context.CopySubresource(Array, D3D12CalcSubresource(Mip, Slice, 0, ArrayDesc.MipLevels, Slices),
+                            Source, Mip);
+                    }
+                    Packed.push_back(Tex.Tex);
+                }
+
+                Context.TransitionResource(Array, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE |
+                    D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+            }
+        }
+
+        Context.Finish(true);
+
+        m_SRVs.resize(Count);
+        for (uint32_t i = 0; i < Count; ++i)
+        {
+            const Member& Tex = Members[MemberOfSource[i]];
+
+            ID3D12Resource* Resource = Tex.Array != ~0u ? m_Arrays[Tex.Array].GetResource() :
+                const_cast<ID3D12Resource*>(Tex.Tex->GetResource());
+
+            D3D12_SHADER_RESOURCE_VIEW_DESC SRVDesc = {};
+            SRVDesc.Format = GetViewFormat(Tex.Desc.Format, Sources[i].sRGB);
+            SRVDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
+            SRVDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+            SRVDesc.Texture2DArray.MipLevels = (UINT)-1;
+            SRVDesc.Texture2DArray.FirstArraySlice = Tex.Slice;
+            SRVDesc.Texture2DArray.ArraySize = 1;
+
+            m_SRVs[i] = AllocateDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+            g_Device->CreateShaderResourceView(Resource, &SRVDesc, m_SRVs[i]);
+        }
+
+        // Textures left in their own resources stay in the cache, which owns them
+        sort(Packed.begin(), Packed.end());
+        lock_guard<mutex> Guard(s_TextureCacheMutex);
+        for (auto iter = s_TextureCache.begin(); iter != s_TextureCache.end(); )
+        {
+            if (binary_search(Packed.begin(), Packed.end(), (const Texture*)iter->second.get()))
+            {
+                iter->second->Destroy();
+                iter = s_TextureCache.erase(iter);
+            }
+            else
+                ++iter;
+        }
+    }
+
+    void PackedTextures::Destroy( void )
+    {
+        for (D3D12_CPU_DESCRIPTOR_HANDLE& SRV : m_SRVs)
+            FreeDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, SRV);
+        m_SRVs.clear();
+
+        for (GpuResource& Array : m_Arrays)
+            Array.Destroy();
+        m_Arrays.clear();
+    }
+
     const Texture& GetBlackTex2D(void)
     {
         auto ManagedTex = FindOrLoadTexture(L"DefaultBlackTexture");
@@ -276,7 +830,11 @@ const ManagedTexture* TextureManager::LoadDDSFromFile( const std::wstring& fileN
         return ManTex;
     }
 
+    int64_t ReadTick = SystemTime::GetCurrentTick();
     Utility::ByteArray ba = Utility::ReadFileSync( s_RootPath + fileName );
+    StartupProfile::Record(StartupProfile::kTextureRead, ReadTick, SystemTime::GetCurrentTick(), ba->size());
+
+    StartupProfile::ScopedSpan Span(StartupProfile::kTextureUpload, ba->size());
     if (ba->size() == 0 || !ManTex->CreateDDSFromMemory( ba->data(), ba->size(), sRGB ))
         ManTex->SetToInvalidTexture();
     else
@@ -285,6 +843,53 @@ const ManagedTexture* TextureManager::LoadDDSFromFile( const std::wstring& fileN
     return ManTex;
 }
 
+void TextureManager::LoadDDSFromFileAsync( const std::wstring& fileName, bool sRGB, JobSystem::Counter& Group,
+    AssetIO::Priority Priority )
+{
+    auto ManagedTex = FindOrLoadTexture(fileName);
+
+    ManagedTexture* ManTex = ManagedTex.first;
+    const bool RequestsLoad = ManagedTex.second;
+
+    if (!RequestsLoad)
+        return;
+
+    auto CreateTexture = [ManTex, fileName, sRGB](const void* Data, size_t Size)
+    {
+        StartupProfile::ScopedSpan Span(StartupProfile::kTextureUpload, Size);
+        if (Size == 0 || !ManTex->CreateDDSFromMemory( Data, Size, sRGB, true ))
+            ManTex->SetToInvalidTexture();
+        else
+            ManTex->GetResource()->SetName(fileName.c_str());
+    };
+
+    // The blocks are decompressed in parallel by the worker running the callback and the ones it wakes.  When
+    // there is no compressed file, the callback is still counted by the group while it queues the plain read.
+    JobSystem::Counter* GroupPtr = &Group;
+    AssetIO::ReadFile(s_RootPath + fileName + Utility::kBlockFileSuffix, Priority,
+        [CreateTexture, fileName, Priority, GroupPtr](const void* Data, size_t Size)
+    {
+        if (Size == 0)
+        {
+            AssetIO::ReadFile(s_RootPath + fileName, Priority, CreateTexture, GroupPtr);
+            return;
+        }
+
+        const int64_t DecompressTick = SystemTime::GetCurrentTick();
+        const size_t DecompressedSize = Utility::GetBlockDecompressedSize(Data, Size);
+        std::vector<uint8_t> Decompressed(DecompressedSize);
+        if (DecompressedSize == 0 || !Utility::DecompressBlocks(Data, Size, Decompressed.data()))
+        {
+            Utility::Printf(L"Couldn't decompress block file %s%s\n", fileName.c_str(), Utility::kBlockFileSuffix);
+            Decompressed.clear();
+        }
+        StartupProfile::Record(StartupProfile::kTextureDecompress, DecompressTick, SystemTime::GetCurrentTick(),
+            Decompressed.size());
+
+        CreateTexture(Decompressed.data(), Decompressed.size());
+    }, &Group);
+}
+
 const ManagedTexture* TextureManager::LoadTGAFromFile( const std::wstring& fileName, bool sRGB )
 {
     auto ManagedTex = FindOrLoadTexture(fileName);
@@ -298,10 +903,17 @@ const ManagedTexture* TextureManager::LoadTGAFromFile( const std::wstring& fileN
         return ManTex;
     }
 
+    int64_t ReadTick = SystemTime::GetCurrentTick();
     Utility::ByteArray ba = Utility::ReadFileSync( s_RootPath + fileName );
+    StartupProfile::Record(StartupProfile::kTextureRead, ReadTick, SystemTime::GetCurrentTick(), ba->size());
+
+    // Decoding, conversion to the cached DDS and the upload are timed together
     if (ba->size() > 0)
     {
-        ManTex->CreateTGAFromMemory( ba->data(), ba->size(), sRGB );
+        StartupProfile::ScopedSpan Span(StartupProfile::kTextureDecode, ba->size());
+        auto Decode = [&ba](DecodedImage& Image) { DecodeTGA(ba->data(), Image); return true; };
+        if (!LoadConvertedImage(*ManTex, fileName, ba, sRGB, Decode))
+            ManTex->CreateTGAFromMemory( ba->data(), ba->size(), sRGB );
         ManTex->GetResource()->SetName(fileName.c_str());
     }
     else
@@ -327,7 +939,12 @@ const ManagedTexture* TextureManager::LoadPIXImageFromFile( const std::wstring&
     Utility::ByteArray ba = Utility::ReadFileSync( s_RootPath + fileName );
     if (ba->size() > 0)
     {
-        ManTex->CreatePIXImageFromMemory(ba->data(), ba->size());
+        // The format leads the header
+        const bool sRGB = ba->size() >= sizeof(PIXImageHeader) &&
+            *(const DXGI_FORMAT*)ba->data() == DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+        auto Decode = [&ba](DecodedImage& Image) { return DecodePIXImage(ba->data(), ba->size(), Image); };
+        if (!LoadConvertedImage(*ManTex, fileName, ba, sRGB, Decode))
+            ManTex->CreatePIXImageFromMemory(ba->data(), ba->size());
         ManTex->GetResource()->SetName(fileName.c_str());
     }
     else
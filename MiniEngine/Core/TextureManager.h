@@ -17,6 +17,7 @@
 #include "pch.h"
 #include "GpuResource.h"
 #include "Utility.h"
+#include "AssetIO.h"
 
 class Texture : public GpuResource
 {
@@ -35,15 +36,11 @@ public:
     }
 
     void CreateTGAFromMemory( const void* memBuffer, size_t fileSize, bool sRGB );
-    bool CreateDDSFromMemory( const void* memBuffer, size_t fileSize, bool sRGB );
+    bool CreateDDSFromMemory( const void* memBuffer, size_t fileSize, bool sRGB, bool BatchedUpload = false );
     void CreatePIXImageFromMemory( const void* memBuffer, size_t fileSize );
 
-    virtual void Destroy() override
-    {
-        GpuResource::Destroy();
-        // This leaks descriptor handles.  We should really give it back to be reused.
-        m_hCpuDescriptorHandle.ptr = 0;
-    }
+    // Also gives the view's descriptor back to be reused
+    virtual void Destroy() override;
 
     const D3D12_CPU_DESCRIPTOR_HANDLE& GetSRV() const { return m_hCpuDescriptorHandle; }
 
@@ -51,6 +48,12 @@ public:
 
 protected:
 
+    // Creates a 2D texture from its top mip.  With ReserveMips, a texture in a format that compute shaders can
+    // write gets room for a full mip chain, which TextureManager::GenerateMissingMips() fills in later.  Until
+    // then, its view shows only the top mip.
+    void Create2D( size_t RowPitch, size_t Width, size_t Height, DXGI_FORMAT Format, const void* InitData,
+        bool ReserveMips, bool BatchedUpload = false );
+
     D3D12_CPU_DESCRIPTOR_HANDLE m_hCpuDescriptorHandle;
 };
 
@@ -67,6 +70,14 @@ public:
     void SetToInvalidTexture(void);
     bool IsValid(void) const { return m_IsValid; }
 
+    // An invalid texture shows the magenta texture's view, which isn't its own to free
+    virtual void Destroy() override
+    {
+        if (!m_IsValid)
+            m_hCpuDescriptorHandle.ptr = 0;
+        Texture::Destroy();
+    }
+
 private:
     std::wstring m_MapKey;        // For deleting from the map later
     bool m_IsValid;
@@ -77,11 +88,25 @@ namespace TextureManager
     void Initialize( const std::wstring& TextureLibRoot );
     void Shutdown(void);
 
+    // Prepended to every file name that is loaded
+    const std::wstring& GetRootPath( void );
+
     const ManagedTexture* LoadFromFile( const std::wstring& fileName, bool sRGB = false );
     const ManagedTexture* LoadDDSFromFile( const std::wstring& fileName, bool sRGB = false );
+
+    // Uncompressed images whose sides are multiples of 4 are converted on the GPU to BC-compressed DDS files
+    // with mips the first time they are loaded.  The DDS files are cached in "Cache/" under the root path,
+    // keyed by name and contents, and later loads read them instead.
     const ManagedTexture* LoadTGAFromFile( const std::wstring& fileName, bool sRGB = false );
     const ManagedTexture* LoadPIXImageFromFile( const std::wstring& fileName );
 
+    // Starts reading a DDS texture through the asset I/O queue and returns right away.  The group finishes
+    // once the texture is created, after which LoadDDSFromFile() finds it in the cache.  Its upload is batched,
+    // so nothing may read it before AssetIO::Flush().  As with ReadFileSync(), a block-compressed version of the
+    // file is read instead when there is one.
+    void LoadDDSFromFileAsync( const std::wstring& fileName, bool sRGB, JobSystem::Counter& Group,
+        AssetIO::Priority Priority = AssetIO::kPriorityNormal );
+
     inline const ManagedTexture* LoadFromFile( const std::string& fileName, bool sRGB = false )
     {
         return LoadFromFile(MakeWStr(fileName), sRGB);
@@ -102,6 +127,46 @@ namespace TextureManager
         return LoadPIXImageFromFile(MakeWStr(fileName));
     }
 
+    // Uncompressed textures loaded with only their top mip, such as TGA files and single-mip DDS files, are queued
+    // to have the rest of their mips generated.  This generates them for every queued texture, batching many
+    // textures into each dispatch, and then points the texture views at the full mip chains.  Call it from the
+    // main thread before recording work that samples the textures.
+    void GenerateMissingMips( void );
+
+    // Packs textures of the same format, size and mip count into texture arrays, so that a set of many small
+    // textures, such as a model's materials, is a few resources rather than one each.  Every source gets a
+    // Texture2DArray view of one slice, of its array or of its own resource when nothing matched it, so that
+    // shaders sample all of them the same way.  Packed textures are unloaded from the cache, so they must not
+    // be used outside the set.  Invalid textures are viewed as the magenta texture, and textures whose mips
+    // were generated are left in their own resources.
+    class PackedTextures
+    {
+    public:
+        struct Source
+        {
+            const Texture* Tex;
+            bool sRGB;          // For textures whose resources are typeless
+        };
+
+        PackedTextures() {}
+        ~PackedTextures() { Destroy(); }
+        PackedTextures(const PackedTextures&) = delete;
+        PackedTextures& operator=(const PackedTextures&) = delete;
+
+        // Generates missing mips first, so call it from the main thread
+        void Create( const Source* Sources, uint32_t Count );
+        void Destroy( void );
+
+        // The view of the source at the index given to Create()
+        const D3D12_CPU_DESCRIPTOR_HANDLE& GetSRV( uint32_t Index ) const { return m_SRVs[Index]; }
+        uint32_t GetArrayCount( void ) const { return (uint32_t)m_Arrays.size(); }
+
+    private:
+        std::vector<GpuResource> m_Arrays;
+        std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> m_SRVs;
+    };
+
     const Texture& GetBlackTex2D(void);
     const Texture& GetWhiteTex2D(void);
+    const Texture& GetMagentaTex2D(void);
 }
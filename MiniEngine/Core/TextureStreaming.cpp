@@ -0,0 +1,634 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "pch.h"
+#include "TextureStreaming.h"
+#include "GraphicsCore.h"
+#include "CommandListManager.h"
+#include "DynamicDescriptorHeap.h"
+#include "AssetIO.h"
+#include "GpuMemoryTracker.h"
+#include "PagingService.h"
+#include "StartupProfile.h"
+#include "FrameArena.h"
+#include <map>
+#include <deque>
+#include <algorithm>
+
+using namespace Graphics;
+
+namespace TextureStreaming
+{
+    BoolVar Enable("Graphics/Texture Streaming/Enable", true);
+    IntVar BudgetMB("Graphics/Texture Streaming/Budget (MB)", 512, 64, 8192, 64);
+    IntVar LoadsInFlight("Graphics/Texture Streaming/Loads In Flight", 16, 1, 128);
+    IntVar EvictionDelay("Graphics/Texture Streaming/Eviction Delay (frames)", 60, 1, 1000, 10);
+
+    // 64 MB heaps of 64 KB tiles.  A mip takes its tiles from a single heap, so one this size holds the finest
+    // mip of a 4K BC7 texture.
+    const uint32_t kTilesPerHeap = 1024;
+    const uint32_t kTilesPerMB = 1024 * 1024 / D3D12_TILED_RESOURCE_TILE_SIZE_IN_BYTES;
+    const uint64_t kHeapBytes = (uint64_t)kTilesPerHeap * D3D12_TILED_RESOURCE_TILE_SIZE_IN_BYTES;
+
+    enum LoadState { kLoadIdle, kLoadReading, kLoadUploaded, kLoadFailed };
+
+    struct TileHeap
+    {
+        ID3D12Heap* Heap;
+        std::vector<UINT> FreeTiles;
+    };
+
+    // The tiles of an evicted mip stay mapped until the GPU has passed the work that could still sample them
+    struct PendingUnmap
+    {
+        StreamedTexture* Texture;
+        uint32_t Mip;
+        StreamedTexture::MipTiles Tiles;
+        uint64_t FenceValue;
+    };
+
+    bool s_Supported = false;
+
+    // Guards the texture map and the tile pool, which loads touch from job system workers
+    std::mutex s_Mutex;
+    std::map<std::wstring, std::unique_ptr<StreamedTexture>> s_Textures;
+    std::vector<TileHeap> s_TileHeaps;             // Heaps given back to the OS leave a null slot
+    uint32_t s_TilesInUse = 0;
+    uint32_t s_PackedTilesInUse = 0;
+
+    // Lowered below the tuning budget when the OS budget shrinks, and raised again a heap at a time once the
+    // memory fits
+    uint32_t s_TrimmedBudgetTiles = UINT32_MAX;
+    uint32_t s_PagingClient = 0;
+
+    // Only touched by Update()
+    std::deque<PendingUnmap> s_PendingUnmaps;
+    uint32_t s_TilesPendingUnmap = 0;
+    uint32_t s_NumLoadsInFlight = 0;
+    uint64_t s_FrameIndex = 0;
+
+    uint32_t GetBudgetTiles( void );
+    uint64_t TrimStreamedMips( uint64_t BytesToFree );
+    void ReleaseEmptyHeaps( void );
+    bool AllocateTiles( uint32_t NumTiles, bool IgnoreBudget, StreamedTexture::MipTiles& Tiles );
+    void FreeTiles( StreamedTexture::MipTiles& Tiles );
+    void MapTiles( StreamedTexture& Tex, uint32_t Subresource, const StreamedTexture::MipTiles& Tiles );
+    void UnmapTiles( StreamedTexture& Tex, uint32_t Subresource, uint32_t NumTiles );
+    uint32_t GetMipTileCount( const StreamedTexture& Tex, uint32_t Mip );
+
+    void LoadWhole( StreamedTexture& Tex, JobSystem::Counter* Group );
+    bool CreateStreamedTexture( StreamedTexture& Tex, const void* Header, size_t HeaderSize, JobSystem::Counter* Group );
+    void StartMipLoad( StreamedTexture& Tex, uint32_t Mip, JobSystem::Counter* Group );
+    void EvictMip( StreamedTexture& Tex );
+}
+
+using namespace TextureStreaming;
+
+StreamedTexture::StreamedTexture( const std::wstring& FileName, bool sRGB ) :
+    m_FileName(FileName), m_sRGB(sRGB), m_IsValid(true), m_IsStreamed(false), m_NumStandardMips(0), m_FinestMip(0),
+    m_ResidentMip(0), m_LoadingMip(0), m_LoadState(kLoadReading), m_LoadFence(0), m_RequestedMip(0), m_WantedMip(0),
+    m_WantedFrame(0)
+{
+    ZeroMemory(&m_Layout, sizeof(m_Layout));
+    ZeroMemory(m_MipTiling, sizeof(m_MipTiling));
+}
+
+void StreamedTexture::AttachReservedResource( ID3D12Resource* Resource )
+{
+    m_pResource.Attach(Resource);
+    m_UsageState = D3D12_RESOURCE_STATE_COMMON;
+    m_pResource->SetName(m_FileName.c_str());
+}
+
+// Only the resident mips are in the view.  It is an array view, as are those of all material textures.
+void StreamedTexture::UpdateSRV( void )
+{
+    if (m_hCpuDescriptorHandle.ptr == D3D12_GPU_VIRTUAL_ADDRESS_UNKNOWN)
+        m_hCpuDescriptorHandle = AllocateDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+
+    D3D12_SHADER_RESOURCE_VIEW_DESC SRVDesc = {};
+    SRVDesc.Format = m_Layout.format;
+    SRVDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
+    SRVDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+    SRVDesc.Texture2DArray.MostDetailedMip = m_ResidentMip;
+    SRVDesc.Texture2DArray.MipLevels = m_Layout.mipCount - m_ResidentMip;
+    SRVDesc.Texture2DArray.ArraySize = 1;
+    g_Device->CreateShaderResourceView(m_pResource.Get(), &SRVDesc, m_hCpuDescriptorHandle);
+}
+
+void TextureStreaming::Initialize( void )
+{
+    D3D12_FEATURE_DATA_D3D12_OPTIONS Options = {};
+    s_Supported = SUCCEEDED(g_Device->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS, &Options, sizeof(Options))) &&
+        Options.TiledResourcesTier >= D3D12_TILED_RESOURCES_TIER_1;
+
+    if (!s_Supported)
+    {
+        Utility::Print("Texture streaming requires tiled resources.  Streamed textures are loaded whole.\n");
+        return;
+    }
+
+    // Streamed mips can always be read again, so they are the first to go when the OS budget shrinks
+    s_PagingClient = PagingService::RegisterClient(PagingService::kPriorityLow, TrimStreamedMips);
+}
+
+void TextureStreaming::Shutdown( void )
+{
+    if (s_PagingClient != 0)
+    {
+        PagingService::UnregisterClient(s_PagingClient);
+        s_PagingClient = 0;
+    }
+
+    g_CommandManager.IdleGPU();
+
+    s_PendingUnmaps.clear();
+    s_Textures.clear();
+
+    for (auto& Heap : s_TileHeaps)
+    {
+        if (Heap.Heap != nullptr)
+            Heap.Heap->Release();
+    }
+    s_TileHeaps.clear();
+    s_TilesInUse = 0;
+    s_PackedTilesInUse = 0;
+    s_TrimmedBudgetTiles = UINT32_MAX;
+    s_TilesPendingUnmap = 0;
+    s_NumLoadsInFlight = 0;
+}
+
+StreamedTexture* TextureStreaming::LoadDDSFromFileAsync( const std::wstring& FileName, bool sRGB, JobSystem::Counter& Group )
+{
+    StreamedTexture* Tex = nullptr;
+    {
+        std::lock_guard<std::mutex> LockGuard(s_Mutex);
+
+        auto Iter = s_Textures.find(FileName);
+        if (Iter != s_Textures.end())
+            return Iter->second.get();
+
+        Tex = new StreamedTexture(FileName, sRGB);
+        s_Textures[FileName].reset(Tex);
+    }
+
+    if (!s_Supported)
+    {
+        LoadWhole(*Tex, &Group);
+        return Tex;
+    }
+
+    // The header tells whether the texture can be streamed and where its mips are
+    JobSystem::Counter* GroupPtr = &Group;
+    AssetIO::ReadFileRange(TextureManager::GetRootPath() + FileName, 0, DDS_MAX_HEADER_SIZE, AssetIO::kPriorityNormal,
+        [Tex, GroupPtr](const void* Data, size_t Size)
+    {
+        if (Size == 0)
+        {
+            Tex->m_IsValid = false;
+            Tex->m_LoadState = kLoadIdle;
+        }
+        else if (!CreateStreamedTexture(*Tex, Data, Size, GroupPtr))
+            LoadWhole(*Tex, GroupPtr);
+    }, &Group);
+
+    return Tex;
+}
+
+void TextureStreaming::LoadWhole( StreamedTexture& Tex, JobSystem::Counter* Group )
+{
+    StreamedTexture* TexPtr = &Tex;
+    AssetIO::ReadFile(TextureManager::GetRootPath() + Tex.m_FileName, AssetIO::kPriorityNormal,
+        [TexPtr](const void* Data, size_t Size)
+    {
+        StartupProfile::ScopedSpan Span(StartupProfile::kTextureUpload, Size);
+        if (Size == 0 || !TexPtr->CreateDDSFromMemory(Data, Size, TexPtr->m_sRGB, true))
+            TexPtr->m_IsValid = false;
+        else
+            TexPtr->GetResource()->SetName(TexPtr->m_FileName.c_str());
+        TexPtr->m_LoadState = kLoadIdle;
+    }, Group);
+}
+
+bool TextureStreaming::CreateStreamedTexture( StreamedTexture& Tex, const void* Header, size_t HeaderSize,
+    JobSystem::Counter* Group )
+{
+    StartupProfile::ScopedSpan Span(StartupProfile::kTextureUpload);
+    if (FAILED(GetDDSTextureLayout((const uint8_t*)Header, HeaderSize, Tex.m_sRGB, &Tex.m_Layout)))
+        return false;
+
+    D3D12_RESOURCE_DESC Desc = {};
+    Desc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+    Desc.Width = Tex.m_Layout.width;
+    Desc.Height = Tex.m_Layout.height;
+    Desc.DepthOrArraySize = 1;
+    Desc.MipLevels = (UINT16)Tex.m_Layout.mipCount;
+    Desc.Format = Tex.m_Layout.format;
+    Desc.SampleDesc.Count = 1;
+    Desc.Layout = D3D12_TEXTURE_LAYOUT_64KB_UNDEFINED_SWIZZLE;
+
+    ID3D12Resource* Resource = nullptr;
+    if (FAILED(g_Device->CreateReservedResource(&Desc, D3D12_RESOURCE_STATE_COMMON, nullptr, MY_IID_PPV_ARGS(&Resource))))
+        return false;
+
+    UINT NumTiles = 0;
+    D3D12_PACKED_MIP_INFO PackedMipInfo;
+    D3D12_TILE_SHAPE TileShape;
+    UINT NumSubresourceTilings = Tex.m_Layout.mipCount;
+    g_Device->GetResourceTiling(Resource, &NumTiles, &PackedMipInfo, &TileShape, &NumSubresourceTilings, 0, Tex.m_MipTiling);
+
+    // Textures that are all packed gain nothing from streaming, and without a packed tail there would be nothing
+    // to sample before the first streamed mip arrives.  Mips that do not fit the staging ring would be copied
+    // on the graphics queue.
+    bool CanStream = PackedMipInfo.NumStandardMips > 0 && PackedMipInfo.NumPackedMips > 0;
+    for (uint32_t Mip = 0; CanStream && Mip < PackedMipInfo.NumStandardMips; ++Mip)
+        CanStream = Tex.m_Layout.mips[Mip].numBytes <= AssetIO::GetMaxStagedUpload();
+
+    if (!CanStream)
+    {
+        Resource->Release();
+        return false;
+    }
+
+    Tex.AttachReservedResource(Resource);
+    Tex.m_IsStreamed = true;
+    Tex.m_NumStandardMips = PackedMipInfo.NumStandardMips;
+    Tex.m_ResidentMip = Tex.m_NumStandardMips;
+    Tex.m_LoadingMip = Tex.m_NumStandardMips;
+    Tex.m_RequestedMip = Tex.m_NumStandardMips;
+    Tex.m_WantedMip = Tex.m_NumStandardMips;
+
+    // The packed tail stays resident for the life of the texture, regardless of the budget
+    {
+        std::lock_guard<std::mutex> LockGuard(s_Mutex);
+        AllocateTiles(PackedMipInfo.NumTilesForPackedMips, true, Tex.m_PackedTiles);
+        s_PackedTilesInUse += PackedMipInfo.NumTilesForPackedMips;
+        MapTiles(Tex, Tex.m_NumStandardMips, Tex.m_PackedTiles);
+    }
+
+    Tex.UpdateSRV();
+    StartMipLoad(Tex, Tex.m_NumStandardMips, Group);
+    return true;
+}
+
+void TextureStreaming::StartMipLoad( StreamedTexture& Tex, uint32_t Mip, JobSystem::Counter* Group )
+{
+    // The packed mips are read together, and they follow each other in the file like all of the mips do
+    const bool Packed = Mip == Tex.m_NumStandardMips;
+    const uint32_t NumMips = Packed ? Tex.m_Layout.mipCount - Mip : 1;
+    const DDS_MIP_LAYOUT& FirstMip = Tex.m_Layout.mips[Mip];
+    const DDS_MIP_LAYOUT& LastMip = Tex.m_Layout.mips[Mip + NumMips - 1];
+    const size_t ReadSize = LastMip.offset + LastMip.numBytes - FirstMip.offset;
+
+    // The first load is waited for by its group, and the texture may be sampled after AssetIO::Flush()
+    const bool FirstLoad = Mip == Tex.m_ResidentMip;
+
+    Tex.m_LoadingMip = Mip;
+    Tex.m_LoadFence = 0;
+    Tex.m_LoadState = kLoadReading;
+
+    StreamedTexture* TexPtr = &Tex;
+    AssetIO::ReadFileRange(TextureManager::GetRootPath() + Tex.m_FileName, FirstMip.offset, ReadSize,
+        FirstLoad ? AssetIO::kPriorityNormal : AssetIO::kPriorityLow,
+        [TexPtr, Mip, NumMips, ReadSize, FirstLoad](const void* Data, size_t Size)
+    {
+        if (Size != ReadSize)
+        {
+            if (FirstLoad)
+                TexPtr->m_IsValid = false;
+            TexPtr->m_LoadState = FirstLoad ? kLoadIdle : kLoadFailed;
+            return;
+        }
+
+        StartupProfile::ScopedSpan Span(StartupProfile::kTextureUpload, ReadSize);
+        D3D12_SUBRESOURCE_DATA SubData[D3D12_REQ_MIP_LEVELS];
+        for (uint32_t i = 0; i < NumMips; ++i)
+        {
+            const DDS_MIP_LAYOUT& MipLayout = TexPtr->m_Layout.mips[Mip + i];
+            SubData[i].pData = (const uint8_t*)Data + (MipLayout.offset - TexPtr->m_Layout.mips[Mip].offset);
+            SubData[i].RowPitch = MipLayout.rowBytes;
+            SubData[i].SlicePitch = MipLayout.numBytes;
+        }
+        AssetIO::UploadTexture(*TexPtr, NumMips, SubData, Mip);
+
+        TexPtr->m_LoadState = FirstLoad ? kLoadIdle : kLoadUploaded;
+    }, Group);
+}
+
+void TextureStreaming::RequestResolution( StreamedTexture* Tex, float Log2Resolution )
+{
+    if (!Tex->m_IsStreamed)
+        return;
+
+    const float Log2Size = std::log2((float)std::max(Tex->m_Layout.width, Tex->m_Layout.height));
+    const int Mip = (int)std::floor(Log2Size - Log2Resolution);
+    const uint32_t ClampedMip = (uint32_t)std::max<int>(std::min<int>(Mip, Tex->m_NumStandardMips), Tex->m_FinestMip);
+    Tex->m_RequestedMip = std::min(Tex->m_RequestedMip, ClampedMip);
+}
+
+uint32_t TextureStreaming::GetMipTileCount( const StreamedTexture& Tex, uint32_t Mip )
+{
+    const D3D12_SUBRESOURCE_TILING& Tiling = Tex.m_MipTiling[Mip];
+    return Tiling.WidthInTiles * Tiling.HeightInTiles * Tiling.DepthInTiles;
+}
+
+uint32_t TextureStreaming::GetBudgetTiles( void )
+{
+    return std::min((uint32_t)BudgetMB * kTilesPerMB, s_TrimmedBudgetTiles);
+}
+
+// Lowers the budget by the tiles asked for, down to the packed tails that cannot be evicted, and leaves the
+// evicting to the next Update().  Tiles only go back to the OS with the heaps they empty.
+uint64_t TextureStreaming::TrimStreamedMips( uint64_t BytesToFree )
+{
+    std::lock_guard<std::mutex> LockGuard(s_Mutex);
+
+    const uint32_t TilesHeld = s_TilesInUse - s_TilesPendingUnmap;
+    const uint32_t Evictable = TilesHeld - std::min(s_PackedTilesInUse, TilesHeld);
+    const uint64_t TilesToFree = (BytesToFree + D3D12_TILED_RESOURCE_TILE_SIZE_IN_BYTES - 1) / D3D12_TILED_RESOURCE_TILE_SIZE_IN_BYTES;
+    const uint32_t Trimmed = (uint32_t)std::min<uint64_t>(TilesToFree, Evictable);
+
+    s_TrimmedBudgetTiles = std::min(s_TrimmedBudgetTiles, TilesHeld - Trimmed);
+    return (uint64_t)Trimmed * D3D12_TILED_RESOURCE_TILE_SIZE_IN_BYTES;
+}
+
+void TextureStreaming::ReleaseEmptyHeaps( void )
+{
+    for (auto& Heap : s_TileHeaps)
+    {
+        if (Heap.Heap != nullptr && Heap.FreeTiles.size() == kTilesPerHeap)
+        {
+            Heap.Heap->Release();
+            Heap.Heap = nullptr;
+            Heap.FreeTiles.clear();
+        }
+    }
+}
+
+bool TextureStreaming::AllocateTiles( uint32_t NumTiles, bool IgnoreBudget, StreamedTexture::MipTiles& Tiles )
+{
+    ASSERT(NumTiles <= kTilesPerHeap);
+
+    if (!IgnoreBudget && s_TilesInUse + NumTiles > GetBudgetTiles())
+        return false;
+
+    uint32_t HeapIdx = 0;
+    while (HeapIdx < s_TileHeaps.size() && (s_TileHeaps[HeapIdx].Heap == nullptr || s_TileHeaps[HeapIdx].FreeTiles.size() < NumTiles))
+        ++HeapIdx;
+
+    if (HeapIdx == s_TileHeaps.size())
+    {
+        if (!IgnoreBudget && !PagingService::FitsInBudget(kHeapBytes, PagingService::kPriorityLow))
+            return false;
+
+        D3D12_HEAP_DESC HeapDesc = {};
+        HeapDesc.SizeInBytes = kHeapBytes;
+        HeapDesc.Properties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
+        HeapDesc.Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES;
+
+        TileHeap NewHeap;
+        ASSERT_SUCCEEDED(g_Device->CreateHeap(&HeapDesc, MY_IID_PPV_ARGS(&NewHeap.Heap)));
+        NewHeap.Heap->SetName(L"Texture Streaming Tiles");
+        GpuMemoryTracker::TrackHeap(NewHeap.Heap, GpuMemoryTracker::kTextures);
+
+        // Streamed mips can be reloaded, so the OS should demote them before anything else
+        Microsoft::WRL::ComPtr<ID3D12Device1> Device1;
+        if (SUCCEEDED(g_Device->QueryInterface(MY_IID_PPV_ARGS(&Device1))))
+        {
+            ID3D12Pageable* Pageable = NewHeap.Heap;
+            const D3D12_RESIDENCY_PRIORITY Priority = D3D12_RESIDENCY_PRIORITY_LOW;
+            Device1->SetResidencyPriority(1, &Pageable, &Priority);
+        }
+
+        // Hand out the low tiles first
+        for (UINT Tile = kTilesPerHeap; Tile > 0; --Tile)
+            NewHeap.FreeTiles.push_back(Tile - 1);
+
+        // Fill the slot of a heap that was given back before growing the list, as mips refer to heaps by index
+        HeapIdx = 0;
+        while (HeapIdx < s_TileHeaps.size() && s_TileHeaps[HeapIdx].Heap != nullptr)
+            ++HeapIdx;
+        if (HeapIdx == s_TileHeaps.size())
+            s_TileHeaps.push_back(std::move(NewHeap));
+        else
+            s_TileHeaps[HeapIdx] = std::move(NewHeap);
+    }
+
+    std::vector<UINT>& FreeList = s_TileHeaps[HeapIdx].FreeTiles;
+    Tiles.Heap = HeapIdx;
+    Tiles.Tiles.assign(FreeList.end() - NumTiles, FreeList.end());
+    FreeList.resize(FreeList.size() - NumTiles);
+    s_TilesInUse += NumTiles;
+    return true;
+}
+
+void TextureStreaming::FreeTiles( StreamedTexture::MipTiles& Tiles )
+{
+    std::vector<UINT>& FreeList = s_TileHeaps[Tiles.Heap].FreeTiles;
+    FreeList.insert(FreeList.end(), Tiles.Tiles.begin(), Tiles.Tiles.end());
+    s_TilesInUse -= (uint32_t)Tiles.Tiles.size();
+    Tiles.Tiles.clear();
+}
+
+// Tile mappings are changed on the copy queue, which orders them before the uploads that follow
+void TextureStreaming::MapTiles( StreamedTexture& Tex, uint32_t Subresource, const StreamedTexture::MipTiles& Tiles )
+{
+    StartupProfile::ScopedSpan Span(StartupProfile::kResidency);
+    D3D12_TILED_RESOURCE_COORDINATE Coord = { 0, 0, 0, Subresource };
+    D3D12_TILE_REGION_SIZE RegionSize = {};
+    RegionSize.NumTiles = (UINT)Tiles.Tiles.size();
+
+    const UINT NumRanges = (UINT)Tiles.Tiles.size();
+    UINT* RangeTileCounts = FrameArena::AllocateArray<UINT>(NumRanges);
+    std::fill(RangeTileCounts, RangeTileCounts + NumRanges, 1u);
+    g_CommandManager.GetCopyQueue().GetCommandQueue()->UpdateTileMappings(Tex.GetResource(), 1, &Coord, &RegionSize,
+        s_TileHeaps[Tiles.Heap].Heap, NumRanges, nullptr, Tiles.Tiles.data(), RangeTileCounts,
+        D3D12_TILE_MAPPING_FLAG_NONE);
+}
+
+void TextureStreaming::UnmapTiles( StreamedTexture& Tex, uint32_t Subresource, uint32_t NumTiles )
+{
+    D3D12_TILED_RESOURCE_COORDINATE Coord = { 0, 0, 0, Subresource };
+    D3D12_TILE_REGION_SIZE RegionSize = {};
+    RegionSize.NumTiles = NumTiles;
+
+    const D3D12_TILE_RANGE_FLAGS RangeFlags = D3D12_TILE_RANGE_FLAG_NULL;
+    g_CommandManager.GetCopyQueue().GetCommandQueue()->UpdateTileMappings(Tex.GetResource(), 1, &Coord, &RegionSize,
+        nullptr, 1, &RangeFlags, nullptr, &NumTiles, D3D12_TILE_MAPPING_FLAG_NONE);
+}
+
+void TextureStreaming::EvictMip( StreamedTexture& Tex )
+{
+    const uint32_t Mip = Tex.m_ResidentMip;
+    ASSERT(Mip < Tex.m_NumStandardMips && Tex.m_LoadingMip == Mip);
+
+    Tex.m_ResidentMip = Mip + 1;
+    Tex.m_LoadingMip = Mip + 1;
+    Tex.UpdateSRV();
+
+    // Everything submitted so far may still sample the mip through the old SRV
+    PendingUnmap Unmap = { &Tex, Mip, std::move(Tex.m_MipTiles[Mip]),
+        g_CommandManager.GetGraphicsQueue().GetNextFenceValue() - 1 };
+    Tex.m_MipTiles[Mip].Tiles.clear();
+    s_TilesPendingUnmap += (uint32_t)Unmap.Tiles.Tiles.size();
+    s_PendingUnmaps.push_back(std::move(Unmap));
+}
+
+void TextureStreaming::Update( void )
+{
+    if (!s_Supported)
+        return;
+
+    std::lock_guard<std::mutex> LockGuard(s_Mutex);
+    ++s_FrameIndex;
+
+    while (!s_PendingUnmaps.empty() && g_CommandManager.IsFenceComplete(s_PendingUnmaps.front().FenceValue))
+    {
+        PendingUnmap& Unmap = s_PendingUnmaps.front();
+        UnmapTiles(*Unmap.Texture, Unmap.Mip, (uint32_t)Unmap.Tiles.Tiles.size());
+        s_TilesPendingUnmap -= (uint32_t)Unmap.Tiles.Tiles.size();
+        FreeTiles(Unmap.Tiles);
+        s_PendingUnmaps.pop_front();
+    }
+
+    // While trimmed, memory goes back to the OS as heaps empty out, and the budget grows again once it fits
+    if (s_TrimmedBudgetTiles != UINT32_MAX)
+    {
+        ReleaseEmptyHeaps();
+
+        if (PagingService::FitsInBudget(kHeapBytes, PagingService::kPriorityLow))
+        {
+            s_TrimmedBudgetTiles += kTilesPerHeap;
+            if (s_TrimmedBudgetTiles >= (uint32_t)BudgetMB * kTilesPerMB)
+                s_TrimmedBudgetTiles = UINT32_MAX;
+        }
+    }
+
+    bool SRVsChanged = false;
+    FrameArena::FrameVector<StreamedTexture*> AwaitingFence;
+    FrameArena::FrameVector<StreamedTexture*> Wanting;
+    FrameArena::FrameVector<StreamedTexture*> Evictable;
+    AwaitingFence.reserve(s_Textures.size());
+    Wanting.reserve(s_Textures.size());
+    Evictable.reserve(s_Textures.size());
+
+    for (auto& Entry : s_Textures)
+    {
+        StreamedTexture& Tex = *Entry.second;
+        const uint32_t State = Tex.m_LoadState;
+        if (!Tex.m_IsStreamed || State == kLoadReading)
+            continue;
+
+        // Hold on to finer mips for a while after they stop being asked for, and let them go one at a time
+        if (Tex.m_RequestedMip <= Tex.m_WantedMip)
+        {
+            Tex.m_WantedMip = Tex.m_RequestedMip;
+            Tex.m_WantedFrame = s_FrameIndex;
+        }
+        else if (s_FrameIndex - Tex.m_WantedFrame > (uint64_t)EvictionDelay)
+        {
+            ++Tex.m_WantedMip;
+            Tex.m_WantedFrame = s_FrameIndex;
+        }
+        Tex.m_RequestedMip = Tex.m_NumStandardMips;
+
+        if (State == kLoadUploaded)
+        {
+            if (Tex.m_LoadFence == 0)
+                AwaitingFence.push_back(&Tex);
+            else if (g_CommandManager.IsFenceComplete(Tex.m_LoadFence))
+            {
+                Tex.m_ResidentMip = Tex.m_LoadingMip;
+                Tex.m_LoadState = kLoadIdle;
+                --s_NumLoadsInFlight;
+                Tex.UpdateSRV();
+                SRVsChanged = true;
+            }
+        }
+        else if (State == kLoadFailed)
+        {
+            // Nothing has sampled the mip, so its tiles can go right away
+            Utility::Printf(L"Failed to stream mip %u of %ws\n", Tex.m_LoadingMip, Tex.m_FileName.c_str());
+            UnmapTiles(Tex, Tex.m_LoadingMip, (uint32_t)Tex.m_MipTiles[Tex.m_LoadingMip].Tiles.size());
+            FreeTiles(Tex.m_MipTiles[Tex.m_LoadingMip]);
+            Tex.m_FinestMip = Tex.m_ResidentMip;
+            Tex.m_WantedMip = std::max(Tex.m_WantedMip, Tex.m_FinestMip);
+            Tex.m_LoadingMip = Tex.m_ResidentMip;
+            Tex.m_LoadState = kLoadIdle;
+            --s_NumLoadsInFlight;
+        }
+
+        if (Tex.m_LoadState == kLoadIdle)
+        {
+            if (Tex.m_WantedMip < Tex.m_ResidentMip)
+                Wanting.push_back(&Tex);
+            else if (Tex.m_WantedMip > Tex.m_ResidentMip)
+                Evictable.push_back(&Tex);
+        }
+    }
+
+    // One submission covers every upload that has been recorded
+    if (!AwaitingFence.empty())
+    {
+        const uint64_t FenceValue = AssetIO::Submit();
+        for (auto Tex : AwaitingFence)
+            Tex->m_LoadFence = FenceValue;
+    }
+
+    // The textures furthest from what is asked of them go first
+    std::sort(Wanting.begin(), Wanting.end(), [](const StreamedTexture* A, const StreamedTexture* B)
+    {
+        return A->m_ResidentMip - A->m_WantedMip > B->m_ResidentMip - B->m_WantedMip;
+    });
+
+    uint32_t TilesNeeded = 0;
+    for (auto Tex : Wanting)
+    {
+        if (s_NumLoadsInFlight >= (uint32_t)LoadsInFlight)
+            break;
+
+        const uint32_t Mip = Tex->m_ResidentMip - 1;
+        const uint32_t NumTiles = GetMipTileCount(*Tex, Mip);
+        if (!AllocateTiles(NumTiles, false, Tex->m_MipTiles[Mip]))
+        {
+            TilesNeeded = NumTiles;
+            break;
+        }
+
+        MapTiles(*Tex, Mip, Tex->m_MipTiles[Mip]);
+        StartMipLoad(*Tex, Mip, nullptr);
+        ++s_NumLoadsInFlight;
+    }
+
+    // Make room for the load that did not fit, or get back under a budget that was lowered, starting with the
+    // textures that have gone the longest without being asked for their finest mips
+    std::sort(Evictable.begin(), Evictable.end(), [](const StreamedTexture* A, const StreamedTexture* B)
+    {
+        return A->m_WantedFrame < B->m_WantedFrame;
+    });
+
+    const uint32_t BudgetTiles = GetBudgetTiles();
+    for (auto Tex : Evictable)
+    {
+        if (s_TilesInUse - s_TilesPendingUnmap + TilesNeeded <= BudgetTiles)
+            break;
+
+        EvictMip(*Tex);
+        SRVsChanged = true;
+    }
+
+    if (SRVsChanged)
+        DynamicDescriptorHeap::RefreshPersistentDescriptors();
+}
+
+uint64_t TextureStreaming::GetResidentBytes( void )
+{
+    std::lock_guard<std::mutex> LockGuard(s_Mutex);
+    return (uint64_t)s_TilesInUse * D3D12_TILED_RESOURCE_TILE_SIZE_IN_BYTES;
+}
@@ -0,0 +1,89 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#pragma once
+
+#include "pch.h"
+#include "TextureManager.h"
+#include "DDSTextureLoader.h"
+#include "EngineTuning.h"
+#include <atomic>
+
+// Streams the mips of DDS textures into reserved resources.  A texture starts out with only its packed mip tail,
+// and the renderer reports the resolution it would like each texture sampled at.  The streamer then reads the
+// missing mips, one at a time from coarse to fine, through the asset I/O queue, and maps them into tiles from a
+// shared pool.  When the pool reaches its budget, mips of textures that have gone without being asked for them
+// the longest are evicted.  The pool's budget shrinks when the paging service asks it to trim for the OS budget,
+// and pool heaps are only added while they fit in it.  Textures that cannot be streamed are loaded whole instead.
+class StreamedTexture : public Texture
+{
+public:
+    StreamedTexture( const std::wstring& FileName, bool sRGB );
+
+    bool IsValid( void ) const { return m_IsValid; }
+
+    // The SRV begins at this mip.  It is 0 for textures that were loaded whole.
+    uint32_t GetResidentMip( void ) const { return m_ResidentMip; }
+
+    // The rest is used by the streamer
+    void AttachReservedResource( ID3D12Resource* Resource );
+    void UpdateSRV( void );
+
+    struct MipTiles
+    {
+        uint32_t Heap;
+        std::vector<UINT> Tiles;            // Tile offsets in the heap
+    };
+
+    std::wstring m_FileName;
+    bool m_sRGB;
+    bool m_IsValid;
+    bool m_IsStreamed;
+    DDS_TEXTURE_LAYOUT m_Layout;
+
+    uint32_t m_NumStandardMips;             // Mips from this one on are packed into the tail
+    uint32_t m_FinestMip;                   // Finer mips failed to load
+    uint32_t m_ResidentMip;
+    uint32_t m_LoadingMip;                  // The mip being read, or m_ResidentMip when there is none
+    std::atomic<uint32_t> m_LoadState;
+    uint64_t m_LoadFence;                   // Copy queue fence of the loading mip's upload
+    D3D12_SUBRESOURCE_TILING m_MipTiling[D3D12_REQ_MIP_LEVELS];
+    MipTiles m_MipTiles[D3D12_REQ_MIP_LEVELS];
+    MipTiles m_PackedTiles;
+
+    uint32_t m_RequestedMip;                // Finest mip asked for this frame
+    uint32_t m_WantedMip;                   // Finest mip asked for recently
+    uint64_t m_WantedFrame;                 // When the wanted mip was last asked for
+};
+
+namespace TextureStreaming
+{
+    extern BoolVar Enable;
+
+    // Streaming needs tiled resources.  Without them, streamed loads fall back to whole textures.
+    void Initialize( void );
+    void Shutdown( void );
+
+    // Starts reading a DDS texture, given a path under the texture root, and returns right away.  The group
+    // finishes once the texture exists with its first mips, and nothing may sample it before AssetIO::Flush().
+    // Loading a file a second time returns the same texture.
+    StreamedTexture* LoadDDSFromFileAsync( const std::wstring& FileName, bool sRGB, JobSystem::Counter& Group );
+
+    // Asks for the texture to be sampled at the given resolution, as the log2 of texels per unit of UV along
+    // each axis.  The requests of a frame are acted upon by the next Update().
+    void RequestResolution( StreamedTexture* Texture, float Log2Resolution );
+
+    // Makes mips whose uploads have finished visible, starts reading the most wanted missing mips, and evicts
+    // mips when over budget.  Call once a frame from the main thread before any rendering is recorded.  SRVs
+    // are rewritten in place, and the persistent descriptors are refreshed when any of them change.
+    void Update( void );
+
+    // Bytes of tiles holding streamed mips
+    uint64_t GetResidentBytes( void );
+}
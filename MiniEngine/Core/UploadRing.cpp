@@ -0,0 +1,194 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "pch.h"
+#include "UploadRing.h"
+#include "GraphicsCore.h"
+#include "CommandListManager.h"
+#include "GpuMemoryTracker.h"
+#include <atomic>
+#include <thread>
+
+using namespace Graphics;
+using Microsoft::WRL::ComPtr;
+
+namespace UploadRing
+{
+    const char* StrategyLabels[kNumStrategies] = { "Pages", "Ring: Constants", "Ring: All Dynamic Data" };
+    EnumVar DynamicUploadStrategy("Graphics/Dynamic Upload Strategy", kRingConstants, kNumStrategies, StrategyLabels);
+
+    const size_t kChunkSize = 64 * 1024;
+
+    struct Segment
+    {
+        std::atomic<size_t> Offset;             // Bytes reserved since the segment was last reused
+        std::atomic<uint32_t> NumOpenContexts;  // Contexts that allocated from it and have not finished
+
+        // The last fence of each queue that used the segment
+        std::atomic<uint64_t> Fences[3];
+    };
+
+    ComPtr<ID3D12Resource> s_Buffer;
+    uint8_t* s_CpuBase = nullptr;
+    D3D12_GPU_VIRTUAL_ADDRESS s_GpuBase = 0;
+    size_t s_SegmentSize = 0;
+    Segment s_Segments[kNumSegments];
+    std::atomic<uint32_t> s_CurrentSegment(0);
+
+    uint32_t GetQueueIndex( uint64_t FenceValue )
+    {
+        switch ((D3D12_COMMAND_LIST_TYPE)(FenceValue >> 56))
+        {
+        case D3D12_COMMAND_LIST_TYPE_COMPUTE: return 1;
+        case D3D12_COMMAND_LIST_TYPE_COPY: return 2;
+        default: return 0;
+        }
+    }
+}
+
+UploadRing::Strategy UploadRing::GetStrategy( void )
+{
+    return (Strategy)(int32_t)DynamicUploadStrategy;
+}
+
+void UploadRing::SetStrategy( Strategy NewStrategy )
+{
+    DynamicUploadStrategy = NewStrategy;
+}
+
+bool UploadRing::UsesRing( bool IsConstants )
+{
+    const int32_t Current = DynamicUploadStrategy;
+    return IsConstants ? Current != kPages : Current == kRingAllData;
+}
+
+void UploadRing::Initialize( size_t SegmentSize )
+{
+    ASSERT(s_Buffer == nullptr);
+
+    s_SegmentSize = Math::AlignUp(SegmentSize, kChunkSize);
+
+    D3D12_HEAP_PROPERTIES HeapProps;
+    HeapProps.Type = D3D12_HEAP_TYPE_UPLOAD;
+    HeapProps.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+    HeapProps.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+    HeapProps.CreationNodeMask = 1;
+    HeapProps.VisibleNodeMask = 1;
+
+    D3D12_RESOURCE_DESC ResourceDesc = CD3DX12_RESOURCE_DESC::Buffer(s_SegmentSize * kNumSegments);
+
+    ASSERT_SUCCEEDED( g_Device->CreateCommittedResource(&HeapProps, D3D12_HEAP_FLAG_NONE, &ResourceDesc,
+        D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, MY_IID_PPV_ARGS(&s_Buffer)) );
+    s_Buffer->SetName(L"Dynamic Upload Ring");
+    GpuMemoryTracker::TrackResource(s_Buffer.Get(), GpuMemoryTracker::kUploadBuffers);
+
+    // Upload heaps can stay mapped for as long as they live
+    ASSERT_SUCCEEDED( s_Buffer->Map(0, nullptr, (void**)&s_CpuBase) );
+    s_GpuBase = s_Buffer->GetGPUVirtualAddress();
+
+    for (Segment& Seg : s_Segments)
+    {
+        Seg.Offset = 0;
+        Seg.NumOpenContexts = 0;
+        for (auto& Fence : Seg.Fences)
+            Fence = 0;
+    }
+    s_CurrentSegment = 0;
+}
+
+void UploadRing::Shutdown( void )
+{
+    if (s_Buffer == nullptr)
+        return;
+
+    s_Buffer->Unmap(0, nullptr);
+    s_Buffer = nullptr;
+    s_CpuBase = nullptr;
+    s_GpuBase = 0;
+}
+
+void UploadRing::EndFrame( void )
+{
+    if (s_Buffer == nullptr)
+        return;
+
+    const uint32_t Next = (s_CurrentSegment.load() + 1) % kNumSegments;
+    Segment& Seg = s_Segments[Next];
+
+    // A context that is still recording, such as one on a loading thread, would be using the segment.  The
+    // frames in flight normally cover both this and the GPU, so the waits rarely block.
+    while (Seg.NumOpenContexts.load(std::memory_order_acquire) > 0)
+        std::this_thread::yield();
+
+    for (auto& Fence : Seg.Fences)
+    {
+        const uint64_t FenceValue = Fence.exchange(0);
+        if (FenceValue != 0)
+            g_CommandManager.WaitForFence(FenceValue);
+    }
+
+    Seg.Offset = 0;
+    s_CurrentSegment.store(Next);
+}
+
+bool UploadRingAllocator::ReserveChunk( size_t MinSize )
+{
+    using namespace UploadRing;
+
+    if (s_Buffer == nullptr)
+        return false;
+
+    // Join the current segment.  Should it change before this context is counted, EndFrame() may be reusing the
+    // segment, so let go of it and join the new one.
+    while (m_Segment == kNoSegment)
+    {
+        const uint32_t Current = s_CurrentSegment.load();
+        s_Segments[Current].NumOpenContexts.fetch_add(1);
+        if (s_CurrentSegment.load() == Current)
+            m_Segment = Current;
+        else
+            s_Segments[Current].NumOpenContexts.fetch_sub(1, std::memory_order_release);
+    }
+
+    // Once the segment is full, stop bumping its offset
+    Segment& Seg = s_Segments[m_Segment];
+    if (Seg.Offset.load(std::memory_order_relaxed) >= s_SegmentSize)
+        return false;
+
+    const size_t ChunkSize = Math::AlignUp(std::max(MinSize, kChunkSize), kChunkSize);
+    const size_t Offset = Seg.Offset.fetch_add(ChunkSize, std::memory_order_relaxed);
+    if (Offset + ChunkSize > s_SegmentSize)
+        return false;
+
+    m_CurOffset = m_Segment * s_SegmentSize + Offset;
+    m_EndOffset = m_CurOffset + ChunkSize;
+    m_CpuBase = s_CpuBase;
+    m_GpuBase = s_GpuBase;
+    return true;
+}
+
+void UploadRingAllocator::Retire( uint64_t FenceValue )
+{
+    using namespace UploadRing;
+
+    if (m_Segment == kNoSegment)
+        return;
+
+    // Keep the latest fence of the queue, since the segment is free once every one of them has passed
+    std::atomic<uint64_t>& Fence = s_Segments[m_Segment].Fences[GetQueueIndex(FenceValue)];
+    uint64_t LastValue = Fence.load(std::memory_order_relaxed);
+    while (FenceValue > LastValue && !Fence.compare_exchange_weak(LastValue, FenceValue))
+        ;
+
+    s_Segments[m_Segment].NumOpenContexts.fetch_sub(1, std::memory_order_release);
+
+    m_Segment = kNoSegment;
+    m_CurOffset = 0;
+    m_EndOffset = 0;
+}
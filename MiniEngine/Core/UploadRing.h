@@ -0,0 +1,88 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// A persistently mapped upload heap for dynamic data, split into one segment per frame in flight.  Command
+// contexts reserve 64 KB chunks of the current segment with an atomic bump of its offset, and sub-allocate from
+// their chunk with no synchronization at all.  A segment is reused once every context that allocated from it has
+// finished and the GPU has passed their fences.
+//
+// Which dynamic data comes from the ring is a tuning strategy.  The paged linear allocator is always there to
+// fall back on, and the ModelViewer's -uploadsweep benchmark compares the strategies under many small draws.
+//
+
+#pragma once
+
+#include "pch.h"
+
+namespace UploadRing
+{
+    const uint32_t kNumSegments = 3;
+
+    enum Strategy
+    {
+        kPages,             // Everything comes from linear allocator pages
+        kRingConstants,     // Constants come from the ring
+        kRingAllData,       // Constants, dynamic vertices, indices and structured buffers come from the ring
+        kNumStrategies
+    };
+
+    Strategy GetStrategy( void );
+    void SetStrategy( Strategy NewStrategy );
+
+    // Whether the current strategy puts constants, or else other dynamic data, in the ring
+    bool UsesRing( bool IsConstants );
+
+    void Initialize( size_t SegmentSize = 4 * 1024 * 1024 );
+    void Shutdown( void );
+
+    // Moves on to the next segment, first waiting for the GPU to finish with it when it has to.  Call this once
+    // per frame after the frame's command lists are submitted.
+    void EndFrame( void );
+}
+
+// The part of the ring that one command context allocates from.  All of a context's allocations come from the
+// segment that was current when it made the first one.
+class UploadRingAllocator
+{
+public:
+
+    UploadRingAllocator() : m_Segment(kNoSegment), m_CurOffset(0), m_EndOffset(0), m_CpuBase(nullptr), m_GpuBase(0) {}
+
+    // Fails before the ring is initialized, or when the segment has no room left and the caller should fall back
+    // to a linear allocator page
+    bool Allocate( size_t SizeInBytes, size_t Alignment, void*& DataPtr, D3D12_GPU_VIRTUAL_ADDRESS& GpuAddress )
+    {
+        size_t Offset = Math::AlignUp(m_CurOffset, Alignment);
+        if (Offset + SizeInBytes > m_EndOffset)
+        {
+            if (!ReserveChunk(SizeInBytes + Alignment))
+                return false;
+            Offset = Math::AlignUp(m_CurOffset, Alignment);
+        }
+
+        m_CurOffset = Offset + SizeInBytes;
+        DataPtr = m_CpuBase + Offset;
+        GpuAddress = m_GpuBase + Offset;
+        return true;
+    }
+
+    // The context's command lists will be done when the fence reaches the value
+    void Retire( uint64_t FenceValue );
+
+private:
+
+    static const uint32_t kNoSegment = ~0u;
+
+    bool ReserveChunk( size_t MinSize );
+
+    uint32_t m_Segment;
+    size_t m_CurOffset;
+    size_t m_EndOffset;
+    uint8_t* m_CpuBase;
+    D3D12_GPU_VIRTUAL_ADDRESS m_GpuBase;
+};
@@ -36,6 +36,9 @@
 
 #include "d3dx12.h"
 
+#include <dxgi1_4.h>
+#include "../../Libraries/D3DX12Residency/d3dx12Residency.h"
+
 #include <cstdint>
 #include <cstdio>
 #include <cstdarg>
@@ -12,17 +12,38 @@
 //
 
 #include "Model.h"
+#include "GeometryStreaming.h"
+#include "Math/BatchBounds.h"
 #include <string.h>
 #include <float.h>
+#include <math.h>
+#include <algorithm>
 
 Model::Model()
     : m_pMesh(nullptr)
     , m_pMaterial(nullptr)
+    , m_MeshletCount(0)
+    , m_pMeshlet(nullptr)
+    , m_LODCount(0)
+    , m_pMeshLOD(nullptr)
+    , m_JointCount(0)
+    , m_pJoint(nullptr)
+    , m_pSkinData(nullptr)
+    , m_pSkinDataDepth(nullptr)
+    , m_AnimationCount(0)
+    , m_pAnimation(nullptr)
+    , m_AnimationCurveCount(0)
+    , m_pAnimationCurve(nullptr)
+    , m_AnimationKeyCount(0)
+    , m_pAnimationKey(nullptr)
     , m_pVertexData(nullptr)
     , m_pIndexData(nullptr)
     , m_pVertexDataDepth(nullptr)
     , m_pIndexDataDepth(nullptr)
     , m_SRVs(nullptr)
+    , m_pStreamedGeometry(nullptr)
+    , m_DynamicMeshCount(0)
+    , m_StaticGeometryVersion(0)
 {
     Clear();
 }
@@ -34,10 +55,15 @@ Model::~Model()
 
 void Model::Clear()
 {
+    GeometryStreaming::Destroy(m_pStreamedGeometry);
+    m_pStreamedGeometry = nullptr;
+
     m_VertexBuffer.Destroy();
     m_IndexBuffer.Destroy();
     m_VertexBufferDepth.Destroy();
     m_IndexBufferDepth.Destroy();
+    m_SkinBuffer.Destroy();
+    m_SkinBufferDepth.Destroy();
 
     delete [] m_pMesh;
     m_pMesh = nullptr;
@@ -47,6 +73,32 @@ void Model::Clear()
     m_pMaterial = nullptr;
     m_Header.materialCount = 0;
 
+    delete [] m_pMeshlet;
+    m_pMeshlet = nullptr;
+    m_MeshletCount = 0;
+
+    delete [] m_pMeshLOD;
+    m_pMeshLOD = nullptr;
+    m_LODCount = 0;
+
+    delete [] m_pJoint;
+    m_pJoint = nullptr;
+    m_JointCount = 0;
+    delete [] m_pSkinData;
+    delete [] m_pSkinDataDepth;
+    m_pSkinData = nullptr;
+    m_pSkinDataDepth = nullptr;
+
+    delete [] m_pAnimation;
+    delete [] m_pAnimationCurve;
+    delete [] m_pAnimationKey;
+    m_pAnimation = nullptr;
+    m_AnimationCount = 0;
+    m_pAnimationCurve = nullptr;
+    m_AnimationCurveCount = 0;
+    m_pAnimationKey = nullptr;
+    m_AnimationKeyCount = 0;
+
     delete [] m_pVertexData;
     delete [] m_pIndexData;
     delete [] m_pVertexDataDepth;
@@ -60,10 +112,38 @@ void Model::Clear()
     m_Header.vertexDataByteSizeDepth = 0;
     m_pIndexDataDepth = nullptr;
 
+    m_Header.signature = h3dSignature;
+    m_Header.version = h3dVersion;
+    m_Header.indexSize = sizeof(uint16_t);
+    m_Header.reserved = 0;
+
     ReleaseTextures();
 
     m_Header.boundingBox.min = Vector3(0.0f);
     m_Header.boundingBox.max = Vector3(0.0f);
+
+    m_MeshIsDynamic.clear();
+    m_MeshIsSkinned.clear();
+    m_MaterialIsOpaque.clear();
+    m_TextureManifest.clear();
+    m_MaterialTextures.clear();
+    m_DynamicMeshCount = 0;
+    ++m_StaticGeometryVersion;
+}
+
+void Model::SetMeshDynamic( uint32_t meshIndex, bool isDynamic )
+{
+    ASSERT(meshIndex < m_Header.meshCount);
+
+    if (m_MeshIsDynamic.size() < m_Header.meshCount)
+        m_MeshIsDynamic.resize(m_Header.meshCount, false);
+
+    if (m_MeshIsDynamic[meshIndex] == isDynamic)
+        return;
+
+    m_MeshIsDynamic[meshIndex] = isDynamic;
+    m_DynamicMeshCount += isDynamic ? 1 : -1;
+    ++m_StaticGeometryVersion;
 }
 
 // assuming at least 3 floats for position
@@ -73,22 +153,8 @@ void Model::ComputeMeshBoundingBox(unsigned int meshIndex, BoundingBox &bbox) co
 
     if (mesh->vertexCount > 0)
     {
-        unsigned int vertexStride = mesh->vertexStride;
-
         const float *p = (float*)(m_pVertexData + mesh->vertexDataByteOffset + mesh->attrib[attrib_position].offset);
-        const float *pEnd = (float*)(m_pVertexData + mesh->vertexDataByteOffset + mesh->vertexCount * mesh->vertexStride + mesh->attrib[attrib_position].offset);
-        bbox.min = Scalar(FLT_MAX);
-        bbox.max = Scalar(-FLT_MAX);
-
-        while (p < pEnd)
-        {
-            Vector3 pos(*(p + 0), *(p + 1), *(p + 2));
-
-            bbox.min = Min(bbox.min, pos);
-            bbox.max = Max(bbox.max, pos);
-
-            (*(uint8_t**)&p) += vertexStride;
-        }
+        Math::ComputeBounds(p, mesh->vertexStride, mesh->vertexCount, bbox.min, bbox.max);
     }
     else
     {
@@ -127,3 +193,190 @@ void Model::ComputeAllBoundingBoxes()
     }
     ComputeGlobalBoundingBox(m_Header.boundingBox);
 }
+
+void Model::InitializeBaseLODs()
+{
+    delete [] m_pMeshLOD;
+    m_LODCount = 1;
+    m_pMeshLOD = new MeshLOD [m_Header.meshCount];
+    for (unsigned int meshIndex = 0; meshIndex < m_Header.meshCount; meshIndex++)
+    {
+        m_pMeshLOD[meshIndex].indexDataByteOffset = m_pMesh[meshIndex].indexDataByteOffset;
+        m_pMeshLOD[meshIndex].indexCount = m_pMesh[meshIndex].indexCount;
+        m_pMeshLOD[meshIndex].error = 0.0f;
+    }
+}
+
+void Model::InitializeSkinnedMeshes( const SkinVertex* skinData )
+{
+    m_MeshIsSkinned.assign(m_Header.meshCount, false);
+    if (skinData == nullptr)
+        return;
+
+    for (unsigned int meshIndex = 0; meshIndex < m_Header.meshCount; meshIndex++)
+    {
+        const Mesh& mesh = m_pMesh[meshIndex];
+        const SkinVertex* meshSkin = skinData + mesh.vertexDataByteOffset / mesh.vertexStride;
+        for (unsigned int v = 0; v < mesh.vertexCount && !m_MeshIsSkinned[meshIndex]; v++)
+            m_MeshIsSkinned[meshIndex] = *(const uint32_t*)meshSkin[v].weights != 0;
+
+        if (m_MeshIsSkinned[meshIndex])
+            SetMeshDynamic(meshIndex, true);
+    }
+}
+
+namespace
+{
+    // Keys are sorted by time, and times outside of them hold the first or last key
+    XMVECTOR SampleCurve( const Model::AnimationKey* keys, uint32_t keyCount, float time, bool isRotation )
+    {
+        const Model::AnimationKey* next = std::upper_bound(keys, keys + keyCount, time,
+            [](float t, const Model::AnimationKey& key) { return t < key.time; });
+        if (next == keys)
+            return XMLoadFloat4((const XMFLOAT4*)keys[0].value);
+        if (next == keys + keyCount)
+            return XMLoadFloat4((const XMFLOAT4*)keys[keyCount - 1].value);
+
+        const Model::AnimationKey& prev = next[-1];
+        const float t = next->time > prev.time ? (time - prev.time) / (next->time - prev.time) : 0.0f;
+        XMVECTOR a = XMLoadFloat4((const XMFLOAT4*)prev.value);
+        XMVECTOR b = XMLoadFloat4((const XMFLOAT4*)next->value);
+        return isRotation ? XMQuaternionSlerp(a, b, t) : XMVectorLerp(a, b, t);
+    }
+}
+
+void Model::ComputeJointPalette( uint32_t animationIndex, float time, AffineTransform* palette ) const
+{
+    // Local poses start out as the bind pose.  The animation's curves replace what they key.
+    std::vector<XMVECTOR> translation(m_JointCount), rotation(m_JointCount), scale(m_JointCount);
+    for (uint32_t jointIndex = 0; jointIndex < m_JointCount; jointIndex++)
+    {
+        const Joint& joint = m_pJoint[jointIndex];
+        translation[jointIndex] = XMLoadFloat3((const XMFLOAT3*)joint.bindTranslation);
+        rotation[jointIndex] = XMLoadFloat4((const XMFLOAT4*)joint.bindRotation);
+        scale[jointIndex] = XMLoadFloat3((const XMFLOAT3*)joint.bindScale);
+    }
+
+    if (animationIndex < m_AnimationCount)
+    {
+        const Animation& animation = m_pAnimation[animationIndex];
+        if (animation.duration > 0.0f)
+        {
+            time = fmodf(time, animation.duration);
+            if (time < 0.0f)
+                time += animation.duration;
+        }
+
+        for (uint32_t curveIndex = animation.firstCurve; curveIndex < animation.firstCurve + animation.curveCount; curveIndex++)
+        {
+            const AnimationCurve& curve = m_pAnimationCurve[curveIndex];
+            if (curve.keyCount == 0)
+                continue;
+
+            XMVECTOR value = SampleCurve(m_pAnimationKey + curve.firstKey, curve.keyCount, time, curve.target == curve_rotation);
+            switch (curve.target)
+            {
+            case curve_translation: translation[curve.joint] = value; break;
+            case curve_rotation: rotation[curve.joint] = XMQuaternionNormalize(value); break;
+            case curve_scale: scale[curve.joint] = value; break;
+            }
+        }
+    }
+
+    // Parents come first, so each joint's parent is already in model space
+    for (uint32_t jointIndex = 0; jointIndex < m_JointCount; jointIndex++)
+    {
+        AffineTransform local(Matrix3(Quaternion(rotation[jointIndex])) * Matrix3::MakeScale(Vector3(scale[jointIndex])),
+            Vector3(translation[jointIndex]));
+        const int32_t parent = m_pJoint[jointIndex].parent;
+        palette[jointIndex] = parent >= 0 ? palette[parent] * local : local;
+    }
+
+    for (uint32_t jointIndex = 0; jointIndex < m_JointCount; jointIndex++)
+    {
+        const float (*rows)[4] = m_pJoint[jointIndex].inverseBind;
+        AffineTransform inverseBind(
+            Vector3(rows[0][0], rows[1][0], rows[2][0]),
+            Vector3(rows[0][1], rows[1][1], rows[2][1]),
+            Vector3(rows[0][2], rows[1][2], rows[2][2]),
+            Vector3(rows[0][3], rows[1][3], rows[2][3]));
+        palette[jointIndex] = palette[jointIndex] * inverseBind;
+    }
+}
+
+Model::VertexDecode Model::GetVertexDecode() const
+{
+    VertexDecode decode = { { 1.0f, 1.0f, 1.0f }, 0.0f, { 0.0f, 0.0f, 0.0f } };
+
+    if (m_Header.meshCount > 0 && m_pMesh[0].attrib[attrib_position].format != attrib_format_float)
+    {
+        Vector3 extent = m_Header.boundingBox.max - m_Header.boundingBox.min;
+        decode.positionScale[0] = extent.GetX();
+        decode.positionScale[1] = extent.GetY();
+        decode.positionScale[2] = extent.GetZ();
+        decode.positionBias[0] = m_Header.boundingBox.min.GetX();
+        decode.positionBias[1] = m_Header.boundingBox.min.GetY();
+        decode.positionBias[2] = m_Header.boundingBox.min.GetZ();
+    }
+    if (m_Header.meshCount > 0 && m_pMesh[0].attrib[attrib_normal].format != attrib_format_float)
+        decode.octahedralNormals = 1.0f;
+
+    return decode;
+}
+
+std::vector<D3D12_INPUT_ELEMENT_DESC> Model::GetInputLayout(bool depthOnly) const
+{
+    static const char* semanticNames[] = { "POSITION", "TEXCOORD", "NORMAL", "TANGENT", "BITANGENT" };
+
+    std::vector<D3D12_INPUT_ELEMENT_DESC> layout;
+    if (m_Header.meshCount == 0)
+        return layout;
+
+    const Attrib* attribs = depthOnly ? m_pMesh[0].attribDepth : m_pMesh[0].attrib;
+    const unsigned int enabled = depthOnly ? m_pMesh[0].attribsEnabledDepth : m_pMesh[0].attribsEnabled;
+
+    for (unsigned int n = 0; n < _countof(semanticNames); n++)
+    {
+        if ((enabled & (1 << n)) == 0)
+            continue;
+
+        const Attrib& attrib = attribs[n];
+        DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+        switch (attrib.format)
+        {
+        case attrib_format_float:
+        {
+            static const DXGI_FORMAT formats[] = { DXGI_FORMAT_R32_FLOAT, DXGI_FORMAT_R32G32_FLOAT, DXGI_FORMAT_R32G32B32_FLOAT, DXGI_FORMAT_R32G32B32A32_FLOAT };
+            format = formats[attrib.components - 1];
+            break;
+        }
+        case attrib_format_half:
+            format = attrib.components <= 2 ? DXGI_FORMAT_R16G16_FLOAT : DXGI_FORMAT_R16G16B16A16_FLOAT;
+            break;
+        case attrib_format_ushort:
+            if (attrib.components <= 2)
+                format = attrib.normalized ? DXGI_FORMAT_R16G16_UNORM : DXGI_FORMAT_R16G16_UINT;
+            else
+                format = attrib.normalized ? DXGI_FORMAT_R16G16B16A16_UNORM : DXGI_FORMAT_R16G16B16A16_UINT;
+            break;
+        case attrib_format_short:
+            if (attrib.components <= 2)
+                format = attrib.normalized ? DXGI_FORMAT_R16G16_SNORM : DXGI_FORMAT_R16G16_SINT;
+            else
+                format = attrib.normalized ? DXGI_FORMAT_R16G16B16A16_SNORM : DXGI_FORMAT_R16G16B16A16_SINT;
+            break;
+        case attrib_format_ubyte:
+            format = attrib.normalized ? DXGI_FORMAT_R8G8B8A8_UNORM : DXGI_FORMAT_R8G8B8A8_UINT;
+            break;
+        case attrib_format_byte:
+            format = attrib.normalized ? DXGI_FORMAT_R8G8B8A8_SNORM : DXGI_FORMAT_R8G8B8A8_SINT;
+            break;
+        }
+        ASSERT(format != DXGI_FORMAT_UNKNOWN, "Unsupported vertex attribute format");
+
+        D3D12_INPUT_ELEMENT_DESC desc = { semanticNames[n], 0, format, 0, attrib.offset, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 };
+        layout.push_back(desc);
+    }
+
+    return layout;
+}
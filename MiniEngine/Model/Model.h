@@ -20,6 +20,9 @@
 
 using namespace Math;
 
+class StreamedTexture;
+class StreamedGeometry;
+
 class Model
 {
 public:
@@ -54,6 +57,8 @@ public:
         attrib_mask_normal = attrib_mask_2,
         attrib_mask_tangent = attrib_mask_3,
         attrib_mask_bitangent = attrib_mask_4,
+        attrib_mask_joints = attrib_mask_5,
+        attrib_mask_weights = attrib_mask_6,
     };
 
     enum
@@ -82,6 +87,11 @@ public:
         attrib_tangent = attrib_3,
         attrib_bitangent = attrib_4,
 
+        // Joint indices and weights only exist while ModelConverter optimizes a skinned model, so that the
+        // vertex reorders carry them along.  Saved files keep them in the skinning section instead.
+        attrib_joints = attrib_5,
+        attrib_weights = attrib_6,
+
         maxAttribs = 16
     };
 
@@ -93,6 +103,7 @@ public:
         attrib_format_ushort,
         attrib_format_short,
         attrib_format_float,
+        attrib_format_half,
 
         attrib_formats
     };
@@ -103,13 +114,22 @@ public:
         Vector3 max;
     };
 
+    // Files start with the signature and version.  Sizes and offsets are 64-bit so that a stream can pass 4GB,
+    // and every mesh's indices are 16-bit or 32-bit as the header says.  Files written before the signature
+    // existed start with the mesh count instead, and load with 16-bit indices into the current layout.
+    enum { h3dSignature = 0x32443348, h3dVersion = 2 }; // "H3D2"
+
     struct Header
     {
+        uint32_t signature;
+        uint32_t version;
         uint32_t meshCount;
         uint32_t materialCount;
-        uint32_t vertexDataByteSize;
-        uint32_t indexDataByteSize;
-        uint32_t vertexDataByteSizeDepth;
+        uint64_t vertexDataByteSize;
+        uint64_t indexDataByteSize;
+        uint64_t vertexDataByteSizeDepth;
+        uint32_t indexSize; // bytes per index, 2 or 4
+        uint32_t reserved;
         BoundingBox boundingBox;
     };
     Header m_Header;
@@ -134,16 +154,137 @@ public:
         Attrib attrib[maxAttribs];
         Attrib attribDepth[maxAttribs];
 
-        unsigned int vertexDataByteOffset;
+        uint64_t vertexDataByteOffset;
         unsigned int vertexCount;
-        unsigned int indexDataByteOffset;
         unsigned int indexCount;
+        uint64_t indexDataByteOffset;
 
-        unsigned int vertexDataByteOffsetDepth;
+        uint64_t vertexDataByteOffsetDepth;
         unsigned int vertexCountDepth;
     };
     Mesh *m_pMesh;
 
+    // Draws count indices and vertices, where the meshes hold byte offsets.  Offsets are the same in both
+    // index streams, and vertex offsets are in the full or depth-only stream's vertices.
+    uint32_t GetIndexSize() const { return m_Header.indexSize; }
+    DXGI_FORMAT GetIndexFormat() const { return m_Header.indexSize == 4 ? DXGI_FORMAT_R32_UINT : DXGI_FORMAT_R16_UINT; }
+    uint32_t GetStartIndex( uint64_t indexDataByteOffset ) const { return (uint32_t)(indexDataByteOffset / m_Header.indexSize); }
+    uint32_t GetBaseVertex( const Mesh& mesh, bool depthOnly ) const
+    {
+        return depthOnly ? (uint32_t)(mesh.vertexDataByteOffsetDepth / m_VertexStrideDepth) : (uint32_t)(mesh.vertexDataByteOffset / m_VertexStride);
+    }
+
+    // Clusters of at most maxMeshletVertices unique vertices and maxMeshletTriangles triangles that split up
+    // the depth-only index stream, so that shadow casters can be culled at a finer grain than whole meshes.
+    // Each meshlet is a contiguous run of its mesh's indices.  Meshlets are stored after the depth-only
+    // indices, and files written before they existed simply have none.
+    enum { maxMeshletVertices = 64, maxMeshletTriangles = 124 };
+
+    struct Meshlet
+    {
+        float center[3]; // bounding sphere
+        float radius;
+        float coneAxis[3]; // every triangle normal is within the cone around this axis
+        float coneCutoff; // sine of the cone's half angle, or 1 when the cone is too wide to ever face away
+
+        unsigned int meshIndex;
+        unsigned int indexOffset; // from the mesh's first index
+        unsigned int indexCount;
+        unsigned int vertexCount;
+    };
+    uint32_t m_MeshletCount;
+    Meshlet *m_pMeshlet;
+
+    // Simplified levels of detail of every mesh.  Each level is a run of indices into the mesh's own vertices,
+    // at the same offset in both index streams, so a draw changes level by changing only its index range.
+    // Level 0 is the mesh itself, and the error of a level estimates how far (in model units) simplification
+    // moved the surface.  Levels are stored after the meshlets, and files written before they existed load
+    // with level 0 alone.
+    enum { maxLODs = 5 };
+
+    struct MeshLOD
+    {
+        uint64_t indexDataByteOffset;
+        unsigned int indexCount;
+        float error;
+    };
+    uint32_t m_LODCount; // levels per mesh
+    MeshLOD *m_pMeshLOD;
+
+    const MeshLOD& GetMeshLOD( uint32_t meshIndex, uint32_t lod ) const { return m_pMeshLOD[meshIndex * m_LODCount + lod]; }
+
+    // Meshes are static unless flagged otherwise.  The flags are kept outside of Mesh because meshes
+    // are read directly from the H3D file.  The static geometry version changes whenever the set of
+    // static meshes does, so anything cached from static meshes (e.g. shadow maps) knows to rebuild.
+    bool IsMeshDynamic( uint32_t meshIndex ) const { return meshIndex < m_MeshIsDynamic.size() && m_MeshIsDynamic[meshIndex]; }
+    void SetMeshDynamic( uint32_t meshIndex, bool isDynamic );
+    uint32_t GetDynamicMeshCount() const { return m_DynamicMeshCount; }
+    uint32_t GetStaticGeometryVersion() const { return m_StaticGeometryVersion; }
+
+    // Skeletal animation.  Every vertex of both streams blends up to maxJointWeights joints, with a SkinVertex
+    // for each vertex in the same order as the vertex data, and vertices without weights are not skinned.
+    // Joints are listed after their parents.  An animation is a set of curves, each keying the translation,
+    // rotation or scale of one joint relative to its parent, and joints without a curve keep their bind pose.
+    // Skinning is stored after the LODs, and files written before it existed load without joints.  Skinned
+    // meshes are flagged dynamic on load.
+    enum { maxJoints = 256, maxJointWeights = 4, maxAnimationName = 64 };
+    enum { curve_translation = 0, curve_rotation, curve_scale };
+
+    struct Joint
+    {
+        float inverseBind[3][4]; // rows of the affine transform from model space to the joint's bind space
+        float bindTranslation[3];
+        int32_t parent; // -1 at a root
+        float bindRotation[4]; // quaternion, xyzw
+        float bindScale[3];
+        uint32_t reserved;
+    };
+    uint32_t m_JointCount;
+    Joint *m_pJoint;
+
+    struct SkinVertex
+    {
+        uint8_t joints[maxJointWeights];
+        uint8_t weights[maxJointWeights]; // unorm, summing to 255 when skinned and 0 otherwise
+    };
+    SkinVertex *m_pSkinData;
+    SkinVertex *m_pSkinDataDepth;
+    StructuredBuffer m_SkinBuffer;
+    StructuredBuffer m_SkinBufferDepth;
+
+    struct AnimationKey
+    {
+        float time; // seconds
+        float value[4]; // xyz, or a quaternion for rotations
+    };
+    struct AnimationCurve
+    {
+        uint32_t joint;
+        uint32_t target; // curve_translation, curve_rotation or curve_scale
+        uint32_t firstKey;
+        uint32_t keyCount;
+    };
+    struct Animation
+    {
+        char name[maxAnimationName];
+        float duration; // seconds
+        uint32_t firstCurve;
+        uint32_t curveCount;
+    };
+    uint32_t m_AnimationCount;
+    Animation *m_pAnimation;
+    uint32_t m_AnimationCurveCount;
+    AnimationCurve *m_pAnimationCurve;
+    uint32_t m_AnimationKeyCount;
+    AnimationKey *m_pAnimationKey;
+
+    bool IsSkinned() const { return m_JointCount > 0; }
+    bool IsMeshSkinned( uint32_t meshIndex ) const { return meshIndex < m_MeshIsSkinned.size() && m_MeshIsSkinned[meshIndex]; }
+
+    // The transform of every joint from the bind pose to its pose in the animation at the given time, which
+    // loops over the animation's duration.  An animation index past the last poses the bind pose.
+    void ComputeJointPalette( uint32_t animationIndex, float time, AffineTransform* palette ) const;
+
     struct Material
     {
         Vector3 diffuse;
@@ -169,6 +310,26 @@ public:
     };
     Material *m_pMaterial;
 
+    // Materials that ModelConverter split off alpha-tested ones, holding the triangles that the alpha texture
+    // covers fully.  They are never alpha tested, whatever their textures, and their triangles come in both
+    // windings so that they still draw two-sided.  The flags are stored after the skinning, and files written
+    // before they existed have none.
+    bool IsMaterialOpaque( uint32_t materialIndex ) const { return materialIndex < m_MaterialIsOpaque.size() && m_MaterialIsOpaque[materialIndex]; }
+
+    // The texture files of the materials, as ModelConverter resolved them:  each slot's path with the fallbacks
+    // applied and the extension of the file found, and every file listed once per color space.  Materials
+    // index them by slot, with textureNone for slots that have no texture.  They are stored after the opaque
+    // material flags, and files written before them have none, which load by probing the material's paths.
+    enum { maxTexReferencePath = 256 };
+    enum { textureNone = 0xffffffff };
+    struct TextureReference
+    {
+        char path[maxTexReferencePath];
+        uint32_t sRGB;
+    };
+    std::vector<TextureReference> m_TextureManifest;
+    std::vector<uint32_t> m_MaterialTextures;   // Material::texCount per material
+
     unsigned char *m_pVertexData;
     unsigned char *m_pIndexData;
     StructuredBuffer m_VertexBuffer;
@@ -192,21 +353,73 @@ public:
         return m_Header.boundingBox;
     }
 
+    // Quantized files store positions in 16-bit unorms relative to the model's bounding box, and normals,
+    // tangents and bitangents octahedral-encoded in pairs of 16-bit snorms.  Older files store floats, which
+    // decode with a unit scale.  Vertex shaders rebuild positions as positionScale * stored + positionBias.
+    struct VertexDecode
+    {
+        float positionScale[3];
+        float octahedralNormals; // nonzero when the normals need decoding
+        float positionBias[3];
+    };
+    VertexDecode GetVertexDecode() const;
+
+    // One element per enabled attribute of the full or depth-only vertex stream, in attribute order.  Every
+    // mesh shares the first mesh's vertex layout.
+    std::vector<D3D12_INPUT_ELEMENT_DESC> GetInputLayout(bool depthOnly) const;
+
     D3D12_CPU_DESCRIPTOR_HANDLE* GetSRVs( uint32_t materialIdx ) const
     {
         return m_SRVs + materialIdx * 6;
     }
 
+    // Asks for the streamed textures of a material to be sampled at the given resolution, as the log2 of texels
+    // per unit of UV.  Materials whose textures were loaded whole ignore it.
+    bool HasStreamedTextures() const { return !m_StreamedTextures.empty(); }
+    void RequestTextureResolution( uint32_t materialIdx, float log2Resolution ) const;
+
+    // Models whose geometry does not fit in the geometry streaming budget keep the coarsest level of every mesh
+    // resident, and stream in the rest of a mesh while it is asked for, closest or most visible first.  A mesh
+    // may not be drawn finer than its resident level, so anything that reads whole meshes, such as meshlets,
+    // needs a model whose geometry is not streamed.
+    bool IsGeometryStreamed() const { return m_pStreamedGeometry != nullptr; }
+    uint32_t GetResidentLOD( uint32_t meshIndex ) const;
+    void RequestMeshGeometry( uint32_t meshIndex, float priority ) const;
+
 protected:
 
-    bool LoadH3D(const char *filename);
+    // Geometry is uploaded straight from a mapping of the file.  The CPU copies in m_pVertexData and friends
+    // are only kept when asked for, e.g. by tools that go on to modify or save the model.
+    bool LoadH3D(const char *filename, bool keepGeometryData = false);
     bool SaveH3D(const char *filename) const;
 
     void ComputeMeshBoundingBox(unsigned int meshIndex, BoundingBox &bbox) const;
     void ComputeGlobalBoundingBox(BoundingBox &bbox) const;
     void ComputeAllBoundingBoxes();
 
+    // A single level per mesh, for models without simplified levels
+    void InitializeBaseLODs();
+
+    // Finds the meshes with weighted vertices in the full stream's skin data and flags them dynamic
+    void InitializeSkinnedMeshes( const SkinVertex* skinData );
+
     void ReleaseTextures();
     void LoadTextures();
+    void LoadTextureManifest();
+    const StreamedTexture* FindStreamedTexture( uint32_t materialIdx, uint32_t slot );
+    void PackTextures( const std::vector<TextureManager::PackedTextures::Source>& slots );
     D3D12_CPU_DESCRIPTOR_HANDLE* m_SRVs;
+    std::vector<StreamedTexture*> m_StreamedTextures;   // In the slots of m_SRVs, or empty without streaming
+    TextureManager::PackedTextures m_PackedTextures;    // Holds the views of the other slots
+
+    // Makes the geometry buffers reserved, with the coarsest levels and the vertices they reach uploaded from
+    // the file's contents, and each mesh a part that streams in the rest
+    void CreateStreamedGeometry( const char* filename, uint64_t fileOffset, const unsigned char* const data[4] );
+    StreamedGeometry* m_pStreamedGeometry;
+
+    std::vector<bool> m_MeshIsDynamic;
+    std::vector<bool> m_MeshIsSkinned;
+    std::vector<bool> m_MaterialIsOpaque;
+    uint32_t m_DynamicMeshCount;
+    uint32_t m_StaticGeometryVersion;
 };
@@ -15,27 +15,268 @@
 #include "Utility.h"
 #include "TextureManager.h"
 #include "GraphicsCore.h"
+#include "GpuMemoryTracker.h"
 #include "DescriptorHeap.h"
 #include "CommandContext.h"
+#include "AssetIO.h"
+#include "TextureStreaming.h"
+#include "GeometryStreaming.h"
+#include "StartupProfile.h"
 #include <stdio.h>
+#include <algorithm>
 
-bool Model::LoadH3D(const char *filename)
+namespace
 {
-    FILE *file = nullptr;
-    if (0 != fopen_s(&file, filename, "rb"))
+    // A read-only view of a whole file.  Geometry is copied straight out of the view, so loading never holds
+    // more than the page cache and the upload memory in flight.
+    class MappedFile
+    {
+    public:
+        MappedFile(const char *filename) : m_File(INVALID_HANDLE_VALUE), m_Mapping(nullptr), m_pData(nullptr), m_Size(0)
+        {
+            m_File = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+            if (m_File == INVALID_HANDLE_VALUE)
+                return;
+
+            LARGE_INTEGER fileSize;
+            if (!GetFileSizeEx(m_File, &fileSize) || fileSize.QuadPart == 0)
+                return;
+
+            m_Mapping = CreateFileMappingA(m_File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (m_Mapping == nullptr)
+                return;
+
+            m_pData = (const unsigned char*)MapViewOfFile(m_Mapping, FILE_MAP_READ, 0, 0, 0);
+            if (m_pData != nullptr)
+                m_Size = (size_t)fileSize.QuadPart;
+        }
+
+        ~MappedFile()
+        {
+            if (m_pData != nullptr)
+                UnmapViewOfFile(m_pData);
+            if (m_Mapping != nullptr)
+                CloseHandle(m_Mapping);
+            if (m_File != INVALID_HANDLE_VALUE)
+                CloseHandle(m_File);
+        }
+
+        bool IsValid() const { return m_pData != nullptr; }
+        size_t GetSize() const { return m_Size; }
+
+        // Touches every page of the view, so that reading the file is timed apart from parsing it
+        void Prefault() const
+        {
+            volatile unsigned char sink = 0;
+            for (size_t offset = 0; offset < m_Size; offset += 4096)
+                sink += m_pData[offset];
+        }
+
+        // Returns the next byteCount bytes and moves past them, or nullptr if the file ends first
+        const unsigned char* Consume(size_t& cursor, size_t byteCount) const
+        {
+            if (byteCount > m_Size - cursor)
+                return nullptr;
+
+            const unsigned char* data = m_pData + cursor;
+            cursor += byteCount;
+            return data;
+        }
+
+        bool Read(size_t& cursor, void* dest, size_t byteCount) const
+        {
+            const unsigned char* data = Consume(cursor, byteCount);
+            if (data != nullptr)
+                memcpy(dest, data, byteCount);
+            return data != nullptr;
+        }
+
+    private:
+        HANDLE m_File;
+        HANDLE m_Mapping;
+        const unsigned char* m_pData;
+        size_t m_Size;
+    };
+
+    // The layout of files written before the signature, with 32-bit sizes and offsets and 16-bit indices
+    struct LegacyHeader
+    {
+        uint32_t meshCount;
+        uint32_t materialCount;
+        uint32_t vertexDataByteSize;
+        uint32_t indexDataByteSize;
+        uint32_t vertexDataByteSizeDepth;
+        Model::BoundingBox boundingBox;
+    };
+
+    struct LegacyMesh
+    {
+        Model::BoundingBox boundingBox;
+
+        unsigned int materialIndex;
+
+        unsigned int attribsEnabled;
+        unsigned int attribsEnabledDepth;
+        unsigned int vertexStride;
+        unsigned int vertexStrideDepth;
+        Model::Attrib attrib[Model::maxAttribs];
+        Model::Attrib attribDepth[Model::maxAttribs];
+
+        unsigned int vertexDataByteOffset;
+        unsigned int vertexCount;
+        unsigned int indexDataByteOffset;
+        unsigned int indexCount;
+
+        unsigned int vertexDataByteOffsetDepth;
+        unsigned int vertexCountDepth;
+    };
+
+    struct LegacyMeshLOD
+    {
+        unsigned int indexDataByteOffset;
+        unsigned int indexCount;
+        float error;
+    };
+
+    bool ReadHeader(const MappedFile& file, size_t& cursor, Model::Header& header, bool& isLegacy)
+    {
+        uint32_t signature = 0;
+        size_t peek = cursor;
+        if (!file.Read(peek, &signature, sizeof(uint32_t)))
+            return false;
+
+        isLegacy = signature != Model::h3dSignature;
+        if (!isLegacy)
+        {
+            return file.Read(cursor, &header, sizeof(Model::Header)) && header.version == Model::h3dVersion &&
+                (header.indexSize == sizeof(uint16_t) || header.indexSize == sizeof(uint32_t));
+        }
+
+        LegacyHeader legacy;
+        if (!file.Read(cursor, &legacy, sizeof(LegacyHeader)))
+            return false;
+
+        header.signature = Model::h3dSignature;
+        header.version = Model::h3dVersion;
+        header.meshCount = legacy.meshCount;
+        header.materialCount = legacy.materialCount;
+        header.vertexDataByteSize = legacy.vertexDataByteSize;
+        header.indexDataByteSize = legacy.indexDataByteSize;
+        header.vertexDataByteSizeDepth = legacy.vertexDataByteSizeDepth;
+        header.indexSize = sizeof(uint16_t);
+        header.reserved = 0;
+        header.boundingBox = legacy.boundingBox;
+        return true;
+    }
+
+    bool ReadMeshes(const MappedFile& file, size_t& cursor, bool isLegacy, Model::Mesh* meshes, uint32_t meshCount)
+    {
+        if (!isLegacy)
+            return file.Read(cursor, meshes, sizeof(Model::Mesh) * meshCount);
+
+        std::vector<LegacyMesh> legacy(meshCount);
+        if (!file.Read(cursor, legacy.data(), sizeof(LegacyMesh) * meshCount))
+            return false;
+
+        for (uint32_t meshIndex = 0; meshIndex < meshCount; ++meshIndex)
+        {
+            const LegacyMesh& src = legacy[meshIndex];
+            Model::Mesh& dst = meshes[meshIndex];
+            dst.boundingBox = src.boundingBox;
+            dst.materialIndex = src.materialIndex;
+            dst.attribsEnabled = src.attribsEnabled;
+            dst.attribsEnabledDepth = src.attribsEnabledDepth;
+            dst.vertexStride = src.vertexStride;
+            dst.vertexStrideDepth = src.vertexStrideDepth;
+            memcpy(dst.attrib, src.attrib, sizeof(dst.attrib));
+            memcpy(dst.attribDepth, src.attribDepth, sizeof(dst.attribDepth));
+            dst.vertexDataByteOffset = src.vertexDataByteOffset;
+            dst.vertexCount = src.vertexCount;
+            dst.indexCount = src.indexCount;
+            dst.indexDataByteOffset = src.indexDataByteOffset;
+            dst.vertexDataByteOffsetDepth = src.vertexDataByteOffsetDepth;
+            dst.vertexCountDepth = src.vertexCountDepth;
+        }
+        return true;
+    }
+
+    bool ReadMeshLODs(const MappedFile& file, size_t& cursor, bool isLegacy, Model::MeshLOD* levels, uint32_t levelCount)
+    {
+        if (!isLegacy)
+            return file.Read(cursor, levels, sizeof(Model::MeshLOD) * levelCount);
+
+        std::vector<LegacyMeshLOD> legacy(levelCount);
+        if (!file.Read(cursor, legacy.data(), sizeof(LegacyMeshLOD) * levelCount))
+            return false;
+
+        for (uint32_t n = 0; n < levelCount; ++n)
+        {
+            levels[n].indexDataByteOffset = legacy[n].indexDataByteOffset;
+            levels[n].indexCount = legacy[n].indexCount;
+            levels[n].error = legacy[n].error;
+        }
+        return true;
+    }
+
+    // The geometry buffers in the order of their sections in the file
+    enum { kStreamVertex, kStreamIndex, kStreamVertexDepth, kStreamIndexDepth, kNumGeometryStreams };
+
+    // Keeps the tiles of the vertices that a run of a mesh's indices reaches resident.  Indices may reach
+    // anywhere in the mesh, and a vertex may straddle two tiles.  A byte range within each tile covers it.
+    void AddReachedVertices(StreamedGeometry* geometry, uint32_t stream, const unsigned char* indices, uint32_t indexCount,
+        uint32_t indexSize, uint64_t vertexDataByteOffset, uint32_t vertexStride)
+    {
+        const uint64_t tileSize = D3D12_TILED_RESOURCE_TILE_SIZE_IN_BYTES;
+        std::vector<uint64_t> tiles;
+        tiles.reserve(2 * indexCount);
+        for (uint32_t n = 0; n < indexCount; ++n)
+        {
+            const uint32_t index = indexSize == 4 ? ((const uint32_t*)indices)[n] : ((const uint16_t*)indices)[n];
+            const uint64_t vertexStart = vertexDataByteOffset + (uint64_t)index * vertexStride;
+            tiles.push_back(vertexStart / tileSize);
+            tiles.push_back((vertexStart + vertexStride - 1) / tileSize);
+        }
+
+        std::sort(tiles.begin(), tiles.end());
+        tiles.erase(std::unique(tiles.begin(), tiles.end()), tiles.end());
+        for (uint64_t tile : tiles)
+            GeometryStreaming::AddRange(geometry, StreamedGeometry::kResidentPart, stream, tile * tileSize, 1);
+    }
+
+    // Keeps a CPU copy of a geometry stream for callers that edit or save the model
+    unsigned char* CopyGeometry(const unsigned char* src, size_t byteCount)
+    {
+        unsigned char* copy = new unsigned char[byteCount];
+        memcpy(copy, src, byteCount);
+        return copy;
+    }
+}
+
+bool Model::LoadH3D(const char *filename, bool keepGeometryData)
+{
+    const int64_t readTick = SystemTime::GetCurrentTick();
+    MappedFile file(filename);
+    if (!file.IsValid())
         return false;
+    if (StartupProfile::IsRecording())
+        file.Prefault();
 
-    bool ok = false;
+    const int64_t parseTick = SystemTime::GetCurrentTick();
+    StartupProfile::Record(StartupProfile::kModelRead, readTick, parseTick, file.GetSize());
 
-    if (1 != fread(&m_Header, sizeof(Header), 1, file)) goto h3d_load_fail;
+    size_t cursor = 0;
+
+    bool isLegacy = false;
+    if (!ReadHeader(file, cursor, m_Header, isLegacy))
+        return false;
 
     m_pMesh = new Mesh [m_Header.meshCount];
     m_pMaterial = new Material [m_Header.materialCount];
 
-    if (m_Header.meshCount > 0)
-        if (1 != fread(m_pMesh, sizeof(Mesh) * m_Header.meshCount, 1, file)) goto h3d_load_fail;
-    if (m_Header.materialCount > 0)
-        if (1 != fread(m_pMaterial, sizeof(Material) * m_Header.materialCount, 1, file)) goto h3d_load_fail;
+    if (!ReadMeshes(file, cursor, isLegacy, m_pMesh, m_Header.meshCount))
+        return false;
+    if (!file.Read(cursor, m_pMaterial, sizeof(Material) * m_Header.materialCount))
+        return false;
 
     m_VertexStride = m_pMesh[0].vertexStride;
     m_VertexStrideDepth = m_pMesh[0].vertexStrideDepth;
@@ -45,6 +286,8 @@ bool Model::LoadH3D(const char *filename)
         const Mesh& mesh = m_pMesh[meshIndex];
         ASSERT(mesh.vertexStride == m_VertexStride);
         ASSERT(mesh.vertexStrideDepth == m_VertexStrideDepth);
+        ASSERT(memcmp(mesh.attrib, m_pMesh[0].attrib, sizeof(mesh.attrib)) == 0);
+        ASSERT(memcmp(mesh.attribDepth, m_pMesh[0].attribDepth, sizeof(mesh.attribDepth)) == 0);
     }
     for (uint32_t meshIndex = 0; meshIndex < m_Header.meshCount; ++meshIndex)
     {
@@ -52,57 +295,192 @@ bool Model::LoadH3D(const char *filename)
 
         ASSERT( mesh.attribsEnabled ==
             (attrib_mask_position | attrib_mask_texcoord0 | attrib_mask_normal | attrib_mask_tangent | attrib_mask_bitangent) );
-        ASSERT(mesh.attrib[0].components == 3 && mesh.attrib[0].format == Model::attrib_format_float); // position
-        ASSERT(mesh.attrib[1].components == 2 && mesh.attrib[1].format == Model::attrib_format_float); // texcoord0
-        ASSERT(mesh.attrib[2].components == 3 && mesh.attrib[2].format == Model::attrib_format_float); // normal
-        ASSERT(mesh.attrib[3].components == 3 && mesh.attrib[3].format == Model::attrib_format_float); // tangent
-        ASSERT(mesh.attrib[4].components == 3 && mesh.attrib[4].format == Model::attrib_format_float); // bitangent
 
+        // Either every attribute is float, or the file is quantized
+        if (mesh.attrib[0].format == Model::attrib_format_float)
+        {
+            ASSERT(mesh.attrib[0].components == 3 && mesh.attrib[0].format == Model::attrib_format_float); // position
+            ASSERT(mesh.attrib[1].components == 2 && mesh.attrib[1].format == Model::attrib_format_float); // texcoord0
+            ASSERT(mesh.attrib[2].components == 3 && mesh.attrib[2].format == Model::attrib_format_float); // normal
+            ASSERT(mesh.attrib[3].components == 3 && mesh.attrib[3].format == Model::attrib_format_float); // tangent
+            ASSERT(mesh.attrib[4].components == 3 && mesh.attrib[4].format == Model::attrib_format_float); // bitangent
+        }
+        else
+        {
+            ASSERT(mesh.attrib[0].components == 4 && mesh.attrib[0].format == Model::attrib_format_ushort && mesh.attrib[0].normalized); // position
+            ASSERT(mesh.attrib[1].components == 2 && mesh.attrib[1].format == Model::attrib_format_half); // texcoord0
+            ASSERT(mesh.attrib[2].components == 2 && mesh.attrib[2].format == Model::attrib_format_short && mesh.attrib[2].normalized); // normal
+            ASSERT(mesh.attrib[3].components == 2 && mesh.attrib[3].format == Model::attrib_format_short && mesh.attrib[3].normalized); // tangent
+            ASSERT(mesh.attrib[4].components == 2 && mesh.attrib[4].format == Model::attrib_format_short && mesh.attrib[4].normalized); // bitangent
+        }
+
+        // Both streams must decode positions the same way for the depth test against the Z prepass
         ASSERT( mesh.attribsEnabledDepth ==
             (attrib_mask_position) );
-        ASSERT(mesh.attrib[0].components == 3 && mesh.attrib[0].format == Model::attrib_format_float); // position
+        ASSERT(mesh.attribDepth[0].components == mesh.attrib[0].components && mesh.attribDepth[0].format == mesh.attrib[0].format); // position
     }
 #endif
 
-    m_pVertexData = new unsigned char[ m_Header.vertexDataByteSize ];
-    m_pIndexData = new unsigned char[ m_Header.indexDataByteSize ];
-    m_pVertexDataDepth = new unsigned char[ m_Header.vertexDataByteSizeDepth ];
-    m_pIndexDataDepth = new unsigned char[ m_Header.indexDataByteSize ];
+    const size_t geometryOffset = cursor;
+    const unsigned char* vertexData = file.Consume(cursor, m_Header.vertexDataByteSize);
+    const unsigned char* indexData = file.Consume(cursor, m_Header.indexDataByteSize);
+    const unsigned char* vertexDataDepth = file.Consume(cursor, m_Header.vertexDataByteSizeDepth);
+    const unsigned char* indexDataDepth = file.Consume(cursor, m_Header.indexDataByteSize);
+    if (vertexData == nullptr || indexData == nullptr || vertexDataDepth == nullptr || indexDataDepth == nullptr)
+        return false;
 
-    if (m_Header.vertexDataByteSize > 0)
-        if (1 != fread(m_pVertexData, m_Header.vertexDataByteSize, 1, file)) goto h3d_load_fail;
-    if (m_Header.indexDataByteSize > 0)
-        if (1 != fread(m_pIndexData, m_Header.indexDataByteSize, 1, file)) goto h3d_load_fail;
+    // Older files end here, without meshlets
+    const bool hasMeshletCount = file.Read(cursor, &m_MeshletCount, sizeof(uint32_t));
+    if (hasMeshletCount && m_MeshletCount > 0)
+    {
+        m_pMeshlet = new Meshlet [m_MeshletCount];
+        if (!file.Read(cursor, m_pMeshlet, sizeof(Meshlet) * m_MeshletCount))
+            return false;
+    }
+    else
+        m_MeshletCount = 0;
 
-    if (m_Header.vertexDataByteSizeDepth > 0)
-        if (1 != fread(m_pVertexDataDepth, m_Header.vertexDataByteSizeDepth, 1, file)) goto h3d_load_fail;
-    if (m_Header.indexDataByteSize > 0)
-        if (1 != fread(m_pIndexDataDepth, m_Header.indexDataByteSize, 1, file)) goto h3d_load_fail;
-
-    m_VertexBuffer.Create(L"VertexBuffer", m_Header.vertexDataByteSize / m_VertexStride, m_VertexStride, m_pVertexData);
-    m_IndexBuffer.Create(L"IndexBuffer", m_Header.indexDataByteSize / sizeof(uint16_t), sizeof(uint16_t), m_pIndexData);
-    delete [] m_pVertexData;
-    m_pVertexData = nullptr;
-    delete [] m_pIndexData;
-    m_pIndexData = nullptr;
-
-    m_VertexBufferDepth.Create(L"VertexBufferDepth", m_Header.vertexDataByteSizeDepth / m_VertexStrideDepth, m_VertexStrideDepth, m_pVertexDataDepth);
-    m_IndexBufferDepth.Create(L"IndexBufferDepth", m_Header.indexDataByteSize / sizeof(uint16_t), sizeof(uint16_t), m_pIndexDataDepth);
-    delete [] m_pVertexDataDepth;
-    m_pVertexDataDepth = nullptr;
-    delete [] m_pIndexDataDepth;
-    m_pIndexDataDepth = nullptr;
+    // As are files without LODs
+    if (hasMeshletCount && file.Read(cursor, &m_LODCount, sizeof(uint32_t)) && m_LODCount > 0)
+    {
+        m_pMeshLOD = new MeshLOD [m_Header.meshCount * m_LODCount];
+        if (!ReadMeshLODs(file, cursor, isLegacy, m_pMeshLOD, m_Header.meshCount * m_LODCount))
+            return false;
+    }
+    else
+        InitializeBaseLODs();
+
+    // And files without skinning.  The skin data covers every vertex of the full stream, then the depth-only.
+    const uint32_t vertexCount = (uint32_t)(m_Header.vertexDataByteSize / m_VertexStride);
+    const uint32_t vertexCountDepth = (uint32_t)(m_Header.vertexDataByteSizeDepth / m_VertexStrideDepth);
+    const unsigned char* skinData = nullptr;
+    const unsigned char* skinDataDepth = nullptr;
+    if (hasMeshletCount && file.Read(cursor, &m_JointCount, sizeof(uint32_t)) && m_JointCount > 0)
+    {
+        ASSERT(m_JointCount <= maxJoints);
+        m_pJoint = new Joint [m_JointCount];
+        if (!file.Read(cursor, m_pJoint, sizeof(Joint) * m_JointCount))
+            return false;
+
+        skinData = file.Consume(cursor, sizeof(SkinVertex) * vertexCount);
+        skinDataDepth = file.Consume(cursor, sizeof(SkinVertex) * vertexCountDepth);
+        if (skinData == nullptr || skinDataDepth == nullptr)
+            return false;
+
+        if (!file.Read(cursor, &m_AnimationCount, sizeof(uint32_t)) ||
+            !file.Read(cursor, &m_AnimationCurveCount, sizeof(uint32_t)) ||
+            !file.Read(cursor, &m_AnimationKeyCount, sizeof(uint32_t)))
+            return false;
+
+        m_pAnimation = new Animation [m_AnimationCount];
+        m_pAnimationCurve = new AnimationCurve [m_AnimationCurveCount];
+        m_pAnimationKey = new AnimationKey [m_AnimationKeyCount];
+        if (!file.Read(cursor, m_pAnimation, sizeof(Animation) * m_AnimationCount) ||
+            !file.Read(cursor, m_pAnimationCurve, sizeof(AnimationCurve) * m_AnimationCurveCount) ||
+            !file.Read(cursor, m_pAnimationKey, sizeof(AnimationKey) * m_AnimationKeyCount))
+            return false;
+    }
+    else
+        m_JointCount = 0;
 
-    LoadTextures();
+    // And files without opaque material flags
+    uint32_t materialFlagCount = 0;
+    if (hasMeshletCount && file.Read(cursor, &materialFlagCount, sizeof(uint32_t)) && materialFlagCount > 0)
+    {
+        std::vector<uint32_t> materialFlags(materialFlagCount);
+        if (materialFlagCount != m_Header.materialCount ||
+            !file.Read(cursor, materialFlags.data(), sizeof(uint32_t) * materialFlagCount))
+            return false;
+
+        m_MaterialIsOpaque.resize(materialFlagCount);
+        for (uint32_t materialIdx = 0; materialIdx < materialFlagCount; ++materialIdx)
+            m_MaterialIsOpaque[materialIdx] = materialFlags[materialIdx] != 0;
+    }
 
-    ok = true;
+    // And files without a texture manifest
+    uint32_t textureCount = 0;
+    if (hasMeshletCount && file.Read(cursor, &textureCount, sizeof(uint32_t)) && textureCount > 0)
+    {
+        m_TextureManifest.resize(textureCount);
+        m_MaterialTextures.resize(m_Header.materialCount * Material::texCount);
+        if (!file.Read(cursor, m_TextureManifest.data(), sizeof(TextureReference) * textureCount) ||
+            !file.Read(cursor, m_MaterialTextures.data(), sizeof(uint32_t) * m_MaterialTextures.size()))
+            return false;
+    }
 
-h3d_load_fail:
+    InitializeSkinnedMeshes((const SkinVertex*)skinData);
 
-    if (EOF == fclose(file))
-        ok = false;
+    const int64_t uploadTick = SystemTime::GetCurrentTick();
+    StartupProfile::Record(StartupProfile::kModelParse, parseTick, uploadTick);
 
-    return ok;
+    // The index buffers' element size picks the index format of their views.  A view's size is 32-bit, so
+    // that is as far as one draw of a stream can reach.
+    const uint32_t indexCount = (uint32_t)(m_Header.indexDataByteSize / m_Header.indexSize);
+    ASSERT(m_Header.indexDataByteSize <= UINT32_MAX && m_Header.vertexDataByteSize <= UINT32_MAX,
+        "Geometry streams past 4GB cannot be bound with one view");
+
+    // Streaming needs the finer levels to be optional, and skinning and tools read every vertex
+    uint64_t geometryBytes = m_Header.vertexDataByteSize + m_Header.vertexDataByteSizeDepth + 2 * m_Header.indexDataByteSize;
+    if (!keepGeometryData && m_JointCount == 0 && m_LODCount > 1 && GeometryStreaming::ShouldStream(geometryBytes))
+    {
+        m_VertexBuffer.CreateReserved(L"VertexBuffer", vertexCount, m_VertexStride);
+        m_IndexBuffer.CreateReserved(L"IndexBuffer", indexCount, m_Header.indexSize);
+        m_VertexBufferDepth.CreateReserved(L"VertexBufferDepth", vertexCountDepth, m_VertexStrideDepth);
+        m_IndexBufferDepth.CreateReserved(L"IndexBufferDepth", indexCount, m_Header.indexSize);
+
+        const unsigned char* const data[kNumGeometryStreams] = { vertexData, indexData, vertexDataDepth, indexDataDepth };
+        CreateStreamedGeometry(filename, geometryOffset, data);
+        geometryBytes = (uint64_t)m_pStreamedGeometry->m_NumResidentTiles * D3D12_TILED_RESOURCE_TILE_SIZE_IN_BYTES;
+    }
+    else
+    {
+        m_VertexBuffer.Create(L"VertexBuffer", vertexCount, m_VertexStride);
+        m_IndexBuffer.Create(L"IndexBuffer", indexCount, m_Header.indexSize);
+        m_VertexBufferDepth.Create(L"VertexBufferDepth", vertexCountDepth, m_VertexStrideDepth);
+        m_IndexBufferDepth.Create(L"IndexBufferDepth", indexCount, m_Header.indexSize);
+        GpuMemoryTracker::TrackResource(m_VertexBuffer.GetResource(), GpuMemoryTracker::kModelGeometry);
+        GpuMemoryTracker::TrackResource(m_IndexBuffer.GetResource(), GpuMemoryTracker::kModelGeometry);
+        GpuMemoryTracker::TrackResource(m_VertexBufferDepth.GetResource(), GpuMemoryTracker::kModelGeometry);
+        GpuMemoryTracker::TrackResource(m_IndexBufferDepth.GetResource(), GpuMemoryTracker::kModelGeometry);
+
+        // The staging ring bounds the upload memory in use, and the textures' flush covers these copies too
+        AssetIO::UploadBuffer(m_VertexBuffer, 0, vertexData, m_Header.vertexDataByteSize);
+        AssetIO::UploadBuffer(m_IndexBuffer, 0, indexData, m_Header.indexDataByteSize);
+        AssetIO::UploadBuffer(m_VertexBufferDepth, 0, vertexDataDepth, m_Header.vertexDataByteSizeDepth);
+        AssetIO::UploadBuffer(m_IndexBufferDepth, 0, indexDataDepth, m_Header.indexDataByteSize);
+    }
+
+    if (m_JointCount > 0)
+    {
+        m_SkinBuffer.Create(L"SkinBuffer", vertexCount, sizeof(SkinVertex));
+        m_SkinBufferDepth.Create(L"SkinBufferDepth", vertexCountDepth, sizeof(SkinVertex));
+        GpuMemoryTracker::TrackResource(m_SkinBuffer.GetResource(), GpuMemoryTracker::kModelGeometry);
+        GpuMemoryTracker::TrackResource(m_SkinBufferDepth.GetResource(), GpuMemoryTracker::kModelGeometry);
+        AssetIO::UploadBuffer(m_SkinBuffer, 0, skinData, sizeof(SkinVertex) * vertexCount);
+        AssetIO::UploadBuffer(m_SkinBufferDepth, 0, skinDataDepth, sizeof(SkinVertex) * vertexCountDepth);
+    }
+
+    const uint64_t uploadBytes = geometryBytes +
+        (m_JointCount > 0 ? sizeof(SkinVertex) * (vertexCount + vertexCountDepth) : 0);
+    StartupProfile::Record(StartupProfile::kModelUpload, uploadTick, SystemTime::GetCurrentTick(), uploadBytes);
+
+    if (keepGeometryData)
+    {
+        m_pVertexData = CopyGeometry(vertexData, m_Header.vertexDataByteSize);
+        m_pIndexData = CopyGeometry(indexData, m_Header.indexDataByteSize);
+        m_pVertexDataDepth = CopyGeometry(vertexDataDepth, m_Header.vertexDataByteSizeDepth);
+        m_pIndexDataDepth = CopyGeometry(indexDataDepth, m_Header.indexDataByteSize);
+
+        if (m_JointCount > 0)
+        {
+            m_pSkinData = (SkinVertex*)CopyGeometry(skinData, sizeof(SkinVertex) * vertexCount);
+            m_pSkinDataDepth = (SkinVertex*)CopyGeometry(skinDataDepth, sizeof(SkinVertex) * vertexCountDepth);
+        }
+    }
+
+    LoadTextures();
+
+    return true;
 }
 
 bool Model::SaveH3D(const char *filename) const
@@ -130,6 +508,58 @@ bool Model::SaveH3D(const char *filename) const
     if (m_Header.indexDataByteSize > 0)
         if (1 != fwrite(m_pIndexDataDepth, m_Header.indexDataByteSize, 1, file)) goto h3d_save_fail;
 
+    if (1 != fwrite(&m_MeshletCount, sizeof(uint32_t), 1, file)) goto h3d_save_fail;
+    if (m_MeshletCount > 0)
+        if (1 != fwrite(m_pMeshlet, sizeof(Meshlet) * m_MeshletCount, 1, file)) goto h3d_save_fail;
+
+    if (1 != fwrite(&m_LODCount, sizeof(uint32_t), 1, file)) goto h3d_save_fail;
+    if (m_LODCount > 0)
+        if (1 != fwrite(m_pMeshLOD, sizeof(MeshLOD) * m_Header.meshCount * m_LODCount, 1, file)) goto h3d_save_fail;
+
+    if (1 != fwrite(&m_JointCount, sizeof(uint32_t), 1, file)) goto h3d_save_fail;
+    if (m_JointCount > 0)
+    {
+        const uint64_t vertexCount = m_Header.vertexDataByteSize / m_pMesh[0].vertexStride;
+        const uint64_t vertexCountDepth = m_Header.vertexDataByteSizeDepth / m_pMesh[0].vertexStrideDepth;
+
+        if (1 != fwrite(m_pJoint, sizeof(Joint) * m_JointCount, 1, file)) goto h3d_save_fail;
+        if (1 != fwrite(m_pSkinData, sizeof(SkinVertex) * vertexCount, 1, file)) goto h3d_save_fail;
+        if (1 != fwrite(m_pSkinDataDepth, sizeof(SkinVertex) * vertexCountDepth, 1, file)) goto h3d_save_fail;
+
+        if (1 != fwrite(&m_AnimationCount, sizeof(uint32_t), 1, file)) goto h3d_save_fail;
+        if (1 != fwrite(&m_AnimationCurveCount, sizeof(uint32_t), 1, file)) goto h3d_save_fail;
+        if (1 != fwrite(&m_AnimationKeyCount, sizeof(uint32_t), 1, file)) goto h3d_save_fail;
+        if (m_AnimationCount > 0)
+            if (1 != fwrite(m_pAnimation, sizeof(Animation) * m_AnimationCount, 1, file)) goto h3d_save_fail;
+        if (m_AnimationCurveCount > 0)
+            if (1 != fwrite(m_pAnimationCurve, sizeof(AnimationCurve) * m_AnimationCurveCount, 1, file)) goto h3d_save_fail;
+        if (m_AnimationKeyCount > 0)
+            if (1 != fwrite(m_pAnimationKey, sizeof(AnimationKey) * m_AnimationKeyCount, 1, file)) goto h3d_save_fail;
+    }
+
+    {
+        const uint32_t materialFlagCount = m_MaterialIsOpaque.empty() ? 0 : m_Header.materialCount;
+        std::vector<uint32_t> materialFlags(materialFlagCount);
+        for (uint32_t materialIdx = 0; materialIdx < materialFlagCount; ++materialIdx)
+            materialFlags[materialIdx] = IsMaterialOpaque(materialIdx) ? 1 : 0;
+
+        if (1 != fwrite(&materialFlagCount, sizeof(uint32_t), 1, file)) goto h3d_save_fail;
+        if (materialFlagCount > 0)
+            if (1 != fwrite(materialFlags.data(), sizeof(uint32_t) * materialFlagCount, 1, file)) goto h3d_save_fail;
+    }
+
+    {
+        const uint32_t textureCount = (uint32_t)m_TextureManifest.size();
+        ASSERT(textureCount == 0 || m_MaterialTextures.size() == m_Header.materialCount * Material::texCount);
+
+        if (1 != fwrite(&textureCount, sizeof(uint32_t), 1, file)) goto h3d_save_fail;
+        if (textureCount > 0)
+        {
+            if (1 != fwrite(m_TextureManifest.data(), sizeof(TextureReference) * textureCount, 1, file)) goto h3d_save_fail;
+            if (1 != fwrite(m_MaterialTextures.data(), sizeof(uint32_t) * m_MaterialTextures.size(), 1, file)) goto h3d_save_fail;
+        }
+    }
+
     ok = true;
 
 h3d_save_fail:
@@ -157,6 +587,8 @@ void Model::ReleaseTextures()
         delete [] m_Textures;
     }
     */
+    m_PackedTextures.Destroy();
+    m_StreamedTextures.clear();
 }
 
 void Model::LoadTextures(void)
@@ -165,36 +597,87 @@ void Model::LoadTextures(void)
 
     m_SRVs = new D3D12_CPU_DESCRIPTOR_HANDLE[m_Header.materialCount * 6];
 
-    const ManagedTexture* MatTextures[6] = {};
+    if (!m_TextureManifest.empty())
+    {
+        LoadTextureManifest();
+        return;
+    }
+
+    // Without a manifest, read every material's DDS textures at once so that the reads overlap.  The loop below finds them in the
+    // texture cache, and only falls back to synchronous loads for the ones that are missing.  Streamed textures
+    // only read their smallest mips here.
+    const bool Streaming = TextureStreaming::Enable;
+    if (Streaming)
+        m_StreamedTextures.assign(m_Header.materialCount * 6, nullptr);
+
+    JobSystem::Counter TextureLoads;
+    for (uint32_t materialIdx = 0; materialIdx < m_Header.materialCount; ++materialIdx)
+    {
+        const Material& pMaterial = m_pMaterial[materialIdx];
+        if (Streaming)
+        {
+            StreamedTexture** Streamed = m_StreamedTextures.data() + materialIdx * 6;
+            Streamed[0] = TextureStreaming::LoadDDSFromFileAsync(MakeWStr(pMaterial.texDiffusePath) + L".dds", true, TextureLoads);
+            Streamed[1] = TextureStreaming::LoadDDSFromFileAsync(MakeWStr(pMaterial.texSpecularPath) + L".dds", true, TextureLoads);
+            Streamed[3] = TextureStreaming::LoadDDSFromFileAsync(MakeWStr(pMaterial.texNormalPath) + L".dds", false, TextureLoads);
+        }
+        else
+        {
+            TextureManager::LoadDDSFromFileAsync(MakeWStr(pMaterial.texDiffusePath) + L".dds", true, TextureLoads);
+            TextureManager::LoadDDSFromFileAsync(MakeWStr(pMaterial.texSpecularPath) + L".dds", true, TextureLoads);
+            TextureManager::LoadDDSFromFileAsync(MakeWStr(pMaterial.texNormalPath) + L".dds", false, TextureLoads);
+        }
+    }
+    JobSystem::Wait(TextureLoads);
+    AssetIO::Flush();
+
+    const Texture* MatTextures[6] = {};
+    const ManagedTexture* LoadedTexture = nullptr;
+    std::vector<TextureManager::PackedTextures::Source> slots(m_Header.materialCount * 6);
 
     for (uint32_t materialIdx = 0; materialIdx < m_Header.materialCount; ++materialIdx)
     {
         const Material& pMaterial = m_pMaterial[materialIdx];
 
         // Load diffuse
-        MatTextures[0] = TextureManager::LoadFromFile(pMaterial.texDiffusePath, true);
-        if (!MatTextures[0]->IsValid())
-            MatTextures[0] = TextureManager::LoadFromFile("default", true);
+        MatTextures[0] = FindStreamedTexture(materialIdx, 0);
+        if (MatTextures[0] == nullptr)
+        {
+            LoadedTexture = TextureManager::LoadFromFile(pMaterial.texDiffusePath, true);
+            if (!LoadedTexture->IsValid())
+                LoadedTexture = TextureManager::LoadFromFile("default", true);
+            MatTextures[0] = LoadedTexture;
+        }
 
         // Load specular
-        MatTextures[1] = TextureManager::LoadFromFile(pMaterial.texSpecularPath, true);
-        if (!MatTextures[1]->IsValid())
+        MatTextures[1] = FindStreamedTexture(materialIdx, 1);
+        if (MatTextures[1] == nullptr)
         {
-            MatTextures[1] = TextureManager::LoadFromFile(std::string(pMaterial.texDiffusePath) + "_specular", true);
-            if (!MatTextures[1]->IsValid())
-                MatTextures[1] = TextureManager::LoadFromFile("default_specular", true);
+            LoadedTexture = TextureManager::LoadFromFile(pMaterial.texSpecularPath, true);
+            if (!LoadedTexture->IsValid())
+            {
+                LoadedTexture = TextureManager::LoadFromFile(std::string(pMaterial.texDiffusePath) + "_specular", true);
+                if (!LoadedTexture->IsValid())
+                    LoadedTexture = TextureManager::LoadFromFile("default_specular", true);
+            }
+            MatTextures[1] = LoadedTexture;
         }
 
         // Load emissive
         //MatTextures[2] = TextureManager::LoadFromFile(pMaterial.texEmissivePath, true);
 
         // Load normal
-        MatTextures[3] = TextureManager::LoadFromFile(pMaterial.texNormalPath, false);
-        if (!MatTextures[3]->IsValid())
+        MatTextures[3] = FindStreamedTexture(materialIdx, 3);
+        if (MatTextures[3] == nullptr)
         {
-            MatTextures[3] = TextureManager::LoadFromFile(std::string(pMaterial.texDiffusePath) + "_normal", false);
-            if (!MatTextures[3]->IsValid())
-                MatTextures[3] = TextureManager::LoadFromFile("default_normal", false);
+            LoadedTexture = TextureManager::LoadFromFile(pMaterial.texNormalPath, false);
+            if (!LoadedTexture->IsValid())
+            {
+                LoadedTexture = TextureManager::LoadFromFile(std::string(pMaterial.texDiffusePath) + "_normal", false);
+                if (!LoadedTexture->IsValid())
+                    LoadedTexture = TextureManager::LoadFromFile("default_normal", false);
+            }
+            MatTextures[3] = LoadedTexture;
         }
 
         // Load lightmap
@@ -203,11 +686,212 @@ void Model::LoadTextures(void)
         // Load reflection
         //MatTextures[5] = TextureManager::LoadFromFile(pMaterial.texReflectionPath, true);
 
-        m_SRVs[materialIdx * 6 + 0] = MatTextures[0]->GetSRV();
-        m_SRVs[materialIdx * 6 + 1] = MatTextures[1]->GetSRV();
-        m_SRVs[materialIdx * 6 + 2] = MatTextures[0]->GetSRV();
-        m_SRVs[materialIdx * 6 + 3] = MatTextures[3]->GetSRV();
-        m_SRVs[materialIdx * 6 + 4] = MatTextures[0]->GetSRV();
-        m_SRVs[materialIdx * 6 + 5] = MatTextures[0]->GetSRV();
+        const uint32_t slotTextures[6] = { 0, 1, 0, 3, 0, 0 };
+        for (uint32_t slot = 0; slot < 6; ++slot)
+        {
+            const uint32_t textureSlot = slotTextures[slot];
+            if (FindStreamedTexture(materialIdx, textureSlot) != nullptr)
+                m_SRVs[materialIdx * 6 + slot] = MatTextures[textureSlot]->GetSRV();
+            else
+                slots[materialIdx * 6 + slot] = { MatTextures[textureSlot], textureSlot != 3 };
+        }
     }
+
+    PackTextures(slots);
+}
+
+// Every file of the manifest is known to exist, so all of them are read at once and waited for together, with none
+// of the probing for fallbacks.  Uncompressed files are rare in resolved models and load after the wait, since
+// they go through the texture cache's conversion.
+void Model::LoadTextureManifest(void)
+{
+    const bool Streaming = TextureStreaming::Enable;
+    const uint32_t textureCount = (uint32_t)m_TextureManifest.size();
+
+    std::vector<std::wstring> paths(textureCount);
+    std::vector<bool> isDDS(textureCount);
+    std::vector<StreamedTexture*> streamed(textureCount, nullptr);
+
+    JobSystem::Counter TextureLoads;
+    for (uint32_t textureIdx = 0; textureIdx < textureCount; ++textureIdx)
+    {
+        const TextureReference& reference = m_TextureManifest[textureIdx];
+        paths[textureIdx] = MakeWStr(reference.path);
+
+        const size_t length = paths[textureIdx].length();
+        isDDS[textureIdx] = length >= 4 && _wcsicmp(paths[textureIdx].c_str() + length - 4, L".dds") == 0;
+        if (!isDDS[textureIdx])
+            continue;
+
+        if (Streaming)
+            streamed[textureIdx] = TextureStreaming::LoadDDSFromFileAsync(paths[textureIdx], reference.sRGB != 0, TextureLoads);
+        else
+            TextureManager::LoadDDSFromFileAsync(paths[textureIdx], reference.sRGB != 0, TextureLoads);
+    }
+    JobSystem::Wait(TextureLoads);
+    AssetIO::Flush();
+
+    // Files that went missing since the conversion load as invalid textures, which stand out in magenta
+    std::vector<const Texture*> textures(textureCount);
+    for (uint32_t textureIdx = 0; textureIdx < textureCount; ++textureIdx)
+    {
+        const bool sRGB = m_TextureManifest[textureIdx].sRGB != 0;
+        if (streamed[textureIdx] != nullptr && !streamed[textureIdx]->IsValid())
+            streamed[textureIdx] = nullptr;
+
+        if (streamed[textureIdx] != nullptr)
+            textures[textureIdx] = streamed[textureIdx];
+        else if (isDDS[textureIdx])
+            textures[textureIdx] = TextureManager::LoadDDSFromFile(paths[textureIdx], sRGB);
+        else
+            textures[textureIdx] = TextureManager::LoadTGAFromFile(paths[textureIdx], sRGB);
+    }
+
+    if (Streaming)
+        m_StreamedTextures.assign(m_Header.materialCount * 6, nullptr);
+
+    std::vector<TextureManager::PackedTextures::Source> slots(m_Header.materialCount * 6);
+    const uint32_t magentaIdx = textureCount;
+
+    for (uint32_t materialIdx = 0; materialIdx < m_Header.materialCount; ++materialIdx)
+    {
+        uint32_t MatTextures[6];
+        for (uint32_t slot = 0; slot < 6; ++slot)
+        {
+            const uint32_t textureIdx = m_MaterialTextures[materialIdx * Material::texCount + slot];
+            MatTextures[slot] = textureIdx < textureCount ? textureIdx : magentaIdx;
+            if (Streaming && textureIdx < textureCount)
+                m_StreamedTextures[materialIdx * 6 + slot] = streamed[textureIdx];
+        }
+
+        // The slots that are not sampled yet hold the diffuse texture, as without a manifest
+        const uint32_t slotTextures[6] = { MatTextures[0], MatTextures[1], MatTextures[0], MatTextures[3], MatTextures[0], MatTextures[0] };
+        for (uint32_t slot = 0; slot < 6; ++slot)
+        {
+            const uint32_t textureIdx = slotTextures[slot];
+            if (textureIdx == magentaIdx)
+            {
+                slots[materialIdx * 6 + slot] = { &TextureManager::GetMagentaTex2D(), false };
+            }
+            else if (streamed[textureIdx] != nullptr)
+            {
+                m_SRVs[materialIdx * 6 + slot] = streamed[textureIdx]->GetSRV();
+            }
+            else
+            {
+                slots[materialIdx * 6 + slot] = { textures[textureIdx], m_TextureManifest[textureIdx].sRGB != 0 };
+            }
+        }
+    }
+
+    PackTextures(slots);
+}
+
+// Gives every slot with a texture that is not streamed a view into the model's packed textures.  The other slots
+// already hold their streamed textures' views.
+void Model::PackTextures( const std::vector<TextureManager::PackedTextures::Source>& slots )
+{
+    std::vector<TextureManager::PackedTextures::Source> sources;
+    std::vector<uint32_t> slotSource(slots.size(), ~0u);
+    for (size_t slot = 0; slot < slots.size(); ++slot)
+    {
+        if (slots[slot].Tex == nullptr)
+            continue;
+
+        slotSource[slot] = (uint32_t)sources.size();
+        sources.push_back(slots[slot]);
+    }
+
+    m_PackedTextures.Create(sources.data(), (uint32_t)sources.size());
+
+    for (size_t slot = 0; slot < slots.size(); ++slot)
+    {
+        if (slotSource[slot] != ~0u)
+            m_SRVs[slot] = m_PackedTextures.GetSRV(slotSource[slot]);
+    }
+}
+
+// Missing files fall back to the usual defaults, which are not streamed
+const StreamedTexture* Model::FindStreamedTexture( uint32_t materialIdx, uint32_t slot )
+{
+    if (m_StreamedTextures.empty())
+        return nullptr;
+
+    StreamedTexture*& Streamed = m_StreamedTextures[materialIdx * 6 + slot];
+    if (Streamed != nullptr && !Streamed->IsValid())
+        Streamed = nullptr;
+    return Streamed;
+}
+
+void Model::RequestTextureResolution( uint32_t materialIdx, float log2Resolution ) const
+{
+    for (uint32_t slot = 0; slot < 6; ++slot)
+    {
+        StreamedTexture* Streamed = m_StreamedTextures[materialIdx * 6 + slot];
+        if (Streamed != nullptr)
+            TextureStreaming::RequestResolution(Streamed, log2Resolution);
+    }
+}
+
+void Model::CreateStreamedGeometry( const char* filename, uint64_t fileOffset, const unsigned char* const data[kNumGeometryStreams] )
+{
+    GpuBuffer* const buffers[kNumGeometryStreams] = { &m_VertexBuffer, &m_IndexBuffer, &m_VertexBufferDepth, &m_IndexBufferDepth };
+    const uint64_t fileOffsets[kNumGeometryStreams] =
+    {
+        fileOffset,
+        fileOffset + m_Header.vertexDataByteSize,
+        fileOffset + m_Header.vertexDataByteSize + m_Header.indexDataByteSize,
+        fileOffset + m_Header.vertexDataByteSize + m_Header.indexDataByteSize + m_Header.vertexDataByteSizeDepth
+    };
+    const void* const contents[kNumGeometryStreams] = { data[0], data[1], data[2], data[3] };
+
+    StreamedGeometry* geometry = GeometryStreaming::Create(MakeWStr(filename), kNumGeometryStreams, buffers, fileOffsets,
+        contents, m_Header.meshCount);
+    m_pStreamedGeometry = geometry;
+
+    const uint32_t coarseLOD = m_LODCount - 1;
+    for (uint32_t meshIndex = 0; meshIndex < m_Header.meshCount; ++meshIndex)
+    {
+        const Mesh& mesh = m_pMesh[meshIndex];
+
+        // The coarsest level stays resident, with the vertices it reaches in both vertex streams
+        const MeshLOD& coarse = GetMeshLOD(meshIndex, coarseLOD);
+        const uint64_t coarseBytes = (uint64_t)coarse.indexCount * m_Header.indexSize;
+        GeometryStreaming::AddRange(geometry, StreamedGeometry::kResidentPart, kStreamIndex, coarse.indexDataByteOffset, coarseBytes);
+        GeometryStreaming::AddRange(geometry, StreamedGeometry::kResidentPart, kStreamIndexDepth, coarse.indexDataByteOffset, coarseBytes);
+        AddReachedVertices(geometry, kStreamVertex, data[kStreamIndex] + coarse.indexDataByteOffset, coarse.indexCount,
+            m_Header.indexSize, mesh.vertexDataByteOffset, m_VertexStride);
+        AddReachedVertices(geometry, kStreamVertexDepth, data[kStreamIndexDepth] + coarse.indexDataByteOffset, coarse.indexCount,
+            m_Header.indexSize, mesh.vertexDataByteOffsetDepth, m_VertexStrideDepth);
+
+        // The part of the same index holds the whole mesh, every level in both index streams.  The finer levels
+        // follow each other, so they make a single range.
+        GeometryStreaming::AddRange(geometry, meshIndex, kStreamVertex, mesh.vertexDataByteOffset, (uint64_t)mesh.vertexCount * m_VertexStride);
+        GeometryStreaming::AddRange(geometry, meshIndex, kStreamVertexDepth, mesh.vertexDataByteOffsetDepth,
+            (uint64_t)mesh.vertexCountDepth * m_VertexStrideDepth);
+        const uint32_t indexStreams[] = { kStreamIndex, kStreamIndexDepth };
+        for (uint32_t stream : indexStreams)
+        {
+            for (uint32_t lod = 0; lod < m_LODCount; ++lod)
+            {
+                const MeshLOD& level = GetMeshLOD(meshIndex, lod);
+                GeometryStreaming::AddRange(geometry, meshIndex, stream, level.indexDataByteOffset, (uint64_t)level.indexCount * m_Header.indexSize);
+            }
+        }
+    }
+
+    GeometryStreaming::FinishCreate(geometry);
+}
+
+uint32_t Model::GetResidentLOD( uint32_t meshIndex ) const
+{
+    if (m_pStreamedGeometry == nullptr || GeometryStreaming::IsPartResident(m_pStreamedGeometry, meshIndex))
+        return 0;
+    return m_LODCount - 1;
+}
+
+void Model::RequestMeshGeometry( uint32_t meshIndex, float priority ) const
+{
+    if (m_pStreamedGeometry != nullptr)
+        GeometryStreaming::RequestPart(m_pStreamedGeometry, meshIndex, priority);
 }
@@ -0,0 +1,163 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "ModelSkinning.h"
+#include "PipelineState.h"
+#include "RootSignature.h"
+#include "CommandContext.h"
+#include "GpuMemoryTracker.h"
+#include "EngineProfiling.h"
+
+#include "CompiledShaders/SkinningCS.h"
+
+namespace
+{
+    RootSignature s_RootSig;
+    ComputePSO s_SkinningCS;
+    bool s_PipelineInitialized = false;
+
+    // Shared by every skinned model, and created with the first
+    void InitializePipeline( void )
+    {
+        if (s_PipelineInitialized)
+            return;
+        s_PipelineInitialized = true;
+
+        s_RootSig.Reset(5, 0);
+        s_RootSig[0].InitAsConstantBuffer(0);
+        s_RootSig[1].InitAsBufferSRV(0);
+        s_RootSig[2].InitAsBufferSRV(1);
+        s_RootSig[3].InitAsBufferSRV(2);
+        s_RootSig[4].InitAsBufferUAV(0);
+        s_RootSig.Finalize(L"Model Skinning");
+
+        s_SkinningCS.SetRootSignature(s_RootSig);
+        s_SkinningCS.SetComputeShader(g_pSkinningCS, sizeof(g_pSkinningCS));
+        s_SkinningCS.Finalize();
+    }
+
+    const uint32_t kNoAttrib = 0xFFFFFFFF;
+}
+
+void ModelSkinning::Create( Model& model )
+{
+    Destroy();
+    if (!model.IsSkinned() || model.m_Header.meshCount == 0)
+        return;
+
+    InitializePipeline();
+
+    m_pModel = &model;
+    m_VertexBuffer.Create(L"Skinned VertexBuffer", model.m_VertexBuffer.GetElementCount(), model.m_VertexStride);
+    m_VertexBufferDepth.Create(L"Skinned VertexBufferDepth", model.m_VertexBufferDepth.GetElementCount(), model.m_VertexStrideDepth);
+    GpuMemoryTracker::TrackResource(m_VertexBuffer.GetResource(), GpuMemoryTracker::kModelGeometry);
+    GpuMemoryTracker::TrackResource(m_VertexBufferDepth.GetResource(), GpuMemoryTracker::kModelGeometry);
+    m_NeedsCopy = true;
+}
+
+void ModelSkinning::Destroy()
+{
+    m_VertexBuffer.Destroy();
+    m_VertexBufferDepth.Destroy();
+    m_pModel = nullptr;
+}
+
+void ModelSkinning::Update( ComputeContext& Context, uint32_t animationIndex, float time )
+{
+    ASSERT(IsValid());
+
+    ScopedTimer _prof(L"Skinning", Context);
+
+    __declspec(align(64)) AffineTransform palette[Model::maxJoints];
+    m_pModel->ComputeJointPalette(animationIndex, time, palette);
+
+    // Rows of each 3x4 transform
+    __declspec(align(16)) float joints[Model::maxJoints][3][4];
+    for (uint32_t jointIndex = 0; jointIndex < m_pModel->m_JointCount; jointIndex++)
+    {
+        const AffineTransform& joint = palette[jointIndex];
+        const Vector3 columns[4] = { joint.GetX(), joint.GetY(), joint.GetZ(), joint.GetTranslation() };
+        for (int column = 0; column < 4; column++)
+        {
+            joints[jointIndex][0][column] = columns[column].GetX();
+            joints[jointIndex][1][column] = columns[column].GetY();
+            joints[jointIndex][2][column] = columns[column].GetZ();
+        }
+    }
+
+    Context.SetRootSignature(s_RootSig);
+    Context.SetPipelineState(s_SkinningCS);
+    Context.SetDynamicSRV(1, sizeof(joints[0]) * m_pModel->m_JointCount, joints);
+
+    if (m_NeedsCopy)
+    {
+        Context.TransitionResource(m_pModel->m_VertexBuffer, D3D12_RESOURCE_STATE_GENERIC_READ);
+        Context.TransitionResource(m_pModel->m_VertexBufferDepth, D3D12_RESOURCE_STATE_GENERIC_READ);
+        Context.TransitionResource(m_pModel->m_SkinBuffer, D3D12_RESOURCE_STATE_GENERIC_READ);
+        Context.TransitionResource(m_pModel->m_SkinBufferDepth, D3D12_RESOURCE_STATE_GENERIC_READ);
+    }
+    Context.TransitionResource(m_VertexBuffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    Context.TransitionResource(m_VertexBufferDepth, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, true);
+
+    SkinStream(Context, false);
+    SkinStream(Context, true);
+    m_NeedsCopy = false;
+
+    const D3D12_RESOURCE_STATES ReadState = D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE;
+    Context.TransitionResource(m_VertexBuffer, ReadState);
+    Context.TransitionResource(m_VertexBufferDepth, ReadState, true);
+}
+
+void ModelSkinning::SkinStream( ComputeContext& Context, bool depthOnly )
+{
+    const Model& model = *m_pModel;
+    const Model::Mesh& mesh = model.m_pMesh[0];
+    const Model::Attrib* attribs = depthOnly ? mesh.attribDepth : mesh.attrib;
+    const Model::VertexDecode decode = model.GetVertexDecode();
+    const StructuredBuffer& source = depthOnly ? model.m_VertexBufferDepth : model.m_VertexBuffer;
+
+    __declspec(align(16)) struct
+    {
+        float PositionScale[3];
+        uint32_t Quantized;
+        float PositionBias[3];
+        uint32_t CopyVertices;
+        float RcpPositionScale[3];
+        uint32_t VertexCount;
+        uint32_t VertexStride;
+        uint32_t PositionOffset;
+        uint32_t NormalOffset;
+        uint32_t TangentOffset;
+        uint32_t BitangentOffset;
+    } csConstants;
+
+    for (int n = 0; n < 3; n++)
+    {
+        csConstants.PositionScale[n] = decode.positionScale[n];
+        csConstants.PositionBias[n] = decode.positionBias[n];
+        csConstants.RcpPositionScale[n] = decode.positionScale[n] > 0.0f ? 1.0f / decode.positionScale[n] : 0.0f;
+    }
+    csConstants.Quantized = attribs[Model::attrib_position].format != Model::attrib_format_float;
+    csConstants.CopyVertices = m_NeedsCopy;
+    csConstants.VertexCount = source.GetElementCount();
+    csConstants.VertexStride = depthOnly ? mesh.vertexStrideDepth : mesh.vertexStride;
+    csConstants.PositionOffset = attribs[Model::attrib_position].offset;
+
+    // The depth-only stream has positions alone
+    const unsigned int enabled = depthOnly ? mesh.attribsEnabledDepth : mesh.attribsEnabled;
+    csConstants.NormalOffset = (enabled & Model::attrib_mask_normal) ? attribs[Model::attrib_normal].offset : kNoAttrib;
+    csConstants.TangentOffset = (enabled & Model::attrib_mask_tangent) ? attribs[Model::attrib_tangent].offset : kNoAttrib;
+    csConstants.BitangentOffset = (enabled & Model::attrib_mask_bitangent) ? attribs[Model::attrib_bitangent].offset : kNoAttrib;
+
+    Context.SetDynamicConstantBufferView(0, sizeof(csConstants), &csConstants);
+    Context.SetBufferSRV(2, source);
+    Context.SetBufferSRV(3, depthOnly ? model.m_SkinBufferDepth : model.m_SkinBuffer);
+    Context.SetBufferUAV(4, depthOnly ? m_VertexBufferDepth : m_VertexBuffer);
+    Context.Dispatch1D(csConstants.VertexCount, 64);
+}
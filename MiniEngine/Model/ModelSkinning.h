@@ -0,0 +1,49 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#pragma once
+
+#include "Model.h"
+
+class ComputeContext;
+
+// Skins a model's vertex streams on the GPU once per frame, ahead of every pass that draws it.  The skinned
+// streams keep the model's vertex formats and layouts, so the depth prepass, every shadow view and the color
+// pass bind them in place of the model's own vertex buffers, and acceleration structures can be refit over
+// them, without any of them skinning again.  Quantized positions stay relative to the model's bounding box,
+// which ModelConverter grows to cover every pose of every animation.
+class ModelSkinning
+{
+public:
+    ModelSkinning() : m_pModel(nullptr), m_NeedsCopy(false) {}
+    ~ModelSkinning() { Destroy(); }
+
+    // Does nothing for models without joints, which IsValid() then reports.  The first update moves the
+    // model's vertex and skin buffers to D3D12_RESOURCE_STATE_GENERIC_READ, where they stay.
+    void Create( Model& model );
+    void Destroy();
+
+    bool IsValid() const { return m_pModel != nullptr; }
+
+    // Poses the joints with the animation at the given time (see Model::ComputeJointPalette) and skins both
+    // streams.  Must be recorded on the graphics queue, since it leaves the skinned streams in the vertex buffer
+    // state, which is also readable by the non-pixel shaders that build acceleration structures.
+    void Update( ComputeContext& Context, uint32_t animationIndex, float time );
+
+    const StructuredBuffer& GetVertexBuffer() const { return m_VertexBuffer; }
+    const StructuredBuffer& GetVertexBufferDepth() const { return m_VertexBufferDepth; }
+
+private:
+    void SkinStream( ComputeContext& Context, bool depthOnly );
+
+    Model* m_pModel;
+    StructuredBuffer m_VertexBuffer;
+    StructuredBuffer m_VertexBufferDepth;
+    bool m_NeedsCopy;   // The first update copies the streams whole
+};
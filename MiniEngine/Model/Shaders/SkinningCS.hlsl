@@ -0,0 +1,156 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+// Skins one vertex stream of a model.  Each thread poses a vertex with the weighted blend of up to four joint
+// transforms and rewrites its position, and its normal, tangent and bitangent in streams that have them, in
+// the model's own format.  The first pass copies every vertex whole, so later passes leave the texture
+// coordinates and the vertices without weights alone.  Joints are assumed to scale uniformly, so directions
+// are transformed by the blended transform rather than its inverse transpose.
+
+#define Skinning_RootSig \
+    "RootFlags(0), " \
+    "CBV(b0), " \
+    "SRV(t0), " \
+    "SRV(t1), " \
+    "SRV(t2), " \
+    "UAV(u0)"
+
+static const uint kNoAttrib = 0xFFFFFFFF;
+
+struct JointTransform
+{
+    float4 Rows[3];
+};
+
+StructuredBuffer<JointTransform> Joints : register(t0);
+ByteAddressBuffer SourceVertices : register(t1);
+StructuredBuffer<uint2> SkinData : register(t2);   // Four joint indices, then four unorm8 weights
+RWByteAddressBuffer SkinnedVertices : register(u0);
+
+cbuffer CSConstants : register(b0)
+{
+    float3 PositionScale;       // Quantized positions are relative to the model's bounding box
+    uint Quantized;
+    float3 PositionBias;
+    uint CopyVertices;
+    float3 RcpPositionScale;    // 0 along axes where the box is flat
+    uint VertexCount;
+    uint VertexStride;
+    uint PositionOffset;
+    uint NormalOffset;          // kNoAttrib in the depth-only stream
+    uint TangentOffset;
+    uint BitangentOffset;
+}
+
+int2 UnpackSnorm16x2( uint Packed )
+{
+    return int2((int)(Packed << 16) >> 16, (int)Packed >> 16);
+}
+
+// Matches DecodeOctahedral() in the vertex shaders and EncodeOctahedral() in ModelConverter
+float3 DecodeOctahedral( uint Packed )
+{
+    float2 e = max(UnpackSnorm16x2(Packed) / 32767.0, -1.0);
+    float3 v = float3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = saturate(-v.z);
+    v.xy += v.xy >= 0.0 ? -t : t;
+    return normalize(v);
+}
+
+uint EncodeOctahedral( float3 v )
+{
+    float2 e = v.xy / max(abs(v.x) + abs(v.y) + abs(v.z), 1e-20);
+    if (v.z < 0.0)
+        e = (1.0 - abs(e.yx)) * (e.xy >= 0.0 ? 1.0 : -1.0);
+    int2 q = (int2)round(clamp(e, -1.0, 1.0) * 32767.0);
+    return (q.x & 0xFFFF) | (q.y << 16);
+}
+
+float3 SkinDirection( float3 Row0, float3 Row1, float3 Row2, float3 v )
+{
+    return normalize(float3(dot(Row0, v), dot(Row1, v), dot(Row2, v)));
+}
+
+void SkinAttrib( uint Address, uint Offset, float3 Row0, float3 Row1, float3 Row2 )
+{
+    if (Offset == kNoAttrib)
+        return;
+
+    if (Quantized != 0)
+    {
+        float3 v = DecodeOctahedral(SourceVertices.Load(Address + Offset));
+        SkinnedVertices.Store(Address + Offset, EncodeOctahedral(SkinDirection(Row0, Row1, Row2, v)));
+    }
+    else
+    {
+        float3 v = asfloat(SourceVertices.Load3(Address + Offset));
+        SkinnedVertices.Store3(Address + Offset, asuint(SkinDirection(Row0, Row1, Row2, v)));
+    }
+}
+
+[RootSignature(Skinning_RootSig)]
+[numthreads( 64, 1, 1 )]
+void main( uint3 DTid : SV_DispatchThreadID )
+{
+    const uint VertexIndex = DTid.x;
+    if (VertexIndex >= VertexCount)
+        return;
+
+    const uint Address = VertexIndex * VertexStride;
+    if (CopyVertices != 0)
+    {
+        for (uint Offset = 0; Offset < VertexStride; Offset += 4)
+            SkinnedVertices.Store(Address + Offset, SourceVertices.Load(Address + Offset));
+    }
+
+    const uint2 Skin = SkinData[VertexIndex];
+    if (Skin.y == 0)
+        return;
+
+    float4 Row0 = 0.0, Row1 = 0.0, Row2 = 0.0;
+
+    [unroll]
+    for (uint i = 0; i < 4; ++i)
+    {
+        const float Weight = ((Skin.y >> (i * 8)) & 0xFF) / 255.0;
+        if (Weight > 0.0)
+        {
+            JointTransform Joint = Joints[(Skin.x >> (i * 8)) & 0xFF];
+            Row0 += Weight * Joint.Rows[0];
+            Row1 += Weight * Joint.Rows[1];
+            Row2 += Weight * Joint.Rows[2];
+        }
+    }
+
+    // Quantized positions keep the fourth component the converter wrote
+    const uint PositionAddress = Address + PositionOffset;
+    uint2 Packed = 0;
+    float3 Position;
+    if (Quantized != 0)
+    {
+        Packed = SourceVertices.Load2(PositionAddress);
+        Position = float3(Packed.x & 0xFFFF, Packed.x >> 16, Packed.y & 0xFFFF) / 65535.0 * PositionScale + PositionBias;
+    }
+    else
+        Position = asfloat(SourceVertices.Load3(PositionAddress));
+
+    Position = float3(dot(Row0, float4(Position, 1.0)), dot(Row1, float4(Position, 1.0)), dot(Row2, float4(Position, 1.0)));
+
+    if (Quantized != 0)
+    {
+        uint3 Q = (uint3)(saturate((Position - PositionBias) * RcpPositionScale) * 65535.0 + 0.5);
+        SkinnedVertices.Store2(PositionAddress, uint2(Q.x | (Q.y << 16), Q.z | (Packed.y & 0xFFFF0000)));
+    }
+    else
+        SkinnedVertices.Store3(PositionAddress, asuint(Position));
+
+    SkinAttrib(Address, NormalOffset, Row0.xyz, Row1.xyz, Row2.xyz);
+    SkinAttrib(Address, TangentOffset, Row0.xyz, Row1.xyz, Row2.xyz);
+    SkinAttrib(Address, BitangentOffset, Row0.xyz, Row1.xyz, Row2.xyz);
+}
@@ -19,7 +19,9 @@
 #include <stdint.h>
 #include <assert.h>
 #include <math.h>
+#include <string.h>
 #include <algorithm>
+#include <vector>
 
 #include "IndexOptimizePostTransform.h"
 
@@ -461,3 +463,195 @@ void OptimizeFaces(const IndexType* indexList, uint32_t indexCount, IndexType* n
     delete [] faceSorted;
     delete [] faceReverseLookup;
 }
+
+namespace
+{
+    // Simulates a FIFO post-transform cache by stamping each vertex with the count of misses when it was
+    // last transformed.  A vertex is still cached if fewer than cacheSize misses have happened since.
+    class FifoCacheSimulator
+    {
+    public:
+        FifoCacheSimulator(uint32_t vertexCount, uint32_t cacheSize)
+            : m_Stamps(vertexCount, 0u), m_CacheSize(cacheSize), m_Misses(cacheSize + 1) {}
+
+        // Returns the number of vertices of the triangle that missed
+        template <typename IndexType>
+        uint32_t AddTriangle(const IndexType* tri)
+        {
+            uint32_t misses = 0;
+            for (uint32_t v = 0; v < 3; ++v)
+            {
+                if (m_Misses - m_Stamps[tri[v]] > m_CacheSize)
+                {
+                    m_Stamps[tri[v]] = m_Misses++;
+                    misses++;
+                }
+            }
+            return misses;
+        }
+
+        // Evicts everything
+        void Flush() { m_Misses += m_CacheSize + 1; }
+
+    private:
+        std::vector<uint32_t> m_Stamps;
+        uint32_t m_CacheSize;
+        uint32_t m_Misses;
+    };
+
+    template <typename IndexType>
+    uint32_t GetVertexCount(const IndexType* indexList, uint32_t indexCount)
+    {
+        uint32_t vertexCount = 0;
+        for (uint32_t i = 0; i < indexCount; ++i)
+            vertexCount = std::max(vertexCount, (uint32_t)indexList[i] + 1);
+        return vertexCount;
+    }
+}
+
+template <typename IndexType>
+void OptimizeOverdraw(const IndexType* indexList, uint32_t indexCount, IndexType* newIndexList,
+    const float* positions, uint32_t positionStride, uint16_t cacheSize, float threshold)
+{
+    const uint32_t faceCount = indexCount / 3;
+    const uint32_t vertexCount = GetVertexCount(indexList, indexCount);
+
+    // The misses of each triangle in the given order
+    std::vector<uint8_t> faceMisses(faceCount);
+    {
+        FifoCacheSimulator cache(vertexCount, cacheSize);
+        for (uint32_t f = 0; f < faceCount; ++f)
+            faceMisses[f] = (uint8_t)cache.AddTriangle(indexList + f * 3);
+    }
+
+    // Hard boundaries where every vertex of a triangle missed, so that drawing from there after anything
+    // else costs next to nothing.  Within them, soft boundaries wherever the ACMR since the last boundary,
+    // starting from an empty cache, has come down to within threshold of the hard cluster's.
+    std::vector<uint32_t> clusterStart;
+    FifoCacheSimulator clusterCache(vertexCount, cacheSize);
+    for (uint32_t hardStart = 0; hardStart < faceCount; )
+    {
+        uint32_t hardEnd = hardStart + 1;
+        uint32_t hardMisses = faceMisses[hardStart];
+        while (hardEnd < faceCount && faceMisses[hardEnd] < 3)
+            hardMisses += faceMisses[hardEnd++];
+
+        const float clusterThreshold = threshold * (float)hardMisses / (float)(hardEnd - hardStart);
+
+        clusterStart.push_back(hardStart);
+        clusterCache.Flush();
+        uint32_t runningMisses = 0;
+        uint32_t runningStart = hardStart;
+        for (uint32_t f = hardStart; f < hardEnd - 1; ++f)
+        {
+            runningMisses += clusterCache.AddTriangle(indexList + f * 3);
+            if ((float)runningMisses <= clusterThreshold * (float)(f + 1 - runningStart))
+            {
+                clusterStart.push_back(f + 1);
+                clusterCache.Flush();
+                runningMisses = 0;
+                runningStart = f + 1;
+            }
+        }
+
+        hardStart = hardEnd;
+    }
+    clusterStart.push_back(faceCount);
+
+    auto getPosition = [&](IndexType index) -> const float*
+    {
+        return (const float*)((const uint8_t*)positions + (size_t)index * positionStride);
+    };
+
+    // Area-weighted centroid and normal of each cluster and of the mesh
+    const uint32_t clusterCount = (uint32_t)clusterStart.size() - 1;
+    std::vector<float> clusterData(clusterCount * 7, 0.0f);
+    float meshCentroid[3] = { 0.0f, 0.0f, 0.0f };
+    float meshArea = 0.0f;
+    for (uint32_t c = 0; c < clusterCount; ++c)
+    {
+        float* data = clusterData.data() + c * 7;
+        for (uint32_t f = clusterStart[c]; f < clusterStart[c + 1]; ++f)
+        {
+            const float* p0 = getPosition(indexList[f * 3 + 0]);
+            const float* p1 = getPosition(indexList[f * 3 + 1]);
+            const float* p2 = getPosition(indexList[f * 3 + 2]);
+
+            const float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+            const float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+            const float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+            const float area = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+            for (uint32_t k = 0; k < 3; ++k)
+            {
+                data[k] += (p0[k] + p1[k] + p2[k]) * (area / 3.0f);
+                data[3 + k] += n[k];
+            }
+            data[6] += area;
+        }
+
+        for (uint32_t k = 0; k < 3; ++k)
+            meshCentroid[k] += data[k];
+        meshArea += data[6];
+    }
+    for (uint32_t k = 0; k < 3; ++k)
+        meshCentroid[k] = meshArea > 0.0f ? meshCentroid[k] / meshArea : 0.0f;
+
+    // Clusters facing away from the center are more likely to occlude the rest of the mesh
+    std::vector<float> clusterScore(clusterCount);
+    for (uint32_t c = 0; c < clusterCount; ++c)
+    {
+        const float* data = clusterData.data() + c * 7;
+        float score = 0.0f;
+        if (data[6] > 0.0f)
+        {
+            for (uint32_t k = 0; k < 3; ++k)
+                score += (data[k] / data[6] - meshCentroid[k]) * data[3 + k];
+            float normalLength = sqrtf(data[3] * data[3] + data[4] * data[4] + data[5] * data[5]);
+            score = normalLength > 0.0f ? score / normalLength : 0.0f;
+        }
+        clusterScore[c] = score;
+    }
+
+    std::vector<uint32_t> clusterOrder(clusterCount);
+    for (uint32_t c = 0; c < clusterCount; ++c)
+        clusterOrder[c] = c;
+    std::stable_sort(clusterOrder.begin(), clusterOrder.end(),
+        [&](uint32_t a, uint32_t b) { return clusterScore[a] > clusterScore[b]; });
+
+    IndexType* dst = newIndexList;
+    for (uint32_t c : clusterOrder)
+    {
+        const uint32_t first = clusterStart[c] * 3;
+        const uint32_t count = (clusterStart[c + 1] - clusterStart[c]) * 3;
+        memcpy(dst, indexList + first, sizeof(IndexType) * count);
+        dst += count;
+    }
+    assert(dst == newIndexList + faceCount * 3);
+}
+
+template <typename IndexType>
+VertexCacheStats ComputeVertexCacheStats(const IndexType* indexList, uint32_t indexCount, uint16_t cacheSize)
+{
+    const uint32_t faceCount = indexCount / 3;
+    const uint32_t vertexCount = GetVertexCount(indexList, indexCount);
+
+    VertexCacheStats stats = {};
+    stats.triangleCount = faceCount;
+
+    FifoCacheSimulator cache(vertexCount, cacheSize);
+    for (uint32_t f = 0; f < faceCount; ++f)
+        stats.transformedVertexCount += cache.AddTriangle(indexList + f * 3);
+
+    std::vector<bool> referenced(vertexCount, false);
+    for (uint32_t i = 0; i < faceCount * 3; ++i)
+    {
+        if (!referenced[indexList[i]])
+        {
+            referenced[indexList[i]] = true;
+            stats.vertexCount++;
+        }
+    }
+
+    return stats;
+}
@@ -32,3 +32,60 @@ void OptimizeFaces(const IndexType* indexList, uint32_t indexCount, IndexType* n
 
 template void OptimizeFaces<uint16_t>(const uint16_t* indexList, uint32_t indexCount, uint16_t* newIndexList, uint16_t lruCacheSize);
 template void OptimizeFaces<uint32_t>(const uint32_t* indexList, uint32_t indexCount, uint32_t* newIndexList, uint16_t lruCacheSize);
+
+//-----------------------------------------------------------------------------
+//  OptimizeOverdraw
+//-----------------------------------------------------------------------------
+//  Reorders clusters of an index list already optimized by OptimizeFaces so
+//  that triangles likely to occlude others (those facing away from the
+//  mesh's center) are drawn first.  Clusters break where the simulated FIFO
+//  cache restarts, and again wherever the ACMR so far is within threshold of
+//  the whole cluster's, which bounds the vertex cache cost of the reorder.
+//
+//  Parameters:
+//      indexList
+//          input index list, in post-transform cache order
+//      indexCount
+//          the number of indices in the list
+//      newIndexList
+//          a pointer to a preallocated buffer the same size as indexList to
+//          hold the reordered index list
+//      positions, positionStride
+//          float3 vertex positions and the byte stride between them
+//      cacheSize
+//          the size of the simulated FIFO post-transform cache
+//      threshold
+//          the ACMR increase a cluster split may cost (1.05 is 5%)
+//-----------------------------------------------------------------------------
+template <typename IndexType>
+void OptimizeOverdraw(const IndexType* indexList, uint32_t indexCount, IndexType* newIndexList,
+    const float* positions, uint32_t positionStride, uint16_t cacheSize, float threshold);
+
+template void OptimizeOverdraw<uint16_t>(const uint16_t* indexList, uint32_t indexCount, uint16_t* newIndexList,
+    const float* positions, uint32_t positionStride, uint16_t cacheSize, float threshold);
+template void OptimizeOverdraw<uint32_t>(const uint32_t* indexList, uint32_t indexCount, uint32_t* newIndexList,
+    const float* positions, uint32_t positionStride, uint16_t cacheSize, float threshold);
+
+//-----------------------------------------------------------------------------
+//  ComputeVertexCacheStats
+//-----------------------------------------------------------------------------
+//  Counts the vertices a FIFO post-transform cache of cacheSize entries
+//  transforms for an index list.  ACMR is transformed vertices per triangle
+//  (0.5 is ideal for a regular grid, 3 is the worst) and ATVR is transformed
+//  vertices per referenced vertex (1 is ideal).  Counts add across meshes.
+//-----------------------------------------------------------------------------
+struct VertexCacheStats
+{
+    uint32_t transformedVertexCount;
+    uint32_t triangleCount;
+    uint32_t vertexCount;
+
+    float GetACMR() const { return triangleCount > 0 ? (float)transformedVertexCount / triangleCount : 0.0f; }
+    float GetATVR() const { return vertexCount > 0 ? (float)transformedVertexCount / vertexCount : 0.0f; }
+};
+
+template <typename IndexType>
+VertexCacheStats ComputeVertexCacheStats(const IndexType* indexList, uint32_t indexCount, uint16_t cacheSize);
+
+template VertexCacheStats ComputeVertexCacheStats<uint16_t>(const uint16_t* indexList, uint32_t indexCount, uint16_t cacheSize);
+template VertexCacheStats ComputeVertexCacheStats<uint32_t>(const uint32_t* indexList, uint32_t indexCount, uint16_t cacheSize);
@@ -16,6 +16,11 @@
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
+#include <stdio.h>
+#include <math.h>
+#include <float.h>
+#include <vector>
+#include <algorithm>
 
 const char* AssimpModel::s_FormatString[] =
 {
@@ -42,6 +47,7 @@ int AssimpModel::FormatFromFilename(const char *filename)
 bool AssimpModel::Load(const char *filename)
 {
     Clear();
+    m_HasSourceCacheStats = false;
 
     int format = FormatFromFilename(filename);
 
@@ -54,7 +60,8 @@ bool AssimpModel::Load(const char *filename)
         break;
 
     case format_h3d:
-        rval = LoadH3D(filename);
+        // Keep the geometry on the CPU so that it can be saved again
+        rval = LoadH3D(filename, true);
         needToOptimize = false;
         break;
     }
@@ -65,6 +72,9 @@ bool AssimpModel::Load(const char *filename)
     if (needToOptimize)
         Optimize();
 
+    // After the cutout split, which adds materials
+    ResolveTextures();
+
     return true;
 }
 
@@ -86,6 +96,312 @@ bool AssimpModel::Save(const char *filename) const
     return rval;
 }
 
+namespace
+{
+    bool ContainsBone(const aiNode *node, const AssimpModel::JointMap &boneNames)
+    {
+        if (boneNames.count(node->mName.C_Str()) > 0)
+            return true;
+        for (unsigned int n = 0; n < node->mNumChildren; n++)
+        {
+            if (ContainsBone(node->mChildren[n], boneNames))
+                return true;
+        }
+        return false;
+    }
+
+    // Depth first, so that parents come before their children
+    void CollectJoints(const aiNode *node, int32_t parent, const AssimpModel::JointMap &boneNames,
+        std::vector<const aiNode*> &nodes, std::vector<int32_t> &parents)
+    {
+        if (!ContainsBone(node, boneNames))
+            return;
+
+        const int32_t index = (int32_t)nodes.size();
+        nodes.push_back(node);
+        parents.push_back(parent);
+        for (unsigned int n = 0; n < node->mNumChildren; n++)
+            CollectJoints(node->mChildren[n], index, boneNames, nodes, parents);
+    }
+
+    void StoreRows(const aiMatrix4x4 &m, float rows[3][4])
+    {
+        const float values[3][4] =
+        {
+            { m.a1, m.a2, m.a3, m.a4 },
+            { m.b1, m.b2, m.b3, m.b4 },
+            { m.c1, m.c2, m.c3, m.c4 },
+        };
+        memcpy(rows, values, sizeof(values));
+    }
+}
+
+// Skinned vertices are posed in the space of the scene's root, where Assimp's bone offsets put them
+bool AssimpModel::ImportJoints(const aiScene *scene, JointMap &jointIndices)
+{
+    JointMap boneNames;
+    std::map<std::string, const aiBone*> bones;
+    for (unsigned int meshIndex = 0; meshIndex < scene->mNumMeshes; meshIndex++)
+    {
+        const aiMesh *srcMesh = scene->mMeshes[meshIndex];
+        for (unsigned int b = 0; b < srcMesh->mNumBones; b++)
+        {
+            boneNames[srcMesh->mBones[b]->mName.C_Str()] = 0;
+            bones.emplace(srcMesh->mBones[b]->mName.C_Str(), srcMesh->mBones[b]);
+        }
+    }
+
+    std::vector<const aiNode*> nodes;
+    std::vector<int32_t> parents;
+    CollectJoints(scene->mRootNode, -1, boneNames, nodes, parents);
+    if (nodes.size() > maxJoints)
+    {
+        printf("skeleton has %u joints, more than the %u supported\n", (unsigned int)nodes.size(), (unsigned int)maxJoints);
+        return false;
+    }
+
+    m_JointCount = (uint32_t)nodes.size();
+    m_pJoint = new Joint [m_JointCount];
+    memset(m_pJoint, 0, sizeof(Joint) * m_JointCount);
+    for (uint32_t jointIndex = 0; jointIndex < m_JointCount; jointIndex++)
+    {
+        const aiNode *node = nodes[jointIndex];
+        Joint *joint = m_pJoint + jointIndex;
+        jointIndices[node->mName.C_Str()] = jointIndex;
+
+        aiVector3D scaling, position;
+        aiQuaternion rotation;
+        node->mTransformation.Decompose(scaling, rotation, position);
+        joint->bindTranslation[0] = position.x;
+        joint->bindTranslation[1] = position.y;
+        joint->bindTranslation[2] = position.z;
+        joint->bindRotation[0] = rotation.x;
+        joint->bindRotation[1] = rotation.y;
+        joint->bindRotation[2] = rotation.z;
+        joint->bindRotation[3] = rotation.w;
+        joint->bindScale[0] = scaling.x;
+        joint->bindScale[1] = scaling.y;
+        joint->bindScale[2] = scaling.z;
+        joint->parent = parents[jointIndex];
+
+        // Ancestors that no vertex is bound to keep an identity
+        auto bone = bones.find(node->mName.C_Str());
+        StoreRows(bone != bones.end() ? bone->second->mOffsetMatrix : aiMatrix4x4(), joint->inverseBind);
+    }
+
+    return true;
+}
+
+void AssimpModel::ImportSkin(const aiMesh *srcMesh, unsigned int meshIndex, const JointMap &jointIndices)
+{
+    const Mesh *dstMesh = m_pMesh + meshIndex;
+
+    // Assimp's bone weight limit keeps at most maxJointWeights per vertex, but any extras replace the weakest
+    std::vector<uint32_t> joints(dstMesh->vertexCount * maxJointWeights, 0);
+    std::vector<float> weights(dstMesh->vertexCount * maxJointWeights, 0.0f);
+    for (unsigned int b = 0; b < srcMesh->mNumBones; b++)
+    {
+        const aiBone *bone = srcMesh->mBones[b];
+        const uint32_t jointIndex = jointIndices.at(bone->mName.C_Str());
+        for (unsigned int w = 0; w < bone->mNumWeights; w++)
+        {
+            const aiVertexWeight &vertexWeight = bone->mWeights[w];
+            float *vertexWeights = weights.data() + vertexWeight.mVertexId * maxJointWeights;
+            unsigned int weakest = 0;
+            for (unsigned int n = 1; n < maxJointWeights; n++)
+                weakest = vertexWeights[n] < vertexWeights[weakest] ? n : weakest;
+            if (vertexWeight.mWeight > vertexWeights[weakest])
+            {
+                vertexWeights[weakest] = vertexWeight.mWeight;
+                joints[vertexWeight.mVertexId * maxJointWeights + weakest] = jointIndex;
+            }
+        }
+    }
+
+    const bool meshSkinned = srcMesh->mNumBones > 0;
+    for (unsigned int v = 0; v < dstMesh->vertexCount; v++)
+    {
+        // Rounded to unorm8s summing to 255, with the rounding error going to the strongest weight
+        const float *vertexWeights = weights.data() + v * maxJointWeights;
+        float sum = 0.0f;
+        for (unsigned int n = 0; n < maxJointWeights; n++)
+            sum += vertexWeights[n];
+
+        SkinVertex skin = {};
+        if (meshSkinned && sum > 0.0f)
+        {
+            int total = 0;
+            unsigned int strongest = 0;
+            for (unsigned int n = 0; n < maxJointWeights; n++)
+            {
+                skin.joints[n] = (uint8_t)joints[v * maxJointWeights + n];
+                skin.weights[n] = (uint8_t)(vertexWeights[n] / sum * 255.0f + 0.5f);
+                total += skin.weights[n];
+                strongest = vertexWeights[n] > vertexWeights[strongest] ? n : strongest;
+            }
+            skin.weights[strongest] = (uint8_t)(skin.weights[strongest] + 255 - total);
+        }
+
+        memcpy(m_pVertexData + dstMesh->vertexDataByteOffset + v * dstMesh->vertexStride + dstMesh->attrib[attrib_joints].offset,
+            skin.joints, sizeof(skin.joints));
+        memcpy(m_pVertexData + dstMesh->vertexDataByteOffset + v * dstMesh->vertexStride + dstMesh->attrib[attrib_weights].offset,
+            skin.weights, sizeof(skin.weights));
+        memcpy(m_pVertexDataDepth + dstMesh->vertexDataByteOffsetDepth + v * dstMesh->vertexStrideDepth + dstMesh->attribDepth[attrib_joints].offset,
+            skin.joints, sizeof(skin.joints));
+        memcpy(m_pVertexDataDepth + dstMesh->vertexDataByteOffsetDepth + v * dstMesh->vertexStrideDepth + dstMesh->attribDepth[attrib_weights].offset,
+            skin.weights, sizeof(skin.weights));
+    }
+}
+
+void AssimpModel::ImportAnimations(const aiScene *scene, const JointMap &jointIndices)
+{
+    std::vector<Animation> animations;
+    std::vector<AnimationCurve> curves;
+    std::vector<AnimationKey> keys;
+
+    for (unsigned int animationIndex = 0; animationIndex < scene->mNumAnimations; animationIndex++)
+    {
+        const aiAnimation *srcAnimation = scene->mAnimations[animationIndex];
+        const double secondsPerTick = 1.0 / (srcAnimation->mTicksPerSecond > 0.0 ? srcAnimation->mTicksPerSecond : 25.0);
+
+        Animation animation = {};
+        strncpy_s(animation.name, srcAnimation->mName.C_Str(), maxAnimationName - 1);
+        animation.duration = (float)(srcAnimation->mDuration * secondsPerTick);
+        animation.firstCurve = (uint32_t)curves.size();
+
+        auto addCurve = [&](uint32_t joint, uint32_t target, unsigned int keyCount, const std::function<AnimationKey(unsigned int)>& getKey)
+        {
+            if (keyCount == 0)
+                return;
+
+            AnimationCurve curve = { joint, target, (uint32_t)keys.size(), keyCount };
+            for (unsigned int k = 0; k < keyCount; k++)
+                keys.push_back(getKey(k));
+            curves.push_back(curve);
+        };
+
+        for (unsigned int channelIndex = 0; channelIndex < srcAnimation->mNumChannels; channelIndex++)
+        {
+            // Channels of nodes outside of the skeleton move nothing that is drawn
+            const aiNodeAnim *channel = srcAnimation->mChannels[channelIndex];
+            auto joint = jointIndices.find(channel->mNodeName.C_Str());
+            if (joint == jointIndices.end())
+                continue;
+
+            addCurve(joint->second, curve_translation, channel->mNumPositionKeys, [&](unsigned int k)
+            {
+                const aiVectorKey &key = channel->mPositionKeys[k];
+                AnimationKey dst = { (float)(key.mTime * secondsPerTick), { key.mValue.x, key.mValue.y, key.mValue.z, 0.0f } };
+                return dst;
+            });
+            addCurve(joint->second, curve_rotation, channel->mNumRotationKeys, [&](unsigned int k)
+            {
+                const aiQuatKey &key = channel->mRotationKeys[k];
+                AnimationKey dst = { (float)(key.mTime * secondsPerTick), { key.mValue.x, key.mValue.y, key.mValue.z, key.mValue.w } };
+                return dst;
+            });
+            addCurve(joint->second, curve_scale, channel->mNumScalingKeys, [&](unsigned int k)
+            {
+                const aiVectorKey &key = channel->mScalingKeys[k];
+                AnimationKey dst = { (float)(key.mTime * secondsPerTick), { key.mValue.x, key.mValue.y, key.mValue.z, 0.0f } };
+                return dst;
+            });
+        }
+
+        animation.curveCount = (uint32_t)curves.size() - animation.firstCurve;
+        animations.push_back(animation);
+    }
+
+    m_AnimationCount = (uint32_t)animations.size();
+    m_pAnimation = new Animation [m_AnimationCount];
+    memcpy(m_pAnimation, animations.data(), sizeof(Animation) * m_AnimationCount);
+    m_AnimationCurveCount = (uint32_t)curves.size();
+    m_pAnimationCurve = new AnimationCurve [m_AnimationCurveCount];
+    memcpy(m_pAnimationCurve, curves.data(), sizeof(AnimationCurve) * m_AnimationCurveCount);
+    m_AnimationKeyCount = (uint32_t)keys.size();
+    m_pAnimationKey = new AnimationKey [m_AnimationKeyCount];
+    memcpy(m_pAnimationKey, keys.data(), sizeof(AnimationKey) * m_AnimationKeyCount);
+}
+
+// Grows the bounds of each skinned mesh over its bind pose and every animation sampled 30 times a second.  The
+// meshes are culled and their positions quantized with these bounds, so they hold for any pose in between too,
+// give or take what the samples miss.
+void AssimpModel::ComputeSkinnedBoundingBoxes()
+{
+    enum { samplesPerSecond = 30 };
+
+    // Rows of each joint's 3x4 transform, for every pose
+    std::vector<float> poses;
+    auto addPose = [&](uint32_t animationIndex, float time)
+    {
+        __declspec(align(64)) AffineTransform palette[maxJoints];
+        ComputeJointPalette(animationIndex, time, palette);
+        for (uint32_t jointIndex = 0; jointIndex < m_JointCount; jointIndex++)
+        {
+            const AffineTransform &joint = palette[jointIndex];
+            const Vector3 x = joint.GetX(), y = joint.GetY(), z = joint.GetZ(), w = joint.GetTranslation();
+            const float rows[12] =
+            {
+                x.GetX(), y.GetX(), z.GetX(), w.GetX(),
+                x.GetY(), y.GetY(), z.GetY(), w.GetY(),
+                x.GetZ(), y.GetZ(), z.GetZ(), w.GetZ(),
+            };
+            poses.insert(poses.end(), rows, rows + 12);
+        }
+    };
+
+    addPose(m_AnimationCount, 0.0f);
+    for (uint32_t animationIndex = 0; animationIndex < m_AnimationCount; animationIndex++)
+    {
+        const float duration = m_pAnimation[animationIndex].duration;
+        const unsigned int sampleCount = std::max(1u, (unsigned int)ceilf(duration * samplesPerSecond));
+        for (unsigned int sample = 0; sample <= sampleCount; sample++)
+            addPose(animationIndex, duration * sample / sampleCount);
+    }
+    const size_t poseCount = poses.size() / (m_JointCount * 12);
+
+    ForEachMesh([&](unsigned int meshIndex)
+    {
+        if (!IsMeshSkinned(meshIndex))
+            return;
+
+        Mesh *mesh = m_pMesh + meshIndex;
+        Vector3 boundsMin = mesh->boundingBox.min;
+        Vector3 boundsMax = mesh->boundingBox.max;
+        for (unsigned int v = 0; v < mesh->vertexCount; v++)
+        {
+            const unsigned char *vertex = m_pVertexData + mesh->vertexDataByteOffset + v * mesh->vertexStride;
+            const float *position = (const float*)(vertex + mesh->attrib[attrib_position].offset);
+            const uint8_t *joints = vertex + mesh->attrib[attrib_joints].offset;
+            const uint8_t *weights = vertex + mesh->attrib[attrib_weights].offset;
+
+            // Vertices without weights stay where they are, which the bounds already hold
+            if (weights[0] + weights[1] + weights[2] + weights[3] == 0)
+                continue;
+
+            for (size_t pose = 0; pose < poseCount; pose++)
+            {
+                float skinned[3] = { 0.0f, 0.0f, 0.0f };
+                for (unsigned int n = 0; n < maxJointWeights; n++)
+                {
+                    const float weight = weights[n] / 255.0f;
+                    const float *rows = poses.data() + (pose * m_JointCount + joints[n]) * 12;
+                    for (int row = 0; row < 3; row++)
+                    {
+                        skinned[row] += weight * (rows[row * 4] * position[0] + rows[row * 4 + 1] * position[1] +
+                            rows[row * 4 + 2] * position[2] + rows[row * 4 + 3]);
+                    }
+                }
+                boundsMin = Min(boundsMin, Vector3(skinned[0], skinned[1], skinned[2]));
+                boundsMax = Max(boundsMax, Vector3(skinned[0], skinned[1], skinned[2]));
+            }
+        }
+        mesh->boundingBox.min = boundsMin;
+        mesh->boundingBox.max = boundsMax;
+    });
+
+    ComputeGlobalBoundingBox(m_Header.boundingBox);
+}
 
 bool AssimpModel::LoadAssimp(const char *filename)
 {
@@ -97,7 +413,7 @@ bool AssimpModel::LoadAssimp(const char *filename)
 
     // max triangles and vertices per mesh, splits above this threshold
     importer.SetPropertyInteger(AI_CONFIG_PP_SLM_TRIANGLE_LIMIT, INT_MAX);
-    importer.SetPropertyInteger(AI_CONFIG_PP_SLM_VERTEX_LIMIT, 0xfffe); // avoid the primitive restart index
+    importer.SetPropertyInteger(AI_CONFIG_PP_SLM_VERTEX_LIMIT, m_Allow32BitIndices ? INT_MAX : 0xfffe); // avoid the primitive restart index
 
     // remove points and lines
     importer.SetPropertyInteger(AI_CONFIG_PP_SBP_REMOVE, aiPrimitiveType_POINT | aiPrimitiveType_LINE);
@@ -116,6 +432,7 @@ bool AssimpModel::LoadAssimp(const char *filename)
         aiProcess_FindInvalidData |
         aiProcess_GenUVCoords |
         aiProcess_TransformUVCoords |
+        aiProcess_LimitBoneWeights | // the default limit matches maxJointWeights
         aiProcess_OptimizeMeshes |
         aiProcess_OptimizeGraph);
 
@@ -127,11 +444,6 @@ bool AssimpModel::LoadAssimp(const char *filename)
         // embedded textures...
     }
 
-    if (scene->HasAnimations())
-    {
-        // todo
-    }
-
     m_Header.materialCount = scene->mNumMaterials;
     m_pMaterial = new Material [m_Header.materialCount];
     memset(m_pMaterial, 0, sizeof(Material) * m_Header.materialCount);
@@ -215,9 +527,18 @@ bool AssimpModel::LoadAssimp(const char *filename)
         strncpy_s(dstMat->name, matName.C_Str(), Material::maxMaterialName - 1);
     }
 
+    // Every mesh shares the vertex layout, so either all of them have joints and weights or none do
+    bool skinned = false;
+    for (unsigned int meshIndex = 0; meshIndex < scene->mNumMeshes; meshIndex++)
+        skinned = skinned || scene->mMeshes[meshIndex]->HasBones();
+
+    // NarrowIndices() halves them once the model is optimized, if they fit
+    m_Header.indexSize = sizeof(uint32_t);
+
     m_Header.meshCount = scene->mNumMeshes;
     m_pMesh = new Mesh [m_Header.meshCount];
     memset(m_pMesh, 0, sizeof(Mesh) * m_Header.meshCount);
+    m_MeshIsSkinned.assign(m_Header.meshCount, false);
     // first pass, count everything
     for (unsigned int meshIndex = 0; meshIndex < scene->mNumMeshes; meshIndex++)
     {
@@ -272,6 +593,27 @@ bool AssimpModel::LoadAssimp(const char *filename)
         dstMesh->attribDepth[attrib_position].format = attrib_format_float;
         dstMesh->vertexStrideDepth += sizeof(float) * 3;
 
+        // both streams are skinned
+        if (skinned)
+        {
+            auto addSkinAttribs = [](Attrib *attribs, unsigned int &attribsEnabled, unsigned int &vertexStride)
+            {
+                attribsEnabled |= attrib_mask_joints | attrib_mask_weights;
+                attribs[attrib_joints].offset = (uint16_t)vertexStride;
+                attribs[attrib_joints].normalized = 0;
+                attribs[attrib_joints].components = maxJointWeights;
+                attribs[attrib_joints].format = attrib_format_ubyte;
+                attribs[attrib_weights].offset = (uint16_t)(vertexStride + sizeof(uint8_t) * maxJointWeights);
+                attribs[attrib_weights].normalized = 1;
+                attribs[attrib_weights].components = maxJointWeights;
+                attribs[attrib_weights].format = attrib_format_ubyte;
+                vertexStride += sizeof(uint8_t) * maxJointWeights * 2;
+            };
+            addSkinAttribs(dstMesh->attrib, dstMesh->attribsEnabled, dstMesh->vertexStride);
+            addSkinAttribs(dstMesh->attribDepth, dstMesh->attribsEnabledDepth, dstMesh->vertexStrideDepth);
+            m_MeshIsSkinned[meshIndex] = srcMesh->HasBones();
+        }
+
         // color rendering
         dstMesh->vertexDataByteOffset = m_Header.vertexDataByteSize;
         dstMesh->vertexCount = srcMesh->mNumVertices;
@@ -279,25 +621,30 @@ bool AssimpModel::LoadAssimp(const char *filename)
         dstMesh->indexDataByteOffset = m_Header.indexDataByteSize;
         dstMesh->indexCount = srcMesh->mNumFaces * 3;
 
-        m_Header.vertexDataByteSize += dstMesh->vertexStride * dstMesh->vertexCount;
-        m_Header.indexDataByteSize += sizeof(uint16_t) * dstMesh->indexCount;
+        m_Header.vertexDataByteSize += (uint64_t)dstMesh->vertexStride * dstMesh->vertexCount;
+        m_Header.indexDataByteSize += sizeof(uint32_t) * dstMesh->indexCount;
 
         // depth-only rendering
         dstMesh->vertexDataByteOffsetDepth = m_Header.vertexDataByteSizeDepth;
         dstMesh->vertexCountDepth = srcMesh->mNumVertices;
 
-        m_Header.vertexDataByteSizeDepth += dstMesh->vertexStrideDepth * dstMesh->vertexCountDepth;
+        m_Header.vertexDataByteSizeDepth += (uint64_t)dstMesh->vertexStrideDepth * dstMesh->vertexCountDepth;
     }
     // allocate storage
-    m_pVertexData = new unsigned char [m_Header.vertexDataByteSize];
-    m_pIndexData = new unsigned char [m_Header.indexDataByteSize];
-    m_pVertexDataDepth = new unsigned char [m_Header.vertexDataByteSizeDepth];
-    m_pIndexDataDepth = new unsigned char [m_Header.indexDataByteSize];
+    m_pVertexData = new unsigned char [(size_t)m_Header.vertexDataByteSize];
+    m_pIndexData = new unsigned char [(size_t)m_Header.indexDataByteSize];
+    m_pVertexDataDepth = new unsigned char [(size_t)m_Header.vertexDataByteSizeDepth];
+    m_pIndexDataDepth = new unsigned char [(size_t)m_Header.indexDataByteSize];
+
+    JointMap jointIndices;
+    if (skinned && !ImportJoints(scene, jointIndices))
+        return false;
+
     // second pass, fill in vertex and index data
-    for (unsigned int meshIndex = 0; meshIndex < scene->mNumMeshes; meshIndex++)
+    ForEachMesh([&](unsigned int meshIndex)
     {
         const aiMesh *srcMesh = scene->mMeshes[meshIndex];
-        Mesh *dstMesh = m_pMesh + meshIndex;
+        const Mesh *dstMesh = m_pMesh + meshIndex;
 
         float *dstPos = (float*)(m_pVertexData + dstMesh->vertexDataByteOffset + dstMesh->attrib[attrib_position].offset);
         float *dstTexcoord0 = (float*)(m_pVertexData + dstMesh->vertexDataByteOffset + dstMesh->attrib[attrib_texcoord0].offset);
@@ -384,8 +731,8 @@ bool AssimpModel::LoadAssimp(const char *filename)
             dstBitangent = (float*)((unsigned char*)dstBitangent + dstMesh->vertexStride);
         }
 
-        uint16_t *dstIndex = (uint16_t*)(m_pIndexData + dstMesh->indexDataByteOffset);
-        uint16_t *dstIndexDepth = (uint16_t*)(m_pIndexDataDepth + dstMesh->indexDataByteOffset);
+        uint32_t *dstIndex = (uint32_t*)(m_pIndexData + dstMesh->indexDataByteOffset);
+        uint32_t *dstIndexDepth = (uint32_t*)(m_pIndexDataDepth + dstMesh->indexDataByteOffset);
         for (unsigned int f = 0; f < srcMesh->mNumFaces; f++)
         {
             assert(srcMesh->mFaces[f].mNumIndices == 3);
@@ -398,9 +745,22 @@ bool AssimpModel::LoadAssimp(const char *filename)
             *dstIndexDepth++ = srcMesh->mFaces[f].mIndices[1];
             *dstIndexDepth++ = srcMesh->mFaces[f].mIndices[2];
         }
-    }
+
+        if (skinned)
+            ImportSkin(srcMesh, meshIndex, jointIndices);
+    });
+
+    // Skinned meshes keep their vertices in the order of the skin data
+    if (!skinned)
+        SplitCutoutMeshes();
 
     ComputeAllBoundingBoxes();
 
+    if (skinned)
+    {
+        ImportAnimations(scene, jointIndices);
+        ComputeSkinnedBoundingBoxes();
+    }
+
     return true;
 }
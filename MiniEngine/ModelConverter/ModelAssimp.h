@@ -12,6 +12,13 @@
 #pragma once
 
 #include "Model.h"
+#include "IndexOptimizePostTransform.h"
+#include <functional>
+#include <map>
+#include <string>
+
+struct aiScene;
+struct aiMesh;
 
 class AssimpModel : public Model
 {
@@ -27,16 +34,76 @@ public:
     static const char *s_FormatString[];
     static int FormatFromFilename(const char *filename);
 
+    AssimpModel() : m_OverdrawThreshold(1.05f), m_AlphaTestThreshold(0.5f), m_Allow32BitIndices(true), m_HasSourceCacheStats(false) {}
+
     virtual bool Load(const char* filename) override;
     bool Save(const char* filename) const;
 
+    // With a threshold above zero, clusters of each mesh's triangles are reordered to reduce overdraw, at an
+    // ACMR cost of up to the threshold (1.05 allows 5% more vertex shading).  At zero, triangles are only
+    // ordered for the post-transform cache.
+    void SetOverdrawThreshold(float threshold) { m_OverdrawThreshold = threshold; }
+
+    // Materials whose diffuse texture has alpha are taken to be alpha tested against this threshold, as
+    // DepthViewerPS tests at 0.5.  Their triangles are split into those the texture covers fully, which move to
+    // an opaque copy of the material, and those it covers partly, which stay.  Triangles it never covers are
+    // dropped.  Zero leaves every mesh whole.
+    void SetAlphaTestThreshold(float threshold) { m_AlphaTestThreshold = threshold; }
+
+    // Indices are 32-bit while a model is converted, and saved as 16-bit when every mesh has few enough
+    // vertices.  Meshes are only split on import when 32-bit indices are not allowed: a larger mesh costs one
+    // draw instead of several, and splitting never improves the post-transform cache order computed over it.
+    void SetAllow32BitIndices(bool allow) { m_Allow32BitIndices = allow; }
+
+    // Where the application loads textures from, such as "Textures/", to find the files that the materials' paths
+    // resolve to.  Empty when the converter runs there.
+    void SetTextureRoot(const std::string &root)
+    {
+        m_TextureRoot = root;
+        if (!root.empty() && root.back() != '/' && root.back() != '\\')
+            m_TextureRoot += '/';
+    }
+
+    // Vertex cache stats of every mesh's full detail triangles, summed over the meshes.  The stats before
+    // the reorders are only known for models imported through Assimp.
+    enum { fifoCacheSize = 32 };
+    VertexCacheStats ComputeCacheStats(bool depth) const;
+    const VertexCacheStats *GetSourceCacheStats(bool depth) const { return m_HasSourceCacheStats ? &m_SourceCacheStats[depth ? 1 : 0] : nullptr; }
+
 private:
 
     bool LoadAssimp(const char *filename);
 
+    // The skeleton is every node that a bone names, with its ancestors.  Each vertex keeps its strongest
+    // weights in the joint and weight attributes until QuantizeVertices() moves them to the skin data.
+    typedef std::map<std::string, uint32_t> JointMap;
+    bool ImportJoints(const aiScene *scene, JointMap &jointIndices);
+    void ImportSkin(const aiMesh *srcMesh, unsigned int meshIndex, const JointMap &jointIndices);
+    void ImportAnimations(const aiScene *scene, const JointMap &jointIndices);
+    void ComputeSkinnedBoundingBoxes();
+    void SplitCutoutMeshes();
+
+    // Builds the texture manifest, the file each material slot loads with the fallbacks applied
+    void ResolveTextures();
+
+    // Runs func for every mesh, spread over the job system's workers when it has been started.  Meshes may be
+    // visited in any order, so func may only write its own mesh's data.
+    void ForEachMesh(const std::function<void(unsigned int meshIndex)>& func) const;
+
     void Optimize();
     void OptimizeRemoveDuplicateVertices(bool depth);
     void OptimizePostTransform(bool depth);
     void OptimizePreTransform(bool depth);
+    void BuildMeshlets();
+    void GenerateLODs();
+    void QuantizeVertices();
+    void NarrowIndices();
+
+    float m_OverdrawThreshold;
+    float m_AlphaTestThreshold;
+    bool m_Allow32BitIndices;
+    bool m_HasSourceCacheStats;
+    std::string m_TextureRoot;
+    VertexCacheStats m_SourceCacheStats[2];
 };
 
@@ -12,15 +12,25 @@
 //
 
 #include "ModelAssimp.h"
+#include "JobSystem.h"
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <thread>
 
 void PrintHelp()
 {
     printf("model_convert\n");
 
     printf("usage:\n");
-    printf("model_convert input_file output_file\n");
+    printf("model_convert [-j threads] [-overdraw threshold] [-alphatest threshold] [-index16] [-textureroot dir] input_file output_file\n");
+    printf("  -j threads: meshes are processed on this many threads (default: one per core)\n");
+    printf("  -overdraw threshold: ACMR increase allowed to reorder triangles for overdraw, 0 to disable (default: 1.05)\n");
+    printf("  -alphatest threshold: alpha below which cutout materials discard, 0 to leave their meshes whole (default: 0.5)\n");
+    printf("  -index16: split large meshes so that every index is 16-bit, rather than saving 32-bit indices\n");
+    printf("  -textureroot dir: the directory the application loads textures from, to resolve the materials' textures (default: working directory)\n");
 }
 
 void PrintModelStats(const Model *model)
@@ -32,9 +42,14 @@ void PrintModelStats(const Model *model)
         , (float)bbox.min.GetX(), (float)bbox.min.GetY(), (float)bbox.min.GetZ()
         , (float)bbox.max.GetX(), (float)bbox.max.GetY(), (float)bbox.max.GetZ());
 
-    printf("vertex data size: %u\n", model->m_Header.vertexDataByteSize);
-    printf("index data size: %u\n", model->m_Header.indexDataByteSize);
-    printf("vertex data size depth-only: %u\n", model->m_Header.vertexDataByteSizeDepth);
+    printf("vertex data size: %llu\n", model->m_Header.vertexDataByteSize);
+    printf("index data size: %llu\n", model->m_Header.indexDataByteSize);
+    printf("index size: %u\n", model->m_Header.indexSize);
+    printf("vertex data size depth-only: %llu\n", model->m_Header.vertexDataByteSizeDepth);
+    printf("meshlet count: %u\n", model->m_MeshletCount);
+    printf("lod count: %u\n", model->m_LODCount);
+    printf("joint count: %u\n", model->m_JointCount);
+    printf("animation count: %u\n", model->m_AnimationCount);
     printf("\n");
 
     printf("mesh count: %u\n", model->m_Header.meshCount);
@@ -65,12 +80,21 @@ void PrintModelStats(const Model *model)
             case Model::attrib_format_float:
                 printf("float");
                 break;
+
+            case Model::attrib_format_half:
+                printf("half");
+                break;
             }
         };
 
         printf("mesh %u\n", meshIndex);
         printf("vertices: %u\n", mesh->vertexCount);
         printf("indices: %u\n", mesh->indexCount);
+        for (unsigned int lod = 1; lod < model->m_LODCount; lod++)
+        {
+            const Model::MeshLOD& meshLOD = model->GetMeshLOD(meshIndex, lod);
+            printf("lod %u: indices %u, error %f\n", lod, meshLOD.indexCount, meshLOD.error);
+        }
         printf("vertex stride: %u\n", mesh->vertexStride);
         for (int n = 0; n < Model::maxAttribs; n++)
         {
@@ -94,7 +118,7 @@ void PrintModelStats(const Model *model)
             printf("attrib %d: offset %u, normalized %u, components %u, format "
                 , n, mesh->attribDepth[n].offset, mesh->attribDepth[n].normalized
                 , mesh->attribDepth[n].components);
-            printAttribFormat(mesh->attrib[n].format);
+            printAttribFormat(mesh->attribDepth[n].format);
             printf("\n");
         }
     }
@@ -105,29 +129,95 @@ void PrintModelStats(const Model *model)
     {
         const Model::Material *material = model->m_pMaterial + materialIndex;
 
-        printf("material %u\n", materialIndex);
+        printf("material %u%s\n", materialIndex, model->IsMaterialOpaque(materialIndex) ? " (opaque cutout triangles)" : "");
+    }
+    printf("\n");
+}
+
+// ACMR (vertices shaded per triangle) and ATVR (times each vertex is shaded) of the color and depth-only
+// index streams, before and after the triangle reorders when the model was imported
+void PrintCacheStats(const AssimpModel *model)
+{
+    printf("vertex cache stats (%u entry fifo):\n", (unsigned int)AssimpModel::fifoCacheSize);
+    for (int depth = 0; depth < 2; depth++)
+    {
+        const char *label = depth ? "depth-only" : "color";
+        const VertexCacheStats stats = model->ComputeCacheStats(depth != 0);
+        const VertexCacheStats *source = model->GetSourceCacheStats(depth != 0);
+        if (source)
+        {
+            printf("%s: acmr %.3f -> %.3f, atvr %.3f -> %.3f\n", label, source->GetACMR(), stats.GetACMR(),
+                source->GetATVR(), stats.GetATVR());
+        }
+        else
+        {
+            printf("%s: acmr %.3f, atvr %.3f\n", label, stats.GetACMR(), stats.GetATVR());
+        }
     }
     printf("\n");
 }
 
 int main(int argc, char **argv)
 {
-    if (argc != 3)
+    unsigned int threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+    float overdrawThreshold = 1.05f;
+    float alphaTestThreshold = 0.5f;
+    bool allow32BitIndices = true;
+    const char *textureRoot = "";
+
+    int arg = 1;
+    while (arg + 1 < argc && argv[arg][0] == '-')
+    {
+        if (strcmp(argv[arg], "-index16") == 0)
+        {
+            allow32BitIndices = false;
+            arg++;
+            continue;
+        }
+
+        if (strcmp(argv[arg], "-j") == 0)
+            threadCount = (unsigned int)atoi(argv[arg + 1]);
+        else if (strcmp(argv[arg], "-overdraw") == 0)
+            overdrawThreshold = (float)atof(argv[arg + 1]);
+        else if (strcmp(argv[arg], "-alphatest") == 0)
+            alphaTestThreshold = (float)atof(argv[arg + 1]);
+        else if (strcmp(argv[arg], "-textureroot") == 0)
+            textureRoot = argv[arg + 1];
+        else
+            break;
+        arg += 2;
+    }
+
+    if (argc - arg != 2 || threadCount == 0 || overdrawThreshold < 0.0f || alphaTestThreshold < 0.0f || alphaTestThreshold > 1.0f)
     {
         PrintHelp();
         return -1;
     }
 
-    const char *input_file = argv[1];
-    const char *output_file = argv[2];
+    const char *input_file = argv[arg];
+    const char *output_file = argv[arg + 1];
 
     printf("input file %s\n", input_file);
     printf("output file %s\n", output_file);
+    printf("threads %u\n", threadCount);
+
+    // The meshes are processed independently and gathered in order, so the output is the same for any count
+    if (threadCount > 1)
+        JobSystem::Initialize(threadCount - 1);
 
     AssimpModel model;
+    model.SetOverdrawThreshold(overdrawThreshold);
+    model.SetAlphaTestThreshold(alphaTestThreshold);
+    model.SetAllow32BitIndices(allow32BitIndices);
+    model.SetTextureRoot(textureRoot);
 
     printf("loading...\n");
-    if (!model.Load(input_file))
+    bool loaded = model.Load(input_file);
+
+    if (threadCount > 1)
+        JobSystem::Shutdown();
+
+    if (!loaded)
     {
         printf("failed to load model: %s\n", input_file);
         return -1;
@@ -143,6 +233,7 @@ int main(int argc, char **argv)
     printf("done\n");
 
     PrintModelStats(&model);
+    PrintCacheStats(&model);
 
     return 0;
 }
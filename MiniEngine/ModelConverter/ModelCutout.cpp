@@ -0,0 +1,356 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "ModelAssimp.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+namespace
+{
+    enum { triangle_opaque, triangle_partial, triangle_transparent };
+
+    // Triangles spanning more texels than this, usually ones with tiling UVs, are left alpha tested
+    enum { maxTriangleTexels = 1 << 20 };
+
+    // The alpha of a material's diffuse texture.  Each texel holds the least and the most alpha of the texels
+    // around it, which bounds what bilinear filtering can return anywhere within a texel of its center.
+    struct AlphaCoverage
+    {
+        int width;
+        int height;
+        std::vector<unsigned char> minAlpha;
+        std::vector<unsigned char> maxAlpha;
+
+        AlphaCoverage() : width(0), height(0) {}
+
+        bool IsValid() const { return width > 0; }
+
+        // UVs wrap, as the material sampler does
+        unsigned int TexelIndex(int x, int y) const
+        {
+            x %= width;
+            y %= height;
+            return (unsigned int)((y < 0 ? y + height : y) * width + (x < 0 ? x + width : x));
+        }
+    };
+
+    // Reads the alpha of an uncompressed 32-bit TGA, the only source format with alpha that the texture manager
+    // decodes.  Rows stay in file order, as the texture manager keeps them.
+    bool LoadTGAAlpha(const std::string &filename, std::vector<unsigned char> &alpha, int &width, int &height)
+    {
+        FILE *file = nullptr;
+        if (0 != fopen_s(&file, filename.c_str(), "rb"))
+            return false;
+
+        unsigned char header[18];
+        bool ok = 1 == fread(header, sizeof(header), 1, file) && header[1] == 0 && header[2] == 2 && header[16] == 32;
+        if (ok)
+        {
+            width = header[12] | header[13] << 8;
+            height = header[14] | header[15] << 8;
+
+            std::vector<unsigned char> pixels((size_t)width * height * 4);
+            ok = width > 0 && height > 0 && 0 == fseek(file, header[0], SEEK_CUR) &&
+                1 == fread(pixels.data(), pixels.size(), 1, file);
+
+            alpha.resize((size_t)width * height);
+            for (size_t n = 0; ok && n < alpha.size(); n++)
+                alpha[n] = pixels[n * 4 + 3];
+        }
+
+        fclose(file);
+        return ok;
+    }
+
+    // Loads the coverage of a texture with some texel that is not fully opaque
+    bool LoadAlphaCoverage(const std::string &texturePath, AlphaCoverage &coverage)
+    {
+        std::vector<unsigned char> alpha;
+        int width = 0, height = 0;
+        if (!LoadTGAAlpha(texturePath + ".tga", alpha, width, height) ||
+            *std::min_element(alpha.begin(), alpha.end()) == 0xff)
+            return false;
+
+        coverage.width = width;
+        coverage.height = height;
+        coverage.minAlpha.resize(alpha.size());
+        coverage.maxAlpha.resize(alpha.size());
+        for (int y = 0; y < height; y++)
+        {
+            for (int x = 0; x < width; x++)
+            {
+                unsigned char lo = 0xff, hi = 0;
+                for (int dy = -1; dy <= 1; dy++)
+                {
+                    for (int dx = -1; dx <= 1; dx++)
+                    {
+                        unsigned char a = alpha[coverage.TexelIndex(x + dx, y + dy)];
+                        lo = std::min(lo, a);
+                        hi = std::max(hi, a);
+                    }
+                }
+                coverage.minAlpha[y * width + x] = lo;
+                coverage.maxAlpha[y * width + x] = hi;
+            }
+        }
+        return true;
+    }
+
+    float EdgeFunction(const float a[2], const float b[2], float x, float y)
+    {
+        return (b[0] - a[0]) * (y - a[1]) - (b[1] - a[1]) * (x - a[0]);
+    }
+
+    // Tests the texel centers inside the triangle and points along its edges, so that thin triangles are
+    // covered too.  The threshold is in 8-bit alpha.
+    int ClassifyTriangle(const AlphaCoverage &coverage, const float *uv[3], float threshold)
+    {
+        // Texel space, with the texel centers on integers
+        float p[3][2];
+        for (int n = 0; n < 3; n++)
+        {
+            p[n][0] = uv[n][0] * coverage.width - 0.5f;
+            p[n][1] = uv[n][1] * coverage.height - 0.5f;
+        }
+
+        const float minX = floorf(std::min(p[0][0], std::min(p[1][0], p[2][0])));
+        const float minY = floorf(std::min(p[0][1], std::min(p[1][1], p[2][1])));
+        const float maxX = ceilf(std::max(p[0][0], std::max(p[1][0], p[2][0])));
+        const float maxY = ceilf(std::max(p[0][1], std::max(p[1][1], p[2][1])));
+        if (!(maxX - minX < maxTriangleTexels && maxY - minY < maxTriangleTexels &&
+            (maxX - minX + 1.0f) * (maxY - minY + 1.0f) <= maxTriangleTexels))
+            return triangle_partial;
+
+        unsigned char lo = 0xff, hi = 0;
+        auto sample = [&](int x, int y)
+        {
+            const unsigned int texel = coverage.TexelIndex(x, y);
+            lo = std::min(lo, coverage.minAlpha[texel]);
+            hi = std::max(hi, coverage.maxAlpha[texel]);
+        };
+
+        const float area = EdgeFunction(p[0], p[1], p[2][0], p[2][1]);
+        if (area != 0.0f)
+        {
+            for (int y = (int)minY; y <= (int)maxY; y++)
+            {
+                for (int x = (int)minX; x <= (int)maxX; x++)
+                {
+                    const float w0 = EdgeFunction(p[1], p[2], (float)x, (float)y) * area;
+                    const float w1 = EdgeFunction(p[2], p[0], (float)x, (float)y) * area;
+                    const float w2 = EdgeFunction(p[0], p[1], (float)x, (float)y) * area;
+                    if (w0 >= 0.0f && w1 >= 0.0f && w2 >= 0.0f)
+                        sample(x, y);
+                }
+            }
+        }
+
+        // Half texel steps along each edge
+        for (int e = 0; e < 3; e++)
+        {
+            const float *a = p[e];
+            const float *b = p[(e + 1) % 3];
+            const int steps = (int)ceilf(2.0f * std::max(fabsf(b[0] - a[0]), fabsf(b[1] - a[1]))) + 1;
+            for (int s = 0; s <= steps; s++)
+            {
+                const float t = (float)s / steps;
+                sample((int)floorf(a[0] + (b[0] - a[0]) * t + 0.5f), (int)floorf(a[1] + (b[1] - a[1]) * t + 0.5f));
+            }
+        }
+
+        if (lo >= threshold)
+            return triangle_opaque;
+        if (hi < threshold)
+            return triangle_transparent;
+        return triangle_partial;
+    }
+}
+
+// Runs on the imported float vertices, before any optimization, and rebuilds every mesh with only the vertices
+// its kept triangles use.  Both streams still share their indices at this point.
+void AssimpModel::SplitCutoutMeshes()
+{
+    if (m_AlphaTestThreshold <= 0.0f)
+        return;
+
+    std::vector<AlphaCoverage> coverage(m_Header.materialCount);
+    bool anyCutout = false;
+    for (unsigned int materialIndex = 0; materialIndex < m_Header.materialCount; materialIndex++)
+        anyCutout |= LoadAlphaCoverage(m_TextureRoot + m_pMaterial[materialIndex].texDiffusePath, coverage[materialIndex]);
+    if (!anyCutout)
+        return;
+
+    struct MeshPart
+    {
+        unsigned int sourceMesh;
+        unsigned int materialIndex;
+        std::vector<uint32_t> indices;
+    };
+    std::vector<MeshPart> parts;
+    std::vector<unsigned int> opaqueMaterial(m_Header.materialCount, ~0u);
+    unsigned int opaqueMaterialCount = 0;
+    unsigned int triangleCounts[3] = {};
+
+    const float threshold = m_AlphaTestThreshold * 255.0f;
+    for (unsigned int meshIndex = 0; meshIndex < m_Header.meshCount; meshIndex++)
+    {
+        const Mesh *mesh = m_pMesh + meshIndex;
+        const AlphaCoverage &meshCoverage = coverage[mesh->materialIndex];
+        const uint32_t *indices = (const uint32_t*)(m_pIndexData + mesh->indexDataByteOffset);
+
+        MeshPart partial = { meshIndex, mesh->materialIndex };
+        MeshPart opaque = { meshIndex, mesh->materialIndex };
+        if (!meshCoverage.IsValid())
+        {
+            partial.indices.assign(indices, indices + mesh->indexCount);
+            parts.push_back(partial);
+            continue;
+        }
+
+        const unsigned char *texcoords = m_pVertexData + mesh->vertexDataByteOffset + mesh->attrib[attrib_texcoord0].offset;
+        for (unsigned int n = 0; n < mesh->indexCount; n += 3)
+        {
+            const float *uv[3];
+            for (int corner = 0; corner < 3; corner++)
+                uv[corner] = (const float*)(texcoords + indices[n + corner] * mesh->vertexStride);
+
+            const int classification = ClassifyTriangle(meshCoverage, uv, threshold);
+            triangleCounts[classification]++;
+            if (classification == triangle_partial)
+            {
+                partial.indices.insert(partial.indices.end(), indices + n, indices + n + 3);
+            }
+            else if (classification == triangle_opaque)
+            {
+                // Cutouts draw two-sided, and opaque materials cull back faces
+                const uint32_t triangle[6] = { indices[n], indices[n + 1], indices[n + 2], indices[n], indices[n + 2], indices[n + 1] };
+                opaque.indices.insert(opaque.indices.end(), triangle, triangle + 6);
+            }
+        }
+
+        if (!partial.indices.empty())
+            parts.push_back(partial);
+        if (!opaque.indices.empty())
+        {
+            if (opaqueMaterial[mesh->materialIndex] == ~0u)
+                opaqueMaterial[mesh->materialIndex] = m_Header.materialCount + opaqueMaterialCount++;
+            opaque.materialIndex = opaqueMaterial[mesh->materialIndex];
+            parts.push_back(opaque);
+        }
+    }
+
+    printf("cutout triangles: %u opaque, %u partial, %u transparent\n",
+        triangleCounts[triangle_opaque], triangleCounts[triangle_partial], triangleCounts[triangle_transparent]);
+    if (triangleCounts[triangle_opaque] == 0 && triangleCounts[triangle_transparent] == 0)
+        return;
+
+    // The opaque copies follow the original materials
+    Material *materials = new Material [m_Header.materialCount + opaqueMaterialCount];
+    memcpy(materials, m_pMaterial, sizeof(Material) * m_Header.materialCount);
+    m_MaterialIsOpaque.assign(m_Header.materialCount + opaqueMaterialCount, false);
+    for (unsigned int materialIndex = 0; materialIndex < m_Header.materialCount; materialIndex++)
+    {
+        if (opaqueMaterial[materialIndex] != ~0u)
+        {
+            materials[opaqueMaterial[materialIndex]] = m_pMaterial[materialIndex];
+            m_MaterialIsOpaque[opaqueMaterial[materialIndex]] = true;
+        }
+    }
+    delete [] m_pMaterial;
+    m_pMaterial = materials;
+    m_Header.materialCount += opaqueMaterialCount;
+
+    // Every part takes the vertices it uses in the order it first uses them
+    std::vector<std::vector<uint32_t>> partVertices(parts.size());
+    uint64_t vertexDataByteSize = 0, indexDataByteSize = 0, vertexDataByteSizeDepth = 0;
+    for (size_t partIndex = 0; partIndex < parts.size(); partIndex++)
+    {
+        MeshPart &part = parts[partIndex];
+        const Mesh *mesh = m_pMesh + part.sourceMesh;
+
+        std::vector<uint32_t> vertexRemap(mesh->vertexCount, ~0u);
+        for (uint32_t &index : part.indices)
+        {
+            if (vertexRemap[index] == ~0u)
+            {
+                vertexRemap[index] = (uint32_t)partVertices[partIndex].size();
+                partVertices[partIndex].push_back(index);
+            }
+            index = vertexRemap[index];
+        }
+
+        vertexDataByteSize += (uint64_t)mesh->vertexStride * partVertices[partIndex].size();
+        vertexDataByteSizeDepth += (uint64_t)mesh->vertexStrideDepth * partVertices[partIndex].size();
+        indexDataByteSize += sizeof(uint32_t) * part.indices.size();
+    }
+
+    Mesh *meshes = new Mesh [parts.size()];
+    unsigned char *vertexData = new unsigned char [(size_t)vertexDataByteSize];
+    unsigned char *indexData = new unsigned char [(size_t)indexDataByteSize];
+    unsigned char *vertexDataDepth = new unsigned char [(size_t)vertexDataByteSizeDepth];
+    unsigned char *indexDataDepth = new unsigned char [(size_t)indexDataByteSize];
+
+    uint64_t vertexDataByteOffset = 0, indexDataByteOffset = 0, vertexDataByteOffsetDepth = 0;
+    for (size_t partIndex = 0; partIndex < parts.size(); partIndex++)
+    {
+        const MeshPart &part = parts[partIndex];
+        const Mesh *srcMesh = m_pMesh + part.sourceMesh;
+        const std::vector<uint32_t> &vertices = partVertices[partIndex];
+
+        Mesh *dstMesh = meshes + partIndex;
+        *dstMesh = *srcMesh;
+        dstMesh->materialIndex = part.materialIndex;
+        dstMesh->vertexDataByteOffset = vertexDataByteOffset;
+        dstMesh->vertexCount = (unsigned int)vertices.size();
+        dstMesh->indexDataByteOffset = indexDataByteOffset;
+        dstMesh->indexCount = (unsigned int)part.indices.size();
+        dstMesh->vertexDataByteOffsetDepth = vertexDataByteOffsetDepth;
+        dstMesh->vertexCountDepth = (unsigned int)vertices.size();
+
+        for (uint32_t vertex : vertices)
+        {
+            memcpy(vertexData + vertexDataByteOffset, m_pVertexData + srcMesh->vertexDataByteOffset + (size_t)vertex * srcMesh->vertexStride,
+                srcMesh->vertexStride);
+            memcpy(vertexDataDepth + vertexDataByteOffsetDepth, m_pVertexDataDepth + srcMesh->vertexDataByteOffsetDepth + (size_t)vertex * srcMesh->vertexStrideDepth,
+                srcMesh->vertexStrideDepth);
+            vertexDataByteOffset += srcMesh->vertexStride;
+            vertexDataByteOffsetDepth += srcMesh->vertexStrideDepth;
+        }
+
+        const size_t indexBytes = sizeof(uint32_t) * part.indices.size();
+        if (indexBytes > 0)
+        {
+            memcpy(indexData + indexDataByteOffset, part.indices.data(), indexBytes);
+            memcpy(indexDataDepth + indexDataByteOffset, part.indices.data(), indexBytes);
+        }
+        indexDataByteOffset += indexBytes;
+    }
+
+    delete [] m_pMesh;
+    delete [] m_pVertexData;
+    delete [] m_pIndexData;
+    delete [] m_pVertexDataDepth;
+    delete [] m_pIndexDataDepth;
+    m_pMesh = meshes;
+    m_pVertexData = vertexData;
+    m_pIndexData = indexData;
+    m_pVertexDataDepth = vertexDataDepth;
+    m_pIndexDataDepth = indexDataDepth;
+
+    m_Header.meshCount = (uint32_t)parts.size();
+    m_Header.vertexDataByteSize = vertexDataByteSize;
+    m_Header.indexDataByteSize = indexDataByteSize;
+    m_Header.vertexDataByteSizeDepth = vertexDataByteSizeDepth;
+    m_MeshIsSkinned.assign(m_Header.meshCount, false);
+}
@@ -13,57 +13,119 @@
 
 #include "ModelAssimp.h"
 #include "IndexOptimizePostTransform.h"
+#include "JobSystem.h"
 
 #include <string.h>
+#include <math.h>
+#include <float.h>
+#include <vector>
+#include <algorithm>
+#include <DirectXPackedVector.h>
+
+namespace
+{
+    uint16_t QuantizeUnorm16(float value)
+    {
+        return (uint16_t)(Min(Max(value, 0.0f), 1.0f) * 65535.0f + 0.5f);
+    }
+
+    int16_t QuantizeSnorm16(float value)
+    {
+        value = Min(Max(value, -1.0f), 1.0f) * 32767.0f;
+        return (int16_t)(value >= 0.0f ? value + 0.5f : value - 0.5f);
+    }
+
+    // Projects the unit vector onto the octahedron |x| + |y| + |z| = 1 and unfolds the lower half over the
+    // corners of the upper half, leaving a point in the [-1, 1] square
+    void EncodeOctahedral(const float *v, int16_t *dst)
+    {
+        float l1 = fabsf(v[0]) + fabsf(v[1]) + fabsf(v[2]);
+        float x = l1 > 0.0f ? v[0] / l1 : 0.0f;
+        float y = l1 > 0.0f ? v[1] / l1 : 0.0f;
+        if (v[2] < 0.0f)
+        {
+            float foldedX = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+            float foldedY = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+            x = foldedX;
+            y = foldedY;
+        }
+        dst[0] = QuantizeSnorm16(x);
+        dst[1] = QuantizeSnorm16(y);
+    }
+}
+
+void AssimpModel::ForEachMesh(const std::function<void(unsigned int meshIndex)>& func) const
+{
+    auto runMeshes = [&func](uint32_t begin, uint32_t end)
+    {
+        for (uint32_t meshIndex = begin; meshIndex < end; meshIndex++)
+            func(meshIndex);
+    };
+
+    // One mesh per job, since mesh sizes vary too much to batch them evenly
+    if (JobSystem::GetWorkerCount() > 0)
+        JobSystem::ParallelFor(m_Header.meshCount, 1, runMeshes);
+    else
+        runMeshes(0, m_Header.meshCount);
+}
 
 void AssimpModel::OptimizeRemoveDuplicateVertices(bool depth)
 {
     unsigned char *deduplicatedVertexData = new unsigned char [depth ? m_Header.vertexDataByteSizeDepth : m_Header.vertexDataByteSize];
-    uint32_t deduplicatedVertexDataSize = 0;
+    std::vector<unsigned int> deduplicatedCounts(m_Header.meshCount);
 
-    for (unsigned int meshIndex = 0; meshIndex < m_Header.meshCount; meshIndex++)
+    // Each mesh is deduplicated into the space it had before, and the meshes are packed together afterwards
+    ForEachMesh([&](unsigned int meshIndex)
     {
-        Mesh *mesh = m_pMesh + meshIndex;
+        const Mesh *mesh = m_pMesh + meshIndex;
         unsigned int vertexStride = depth ? mesh->vertexStrideDepth : mesh->vertexStride;
-        unsigned char *meshVertexData = depth ? (m_pVertexDataDepth + mesh->vertexDataByteOffsetDepth) : (m_pVertexData + mesh->vertexDataByteOffset);
+        uint64_t vertexDataByteOffset = depth ? mesh->vertexDataByteOffsetDepth : mesh->vertexDataByteOffset;
+        const unsigned char *meshVertexData = (depth ? m_pVertexDataDepth : m_pVertexData) + vertexDataByteOffset;
 
-        unsigned char *meshDeduplicatedVertexData = deduplicatedVertexData + deduplicatedVertexDataSize;
+        unsigned char *meshDeduplicatedVertexData = deduplicatedVertexData + vertexDataByteOffset;
         unsigned int deduplicatedCount = 0;
 
         unsigned int vertexCount = depth ? mesh->vertexCountDepth : mesh->vertexCount;
         uint32_t *vertexRemap = new uint32_t [vertexCount];
-        memset(vertexRemap, (uint32_t)-1, sizeof(uint32_t) * vertexCount);
         assert(vertexCount <= (uint32_t)-1);
 
-        for (unsigned int v1 = 0; v1 < vertexCount; v1++)
+        auto vertexData = [&](uint32_t v) { return meshVertexData + (size_t)v * vertexStride; };
+
+        // Meshes are no longer split to fit 16-bit indices, so duplicates are found by sorting rather than by
+        // comparing every pair.  Equal vertices sort together in their original order, and each maps to the
+        // first of them.
+        std::vector<uint32_t> sortedVertices(vertexCount);
+        std::vector<uint32_t> firstDuplicate(vertexCount);
+        for (unsigned int v = 0; v < vertexCount; v++)
+            sortedVertices[v] = v;
+        std::sort(sortedVertices.begin(), sortedVertices.end(), [&](uint32_t a, uint32_t b)
         {
-            if (vertexRemap[v1] != (uint32_t)-1)
-                continue; // this was already found to be a duplicate
+            int order = memcmp(vertexData(a), vertexData(b), vertexStride);
+            return order != 0 ? order < 0 : a < b;
+        });
+        for (unsigned int n = 0; n < vertexCount; n++)
+        {
+            const uint32_t v = sortedVertices[n];
+            const bool duplicate = n > 0 && 0 == memcmp(vertexData(sortedVertices[n - 1]), vertexData(v), vertexStride);
+            firstDuplicate[v] = duplicate ? firstDuplicate[sortedVertices[n - 1]] : v;
+        }
 
-            const unsigned char *v1Data = meshVertexData + v1 * vertexStride;
+        for (unsigned int v1 = 0; v1 < vertexCount; v1++)
+        {
+            if (firstDuplicate[v1] != v1)
+            {
+                vertexRemap[v1] = vertexRemap[firstDuplicate[v1]];
+                continue;
+            }
 
             // this is a new unique vertex
             uint32_t remappedSlot = deduplicatedCount++;
             vertexRemap[v1] = remappedSlot;
-            memcpy(meshDeduplicatedVertexData + remappedSlot * vertexStride, v1Data, vertexStride);
-
-            // scan for duplicates
-            for (unsigned int v2 = v1 + 1; v2 < vertexCount; v2++)
-            {
-                if (vertexRemap[v2] != (uint32_t)-1)
-                    continue; // this was already found to be a duplicate of another vertex
-
-                const unsigned char *v2Data = meshVertexData + v2 * vertexStride;
-
-                if (0 == memcmp(v1Data, v2Data, vertexStride))
-                {
-                    vertexRemap[v2] = remappedSlot;
-                }
-            }
+            memcpy(meshDeduplicatedVertexData + (size_t)remappedSlot * vertexStride, vertexData(v1), vertexStride);
         }
 
         unsigned int indexCount = mesh->indexCount;
-        uint16_t *indexArray = (uint16_t*)((depth ? m_pIndexDataDepth : m_pIndexData) + mesh->indexDataByteOffset);
+        uint32_t *indexArray = (uint32_t*)((depth ? m_pIndexDataDepth : m_pIndexData) + mesh->indexDataByteOffset);
         for (unsigned int n = 0; n < indexCount; n++)
         {
             indexArray[n] = vertexRemap[indexArray[n]];
@@ -71,17 +133,24 @@ void AssimpModel::OptimizeRemoveDuplicateVertices(bool depth)
 
         delete [] vertexRemap;
 
-        if (depth)
-        {
-            mesh->vertexCountDepth = deduplicatedCount;
-            mesh->vertexDataByteOffsetDepth = deduplicatedVertexDataSize;
-        }
-        else
-        {
-            mesh->vertexCount = deduplicatedCount;
-            mesh->vertexDataByteOffset = deduplicatedVertexDataSize;
-        }
-        deduplicatedVertexDataSize += deduplicatedCount * vertexStride;
+        deduplicatedCounts[meshIndex] = deduplicatedCount;
+    });
+
+    // Meshes are packed in order, and each only moves towards the front
+    uint64_t deduplicatedVertexDataSize = 0;
+    for (unsigned int meshIndex = 0; meshIndex < m_Header.meshCount; meshIndex++)
+    {
+        Mesh *mesh = m_pMesh + meshIndex;
+        unsigned int vertexStride = depth ? mesh->vertexStrideDepth : mesh->vertexStride;
+        uint64_t &vertexDataByteOffset = depth ? mesh->vertexDataByteOffsetDepth : mesh->vertexDataByteOffset;
+        unsigned int deduplicatedCount = deduplicatedCounts[meshIndex];
+
+        memmove(deduplicatedVertexData + deduplicatedVertexDataSize, deduplicatedVertexData + vertexDataByteOffset,
+            (size_t)deduplicatedCount * vertexStride);
+
+        vertexDataByteOffset = deduplicatedVertexDataSize;
+        (depth ? mesh->vertexCountDepth : mesh->vertexCount) = deduplicatedCount;
+        deduplicatedVertexDataSize += (uint64_t)deduplicatedCount * vertexStride;
     }
 
     if (depth)
@@ -98,31 +167,61 @@ void AssimpModel::OptimizeRemoveDuplicateVertices(bool depth)
     }
 }
 
+VertexCacheStats AssimpModel::ComputeCacheStats(bool depth) const
+{
+    VertexCacheStats total = {};
+    for (unsigned int meshIndex = 0; meshIndex < m_Header.meshCount; meshIndex++)
+    {
+        const Mesh *mesh = m_pMesh + meshIndex;
+        const unsigned char *indices = (depth ? m_pIndexDataDepth : m_pIndexData) + mesh->indexDataByteOffset;
+
+        // Saved models may have either index size
+        VertexCacheStats stats = m_Header.indexSize == sizeof(uint32_t) ?
+            ComputeVertexCacheStats<uint32_t>((const uint32_t*)indices, mesh->indexCount, fifoCacheSize) :
+            ComputeVertexCacheStats<uint16_t>((const uint16_t*)indices, mesh->indexCount, fifoCacheSize);
+        total.transformedVertexCount += stats.transformedVertexCount;
+        total.triangleCount += stats.triangleCount;
+        total.vertexCount += stats.vertexCount;
+    }
+    return total;
+}
+
 void AssimpModel::OptimizePostTransform(bool depth)
 {
     enum {lruCacheSize = 64};
 
-    for (unsigned int meshIndex = 0; meshIndex < m_Header.meshCount; meshIndex++)
+    ForEachMesh([&](unsigned int meshIndex)
     {
-        Mesh *mesh = m_pMesh + meshIndex;
+        const Mesh *mesh = m_pMesh + meshIndex;
 
-        uint16_t *srcIndices = new uint16_t [mesh->indexCount];
-        uint16_t *dstIndices = (uint16_t*)((depth ? m_pIndexDataDepth : m_pIndexData) + mesh->indexDataByteOffset);
-        memcpy(srcIndices, dstIndices, sizeof(uint16_t) * mesh->indexCount);
+        uint32_t *srcIndices = new uint32_t [mesh->indexCount];
+        uint32_t *dstIndices = (uint32_t*)((depth ? m_pIndexDataDepth : m_pIndexData) + mesh->indexDataByteOffset);
+        memcpy(srcIndices, dstIndices, sizeof(uint32_t) * mesh->indexCount);
 
-        OptimizeFaces<uint16_t>(srcIndices, mesh->indexCount, dstIndices, lruCacheSize);
+        OptimizeFaces<uint32_t>(srcIndices, mesh->indexCount, dstIndices, lruCacheSize);
+
+        if (m_OverdrawThreshold > 0.0f)
+        {
+            const float *positions = depth ?
+                (const float*)(m_pVertexDataDepth + mesh->vertexDataByteOffsetDepth + mesh->attribDepth[attrib_position].offset) :
+                (const float*)(m_pVertexData + mesh->vertexDataByteOffset + mesh->attrib[attrib_position].offset);
+
+            memcpy(srcIndices, dstIndices, sizeof(uint32_t) * mesh->indexCount);
+            OptimizeOverdraw<uint32_t>(srcIndices, mesh->indexCount, dstIndices, positions,
+                depth ? mesh->vertexStrideDepth : mesh->vertexStride, fifoCacheSize, m_OverdrawThreshold);
+        }
 
         delete [] srcIndices;
-    }
+    });
 }
 
 void AssimpModel::OptimizePreTransform(bool depth)
 {
     unsigned char *reorderedVertexData = new unsigned char [depth ? m_Header.vertexDataByteSizeDepth : m_Header.vertexDataByteSize];
 
-    for (unsigned int meshIndex = 0; meshIndex < m_Header.meshCount; meshIndex++)
+    ForEachMesh([&](unsigned int meshIndex)
     {
-        Mesh *mesh = m_pMesh + meshIndex;
+        const Mesh *mesh = m_pMesh + meshIndex;
         unsigned int indexCount = mesh->indexCount;
         unsigned int vertexStride = depth ? mesh->vertexStrideDepth : mesh->vertexStride;
         unsigned char *meshVertexData = depth ? (m_pVertexDataDepth + mesh->vertexDataByteOffsetDepth) : (m_pVertexData + mesh->vertexDataByteOffset);
@@ -135,15 +234,15 @@ void AssimpModel::OptimizePreTransform(bool depth)
         memset(vertexRemap, (uint32_t)-1, sizeof(uint32_t) * vertexCount);
         assert(vertexCount <= (uint32_t)-1);
 
-        uint16_t *indexArray = (uint16_t*)((depth ? m_pIndexDataDepth : m_pIndexData) + mesh->indexDataByteOffset);
+        uint32_t *indexArray = (uint32_t*)((depth ? m_pIndexDataDepth : m_pIndexData) + mesh->indexDataByteOffset);
         for (unsigned int n = 0; n < indexCount; n++)
         {
-            uint16_t index = indexArray[n];
+            uint32_t index = indexArray[n];
             if (vertexRemap[index] == (uint32_t)-1)
             {
                 // not relocated yet
-                const unsigned char *vSrc = meshVertexData + index * vertexStride;
-                unsigned char *vDst = meshReorderedVertexData + reorderedCount * vertexStride;
+                const unsigned char *vSrc = meshVertexData + (size_t)index * vertexStride;
+                unsigned char *vDst = meshReorderedVertexData + (size_t)reorderedCount * vertexStride;
                 memcpy(vDst, vSrc, vertexStride);
 
                 vertexRemap[index] = reorderedCount;
@@ -153,7 +252,7 @@ void AssimpModel::OptimizePreTransform(bool depth)
         }
 
         delete [] vertexRemap;
-    }
+    });
 
     if (depth)
     {
@@ -167,18 +266,337 @@ void AssimpModel::OptimizePreTransform(bool depth)
     }
 }
 
-void AssimpModel::Optimize()
+// Splits the depth-only index stream of each mesh into meshlets.  Triangles are taken in their post-transform
+// cache order, so neighboring triangles (which share vertices and usually face the same way) end up together.
+void AssimpModel::BuildMeshlets()
+{
+    std::vector<std::vector<Meshlet>> meshMeshlets(m_Header.meshCount);
+
+    ForEachMesh([&](unsigned int meshIndex)
+    {
+        std::vector<Meshlet>& meshlets = meshMeshlets[meshIndex];
+        std::vector<uint32_t> vertexStamp;
+        uint32_t meshletVertices[maxMeshletVertices];
+
+        const Mesh *mesh = m_pMesh + meshIndex;
+        const uint32_t *indexArray = (uint32_t*)(m_pIndexDataDepth + mesh->indexDataByteOffset);
+        const unsigned char *meshVertexData = m_pVertexDataDepth + mesh->vertexDataByteOffsetDepth + mesh->attribDepth[attrib_position].offset;
+
+        auto getPosition = [&](uint32_t index) -> Vector3
+        {
+            const float *p = (const float*)(meshVertexData + (size_t)index * mesh->vertexStrideDepth);
+            return Vector3(p[0], p[1], p[2]);
+        };
+
+        // Stamped with the meshlet count + 1 when a vertex is already in the current meshlet
+        vertexStamp.assign(mesh->vertexCountDepth, 0);
+
+        unsigned int firstIndex = 0;
+        while (firstIndex < mesh->indexCount)
+        {
+            const uint32_t stamp = (uint32_t)meshlets.size() + 1;
+            unsigned int vertexCount = 0;
+            unsigned int indexCount = 0;
+
+            while (firstIndex + indexCount < mesh->indexCount && indexCount < maxMeshletTriangles * 3)
+            {
+                const uint32_t *tri = indexArray + firstIndex + indexCount;
+                unsigned int newVertices = 0;
+                for (int n = 0; n < 3; n++)
+                    newVertices += (vertexStamp[tri[n]] != stamp && (n < 1 || tri[n] != tri[0]) && (n < 2 || tri[n] != tri[1])) ? 1 : 0;
+                if (vertexCount + newVertices > maxMeshletVertices)
+                    break;
+
+                for (int n = 0; n < 3; n++)
+                {
+                    if (vertexStamp[tri[n]] != stamp)
+                    {
+                        vertexStamp[tri[n]] = stamp;
+                        meshletVertices[vertexCount++] = tri[n];
+                    }
+                }
+                indexCount += 3;
+            }
+
+            Meshlet meshlet;
+            meshlet.meshIndex = meshIndex;
+            meshlet.indexOffset = firstIndex;
+            meshlet.indexCount = indexCount;
+            meshlet.vertexCount = vertexCount;
+
+            // Bounding sphere around the center of the vertices' box
+            Vector3 boundsMin = Scalar(FLT_MAX);
+            Vector3 boundsMax = Scalar(-FLT_MAX);
+            for (unsigned int n = 0; n < vertexCount; n++)
+            {
+                Vector3 pos = getPosition(meshletVertices[n]);
+                boundsMin = Min(boundsMin, pos);
+                boundsMax = Max(boundsMax, pos);
+            }
+            Vector3 center = (boundsMin + boundsMax) * 0.5f;
+            float radius = 0.0f;
+            for (unsigned int n = 0; n < vertexCount; n++)
+                radius = Max(radius, (float)Length(getPosition(meshletVertices[n]) - center));
+
+            // Skinned meshlets move with the pose, so they get the animated mesh bounds and are never cone culled
+            const bool meshSkinned = IsMeshSkinned(meshIndex);
+            if (meshSkinned)
+            {
+                boundsMin = mesh->boundingBox.min;
+                boundsMax = mesh->boundingBox.max;
+                center = (boundsMin + boundsMax) * 0.5f;
+                radius = (float)Length(boundsMax - boundsMin) * 0.5f;
+            }
+
+            // Normal cone around the average triangle normal.  Degenerate triangles have no normal and are skipped.
+            std::vector<Vector3> normals;
+            normals.reserve(indexCount / 3);
+            Vector3 axis(kZero);
+            for (unsigned int n = 0; n < indexCount; n += 3)
+            {
+                const uint32_t *tri = indexArray + firstIndex + n;
+                Vector3 p0 = getPosition(tri[0]);
+                Vector3 normal = Cross(getPosition(tri[1]) - p0, getPosition(tri[2]) - p0);
+                float length = Length(normal);
+                if (length > 0.0f)
+                {
+                    normals.push_back(normal / length);
+                    axis = axis + normals.back();
+                }
+            }
+
+            float coneCutoff = 1.0f;
+            float axisLength = Length(axis);
+            if (axisLength > 0.0f)
+            {
+                axis = axis / axisLength;
+                float minDot = 1.0f;
+                for (const Vector3& normal : normals)
+                    minDot = Min(minDot, (float)Dot(normal, axis));
+
+                // A cone of 90 degrees or more always has a triangle that could face the light
+                if (minDot > 0.0f)
+                    coneCutoff = sqrtf(1.0f - minDot * minDot);
+            }
+
+            meshlet.center[0] = center.GetX();
+            meshlet.center[1] = center.GetY();
+            meshlet.center[2] = center.GetZ();
+            meshlet.radius = radius;
+            meshlet.coneAxis[0] = axis.GetX();
+            meshlet.coneAxis[1] = axis.GetY();
+            meshlet.coneAxis[2] = axis.GetZ();
+            meshlet.coneCutoff = meshSkinned ? 1.0f : coneCutoff;
+            meshlets.push_back(meshlet);
+
+            firstIndex += indexCount;
+        }
+    });
+
+    // Concatenated in mesh order
+    std::vector<Meshlet> meshlets;
+    for (const std::vector<Meshlet>& mesh : meshMeshlets)
+        meshlets.insert(meshlets.end(), mesh.begin(), mesh.end());
+
+    delete [] m_pMeshlet;
+    m_MeshletCount = (uint32_t)meshlets.size();
+    m_pMeshlet = new Meshlet [m_MeshletCount];
+    memcpy(m_pMeshlet, meshlets.data(), sizeof(Meshlet) * m_MeshletCount);
+}
+
+// Rewrites both vertex streams in the quantized layout.  Positions become 16-bit unorms relative to the model's
+// bounding box, so the full and depth-only streams still hold identical positions.  Normals, tangents and
+// bitangents are octahedral-encoded in 16-bit snorms and texture coordinates become half floats, which takes
+// the full vertex from 56 bytes to 24 and the depth-only vertex from 12 bytes to 8.  Joints and weights move out
+// of both streams into the skin data, indexed by the same vertex, which the skinning pass reads on its own.
+void AssimpModel::QuantizeVertices()
 {
-    // TODO: quantize/compress vertex data
+    enum
+    {
+        quantizedStride = sizeof(uint16_t) * 4 + sizeof(uint16_t) * 2 + sizeof(int16_t) * 2 * 3,
+        quantizedStrideDepth = sizeof(uint16_t) * 4,
+    };
+
+    auto setAttrib = [](Attrib &attrib, unsigned int offset, unsigned int components, unsigned int format, bool normalized)
+    {
+        attrib.offset = (uint16_t)offset;
+        attrib.normalized = normalized ? 1 : 0;
+        attrib.components = (uint16_t)components;
+        attrib.format = (uint16_t)format;
+    };
+
+    const Vector3 boundsMin = m_Header.boundingBox.min;
+    const Vector3 extent = m_Header.boundingBox.max - boundsMin;
+    const float invExtent[3] =
+    {
+        extent.GetX() > 0.0f ? 1.0f / extent.GetX() : 0.0f,
+        extent.GetY() > 0.0f ? 1.0f / extent.GetY() : 0.0f,
+        extent.GetZ() > 0.0f ? 1.0f / extent.GetZ() : 0.0f,
+    };
+    const float offset[3] = { boundsMin.GetX(), boundsMin.GetY(), boundsMin.GetZ() };
+
+    auto quantizePosition = [&](const float *src, uint16_t *dst)
+    {
+        for (int n = 0; n < 3; n++)
+            dst[n] = QuantizeUnorm16((src[n] - offset[n]) * invExtent[n]);
+        dst[3] = 0;
+    };
+
+    uint64_t vertexDataByteSize = 0;
+    uint64_t vertexDataByteSizeDepth = 0;
+    for (unsigned int meshIndex = 0; meshIndex < m_Header.meshCount; meshIndex++)
+    {
+        vertexDataByteSize += (uint64_t)m_pMesh[meshIndex].vertexCount * quantizedStride;
+        vertexDataByteSizeDepth += (uint64_t)m_pMesh[meshIndex].vertexCountDepth * quantizedStrideDepth;
+    }
+    unsigned char *quantizedVertexData = new unsigned char [(size_t)vertexDataByteSize];
+    unsigned char *quantizedVertexDataDepth = new unsigned char [(size_t)vertexDataByteSizeDepth];
+
+    const bool skinned = IsSkinned();
+    if (skinned)
+    {
+        delete [] m_pSkinData;
+        delete [] m_pSkinDataDepth;
+        m_pSkinData = new SkinVertex [(size_t)(vertexDataByteSize / quantizedStride)];
+        m_pSkinDataDepth = new SkinVertex [(size_t)(vertexDataByteSizeDepth / quantizedStrideDepth)];
+    }
+
+    ForEachMesh([&](unsigned int meshIndex)
+    {
+        Mesh *mesh = m_pMesh + meshIndex;
+
+        // Meshes keep their base vertex
+        const unsigned char *srcVertexData = m_pVertexData + mesh->vertexDataByteOffset;
+        const unsigned char *srcVertexDataDepth = m_pVertexDataDepth + mesh->vertexDataByteOffsetDepth;
+        mesh->vertexDataByteOffset = mesh->vertexDataByteOffset / mesh->vertexStride * quantizedStride;
+        mesh->vertexDataByteOffsetDepth = mesh->vertexDataByteOffsetDepth / mesh->vertexStrideDepth * quantizedStrideDepth;
+        unsigned char *dstVertexData = quantizedVertexData + mesh->vertexDataByteOffset;
+        unsigned char *dstVertexDataDepth = quantizedVertexDataDepth + mesh->vertexDataByteOffsetDepth;
 
+        for (unsigned int v = 0; v < mesh->vertexCount; v++)
+        {
+            const unsigned char *src = srcVertexData + v * mesh->vertexStride;
+            unsigned char *dst = dstVertexData + v * quantizedStride;
+
+            quantizePosition((const float*)(src + mesh->attrib[attrib_position].offset), (uint16_t*)dst);
+
+            const float *texcoord0 = (const float*)(src + mesh->attrib[attrib_texcoord0].offset);
+            uint16_t *dstTexcoord0 = (uint16_t*)(dst + 8);
+            dstTexcoord0[0] = DirectX::PackedVector::XMConvertFloatToHalf(texcoord0[0]);
+            dstTexcoord0[1] = DirectX::PackedVector::XMConvertFloatToHalf(texcoord0[1]);
+
+            EncodeOctahedral((const float*)(src + mesh->attrib[attrib_normal].offset), (int16_t*)(dst + 12));
+            EncodeOctahedral((const float*)(src + mesh->attrib[attrib_tangent].offset), (int16_t*)(dst + 16));
+            EncodeOctahedral((const float*)(src + mesh->attrib[attrib_bitangent].offset), (int16_t*)(dst + 20));
+
+            if (skinned)
+            {
+                SkinVertex &skin = m_pSkinData[mesh->vertexDataByteOffset / quantizedStride + v];
+                memcpy(skin.joints, src + mesh->attrib[attrib_joints].offset, sizeof(skin.joints));
+                memcpy(skin.weights, src + mesh->attrib[attrib_weights].offset, sizeof(skin.weights));
+            }
+        }
+
+        for (unsigned int v = 0; v < mesh->vertexCountDepth; v++)
+        {
+            const unsigned char *src = srcVertexDataDepth + v * mesh->vertexStrideDepth;
+            quantizePosition((const float*)(src + mesh->attribDepth[attrib_position].offset),
+                (uint16_t*)(dstVertexDataDepth + v * quantizedStrideDepth));
+
+            if (skinned)
+            {
+                SkinVertex &skin = m_pSkinDataDepth[mesh->vertexDataByteOffsetDepth / quantizedStrideDepth + v];
+                memcpy(skin.joints, src + mesh->attribDepth[attrib_joints].offset, sizeof(skin.joints));
+                memcpy(skin.weights, src + mesh->attribDepth[attrib_weights].offset, sizeof(skin.weights));
+            }
+        }
+
+        setAttrib(mesh->attrib[attrib_position], 0, 4, attrib_format_ushort, true);
+        setAttrib(mesh->attrib[attrib_texcoord0], 8, 2, attrib_format_half, false);
+        setAttrib(mesh->attrib[attrib_normal], 12, 2, attrib_format_short, true);
+        setAttrib(mesh->attrib[attrib_tangent], 16, 2, attrib_format_short, true);
+        setAttrib(mesh->attrib[attrib_bitangent], 20, 2, attrib_format_short, true);
+        mesh->vertexStride = quantizedStride;
+
+        setAttrib(mesh->attribDepth[attrib_position], 0, 4, attrib_format_ushort, true);
+        mesh->vertexStrideDepth = quantizedStrideDepth;
+
+        mesh->attribsEnabled &= ~(attrib_mask_joints | attrib_mask_weights);
+        mesh->attribsEnabledDepth &= ~(attrib_mask_joints | attrib_mask_weights);
+        memset(mesh->attrib + attrib_joints, 0, sizeof(Attrib) * 2);
+        memset(mesh->attribDepth + attrib_joints, 0, sizeof(Attrib) * 2);
+    });
+
+    delete [] m_pVertexData;
+    delete [] m_pVertexDataDepth;
+    m_pVertexData = quantizedVertexData;
+    m_pVertexDataDepth = quantizedVertexDataDepth;
+    m_Header.vertexDataByteSize = vertexDataByteSize;
+    m_Header.vertexDataByteSizeDepth = vertexDataByteSizeDepth;
+}
+
+void AssimpModel::Optimize()
+{
     OptimizeRemoveDuplicateVertices(false);
     OptimizeRemoveDuplicateVertices(true);
 
-    // re-order indices for post transform cache
+    m_SourceCacheStats[0] = ComputeCacheStats(false);
+    m_SourceCacheStats[1] = ComputeCacheStats(true);
+    m_HasSourceCacheStats = true;
+
+    // re-order indices for post transform cache, then clusters of them for overdraw
     OptimizePostTransform(false);
     OptimizePostTransform(true);
 
     // re-order vertices for linear memory access
     OptimizePreTransform(false);
     OptimizePreTransform(true);
+
+    // split the depth-only stream into clusters for shadow culling
+    BuildMeshlets();
+
+    // simplified levels of detail, after the full meshes' indices
+    GenerateLODs();
+
+    // last, since everything above reads float positions
+    QuantizeVertices();
+
+    NarrowIndices();
+}
+
+// Saves the 32-bit indices of the conversion as 16-bit when every mesh's vertices fit, leaving out the
+// primitive restart index.  Offsets into both streams and into the LODs halve, and meshlet offsets count
+// indices, so they stay.
+void AssimpModel::NarrowIndices()
+{
+    assert(m_Header.indexSize == sizeof(uint32_t));
+
+    for (unsigned int meshIndex = 0; meshIndex < m_Header.meshCount; meshIndex++)
+    {
+        if (m_pMesh[meshIndex].vertexCount > 0xffff || m_pMesh[meshIndex].vertexCountDepth > 0xffff)
+            return;
+    }
+
+    const size_t indexCount = (size_t)(m_Header.indexDataByteSize / sizeof(uint32_t));
+    for (int depth = 0; depth < 2; depth++)
+    {
+        unsigned char *&indexData = depth ? m_pIndexDataDepth : m_pIndexData;
+        unsigned char *narrowIndexData = new unsigned char [indexCount * sizeof(uint16_t)];
+
+        const uint32_t *src = (const uint32_t*)indexData;
+        uint16_t *dst = (uint16_t*)narrowIndexData;
+        for (size_t n = 0; n < indexCount; n++)
+            dst[n] = (uint16_t)src[n];
+
+        delete [] indexData;
+        indexData = narrowIndexData;
+    }
+
+    for (unsigned int meshIndex = 0; meshIndex < m_Header.meshCount; meshIndex++)
+        m_pMesh[meshIndex].indexDataByteOffset /= 2;
+    for (unsigned int n = 0; n < m_Header.meshCount * m_LODCount; n++)
+        m_pMeshLOD[n].indexDataByteOffset /= 2;
+
+    m_Header.indexDataByteSize = indexCount * sizeof(uint16_t);
+    m_Header.indexSize = sizeof(uint16_t);
 }
@@ -0,0 +1,478 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "ModelAssimp.h"
+#include "IndexOptimizePostTransform.h"
+
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include <queue>
+#include <unordered_map>
+#include <map>
+#include <array>
+
+namespace
+{
+    struct Float3
+    {
+        float x, y, z;
+    };
+
+    Float3 Sub(const Float3& a, const Float3& b) { Float3 r = { a.x - b.x, a.y - b.y, a.z - b.z }; return r; }
+    Float3 Cross(const Float3& a, const Float3& b) { Float3 r = { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x }; return r; }
+    double Dot(const Float3& a, const Float3& b) { return (double)a.x * b.x + (double)a.y * b.y + (double)a.z * b.z; }
+
+    // Sum of the squared distances to a set of planes, as a symmetric 4x4 matrix
+    struct Quadric
+    {
+        double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2;
+
+        void AddPlane(double a, double b, double c, double d)
+        {
+            a2 += a * a; ab += a * b; ac += a * c; ad += a * d;
+            b2 += b * b; bc += b * c; bd += b * d;
+            c2 += c * c; cd += c * d;
+            d2 += d * d;
+        }
+
+        void Add(const Quadric& q)
+        {
+            a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad;
+            b2 += q.b2; bc += q.bc; bd += q.bd;
+            c2 += q.c2; cd += q.cd;
+            d2 += q.d2;
+        }
+
+        double Evaluate(const Float3& p) const
+        {
+            double x = p.x, y = p.y, z = p.z;
+            double e = a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x
+                + b2 * y * y + 2 * bc * y * z + 2 * bd * y
+                + c2 * z * z + 2 * cd * z
+                + d2;
+            return e > 0.0 ? e : 0.0;
+        }
+    };
+
+    // Simplifies a triangle list by collapsing edges onto one of their end points, cheapest first by the
+    // quadric error metric (Garland and Heckbert.)  Only existing vertices are kept, so the simplified
+    // triangles index the original vertex data.  Vertices on open or shared edges never move, and UV and
+    // normal seams are open edges of the index topology, so the pieces on either side of a seam cannot crack
+    // apart.  Collapses that would flip a triangle or pinch the surface are skipped.
+    class MeshSimplifier
+    {
+    public:
+        MeshSimplifier(const unsigned char* positions, unsigned int stride, unsigned int vertexCount,
+            const uint32_t* indices, unsigned int indexCount);
+
+        // Collapses edges until at most targetTriangles remain or there is nothing left to collapse.  Returns
+        // the largest error of any collapse so far, as a distance.
+        float Simplify(unsigned int targetTriangles);
+
+        unsigned int GetTriangleCount() const { return m_TriangleCount; }
+        void GetIndices(std::vector<uint32_t>& indices) const;
+
+    private:
+        struct Collapse
+        {
+            double cost;
+            uint32_t from, to;
+            uint32_t fromVersion, toVersion;
+
+            bool operator<(const Collapse& rhs) const { return cost > rhs.cost; }
+        };
+
+        void PushCollapse(uint32_t from, uint32_t to);
+        void PushNeighbors(uint32_t vertex);
+        bool IsValid(uint32_t from, uint32_t to);
+        void ApplyCollapse(uint32_t from, uint32_t to);
+
+        std::vector<Float3> m_Positions;
+        std::vector<uint32_t> m_Indices;
+        std::vector<bool> m_TriangleAlive;
+        unsigned int m_TriangleCount;
+
+        std::vector<std::vector<uint32_t>> m_VertexTriangles;
+        std::vector<Quadric> m_Quadrics;
+        std::vector<bool> m_Locked;
+        std::vector<uint32_t> m_Version;
+
+        std::priority_queue<Collapse> m_Queue;
+        double m_MaxError;
+
+        // Scratch for the validity test
+        std::vector<uint32_t> m_Stamp;
+        uint32_t m_StampValue;
+    };
+
+    MeshSimplifier::MeshSimplifier(const unsigned char* positions, unsigned int stride, unsigned int vertexCount,
+        const uint32_t* indices, unsigned int indexCount)
+        : m_TriangleCount(0), m_MaxError(0.0), m_StampValue(0)
+    {
+        m_Positions.resize(vertexCount);
+        for (unsigned int v = 0; v < vertexCount; v++)
+            memcpy(&m_Positions[v], positions + v * stride, sizeof(Float3));
+
+        m_Quadrics.assign(vertexCount, Quadric());
+        m_Locked.assign(vertexCount, false);
+        m_Version.assign(vertexCount, 0);
+        m_Stamp.assign(vertexCount, 0);
+        m_VertexTriangles.resize(vertexCount);
+
+        // Degenerate triangles are dropped up front
+        for (unsigned int n = 0; n + 2 < indexCount; n += 3)
+        {
+            const uint32_t* tri = indices + n;
+            if (tri[0] == tri[1] || tri[1] == tri[2] || tri[0] == tri[2])
+                continue;
+            m_Indices.insert(m_Indices.end(), tri, tri + 3);
+        }
+        m_TriangleCount = (unsigned int)m_Indices.size() / 3;
+        m_TriangleAlive.assign(m_TriangleCount, true);
+
+        std::unordered_map<uint64_t, uint32_t> edgeUse;
+        for (uint32_t t = 0; t < m_TriangleCount; t++)
+        {
+            const uint32_t* tri = &m_Indices[t * 3];
+            for (int n = 0; n < 3; n++)
+            {
+                m_VertexTriangles[tri[n]].push_back(t);
+
+                uint64_t a = tri[n], b = tri[(n + 1) % 3];
+                edgeUse[a < b ? (a << 32 | b) : (b << 32 | a)]++;
+            }
+
+            Float3 normal = Cross(Sub(m_Positions[tri[1]], m_Positions[tri[0]]), Sub(m_Positions[tri[2]], m_Positions[tri[0]]));
+            double length = sqrt(Dot(normal, normal));
+            if (length == 0.0)
+                continue;
+
+            double a = normal.x / length, b = normal.y / length, c = normal.z / length;
+            double d = -(a * m_Positions[tri[0]].x + b * m_Positions[tri[0]].y + c * m_Positions[tri[0]].z);
+            for (int n = 0; n < 3; n++)
+                m_Quadrics[tri[n]].AddPlane(a, b, c, d);
+        }
+
+        // Edges used by one triangle are on a border or seam, and edges used by more than two are non-manifold
+        for (auto& edge : edgeUse)
+        {
+            if (edge.second != 2)
+            {
+                m_Locked[(size_t)(edge.first >> 32)] = true;
+                m_Locked[(size_t)(edge.first & 0xFFFFFFFF)] = true;
+            }
+        }
+
+        for (uint32_t v = 0; v < vertexCount; v++)
+            PushNeighbors(v);
+    }
+
+    void MeshSimplifier::PushCollapse(uint32_t from, uint32_t to)
+    {
+        if (m_Locked[from])
+            return;
+
+        Quadric q = m_Quadrics[from];
+        q.Add(m_Quadrics[to]);
+
+        Collapse collapse = { q.Evaluate(m_Positions[to]), from, to, m_Version[from], m_Version[to] };
+        m_Queue.push(collapse);
+    }
+
+    void MeshSimplifier::PushNeighbors(uint32_t vertex)
+    {
+        for (uint32_t t : m_VertexTriangles[vertex])
+        {
+            if (!m_TriangleAlive[t])
+                continue;
+
+            const uint32_t* tri = &m_Indices[t * 3];
+            for (int n = 0; n < 3; n++)
+            {
+                if (tri[n] == vertex)
+                    continue;
+                PushCollapse(vertex, tri[n]);
+                PushCollapse(tri[n], vertex);
+            }
+        }
+    }
+
+    bool MeshSimplifier::IsValid(uint32_t from, uint32_t to)
+    {
+        // The neighbors of both end points.  Besides the vertices of the triangles on the edge, they may share
+        // none, or the collapse would pinch the surface into a non-manifold fan.
+        uint32_t stampFrom = ++m_StampValue;
+        uint32_t stampTo = ++m_StampValue;
+        unsigned int sharedTriangles = 0;
+
+        for (uint32_t t : m_VertexTriangles[from])
+        {
+            if (!m_TriangleAlive[t])
+                continue;
+            const uint32_t* tri = &m_Indices[t * 3];
+            if (tri[0] == to || tri[1] == to || tri[2] == to)
+                sharedTriangles++;
+            for (int n = 0; n < 3; n++)
+                m_Stamp[tri[n]] = stampFrom;
+        }
+        if (sharedTriangles == 0)
+            return false;
+
+        unsigned int sharedNeighbors = 0;
+        for (uint32_t t : m_VertexTriangles[to])
+        {
+            if (!m_TriangleAlive[t])
+                continue;
+            const uint32_t* tri = &m_Indices[t * 3];
+            for (int n = 0; n < 3; n++)
+            {
+                if (tri[n] != from && tri[n] != to && m_Stamp[tri[n]] == stampFrom)
+                {
+                    sharedNeighbors++;
+                    m_Stamp[tri[n]] = stampTo;
+                }
+            }
+        }
+        if (sharedNeighbors > sharedTriangles)
+            return false;
+
+        // Triangles that move with the collapse must not flip or become degenerate
+        for (uint32_t t : m_VertexTriangles[from])
+        {
+            if (!m_TriangleAlive[t])
+                continue;
+            const uint32_t* tri = &m_Indices[t * 3];
+            if (tri[0] == to || tri[1] == to || tri[2] == to)
+                continue;
+
+            Float3 p[3], q[3];
+            for (int n = 0; n < 3; n++)
+            {
+                p[n] = m_Positions[tri[n]];
+                q[n] = tri[n] == from ? m_Positions[to] : p[n];
+            }
+
+            Float3 before = Cross(Sub(p[1], p[0]), Sub(p[2], p[0]));
+            Float3 after = Cross(Sub(q[1], q[0]), Sub(q[2], q[0]));
+            double afterLengthSq = Dot(after, after);
+            if (afterLengthSq == 0.0 || Dot(before, after) <= 0.25 * sqrt(Dot(before, before) * afterLengthSq))
+                return false;
+        }
+
+        return true;
+    }
+
+    void MeshSimplifier::ApplyCollapse(uint32_t from, uint32_t to)
+    {
+        std::vector<uint32_t>& toTriangles = m_VertexTriangles[to];
+
+        for (uint32_t t : m_VertexTriangles[from])
+        {
+            if (!m_TriangleAlive[t])
+                continue;
+
+            uint32_t* tri = &m_Indices[t * 3];
+            if (tri[0] == to || tri[1] == to || tri[2] == to)
+            {
+                m_TriangleAlive[t] = false;
+                m_TriangleCount--;
+                continue;
+            }
+
+            for (int n = 0; n < 3; n++)
+            {
+                if (tri[n] == from)
+                    tri[n] = to;
+            }
+            toTriangles.push_back(t);
+        }
+        m_VertexTriangles[from].clear();
+
+        // Keep the list from filling up with collapsed triangles
+        size_t alive = 0;
+        for (size_t n = 0; n < toTriangles.size(); n++)
+        {
+            if (m_TriangleAlive[toTriangles[n]])
+                toTriangles[alive++] = toTriangles[n];
+        }
+        toTriangles.resize(alive);
+
+        m_Quadrics[to].Add(m_Quadrics[from]);
+        m_Version[from]++;
+        m_Version[to]++;
+
+        PushNeighbors(to);
+    }
+
+    float MeshSimplifier::Simplify(unsigned int targetTriangles)
+    {
+        while (m_TriangleCount > targetTriangles && !m_Queue.empty())
+        {
+            Collapse collapse = m_Queue.top();
+            m_Queue.pop();
+
+            // Stale entries were queued before one of their end points changed
+            if (collapse.fromVersion != m_Version[collapse.from] || collapse.toVersion != m_Version[collapse.to])
+                continue;
+            if (!IsValid(collapse.from, collapse.to))
+                continue;
+
+            ApplyCollapse(collapse.from, collapse.to);
+            m_MaxError = collapse.cost > m_MaxError ? collapse.cost : m_MaxError;
+        }
+
+        return (float)sqrt(m_MaxError);
+    }
+
+    void MeshSimplifier::GetIndices(std::vector<uint32_t>& indices) const
+    {
+        indices.clear();
+        for (uint32_t t = 0; t < (uint32_t)m_TriangleAlive.size(); t++)
+        {
+            if (m_TriangleAlive[t])
+                indices.insert(indices.end(), &m_Indices[t * 3], &m_Indices[t * 3] + 3);
+        }
+    }
+}
+
+// Builds the simplified levels of every mesh.  Each level halves the triangles of the one before, and a mesh
+// that cannot be simplified any further repeats its last level.  The levels' indices are appended to both index
+// streams at the same offsets, with the depth-only indices remapped to the depth-only vertex with the same
+// position.
+void AssimpModel::GenerateLODs()
+{
+    enum { lruCacheSize = 64, minTriangles = 16 };
+
+    // Each mesh's levels are built on their own, with offsets into the mesh's own indices until they are
+    // appended in mesh order
+    struct MeshLODs
+    {
+        MeshLOD levels[maxLODs];
+        bool local[maxLODs];
+        std::vector<uint32_t> indices;
+        std::vector<uint32_t> indicesDepth;
+    };
+    std::vector<MeshLODs> meshLODs(m_Header.meshCount);
+
+    ForEachMesh([&](unsigned int meshIndex)
+    {
+        std::vector<uint32_t> simplified;
+        std::vector<uint32_t> optimized;
+        std::vector<uint32_t> depthVertex;
+        std::map<std::array<uint32_t, 3>, uint32_t> positionToDepthVertex;
+
+        const Mesh *mesh = m_pMesh + meshIndex;
+        const unsigned char *positions = m_pVertexData + mesh->vertexDataByteOffset + mesh->attrib[attrib_position].offset;
+        const uint32_t *indices = (uint32_t*)(m_pIndexData + mesh->indexDataByteOffset);
+
+        // Both streams hold bit-identical float positions, and the depth-only stream has one vertex per position
+        const unsigned char *positionsDepth = m_pVertexDataDepth + mesh->vertexDataByteOffsetDepth + mesh->attribDepth[attrib_position].offset;
+        for (uint32_t v = 0; v < mesh->vertexCountDepth; v++)
+        {
+            std::array<uint32_t, 3> key;
+            memcpy(key.data(), positionsDepth + v * mesh->vertexStrideDepth, sizeof(key));
+            positionToDepthVertex.emplace(key, v);
+        }
+        depthVertex.resize(mesh->vertexCount);
+        for (uint32_t v = 0; v < mesh->vertexCount; v++)
+        {
+            std::array<uint32_t, 3> key;
+            memcpy(key.data(), positions + v * mesh->vertexStride, sizeof(key));
+            auto it = positionToDepthVertex.find(key);
+            assert(it != positionToDepthVertex.end());
+            depthVertex[v] = it->second;
+        }
+
+        MeshLODs &lods = meshLODs[meshIndex];
+        lods.levels[0].indexDataByteOffset = mesh->indexDataByteOffset;
+        lods.levels[0].indexCount = mesh->indexCount;
+        lods.levels[0].error = 0.0f;
+        lods.local[0] = false;
+
+        MeshSimplifier simplifier(positions, mesh->vertexStride, mesh->vertexCount, indices, mesh->indexCount);
+
+        for (unsigned int lod = 1; lod < maxLODs; lod++)
+        {
+            const unsigned int previousTriangles = lods.levels[lod - 1].indexCount / 3;
+            const unsigned int targetTriangles = previousTriangles / 2;
+
+            float error = targetTriangles >= minTriangles ? simplifier.Simplify(targetTriangles) : 0.0f;
+
+            // Levels that save less than a quarter of the triangles are not worth switching to
+            if (targetTriangles < minTriangles || simplifier.GetTriangleCount() * 4 > previousTriangles * 3)
+            {
+                lods.levels[lod] = lods.levels[lod - 1];
+                lods.local[lod] = lods.local[lod - 1];
+                continue;
+            }
+
+            simplifier.GetIndices(simplified);
+            optimized.resize(simplified.size());
+            OptimizeFaces<uint32_t>(simplified.data(), (uint32_t)simplified.size(), optimized.data(), lruCacheSize);
+            if (m_OverdrawThreshold > 0.0f)
+            {
+                simplified.swap(optimized);
+                OptimizeOverdraw<uint32_t>(simplified.data(), (uint32_t)simplified.size(), optimized.data(),
+                    (const float*)positions, mesh->vertexStride, fifoCacheSize, m_OverdrawThreshold);
+            }
+
+            lods.levels[lod].indexDataByteOffset = lods.indices.size() * sizeof(uint32_t);
+            lods.levels[lod].indexCount = (uint32_t)optimized.size();
+            lods.levels[lod].error = error;
+            lods.local[lod] = true;
+
+            lods.indices.insert(lods.indices.end(), optimized.begin(), optimized.end());
+            for (uint32_t index : optimized)
+                lods.indicesDepth.push_back(depthVertex[index]);
+        }
+    });
+
+    std::vector<MeshLOD> lods(m_Header.meshCount * maxLODs);
+    std::vector<uint32_t> lodIndices;
+    std::vector<uint32_t> lodIndicesDepth;
+    for (unsigned int meshIndex = 0; meshIndex < m_Header.meshCount; meshIndex++)
+    {
+        const MeshLODs &mesh = meshLODs[meshIndex];
+        const uint64_t baseOffset = m_Header.indexDataByteSize + lodIndices.size() * sizeof(uint32_t);
+        for (unsigned int lod = 0; lod < maxLODs; lod++)
+        {
+            lods[meshIndex * maxLODs + lod] = mesh.levels[lod];
+            if (mesh.local[lod])
+                lods[meshIndex * maxLODs + lod].indexDataByteOffset += baseOffset;
+        }
+        lodIndices.insert(lodIndices.end(), mesh.indices.begin(), mesh.indices.end());
+        lodIndicesDepth.insert(lodIndicesDepth.end(), mesh.indicesDepth.begin(), mesh.indicesDepth.end());
+    }
+
+    // Append the levels to both index streams
+    const size_t lodByteSize = lodIndices.size() * sizeof(uint32_t);
+    const uint64_t indexDataByteSize = m_Header.indexDataByteSize + lodByteSize;
+
+    unsigned char *indexData = new unsigned char [(size_t)indexDataByteSize];
+    unsigned char *indexDataDepth = new unsigned char [(size_t)indexDataByteSize];
+    memcpy(indexData, m_pIndexData, m_Header.indexDataByteSize);
+    memcpy(indexDataDepth, m_pIndexDataDepth, m_Header.indexDataByteSize);
+    if (lodByteSize > 0)
+    {
+        memcpy(indexData + m_Header.indexDataByteSize, lodIndices.data(), lodByteSize);
+        memcpy(indexDataDepth + m_Header.indexDataByteSize, lodIndicesDepth.data(), lodByteSize);
+    }
+
+    delete [] m_pIndexData;
+    delete [] m_pIndexDataDepth;
+    m_pIndexData = indexData;
+    m_pIndexDataDepth = indexDataDepth;
+    m_Header.indexDataByteSize = indexDataByteSize;
+
+    delete [] m_pMeshLOD;
+    m_LODCount = maxLODs;
+    m_pMeshLOD = new MeshLOD [lods.size()];
+    memcpy(m_pMeshLOD, lods.data(), sizeof(MeshLOD) * lods.size());
+}
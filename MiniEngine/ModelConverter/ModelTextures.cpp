@@ -0,0 +1,94 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "ModelAssimp.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <map>
+#include <string>
+#include <utility>
+
+namespace
+{
+    bool FileExists(const std::string &filename)
+    {
+        FILE *file = nullptr;
+        if (0 != fopen_s(&file, filename.c_str(), "rb"))
+            return false;
+        fclose(file);
+        return true;
+    }
+
+    // Finds the first candidate that the texture manager would load, trying its DDS file, the block compressed
+    // copy of that, and its TGA file, in the order the texture manager does.  When none exist, the last
+    // candidate's DDS file is kept, which loads as an invalid texture as it always has.
+    std::string ResolveTexture(const std::string &root, const std::string *candidates, unsigned int candidateCount)
+    {
+        for (unsigned int n = 0; n < candidateCount; n++)
+        {
+            const std::string dds = candidates[n] + ".dds";
+            if (FileExists(root + dds) || FileExists(root + dds + ".zblk"))
+                return dds;
+
+            const std::string tga = candidates[n] + ".tga";
+            if (FileExists(root + tga))
+                return tga;
+        }
+
+        printf("no texture found for %s\n", candidates[0].c_str());
+        return candidates[candidateCount - 1] + ".dds";
+    }
+}
+
+// The fallbacks are those Model::LoadTextures() probes for files without a manifest
+void AssimpModel::ResolveTextures()
+{
+    m_TextureManifest.clear();
+    m_MaterialTextures.assign(m_Header.materialCount * Material::texCount, (uint32_t)textureNone);
+
+    std::map<std::pair<std::string, bool>, uint32_t> textureIndices;
+    unsigned int duplicateCount = 0;
+
+    auto addTexture = [&](const std::string &path, bool sRGB) -> uint32_t
+    {
+        auto found = textureIndices.find(std::make_pair(path, sRGB));
+        if (found != textureIndices.end())
+        {
+            duplicateCount++;
+            return found->second;
+        }
+
+        TextureReference reference = {};
+        strncpy_s(reference.path, path.c_str(), maxTexReferencePath - 1);
+        reference.sRGB = sRGB ? 1 : 0;
+
+        const uint32_t index = (uint32_t)m_TextureManifest.size();
+        m_TextureManifest.push_back(reference);
+        textureIndices[std::make_pair(path, sRGB)] = index;
+        return index;
+    };
+
+    for (unsigned int materialIndex = 0; materialIndex < m_Header.materialCount; materialIndex++)
+    {
+        const Material &material = m_pMaterial[materialIndex];
+        const std::string diffusePath = material.texDiffusePath;
+        uint32_t *textures = &m_MaterialTextures[materialIndex * Material::texCount];
+
+        const std::string diffuse[] = { diffusePath, "default" };
+        const std::string specular[] = { material.texSpecularPath, diffusePath + "_specular", "default_specular" };
+        const std::string normal[] = { material.texNormalPath, diffusePath + "_normal", "default_normal" };
+
+        textures[0] = addTexture(ResolveTexture(m_TextureRoot, diffuse, _countof(diffuse)), true);
+        textures[1] = addTexture(ResolveTexture(m_TextureRoot, specular, _countof(specular)), true);
+        textures[3] = addTexture(ResolveTexture(m_TextureRoot, normal, _countof(normal)), false);
+    }
+
+    printf("textures: %u files, %u duplicate references\n", (unsigned int)m_TextureManifest.size(), duplicateCount);
+}
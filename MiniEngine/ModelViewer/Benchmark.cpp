@@ -0,0 +1,775 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "Benchmark.h"
+#include "Camera.h"
+#include "GraphicsCore.h"
+#include "BufferManager.h"
+#include "CommandContext.h"
+#include "ReadbackBuffer.h"
+#include "GpuMemoryPool.h"
+#include "SystemTime.h"
+#include "EngineTuning.h"
+#include "./DrawStatistics.h"
+#include <DirectXPackedVector.h>
+#include <dxgi1_4.h>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+using namespace Math;
+using namespace Graphics;
+using namespace std;
+
+namespace Benchmark
+{
+    const uint32_t kWarmUpFrames = 120;     // Lets streaming, adaptation and the shadow caches settle
+    const uint32_t kMeasuredFrames = 1000;
+    const uint32_t kNumCaptures = 6;        // Images compared per sweep configuration
+    const uint32_t kSettleFrames = 30;      // Frames a capture point is held for temporal effects to converge
+
+    // The synthetic load of an upload sweep, sized to fit the ring's segment when everything goes there
+    const uint32_t kStressDraws = 8000;
+    const size_t kStressConstantSize = 256;
+    const uint32_t kStressVertices = 4;
+    const char* kStrategyNames[UploadRing::kNumStrategies] = { "Pages", "Ring Constants", "Ring All Dynamic Data" };
+
+    // Each pass is timed by whichever of its scopes ran, since the label of some depends on the settings.  The
+    // sun shadow cost of a sweep sums the passes that render and filter the sun shadows.
+    struct Pass
+    {
+        const char* Name;
+        const wchar_t* Scopes[4];
+        bool SunShadowCost;
+    };
+
+    const Pass kPasses[] =
+    {
+        { "Sun Shadows", { L"Render Shadow Cascades", L"Render Shadow Map" }, true },
+        { "Sun Shadow Filtering", { L"Sun Shadow Moments", L"Sun Shadow Depth Pyramid", L"Sun Shadow Mask",
+            L"Request Shadow Pages" }, true },
+        { "Light Shadows", { L"RenderLightShadows" }, false },
+        { "Z PrePass", { L"Z PrePass" }, false },
+        { "Color", { L"Render Color", L"Render Color (Soft Shadows)" }, true },
+        { "SSAO", { L"Generate SSAO" }, false },
+        { "Post Effects", { L"Post Effects" }, false },
+    };
+    const uint32_t kNumPasses = _countof(kPasses);
+
+    // The report's keys for the counts of each view's draws
+    const char* kDrawCountKeys[DrawStatistics::kNumCounts] = { "meshes", "triangles", "trianglesDrawn" };
+
+    struct Keyframe
+    {
+        Vector3 Eye;
+        Vector3 At;
+    };
+
+    struct Configuration
+    {
+        string Name;
+        function<void(void)> Apply;
+        vector<float> FrameTimes;
+        vector<float> PassTimes[kNumPasses];
+        vector<float> UploadTimes;
+        vector<float> DrawCounts[DrawStatistics::kNumViews][DrawStatistics::kNumCounts];
+        bool ViewDrawn[DrawStatistics::kNumViews];
+        uint64_t PeakVideoMemory;
+        double SquaredError;
+        uint64_t NumErrorSamples;
+    };
+
+    bool s_Running = false;
+    bool s_Sweep = false;
+    bool s_UploadSweep = false;
+    bool s_TuningSweep = false;
+    string s_TuningPath;
+    bool s_Finished = false;
+    uint32_t s_FrameIndex = 0;
+    wstring s_PathFile;
+    vector<Keyframe> s_Keyframes;
+
+    vector<Configuration> s_Configurations;
+    uint32_t s_CurrentConfig = 0;
+
+    // The reference images are kept in the packed format of the scene color buffer
+    ReadbackBuffer s_Readback;
+    vector<vector<uint32_t>> s_ReferenceImages;
+
+    bool LoadKeyframes( const wstring& FileName )
+    {
+        ifstream File(FileName);
+        if (!File)
+            return false;
+
+        string Line;
+        while (getline(File, Line))
+        {
+            if (Line.empty() || Line[0] == '#')
+                continue;
+
+            float e[3], a[3];
+            istringstream Values(Line);
+            if (Values >> e[0] >> e[1] >> e[2] >> a[0] >> a[1] >> a[2])
+                s_Keyframes.push_back({ Vector3(e[0], e[1], e[2]), Vector3(a[0], a[1], a[2]) });
+        }
+        return s_Keyframes.size() >= 2;
+    }
+
+    // Flies from the camera's starting point to the far side of the scene, panning across it on the way
+    void CreateDefaultKeyframes( const Vector3& SceneMin, const Vector3& SceneMax )
+    {
+        const Vector3 Center = (SceneMin + SceneMax) * 0.5f;
+        const float Radius = Length(SceneMax - SceneMin) * 0.5f;
+        const float Pan[4] = { 0.0f, 0.25f, -0.25f, 0.0f };
+
+        s_Keyframes.clear();
+        for (uint32_t i = 0; i < 4; ++i)
+        {
+            const Vector3 Eye = Center + Vector3(Radius * (0.5f - i / 3.0f), 0.0f, 0.0f);
+            s_Keyframes.push_back({ Eye, Eye + Vector3(-0.5f * Radius, 0.0f, Pan[i] * Radius) });
+        }
+    }
+
+    Vector3 CatmullRom( Vector3 p0, Vector3 p1, Vector3 p2, Vector3 p3, float t )
+    {
+        const float t2 = t * t;
+        const float t3 = t2 * t;
+        return 0.5f * (p1 * 2.0f + (p2 - p0) * t + (p0 * 2.0f - p1 * 5.0f + p2 * 4.0f - p3) * t2 +
+            (p1 * 3.0f - p0 - p2 * 3.0f + p3) * t3);
+    }
+
+    // T runs from 0 at the first keyframe to 1 at the last, and the end keyframes are repeated to complete the
+    // outer segments
+    Keyframe Evaluate( float T )
+    {
+        const uint32_t NumSegments = (uint32_t)s_Keyframes.size() - 1;
+        const float Position = T * NumSegments;
+        const uint32_t Segment = min((uint32_t)Position, NumSegments - 1);
+        const float t = Position - Segment;
+
+        const Keyframe& k0 = s_Keyframes[Segment == 0 ? 0 : Segment - 1];
+        const Keyframe& k1 = s_Keyframes[Segment];
+        const Keyframe& k2 = s_Keyframes[Segment + 1];
+        const Keyframe& k3 = s_Keyframes[min(Segment + 2, NumSegments)];
+
+        Keyframe Result = { CatmullRom(k0.Eye, k1.Eye, k2.Eye, k3.Eye, t), CatmullRom(k0.At, k1.At, k2.At, k3.At, t) };
+        return Result;
+    }
+
+    void AddConfigurationInternal( const string& Name, const function<void(void)>& Apply )
+    {
+        s_Configurations.emplace_back();
+        Configuration& Config = s_Configurations.back();
+        Config.Name = Name;
+        Config.Apply = Apply;
+        Config.FrameTimes.reserve(kMeasuredFrames);
+        for (auto& Times : Config.PassTimes)
+            Times.reserve(kMeasuredFrames);
+        Config.UploadTimes.reserve(kMeasuredFrames);
+        for (uint32_t View = 0; View < DrawStatistics::kNumViews; ++View)
+        {
+            for (auto& Counts : Config.DrawCounts[View])
+                Counts.reserve(kMeasuredFrames);
+            Config.ViewDrawn[View] = false;
+        }
+        Config.PeakVideoMemory = 0;
+        Config.SquaredError = 0.0;
+        Config.NumErrorSamples = 0;
+    }
+
+    void RecordFrame( Configuration& Config )
+    {
+        Config.FrameTimes.push_back(GetFrameTime() * 1000.0f);
+
+        for (uint32_t i = 0; i < kNumPasses; ++i)
+        {
+            float PassTime = 0.0f;
+            for (const wchar_t* Scope : kPasses[i].Scopes)
+            {
+                float CpuTime, GpuTime;
+                if (Scope != nullptr && EngineProfiling::GetScopeTimes(Scope, CpuTime, GpuTime))
+                    PassTime += GpuTime;
+            }
+            Config.PassTimes[i].push_back(PassTime);
+        }
+
+        // The draw counts arrive a few frames late, and views that have not drawn yet count zero
+        for (uint32_t View = 0; View < DrawStatistics::kNumViews; ++View)
+        {
+            uint64_t Counts[DrawStatistics::kNumCounts];
+            const bool Drawn = DrawStatistics::GetCounts(View, Counts);
+            Config.ViewDrawn[View] = Config.ViewDrawn[View] || Drawn;
+            for (uint32_t Count = 0; Count < DrawStatistics::kNumCounts; ++Count)
+                Config.DrawCounts[View][Count].push_back(Drawn ? (float)Counts[Count] : 0.0f);
+        }
+
+        Config.PeakVideoMemory = max(Config.PeakVideoMemory, GpuMemoryPool::GetVideoMemoryUsage());
+    }
+
+    // Uploads each draw's constants and vertices the way the scene's many small draws would.  Only the CPU time of
+    // the uploads is returned, since submitting the context costs the same under every strategy.
+    float RecordUploadStress( void )
+    {
+        __declspec(align(16)) static const float Constants[kStressConstantSize / sizeof(float)] = {};
+        __declspec(align(16)) static const XMFLOAT4 Vertices[kStressVertices] = {};
+
+        GraphicsContext& Context = GraphicsContext::Begin(L"Upload Stress");
+
+        const int64_t StartTick = SystemTime::GetCurrentTick();
+        for (uint32_t i = 0; i < kStressDraws; ++i)
+        {
+            Context.UploadDynamicConstants(kStressConstantSize, Constants);
+            Context.SetDynamicVB(0, kStressVertices, sizeof(XMFLOAT4), Vertices);
+        }
+        const int64_t EndTick = SystemTime::GetCurrentTick();
+
+        Context.Finish();
+        return (float)(SystemTime::TimeBetweenTicks(StartTick, EndTick) * 1000.0);
+    }
+
+    // Reads back the last frame's final image.  The reference configuration keeps it, and every other one adds
+    // its squared difference from the reference image of the same capture point.
+    void CaptureImage( Configuration& Config, uint32_t CaptureIndex )
+    {
+        if (g_SceneColorBuffer.GetFormat() != DXGI_FORMAT_R11G11B10_FLOAT)
+        {
+            Utility::Printf("The sweep compares R11G11B10_FLOAT scene color only, so no images are captured\n");
+            return;
+        }
+
+        const uint32_t Width = (uint32_t)g_SceneColorBuffer.GetWidth();
+        const uint32_t Height = (uint32_t)g_SceneColorBuffer.GetHeight();
+
+        D3D12_PLACED_SUBRESOURCE_FOOTPRINT Footprint;
+        UINT64 TotalBytes;
+        g_Device->GetCopyableFootprints(&g_SceneColorBuffer.GetResource()->GetDesc(), 0, 1, 0, &Footprint,
+            nullptr, nullptr, &TotalBytes);
+        if (s_Readback.GetBufferSize() < TotalBytes)
+            s_Readback.Create(L"Benchmark Readback", (uint32_t)(TotalBytes / 4), 4);
+
+        CommandContext::ReadbackTexture2D(s_Readback, g_SceneColorBuffer);
+
+        vector<uint32_t> Image(Width * Height);
+        const uint8_t* Rows = (const uint8_t*)s_Readback.Map();
+        for (uint32_t y = 0; y < Height; ++y)
+            memcpy(&Image[y * Width], Rows + y * Footprint.Footprint.RowPitch, Width * 4);
+        s_Readback.Unmap();
+
+        if (s_CurrentConfig == 0)
+        {
+            s_ReferenceImages.push_back(move(Image));
+            return;
+        }
+
+        if (CaptureIndex >= s_ReferenceImages.size() || s_ReferenceImages[CaptureIndex].size() != Image.size())
+            return;
+
+        using namespace DirectX::PackedVector;
+
+        const vector<uint32_t>& Reference = s_ReferenceImages[CaptureIndex];
+        double SquaredError = 0.0;
+        for (size_t i = 0; i < Image.size(); ++i)
+        {
+            const XMFLOAT3PK Texel(Image[i]);
+            const XMFLOAT3PK ReferenceTexel(Reference[i]);
+            const XMVECTOR Delta = XMVectorSubtract(XMLoadFloat3PK(&Texel), XMLoadFloat3PK(&ReferenceTexel));
+            SquaredError += XMVectorGetX(XMVector3Dot(Delta, Delta));
+        }
+        Config.SquaredError += SquaredError;
+        Config.NumErrorSamples += Image.size() * 3;
+    }
+
+    float Average( const vector<float>& Samples )
+    {
+        float Sum = 0.0f;
+        for (float Sample : Samples)
+            Sum += Sample;
+        return Samples.empty() ? 0.0f : Sum / Samples.size();
+    }
+
+    float GetSunShadowCost( const Configuration& Config )
+    {
+        float Cost = 0.0f;
+        for (uint32_t i = 0; i < kNumPasses; ++i)
+        {
+            if (kPasses[i].SunShadowCost)
+                Cost += Average(Config.PassTimes[i]);
+        }
+        return Cost;
+    }
+
+    float GetRMSE( const Configuration& Config )
+    {
+        return Config.NumErrorSamples == 0 ? 0.0f : (float)sqrt(Config.SquaredError / Config.NumErrorSamples);
+    }
+
+    // Nearest rank percentiles of the samples
+    void WriteStatistics( ofstream& File, vector<float> Samples )
+    {
+        if (Samples.empty())
+        {
+            File << "null";
+            return;
+        }
+
+        sort(Samples.begin(), Samples.end());
+        auto Percentile = [&]( float p ) { return Samples[min((size_t)(p * Samples.size()), Samples.size() - 1)]; };
+
+        File << "{ \"avg\": " << Average(Samples) << ", \"p50\": " << Percentile(0.5f) <<
+            ", \"p95\": " << Percentile(0.95f) << ", \"p99\": " << Percentile(0.99f) <<
+            ", \"max\": " << Samples.back() << " }";
+    }
+
+    // The GPU and driver the results were measured on, which regression checks only compare like with like
+    void WriteAdapter( ofstream& File )
+    {
+        Microsoft::WRL::ComPtr<IDXGIFactory4> Factory;
+        Microsoft::WRL::ComPtr<IDXGIAdapter> Adapter;
+        DXGI_ADAPTER_DESC Desc = {};
+        LARGE_INTEGER DriverVersion = {};
+        if (SUCCEEDED(CreateDXGIFactory2(0, MY_IID_PPV_ARGS(&Factory))) &&
+            SUCCEEDED(Factory->EnumAdapterByLuid(g_Device->GetAdapterLuid(), MY_IID_PPV_ARGS(&Adapter))))
+        {
+            Adapter->GetDesc(&Desc);
+            Adapter->CheckInterfaceSupport(__uuidof(IDXGIDevice), &DriverVersion);
+        }
+
+        File << "{ \"name\": \"";
+        for (const wchar_t* Char = Desc.Description; *Char != L'\0'; ++Char)
+        {
+            if (*Char >= L' ' && *Char < 0x80 && *Char != L'"' && *Char != L'\\')
+                File << (char)*Char;
+        }
+        File << "\", \"vendorId\": " << Desc.VendorId << ", \"deviceId\": " << Desc.DeviceId <<
+            ", \"driver\": \"" << HIWORD(DriverVersion.HighPart) << '.' << LOWORD(DriverVersion.HighPart) << '.' <<
+            HIWORD(DriverVersion.LowPart) << '.' << LOWORD(DriverVersion.LowPart) << "\" }";
+    }
+
+    void WriteFrames( const Configuration& Config )
+    {
+        ofstream Frames("BenchmarkFrames.csv", ios::out);
+        if (!Frames)
+        {
+            Utility::Printf("Unable to write BenchmarkFrames.csv\n");
+            return;
+        }
+        Frames.precision(3);
+        Frames << fixed << "Frame,Frame Time";
+        for (const Pass& P : kPasses)
+            Frames << ',' << P.Name;
+        for (uint32_t View = 0; View < DrawStatistics::kNumViews; ++View)
+        {
+            for (uint32_t Count = 0; Config.ViewDrawn[View] && Count < DrawStatistics::kNumCounts; ++Count)
+                Frames << ',' << DrawStatistics::GetViewName(View) << ' ' << DrawStatistics::GetCountName(Count);
+        }
+        Frames << '\n';
+        for (size_t f = 0; f < Config.FrameTimes.size(); ++f)
+        {
+            Frames << f << ',' << Config.FrameTimes[f];
+            for (uint32_t i = 0; i < kNumPasses; ++i)
+                Frames << ',' << Config.PassTimes[i][f];
+            for (uint32_t View = 0; View < DrawStatistics::kNumViews; ++View)
+            {
+                for (uint32_t Count = 0; Config.ViewDrawn[View] && Count < DrawStatistics::kNumCounts; ++Count)
+                    Frames << ',' << (uint64_t)Config.DrawCounts[View][Count][f];
+            }
+            Frames << '\n';
+        }
+    }
+
+    // One row per configuration from the cheapest to the most expensive
+    void WriteSweepTable( void )
+    {
+        ofstream Table("ShadowSweep.csv", ios::out);
+        if (!Table)
+        {
+            Utility::Printf("Unable to write ShadowSweep.csv\n");
+            return;
+        }
+
+        vector<uint32_t> Order(s_Configurations.size());
+        for (uint32_t i = 0; i < Order.size(); ++i)
+            Order[i] = i;
+        sort(Order.begin(), Order.end(), []( uint32_t a, uint32_t b )
+            { return GetSunShadowCost(s_Configurations[a]) < GetSunShadowCost(s_Configurations[b]); });
+
+        Table.precision(4);
+        Table << fixed << "Configuration,Sun Shadow Cost (ms),RMSE,Pareto Optimal\n";
+        for (uint32_t i : Order)
+        {
+            const float Cost = GetSunShadowCost(s_Configurations[i]);
+            const float Error = GetRMSE(s_Configurations[i]);
+
+            bool Dominated = false;
+            for (uint32_t j = 0; j < s_Configurations.size() && !Dominated; ++j)
+            {
+                const float OtherCost = GetSunShadowCost(s_Configurations[j]);
+                const float OtherError = GetRMSE(s_Configurations[j]);
+                Dominated = j != i && OtherCost <= Cost && OtherError <= Error && (OtherCost < Cost || OtherError < Error);
+            }
+
+            Table << s_Configurations[i].Name << (i == 0 ? " (reference)" : "") << ',' << Cost << ',' << Error <<
+                ',' << (Dominated ? "no" : "yes") << '\n';
+        }
+    }
+
+    // One row per strategy, in the order they were run
+    void WriteUploadTable( void )
+    {
+        ofstream Table("UploadSweep.csv", ios::out);
+        if (!Table)
+        {
+            Utility::Printf("Unable to write UploadSweep.csv\n");
+            return;
+        }
+
+        Table.precision(4);
+        Table << fixed << "Configuration,Upload CPU Time (ms),Frame Time (ms),Upload Time per Draw (us)\n";
+        for (const Configuration& Config : s_Configurations)
+        {
+            const float UploadTime = Average(Config.UploadTimes);
+            Table << Config.Name << ',' << UploadTime << ',' << Average(Config.FrameTimes) << ',' <<
+                UploadTime * 1000.0f / kStressDraws << '\n';
+        }
+    }
+
+    // One row per value, in the order they were run, which plots the cost of the variable
+    void WriteTuningTable( void )
+    {
+        ofstream Table("TuningSweep.csv", ios::out);
+        if (!Table)
+        {
+            Utility::Printf("Unable to write TuningSweep.csv\n");
+            return;
+        }
+
+        Table.precision(4);
+        Table << fixed << s_TuningPath << ",Frame Time (ms),Frame Time p95 (ms)";
+        for (const Pass& P : kPasses)
+            Table << ',' << P.Name << " (ms)";
+        Table << ",Peak Video Memory (MB)\n";
+
+        for (const Configuration& Config : s_Configurations)
+        {
+            vector<float> Sorted = Config.FrameTimes;
+            sort(Sorted.begin(), Sorted.end());
+            const float P95 = Sorted.empty() ? 0.0f : Sorted[min((size_t)(0.95f * Sorted.size()), Sorted.size() - 1)];
+
+            Table << Config.Name.substr(s_TuningPath.size() + 3) << ',' << Average(Config.FrameTimes) << ',' << P95;
+            for (uint32_t i = 0; i < kNumPasses; ++i)
+                Table << ',' << Average(Config.PassTimes[i]);
+            Table << ',' << (Config.PeakVideoMemory >> 20) << '\n';
+        }
+    }
+
+    // Reads -tunesweep "<path>" followed by <first> <last> <step> or a comma separated list into one configuration
+    // per value
+    bool AddTuningConfigurations( const wchar_t* Arg )
+    {
+        Arg += wcslen(L"-tunesweep");
+        while (*Arg == L' ')
+            ++Arg;
+
+        if (*Arg == L'"')
+        {
+            for (++Arg; *Arg != L'\0' && *Arg != L'"'; ++Arg)
+                s_TuningPath += (char)*Arg;
+            if (*Arg == L'"')
+                ++Arg;
+        }
+        else
+        {
+            for (; *Arg != L'\0' && *Arg != L' '; ++Arg)
+                s_TuningPath += (char)*Arg;
+        }
+
+        if (EngineTuning::FindVariable(s_TuningPath) == nullptr)
+        {
+            Utility::Printf("-tunesweep:  there is no tuning variable named %s\n", s_TuningPath.c_str());
+            return false;
+        }
+
+        while (*Arg == L' ')
+            ++Arg;
+        // The values end at the next option, so that negative values still parse
+        string Values;
+        for (; *Arg != L'\0' && !(Arg[0] == L'-' && iswalpha(Arg[1])); ++Arg)
+            Values += (char)*Arg;
+
+        vector<string> Settings;
+        float First, Last, Step;
+        if (Values.find(',') == string::npos && sscanf_s(Values.c_str(), "%f %f %f", &First, &Last, &Step) == 3 && Step > 0.0f)
+        {
+            // Count the steps rather than accumulate them, which would drift
+            const uint32_t NumSteps = (uint32_t)floor((Last - First) / Step + 0.001f);
+            for (uint32_t i = 0; i <= NumSteps; ++i)
+            {
+                char Value[32];
+                sprintf_s(Value, "%g", First + i * Step);
+                Settings.push_back(Value);
+            }
+        }
+        else
+        {
+            istringstream List(Values);
+            string Value;
+            while (getline(List, Value, ','))
+            {
+                const size_t Start = Value.find_first_not_of(' ');
+                if (Start != string::npos)
+                    Settings.push_back(Value.substr(Start, Value.find_last_not_of(' ') - Start + 1));
+            }
+        }
+
+        if (Settings.empty())
+        {
+            Utility::Printf("-tunesweep:  expected <first> <last> <step> or a comma separated list of values\n");
+            return false;
+        }
+
+        const string Path = s_TuningPath;
+        for (const string& Value : Settings)
+        {
+            AddConfigurationInternal(Path + " = " + Value, [=]()
+            {
+                if (!EngineTuning::SetVariable(Path, Value))
+                    Utility::Printf("-tunesweep:  %s does not take the value %s\n", Path.c_str(), Value.c_str());
+            });
+        }
+        return true;
+    }
+
+    void WriteReport( void )
+    {
+        ofstream Report("BenchmarkReport.json", ios::out);
+        if (!Report)
+        {
+            Utility::Printf("Unable to write BenchmarkReport.json\n");
+            return;
+        }
+        Report.precision(4);
+        Report << fixed << "{\n  \"frames\": " << kMeasuredFrames << ",\n  \"warmUpFrames\": " << kWarmUpFrames <<
+            ",\n  \"resolution\": [" << g_DisplayWidth << ", " << g_DisplayHeight << "]" << ",\n  \"adapter\": ";
+        WriteAdapter(Report);
+        Report << ",\n  \"configurations\": [";
+        for (size_t c = 0; c < s_Configurations.size(); ++c)
+        {
+            const Configuration& Config = s_Configurations[c];
+            Report << (c == 0 ? "\n" : ",\n") << "    {\n      \"name\": \"" << Config.Name << "\",\n      \"frameTimeMs\": ";
+            WriteStatistics(Report, Config.FrameTimes);
+            Report << ",\n      \"gpuPassTimeMs\": {";
+            for (uint32_t i = 0; i < kNumPasses; ++i)
+            {
+                Report << (i == 0 ? "\n" : ",\n") << "        \"" << kPasses[i].Name << "\": ";
+                WriteStatistics(Report, Config.PassTimes[i]);
+            }
+            Report << "\n      },\n      \"drawStatistics\": {";
+            bool FirstView = true;
+            for (uint32_t View = 0; View < DrawStatistics::kNumViews; ++View)
+            {
+                if (!Config.ViewDrawn[View])
+                    continue;
+
+                Report << (FirstView ? "\n" : ",\n") << "        \"" << DrawStatistics::GetViewName(View) << "\": {";
+                for (uint32_t Count = 0; Count < DrawStatistics::kNumCounts; ++Count)
+                {
+                    Report << (Count == 0 ? "\n" : ",\n") << "          \"" << kDrawCountKeys[Count] << "\": ";
+                    WriteStatistics(Report, Config.DrawCounts[View][Count]);
+                }
+                Report << "\n        }";
+                FirstView = false;
+            }
+            Report << "\n      },\n      \"peakVideoMemoryMB\": " << (Config.PeakVideoMemory >> 20);
+            if (s_Sweep)
+                Report << ",\n      \"sunShadowCostMs\": " << GetSunShadowCost(Config) << ",\n      \"rmse\": " << GetRMSE(Config);
+            if (s_UploadSweep)
+            {
+                Report << ",\n      \"uploadCpuTimeMs\": ";
+                WriteStatistics(Report, Config.UploadTimes);
+            }
+            Report << "\n    }";
+        }
+        Report << "\n  ]\n}\n";
+
+        const char* TableName = "BenchmarkFrames.csv";
+        if (s_Sweep)
+        {
+            WriteSweepTable();
+            TableName = "ShadowSweep.csv";
+        }
+        else if (s_UploadSweep)
+        {
+            WriteUploadTable();
+            TableName = "UploadSweep.csv";
+        }
+        else if (s_TuningSweep)
+        {
+            WriteTuningTable();
+            TableName = "TuningSweep.csv";
+        }
+        else
+        {
+            WriteFrames(s_Configurations[0]);
+        }
+
+        Utility::Printf("Benchmark finished, wrote BenchmarkReport.json and %s\n", TableName);
+    }
+}
+
+bool Benchmark::Initialize( const Vector3& SceneMin, const Vector3& SceneMax )
+{
+#if WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_DESKTOP)
+    const wchar_t* CommandLine = GetCommandLineW();
+    const wchar_t* Arg = wcsstr(CommandLine, L"-benchmark");
+    if (Arg == nullptr)
+        return false;
+
+    // The camera path is the next argument, unless that is another option
+    Arg += wcslen(L"-benchmark");
+    while (*Arg == L' ')
+        ++Arg;
+    if (*Arg == L'"')
+    {
+        for (++Arg; *Arg != L'\0' && *Arg != L'"'; ++Arg)
+            s_PathFile += *Arg;
+    }
+    else if (*Arg != L'-')
+    {
+        for (; *Arg != L'\0' && *Arg != L' '; ++Arg)
+            s_PathFile += *Arg;
+    }
+
+    if (s_PathFile.empty())
+    {
+        CreateDefaultKeyframes(SceneMin, SceneMax);
+    }
+    else if (!LoadKeyframes(s_PathFile))
+    {
+        Utility::Printf(L"Unable to read two or more keyframes from %s, using the default camera path\n", s_PathFile.c_str());
+        CreateDefaultKeyframes(SceneMin, SceneMax);
+    }
+
+    s_Sweep = wcsstr(CommandLine, L"-shadowsweep") != nullptr;
+    s_UploadSweep = !s_Sweep && wcsstr(CommandLine, L"-uploadsweep") != nullptr;
+    const wchar_t* TuningArg = s_Sweep || s_UploadSweep ? nullptr : wcsstr(CommandLine, L"-tunesweep");
+    if (TuningArg != nullptr)
+    {
+        s_TuningSweep = AddTuningConfigurations(TuningArg);
+        if (!s_TuningSweep)
+            s_Configurations.clear();
+    }
+
+    if (s_UploadSweep)
+    {
+        for (int32_t i = 0; i < UploadRing::kNumStrategies; ++i)
+        {
+            const UploadRing::Strategy NewStrategy = (UploadRing::Strategy)i;
+            AddConfigurationInternal(kStrategyNames[i], [=]() { UploadRing::SetStrategy(NewStrategy); });
+        }
+    }
+    else if (!s_Sweep && !s_TuningSweep)
+    {
+        AddConfigurationInternal("Default", nullptr);
+    }
+
+    s_Running = true;
+    Utility::Printf("Benchmarking %u frames after %u warm-up frames\n", kMeasuredFrames, kWarmUpFrames);
+    return true;
+#else
+    (void)SceneMin;
+    (void)SceneMax;
+    return false;
+#endif
+}
+
+bool Benchmark::IsRunning( void )
+{
+    return s_Running;
+}
+
+bool Benchmark::IsSweep( void )
+{
+    return s_Sweep;
+}
+
+void Benchmark::AddConfiguration( const string& Name, const function<void(void)>& Apply )
+{
+    ASSERT(s_Sweep && s_FrameIndex == 0 && s_CurrentConfig == 0);
+    AddConfigurationInternal(Name, Apply);
+}
+
+bool Benchmark::IsFinished( void )
+{
+    return s_Finished;
+}
+
+void Benchmark::Update( BaseCamera& Camera )
+{
+    if (!s_Running || s_Configurations.empty())
+        return;
+
+    // The frame before this one is the first to be measured once the warm-up frames are over
+    if (s_FrameIndex > kWarmUpFrames && s_FrameIndex <= kWarmUpFrames + kMeasuredFrames)
+        RecordFrame(s_Configurations[s_CurrentConfig]);
+
+    // The load runs through the warm-up frames as well, so that the pages and the ring have settled
+    if (s_UploadSweep && s_FrameIndex < kWarmUpFrames + kMeasuredFrames)
+    {
+        const float UploadTime = RecordUploadStress();
+        if (s_FrameIndex >= kWarmUpFrames)
+            s_Configurations[s_CurrentConfig].UploadTimes.push_back(UploadTime);
+    }
+
+    float T;
+    if (s_FrameIndex < kWarmUpFrames + kMeasuredFrames)
+    {
+        T = s_FrameIndex < kWarmUpFrames ? 0.0f : (float)(s_FrameIndex - kWarmUpFrames) / (kMeasuredFrames - 1);
+    }
+    else
+    {
+        // A sweep holds the camera at each capture point until the last frame there is done
+        const uint32_t CaptureFrame = s_FrameIndex - kWarmUpFrames - kMeasuredFrames;
+        const uint32_t Capture = CaptureFrame / kSettleFrames;
+        if (CaptureFrame > 0 && CaptureFrame % kSettleFrames == 0)
+            CaptureImage(s_Configurations[s_CurrentConfig], Capture - 1);
+
+        if (!s_Sweep || Capture == kNumCaptures)
+        {
+            if (++s_CurrentConfig == s_Configurations.size())
+            {
+                WriteReport();
+                s_Readback.Destroy();
+                s_Running = false;
+                s_Finished = true;
+                return;
+            }
+            s_FrameIndex = 0;
+            T = 0.0f;
+        }
+        else
+        {
+            T = (Capture + 0.5f) / kNumCaptures;
+        }
+    }
+
+    if (s_FrameIndex == 0 && s_Configurations[s_CurrentConfig].Apply)
+    {
+        Utility::Printf("Benchmarking %s\n", s_Configurations[s_CurrentConfig].Name.c_str());
+        s_Configurations[s_CurrentConfig].Apply();
+    }
+
+    const Keyframe View = Evaluate(min(T, 1.0f));
+    Camera.SetEyeAtUp(View.Eye, View.At, Vector3(kYUnitVector));
+    Camera.Update();
+
+    ++s_FrameIndex;
+}
@@ -0,0 +1,58 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#pragma once
+
+#include <functional>
+#include <string>
+
+namespace Math
+{
+    class Vector3;
+    class BaseCamera;
+}
+
+// A repeatable performance run, started with -benchmark [CameraPath.txt] on the command line.  The camera flies a
+// Catmull-Rom spline through the keyframes of the file, one "EyeX EyeY EyeZ AtX AtY AtZ" per line, or across the
+// scene when there is no file.  The spline is stepped once per frame rather than by elapsed time, so every run
+// renders the same frames.  After the warm-up frames, the frame time, the GPU time of each pass and the draw
+// statistics of each view are recorded, and at the end BenchmarkReport.json summarizes them and BenchmarkFrames.csv
+// lists every frame.  Pass times come from the profiler scopes, which release builds compile out.  The report names the GPU and driver, so that
+// Tools/Scripts/BenchmarkRegression.py can compare it with earlier runs on the same ones.
+//
+// Adding -shadowsweep repeats the run for each configuration the application adds.  After its timed frames, each
+// configuration holds the camera still at a few points of the path and reads back the final image, which is
+// compared with the images of the first configuration, the reference.  ShadowSweep.csv then lists the sun shadow
+// cost and the RMSE of every configuration and marks the ones no other is both cheaper and closer than.
+//
+// Adding -uploadsweep instead repeats the run for each dynamic upload strategy of the command contexts.  Every
+// frame also records a context of many small draws' worth of dynamic constants and vertices, and UploadSweep.csv
+// lists the CPU time spent allocating and copying them under each strategy.
+//
+// Adding -tunesweep "<EngineTuning path>" <first> <last> <step>, or a comma separated list of values in place of
+// the range, instead repeats the run for each value of the variable.  TuningSweep.csv then lists the frame and
+// pass times against the value, to choose defaults from.  Other variables can be fixed for every run with -tune.
+namespace Benchmark
+{
+    // Returns whether the command line asks for a benchmark.  The bounds place the default camera path.
+    bool Initialize( const Math::Vector3& SceneMin, const Math::Vector3& SceneMax );
+
+    bool IsRunning( void );
+    bool IsSweep( void );
+
+    // Apply is called before the configuration's first frame and must set every option that any configuration
+    // changes.  Only call this while the sweep has not started.
+    void AddConfiguration( const std::string& Name, const std::function<void(void)>& Apply );
+
+    // Set once the report has been written and the application should exit
+    bool IsFinished( void );
+
+    // Records the times of the last frame and moves the camera to where this frame sees the scene from
+    void Update( Math::BaseCamera& Camera );
+}
@@ -0,0 +1,188 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "CascadedShadows.h"
+#include "PipelineState.h"
+#include "RootSignature.h"
+#include "CommandContext.h"
+#include "Camera.h"
+#include "CascadedShadowCamera.h"
+#include "BufferManager.h"
+#include "DynamicResolution.h"
+
+#include "CompiledShaders/SDSMDepthBoundsCS.h"
+#include "CompiledShaders/SDSMLightBoundsCS.h"
+#include "CompiledShaders/SDSMSetupCascadesCS.h"
+
+using namespace Math;
+using namespace Graphics;
+
+// must keep in sync with HLSL
+__declspec(align(16)) struct CascadeData
+{
+    Matrix4 ViewProj;
+    Matrix4 ShadowMatrix;
+    float SplitDistance;
+    float WrapOffset[2];
+    float Scrolling;
+    float Pad[28];
+};
+
+enum { kReductionBufferSize = 256 };
+
+namespace CascadedShadows
+{
+    BoolVar FitToDepthBuffer("Application/Lighting/Cascades/Fit To Depth Buffer", true);
+
+    RootSignature m_SDSMRootSig;
+    ComputePSO m_DepthBoundsCS;
+    ComputePSO m_LightBoundsCS;
+    ComputePSO m_SetupCascadesCS;
+
+    StructuredBuffer m_CascadeBuffer;
+    ByteAddressBuffer m_ReductionBuffer;
+}
+
+void CascadedShadows::InitializeResources( void )
+{
+    static_assert(sizeof(CascadeData) == kCascadeStride, "Cascades must be bindable as constant buffers");
+
+    m_SDSMRootSig.Reset(3, 0);
+    m_SDSMRootSig[0].InitAsConstantBuffer(0);
+    m_SDSMRootSig[1].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 0, 1);
+    m_SDSMRootSig[2].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 0, 2);
+    m_SDSMRootSig.Finalize(L"SDSM");
+
+#define CreatePSO( ObjName, ShaderByteCode ) \
+    ObjName.SetRootSignature(m_SDSMRootSig); \
+    ObjName.SetComputeShader(ShaderByteCode, sizeof(ShaderByteCode) ); \
+    ObjName.Finalize();
+
+    CreatePSO(m_DepthBoundsCS, g_pSDSMDepthBoundsCS);
+    CreatePSO(m_LightBoundsCS, g_pSDSMLightBoundsCS);
+    CreatePSO(m_SetupCascadesCS, g_pSDSMSetupCascadesCS);
+
+#undef CreatePSO
+
+    m_CascadeBuffer.Create(L"Cascade Buffer", GameCore::CascadedShadowCamera::kMaxCascades, sizeof(CascadeData));
+
+    // Min slots start at ~0 and max slots at 0.  The cascade setup pass restores this state every frame.
+    // The first 8 words hold the depth range and each cascade's bounds occupy the next 8 words.
+    uint32_t InitialReduction[kReductionBufferSize / 4] = { 0xFFFFFFFF, 0 };
+    for (uint32_t i = 8; i < kReductionBufferSize / 4; ++i)
+        InitialReduction[i] = (i & 7) < 3 ? 0xFFFFFFFF : 0;
+    m_ReductionBuffer.Create(L"SDSM Reduction Buffer", kReductionBufferSize / 4, 4, InitialReduction);
+}
+
+void CascadedShadows::Shutdown( void )
+{
+    m_CascadeBuffer.Destroy();
+    m_ReductionBuffer.Destroy();
+}
+
+void CascadedShadows::UploadCascades( GraphicsContext& gfxContext, const GameCore::CascadedShadowCamera& cascades )
+{
+    CascadeData Data[GameCore::CascadedShadowCamera::kMaxCascades];
+    for (uint32_t i = 0; i < cascades.GetNumCascades(); ++i)
+    {
+        Data[i].ViewProj = cascades.GetCascade(i).GetViewProjMatrix();
+        Data[i].ShadowMatrix = cascades.GetCascade(i).GetShadowMatrix();
+        Data[i].SplitDistance = cascades.GetSplitDistance(i);
+        Data[i].WrapOffset[0] = (float)cascades.GetWrapOffsetX(i) / (float)cascades.GetBufferWidth();
+        Data[i].WrapOffset[1] = (float)cascades.GetWrapOffsetY(i) / (float)cascades.GetBufferHeight();
+        Data[i].Scrolling = cascades.IsScrolling(i) ? 1.0f : 0.0f;
+    }
+
+    gfxContext.TransitionResource(m_CascadeBuffer, D3D12_RESOURCE_STATE_COPY_DEST, true);
+    gfxContext.WriteBuffer(m_CascadeBuffer, 0, Data, sizeof(CascadeData) * cascades.GetNumCascades());
+}
+
+void CascadedShadows::FitCascades( GraphicsContext& gfxContext, const Camera& camera, const Vector3& lightDirection,
+    uint32_t numCascades, float splitLambda, float shadowDistance, float shadowDepth, uint32_t bufferSize )
+{
+    ScopedTimer _prof(L"Fit Shadow Cascades", gfxContext);
+
+    ASSERT(numCascades > 0 && numCascades <= GameCore::CascadedShadowCamera::kMaxCascades);
+
+    // Same basis as a camera looking down the light direction so that triangle winding is preserved
+    Vector3 lightDir = Normalize(lightDirection);
+    Vector3 lightRight = Cross(lightDir, Vector3(kYUnitVector));
+    if (LengthSquare(lightRight) < 0.000001f)
+        lightRight = Cross(lightDir, Vector3(kXUnitVector));
+    lightRight = Normalize(lightRight);
+    Vector3 lightUp = Cross(lightRight, lightDir);
+
+    __declspec(align(16)) struct
+    {
+        Matrix4 InvViewProj;
+        XMFLOAT3 CameraPos;
+        uint32_t NumCascades;
+        XMFLOAT3 CameraForward;
+        float SplitLambda;
+        XMFLOAT3 LightRight;
+        float ShadowDepth;
+        XMFLOAT3 LightUp;
+        float BufferSize;
+        XMFLOAT3 LightDirection;
+        float NearClip;
+        uint32_t ViewportSize[2];
+        float ShadowDistance;
+    } csConstants;
+
+    csConstants.InvViewProj = Invert(camera.GetViewProjMatrix());
+    XMStoreFloat3(&csConstants.CameraPos, camera.GetPosition());
+    XMStoreFloat3(&csConstants.CameraForward, camera.GetForwardVec());
+    XMStoreFloat3(&csConstants.LightRight, lightRight);
+    XMStoreFloat3(&csConstants.LightUp, lightUp);
+    XMStoreFloat3(&csConstants.LightDirection, lightDir);
+    csConstants.NumCascades = numCascades;
+    csConstants.SplitLambda = splitLambda;
+    csConstants.ShadowDepth = shadowDepth;
+    csConstants.BufferSize = (float)bufferSize;
+    csConstants.NearClip = camera.GetNearClip();
+    csConstants.ViewportSize[0] = DynamicResolution::GetWidth();
+    csConstants.ViewportSize[1] = DynamicResolution::GetHeight();
+    csConstants.ShadowDistance = shadowDistance;
+
+    ComputeContext& Context = gfxContext.GetComputeContext();
+
+    Context.SetRootSignature(m_SDSMRootSig);
+    Context.SetDynamicConstantBufferView(0, sizeof(csConstants), &csConstants);
+
+    Context.TransitionResource(g_SceneDepthBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    Context.TransitionResource(m_ReductionBuffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    Context.TransitionResource(m_CascadeBuffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, true);
+
+    Context.SetDynamicDescriptor(1, 0, g_SceneDepthBuffer.GetDepthSRV());
+    Context.SetDynamicDescriptor(2, 0, m_ReductionBuffer.GetUAV());
+    Context.SetDynamicDescriptor(2, 1, m_CascadeBuffer.GetUAV());
+
+    Context.SetPipelineState(m_DepthBoundsCS);
+    Context.Dispatch2D(DynamicResolution::GetWidth(), DynamicResolution::GetHeight(), 16, 16);
+
+    Context.InsertUAVBarrier(m_ReductionBuffer);
+    Context.SetPipelineState(m_LightBoundsCS);
+    Context.Dispatch2D(DynamicResolution::GetWidth(), DynamicResolution::GetHeight(), 16, 16);
+
+    Context.InsertUAVBarrier(m_ReductionBuffer);
+    Context.SetPipelineState(m_SetupCascadesCS);
+    Context.Dispatch(1, 1, 1);
+}
+
+void CascadedShadows::TransitionForRendering( GraphicsContext& gfxContext )
+{
+    gfxContext.TransitionResource(m_CascadeBuffer,
+        D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE |
+        D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, true);
+}
+
+uint64_t CascadedShadows::GetCascadeCBV( uint32_t cascade )
+{
+    return m_CascadeBuffer.GetGpuVirtualAddress() + cascade * sizeof(CascadeData);
+}
@@ -0,0 +1,54 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#pragma once
+
+#include <cstdint>
+
+class StructuredBuffer;
+class GraphicsContext;
+class BoolVar;
+namespace Math
+{
+    class Vector3;
+    class Camera;
+}
+namespace GameCore
+{
+    class CascadedShadowCamera;
+}
+
+// The sun cascades live in a GPU buffer that is read by both the shadow pass and the pixel shader.
+// It is either filled from the CPU with frustum-fitted cascades, or fitted on the GPU to the samples
+// in the depth buffer (sample distribution shadow maps) with no readback.
+namespace CascadedShadows
+{
+    extern BoolVar FitToDepthBuffer;
+
+    extern StructuredBuffer m_CascadeBuffer;
+
+    // Byte distance between cascades in m_CascadeBuffer, which is large enough to bind each as a CBV
+    enum { kCascadeStride = 256 };
+
+    void InitializeResources(void);
+    void Shutdown(void);
+
+    // Copy cascades that were fitted on the CPU into the cascade buffer
+    void UploadCascades(GraphicsContext& gfxContext, const GameCore::CascadedShadowCamera& cascades);
+
+    // Fit cascades to the visible samples in g_SceneDepthBuffer.  The depth pre-pass must be complete.
+    void FitCascades(GraphicsContext& gfxContext, const Math::Camera& camera, const Math::Vector3& lightDirection,
+        uint32_t numCascades, float splitLambda, float shadowDistance, float shadowDepth, uint32_t bufferSize);
+
+    // Prepare the cascade buffer to be read by the shadow pass, caster culling, and the pixel shader
+    void TransitionForRendering(GraphicsContext& gfxContext);
+
+    // Address of the constants for rendering one cascade with DepthViewerVS
+    uint64_t GetCascadeCBV(uint32_t cascade);
+}
@@ -4,6 +4,18 @@ copy ModelViewerPS_SM6.h ..\Build_VS14\x64\Debug\Output\ModelViewer\CompiledShad
 copy ModelViewerPS_SM6.h ..\Build_VS14\x64\Profile\Output\ModelViewer\CompiledShaders
 copy ModelViewerPS_SM6.h ..\Build_VS14\x64\Release\Output\ModelViewer\CompiledShaders
 
+dxc.exe /D_WAVE_OP /DSCALAR_LOOP /Zi /E"main" /Vn"g_pModelViewerPS_SM6_ScalarLoop" /Tps_6_0 /Fh"ModelViewerPS_SM6_ScalarLoop.h" /nologo Shaders/ModelViewerPS.hlsl
+
+copy ModelViewerPS_SM6_ScalarLoop.h ..\Build_VS14\x64\Debug\Output\ModelViewer\CompiledShaders
+copy ModelViewerPS_SM6_ScalarLoop.h ..\Build_VS14\x64\Profile\Output\ModelViewer\CompiledShaders
+copy ModelViewerPS_SM6_ScalarLoop.h ..\Build_VS14\x64\Release\Output\ModelViewer\CompiledShaders
+
+dxc.exe /D_WAVE_OP /DSCALAR_BRANCH /Zi /E"main" /Vn"g_pModelViewerPS_SM6_ScalarBranch" /Tps_6_0 /Fh"ModelViewerPS_SM6_ScalarBranch.h" /nologo Shaders/ModelViewerPS.hlsl
+
+copy ModelViewerPS_SM6_ScalarBranch.h ..\Build_VS14\x64\Debug\Output\ModelViewer\CompiledShaders
+copy ModelViewerPS_SM6_ScalarBranch.h ..\Build_VS14\x64\Profile\Output\ModelViewer\CompiledShaders
+copy ModelViewerPS_SM6_ScalarBranch.h ..\Build_VS14\x64\Release\Output\ModelViewer\CompiledShaders
+
 dxc.exe /Zi /E"main" /Vn"g_pModelViewerVS_SM6" /Tvs_6_0 /Fh"ModelViewerVS_SM6.h" /nologo Shaders/ModelViewerVS.hlsl
 
 copy ModelViewerVS_SM6.h ..\Build_VS14\x64\Debug\Output\ModelViewer\CompiledShaders
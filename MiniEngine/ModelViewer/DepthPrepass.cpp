@@ -0,0 +1,109 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "DepthPrepass.h"
+#include "GraphicsCore.h"
+#include "GpuTimeManager.h"
+
+namespace DepthPrepass
+{
+    const char* ModeLabels[kNumModes] = { "Full", "Occluders", "Off", "Adaptive" };
+    EnumVar Mode("Application/Depth Prepass/Mode", kAdaptive, kNumModes, ModeLabels);
+    NumVar MinOccluderArea("Application/Depth Prepass/Min Occluder Area", 0.02f, 0.0f, 1.0f, 0.005f);
+    BoolVar ShowOverdraw("Application/Depth Prepass/Show Overdraw", false);
+
+    // Frames between trials of the choice not taken and the length of a trial.  The restricted pre-pass must
+    // save a few percent before it replaces the full one, so that noise does not flip the choice every frame.
+    enum { kTrialInterval = 240, kTrialFrames = 8, kHistoryFrames = 4 };
+    const float kSwitchMargin = 0.05f;
+    const float kCostBlend = 0.1f;
+
+    uint32_t m_Timers[kNumTimers];
+
+    // Whether each recent frame restricted the pre-pass, to credit its times to the right choice
+    bool m_FrameRestricted[kHistoryFrames];
+
+    // The running average GPU milliseconds of both passes with the full and the restricted pre-pass, zero
+    // until measured
+    float m_Cost[2] = { 0.0f, 0.0f };
+    bool m_Restricted = false;
+    uint32_t m_FramesSinceTrial = 0;
+    uint32_t m_TrialFramesLeft = 0;
+}
+
+void DepthPrepass::InitializeResources( void )
+{
+    for (uint32_t i = 0; i < kNumTimers; ++i)
+        m_Timers[i] = GpuTimeManager::NewTimer();
+    for (uint32_t i = 0; i < kHistoryFrames; ++i)
+        m_FrameRestricted[i] = false;
+}
+
+bool DepthPrepass::BeginFrame( bool CanRestrict )
+{
+    // Like the light shadow schedule, take the times read back to be those of two frames ago
+    const uint32_t FrameIndex = (uint32_t)Graphics::GetFrameCount();
+    const float Cost = (GpuTimeManager::GetLastTime(m_Timers[kPrepassTimer]) +
+        GpuTimeManager::GetLastTime(m_Timers[kColorTimer])) * 1000.0f;
+    float& Average = m_Cost[m_FrameRestricted[(FrameIndex - 2) % kHistoryFrames] ? 1 : 0];
+    if (Cost > 0.0f)
+        Average = Average == 0.0f ? Cost : Average + (Cost - Average) * kCostBlend;
+
+    bool Restrict = false;
+    switch (Mode)
+    {
+    case kFull:
+        break;
+
+    case kOccluders:
+    case kOff:
+        Restrict = CanRestrict;
+        break;
+
+    default:
+        if (!CanRestrict)
+            break;
+
+        if (m_TrialFramesLeft == 0)
+        {
+            if (m_Cost[0] > 0.0f && m_Cost[1] > 0.0f)
+                m_Restricted = m_Cost[1] < m_Cost[0] * (m_Restricted ? 1.0f : 1.0f - kSwitchMargin);
+
+            if (++m_FramesSinceTrial >= kTrialInterval || m_Cost[m_Restricted ? 0 : 1] == 0.0f)
+            {
+                m_FramesSinceTrial = 0;
+                m_TrialFramesLeft = kTrialFrames;
+            }
+        }
+
+        if (m_TrialFramesLeft > 0)
+        {
+            --m_TrialFramesLeft;
+            Restrict = !m_Restricted;
+        }
+        else
+        {
+            Restrict = m_Restricted;
+        }
+        break;
+    }
+
+    m_FrameRestricted[FrameIndex % kHistoryFrames] = Restrict;
+    return Restrict;
+}
+
+void DepthPrepass::StartTimer( CommandContext& Context, uint32_t Timer )
+{
+    GpuTimeManager::StartTimer(Context, m_Timers[Timer]);
+}
+
+void DepthPrepass::StopTimer( CommandContext& Context, uint32_t Timer )
+{
+    GpuTimeManager::StopTimer(Context, m_Timers[Timer]);
+}
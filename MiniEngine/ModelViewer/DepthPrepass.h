@@ -0,0 +1,41 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#pragma once
+
+#include <cstdint>
+
+class CommandContext;
+class EnumVar;
+class NumVar;
+class BoolVar;
+
+// Decides how much of the opaque geometry the depth pre-pass draws.  The full pre-pass lets the color pass
+// shade every pixel once, at the cost of a second pass over the geometry.  Restricted to the large occluders,
+// or skipped, the color pass writes the depth of the other opaque meshes itself, which pays off when they hide
+// little.  The adaptive mode times both choices, keeps the cheaper one and tries the other now and then, since
+// the answer changes with the view.
+namespace DepthPrepass
+{
+    enum { kFull, kOccluders, kOff, kAdaptive, kNumModes };
+    extern EnumVar Mode;
+    extern NumVar MinOccluderArea;
+    extern BoolVar ShowOverdraw;
+
+    void InitializeResources(void);
+
+    // Whether this frame's opaque pre-pass leaves meshes to the color pass.  CanRestrict is false while a pass
+    // ahead of the color pass needs the depth of every mesh.
+    bool BeginFrame(bool CanRestrict);
+
+    // Bracket the opaque pre-pass and the color pass, whose sum the adaptive mode compares
+    enum { kPrepassTimer, kColorTimer, kNumTimers };
+    void StartTimer(CommandContext& Context, uint32_t Timer);
+    void StopTimer(CommandContext& Context, uint32_t Timer);
+}
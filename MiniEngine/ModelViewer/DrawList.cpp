@@ -0,0 +1,429 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "DrawList.h"
+#include "RootSignature.h"
+#include "CommandContext.h"
+#include "CommandSignature.h"
+#include "Model.h"
+#include "./DrawStatistics.h"
+#include <algorithm>
+
+using namespace Graphics;
+
+// Matches the root constants that DrawObjects() sets, followed by the draw.  WriteBuffer() copies 16 bytes
+// at a time, so commands are kept a multiple of that.
+__declspec(align(16)) struct DrawCommand
+{
+    uint32_t BaseVertex;
+    uint32_t MaterialIndex;
+    uint32_t ViewMask;
+    D3D12_DRAW_INDEXED_ARGUMENTS DrawArgs;
+};
+static_assert(sizeof(DrawCommand) % 16 == 0, "Draw commands must be 16 byte aligned");
+
+namespace DrawList
+{
+    BoolVar Enable("Application/Indirect Draws/Enable", true);
+
+    enum { kNumBuckets = 4 };
+    enum { kFullStream, kDepthOnlyStream, kNumStreams };
+    enum { kCameraLODs, kShadowLODs, kNumLODSets };
+
+    // Consecutive draws of one bucket that use the same material
+    struct MaterialRun
+    {
+        uint32_t FirstDraw;
+        uint32_t NumDraws;
+        uint32_t MaterialIndex;
+    };
+
+    // How the commands of a buffer split into buckets and runs.  The draws and runs of each bucket start where
+    // the previous bucket's end.
+    struct DrawLayout
+    {
+        std::vector<MaterialRun> MaterialRuns;
+        uint32_t BucketFirstDraw[kNumBuckets + 1];
+        uint32_t BucketFirstRun[kNumBuckets + 1];
+    };
+
+    CommandSignature m_DrawCommandSignature(2);
+
+    // One command per mesh for each vertex stream and set of LODs, in the same order for all.  The CPU copies
+    // and the mesh and level of every draw are kept to compact the visible draws from and to patch LODs, and
+    // the draw of every mesh to follow a mesh order.
+    StructuredBuffer m_DrawCommandBuffer[kNumLODSets][kNumStreams];
+    std::vector<DrawCommand> m_DrawCommands[kNumLODSets][kNumStreams];
+    std::vector<uint8_t> m_DrawLOD[kNumLODSets];
+    std::vector<uint32_t> m_DrawMesh;
+    std::vector<uint32_t> m_MeshDraw;
+    uint32_t m_NumDraws = 0;
+    DrawLayout m_FullLayout;
+    uint32_t m_GeometryVersion = 0;
+
+    // The camera draws SetVisibleMeshes() left, in the same order or the one it was given
+    StructuredBuffer m_VisibleCommandBuffer[kNumStreams];
+    DrawLayout m_VisibleLayout;
+
+    // The triangles of each bucket's draws at the levels they are patched to, for the draw statistics
+    uint64_t m_FullTriangles[kNumLODSets][kNumBuckets];
+    uint64_t m_VisibleTriangles[kNumBuckets];
+
+    void BuildCommands(const Model& model, const std::vector<bool>& MaterialIsCutout);
+    void CountTriangles(const DrawLayout& Layout, const DrawCommand* Commands, uint64_t BucketTriangles[kNumBuckets]);
+}
+
+void DrawList::CountTriangles( const DrawLayout& Layout, const DrawCommand* Commands, uint64_t BucketTriangles[kNumBuckets] )
+{
+    for (uint32_t Bucket = 0; Bucket < kNumBuckets; ++Bucket)
+    {
+        BucketTriangles[Bucket] = 0;
+        for (uint32_t DrawIndex = Layout.BucketFirstDraw[Bucket]; DrawIndex < Layout.BucketFirstDraw[Bucket + 1]; ++DrawIndex)
+            BucketTriangles[Bucket] += Commands[DrawIndex].DrawArgs.IndexCountPerInstance / 3;
+    }
+}
+
+void DrawList::BuildCommands( const Model& model, const std::vector<bool>& MaterialIsCutout )
+{
+    const uint32_t NumMeshes = model.m_Header.meshCount;
+
+    auto GetBucket = [&]( uint32_t meshIndex ) -> uint32_t
+    {
+        return (MaterialIsCutout[model.m_pMesh[meshIndex].materialIndex] ? 2 : 0) + (model.IsMeshDynamic(meshIndex) ? 1 : 0);
+    };
+
+    std::vector<uint32_t> Order(NumMeshes);
+    for (uint32_t meshIndex = 0; meshIndex < NumMeshes; ++meshIndex)
+        Order[meshIndex] = meshIndex;
+
+    std::sort(Order.begin(), Order.end(), [&]( uint32_t a, uint32_t b )
+    {
+        uint32_t BucketA = GetBucket(a), BucketB = GetBucket(b);
+        if (BucketA != BucketB)
+            return BucketA < BucketB;
+        uint32_t MaterialA = model.m_pMesh[a].materialIndex, MaterialB = model.m_pMesh[b].materialIndex;
+        if (MaterialA != MaterialB)
+            return MaterialA < MaterialB;
+        return a < b;
+    });
+
+    for (uint32_t Set = 0; Set < kNumLODSets; ++Set)
+    {
+        for (uint32_t Stream = 0; Stream < kNumStreams; ++Stream)
+            m_DrawCommands[Set][Stream].resize(NumMeshes);
+        m_DrawLOD[Set].assign(NumMeshes, 0);
+    }
+    m_DrawMesh = Order;
+    m_MeshDraw.resize(NumMeshes);
+    for (uint32_t DrawIndex = 0; DrawIndex < NumMeshes; ++DrawIndex)
+        m_MeshDraw[Order[DrawIndex]] = DrawIndex;
+
+    std::vector<MaterialRun>& Runs = m_FullLayout.MaterialRuns;
+    Runs.clear();
+
+    uint32_t Bucket = 0;
+    m_FullLayout.BucketFirstDraw[0] = 0;
+    m_FullLayout.BucketFirstRun[0] = 0;
+
+    for (uint32_t DrawIndex = 0; DrawIndex < NumMeshes; ++DrawIndex)
+    {
+        const uint32_t meshIndex = Order[DrawIndex];
+        const Model::Mesh& mesh = model.m_pMesh[meshIndex];
+
+        const uint32_t MeshBucket = GetBucket(meshIndex);
+        while (Bucket < MeshBucket)
+        {
+            ++Bucket;
+            m_FullLayout.BucketFirstDraw[Bucket] = DrawIndex;
+            m_FullLayout.BucketFirstRun[Bucket] = (uint32_t)Runs.size();
+        }
+
+        if (Runs.size() == m_FullLayout.BucketFirstRun[Bucket] || Runs.back().MaterialIndex != mesh.materialIndex)
+            Runs.push_back({ DrawIndex, 0, mesh.materialIndex });
+        Runs.back().NumDraws++;
+
+        for (uint32_t Stream = 0; Stream < kNumStreams; ++Stream)
+        {
+            const bool DepthOnly = Stream == kDepthOnlyStream;
+
+            DrawCommand& Command = m_DrawCommands[kCameraLODs][Stream][DrawIndex];
+            Command.BaseVertex = model.GetBaseVertex(mesh, DepthOnly);
+            Command.MaterialIndex = mesh.materialIndex;
+            Command.ViewMask = 1;
+            Command.DrawArgs.IndexCountPerInstance = mesh.indexCount;
+            Command.DrawArgs.InstanceCount = 1;
+            Command.DrawArgs.StartIndexLocation = model.GetStartIndex(mesh.indexDataByteOffset);
+            Command.DrawArgs.BaseVertexLocation = Command.BaseVertex;
+            Command.DrawArgs.StartInstanceLocation = 0;
+
+            m_DrawCommands[kShadowLODs][Stream][DrawIndex] = Command;
+        }
+    }
+
+    while (Bucket < kNumBuckets)
+    {
+        ++Bucket;
+        m_FullLayout.BucketFirstDraw[Bucket] = NumMeshes;
+        m_FullLayout.BucketFirstRun[Bucket] = (uint32_t)Runs.size();
+    }
+
+    m_NumDraws = NumMeshes;
+    m_GeometryVersion = model.GetStaticGeometryVersion();
+    for (uint32_t Set = 0; Set < kNumLODSets; ++Set)
+        CountTriangles(m_FullLayout, m_DrawCommands[Set][kFullStream].data(), m_FullTriangles[Set]);
+
+    // Nothing is visible until the next SetVisibleMeshes()
+    m_VisibleLayout.MaterialRuns.clear();
+    for (uint32_t i = 0; i <= kNumBuckets; ++i)
+        m_VisibleLayout.BucketFirstDraw[i] = m_VisibleLayout.BucketFirstRun[i] = 0;
+    for (uint32_t Bucket = 0; Bucket < kNumBuckets; ++Bucket)
+        m_VisibleTriangles[Bucket] = 0;
+}
+
+void DrawList::InitializeResources( const RootSignature& DrawRootSig, const Model& model, const std::vector<bool>& MaterialIsCutout )
+{
+    m_DrawCommandSignature[0].Constant(4, 0, 3);
+    m_DrawCommandSignature[1].DrawIndexed();
+    m_DrawCommandSignature.Finalize(&DrawRootSig);
+
+    BuildCommands(model, MaterialIsCutout);
+    if (m_NumDraws == 0)
+        return;
+
+    m_DrawCommandBuffer[kCameraLODs][kFullStream].Create(L"Draw List", m_NumDraws, sizeof(DrawCommand),
+        m_DrawCommands[kCameraLODs][kFullStream].data());
+    m_DrawCommandBuffer[kCameraLODs][kDepthOnlyStream].Create(L"Depth-Only Draw List", m_NumDraws, sizeof(DrawCommand),
+        m_DrawCommands[kCameraLODs][kDepthOnlyStream].data());
+    m_DrawCommandBuffer[kShadowLODs][kFullStream].Create(L"Shadow Draw List", m_NumDraws, sizeof(DrawCommand),
+        m_DrawCommands[kShadowLODs][kFullStream].data());
+    m_DrawCommandBuffer[kShadowLODs][kDepthOnlyStream].Create(L"Depth-Only Shadow Draw List", m_NumDraws, sizeof(DrawCommand),
+        m_DrawCommands[kShadowLODs][kDepthOnlyStream].data());
+    m_VisibleCommandBuffer[kFullStream].Create(L"Visible Draw List", m_NumDraws, sizeof(DrawCommand));
+    m_VisibleCommandBuffer[kDepthOnlyStream].Create(L"Visible Depth-Only Draw List", m_NumDraws, sizeof(DrawCommand));
+}
+
+void DrawList::Shutdown( void )
+{
+    m_DrawCommandSignature.Destroy();
+    for (uint32_t Stream = 0; Stream < kNumStreams; ++Stream)
+    {
+        for (uint32_t Set = 0; Set < kNumLODSets; ++Set)
+        {
+            m_DrawCommandBuffer[Set][Stream].Destroy();
+            m_DrawCommands[Set][Stream].clear();
+        }
+        m_VisibleCommandBuffer[Stream].Destroy();
+    }
+    for (uint32_t Set = 0; Set < kNumLODSets; ++Set)
+        m_DrawLOD[Set].clear();
+    m_DrawMesh.clear();
+    m_MeshDraw.clear();
+    m_FullLayout.MaterialRuns.clear();
+    m_VisibleLayout.MaterialRuns.clear();
+    m_NumDraws = 0;
+}
+
+void DrawList::Update( GraphicsContext& gfxContext, const Model& model, const std::vector<bool>& MaterialIsCutout )
+{
+    if (m_NumDraws == 0 || model.GetStaticGeometryVersion() == m_GeometryVersion)
+        return;
+
+    ASSERT(model.m_Header.meshCount == m_NumDraws, "The draw list was built for another model");
+
+    BuildCommands(model, MaterialIsCutout);
+
+    for (uint32_t Set = 0; Set < kNumLODSets; ++Set)
+    {
+        for (uint32_t Stream = 0; Stream < kNumStreams; ++Stream)
+        {
+            StructuredBuffer& CommandBuffer = m_DrawCommandBuffer[Set][Stream];
+            gfxContext.TransitionResource(CommandBuffer, D3D12_RESOURCE_STATE_COPY_DEST, true);
+            gfxContext.WriteBuffer(CommandBuffer, 0, m_DrawCommands[Set][Stream].data(), m_NumDraws * sizeof(DrawCommand));
+            gfxContext.TransitionResource(CommandBuffer, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT);
+        }
+    }
+}
+
+void DrawList::SetMeshLODs( GraphicsContext& gfxContext, const Model& model, const std::vector<uint8_t>& CameraLOD,
+    const std::vector<uint8_t>& ShadowLOD )
+{
+    if (m_NumDraws == 0)
+        return;
+
+    ASSERT(CameraLOD.size() == m_NumDraws && ShadowLOD.size() == m_NumDraws, "The LODs do not match the draw list");
+
+    const std::vector<uint8_t>* MeshLOD[kNumLODSets] = { &CameraLOD, &ShadowLOD };
+
+    for (uint32_t Set = 0; Set < kNumLODSets; ++Set)
+    {
+        bool Changed = false;
+        for (uint32_t DrawIndex = 0; DrawIndex < m_NumDraws; ++DrawIndex)
+        {
+            const uint32_t meshIndex = m_DrawMesh[DrawIndex];
+            const uint8_t LOD = (*MeshLOD[Set])[meshIndex];
+            if (m_DrawLOD[Set][DrawIndex] == LOD)
+                continue;
+
+            // Both streams index the same ranges
+            const Model::MeshLOD& Level = model.GetMeshLOD(meshIndex, LOD);
+            for (uint32_t Stream = 0; Stream < kNumStreams; ++Stream)
+            {
+                D3D12_DRAW_INDEXED_ARGUMENTS& DrawArgs = m_DrawCommands[Set][Stream][DrawIndex].DrawArgs;
+                DrawArgs.IndexCountPerInstance = Level.indexCount;
+                DrawArgs.StartIndexLocation = model.GetStartIndex(Level.indexDataByteOffset);
+            }
+            m_DrawLOD[Set][DrawIndex] = LOD;
+            Changed = true;
+        }
+
+        if (!Changed)
+            continue;
+
+        CountTriangles(m_FullLayout, m_DrawCommands[Set][kFullStream].data(), m_FullTriangles[Set]);
+        for (uint32_t Stream = 0; Stream < kNumStreams; ++Stream)
+        {
+            StructuredBuffer& CommandBuffer = m_DrawCommandBuffer[Set][Stream];
+            gfxContext.TransitionResource(CommandBuffer, D3D12_RESOURCE_STATE_COPY_DEST, true);
+            gfxContext.WriteBuffer(CommandBuffer, 0, m_DrawCommands[Set][Stream].data(), m_NumDraws * sizeof(DrawCommand));
+            gfxContext.TransitionResource(CommandBuffer, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT);
+        }
+    }
+}
+
+void DrawList::SetVisibleMeshes( GraphicsContext& gfxContext, const std::vector<bool>& MeshIsVisible,
+    const std::vector<uint32_t>& MeshOrder )
+{
+    if (m_NumDraws == 0)
+        return;
+
+    ASSERT(MeshIsVisible.size() == m_NumDraws, "The visibility does not match the draw list");
+    ASSERT(MeshOrder.empty() || MeshOrder.size() == m_NumDraws, "The mesh order does not match the draw list");
+
+    // Runs keep their order and drop their hidden draws, so the visible list sorts the same way as the full one
+    std::vector<DrawCommand> Commands[kNumStreams];
+    std::vector<MaterialRun>& VisibleRuns = m_VisibleLayout.MaterialRuns;
+    VisibleRuns.clear();
+
+    for (uint32_t Bucket = 0; Bucket < kNumBuckets; ++Bucket)
+    {
+        m_VisibleLayout.BucketFirstDraw[Bucket] = (uint32_t)Commands[kFullStream].size();
+        m_VisibleLayout.BucketFirstRun[Bucket] = (uint32_t)VisibleRuns.size();
+
+        if (!MeshOrder.empty())
+        {
+            const uint32_t FirstDraw = m_FullLayout.BucketFirstDraw[Bucket];
+            const uint32_t EndDraw = m_FullLayout.BucketFirstDraw[Bucket + 1];
+
+            for (uint32_t meshIndex : MeshOrder)
+            {
+                const uint32_t DrawIndex = m_MeshDraw[meshIndex];
+                if (DrawIndex < FirstDraw || DrawIndex >= EndDraw || !MeshIsVisible[meshIndex])
+                    continue;
+
+                const uint32_t MaterialIndex = m_DrawCommands[kCameraLODs][kFullStream][DrawIndex].MaterialIndex;
+                if (VisibleRuns.size() == m_VisibleLayout.BucketFirstRun[Bucket] || VisibleRuns.back().MaterialIndex != MaterialIndex)
+                    VisibleRuns.push_back({ (uint32_t)Commands[kFullStream].size(), 0, MaterialIndex });
+                VisibleRuns.back().NumDraws++;
+
+                for (uint32_t Stream = 0; Stream < kNumStreams; ++Stream)
+                    Commands[Stream].push_back(m_DrawCommands[kCameraLODs][Stream][DrawIndex]);
+            }
+            continue;
+        }
+
+        for (uint32_t RunIndex = m_FullLayout.BucketFirstRun[Bucket]; RunIndex < m_FullLayout.BucketFirstRun[Bucket + 1]; ++RunIndex)
+        {
+            const MaterialRun& Run = m_FullLayout.MaterialRuns[RunIndex];
+            MaterialRun VisibleRun = { (uint32_t)Commands[kFullStream].size(), 0, Run.MaterialIndex };
+
+            for (uint32_t DrawIndex = Run.FirstDraw; DrawIndex < Run.FirstDraw + Run.NumDraws; ++DrawIndex)
+            {
+                if (!MeshIsVisible[m_DrawMesh[DrawIndex]])
+                    continue;
+
+                for (uint32_t Stream = 0; Stream < kNumStreams; ++Stream)
+                    Commands[Stream].push_back(m_DrawCommands[kCameraLODs][Stream][DrawIndex]);
+                VisibleRun.NumDraws++;
+            }
+
+            if (VisibleRun.NumDraws > 0)
+                VisibleRuns.push_back(VisibleRun);
+        }
+    }
+
+    const uint32_t NumVisible = (uint32_t)Commands[kFullStream].size();
+    m_VisibleLayout.BucketFirstDraw[kNumBuckets] = NumVisible;
+    m_VisibleLayout.BucketFirstRun[kNumBuckets] = (uint32_t)VisibleRuns.size();
+    CountTriangles(m_VisibleLayout, Commands[kFullStream].data(), m_VisibleTriangles);
+    if (NumVisible == 0)
+        return;
+
+    for (uint32_t Stream = 0; Stream < kNumStreams; ++Stream)
+    {
+        gfxContext.TransitionResource(m_VisibleCommandBuffer[Stream], D3D12_RESOURCE_STATE_COPY_DEST, true);
+        gfxContext.WriteBuffer(m_VisibleCommandBuffer[Stream], 0, Commands[Stream].data(), NumVisible * sizeof(DrawCommand));
+        gfxContext.TransitionResource(m_VisibleCommandBuffer[Stream], D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT);
+    }
+}
+
+void DrawList::Draw( GraphicsContext& gfxContext, const Model& model, uint32_t BucketMask, bool DepthOnlyStream, bool BindMaterials,
+    bool VisibleOnly, bool ShadowLODs )
+{
+    if (m_NumDraws == 0)
+        return;
+
+    ASSERT(!(VisibleOnly && ShadowLODs), "The visible list only has the camera LODs");
+
+    const uint32_t Stream = DepthOnlyStream ? kDepthOnlyStream : kFullStream;
+    StructuredBuffer& CommandBuffer = VisibleOnly ? m_VisibleCommandBuffer[Stream] :
+        m_DrawCommandBuffer[ShadowLODs ? kShadowLODs : kCameraLODs][Stream];
+    const DrawLayout& Layout = VisibleOnly ? m_VisibleLayout : m_FullLayout;
+    const uint64_t* BucketTriangles = VisibleOnly ? m_VisibleTriangles : m_FullTriangles[ShadowLODs ? kShadowLODs : kCameraLODs];
+
+    uint32_t NumMeshes = 0;
+    uint64_t NumTriangles = 0;
+    for (uint32_t Bucket = 0; Bucket < kNumBuckets; ++Bucket)
+    {
+        if (BucketMask & (1 << Bucket))
+        {
+            NumMeshes += Layout.BucketFirstDraw[Bucket + 1] - Layout.BucketFirstDraw[Bucket];
+            NumTriangles += BucketTriangles[Bucket];
+        }
+    }
+    DrawStatistics::AddDraws(NumMeshes, NumTriangles);
+
+    for (uint32_t Bucket = 0; Bucket < kNumBuckets; ++Bucket)
+    {
+        if (!(BucketMask & (1 << Bucket)))
+            continue;
+
+        if (!BindMaterials)
+        {
+            // Runs of the next buckets in the mask are adjacent, so they go in the same submission
+            uint32_t EndBucket = Bucket + 1;
+            while (EndBucket < kNumBuckets && (BucketMask & (1 << EndBucket)))
+                ++EndBucket;
+
+            const uint32_t FirstDraw = Layout.BucketFirstDraw[Bucket];
+            const uint32_t NumDraws = Layout.BucketFirstDraw[EndBucket] - FirstDraw;
+            if (NumDraws > 0)
+                gfxContext.ExecuteIndirect(m_DrawCommandSignature, CommandBuffer, FirstDraw * sizeof(DrawCommand), NumDraws);
+
+            Bucket = EndBucket - 1;
+            continue;
+        }
+
+        for (uint32_t RunIndex = Layout.BucketFirstRun[Bucket]; RunIndex < Layout.BucketFirstRun[Bucket + 1]; ++RunIndex)
+        {
+            const MaterialRun& Run = Layout.MaterialRuns[RunIndex];
+            gfxContext.SetDynamicDescriptors(2, 0, 6, model.GetSRVs(Run.MaterialIndex));
+            gfxContext.ExecuteIndirect(m_DrawCommandSignature, CommandBuffer, Run.FirstDraw * sizeof(DrawCommand), Run.NumDraws);
+        }
+    }
+}
@@ -0,0 +1,55 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+class Model;
+class RootSignature;
+class GraphicsContext;
+class BoolVar;
+
+// The model's meshes as GPU draw commands, built once when the model loads and sorted by alpha mode, mobility
+// and material.  A pass submits every run of meshes that share a material with a single ExecuteIndirect, so
+// its CPU cost grows with the number of materials rather than meshes.  Material textures live in a descriptor
+// table, which indirect draws cannot change, so passes that read them still bind each material from the CPU
+// unless their shaders index the bindless material textures instead.
+namespace DrawList
+{
+    extern BoolVar Enable;
+
+    // Meshes are grouped into buckets, which can be combined in a mask
+    enum { kOpaqueStatic = 0x1, kOpaqueDynamic = 0x2, kCutoutStatic = 0x4, kCutoutDynamic = 0x8 };
+
+    // The command signature sets the root constants of DrawRootSig, so draws must use that root signature
+    void InitializeResources(const RootSignature& DrawRootSig, const Model& model, const std::vector<bool>& MaterialIsCutout);
+    void Shutdown(void);
+
+    // Re-sorts the draws when meshes have switched between static and dynamic
+    void Update(GraphicsContext& gfxContext, const Model& model, const std::vector<bool>& MaterialIsCutout);
+
+    // Points each mesh's draws at its level of detail, with separate levels for camera and shadow views.  Only
+    // changed commands are uploaded, and this must come ahead of SetVisibleMeshes().
+    void SetMeshLODs(GraphicsContext& gfxContext, const Model& model, const std::vector<uint8_t>& CameraLOD,
+        const std::vector<uint8_t>& ShadowLOD);
+
+    // Compacts the draws of the visible meshes into a second list, which keeps the sort order of the full one.
+    // Given a MeshOrder, each bucket's draws follow it instead, with a run wherever the material changes.
+    void SetVisibleMeshes(GraphicsContext& gfxContext, const std::vector<bool>& MeshIsVisible,
+        const std::vector<uint32_t>& MeshOrder = std::vector<uint32_t>());
+
+    // Draws the buckets in the mask for a single view with the bound PSO.  With BindMaterials, each material's
+    // textures are bound to root table 2 ahead of its meshes.  Otherwise every bucket is one ExecuteIndirect.
+    // VisibleOnly draws the list of the last SetVisibleMeshes() instead of every mesh.  ShadowLODs draws the
+    // shadow levels of detail, which only the full list has.
+    void Draw(GraphicsContext& gfxContext, const Model& model, uint32_t BucketMask, bool DepthOnlyStream, bool BindMaterials,
+        bool VisibleOnly = false, bool ShadowLODs = false);
+}
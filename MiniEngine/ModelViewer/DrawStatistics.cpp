@@ -0,0 +1,214 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "DrawStatistics.h"
+#include "CommandContext.h"
+#include "CommandListManager.h"
+#include "GraphicsCore.h"
+#include "ReadbackBuffer.h"
+#include "EngineProfiling.h"
+#include "EngineTuning.h"
+#include "CascadedShadowCamera.h"
+#include <algorithm>
+#include <atomic>
+#include <string>
+
+using namespace Graphics;
+
+namespace DrawStatistics
+{
+    BoolVar Enable("Application/Draw Statistics/Enable", true);
+
+    // Frames whose GPU counts are in flight, and the most culled draws a frame reads back
+    enum { kReadbackLatency = 3, kMaxCulledDraws = 1024 };
+
+    const char* kViewNames[kNumViews] = { "Main", "Cascade 0", "Cascade 1", "Cascade 2", "Cascade 3", "Cascade 4",
+        "Cascade 5", "Cascade 6", "Cascade 7", "Sun Shadow", "Light Shadows" };
+    const char* kCountNames[kNumCounts] = { "Meshes", "Triangles", "Triangles Drawn" };
+
+    // This frame's counts, without the triangles drawn by culled draws until they are read back
+    std::atomic<uint64_t> m_Counts[kNumViews][kNumCounts];
+    std::atomic<uint32_t> m_NumCulledDraws;
+    uint32_t m_View = kMainView;
+    bool m_Counting = false;
+
+    // The frames in flight, with the view of every culled draw whose triangles they read back
+    struct PendingFrame
+    {
+        uint64_t Counts[kNumViews][kNumCounts];
+        uint8_t CulledDrawView[kMaxCulledDraws];
+        uint32_t NumCulledDraws;
+        uint64_t Fence;
+    };
+    PendingFrame m_Frames[kReadbackLatency];
+    ReadbackBuffer m_Readback[kReadbackLatency];
+    uint32_t m_ReadbackHead = 0;
+    uint32_t m_ReadbackTail = 0;
+    uint32_t m_NumPendingReadbacks = 0;
+
+    uint64_t m_Published[kNumViews][kNumCounts];
+    bool m_ViewDrawn[kNumViews];
+
+    void Publish(PendingFrame& Frame, ReadbackBuffer& Readback);
+}
+
+void DrawStatistics::InitializeResources( void )
+{
+    static_assert(kMaxCascadeViews == GameCore::CascadedShadowCamera::kMaxCascades, "One view per sun cascade");
+    static_assert(kNumViews <= 256, "Culled draws keep their view in a byte");
+
+    for (uint32_t i = 0; i < kReadbackLatency; ++i)
+    {
+        m_Readback[i].Create(L"Draw Statistics Readback", kMaxCulledDraws, sizeof(uint32_t));
+        m_Frames[i].Fence = 0;
+    }
+    for (uint32_t View = 0; View < kNumViews; ++View)
+        m_ViewDrawn[View] = false;
+}
+
+void DrawStatistics::Shutdown( void )
+{
+    for (uint32_t i = 0; i < kReadbackLatency; ++i)
+        m_Readback[i].Destroy();
+    m_ReadbackHead = m_ReadbackTail = m_NumPendingReadbacks = 0;
+    m_Counting = false;
+}
+
+void DrawStatistics::Publish( PendingFrame& Frame, ReadbackBuffer& Readback )
+{
+    if (Frame.NumCulledDraws > 0)
+    {
+        const uint32_t* TrianglesDrawn = (const uint32_t*)Readback.Map();
+        for (uint32_t i = 0; i < Frame.NumCulledDraws; ++i)
+            Frame.Counts[Frame.CulledDrawView[i]][kTrianglesDrawn] += TrianglesDrawn[i];
+        Readback.Unmap();
+    }
+
+    // Views stay listed once they have drawn, so that their counters fall to zero rather than go stale
+    for (uint32_t View = 0; View < kNumViews; ++View)
+    {
+        m_ViewDrawn[View] = m_ViewDrawn[View] || Frame.Counts[View][kMeshes] > 0;
+        if (!m_ViewDrawn[View])
+            continue;
+
+        for (uint32_t Count = 0; Count < kNumCounts; ++Count)
+        {
+            m_Published[View][Count] = Frame.Counts[View][Count];
+            EngineProfiling::SetCounter(std::string(kViewNames[View]) + " " + kCountNames[Count],
+                (uint32_t)std::min<uint64_t>(Frame.Counts[View][Count], UINT32_MAX));
+        }
+    }
+}
+
+void DrawStatistics::BeginFrame( void )
+{
+    int32_t Newest = -1;
+    while (m_NumPendingReadbacks > 0 && g_CommandManager.IsFenceComplete(m_Frames[m_ReadbackTail].Fence))
+    {
+        Newest = (int32_t)m_ReadbackTail;
+        m_ReadbackTail = (m_ReadbackTail + 1) % kReadbackLatency;
+        --m_NumPendingReadbacks;
+    }
+
+    if (Newest >= 0)
+        Publish(m_Frames[Newest], m_Readback[Newest]);
+
+    // Skip the frame if the CPU has fallen so far behind that every readback is in flight
+    m_Counting = Enable && m_NumPendingReadbacks < kReadbackLatency;
+    if (!m_Counting)
+        return;
+
+    for (uint32_t View = 0; View < kNumViews; ++View)
+    {
+        for (uint32_t Count = 0; Count < kNumCounts; ++Count)
+            m_Counts[View][Count] = 0;
+    }
+    m_NumCulledDraws = 0;
+    m_View = kMainView;
+}
+
+void DrawStatistics::EndFrame( uint64_t FenceValue )
+{
+    if (!m_Counting)
+        return;
+
+    m_Counting = false;
+
+    PendingFrame& Frame = m_Frames[m_ReadbackHead];
+    for (uint32_t View = 0; View < kNumViews; ++View)
+    {
+        for (uint32_t Count = 0; Count < kNumCounts; ++Count)
+            Frame.Counts[View][Count] = m_Counts[View][Count];
+    }
+    Frame.NumCulledDraws = std::min((uint32_t)m_NumCulledDraws, (uint32_t)kMaxCulledDraws);
+    Frame.Fence = FenceValue;
+
+    m_ReadbackHead = (m_ReadbackHead + 1) % kReadbackLatency;
+    ++m_NumPendingReadbacks;
+}
+
+void DrawStatistics::SetView( uint32_t View )
+{
+    ASSERT(View < kNumViews);
+    m_View = View;
+}
+
+void DrawStatistics::AddDraws( uint32_t NumMeshes, uint64_t NumTriangles )
+{
+    if (!m_Counting || NumMeshes == 0)
+        return;
+
+    m_Counts[m_View][kMeshes] += NumMeshes;
+    m_Counts[m_View][kTriangles] += NumTriangles;
+    m_Counts[m_View][kTrianglesDrawn] += NumTriangles;
+}
+
+void DrawStatistics::AddCulledDraws( CommandContext& Context, uint32_t NumMeshes, uint64_t NumTriangles, GpuResource& Counts,
+    uint32_t Offset )
+{
+    if (!m_Counting)
+        return;
+
+    m_Counts[m_View][kMeshes] += NumMeshes;
+    m_Counts[m_View][kTriangles] += NumTriangles;
+
+    // Past the end of the readback, take every candidate to be drawn
+    const uint32_t Index = m_NumCulledDraws++;
+    if (Index >= kMaxCulledDraws)
+    {
+        m_Counts[m_View][kTrianglesDrawn] += NumTriangles;
+        return;
+    }
+
+    m_Frames[m_ReadbackHead].CulledDrawView[Index] = (uint8_t)m_View;
+    Context.CopyBufferRegion(m_Readback[m_ReadbackHead], Index * sizeof(uint32_t), Counts, Offset, sizeof(uint32_t));
+}
+
+const char* DrawStatistics::GetViewName( uint32_t View )
+{
+    ASSERT(View < kNumViews);
+    return kViewNames[View];
+}
+
+const char* DrawStatistics::GetCountName( uint32_t Count )
+{
+    ASSERT(Count < kNumCounts);
+    return kCountNames[Count];
+}
+
+bool DrawStatistics::GetCounts( uint32_t View, uint64_t Counts[kNumCounts] )
+{
+    ASSERT(View < kNumViews);
+    if (!m_ViewDrawn[View])
+        return false;
+
+    for (uint32_t Count = 0; Count < kNumCounts; ++Count)
+        Counts[Count] = m_Published[View][Count];
+    return true;
+}
@@ -0,0 +1,58 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#pragma once
+
+#include <cstdint>
+
+class CommandContext;
+class GpuResource;
+class BoolVar;
+
+// Counts the meshes and triangles that each view submits and the triangles left after GPU culling, to weigh
+// culling, LOD and meshlet changes by.  The meshes are the draws made from the CPU or the candidates handed to
+// a GPU culling pass, and the triangles count every instance and view.  Culling passes write the triangles of
+// the draws they keep, which are read back a few frames later, so each frame's counts are published together
+// once its GPU counts arrive.  Views culled only on the CPU draw every triangle they submit.
+namespace DrawStatistics
+{
+    extern BoolVar Enable;
+
+    enum { kMaxCascadeViews = 8 };
+    enum { kMainView, kFirstCascadeView, kSunShadowView = kFirstCascadeView + kMaxCascadeViews, kLightShadowView, kNumViews };
+    enum { kMeshes, kTriangles, kTrianglesDrawn, kNumCounts };
+
+    void InitializeResources(void);
+    void Shutdown(void);
+
+    // Publishes the newest frame whose GPU counts have arrived as profiler counters, and starts this frame's
+    void BeginFrame(void);
+
+    // The frame's counts are complete once the fence it last signals has passed
+    void EndFrame(uint64_t FenceValue);
+
+    // Draws are counted in this view until it is changed.  Single sun shadow maps and cascades drawn together
+    // count as the sun shadow view, and every light shadow as the light shadow view.
+    void SetView(uint32_t View);
+
+    // Draws made from the CPU.  The chunks of a pass may add them from several threads at once.
+    void AddDraws(uint32_t NumMeshes, uint64_t NumTriangles);
+
+    // The candidates of a GPU culling pass, which wrote the triangles of the draws it kept as a uint at Offset
+    // in Counts.  Counts must be in a state that can be copied from.  A pass that culls in several steps may
+    // pass its candidates with just one of them.
+    void AddCulledDraws(CommandContext& Context, uint32_t NumMeshes, uint64_t NumTriangles, GpuResource& Counts,
+        uint32_t Offset);
+
+    const char* GetViewName(uint32_t View);
+    const char* GetCountName(uint32_t Count);
+
+    // The counts last published.  Returns false for a view that has never drawn.
+    bool GetCounts(uint32_t View, uint64_t Counts[kNumCounts]);
+}
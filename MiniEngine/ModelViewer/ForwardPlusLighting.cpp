@@ -18,83 +18,376 @@
 #include "CommandContext.h"
 #include "Camera.h"
 #include "BufferManager.h"
+#include "DynamicResolution.h"
+#include "GraphicsCore.h"
+#include "ShaderCompiler.h"
+#include <algorithm>
+#include <cmath>
+#include <DirectXPackedVector.h>
 
 #include "CompiledShaders/FillLightGridCS_8.h"
 #include "CompiledShaders/FillLightGridCS_16.h"
 #include "CompiledShaders/FillLightGridCS_24.h"
 #include "CompiledShaders/FillLightGridCS_32.h"
+#include "CompiledShaders/FillLightClustersCS.h"
+#include "CompiledShaders/FillLightSuperTilesCS.h"
+#include "CompiledShaders/LightShadowMatricesCS.h"
 
 using namespace Math;
 using namespace Graphics;
 
-// must keep in sync with HLSL
+// must keep in sync with HLSL.  The light loops read all of it for every light, so it is kept to 32 bytes.
 struct LightData
 {
     float pos[3];
     float radiusSq;
-    float color[3];
 
-    uint32_t type;
-    float coneDir[3];
-    float coneAngles[2];
+    uint16_t color[3];          // Half floats
+    uint16_t type;
+    int16_t coneDir[2];         // Octahedral-encoded snorms
+    uint16_t coneAngles[2];     // Half floats
+};
+static_assert(sizeof(LightData) == 32, "Keep the light data in sync with LightGrid.hlsli");
+
+// Shadowed lights only, by slot - kFirstShadowedSlot
+struct LightShadowData
+{
+    float shadowTextureMatrix[16];      // Written by LightShadowMatricesCS for cone lights
 
-    float shadowTextureMatrix[16];
+    float pointShadowParams[4];
+    float pointShadowFaceOffsets[12];
 };
 
 enum { kMinLightGridDim = 8 };
+// Keep in sync with SUPER_TILE_DIM in LightGrid.hlsli
+enum { kLightSuperTileDim = 64 };
+// Keep in sync with TILE_HEADER_SIZE and LIGHT_INDEX_SIZE in LightGrid.hlsli
+enum { kTileHeaderSize = 8, kLightIndexSize = Lighting::MaxLights <= 256 ? 1 : 2 };
+// Light indices the grid lists hold across all tiles.  Tiles that do not fit are left unlit.
+enum { kTileListCapacity = 2 * 1024 * 1024 };
+// Light indices the cluster list holds across all clusters.  Clusters that do not fit are left unlit.
+enum { kClusterListCapacity = 4 * 1024 * 1024 };
+enum { kShadowAtlasSize = 4096, kMinShadowTileSize = 64, kMaxShadowTileSize = 1024 };
+enum : uint32_t { kShadowNeverUpdated = 0xFFFFFFFF };
+// Light buffer uploads go in blocks of lights that start on the 16 byte boundaries WriteBuffer needs
+enum { kUploadBlockLights = 4 };
+static_assert((kUploadBlockLights * sizeof(LightData)) % 16 == 0, "Upload blocks must be 16 byte aligned");
+static_assert(Lighting::MaxLights % kUploadBlockLights == 0, "Upload blocks must cover the light buffer");
+static_assert(sizeof(LightShadowData) % 16 == 0, "Shadow data uploads must be 16 byte aligned");
+enum { kFirstShadowedSlot = Lighting::MaxLights - Lighting::MaxShadowedLights };
+// Shadowed cone lights take the first shadowed slots.  Keep in sync with NUM_CONE_SHADOWED_LIGHTS in LightShadowMatricesCS.hlsl
+enum { kNumConeShadowedLights = Lighting::MaxShadowedLights / 2 };
 
 namespace Lighting
 {
     IntVar LightGridDim("Application/Forward+/Light Grid Dim", 16, kMinLightGridDim, 32, 8 );
+    BoolVar ClusteredLighting("Application/Forward+/Clustered", true);
+    NumVar ShadowResolutionScale("Application/Forward+/Shadow Resolution Scale", 1.0f, 0.25f, 4.0f, 0.25f );
+    NumVar ShadowUpdateBudget("Application/Forward+/Shadow Update Budget (ms)", 1.0f, 0.1f, 10.0f, 0.1f );
+    NumVar ShadowResolutionHysteresis("Application/Forward+/Shadow Resolution Hysteresis", 0.25f, 0.0f, 0.5f, 0.05f );
+    IntVar ShadowMaxUpdateInterval("Application/Forward+/Shadow Max Update Interval", 8, 1, 64 );
+    BoolVar LazyLightGrid("Application/Forward+/Lazy Light Grid", true);
+    const char* PointShadowModeLabels[] = { "Cube", "Dual Paraboloid" };
+    EnumVar PointShadowMode("Application/Forward+/Point Shadow Mode", kPointShadowCube, kNumPointShadowModes, PointShadowModeLabels);
 
     RootSignature m_FillLightRootSig;
     ComputePSO m_FillLightGridCS_8;
     ComputePSO m_FillLightGridCS_16;
     ComputePSO m_FillLightGridCS_24;
     ComputePSO m_FillLightGridCS_32;
+    ComputePSO m_FillLightClustersCS;
+    RootSignature m_FillSuperTilesRootSig;
+    ComputePSO m_FillLightSuperTilesCS;
+    RootSignature m_LightShadowMatricesRootSig;
+    ComputePSO m_LightShadowMatricesCS;
 
-    LightData m_LightData[MaxLights];
+    __declspec(align(16)) LightData m_LightData[MaxLights];
     StructuredBuffer m_LightBuffer;
+    __declspec(align(16)) LightShadowData m_LightShadowData[MaxShadowedLights];
+    StructuredBuffer m_LightShadowBuffer;
     ByteAddressBuffer m_LightGrid;
+    uint32_t m_LightGridListBase;
 
     ByteAddressBuffer m_LightGridBitMask;
+    // A light bit mask per super tile, only used while building the grid
+    ByteAddressBuffer m_LightSuperTileMask;
     uint32_t m_FirstConeLight;
     uint32_t m_FirstConeShadowedLight;
+    uint32_t m_FirstPointShadowedLight;
+
+    ByteAddressBuffer m_LightClusters;
+    ByteAddressBuffer m_LightClusterList;
+    bool m_FillFrontClusters = false;
+
+    // What the grid was last built from, so that idle frames can reuse it
+    struct LightGridInputs
+    {
+        Matrix4 ViewProj;
+        Matrix4 SplitViewProj;
+        uint32_t SplitX;
+        float NearClip, FarClip;
+        uint32_t Width, Height;
+        int32_t TileDim;
+        bool Clustered;
+        bool FillFrontClusters;
+        uint32_t LightVersion;
+        uint32_t DepthVersion;
+    };
+    LightGridInputs m_LightGridInputs;
+    bool m_LightGridValid = false;
+    // Changes whenever the light buffer does
+    uint32_t m_LightDataVersion = 0;
+
+    // Each type's slots run from kTypeFirstSlot[type] to kTypeFirstSlot[type + 1], live lights first
+    const uint32_t kTypeFirstSlot[kNumLightTypes + 1] = { 0, (MaxLights - MaxShadowedLights) / 2,
+        MaxLights - MaxShadowedLights, MaxLights - MaxShadowedLights / 2, MaxLights };
+    uint32_t m_LightTypeCount[kNumLightTypes];
+    LightHandle m_SlotToHandle[MaxLights];
+    uint32_t m_HandleToSlot[MaxLights];
+    std::vector<LightHandle> m_FreeLightHandles;
+    bool m_LightBlockDirty[MaxLights / kUploadBlockLights];
+    bool m_ShadowDataDirty[MaxShadowedLights];
 
-    enum {shadowDim = 512};
-    ColorBuffer m_LightShadowArray;
-    ShadowBuffer m_LightShadowTempBuffer;
-    Matrix4 m_LightShadowMatrix[MaxLights];
+    ShadowBuffer m_LightShadowAtlas;
+    StructuredBuffer m_LightShadowMatrixBuffer;
+    bool m_LightShadowMatricesDirty = true;
+    ShadowAtlasAllocator::Tile m_LightShadowTile[MaxLights];
+    bool m_LightShadowDirty[MaxLights];
+    uint32_t m_LightShadowLastUpdate[MaxLights];
+    ShadowAtlasAllocator::Tile m_PointShadowFaceTile[MaxLights][kMaxPointShadowFaces];
+    // The mode the current point light tiles were allocated for
+    int32_t m_PointShadowLayoutMode = kPointShadowCube;
+    ShadowAtlasAllocator m_ShadowAtlasAllocator;
+    bool m_ShadowAtlasCleared = false;
+
+    // Running average of the GPU time to render one light, refined by ReportShadowUpdateCost()
+    float m_ShadowUpdateCostPerLight = 0.1f;
 
     void InitializeResources(void);
     void CreateRandomLights(const Vector3 minBound, const Vector3 maxBound);
-    void FillLightGrid(GraphicsContext& gfxContext, const Camera& camera);
+    LightHandle AddLight(LightType type, const Vector3& position, float radius, const Vector3& color,
+        const Vector3& coneDir, float coneInner, float coneOuter);
+    void RemoveLight(LightHandle light);
+    void RemoveAllLights(void);
+    void MoveLight(LightHandle light, const Vector3& position, const Vector3& coneDir);
+    uint32_t GetLightCount(LightType type);
+    void SetLightPlacement(uint32_t slot, const Vector3& position, const Vector3& coneDir);
+    void ClearLightSlot(uint32_t slot);
+    void MarkLightDataDirty(uint32_t slot);
+    LightShadowData& GetShadowData(uint32_t slot);
+    void UploadLights(CommandContext& context);
+    void BuildLightShadowMatrices(ComputeContext& context);
+    uint64_t GetLightShadowMatrixCBV(uint32_t lightIndex);
+    void UpdateShadowAtlas(GraphicsContext& gfxContext, const Camera& camera);
+    void InvalidateShadows(const Vector3& minBound, const Vector3& maxBound);
+    uint32_t ScheduleShadowUpdates(uint32_t* lightList);
+    void ReportShadowUpdateCost(float gpuMilliseconds, uint32_t numLightsRendered);
+    bool IsPointShadowedLight(uint32_t lightIndex);
+    uint32_t GetPointShadowFaceCount(void);
+    void GetPointShadowConstants(uint32_t lightIndex, PointShadowConstants& constants);
+    uint32_t GetPointShadowCullViews(uint32_t lightIndex, Matrix4* views);
+    uint32_t GetTileAlignment(void);
+    void FillLightGrid(GraphicsContext& gfxContext, const Camera& camera, const GridViews* views, uint32_t depthVersion);
+    void FillLightGrid(ComputeContext& asyncContext, const Camera& camera, const GridViews* views, uint32_t depthVersion);
+    bool NeedsLightGridRebuild(const Camera& camera, const GridViews* views, uint32_t depthVersion);
+    void GetGridMatrices(const Camera& camera, const GridViews* views, Matrix4& viewProj, uint32_t& splitX, Matrix4& splitViewProj);
+    void DispatchLightSuperTiles(ComputeContext& Context, const Camera& camera, const GridViews* views);
+    void DispatchLightGrid(ComputeContext& Context, const Camera& camera, const GridViews* views);
+    void DispatchLightClusters(ComputeContext& Context, const Camera& camera, const GridViews* views);
+    void GetClusterParams(const Camera& camera, float params[4]);
     void Shutdown(void);
 }
 
+// Rotates positions relative to a point light into the view space of one of its shadow faces.  Keep in
+// sync with GetPointShadowFaceView() in PointShadow.hlsli.
+static Matrix3 GetPointShadowFaceRotation( uint32_t face )
+{
+    // Rows of each rotation, for faces +Y, -Y, +X, -X, +Z, -Z
+    static const float kFaceRows[Lighting::kMaxPointShadowFaces][3][3] =
+    {
+        { { -1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, -1.0f }, { 0.0f, -1.0f, 0.0f } },
+        { { -1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f,  1.0f }, { 0.0f,  1.0f, 0.0f } },
+        { {  0.0f, 0.0f, 1.0f }, { 0.0f, 1.0f,  0.0f }, { -1.0f, 0.0f, 0.0f } },
+        { {  0.0f, 0.0f, -1.0f }, { 0.0f, 1.0f, 0.0f }, {  1.0f, 0.0f, 0.0f } },
+        { { -1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f,  0.0f }, { 0.0f, 0.0f, -1.0f } },
+        { {  1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f,  0.0f }, { 0.0f, 0.0f,  1.0f } },
+    };
+
+    const float (&r)[3][3] = kFaceRows[face];
+    return Matrix3(
+        Vector3(r[0][0], r[1][0], r[2][0]),
+        Vector3(r[0][1], r[1][1], r[2][1]),
+        Vector3(r[0][2], r[1][2], r[2][2]));
+}
+
+// The depth terms of pointShadowParams.  Cube faces use the reversed-Z 90 degree perspective projection,
+// and paraboloids store reversed linear distance.
+static void GetPointShadowDepthParams( float radius, bool paraboloid, float params[2] )
+{
+    const float nearClip = radius * .05f;
+    const float farClip = radius;
+
+    if (paraboloid)
+    {
+        params[0] = farClip / (farClip - nearClip);
+        params[1] = 1.0f / (farClip - nearClip);
+    }
+    else
+    {
+        params[0] = nearClip / (farClip - nearClip);
+        params[1] = params[0] * farClip;
+    }
+}
+
+// Projects the unit vector onto the octahedron |x| + |y| + |z| = 1 and unfolds the lower half over the corners of
+// the upper half.  Keep in sync with GetLightConeDir() in LightGrid.hlsli.
+static void EncodeConeDir( const Vector3& dir, int16_t encoded[2] )
+{
+    const float l1 = fabsf(dir.GetX()) + fabsf(dir.GetY()) + fabsf(dir.GetZ());
+    float x = l1 > 0.0f ? dir.GetX() / l1 : 0.0f;
+    float y = l1 > 0.0f ? dir.GetY() / l1 : 0.0f;
+    if (dir.GetZ() < 0.0f)
+    {
+        const float foldedX = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        const float foldedY = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = foldedX;
+        y = foldedY;
+    }
+    encoded[0] = (int16_t)lroundf(std::max(-1.0f, std::min(x, 1.0f)) * 32767.0f);
+    encoded[1] = (int16_t)lroundf(std::max(-1.0f, std::min(y, 1.0f)) * 32767.0f);
+}
+
+static void UpdatePointShadowData( LightShadowData& light, float radius, const ShadowAtlasAllocator::Tile* faceTiles,
+    uint32_t numFaces, bool paraboloid )
+{
+    if (faceTiles[0].Size == 0)
+    {
+        // Like the cone lights without a tile, map every point to the bottom right corner of the atlas with a
+        // depth that always passes the shadow test.  Tile borders are never rendered, so the corner stays cleared.
+        light.pointShadowParams[0] = -1.0f;
+        light.pointShadowParams[1] = 0.0f;
+        light.pointShadowParams[2] = 0.0f;
+        light.pointShadowParams[3] = 0.0f;
+        for (uint32_t i = 0; i < _countof(light.pointShadowFaceOffsets); ++i)
+            light.pointShadowFaceOffsets[i] = 1.0f;
+        return;
+    }
+
+    GetPointShadowDepthParams(radius, paraboloid, light.pointShadowParams);
+    light.pointShadowParams[2] = (float)faceTiles[0].Size / kShadowAtlasSize;
+    light.pointShadowParams[3] = paraboloid ? 1.0f : 0.0f;
+
+    for (uint32_t face = 0; face < Lighting::kMaxPointShadowFaces; ++face)
+    {
+        const ShadowAtlasAllocator::Tile& tile = faceTiles[face < numFaces ? face : 0];
+        light.pointShadowFaceOffsets[face * 2 + 0] = (float)tile.X / kShadowAtlasSize;
+        light.pointShadowFaceOffsets[face * 2 + 1] = (float)tile.Y / kShadowAtlasSize;
+    }
+}
+
 void Lighting::InitializeResources( void )
 {
     m_FillLightRootSig.Reset(3, 0);
     m_FillLightRootSig[0].InitAsConstantBuffer(0);
-    m_FillLightRootSig[1].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 0, 2);
+    m_FillLightRootSig[1].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 0, 3);
     m_FillLightRootSig[2].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 0, 2);
     m_FillLightRootSig.Finalize(L"FillLightRS");
 
-    m_FillLightGridCS_8.SetRootSignature(m_FillLightRootSig);
-    m_FillLightGridCS_8.SetComputeShader(g_pFillLightGridCS_8, sizeof(g_pFillLightGridCS_8));
-    m_FillLightGridCS_8.Finalize();
+    // The grid sizes are permutations of one source, which reload when it is edited
+    struct FillLightGridVariant
+    {
+        ComputePSO& PSO;
+        const wchar_t* GroupSize;
+        D3D12_SHADER_BYTECODE Embedded;
+    };
+    const FillLightGridVariant FillLightGridVariants[] =
+    {
+        { m_FillLightGridCS_8,  L"8",  CD3DX12_SHADER_BYTECODE(g_pFillLightGridCS_8,  sizeof(g_pFillLightGridCS_8)) },
+        { m_FillLightGridCS_16, L"16", CD3DX12_SHADER_BYTECODE(g_pFillLightGridCS_16, sizeof(g_pFillLightGridCS_16)) },
+        { m_FillLightGridCS_24, L"24", CD3DX12_SHADER_BYTECODE(g_pFillLightGridCS_24, sizeof(g_pFillLightGridCS_24)) },
+        { m_FillLightGridCS_32, L"32", CD3DX12_SHADER_BYTECODE(g_pFillLightGridCS_32, sizeof(g_pFillLightGridCS_32)) },
+    };
+
+    ShaderCompiler::Permutation* FillLightGridShaders[_countof(FillLightGridVariants)];
+    for (uint32_t i = 0; i < _countof(FillLightGridVariants); ++i)
+    {
+        const FillLightGridVariant& Variant = FillLightGridVariants[i];
+        FillLightGridShaders[i] = &ShaderCompiler::GetPermutation(L"FillLightGridCS.hlsli", L"main", L"cs_6_0",
+            { { L"WORK_GROUP_SIZE_X", Variant.GroupSize }, { L"WORK_GROUP_SIZE_Y", Variant.GroupSize }, { L"WORK_GROUP_SIZE_Z", L"1" } },
+            Variant.Embedded);
+    }
+
+    for (uint32_t i = 0; i < _countof(FillLightGridVariants); ++i)
+    {
+        ComputePSO* PSO = &FillLightGridVariants[i].PSO;
+        ShaderCompiler::Permutation* Shader = FillLightGridShaders[i];
+
+        PSO->SetRootSignature(m_FillLightRootSig);
+        PSO->SetComputeShader(Shader->GetBytecode());
+        PSO->Finalize();
+
+        Shader->OnReload([PSO, Shader]
+        {
+            PSO->SetComputeShader(Shader->GetBytecode());
+            PSO->Finalize();
+        });
+    }
+
+    m_FillLightClustersCS.SetRootSignature(m_FillLightRootSig);
+    m_FillLightClustersCS.SetComputeShader(g_pFillLightClustersCS, sizeof(g_pFillLightClustersCS));
+    m_FillLightClustersCS.Finalize();
+
+    m_FillSuperTilesRootSig.Reset(3, 0);
+    m_FillSuperTilesRootSig[0].InitAsConstantBuffer(0);
+    m_FillSuperTilesRootSig[1].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 0, 2);
+    m_FillSuperTilesRootSig[2].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 0, 1);
+    m_FillSuperTilesRootSig.Finalize(L"FillSuperTilesRS");
+
+    m_FillLightSuperTilesCS.SetRootSignature(m_FillSuperTilesRootSig);
+    m_FillLightSuperTilesCS.SetComputeShader(g_pFillLightSuperTilesCS, sizeof(g_pFillLightSuperTilesCS));
+    m_FillLightSuperTilesCS.Finalize();
+
+    m_LightShadowMatricesRootSig.Reset(3, 0);
+    m_LightShadowMatricesRootSig[0].InitAsBufferSRV(0);
+    m_LightShadowMatricesRootSig[1].InitAsBufferSRV(1);
+    m_LightShadowMatricesRootSig[2].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 0, 2);
+    m_LightShadowMatricesRootSig.Finalize(L"LightShadowMatricesRS");
+
+    m_LightShadowMatricesCS.SetRootSignature(m_LightShadowMatricesRootSig);
+    m_LightShadowMatricesCS.SetComputeShader(g_pLightShadowMatricesCS, sizeof(g_pLightShadowMatricesCS));
+    m_LightShadowMatricesCS.Finalize();
+
+    RemoveAllLights();
+    m_FirstConeLight = kTypeFirstSlot[kConeLight];
+    m_FirstConeShadowedLight = kTypeFirstSlot[kConeShadowedLight];
+    m_FirstPointShadowedLight = kTypeFirstSlot[kPointShadowedLight];
+    for (uint32_t block = 0; block < _countof(m_LightBlockDirty); block++)
+        m_LightBlockDirty[block] = false;
+    for (uint32_t n = 0; n < MaxShadowedLights; n++)
+        m_ShadowDataDirty[n] = false;
+
+    m_LightBuffer.Create(L"m_LightBuffer", MaxLights, sizeof(LightData), m_LightData);
+    m_LightShadowBuffer.Create(L"m_LightShadowBuffer", MaxShadowedLights, sizeof(LightShadowData), m_LightShadowData);
+    m_LightShadowMatrixBuffer.Create(L"m_LightShadowMatrixBuffer", kNumConeShadowedLights, kLightShadowMatrixStride);
+    m_LightShadowMatricesDirty = true;
+
+    // todo: assumes max resolution of 1920x1080
+    uint32_t lightGridCells = Math::DivideByMultiple(1920, kMinLightGridDim) * Math::DivideByMultiple(1080, kMinLightGridDim);
+    // The allocation counter, then the tile headers, then the lists
+    m_LightGridListBase = 4 + lightGridCells * kTileHeaderSize;
+    m_LightGrid.Create(L"m_LightGrid", (m_LightGridListBase + kTileListCapacity * kLightIndexSize) / 4, 4, nullptr);
+
+    uint32_t lightGridBitMaskSizeBytes = lightGridCells * MaxLights / 8;
+    m_LightGridBitMask.Create(L"m_LightGridBitMask", lightGridBitMaskSizeBytes, 1, nullptr);
 
-    m_FillLightGridCS_16.SetRootSignature(m_FillLightRootSig);
-    m_FillLightGridCS_16.SetComputeShader(g_pFillLightGridCS_16, sizeof(g_pFillLightGridCS_16));
-    m_FillLightGridCS_16.Finalize();
+    uint32_t superTiles = Math::DivideByMultiple(1920, kLightSuperTileDim) * Math::DivideByMultiple(1080, kLightSuperTileDim);
+    m_LightSuperTileMask.Create(L"m_LightSuperTileMask", superTiles * MaxLights / 32, 4, nullptr);
 
-    m_FillLightGridCS_24.SetRootSignature(m_FillLightRootSig);
-    m_FillLightGridCS_24.SetComputeShader(g_pFillLightGridCS_24, sizeof(g_pFillLightGridCS_24));
-    m_FillLightGridCS_24.Finalize();
+    // The first dword of the list is the allocation counter
+    m_LightClusters.Create(L"m_LightClusters", lightGridCells * kClusterSlices * 4, 4, nullptr);
+    m_LightClusterList.Create(L"m_LightClusterList", 1 + kClusterListCapacity, 4, nullptr);
 
-    m_FillLightGridCS_32.SetRootSignature(m_FillLightRootSig);
-    m_FillLightGridCS_32.SetComputeShader(g_pFillLightGridCS_32, sizeof(g_pFillLightGridCS_32));
-    m_FillLightGridCS_32.Finalize();
+    m_LightShadowAtlas.Create(L"m_LightShadowAtlas", kShadowAtlasSize, kShadowAtlasSize);
 }
 
 void Lighting::CreateRandomLights( const Vector3 minBound, const Vector3 maxBound )
@@ -149,125 +442,729 @@ void Lighting::CreateRandomLights( const Vector3 minBound, const Vector3 maxBoun
         return Normalize(Vector3(randGaussian(), randGaussian(), randGaussian()));
     };
 
+    RemoveAllLights();
+
+    // Unshadowed lights shrink with their count so that about as many of them overlap a point as before
+    const uint32_t firstShadowedLight = MaxLights - MaxShadowedLights;
+    const float unshadowedRadiusScale = std::cbrt(64.0f / firstShadowedLight);
+
     const float pi = 3.14159265359f;
-    for (uint32_t n = 0; n < MaxLights; n++)
+    for (uint32_t type = 0; type < kNumLightTypes; type++)
     {
-        Vector3 pos = randVecUniform() * posScale + posBias;
-        float lightRadius = randFloat() * 800.0f + 200.0f;
+        for (uint32_t n = kTypeFirstSlot[type]; n < kTypeFirstSlot[type + 1]; n++)
+        {
+            Vector3 pos = randVecUniform() * posScale + posBias;
+            float lightRadius = randFloat() * 800.0f + 200.0f;
+            if (type < kConeShadowedLight)
+                lightRadius *= unshadowedRadiusScale;
 
-        Vector3 color = randVecUniform();
-        float colorScale = randFloat() * .3f + .3f;
-        color = color * colorScale;
+            Vector3 color = randVecUniform();
+            float colorScale = randFloat() * .3f + .3f;
+            color = color * colorScale;
 
-        uint32_t type;
-        // force types to match 32-bit boundaries for the BIT_MASK_SORTED case
-        if (n < 32 * 1)
-            type = 0;
-        else if (n < 32 * 3)
-            type = 1;
-        else
-            type = 2;
+            Vector3 coneDir = randVecGaussian();
+            float coneInner = (randFloat() * .2f + .025f) * pi;
+            float coneOuter = coneInner + randFloat() * .1f * pi;
 
-        Vector3 coneDir = randVecGaussian();
-        float coneInner = (randFloat() * .2f + .025f) * pi;
-        float coneOuter = coneInner + randFloat() * .1f * pi;
+            if (type == kConeLight || type == kConeShadowedLight)
+            {
+                // emphasize cone lights
+                color = color * 5.0f;
+            }
 
-        if (type == 1 || type == 2)
-        {
-            // emphasize cone lights
-            color = color * 5.0f;
+            AddLight((LightType)type, pos, lightRadius, color, coneDir, coneInner, coneOuter);
         }
-
-        Math::Camera shadowCamera;
-        shadowCamera.SetEyeAtUp(pos, pos + coneDir, Vector3(0, 1, 0));
-        shadowCamera.SetPerspectiveMatrix(coneOuter * 2, 1.0f, lightRadius * .05f, lightRadius * 1.0f);
-        shadowCamera.Update();
-        m_LightShadowMatrix[n] = shadowCamera.GetViewProjMatrix();
-        Matrix4 shadowTextureMatrix = Matrix4(AffineTransform(Matrix3::MakeScale( 0.5f, -0.5f, 1.0f ), Vector3(0.5f, 0.5f, 0.0f))) * m_LightShadowMatrix[n];
-
-        m_LightData[n].pos[0] = pos.GetX();
-        m_LightData[n].pos[1] = pos.GetY();
-        m_LightData[n].pos[2] = pos.GetZ();
-        m_LightData[n].radiusSq = lightRadius * lightRadius;
-        m_LightData[n].color[0] = color.GetX();
-        m_LightData[n].color[1] = color.GetY();
-        m_LightData[n].color[2] = color.GetZ();
-        m_LightData[n].type = type;
-        m_LightData[n].coneDir[0] = coneDir.GetX();
-        m_LightData[n].coneDir[1] = coneDir.GetY();
-        m_LightData[n].coneDir[2] = coneDir.GetZ();
-        m_LightData[n].coneAngles[0] = 1.0f / (cos(coneInner) - cos(coneOuter));
-        m_LightData[n].coneAngles[1] = cos(coneOuter);
-        std::memcpy(m_LightData[n].shadowTextureMatrix, &shadowTextureMatrix, sizeof(shadowTextureMatrix));
-        //*(Matrix4*)(m_LightData[n].shadowTextureMatrix) = shadowTextureMatrix;
     }
-    // sort lights by type, needed for efficiency in the BIT_MASK approach
-    /*    {
-    Matrix4 copyLightShadowMatrix[MaxLights];
-    memcpy(copyLightShadowMatrix, m_LightShadowMatrix, sizeof(Matrix4) * MaxLights);
-    LightData copyLightData[MaxLights];
-    memcpy(copyLightData, m_LightData, sizeof(LightData) * MaxLights);
+}
+
+Lighting::LightHandle Lighting::AddLight( LightType type, const Vector3& position, float radius, const Vector3& color,
+    const Vector3& coneDir, float coneInner, float coneOuter )
+{
+    ASSERT(type < kNumLightTypes);
+
+    const uint32_t slot = kTypeFirstSlot[type] + m_LightTypeCount[type];
+    if (slot == kTypeFirstSlot[type + 1])
+        return kInvalidLight;
+
+    m_LightTypeCount[type]++;
+    const LightHandle handle = m_FreeLightHandles.back();
+    m_FreeLightHandles.pop_back();
+    m_SlotToHandle[slot] = handle;
+    m_HandleToSlot[handle] = slot;
+
+    LightData& light = m_LightData[slot];
+    light.radiusSq = radius * radius;
+    light.color[0] = DirectX::PackedVector::XMConvertFloatToHalf(color.GetX());
+    light.color[1] = DirectX::PackedVector::XMConvertFloatToHalf(color.GetY());
+    light.color[2] = DirectX::PackedVector::XMConvertFloatToHalf(color.GetZ());
+    light.type = (uint16_t)type;
+    light.coneAngles[0] = DirectX::PackedVector::XMConvertFloatToHalf(1.0f / (cos(coneInner) - cos(coneOuter)));
+    light.coneAngles[1] = DirectX::PackedVector::XMConvertFloatToHalf(cos(coneOuter));
+
+    // Lights are unshadowed until they are assigned an atlas tile
+    m_LightShadowTile[slot].X = m_LightShadowTile[slot].Y = m_LightShadowTile[slot].Size = 0;
+    for (uint32_t face = 0; face < kMaxPointShadowFaces; ++face)
+        m_PointShadowFaceTile[slot][face] = m_LightShadowTile[slot];
+    m_LightShadowDirty[slot] = false;
+    m_LightShadowLastUpdate[slot] = kShadowNeverUpdated;
+    if (slot >= kFirstShadowedSlot)
+        UpdatePointShadowData(GetShadowData(slot), radius, m_PointShadowFaceTile[slot], kMaxPointShadowFaces, false);
+
+    SetLightPlacement(slot, position, coneDir);
+    return handle;
+}
+
+void Lighting::RemoveLight( LightHandle handle )
+{
+    ASSERT(handle < MaxLights && m_HandleToSlot[handle] != kInvalidLight, "Removing a light that does not exist");
+
+    const uint32_t slot = m_HandleToSlot[handle];
+    const uint32_t type = m_LightData[slot].type;
+    const uint32_t lastSlot = kTypeFirstSlot[type] + --m_LightTypeCount[type];
 
-    uint32_t sortArray[MaxLights];
-    for (uint32_t n = 0; n < MaxLights; n++)
+    // Keep the type packed.  The moved light keeps its atlas tile, so its shadow stays valid.
+    if (slot != lastSlot)
     {
-    sortArray[n] = n;
+        m_LightData[slot] = m_LightData[lastSlot];
+        if (slot >= kFirstShadowedSlot)
+            GetShadowData(slot) = GetShadowData(lastSlot);
+        m_LightShadowTile[slot] = m_LightShadowTile[lastSlot];
+        m_LightShadowDirty[slot] = m_LightShadowDirty[lastSlot];
+        m_LightShadowLastUpdate[slot] = m_LightShadowLastUpdate[lastSlot];
+        for (uint32_t face = 0; face < kMaxPointShadowFaces; ++face)
+            m_PointShadowFaceTile[slot][face] = m_PointShadowFaceTile[lastSlot][face];
+        m_SlotToHandle[slot] = m_SlotToHandle[lastSlot];
+        m_HandleToSlot[m_SlotToHandle[slot]] = slot;
+        MarkLightDataDirty(slot);
     }
-    std::sort(sortArray, sortArray + MaxLights,
-    [this](const uint32_t &a, const uint32_t &b) -> bool
+
+    ClearLightSlot(lastSlot);
+    m_HandleToSlot[handle] = kInvalidLight;
+    m_FreeLightHandles.push_back(handle);
+}
+
+void Lighting::RemoveAllLights( void )
+{
+    for (uint32_t slot = 0; slot < MaxLights; slot++)
+        ClearLightSlot(slot);
+
+    for (uint32_t type = 0; type < kNumLightTypes; type++)
+        m_LightTypeCount[type] = 0;
+
+    // Hand out low handles first
+    m_FreeLightHandles.clear();
+    for (uint32_t handle = MaxLights; handle > 0; handle--)
     {
-    return this->m_LightData[a].type < this->m_LightData[b].type;
-    });
-    for (uint32_t n = 0; n < MaxLights; n++)
+        m_FreeLightHandles.push_back(handle - 1);
+        m_HandleToSlot[handle - 1] = kInvalidLight;
+    }
+}
+
+void Lighting::MoveLight( LightHandle handle, const Vector3& position, const Vector3& coneDir )
+{
+    ASSERT(handle < MaxLights && m_HandleToSlot[handle] != kInvalidLight, "Moving a light that does not exist");
+
+    const uint32_t slot = m_HandleToSlot[handle];
+    SetLightPlacement(slot, position, coneDir);
+
+    // The old shadow is wrong everywhere, so treat it like a new tile that must be filled before it is sampled
+    if (m_LightShadowTile[slot].Size > 0)
     {
-    m_LightShadowMatrix[n] = copyLightShadowMatrix[sortArray[n]];
-    m_LightData[n] = copyLightData[sortArray[n]];
+        m_LightShadowDirty[slot] = true;
+        m_LightShadowLastUpdate[slot] = kShadowNeverUpdated;
     }
-    }*/
-    for (uint32_t n = 0; n < MaxLights; n++)
+}
+
+uint32_t Lighting::GetLightCount( LightType type )
+{
+    ASSERT(type < kNumLightTypes);
+    return m_LightTypeCount[type];
+}
+
+void Lighting::SetLightPlacement( uint32_t slot, const Vector3& position, const Vector3& coneDir )
+{
+    LightData& light = m_LightData[slot];
+    light.pos[0] = position.GetX();
+    light.pos[1] = position.GetY();
+    light.pos[2] = position.GetZ();
+    EncodeConeDir(coneDir, light.coneDir);
+
+    // The shadow matrices are built on the GPU from the uploaded light, see BuildLightShadowMatrices()
+    MarkLightDataDirty(slot);
+}
+
+// An empty slot has no radius, which the grid and cluster builders skip
+void Lighting::ClearLightSlot( uint32_t slot )
+{
+    std::memset(&m_LightData[slot], 0, sizeof(LightData));
+    if (slot >= kFirstShadowedSlot)
+        std::memset(&GetShadowData(slot), 0, sizeof(LightShadowData));
+    m_LightShadowTile[slot].X = m_LightShadowTile[slot].Y = m_LightShadowTile[slot].Size = 0;
+    for (uint32_t face = 0; face < kMaxPointShadowFaces; ++face)
+        m_PointShadowFaceTile[slot][face] = m_LightShadowTile[slot];
+    m_LightShadowDirty[slot] = false;
+    m_LightShadowLastUpdate[slot] = kShadowNeverUpdated;
+    m_SlotToHandle[slot] = kInvalidLight;
+    MarkLightDataDirty(slot);
+}
+
+void Lighting::MarkLightDataDirty( uint32_t slot )
+{
+    m_LightBlockDirty[slot / kUploadBlockLights] = true;
+    if (slot >= kFirstShadowedSlot)
+        m_ShadowDataDirty[slot - kFirstShadowedSlot] = true;
+    if (slot >= kTypeFirstSlot[kConeShadowedLight] && slot < kTypeFirstSlot[kPointShadowedLight])
+        m_LightShadowMatricesDirty = true;
+}
+
+LightShadowData& Lighting::GetShadowData( uint32_t slot )
+{
+    ASSERT(slot >= kFirstShadowedSlot && slot < MaxLights, "Only shadowed lights have shadow data");
+    return m_LightShadowData[slot - kFirstShadowedSlot];
+}
+
+// Copies each run of dirty blocks into the buffer through the context's upload allocator.  Returns whether any was.
+static bool UploadDirtyBlocks( CommandContext& context, StructuredBuffer& buffer, const void* data, size_t blockSize,
+    bool* blockDirty, uint32_t numBlocks )
+{
+    bool transitioned = false;
+    for (uint32_t firstBlock = 0; firstBlock < numBlocks; firstBlock++)
     {
-        if (m_LightData[n].type == 1)
+        if (!blockDirty[firstBlock])
+            continue;
+
+        uint32_t endBlock = firstBlock + 1;
+        while (endBlock < numBlocks && blockDirty[endBlock])
+            endBlock++;
+
+        if (!transitioned)
         {
-            m_FirstConeLight = n;
-            break;
+            context.TransitionResource(buffer, D3D12_RESOURCE_STATE_COPY_DEST, true);
+            transitioned = true;
         }
+
+        context.WriteBuffer(buffer, firstBlock * blockSize, (const uint8_t*)data + firstBlock * blockSize,
+            (endBlock - firstBlock) * blockSize);
+
+        for (uint32_t block = firstBlock; block < endBlock; block++)
+            blockDirty[block] = false;
+        firstBlock = endBlock;
+    }
+
+    if (transitioned)
+        context.TransitionResource(buffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+
+    return transitioned;
+}
+
+void Lighting::UploadLights( CommandContext& context )
+{
+    if (UploadDirtyBlocks(context, m_LightBuffer, m_LightData, kUploadBlockLights * sizeof(LightData), m_LightBlockDirty,
+        MaxLights / kUploadBlockLights))
+    {
+        ++m_LightDataVersion;
     }
-    for (uint32_t n = 0; n < MaxLights; n++)
+    UploadDirtyBlocks(context, m_LightShadowBuffer, m_LightShadowData, sizeof(LightShadowData), m_ShadowDataDirty,
+        MaxShadowedLights);
+
+    // The upload overwrites the texture matrices of the cone lights it touched
+    if (m_LightShadowMatricesDirty)
+        BuildLightShadowMatrices(context.GetComputeContext());
+}
+
+// Rebuilds the matrices of every shadowed cone light on the GPU, so that moving lights costs no CPU matrix math
+void Lighting::BuildLightShadowMatrices( ComputeContext& context )
+{
+    // Half the tile size and the tile center in atlas UV, with w = 0 for lights without a tile
+    __declspec(align(16)) float tileTransforms[kNumConeShadowedLights][4];
+    for (uint32_t i = 0; i < kNumConeShadowedLights; i++)
     {
-        if (m_LightData[n].type == 2)
-        {
-            m_FirstConeShadowedLight = n;
-            break;
-        }
+        const ShadowAtlasAllocator::Tile& tile = m_LightShadowTile[kFirstShadowedSlot + i];
+        const float halfSize = 0.5f * tile.Size / kShadowAtlasSize;
+        tileTransforms[i][0] = halfSize;
+        tileTransforms[i][1] = halfSize + (float)tile.X / kShadowAtlasSize;
+        tileTransforms[i][2] = halfSize + (float)tile.Y / kShadowAtlasSize;
+        tileTransforms[i][3] = tile.Size > 0 ? 1.0f : 0.0f;
     }
-    m_LightBuffer.Create(L"m_LightBuffer", MaxLights, sizeof(LightData), m_LightData);
 
-    // todo: assumes max resolution of 1920x1080
-    uint32_t lightGridCells = Math::DivideByMultiple(1920, kMinLightGridDim) * Math::DivideByMultiple(1080, kMinLightGridDim);
-    uint32_t lightGridSizeBytes = lightGridCells * (4 + MaxLights * 4);
-    m_LightGrid.Create(L"m_LightGrid", lightGridSizeBytes, 1, nullptr);
+    ScopedTimer _prof(L"Light Shadow Matrices", context);
 
-    uint32_t lightGridBitMaskSizeBytes = lightGridCells * 4 * 4;
-    m_LightGridBitMask.Create(L"m_LightGridBitMask", lightGridBitMaskSizeBytes, 1, nullptr);
+    context.SetRootSignature(m_LightShadowMatricesRootSig);
+    context.SetPipelineState(m_LightShadowMatricesCS);
+
+    const D3D12_RESOURCE_STATES readState = D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
+    context.TransitionResource(m_LightBuffer, readState);
+    context.TransitionResource(m_LightShadowBuffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    context.TransitionResource(m_LightShadowMatrixBuffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, true);
+
+    context.SetBufferSRV(0, m_LightBuffer);
+    context.SetDynamicSRV(1, sizeof(tileTransforms), tileTransforms);
+    context.SetDynamicDescriptor(2, 0, m_LightShadowBuffer.GetUAV());
+    context.SetDynamicDescriptor(2, 1, m_LightShadowMatrixBuffer.GetUAV());
+    context.Dispatch(1, 1, 1);
+
+    // The matrices are read by caster culling and bound as the constants of the cone light shadow passes
+    context.TransitionResource(m_LightShadowBuffer, readState);
+    context.TransitionResource(m_LightShadowMatrixBuffer,
+        D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, true);
+
+    m_LightShadowMatricesDirty = false;
+}
 
-    m_LightShadowArray.CreateArray(L"m_LightShadowArray", shadowDim, shadowDim, MaxLights, DXGI_FORMAT_R16_UNORM);
-    m_LightShadowTempBuffer.Create(L"m_LightShadowTempBuffer", shadowDim, shadowDim);
+uint64_t Lighting::GetLightShadowMatrixCBV( uint32_t lightIndex )
+{
+    ASSERT(lightIndex >= m_FirstConeShadowedLight && lightIndex < m_FirstPointShadowedLight, "Only shadowed cone lights have a shadow matrix");
+    return m_LightShadowMatrixBuffer.GetGpuVirtualAddress() + (lightIndex - m_FirstConeShadowedLight) * kLightShadowMatrixStride;
 }
 
 void Lighting::Shutdown(void)
 {
     m_LightBuffer.Destroy();
+    m_LightShadowBuffer.Destroy();
+    m_LightShadowMatrixBuffer.Destroy();
     m_LightGrid.Destroy();
     m_LightGridBitMask.Destroy();
-    m_LightShadowArray.Destroy();
-    m_LightShadowTempBuffer.Destroy();
+    m_LightSuperTileMask.Destroy();
+    m_LightClusters.Destroy();
+    m_LightClusterList.Destroy();
+    m_LightShadowAtlas.Destroy();
+    m_ShadowAtlasCleared = false;
+    m_LightGridValid = false;
 }
 
-void Lighting::FillLightGrid(GraphicsContext& gfxContext, const Camera& camera)
+void Lighting::UpdateShadowAtlas(GraphicsContext& gfxContext, const Camera& camera)
 {
-    ScopedTimer _prof(L"FillLightGrid", gfxContext);
+    // Request a tile roughly as large as the light's bounding sphere on screen
+    const float pixelsPerUnit = DynamicResolution::GetHeight() * 0.5f / tanf(camera.GetFOV() * 0.5f);
+
+    uint32_t requestedSize[MaxLights];
+    uint32_t shadowedLights[MaxLights];
+    uint32_t numShadowedLights = 0;
+
+    // Switching modes changes the number of faces of every point light
+    const bool pointShadowModeChanged = m_PointShadowLayoutMode != PointShadowMode;
+    m_PointShadowLayoutMode = PointShadowMode;
+    const bool paraboloid = m_PointShadowLayoutMode == kPointShadowDualParaboloid;
+    const uint32_t numPointFaces = GetPointShadowFaceCount();
+
+    for (uint32_t n = m_FirstConeShadowedLight; n < MaxLights; n++)
+    {
+        if (m_LightData[n].type != 2 && m_LightData[n].type != 3)
+            continue;
+
+        Vector3 lightPos(m_LightData[n].pos[0], m_LightData[n].pos[1], m_LightData[n].pos[2]);
+        float radius = sqrtf(m_LightData[n].radiusSq);
+        float distance = Length(lightPos - camera.GetPosition());
+
+        float screenSize = ShadowResolutionScale * (distance > radius ?
+            2.0f * radius * pixelsPerUnit / distance : (float)kMaxShadowTileSize);
+
+        // Each face only sees part of a point light's sphere
+        if (m_LightData[n].type == 3)
+            screenSize *= 0.5f;
+
+        uint32_t tileSize = kMinShadowTileSize;
+        while (tileSize < kMaxShadowTileSize && tileSize * 2 <= screenSize)
+            tileSize *= 2;
+
+        // Keep the current size until the screen size is clearly past the next threshold, so that a light
+        // hovering near one does not switch tiles, and re-render, every few frames
+        const uint32_t currentSize = m_LightShadowTile[n].Size;
+        if (currentSize > 0 && tileSize != currentSize)
+        {
+            const float margin = ShadowResolutionHysteresis;
+            if (tileSize > currentSize ? screenSize < currentSize * 2.0f * (1.0f + margin) :
+                screenSize >= currentSize * (1.0f - margin))
+            {
+                tileSize = currentSize;
+            }
+        }
+
+        requestedSize[n] = tileSize;
+        shadowedLights[numShadowedLights++] = n;
+    }
+
+    // Largest tiles first so that the quadtree packs without gaps.  Ties keep light order so that
+    // the same requests always produce the same layout.
+    std::stable_sort(shadowedLights, shadowedLights + numShadowedLights,
+        [&requestedSize](uint32_t a, uint32_t b) { return requestedSize[a] > requestedSize[b]; });
+
+    m_ShadowAtlasAllocator.Reset(kShadowAtlasSize, kMinShadowTileSize);
+
+    // Tiles only clear themselves, so start from a known state
+    if (!m_ShadowAtlasCleared)
+    {
+        gfxContext.TransitionResource(m_LightShadowAtlas, D3D12_RESOURCE_STATE_DEPTH_WRITE, true);
+        gfxContext.ClearDepth(m_LightShadowAtlas);
+        gfxContext.TransitionResource(m_LightShadowAtlas, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+        m_ShadowAtlasCleared = true;
+    }
+
+    for (uint32_t i = 0; i < numShadowedLights; i++)
+    {
+        uint32_t n = shadowedLights[i];
+
+        if (IsPointShadowedLight(n))
+        {
+            // Every face needs a tile of the same size.  Faces allocated before the atlas ran out are lost
+            // until the next layout, which only happens once the atlas is already full.
+            ShadowAtlasAllocator::Tile faceTiles[kMaxPointShadowFaces] = {};
+            for (uint32_t tileSize = requestedSize[n]; tileSize >= kMinShadowTileSize; tileSize /= 2)
+            {
+                uint32_t face = 0;
+                while (face < numPointFaces && m_ShadowAtlasAllocator.Allocate(tileSize, faceTiles[face]))
+                    ++face;
+
+                if (face == numPointFaces)
+                    break;
+
+                for (face = 0; face < numPointFaces; ++face)
+                    faceTiles[face].X = faceTiles[face].Y = faceTiles[face].Size = 0;
+            }
+
+            bool tilesChanged = pointShadowModeChanged;
+            for (uint32_t face = 0; face < numPointFaces; ++face)
+                tilesChanged = tilesChanged || !(faceTiles[face] == m_PointShadowFaceTile[n][face]);
+
+            if (!tilesChanged)
+                continue;
+
+            for (uint32_t face = 0; face < kMaxPointShadowFaces; ++face)
+                m_PointShadowFaceTile[n][face] = faceTiles[face];
+            m_LightShadowTile[n] = faceTiles[0];
+            m_LightShadowDirty[n] = faceTiles[0].Size > 0;
+            m_LightShadowLastUpdate[n] = kShadowNeverUpdated;
+            MarkLightDataDirty(n);
+
+            UpdatePointShadowData(GetShadowData(n), sqrtf(m_LightData[n].radiusSq), faceTiles, numPointFaces, paraboloid);
+            continue;
+        }
+
+        // If the atlas is full, fall back to smaller tiles before giving up on the light
+        ShadowAtlasAllocator::Tile tile = { 0, 0, 0 };
+        for (uint32_t tileSize = requestedSize[n]; tileSize >= kMinShadowTileSize; tileSize /= 2)
+        {
+            if (m_ShadowAtlasAllocator.Allocate(tileSize, tile))
+                break;
+        }
+
+        if (tile == m_LightShadowTile[n])
+            continue;
+
+        m_LightShadowTile[n] = tile;
+        m_LightShadowDirty[n] = tile.Size > 0;
+        m_LightShadowLastUpdate[n] = kShadowNeverUpdated;
+        MarkLightDataDirty(n);
+    }
+
+    UploadLights(gfxContext);
+}
+
+void Lighting::InvalidateShadows(const Vector3& minBound, const Vector3& maxBound)
+{
+    for (uint32_t n = m_FirstConeShadowedLight; n < MaxLights; n++)
+    {
+        if (m_LightShadowTile[n].Size == 0)
+            continue;
+
+        Vector3 lightPos(m_LightData[n].pos[0], m_LightData[n].pos[1], m_LightData[n].pos[2]);
+        Vector3 closestPoint = Min(Max(lightPos, minBound), maxBound);
+        if (LengthSquare(closestPoint - lightPos) <= m_LightData[n].radiusSq)
+            m_LightShadowDirty[n] = true;
+    }
+}
+
+uint32_t Lighting::ScheduleShadowUpdates(uint32_t* lightList)
+{
+    const uint32_t frameIndex = (uint32_t)Graphics::GetFrameCount();
+
+    float priority[MaxLights];
+    uint32_t candidates[MaxLights];
+    uint32_t numCandidates = 0;
+    uint32_t numScheduled = 0;
+
+    for (uint32_t n = m_FirstConeShadowedLight; n < MaxLights; n++)
+    {
+        if (!m_LightShadowDirty[n])
+            continue;
+
+        // A new tile holds whatever was there before, so it must be filled before it is sampled
+        if (m_LightShadowLastUpdate[n] == kShadowNeverUpdated)
+        {
+            lightList[numScheduled++] = n;
+            continue;
+        }
+
+        // Smaller tiles belong to lights that are farther away or cover less of the screen, so they are
+        // refreshed less often:  each halving of the tile size doubles the frames between updates
+        const uint32_t interval = std::min((uint32_t)ShadowMaxUpdateInterval,
+            (uint32_t)kMaxShadowTileSize / m_LightShadowTile[n].Size);
+        if (frameIndex - m_LightShadowLastUpdate[n] < interval)
+            continue;
+
+        // Favor lights that cover more of the screen and lights that have waited longer
+        float tileArea = (float)(m_LightShadowTile[n].Size * m_LightShadowTile[n].Size);
+        priority[n] = tileArea * (float)(frameIndex - m_LightShadowLastUpdate[n]);
+        candidates[numCandidates++] = n;
+    }
+
+    std::stable_sort(candidates, candidates + numCandidates,
+        [&priority](uint32_t a, uint32_t b) { return priority[a] > priority[b]; });
+
+    // Always make progress, even when a single light costs more than the whole budget
+    float estimatedCost = numScheduled * m_ShadowUpdateCostPerLight;
+    for (uint32_t i = 0; i < numCandidates; i++)
+    {
+        if (numScheduled > 0 && estimatedCost + m_ShadowUpdateCostPerLight > ShadowUpdateBudget)
+            break;
+
+        lightList[numScheduled++] = candidates[i];
+        estimatedCost += m_ShadowUpdateCostPerLight;
+    }
+
+    for (uint32_t i = 0; i < numScheduled; i++)
+    {
+        m_LightShadowDirty[lightList[i]] = false;
+        m_LightShadowLastUpdate[lightList[i]] = frameIndex;
+    }
+
+    return numScheduled;
+}
+
+void Lighting::ReportShadowUpdateCost(float gpuMilliseconds, uint32_t numLightsRendered)
+{
+    // Invalid or missing timings read back as zero
+    if (numLightsRendered == 0 || gpuMilliseconds <= 0.0f)
+        return;
+
+    m_ShadowUpdateCostPerLight += (gpuMilliseconds / numLightsRendered - m_ShadowUpdateCostPerLight) * 0.1f;
+}
+
+bool Lighting::IsPointShadowedLight(uint32_t lightIndex)
+{
+    return m_LightData[lightIndex].type == 3;
+}
+
+uint32_t Lighting::GetPointShadowFaceCount(void)
+{
+    return m_PointShadowLayoutMode == kPointShadowDualParaboloid ? 2 : kMaxPointShadowFaces;
+}
+
+void Lighting::GetPointShadowConstants(uint32_t lightIndex, PointShadowConstants& constants)
+{
+    const LightData& light = m_LightData[lightIndex];
+    const bool paraboloid = m_PointShadowLayoutMode == kPointShadowDualParaboloid;
+
+    constants.LightPos[0] = light.pos[0];
+    constants.LightPos[1] = light.pos[1];
+    constants.LightPos[2] = light.pos[2];
+    constants.Pad = 0.0f;
+    GetPointShadowDepthParams(sqrtf(light.radiusSq), paraboloid, constants.ShadowParams);
+    constants.ShadowParams[2] = 0.0f;
+    constants.ShadowParams[3] = paraboloid ? 1.0f : 0.0f;
+}
+
+uint32_t Lighting::GetPointShadowCullViews(uint32_t lightIndex, Matrix4* views)
+{
+    const LightData& light = m_LightData[lightIndex];
+    const Vector3 lightPos(light.pos[0], light.pos[1], light.pos[2]);
+    const float radius = sqrtf(light.radiusSq);
+
+    Matrix4 proj;
+    if (m_PointShadowLayoutMode == kPointShadowDualParaboloid)
+    {
+        // The box around the hemisphere in front of the face
+        proj = Matrix4(
+            Vector4(1.0f / radius, 0.0f, 0.0f, 0.0f),
+            Vector4(0.0f, 1.0f / radius, 0.0f, 0.0f),
+            Vector4(0.0f, 0.0f, -1.0f / radius, 0.0f),
+            Vector4(0.0f, 0.0f, 0.0f, 1.0f));
+    }
+    else
+    {
+        float depthParams[2];
+        GetPointShadowDepthParams(radius, false, depthParams);
+        proj = Matrix4(
+            Vector4(1.0f, 0.0f, 0.0f, 0.0f),
+            Vector4(0.0f, 1.0f, 0.0f, 0.0f),
+            Vector4(0.0f, 0.0f, depthParams[0], -1.0f),
+            Vector4(0.0f, 0.0f, depthParams[1], 0.0f));
+    }
+
+    const uint32_t numFaces = GetPointShadowFaceCount();
+    for (uint32_t face = 0; face < numFaces; ++face)
+    {
+        Matrix3 rotation = GetPointShadowFaceRotation(face);
+        views[face] = proj * Matrix4(AffineTransform(rotation, rotation * -lightPos));
+    }
+    return numFaces;
+}
+
+void Lighting::GetClusterParams(const Camera& camera, float params[4])
+{
+    // Slices split log2(view depth) evenly between the near and far clip distances
+    const float sliceScale = kClusterSlices / std::log2(camera.GetFarClip() / camera.GetNearClip());
+    params[0] = ClusteredLighting ? 1.0f : 0.0f;
+    params[1] = sliceScale;
+    params[2] = -std::log2(camera.GetNearClip()) * sliceScale;
+    params[3] = 0.0f;
+}
+
+uint32_t Lighting::GetTileAlignment(void)
+{
+    // The least common multiple of the two tile sizes
+    uint32_t a = kLightSuperTileDim, b = (uint32_t)LightGridDim;
+    while (b != 0)
+    {
+        const uint32_t r = a % b;
+        a = b;
+        b = r;
+    }
+    return kLightSuperTileDim / a * (uint32_t)LightGridDim;
+}
+
+// A single view culls every tile with the camera's matrix
+void Lighting::GetGridMatrices(const Camera& camera, const GridViews* views, Matrix4& viewProj, uint32_t& splitX,
+    Matrix4& splitViewProj)
+{
+    if (views == nullptr)
+    {
+        viewProj = camera.GetViewProjMatrix();
+        splitX = 0xFFFFFFFF;
+        splitViewProj = viewProj;
+    }
+    else
+    {
+        viewProj = *views->ViewProj[0];
+        splitX = views->SplitX;
+        splitViewProj = *views->ViewProj[1];
+    }
+}
+
+// Bins the lights into the super tiles, leaving their masks readable by the fine passes
+void Lighting::DispatchLightSuperTiles(ComputeContext& Context, const Camera& camera, const GridViews* views)
+{
+    ScopedTimer _prof(L"Super Tiles", Context);
+
+    Context.SetRootSignature(m_FillSuperTilesRootSig);
+    Context.SetPipelineState(m_FillLightSuperTilesCS);
+
+    ColorBuffer& LinearDepth = g_LinearDepth[ Graphics::GetFrameCount() % 2 ];
+
+    Context.TransitionResource(m_LightBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    Context.TransitionResource(LinearDepth, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    Context.TransitionResource(m_LightSuperTileMask, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+
+    Context.SetDynamicDescriptor(1, 0, m_LightBuffer.GetSRV());
+    Context.SetDynamicDescriptor(1, 1, LinearDepth.GetSRV());
+    Context.SetDynamicDescriptor(2, 0, m_LightSuperTileMask.GetUAV());
+
+    uint32_t superTileCountX = Math::DivideByMultiple(DynamicResolution::GetWidth(), kLightSuperTileDim);
+    uint32_t superTileCountY = Math::DivideByMultiple(DynamicResolution::GetHeight(), kLightSuperTileDim);
+
+    float FarClipDist = camera.GetFarClip();
+    float NearClipDist = camera.GetNearClip();
+
+    struct CSConstants
+    {
+        uint32_t ViewportWidth, ViewportHeight;
+        float RcpZMagic;
+        uint32_t SuperTileCountX;
+        Matrix4 ViewProjMatrix;
+        uint32_t FillFrontClusters;
+        uint32_t SplitX;
+        Matrix4 SplitViewProjMatrix;
+    } csConstants;
+    csConstants.ViewportWidth = DynamicResolution::GetWidth();
+    csConstants.ViewportHeight = DynamicResolution::GetHeight();
+    csConstants.RcpZMagic = NearClipDist / (FarClipDist - NearClipDist);
+    csConstants.SuperTileCountX = superTileCountX;
+    csConstants.FillFrontClusters = ClusteredLighting && m_FillFrontClusters ? 1 : 0;
+    GetGridMatrices(camera, views, csConstants.ViewProjMatrix, csConstants.SplitX, csConstants.SplitViewProjMatrix);
+    Context.SetDynamicConstantBufferView(0, sizeof(CSConstants), &csConstants);
+
+    Context.Dispatch(superTileCountX, superTileCountY, 1);
+
+    Context.TransitionResource(m_LightSuperTileMask, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+}
+
+// Bins the lights into the clusters, leaving the cluster buffers in the unordered access state
+void Lighting::DispatchLightClusters(ComputeContext& Context, const Camera& camera, const GridViews* views)
+{
+    ScopedTimer _prof(L"Clusters", Context);
+
+    Context.SetRootSignature(m_FillLightRootSig);
+    Context.SetPipelineState(m_FillLightClustersCS);
 
-    ComputeContext& Context = gfxContext.GetComputeContext();
+    ColorBuffer& LinearDepth = g_LinearDepth[ Graphics::GetFrameCount() % 2 ];
+
+    Context.TransitionResource(m_LightBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    Context.TransitionResource(LinearDepth, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    Context.TransitionResource(m_LightClusters, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    Context.FillBuffer(m_LightClusterList, 0, 0u, sizeof(uint32_t));
+    Context.TransitionResource(m_LightClusterList, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+
+    Context.SetDynamicDescriptor(1, 0, m_LightBuffer.GetSRV());
+    Context.SetDynamicDescriptor(1, 1, LinearDepth.GetSRV());
+    Context.SetDynamicDescriptor(1, 2, m_LightSuperTileMask.GetSRV());
+    Context.SetDynamicDescriptor(2, 0, m_LightClusters.GetUAV());
+    Context.SetDynamicDescriptor(2, 1, m_LightClusterList.GetUAV());
+
+    uint32_t tileCountX = Math::DivideByMultiple(DynamicResolution::GetWidth(), LightGridDim);
+    uint32_t tileCountY = Math::DivideByMultiple(DynamicResolution::GetHeight(), LightGridDim);
+
+    float clusterParams[4];
+    GetClusterParams(camera, clusterParams);
+
+    __declspec(align(16)) struct CSConstants
+    {
+        uint32_t ViewportWidth, ViewportHeight;
+        uint32_t TileDim;
+        uint32_t TileCountX;
+        Matrix4 ViewProjMatrix;
+        Vector4 CameraPos;          // w holds FarClip
+        Vector4 CameraForward;      // w holds SliceScale
+        float SliceBias;
+        uint32_t ListCapacity;
+        uint32_t FirstConeLight;
+        uint32_t FirstConeShadowedLight;
+        uint32_t FirstPointShadowedLight;
+        uint32_t SuperTileCountX;
+        uint32_t FillFrontClusters;
+        uint32_t SplitX;
+        Matrix4 SplitViewProjMatrix;
+    } csConstants;
+    csConstants.ViewportWidth = DynamicResolution::GetWidth();
+    csConstants.ViewportHeight = DynamicResolution::GetHeight();
+    csConstants.TileDim = LightGridDim;
+    csConstants.TileCountX = tileCountX;
+    csConstants.CameraPos = Vector4(camera.GetPosition(), camera.GetFarClip());
+    csConstants.CameraForward = Vector4(camera.GetForwardVec(), clusterParams[1]);
+    csConstants.SliceBias = clusterParams[2];
+    csConstants.ListCapacity = 1 + kClusterListCapacity;
+    csConstants.FirstConeLight = m_FirstConeLight;
+    csConstants.FirstConeShadowedLight = m_FirstConeShadowedLight;
+    csConstants.FirstPointShadowedLight = m_FirstPointShadowedLight;
+    csConstants.SuperTileCountX = Math::DivideByMultiple(DynamicResolution::GetWidth(), kLightSuperTileDim);
+    csConstants.FillFrontClusters = m_FillFrontClusters ? 1 : 0;
+    GetGridMatrices(camera, views, csConstants.ViewProjMatrix, csConstants.SplitX, csConstants.SplitViewProjMatrix);
+    Context.SetDynamicConstantBufferView(0, sizeof(CSConstants), &csConstants);
+
+    Context.Dispatch(tileCountX, tileCountY, 1);
+}
+
+// Bins the lights into the super tiles and then into the grid, leaving the grid in the unordered access state
+void Lighting::DispatchLightGrid(ComputeContext& Context, const Camera& camera, const GridViews* views)
+{
+    DispatchLightSuperTiles(Context, camera, views);
+
+    if (ClusteredLighting)
+    {
+        DispatchLightClusters(Context, camera, views);
+        return;
+    }
+
+    ScopedTimer _prof(L"Fine Tiles", Context);
 
     Context.SetRootSignature(m_FillLightRootSig);
 
@@ -285,18 +1182,20 @@ void Lighting::FillLightGrid(GraphicsContext& gfxContext, const Camera& camera)
     Context.TransitionResource(m_LightBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
     Context.TransitionResource(LinearDepth, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
     Context.TransitionResource(g_SceneDepthBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    Context.FillBuffer(m_LightGrid, 0, 0u, sizeof(uint32_t));
     Context.TransitionResource(m_LightGrid, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
     Context.TransitionResource(m_LightGridBitMask, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
 
     Context.SetDynamicDescriptor(1, 0, m_LightBuffer.GetSRV());
     Context.SetDynamicDescriptor(1, 1, LinearDepth.GetSRV());
     //Context.SetDynamicDescriptor(1, 1, g_SceneDepthBuffer.GetDepthSRV());
+    Context.SetDynamicDescriptor(1, 2, m_LightSuperTileMask.GetSRV());
     Context.SetDynamicDescriptor(2, 0, m_LightGrid.GetUAV());
     Context.SetDynamicDescriptor(2, 1, m_LightGridBitMask.GetUAV());
 
     // todo: assumes 1920x1080 resolution
-    uint32_t tileCountX = Math::DivideByMultiple(g_SceneColorBuffer.GetWidth(), LightGridDim);
-    uint32_t tileCountY = Math::DivideByMultiple(g_SceneColorBuffer.GetHeight(), LightGridDim);
+    uint32_t tileCountX = Math::DivideByMultiple(DynamicResolution::GetWidth(), LightGridDim);
+    uint32_t tileCountY = Math::DivideByMultiple(DynamicResolution::GetHeight(), LightGridDim);
 
     float FarClipDist = camera.GetFarClip();
     float NearClipDist = camera.GetNearClip();
@@ -308,19 +1207,79 @@ void Lighting::FillLightGrid(GraphicsContext& gfxContext, const Camera& camera)
         float InvTileDim;
         float RcpZMagic;
         uint32_t TileCount;
+        uint32_t SuperTileCountX;
         Matrix4 ViewProjMatrix;
+        uint32_t ListBase;
+        uint32_t ListEnd;
+        uint32_t SplitX;
+        Matrix4 SplitViewProjMatrix;
     } csConstants;
     // todo: assumes 1920x1080 resolution
-    csConstants.ViewportWidth = g_SceneColorBuffer.GetWidth();
-    csConstants.ViewportHeight = g_SceneColorBuffer.GetHeight();
+    csConstants.ViewportWidth = DynamicResolution::GetWidth();
+    csConstants.ViewportHeight = DynamicResolution::GetHeight();
     csConstants.InvTileDim = 1.0f / LightGridDim;
     csConstants.RcpZMagic = RcpZMagic;
     csConstants.TileCount = tileCountX;
-    csConstants.ViewProjMatrix = camera.GetViewProjMatrix();
+    csConstants.SuperTileCountX = Math::DivideByMultiple(DynamicResolution::GetWidth(), kLightSuperTileDim);
+    csConstants.ListBase = m_LightGridListBase;
+    csConstants.ListEnd = (uint32_t)m_LightGrid.GetBufferSize();
+    GetGridMatrices(camera, views, csConstants.ViewProjMatrix, csConstants.SplitX, csConstants.SplitViewProjMatrix);
     Context.SetDynamicConstantBufferView(0, sizeof(CSConstants), &csConstants);
 
     Context.Dispatch(tileCountX, tileCountY, 1);
+}
+
+// Records what the grid is about to be built from, and returns false when that is what it was last built from
+bool Lighting::NeedsLightGridRebuild(const Camera& camera, const GridViews* views, uint32_t depthVersion)
+{
+    LightGridInputs inputs;
+    GetGridMatrices(camera, views, inputs.ViewProj, inputs.SplitX, inputs.SplitViewProj);
+    inputs.NearClip = camera.GetNearClip();
+    inputs.FarClip = camera.GetFarClip();
+    inputs.Width = DynamicResolution::GetWidth();
+    inputs.Height = DynamicResolution::GetHeight();
+    inputs.TileDim = LightGridDim;
+    inputs.Clustered = ClusteredLighting;
+    inputs.FillFrontClusters = m_FillFrontClusters;
+    inputs.LightVersion = m_LightDataVersion;
+    inputs.DepthVersion = depthVersion;
+
+    const LightGridInputs& last = m_LightGridInputs;
+    const bool unchanged = m_LightGridValid && LazyLightGrid && depthVersion != kDepthVersionUnknown &&
+        std::memcmp(&inputs.ViewProj, &last.ViewProj, sizeof(Matrix4)) == 0 &&
+        std::memcmp(&inputs.SplitViewProj, &last.SplitViewProj, sizeof(Matrix4)) == 0 &&
+        inputs.SplitX == last.SplitX && inputs.NearClip == last.NearClip && inputs.FarClip == last.FarClip &&
+        inputs.Width == last.Width && inputs.Height == last.Height && inputs.TileDim == last.TileDim &&
+        inputs.Clustered == last.Clustered && inputs.FillFrontClusters == last.FillFrontClusters &&
+        inputs.LightVersion == last.LightVersion && inputs.DepthVersion == last.DepthVersion;
+
+    m_LightGridInputs = inputs;
+    m_LightGridValid = true;
+    return !unchanged;
+}
+
+void Lighting::FillLightGrid(GraphicsContext& gfxContext, const Camera& camera, const GridViews* views, uint32_t depthVersion)
+{
+    // The grid buffers keep what they held, and are left in the same states as after building them
+    if (!NeedsLightGridRebuild(camera, views, depthVersion))
+        return;
+
+    ScopedTimer _prof(L"FillLightGrid", gfxContext);
+
+    DispatchLightGrid(gfxContext.GetComputeContext(), camera, views);
+
+    gfxContext.TransitionResource(m_LightGrid, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+    gfxContext.TransitionResource(m_LightGridBitMask, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+    gfxContext.TransitionResource(m_LightClusters, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+    gfxContext.TransitionResource(m_LightClusterList, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+}
+
+void Lighting::FillLightGrid(ComputeContext& asyncContext, const Camera& camera, const GridViews* views, uint32_t depthVersion)
+{
+    if (!NeedsLightGridRebuild(camera, views, depthVersion))
+        return;
+
+    ScopedTimer _prof(L"FillLightGrid", asyncContext);
 
-    Context.TransitionResource(m_LightGrid, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-    Context.TransitionResource(m_LightGridBitMask, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+    DispatchLightGrid(asyncContext, camera, views);
 }
@@ -17,13 +17,18 @@
 //using namespace Graphics;
 
 #include <cstdint>
+#include "ShadowAtlasAllocator.h"
 
 class StructuredBuffer;
 class ByteAddressBuffer;
 class ColorBuffer;
 class ShadowBuffer;
 class GraphicsContext;
+class ComputeContext;
+class BoolVar;
 class IntVar;
+class NumVar;
+class EnumVar;
 namespace Math
 {
     class Vector3;
@@ -34,23 +39,139 @@ namespace Math
 namespace Lighting
 {
     extern IntVar LightGridDim;
+    extern NumVar ShadowUpdateBudget;
+    extern BoolVar ClusteredLighting;
 
-    enum { MaxLights = 128 };
+    // Keep in sync with LightGrid.hlsli.  Only the last MaxShadowedLights lights cast shadows.
+    enum { MaxLights = 1024, MaxShadowedLights = 64 };
+    enum { kClusterSlices = 16 };
+
+    // Each type owns a fixed range of the light buffer: half of the unshadowed slots each for point and
+    // cone lights, then half of the shadowed slots each for shadowed cone and point lights
+    enum LightType { kPointLight, kConeLight, kConeShadowedLight, kPointShadowedLight, kNumLightTypes };
+
+    // Lights are referred to by handles that stay valid until they are removed.  The lights of a type stay
+    // packed at the start of the type's range, so removing one moves the type's last light into its slot.
+    typedef std::uint32_t LightHandle;
+    enum : LightHandle { kInvalidLight = 0xFFFFFFFF };
+
+    // Returns kInvalidLight when the type's range is full.  Cone angles are in radians from the axis.
+    LightHandle AddLight(LightType type, const Math::Vector3& position, float radius, const Math::Vector3& color,
+        const Math::Vector3& coneDir, float coneInner, float coneOuter);
+    void RemoveLight(LightHandle light);
+    void RemoveAllLights(void);
+
+    // Moving a shadowed light re-renders its shadow with the next shadow update
+    void MoveLight(LightHandle light, const Math::Vector3& position, const Math::Vector3& coneDir);
+
+    std::uint32_t GetLightCount(LightType type);
+
+    // Shadowed point lights render a cube map, or a cheaper dual paraboloid map that needs only two faces
+    enum { kPointShadowCube, kPointShadowDualParaboloid, kNumPointShadowModes };
+    enum { kMaxPointShadowFaces = 6 };
+    extern EnumVar PointShadowMode;
 
     //LightData m_LightData[MaxLights];
     extern StructuredBuffer m_LightBuffer;
+    // The shadow terms of the shadowed lights, kept apart so the light loops only fetch them for those lights
+    extern StructuredBuffer m_LightShadowBuffer;
     extern ByteAddressBuffer m_LightGrid;
 
     extern ByteAddressBuffer m_LightGridBitMask;
     extern std::uint32_t m_FirstConeLight;
     extern std::uint32_t m_FirstConeShadowedLight;
+    extern std::uint32_t m_FirstPointShadowedLight;
+
+    // Clustered lighting splits every grid tile into kClusterSlices exponentially spaced depth slices.
+    // m_LightClusters holds a header per cluster, and m_LightClusterList the light indices they point to.
+    extern ByteAddressBuffer m_LightClusters;
+    extern ByteAddressBuffer m_LightClusterList;
+
+    // Volumetric lighting lights the air in front of the geometry and over the sky.  While this is set, every
+    // cluster up to the farthest geometry of its tile gets a list, and all of them where the tile shows sky.
+    extern bool m_FillFrontClusters;
+
+    // Constants the color pass needs to find its cluster: enable, slice scale and slice bias
+    void GetClusterParams(const Math::Camera& camera, float params[4]);
+
+    // Shadowed cone and point lights render into tiles of a shared atlas sized by their screen coverage.
+    // Lights that need re-rendering are flagged dirty until ScheduleShadowUpdates() picks them.
+    extern ShadowBuffer m_LightShadowAtlas;
+    extern ShadowAtlasAllocator::Tile m_LightShadowTile[MaxLights];
+    extern bool m_LightShadowDirty[MaxLights];
+
+    // The shadow view-projection of each shadowed cone light, by light index - m_FirstConeShadowedLight.  They are
+    // built on the GPU from the light buffer, far enough apart to bind each as a CBV.
+    extern StructuredBuffer m_LightShadowMatrixBuffer;
+    enum { kLightShadowMatrixStride = 256 };
+
+    // Address of the constants for rendering a shadowed cone light with DepthViewerVS
+    std::uint64_t GetLightShadowMatrixCBV(std::uint32_t lightIndex);
+
+    // Every face of a shadowed point light gets its own tile of the same size.  m_LightShadowTile holds
+    // the first face.
+    extern ShadowAtlasAllocator::Tile m_PointShadowFaceTile[MaxLights][kMaxPointShadowFaces];
 
-    extern ColorBuffer m_LightShadowArray;
-    extern ShadowBuffer m_LightShadowTempBuffer;
-    extern Math::Matrix4 m_LightShadowMatrix[MaxLights];
+    // Constants for DepthViewerPointShadowVS.  Keep in sync with HLSL.
+    __declspec(align(16)) struct PointShadowConstants
+    {
+        float LightPos[3];
+        float Pad;
+        float ShadowParams[4];
+    };
+
+    bool IsPointShadowedLight(std::uint32_t lightIndex);
+    std::uint32_t GetPointShadowFaceCount(void);
+    void GetPointShadowConstants(std::uint32_t lightIndex, PointShadowConstants& constants);
+
+    // Writes a view-projection matrix per face that bounds what the face renders, for culling, and
+    // returns the number of faces
+    std::uint32_t GetPointShadowCullViews(std::uint32_t lightIndex, Math::Matrix4* views);
 
     void InitializeResources(void);
+
+    // Replaces every light with a random set filling each type's range
     void CreateRandomLights(const Math::Vector3 minBound, const Math::Vector3 maxBound);
-    void FillLightGrid(GraphicsContext& gfxContext, const Math::Camera& camera);
+
+    // Also uploads the slots of the light buffer that changed since the last update, and rebuilds the shadow
+    // matrices of the cone lights from them on the GPU
+    void UpdateShadowAtlas(GraphicsContext& gfxContext, const Math::Camera& camera);
+
+    // Flags every shadowed light whose range overlaps the box, e.g. because a caster inside it moved
+    void InvalidateShadows(const Math::Vector3& minBound, const Math::Vector3& maxBound);
+
+    // Writes the dirty lights that fit in this frame's ShadowUpdateBudget to lightList, most important
+    // first, and returns how many there are.  Lights with a newly assigned tile are always included.  Others
+    // wait longer between updates the smaller their tile is.
+    std::uint32_t ScheduleShadowUpdates(std::uint32_t* lightList);
+
+    // Feeds the measured GPU cost of a past schedule back into the per-light cost estimate
+    void ReportShadowUpdateCost(float gpuMilliseconds, std::uint32_t numLightsRendered);
+
+    // Multi-view frames lay their views side by side and fill one grid for all of them.  The tiles before SplitX
+    // are culled with the first matrix and the rest with the second, each mapping the world to the clip space of
+    // the whole target.  The views share the camera's clip distances and forward direction.
+    struct GridViews
+    {
+        const Math::Matrix4* ViewProj[2];
+        std::uint32_t SplitX;
+    };
+
+    // A split between views must fall on a multiple of this many pixels, so that no tile straddles it
+    std::uint32_t GetTileAlignment(void);
+
+    // The grid is only built again when the camera, the views, the lights, the grid settings or depthVersion
+    // changed since it was last built.  The caller changes depthVersion whenever anything the depth pre-pass
+    // draws may have moved.  With kDepthVersionUnknown the grid is built every frame.
+    enum : std::uint32_t { kDepthVersionUnknown = 0xFFFFFFFF };
+
+    void FillLightGrid(GraphicsContext& gfxContext, const Math::Camera& camera, const GridViews* views = nullptr,
+        std::uint32_t depthVersion = kDepthVersionUnknown);
+
+    // Fills the grid on a compute queue context.  The graphics queue must leave the light buffer, linear depth
+    // and depth buffer as non-pixel shader resources first, and transition the grid to a pixel shader resource
+    // once it has waited for the compute queue.
+    void FillLightGrid(ComputeContext& asyncContext, const Math::Camera& camera, const GridViews* views = nullptr,
+        std::uint32_t depthVersion = kDepthVersionUnknown);
     void Shutdown(void);
 }
@@ -0,0 +1,257 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "HiZCulling.h"
+#include "PipelineState.h"
+#include "RootSignature.h"
+#include "CommandContext.h"
+#include "CommandSignature.h"
+#include "BufferManager.h"
+#include "DynamicResolution.h"
+#include "ColorBuffer.h"
+#include "Camera.h"
+#include "Model.h"
+#include "SinglePassDownsample.h"
+#include "./DrawStatistics.h"
+#include <algorithm>
+
+#include "CompiledShaders/HiZCullCS.h"
+
+using namespace Math;
+using namespace Graphics;
+
+// must keep in sync with HLSL
+struct MeshInfo
+{
+    XMFLOAT3 BoundsMin;
+    uint32_t IndexCount;
+    XMFLOAT3 BoundsMax;
+    uint32_t StartIndex;
+    uint32_t BaseVertex;
+    uint32_t MaterialIndex;
+    uint32_t BaseVertexDepth;
+    uint32_t Pad;
+};
+
+struct DrawCommand
+{
+    uint32_t BaseVertex;
+    uint32_t MaterialIndex;
+    uint32_t ViewMask;
+    D3D12_DRAW_INDEXED_ARGUMENTS DrawArgs;
+};
+
+namespace HiZCulling
+{
+    BoolVar Enable("Application/View Culling/GPU Occlusion", true);
+
+    // The single pass downsample writes at most this many levels
+    enum { kMaxLevels = SinglePassDownsample::kMaxMips };
+
+    RootSignature m_CullRootSig;
+    ComputePSO m_CullCS;
+    CommandSignature m_DrawCommandSignature(2);
+
+    StructuredBuffer m_MeshBuffer;
+    uint32_t m_NumMeshes = 0;
+    uint64_t m_NumTriangles = 0;
+
+    // A list of draws and a count for each phase, followed by the triangles of each phase's draws, and whether
+    // each mesh was visible at the end of last frame.  The draw statistics copy the triangles from the counts.
+    StructuredBuffer m_DrawCommandBuffer;
+    ByteAddressBuffer m_DrawCountBuffer;
+    ByteAddressBuffer m_VisibilityBuffer;
+
+    // Level 0 is half the size of the depth buffer, rounded up to a power of two
+    ColorBuffer m_HiZBuffer;
+    uint32_t m_HiZLevels = 0;
+
+    const D3D12_RESOURCE_STATES kDrawCountState = D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT | D3D12_RESOURCE_STATE_COPY_SOURCE;
+
+    void Cull(GraphicsContext& gfxContext, const Camera& camera, uint32_t Phase);
+    void BuildDepthPyramid(GraphicsContext& gfxContext);
+}
+
+void HiZCulling::InitializeResources( const RootSignature& DrawRootSig, const Model& model, const std::vector<bool>& MaterialIsCutout )
+{
+    m_CullRootSig.Reset(4, 0);
+    m_CullRootSig[0].InitAsConstantBuffer(0);
+    m_CullRootSig[1].InitAsBufferSRV(0);
+    m_CullRootSig[2].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 1);
+    m_CullRootSig[3].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 0, 3);
+    m_CullRootSig.Finalize(L"Hi-Z Culling");
+
+    m_CullCS.SetRootSignature(m_CullRootSig);
+    m_CullCS.SetComputeShader(g_pHiZCullCS, sizeof(g_pHiZCullCS));
+    m_CullCS.Finalize();
+
+    // Matches the root constants that DrawObjects() sets
+    m_DrawCommandSignature[0].Constant(4, 0, 3);
+    m_DrawCommandSignature[1].DrawIndexed();
+    m_DrawCommandSignature.Finalize(&DrawRootSig);
+
+    auto NextPowerOfTwo = []( uint32_t x ) { uint32_t p = 1; while (p < x) p *= 2; return p; };
+    const uint32_t HiZWidth = std::max(NextPowerOfTwo((uint32_t)g_SceneDepthBuffer.GetWidth()) / 2, 1u);
+    const uint32_t HiZHeight = std::max(NextPowerOfTwo((uint32_t)g_SceneDepthBuffer.GetHeight()) / 2, 1u);
+    m_HiZLevels = 1;
+    while ((HiZWidth | HiZHeight) >> m_HiZLevels)
+        ++m_HiZLevels;
+    m_HiZLevels = std::min<uint32_t>(m_HiZLevels, kMaxLevels);
+    m_HiZBuffer.Create(L"Hi-Z Depth Pyramid", HiZWidth, HiZHeight, m_HiZLevels, DXGI_FORMAT_R32_FLOAT);
+
+    std::vector<MeshInfo> Meshes;
+    Meshes.reserve(model.m_Header.meshCount);
+
+    for (uint32_t meshIndex = 0; meshIndex < model.m_Header.meshCount; meshIndex++)
+    {
+        const Model::Mesh& mesh = model.m_pMesh[meshIndex];
+        if (MaterialIsCutout[mesh.materialIndex])
+            continue;
+
+        MeshInfo Info;
+        XMStoreFloat3(&Info.BoundsMin, mesh.boundingBox.min);
+        XMStoreFloat3(&Info.BoundsMax, mesh.boundingBox.max);
+        Info.IndexCount = mesh.indexCount;
+        Info.StartIndex = model.GetStartIndex(mesh.indexDataByteOffset);
+        Info.BaseVertex = model.GetBaseVertex(mesh, false);
+        Info.MaterialIndex = mesh.materialIndex;
+        Info.BaseVertexDepth = model.GetBaseVertex(mesh, true);
+        Info.Pad = 0;
+        Meshes.push_back(Info);
+        m_NumTriangles += mesh.indexCount / 3;
+    }
+
+    m_NumMeshes = (uint32_t)Meshes.size();
+    if (m_NumMeshes == 0)
+        return;
+
+    // Everything counts as visible in the first frame, which makes it draw every mesh in the first phase
+    std::vector<uint32_t> Visible(m_NumMeshes, 1);
+
+    m_MeshBuffer.Create(L"Hi-Z Culling Meshes", m_NumMeshes, sizeof(MeshInfo), Meshes.data());
+    // A list per phase for each vertex stream
+    m_DrawCommandBuffer.Create(L"Hi-Z Culling Draws", 4 * m_NumMeshes, sizeof(DrawCommand));
+    m_DrawCountBuffer.Create(L"Hi-Z Culling Draw Counts", 4, sizeof(uint32_t));
+    m_VisibilityBuffer.Create(L"Hi-Z Culling Visibility", m_NumMeshes, sizeof(uint32_t), Visible.data());
+}
+
+void HiZCulling::Shutdown( void )
+{
+    m_DrawCommandSignature.Destroy();
+    m_MeshBuffer.Destroy();
+    m_DrawCommandBuffer.Destroy();
+    m_DrawCountBuffer.Destroy();
+    m_VisibilityBuffer.Destroy();
+    m_HiZBuffer.Destroy();
+    m_NumMeshes = 0;
+    m_NumTriangles = 0;
+}
+
+void HiZCulling::CullFirstPhase( GraphicsContext& gfxContext, const Camera& camera )
+{
+    if (m_NumMeshes == 0)
+        return;
+
+    ScopedTimer _prof(L"Hi-Z Cull Phase 1", gfxContext);
+    Cull(gfxContext, camera, 0);
+}
+
+void HiZCulling::CullSecondPhase( GraphicsContext& gfxContext, const Camera& camera )
+{
+    if (m_NumMeshes == 0)
+        return;
+
+    ScopedTimer _prof(L"Hi-Z Cull Phase 2", gfxContext);
+    BuildDepthPyramid(gfxContext);
+    Cull(gfxContext, camera, 1);
+    gfxContext.TransitionResource(g_SceneDepthBuffer, D3D12_RESOURCE_STATE_DEPTH_WRITE, true);
+}
+
+void HiZCulling::BuildDepthPyramid( GraphicsContext& gfxContext )
+{
+    ComputeContext& Context = gfxContext.GetComputeContext();
+
+    Context.TransitionResource(g_SceneDepthBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    Context.TransitionResource(m_HiZBuffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, true);
+
+    // Every texel holds the farthest depth of the 2x2 texels below it, and reversed depth makes that the smallest.
+    // The pyramid covers twice its size of the depth buffer, and texels past its edge read 0, which never occludes.
+    D3D12_CPU_DESCRIPTOR_HANDLE Levels[kMaxLevels];
+    for (uint32_t Level = 0; Level < m_HiZLevels; ++Level)
+        Levels[Level] = m_HiZBuffer.GetMipUAV(Level);
+
+    SinglePassDownsample::Downsample(Context, SinglePassDownsample::kMinimum, g_SceneDepthBuffer.GetDepthSRV(),
+        m_HiZBuffer.GetWidth() * 2, m_HiZBuffer.GetHeight() * 2, Levels, m_HiZLevels);
+
+    Context.TransitionResource(m_HiZBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+}
+
+void HiZCulling::Cull( GraphicsContext& gfxContext, const Camera& camera, uint32_t Phase )
+{
+    __declspec(align(16)) struct
+    {
+        Matrix4 ViewProj;
+        uint32_t NumMeshes;
+        uint32_t Phase;
+        uint32_t ViewportSize[2];
+        uint32_t HiZLevels;
+    } csConstants;
+    csConstants.ViewProj = camera.GetViewProjMatrix();
+    csConstants.NumMeshes = m_NumMeshes;
+    csConstants.Phase = Phase;
+    csConstants.ViewportSize[0] = DynamicResolution::GetWidth();
+    csConstants.ViewportSize[1] = DynamicResolution::GetHeight();
+    csConstants.HiZLevels = m_HiZLevels;
+
+    ComputeContext& Context = gfxContext.GetComputeContext();
+
+    Context.TransitionResource(m_DrawCountBuffer, D3D12_RESOURCE_STATE_COPY_DEST, true);
+    Context.FillBuffer(m_DrawCountBuffer, Phase * sizeof(uint32_t), 0.0f, sizeof(uint32_t));
+    Context.FillBuffer(m_DrawCountBuffer, (2 + Phase) * sizeof(uint32_t), 0.0f, sizeof(uint32_t));
+
+    Context.TransitionResource(m_DrawCountBuffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    Context.TransitionResource(m_DrawCommandBuffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    Context.TransitionResource(m_VisibilityBuffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    Context.TransitionResource(m_HiZBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, true);
+
+    Context.SetRootSignature(m_CullRootSig);
+    Context.SetPipelineState(m_CullCS);
+    Context.SetDynamicConstantBufferView(0, sizeof(csConstants), &csConstants);
+    Context.SetBufferSRV(1, m_MeshBuffer);
+    Context.SetDynamicDescriptor(2, 0, m_HiZBuffer.GetSRV());
+    Context.SetDynamicDescriptor(3, 0, m_DrawCommandBuffer.GetUAV());
+    Context.SetDynamicDescriptor(3, 1, m_DrawCountBuffer.GetUAV());
+    Context.SetDynamicDescriptor(3, 2, m_VisibilityBuffer.GetUAV());
+    Context.Dispatch(Math::DivideByMultiple(m_NumMeshes, 64), 1, 1);
+
+    Context.TransitionResource(m_DrawCommandBuffer, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT);
+    Context.TransitionResource(m_DrawCountBuffer, kDrawCountState);
+}
+
+void HiZCulling::Draw( GraphicsContext& gfxContext, uint32_t PhaseMask, bool DepthOnlyStream )
+{
+    if (m_NumMeshes == 0)
+        return;
+
+    const uint32_t FirstList = DepthOnlyStream ? 2 : 0;
+
+    for (uint32_t Phase = 0; Phase < 2; ++Phase)
+    {
+        if (PhaseMask & (1 << Phase))
+        {
+            gfxContext.ExecuteIndirect(m_DrawCommandSignature, m_DrawCommandBuffer, (FirstList + Phase) * m_NumMeshes * sizeof(DrawCommand),
+                m_NumMeshes, &m_DrawCountBuffer, Phase * sizeof(uint32_t));
+
+            // Between them the phases test every mesh once, so the second brings the candidates
+            const bool SecondPhase = Phase == 1;
+            DrawStatistics::AddCulledDraws(gfxContext, SecondPhase ? m_NumMeshes : 0, SecondPhase ? m_NumTriangles : 0,
+                m_DrawCountBuffer, (2 + Phase) * sizeof(uint32_t));
+        }
+    }
+}
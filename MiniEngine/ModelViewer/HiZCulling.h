@@ -0,0 +1,49 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+class Model;
+class RootSignature;
+class GraphicsContext;
+class BoolVar;
+namespace Math
+{
+    class Camera;
+}
+
+// Two-phase GPU occlusion culling of the opaque meshes of the main view.  The first phase draws the meshes
+// that were visible last frame.  A Hi-Z pyramid is then built from the depth they leave, every mesh is tested
+// against it, and the second phase draws the meshes that have just come into view.  The visibility carries
+// over to the next frame, so meshes are only drawn late in the frame they appear.  Draws come from
+// ExecuteIndirect and cannot change material descriptors, so passes must not need material textures bound.
+namespace HiZCulling
+{
+    extern BoolVar Enable;
+
+    enum { kFirstPhase = 0x1, kSecondPhase = 0x2, kBothPhases = 0x3 };
+
+    // The command signature sets the root constants of DrawRootSig, so draws must use that root signature
+    void InitializeResources(const RootSignature& DrawRootSig, const Model& model, const std::vector<bool>& MaterialIsCutout);
+    void Shutdown(void);
+
+    // Writes the first phase's draws, the meshes visible last frame that are inside the camera's frustum
+    void CullFirstPhase(GraphicsContext& gfxContext, const Math::Camera& camera);
+
+    // Builds the Hi-Z pyramid from g_SceneDepthBuffer once the first phase is drawn, then tests every mesh
+    // against it and writes the second phase's draws.  The depth buffer is left for depth writes.
+    void CullSecondPhase(GraphicsContext& gfxContext, const Math::Camera& camera);
+
+    // Draws the culled meshes of the phases in the mask with the currently bound PSO, from whichever of the
+    // model's vertex streams is bound
+    void Draw(GraphicsContext& gfxContext, uint32_t PhaseMask, bool DepthOnlyStream);
+}
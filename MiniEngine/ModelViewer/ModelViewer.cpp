@@ -16,8 +16,10 @@
 #include "GraphicsCore.h"
 #include "CameraController.h"
 #include "BufferManager.h"
+#include "DynamicResolution.h"
 #include "Camera.h"
 #include "Model.h"
+#include "ModelSkinning.h"
 #include "GpuBuffer.h"
 #include "CommandContext.h"
 #include "SamplerManager.h"
@@ -30,37 +32,89 @@
 #include "SystemTime.h"
 #include "TextRenderer.h"
 #include "ShadowCamera.h"
+#include "CascadedShadowCamera.h"
 #include "ParticleEffectManager.h"
 #include "GameInput.h"
+#include "GpuTimeManager.h"
+#include "CpuProfiler.h"
 #include "./ForwardPlusLighting.h"
+#include "./CascadedShadows.h"
+#include "./ShadowCasterCulling.h"
+#include "./SoftwareShadowRaster.h"
+#include "./DrawList.h"
+#include "./StaticBundles.h"
+#include "./ViewCulling.h"
+#include "./HiZCulling.h"
+#include "./ShadowMoments.h"
+#include "./SoftShadows.h"
+#include "./VirtualShadowMap.h"
+#include "./SunShadowMask.h"
+#include "./VariableRateShading.h"
+#include "./VolumetricLighting.h"
+#include "./DepthPrepass.h"
+#include "./DrawStatistics.h"
+#include "./TextureFeedback.h"
+#include "./Benchmark.h"
+#include "./SceneInstances.h"
+#include "./MultiView.h"
+#include "JobSystem.h"
+#include "AssetIO.h"
+#include "TextureStreaming.h"
+#include "GeometryStreaming.h"
+#include "FrameArena.h"
+#include <cmath>
+#include <algorithm>
+#include <functional>
 
 // To enable wave intrinsics, uncomment this macro and #define DXIL in Core/GraphcisCore.cpp.
 // Run CompileSM6Test.bat to compile the relevant shaders with DXC.
 //#define _WAVE_OP
 
 #include "CompiledShaders/DepthViewerVS.h"
+#include "CompiledShaders/DepthViewerCutoutVS.h"
 #include "CompiledShaders/DepthViewerPS.h"
+#include "CompiledShaders/DepthViewerCascadeVS.h"
+#include "CompiledShaders/DepthViewerCascadeCutoutVS.h"
+#include "CompiledShaders/DepthViewerPointShadowVS.h"
+#include "CompiledShaders/DepthViewerPointShadowCutoutVS.h"
 #include "CompiledShaders/ModelViewerVS.h"
 #include "CompiledShaders/ModelViewerPS.h"
+#include "CompiledShaders/ModelViewerBindlessPS.h"
+#include "CompiledShaders/DepthViewerBindlessPS.h"
+#include "CompiledShaders/DepthViewerMultiViewVS.h"
+#include "CompiledShaders/DepthViewerMultiViewCutoutVS.h"
+#include "CompiledShaders/ModelViewerMultiViewVS.h"
 #ifdef _WAVE_OP
 #include "CompiledShaders/DepthViewerVS_SM6.h"
 #include "CompiledShaders/ModelViewerVS_SM6.h"
 #include "CompiledShaders/ModelViewerPS_SM6.h"
+#include "CompiledShaders/ModelViewerPS_SM6_ScalarLoop.h"
+#include "CompiledShaders/ModelViewerPS_SM6_ScalarBranch.h"
 #endif
 #include "CompiledShaders/WaveTileCountPS.h"
+#include "CompiledShaders/DepthOverdrawPS.h"
 
 using namespace GameCore;
 using namespace Math;
 using namespace Graphics;
 
+#ifdef _WAVE_OP
+// Tile light loops of the SM 6.0 color pass, one PSO each.  See the options in ModelViewerPS.hlsl.
+enum { kWaveLightLoopBitMask, kWaveLightLoopScalarLoop, kWaveLightLoopScalarBranch, kNumWaveLightLoops };
+#endif
+
 class ModelViewer : public GameCore::IGameApp
 {
 public:
 
-    ModelViewer( void ) {}
+    ModelViewer( void ) : m_SunShadowMap(nullptr), m_ShadowCacheValid(false), m_ShadowCacheResource(nullptr),
+        m_ShadowCacheGeometryVersion(0), m_ScrollingCascadesValid(false), m_ScrollingCascadeGeometryVersion(0), m_LightShadowTimer(0), m_LightShadowGeometryVersion(0),
+        m_LightShadowMomentsValid(false), m_LightShadowPyramidValid(false), m_BindlessSupported(false),
+        m_DrawInstances(nullptr), m_MeshLODVersion(0), m_MeshShadowLODVersion(0), m_ResidencyVersion(0), m_SceneMotionVersion(0), m_AnimationTime(0.0f) {}
 
     virtual void Startup( void ) override;
     virtual void Cleanup( void ) override;
+    virtual bool IsDone( void ) override;
 
     virtual void Update( float deltaT ) override;
     virtual void RenderScene( void ) override;
@@ -68,9 +122,70 @@ public:
 private:
 
     void RenderLightShadows(GraphicsContext& gfxContext);
-
-    enum eObjectFilter { kOpaque = 0x1, kCutout = 0x2, kTransparent = 0x4, kAll = 0xF, kNone = 0x0 };
+    void RenderCascadedShadows(GraphicsContext& gfxContext);
+    void RenderCascadedShadowsSinglePass(GraphicsContext& gfxContext, uint32_t NumCascades);
+    // Draws only the texels of the scrolling cascades that came into view since they were last rendered
+    void RenderScrollingCascades(GraphicsContext& gfxContext, uint32_t FirstCascade);
+    // Cascades fitted to the depth buffer move every frame, so only frustum fitted ones can scroll
+    uint32_t GetFirstScrollingCascade( void ) const;
+    void RenderCachedSunShadow(GraphicsContext& gfxContext);
+    void RenderVirtualSunShadow(GraphicsContext& gfxContext);
+
+    // Filters without kStatic or kDynamic draw meshes of either mobility.  kSkipMaterials leaves the material
+    // textures unbound, for PSOs without a pixel shader.  kVisible draws only the meshes view culling left
+    // visible, for the main view.  kShadowLOD draws the coarser levels of detail chosen for shadow views.
+    // kHardwareRaster skips the meshes the last RasterizeSmallCasters() drew in compute.
+    enum eObjectFilter { kOpaque = 0x1, kCutout = 0x2, kTransparent = 0x4, kAll = 0xF, kNone = 0x0,
+        kStatic = 0x10, kDynamic = 0x20, kSkipMaterials = 0x40, kVisible = 0x80, kShadowLOD = 0x100, kHardwareRaster = 0x200,
+        kOccluder = 0x400 };
     void RenderObjects( GraphicsContext& Context, const Matrix4& ViewProjMat, eObjectFilter Filter = kAll );
+    // Opaque depth passes fetch only positions from the depth-only vertex stream.  This binds it for the
+    // draws and then binds the full stream again.
+    void RenderObjectsDepth( GraphicsContext& Context, const Matrix4& ViewProjMat, eObjectFilter Filter );
+    void SetVertexStream( GraphicsContext& Context, bool DepthOnlyStream );
+    // Each mesh is drawn with one instance per view for the multi-view shaders.  Only meshes in
+    // [FirstMesh, EndMesh) are drawn, counted in the camera's sorted order for the visible meshes.  Single
+    // view draws of the whole list are submitted from the DrawList, and otherwise the static meshes of passes that
+    // draw every mesh in the range are replayed from a bundle.
+    // With scene instances, each mesh is drawn with the instances of the last SetInstanceView() instead.
+    void DrawObjects( GraphicsContext& Context, eObjectFilter Filter, uint32_t NumViews = 1, bool DepthOnlyStream = false,
+        uint32_t FirstMesh = 0, uint32_t EndMesh = ~0u );
+    // Records the draws DrawObjects() would make of the static meshes in [FirstMesh, EndMesh) into a bundle
+    void RecordStaticDraws( ID3D12GraphicsCommandList* Bundle, D3D12_GPU_DESCRIPTOR_HANDLE MaterialTables, eObjectFilter Filter,
+        uint32_t NumViews, bool DepthOnlyStream, uint32_t FirstMesh, uint32_t EndMesh, uint32_t& NumDraws, uint64_t& NumTriangles );
+    // Records a pass in chunks of the mesh list, each on its own context in the worker pool, when parallel
+    // recording is enabled.  Otherwise the whole list is recorded on gfxContext.  RecordChunk starts from an
+    // empty context, so it must bind all of its state, and it must not transition resources.
+    typedef std::function<void(GraphicsContext& Context, uint32_t FirstMesh, uint32_t EndMesh)> RecordChunkFunc;
+    void RecordObjects( GraphicsContext& gfxContext, const RecordChunkFunc& RecordChunk );
+    // Picks each mesh's level of detail for the frame from its projected size in the main camera.  The versions
+    // change whenever a level does.  Streamed meshes ask for their finer levels and stay at the resident one.
+    void SelectMeshLODs( void );
+    void SetVSConstants( GraphicsContext& Context, const Matrix4& ViewProjMat );
+    // Culls the scene instances to the views and draws from List until the next call.  Parallel chunks share
+    // the list, so this must be called ahead of recording them.
+    void SetInstanceView( SceneInstances::VisibleList& List, const Matrix4* ViewProjs, uint32_t NumViews );
+    // The GPU caster culling draws each mesh once with its model transform, so scene instances are drawn
+    // from the CPU lists instead.  It also draws every mesh and meshlet whole, which streamed geometry may lack.
+    bool UseCasterCulling( void ) const
+    {
+        return ShadowCasterCulling::Enable && !SceneInstances::IsActive() && !m_Model.IsGeometryStreamed();
+    }
+    // Draws every caster with the shadow PSOs.  The VS constants must already be bound.
+    void RenderShadowCasters( GraphicsContext& Context, uint32_t CullSlot );
+    // Draws the sun shadow casters made of tiny triangles into Target with the compute rasterizer.  Returns the
+    // filter that the hardware draws of the opaque casters must add, and restores the default graphics state.
+    eObjectFilter RasterizeSmallCasters( GraphicsContext& Context, const Matrix4& ViewProjMat, ShadowBuffer& Target,
+        bool ShadowLOD );
+    // The state every command list starts from
+    void SetupGraphicsState( GraphicsContext& Context );
+    // Recreates the sun shadow maps and their PSOs when the selected depth format changes
+    void UpdateSunShadowFormat( void );
+    void CreateSunShadowPSOs( void );
+    // Recreates the sun shadow maps and the buffers derived from them at a new size.  Cascades are half of it.
+    void ResizeSunShadows( uint32_t Size );
+    // Adds a benchmark configuration for each sun shadow technique and resolution
+    void AddShadowSweep( void );
     void CreateParticleEffects();
     Camera m_Camera;
     std::auto_ptr<CameraController> m_CameraController;
@@ -84,23 +199,105 @@ private:
     GraphicsPSO m_ModelPSO;
 #ifdef _WAVE_OP
     GraphicsPSO m_DepthWaveOpsPSO;
-    GraphicsPSO m_ModelWaveOpsPSO;
+    GraphicsPSO m_ModelWaveOpsPSO[kNumWaveLightLoops];
 #endif
     GraphicsPSO m_CutoutModelPSO;
+    // Color passes that write the depth of the meshes a restricted depth pre-pass left out
+    GraphicsPSO m_ModelDepthWritePSO;
+    GraphicsPSO m_OverdrawPSO;
     GraphicsPSO m_ShadowPSO;
     GraphicsPSO m_CutoutShadowPSO;
+    GraphicsPSO m_SunShadowPSO;            // Match the format of g_ShadowBuffer and g_StaticShadowBuffer
+    GraphicsPSO m_CutoutSunShadowPSO;
+    GraphicsPSO m_CascadeShadowPSO;
+    GraphicsPSO m_CutoutCascadeShadowPSO;
+    GraphicsPSO m_PointShadowPSO;
+    GraphicsPSO m_CutoutPointShadowPSO;
     GraphicsPSO m_WaveTileCountPSO;
 
+    // The camera passes of multi-view frames, which draw an instance per eye.  They bind material textures.
+    GraphicsPSO m_MultiViewDepthPSO;
+    GraphicsPSO m_MultiViewCutoutDepthPSO;
+    GraphicsPSO m_MultiViewModelPSO;
+    GraphicsPSO m_MultiViewCutoutModelPSO;
+
+    // The bindless PSOs read material textures from the persistent descriptor region, so that the draws of
+    // different materials need no descriptor copies.  Needs resource binding tier 2 for the unbounded table.
+    bool m_BindlessSupported;
+    GraphicsPSO m_BindlessModelPSO;
+    GraphicsPSO m_BindlessCutoutModelPSO;
+    GraphicsPSO m_BindlessCutoutDepthPSO;
+    GraphicsPSO m_BindlessModelDepthWritePSO;
+
     D3D12_CPU_DESCRIPTOR_HANDLE m_DefaultSampler;
     D3D12_CPU_DESCRIPTOR_HANDLE m_ShadowSampler;
     D3D12_CPU_DESCRIPTOR_HANDLE m_BiasedDefaultSampler;
 
-    D3D12_CPU_DESCRIPTOR_HANDLE m_ExtraTextures[6];
+    D3D12_CPU_DESCRIPTOR_HANDLE m_ExtraTextures[17];
     Model m_Model;
+    Model::VertexDecode m_VertexDecode;
+    ModelSkinning m_Skinning;
+    float m_AnimationTime;
     std::vector<bool> m_pMaterialIsCutout;
+    std::vector<bool> m_MeshIsVisible;
+    std::vector<uint32_t> m_MeshDrawOrder;
+    std::vector<bool> m_MeshIsOccluder;
+    std::vector<uint8_t> m_MeshLOD;
+    std::vector<uint8_t> m_MeshShadowLOD;
+    uint32_t m_MeshLODVersion;
+    uint32_t m_MeshShadowLODVersion;
+    std::vector<uint8_t> m_MeshIsSoftwareRaster;
+
+    // The finest level each streamed mesh can be drawn at.  Shadows cached from the static meshes are drawn
+    // again when the model changes, or when streaming changes one of these.
+    std::vector<uint8_t> m_MeshResidentLOD;
+    uint32_t m_ResidencyVersion;
+    uint32_t GetCachedGeometryVersion( void ) const { return m_Model.GetStaticGeometryVersion() + m_ResidencyVersion; }
+
+    // Changes on every frame that moves instances, dynamic meshes or the animated pose.  With the geometry and LOD
+    // versions it tells the light grid when the depth it was built from may have changed.
+    uint32_t m_SceneMotionVersion;
+    uint32_t GetSceneDepthVersion( void ) const { return GetCachedGeometryVersion() + m_MeshLODVersion + m_SceneMotionVersion; }
+
+    // The scene instances the camera sees, those of the shadow view being rendered, and the list drawn from
+    SceneInstances::VisibleList m_CameraInstances;
+    SceneInstances::VisibleList m_ShadowInstances;
+    const SceneInstances::VisibleList* m_DrawInstances;
 
     Vector3 m_SunDirection;
     ShadowCamera m_SunShadow;
+    CascadedShadowCamera m_SunCascades;
+    ShadowCamera m_VirtualSunShadow;
+
+    // The sun shadow map sampled this frame, which may be the static cache itself
+    ShadowBuffer* m_SunShadowMap;
+
+    // Tracks what the static casters in g_StaticShadowBuffer were rendered with
+    bool m_ShadowCacheValid;
+    ID3D12Resource* m_ShadowCacheResource;
+    uint32_t m_ShadowCacheGeometryVersion;
+
+    // Where each scrolling cascade's view was when its slice was last drawn
+    struct ScrolledCascade
+    {
+        uint32_t Epoch;
+        int32_t TexelX;
+        int32_t TexelY;
+    };
+    ScrolledCascade m_ScrolledCascades[CascadedShadowCamera::kMaxCascades];
+    bool m_ScrollingCascadesValid;
+    uint32_t m_ScrollingCascadeGeometryVersion;
+
+    // GPU time spent on light shadows is read back two frames late, so remember how many lights
+    // each recent frame rendered
+    uint32_t m_LightShadowTimer;
+    uint32_t m_LightShadowUpdateCount[4];
+    uint32_t m_LightShadowGeometryVersion;
+
+    // Whether every light atlas tile has been converted to moments or a depth pyramid since the
+    // filter that needs it was enabled
+    bool m_LightShadowMomentsValid;
+    bool m_LightShadowPyramidValid;
 };
 
 CREATE_APPLICATION( ModelViewer )
@@ -109,13 +306,68 @@ ExpVar m_SunLightIntensity("Application/Lighting/Sun Light Intensity", 4.0f, 0.0
 ExpVar m_AmbientIntensity("Application/Lighting/Ambient Intensity", 0.1f, -16.0f, 16.0f, 0.1f);
 NumVar m_SunOrientation("Application/Lighting/Sun Orientation", -0.5f, -100.0f, 100.0f, 0.1f );
 NumVar m_SunInclination("Application/Lighting/Sun Inclination", 0.75f, 0.0f, 1.0f, 0.01f );
+
+namespace EngineProfiling
+{
+    extern BoolVar DrawProfiler;
+}
 NumVar ShadowDimX("Application/Lighting/Shadow Dim X", 5000, 1000, 10000, 100 );
 NumVar ShadowDimY("Application/Lighting/Shadow Dim Y", 3000, 1000, 10000, 100 );
 NumVar ShadowDimZ("Application/Lighting/Shadow Dim Z", 3000, 1000, 10000, 100 );
 
+BoolVar EnableCascadedShadows("Application/Lighting/Cascades/Enable", true);
+IntVar ShadowCascadeCount("Application/Lighting/Cascades/Count", 4, 2, CascadedShadowCamera::kMaxCascades);
+NumVar ShadowCascadeLambda("Application/Lighting/Cascades/Split Lambda", 0.8f, 0.0f, 1.0f, 0.05f);
+NumVar ShadowCascadeDistance("Application/Lighting/Cascades/Shadow Distance", 4000, 500, 10000, 100 );
+NumVar ShadowCascadeBlend("Application/Lighting/Cascades/Blend Range", 0.1f, 0.0f, 0.5f, 0.01f);
+BoolVar ShadowCascadeSinglePass("Application/Lighting/Cascades/Single Pass", true);
+BoolVar ShadowCascadeScrolling("Application/Lighting/Cascades/Scroll Far Cascades", true);
+IntVar ShadowCascadeScrollFrom("Application/Lighting/Cascades/Scroll From", 2, 1, CascadedShadowCamera::kMaxCascades);
+
+BoolVar EnableShadowCache("Application/Lighting/Cache Static Shadows", true);
+
+// While TAA accumulates the image, the sun shadow filter can take a few taps of a Poisson disk rotated every
+// frame instead of its fixed nine
+BoolVar TemporalShadowFilter("Application/Lighting/Temporal Shadow Filter", false);
+IntVar TemporalShadowTaps("Application/Lighting/Temporal Shadow Taps", 4, 2, 4);
+
+// The single sun shadow map covers the whole scene, so it benefits the most from float depth.  Cascades
+// and light shadows stay D16_UNORM.
+enum { kShadowFormatD16, kShadowFormatD32, kNumShadowFormats };
+const char* ShadowFormatLabels[] = { "D16", "D32F" };
+EnumVar SunShadowFormat("Application/Lighting/Sun Shadow Format", kShadowFormatD16, kNumShadowFormats, ShadowFormatLabels);
+
 BoolVar ShowWaveTileCounts("Application/Forward+/Show Wave Tile Counts", false);
+
+// Each mesh draws its coarsest level whose simplification error projects to no more than the threshold.
+// Shadow views accept the error times the bias, since their texels rarely match the screen's pixels.
+BoolVar EnableLOD("Application/LOD/Enable", true);
+NumVar LODErrorPixels("Application/LOD/Error Threshold (pixels)", 1.0f, 0.25f, 16.0f, 0.25f);
+NumVar ShadowLODBias("Application/LOD/Shadow Bias", 4.0f, 1.0f, 16.0f, 0.5f);
+
+// Skinned models play one of their animations, skinned once a frame for every pass that draws them.  A clip
+// past the model's last holds the bind pose.
+BoolVar EnableAnimation("Application/Animation/Enable", true);
+IntVar AnimationClip("Application/Animation/Clip", 0, 0, 255);
+NumVar AnimationSpeed("Application/Animation/Speed", 1.0f, 0.0f, 4.0f, 0.1f);
+
+// The Z pre-pass and color pass index material textures by the draw's material index rather than binding them
+BoolVar BindlessMaterials("Application/Bindless Materials", true);
+
+// The depth pre-pass, uncached sun shadow map and color pass can record their draws on worker threads
+BoolVar ParallelRecording("Application/Parallel Recording/Enable", false);
+IntVar ParallelChunks("Application/Parallel Recording/Chunks", 4, 2, 16);
+
+// SSAO, the light grid and (optionally) the particle update run on the compute queue while the graphics queue
+// rasterizes the sun shadows, which are bound by depth throughput and leave the shader cores idle
+BoolVar AsyncComputeOverlap("Application/Async Compute/Overlap Shadows", false);
+BoolVar AsyncParticleUpdate("Application/Async Compute/Particle Update", true);
 #ifdef _WAVE_OP
 BoolVar EnableWaveOps("Application/Forward+/Enable Wave Ops", true);
+// Bit Mask walks the union of the wave's tile masks with scalar light fetches.  The scalar loop and branch
+// variants walk the tile lists, scalarized over the distinct tiles of the wave.
+const char* WaveLightLoopLabels[] = { "Bit Mask", "Scalar Loop", "Scalar Branch" };
+EnumVar WaveLightLoop("Application/Forward+/Wave Light Loop", kWaveLightLoopBitMask, kNumWaveLightLoops, WaveLightLoopLabels);
 #endif
 
 void ModelViewer::Startup( void )
@@ -123,34 +375,75 @@ void ModelViewer::Startup( void )
     SamplerDesc DefaultSamplerDesc;
     DefaultSamplerDesc.MaxAnisotropy = 8;
 
-    m_RootSig.Reset(5, 2);
+    SamplerDesc MomentSamplerDesc = DefaultSamplerDesc;
+    MomentSamplerDesc.SetTextureAddressMode(D3D12_TEXTURE_ADDRESS_MODE_CLAMP);
+
+    D3D12_FEATURE_DATA_D3D12_OPTIONS Options = {};
+    m_BindlessSupported = SUCCEEDED(g_Device->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS, &Options, sizeof(Options))) &&
+        Options.ResourceBindingTier >= D3D12_RESOURCE_BINDING_TIER_2;
+
+    // Scrolling shadow cascades are addressed toroidally
+    SamplerDesc ShadowWrapSamplerDesc = SamplerShadowDesc;
+    ShadowWrapSamplerDesc.AddressU = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
+    ShadowWrapSamplerDesc.AddressV = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
+
+    m_RootSig.Reset(m_BindlessSupported ? 8 : 7, 4);
     m_RootSig.InitStaticSampler(0, DefaultSamplerDesc, D3D12_SHADER_VISIBILITY_PIXEL);
     m_RootSig.InitStaticSampler(1, SamplerShadowDesc, D3D12_SHADER_VISIBILITY_PIXEL);
+    m_RootSig.InitStaticSampler(2, MomentSamplerDesc, D3D12_SHADER_VISIBILITY_PIXEL);
+    m_RootSig.InitStaticSampler(3, ShadowWrapSamplerDesc, D3D12_SHADER_VISIBILITY_PIXEL);
     m_RootSig[0].InitAsConstantBuffer(0, D3D12_SHADER_VISIBILITY_VERTEX);
     m_RootSig[1].InitAsConstantBuffer(0, D3D12_SHADER_VISIBILITY_PIXEL);
     m_RootSig[2].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 0, 6, D3D12_SHADER_VISIBILITY_PIXEL);
-    m_RootSig[3].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 64, 6, D3D12_SHADER_VISIBILITY_PIXEL);
-    m_RootSig[4].InitAsConstants(1, 2, D3D12_SHADER_VISIBILITY_VERTEX);
+    m_RootSig[3].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 64, 17, D3D12_SHADER_VISIBILITY_PIXEL);
+    m_RootSig[4].InitAsConstants(1, 3);
+    m_RootSig[5].InitAsConstants(2, sizeof(Model::VertexDecode) / 4, D3D12_SHADER_VISIBILITY_VERTEX);
+    m_RootSig[6].InitAsBufferUAV(0, D3D12_SHADER_VISIBILITY_PIXEL);
+    if (m_BindlessSupported)
+    {
+        m_RootSig[7].InitAsDescriptorTable(1, D3D12_SHADER_VISIBILITY_PIXEL);
+        m_RootSig[7].SetTableRange(0, D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 0, DynamicDescriptorHeap::kNumPersistentDescriptors, 1);
+        m_RootSig.SetPersistentTable(7);
+    }
     m_RootSig.Finalize(L"ModelViewer", D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
 
     DXGI_FORMAT ColorFormat = g_SceneColorBuffer.GetFormat();
     DXGI_FORMAT DepthFormat = g_SceneDepthBuffer.GetFormat();
 
-    D3D12_INPUT_ELEMENT_DESC vertElem[] =
-    {
-        { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-        { "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-        { "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-        { "TANGENT", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-        { "BITANGENT", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
-    };
+    // The input layouts follow the model's vertex formats, which may be quantized
+    TextureManager::Initialize(L"Textures/");
+    ASSERT(m_Model.Load("Models/sponza.h3d"), "Failed to load model");
+    AssetIO::ReportThroughput("Model load");
+    ASSERT(m_Model.m_Header.meshCount > 0, "Model contains no meshes");
+    m_VertexDecode = m_Model.GetVertexDecode();
+    m_Skinning.Create(m_Model);
+
+    std::vector<D3D12_INPUT_ELEMENT_DESC> vertElem = m_Model.GetInputLayout(false);
+
+    // Opaque depth passes only read positions, so they use the depth-only stream
+    std::vector<D3D12_INPUT_ELEMENT_DESC> depthVertElem = m_Model.GetInputLayout(true);
+
+    // Alpha tested depth passes read the full stream, but only fetch the position and texture coordinates
+    std::vector<D3D12_INPUT_ELEMENT_DESC> cutoutVertElem(vertElem.begin(), vertElem.begin() + 2);
+
+    // Every layout reads the world transform of the instance from a second stream.  The multi-view shaders
+    // spend their instances on views, so theirs only steps from one draw to the next.
+    std::vector<D3D12_INPUT_ELEMENT_DESC> multiViewElem = vertElem;
+    std::vector<D3D12_INPUT_ELEMENT_DESC> depthMultiViewElem = depthVertElem;
+    std::vector<D3D12_INPUT_ELEMENT_DESC> cutoutMultiViewElem = cutoutVertElem;
+    SceneInstances::AppendInputLayout(vertElem, false);
+    SceneInstances::AppendInputLayout(depthVertElem, false);
+    SceneInstances::AppendInputLayout(cutoutVertElem, false);
+    SceneInstances::AppendInputLayout(multiViewElem, true);
+    SceneInstances::AppendInputLayout(depthMultiViewElem, true);
+    SceneInstances::AppendInputLayout(cutoutMultiViewElem, true);
 
     // Depth-only (2x rate)
     m_DepthPSO.SetRootSignature(m_RootSig);
     m_DepthPSO.SetRasterizerState(RasterizerDefault);
     m_DepthPSO.SetBlendState(BlendNoColorWrite);
     m_DepthPSO.SetDepthStencilState(DepthStateReadWrite);
-    m_DepthPSO.SetInputLayout(_countof(vertElem), vertElem);
+    m_DepthPSO.SetInputLayout((UINT)depthVertElem.size(), depthVertElem.data());
     m_DepthPSO.SetPrimitiveTopologyType(D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE);
     m_DepthPSO.SetRenderTargetFormats(0, nullptr, DepthFormat);
     m_DepthPSO.SetVertexShader(g_pDepthViewerVS, sizeof(g_pDepthViewerVS));
@@ -158,6 +451,8 @@ void ModelViewer::Startup( void )
 
     // Depth-only shading but with alpha testing
     m_CutoutDepthPSO = m_DepthPSO;
+    m_CutoutDepthPSO.SetInputLayout((UINT)cutoutVertElem.size(), cutoutVertElem.data());
+    m_CutoutDepthPSO.SetVertexShader(g_pDepthViewerCutoutVS, sizeof(g_pDepthViewerCutoutVS));
     m_CutoutDepthPSO.SetPixelShader(g_pDepthViewerPS, sizeof(g_pDepthViewerPS));
     m_CutoutDepthPSO.SetRasterizerState(RasterizerTwoSided);
     m_CutoutDepthPSO.Finalize();
@@ -170,12 +465,41 @@ void ModelViewer::Startup( void )
 
     // Shadows with alpha testing
     m_CutoutShadowPSO = m_ShadowPSO;
+    m_CutoutShadowPSO.SetInputLayout((UINT)cutoutVertElem.size(), cutoutVertElem.data());
+    m_CutoutShadowPSO.SetVertexShader(g_pDepthViewerCutoutVS, sizeof(g_pDepthViewerCutoutVS));
     m_CutoutShadowPSO.SetPixelShader(g_pDepthViewerPS, sizeof(g_pDepthViewerPS));
     m_CutoutShadowPSO.SetRasterizerState(RasterizerShadowTwoSided);
     m_CutoutShadowPSO.Finalize();
 
+    CreateSunShadowPSOs();
+
+    // All cascades in one pass
+    m_CascadeShadowPSO = m_ShadowPSO;
+    m_CascadeShadowPSO.SetRenderTargetFormats(0, nullptr, g_CascadedShadowBuffer.GetFormat());
+    m_CascadeShadowPSO.SetInputLayout((UINT)depthMultiViewElem.size(), depthMultiViewElem.data());
+    m_CascadeShadowPSO.SetVertexShader(g_pDepthViewerCascadeVS, sizeof(g_pDepthViewerCascadeVS));
+    m_CascadeShadowPSO.Finalize();
+
+    m_CutoutCascadeShadowPSO = m_CutoutShadowPSO;
+    m_CutoutCascadeShadowPSO.SetRenderTargetFormats(0, nullptr, g_CascadedShadowBuffer.GetFormat());
+    m_CutoutCascadeShadowPSO.SetInputLayout((UINT)cutoutMultiViewElem.size(), cutoutMultiViewElem.data());
+    m_CutoutCascadeShadowPSO.SetVertexShader(g_pDepthViewerCascadeCutoutVS, sizeof(g_pDepthViewerCascadeCutoutVS));
+    m_CutoutCascadeShadowPSO.Finalize();
+
+    // All faces of a point light in one pass, each face selecting the viewport of its atlas tile
+    m_PointShadowPSO = m_ShadowPSO;
+    m_PointShadowPSO.SetInputLayout((UINT)depthMultiViewElem.size(), depthMultiViewElem.data());
+    m_PointShadowPSO.SetVertexShader(g_pDepthViewerPointShadowVS, sizeof(g_pDepthViewerPointShadowVS));
+    m_PointShadowPSO.Finalize();
+
+    m_CutoutPointShadowPSO = m_CutoutShadowPSO;
+    m_CutoutPointShadowPSO.SetInputLayout((UINT)cutoutMultiViewElem.size(), cutoutMultiViewElem.data());
+    m_CutoutPointShadowPSO.SetVertexShader(g_pDepthViewerPointShadowCutoutVS, sizeof(g_pDepthViewerPointShadowCutoutVS));
+    m_CutoutPointShadowPSO.Finalize();
+
     // Full color pass
     m_ModelPSO = m_DepthPSO;
+    m_ModelPSO.SetInputLayout((UINT)vertElem.size(), vertElem.data());
     m_ModelPSO.SetBlendState(BlendDisable);
     m_ModelPSO.SetDepthStencilState(DepthStateTestEqual);
     m_ModelPSO.SetRenderTargetFormats(1, &ColorFormat, DepthFormat);
@@ -188,36 +512,106 @@ void ModelViewer::Startup( void )
     m_DepthWaveOpsPSO.SetVertexShader( g_pDepthViewerVS_SM6, sizeof(g_pDepthViewerVS_SM6) );
     m_DepthWaveOpsPSO.Finalize();
 
-    m_ModelWaveOpsPSO = m_ModelPSO;
-    m_ModelWaveOpsPSO.SetVertexShader( g_pModelViewerVS_SM6, sizeof(g_pModelViewerVS_SM6) );
-    m_ModelWaveOpsPSO.SetPixelShader( g_pModelViewerPS_SM6, sizeof(g_pModelViewerPS_SM6) );
-    m_ModelWaveOpsPSO.Finalize();
+    for (uint32_t i = 0; i < kNumWaveLightLoops; ++i)
+    {
+        m_ModelWaveOpsPSO[i] = m_ModelPSO;
+        m_ModelWaveOpsPSO[i].SetVertexShader( g_pModelViewerVS_SM6, sizeof(g_pModelViewerVS_SM6) );
+    }
+    m_ModelWaveOpsPSO[kWaveLightLoopBitMask].SetPixelShader( g_pModelViewerPS_SM6, sizeof(g_pModelViewerPS_SM6) );
+    m_ModelWaveOpsPSO[kWaveLightLoopScalarLoop].SetPixelShader( g_pModelViewerPS_SM6_ScalarLoop, sizeof(g_pModelViewerPS_SM6_ScalarLoop) );
+    m_ModelWaveOpsPSO[kWaveLightLoopScalarBranch].SetPixelShader( g_pModelViewerPS_SM6_ScalarBranch, sizeof(g_pModelViewerPS_SM6_ScalarBranch) );
+    for (uint32_t i = 0; i < kNumWaveLightLoops; ++i)
+        m_ModelWaveOpsPSO[i].Finalize();
 #endif
 
     m_CutoutModelPSO = m_ModelPSO;
     m_CutoutModelPSO.SetRasterizerState(RasterizerTwoSided);
     m_CutoutModelPSO.Finalize();
 
+    m_ModelDepthWritePSO = m_ModelPSO;
+    m_ModelDepthWritePSO.SetDepthStencilState(DepthStateReadWrite);
+    m_ModelDepthWritePSO.Finalize();
+
+    // Every layer of geometry adds up, whatever hides it
+    m_OverdrawPSO = m_DepthPSO;
+    m_OverdrawPSO.SetBlendState(BlendAdditive);
+    m_OverdrawPSO.SetDepthStencilState(DepthStateDisabled);
+    m_OverdrawPSO.SetRenderTargetFormats(1, &ColorFormat, DepthFormat);
+    m_OverdrawPSO.SetPixelShader(g_pDepthOverdrawPS, sizeof(g_pDepthOverdrawPS));
+    m_OverdrawPSO.Finalize();
+
+    if (m_BindlessSupported)
+    {
+        m_BindlessModelPSO = m_ModelPSO;
+        m_BindlessModelPSO.SetPixelShader(g_pModelViewerBindlessPS, sizeof(g_pModelViewerBindlessPS));
+        m_BindlessModelPSO.Finalize();
+
+        m_BindlessModelDepthWritePSO = m_BindlessModelPSO;
+        m_BindlessModelDepthWritePSO.SetDepthStencilState(DepthStateReadWrite);
+        m_BindlessModelDepthWritePSO.Finalize();
+
+        m_BindlessCutoutModelPSO = m_BindlessModelPSO;
+        m_BindlessCutoutModelPSO.SetRasterizerState(RasterizerTwoSided);
+        m_BindlessCutoutModelPSO.Finalize();
+
+        m_BindlessCutoutDepthPSO = m_CutoutDepthPSO;
+        m_BindlessCutoutDepthPSO.SetPixelShader(g_pDepthViewerBindlessPS, sizeof(g_pDepthViewerBindlessPS));
+        m_BindlessCutoutDepthPSO.Finalize();
+    }
+    else
+        Utility::Print("Bindless materials require resource binding tier 2 and are disabled.\n");
+
     // A debug shader for counting lights in a tile
     m_WaveTileCountPSO = m_ModelPSO;
     m_WaveTileCountPSO.SetPixelShader(g_pWaveTileCountPS, sizeof(g_pWaveTileCountPS));
     m_WaveTileCountPSO.Finalize();
 
-    Lighting::InitializeResources();
+    // Both eyes in one pass, each instance selecting its eye's viewport
+    m_MultiViewDepthPSO = m_DepthPSO;
+    m_MultiViewDepthPSO.SetInputLayout((UINT)depthMultiViewElem.size(), depthMultiViewElem.data());
+    m_MultiViewDepthPSO.SetVertexShader(g_pDepthViewerMultiViewVS, sizeof(g_pDepthViewerMultiViewVS));
+    m_MultiViewDepthPSO.Finalize();
 
+    m_MultiViewCutoutDepthPSO = m_CutoutDepthPSO;
+    m_MultiViewCutoutDepthPSO.SetInputLayout((UINT)cutoutMultiViewElem.size(), cutoutMultiViewElem.data());
+    m_MultiViewCutoutDepthPSO.SetVertexShader(g_pDepthViewerMultiViewCutoutVS, sizeof(g_pDepthViewerMultiViewCutoutVS));
+    m_MultiViewCutoutDepthPSO.Finalize();
+
+    m_MultiViewModelPSO = m_ModelPSO;
+    m_MultiViewModelPSO.SetInputLayout((UINT)multiViewElem.size(), multiViewElem.data());
+    m_MultiViewModelPSO.SetVertexShader(g_pModelViewerMultiViewVS, sizeof(g_pModelViewerMultiViewVS));
+    m_MultiViewModelPSO.Finalize();
+
+    m_MultiViewCutoutModelPSO = m_MultiViewModelPSO;
+    m_MultiViewCutoutModelPSO.SetRasterizerState(RasterizerTwoSided);
+    m_MultiViewCutoutModelPSO.Finalize();
+
+    Lighting::InitializeResources();
+    CascadedShadows::InitializeResources();
+    ShadowMoments::InitializeResources(g_ShadowBuffer, Lighting::m_LightShadowAtlas);
+    SoftShadows::InitializeResources(g_ShadowBuffer, Lighting::m_LightShadowAtlas);
+    VirtualShadowMap::InitializeResources();
+    SunShadowMask::InitializeResources();
+    VariableRateShading::InitializeResources();
+    VolumetricLighting::InitializeResources();
+    DepthPrepass::InitializeResources();
+    DrawStatistics::InitializeResources();
+
+    m_SunShadowMap = &g_ShadowBuffer;
     m_ExtraTextures[0] = g_SSAOFullScreen.GetSRV();
     m_ExtraTextures[1] = g_ShadowBuffer.GetSRV();
 
-    TextureManager::Initialize(L"Textures/");
-    ASSERT(m_Model.Load("Models/sponza.h3d"), "Failed to load model");
-    ASSERT(m_Model.m_Header.meshCount > 0, "Model contains no meshes");
-
-    // The caller of this function can override which materials are considered cutouts
+    // The caller of this function can override which materials are considered cutouts.  The converter's opaque
+    // copies of cutout materials never are.
     m_pMaterialIsCutout.resize(m_Model.m_Header.materialCount);
     for (uint32_t i = 0; i < m_Model.m_Header.materialCount; ++i)
     {
         const Model::Material& mat = m_Model.m_pMaterial[i];
-        if (std::string(mat.texDiffusePath).find("thorn") != std::string::npos ||
+        if (m_Model.IsMaterialOpaque(i))
+        {
+            m_pMaterialIsCutout[i] = false;
+        }
+        else if (std::string(mat.texDiffusePath).find("thorn") != std::string::npos ||
             std::string(mat.texDiffusePath).find("plant") != std::string::npos ||
             std::string(mat.texDiffusePath).find("chain") != std::string::npos)
         {
@@ -229,33 +623,104 @@ void ModelViewer::Startup( void )
         }
     }
 
+    // Bindless passes index the material textures in the persistent region, and bundles bind each material's
+    // table from it
+    ASSERT(m_Model.m_Header.materialCount * 6 <= DynamicDescriptorHeap::kNumPersistentDescriptors,
+        "The model's textures do not fit in the persistent descriptor region");
+    DynamicDescriptorHeap::SetPersistentDescriptors(0, m_Model.m_Header.materialCount * 6, m_Model.GetSRVs(0));
+
+    ShadowCasterCulling::InitializeResources(m_RootSig, m_Model, m_pMaterialIsCutout);
+    DrawList::InitializeResources(m_RootSig, m_Model, m_pMaterialIsCutout);
+    StaticBundles::Initialize(m_RootSig);
+    ViewCulling::InitializeResources(m_Model);
+    TextureFeedback::InitializeResources(m_Model);
+    HiZCulling::InitializeResources(m_RootSig, m_Model, m_pMaterialIsCutout);
+    SceneInstances::InitializeResources(m_Model);
+    SoftwareShadowRaster::InitializeResources(m_Model, m_pMaterialIsCutout);
+
+    // Everything above overlapped the initialization of the graphics subsystems.  The particles need theirs.
+    Graphics::FinishInitialization();
     CreateParticleEffects();
 
-    float modelRadius = Length(m_Model.m_Header.boundingBox.max - m_Model.m_Header.boundingBox.min) * .5f;
-    const Vector3 eye = (m_Model.m_Header.boundingBox.min + m_Model.m_Header.boundingBox.max) * .5f + Vector3(modelRadius * .5f, 0.0f, 0.0f);
-    m_Camera.SetEyeAtUp( eye, Vector3(kZero), Vector3(kYUnitVector) );
-    m_Camera.SetZRange( 1.0f, 10000.0f );
-    m_CameraController.reset(new CameraController(m_Camera, Vector3(kYUnitVector)));
-
-    MotionBlur::Enable = true;
-    TemporalEffects::EnableTAA = true;
-    FXAA::Enable = false;
-    PostEffects::EnableHDR = true;
-    PostEffects::EnableAdaptation = true;
-    SSAO::Enable = true;
+    // Startup() runs again when the device is recreated, which keeps the view and the settings
+    const bool FirstStartup = m_CameraController.get() == nullptr;
+    if (FirstStartup)
+    {
+        float modelRadius = Length(m_Model.m_Header.boundingBox.max - m_Model.m_Header.boundingBox.min) * .5f;
+        const Vector3 eye = (m_Model.m_Header.boundingBox.min + m_Model.m_Header.boundingBox.max) * .5f + Vector3(modelRadius * .5f, 0.0f, 0.0f);
+        m_Camera.SetEyeAtUp( eye, Vector3(kZero), Vector3(kYUnitVector) );
+        m_Camera.SetZRange( 1.0f, 10000.0f );
+        m_CameraController.reset(new CameraController(m_Camera, Vector3(kYUnitVector)));
+
+        MotionBlur::Enable = true;
+        TemporalEffects::EnableTAA = true;
+        FXAA::Enable = false;
+        PostEffects::EnableHDR = true;
+        PostEffects::EnableAdaptation = true;
+        SSAO::Enable = true;
+    }
 
     Lighting::CreateRandomLights(m_Model.GetBoundingBox().min, m_Model.GetBoundingBox().max);
 
+    // The lights are seeded the same every run.  Settings saved from earlier sessions could still move the sun
+    // or hold the frame rate to the display.
+    if (FirstStartup && Benchmark::Initialize(m_Model.GetBoundingBox().min, m_Model.GetBoundingBox().max))
+    {
+        m_SunOrientation = -0.5f;
+        m_SunInclination = 0.75f;
+        Graphics::s_EnableVSync = false;
+        EngineProfiling::DrawProfiler = false;
+
+        if (Benchmark::IsSweep())
+            AddShadowSweep();
+    }
+
     m_ExtraTextures[2] = Lighting::m_LightBuffer.GetSRV();
-    m_ExtraTextures[3] = Lighting::m_LightShadowArray.GetSRV();
+    m_ExtraTextures[3] = Lighting::m_LightShadowAtlas.GetSRV();
     m_ExtraTextures[4] = Lighting::m_LightGrid.GetSRV();
     m_ExtraTextures[5] = Lighting::m_LightGridBitMask.GetSRV();
+    m_ExtraTextures[6] = g_CascadedShadowBuffer.GetSRV();
+    m_ExtraTextures[7] = CascadedShadows::m_CascadeBuffer.GetSRV();
+    m_ExtraTextures[8] = ShadowMoments::m_SunMoments.GetSRV();
+    m_ExtraTextures[9] = ShadowMoments::m_LightAtlasMoments.GetSRV();
+    m_ExtraTextures[10] = SoftShadows::m_SunDepthPyramid.GetSRV();
+    m_ExtraTextures[11] = SoftShadows::m_LightAtlasDepthPyramid.GetSRV();
+    m_ExtraTextures[12] = VirtualShadowMap::IsSupported() ? VirtualShadowMap::m_VirtualShadowMap.GetSRV() : g_ShadowBuffer.GetSRV();
+    m_ExtraTextures[13] = g_SunShadowMask.GetSRV();
+    m_ExtraTextures[14] = Lighting::m_LightClusters.GetSRV();
+    m_ExtraTextures[15] = Lighting::m_LightClusterList.GetSRV();
+    m_ExtraTextures[16] = Lighting::m_LightShadowBuffer.GetSRV();
+
+    m_LightShadowTimer = GpuTimeManager::NewTimer();
+    for (uint32_t i = 0; i < _countof(m_LightShadowUpdateCount); ++i)
+        m_LightShadowUpdateCount[i] = 0;
+    m_LightShadowGeometryVersion = GetCachedGeometryVersion();
 }
 
 void ModelViewer::Cleanup( void )
 {
+    m_Skinning.Destroy();
     m_Model.Clear();
     Lighting::Shutdown();
+    CascadedShadows::Shutdown();
+    ShadowCasterCulling::Shutdown();
+    DrawList::Shutdown();
+    StaticBundles::Shutdown();
+    ViewCulling::Shutdown();
+    DrawStatistics::Shutdown();
+    TextureFeedback::Shutdown();
+    HiZCulling::Shutdown();
+    SceneInstances::Shutdown();
+    SoftwareShadowRaster::Shutdown();
+    ShadowMoments::Shutdown();
+    SoftShadows::Shutdown();
+    VirtualShadowMap::Shutdown();
+    VolumetricLighting::Shutdown();
+}
+
+bool ModelViewer::IsDone( void )
+{
+    return Benchmark::IsFinished() || IGameApp::IsDone();
 }
 
 namespace Graphics
@@ -272,7 +737,10 @@ void ModelViewer::Update( float deltaT )
     else if (GameInput::IsFirstPressed(GameInput::kRShoulder))
         DebugZoom.Increment();
 
-    m_CameraController->Update(deltaT);
+    if (Benchmark::IsRunning())
+        Benchmark::Update(m_Camera);
+    else
+        m_CameraController->Update(deltaT);
     m_ViewProjMatrix = m_Camera.GetViewProjMatrix();
 
     float costheta = cosf(m_SunOrientation);
@@ -281,6 +749,15 @@ void ModelViewer::Update( float deltaT )
     float sinphi = sinf(m_SunInclination * 3.14159f * 0.5f);
     m_SunDirection = Normalize(Vector3( costheta * cosphi, sinphi, sintheta * cosphi ));
 
+    UpdateSunShadowFormat();
+
+    if (EnableAnimation)
+    {
+        m_AnimationTime += deltaT * AnimationSpeed;
+        if (m_Skinning.IsValid())
+            ++m_SceneMotionVersion;
+    }
+
     // We use viewport offsets to jitter sample positions from frame to frame (for TAA.)
     // D3D has a design quirk with fractional offsets such that the implicit scissor
     // region of a viewport is floor(TopLeftXY) and floor(TopLeftXY + WidthHeight), so
@@ -291,18 +768,98 @@ void ModelViewer::Update( float deltaT )
     // temporal AA.
     TemporalEffects::GetJitterOffset(m_MainViewport.TopLeftX, m_MainViewport.TopLeftY);
 
-    m_MainViewport.Width = (float)g_SceneColorBuffer.GetWidth();
-    m_MainViewport.Height = (float)g_SceneColorBuffer.GetHeight();
+    m_MainViewport.Width = (float)DynamicResolution::GetWidth();
+    m_MainViewport.Height = (float)DynamicResolution::GetHeight();
     m_MainViewport.MinDepth = 0.0f;
     m_MainViewport.MaxDepth = 1.0f;
 
     m_MainScissor.left = 0;
     m_MainScissor.top = 0;
-    m_MainScissor.right = (LONG)g_SceneColorBuffer.GetWidth();
-    m_MainScissor.bottom = (LONG)g_SceneColorBuffer.GetHeight();
+    m_MainScissor.right = (LONG)DynamicResolution::GetWidth();
+    m_MainScissor.bottom = (LONG)DynamicResolution::GetHeight();
+
+    MultiView::Update(m_Camera, m_MainViewport, Lighting::GetTileAlignment());
+
+    // Moving the instances leaves every cached shadow of both the old and the new layout stale
+    Vector3 OldSceneMin, OldSceneMax;
+    SceneInstances::GetSceneBounds(OldSceneMin, OldSceneMax);
+    if (SceneInstances::Update(m_Model))
+    {
+        Vector3 SceneMin, SceneMax;
+        SceneInstances::GetSceneBounds(SceneMin, SceneMax);
+        Lighting::InvalidateShadows(Min(OldSceneMin, SceneMin), Max(OldSceneMax, SceneMax));
+        VirtualShadowMap::InvalidateAll();
+        m_ShadowCacheValid = false;
+        m_ScrollingCascadesValid = false;
+        ++m_SceneMotionVersion;
+    }
+
+    // Light shadows and virtual sun shadow pages are only re-rendered when something they can see has changed
+    if (m_LightShadowGeometryVersion != GetCachedGeometryVersion())
+    {
+        Vector3 SceneMin, SceneMax;
+        SceneInstances::GetSceneBounds(SceneMin, SceneMax);
+        Lighting::InvalidateShadows(SceneMin, SceneMax);
+        VirtualShadowMap::InvalidateAll();
+        m_LightShadowGeometryVersion = GetCachedGeometryVersion();
+    }
+
+    if (m_Model.GetDynamicMeshCount() > 0)
+    {
+        ++m_SceneMotionVersion;
+        for (uint32_t meshIndex = 0; meshIndex < m_Model.m_Header.meshCount; meshIndex++)
+        {
+            if (m_Model.IsMeshDynamic(meshIndex))
+            {
+                Vector3 MinBound = m_Model.m_pMesh[meshIndex].boundingBox.min;
+                Vector3 MaxBound = m_Model.m_pMesh[meshIndex].boundingBox.max;
+                if (SceneInstances::IsActive())
+                    SceneInstances::GetMeshBounds(meshIndex, MinBound, MaxBound);
+                Lighting::InvalidateShadows(MinBound, MaxBound);
+                VirtualShadowMap::InvalidateBox(m_VirtualSunShadow, MinBound, MaxBound);
+            }
+        }
+    }
 }
 
 void ModelViewer::RenderObjects( GraphicsContext& gfxContext, const Matrix4& ViewProjMat, eObjectFilter Filter )
+{
+    SetVSConstants(gfxContext, ViewProjMat);
+
+    DrawObjects(gfxContext, Filter);
+}
+
+void ModelViewer::RenderObjectsDepth( GraphicsContext& gfxContext, const Matrix4& ViewProjMat, eObjectFilter Filter )
+{
+    SetVSConstants(gfxContext, ViewProjMat);
+
+    SetVertexStream(gfxContext, true);
+    DrawObjects(gfxContext, Filter, 1, true);
+    SetVertexStream(gfxContext, false);
+}
+
+void ModelViewer::SetVertexStream( GraphicsContext& gfxContext, bool DepthOnlyStream )
+{
+    if (DepthOnlyStream)
+    {
+        gfxContext.SetIndexBuffer(m_Model.m_IndexBufferDepth.IndexBufferView());
+        gfxContext.SetVertexBuffer(0, m_Model.m_VertexBufferDepth.VertexBufferView());
+    }
+    else
+    {
+        gfxContext.SetIndexBuffer(m_Model.m_IndexBuffer.IndexBufferView());
+        gfxContext.SetVertexBuffer(0, m_Model.m_VertexBuffer.VertexBufferView());
+    }
+
+    // Skinned models draw this frame's skinned streams, which share the model's layouts and index buffers
+    if (m_Skinning.IsValid())
+    {
+        const StructuredBuffer& Skinned = DepthOnlyStream ? m_Skinning.GetVertexBufferDepth() : m_Skinning.GetVertexBuffer();
+        gfxContext.SetVertexBuffer(0, Skinned.VertexBufferView());
+    }
+}
+
+void ModelViewer::SetVSConstants( GraphicsContext& gfxContext, const Matrix4& ViewProjMat )
 {
     struct VSConstants
     {
@@ -315,223 +872,1595 @@ void ModelViewer::RenderObjects( GraphicsContext& gfxContext, const Matrix4& Vie
     XMStoreFloat3(&vsConstants.viewerPos, m_Camera.GetPosition());
 
     gfxContext.SetDynamicConstantBufferView(0, sizeof(vsConstants), &vsConstants);
+}
 
-    uint32_t materialIdx = 0xFFFFFFFFul;
-
-    uint32_t VertexStride = m_Model.m_VertexStride;
+void ModelViewer::SetInstanceView( SceneInstances::VisibleList& List, const Matrix4* ViewProjs, uint32_t NumViews )
+{
+    if (!SceneInstances::IsActive())
+        return;
 
-    for (uint32_t meshIndex = 0; meshIndex < m_Model.m_Header.meshCount; meshIndex++)
-    {
-        const Model::Mesh& mesh = m_Model.m_pMesh[meshIndex];
+    SceneInstances::Cull(ViewProjs, NumViews, List);
+    m_DrawInstances = &List;
+}
 
-        uint32_t indexCount = mesh.indexCount;
-        uint32_t startIndex = mesh.indexDataByteOffset / sizeof(uint16_t);
-        uint32_t baseVertex = mesh.vertexDataByteOffset / VertexStride;
+void ModelViewer::CreateSunShadowPSOs( void )
+{
+    const DXGI_FORMAT ShadowFormat = g_ShadowBuffer.GetFormat();
+    const bool FloatDepth = ShadowFormat == DXGI_FORMAT_D32_FLOAT;
+
+    m_SunShadowPSO = m_ShadowPSO;
+    m_SunShadowPSO.SetRasterizerState(FloatDepth ? RasterizerShadowD32 : RasterizerShadow);
+    m_SunShadowPSO.SetRenderTargetFormats(0, nullptr, ShadowFormat);
+    m_SunShadowPSO.Finalize();
+
+    m_CutoutSunShadowPSO = m_CutoutShadowPSO;
+    m_CutoutSunShadowPSO.SetRasterizerState(FloatDepth ? RasterizerShadowD32TwoSided : RasterizerShadowTwoSided);
+    m_CutoutSunShadowPSO.SetRenderTargetFormats(0, nullptr, ShadowFormat);
+    m_CutoutSunShadowPSO.Finalize();
+}
 
-        if (mesh.materialIndex != materialIdx)
-        {
-            if ( m_pMaterialIsCutout[mesh.materialIndex] && !(Filter & kCutout) ||
-                !m_pMaterialIsCutout[mesh.materialIndex] && !(Filter & kOpaque) )
-                continue;
+void ModelViewer::UpdateSunShadowFormat( void )
+{
+    // Also catches the buffers having been recreated with the default format on a resolution change
+    const DXGI_FORMAT ShadowFormat = SunShadowFormat == kShadowFormatD32 ? DXGI_FORMAT_D32_FLOAT : DXGI_FORMAT_D16_UNORM;
+    if (g_ShadowBuffer.GetFormat() == ShadowFormat && g_StaticShadowBuffer.GetFormat() == ShadowFormat)
+        return;
 
-            materialIdx = mesh.materialIndex;
-            gfxContext.SetDynamicDescriptors(2, 0, 6, m_Model.GetSRVs(materialIdx) );
-        }
+    g_CommandManager.IdleGPU();
 
-        gfxContext.SetConstants(4, baseVertex, materialIdx);
+    g_ShadowBuffer.Create(L"Shadow Map", (uint32_t)g_ShadowBuffer.GetWidth(), (uint32_t)g_ShadowBuffer.GetHeight(), ShadowFormat);
+    g_StaticShadowBuffer.Create(L"Static Shadow Map", (uint32_t)g_StaticShadowBuffer.GetWidth(),
+        (uint32_t)g_StaticShadowBuffer.GetHeight(), ShadowFormat);
+    m_ShadowCacheValid = false;
 
-        gfxContext.DrawIndexed(indexCount, startIndex, baseVertex);
-    }
+    CreateSunShadowPSOs();
 }
 
-void ModelViewer::RenderLightShadows(GraphicsContext& gfxContext)
+void ModelViewer::ResizeSunShadows( uint32_t Size )
 {
-    using namespace Lighting;
+    if (g_ShadowBuffer.GetWidth() == Size && g_CascadedShadowBuffer.GetWidth() == Size / 2)
+        return;
 
-    ScopedTimer _prof(L"RenderLightShadows", gfxContext);
+    g_CommandManager.IdleGPU();
 
-    static uint32_t LightIndex = 0;
-    if (LightIndex >= MaxLights)
-        return;
+    g_ShadowBuffer.Create(L"Shadow Map", Size, Size, g_ShadowBuffer.GetFormat());
+    g_StaticShadowBuffer.Create(L"Static Shadow Map", Size, Size, g_StaticShadowBuffer.GetFormat());
+    g_CascadedShadowBuffer.CreateArray(L"Cascaded Shadow Map", Size / 2, Size / 2, CascadedShadowCamera::kMaxCascades,
+        g_CascadedShadowBuffer.GetFormat());
+    ShadowMoments::ResizeSunMoments(g_ShadowBuffer);
+    SoftShadows::ResizeSunPyramid(g_ShadowBuffer);
+    m_ShadowCacheValid = false;
+    m_ScrollingCascadesValid = false;
+}
 
-    m_LightShadowTempBuffer.BeginRendering(gfxContext);
+void ModelViewer::AddShadowSweep( void )
+{
+    struct Technique
     {
-        gfxContext.SetPipelineState(m_ShadowPSO);
-        RenderObjects(gfxContext, m_LightShadowMatrix[LightIndex], kOpaque);
-        gfxContext.SetPipelineState(m_CutoutShadowPSO);
-        RenderObjects(gfxContext, m_LightShadowMatrix[LightIndex], kCutout);
-    }
-    m_LightShadowTempBuffer.EndRendering(gfxContext);
-
-    gfxContext.TransitionResource(m_LightShadowTempBuffer, D3D12_RESOURCE_STATE_GENERIC_READ);
-    gfxContext.TransitionResource(m_LightShadowArray, D3D12_RESOURCE_STATE_COPY_DEST);
+        const char* Name;
+        bool Cascades, Cache, Moments, Soft, Mask, Virtual, Contact;
+    };
 
-    gfxContext.CopySubresource(m_LightShadowArray, LightIndex, m_LightShadowTempBuffer, 0);
+    // Contact shadows are meant to hold up at half the shadow map size, e.g. "Contact Shadows 2048" against
+    // "Shadow Mask 4096"
+    static const Technique kTechniques[] =
+    {
+        { "Cascades", true, false, false, false, false, false, false },
+        { "Shadow Map", false, false, false, false, false, false, false },
+        { "Cached Shadow Map", false, true, false, false, false, false, false },
+        { "Moment Shadows", false, false, true, false, false, false, false },
+        { "Soft Shadows", false, false, false, true, false, false, false },
+        { "Shadow Mask", false, false, false, false, true, false, false },
+        { "Contact Shadows", false, false, false, false, true, false, true },
+        { "Virtual Shadow Map", false, false, false, false, false, true, false },
+    };
 
-    gfxContext.TransitionResource(m_LightShadowArray, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+    auto Apply = [this]( const Technique& Tech, uint32_t Size, int32_t Format, int32_t BlockerSamples, int32_t FilterSamples )
+    {
+        EnableCascadedShadows = Tech.Cascades;
+        EnableShadowCache = Tech.Cache;
+        ShadowMoments::Enable = Tech.Moments;
+        SoftShadows::Enable = Tech.Soft;
+        SoftShadows::BlockerSamples = BlockerSamples;
+        SoftShadows::FilterSamples = FilterSamples;
+        SunShadowMask::Enable = Tech.Mask;
+        SunShadowMask::ContactShadows = Tech.Contact;
+        VirtualShadowMap::Enable = Tech.Virtual;
+        SunShadowFormat = Format;
+        ResizeSunShadows(Size);
+        UpdateSunShadowFormat();
+    };
 
-    ++LightIndex;
-}
+    // There is no ray traced reference in this sample, so the reference is the softest and most finely
+    // sampled sun shadow the rasterizer produces
+    const Technique& Soft = kTechniques[4];
+    Benchmark::AddConfiguration("Soft Shadows 4096 D32F 64 Samples",
+        [=]() { Apply(Soft, 4096, kShadowFormatD32, 64, 64); });
 
-void ModelViewer::RenderScene( void )
-{
-    static bool s_ShowLightCounts = false;
-    if (ShowWaveTileCounts != s_ShowLightCounts)
+    const uint32_t kSizes[] = { 1024, 2048, 4096 };
+    for (const Technique& Tech : kTechniques)
     {
-        static bool EnableHDR;
-        if (ShowWaveTileCounts)
+        if (Tech.Virtual)
         {
-            EnableHDR = PostEffects::EnableHDR;
-            PostEffects::EnableHDR = false;
+            // The virtual map has a fixed size of its own
+            if (VirtualShadowMap::IsSupported())
+                Benchmark::AddConfiguration(Tech.Name, [=]() { Apply(Tech, 2048, kShadowFormatD16, 16, 24); });
+            continue;
         }
-        else
+
+        for (uint32_t Size : kSizes)
         {
-            PostEffects::EnableHDR = EnableHDR;
+            const uint32_t MapSize = Tech.Cascades ? Size / 2 : Size;
+            Benchmark::AddConfiguration(std::string(Tech.Name) + " " + std::to_string(MapSize),
+                [=]() { Apply(Tech, Size, kShadowFormatD16, 16, 24); });
         }
-        s_ShowLightCounts = ShowWaveTileCounts;
     }
+}
 
-    GraphicsContext& gfxContext = GraphicsContext::Begin(L"Scene Render");
-
-    ParticleEffects::Update(gfxContext.GetComputeContext(), Graphics::GetFrameTime());
+void ModelViewer::RenderShadowCasters( GraphicsContext& gfxContext, uint32_t CullSlot )
+{
+    SetVertexStream(gfxContext, true);
+    gfxContext.SetPipelineState(m_ShadowPSO);
+    if (UseCasterCulling())
+        ShadowCasterCulling::DrawCasters(gfxContext, CullSlot);
+    else
+        DrawObjects(gfxContext, (eObjectFilter)(kOpaque | kSkipMaterials | kShadowLOD), 1, true);
 
-    uint32_t FrameIndex = TemporalEffects::GetFrameIndexMod2();
+    SetVertexStream(gfxContext, false);
+    gfxContext.SetPipelineState(m_CutoutShadowPSO);
+    DrawObjects(gfxContext, (eObjectFilter)(kCutout | kShadowLOD));
+}
 
-    __declspec(align(16)) struct
+ModelViewer::eObjectFilter ModelViewer::RasterizeSmallCasters( GraphicsContext& gfxContext, const Matrix4& ViewProjMat,
+    ShadowBuffer& Target, bool ShadowLOD )
+{
+    // The compute rasterizer places each mesh where the model put it, and reads the meshlets of whole meshes
+    if (SceneInstances::IsActive() || m_Model.IsGeometryStreamed() ||
+        !SoftwareShadowRaster::Render(gfxContext, ViewProjMat, Target, ShadowLOD ? &m_MeshShadowLOD : nullptr, m_MeshIsSoftwareRaster))
     {
-        Vector3 sunDirection;
-        Vector3 sunLight;
-        Vector3 ambientLight;
-        float ShadowTexelSize[4];
+        return kNone;
+    }
 
-        float InvTileDim[4];
-        uint32_t TileCount[4];
-        uint32_t FirstLightIndex[4];
-        uint32_t FrameIndexMod2;
-    } psConstants;
+    SetupGraphicsState(gfxContext);
+    return kHardwareRaster;
+}
 
-    psConstants.sunDirection = m_SunDirection;
-    psConstants.sunLight = Vector3(1.0f, 1.0f, 1.0f) * m_SunLightIntensity;
-    psConstants.ambientLight = Vector3(1.0f, 1.0f, 1.0f) * m_AmbientIntensity;
-    psConstants.ShadowTexelSize[0] = 1.0f / g_ShadowBuffer.GetWidth();
-    psConstants.InvTileDim[0] = 1.0f / Lighting::LightGridDim;
-    psConstants.InvTileDim[1] = 1.0f / Lighting::LightGridDim;
-    psConstants.TileCount[0] = Math::DivideByMultiple(g_SceneColorBuffer.GetWidth(), Lighting::LightGridDim);
-    psConstants.TileCount[1] = Math::DivideByMultiple(g_SceneColorBuffer.GetHeight(), Lighting::LightGridDim);
-    psConstants.FirstLightIndex[0] = Lighting::m_FirstConeLight;
-    psConstants.FirstLightIndex[1] = Lighting::m_FirstConeShadowedLight;
-    psConstants.FrameIndexMod2 = FrameIndex;
+void ModelViewer::SetupGraphicsState( GraphicsContext& Context )
+{
+    Context.SetRootSignature(m_RootSig);
+    Context.SetConstantArray(5, sizeof(m_VertexDecode) / 4, &m_VertexDecode);
+    TextureFeedback::Bind(Context, 6);
+    if (m_BindlessSupported)
+        Context.SetPersistentDescriptorTable(7, 0);
+    Context.SetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    SetVertexStream(Context, false);
+    SceneInstances::BindIdentity(Context);
+}
 
-    // Set the default state for command lists
-    auto pfnSetupGraphicsState = [&](void)
-    {
-        gfxContext.SetRootSignature(m_RootSig);
-        gfxContext.SetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-        gfxContext.SetIndexBuffer(m_Model.m_IndexBuffer.IndexBufferView());
-        gfxContext.SetVertexBuffer(0, m_Model.m_VertexBuffer.VertexBufferView());
-    };
+void ModelViewer::DrawObjects( GraphicsContext& gfxContext, eObjectFilter Filter, uint32_t NumViews, bool DepthOnlyStream,
+    uint32_t FirstMesh, uint32_t EndMesh )
+{
+    if (!(Filter & (kStatic | kDynamic)))
+        Filter = (eObjectFilter)(Filter | kStatic | kDynamic);
 
-    pfnSetupGraphicsState();
+    ASSERT(NumViews > 0 && NumViews <= 32);
+    const uint32_t ViewMask = 0xFFFFFFFFul >> (32 - NumViews);
 
-    RenderLightShadows(gfxContext);
+    uint32_t materialIdx = 0xFFFFFFFFul;
 
-    {
-        ScopedTimer _prof(L"Z PrePass", gfxContext);
+    EndMesh = std::min(EndMesh, m_Model.m_Header.meshCount);
 
-        gfxContext.SetDynamicConstantBufferView(1, sizeof(psConstants), &psConstants);
+    const SceneInstances::VisibleList* Instances = SceneInstances::IsActive() ? m_DrawInstances : nullptr;
+
+    // The draw list has no way to leave out the meshes drawn in compute, or those that are not occluders
+    if (DrawList::Enable && Instances == nullptr && NumViews == 1 && FirstMesh == 0 && EndMesh == m_Model.m_Header.meshCount &&
+        !(Filter & (kHardwareRaster | kOccluder)))
+    {
+        uint32_t BucketMask = 0;
+        if (Filter & kOpaque)
+            BucketMask |= (Filter & kStatic ? DrawList::kOpaqueStatic : 0) | (Filter & kDynamic ? DrawList::kOpaqueDynamic : 0);
+        if (Filter & kCutout)
+            BucketMask |= (Filter & kStatic ? DrawList::kCutoutStatic : 0) | (Filter & kDynamic ? DrawList::kCutoutDynamic : 0);
+
+        DrawList::Draw(gfxContext, m_Model, BucketMask, DepthOnlyStream, !(Filter & kSkipMaterials), (Filter & kVisible) != 0,
+            (Filter & kShadowLOD) != 0);
+        return;
+    }
 
+    // Camera passes follow the culling and sort of the frame, and the compute rasterized meshes and the occluders
+    // change with the view, so only the other passes have static draws that stay the same from frame to frame
+    if (StaticBundles::Enable && Instances == nullptr && (Filter & kStatic) &&
+        !(Filter & (kVisible | kHardwareRaster | kOccluder)))
+    {
+        const eObjectFilter StaticFilter = (eObjectFilter)(Filter & ~kDynamic);
+
+        StaticBundles::Key BundleKey;
+        BundleKey.Filter = StaticFilter;
+        BundleKey.NumViews = NumViews;
+        BundleKey.FirstMesh = FirstMesh;
+        BundleKey.EndMesh = EndMesh;
+        BundleKey.Version = Filter & kShadowLOD ? m_MeshShadowLODVersion : m_MeshLODVersion;
+        BundleKey.DepthOnlyStream = DepthOnlyStream;
+        BundleKey.BindMaterials = !(Filter & kSkipMaterials);
+
+        StaticBundles::Draw(gfxContext, BundleKey, [&]( ID3D12GraphicsCommandList* Bundle, D3D12_GPU_DESCRIPTOR_HANDLE MaterialTables,
+            uint32_t& NumDraws, uint64_t& NumTriangles )
         {
-            ScopedTimer _prof1(L"Opaque", gfxContext);
-            gfxContext.TransitionResource(g_SceneDepthBuffer, D3D12_RESOURCE_STATE_DEPTH_WRITE, true);
-            gfxContext.ClearDepth(g_SceneDepthBuffer);
+            RecordStaticDraws(Bundle, MaterialTables, StaticFilter, NumViews, DepthOnlyStream, FirstMesh, EndMesh, NumDraws,
+                NumTriangles);
+        });
 
-#ifdef _WAVE_OP
-            gfxContext.SetPipelineState(EnableWaveOps ? m_DepthWaveOpsPSO : m_DepthPSO );
-#else
-            gfxContext.SetPipelineState(m_DepthPSO);
-#endif
-            gfxContext.SetDepthStencilTarget(g_SceneDepthBuffer.GetDSV());
-            gfxContext.SetViewportAndScissor(m_MainViewport, m_MainScissor);
-            RenderObjects(gfxContext, m_ViewProjMatrix, kOpaque );
-        }
+        if (!(Filter & kDynamic) || m_Model.GetDynamicMeshCount() == 0)
+            return;
 
-        {
-            ScopedTimer _prof2(L"Cutout", gfxContext);
-            gfxContext.SetPipelineState(m_CutoutDepthPSO);
-            RenderObjects(gfxContext, m_ViewProjMatrix, kCutout );
-        }
+        Filter = (eObjectFilter)(Filter & ~kStatic);
     }
 
-    SSAO::Render(gfxContext, m_Camera);
+    const std::vector<uint8_t>& MeshLOD = Filter & kShadowLOD ? m_MeshShadowLOD : m_MeshLOD;
 
-    Lighting::FillLightGrid(gfxContext, m_Camera);
-
-    if (!SSAO::DebugDraw)
+    // The instances of each mesh are contiguous in the stream, so a mesh's draw starts at its first one
+    if (Instances != nullptr)
     {
-        ScopedTimer _prof(L"Main Render", gfxContext);
+        if (Instances->Transforms.empty())
+            return;
 
-        gfxContext.TransitionResource(g_SceneColorBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET, true);
-        gfxContext.ClearColor(g_SceneColorBuffer);
+        gfxContext.SetDynamicVB(SceneInstances::kStreamSlot, Instances->Transforms.size(), sizeof(SceneInstances::Transform),
+            Instances->Transforms.data());
+    }
 
-        pfnSetupGraphicsState();
+    // Camera passes go front to back, while instances and the other views keep the order of the file
+    const bool Sorted = (Filter & kVisible) && Instances == nullptr && !m_MeshDrawOrder.empty();
 
-        {
-            ScopedTimer _prof3(L"Render Shadow Map", gfxContext);
+    uint32_t NumDraws = 0;
+    uint64_t NumTriangles = 0;
 
-            m_SunShadow.UpdateMatrix(-m_SunDirection, Vector3(0, -500.0f, 0), Vector3(ShadowDimX, ShadowDimY, ShadowDimZ),
-                (uint32_t)g_ShadowBuffer.GetWidth(), (uint32_t)g_ShadowBuffer.GetHeight(), 16);
+    for (uint32_t DrawIndex = FirstMesh; DrawIndex < EndMesh; DrawIndex++)
+    {
+        const uint32_t meshIndex = Sorted ? m_MeshDrawOrder[DrawIndex] : DrawIndex;
+        const Model::Mesh& mesh = m_Model.m_pMesh[meshIndex];
+        const Model::MeshLOD& lod = m_Model.GetMeshLOD(meshIndex, MeshLOD[meshIndex]);
 
-            g_ShadowBuffer.BeginRendering(gfxContext);
-            gfxContext.SetPipelineState(m_ShadowPSO);
-            RenderObjects(gfxContext, m_SunShadow.GetViewProjMatrix(), kOpaque);
-            gfxContext.SetPipelineState(m_CutoutShadowPSO);
-            RenderObjects(gfxContext, m_SunShadow.GetViewProjMatrix(), kCutout);
-            g_ShadowBuffer.EndRendering(gfxContext);
-        }
+        uint32_t indexCount = lod.indexCount;
+        uint32_t startIndex = m_Model.GetStartIndex(lod.indexDataByteOffset);
+        uint32_t baseVertex = m_Model.GetBaseVertex(mesh, DepthOnlyStream);
 
-        if (SSAO::AsyncCompute)
-        {
-            gfxContext.Flush();
-            pfnSetupGraphicsState();
+        if (!(Filter & (m_Model.IsMeshDynamic(meshIndex) ? kDynamic : kStatic)))
+            continue;
 
-            // Make the 3D queue wait for the Compute queue to finish SSAO
-            g_CommandManager.GetGraphicsQueue().StallForProducer(g_CommandManager.GetComputeQueue());
+        // View culling tested the mesh where the model put it, while instances were culled to the view already
+        uint32_t FirstInstance = 0;
+        uint32_t InstanceCount = 1;
+        if (Instances != nullptr)
+        {
+            FirstInstance = Instances->MeshFirst[meshIndex];
+            InstanceCount = Instances->MeshCount[meshIndex];
+            if (InstanceCount == 0)
+                continue;
         }
-
+        else if ((Filter & kVisible) && !m_MeshIsVisible[meshIndex])
         {
-            ScopedTimer _prof4(L"Render Color", gfxContext);
+            continue;
+        }
 
-            gfxContext.TransitionResource(g_SSAOFullScreen, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+        if ((Filter & kHardwareRaster) && m_MeshIsSoftwareRaster[meshIndex])
+            continue;
 
-            gfxContext.SetDynamicDescriptors(3, 0, _countof(m_ExtraTextures), m_ExtraTextures);
-            gfxContext.SetDynamicConstantBufferView(1, sizeof(psConstants), &psConstants);
-#ifdef _WAVE_OP
-            gfxContext.SetPipelineState(EnableWaveOps ? m_ModelWaveOpsPSO : m_ModelPSO );
-#else
-            gfxContext.SetPipelineState(ShowWaveTileCounts ? m_WaveTileCountPSO : m_ModelPSO);
-#endif
-            gfxContext.TransitionResource(g_SceneDepthBuffer, D3D12_RESOURCE_STATE_DEPTH_READ);
-            gfxContext.SetRenderTarget(g_SceneColorBuffer.GetRTV(), g_SceneDepthBuffer.GetDSV_DepthReadOnly());
-            gfxContext.SetViewportAndScissor(m_MainViewport, m_MainScissor);
+        if ((Filter & kOccluder) && !m_MeshIsOccluder[meshIndex])
+            continue;
 
-            RenderObjects( gfxContext, m_ViewProjMatrix, kOpaque );
+        if (mesh.materialIndex != materialIdx)
+        {
+            if ( m_pMaterialIsCutout[mesh.materialIndex] && !(Filter & kCutout) ||
+                !m_pMaterialIsCutout[mesh.materialIndex] && !(Filter & kOpaque) )
+                continue;
 
-            if (!ShowWaveTileCounts)
-            {
-                gfxContext.SetPipelineState(m_CutoutModelPSO);
-                RenderObjects( gfxContext, m_ViewProjMatrix, kCutout );
-            }
+            materialIdx = mesh.materialIndex;
+            if (!(Filter & kSkipMaterials))
+                gfxContext.SetDynamicDescriptors(2, 0, 6, m_Model.GetSRVs(materialIdx) );
         }
 
-    }
+        gfxContext.SetConstants(4, baseVertex, materialIdx, ViewMask);
 
-    // Some systems generate a per-pixel velocity buffer to better track dynamic and skinned meshes.  Everything
-    // is static in our scene, so we generate velocity from camera motion and the depth buffer.  A velocity buffer
-    // is necessary for all temporal effects (and motion blur).
+        if (NumViews == 1)
+        {
+            gfxContext.DrawIndexedInstanced(indexCount, InstanceCount, startIndex, baseVertex, FirstInstance);
+            ++NumDraws;
+        }
+        else
+        {
+            // Multi-view shaders spend the instances of a draw on views
+            for (uint32_t i = 0; i < InstanceCount; ++i)
+                gfxContext.DrawIndexedInstanced(indexCount, NumViews, startIndex, baseVertex, FirstInstance + i);
+            NumDraws += InstanceCount;
+        }
+        NumTriangles += (uint64_t)(indexCount / 3) * InstanceCount * NumViews;
+    }
+
+    DrawStatistics::AddDraws(NumDraws, NumTriangles);
+
+    if (Instances != nullptr)
+        SceneInstances::BindIdentity(gfxContext);
+}
+
+void ModelViewer::SelectMeshLODs( void )
+{
+    const uint32_t NumMeshes = m_Model.m_Header.meshCount;
+    FrameArena::FrameVector<uint8_t> MeshLOD(NumMeshes, 0);
+    FrameArena::FrameVector<uint8_t> MeshShadowLOD(NumMeshes, 0);
+
+    // Pixels per world unit at a distance of one
+    const float PixelsPerUnit = 0.5f * (float)DynamicResolution::GetHeight() / std::tan(0.5f * m_Camera.GetFOV());
+    const Vector3 Eye = m_Camera.GetPosition();
+
+    for (uint32_t meshIndex = 0; EnableLOD && meshIndex < NumMeshes; ++meshIndex)
+    {
+        // The distance to the nearest point of the box, so that large meshes are not coarsened around the camera
+        const Model::BoundingBox& bounds = m_Model.m_pMesh[meshIndex].boundingBox;
+        const float Distance = Length(Max(Max(bounds.min - Eye, Eye - bounds.max), Vector3(kZero)));
+        if (Distance <= 0.0f)
+            continue;
+
+        const float ErrorScale = PixelsPerUnit / Distance;
+        for (uint32_t lod = 1; lod < m_Model.m_LODCount; ++lod)
+        {
+            const float Error = m_Model.GetMeshLOD(meshIndex, lod).error * ErrorScale;
+            if (Error <= LODErrorPixels)
+                MeshLOD[meshIndex] = (uint8_t)lod;
+            if (Error <= LODErrorPixels * ShadowLODBias)
+                MeshShadowLOD[meshIndex] = (uint8_t)lod;
+        }
+    }
+
+    // Visible meshes load before the casters around them, and nearer ones first.  A mesh asks for its finer
+    // levels while either view would use them.
+    if (m_Model.IsGeometryStreamed())
+    {
+        const uint32_t CoarsestLOD = m_Model.m_LODCount - 1;
+        bool ResidencyChanged = m_MeshResidentLOD.size() != NumMeshes;
+        m_MeshResidentLOD.resize(NumMeshes, 0);
+        for (uint32_t meshIndex = 0; meshIndex < NumMeshes; ++meshIndex)
+        {
+            if (std::min(MeshLOD[meshIndex], MeshShadowLOD[meshIndex]) < CoarsestLOD)
+            {
+                const Model::BoundingBox& bounds = m_Model.m_pMesh[meshIndex].boundingBox;
+                const float Distance = Length(Max(Max(bounds.min - Eye, Eye - bounds.max), Vector3(kZero)));
+                const float Priority = (m_MeshIsVisible[meshIndex] ? 1.0f : 0.0f) + 1.0f / (1.0f + Distance);
+                m_Model.RequestMeshGeometry(meshIndex, Priority);
+            }
+
+            const uint8_t ResidentLOD = (uint8_t)m_Model.GetResidentLOD(meshIndex);
+            MeshLOD[meshIndex] = std::max(MeshLOD[meshIndex], ResidentLOD);
+            MeshShadowLOD[meshIndex] = std::max(MeshShadowLOD[meshIndex], ResidentLOD);
+            ResidencyChanged |= m_MeshResidentLOD[meshIndex] != ResidentLOD;
+            m_MeshResidentLOD[meshIndex] = ResidentLOD;
+        }
+
+        if (ResidencyChanged)
+            ++m_ResidencyVersion;
+    }
+
+    // Bundles recorded with the last levels stay valid until one of them changes
+    if (m_MeshLOD.size() != NumMeshes || !std::equal(MeshLOD.begin(), MeshLOD.end(), m_MeshLOD.begin()))
+    {
+        m_MeshLOD.assign(MeshLOD.begin(), MeshLOD.end());
+        ++m_MeshLODVersion;
+    }
+    if (m_MeshShadowLOD.size() != NumMeshes || !std::equal(MeshShadowLOD.begin(), MeshShadowLOD.end(), m_MeshShadowLOD.begin()))
+    {
+        m_MeshShadowLOD.assign(MeshShadowLOD.begin(), MeshShadowLOD.end());
+        ++m_MeshShadowLODVersion;
+    }
+}
+
+void ModelViewer::RecordStaticDraws( ID3D12GraphicsCommandList* Bundle, D3D12_GPU_DESCRIPTOR_HANDLE MaterialTables,
+    eObjectFilter Filter, uint32_t NumViews, bool DepthOnlyStream, uint32_t FirstMesh, uint32_t EndMesh, uint32_t& NumDraws,
+    uint64_t& NumTriangles )
+{
+    const uint32_t ViewMask = 0xFFFFFFFFul >> (32 - NumViews);
+    const std::vector<uint8_t>& MeshLOD = Filter & kShadowLOD ? m_MeshShadowLOD : m_MeshLOD;
+
+    // Each material's six textures follow the previous material's in the persistent region
+    const UINT64 MaterialTableSize = 6 * g_Device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+
+    uint32_t materialIdx = 0xFFFFFFFFul;
+
+    for (uint32_t meshIndex = FirstMesh; meshIndex < EndMesh; ++meshIndex)
+    {
+        const Model::Mesh& mesh = m_Model.m_pMesh[meshIndex];
+        if (m_Model.IsMeshDynamic(meshIndex) || !(Filter & (m_pMaterialIsCutout[mesh.materialIndex] ? kCutout : kOpaque)))
+            continue;
+
+        const Model::MeshLOD& lod = m_Model.GetMeshLOD(meshIndex, MeshLOD[meshIndex]);
+        const uint32_t startIndex = m_Model.GetStartIndex(lod.indexDataByteOffset);
+        const uint32_t baseVertex = m_Model.GetBaseVertex(mesh, DepthOnlyStream);
+
+        if (mesh.materialIndex != materialIdx)
+        {
+            materialIdx = mesh.materialIndex;
+            if (!(Filter & kSkipMaterials))
+            {
+                D3D12_GPU_DESCRIPTOR_HANDLE MaterialTable = MaterialTables;
+                MaterialTable.ptr += materialIdx * MaterialTableSize;
+                Bundle->SetGraphicsRootDescriptorTable(2, MaterialTable);
+            }
+        }
+
+        const uint32_t Constants[3] = { baseVertex, materialIdx, ViewMask };
+        Bundle->SetGraphicsRoot32BitConstants(4, _countof(Constants), Constants, 0);
+        Bundle->DrawIndexedInstanced(lod.indexCount, NumViews, startIndex, baseVertex, 0);
+
+        ++NumDraws;
+        NumTriangles += (uint64_t)(lod.indexCount / 3) * NumViews;
+    }
+}
+
+void ModelViewer::RecordObjects( GraphicsContext& gfxContext, const RecordChunkFunc& RecordChunk )
+{
+    const uint32_t NumMeshes = m_Model.m_Header.meshCount;
+    const uint32_t NumChunks = std::min((uint32_t)ParallelChunks, NumMeshes);
+
+    // A single submission from the draw list leaves nothing to split
+    if (!ParallelRecording || NumChunks < 2 || (DrawList::Enable && !SceneInstances::IsActive()))
+    {
+        RecordChunk(gfxContext, 0, NumMeshes);
+        return;
+    }
+
+    // Split the meshes into chunks with about the same number of indices
+    uint64_t TotalIndices = 0;
+    for (uint32_t meshIndex = 0; meshIndex < NumMeshes; ++meshIndex)
+        TotalIndices += m_Model.m_pMesh[meshIndex].indexCount;
+
+    uint32_t* ChunkStart = FrameArena::AllocateArray<uint32_t>(NumChunks + 1);
+    ChunkStart[0] = 0;
+    for (uint32_t Chunk = 1; Chunk <= NumChunks; ++Chunk)
+        ChunkStart[Chunk] = NumMeshes;
+    uint64_t IndicesSoFar = 0;
+    for (uint32_t meshIndex = 0, Chunk = 1; meshIndex < NumMeshes && Chunk < NumChunks; ++meshIndex)
+    {
+        IndicesSoFar += m_Model.m_pMesh[meshIndex].indexCount;
+        if (IndicesSoFar * NumChunks >= TotalIndices * Chunk)
+            ChunkStart[Chunk++] = meshIndex + 1;
+    }
+
+    // Contexts are begun and finished on this thread.  Everything gfxContext has recorded so far has to
+    // reach the queue ahead of the chunks, and the chunks ahead of whatever it records next.  Chunks with
+    // enough meshes take large allocators.
+    CommandContext** Contexts = FrameArena::AllocateArray<CommandContext*>(NumChunks);
+    for (uint32_t Chunk = 0; Chunk < NumChunks; ++Chunk)
+        Contexts[Chunk] = &GraphicsContext::Begin(L"",
+            CommandAllocatorPool::GetSizeClass(ChunkStart[Chunk + 1] - ChunkStart[Chunk]));
+
+    gfxContext.Flush();
+
+    JobSystem::ParallelFor(NumChunks, 1, [&](uint32_t Chunk, uint32_t)
+    {
+        CPU_PROFILE_SCOPE(L"Record Chunk");
+        RecordChunk(Contexts[Chunk]->GetGraphicsContext(), ChunkStart[Chunk], ChunkStart[Chunk + 1]);
+    });
+
+    CommandContext::FinishParallel(Contexts, NumChunks);
+}
+
+void ModelViewer::RenderLightShadows(GraphicsContext& gfxContext)
+{
+    using namespace Lighting;
+
+    ScopedTimer _prof(L"RenderLightShadows", gfxContext);
+
+    UpdateShadowAtlas(gfxContext, m_Camera);
+
+    // Tiles that were not re-rendered while moment shadows were off still need converting
+    if (!ShadowMoments::Enable)
+    {
+        m_LightShadowMomentsValid = false;
+    }
+    else if (!m_LightShadowMomentsValid)
+    {
+        ShadowMoments::ConvertLightTiles(gfxContext.GetComputeContext(), m_LightShadowAtlas,
+            m_LightShadowTile + m_FirstConeShadowedLight, m_FirstPointShadowedLight - m_FirstConeShadowedLight);
+        m_LightShadowMomentsValid = true;
+    }
+
+    if (!SoftShadows::Enable)
+    {
+        m_LightShadowPyramidValid = false;
+    }
+    else if (!m_LightShadowPyramidValid)
+    {
+        SoftShadows::BuildLightTilePyramids(gfxContext.GetComputeContext(), m_LightShadowAtlas,
+            m_LightShadowTile + m_FirstConeShadowedLight, m_FirstPointShadowedLight - m_FirstConeShadowedLight);
+        m_LightShadowPyramidValid = true;
+    }
+
+    // Adapt the schedule to what the lights actually cost when they were last measured
+    const uint32_t FrameIndex = (uint32_t)Graphics::GetFrameCount();
+    ReportShadowUpdateCost(GpuTimeManager::GetLastTime(m_LightShadowTimer) * 1000.0f,
+        m_LightShadowUpdateCount[(FrameIndex - 2) % _countof(m_LightShadowUpdateCount)]);
+
+    uint32_t LightList[MaxLights];
+    const uint32_t NumLights = ScheduleShadowUpdates(LightList);
+    m_LightShadowUpdateCount[FrameIndex % _countof(m_LightShadowUpdateCount)] = NumLights;
+
+    if (NumLights == 0)
+        return;
+
+    // Cone lights render one view each and point lights render all of their faces at once
+    const uint32_t NumConeLights = (uint32_t)(std::stable_partition(LightList, LightList + NumLights,
+        [](uint32_t LightIndex) { return !IsPointShadowedLight(LightIndex); }) - LightList);
+
+    GpuTimeManager::StartTimer(gfxContext, m_LightShadowTimer);
+
+    // Every shadowed light has a culling slot of its own after the sun cascades
+    const uint32_t FirstCullSlot = CascadedShadowCamera::kMaxCascades;
+    static_assert(FirstCullSlot + MaxShadowedLights <= ShadowCasterCulling::kMaxViews, "Too few caster culling slots");
+    auto GetCullSlot = [FirstCullSlot](uint32_t LightIndex) { return FirstCullSlot + LightIndex - m_FirstConeShadowedLight; };
+
+    if (UseCasterCulling())
+    {
+        // Cone light matrices only exist on the GPU, so every cone light up to the last scheduled one is culled
+        if (NumConeLights > 0)
+        {
+            const uint32_t NumViews = *std::max_element(LightList, LightList + NumConeLights) - m_FirstConeShadowedLight + 1;
+            ShadowCasterCulling::CullViews(gfxContext, m_LightShadowMatrixBuffer, kLightShadowMatrixStride, NumViews, FirstCullSlot);
+        }
+
+        for (uint32_t i = NumConeLights; i < NumLights; ++i)
+        {
+            Matrix4 FaceViews[kMaxPointShadowFaces];
+            const uint32_t NumFaces = GetPointShadowCullViews(LightList[i], FaceViews);
+
+            PointShadowConstants Constants;
+            GetPointShadowConstants(LightList[i], Constants);
+            const Vector4 LightPos(Constants.LightPos[0], Constants.LightPos[1], Constants.LightPos[2], 1.0f);
+            ShadowCasterCulling::CullMultiView(gfxContext, FaceViews, NumFaces, GetCullSlot(LightList[i]), &LightPos);
+        }
+    }
+
+    m_LightShadowAtlas.BeginRendering(gfxContext, false);
+
+    {
+        ScopedTimer _prof(L"Cone Light Casters", gfxContext);
+
+        // Cone light matrices only exist on the GPU, so their instances are not culled
+        SetInstanceView(m_ShadowInstances, nullptr, 0);
+
+        for (uint32_t i = 0; i < NumConeLights; ++i)
+        {
+            const uint32_t LightIndex = LightList[i];
+
+            // Render straight into the light's tile.  The border texels are left cleared so that filtering
+            // never reads a neighboring tile.
+            const ShadowAtlasAllocator::Tile& Tile = m_LightShadowTile[LightIndex];
+
+            D3D12_VIEWPORT Viewport;
+            Viewport.TopLeftX = (float)Tile.X;
+            Viewport.TopLeftY = (float)Tile.Y;
+            Viewport.Width = (float)Tile.Size;
+            Viewport.Height = (float)Tile.Size;
+            Viewport.MinDepth = 0.0f;
+            Viewport.MaxDepth = 1.0f;
+
+            D3D12_RECT TileRect = { (LONG)Tile.X, (LONG)Tile.Y, (LONG)(Tile.X + Tile.Size), (LONG)(Tile.Y + Tile.Size) };
+            D3D12_RECT Scissor = { TileRect.left + 1, TileRect.top + 1, TileRect.right - 1, TileRect.bottom - 1 };
+
+            gfxContext.ClearDepth(m_LightShadowAtlas, TileRect);
+            gfxContext.SetViewportAndScissor(Viewport, Scissor);
+
+            gfxContext.SetConstantBuffer(0, GetLightShadowMatrixCBV(LightIndex));
+            RenderShadowCasters(gfxContext, GetCullSlot(LightIndex));
+        }
+    }
+
+    const uint32_t NumFaces = GetPointShadowFaceCount();
+
+    {
+        ScopedTimer _prof(L"Point Light Casters", gfxContext);
+
+        for (uint32_t i = NumConeLights; i < NumLights; ++i)
+        {
+            const uint32_t LightIndex = LightList[i];
+
+            // Each face has a viewport and scissor of its own, with the same cleared border as cone light tiles
+            D3D12_VIEWPORT Viewports[kMaxPointShadowFaces];
+            D3D12_RECT Scissors[kMaxPointShadowFaces];
+            for (uint32_t Face = 0; Face < NumFaces; ++Face)
+            {
+                const ShadowAtlasAllocator::Tile& Tile = m_PointShadowFaceTile[LightIndex][Face];
+
+                Viewports[Face].TopLeftX = (float)Tile.X;
+                Viewports[Face].TopLeftY = (float)Tile.Y;
+                Viewports[Face].Width = (float)Tile.Size;
+                Viewports[Face].Height = (float)Tile.Size;
+                Viewports[Face].MinDepth = 0.0f;
+                Viewports[Face].MaxDepth = 1.0f;
+
+                D3D12_RECT TileRect = { (LONG)Tile.X, (LONG)Tile.Y, (LONG)(Tile.X + Tile.Size), (LONG)(Tile.Y + Tile.Size) };
+                Scissors[Face] = { TileRect.left + 1, TileRect.top + 1, TileRect.right - 1, TileRect.bottom - 1 };
+
+                gfxContext.ClearDepth(m_LightShadowAtlas, TileRect);
+            }
+            gfxContext.SetViewportsAndScissors(NumFaces, Viewports, Scissors);
+
+            PointShadowConstants Constants;
+            GetPointShadowConstants(LightIndex, Constants);
+            gfxContext.SetDynamicConstantBufferView(0, sizeof(Constants), &Constants);
+
+            if (SceneInstances::IsActive())
+            {
+                Matrix4 FaceViews[kMaxPointShadowFaces];
+                SetInstanceView(m_ShadowInstances, FaceViews, GetPointShadowCullViews(LightIndex, FaceViews));
+            }
+
+            SetVertexStream(gfxContext, true);
+            gfxContext.SetPipelineState(m_PointShadowPSO);
+            if (UseCasterCulling())
+                ShadowCasterCulling::DrawCasters(gfxContext, GetCullSlot(LightIndex));
+            else
+                DrawObjects(gfxContext, (eObjectFilter)(kOpaque | kSkipMaterials | kShadowLOD), NumFaces, true);
+
+            SetVertexStream(gfxContext, false);
+            gfxContext.SetPipelineState(m_CutoutPointShadowPSO);
+            DrawObjects(gfxContext, (eObjectFilter)(kCutout | kShadowLOD), NumFaces);
+        }
+    }
+
+    m_LightShadowAtlas.EndRendering(gfxContext);
+
+    GpuTimeManager::StopTimer(gfxContext, m_LightShadowTimer);
+
+    // Point lights are only filtered with comparison samples, so only cone light tiles are converted
+    ShadowAtlasAllocator::Tile Tiles[MaxLights];
+    for (uint32_t i = 0; i < NumConeLights; ++i)
+        Tiles[i] = m_LightShadowTile[LightList[i]];
+
+    if (ShadowMoments::Enable && NumConeLights > 0)
+        ShadowMoments::ConvertLightTiles(gfxContext.GetComputeContext(), m_LightShadowAtlas, Tiles, NumConeLights);
+    if (SoftShadows::Enable && NumConeLights > 0)
+        SoftShadows::BuildLightTilePyramids(gfxContext.GetComputeContext(), m_LightShadowAtlas, Tiles, NumConeLights);
+}
+
+uint32_t ModelViewer::GetFirstScrollingCascade( void ) const
+{
+    return ShadowCascadeScrolling && !CascadedShadows::FitToDepthBuffer ?
+        (uint32_t)ShadowCascadeScrollFrom : (uint32_t)CascadedShadowCamera::kMaxCascades;
+}
+
+void ModelViewer::RenderCascadedShadows(GraphicsContext& gfxContext)
+{
+    ScopedTimer _prof(L"Render Shadow Cascades", gfxContext);
+
+    // The cascade matrices may have been computed on the GPU, so they are only ever referenced by address
+    CascadedShadows::TransitionForRendering(gfxContext);
+
+    const uint32_t NumCascades = (uint32_t)ShadowCascadeCount;
+    const uint32_t NumRedrawn = std::min(NumCascades, GetFirstScrollingCascade());
+
+    // Scrolling cascades keep their contents, so only the slices that are redrawn in full are cleared
+    if (NumRedrawn == NumCascades)
+    {
+        g_CascadedShadowBuffer.BeginRendering(gfxContext);
+        m_ScrollingCascadesValid = false;
+    }
+    else
+    {
+        const D3D12_RECT SliceRect = { 0, 0, (LONG)g_CascadedShadowBuffer.GetWidth(), (LONG)g_CascadedShadowBuffer.GetHeight() };
+        g_CascadedShadowBuffer.BeginRendering(gfxContext, false);
+        for (uint32_t Cascade = 0; Cascade < NumRedrawn; ++Cascade)
+            gfxContext.ClearDepth(g_CascadedShadowBuffer, Cascade, SliceRect);
+    }
+
+    if (NumRedrawn > 0)
+    {
+        // Cascades are redrawn every frame, so casters that only shadow what the camera cannot see are skipped.
+        // The receivers are framed by the same box as the single sun shadow map.
+        if (UseCasterCulling() && ShadowCasterCulling::ReceiverCulling)
+        {
+            ShadowCamera ReceiverFrame;
+            ReceiverFrame.UpdateMatrix(-m_SunDirection, Vector3(0, -500.0f, 0), Vector3(ShadowDimX, ShadowDimY, ShadowDimZ),
+                ShadowCasterCulling::kReceiverGridSize, ShadowCasterCulling::kReceiverGridSize, 16);
+            ShadowCasterCulling::FindReceivers(gfxContext, m_Camera, ReceiverFrame.GetViewProjMatrix());
+        }
+
+        if (ShadowCascadeSinglePass)
+        {
+            RenderCascadedShadowsSinglePass(gfxContext, NumRedrawn);
+        }
+        else
+        {
+            // Cascades cull into the first slots.  Their matrices may only exist on the GPU, so instances are not culled.
+            SetInstanceView(m_ShadowInstances, nullptr, 0);
+            if (UseCasterCulling())
+            {
+                ShadowCasterCulling::CullViews(gfxContext, CascadedShadows::m_CascadeBuffer, CascadedShadows::kCascadeStride,
+                    NumRedrawn, 0, true);
+            }
+
+            static const wchar_t* kCascadeNames[] = { L"Cascade 0", L"Cascade 1", L"Cascade 2", L"Cascade 3",
+                L"Cascade 4", L"Cascade 5", L"Cascade 6", L"Cascade 7" };
+            static_assert(_countof(kCascadeNames) == CascadedShadowCamera::kMaxCascades, "One profiling scope name per cascade");
+
+            for (uint32_t Cascade = 0; Cascade < NumRedrawn; ++Cascade)
+            {
+                ScopedTimer _prof(kCascadeNames[Cascade], gfxContext);
+                DrawStatistics::SetView(DrawStatistics::kFirstCascadeView + Cascade);
+                g_CascadedShadowBuffer.SetRenderSlice(gfxContext, Cascade);
+                gfxContext.SetConstantBuffer(0, CascadedShadows::GetCascadeCBV(Cascade));
+                RenderShadowCasters(gfxContext, Cascade);
+            }
+            DrawStatistics::SetView(DrawStatistics::kSunShadowView);
+        }
+    }
+
+    if (NumRedrawn < NumCascades)
+        RenderScrollingCascades(gfxContext, NumRedrawn);
+
+    g_CascadedShadowBuffer.EndRendering(gfxContext);
+}
+
+void ModelViewer::RenderCascadedShadowsSinglePass(GraphicsContext& gfxContext, uint32_t NumCascades)
+{
+    // One instanced draw per mesh (or meshlet facing the sun) that lands in any cascade
+    SetInstanceView(m_ShadowInstances, nullptr, 0);
+    if (UseCasterCulling())
+    {
+        const Vector4 SunLight(-m_SunDirection, 0.0f);
+        ShadowCasterCulling::CullMultiView(gfxContext, CascadedShadows::m_CascadeBuffer, CascadedShadows::kCascadeStride,
+            NumCascades, 0, true, &SunLight);
+    }
+
+    // Every slice is bound at once and the vertex shader picks the slice for each instance
+    g_CascadedShadowBuffer.SetRenderTarget(gfxContext);
+    gfxContext.SetConstantBuffer(0, CascadedShadows::GetCascadeCBV(0));
+
+    SetVertexStream(gfxContext, true);
+    gfxContext.SetPipelineState(m_CascadeShadowPSO);
+    if (UseCasterCulling())
+        ShadowCasterCulling::DrawCasters(gfxContext, 0);
+    else
+        DrawObjects(gfxContext, (eObjectFilter)(kOpaque | kSkipMaterials | kShadowLOD), NumCascades, true);
+
+    SetVertexStream(gfxContext, false);
+    gfxContext.SetPipelineState(m_CutoutCascadeShadowPSO);
+    DrawObjects(gfxContext, (eObjectFilter)(kCutout | kShadowLOD), NumCascades);
+}
+
+namespace
+{
+    // Scale and offset clip space so that a rectangle of a cascade's view fills [-1, 1]
+    Matrix4 GetCascadeRectViewProj( const Matrix4& ViewProj, const D3D12_RECT& Rect, float Width, float Height )
+    {
+        const float Left = Rect.left * 2.0f / Width - 1.0f;
+        const float Right = Rect.right * 2.0f / Width - 1.0f;
+        const float Top = 1.0f - Rect.top * 2.0f / Height;
+        const float Bottom = 1.0f - Rect.bottom * 2.0f / Height;
+
+        const float ScaleX = 2.0f / (Right - Left);
+        const float ScaleY = 2.0f / (Top - Bottom);
+        Matrix4 Crop(
+            Vector4(ScaleX, 0.0f, 0.0f, 0.0f),
+            Vector4(0.0f, ScaleY, 0.0f, 0.0f),
+            Vector4(0.0f, 0.0f, 1.0f, 0.0f),
+            Vector4(-(Right + Left) * 0.5f * ScaleX, -(Top + Bottom) * 0.5f * ScaleY, 0.0f, 1.0f));
+
+        return Crop * ViewProj;
+    }
+
+    // Splits [Begin, End) of a view axis where its toroidal storage wraps.  Returns the number of pieces.
+    uint32_t SplitWrappedRange( LONG Begin, LONG End, LONG Offset, LONG Size, LONG ViewSplit[3], LONG StoreBegin[2] )
+    {
+        const LONG Start = (Begin + Offset) % Size;
+        ViewSplit[0] = Begin;
+        StoreBegin[0] = Start;
+        if (Start + End - Begin <= Size)
+        {
+            ViewSplit[1] = End;
+            return 1;
+        }
+        ViewSplit[1] = Begin + Size - Start;
+        ViewSplit[2] = End;
+        StoreBegin[1] = 0;
+        return 2;
+    }
+}
+
+void ModelViewer::RenderScrollingCascades(GraphicsContext& gfxContext, uint32_t FirstCascade)
+{
+    ScopedTimer _prof(L"Scrolling Cascades", gfxContext);
+
+    const LONG Width = (LONG)g_CascadedShadowBuffer.GetWidth();
+    const LONG Height = (LONG)g_CascadedShadowBuffer.GetHeight();
+    const uint32_t NumCascades = (uint32_t)ShadowCascadeCount;
+
+    // Texels that stay would keep the shadows of anything that moved, so scenes with dynamic meshes are
+    // redrawn in full.  So is everything when the static geometry changes.
+    const bool Redraw = !m_ScrollingCascadesValid || m_Model.GetDynamicMeshCount() != 0 ||
+        m_ScrollingCascadeGeometryVersion != GetCachedGeometryVersion();
+    m_ScrollingCascadesValid = true;
+    m_ScrollingCascadeGeometryVersion = GetCachedGeometryVersion();
+
+    // At most a column and a row strip per cascade, in its view's texels
+    enum { kMaxStrips = CascadedShadowCamera::kMaxCascades * 2 };
+    D3D12_RECT Strips[kMaxStrips];
+    uint32_t StripCascade[kMaxStrips];
+    Matrix4 StripViews[kMaxStrips];
+    uint32_t NumStrips = 0;
+
+    for (uint32_t Cascade = FirstCascade; Cascade < NumCascades; ++Cascade)
+    {
+        const ShadowCamera& Shadow = m_SunCascades.GetCascade(Cascade);
+        ScrolledCascade& Contents = m_ScrolledCascades[Cascade];
+        const LONG DeltaX = Shadow.GetTexelCenterX() - Contents.TexelX;
+        const LONG DeltaY = Shadow.GetTexelCenterY() - Contents.TexelY;
+
+        if (Redraw || Contents.Epoch != m_SunCascades.GetScrollEpoch(Cascade) ||
+            std::abs(DeltaX) >= Width || std::abs(DeltaY) >= Height)
+        {
+            Strips[NumStrips] = { 0, 0, Width, Height };
+            StripCascade[NumStrips++] = Cascade;
+        }
+        else
+        {
+            // Moving right exposes columns on the right.  Rows count down, so moving up exposes rows at the top.
+            if (DeltaX != 0)
+            {
+                Strips[NumStrips] = DeltaX > 0 ? D3D12_RECT{ Width - DeltaX, 0, Width, Height } : D3D12_RECT{ 0, 0, -DeltaX, Height };
+                StripCascade[NumStrips++] = Cascade;
+            }
+            if (DeltaY != 0)
+            {
+                Strips[NumStrips] = DeltaY > 0 ? D3D12_RECT{ 0, 0, Width, DeltaY } : D3D12_RECT{ 0, Height + DeltaY, Width, Height };
+                StripCascade[NumStrips++] = Cascade;
+            }
+        }
+
+        Contents.Epoch = m_SunCascades.GetScrollEpoch(Cascade);
+        Contents.TexelX = Shadow.GetTexelCenterX();
+        Contents.TexelY = Shadow.GetTexelCenterY();
+    }
+
+    EngineProfiling::SetCounter("Scrolled Cascade Strips", NumStrips);
+    if (NumStrips == 0)
+        return;
+
+    for (uint32_t i = 0; i < NumStrips; ++i)
+    {
+        StripViews[i] = GetCascadeRectViewProj(m_SunCascades.GetCascade(StripCascade[i]).GetViewProjMatrix(),
+            Strips[i], (float)Width, (float)Height);
+    }
+
+    // Strips cull into the slots of the virtual shadow pages, which are never rendered alongside cascades.
+    // Already rendered texels are kept, so casters are not tested against this frame's receivers.
+    const uint32_t FirstCullSlot = CascadedShadowCamera::kMaxCascades + Lighting::MaxShadowedLights;
+    static_assert(FirstCullSlot + kMaxStrips <= ShadowCasterCulling::kMaxViews, "Too few caster culling slots");
+    if (UseCasterCulling())
+        ShadowCasterCulling::CullViews(gfxContext, StripViews, NumStrips, FirstCullSlot);
+
+    for (uint32_t i = 0; i < NumStrips; ++i)
+    {
+        const uint32_t Cascade = StripCascade[i];
+        const D3D12_RECT& Strip = Strips[i];
+        const Matrix4& ViewProj = m_SunCascades.GetCascade(Cascade).GetViewProjMatrix();
+
+        g_CascadedShadowBuffer.SetRenderSlice(gfxContext, Cascade);
+        SetInstanceView(m_ShadowInstances, &StripViews[i], 1);
+
+        // A strip is stored in up to four rectangles where it crosses the edges of the slice
+        LONG SplitX[3], StoreX[2], SplitY[3], StoreY[2];
+        const uint32_t PiecesX = SplitWrappedRange(Strip.left, Strip.right, (LONG)m_SunCascades.GetWrapOffsetX(Cascade), Width, SplitX, StoreX);
+        const uint32_t PiecesY = SplitWrappedRange(Strip.top, Strip.bottom, (LONG)m_SunCascades.GetWrapOffsetY(Cascade), Height, SplitY, StoreY);
+
+        for (uint32_t y = 0; y < PiecesY; ++y)
+        {
+            for (uint32_t x = 0; x < PiecesX; ++x)
+            {
+                const D3D12_RECT ViewRect = { SplitX[x], SplitY[y], SplitX[x + 1], SplitY[y + 1] };
+                const D3D12_RECT StoreRect = { StoreX[x], StoreY[y],
+                    StoreX[x] + ViewRect.right - ViewRect.left, StoreY[y] + ViewRect.bottom - ViewRect.top };
+
+                D3D12_VIEWPORT Viewport;
+                Viewport.TopLeftX = (float)StoreRect.left;
+                Viewport.TopLeftY = (float)StoreRect.top;
+                Viewport.Width = (float)(StoreRect.right - StoreRect.left);
+                Viewport.Height = (float)(StoreRect.bottom - StoreRect.top);
+                Viewport.MinDepth = 0.0f;
+                Viewport.MaxDepth = 1.0f;
+
+                gfxContext.ClearDepth(g_CascadedShadowBuffer, Cascade, StoreRect);
+                gfxContext.SetViewportAndScissor(Viewport, StoreRect);
+
+                SetVSConstants(gfxContext, GetCascadeRectViewProj(ViewProj, ViewRect, (float)Width, (float)Height));
+                RenderShadowCasters(gfxContext, FirstCullSlot + i);
+            }
+        }
+    }
+}
+
+void ModelViewer::RenderCachedSunShadow(GraphicsContext& gfxContext)
+{
+    // Static casters are only redrawn when the projection or the static geometry changes, or when
+    // the cache itself was recreated (e.g. on a resolution change.)
+    if (!m_ShadowCacheValid || m_SunShadow.HasMatrixChanged() ||
+        m_ShadowCacheResource != g_StaticShadowBuffer.GetResource() ||
+        m_ShadowCacheGeometryVersion != GetCachedGeometryVersion())
+    {
+        ScopedTimer _prof(L"Static Casters", gfxContext);
+
+        // Full detail, since the cache outlives the camera distances the LODs were chosen for
+
+        SetInstanceView(m_ShadowInstances, &m_SunShadow.GetViewProjMatrix(), 1);
+        g_StaticShadowBuffer.BeginRendering(gfxContext);
+        const eObjectFilter Raster = RasterizeSmallCasters(gfxContext, m_SunShadow.GetViewProjMatrix(), g_StaticShadowBuffer, false);
+        gfxContext.SetPipelineState(m_SunShadowPSO);
+        RenderObjectsDepth(gfxContext, m_SunShadow.GetViewProjMatrix(), (eObjectFilter)(kOpaque | kStatic | kSkipMaterials | Raster));
+        gfxContext.SetPipelineState(m_CutoutSunShadowPSO);
+        RenderObjects(gfxContext, m_SunShadow.GetViewProjMatrix(), (eObjectFilter)(kCutout | kStatic));
+        g_StaticShadowBuffer.EndRendering(gfxContext);
+
+        m_ShadowCacheValid = true;
+        m_ShadowCacheResource = g_StaticShadowBuffer.GetResource();
+        m_ShadowCacheGeometryVersion = GetCachedGeometryVersion();
+    }
+
+    // With nothing moving, the cache can be sampled directly
+    if (m_Model.GetDynamicMeshCount() == 0)
+    {
+        gfxContext.TransitionResource(g_StaticShadowBuffer, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+        m_SunShadowMap = &g_StaticShadowBuffer;
+        m_ExtraTextures[1] = g_StaticShadowBuffer.GetSRV();
+        return;
+    }
+
+    ScopedTimer _prof(L"Dynamic Casters", gfxContext);
+
+    gfxContext.CopyBuffer(g_ShadowBuffer, g_StaticShadowBuffer);
+    SetInstanceView(m_ShadowInstances, &m_SunShadow.GetViewProjMatrix(), 1);
+
+    g_ShadowBuffer.BeginRendering(gfxContext, false);
+    gfxContext.SetPipelineState(m_SunShadowPSO);
+    RenderObjectsDepth(gfxContext, m_SunShadow.GetViewProjMatrix(), (eObjectFilter)(kOpaque | kDynamic | kSkipMaterials | kShadowLOD));
+    gfxContext.SetPipelineState(m_CutoutSunShadowPSO);
+    RenderObjects(gfxContext, m_SunShadow.GetViewProjMatrix(), (eObjectFilter)(kCutout | kDynamic | kShadowLOD));
+    g_ShadowBuffer.EndRendering(gfxContext);
+
+    m_SunShadowMap = &g_ShadowBuffer;
+    m_ExtraTextures[1] = g_ShadowBuffer.GetSRV();
+}
+
+void ModelViewer::RenderVirtualSunShadow(GraphicsContext& gfxContext)
+{
+    ScopedTimer _prof(L"Virtual Shadow Pages", gfxContext);
+
+    uint32_t PageList[VirtualShadowMap::kMaxPageUpdates];
+    const uint32_t NumPages = VirtualShadowMap::UpdatePages(m_VirtualSunShadow, PageList, (uint32_t)VirtualShadowMap::MaxPageUpdates);
+    if (NumPages == 0)
+        return;
+
+    Matrix4 PageViews[VirtualShadowMap::kMaxPageUpdates];
+    for (uint32_t i = 0; i < NumPages; ++i)
+        PageViews[i] = VirtualShadowMap::GetPageViewProjMatrix(m_VirtualSunShadow, PageList[i]);
+
+    // Pages cull into the slots after the lights
+    const uint32_t FirstCullSlot = CascadedShadowCamera::kMaxCascades + Lighting::MaxShadowedLights;
+    if (UseCasterCulling())
+        ShadowCasterCulling::CullViews(gfxContext, PageViews, NumPages, FirstCullSlot);
+
+    ShadowBuffer& ShadowMap = VirtualShadowMap::m_VirtualShadowMap;
+    ShadowMap.BeginRendering(gfxContext, false);
+
+    for (uint32_t i = 0; i < NumPages; ++i)
+    {
+        const D3D12_RECT PageRect = VirtualShadowMap::GetPageRect(PageList[i]);
+
+        D3D12_VIEWPORT Viewport;
+        Viewport.TopLeftX = (float)PageRect.left;
+        Viewport.TopLeftY = (float)PageRect.top;
+        Viewport.Width = (float)(PageRect.right - PageRect.left);
+        Viewport.Height = (float)(PageRect.bottom - PageRect.top);
+        Viewport.MinDepth = 0.0f;
+        Viewport.MaxDepth = 1.0f;
+
+        gfxContext.ClearDepth(ShadowMap, PageRect);
+        gfxContext.SetViewportAndScissor(Viewport, PageRect);
+
+        SetVSConstants(gfxContext, PageViews[i]);
+        SetInstanceView(m_ShadowInstances, &PageViews[i], 1);
+        RenderShadowCasters(gfxContext, FirstCullSlot + i);
+    }
+
+    ShadowMap.EndRendering(gfxContext);
+}
+
+void ModelViewer::RenderScene( void )
+{
+    static bool s_ShowLightCounts = false;
+    if (ShowWaveTileCounts != s_ShowLightCounts)
+    {
+        static bool EnableHDR;
+        if (ShowWaveTileCounts)
+        {
+            EnableHDR = PostEffects::EnableHDR;
+            PostEffects::EnableHDR = false;
+        }
+        else
+        {
+            PostEffects::EnableHDR = EnableHDR;
+        }
+        s_ShowLightCounts = ShowWaveTileCounts;
+    }
+
+    // Mips and meshes asked for by earlier frames become resident, or start to stream, before anything reads them
+    TextureFeedback::Update(m_Model);
+    TextureStreaming::Update();
+    GeometryStreaming::Update();
+
+    DrawStatistics::BeginFrame();
+
+    GraphicsContext& gfxContext = GraphicsContext::Begin(L"Scene Render");
+
+    // Every pass below draws the pose skinned here
+    if (m_Skinning.IsValid())
+        m_Skinning.Update(gfxContext.GetComputeContext(), AnimationClip, m_AnimationTime);
+
+    DrawList::Update(gfxContext, m_Model, m_pMaterialIsCutout);
+    StaticBundles::Update(m_Model);
+
+    // Multi-view frames cull once for every eye, and sort and pick levels of detail from the camera between them
+    const uint32_t NumViews = MultiView::GetViewCount();
+    ViewCulling::CullMeshes(m_Model, NumViews > 1 ? MultiView::GetCullCamera() : m_Camera, m_MeshIsVisible);
+    ViewCulling::SortMeshes(m_Model, m_Camera, m_pMaterialIsCutout, m_MeshIsVisible, m_MeshDrawOrder);
+    SelectMeshLODs();
+    if (NumViews > 1)
+        SetInstanceView(m_CameraInstances, MultiView::GetViewProjMatrices(), NumViews);
+    else
+        SetInstanceView(m_CameraInstances, &m_ViewProjMatrix, 1);
+    if (DrawList::Enable)
+    {
+        DrawList::SetMeshLODs(gfxContext, m_Model, m_MeshLOD, m_MeshShadowLOD);
+        DrawList::SetVisibleMeshes(gfxContext, m_MeshIsVisible, m_MeshDrawOrder);
+    }
+
+    // The debug view composites SSAO on the graphics queue and skips the shadows, so it keeps the serial order
+    const bool UseAsyncCompute = AsyncComputeOverlap && !SSAO::DebugDraw;
+    const bool AsyncParticles = UseAsyncCompute && AsyncParticleUpdate;
+
+    if (!AsyncParticles)
+        ParticleEffects::Update(gfxContext.GetComputeContext(), Graphics::GetFrameTime());
+
+    uint32_t FrameIndex = TemporalEffects::GetFrameIndexMod2();
+
+    __declspec(align(16)) struct
+    {
+        Vector3 sunDirection;
+        Vector3 sunLight;
+        Vector3 ambientLight;
+        float ShadowTexelSize[4];
+
+        float InvTileDim[4];
+        uint32_t TileCount[4];
+        uint32_t FirstLightIndex[4];
+        uint32_t FrameIndexMod2;
+
+        uint32_t NumCascades;
+        float CascadeBlendRange;
+        float Padding;
+        Vector3 CameraForward;
+
+        float MomentShadowParams[4];
+        float SoftShadowParams[4];
+        uint32_t SoftShadowSamples[4];
+        Matrix4 VirtualShadowMatrix;
+        float VirtualShadowParams[4];
+        float ShadowMaskParams[4];
+        float ClusterParams[4];
+        uint32_t MipFeedbackParams[4];
+        float TemporalShadowParams[4];
+    } psConstants;
+
+    // The virtual shadow map replaces the cascades, with the regular sun shadow map as its fallback
+    const bool UseVirtualShadows = VirtualShadowMap::IsEnabled();
+    const bool UseCascades = EnableCascadedShadows && !UseVirtualShadows;
+
+    if (UseVirtualShadows)
+    {
+        m_VirtualSunShadow.UpdateMatrix(-m_SunDirection, Vector3(0, -500.0f, 0), Vector3(ShadowDimX, ShadowDimY, ShadowDimZ),
+            VirtualShadowMap::kVirtualSize, VirtualShadowMap::kVirtualSize, VirtualShadowMap::m_VirtualShadowMap.GetDepthPrecision());
+    }
+
+    // Cascades fitted to the depth buffer are computed later, once the depth pre-pass is done
+    if (UseCascades && !CascadedShadows::FitToDepthBuffer)
+    {
+        m_SunCascades.UpdateMatrices(m_Camera, -m_SunDirection, ShadowCascadeCount, ShadowCascadeLambda,
+            ShadowCascadeDistance, ShadowDimZ, (uint32_t)g_CascadedShadowBuffer.GetWidth(),
+            (uint32_t)g_CascadedShadowBuffer.GetHeight(), g_CascadedShadowBuffer.GetDepthPrecision(),
+            GetFirstScrollingCascade());
+        CascadedShadows::UploadCascades(gfxContext, m_SunCascades);
+    }
+
+    psConstants.sunDirection = m_SunDirection;
+    psConstants.sunLight = Vector3(1.0f, 1.0f, 1.0f) * m_SunLightIntensity;
+    psConstants.ambientLight = Vector3(1.0f, 1.0f, 1.0f) * m_AmbientIntensity;
+    psConstants.ShadowTexelSize[0] = 1.0f / g_ShadowBuffer.GetWidth();
+    psConstants.ShadowTexelSize[1] = 1.0f / g_CascadedShadowBuffer.GetWidth();
+    psConstants.ShadowTexelSize[2] = 1.0f / Lighting::m_LightShadowAtlas.GetWidth();
+    psConstants.InvTileDim[0] = 1.0f / Lighting::LightGridDim;
+    psConstants.InvTileDim[1] = 1.0f / Lighting::LightGridDim;
+    psConstants.TileCount[0] = Math::DivideByMultiple(DynamicResolution::GetWidth(), Lighting::LightGridDim);
+    psConstants.TileCount[1] = Math::DivideByMultiple(DynamicResolution::GetHeight(), Lighting::LightGridDim);
+    psConstants.FirstLightIndex[0] = Lighting::m_FirstConeLight;
+    psConstants.FirstLightIndex[1] = Lighting::m_FirstConeShadowedLight;
+    psConstants.FirstLightIndex[2] = Lighting::m_FirstPointShadowedLight;
+    psConstants.FrameIndexMod2 = FrameIndex;
+    psConstants.NumCascades = UseCascades ? (uint32_t)ShadowCascadeCount : 0;
+    psConstants.CascadeBlendRange = ShadowCascadeBlend;
+    psConstants.CameraForward = m_Camera.GetForwardVec();
+    psConstants.MomentShadowParams[0] = ShadowMoments::Enable ? 1.0f : 0.0f;
+    psConstants.MomentShadowParams[1] = ShadowMoments::LightBleedReduction;
+    // An orthographic shadow map spans ShadowDimZ in depth and ShadowDimX across
+    psConstants.SoftShadowParams[0] = std::tan(XMConvertToRadians(SoftShadows::SunAngularDiameter * 0.5f)) *
+        (float)ShadowDimZ / (float)ShadowDimX;
+    psConstants.SoftShadowParams[1] = SoftShadows::ConeLightSize;
+    psConstants.SoftShadowParams[2] = SoftShadows::MaxSearchRadius;
+    psConstants.SoftShadowSamples[0] = SoftShadows::Enable ? 1 : 0;
+    psConstants.SoftShadowSamples[1] = (uint32_t)SoftShadows::BlockerSamples;
+    psConstants.SoftShadowSamples[2] = (uint32_t)SoftShadows::FilterSamples;
+    psConstants.VirtualShadowMatrix = m_VirtualSunShadow.GetShadowMatrix();
+    psConstants.VirtualShadowParams[0] = UseVirtualShadows ? 1.0f : 0.0f;
+    psConstants.VirtualShadowParams[1] = 1.0f / VirtualShadowMap::kVirtualSize;
+    psConstants.ShadowMaskParams[0] = SunShadowMask::Enable ? 1.0f : 0.0f;
+    Lighting::GetClusterParams(m_Camera, psConstants.ClusterParams);
+    TextureFeedback::GetShaderParams(psConstants.MipFeedbackParams);
+
+    // Stepping by the golden angle keeps the rotations of nearby frames far apart
+    const float ShadowRotation = (float)(Graphics::GetFrameCount() % 1024) * 2.3999632f;
+    psConstants.TemporalShadowParams[0] = TemporalShadowFilter && TemporalEffects::EnableTAA ? (float)TemporalShadowTaps : 0.0f;
+    psConstants.TemporalShadowParams[1] = std::cos(ShadowRotation);
+    psConstants.TemporalShadowParams[2] = std::sin(ShadowRotation);
+    psConstants.TemporalShadowParams[3] = 0.0f;
+
+    // The SM 6.0 light loops and the tile count view have no bindless variant, so their opaque draws still bind
+    // each material's textures.  Neither do the multi-view passes, which replace them.
+    const bool Bindless = m_BindlessSupported && BindlessMaterials && NumViews == 1;
+#ifdef _WAVE_OP
+    const bool BindlessOpaque = Bindless && !EnableWaveOps;
+#else
+    const bool BindlessOpaque = Bindless && !ShowWaveTileCounts;
+#endif
+
+    // The Hi-Z culling draws each mesh whole, once with its model transform
+    const bool UseHiZCulling = HiZCulling::Enable && !SceneInstances::IsActive() && !m_Model.IsGeometryStreamed();
+
+    // A restricted pre-pass leaves the depth of the other opaque meshes to the color pass, so nothing ahead of it
+    // may need them.  The light clusters stay conservative by filling in front of the depth they find, and the
+    // linear depth is made again after the color pass.  Occluders are found from the boxes of the meshes where
+    // the model put them, which scene instances move.
+#ifdef _WAVE_OP
+    const bool PlainColorPass = !EnableWaveOps;
+#else
+    const bool PlainColorPass = !ShowWaveTileCounts;
+#endif
+    const bool CanRestrictPrepass = PlainColorPass && !UseHiZCulling && !SceneInstances::IsActive() && !SSAO::Enable &&
+        !SSAO::DebugDraw && !SunShadowMask::Enable && !UseVirtualShadows && !(UseCascades && CascadedShadows::FitToDepthBuffer) &&
+        Lighting::ClusteredLighting && NumViews == 1;
+    const bool RestrictPrepass = DepthPrepass::BeginFrame(CanRestrictPrepass);
+    if (RestrictPrepass)
+    {
+        if (DepthPrepass::Mode == DepthPrepass::kOff)
+            m_MeshIsOccluder.assign(m_Model.m_Header.meshCount, false);
+        else
+            ViewCulling::FindOccluders(m_Model, m_Camera, DepthPrepass::MinOccluderArea, m_MeshIsVisible, m_MeshIsOccluder);
+    }
+
+    // Set the default state for command lists
+    auto pfnSetupGraphicsState = [&](GraphicsContext& Context)
+    {
+        SetupGraphicsState(Context);
+    };
+
+    pfnSetupGraphicsState(gfxContext);
+
+    // The camera passes of a multi-view frame draw every eye at once, each instance of a draw picking its eye's
+    // matrix and viewport
+    auto pfnSetCameraView = [&](GraphicsContext& Context)
+    {
+        if (NumViews > 1)
+        {
+            MultiView::SetViewportsAndScissors(Context);
+            MultiView::SetVSConstants(Context, m_SunShadow.GetShadowMatrix());
+        }
+        else
+        {
+            Context.SetViewportAndScissor(m_MainViewport, m_MainScissor);
+            SetVSConstants(Context, m_ViewProjMatrix);
+        }
+    };
+
+    DrawStatistics::SetView(DrawStatistics::kLightShadowView);
+    RenderLightShadows(gfxContext);
+    DrawStatistics::SetView(DrawStatistics::kMainView);
+
+    {
+        ScopedTimer _prof(L"Z PrePass", gfxContext);
+
+        // The light shadows drew from lists of their own
+        m_DrawInstances = &m_CameraInstances;
+
+        gfxContext.SetDynamicConstantBufferView(1, sizeof(psConstants), &psConstants);
+
+        // Each chunk binds the depth target itself, so that it can be recorded on any context
+        auto pfnSetupDepthState = [&](GraphicsContext& Context)
+        {
+            pfnSetupGraphicsState(Context);
+            Context.SetDynamicConstantBufferView(1, sizeof(psConstants), &psConstants);
+            Context.SetDepthStencilTarget(g_SceneDepthBuffer.GetDSV());
+            pfnSetCameraView(Context);
+        };
+
+        {
+            ScopedTimer _prof1(L"Opaque", gfxContext);
+            gfxContext.TransitionResource(g_SceneDepthBuffer, D3D12_RESOURCE_STATE_DEPTH_WRITE, true);
+            gfxContext.ClearDepth(g_SceneDepthBuffer);
+            DepthPrepass::StartTimer(gfxContext, DepthPrepass::kPrepassTimer);
+
+            auto pfnSetupOpaqueDepthState = [&](GraphicsContext& Context)
+            {
+                pfnSetupDepthState(Context);
+                SetVertexStream(Context, true);
+                if (NumViews > 1)
+                    Context.SetPipelineState(m_MultiViewDepthPSO);
+                else
+#ifdef _WAVE_OP
+                    Context.SetPipelineState(EnableWaveOps ? m_DepthWaveOpsPSO : m_DepthPSO );
+#else
+                    Context.SetPipelineState(m_DepthPSO);
+#endif
+            };
+
+            if (UseHiZCulling)
+            {
+                // The culling dispatches replace the PSO and may switch descriptor heaps, so the draw state is
+                // bound again after each
+                HiZCulling::CullFirstPhase(gfxContext, m_Camera);
+                pfnSetupOpaqueDepthState(gfxContext);
+                HiZCulling::Draw(gfxContext, HiZCulling::kFirstPhase, true);
+                HiZCulling::CullSecondPhase(gfxContext, m_Camera);
+                pfnSetupOpaqueDepthState(gfxContext);
+                HiZCulling::Draw(gfxContext, HiZCulling::kSecondPhase, true);
+            }
+            else
+            {
+                const eObjectFilter Occluders = RestrictPrepass ? kOccluder : kNone;
+                RecordObjects(gfxContext, [&](GraphicsContext& Context, uint32_t FirstMesh, uint32_t EndMesh)
+                {
+                    pfnSetupOpaqueDepthState(Context);
+                    DrawObjects(Context, (eObjectFilter)(kOpaque | kSkipMaterials | kVisible | Occluders), NumViews, true,
+                        FirstMesh, EndMesh);
+                });
+            }
+
+            DepthPrepass::StopTimer(gfxContext, DepthPrepass::kPrepassTimer);
+        }
+
+        {
+            ScopedTimer _prof2(L"Cutout", gfxContext);
+            RecordObjects(gfxContext, [&](GraphicsContext& Context, uint32_t FirstMesh, uint32_t EndMesh)
+            {
+                pfnSetupDepthState(Context);
+                Context.SetPipelineState(NumViews > 1 ? m_MultiViewCutoutDepthPSO : Bindless ? m_BindlessCutoutDepthPSO : m_CutoutDepthPSO);
+                DrawObjects(Context, (eObjectFilter)((Bindless ? kCutout | kSkipMaterials : kCutout) | kVisible), NumViews, false,
+                    FirstMesh, EndMesh);
+            });
+        }
+    }
+
+    ViewCulling::CaptureOcclusionDepth(gfxContext, m_Camera);
+
+    // Both eyes share one grid, split between their halves of the target
+    Lighting::GridViews GridViews;
+    const Lighting::GridViews* pGridViews = nullptr;
+    if (NumViews > 1)
+    {
+        MultiView::GetGridViews(GridViews);
+        pGridViews = &GridViews;
+    }
+
+    const bool UseVolumetrics = VolumetricLighting::Enable;
+    Lighting::m_FillFrontClusters = UseVolumetrics || RestrictPrepass;
+
+    if (UseAsyncCompute)
+    {
+        // Leave everything the compute work touches in a state the compute queue can use, then make it wait
+        // for the depth pre-pass
+        gfxContext.TransitionResource(g_SceneDepthBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        gfxContext.TransitionResource(g_SSAOFullScreen, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+        gfxContext.TransitionResource(Lighting::m_LightBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        gfxContext.TransitionResource(Lighting::m_LightGrid, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+        gfxContext.TransitionResource(Lighting::m_LightGridBitMask, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+        gfxContext.TransitionResource(Lighting::m_LightClusters, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+        gfxContext.TransitionResource(Lighting::m_LightClusterList, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+        g_CommandManager.GetComputeQueue().StallForFence(gfxContext.Flush());
+        pfnSetupGraphicsState(gfxContext);
+
+        ComputeContext& asyncContext = ComputeContext::Begin(L"Async Compute", true);
+        if (AsyncParticles)
+            ParticleEffects::Update(asyncContext, Graphics::GetFrameTime());
+        SSAO::Render(gfxContext, asyncContext, m_Camera);
+        // Without the full depth yet, depth of field classifies its tiles itself when it renders
+        if (!RestrictPrepass)
+            DepthOfField::ClassifyTiles(asyncContext, m_Camera.GetFarClip());
+        Lighting::FillLightGrid(asyncContext, m_Camera, pGridViews, GetSceneDepthVersion());
+        asyncContext.Finish();
+    }
+    else
+    {
+        SSAO::Render(gfxContext, m_Camera);
+
+        Lighting::FillLightGrid(gfxContext, m_Camera, pGridViews, GetSceneDepthVersion());
+    }
+
+    if (UseVirtualShadows)
+        VirtualShadowMap::RequestPages(gfxContext, m_Camera, m_VirtualSunShadow);
+
+    if (!SSAO::DebugDraw)
+    {
+        ScopedTimer _prof(L"Main Render", gfxContext);
+
+        gfxContext.TransitionResource(g_SceneColorBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET, true);
+        gfxContext.ClearColor(g_SceneColorBuffer);
+
+        pfnSetupGraphicsState(gfxContext);
+
+        DrawStatistics::SetView(DrawStatistics::kSunShadowView);
+        if (UseCascades)
+        {
+            if (CascadedShadows::FitToDepthBuffer)
+            {
+                CascadedShadows::FitCascades(gfxContext, m_Camera, -m_SunDirection, ShadowCascadeCount,
+                    ShadowCascadeLambda, ShadowCascadeDistance, ShadowDimZ, (uint32_t)g_CascadedShadowBuffer.GetWidth());
+            }
+            RenderCascadedShadows(gfxContext);
+        }
+        else
+        {
+            ScopedTimer _prof3(L"Render Shadow Map", gfxContext);
+
+            m_SunShadow.UpdateMatrix(-m_SunDirection, Vector3(0, -500.0f, 0), Vector3(ShadowDimX, ShadowDimY, ShadowDimZ),
+                (uint32_t)g_ShadowBuffer.GetWidth(), (uint32_t)g_ShadowBuffer.GetHeight(), g_ShadowBuffer.GetDepthPrecision());
+
+            if (EnableShadowCache)
+            {
+                RenderCachedSunShadow(gfxContext);
+            }
+            else
+            {
+                m_ShadowCacheValid = false;
+                m_SunShadowMap = &g_ShadowBuffer;
+                m_ExtraTextures[1] = g_ShadowBuffer.GetSRV();
+
+                SetInstanceView(m_ShadowInstances, &m_SunShadow.GetViewProjMatrix(), 1);
+                g_ShadowBuffer.BeginRendering(gfxContext);
+                const eObjectFilter Raster = RasterizeSmallCasters(gfxContext, m_SunShadow.GetViewProjMatrix(), g_ShadowBuffer, true);
+                RecordObjects(gfxContext, [&](GraphicsContext& Context, uint32_t FirstMesh, uint32_t EndMesh)
+                {
+                    pfnSetupGraphicsState(Context);
+                    g_ShadowBuffer.SetRenderTarget(Context);
+                    SetVSConstants(Context, m_SunShadow.GetViewProjMatrix());
+                    Context.SetPipelineState(m_SunShadowPSO);
+                    SetVertexStream(Context, true);
+                    DrawObjects(Context, (eObjectFilter)(kOpaque | kSkipMaterials | kShadowLOD | Raster), 1, true, FirstMesh, EndMesh);
+                    SetVertexStream(Context, false);
+                    Context.SetPipelineState(m_CutoutSunShadowPSO);
+                    DrawObjects(Context, (eObjectFilter)(kCutout | kShadowLOD), 1, false, FirstMesh, EndMesh);
+                });
+                g_ShadowBuffer.EndRendering(gfxContext);
+            }
+
+            if (ShadowMoments::Enable)
+                ShadowMoments::ConvertSunShadow(gfxContext.GetComputeContext(), *m_SunShadowMap);
+            if (SoftShadows::Enable)
+                SoftShadows::BuildSunPyramid(gfxContext.GetComputeContext(), *m_SunShadowMap);
+
+            if (UseVirtualShadows)
+                RenderVirtualSunShadow(gfxContext);
+        }
+        DrawStatistics::SetView(DrawStatistics::kMainView);
+
+        if (UseAsyncCompute)
+        {
+            // Submit the shadows before waiting so that they overlap the compute work, which must finish before
+            // anything reads SSAO or the light grid
+            gfxContext.Flush();
+            pfnSetupGraphicsState(gfxContext);
+            g_CommandManager.GetGraphicsQueue().StallForProducer(g_CommandManager.GetComputeQueue());
+
+            gfxContext.TransitionResource(Lighting::m_LightBuffer,
+                D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+            gfxContext.TransitionResource(Lighting::m_LightGrid, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+            gfxContext.TransitionResource(Lighting::m_LightGridBitMask, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+            gfxContext.TransitionResource(Lighting::m_LightClusters, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+            gfxContext.TransitionResource(Lighting::m_LightClusterList, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+        }
+
+        // The mask and volumetric passes read whichever sun shadow resources the color pass would have
+        const D3D12_RESOURCE_STATES ShadowReadState =
+            D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
+        if (SunShadowMask::Enable || UseVolumetrics)
+        {
+            if (UseCascades)
+            {
+                gfxContext.TransitionResource(g_CascadedShadowBuffer, ShadowReadState);
+            }
+            else
+            {
+                gfxContext.TransitionResource(*m_SunShadowMap, ShadowReadState);
+                if (ShadowMoments::Enable)
+                    gfxContext.TransitionResource(ShadowMoments::m_SunMoments, ShadowReadState);
+                if (SoftShadows::Enable)
+                    gfxContext.TransitionResource(SoftShadows::m_SunDepthPyramid, ShadowReadState);
+                if (UseVirtualShadows)
+                    gfxContext.TransitionResource(VirtualShadowMap::m_VirtualShadowMap, ShadowReadState);
+            }
+        }
+
+        if (SunShadowMask::Enable)
+        {
+            // The table entries before the mask itself
+            SunShadowMask::Render(gfxContext.GetComputeContext(), m_Camera, m_MainViewport, m_SunShadow.GetShadowMatrix(),
+                &psConstants, sizeof(psConstants), m_ExtraTextures, 13);
+        }
+
+        const bool AsyncVolumetrics = UseVolumetrics && VolumetricLighting::AsyncCompute;
+        if (UseVolumetrics)
+        {
+            gfxContext.TransitionResource(Lighting::m_LightBuffer, ShadowReadState);
+            gfxContext.TransitionResource(Lighting::m_LightShadowBuffer, ShadowReadState);
+            gfxContext.TransitionResource(Lighting::m_LightShadowAtlas, ShadowReadState);
+            gfxContext.TransitionResource(Lighting::m_LightClusters, ShadowReadState);
+            gfxContext.TransitionResource(Lighting::m_LightClusterList, ShadowReadState);
+
+            if (AsyncVolumetrics)
+            {
+                // Light the froxels on the compute queue while the color pass renders.  Nothing they read changes
+                // state until the graphics queue has waited for them.
+                g_CommandManager.GetComputeQueue().StallForFence(gfxContext.Flush());
+                pfnSetupGraphicsState(gfxContext);
+
+                ComputeContext& volumeContext = ComputeContext::Begin(L"Volumetric Lighting", true);
+                VolumetricLighting::Render(volumeContext, m_Camera, m_MainViewport, m_SunShadow.GetShadowMatrix(),
+                    &psConstants, sizeof(psConstants), m_ExtraTextures, 13, m_ExtraTextures + 14);
+                volumeContext.Finish();
+            }
+            else
+            {
+                VolumetricLighting::Render(gfxContext.GetComputeContext(), m_Camera, m_MainViewport,
+                    m_SunShadow.GetShadowMatrix(), &psConstants, sizeof(psConstants), m_ExtraTextures, 13, m_ExtraTextures + 14);
+            }
+        }
+
+        const bool UseShadingRate = VariableRateShading::IsActive();
+        if (UseShadingRate)
+            VariableRateShading::Render(gfxContext.GetComputeContext(), SunShadowMask::Enable);
+
+        if (SSAO::AsyncCompute && !UseAsyncCompute)
+        {
+            gfxContext.Flush();
+            pfnSetupGraphicsState(gfxContext);
+
+            // Make the 3D queue wait for the Compute queue to finish SSAO
+            g_CommandManager.GetGraphicsQueue().StallForProducer(g_CommandManager.GetComputeQueue());
+        }
+
+        {
+            // Soft shadows are timed separately so they can be compared against PCF
+            ScopedTimer _prof4(SoftShadows::Enable ? L"Render Color (Soft Shadows)" : L"Render Color", gfxContext);
+
+            gfxContext.TransitionResource(g_SSAOFullScreen, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+            gfxContext.TransitionResource(g_SceneDepthBuffer,
+                RestrictPrepass ? D3D12_RESOURCE_STATE_DEPTH_WRITE : D3D12_RESOURCE_STATE_DEPTH_READ);
+            m_DrawInstances = &m_CameraInstances;
+            DepthPrepass::StartTimer(gfxContext, DepthPrepass::kColorTimer);
+
+            RecordObjects(gfxContext, [&](GraphicsContext& Context, uint32_t FirstMesh, uint32_t EndMesh)
+            {
+                pfnSetupGraphicsState(Context);
+                Context.SetDynamicDescriptors(3, 0, _countof(m_ExtraTextures), m_ExtraTextures);
+                Context.SetDynamicConstantBufferView(1, sizeof(psConstants), &psConstants);
+                if (NumViews > 1)
+                    Context.SetPipelineState(m_MultiViewModelPSO);
+                else if (BindlessOpaque)
+                    Context.SetPipelineState(RestrictPrepass ? m_BindlessModelDepthWritePSO : m_BindlessModelPSO);
+                else if (RestrictPrepass)
+                    Context.SetPipelineState(m_ModelDepthWritePSO);
+                else
+#ifdef _WAVE_OP
+                    Context.SetPipelineState(EnableWaveOps ? m_ModelWaveOpsPSO[WaveLightLoop] : m_ModelPSO );
+#else
+                    Context.SetPipelineState(ShowWaveTileCounts ? m_WaveTileCountPSO : m_ModelPSO);
+#endif
+                Context.SetRenderTarget(g_SceneColorBuffer.GetRTV(),
+                    RestrictPrepass ? g_SceneDepthBuffer.GetDSV() : g_SceneDepthBuffer.GetDSV_DepthReadOnly());
+                pfnSetCameraView(Context);
+                if (UseShadingRate)
+                    Context.SetShadingRateImage(&g_ShadingRateImage);
+
+                // Without material textures to bind, the opaque meshes are exactly those the depth pre-pass drew
+                if (BindlessOpaque && UseHiZCulling)
+                {
+                    if (FirstMesh == 0)
+                        HiZCulling::Draw(Context, HiZCulling::kBothPhases, false);
+                }
+                else
+                {
+                    DrawObjects(Context, (eObjectFilter)((BindlessOpaque ? kOpaque | kSkipMaterials : kOpaque) | kVisible), NumViews, false,
+                        FirstMesh, EndMesh);
+                }
+
+                if (!ShowWaveTileCounts || NumViews > 1)
+                {
+                    Context.SetPipelineState(NumViews > 1 ? m_MultiViewCutoutModelPSO : Bindless ? m_BindlessCutoutModelPSO : m_CutoutModelPSO);
+                    DrawObjects(Context, (eObjectFilter)((Bindless ? kCutout | kSkipMaterials : kCutout) | kVisible), NumViews, false,
+                        FirstMesh, EndMesh);
+                }
+            });
+
+            // The rate image stays bound to the context that recorded the color pass
+            if (UseShadingRate)
+                gfxContext.SetShadingRateImage(nullptr);
+
+            DepthPrepass::StopTimer(gfxContext, DepthPrepass::kColorTimer);
+        }
+
+        // Everything after the color pass reads the linear depth of every mesh
+        if (RestrictPrepass)
+            SSAO::LinearizeDepth(gfxContext.GetComputeContext(), m_Camera);
+
+        if (UseVolumetrics)
+        {
+            if (AsyncVolumetrics)
+            {
+                // Submit the color pass before waiting, so that it overlaps the volume
+                gfxContext.Flush();
+                pfnSetupGraphicsState(gfxContext);
+                g_CommandManager.GetGraphicsQueue().StallForProducer(g_CommandManager.GetComputeQueue());
+            }
+
+            VolumetricLighting::Apply(gfxContext, g_LinearDepth[FrameIndex], m_MainViewport, m_MainScissor);
+        }
+
+        if (DepthPrepass::ShowOverdraw)
+        {
+            ScopedTimer _prof5(L"Overdraw View", gfxContext);
+
+            gfxContext.TransitionResource(g_SceneColorBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET, true);
+            gfxContext.ClearColor(g_SceneColorBuffer);
+            gfxContext.TransitionResource(g_SceneDepthBuffer, D3D12_RESOURCE_STATE_DEPTH_READ, true);
+
+            pfnSetupGraphicsState(gfxContext);
+            gfxContext.SetPipelineState(m_OverdrawPSO);
+            gfxContext.SetRenderTarget(g_SceneColorBuffer.GetRTV(), g_SceneDepthBuffer.GetDSV_DepthReadOnly());
+            gfxContext.SetViewportAndScissor(m_MainViewport, m_MainScissor);
+            SetVSConstants(gfxContext, m_ViewProjMatrix);
+            SetVertexStream(gfxContext, true);
+            DrawObjects(gfxContext, (eObjectFilter)(kOpaque | kCutout | kSkipMaterials | kVisible), 1, true);
+            SetVertexStream(gfxContext, false);
+        }
+    }
+
+    TextureFeedback::Resolve(gfxContext);
+
+    // Some systems generate a per-pixel velocity buffer to better track dynamic and skinned meshes.  Everything
+    // is static in our scene, so we generate velocity from camera motion and the depth buffer.  A velocity buffer
+    // is necessary for all temporal effects (and motion blur).
     MotionBlur::GenerateCameraVelocityBuffer(gfxContext, m_Camera, true);
 
-    TemporalEffects::ResolveImage(gfxContext);
+    // Upscaling leaves the depth and velocity at the render resolution but not the scene color, so the passes
+    // reading them together run before it
+    const bool Upscaling = TemporalEffects::IsUpscaling();
+    if (!Upscaling)
+        TemporalEffects::ResolveImage(gfxContext);
 
+    // Particles sample the single sun shadow map, and go unshadowed under the cascades
+    ParticleEffects::SetSunShadow(UseCascades ? nullptr : m_SunShadowMap, m_SunShadow);
     ParticleEffects::Render(gfxContext, m_Camera, g_SceneColorBuffer, g_SceneDepthBuffer,  g_LinearDepth[FrameIndex]);
 
     // Until I work out how to couple these two, it's "either-or".
@@ -540,7 +2469,10 @@ void ModelViewer::RenderScene( void )
     else
         MotionBlur::RenderObjectBlur(gfxContext, g_VelocityBuffer);
 
-    gfxContext.Finish();
+    if (Upscaling)
+        TemporalEffects::ResolveImage(gfxContext);
+
+    DrawStatistics::EndFrame(gfxContext.Finish());
 }
 
 void ModelViewer::CreateParticleEffects()
@@ -568,6 +2500,7 @@ void ModelViewer::CreateParticleEffects()
 
     Smoke.TotalActiveLifetime = FLT_MAX;
     Smoke.EmitProperties.MaxParticles = 25;
+    Smoke.EmitProperties.ShadowStrength = 1.0f;
     Smoke.EmitProperties.EmitPosW = Smoke.EmitProperties.LastEmitPosW = XMFLOAT3(1120.0f, 185.0f, -445.0f);
     Smoke.EmitRate = 64.0f;
     Smoke.LifeMinMax = XMFLOAT2(2.5f, 4.0f);
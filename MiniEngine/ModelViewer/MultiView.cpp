@@ -0,0 +1,183 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "MultiView.h"
+#include "Camera.h"
+#include "CommandContext.h"
+#include "EngineTuning.h"
+#include "TemporalEffects.h"
+#include "MotionBlur.h"
+#include "DepthOfField.h"
+#include "SSAO.h"
+#include "ParticleEffectManager.h"
+#include "ForwardPlusLighting.h"
+#include "ViewCulling.h"
+#include "HiZCulling.h"
+#include "CascadedShadows.h"
+#include "ShadowCasterCulling.h"
+#include "VirtualShadowMap.h"
+#include "SunShadowMask.h"
+#include "VolumetricLighting.h"
+#include "VariableRateShading.h"
+#include "DepthPrepass.h"
+#include <cmath>
+
+using namespace Math;
+
+namespace MultiView
+{
+    BoolVar Enable("Application/Multi-View/Enable", false);
+    NumVar EyeSeparation("Application/Multi-View/Eye Separation", 6.5f, 0.0f, 100.0f, 0.5f);
+
+    // Reprojection, depth reconstruction and full screen filters assume one camera over the whole target
+    BoolVar* const s_SingleViewSettings[] =
+    {
+        &TemporalEffects::EnableTAA, &MotionBlur::Enable, &DepthOfField::Enable, &SSAO::Enable, &SSAO::DebugDraw,
+        &ParticleEffects::Enable, &ViewCulling::OcclusionCulling, &HiZCulling::Enable, &CascadedShadows::FitToDepthBuffer,
+        &ShadowCasterCulling::ReceiverCulling, &VirtualShadowMap::Enable, &SunShadowMask::Enable, &VolumetricLighting::Enable,
+        &VariableRateShading::Enable, &DepthPrepass::ShowOverdraw,
+    };
+    bool s_SavedSettings[_countof(s_SingleViewSettings)];
+    bool s_SettingsOverridden = false;
+
+    uint32_t m_ViewCount = 1;
+    Camera m_EyeCamera[kMaxViews];
+    Camera m_CullCamera;
+    Matrix4 m_ViewProj[kMaxViews];
+    Matrix4 m_GridViewProj[kMaxViews];
+    uint32_t m_SplitX = 0;
+    D3D12_VIEWPORT m_Viewport[kMaxViews];
+    D3D12_RECT m_Scissor[kMaxViews];
+
+    // Keep in sync with MultiView.hlsli
+    __declspec(align(16)) struct VSConstants
+    {
+        Matrix4 ModelToShadow;
+        struct
+        {
+            Matrix4 ViewProj;
+            XMFLOAT3 ViewerPos;
+            float Pad;
+        } Views[kMaxViews];
+    };
+
+    void OverrideSettings(bool Override)
+    {
+        if (Override == s_SettingsOverridden)
+            return;
+
+        for (uint32_t i = 0; i < _countof(s_SingleViewSettings); ++i)
+        {
+            if (Override)
+            {
+                s_SavedSettings[i] = *s_SingleViewSettings[i];
+                *s_SingleViewSettings[i] = false;
+            }
+            else
+            {
+                *s_SingleViewSettings[i] = s_SavedSettings[i];
+            }
+        }
+        s_SettingsOverridden = Override;
+    }
+}
+
+void MultiView::Update( const Camera& camera, const D3D12_VIEWPORT& viewport, uint32_t TileAlignment )
+{
+    OverrideSettings(Enable);
+
+    const uint32_t TargetWidth = (uint32_t)viewport.Width;
+    const uint32_t EyeWidth = TargetWidth / kMaxViews / TileAlignment * TileAlignment;
+    m_ViewCount = Enable && EyeWidth > 0 ? kMaxViews : 1;
+    if (m_ViewCount == 1)
+        return;
+
+    // Parallel eyes share the camera's projection and view depth, with the aspect ratio of their half
+    const float HalfSeparation = EyeSeparation * 0.5f;
+    const float AspectHeightOverWidth = viewport.Height / (float)EyeWidth;
+    for (uint32_t Eye = 0; Eye < kMaxViews; ++Eye)
+    {
+        Camera& EyeCamera = m_EyeCamera[Eye];
+        EyeCamera = camera;
+        EyeCamera.SetAspectRatio(AspectHeightOverWidth);
+        EyeCamera.SetPosition(camera.GetPosition() + camera.GetRightVec() * (Eye == 0 ? -HalfSeparation : HalfSeparation));
+        EyeCamera.Update();
+        m_ViewProj[Eye] = EyeCamera.GetViewProjMatrix();
+
+        // Pixels the eye covers, in the clip space of the whole target
+        const float Left = (float)(Eye * EyeWidth);
+        const float Right = Left + (float)EyeWidth;
+        const float ScaleX = (Right - Left) / (float)TargetWidth;
+        const float OffsetX = (Right + Left) / (float)TargetWidth - 1.0f;
+        const Matrix4 ToTarget(
+            Vector4(ScaleX, 0.0f, 0.0f, 0.0f),
+            Vector4(0.0f, 1.0f, 0.0f, 0.0f),
+            Vector4(0.0f, 0.0f, 1.0f, 0.0f),
+            Vector4(OffsetX, 0.0f, 0.0f, 1.0f));
+        m_GridViewProj[Eye] = ToTarget * m_ViewProj[Eye];
+
+        m_Viewport[Eye] = viewport;
+        m_Viewport[Eye].TopLeftX += Left;
+        m_Viewport[Eye].Width = (float)EyeWidth;
+
+        m_Scissor[Eye].left = (LONG)Left;
+        m_Scissor[Eye].top = 0;
+        m_Scissor[Eye].right = (LONG)Right;
+        m_Scissor[Eye].bottom = (LONG)viewport.Height;
+    }
+    m_SplitX = EyeWidth;
+
+    // Backed off so that its side planes pass through the outer edges of the eyes' near planes
+    const float TanHalfWidth = std::tan(camera.GetFOV() * 0.5f) / AspectHeightOverWidth;
+    const float BackOff = HalfSeparation / TanHalfWidth;
+    m_CullCamera = m_EyeCamera[0];
+    m_CullCamera.SetPosition(camera.GetPosition() - camera.GetForwardVec() * BackOff);
+    m_CullCamera.SetZRange(camera.GetNearClip() + BackOff, camera.GetFarClip() + BackOff);
+    m_CullCamera.Update();
+}
+
+uint32_t MultiView::GetViewCount( void )
+{
+    return m_ViewCount;
+}
+
+const Matrix4* MultiView::GetViewProjMatrices( void )
+{
+    return m_ViewProj;
+}
+
+const Camera& MultiView::GetCullCamera( void )
+{
+    return m_CullCamera;
+}
+
+void MultiView::SetVSConstants( GraphicsContext& Context, const Matrix4& ModelToShadow )
+{
+    VSConstants Constants;
+    Constants.ModelToShadow = ModelToShadow;
+    for (uint32_t Eye = 0; Eye < kMaxViews; ++Eye)
+    {
+        Constants.Views[Eye].ViewProj = m_ViewProj[Eye];
+        XMStoreFloat3(&Constants.Views[Eye].ViewerPos, m_EyeCamera[Eye].GetPosition());
+        Constants.Views[Eye].Pad = 0.0f;
+    }
+    Context.SetDynamicConstantBufferView(0, sizeof(Constants), &Constants);
+}
+
+void MultiView::SetViewportsAndScissors( GraphicsContext& Context )
+{
+    Context.SetViewportsAndScissors(kMaxViews, m_Viewport, m_Scissor);
+}
+
+void MultiView::GetGridViews( Lighting::GridViews& Views )
+{
+    Views.ViewProj[0] = &m_GridViewProj[0];
+    Views.ViewProj[1] = &m_GridViewProj[1];
+    Views.SplitX = m_SplitX;
+}
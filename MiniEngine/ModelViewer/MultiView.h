@@ -0,0 +1,56 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#pragma once
+
+#include <cstdint>
+
+class GraphicsContext;
+class BoolVar;
+class NumVar;
+namespace Math
+{
+    class Camera;
+    class Matrix4;
+}
+namespace Lighting
+{
+    struct GridViews;
+}
+
+// Renders the main view for two eyes, side by side in the scene buffers.  The depth pre-pass and color pass draw
+// each mesh once with an instance per eye, and the vertex shader picks the eye's matrix and viewport, so the
+// culling, draw submission, shadows and light grid are shared by both.  The effects that work from a single
+// camera's view of the whole target are turned off while it is enabled, and restored after.
+namespace MultiView
+{
+    enum { kMaxViews = 2 };
+
+    extern BoolVar Enable;
+    extern NumVar EyeSeparation;
+
+    // Places the eyes either side of the camera and splits the viewport between them.  Each eye's width is a
+    // multiple of TileAlignment, so that no light grid tile spans both.
+    void Update(const Math::Camera& camera, const D3D12_VIEWPORT& viewport, uint32_t TileAlignment);
+
+    // The views the camera passes draw this frame, 1 while disabled
+    uint32_t GetViewCount(void);
+
+    const Math::Matrix4* GetViewProjMatrices(void);
+
+    // A camera behind the eyes whose frustum just holds both of theirs, to cull for them at once
+    const Math::Camera& GetCullCamera(void);
+
+    // The multi-view shaders read the constants of every eye in place of SetVSConstants()
+    void SetVSConstants(GraphicsContext& Context, const Math::Matrix4& ModelToShadow);
+    void SetViewportsAndScissors(GraphicsContext& Context);
+
+    // The eyes' matrices mapped to their halves of the target, for filling one light grid over both
+    void GetGridViews(Lighting::GridViews& Views);
+}
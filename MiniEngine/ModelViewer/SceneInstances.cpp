@@ -0,0 +1,268 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "SceneInstances.h"
+#include "CommandContext.h"
+#include "GpuBuffer.h"
+#include "EngineTuning.h"
+#include "Model.h"
+#include "FrameArena.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace Math;
+using namespace Graphics;
+
+namespace SceneInstances
+{
+    BoolVar Enable("Application/Instances/Enable", false);
+    IntVar GridSize("Application/Instances/Grid Size", 3, 1, 16, 1);
+    NumVar GridSpacing("Application/Instances/Grid Spacing", 1.1f, 1.0f, 4.0f, 0.1f);
+
+    StructuredBuffer m_IdentityStream;
+
+    struct WorldBox
+    {
+        float Center[3];
+        float Extent[3];
+    };
+
+    struct ViewPlanes
+    {
+        float Planes[6][4];
+    };
+
+    // The placement of each copy of the model, and the world bounds of every mesh's instances in the same order,
+    // grouped by mesh
+    std::vector<Transform> m_Placements;
+    std::vector<WorldBox> m_Bounds;
+    uint32_t m_NumMeshes = 0;
+
+    // The settings the instances were built with
+    bool m_Built = false;
+    bool m_BuiltEnable = false;
+    int32_t m_BuiltGridSize = 0;
+    float m_BuiltGridSpacing = 0.0f;
+
+    Vector3 m_SceneMin(kZero);
+    Vector3 m_SceneMax(kZero);
+
+    WorldBox TransformBox(const Transform& Xform, const Model::BoundingBox& Box);
+    void UpdateMeshBounds(const Model& model, uint32_t meshIndex);
+    bool IntersectsView(const ViewPlanes& View, const WorldBox& Box);
+    void Build(const Model& model);
+}
+
+void SceneInstances::InitializeResources( const Model& model )
+{
+    const Transform Identity = { { { 1.0f, 0.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 1.0f, 0.0f } } };
+    m_IdentityStream.Create(L"Identity Instance", 1, sizeof(Transform), &Identity);
+
+    m_NumMeshes = model.m_Header.meshCount;
+    m_Built = false;
+    Update(model);
+}
+
+void SceneInstances::Shutdown( void )
+{
+    m_IdentityStream.Destroy();
+    m_Placements.clear();
+    m_Bounds.clear();
+}
+
+SceneInstances::WorldBox SceneInstances::TransformBox( const Transform& Xform, const Model::BoundingBox& Box )
+{
+    const Vector3 Center = (Box.min + Box.max) * 0.5f;
+    const Vector3 Extent = (Box.max - Box.min) * 0.5f;
+    const float C[3] = { Center.GetX(), Center.GetY(), Center.GetZ() };
+    const float E[3] = { Extent.GetX(), Extent.GetY(), Extent.GetZ() };
+
+    // The half extents of the transformed box come from the absolute values of the matrix
+    WorldBox Result;
+    for (uint32_t Row = 0; Row < 3; ++Row)
+    {
+        const float* R = Xform.Rows[Row];
+        Result.Center[Row] = R[0] * C[0] + R[1] * C[1] + R[2] * C[2] + R[3];
+        Result.Extent[Row] = std::fabs(R[0]) * E[0] + std::fabs(R[1]) * E[1] + std::fabs(R[2]) * E[2];
+    }
+    return Result;
+}
+
+void SceneInstances::UpdateMeshBounds( const Model& model, uint32_t meshIndex )
+{
+    const uint32_t NumPlacements = (uint32_t)m_Placements.size();
+    for (uint32_t i = 0; i < NumPlacements; ++i)
+        m_Bounds[meshIndex * NumPlacements + i] = TransformBox(m_Placements[i], model.m_pMesh[meshIndex].boundingBox);
+}
+
+void SceneInstances::Build( const Model& model )
+{
+    m_Placements.clear();
+    m_Bounds.clear();
+
+    const Model::BoundingBox& ModelBounds = model.GetBoundingBox();
+    m_SceneMin = ModelBounds.min;
+    m_SceneMax = ModelBounds.max;
+
+    if (!Enable)
+        return;
+
+    // A grid of copies around the original, each turned half way around its center from its neighbors
+    const uint32_t Size = (uint32_t)(int32_t)GridSize;
+    const Vector3 Center = (ModelBounds.min + ModelBounds.max) * 0.5f;
+    const Vector3 Step = (ModelBounds.max - ModelBounds.min) * (float)GridSpacing;
+    const float CenterX = Center.GetX(), CenterZ = Center.GetZ();
+    const float StepX = Step.GetX(), StepZ = Step.GetZ();
+    const float Middle = (Size - 1) * 0.5f;
+
+    m_Placements.resize(Size * Size);
+    for (uint32_t Z = 0; Z < Size; ++Z)
+    {
+        for (uint32_t X = 0; X < Size; ++X)
+        {
+            const bool Turned = ((X + Z) & 1) != 0;
+            const float Sign = Turned ? -1.0f : 1.0f;
+            const float OffsetX = ((float)X - Middle) * StepX + (Turned ? 2.0f * CenterX : 0.0f);
+            const float OffsetZ = ((float)Z - Middle) * StepZ + (Turned ? 2.0f * CenterZ : 0.0f);
+
+            const Transform Placement = { { { Sign, 0.0f, 0.0f, OffsetX }, { 0.0f, 1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, Sign, OffsetZ } } };
+            m_Placements[Z * Size + X] = Placement;
+        }
+    }
+
+    m_Bounds.resize(m_NumMeshes * m_Placements.size());
+    for (uint32_t meshIndex = 0; meshIndex < m_NumMeshes; ++meshIndex)
+        UpdateMeshBounds(model, meshIndex);
+
+    for (const WorldBox& Box : m_Bounds)
+    {
+        const Vector3 BoxCenter(Box.Center[0], Box.Center[1], Box.Center[2]);
+        const Vector3 BoxExtent(Box.Extent[0], Box.Extent[1], Box.Extent[2]);
+        m_SceneMin = Min(m_SceneMin, BoxCenter - BoxExtent);
+        m_SceneMax = Max(m_SceneMax, BoxCenter + BoxExtent);
+    }
+}
+
+bool SceneInstances::Update( const Model& model )
+{
+    if (!m_Built || m_BuiltEnable != Enable || m_BuiltGridSize != GridSize || m_BuiltGridSpacing != GridSpacing)
+    {
+        Build(model);
+        m_Built = true;
+        m_BuiltEnable = Enable;
+        m_BuiltGridSize = GridSize;
+        m_BuiltGridSpacing = GridSpacing;
+        return true;
+    }
+
+    // Dynamic meshes move every frame, so only their bounds are brought up to date
+    if (IsActive() && model.GetDynamicMeshCount() > 0)
+    {
+        for (uint32_t meshIndex = 0; meshIndex < m_NumMeshes; ++meshIndex)
+        {
+            if (model.IsMeshDynamic(meshIndex))
+                UpdateMeshBounds(model, meshIndex);
+        }
+    }
+    return false;
+}
+
+bool SceneInstances::IsActive( void )
+{
+    return !m_Placements.empty();
+}
+
+void SceneInstances::GetSceneBounds( Vector3& MinBound, Vector3& MaxBound )
+{
+    MinBound = m_SceneMin;
+    MaxBound = m_SceneMax;
+}
+
+void SceneInstances::GetMeshBounds( uint32_t meshIndex, Vector3& MinBound, Vector3& MaxBound )
+{
+    ASSERT(IsActive() && meshIndex < m_NumMeshes);
+
+    const uint32_t NumPlacements = (uint32_t)m_Placements.size();
+    MinBound = Vector3(FLT_MAX);
+    MaxBound = Vector3(-FLT_MAX);
+    for (uint32_t i = 0; i < NumPlacements; ++i)
+    {
+        const WorldBox& Box = m_Bounds[meshIndex * NumPlacements + i];
+        const Vector3 BoxCenter(Box.Center[0], Box.Center[1], Box.Center[2]);
+        const Vector3 BoxExtent(Box.Extent[0], Box.Extent[1], Box.Extent[2]);
+        MinBound = Min(MinBound, BoxCenter - BoxExtent);
+        MaxBound = Max(MaxBound, BoxCenter + BoxExtent);
+    }
+}
+
+void SceneInstances::AppendInputLayout( std::vector<D3D12_INPUT_ELEMENT_DESC>& Layout, bool MultiView )
+{
+    for (uint32_t Row = 0; Row < 3; ++Row)
+    {
+        const D3D12_INPUT_ELEMENT_DESC Element = { "INSTANCE_WORLD", Row, DXGI_FORMAT_R32G32B32A32_FLOAT, kStreamSlot,
+            Row * sizeof(float) * 4, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_VERTEX_DATA, MultiView ? (UINT)kMultiViewStepRate : 1 };
+        Layout.push_back(Element);
+    }
+}
+
+void SceneInstances::BindIdentity( GraphicsContext& Context )
+{
+    Context.SetVertexBuffer(kStreamSlot, m_IdentityStream.VertexBufferView());
+}
+
+bool SceneInstances::IntersectsView( const ViewPlanes& View, const WorldBox& Box )
+{
+    for (uint32_t p = 0; p < 6; ++p)
+    {
+        const float* P = View.Planes[p];
+        const float Distance = P[0] * Box.Center[0] + P[1] * Box.Center[1] + P[2] * Box.Center[2] + P[3];
+        const float Radius = std::fabs(P[0]) * Box.Extent[0] + std::fabs(P[1]) * Box.Extent[1] + std::fabs(P[2]) * Box.Extent[2];
+        if (Distance + Radius < 0.0f)
+            return false;
+    }
+    return true;
+}
+
+void SceneInstances::Cull( const Matrix4* ViewProjs, uint32_t NumViews, VisibleList& List )
+{
+    List.Transforms.clear();
+    List.MeshFirst.assign(m_NumMeshes, 0);
+    List.MeshCount.assign(m_NumMeshes, 0);
+
+    // The planes of each clip volume in world space, from the rows of the view projection.  Depth runs from 0 to 1.
+    ViewPlanes* Views = FrameArena::AllocateArray<ViewPlanes>(NumViews);
+    for (uint32_t View = 0; View < NumViews; ++View)
+    {
+        const Matrix4 Rows = Transpose(ViewProjs[View]);
+        const Vector4 R0 = Rows.GetX(), R1 = Rows.GetY(), R2 = Rows.GetZ(), R3 = Rows.GetW();
+        const Vector4 ClipPlanes[6] = { R3 + R0, R3 - R0, R3 + R1, R3 - R1, R2, R3 - R2 };
+        for (uint32_t i = 0; i < 6; ++i)
+            XMStoreFloat4((XMFLOAT4*)Views[View].Planes[i], ClipPlanes[i]);
+    }
+
+    const uint32_t NumPlacements = (uint32_t)m_Placements.size();
+    for (uint32_t meshIndex = 0; meshIndex < m_NumMeshes; ++meshIndex)
+    {
+        List.MeshFirst[meshIndex] = (uint32_t)List.Transforms.size();
+
+        for (uint32_t i = 0; i < NumPlacements; ++i)
+        {
+            const WorldBox& Box = m_Bounds[meshIndex * NumPlacements + i];
+
+            bool Visible = NumViews == 0;
+            for (uint32_t View = 0; !Visible && View < NumViews; ++View)
+                Visible = IntersectsView(Views[View], Box);
+
+            if (Visible)
+                List.Transforms.push_back(m_Placements[i]);
+        }
+
+        List.MeshCount[meshIndex] = (uint32_t)List.Transforms.size() - List.MeshFirst[meshIndex];
+    }
+}
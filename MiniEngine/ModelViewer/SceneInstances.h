@@ -0,0 +1,77 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+class Model;
+class GraphicsContext;
+class BoolVar;
+class NumVar;
+class IntVar;
+struct D3D12_INPUT_ELEMENT_DESC;
+namespace Math
+{
+    class Vector3;
+    class Matrix4;
+}
+
+// Copies of the model placed in the scene with world transforms of their own.  Every mesh keeps the list of
+// its instances, so a pass draws each mesh once with DrawIndexedInstanced over the instances a view can see.
+// The transforms reach the vertex shaders as a second, per-instance vertex stream.  Draws without instances
+// bind a stream holding a single identity transform, so the same shaders serve both.
+namespace SceneInstances
+{
+    extern BoolVar Enable;
+    extern IntVar GridSize;
+    extern NumVar GridSpacing;
+
+    // The rows of a 3x4 world matrix, as the vertex shaders read them
+    struct Transform
+    {
+        float Rows[3][4];
+    };
+
+    // The instances of every mesh a view can see, with those of each mesh contiguous
+    struct VisibleList
+    {
+        std::vector<Transform> Transforms;
+        std::vector<uint32_t> MeshFirst;
+        std::vector<uint32_t> MeshCount;
+    };
+
+    // Multi-view shaders spend their instances on views, so their layout steps to the next transform only
+    // after kMultiViewStepRate instances and each instance of a mesh is a draw of its own
+    enum { kStreamSlot = 1, kMultiViewStepRate = 32 };
+
+    void InitializeResources(const Model& model);
+    void Shutdown(void);
+
+    // Rebuilds the instances when the layout settings change, which leaves shadows cached with the old layout
+    // stale.  Returns true when they did.
+    bool Update(const Model& model);
+
+    bool IsActive(void);
+
+    // The world bounds of the whole scene, and of all the instances of one mesh
+    void GetSceneBounds(Math::Vector3& MinBound, Math::Vector3& MaxBound);
+    void GetMeshBounds(uint32_t meshIndex, Math::Vector3& MinBound, Math::Vector3& MaxBound);
+
+    // Appends the per-instance stream to a model input layout
+    void AppendInputLayout(std::vector<D3D12_INPUT_ELEMENT_DESC>& Layout, bool MultiView);
+
+    // Binds the single identity transform to the instance stream
+    void BindIdentity(GraphicsContext& Context);
+
+    // Gathers the instances whose bounds intersect any of the views, or every instance when there are none.
+    // Multi-view passes draw each instance to all of their views, so they cull against all of them at once.
+    void Cull(const Math::Matrix4* ViewProjs, uint32_t NumViews, VisibleList& List);
+}
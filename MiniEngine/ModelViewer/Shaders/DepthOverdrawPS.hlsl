@@ -0,0 +1,22 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// The overdraw view of the depth pre-pass.  Drawn additively without a depth test, every layer of geometry
+// over a pixel adds a step, so the color shows how often the color pass could shade it without a pre-pass.
+//
+
+#include "ModelViewerRS.hlsli"
+
+// Eight layers saturate the red, sixteen the green and thirty-two the blue
+static const float3 kLayerColor = float3(0.125, 0.0625, 0.03125);
+
+[RootSignature(ModelViewer_RootSig)]
+float3 main() : SV_Target0
+{
+    return kLayerColor;
+}
@@ -0,0 +1,3 @@
+#define BINDLESS_MATERIALS
+
+#include "DepthViewerPS.hlsl"
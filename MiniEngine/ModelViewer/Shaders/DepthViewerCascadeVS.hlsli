@@ -0,0 +1,68 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+// Renders every sun cascade that can see a mesh in one instanced draw.  Instance i goes to the
+// cascade of the i-th set bit in CascadeMask, selected with SV_RenderTargetArrayIndex.  Every instance
+// reads the same world transform, since the instance stream only steps between draws.
+
+#include "ModelViewerRS.hlsli"
+#include "ShadowCascades.hlsli"
+#include "VertexDecode.hlsli"
+#include "SceneInstances.hlsli"
+
+cbuffer CascadeConstants : register(b0)
+{
+    CascadeData Cascades[MAX_CASCADES];
+};
+
+cbuffer DrawConstants : register(b1)
+{
+    uint BaseVertex;
+    uint MaterialIndex;
+    uint CascadeMask;
+};
+
+struct VSInput
+{
+    float3 position : POSITION;
+#ifdef ALPHA_TEST
+    float2 texcoord0 : TEXCOORD;
+#endif
+};
+
+struct VSOutput
+{
+    float4 pos : SV_Position;
+#ifdef ALPHA_TEST
+    float2 uv : TexCoord0;
+#endif
+    uint slice : SV_RenderTargetArrayIndex;
+};
+
+uint GetCascadeIndex( uint instance )
+{
+    uint mask = CascadeMask;
+    for (uint i = 0; i < instance; ++i)
+        mask &= mask - 1;
+    return firstbitlow(mask);
+}
+
+[RootSignature(ModelViewer_RootSig)]
+VSOutput main(VSInput vsInput, InstanceTransform instance, uint instanceID : SV_InstanceID)
+{
+    uint cascade = GetCascadeIndex(instanceID);
+
+    VSOutput vsOutput;
+    vsOutput.pos = mul(Cascades[cascade].ViewProj, float4(InstancePosition(instance, DecodePosition(vsInput.position)), 1.0));
+#ifdef ALPHA_TEST
+    vsOutput.uv = vsInput.texcoord0;
+#endif
+    vsOutput.slice = cascade;
+    return vsOutput;
+}
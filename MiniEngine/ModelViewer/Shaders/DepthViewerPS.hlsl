@@ -19,12 +19,20 @@ struct VSOutput
     float2 uv : TexCoord0;
 };
 
-Texture2D<float4>    texDiffuse        : register(t0);
+#ifdef BINDLESS_MATERIALS
+Texture2DArray<float4>    g_MaterialTextures[] : register(t0, space1);
+#else
+Texture2DArray<float4>    texDiffuse        : register(t0);
+#endif
 SamplerState        sampler0        : register(s0);
 
+#ifdef BINDLESS_MATERIALS
+[RootSignature(ModelViewer_BindlessRootSig)]
+#else
 [RootSignature(ModelViewer_RootSig)]
+#endif
 void main(VSOutput vsOutput)
 {
-    if (texDiffuse.Sample(sampler0, vsOutput.uv).a < 0.5)
+    if (MaterialTexture(texDiffuse, 0).Sample(sampler0, MaterialUV(vsOutput.uv)).a < 0.5)
         discard;
 }
@@ -0,0 +1,82 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+// Renders every face of a shadowed point light that can see a mesh in one instanced draw.  Instance i
+// goes to the face of the i-th set bit in FaceMask, and each face's viewport covers its atlas tile.  Every
+// instance reads the same world transform, since the instance stream only steps between draws.
+
+#include "ModelViewerRS.hlsli"
+#include "PointShadow.hlsli"
+#include "VertexDecode.hlsli"
+#include "SceneInstances.hlsli"
+
+cbuffer PointShadowConstants : register(b0)
+{
+    float3 LightPos;
+    float4 ShadowParams;
+};
+
+cbuffer DrawConstants : register(b1)
+{
+    uint BaseVertex;
+    uint MaterialIndex;
+    uint FaceMask;
+};
+
+struct VSInput
+{
+    float3 position : POSITION;
+#ifdef ALPHA_TEST
+    float2 texcoord0 : TEXCOORD;
+#endif
+};
+
+struct VSOutput
+{
+    float4 pos : SV_Position;
+#ifdef ALPHA_TEST
+    float2 uv : TexCoord0;
+#endif
+    float clip : SV_ClipDistance0;
+    uint viewport : SV_ViewportArrayIndex;
+};
+
+uint GetFaceIndex( uint instance )
+{
+    uint mask = FaceMask;
+    for (uint i = 0; i < instance; ++i)
+        mask &= mask - 1;
+    return firstbitlow(mask);
+}
+
+[RootSignature(ModelViewer_RootSig)]
+VSOutput main(VSInput vsInput, InstanceTransform instance, uint instanceID : SV_InstanceID)
+{
+    uint face = GetFaceIndex(instanceID);
+    float3 viewPos = GetPointShadowFaceView(InstancePosition(instance, DecodePosition(vsInput.position)) - LightPos, face);
+
+    VSOutput vsOutput;
+    if (ShadowParams.w != 0.0)
+    {
+        // The paraboloid warp is not linear, so only vertices are warped and each hemisphere is clipped
+        // at the plane through the light
+        vsOutput.pos = float4(ProjectPointShadowFace(viewPos, ShadowParams), 1.0);
+        vsOutput.clip = -viewPos.z;
+    }
+    else
+    {
+        vsOutput.pos = float4(viewPos.xy, ShadowParams.x * viewPos.z + ShadowParams.y, -viewPos.z);
+        vsOutput.clip = 1.0;
+    }
+#ifdef ALPHA_TEST
+    vsOutput.uv = vsInput.texcoord0;
+#endif
+    vsOutput.viewport = face;
+    return vsOutput;
+}
@@ -0,0 +1,67 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Developed by Minigraph
+//
+// Author(s):  James Stanard
+//             Alex Nankervis
+//
+
+// Opaque depth passes read only positions, from the depth-only vertex stream.  With ALPHA_TEST, the
+// texture coordinates are read from the full stream as well.  MULTI_VIEW draws a view per instance, see
+// MultiView.hlsli.
+
+#include "ModelViewerRS.hlsli"
+#include "VertexDecode.hlsli"
+#include "SceneInstances.hlsli"
+
+#ifdef MULTI_VIEW
+#include "MultiView.hlsli"
+#else
+cbuffer VSConstants : register(b0)
+{
+    float4x4 modelToProjection;
+};
+#endif
+
+struct VSInput
+{
+    float3 position : POSITION;
+#ifdef ALPHA_TEST
+    float2 texcoord0 : TEXCOORD;
+#endif
+};
+
+struct VSOutput
+{
+    float4 pos : SV_Position;
+#ifdef ALPHA_TEST
+    float2 uv : TexCoord0;
+#endif
+#ifdef MULTI_VIEW
+    uint viewport : SV_ViewportArrayIndex;
+#endif
+};
+
+[RootSignature(ModelViewer_RootSig)]
+VSOutput main(VSInput vsInput, InstanceTransform instance, uint instanceID : SV_InstanceID)
+{
+#ifdef MULTI_VIEW
+    float4x4 modelToProjection = Views[instanceID].ViewProj;
+#endif
+
+    VSOutput vsOutput;
+    vsOutput.pos = mul(modelToProjection, float4(InstancePosition(instance, DecodePosition(vsInput.position)), 1.0));
+#ifdef ALPHA_TEST
+    vsOutput.uv = vsInput.texcoord0;
+#endif
+#ifdef MULTI_VIEW
+    vsOutput.viewport = instanceID;
+#endif
+    return vsOutput;
+}
@@ -0,0 +1,243 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Builds the clustered light lists.  Each group handles one screen tile: it finds which depth slices of the
+// tile hold geometry, gathers a bit mask of the lights that overlap each of those clusters out of the lights of
+// the super tiles under the tile, and then packs the masks into compact light lists allocated from a shared buffer.  Lights come out in index order, which keeps
+// them sorted by type.
+//
+
+#include "LightGrid.hlsli"
+
+// outdated warning about for-loop variable scope
+#pragma warning (disable: 3078)
+
+#define GROUP_SIZE 8
+#define GROUP_THREADS (GROUP_SIZE * GROUP_SIZE)
+#define CLUSTER_WORDS (NUM_CLUSTER_SLICES * LIGHT_MASK_WORDS)
+
+cbuffer CSConstants : register(b0)
+{
+    uint ViewportWidth, ViewportHeight;
+    uint TileDim;
+    uint TileCountX;
+    float4x4 ViewProjMatrix;
+    float3 CameraPos;
+    float FarClip;
+    float3 CameraForward;
+    float SliceScale;
+    float SliceBias;
+    uint ListCapacity;          // Dwords in the cluster list buffer, including its counter
+    uint FirstConeLight;
+    uint FirstConeShadowedLight;
+    uint FirstPointShadowedLight;
+    uint SuperTileCountX;
+    uint FillFrontClusters;     // The clusters also light the air in front of the geometry and over the sky
+    uint SplitX;                // Tiles from this pixel column on belong to the second view
+    float4x4 SplitViewProjMatrix;
+};
+
+StructuredBuffer<LightData> lightBuffer : register(t0);
+Texture2D<float> depthTex : register(t1);
+ByteAddressBuffer superTileMask : register(t2);
+RWByteAddressBuffer lightClusters : register(u0);
+RWByteAddressBuffer lightClusterList : register(u1);
+
+groupshared uint gs_SliceMask;
+groupshared uint gs_ClusterMask[CLUSTER_WORDS];
+// Dword offset in the list buffer of the first light of each mask word, or ~0 when the list is full
+groupshared uint gs_WordOffset[CLUSTER_WORDS];
+groupshared uint gs_CandidateCount;
+groupshared uint gs_Candidates[MAX_LIGHTS];
+
+#define _RootSig \
+    "RootFlags(0), " \
+    "CBV(b0), " \
+    "DescriptorTable(SRV(t0, numDescriptors = 3))," \
+    "DescriptorTable(UAV(u0, numDescriptors = 2))"
+
+// Counts the bits of a mask word whose light index lies in [first, end)
+uint CountLightRange(uint bits, uint word, uint first, uint end)
+{
+    int lo = clamp((int)first - (int)(word * 32), 0, 32);
+    int hi = clamp((int)end - (int)(word * 32), 0, 32);
+    uint hiMask = hi == 32 ? 0xffffffff : (1u << hi) - 1;
+    uint loMask = lo == 32 ? 0xffffffff : (1u << lo) - 1;
+    return countbits(bits & hiMask & ~loMask);
+}
+
+[RootSignature(_RootSig)]
+[numthreads(GROUP_SIZE, GROUP_SIZE, 1)]
+void main(uint3 groupID : SV_GroupID, uint3 threadID : SV_GroupThreadID, uint threadIndex : SV_GroupIndex)
+{
+    if (threadIndex == 0)
+    {
+        gs_SliceMask = 0;
+        gs_CandidateCount = 0;
+    }
+    for (uint i = threadIndex; i < CLUSTER_WORDS; i += GROUP_THREADS)
+        gs_ClusterMask[i] = 0;
+    GroupMemoryBarrierWithGroupSync();
+
+    // Find the slices that hold geometry.  The depth is linear, as a fraction of the far clip distance.
+    uint2 tileOrigin = groupID.xy * TileDim;
+    uint sliceMask = 0;
+    for (uint y = threadID.y; y < TileDim; y += GROUP_SIZE)
+    {
+        for (uint x = threadID.x; x < TileDim; x += GROUP_SIZE)
+        {
+            uint2 pixel = tileOrigin + uint2(x, y);
+            if (pixel.x >= ViewportWidth || pixel.y >= ViewportHeight)
+                continue;
+
+            // Nothing to light on the far plane
+            float linearDepth = depthTex[pixel];
+            if (linearDepth < 1.0)
+                sliceMask |= 1u << GetClusterSlice(linearDepth * FarClip, SliceScale, SliceBias);
+            else if (FillFrontClusters != 0)
+                sliceMask |= 1u << (NUM_CLUSTER_SLICES - 1);
+        }
+    }
+    InterlockedOr(gs_SliceMask, sliceMask);
+    GroupMemoryBarrierWithGroupSync();
+
+    // The color pass finds its slice from interpolated depth, which can round across a slice boundary, so the
+    // neighbors of occupied slices get lists too
+    uint occupiedSlices = gs_SliceMask;
+    occupiedSlices |= ((occupiedSlices << 1) | (occupiedSlices >> 1)) & ((1u << NUM_CLUSTER_SLICES) - 1);
+
+    // Light scattered in the air reaches the camera from every slice in front of the farthest geometry
+    if (FillFrontClusters != 0 && occupiedSlices != 0)
+        occupiedSlices = (2u << firstbithigh(occupiedSlices)) - 1;
+
+    // Only the lights of the super tiles under this tile can reach it
+    uint2 tilePixelMax = min(tileOrigin + TileDim, uint2(ViewportWidth, ViewportHeight)) - 1;
+    for (uint word = threadIndex; occupiedSlices != 0 && word < LIGHT_MASK_WORDS; word += GROUP_THREADS)
+    {
+        uint bits = LoadSuperTileMaskWord(superTileMask, tileOrigin, tilePixelMax, SuperTileCountX, word);
+        uint slot;
+        InterlockedAdd(gs_CandidateCount, countbits(bits), slot);
+        while (bits != 0)
+        {
+            uint bit = firstbitlow(bits);
+            bits ^= 1u << bit;
+            gs_Candidates[slot++] = word * 32 + bit;
+        }
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    // Side planes of the tile's frustum, in world space
+    float2 invTileSize2X = float2(ViewportWidth, ViewportHeight) / TileDim;
+    float4x4 projToTile = float4x4(
+        invTileSize2X.x, 0, 0, -2.0 * float(groupID.x) + invTileSize2X.x - 1.0,
+        0, -invTileSize2X.y, 0, -2.0 * float(groupID.y) + invTileSize2X.y - 1.0,
+        0, 0, 1, 0,
+        0, 0, 0, 1
+        );
+    float4x4 tileMVP = mul(projToTile, tileOrigin.x >= SplitX ? SplitViewProjMatrix : ViewProjMatrix);
+
+    float4 frustumPlanes[4];
+    frustumPlanes[0] = tileMVP[3] + tileMVP[0];
+    frustumPlanes[1] = tileMVP[3] - tileMVP[0];
+    frustumPlanes[2] = tileMVP[3] + tileMVP[1];
+    frustumPlanes[3] = tileMVP[3] - tileMVP[1];
+    for (int n = 0; n < 4; n++)
+        frustumPlanes[n] *= rsqrt(dot(frustumPlanes[n].xyz, frustumPlanes[n].xyz));
+
+    for (uint candidate = threadIndex; candidate < gs_CandidateCount; candidate += GROUP_THREADS)
+    {
+        uint lightIndex = gs_Candidates[candidate];
+        LightData lightData = lightBuffer[lightIndex];
+        float lightCullRadius = sqrt(lightData.radiusSq);
+
+        // Empty light slots have no radius
+        bool overlapping = lightData.radiusSq > 0.0;
+        for (int n = 0; n < 4; n++)
+        {
+            if (dot(lightData.pos, frustumPlanes[n].xyz) + frustumPlanes[n].w < -lightCullRadius)
+                overlapping = false;
+        }
+
+        float viewDepth = dot(lightData.pos - CameraPos, CameraForward);
+        if (!overlapping || viewDepth + lightCullRadius <= 0.0)
+            continue;
+
+        uint firstSlice = GetClusterSlice(viewDepth - lightCullRadius, SliceScale, SliceBias);
+        uint lastSlice = GetClusterSlice(viewDepth + lightCullRadius, SliceScale, SliceBias);
+        uint slices = occupiedSlices & ((2u << lastSlice) - 1) & ~((1u << firstSlice) - 1);
+
+        while (slices != 0)
+        {
+            uint slice = firstbitlow(slices);
+            slices ^= 1u << slice;
+            InterlockedOr(gs_ClusterMask[slice * LIGHT_MASK_WORDS + lightIndex / 32], 1u << (lightIndex % 32));
+        }
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    uint tileIndex = GetTileIndex(groupID.xy, TileCountX);
+
+    // One thread per cluster counts its lights and allocates its list
+    if (threadIndex < NUM_CLUSTER_SLICES)
+    {
+        uint maskStart = threadIndex * LIGHT_MASK_WORDS;
+
+        uint countSphere = 0, countCone = 0, countConeShadowed = 0, countPointShadowed = 0;
+        uint total = 0;
+        for (uint word = 0; word < LIGHT_MASK_WORDS; word++)
+        {
+            uint bits = gs_ClusterMask[maskStart + word];
+            gs_WordOffset[maskStart + word] = total;
+            total += countbits(bits);
+            countSphere += CountLightRange(bits, word, 0, FirstConeLight);
+            countCone += CountLightRange(bits, word, FirstConeLight, FirstConeShadowedLight);
+            countConeShadowed += CountLightRange(bits, word, FirstConeShadowedLight, FirstPointShadowedLight);
+            countPointShadowed += CountLightRange(bits, word, FirstPointShadowedLight, MAX_LIGHTS);
+        }
+
+        uint listOffset = 1;
+        if (total > 0)
+        {
+            uint firstEntry;
+            lightClusterList.InterlockedAdd(0, total, firstEntry);
+            listOffset += firstEntry;
+
+            // A full list leaves the cluster unlit rather than writing past the end
+            if (listOffset + total > ListCapacity)
+            {
+                countSphere = countCone = countConeShadowed = countPointShadowed = 0;
+                listOffset = 0xffffffff;
+            }
+        }
+
+        for (uint word = 0; word < LIGHT_MASK_WORDS; word++)
+            gs_WordOffset[maskStart + word] = listOffset == 0xffffffff ? 0xffffffff : gs_WordOffset[maskStart + word] + listOffset;
+
+        lightClusters.Store4(GetClusterOffset(tileIndex, threadIndex), uint4(listOffset,
+            countSphere | countCone << 16, countConeShadowed | countPointShadowed << 16, 0));
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    // Every thread writes out the lights of a share of the mask words
+    for (uint i = threadIndex; i < CLUSTER_WORDS; i += GROUP_THREADS)
+    {
+        uint offset = gs_WordOffset[i];
+        if (offset == 0xffffffff)
+            continue;
+
+        uint bits = gs_ClusterMask[i];
+        uint firstLight = (i % LIGHT_MASK_WORDS) * 32;
+        while (bits != 0)
+        {
+            uint bit = firstbitlow(bits);
+            bits ^= 1u << bit;
+            lightClusterList.Store(offset * 4, firstLight + bit);
+            offset++;
+        }
+    }
+}
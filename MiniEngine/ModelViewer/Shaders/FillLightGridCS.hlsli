@@ -30,11 +30,17 @@ cbuffer CSConstants : register(b0)
     float InvTileDim;
     float RcpZMagic;
     uint TileCountX;
+    uint SuperTileCountX;
     float4x4 ViewProjMatrix;
+    uint ListBase;              // Byte offset of the light lists in the grid buffer
+    uint ListEnd;               // Bytes in the grid buffer
+    uint SplitX;                // Tiles from this pixel column on belong to the second view
+    float4x4 SplitViewProjMatrix;
 };
 
 StructuredBuffer<LightData> lightBuffer : register(t0);
 Texture2D<float> depthTex : register(t1);
+ByteAddressBuffer superTileMask : register(t2);
 RWByteAddressBuffer lightGrid : register(u0);
 RWByteAddressBuffer lightGridBitMask : register(u1);
 
@@ -44,17 +50,39 @@ groupshared uint maxDepthUInt;
 groupshared uint tileLightCountSphere;
 groupshared uint tileLightCountCone;
 groupshared uint tileLightCountConeShadowed;
+groupshared uint tileLightCountPointShadowed;
 
-groupshared uint tileLightIndicesSphere[MAX_LIGHTS];
-groupshared uint tileLightIndicesCone[MAX_LIGHTS];
-groupshared uint tileLightIndicesConeShadowed[MAX_LIGHTS];
+groupshared uint tileLightIndicesSphere[MAX_TILE_LIGHTS];
+groupshared uint tileLightIndicesCone[MAX_TILE_LIGHTS];
+groupshared uint tileLightIndicesConeShadowed[MAX_TILE_LIGHTS];
+groupshared uint tileLightIndicesPointShadowed[MAX_TILE_LIGHTS];
 
-groupshared uint4 tileLightBitMask;
+groupshared uint tileListOffset;
+
+groupshared uint tileLightBitMask[LIGHT_MASK_WORDS];
+
+// The lights of the super tiles under this tile, the only ones worth testing
+groupshared uint candidateLightCount;
+groupshared uint candidateLightIndices[MAX_LIGHTS];
+
+// The nth light of the tile's list, which runs through the four types in order
+uint GetTileLightIndex(uint n)
+{
+    if (n < tileLightCountSphere)
+        return tileLightIndicesSphere[n];
+    n -= tileLightCountSphere;
+    if (n < tileLightCountCone)
+        return tileLightIndicesCone[n];
+    n -= tileLightCountCone;
+    if (n < tileLightCountConeShadowed)
+        return tileLightIndicesConeShadowed[n];
+    return tileLightIndicesPointShadowed[n - tileLightCountConeShadowed];
+}
 
 #define _RootSig \
     "RootFlags(0), " \
     "CBV(b0), " \
-    "DescriptorTable(SRV(t0, numDescriptors = 2))," \
+    "DescriptorTable(SRV(t0, numDescriptors = 3))," \
     "DescriptorTable(UAV(u0, numDescriptors = 2))"
 
 [RootSignature(_RootSig)]
@@ -82,14 +110,17 @@ void main(
         tileLightCountSphere = 0;
         tileLightCountCone = 0;
         tileLightCountConeShadowed = 0;
-        tileLightBitMask = 0;
+        tileLightCountPointShadowed = 0;
+        candidateLightCount = 0;
         minDepthUInt = 0xffffffff;
         maxDepthUInt = 0;
     }
+    for (uint word = threadIndex; word < LIGHT_MASK_WORDS; word += WORK_GROUP_THREADS)
+        tileLightBitMask[word] = 0;
     GroupMemoryBarrierWithGroupSync();
 
-    // determine min/max Z for tile
-    if (depth != -1.0)
+    // determine min/max Z for tile, leaving out the sky since it is never lit
+    if (depth != -1.0 && depth < 1.0)
     {
         uint depthUInt = asuint(depth);
         
@@ -120,7 +151,7 @@ void main(
         0, 0, invTileDepthRange, tileBias.z,
         0, 0, 0, 1
         );
-    float4x4 tileMVP = mul(projToTile, ViewProjMatrix);
+    float4x4 tileMVP = mul(projToTile, groupID.x * WORK_GROUP_SIZE_X >= SplitX ? SplitViewProjMatrix : ViewProjMatrix);
     
     // extract frustum planes (these will be in world space)
     float4 frustumPlanes[6];
@@ -138,14 +169,33 @@ void main(
     uint tileIndex = GetTileIndex(groupID.xy, TileCountX);
     uint tileOffset = GetTileOffset(tileIndex);
 
+    // gather the lights of the super tiles under this tile, unless the tile only sees the sky
+    uint2 tilePixelMin = groupID.xy * uint2(WORK_GROUP_SIZE_X, WORK_GROUP_SIZE_Y);
+    uint2 tilePixelMax = min(tilePixelMin + uint2(WORK_GROUP_SIZE_X, WORK_GROUP_SIZE_Y), uint2(ViewportWidth, ViewportHeight)) - 1;
+    for (uint word = threadIndex; maxDepthUInt != 0 && word < LIGHT_MASK_WORDS; word += WORK_GROUP_THREADS)
+    {
+        uint bits = LoadSuperTileMaskWord(superTileMask, tilePixelMin, tilePixelMax, SuperTileCountX, word);
+        uint slot;
+        InterlockedAdd(candidateLightCount, countbits(bits), slot);
+        while (bits != 0)
+        {
+            uint bit = firstbitlow(bits);
+            bits ^= 1u << bit;
+            candidateLightIndices[slot++] = word * 32 + bit;
+        }
+    }
+    GroupMemoryBarrierWithGroupSync();
+
     // find set of lights that overlap this tile
-    for (uint lightIndex = threadIndex; lightIndex < MAX_LIGHTS; lightIndex += WORK_GROUP_THREADS)
+    for (uint candidate = threadIndex; candidate < candidateLightCount; candidate += WORK_GROUP_THREADS)
     {
+        uint lightIndex = candidateLightIndices[candidate];
         LightData lightData = lightBuffer[lightIndex];
         float3 lightWorldPos = lightData.pos;
         float lightCullRadius = sqrt(lightData.radiusSq);
 
-        bool overlapping = true;
+        // empty light slots have no radius
+        bool overlapping = lightData.radiusSq > 0.0;
         for (int n = 0; n < 6; n++)
         {
             float d = dot(lightWorldPos, frustumPlanes[n].xyz) + frustumPlanes[n].w;
@@ -157,13 +207,14 @@ void main(
         
         if (overlapping)
         {
-            switch (lightData.type)
+            switch (GetLightType(lightData))
             {
             case 0: // sphere
                 {
                     uint slot = 0;
                     InterlockedAdd(tileLightCountSphere, 1, slot);
-                    tileLightIndicesSphere[slot] = lightIndex;
+                    if (slot < MAX_TILE_LIGHTS)
+                        tileLightIndicesSphere[slot] = lightIndex;
                 }
                 break;
 
@@ -171,7 +222,8 @@ void main(
                 {
                     uint slot = 0;
                     InterlockedAdd(tileLightCountCone, 1, slot);
-                    tileLightIndicesCone[slot] = lightIndex;
+                    if (slot < MAX_TILE_LIGHTS)
+                        tileLightIndicesCone[slot] = lightIndex;
                 }
                 break;
 
@@ -179,27 +231,23 @@ void main(
                 {
                     uint slot = 0;
                     InterlockedAdd(tileLightCountConeShadowed, 1, slot);
-                    tileLightIndicesConeShadowed[slot] = lightIndex;
+                    if (slot < MAX_TILE_LIGHTS)
+                        tileLightIndicesConeShadowed[slot] = lightIndex;
                 }
                 break;
-            }
 
-            // update bitmask
-            switch (lightIndex / 32)
-            {
-            case 0:
-                InterlockedOr(tileLightBitMask.x, 1 << (lightIndex % 32));
-                break;
-            case 1:
-                InterlockedOr(tileLightBitMask.y, 1 << (lightIndex % 32));
-                break;
-            case 2:
-                InterlockedOr(tileLightBitMask.z, 1 << (lightIndex % 32));
-                break;
-            case 3:
-                InterlockedOr(tileLightBitMask.w, 1 << (lightIndex % 32));
+            case 3: // sphere w/ cube or dual paraboloid shadow map
+                {
+                    uint slot = 0;
+                    InterlockedAdd(tileLightCountPointShadowed, 1, slot);
+                    if (slot < MAX_TILE_LIGHTS)
+                        tileLightIndicesPointShadowed[slot] = lightIndex;
+                }
                 break;
             }
+
+            // update bitmask
+            InterlockedOr(tileLightBitMask[lightIndex / 32], 1 << (lightIndex % 32));
         }
     }
 
@@ -207,29 +255,53 @@ void main(
 
     if (threadIndex == 0)
     {
+        // A full list of a type drops the rest of its lights
+        tileLightCountSphere = min(tileLightCountSphere, MAX_TILE_LIGHTS);
+        tileLightCountCone = min(tileLightCountCone, MAX_TILE_LIGHTS);
+        tileLightCountConeShadowed = min(tileLightCountConeShadowed, MAX_TILE_LIGHTS);
+        tileLightCountPointShadowed = min(tileLightCountPointShadowed, MAX_TILE_LIGHTS);
+
+        // The list is allocated in whole dwords, so no other tile writes the dwords it packs
+        uint total = tileLightCountSphere + tileLightCountCone + tileLightCountConeShadowed + tileLightCountPointShadowed;
+        uint listOffset = ListBase;
+        if (total > 0)
+        {
+            uint firstWord;
+            lightGrid.InterlockedAdd(0, (total * LIGHT_INDEX_SIZE + 3) / 4, firstWord);
+            listOffset += firstWord * 4;
+
+            // A full buffer leaves the tile unlit rather than writing past the end
+            if (listOffset + total * LIGHT_INDEX_SIZE > ListEnd)
+            {
+                tileLightCountSphere = tileLightCountCone = tileLightCountConeShadowed = tileLightCountPointShadowed = 0;
+                listOffset = ListBase;
+            }
+        }
+        tileListOffset = listOffset;
+
         uint lightCount = 
             ((tileLightCountSphere & 0xff) << 0) |
             ((tileLightCountCone & 0xff) << 8) |
-            ((tileLightCountConeShadowed & 0xff) << 16);
-        lightGrid.Store(tileOffset + 0, lightCount);
+            ((tileLightCountConeShadowed & 0xff) << 16) |
+            ((tileLightCountPointShadowed & 0xff) << 24);
+        lightGrid.Store2(tileOffset, uint2(listOffset, lightCount));
+    }
+    GroupMemoryBarrierWithGroupSync();
 
-        uint storeOffset = tileOffset + 4;
-        for (uint n = 0; n < tileLightCountSphere; n++)
-        {
-            lightGrid.Store(storeOffset, tileLightIndicesSphere[n]);
-            storeOffset += 4;
-        }
-        for (uint n = 0; n < tileLightCountCone; n++)
-        {
-            lightGrid.Store(storeOffset, tileLightIndicesCone[n]);
-            storeOffset += 4;
-        }
-        for (uint n = 0; n < tileLightCountConeShadowed; n++)
+    // Every thread packs a share of the list's dwords
+    uint tileLightCount = tileLightCountSphere + tileLightCountCone + tileLightCountConeShadowed + tileLightCountPointShadowed;
+    for (uint listWord = threadIndex; listWord * 4 < tileLightCount * LIGHT_INDEX_SIZE; listWord += WORK_GROUP_THREADS)
+    {
+        uint packed = 0;
+        for (uint k = 0; k < 4 / LIGHT_INDEX_SIZE; k++)
         {
-            lightGrid.Store(storeOffset, tileLightIndicesConeShadowed[n]);
-            storeOffset += 4;
+            uint n = listWord * (4 / LIGHT_INDEX_SIZE) + k;
+            if (n < tileLightCount)
+                packed |= GetTileLightIndex(n) << (k * LIGHT_INDEX_SIZE * 8);
         }
-
-        lightGridBitMask.Store4(tileIndex * 16, tileLightBitMask);
+        lightGrid.Store(tileListOffset + listWord * 4, packed);
     }
+
+    for (uint word = threadIndex; word < LIGHT_MASK_WORDS; word += WORK_GROUP_THREADS)
+        lightGridBitMask.Store(tileIndex * TILE_MASK_SIZE + word * 4, tileLightBitMask[word]);
 }
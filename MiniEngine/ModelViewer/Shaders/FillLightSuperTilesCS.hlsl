@@ -0,0 +1,139 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// The coarse level of the light grid build.  Each group finds the depth bounds of the geometry in one super
+// tile and writes a bit mask of the lights that overlap the super tile's frustum between those bounds.  The
+// fine grid and clusters then only test the lights of the super tiles they lie in.  Super tiles that only
+// see the sky get an empty mask.
+//
+
+#include "LightGrid.hlsli"
+
+// outdated warning about for-loop variable scope
+#pragma warning (disable: 3078)
+
+#define GROUP_SIZE 16
+#define GROUP_THREADS (GROUP_SIZE * GROUP_SIZE)
+#define PIXELS_PER_THREAD (SUPER_TILE_DIM / GROUP_SIZE)
+
+cbuffer CSConstants : register(b0)
+{
+    uint ViewportWidth, ViewportHeight;
+    float RcpZMagic;
+    uint SuperTileCountX;
+    float4x4 ViewProjMatrix;
+    uint FillFrontClusters;     // The clusters also light the air in front of the geometry and over the sky
+    uint SplitX;                // Super tiles from this pixel column on belong to the second view
+    float4x4 SplitViewProjMatrix;
+};
+
+StructuredBuffer<LightData> lightBuffer : register(t0);
+Texture2D<float> depthTex : register(t1);
+RWByteAddressBuffer superTileMask : register(u0);
+
+groupshared uint gs_MinDepth;
+groupshared uint gs_MaxDepth;
+groupshared uint gs_LightMask[LIGHT_MASK_WORDS];
+
+#define _RootSig \
+    "RootFlags(0), " \
+    "CBV(b0), " \
+    "DescriptorTable(SRV(t0, numDescriptors = 2))," \
+    "DescriptorTable(UAV(u0, numDescriptors = 1))"
+
+[RootSignature(_RootSig)]
+[numthreads(GROUP_SIZE, GROUP_SIZE, 1)]
+void main(uint3 groupID : SV_GroupID, uint3 threadID : SV_GroupThreadID, uint threadIndex : SV_GroupIndex)
+{
+    if (threadIndex == 0)
+    {
+        gs_MinDepth = 0xffffffff;
+        gs_MaxDepth = 0;
+    }
+    for (uint word = threadIndex; word < LIGHT_MASK_WORDS; word += GROUP_THREADS)
+        gs_LightMask[word] = 0;
+    GroupMemoryBarrierWithGroupSync();
+
+    // Depth bounds of the geometry.  The depth is linear and positive, so it orders the same as its bits.
+    uint2 pixelOrigin = groupID.xy * SUPER_TILE_DIM + threadID.xy * PIXELS_PER_THREAD;
+    uint minDepth = 0xffffffff, maxDepth = 0;
+    for (uint y = 0; y < PIXELS_PER_THREAD; y++)
+    {
+        for (uint x = 0; x < PIXELS_PER_THREAD; x++)
+        {
+            uint2 pixel = pixelOrigin + uint2(x, y);
+            if (pixel.x >= ViewportWidth || pixel.y >= ViewportHeight)
+                continue;
+
+            // Nothing to light on the far plane, unless the air in front of it is lit too
+            float linearDepth = depthTex[pixel];
+            if (linearDepth < 1.0 || FillFrontClusters != 0)
+            {
+                minDepth = min(minDepth, asuint(linearDepth));
+                maxDepth = max(maxDepth, asuint(linearDepth));
+            }
+        }
+    }
+    InterlockedMin(gs_MinDepth, minDepth);
+    InterlockedMax(gs_MaxDepth, maxDepth);
+    GroupMemoryBarrierWithGroupSync();
+
+    uint superTileIndex = GetTileIndex(groupID.xy, SuperTileCountX);
+
+    if (gs_MaxDepth != 0)
+    {
+        float tileMinDepth = (rcp(asfloat(gs_MaxDepth)) - 1.0) * RcpZMagic;
+        float tileMaxDepth = (rcp(asfloat(gs_MinDepth)) - 1.0) * RcpZMagic;
+
+        // Reversed z puts the near plane at 1
+        if (FillFrontClusters != 0)
+            tileMaxDepth = 1.0;
+        float invTileDepthRange = rcp(max(tileMaxDepth - tileMinDepth, 1.175494351e-38F));
+
+        // Same construction as the fine grid, with the super tile's extent
+        float2 invTileSize2X = float2(ViewportWidth, ViewportHeight) / SUPER_TILE_DIM;
+        float4x4 projToTile = float4x4(
+            invTileSize2X.x, 0, 0, -2.0 * float(groupID.x) + invTileSize2X.x - 1.0,
+            0, -invTileSize2X.y, 0, -2.0 * float(groupID.y) + invTileSize2X.y - 1.0,
+            0, 0, invTileDepthRange, -tileMinDepth * invTileDepthRange,
+            0, 0, 0, 1
+            );
+        float4x4 tileMVP = mul(projToTile, groupID.x * SUPER_TILE_DIM >= SplitX ? SplitViewProjMatrix : ViewProjMatrix);
+
+        float4 frustumPlanes[6];
+        frustumPlanes[0] = tileMVP[3] + tileMVP[0];
+        frustumPlanes[1] = tileMVP[3] - tileMVP[0];
+        frustumPlanes[2] = tileMVP[3] + tileMVP[1];
+        frustumPlanes[3] = tileMVP[3] - tileMVP[1];
+        frustumPlanes[4] = tileMVP[3] + tileMVP[2];
+        frustumPlanes[5] = tileMVP[3] - tileMVP[2];
+        for (int n = 0; n < 6; n++)
+            frustumPlanes[n] *= rsqrt(dot(frustumPlanes[n].xyz, frustumPlanes[n].xyz));
+
+        for (uint lightIndex = threadIndex; lightIndex < MAX_LIGHTS; lightIndex += GROUP_THREADS)
+        {
+            LightData lightData = lightBuffer[lightIndex];
+            float lightCullRadius = sqrt(lightData.radiusSq);
+
+            // Empty light slots have no radius
+            bool overlapping = lightData.radiusSq > 0.0;
+            for (int n = 0; n < 6; n++)
+            {
+                if (dot(lightData.pos, frustumPlanes[n].xyz) + frustumPlanes[n].w < -lightCullRadius)
+                    overlapping = false;
+            }
+
+            if (overlapping)
+                InterlockedOr(gs_LightMask[lightIndex / 32], 1u << (lightIndex % 32));
+        }
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    for (uint word = threadIndex; word < LIGHT_MASK_WORDS; word += GROUP_THREADS)
+        superTileMask.Store(superTileIndex * TILE_MASK_SIZE + word * 4, gs_LightMask[word]);
+}
@@ -0,0 +1,174 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+// Two-phase occlusion culling of the opaque meshes of the main view.  The first phase draws the meshes
+// that were visible last frame and are inside the frustum.  The second tests every mesh in the frustum
+// against the Hi-Z pyramid of the first phase's depth, records which are visible for the next frame, and
+// draws the ones the first phase missed.  Each phase writes its draws to its own list and count, and to a
+// second list that draws from the depth-only vertex stream, NumMeshes * 2 draws further on.  The triangles
+// of each phase's draws follow the two draw counts.
+
+#define HiZCull_RootSig \
+    "RootFlags(0), " \
+    "CBV(b0), " \
+    "SRV(t0), " \
+    "DescriptorTable(SRV(t1, numDescriptors = 1)), " \
+    "DescriptorTable(UAV(u0, numDescriptors = 3))"
+
+// must keep in sync with C++
+struct MeshInfo
+{
+    float3 BoundsMin;
+    uint IndexCount;
+    float3 BoundsMax;
+    uint StartIndex;
+    uint BaseVertex;
+    uint MaterialIndex;
+    uint BaseVertexDepth;
+    uint Pad;
+};
+
+// Root constants for the model shaders followed by D3D12_DRAW_INDEXED_ARGUMENTS
+struct DrawCommand
+{
+    uint BaseVertex;
+    uint MaterialIndex;
+    uint ViewMask;
+    uint IndexCountPerInstance;
+    uint InstanceCount;
+    uint StartIndexLocation;
+    int BaseVertexLocation;
+    uint StartInstanceLocation;
+};
+
+cbuffer CSConstants : register(b0)
+{
+    float4x4 ViewProj;
+    uint NumMeshes;
+    uint Phase;                 // 0 draws last frame's visible meshes, 1 tests against the pyramid
+    uint2 ViewportSize;         // Of the depth buffer the pyramid was built from
+    uint HiZLevels;
+};
+
+StructuredBuffer<MeshInfo> Meshes : register(t0);
+Texture2D<float> HiZ : register(t1);
+RWStructuredBuffer<DrawCommand> DrawCommands : register(u0);
+RWByteAddressBuffer DrawCounts : register(u1);
+RWByteAddressBuffer Visibility : register(u2);
+
+[RootSignature(HiZCull_RootSig)]
+[numthreads( 64, 1, 1 )]
+void main( uint3 DTid : SV_DispatchThreadID )
+{
+    uint meshIndex = DTid.x;
+    if (meshIndex >= NumMeshes)
+        return;
+
+    MeshInfo mesh = Meshes[meshIndex];
+
+    // Project the corners, tracking the clip planes they are all outside of and their screen bounds
+    uint outsideAll = 0x3F;
+    bool crossesNearPlane = false;
+    float2 minUV = 1.0;
+    float2 maxUV = 0.0;
+    float nearestZ = 0.0;
+
+    [unroll]
+    for (uint i = 0; i < 8; ++i)
+    {
+        float3 corner = float3(
+            i & 1 ? mesh.BoundsMax.x : mesh.BoundsMin.x,
+            i & 2 ? mesh.BoundsMax.y : mesh.BoundsMin.y,
+            i & 4 ? mesh.BoundsMax.z : mesh.BoundsMin.z);
+
+        float4 clip = mul(ViewProj, float4(corner, 1.0));
+
+        uint outside = 0;
+        outside |= clip.x < -clip.w ? 0x01 : 0;
+        outside |= clip.x >  clip.w ? 0x02 : 0;
+        outside |= clip.y < -clip.w ? 0x04 : 0;
+        outside |= clip.y >  clip.w ? 0x08 : 0;
+        outside |= clip.z < 0.0     ? 0x10 : 0;
+        outside |= clip.z >  clip.w ? 0x20 : 0;
+        outsideAll &= outside;
+
+        if (clip.w <= 0.0 || clip.z >= clip.w)
+        {
+            crossesNearPlane = true;
+            continue;
+        }
+
+        float3 ndc = clip.xyz / clip.w;
+        float2 uv = ndc.xy * float2(0.5, -0.5) + 0.5;
+        minUV = min(minUV, uv);
+        maxUV = max(maxUV, uv);
+        nearestZ = max(nearestZ, ndc.z);
+    }
+
+    bool inFrustum = outsideAll == 0;
+    bool wasVisible = Visibility.Load(meshIndex * 4) != 0;
+
+    bool draw;
+    if (Phase == 0)
+    {
+        draw = inFrustum && wasVisible;
+    }
+    else
+    {
+        bool visible = inFrustum;
+        if (visible && !crossesNearPlane)
+        {
+            // Pick the level where the bounds cover at most 2x2 texels.  Texels of level L span 2^(L+1)
+            // depth pixels.
+            float2 minPixel = saturate(minUV) * ViewportSize;
+            float2 maxPixel = saturate(maxUV) * ViewportSize;
+            float2 size = maxPixel - minPixel;
+            uint level = (uint)max(ceil(log2(max(max(size.x, size.y), 1.0))) - 1.0, 0.0);
+            level = min(level, HiZLevels - 1);
+
+            float texelSize = exp2(level + 1);
+            uint2 minTexel = (uint2)(minPixel / texelSize);
+            uint2 maxTexel = (uint2)(maxPixel / texelSize);
+
+            float farthestDepth = 1.0;
+            for (uint y = minTexel.y; y <= maxTexel.y; ++y)
+            {
+                for (uint x = minTexel.x; x <= maxTexel.x; ++x)
+                    farthestDepth = min(farthestDepth, HiZ.Load(int3(x, y, level)));
+            }
+
+            visible = nearestZ >= farthestDepth;
+        }
+
+        Visibility.Store(meshIndex * 4, visible ? 1 : 0);
+        draw = visible && !wasVisible;
+    }
+
+    if (!draw)
+        return;
+
+    uint drawIndex;
+    DrawCounts.InterlockedAdd(Phase * 4, 1, drawIndex);
+    DrawCounts.InterlockedAdd(8 + Phase * 4, mesh.IndexCount / 3);
+
+    DrawCommand command;
+    command.BaseVertex = mesh.BaseVertex;
+    command.MaterialIndex = mesh.MaterialIndex;
+    command.ViewMask = 1;
+    command.IndexCountPerInstance = mesh.IndexCount;
+    command.InstanceCount = 1;
+    command.StartIndexLocation = mesh.StartIndex;
+    command.BaseVertexLocation = mesh.BaseVertex;
+    command.StartInstanceLocation = 0;
+    DrawCommands[Phase * NumMeshes + drawIndex] = command;
+
+    command.BaseVertex = mesh.BaseVertexDepth;
+    command.BaseVertexLocation = mesh.BaseVertexDepth;
+    DrawCommands[(2 + Phase) * NumMeshes + drawIndex] = command;
+}
@@ -12,23 +12,83 @@
 //
 
 // keep in sync with C code
-#define MAX_LIGHTS 128
-#define TILE_SIZE (4 + MAX_LIGHTS * 4)
+#define MAX_LIGHTS 1024
+#define MAX_SHADOWED_LIGHTS 64
+#define FIRST_SHADOWED_LIGHT (MAX_LIGHTS - MAX_SHADOWED_LIGHTS)   // shadowed lights take the last slots
+#define MAX_TILE_LIGHTS 255     // per type, as the counts are packed into 8 bits
 
+// The first dword of the grid buffer is the allocation counter of its light lists, in dwords.  A tile header
+// holds the byte offset of its list in the same buffer followed by its sphere | cone << 8 | shadowed cone << 16
+// | shadowed point << 24 light counts.  The lists follow the headers, with the light indices in 8 bits when
+// they fit and 16 bits otherwise.  Read them with LoadTileLightIndex.
+#define TILE_HEADER_SIZE 8
+#if MAX_LIGHTS <= 256
+#define LIGHT_INDEX_SIZE 1
+#define LIGHT_INDEX_MASK 0xff
+#else
+#define LIGHT_INDEX_SIZE 2
+#define LIGHT_INDEX_MASK 0xffff
+#endif
+
+// The bit mask has a bit for every light, so it is exact even when a tile's list is full
+#define LIGHT_MASK_WORDS (MAX_LIGHTS / 32)
+#define TILE_MASK_SIZE (LIGHT_MASK_WORDS * 4)
+
+// Lights are first binned into coarse super tiles of SUPER_TILE_DIM pixels, each with a bit mask laid out like
+// a tile's.  Grid tiles and clusters only test the lights in the masks of the super tiles they overlap.
+#define SUPER_TILE_DIM 64
+
+// Clusters split each tile into exponentially spaced view depth slices.  A cluster header holds the dword
+// offset of its light list in the cluster list buffer followed by its sphere | cone << 16 and shadowed
+// cone | shadowed point << 16 light counts.  The first dword of the list buffer is its allocation counter.
+#define NUM_CLUSTER_SLICES 16
+#define CLUSTER_HEADER_SIZE 16
+
+// What the light loops read for every light, in 32 bytes.  The color and cone angles are half floats, and the
+// cone direction is octahedral-encoded in two snorm16s.  Read them with the accessors below.
 struct LightData
 {
     float3 pos;
     float radiusSq;
 
-    float3 color;
-    uint type;
-
-    float3 coneDir;
-    float2 coneAngles; // x = 1.0f / (cos(coneInner) - cos(coneOuter)), y = cos(coneOuter)
+    uint colorRG;       // red | green << 16
+    uint colorBType;    // blue | type << 16
+    uint coneDir;
+    uint coneAngles;    // x = 1.0f / (cos(coneInner) - cos(coneOuter)), y = cos(coneOuter)
+};
 
+// Shadowed lights only, indexed by light index - FIRST_SHADOWED_LIGHT
+struct LightShadowData
+{
     float4x4 shadowTextureMatrix;
+
+    // Shadowed point lights only.  x, y = face depth terms, z = face tile size in atlas UV, w = dual paraboloid
+    // (see PointShadow.hlsli).  The face offsets hold the atlas UV of each face tile, two faces per element.
+    float4 pointShadowParams;
+    float4 pointShadowFaceOffsets[3];
 };
 
+float3 GetLightColor(LightData lightData)
+{
+    return f16tof32(uint3(lightData.colorRG, lightData.colorRG >> 16, lightData.colorBType));
+}
+uint GetLightType(LightData lightData)
+{
+    return lightData.colorBType >> 16;
+}
+float3 GetLightConeDir(LightData lightData)
+{
+    float2 e = max(float2(int2(lightData.coneDir << 16, lightData.coneDir) >> 16) / 32767.0, -1.0);
+    float3 v = float3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = saturate(-v.z);
+    v.xy += v.xy >= 0.0 ? -t : t;
+    return normalize(v);
+}
+float2 GetLightConeAngles(LightData lightData)
+{
+    return f16tof32(uint2(lightData.coneAngles, lightData.coneAngles >> 16));
+}
+
 uint2 GetTilePos(float2 pos, float2 invTileDim)
 {
     return pos * invTileDim;
@@ -39,5 +99,33 @@ uint GetTileIndex(uint2 tilePos, uint tileCountX)
 }
 uint GetTileOffset(uint tileIndex)
 {
-    return tileIndex * TILE_SIZE;
+    return 4 + tileIndex * TILE_HEADER_SIZE;
+}
+uint LoadTileLightIndex(ByteAddressBuffer lightGrid, uint byteOffset)
+{
+    return (lightGrid.Load(byteOffset & ~3) >> ((byteOffset & 3) * 8)) & LIGHT_INDEX_MASK;
+}
+uint GetClusterSlice(float viewDepth, float sliceScale, float sliceBias)
+{
+    float slice = log2(max(viewDepth, 1e-4)) * sliceScale + sliceBias;
+    return (uint)clamp(slice, 0.0, NUM_CLUSTER_SLICES - 1.0);
+}
+uint GetClusterOffset(uint tileIndex, uint slice)
+{
+    return (tileIndex * NUM_CLUSTER_SLICES + slice) * CLUSTER_HEADER_SIZE;
+}
+
+// Returns a word of the union of the masks of the super tiles under the pixel rectangle [pixelMin, pixelMax].
+// A grid tile that does not divide the super tile dimension can straddle up to four of them.
+uint LoadSuperTileMaskWord(ByteAddressBuffer superTileMask, uint2 pixelMin, uint2 pixelMax, uint superTileCountX, uint word)
+{
+    uint2 first = pixelMin / SUPER_TILE_DIM;
+    uint2 last = pixelMax / SUPER_TILE_DIM;
+    uint bits = 0;
+    for (uint y = first.y; y <= last.y; y++)
+    {
+        for (uint x = first.x; x <= last.x; x++)
+            bits |= superTileMask.Load(GetTileIndex(uint2(x, y), superTileCountX) * TILE_MASK_SIZE + word * 4);
+    }
+    return bits;
 }
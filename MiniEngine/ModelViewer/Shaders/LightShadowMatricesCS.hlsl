@@ -0,0 +1,90 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Builds the shadow view-projection of every shadowed cone light from the light buffer, along with the
+// matrix that maps world space to the light's tile in the shadow atlas.  The frustum matches the cone as
+// the light loops decode it, with the same reversed-Z perspective projection as Math::Camera.
+//
+
+#include "LightGrid.hlsli"
+
+// Shadowed cone lights take the first half of the shadowed slots.  Keep in sync with ForwardPlusLighting.cpp.
+#define NUM_CONE_SHADOWED_LIGHTS (MAX_SHADOWED_LIGHTS / 2)
+
+#define LightShadowMatrices_RootSig \
+    "RootFlags(0), " \
+    "SRV(t0), " \
+    "SRV(t1), " \
+    "DescriptorTable(UAV(u0, numDescriptors = 2))"
+
+// Padded to 256 bytes so that each can be bound as the constants of DepthViewerVS
+struct LightShadowMatrix
+{
+    float4x4 ViewProj;
+    float4 Pad[12];
+};
+
+StructuredBuffer<LightData> lightBuffer : register(t0);
+// x = half the tile size in atlas UV, yz = the tile center in atlas UV, w = 0 for lights without a tile
+StructuredBuffer<float4> tileTransforms : register(t1);
+RWStructuredBuffer<LightShadowData> lightShadowBuffer : register(u0);
+RWStructuredBuffer<LightShadowMatrix> shadowMatrices : register(u1);
+
+[RootSignature(LightShadowMatrices_RootSig)]
+[numthreads( NUM_CONE_SHADOWED_LIGHTS, 1, 1 )]
+void main( uint GI : SV_GroupIndex )
+{
+    LightData lightData = lightBuffer[FIRST_SHADOWED_LIGHT + GI];
+    float4 tile = tileTransforms[GI];
+
+    // Empty slots have no radius and lights without a tile are never rendered.  Their texture matrix maps every
+    // point to the bottom right corner of the atlas with a depth that always passes the shadow test.
+    if (lightData.radiusSq == 0.0 || tile.w == 0.0)
+    {
+        shadowMatrices[GI].ViewProj = (float4x4)0;
+        lightShadowBuffer[GI].shadowTextureMatrix = float4x4(
+            0.0, 0.0, 0.0, 0.0,
+            0.0, 0.0, 0.0, 0.0,
+            0.0, 0.0, 0.0, 0.0,
+            0.0, 0.0, 0.0, 1.0);
+        return;
+    }
+
+    // Same basis as a camera looking down the cone so that triangle winding is preserved
+    float3 forward = GetLightConeDir(lightData);
+    float3 right = cross(forward, float3(0.0, 1.0, 0.0));
+    if (dot(right, right) < 0.000001)
+        right = cross(forward, float3(1.0, 0.0, 0.0));
+    right = normalize(right);
+    float3 up = cross(right, forward);
+
+    // The field of view spans the outer cone angle on both sides of the axis
+    float cosOuter = GetLightConeAngles(lightData).y;
+    float scale = cosOuter * rsqrt(max(1.0 - cosOuter * cosOuter, 1e-8));
+
+    // Reversed-Z between 5% of the radius and the radius
+    float radius = sqrt(lightData.radiusSq);
+    float q1 = 0.05 / (1.0 - 0.05);
+    float q2 = q1 * radius;
+
+    float3 pos = lightData.pos;
+    float4x4 viewProj = float4x4(
+        float4(right * scale, -dot(right, pos) * scale),
+        float4(up * scale, -dot(up, pos) * scale),
+        float4(-forward * q1, dot(forward, pos) * q1 + q2),
+        float4(forward, -dot(forward, pos)));
+
+    const float4x4 toTile = float4x4(
+        tile.x, 0.0, 0.0, tile.y,
+        0.0, -tile.x, 0.0, tile.z,
+        0.0, 0.0, 1.0, 0.0,
+        0.0, 0.0, 0.0, 1.0);
+
+    shadowMatrices[GI].ViewProj = viewProj;
+    lightShadowBuffer[GI].shadowTextureMatrix = mul(toTile, viewProj);
+}
@@ -0,0 +1,36 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+// Shading constants for the color pass.  Keep in sync with psConstants in ModelViewer::RenderScene().
+
+cbuffer PSConstants : register(b0)
+{
+    float3 SunDirection;
+    float3 SunColor;
+    float3 AmbientColor;
+    float4 ShadowTexelSize;    // x = sun shadow map, y = cascade slice, z = light shadow atlas
+
+    float4 InvTileDim;
+    uint4 TileCount;
+    uint4 FirstLightIndex;
+
+    uint FrameIndexMod2;
+    uint NumCascades;        // 0 when cascaded sun shadows are disabled
+    float CascadeBlendRange;    // Fraction of each cascade that cross-fades into the next one
+    float3 CameraForward;
+    float4 MomentShadowParams;    // x = moment shadows enabled, y = light bleed reduction
+    float4 SoftShadowParams;    // x = sun penumbra scale, y = cone light size, z = max search radius in texels
+    uint4 SoftShadowSamples;    // x = soft shadows enabled, y = blocker search samples, z = filter samples
+    float4x4 VirtualShadowMatrix;    // World space to virtual sun shadow map texture space
+    float4 VirtualShadowParams;    // x = virtual shadow map enabled, y = texel size
+    float4 ShadowMaskParams;    // x = sun shadow is read from the screen-space mask
+    float4 ClusterParams;    // x = clustered lighting enabled, y = slice scale, z = slice bias
+    uint4 MipFeedbackParams;    // x = texture feedback enabled, yz = the pixel of each 8x8 tile that reports it
+    float4 TemporalShadowParams;    // x = sun shadow taps rotated per frame, or 0 for the fixed filter, yz = cos, sin of the rotation
+}
@@ -13,8 +13,14 @@
 //
 // Thanks to Michal Drobot for his feedback.
 
+#define DRAW_CONSTANTS
 #include "ModelViewerRS.hlsli"
 #include "LightGrid.hlsli"
+#include "ModelViewerConstants.hlsli"
+#include "ShadowCascades.hlsli"
+#include "ShadowMoments.hlsli"
+#include "SoftShadows.hlsli"
+#include "PointShadow.hlsli"
 
 // outdated warning about for-loop variable scope
 #pragma warning (disable: 3078)
@@ -33,34 +39,43 @@ struct VSOutput
     sample float3 bitangent : Bitangent;
 };
 
-Texture2D<float3> texDiffuse        : register(t0);
-Texture2D<float3> texSpecular        : register(t1);
-//Texture2D<float4> texEmissive        : register(t2);
-Texture2D<float3> texNormal            : register(t3);
-//Texture2D<float4> texLightmap        : register(t4);
-//Texture2D<float4> texReflection    : register(t5);
+#ifdef BINDLESS_MATERIALS
+Texture2DArray<float3> g_MaterialTextures[] : register(t0, space1);
+#else
+Texture2DArray<float3> texDiffuse        : register(t0);
+Texture2DArray<float3> texSpecular        : register(t1);
+//Texture2DArray<float4> texEmissive        : register(t2);
+Texture2DArray<float3> texNormal            : register(t3);
+//Texture2DArray<float4> texLightmap        : register(t4);
+//Texture2DArray<float4> texReflection    : register(t5);
+#endif
 Texture2D<float> texSSAO            : register(t64);
 Texture2D<float> texShadow            : register(t65);
 
 StructuredBuffer<LightData> lightBuffer : register(t66);
-Texture2DArray<float> lightShadowArrayTex : register(t67);
+Texture2D<float> lightShadowAtlasTex : register(t67);
 ByteAddressBuffer lightGrid : register(t68);
 ByteAddressBuffer lightGridBitMask : register(t69);
-
-cbuffer PSConstants : register(b0)
-{
-    float3 SunDirection;
-    float3 SunColor;
-    float3 AmbientColor;
-    float4 ShadowTexelSize;
-
-    float4 InvTileDim;
-    uint4 TileCount;
-    uint4 FirstLightIndex;
-}
+Texture2DArray<float> texSunShadowCascades : register(t70);
+StructuredBuffer<CascadeData> cascadeBuffer : register(t71);
+Texture2D<float2> texShadowMoments : register(t72);
+Texture2D<float2> lightShadowMomentsTex : register(t73);
+Texture2D<float2> texShadowDepthPyramid : register(t74);
+Texture2D<float2> lightShadowDepthPyramidTex : register(t75);
+Texture2D<float> texVirtualShadow : register(t76);
+Texture2D<float> texSunShadowMask : register(t77);
+ByteAddressBuffer lightClusters : register(t78);
+ByteAddressBuffer lightClusterList : register(t79);
+StructuredBuffer<LightShadowData> lightShadowBuffer : register(t80);
+
+RWByteAddressBuffer mipFeedback : register(u0);
 
 SamplerState sampler0 : register(s0);
 SamplerComparisonState shadowSampler : register(s1);
+SamplerState momentSampler : register(s2);
+SamplerComparisonState shadowWrapSampler : register(s3);
+
+#include "SunShadow.hlsli"
 
 void AntiAliasSpecular( inout float3 texNormal, inout float gloss )
 {
@@ -87,35 +102,43 @@ float3 ApplyAmbientLight(
     return ao * diffuse * lightColor;
 }
 
-float GetShadow( float3 ShadowCoord )
+
+// The shadow texture matrix already maps into the light's tile of the atlas
+float GetShadowConeLight(uint lightIndex, float3 shadowCoord)
 {
-#ifdef SINGLE_SAMPLE
-    float result = texShadow.SampleCmpLevelZero( shadowSampler, ShadowCoord.xy, ShadowCoord.z );
-#else
-    const float Dilation = 2.0;
-    float d1 = Dilation * ShadowTexelSize.x * 0.125;
-    float d2 = Dilation * ShadowTexelSize.x * 0.875;
-    float d3 = Dilation * ShadowTexelSize.x * 0.625;
-    float d4 = Dilation * ShadowTexelSize.x * 0.375;
-    float result = (
-        2.0 * texShadow.SampleCmpLevelZero( shadowSampler, ShadowCoord.xy, ShadowCoord.z ) +
-        texShadow.SampleCmpLevelZero( shadowSampler, ShadowCoord.xy + float2(-d2,  d1), ShadowCoord.z ) +
-        texShadow.SampleCmpLevelZero( shadowSampler, ShadowCoord.xy + float2(-d1, -d2), ShadowCoord.z ) +
-        texShadow.SampleCmpLevelZero( shadowSampler, ShadowCoord.xy + float2( d2, -d1), ShadowCoord.z ) +
-        texShadow.SampleCmpLevelZero( shadowSampler, ShadowCoord.xy + float2( d1,  d2), ShadowCoord.z ) +
-        texShadow.SampleCmpLevelZero( shadowSampler, ShadowCoord.xy + float2(-d4,  d3), ShadowCoord.z ) +
-        texShadow.SampleCmpLevelZero( shadowSampler, ShadowCoord.xy + float2(-d3, -d4), ShadowCoord.z ) +
-        texShadow.SampleCmpLevelZero( shadowSampler, ShadowCoord.xy + float2( d4, -d3), ShadowCoord.z ) +
-        texShadow.SampleCmpLevelZero( shadowSampler, ShadowCoord.xy + float2( d3,  d4), ShadowCoord.z )
-        ) / 10.0;
-#endif
+    if (MomentShadowParams.x != 0.0)
+    {
+        float2 moments = lightShadowMomentsTex.SampleLevel(momentSampler, shadowCoord.xy, 0);
+        return GetMomentShadow(moments, shadowCoord.z, LIGHT_MOMENT_EXPONENT, MomentShadowParams.y);
+    }
+
+    // The search can reach past the edge of the light's tile, but only where the cone has faded out
+    if (SoftShadowSamples.x != 0)
+    {
+        SoftShadowDesc desc;
+        desc.TexelSize = ShadowTexelSize.z;
+        desc.PenumbraScale = SoftShadowParams.y;
+        desc.MaxSearchRadius = SoftShadowParams.z;
+        desc.BlockerSamples = SoftShadowSamples.y;
+        desc.FilterSamples = SoftShadowSamples.z;
+        desc.Perspective = true;
+        return GetSoftShadow(lightShadowAtlasTex, lightShadowDepthPyramidTex, shadowSampler, shadowCoord, desc);
+    }
+
+    float result = lightShadowAtlasTex.SampleCmpLevelZero(
+        shadowSampler, shadowCoord.xy, shadowCoord.z);
     return result * result;
 }
 
-float GetShadowConeLight(uint lightIndex, float3 shadowCoord)
+// Point light shadows are always filtered with a single bilinear comparison
+float GetShadowPointLight(float3 lightToPoint, float4 shadowParams, float4 faceOffsets[3])
 {
-    float result = lightShadowArrayTex.SampleCmpLevelZero(
-        shadowSampler, float3(shadowCoord.xy, lightIndex), shadowCoord.z);
+    uint face = GetPointShadowFace(lightToPoint, shadowParams.w != 0.0);
+    float3 faceCoord = ProjectPointShadowFace(GetPointShadowFaceView(lightToPoint, face), shadowParams);
+    float2 faceOffset = face & 1 ? faceOffsets[face / 2].zw : faceOffsets[face / 2].xy;
+    float2 shadowUV = (faceCoord.xy * float2(0.5, -0.5) + 0.5) * shadowParams.z + faceOffset;
+
+    float result = lightShadowAtlasTex.SampleCmpLevelZero(shadowSampler, shadowUV, faceCoord.z);
     return result * result;
 }
 
@@ -151,10 +174,14 @@ float3 ApplyDirectionalLight(
     float3    viewDir,        // World-space vector from eye to point
     float3    lightDir,        // World-space vector from point to light
     float3    lightColor,        // Radiance of directional light
-    float3    shadowCoord        // Shadow coordinate (Shadow map UV & light-relative Z)
+    float3    shadowCoord,    // Shadow coordinate (Shadow map UV & light-relative Z)
+    float3    worldPos,        // World-space fragment position
+    float    viewDepth,        // Distance from the eye along the camera's forward axis
+    uint2    pixelPos        // Screen position for the shadow mask
     )
 {
-    float shadow = GetShadow(shadowCoord);
+    // The mask was resolved from the depth buffer, so the lookup happens only once per pixel
+    float shadow = ShadowMaskParams.x != 0.0 ? texSunShadowMask[pixelPos] : GetDirectionalShadow(shadowCoord, worldPos, viewDepth);
 
     return shadow * ApplyLightCommon(
         diffuseColor,
@@ -280,33 +307,67 @@ float3 ApplyConeShadowedLight(
         );
 }
 
+float3 ApplyPointShadowedLight(
+    float3    diffuseColor,    // Diffuse albedo
+    float3    specularColor,    // Specular albedo
+    float    specularMask,    // Where is it shiny or dingy?
+    float    gloss,            // Specular power
+    float3    normal,            // World-space normal
+    float3    viewDir,        // World-space vector from eye to point
+    float3    worldPos,        // World-space fragment position
+    float3    lightPos,        // World-space light position
+    float    lightRadiusSq,
+    float3    lightColor,        // Radiance of directional light
+    float4    shadowParams,
+    float4    shadowFaceOffsets[3]
+    )
+{
+    float shadow = GetShadowPointLight(worldPos - lightPos, shadowParams, shadowFaceOffsets);
+
+    return shadow * ApplyPointLight(
+        diffuseColor,
+        specularColor,
+        specularMask,
+        gloss,
+        normal,
+        viewDir,
+        worldPos,
+        lightPos,
+        lightRadiusSq,
+        lightColor
+        );
+}
+
 // options for F+ variants and optimizations
 #ifdef _WAVE_OP // SM 6.0 (new shader compiler)
 
-// choose one of these:
-//# define BIT_MASK
+// choose one of these, or define one when compiling to build another PSO variant:
+#if !defined(BIT_MASK) && !defined(BIT_MASK_SORTED) && !defined(SCALAR_LOOP) && !defined(SCALAR_BRANCH)
 # define BIT_MASK_SORTED
-//# define SCALAR_LOOP
-//# define SCALAR_BRANCH
+#endif
 
-// enable to amortize latency of vector read in exchange for additional VGPRs being held
-# define LIGHT_GRID_PRELOADING
+// enable to amortize latency of vector read in exchange for additional VGPRs being held.  Costs one VGPR
+// per mask word, which is too many since MAX_LIGHTS grew.
+//# define LIGHT_GRID_PRELOADING
 
-// configured for 32 sphere lights, 64 cone lights, and 32 cone shadowed lights
-# define POINT_LIGHT_GROUPS            1
-# define SPOT_LIGHT_GROUPS            2
-# define SHADOWED_SPOT_LIGHT_GROUPS    1
+// configured for equal numbers of sphere and cone lights followed by equal numbers of shadowed cone and
+// shadowed sphere lights, 32 lights per group
+# define POINT_LIGHT_GROUPS            ((MAX_LIGHTS - MAX_SHADOWED_LIGHTS) / 64)
+# define SPOT_LIGHT_GROUPS            ((MAX_LIGHTS - MAX_SHADOWED_LIGHTS) / 64)
+# define SHADOWED_SPOT_LIGHT_GROUPS    (MAX_SHADOWED_LIGHTS / 64)
+# define SHADOWED_POINT_LIGHT_GROUPS    (MAX_SHADOWED_LIGHTS / 64)
 # define POINT_LIGHT_GROUPS_TAIL            POINT_LIGHT_GROUPS
 # define SPOT_LIGHT_GROUPS_TAIL                POINT_LIGHT_GROUPS_TAIL + SPOT_LIGHT_GROUPS
 # define SHADOWED_SPOT_LIGHT_GROUPS_TAIL    SPOT_LIGHT_GROUPS_TAIL + SHADOWED_SPOT_LIGHT_GROUPS
+# define SHADOWED_POINT_LIGHT_GROUPS_TAIL    SHADOWED_SPOT_LIGHT_GROUPS_TAIL + SHADOWED_POINT_LIGHT_GROUPS
 
 
-uint GetGroupBits(uint groupIndex, uint tileIndex, uint lightBitMaskGroups[4])
+uint GetGroupBits(uint groupIndex, uint tileIndex, uint lightBitMaskGroups[LIGHT_MASK_WORDS])
 {
 #ifdef LIGHT_GRID_PRELOADING
     return lightBitMaskGroups[groupIndex];
 #else
-    return lightGridBitMask.Load(tileIndex * 16 + groupIndex * 4);
+    return lightGridBitMask.Load(tileIndex * TILE_MASK_SIZE + groupIndex * 4);
 #endif
 }
 
@@ -327,11 +388,37 @@ uint PullNextBit( inout uint bits )
     return bitIndex;
 }
 
+#ifdef BINDLESS_MATERIALS
+[RootSignature(ModelViewer_BindlessRootSig)]
+#else
 [RootSignature(ModelViewer_RootSig)]
+#endif
+
+// Texture streaming needs the resolution each material's textures are sampled at.  One pixel in each 8x8 tile
+// reports it as the log2 of texels per unit of UV, in 1/16 steps plus one so that 0 means unseen.  Anisotropic
+// filtering picks its mip from the shorter axis of the footprint, down to the sampler's maximum anisotropy of 8.
+void WriteMipFeedback( float2 uvDX, float2 uvDY )
+{
+    float lenSqX = dot(uvDX, uvDX);
+    float lenSqY = dot(uvDY, uvDY);
+    float footprintSq = max(min(lenSqX, lenSqY), max(lenSqX, lenSqY) / 64.0);
+    float log2Resolution = -0.5 * log2(max(footprintSq, 1e-20));
+    mipFeedback.InterlockedMax(MaterialIndex * 4, (uint)(clamp(log2Resolution, 0.0, 15.0) * 16.0) + 1);
+}
+
+// Without this, the feedback writes would move the depth test after shading
+[earlydepthstencil]
 float3 main(VSOutput vsOutput) : SV_Target0
 {
     uint2 pixelPos = vsOutput.position.xy;
-    float3 diffuseAlbedo = texDiffuse.Sample(sampler0, vsOutput.uv);
+
+    // Derivatives are taken outside of the branch, where every lane of the quad is active
+    float2 uvDX = ddx(vsOutput.uv);
+    float2 uvDY = ddy(vsOutput.uv);
+    [branch]
+    if (MipFeedbackParams.x != 0 && all((pixelPos & 7) == MipFeedbackParams.yz))
+        WriteMipFeedback(uvDX, uvDY);
+    float3 diffuseAlbedo = MaterialTexture(texDiffuse, 0).Sample(sampler0, MaterialUV(vsOutput.uv));
     float3 colorSum = 0;
     {
         float ao = texSSAO[pixelPos];
@@ -341,31 +428,33 @@ float3 main(VSOutput vsOutput) : SV_Target0
     float gloss = 128.0;
     float3 normal;
     {
-        normal = texNormal.Sample(sampler0, vsOutput.uv) * 2.0 - 1.0;
+        normal = MaterialTexture(texNormal, 3).Sample(sampler0, MaterialUV(vsOutput.uv)) * 2.0 - 1.0;
         AntiAliasSpecular(normal, gloss);
         float3x3 tbn = float3x3(normalize(vsOutput.tangent), normalize(vsOutput.bitangent), normalize(vsOutput.normal));
         normal = normalize(mul(normal, tbn));
     }
 
     float3 specularAlbedo = float3( 0.56, 0.56, 0.56 );
-    float specularMask = texSpecular.Sample(sampler0, vsOutput.uv).g;
+    float specularMask = MaterialTexture(texSpecular, 1).Sample(sampler0, MaterialUV(vsOutput.uv)).g;
     float3 viewDir = normalize(vsOutput.viewDir);
-    colorSum += ApplyDirectionalLight( diffuseAlbedo, specularAlbedo, specularMask, gloss, normal, viewDir, SunDirection, SunColor, vsOutput.shadowCoord );
+    float viewDepth = dot(vsOutput.viewDir, CameraForward);
+    colorSum += ApplyDirectionalLight( diffuseAlbedo, specularAlbedo, specularMask, gloss, normal, viewDir, SunDirection, SunColor,
+        vsOutput.shadowCoord, vsOutput.worldPos, viewDepth, pixelPos );
 
     uint2 tilePos = GetTilePos(pixelPos, InvTileDim.xy);
     uint tileIndex = GetTileIndex(tilePos, TileCount.x);
     uint tileOffset = GetTileOffset(tileIndex);
 
     // Light Grid Preloading setup
-    uint lightBitMaskGroups[4] = { 0, 0, 0, 0 };
+    uint lightBitMaskGroups[LIGHT_MASK_WORDS];
+    for (uint word = 0; word < LIGHT_MASK_WORDS; word++)
+    {
 #if defined(LIGHT_GRID_PRELOADING)
-    uint4 lightBitMask = lightGridBitMask.Load4(tileIndex * 16);
-    
-    lightBitMaskGroups[0] = lightBitMask.x;
-    lightBitMaskGroups[1] = lightBitMask.y;
-    lightBitMaskGroups[2] = lightBitMask.z;
-    lightBitMaskGroups[3] = lightBitMask.w;
+        lightBitMaskGroups[word] = lightGridBitMask.Load(tileIndex * TILE_MASK_SIZE + word * 4);
+#else
+        lightBitMaskGroups[word] = 0;
 #endif
+    }
 
 #define POINT_LIGHT_ARGS \
     diffuseAlbedo, \
@@ -377,22 +466,105 @@ float3 main(VSOutput vsOutput) : SV_Target0
     vsOutput.worldPos, \
     lightData.pos, \
     lightData.radiusSq, \
-    lightData.color
+    GetLightColor(lightData)
 
 #define CONE_LIGHT_ARGS \
     POINT_LIGHT_ARGS, \
-    lightData.coneDir, \
-    lightData.coneAngles
+    GetLightConeDir(lightData), \
+    GetLightConeAngles(lightData)
 
+// The shadow data is only fetched for shadowed lights
 #define SHADOWED_LIGHT_ARGS \
     CONE_LIGHT_ARGS, \
-    lightData.shadowTextureMatrix, \
+    lightShadowBuffer[lightIndex - FIRST_SHADOWED_LIGHT].shadowTextureMatrix, \
     lightIndex
 
+#define SHADOWED_POINT_LIGHT_ARGS \
+    POINT_LIGHT_ARGS, \
+    lightShadowBuffer[lightIndex - FIRST_SHADOWED_LIGHT].pointShadowParams, \
+    lightShadowBuffer[lightIndex - FIRST_SHADOWED_LIGHT].pointShadowFaceOffsets
+
+    [branch]
+    if (ClusterParams.x != 0.0)
+    {
+        // The cluster lists are sorted by type like the tile lists, with counts in 16 bits
+        uint4 cluster = lightClusters.Load4(GetClusterOffset(tileIndex, GetClusterSlice(viewDepth, ClusterParams.y, ClusterParams.z)));
+        uint clusterLightCountSphere = cluster.y & 0xffff;
+        uint clusterLightCountCone = cluster.y >> 16;
+        uint clusterLightCountConeShadowed = cluster.z & 0xffff;
+        uint clusterLightCountPointShadowed = cluster.z >> 16;
+
+        uint clusterLightLoadOffset = cluster.x * 4;
+
+#ifdef _WAVE_OP
+        // Walk the lists of every lane in the wave together, one light at a time in index order.  The light is
+        // then the same across the wave, so its data is fetched once into scalar registers, and lanes whose
+        // list does not hold it idle for that iteration.
+        uint clusterLightLoadEnd = clusterLightLoadOffset + 4 *
+            (clusterLightCountSphere + clusterLightCountCone + clusterLightCountConeShadowed + clusterLightCountPointShadowed);
+        uint nextLightIndex = clusterLightLoadOffset < clusterLightLoadEnd ? lightClusterList.Load(clusterLightLoadOffset) : ~0u;
+
+        while (WaveActiveAnyTrue(nextLightIndex != ~0u))
+        {
+            uint lightIndex = WaveActiveMin(nextLightIndex);
+            if (nextLightIndex == lightIndex)
+            {
+                LightData lightData = lightBuffer[lightIndex];
+
+                if (lightIndex < FirstLightIndex.x) // sphere
+                    colorSum += ApplyPointLight(POINT_LIGHT_ARGS);
+                else if (lightIndex < FirstLightIndex.y) // cone
+                    colorSum += ApplyConeLight(CONE_LIGHT_ARGS);
+                else if (lightIndex < FirstLightIndex.z) // cone w/ shadow map
+                    colorSum += ApplyConeShadowedLight(SHADOWED_LIGHT_ARGS);
+                else // sphere w/ shadow map
+                    colorSum += ApplyPointShadowedLight(SHADOWED_POINT_LIGHT_ARGS);
+
+                clusterLightLoadOffset += 4;
+                nextLightIndex = clusterLightLoadOffset < clusterLightLoadEnd ? lightClusterList.Load(clusterLightLoadOffset) : ~0u;
+            }
+        }
+#else
+        // sphere
+        for (uint n = 0; n < clusterLightCountSphere; n++, clusterLightLoadOffset += 4)
+        {
+            uint lightIndex = lightClusterList.Load(clusterLightLoadOffset);
+            LightData lightData = lightBuffer[lightIndex];
+            colorSum += ApplyPointLight(POINT_LIGHT_ARGS);
+        }
+
+        // cone
+        for (uint n = 0; n < clusterLightCountCone; n++, clusterLightLoadOffset += 4)
+        {
+            uint lightIndex = lightClusterList.Load(clusterLightLoadOffset);
+            LightData lightData = lightBuffer[lightIndex];
+            colorSum += ApplyConeLight(CONE_LIGHT_ARGS);
+        }
+
+        // cone w/ shadow map
+        for (uint n = 0; n < clusterLightCountConeShadowed; n++, clusterLightLoadOffset += 4)
+        {
+            uint lightIndex = lightClusterList.Load(clusterLightLoadOffset);
+            LightData lightData = lightBuffer[lightIndex];
+            colorSum += ApplyConeShadowedLight(SHADOWED_LIGHT_ARGS);
+        }
+
+        // sphere w/ shadow map
+        for (uint n = 0; n < clusterLightCountPointShadowed; n++, clusterLightLoadOffset += 4)
+        {
+            uint lightIndex = lightClusterList.Load(clusterLightLoadOffset);
+            LightData lightData = lightBuffer[lightIndex];
+            colorSum += ApplyPointShadowedLight(SHADOWED_POINT_LIGHT_ARGS);
+        }
+#endif
+
+        return colorSum;
+    }
+
 #if defined(BIT_MASK)
     uint64_t threadMask = Ballot64(tileIndex != ~0); // attempt to get starting exec mask
 
-    for (uint groupIndex = 0; groupIndex < 4; groupIndex++)
+    for (uint groupIndex = 0; groupIndex < LIGHT_MASK_WORDS; groupIndex++)
     {
         // combine across threads
         uint groupBits = WaveActiveBitOr(GetGroupBits(groupIndex, tileIndex, lightBitMaskGroups));
@@ -412,10 +584,14 @@ float3 main(VSOutput vsOutput) : SV_Target0
             {
                 colorSum += ApplyConeLight(CONE_LIGHT_ARGS);
             }
-            else // cone w/ shadow map
+            else if (lightIndex < FirstLightIndex.z) // cone w/ shadow map
             {
                 colorSum += ApplyConeShadowedLight(SHADOWED_LIGHT_ARGS);
             }
+            else // sphere w/ shadow map
+            {
+                colorSum += ApplyPointShadowedLight(SHADOWED_POINT_LIGHT_ARGS);
+            }
         }
     }
 
@@ -425,9 +601,12 @@ float3 main(VSOutput vsOutput) : SV_Target0
     uint pointLightGroupTail        = POINT_LIGHT_GROUPS_TAIL;
     uint spotLightGroupTail            = SPOT_LIGHT_GROUPS_TAIL;
     uint spotShadowLightGroupTail    = SHADOWED_SPOT_LIGHT_GROUPS_TAIL;
+    uint pointShadowLightGroupTail    = SHADOWED_POINT_LIGHT_GROUPS_TAIL;
 
-    uint groupBitsMasks[4] = { 0, 0, 0, 0 };
-    for (int i = 0; i < 4; i++)
+    // The union of the wave's tile masks is uniform, so every light index below comes from scalar registers
+    // and each light's data is fetched once per wave.  Lights outside a lane's tile fall off to zero.
+    uint groupBitsMasks[LIGHT_MASK_WORDS];
+    for (int i = 0; i < LIGHT_MASK_WORDS; i++)
     {
         // combine across threads
         groupBitsMasks[i] = WaveActiveBitOr(GetGroupBits(i, tileIndex, lightBitMaskGroups));
@@ -478,6 +657,21 @@ float3 main(VSOutput vsOutput) : SV_Target0
         }
     }
 
+    for (uint groupIndex = spotShadowLightGroupTail; groupIndex < pointShadowLightGroupTail; groupIndex++)
+    {
+        uint groupBits = groupBitsMasks[groupIndex];
+
+        while (groupBits != 0)
+        {
+            uint bitIndex = PullNextBit(groupBits);
+            uint lightIndex = 32 * groupIndex + bitIndex;
+
+            // sphere w/ shadow map
+            LightData lightData = lightBuffer[lightIndex];
+            colorSum += ApplyPointShadowedLight(SHADOWED_POINT_LIGHT_ARGS);
+        }
+    }
+
 #elif defined(SCALAR_LOOP)
     uint64_t threadMask = Ballot64(tileOffset != ~0); // attempt to get starting exec mask
     uint64_t laneBit = 1ull << WaveGetLaneIndex();
@@ -491,36 +685,46 @@ float3 main(VSOutput vsOutput) : SV_Target0
 
         if (any((uniformMask & laneBit) != 0)) // is this thread one of the current set of uniform threads?
         {
-            uint tileLightCount = lightGrid.Load(uniformTileOffset + 0);
+            uint2 tileHeader = lightGrid.Load2(uniformTileOffset);
+            uint tileLightCount = tileHeader.y;
             uint tileLightCountSphere = (tileLightCount >> 0) & 0xff;
             uint tileLightCountCone = (tileLightCount >> 8) & 0xff;
             uint tileLightCountConeShadowed = (tileLightCount >> 16) & 0xff;
+            uint tileLightCountPointShadowed = (tileLightCount >> 24) & 0xff;
 
-            uint tileLightLoadOffset = uniformTileOffset + 4;
+            uint tileLightLoadOffset = tileHeader.x;
 
             // sphere
-            for (uint n = 0; n < tileLightCountSphere; n++, tileLightLoadOffset += 4)
+            for (uint n = 0; n < tileLightCountSphere; n++, tileLightLoadOffset += LIGHT_INDEX_SIZE)
             {
-                uint lightIndex = lightGrid.Load(tileLightLoadOffset);
+                uint lightIndex = LoadTileLightIndex(lightGrid, tileLightLoadOffset);
                 LightData lightData = lightBuffer[lightIndex];
                 colorSum += ApplyPointLight(POINT_LIGHT_ARGS);
             }
 
             // cone
-            for (uint n = 0; n < tileLightCountCone; n++, tileLightLoadOffset += 4)
+            for (uint n = 0; n < tileLightCountCone; n++, tileLightLoadOffset += LIGHT_INDEX_SIZE)
             {
-                uint lightIndex = lightGrid.Load(tileLightLoadOffset);
+                uint lightIndex = LoadTileLightIndex(lightGrid, tileLightLoadOffset);
                 LightData lightData = lightBuffer[lightIndex];
                 colorSum += ApplyConeLight(CONE_LIGHT_ARGS);
             }
 
             // cone w/ shadow map
-            for (uint n = 0; n < tileLightCountConeShadowed; n++, tileLightLoadOffset += 4)
+            for (uint n = 0; n < tileLightCountConeShadowed; n++, tileLightLoadOffset += LIGHT_INDEX_SIZE)
             {
-                uint lightIndex = lightGrid.Load(tileLightLoadOffset);
+                uint lightIndex = LoadTileLightIndex(lightGrid, tileLightLoadOffset);
                 LightData lightData = lightBuffer[lightIndex];
                 colorSum += ApplyConeShadowedLight(SHADOWED_LIGHT_ARGS);
             }
+
+            // sphere w/ shadow map
+            for (uint n = 0; n < tileLightCountPointShadowed; n++, tileLightLoadOffset += LIGHT_INDEX_SIZE)
+            {
+                uint lightIndex = LoadTileLightIndex(lightGrid, tileLightLoadOffset);
+                LightData lightData = lightBuffer[lightIndex];
+                colorSum += ApplyPointShadowedLight(SHADOWED_POINT_LIGHT_ARGS);
+            }
         }
 
         // strip the current set of uniform threads from the exec mask for the next loop iteration
@@ -534,104 +738,134 @@ float3 main(VSOutput vsOutput) : SV_Target0
         // uniform branch
         tileOffset = WaveReadLaneFirst(tileOffset);
 
-        uint tileLightCount = lightGrid.Load(tileOffset + 0);
+        uint2 tileHeader = lightGrid.Load2(tileOffset);
+        uint tileLightCount = tileHeader.y;
         uint tileLightCountSphere = (tileLightCount >> 0) & 0xff;
         uint tileLightCountCone = (tileLightCount >> 8) & 0xff;
         uint tileLightCountConeShadowed = (tileLightCount >> 16) & 0xff;
+        uint tileLightCountPointShadowed = (tileLightCount >> 24) & 0xff;
 
-        uint tileLightLoadOffset = tileOffset + 4;
+        uint tileLightLoadOffset = tileHeader.x;
 
         // sphere
-        for (uint n = 0; n < tileLightCountSphere; n++, tileLightLoadOffset += 4)
+        for (uint n = 0; n < tileLightCountSphere; n++, tileLightLoadOffset += LIGHT_INDEX_SIZE)
         {
-            uint lightIndex = lightGrid.Load(tileLightLoadOffset);
+            uint lightIndex = LoadTileLightIndex(lightGrid, tileLightLoadOffset);
             LightData lightData = lightBuffer[lightIndex];
             colorSum += ApplyPointLight(POINT_LIGHT_ARGS);
         }
 
         // cone
-        for (uint n = 0; n < tileLightCountCone; n++, tileLightLoadOffset += 4)
+        for (uint n = 0; n < tileLightCountCone; n++, tileLightLoadOffset += LIGHT_INDEX_SIZE)
         {
-            uint lightIndex = lightGrid.Load(tileLightLoadOffset);
+            uint lightIndex = LoadTileLightIndex(lightGrid, tileLightLoadOffset);
             LightData lightData = lightBuffer[lightIndex];
             colorSum += ApplyConeLight(CONE_LIGHT_ARGS);
         }
 
         // cone w/ shadow map
-        for (uint n = 0; n < tileLightCountConeShadowed; n++, tileLightLoadOffset += 4)
+        for (uint n = 0; n < tileLightCountConeShadowed; n++, tileLightLoadOffset += LIGHT_INDEX_SIZE)
         {
-            uint lightIndex = lightGrid.Load(tileLightLoadOffset);
+            uint lightIndex = LoadTileLightIndex(lightGrid, tileLightLoadOffset);
             LightData lightData = lightBuffer[lightIndex];
             colorSum += ApplyConeShadowedLight(SHADOWED_LIGHT_ARGS);
         }
+
+        // sphere w/ shadow map
+        for (uint n = 0; n < tileLightCountPointShadowed; n++, tileLightLoadOffset += LIGHT_INDEX_SIZE)
+        {
+            uint lightIndex = LoadTileLightIndex(lightGrid, tileLightLoadOffset);
+            LightData lightData = lightBuffer[lightIndex];
+            colorSum += ApplyPointShadowedLight(SHADOWED_POINT_LIGHT_ARGS);
+        }
     }
     else
     {
         // divergent branch
-        uint tileLightCount = lightGrid.Load(tileOffset + 0);
+        uint2 tileHeader = lightGrid.Load2(tileOffset);
+        uint tileLightCount = tileHeader.y;
         uint tileLightCountSphere = (tileLightCount >> 0) & 0xff;
         uint tileLightCountCone = (tileLightCount >> 8) & 0xff;
         uint tileLightCountConeShadowed = (tileLightCount >> 16) & 0xff;
+        uint tileLightCountPointShadowed = (tileLightCount >> 24) & 0xff;
 
-        uint tileLightLoadOffset = tileOffset + 4;
+        uint tileLightLoadOffset = tileHeader.x;
 
         // sphere
-        for (uint n = 0; n < tileLightCountSphere; n++, tileLightLoadOffset += 4)
+        for (uint n = 0; n < tileLightCountSphere; n++, tileLightLoadOffset += LIGHT_INDEX_SIZE)
         {
-            uint lightIndex = lightGrid.Load(tileLightLoadOffset);
+            uint lightIndex = LoadTileLightIndex(lightGrid, tileLightLoadOffset);
             LightData lightData = lightBuffer[lightIndex];
             colorSum += ApplyPointLight(POINT_LIGHT_ARGS);
         }
 
         // cone
-        for (uint n = 0; n < tileLightCountCone; n++, tileLightLoadOffset += 4)
+        for (uint n = 0; n < tileLightCountCone; n++, tileLightLoadOffset += LIGHT_INDEX_SIZE)
         {
-            uint lightIndex = lightGrid.Load(tileLightLoadOffset);
+            uint lightIndex = LoadTileLightIndex(lightGrid, tileLightLoadOffset);
             LightData lightData = lightBuffer[lightIndex];
             colorSum += ApplyConeLight(CONE_LIGHT_ARGS);
         }
 
         // cone w/ shadow map
-        for (uint n = 0; n < tileLightCountConeShadowed; n++, tileLightLoadOffset += 4)
+        for (uint n = 0; n < tileLightCountConeShadowed; n++, tileLightLoadOffset += LIGHT_INDEX_SIZE)
         {
-            uint lightIndex = lightGrid.Load(tileLightLoadOffset);
+            uint lightIndex = LoadTileLightIndex(lightGrid, tileLightLoadOffset);
             LightData lightData = lightBuffer[lightIndex];
             colorSum += ApplyConeShadowedLight(SHADOWED_LIGHT_ARGS);
         }
+
+        // sphere w/ shadow map
+        for (uint n = 0; n < tileLightCountPointShadowed; n++, tileLightLoadOffset += LIGHT_INDEX_SIZE)
+        {
+            uint lightIndex = LoadTileLightIndex(lightGrid, tileLightLoadOffset);
+            LightData lightData = lightBuffer[lightIndex];
+            colorSum += ApplyPointShadowedLight(SHADOWED_POINT_LIGHT_ARGS);
+        }
     }
 
 #else // SM 5.0 (no wave intrinsics)
 
-    uint tileLightCount = lightGrid.Load(tileOffset + 0);
+    uint2 tileHeader = lightGrid.Load2(tileOffset);
+    uint tileLightCount = tileHeader.y;
     uint tileLightCountSphere = (tileLightCount >> 0) & 0xff;
     uint tileLightCountCone = (tileLightCount >> 8) & 0xff;
     uint tileLightCountConeShadowed = (tileLightCount >> 16) & 0xff;
+    uint tileLightCountPointShadowed = (tileLightCount >> 24) & 0xff;
 
-    uint tileLightLoadOffset = tileOffset + 4;
+    uint tileLightLoadOffset = tileHeader.x;
 
     // sphere
-    for (uint n = 0; n < tileLightCountSphere; n++, tileLightLoadOffset += 4)
+    for (uint n = 0; n < tileLightCountSphere; n++, tileLightLoadOffset += LIGHT_INDEX_SIZE)
     {
-        uint lightIndex = lightGrid.Load(tileLightLoadOffset);
+        uint lightIndex = LoadTileLightIndex(lightGrid, tileLightLoadOffset);
         LightData lightData = lightBuffer[lightIndex];
         colorSum += ApplyPointLight(POINT_LIGHT_ARGS);
     }
 
     // cone
-    for (uint n = 0; n < tileLightCountCone; n++, tileLightLoadOffset += 4)
+    for (uint n = 0; n < tileLightCountCone; n++, tileLightLoadOffset += LIGHT_INDEX_SIZE)
     {
-        uint lightIndex = lightGrid.Load(tileLightLoadOffset);
+        uint lightIndex = LoadTileLightIndex(lightGrid, tileLightLoadOffset);
         LightData lightData = lightBuffer[lightIndex];
         colorSum += ApplyConeLight(CONE_LIGHT_ARGS);
     }
 
     // cone w/ shadow map
-    for (uint n = 0; n < tileLightCountConeShadowed; n++, tileLightLoadOffset += 4)
+    for (uint n = 0; n < tileLightCountConeShadowed; n++, tileLightLoadOffset += LIGHT_INDEX_SIZE)
     {
-        uint lightIndex = lightGrid.Load(tileLightLoadOffset);
+        uint lightIndex = LoadTileLightIndex(lightGrid, tileLightLoadOffset);
         LightData lightData = lightBuffer[lightIndex];
         colorSum += ApplyConeShadowedLight(SHADOWED_LIGHT_ARGS);
     }
+
+    // sphere w/ shadow map
+    for (uint n = 0; n < tileLightCountPointShadowed; n++, tileLightLoadOffset += LIGHT_INDEX_SIZE)
+    {
+        uint lightIndex = LoadTileLightIndex(lightGrid, tileLightLoadOffset);
+        LightData lightData = lightBuffer[lightIndex];
+        colorSum += ApplyPointShadowedLight(SHADOWED_POINT_LIGHT_ARGS);
+    }
 #endif
 
     return colorSum;
@@ -11,17 +11,58 @@
 // Author:  James Stanard 
 //
 
-#define ModelViewer_RootSig \
+#define ModelViewer_RootParams \
     "RootFlags(ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT), " \
     "CBV(b0, visibility = SHADER_VISIBILITY_VERTEX), " \
     "CBV(b0, visibility = SHADER_VISIBILITY_PIXEL), " \
     "DescriptorTable(SRV(t0, numDescriptors = 6), visibility = SHADER_VISIBILITY_PIXEL)," \
-    "DescriptorTable(SRV(t64, numDescriptors = 6), visibility = SHADER_VISIBILITY_PIXEL)," \
-    "RootConstants(b1, num32BitConstants = 2, visibility = SHADER_VISIBILITY_VERTEX), " \
+    "DescriptorTable(SRV(t64, numDescriptors = 16), visibility = SHADER_VISIBILITY_PIXEL)," \
+    "RootConstants(b1, num32BitConstants = 3), " \
+    "RootConstants(b2, num32BitConstants = 7, visibility = SHADER_VISIBILITY_VERTEX), " \
+    "UAV(u0, visibility = SHADER_VISIBILITY_PIXEL), "
+
+#define ModelViewer_StaticSamplers \
     "StaticSampler(s0, maxAnisotropy = 8, visibility = SHADER_VISIBILITY_PIXEL)," \
     "StaticSampler(s1, visibility = SHADER_VISIBILITY_PIXEL," \
         "addressU = TEXTURE_ADDRESS_CLAMP," \
         "addressV = TEXTURE_ADDRESS_CLAMP," \
         "addressW = TEXTURE_ADDRESS_CLAMP," \
         "comparisonFunc = COMPARISON_GREATER_EQUAL," \
+        "filter = FILTER_MIN_MAG_LINEAR_MIP_POINT)," \
+    "StaticSampler(s2, maxAnisotropy = 8, visibility = SHADER_VISIBILITY_PIXEL," \
+        "addressU = TEXTURE_ADDRESS_CLAMP," \
+        "addressV = TEXTURE_ADDRESS_CLAMP," \
+        "addressW = TEXTURE_ADDRESS_CLAMP)," \
+    "StaticSampler(s3, visibility = SHADER_VISIBILITY_PIXEL," \
+        "addressU = TEXTURE_ADDRESS_WRAP," \
+        "addressV = TEXTURE_ADDRESS_WRAP," \
+        "addressW = TEXTURE_ADDRESS_CLAMP," \
+        "comparisonFunc = COMPARISON_GREATER_EQUAL," \
         "filter = FILTER_MIN_MAG_LINEAR_MIP_POINT)"
+
+#define ModelViewer_RootSig ModelViewer_RootParams ModelViewer_StaticSamplers
+
+// The bindless shaders index the textures of every material, six each, out of the persistent region of the
+// descriptor heap by the material index of the draw constants
+#define ModelViewer_BindlessRootSig ModelViewer_RootParams \
+    "DescriptorTable(SRV(t0, space = 1, numDescriptors = 2048), visibility = SHADER_VISIBILITY_PIXEL)," \
+    ModelViewer_StaticSamplers
+
+// Shaders other than the bindless ones that need the material index define DRAW_CONSTANTS
+#if defined(BINDLESS_MATERIALS) || defined(DRAW_CONSTANTS)
+cbuffer DrawConstants : register(b1)
+{
+    uint BaseVertex;
+    uint MaterialIndex;
+    uint ViewMask;
+};
+#endif
+
+#ifdef BINDLESS_MATERIALS
+#define MaterialTexture(tex, slot) g_MaterialTextures[MaterialIndex * 6 + slot]
+#else
+#define MaterialTexture(tex, slot) tex
+#endif
+
+// Material textures are viewed as one slice of a texture array, which the view itself selects
+#define MaterialUV(uv) float3(uv, 0)
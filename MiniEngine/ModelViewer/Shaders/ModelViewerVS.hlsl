@@ -13,13 +13,20 @@
 //
 
 #include "ModelViewerRS.hlsli"
+#include "VertexDecode.hlsli"
+#include "SceneInstances.hlsli"
 
+// MULTI_VIEW draws a view per instance, see MultiView.hlsli
+#ifdef MULTI_VIEW
+#include "MultiView.hlsli"
+#else
 cbuffer VSConstants : register(b0)
 {
     float4x4 modelToProjection;
     float4x4 modelToShadow;
     float3 ViewerPos;
 };
+#endif
 
 struct VSInput
 {
@@ -40,22 +47,35 @@ struct VSOutput
     float3 normal : Normal;
     float3 tangent : Tangent;
     float3 bitangent : Bitangent;
+#ifdef MULTI_VIEW
+    uint viewport : SV_ViewportArrayIndex;
+#endif
 };
 
 [RootSignature(ModelViewer_RootSig)]
-VSOutput main(VSInput vsInput)
+VSOutput main(VSInput vsInput, InstanceTransform instance, uint instanceID : SV_InstanceID)
 {
+#ifdef MULTI_VIEW
+    float4x4 modelToProjection = Views[instanceID].ViewProj;
+    float3 ViewerPos = Views[instanceID].ViewerPos;
+#endif
+
     VSOutput vsOutput;
 
-    vsOutput.position = mul(modelToProjection, float4(vsInput.position, 1.0));
-    vsOutput.worldPos = vsInput.position;
+    float3 position = InstancePosition(instance, DecodePosition(vsInput.position));
+
+    vsOutput.position = mul(modelToProjection, float4(position, 1.0));
+    vsOutput.worldPos = position;
     vsOutput.texCoord = vsInput.texcoord0;
-    vsOutput.viewDir = vsInput.position - ViewerPos;
-    vsOutput.shadowCoord = mul(modelToShadow, float4(vsInput.position, 1.0)).xyz;
+    vsOutput.viewDir = position - ViewerPos;
+    vsOutput.shadowCoord = mul(modelToShadow, float4(position, 1.0)).xyz;
 
-    vsOutput.normal = vsInput.normal;
-    vsOutput.tangent = vsInput.tangent;
-    vsOutput.bitangent = vsInput.bitangent;
+    vsOutput.normal = InstanceDirection(instance, DecodeNormal(vsInput.normal));
+    vsOutput.tangent = InstanceDirection(instance, DecodeNormal(vsInput.tangent));
+    vsOutput.bitangent = InstanceDirection(instance, DecodeNormal(vsInput.bitangent));
+#ifdef MULTI_VIEW
+    vsOutput.viewport = instanceID;
+#endif
 
     return vsOutput;
 }
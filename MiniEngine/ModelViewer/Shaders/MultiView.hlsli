@@ -0,0 +1,25 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// The camera passes of a multi-view frame draw every mesh with an instance per eye.  The instance picks the
+// eye's matrix and the viewport of its half of the target.  Keep in sync with MultiView.cpp.
+//
+
+#define MAX_VIEWS 2
+
+struct ViewData
+{
+    float4x4 ViewProj;
+    float3 ViewerPos;
+};
+
+cbuffer MultiViewConstants : register(b0)
+{
+    float4x4 modelToShadow;
+    ViewData Views[MAX_VIEWS];
+};
@@ -0,0 +1,55 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+// Shadowed point lights render up to six faces into tiles of the light shadow atlas.  Cube maps use
+// all six faces and dual paraboloid maps use only the first two.  Keep in sync with C++.
+
+#define POINT_SHADOW_FACES 6
+
+// Rotates a light-relative position into the view space of a face, which looks down -Z.
+// Faces are ordered +Y, -Y, +X, -X, +Z, -Z.
+float3 GetPointShadowFaceView( float3 lightToPoint, uint face )
+{
+    float3 d = lightToPoint;
+    switch (face)
+    {
+    case 0:  return float3(-d.x, -d.z, -d.y);
+    case 1:  return float3(-d.x,  d.z,  d.y);
+    case 2:  return float3( d.z,  d.y, -d.x);
+    case 3:  return float3(-d.z,  d.y,  d.x);
+    case 4:  return float3(-d.x,  d.y, -d.z);
+    default: return d;
+    }
+}
+
+// The face whose map holds a light-relative position
+uint GetPointShadowFace( float3 lightToPoint, bool paraboloid )
+{
+    float3 a = abs(lightToPoint);
+    if (paraboloid || (a.y >= a.x && a.y >= a.z))
+        return lightToPoint.y >= 0.0 ? 0 : 1;
+    else if (a.x >= a.z)
+        return lightToPoint.x >= 0.0 ? 2 : 3;
+    else
+        return lightToPoint.z >= 0.0 ? 4 : 5;
+}
+
+// Projects a face view space position to xy in [-1, 1] and reversed depth in z.
+// params: x, y = depth terms (Q1 and Q2 of the 90 degree perspective projection, or far / (far - near)
+// and 1 / (far - near) for linear paraboloid depth), w = dual paraboloid
+float3 ProjectPointShadowFace( float3 viewPos, float4 params )
+{
+    float forward = -viewPos.z;
+    if (params.w != 0.0)
+    {
+        float dist = length(viewPos);
+        return float3(viewPos.xy / (dist + forward), params.x - dist * params.y);
+    }
+    return float3(viewPos.xy / forward, params.y / forward - params.x);
+}
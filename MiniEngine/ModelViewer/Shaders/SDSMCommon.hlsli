@@ -0,0 +1,87 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+// Shared state for the sample distribution shadow map passes, which fit the sun cascades to the
+// depth buffer without ever reading the results back to the CPU.
+
+#include "ShadowCascades.hlsli"
+
+#define SDSM_RootSig \
+    "RootFlags(0), " \
+    "CBV(b0), " \
+    "DescriptorTable(SRV(t0, numDescriptors = 1))," \
+    "DescriptorTable(UAV(u0, numDescriptors = 2))"
+
+cbuffer CSConstants : register(b0)
+{
+    float4x4 InvViewProj;
+    float3 CameraPos;
+    uint NumCascades;
+    float3 CameraForward;
+    float SplitLambda;
+    float3 LightRight;
+    float ShadowDepth;
+    float3 LightUp;
+    float BufferSize;
+    float3 LightDirection;
+    float NearClip;
+    uint2 ViewportSize;
+    float ShadowDistance;
+};
+
+Texture2D<float> DepthBuffer : register(t0);
+RWByteAddressBuffer Reduction : register(u0);
+RWStructuredBuffer<CascadeData> Cascades : register(u1);
+
+// Layout of the reduction buffer:  the view depth range of all visible samples followed by the
+// light space bounds of the samples in each cascade.  Unused slots rest at (min = ~0, max = 0).
+#define DEPTH_RANGE_OFFSET  0
+#define BOUNDS_OFFSET(c)    (32 + (c) * 32)
+
+// Maps a float to a uint with the same ordering so that signed values can be reduced with atomics
+uint OrderedFloatToUint( float f )
+{
+    uint u = asuint(f);
+    return (u & 0x80000000) ? ~u : (u | 0x80000000);
+}
+
+float OrderedUintToFloat( uint u )
+{
+    return asfloat((u & 0x80000000) ? (u & 0x7FFFFFFF) : ~u);
+}
+
+// Visible depth range clamped to the shadow distance.  Falls back to the whole range when nothing
+// was visible.
+void GetDepthRange( out float minDepth, out float maxDepth )
+{
+    uint2 range = Reduction.Load2(DEPTH_RANGE_OFFSET);
+    if (range.x > range.y)
+        range = uint2(asuint(NearClip), asuint(ShadowDistance));
+
+    minDepth = clamp(asfloat(range.x), NearClip, ShadowDistance);
+    maxDepth = clamp(asfloat(range.y), minDepth + 1.0, ShadowDistance);
+}
+
+// Practical split scheme applied to the range of depths actually present in the frame
+float GetSplitDistance( uint cascade, float minDepth, float maxDepth )
+{
+    float t = float(cascade + 1) / float(NumCascades);
+    float logSplit = minDepth * pow(maxDepth / minDepth, t);
+    float uniformSplit = minDepth + (maxDepth - minDepth) * t;
+    return lerp(uniformSplit, logSplit, SplitLambda);
+}
+
+// Returns false for pixels that were not covered by geometry
+bool GetWorldPosition( uint2 pixel, float depth, out float3 worldPos )
+{
+    float2 ndc = (pixel + 0.5) / ViewportSize * float2(2.0, -2.0) + float2(-1.0, 1.0);
+    float4 pos = mul(InvViewProj, float4(ndc, depth, 1.0));
+    worldPos = pos.xyz / pos.w;
+    return depth > 0.0;
+}
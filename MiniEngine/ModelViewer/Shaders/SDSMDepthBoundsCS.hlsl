@@ -0,0 +1,43 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+// Reduces the depth buffer to the range of view depths that need shadows this frame.
+
+#include "SDSMCommon.hlsli"
+
+groupshared uint gs_MinDepth;
+groupshared uint gs_MaxDepth;
+
+[RootSignature(SDSM_RootSig)]
+[numthreads( 16, 16, 1 )]
+void main( uint3 DTid : SV_DispatchThreadID, uint GI : SV_GroupIndex )
+{
+    if (GI == 0)
+    {
+        gs_MinDepth = 0xFFFFFFFF;
+        gs_MaxDepth = 0;
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    float3 worldPos;
+    if (all(DTid.xy < ViewportSize) && GetWorldPosition(DTid.xy, DepthBuffer[DTid.xy], worldPos))
+    {
+        // View depth is always positive, so its bits sort the same as its value
+        uint viewDepth = asuint(dot(worldPos - CameraPos, CameraForward));
+        InterlockedMin(gs_MinDepth, viewDepth);
+        InterlockedMax(gs_MaxDepth, viewDepth);
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    if (GI == 0 && gs_MinDepth <= gs_MaxDepth)
+    {
+        Reduction.InterlockedMin(DEPTH_RANGE_OFFSET, gs_MinDepth);
+        Reduction.InterlockedMax(DEPTH_RANGE_OFFSET + 4, gs_MaxDepth);
+    }
+}
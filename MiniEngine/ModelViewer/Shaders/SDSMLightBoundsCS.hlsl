@@ -0,0 +1,71 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+// Assigns each visible sample to a cascade and accumulates the light space bounds of every cascade.
+
+#include "SDSMCommon.hlsli"
+
+groupshared uint gs_BoundsMin[MAX_CASCADES * 3];
+groupshared uint gs_BoundsMax[MAX_CASCADES * 3];
+
+[RootSignature(SDSM_RootSig)]
+[numthreads( 16, 16, 1 )]
+void main( uint3 DTid : SV_DispatchThreadID, uint GI : SV_GroupIndex )
+{
+    if (GI < MAX_CASCADES * 3)
+    {
+        gs_BoundsMin[GI] = 0xFFFFFFFF;
+        gs_BoundsMax[GI] = 0;
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    float3 worldPos;
+    if (all(DTid.xy < ViewportSize) && GetWorldPosition(DTid.xy, DepthBuffer[DTid.xy], worldPos))
+    {
+        float minDepth, maxDepth;
+        GetDepthRange(minDepth, maxDepth);
+
+        float viewDepth = dot(worldPos - CameraPos, CameraForward);
+
+        uint cascade = NumCascades;
+        for (uint i = 0; i < NumCascades; ++i)
+        {
+            if (viewDepth <= GetSplitDistance(i, minDepth, maxDepth))
+            {
+                cascade = i;
+                break;
+            }
+        }
+
+        if (cascade < NumCascades)
+        {
+            uint3 lightPos = uint3(
+                OrderedFloatToUint(dot(worldPos, LightRight)),
+                OrderedFloatToUint(dot(worldPos, LightUp)),
+                OrderedFloatToUint(dot(worldPos, LightDirection)));
+
+            InterlockedMin(gs_BoundsMin[cascade * 3 + 0], lightPos.x);
+            InterlockedMin(gs_BoundsMin[cascade * 3 + 1], lightPos.y);
+            InterlockedMin(gs_BoundsMin[cascade * 3 + 2], lightPos.z);
+            InterlockedMax(gs_BoundsMax[cascade * 3 + 0], lightPos.x);
+            InterlockedMax(gs_BoundsMax[cascade * 3 + 1], lightPos.y);
+            InterlockedMax(gs_BoundsMax[cascade * 3 + 2], lightPos.z);
+        }
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    // One thread per cascade axis merges the group's bounds into the global bounds
+    if (GI < NumCascades * 3 && gs_BoundsMin[GI] <= gs_BoundsMax[GI])
+    {
+        uint cascade = GI / 3;
+        uint axis = GI % 3;
+        Reduction.InterlockedMin(BOUNDS_OFFSET(cascade) + axis * 4, gs_BoundsMin[GI]);
+        Reduction.InterlockedMax(BOUNDS_OFFSET(cascade) + 16 + axis * 4, gs_BoundsMax[GI]);
+    }
+}
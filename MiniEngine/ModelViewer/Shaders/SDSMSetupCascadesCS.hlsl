@@ -0,0 +1,83 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+// Builds a tight orthographic projection around the samples of each cascade and resets the
+// reduction buffer for the next frame.
+
+#include "SDSMCommon.hlsli"
+
+[RootSignature(SDSM_RootSig)]
+[numthreads( MAX_CASCADES, 1, 1 )]
+void main( uint GI : SV_GroupIndex )
+{
+    float minDepth, maxDepth;
+    GetDepthRange(minDepth, maxDepth);
+
+    uint3 minBits = Reduction.Load3(BOUNDS_OFFSET(GI));
+    uint3 maxBits = Reduction.Load3(BOUNDS_OFFSET(GI) + 16);
+
+    // Everything has been read, so the reduction buffer can be reset
+    GroupMemoryBarrierWithGroupSync();
+
+    Reduction.Store4(BOUNDS_OFFSET(GI), uint4(0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0));
+    Reduction.Store4(BOUNDS_OFFSET(GI) + 16, uint4(0, 0, 0, 0));
+    if (GI == 0)
+        Reduction.Store2(DEPTH_RANGE_OFFSET, uint2(0xFFFFFFFF, 0));
+
+    if (GI >= NumCascades)
+        return;
+
+    float3 boundsMin, boundsMax;
+    if (all(minBits <= maxBits))
+    {
+        boundsMin = float3(OrderedUintToFloat(minBits.x), OrderedUintToFloat(minBits.y), OrderedUintToFloat(minBits.z));
+        boundsMax = float3(OrderedUintToFloat(maxBits.x), OrderedUintToFloat(maxBits.y), OrderedUintToFloat(maxBits.z));
+    }
+    else
+    {
+        // No samples fell in this cascade.  Any valid projection will do because nothing reads it.
+        boundsMin = float3(-1.0, -1.0, -1.0);
+        boundsMax = float3(1.0, 1.0, 1.0);
+    }
+
+    // Leave room for the filter kernel and the scissored border texels
+    float2 extent = max(boundsMax.xy - boundsMin.xy, 1.0);
+    float2 border = extent * 4.0 / BufferSize;
+    boundsMin.xy -= border;
+    boundsMax.xy += border;
+
+    // Keep the cascade center on a texel boundary to reduce crawling when the bounds are stable
+    float2 texelSize = (boundsMax.xy - boundsMin.xy) / BufferSize;
+    float2 center = floor((boundsMin.xy + boundsMax.xy) * 0.5 / texelSize) * texelSize;
+    float2 scale = 2.0 / (boundsMax.xy - boundsMin.xy);
+
+    // Extend toward the light so that casters outside of the view are still captured.  Depth is
+    // reversed, so 1 is the end nearest to the light.
+    float nearZ = boundsMin.z - ShadowDepth;
+    float farZ = boundsMax.z;
+    float scaleZ = 1.0 / (farZ - nearZ);
+
+    float4x4 viewProj = float4x4(
+        float4(LightRight * scale.x, -center.x * scale.x),
+        float4(LightUp * scale.y, -center.y * scale.y),
+        float4(-LightDirection * scaleZ, farZ * scaleZ),
+        float4(0.0, 0.0, 0.0, 1.0));
+
+    const float4x4 toTexture = float4x4(
+        0.5, 0.0, 0.0, 0.5,
+        0.0, -0.5, 0.0, 0.5,
+        0.0, 0.0, 1.0, 0.0,
+        0.0, 0.0, 0.0, 1.0);
+
+    Cascades[GI].ViewProj = viewProj;
+    Cascades[GI].ShadowMatrix = mul(toTexture, viewProj);
+    Cascades[GI].SplitDistance = GetSplitDistance(GI, minDepth, maxDepth);
+    Cascades[GI].WrapOffset = 0.0;
+    Cascades[GI].Scrolling = 0.0;
+}
@@ -0,0 +1,34 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// The world transform of an instance, read from the per-instance vertex stream as the rows of a 3x4 matrix.
+// Draws without instances bind a single identity transform.  Transforms are rigid, so directions need no
+// renormalizing.  See SceneInstances.h.
+//
+
+struct InstanceTransform
+{
+    float4 World0 : INSTANCE_WORLD0;
+    float4 World1 : INSTANCE_WORLD1;
+    float4 World2 : INSTANCE_WORLD2;
+};
+
+// The depth pre-pass and the color pass test for equal depth, so every shader must place a vertex identically
+float3 InstancePosition( InstanceTransform instance, float3 position )
+{
+    precise float3 world = float3(
+        dot(instance.World0, float4(position, 1.0)),
+        dot(instance.World1, float4(position, 1.0)),
+        dot(instance.World2, float4(position, 1.0)));
+    return world;
+}
+
+float3 InstanceDirection( InstanceTransform instance, float3 direction )
+{
+    return float3(dot(instance.World0.xyz, direction), dot(instance.World1.xyz, direction), dot(instance.World2.xyz, direction));
+}
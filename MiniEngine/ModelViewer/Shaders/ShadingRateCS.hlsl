@@ -0,0 +1,97 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+// Chooses the shading rate of each tile of the color pass.  A tile shades coarsely along an axis when last
+// frame's luminance barely changes along it, and at 2x2 when it moved fast enough to be blurred or is dark
+// and fully in the sun's shadow.  Each thread takes 4x4 samples spread over its tile.
+
+#include "../../Core/Shaders/PixelPacking_Velocity.hlsli"
+
+#define ShadingRate_RootSig \
+    "RootFlags(0), " \
+    "CBV(b0), " \
+    "DescriptorTable(SRV(t0, numDescriptors = 3)), " \
+    "DescriptorTable(UAV(u0, numDescriptors = 1)), " \
+    "StaticSampler(s0," \
+        "addressU = TEXTURE_ADDRESS_CLAMP," \
+        "addressV = TEXTURE_ADDRESS_CLAMP," \
+        "addressW = TEXTURE_ADDRESS_CLAMP," \
+        "filter = FILTER_MIN_MAG_MIP_POINT)"
+
+// D3D12_SHADING_RATE, the log2 of the width above the log2 of the height
+static const uint kRate1x1 = 0x0;
+static const uint kRate1x2 = 0x1;
+static const uint kRate2x1 = 0x4;
+static const uint kRate2x2 = 0x5;
+
+Texture2D<float> texLuma : register(t0);
+Texture2D<packed_velocity_t> texVelocity : register(t1);
+Texture2D<float> texShadowMask : register(t2);
+RWTexture2D<uint> RateImage : register(u0);
+
+SamplerState PointSampler : register(s0);
+
+cbuffer CSConstants : register(b0)
+{
+    uint2 RateImageSize;
+    uint2 RenderMax;            // The last pixel of the render area
+    float2 LumaScale;           // Luminance pixels per render pixel
+    float2 RcpLumaSize;
+    uint TileSize;
+    float ContrastThreshold;    // Mean luminance step between neighbors below which an axis shades coarsely
+    float DarkLuminance;
+    float MotionThreshold;      // Pixels per frame
+    uint UseShadowMask;
+}
+
+[RootSignature(ShadingRate_RootSig)]
+[numthreads( 8, 8, 1 )]
+void main( uint3 DTid : SV_DispatchThreadID )
+{
+    if (any(DTid.xy >= RateImageSize))
+        return;
+
+    const uint Step = TileSize / 4;
+    const uint2 Origin = DTid.xy * TileSize + Step / 2;
+
+    float StepX = 0.0, StepY = 0.0, MaxLuma = 0.0, MaxShadow = 0.0, MinSpeed = 1e6;
+
+    [unroll]
+    for (uint y = 0; y < 4; ++y)
+    {
+        [unroll]
+        for (uint x = 0; x < 4; ++x)
+        {
+            const uint2 ST = min(Origin + uint2(x, y) * Step, RenderMax);
+
+            // The four luminance pixels around the sample, with w at the top left and z to its right
+            float4 L = texLuma.Gather(PointSampler, (ST + 0.5) * LumaScale * RcpLumaSize);
+            StepX += abs(L.z - L.w) + abs(L.y - L.x);
+            StepY += abs(L.x - L.w) + abs(L.y - L.z);
+            MaxLuma = max(MaxLuma, max(max(L.x, L.y), max(L.z, L.w)));
+
+            MaxShadow = max(MaxShadow, texShadowMask[ST]);
+            MinSpeed = min(MinSpeed, length(UnpackVelocity(texVelocity[ST]).xy));
+        }
+    }
+
+    StepX /= 32.0;
+    StepY /= 32.0;
+
+    const bool DarkShadow = UseShadowMask != 0 && MaxShadow == 0.0 && MaxLuma < DarkLuminance;
+    if (MinSpeed > MotionThreshold || DarkShadow)
+    {
+        RateImage[DTid.xy] = kRate2x2;
+        return;
+    }
+
+    const bool CoarseX = StepX < ContrastThreshold;
+    const bool CoarseY = StepY < ContrastThreshold;
+    RateImage[DTid.xy] = CoarseX ? (CoarseY ? kRate2x2 : kRate2x1) : (CoarseY ? kRate1x2 : kRate1x1);
+}
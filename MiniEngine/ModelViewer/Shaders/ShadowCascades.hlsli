@@ -0,0 +1,23 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+// keep in sync with CascadedShadowCamera::kMaxCascades
+#define MAX_CASCADES 8
+
+// keep in sync with CascadedShadows.cpp.  Each cascade is padded to 256 bytes so that it can be
+// bound directly as the vertex shader constant buffer when rendering that cascade.
+struct CascadeData
+{
+    float4x4 ViewProj;
+    float4x4 ShadowMatrix;
+    float SplitDistance;
+    float2 WrapOffset;      // Where the cascade's texture space starts in its toroidally addressed slice
+    float Scrolling;        // Nonzero when the slice is addressed toroidally
+    float4 Pad1[7];
+};
@@ -0,0 +1,216 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+// Culls the opaque shadow casters against a batch of shadow views and writes the survivors as
+// indirect draws.  Each view owns a slot of NumMeshes draws plus a draw count in DrawCounts, and the
+// triangles of its draws TriangleCountOffset bytes further on.  In
+// multi-view mode, all views share one slot and each visible mesh gets one instanced draw with an
+// instance per view that sees it.  All draws use the depth-only vertex stream.  Culls may be given
+// meshlets instead of meshes, which are also culled when all of their triangles face away from the
+// light.
+
+#define ShadowCull_RootSig \
+    "RootFlags(0), " \
+    "CBV(b0), " \
+    "SRV(t0), " \
+    "SRV(t1), " \
+    "SRV(t2), " \
+    "DescriptorTable(UAV(u0, numDescriptors = 2))"
+
+// must keep in sync with C++
+struct MeshInfo
+{
+    float3 BoundsMin;
+    uint IndexCount;
+    float3 BoundsMax;
+    uint StartIndex;
+    uint BaseVertex;            // In the depth-only vertex stream
+    uint MaterialIndex;
+    uint2 Pad;
+    float4 Sphere;      // xyz = center, w = radius
+    float4 Cone;        // xyz = axis, w = sine of the half angle (1 never faces away)
+};
+
+// Root constants for the depth vertex shaders followed by D3D12_DRAW_INDEXED_ARGUMENTS
+struct DrawCommand
+{
+    uint BaseVertex;
+    uint MaterialIndex;
+    uint ViewMask;
+    uint IndexCountPerInstance;
+    uint InstanceCount;
+    uint StartIndexLocation;
+    int BaseVertexLocation;
+    uint StartInstanceLocation;
+};
+
+cbuffer CSConstants : register(b0)
+{
+    uint NumMeshes;               // Or meshlets
+    uint ViewStride;
+    uint FirstSlot;
+    uint NumViews;
+    uint MultiView;
+    uint SlotStride;              // Draws per slot
+    uint ConeTest;                // Reject meshlets facing away from LightOrigin
+    uint TriangleCountOffset;     // Bytes from the draw counts to the triangle counts
+    float4x4 ReceiverViewProj;    // Sun light space frame of the receiver grid
+    uint ReceiverGridSize;
+    uint ReceiverTest;            // Reject casters that shadow no visible receiver
+    float4 LightOrigin;           // Light position (w = 1) or unit direction of travel (w = 0)
+};
+
+StructuredBuffer<MeshInfo> Meshes : register(t0);
+ByteAddressBuffer Views : register(t1);
+ByteAddressBuffer ReceiverDepth : register(t2);
+RWStructuredBuffer<DrawCommand> DrawCommands : register(u0);
+RWByteAddressBuffer DrawCounts : register(u1);
+
+float4x4 LoadViewProj( uint view )
+{
+    // A Matrix4 is stored one column at a time
+    uint address = view * ViewStride;
+    return transpose(float4x4(
+        asfloat(Views.Load4(address)),
+        asfloat(Views.Load4(address + 16)),
+        asfloat(Views.Load4(address + 32)),
+        asfloat(Views.Load4(address + 48))));
+}
+
+// A box is outside the view when all eight corners are on the far side of the same clip plane
+bool IsOutsideView( float4x4 viewProj, float3 boundsMin, float3 boundsMax )
+{
+    uint outsideAll = 0x3F;
+
+    [unroll]
+    for (uint i = 0; i < 8; ++i)
+    {
+        float3 corner = float3(
+            i & 1 ? boundsMax.x : boundsMin.x,
+            i & 2 ? boundsMax.y : boundsMin.y,
+            i & 4 ? boundsMax.z : boundsMin.z);
+
+        float4 clip = mul(viewProj, float4(corner, 1.0));
+
+        uint outside = 0;
+        outside |= clip.x < -clip.w ? 0x01 : 0;
+        outside |= clip.x >  clip.w ? 0x02 : 0;
+        outside |= clip.y < -clip.w ? 0x04 : 0;
+        outside |= clip.y >  clip.w ? 0x08 : 0;
+        outside |= clip.z < 0.0     ? 0x10 : 0;
+        outside |= clip.z >  clip.w ? 0x20 : 0;
+        outsideAll &= outside;
+    }
+
+    return outsideAll != 0;
+}
+
+// The caster's shadow can only reach receivers in the grid cells under its light space bounds that are
+// farther from the light than its nearest point.  Large casters are always kept rather than walking
+// many cells.
+bool ShadowsAnyReceiver( float3 boundsMin, float3 boundsMax )
+{
+    float2 minUV = 1.0;
+    float2 maxUV = 0.0;
+    float casterZ = 0.0;
+
+    [unroll]
+    for (uint i = 0; i < 8; ++i)
+    {
+        float3 corner = float3(
+            i & 1 ? boundsMax.x : boundsMin.x,
+            i & 2 ? boundsMax.y : boundsMin.y,
+            i & 4 ? boundsMax.z : boundsMin.z);
+
+        float4 pos = mul(ReceiverViewProj, float4(corner, 1.0));
+        float2 uv = pos.xy / pos.w * float2(0.5, -0.5) + 0.5;
+        minUV = min(minUV, uv);
+        maxUV = max(maxUV, uv);
+        casterZ = max(casterZ, pos.z / pos.w);
+    }
+
+    uint2 minCell = (uint2)clamp(minUV * ReceiverGridSize, 0.0, ReceiverGridSize - 1.0);
+    uint2 maxCell = (uint2)clamp(maxUV * ReceiverGridSize, 0.0, ReceiverGridSize - 1.0);
+    uint2 size = maxCell - minCell + 1;
+    if (size.x * size.y > 256)
+        return true;
+
+    uint casterDepth = asuint(saturate(casterZ));
+    for (uint y = minCell.y; y <= maxCell.y; ++y)
+    {
+        for (uint x = minCell.x; x <= maxCell.x; ++x)
+        {
+            if (ReceiverDepth.Load((y * ReceiverGridSize + x) * 4) <= casterDepth)
+                return true;
+        }
+    }
+    return false;
+}
+
+// Shadow passes cull back faces, so a meshlet draws nothing when its whole normal cone points away from
+// the light.  With a point light, the sphere keeps the test conservative for every point of the meshlet.
+bool IsBackFacing( float4 sphere, float4 cone )
+{
+    if (LightOrigin.w == 0.0)
+        return dot(LightOrigin.xyz, cone.xyz) > cone.w;
+
+    float3 toMeshlet = sphere.xyz - LightOrigin.xyz;
+    return dot(toMeshlet, cone.xyz) > cone.w * length(toMeshlet) + sphere.w;
+}
+
+[RootSignature(ShadowCull_RootSig)]
+[numthreads( 64, 1, 1 )]
+void main( uint3 Gid : SV_GroupID, uint3 DTid : SV_DispatchThreadID )
+{
+    uint meshIndex = DTid.x;
+    if (meshIndex >= NumMeshes)
+        return;
+
+    MeshInfo mesh = Meshes[meshIndex];
+
+    if (ConeTest && IsBackFacing(mesh.Sphere, mesh.Cone))
+        return;
+
+    if (ReceiverTest && !ShadowsAnyReceiver(mesh.BoundsMin, mesh.BoundsMax))
+        return;
+
+    uint viewMask = 0;
+    uint slot = FirstSlot;
+    if (MultiView)
+    {
+        for (uint view = 0; view < NumViews; ++view)
+        {
+            if (!IsOutsideView(LoadViewProj(view), mesh.BoundsMin, mesh.BoundsMax))
+                viewMask |= 1u << view;
+        }
+    }
+    else
+    {
+        viewMask = IsOutsideView(LoadViewProj(Gid.y), mesh.BoundsMin, mesh.BoundsMax) ? 0 : 1;
+        slot += Gid.y;
+    }
+
+    if (viewMask == 0)
+        return;
+
+    uint drawIndex;
+    DrawCounts.InterlockedAdd(slot * 4, 1, drawIndex);
+    DrawCounts.InterlockedAdd(TriangleCountOffset + slot * 4, mesh.IndexCount / 3 * countbits(viewMask));
+
+    DrawCommand command;
+    command.BaseVertex = mesh.BaseVertex;
+    command.MaterialIndex = mesh.MaterialIndex;
+    command.ViewMask = viewMask;
+    command.IndexCountPerInstance = mesh.IndexCount;
+    command.InstanceCount = countbits(viewMask);
+    command.StartIndexLocation = mesh.StartIndex;
+    command.BaseVertexLocation = command.BaseVertex;
+    command.StartInstanceLocation = 0;
+    DrawCommands[slot * SlotStride + drawIndex] = command;
+}
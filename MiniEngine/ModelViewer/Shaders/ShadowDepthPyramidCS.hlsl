@@ -0,0 +1,81 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+// Builds four levels of a min/max depth pyramid over a region of a shadow map.  Texel n of level
+// L bounds the depths of shadow texels [n * 2^(L+1), (n + 1) * 2^(L+1)), so each thread group
+// reduces one 16x16 block of the shadow map.  Blocks never straddle atlas tiles as long as tiles
+// are aligned to 16 texels.
+
+#define ShadowDepthPyramid_RootSig \
+    "RootFlags(0), " \
+    "RootConstants(b0, num32BitConstants = 2), " \
+    "DescriptorTable(SRV(t0, numDescriptors = 1)), " \
+    "DescriptorTable(UAV(u0, numDescriptors = 4))"
+
+cbuffer CSConstants : register(b0)
+{
+    uint2 SrcOffset;    // Upper left shadow texel of the region, a multiple of 16
+};
+
+Texture2D<float> ShadowMap : register(t0);
+RWTexture2D<float2> OutMip0 : register(u0);
+RWTexture2D<float2> OutMip1 : register(u1);
+RWTexture2D<float2> OutMip2 : register(u2);
+RWTexture2D<float2> OutMip3 : register(u3);
+
+groupshared float2 MinMaxCache[64];
+
+float2 Reduce( float2 a, float2 b, float2 c, float2 d )
+{
+    return float2(min(min(a.x, b.x), min(c.x, d.x)), max(max(a.y, b.y), max(c.y, d.y)));
+}
+
+[RootSignature(ShadowDepthPyramid_RootSig)]
+[numthreads( 8, 8, 1 )]
+void main( uint3 DTid : SV_DispatchThreadID, uint GI : SV_GroupIndex )
+{
+    uint2 Dst = (SrcOffset >> 1) + DTid.xy;
+    uint2 Src = Dst << 1;
+
+    float d0 = ShadowMap[Src];
+    float d1 = ShadowMap[Src + uint2(1, 0)];
+    float d2 = ShadowMap[Src + uint2(0, 1)];
+    float d3 = ShadowMap[Src + uint2(1, 1)];
+    float2 MinMax = float2(min(min(d0, d1), min(d2, d3)), max(max(d0, d1), max(d2, d3)));
+
+    OutMip0[Dst] = MinMax;
+    MinMaxCache[GI] = MinMax;
+
+    GroupMemoryBarrierWithGroupSync();
+
+    // Threads with even X and Y reduce their 2x2 quad
+    if ((GI & 0x9) == 0)
+    {
+        MinMax = Reduce(MinMax, MinMaxCache[GI + 0x01], MinMaxCache[GI + 0x08], MinMaxCache[GI + 0x09]);
+        OutMip1[Dst >> 1] = MinMax;
+        MinMaxCache[GI] = MinMax;
+    }
+
+    GroupMemoryBarrierWithGroupSync();
+
+    if ((GI & 0x1B) == 0)
+    {
+        MinMax = Reduce(MinMax, MinMaxCache[GI + 0x02], MinMaxCache[GI + 0x10], MinMaxCache[GI + 0x12]);
+        OutMip2[Dst >> 2] = MinMax;
+        MinMaxCache[GI] = MinMax;
+    }
+
+    GroupMemoryBarrierWithGroupSync();
+
+    if (GI == 0)
+    {
+        MinMax = Reduce(MinMax, MinMaxCache[GI + 0x04], MinMaxCache[GI + 0x20], MinMaxCache[GI + 0x24]);
+        OutMip3[Dst >> 3] = MinMax;
+    }
+}
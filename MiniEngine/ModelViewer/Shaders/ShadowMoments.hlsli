@@ -0,0 +1,45 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+// Exponential variance shadow maps store the first two moments of exp(c * z), where z grows with
+// distance from the light.  Both moments filter linearly, so the maps can be blurred, mipmapped, and
+// sampled with a single bilinear or anisotropic fetch.  The exponent is limited by the precision of
+// the storage format:  the sun uses 32-bit floats and the light atlas uses 16-bit floats.
+
+#define SUN_MOMENT_EXPONENT 40.0
+#define LIGHT_MOMENT_EXPONENT 5.54
+
+// Shadow depths are reversed (1 is nearest the light) in [0, 1].  Remap to [-1, 1] with the sign
+// flipped so that the exponent's full range is used.
+float WarpDepth( float depth, float exponent )
+{
+    return exp(exponent * (1.0 - 2.0 * depth));
+}
+
+float2 GetMoments( float depth, float exponent )
+{
+    float warped = WarpDepth(depth, exponent);
+    return float2(warped, warped * warped);
+}
+
+// Chebyshev's upper bound on the fraction of the filter region that is lit.  Bleed reduction cuts
+// off the low end of the bound, which removes light leaking where occluders overlap.
+float GetMomentShadow( float2 moments, float receiverDepth, float exponent, float bleedReduction )
+{
+    float warped = WarpDepth(receiverDepth, exponent);
+    if (warped <= moments.x)
+        return 1.0;
+
+    float minVariance = 0.0001 * warped * warped;
+    float variance = max(moments.y - moments.x * moments.x, minVariance);
+    float delta = warped - moments.x;
+    float pMax = variance / (variance + delta * delta);
+
+    return saturate((pMax - bleedReduction) / (1.0 - bleedReduction));
+}
@@ -0,0 +1,78 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+// Converts a region of a shadow map to exponential moments and blurs them with a 9x9 gaussian in
+// one pass.  Reads are clamped to the source rectangle so that a tile of an atlas never pulls in its
+// neighbors.
+
+#include "ShadowMoments.hlsli"
+
+#define ShadowMoments_RootSig \
+    "RootFlags(0), " \
+    "CBV(b0), " \
+    "DescriptorTable(SRV(t0, numDescriptors = 1)), " \
+    "DescriptorTable(UAV(u0, numDescriptors = 1))"
+
+cbuffer CSConstants : register(b0)
+{
+    int2 SrcMin;        // Inclusive bounds of the texels that may be read
+    int2 SrcMax;
+    uint2 DstOffset;    // Upper left texel written by the first thread group
+    float Exponent;
+};
+
+Texture2D<float> ShadowMap : register(t0);
+RWTexture2D<float2> Moments : register(u0);
+
+// The gaussian blur weights (derived from Pascal's triangle)
+static const float Weights[5] = { 70.0f / 256.0f, 56.0f / 256.0f, 28.0f / 256.0f, 8.0f / 256.0f, 1.0f / 256.0f };
+
+// 16x16 texels with an 8x8 center that gets written out, then the 16x8 horizontal blur results
+groupshared float2 SrcCache[256];
+groupshared float2 BlurCache[128];
+
+float2 LoadMoments( int2 coord )
+{
+    return GetMoments(ShadowMap[clamp(coord, SrcMin, SrcMax)], Exponent);
+}
+
+[RootSignature(ShadowMoments_RootSig)]
+[numthreads( 8, 8, 1 )]
+void main( uint3 Gid : SV_GroupID, uint3 GTid : SV_GroupThreadID )
+{
+    int2 GroupUL = (int2)DstOffset + (int2)(Gid.xy << 3) - 4;
+    int2 ThreadUL = GroupUL + (int2)(GTid.xy << 1);
+
+    uint destIdx = (GTid.x << 1) + (GTid.y << 5);
+    SrcCache[destIdx +  0] = LoadMoments(ThreadUL + int2(0, 0));
+    SrcCache[destIdx +  1] = LoadMoments(ThreadUL + int2(1, 0));
+    SrcCache[destIdx + 16] = LoadMoments(ThreadUL + int2(0, 1));
+    SrcCache[destIdx + 17] = LoadMoments(ThreadUL + int2(1, 1));
+
+    GroupMemoryBarrierWithGroupSync();
+
+    // Each thread blurs two rows of one column horizontally
+    for (uint row = GTid.y; row < 16; row += 8)
+    {
+        uint rowCenter = (row << 4) + GTid.x + 4;
+        float2 rowResult = Weights[0] * SrcCache[rowCenter];
+        for (uint i = 1; i < 5; ++i)
+            rowResult += Weights[i] * (SrcCache[rowCenter - i] + SrcCache[rowCenter + i]);
+        BlurCache[(row << 3) + GTid.x] = rowResult;
+    }
+
+    GroupMemoryBarrierWithGroupSync();
+
+    uint center = ((GTid.y + 4) << 3) + GTid.x;
+    float2 result = Weights[0] * BlurCache[center];
+    for (uint j = 1; j < 5; ++j)
+        result += Weights[j] * (BlurCache[center - (j << 3)] + BlurCache[center + (j << 3)]);
+
+    Moments[(int2)DstOffset + (int2)(Gid.xy << 3) + (int2)GTid.xy] = result;
+}
@@ -0,0 +1,95 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Finds where the visible receivers are in the sun's light space.  Each group reduces the depth range of
+// one 8x8 tile of the depth buffer, then marks every cell of a coarse light space grid that the tile's
+// frustum slab covers with the smallest (farthest from the light) depth of the slab.  Tiles that span
+// a depth discontinuity cover more cells than they need to, which only makes the culling conservative.
+//
+
+#define ShadowReceiver_RootSig \
+    "RootFlags(0), " \
+    "CBV(b0), " \
+    "DescriptorTable(SRV(t0, numDescriptors = 1))," \
+    "DescriptorTable(UAV(u0, numDescriptors = 1))"
+
+cbuffer CSConstants : register(b0)
+{
+    float4x4 ClipToReceiver;    // Camera clip space to the light space receiver frame
+    uint2 ViewportSize;
+    uint GridSize;
+};
+
+Texture2D<float> DepthBuffer : register(t0);
+RWByteAddressBuffer ReceiverDepth : register(u0);
+
+groupshared uint gs_MinDepth;
+groupshared uint gs_MaxDepth;
+groupshared uint gs_CellMinX;
+groupshared uint gs_CellMinY;
+groupshared uint gs_CellMaxX;
+groupshared uint gs_CellMaxY;
+groupshared uint gs_ReceiverZ;
+
+[RootSignature(ShadowReceiver_RootSig)]
+[numthreads( 8, 8, 1 )]
+void main( uint3 Gid : SV_GroupID, uint3 DTid : SV_DispatchThreadID, uint GI : SV_GroupIndex )
+{
+    if (GI == 0)
+    {
+        gs_MinDepth = 0xFFFFFFFF;
+        gs_MaxDepth = 0;
+        gs_CellMinX = gs_CellMinY = 0xFFFFFFFF;
+        gs_CellMaxX = gs_CellMaxY = 0;
+        gs_ReceiverZ = 0xFFFFFFFF;
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    // Depths are positive, so their bits sort like their values.  Zero is the cleared far plane.
+    if (all(DTid.xy < ViewportSize))
+    {
+        float depth = DepthBuffer[DTid.xy];
+        if (depth > 0.0)
+        {
+            InterlockedMin(gs_MinDepth, asuint(depth));
+            InterlockedMax(gs_MaxDepth, asuint(depth));
+        }
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    if (gs_MinDepth > gs_MaxDepth)
+        return;
+
+    // The eight corners of the tile's slab
+    if (GI < 8)
+    {
+        uint2 pixel = Gid.xy * 8 + uint2(GI & 1 ? 8 : 0, GI & 2 ? 8 : 0);
+        float2 ndc = min(pixel, ViewportSize) / (float2)ViewportSize * float2(2.0, -2.0) + float2(-1.0, 1.0);
+        float depth = asfloat(GI & 4 ? gs_MaxDepth : gs_MinDepth);
+
+        float4 pos = mul(ClipToReceiver, float4(ndc, depth, 1.0));
+        pos.xyz /= pos.w;
+
+        // Clamping keeps the mapping monotonic, so receivers outside the frame land on its edges
+        uint2 cell = (uint2)clamp((pos.xy * float2(0.5, -0.5) + 0.5) * GridSize, 0.0, GridSize - 1.0);
+        InterlockedMin(gs_CellMinX, cell.x);
+        InterlockedMin(gs_CellMinY, cell.y);
+        InterlockedMax(gs_CellMaxX, cell.x);
+        InterlockedMax(gs_CellMaxY, cell.y);
+        InterlockedMin(gs_ReceiverZ, asuint(saturate(pos.z)));
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    uint width = gs_CellMaxX - gs_CellMinX + 1;
+    uint numCells = width * (gs_CellMaxY - gs_CellMinY + 1);
+    for (uint i = GI; i < numCells; i += 64)
+    {
+        uint2 cell = uint2(gs_CellMinX + i % width, gs_CellMinY + i / width);
+        ReceiverDepth.InterlockedMin((cell.y * GridSize + cell.x) * 4, gs_ReceiverZ);
+    }
+}
@@ -0,0 +1,111 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+// Percentage-closer soft shadows.  A blocker search estimates the average occluder depth, which
+// sets the width of the PCF kernel so that penumbrae widen with distance from the caster.  A min/max
+// depth pyramid bounds the search region first so that pixels that are fully lit or fully shadowed
+// skip both the search and the filter.
+
+#define SOFT_SHADOW_PYRAMID_LEVELS 4
+
+struct SoftShadowDesc
+{
+    float TexelSize;            // Of the shadow map, in UV units
+    float PenumbraScale;        // Penumbra width in UV units per unit of blocker-to-receiver depth
+    float MaxSearchRadius;      // In shadow texels
+    uint BlockerSamples;
+    uint FilterSamples;
+    bool Perspective;           // Depth is reversed perspective rather than linear
+};
+
+// Evenly distributed taps over the unit disk
+float2 GetDiskTap( uint index, uint count )
+{
+    float radius = sqrt((index + 0.5) / count);
+    float theta = index * 2.39996323;    // golden angle
+    return radius * float2(cos(theta), sin(theta));
+}
+
+// Penumbra width for an occluder at blockerDepth.  Shadow depths are reversed, so the blocker is
+// always the larger of the two.
+float GetPenumbraWidth( SoftShadowDesc desc, float blockerDepth, float receiverDepth )
+{
+    if (desc.Perspective)
+        return desc.PenumbraScale * (blockerDepth - receiverDepth) / receiverDepth;
+    else
+        return desc.PenumbraScale * (blockerDepth - receiverDepth);
+}
+
+// Returns the depth bounds of every shadow texel within radius (in texels) of coord
+float2 GetRegionDepthBounds( Texture2D<float2> depthPyramid, float2 texelCoord, float radius )
+{
+    // Pick the finest level whose texels are at least as wide as the region, so that the region
+    // touches at most 2x2 of them.  The coarsest level can take up to 4x4 loads.
+    uint level = (uint)clamp(ceil(log2(2.0 * radius)) - 1.0, 0.0, SOFT_SHADOW_PYRAMID_LEVELS - 1.0);
+    float footprint = (float)(2u << level);
+
+    int2 lo = (int2)floor((texelCoord - radius) / footprint);
+    int2 hi = min((int2)floor((texelCoord + radius) / footprint), lo + 3);
+
+    float2 bounds = float2(1.0, 0.0);
+    for (int y = lo.y; y <= hi.y; ++y)
+    {
+        for (int x = lo.x; x <= hi.x; ++x)
+        {
+            float2 texelBounds = depthPyramid.Load(int3(x, y, level));
+            bounds = float2(min(bounds.x, texelBounds.x), max(bounds.y, texelBounds.y));
+        }
+    }
+    return bounds;
+}
+
+float GetSoftShadow( Texture2D<float> shadowMap, Texture2D<float2> depthPyramid, SamplerComparisonState cmpSampler,
+    float3 shadowCoord, SoftShadowDesc desc )
+{
+    const float receiverDepth = shadowCoord.z;
+    const float2 texelCoord = shadowCoord.xy / desc.TexelSize;
+
+    // The widest penumbra comes from a blocker right at the light
+    float searchRadius = GetPenumbraWidth(desc, 1.0, receiverDepth) / desc.TexelSize;
+    searchRadius = clamp(searchRadius, 1.0, desc.MaxSearchRadius);
+
+    float2 bounds = GetRegionDepthBounds(depthPyramid, texelCoord, searchRadius);
+    if (receiverDepth >= bounds.y)
+        return 1.0;
+    if (receiverDepth < bounds.x)
+        return 0.0;
+
+    float blockerSum = 0.0;
+    float numBlockers = 0.0;
+    for (uint i = 0; i < desc.BlockerSamples; ++i)
+    {
+        float2 tap = texelCoord + GetDiskTap(i, desc.BlockerSamples) * searchRadius;
+        float depth = shadowMap.Load(int3(tap, 0));
+        if (depth > receiverDepth)
+        {
+            blockerSum += depth;
+            numBlockers += 1.0;
+        }
+    }
+
+    // The bounds said there is a blocker somewhere, but the taps can still miss it
+    if (numBlockers == 0.0)
+        return 1.0;
+
+    float filterRadius = GetPenumbraWidth(desc, blockerSum / numBlockers, receiverDepth);
+    filterRadius = clamp(filterRadius, desc.TexelSize, desc.MaxSearchRadius * desc.TexelSize);
+
+    float result = 0.0;
+    for (uint j = 0; j < desc.FilterSamples; ++j)
+    {
+        float2 uv = shadowCoord.xy + GetDiskTap(j, desc.FilterSamples) * filterRadius;
+        result += shadowMap.SampleCmpLevelZero(cmpSampler, uv, receiverDepth);
+    }
+    return result / desc.FilterSamples;
+}
@@ -0,0 +1,143 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+// Rasterizes the small shadow casters, a group per meshlet and a thread per triangle.  Each thread tests the
+// texel centers in its triangle's bounds with the hardware's rules: vertices snapped to 1/256 of a texel, the
+// top-left fill convention, back faces culled, depth clipped to [0, 1] and the shadow rasterizer state's
+// depth bias.  The depth nearest the light wins through an atomic max on the float's bits, which order as
+// integers do since depths are never negative.
+
+#include "SoftwareShadowRasterRS.hlsli"
+
+// must keep in sync with C++
+struct MeshletWork
+{
+    uint StartIndex;            // In the depth-only index buffer
+    uint TriangleCount;
+    uint VertexAddress;         // Byte offset of the mesh's vertices in the depth-only stream
+    uint Pad;
+};
+
+ByteAddressBuffer Indices : register(t0);
+ByteAddressBuffer Vertices : register(t1);
+StructuredBuffer<MeshletWork> Meshlets : register(t2);
+RWTexture2D<uint> OutDepth : register(u0);
+
+cbuffer CSConstants : register(b0)
+{
+    float4x4 ViewProj;
+    float3 PositionScale;       // Quantized positions are relative to the model's bounding box
+    uint Quantized;
+    float3 PositionBias;
+    uint VertexStride;
+    float2 TargetSize;
+    uint PositionOffset;
+    uint FirstMeshlet;
+    float DepthBias;            // In steps of the depth format
+    float SlopeScaledDepthBias;
+    uint FloatDepth;
+    uint MaxExtent;             // Texels across the largest bounds a triangle is rasterized in
+    uint Index32;               // The model's indices are 32-bit rather than 16-bit
+}
+
+uint LoadIndex( uint Index )
+{
+    if (Index32 != 0)
+        return Indices.Load(Index * 4);
+
+    uint Packed = Indices.Load((Index * 2) & ~3);
+    return (Index & 1) != 0 ? Packed >> 16 : Packed & 0xFFFF;
+}
+
+// Texel coordinates, with y down, and depth as the viewport transform places them
+float3 LoadVertex( uint VertexAddress, uint Index )
+{
+    const uint Address = VertexAddress + Index * VertexStride + PositionOffset;
+    float3 Position;
+    if (Quantized != 0)
+    {
+        uint2 Packed = Vertices.Load2(Address);
+        Position = float3(Packed.x & 0xFFFF, Packed.x >> 16, Packed.y & 0xFFFF) / 65535.0 * PositionScale + PositionBias;
+    }
+    else
+        Position = asfloat(Vertices.Load3(Address));
+
+    float4 Clip = mul(ViewProj, float4(Position, 1.0));
+    float3 NDC = Clip.xyz / Clip.w;
+    float2 Texel = float2(NDC.x * 0.5 + 0.5, 0.5 - NDC.y * 0.5) * TargetSize;
+    return float3(round(Texel * 256.0) / 256.0, NDC.z);
+}
+
+// Positive inside a front facing (counter-clockwise on screen) triangle
+float EdgeFunction( float2 a, float2 b, float2 p )
+{
+    return (b.y - a.y) * (p.x - a.x) - (b.x - a.x) * (p.y - a.y);
+}
+
+// Texel centers exactly on an edge belong to the triangle when it is a top or a left edge
+bool IsTopLeft( float2 a, float2 b )
+{
+    return (a.y == b.y && b.x < a.x) || b.y > a.y;
+}
+
+[RootSignature(SoftwareShadowRaster_RootSig)]
+[numthreads( 128, 1, 1 )]
+void main( uint3 Gid : SV_GroupID, uint GI : SV_GroupIndex )
+{
+    const MeshletWork Meshlet = Meshlets[FirstMeshlet + Gid.x];
+    if (GI >= Meshlet.TriangleCount)
+        return;
+
+    const uint FirstIndex = Meshlet.StartIndex + GI * 3;
+    const float3 v0 = LoadVertex(Meshlet.VertexAddress, LoadIndex(FirstIndex));
+    const float3 v1 = LoadVertex(Meshlet.VertexAddress, LoadIndex(FirstIndex + 1));
+    const float3 v2 = LoadVertex(Meshlet.VertexAddress, LoadIndex(FirstIndex + 2));
+
+    const float Area = EdgeFunction(v0.xy, v1.xy, v2.xy);
+    if (Area <= 0.0)
+        return;
+
+    // Texel centers sit at half coordinates
+    const float2 BoundsMin = min(min(v0.xy, v1.xy), v2.xy);
+    const float2 BoundsMax = max(max(v0.xy, v1.xy), v2.xy);
+    const int2 First = max(int2(ceil(BoundsMin - 0.5)), 0);
+    const int2 Last = min(min(int2(floor(BoundsMax - 0.5)), int2(TargetSize) - 1), First + (int)MaxExtent - 1);
+
+    // Depth is linear in texel space under an orthographic projection
+    const float RcpArea = 1.0 / Area;
+    const float3 DepthDX = float3(v2.y - v1.y, v0.y - v2.y, v1.y - v0.y) * RcpArea;
+    const float3 DepthDY = float3(v1.x - v2.x, v2.x - v0.x, v0.x - v1.x) * RcpArea;
+    const float3 Depths = float3(v0.z, v1.z, v2.z);
+    const float MaxSlope = max(abs(dot(DepthDX, Depths)), abs(dot(DepthDY, Depths)));
+
+    // D3D12's bias: a step of a unorm format, or of a float's mantissa at the triangle's largest depth
+    const float MaxDepth = max(max(v0.z, v1.z), v2.z);
+    const float DepthStep = FloatDepth != 0 ? asfloat(asuint(MaxDepth) & 0x7F800000) / 8388608.0 : 1.0 / 65535.0;
+    const float Bias = DepthBias * DepthStep + SlopeScaledDepthBias * MaxSlope;
+
+    const bool3 TopLeft = bool3(IsTopLeft(v1.xy, v2.xy), IsTopLeft(v2.xy, v0.xy), IsTopLeft(v0.xy, v1.xy));
+
+    for (int y = First.y; y <= Last.y; ++y)
+    {
+        for (int x = First.x; x <= Last.x; ++x)
+        {
+            const float2 p = float2(x, y) + 0.5;
+            const float3 w = float3(EdgeFunction(v1.xy, v2.xy, p), EdgeFunction(v2.xy, v0.xy, p), EdgeFunction(v0.xy, v1.xy, p));
+            if (!all(w > 0.0 || (w == 0.0 && TopLeft)))
+                continue;
+
+            const float Depth = dot(w * RcpArea, Depths);
+            if (Depth < 0.0 || Depth > 1.0)
+                continue;
+
+            uint Previous;
+            InterlockedMax(OutDepth[uint2(x, y)], asuint(saturate(Depth + Bias)), Previous);
+        }
+    }
+}
@@ -0,0 +1,20 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#define SoftwareShadowRaster_RootSig \
+    "RootFlags(0), " \
+    "CBV(b0), " \
+    "SRV(t0), " \
+    "SRV(t1), " \
+    "SRV(t2), " \
+    "DescriptorTable(UAV(u0))"
+
+#define SoftwareShadowResolve_RootSig \
+    "RootFlags(0), " \
+    "DescriptorTable(SRV(t0), visibility = SHADER_VISIBILITY_PIXEL)"
@@ -0,0 +1,25 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Writes the depths of the compute rasterized casters into the shadow map, where depth testing merges them
+// with the hardware rasterized ones.  Texels no caster covered are left alone.
+//
+
+#include "SoftwareShadowRasterRS.hlsli"
+
+Texture2D<uint> SoftwareDepth : register(t0);
+
+[RootSignature(SoftwareShadowResolve_RootSig)]
+float main( float4 Pos : SV_Position ) : SV_Depth
+{
+    uint Depth = SoftwareDepth[uint2(Pos.xy)];
+    if (Depth == 0)
+        discard;
+
+    return asfloat(Depth);
+}
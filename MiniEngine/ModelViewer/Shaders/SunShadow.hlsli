@@ -0,0 +1,217 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+// Sun shadow lookups shared by the color pass and the screen-space shadow mask.  The includer first
+// includes ModelViewerConstants.hlsli, ShadowCascades.hlsli, ShadowMoments.hlsli and SoftShadows.hlsli,
+// then declares the sun shadow textures and samplers with the same names and registers as
+// ModelViewerPS.hlsl.  Compute shaders also define NO_IMPLICIT_DERIVATIVES.
+
+// A Poisson disk of unit radius, of which the temporal filter takes the first TemporalShadowParams.x taps
+static const float2 kTemporalShadowTaps[4] =
+{
+    float2(-0.9420, -0.3991), float2(0.9456, -0.7689), float2(-0.0942, -0.9294), float2(0.3450, 0.2939)
+};
+
+// Under TAA a few taps of the disk, rotated every frame, are integrated over time into the full filter.  The
+// radius matches the extent of the dilated nine tap pattern.
+float2 GetTemporalShadowOffset( uint Tap, float TexelSize )
+{
+    float2 p = kTemporalShadowTaps[Tap] * (2.0 * 0.875 * TexelSize);
+    return float2(p.x * TemporalShadowParams.y - p.y * TemporalShadowParams.z, p.x * TemporalShadowParams.z + p.y * TemporalShadowParams.y);
+}
+
+float GetShadow( float3 ShadowCoord )
+{
+    // Prefiltered moments only need one (anisotropic) fetch
+    if (MomentShadowParams.x != 0.0)
+    {
+#ifdef NO_IMPLICIT_DERIVATIVES
+        float2 moments = texShadowMoments.SampleLevel(momentSampler, ShadowCoord.xy, 0);
+#else
+        float2 moments = texShadowMoments.Sample(momentSampler, ShadowCoord.xy);
+#endif
+        return GetMomentShadow(moments, ShadowCoord.z, SUN_MOMENT_EXPONENT, MomentShadowParams.y);
+    }
+
+    if (SoftShadowSamples.x != 0)
+    {
+        SoftShadowDesc desc;
+        desc.TexelSize = ShadowTexelSize.x;
+        desc.PenumbraScale = SoftShadowParams.x;
+        desc.MaxSearchRadius = SoftShadowParams.z;
+        desc.BlockerSamples = SoftShadowSamples.y;
+        desc.FilterSamples = SoftShadowSamples.z;
+        desc.Perspective = false;
+        return GetSoftShadow(texShadow, texShadowDepthPyramid, shadowSampler, ShadowCoord, desc);
+    }
+
+#ifdef SINGLE_SAMPLE
+    float result = texShadow.SampleCmpLevelZero( shadowSampler, ShadowCoord.xy, ShadowCoord.z );
+#else
+    [branch]
+    if (TemporalShadowParams.x != 0.0)
+    {
+        const uint Taps = (uint)TemporalShadowParams.x;
+        float result = 0.0;
+        for (uint i = 0; i < Taps; ++i)
+            result += texShadow.SampleCmpLevelZero( shadowSampler, ShadowCoord.xy + GetTemporalShadowOffset(i, ShadowTexelSize.x), ShadowCoord.z );
+        result /= Taps;
+        return result * result;
+    }
+
+    const float Dilation = 2.0;
+    float d1 = Dilation * ShadowTexelSize.x * 0.125;
+    float d2 = Dilation * ShadowTexelSize.x * 0.875;
+    float d3 = Dilation * ShadowTexelSize.x * 0.625;
+    float d4 = Dilation * ShadowTexelSize.x * 0.375;
+    float result = (
+        2.0 * texShadow.SampleCmpLevelZero( shadowSampler, ShadowCoord.xy, ShadowCoord.z ) +
+        texShadow.SampleCmpLevelZero( shadowSampler, ShadowCoord.xy + float2(-d2,  d1), ShadowCoord.z ) +
+        texShadow.SampleCmpLevelZero( shadowSampler, ShadowCoord.xy + float2(-d1, -d2), ShadowCoord.z ) +
+        texShadow.SampleCmpLevelZero( shadowSampler, ShadowCoord.xy + float2( d2, -d1), ShadowCoord.z ) +
+        texShadow.SampleCmpLevelZero( shadowSampler, ShadowCoord.xy + float2( d1,  d2), ShadowCoord.z ) +
+        texShadow.SampleCmpLevelZero( shadowSampler, ShadowCoord.xy + float2(-d4,  d3), ShadowCoord.z ) +
+        texShadow.SampleCmpLevelZero( shadowSampler, ShadowCoord.xy + float2(-d3, -d4), ShadowCoord.z ) +
+        texShadow.SampleCmpLevelZero( shadowSampler, ShadowCoord.xy + float2( d4, -d3), ShadowCoord.z ) +
+        texShadow.SampleCmpLevelZero( shadowSampler, ShadowCoord.xy + float2( d3,  d4), ShadowCoord.z )
+        ) / 10.0;
+#endif
+    return result * result;
+}
+
+// Returns false if any tap lands on a page that is not mapped yet
+bool GetVirtualShadow( float3 worldPos, out float shadow )
+{
+    shadow = 1.0;
+
+    float3 ShadowCoord = mul(VirtualShadowMatrix, float4(worldPos, 1.0)).xyz;
+    if (any(ShadowCoord.xy < 0.0) || any(ShadowCoord.xy >= 1.0))
+        return false;
+
+    const float d1 = VirtualShadowParams.y * 0.5;
+    const float d2 = VirtualShadowParams.y * 1.5;
+    uint s0, s1, s2, s3, s4;
+    float result = (
+        2.0 * texVirtualShadow.SampleCmpLevelZero( shadowSampler, ShadowCoord.xy, ShadowCoord.z, int2(0, 0), s0 ) +
+        texVirtualShadow.SampleCmpLevelZero( shadowSampler, ShadowCoord.xy + float2(-d2,  d1), ShadowCoord.z, int2(0, 0), s1 ) +
+        texVirtualShadow.SampleCmpLevelZero( shadowSampler, ShadowCoord.xy + float2(-d1, -d2), ShadowCoord.z, int2(0, 0), s2 ) +
+        texVirtualShadow.SampleCmpLevelZero( shadowSampler, ShadowCoord.xy + float2( d2, -d1), ShadowCoord.z, int2(0, 0), s3 ) +
+        texVirtualShadow.SampleCmpLevelZero( shadowSampler, ShadowCoord.xy + float2( d1,  d2), ShadowCoord.z, int2(0, 0), s4 )
+        ) / 6.0;
+
+    if (!CheckAccessFullyMapped(s0) || !CheckAccessFullyMapped(s1) || !CheckAccessFullyMapped(s2) ||
+        !CheckAccessFullyMapped(s3) || !CheckAccessFullyMapped(s4))
+        return false;
+
+    shadow = result * result;
+    return true;
+}
+
+float GetSunShadow( float3 ShadowCoord, float3 worldPos )
+{
+    float shadow;
+    if (VirtualShadowParams.x != 0.0 && GetVirtualShadow(worldPos, shadow))
+        return shadow;
+
+    return GetShadow(ShadowCoord);
+}
+
+float GetCascadeShadow( SamplerComparisonState cascadeSampler, uint cascade, float3 ShadowCoord )
+{
+    [branch]
+    if (TemporalShadowParams.x != 0.0)
+    {
+        const uint Taps = (uint)TemporalShadowParams.x;
+        float result = 0.0;
+        for (uint i = 0; i < Taps; ++i)
+        {
+            result += texSunShadowCascades.SampleCmpLevelZero( cascadeSampler,
+                float3(ShadowCoord.xy + GetTemporalShadowOffset(i, ShadowTexelSize.y), cascade), ShadowCoord.z );
+        }
+        result /= Taps;
+        return result * result;
+    }
+
+    const float Dilation = 2.0;
+    float d1 = Dilation * ShadowTexelSize.y * 0.125;
+    float d2 = Dilation * ShadowTexelSize.y * 0.875;
+    float d3 = Dilation * ShadowTexelSize.y * 0.625;
+    float d4 = Dilation * ShadowTexelSize.y * 0.375;
+    float result = (
+        2.0 * texSunShadowCascades.SampleCmpLevelZero( cascadeSampler, float3(ShadowCoord.xy, cascade), ShadowCoord.z ) +
+        texSunShadowCascades.SampleCmpLevelZero( cascadeSampler, float3(ShadowCoord.xy + float2(-d2,  d1), cascade), ShadowCoord.z ) +
+        texSunShadowCascades.SampleCmpLevelZero( cascadeSampler, float3(ShadowCoord.xy + float2(-d1, -d2), cascade), ShadowCoord.z ) +
+        texSunShadowCascades.SampleCmpLevelZero( cascadeSampler, float3(ShadowCoord.xy + float2( d2, -d1), cascade), ShadowCoord.z ) +
+        texSunShadowCascades.SampleCmpLevelZero( cascadeSampler, float3(ShadowCoord.xy + float2( d1,  d2), cascade), ShadowCoord.z ) +
+        texSunShadowCascades.SampleCmpLevelZero( cascadeSampler, float3(ShadowCoord.xy + float2(-d4,  d3), cascade), ShadowCoord.z ) +
+        texSunShadowCascades.SampleCmpLevelZero( cascadeSampler, float3(ShadowCoord.xy + float2(-d3, -d4), cascade), ShadowCoord.z ) +
+        texSunShadowCascades.SampleCmpLevelZero( cascadeSampler, float3(ShadowCoord.xy + float2( d4, -d3), cascade), ShadowCoord.z ) +
+        texSunShadowCascades.SampleCmpLevelZero( cascadeSampler, float3(ShadowCoord.xy + float2( d3,  d4), cascade), ShadowCoord.z )
+        ) / 10.0;
+    return result * result;
+}
+
+// Far cascades that scroll with the camera are stored toroidally, so their texture space is offset and the
+// filter taps wrap around the slice edges
+float GetCascadeShadow( uint cascade, float3 ShadowCoord )
+{
+    if (cascadeBuffer[cascade].Scrolling != 0.0)
+    {
+        ShadowCoord.xy += cascadeBuffer[cascade].WrapOffset;
+        return GetCascadeShadow(shadowWrapSampler, cascade, ShadowCoord);
+    }
+
+    return GetCascadeShadow(shadowSampler, cascade, ShadowCoord);
+}
+
+// Pick the cascade by view depth and cross-fade into the next cascade near the far end of the
+// current one so that the change in resolution is not visible as a hard seam.
+float GetCascadedShadow( float3 worldPos, float viewDepth )
+{
+    uint cascade = NumCascades;
+    for (uint i = 0; i < NumCascades; ++i)
+    {
+        if (viewDepth <= cascadeBuffer[i].SplitDistance)
+        {
+            cascade = i;
+            break;
+        }
+    }
+
+    // Past the last cascade nothing is shadowed
+    if (cascade == NumCascades)
+        return 1.0;
+
+    float3 shadowCoord = mul(cascadeBuffer[cascade].ShadowMatrix, float4(worldPos, 1.0)).xyz;
+    float shadow = GetCascadeShadow(cascade, shadowCoord);
+
+    float splitEnd = cascadeBuffer[cascade].SplitDistance;
+    float splitStart = cascade == 0 ? 0.0 : cascadeBuffer[cascade - 1].SplitDistance;
+    float blendStart = splitEnd - (splitEnd - splitStart) * CascadeBlendRange;
+
+    [branch]
+    if (viewDepth > blendStart)
+    {
+        float nextShadow = 1.0;
+        if (cascade + 1 < NumCascades)
+        {
+            float3 nextCoord = mul(cascadeBuffer[cascade + 1].ShadowMatrix, float4(worldPos, 1.0)).xyz;
+            nextShadow = GetCascadeShadow(cascade + 1, nextCoord);
+        }
+        shadow = lerp(shadow, nextShadow, saturate((viewDepth - blendStart) / (splitEnd - blendStart)));
+    }
+
+    return shadow;
+}
+
+// Whichever sun shadow technique is enabled, for a point at the given view depth
+float GetDirectionalShadow( float3 shadowCoord, float3 worldPos, float viewDepth )
+{
+    return NumCascades > 0 ? GetCascadedShadow(worldPos, viewDepth) : GetSunShadow(shadowCoord, worldPos);
+}
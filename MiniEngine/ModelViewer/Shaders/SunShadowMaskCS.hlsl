@@ -0,0 +1,107 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+// Resolves the sun shadow of every depth buffer pixel into a screen-space mask, so that the color pass
+// performs one load per pixel instead of filtering the shadow map for every shaded sample.  Short contact
+// shadows marched through the depth buffer restore the detail that a coarser shadow map loses.
+
+#define NO_IMPLICIT_DERIVATIVES
+
+#include "SunShadowMaskRS.hlsli"
+#include "ModelViewerConstants.hlsli"
+#include "ShadowCascades.hlsli"
+#include "ShadowMoments.hlsli"
+#include "SoftShadows.hlsli"
+
+Texture2D<float> texSceneDepth : register(t0);
+
+Texture2D<float> texShadow : register(t65);
+Texture2DArray<float> texSunShadowCascades : register(t70);
+StructuredBuffer<CascadeData> cascadeBuffer : register(t71);
+Texture2D<float2> texShadowMoments : register(t72);
+Texture2D<float2> texShadowDepthPyramid : register(t74);
+Texture2D<float> texVirtualShadow : register(t76);
+
+SamplerComparisonState shadowSampler : register(s1);
+SamplerState momentSampler : register(s2);
+SamplerComparisonState shadowWrapSampler : register(s3);
+
+RWTexture2D<float> ShadowMask : register(u0);
+
+#include "SunShadow.hlsli"
+
+// Scene depth linearized like g_LinearDepth, where 1 is the far plane
+float GetLinearDepth( uint2 pixelPos )
+{
+    return 1.0 / (ZMagic * texSceneDepth[pixelPos] + 1.0);
+}
+
+// Marches a few pixels of the depth buffer from the pixel toward the sun.  The ray is blocked where it
+// passes behind another pixel's depth by less than the thickness given to every surface.
+float GetContactShadow( float3 worldPos, uint2 pixelPos )
+{
+    const float3 rayStep = SunDirection * (ContactLength / ContactSteps);
+
+    // Interleaved gradient noise spreads the steps between neighboring pixels to hide banding
+    const float jitter = frac(52.9829189 * frac(dot(pixelPos, float2(0.06711056, 0.00583715))));
+
+    for (uint i = 0; i < ContactSteps; ++i)
+    {
+        float3 samplePos = worldPos + rayStep * (i + jitter);
+        float4 clipPos = mul(ViewProj, float4(samplePos, 1.0));
+        float2 ndc = clipPos.xy / clipPos.w;
+        if (any(abs(ndc) >= 1.0))
+            break;
+
+        int2 samplePixel = int2((ndc * float2(0.5, -0.5) + 0.5) / InvViewportSize + ViewportOffset);
+        samplePixel = clamp(samplePixel, 0, int2(MaskSize) - 1);
+
+        float rayDepth = dot(samplePos - CameraPosition, CameraForward);
+        float behind = rayDepth - GetLinearDepth(samplePixel) / RcpFarClip;
+
+        // Steps near the pixel itself lie on its own surface, which must not shadow it
+        if (behind > ContactThickness * 0.05 && behind < ContactThickness)
+            return 0.0;
+    }
+
+    return 1.0;
+}
+
+[RootSignature(SunShadowMask_RootSig)]
+[numthreads( 8, 8, 1 )]
+void main( uint3 DTid : SV_DispatchThreadID )
+{
+    // At half resolution each thread takes the top left pixel of its quad
+    uint2 pixelPos = DTid.xy * SampleScale;
+    if (any(pixelPos >= MaskSize))
+        return;
+
+    // Nothing to shadow at the far plane
+    float depth = texSceneDepth[pixelPos];
+    if (depth == 0.0)
+    {
+        ShadowMask[DTid.xy] = 1.0;
+        return;
+    }
+
+    float2 ndc = (pixelPos + 0.5 - ViewportOffset) * InvViewportSize * float2(2.0, -2.0) + float2(-1.0, 1.0);
+    float4 worldPos = mul(InvViewProj, float4(ndc, depth, 1.0));
+    worldPos.xyz /= worldPos.w;
+
+    float3 shadowCoord = mul(SunShadowMatrix, float4(worldPos.xyz, 1.0)).xyz;
+    float viewDepth = dot(worldPos.xyz - CameraPosition, CameraForward);
+
+    float shadow = GetDirectionalShadow(shadowCoord, worldPos.xyz, viewDepth);
+
+    [branch]
+    if (ContactLength > 0.0 && shadow > 0.0)
+        shadow = min(shadow, GetContactShadow(worldPos.xyz, pixelPos));
+
+    ShadowMask[DTid.xy] = shadow;
+}
@@ -0,0 +1,51 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+// The shading constants and the shadow SRV table are bound exactly as for the color pass, so the sun
+// shadow functions in SunShadow.hlsli see the same registers.
+#define SunShadowMask_RootSig \
+    "RootFlags(0), " \
+    "CBV(b0), " \
+    "CBV(b1), " \
+    "DescriptorTable(SRV(t0, numDescriptors = 2)), " \
+    "DescriptorTable(SRV(t64, numDescriptors = 13)), " \
+    "DescriptorTable(UAV(u0, numDescriptors = 1)), " \
+    "StaticSampler(s1," \
+        "addressU = TEXTURE_ADDRESS_CLAMP," \
+        "addressV = TEXTURE_ADDRESS_CLAMP," \
+        "addressW = TEXTURE_ADDRESS_CLAMP," \
+        "comparisonFunc = COMPARISON_GREATER_EQUAL," \
+        "filter = FILTER_MIN_MAG_LINEAR_MIP_POINT)," \
+    "StaticSampler(s2, maxAnisotropy = 8," \
+        "addressU = TEXTURE_ADDRESS_CLAMP," \
+        "addressV = TEXTURE_ADDRESS_CLAMP," \
+        "addressW = TEXTURE_ADDRESS_CLAMP)," \
+    "StaticSampler(s3," \
+        "addressU = TEXTURE_ADDRESS_WRAP," \
+        "addressV = TEXTURE_ADDRESS_WRAP," \
+        "addressW = TEXTURE_ADDRESS_CLAMP," \
+        "comparisonFunc = COMPARISON_GREATER_EQUAL," \
+        "filter = FILTER_MIN_MAG_LINEAR_MIP_POINT)"
+
+cbuffer MaskConstants : register(b1)
+{
+    float4x4 InvViewProj;
+    float4x4 ViewProj;
+    float4x4 SunShadowMatrix;   // World space to sun shadow map texture space
+    float3 CameraPosition;
+    float ZMagic;               // (zFar - zNear) / zNear
+    float2 ViewportOffset;      // Sub-pixel jitter of the main viewport
+    float2 InvViewportSize;
+    uint2 MaskSize;             // Full resolution mask dimensions
+    uint SampleScale;           // 2 when the mask is evaluated at half resolution
+    float ContactLength;        // World distance marched toward the sun, or 0 without contact shadows
+    float ContactThickness;     // How far behind the depth buffer a ray still counts as blocked
+    uint ContactSteps;
+    float RcpFarClip;
+};
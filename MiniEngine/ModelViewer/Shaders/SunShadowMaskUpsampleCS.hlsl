@@ -0,0 +1,56 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+// Upsamples a half resolution shadow mask.  The bilinear weights of the four nearest half resolution
+// samples are scaled down by their difference in depth so that shadows do not bleed across edges.
+
+#include "SunShadowMaskRS.hlsli"
+
+Texture2D<float> texSceneDepth : register(t0);
+Texture2D<float> texHalfResMask : register(t1);
+RWTexture2D<float> ShadowMask : register(u0);
+
+float GetLinearDepth( uint2 pixelPos )
+{
+    return 1.0 / (ZMagic * texSceneDepth[pixelPos] + 1.0);
+}
+
+[RootSignature(SunShadowMask_RootSig)]
+[numthreads( 8, 8, 1 )]
+void main( uint3 DTid : SV_DispatchThreadID )
+{
+    if (any(DTid.xy >= MaskSize))
+        return;
+
+    // Half resolution sample h was taken at full resolution pixel 2h
+    const uint2 halfSize = (MaskSize + 1) / 2;
+    const uint2 h0 = DTid.xy / 2;
+    const uint2 h1 = min(h0 + 1, halfSize - 1);
+    const float2 f = (DTid.xy & 1) * 0.5;
+
+    const float depth = GetLinearDepth(DTid.xy);
+    const float tolerance = depth * 0.01;
+
+    uint2 coords[4] = { h0, uint2(h1.x, h0.y), uint2(h0.x, h1.y), h1 };
+    float bilinear[4] = { (1 - f.x) * (1 - f.y), f.x * (1 - f.y), (1 - f.x) * f.y, f.x * f.y };
+
+    float shadowSum = 0.0;
+    float weightSum = 0.0;
+
+    [unroll]
+    for (uint i = 0; i < 4; ++i)
+    {
+        float sampleDepth = GetLinearDepth(min(coords[i] * 2, MaskSize - 1));
+        float weight = bilinear[i] * rcp(abs(sampleDepth - depth) + tolerance);
+        shadowSum += weight * texHalfResMask[coords[i]];
+        weightSum += weight;
+    }
+
+    ShadowMask[DTid.xy] = weightSum > 0.0 ? shadowSum / weightSum : texHalfResMask[h0];
+}
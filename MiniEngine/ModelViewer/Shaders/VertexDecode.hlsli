@@ -0,0 +1,40 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+// Quantized models store positions relative to the model's bounding box, which the input assembler has
+// already expanded to [0, 1], and normals octahedral-encoded in two snorms.  Float models decode with a unit
+// scale and no bias.  See Model::VertexDecode.
+
+cbuffer VertexDecodeConstants : register(b2)
+{
+    float3 PositionScale;
+    float OctahedralNormals;
+    float3 PositionBias;
+};
+
+float3 DecodePosition( float3 position )
+{
+    // The Z prepass and the color pass read positions from different streams, and depth testing for equality
+    // needs them to decode identically
+    precise float3 decoded = position * PositionScale + PositionBias;
+    return decoded;
+}
+
+float3 DecodeOctahedral( float2 e )
+{
+    float3 v = float3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = saturate(-v.z);
+    v.xy += v.xy >= 0.0 ? -t : t;
+    return normalize(v);
+}
+
+float3 DecodeNormal( float3 normal )
+{
+    return OctahedralNormals != 0.0 ? DecodeOctahedral(normal.xy) : normal;
+}
@@ -0,0 +1,47 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+// Reduces the depth buffer to the farthest depth of each 16x16 pixel tile.  The tiles are read back on the
+// CPU, which builds a Hi-Z pyramid from them to occlusion cull the meshes of later frames.
+
+#define ViewOcclusion_RootSig \
+    "RootFlags(0), " \
+    "CBV(b0), " \
+    "DescriptorTable(SRV(t0, numDescriptors = 1)), " \
+    "DescriptorTable(UAV(u0, numDescriptors = 1))"
+
+#define TILE_SIZE 16
+
+cbuffer CSConstants : register(b0)
+{
+    uint2 ViewportSize;
+    uint TilesPerRow;
+};
+
+Texture2D<float> DepthBuffer : register(t0);
+RWStructuredBuffer<float> TileDepth : register(u0);
+
+groupshared uint gs_FarthestDepth;
+
+[RootSignature(ViewOcclusion_RootSig)]
+[numthreads( TILE_SIZE, TILE_SIZE, 1 )]
+void main( uint3 Gid : SV_GroupID, uint3 DTid : SV_DispatchThreadID, uint GI : SV_GroupIndex )
+{
+    if (GI == 0)
+        gs_FarthestDepth = 0xffffffff;
+    GroupMemoryBarrierWithGroupSync();
+
+    // Depth is reversed, so the farthest is the smallest.  Positive floats order the same as their bits.
+    if (all(DTid.xy < ViewportSize))
+        InterlockedMin(gs_FarthestDepth, asuint(DepthBuffer[DTid.xy]));
+    GroupMemoryBarrierWithGroupSync();
+
+    if (GI == 0)
+        TileDepth[Gid.y * TilesPerRow + Gid.x] = asfloat(gs_FarthestDepth);
+}
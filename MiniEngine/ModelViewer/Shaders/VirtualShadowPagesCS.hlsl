@@ -0,0 +1,53 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+// Flags every page of the virtual sun shadow map that a visible pixel projects into.  The flags are
+// read back on the CPU, which maps physical memory behind the requested pages.
+
+#define VirtualShadow_RootSig \
+    "RootFlags(0), " \
+    "CBV(b0), " \
+    "DescriptorTable(SRV(t0, numDescriptors = 1)), " \
+    "DescriptorTable(UAV(u0, numDescriptors = 1))"
+
+cbuffer CSConstants : register(b0)
+{
+    float4x4 InvViewProj;
+    float4x4 ShadowMatrix;      // World space to virtual shadow map texture space
+    uint2 ViewportSize;
+    uint2 PageSize;             // In texels
+    uint PagesPerRow;
+    float VirtualSize;          // Width and height of the virtual shadow map in texels
+};
+
+Texture2D<float> DepthBuffer : register(t0);
+RWByteAddressBuffer PageRequests : register(u0);
+
+[RootSignature(VirtualShadow_RootSig)]
+[numthreads( 8, 8, 1 )]
+void main( uint3 DTid : SV_DispatchThreadID )
+{
+    if (any(DTid.xy >= ViewportSize))
+        return;
+
+    // Nothing to shadow at the far plane
+    float depth = DepthBuffer[DTid.xy];
+    if (depth == 0.0)
+        return;
+
+    float2 ndc = (DTid.xy + 0.5) / ViewportSize * float2(2.0, -2.0) + float2(-1.0, 1.0);
+    float4 worldPos = mul(InvViewProj, float4(ndc, depth, 1.0));
+    float3 shadowCoord = mul(ShadowMatrix, float4(worldPos.xyz / worldPos.w, 1.0)).xyz;
+
+    if (any(shadowCoord.xy < 0.0) || any(shadowCoord.xy >= 1.0))
+        return;
+
+    uint2 page = (uint2)(shadowCoord.xy * VirtualSize) / PageSize;
+    PageRequests.Store((page.y * PagesPerRow + page.x) * 4, 1);
+}
@@ -0,0 +1,33 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Fogs the lit scene with the integrated volume at each pixel's depth.  Premultiplied alpha blending scales the
+// scene color by the transmittance and adds the scattered light.
+//
+
+#include "VolumetricLightingRS.hlsli"
+
+Texture3D<float4> IntegratedVolume : register(t0);
+Texture2D<float> LinearDepth : register(t1);
+
+SamplerState linearSampler : register(s0);
+
+[RootSignature(VolumetricLighting_RootSig)]
+float4 main( float4 Pos : SV_Position ) : SV_Target0
+{
+    // Linear depth is a fraction of the far clip, and the sky lies past the end of the volume
+    float viewDepth = LinearDepth[uint2(Pos.xy)] / RcpFarClip;
+
+    // Each slice holds the integral up to its far side
+    float3 coord;
+    coord.xy = Pos.xy / (VolumeSize.xy * TileDim);
+    coord.z = saturate(GetSliceCoord(viewDepth)) - 0.5 / VolumeSize.z;
+
+    float4 fog = IntegratedVolume.SampleLevel(linearSampler, coord, 0);
+    return float4(fog.rgb, 1.0 - fog.a);
+}
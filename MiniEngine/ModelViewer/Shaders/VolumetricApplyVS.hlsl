@@ -0,0 +1,19 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// An over-sized triangle that covers the whole viewport, without a vertex buffer.  Draw(3).
+//
+
+#include "VolumetricLightingRS.hlsli"
+
+[RootSignature(VolumetricLighting_RootSig)]
+float4 main( uint VertID : SV_VertexID ) : SV_Position
+{
+    float2 Tex = float2(uint2(VertID, VertID << 1) & 2);
+    return float4(lerp(float2(-1, 1), float2(1, -1), Tex), 0, 1);
+}
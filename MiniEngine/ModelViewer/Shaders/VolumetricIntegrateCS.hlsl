@@ -0,0 +1,46 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+// Marches each froxel column away from the camera, accumulating the light scattered toward the camera and the
+// transmittance up to the far side of every slice.  The scattering is integrated analytically across each
+// slice, so thick slices neither gain nor lose energy.
+
+#include "VolumetricLightingRS.hlsli"
+
+Texture3D<float4> ScatterVolume : register(t0);
+RWTexture3D<float4> IntegratedVolume : register(u0);
+
+[RootSignature(VolumetricLighting_RootSig)]
+[numthreads( 8, 8, 1 )]
+void main( uint3 DTid : SV_DispatchThreadID )
+{
+    if (any(DTid.xy >= VolumeSize.xy))
+        return;
+
+    // Distance along the ray per unit of view depth
+    const float rayScale = length(GetFroxelRay(DTid.xy));
+
+    float3 scattering = 0.0;
+    float transmittance = 1.0;
+    float sliceStart = NearClip;
+
+    for (uint z = 0; z < VolumeSize.z; ++z)
+    {
+        float sliceEnd = GetSliceDepth((z + 1.0) / VolumeSize.z);
+        float4 froxel = ScatterVolume[uint3(DTid.xy, z)];
+        float extinction = max(froxel.a, 1e-7);
+
+        float sliceTransmittance = exp(-extinction * (sliceEnd - sliceStart) * rayScale);
+        scattering += transmittance * (froxel.rgb - froxel.rgb * sliceTransmittance) / extinction;
+        transmittance *= sliceTransmittance;
+
+        IntegratedVolume[uint3(DTid.xy, z)] = float4(scattering, transmittance);
+        sliceStart = sliceEnd;
+    }
+}
@@ -0,0 +1,85 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+// The froxel volume has a froxel per light grid tile across and exponentially spaced depth slices between the
+// near clip and the fog's maximum distance.  The shading constants, the shadow SRV table and the light clusters
+// are bound at the color pass registers, so the sun shadow functions in SunShadow.hlsli see the same names.
+#define VolumetricLighting_RootSig \
+    "RootFlags(0), " \
+    "CBV(b0), " \
+    "CBV(b1), " \
+    "DescriptorTable(SRV(t0, numDescriptors = 2)), " \
+    "DescriptorTable(SRV(t64, numDescriptors = 13)), " \
+    "DescriptorTable(SRV(t78, numDescriptors = 2)), " \
+    "DescriptorTable(UAV(u0, numDescriptors = 1)), " \
+    "StaticSampler(s0," \
+        "addressU = TEXTURE_ADDRESS_CLAMP," \
+        "addressV = TEXTURE_ADDRESS_CLAMP," \
+        "addressW = TEXTURE_ADDRESS_CLAMP," \
+        "filter = FILTER_MIN_MAG_MIP_LINEAR)," \
+    "StaticSampler(s1," \
+        "addressU = TEXTURE_ADDRESS_CLAMP," \
+        "addressV = TEXTURE_ADDRESS_CLAMP," \
+        "addressW = TEXTURE_ADDRESS_CLAMP," \
+        "comparisonFunc = COMPARISON_GREATER_EQUAL," \
+        "filter = FILTER_MIN_MAG_LINEAR_MIP_POINT)," \
+    "StaticSampler(s2, maxAnisotropy = 8," \
+        "addressU = TEXTURE_ADDRESS_CLAMP," \
+        "addressV = TEXTURE_ADDRESS_CLAMP," \
+        "addressW = TEXTURE_ADDRESS_CLAMP)," \
+    "StaticSampler(s3," \
+        "addressU = TEXTURE_ADDRESS_WRAP," \
+        "addressV = TEXTURE_ADDRESS_WRAP," \
+        "addressW = TEXTURE_ADDRESS_CLAMP," \
+        "comparisonFunc = COMPARISON_GREATER_EQUAL," \
+        "filter = FILTER_MIN_MAG_LINEAR_MIP_POINT)"
+
+// Keep in sync with csConstants in VolumetricLighting::Render()
+cbuffer VolumeConstants : register(b1)
+{
+    float4x4 InvViewProj;
+    float4x4 PrevViewProj;      // Last frame's, to find each froxel in the history
+    float4x4 SunShadowMatrix;   // World space to sun shadow map texture space
+    float3 CameraPosition;
+    float NearClip;
+    uint3 VolumeSize;           // Froxels across, down and in depth
+    float VolumeDepthScale;     // log2(MaxDistance / NearClip)
+    float2 InvViewportSize;
+    float TileDim;              // Pixels each froxel covers across and down
+    float DepthJitter;          // Where this frame samples within each slice, in [0, 1)
+    float Density;              // Extinction per unit distance at the base height
+    float HeightFalloff;        // Decay of the density per unit of height above the base
+    float BaseHeight;
+    float Anisotropy;           // Henyey-Greenstein g, positive to scatter forward
+    float HistoryWeight;        // 0 when there is no history to blend
+    float RcpFarClip;
+};
+
+// View depth at a fraction of the volume's depth
+float GetSliceDepth( float w )
+{
+    return NearClip * exp2(w * VolumeDepthScale);
+}
+
+// Fraction of the volume's depth at a view depth
+float GetSliceCoord( float viewDepth )
+{
+    return log2(max(viewDepth, NearClip) / NearClip) / VolumeDepthScale;
+}
+
+// World space offset from the camera to the froxel column's center, per unit of view depth
+float3 GetFroxelRay( uint2 froxel )
+{
+    float2 pixel = (froxel + 0.5) * TileDim;
+    float2 ndc = pixel * InvViewportSize * float2(2.0, -2.0) + float2(-1.0, 1.0);
+
+    // Reversed z puts the near plane at 1
+    float4 nearPos = mul(InvViewProj, float4(ndc, 1.0, 1.0));
+    return (nearPos.xyz / nearPos.w - CameraPosition) / NearClip;
+}
@@ -0,0 +1,172 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+// Lights every froxel of the volume once: the sun through its shadow map, and the local lights through the
+// cluster the froxel lies in, each with a single shadow comparison.  Every frame samples a different depth
+// within the slices, and the result is blended with last frame's to smooth the jitter out over time.  Writes
+// the in-scattered light times the extinction, and the extinction.
+
+#define NO_IMPLICIT_DERIVATIVES
+#define SINGLE_SAMPLE
+
+#include "VolumetricLightingRS.hlsli"
+#include "ModelViewerConstants.hlsli"
+#include "LightGrid.hlsli"
+#include "PointShadow.hlsli"
+#include "ShadowCascades.hlsli"
+#include "ShadowMoments.hlsli"
+#include "SoftShadows.hlsli"
+
+// outdated warning about for-loop variable scope
+#pragma warning (disable: 3078)
+
+Texture3D<float4> HistoryVolume : register(t0);
+
+Texture2D<float> texShadow : register(t65);
+StructuredBuffer<LightData> lightBuffer : register(t66);
+Texture2D<float> lightShadowAtlasTex : register(t67);
+Texture2DArray<float> texSunShadowCascades : register(t70);
+StructuredBuffer<CascadeData> cascadeBuffer : register(t71);
+Texture2D<float2> texShadowMoments : register(t72);
+Texture2D<float2> texShadowDepthPyramid : register(t74);
+Texture2D<float> texVirtualShadow : register(t76);
+ByteAddressBuffer lightClusters : register(t78);
+ByteAddressBuffer lightClusterList : register(t79);
+StructuredBuffer<LightShadowData> lightShadowBuffer : register(t80);
+
+SamplerState linearSampler : register(s0);
+SamplerComparisonState shadowSampler : register(s1);
+SamplerState momentSampler : register(s2);
+SamplerComparisonState shadowWrapSampler : register(s3);
+
+RWTexture3D<float4> ScatterVolume : register(u0);
+
+#include "SunShadow.hlsli"
+
+// Fraction of the light scattered toward the camera, where cosTheta is between the directions to the light and
+// away from the camera
+float GetPhase( float cosTheta )
+{
+    const float g = Anisotropy;
+    float denom = 1.0 + g * g - 2.0 * g * cosTheta;
+    return (1.0 - g * g) / (4.0 * 3.14159265 * denom * sqrt(denom));
+}
+
+// The light a local light scatters toward the camera, before its shadow
+float3 GetLightScattering( LightData lightData, float3 worldPos, float3 viewDir, bool cone )
+{
+    float3 lightDir = lightData.pos - worldPos;
+    float lightDistSq = dot(lightDir, lightDir);
+    float invLightDist = rsqrt(lightDistSq);
+    lightDir *= invLightDist;
+
+    // The fall off of the color pass
+    float distanceFalloff = lightData.radiusSq * (invLightDist * invLightDist);
+    distanceFalloff = max(0, distanceFalloff - rsqrt(distanceFalloff));
+
+    if (cone)
+    {
+        float2 coneAngles = GetLightConeAngles(lightData);
+        distanceFalloff *= saturate((dot(-lightDir, GetLightConeDir(lightData)) - coneAngles.y) * coneAngles.x);
+    }
+
+    return GetLightColor(lightData) * (distanceFalloff * GetPhase(dot(lightDir, viewDir)));
+}
+
+float GetConeLightShadow( LightShadowData shadowData, float3 worldPos )
+{
+    float4 shadowCoord = mul(shadowData.shadowTextureMatrix, float4(worldPos, 1.0));
+    shadowCoord.xyz *= rcp(shadowCoord.w);
+    return lightShadowAtlasTex.SampleCmpLevelZero(shadowSampler, shadowCoord.xy, shadowCoord.z);
+}
+
+float GetPointLightShadow( LightData lightData, LightShadowData shadowData, float3 worldPos )
+{
+    float3 lightToPoint = worldPos - lightData.pos;
+    float4 shadowParams = shadowData.pointShadowParams;
+    uint face = GetPointShadowFace(lightToPoint, shadowParams.w != 0.0);
+    float3 faceCoord = ProjectPointShadowFace(GetPointShadowFaceView(lightToPoint, face), shadowParams);
+    float4 faceOffsets = shadowData.pointShadowFaceOffsets[face / 2];
+    float2 faceOffset = face & 1 ? faceOffsets.zw : faceOffsets.xy;
+    float2 shadowUV = (faceCoord.xy * float2(0.5, -0.5) + 0.5) * shadowParams.z + faceOffset;
+    return lightShadowAtlasTex.SampleCmpLevelZero(shadowSampler, shadowUV, faceCoord.z);
+}
+
+float3 GetClusterLightScattering( uint2 froxel, float viewDepth, float3 worldPos, float3 viewDir )
+{
+    // The froxels across are the light grid tiles, so the froxel's cluster is its tile's at its depth
+    uint4 cluster = lightClusters.Load4(GetClusterOffset(GetTileIndex(froxel, TileCount.x),
+        GetClusterSlice(viewDepth, ClusterParams.y, ClusterParams.z)));
+    uint countSphere = cluster.y & 0xffff;
+    uint countCone = cluster.y >> 16;
+    uint countConeShadowed = cluster.z & 0xffff;
+    uint countPointShadowed = cluster.z >> 16;
+
+    uint loadOffset = cluster.x * 4;
+    float3 scattering = 0.0;
+
+    for (uint n = 0; n < countSphere; n++, loadOffset += 4)
+        scattering += GetLightScattering(lightBuffer[lightClusterList.Load(loadOffset)], worldPos, viewDir, false);
+
+    for (uint n = 0; n < countCone; n++, loadOffset += 4)
+        scattering += GetLightScattering(lightBuffer[lightClusterList.Load(loadOffset)], worldPos, viewDir, true);
+
+    for (uint n = 0; n < countConeShadowed; n++, loadOffset += 4)
+    {
+        uint lightIndex = lightClusterList.Load(loadOffset);
+        LightData lightData = lightBuffer[lightIndex];
+        LightShadowData shadowData = lightShadowBuffer[lightIndex - FIRST_SHADOWED_LIGHT];
+        scattering += GetConeLightShadow(shadowData, worldPos) * GetLightScattering(lightData, worldPos, viewDir, true);
+    }
+
+    for (uint n = 0; n < countPointShadowed; n++, loadOffset += 4)
+    {
+        uint lightIndex = lightClusterList.Load(loadOffset);
+        LightData lightData = lightBuffer[lightIndex];
+        LightShadowData shadowData = lightShadowBuffer[lightIndex - FIRST_SHADOWED_LIGHT];
+        scattering += GetPointLightShadow(lightData, shadowData, worldPos) * GetLightScattering(lightData, worldPos, viewDir, false);
+    }
+
+    return scattering;
+}
+
+[RootSignature(VolumetricLighting_RootSig)]
+[numthreads( 8, 8, 1 )]
+void main( uint3 DTid : SV_DispatchThreadID )
+{
+    if (any(DTid >= VolumeSize))
+        return;
+
+    float viewDepth = GetSliceDepth((DTid.z + DepthJitter) / VolumeSize.z);
+    float3 worldPos = CameraPosition + GetFroxelRay(DTid.xy) * viewDepth;
+    float3 viewDir = normalize(worldPos - CameraPosition);
+
+    // Exponential height fog, uniform below its base
+    float extinction = Density * exp2(-HeightFalloff * max(worldPos.y - BaseHeight, 0.0));
+
+    float3 shadowCoord = mul(SunShadowMatrix, float4(worldPos, 1.0)).xyz;
+    float3 light = SunColor * (GetDirectionalShadow(shadowCoord, worldPos, viewDepth) * GetPhase(dot(SunDirection, viewDir)));
+    light += AmbientColor / (4.0 * 3.14159265);
+
+    [branch]
+    if (ClusterParams.x != 0.0)
+        light += GetClusterLightScattering(DTid.xy, viewDepth, worldPos, viewDir);
+
+    float4 result = float4(light * extinction, extinction);
+
+    // The history is sampled where this froxel's point was last frame
+    float4 prevClip = mul(PrevViewProj, float4(worldPos, 1.0));
+    float2 prevPixel = (prevClip.xy / prevClip.w * float2(0.5, -0.5) + 0.5) / InvViewportSize;
+    float3 prevCoord = float3(prevPixel / (VolumeSize.xy * TileDim), GetSliceCoord(prevClip.w));
+
+    if (HistoryWeight > 0.0 && prevClip.w > 0.0 && all(prevCoord == saturate(prevCoord)))
+        result = lerp(result, HistoryVolume.SampleLevel(linearSampler, prevCoord, 0), HistoryWeight);
+
+    ScatterVolume[DTid] = result;
+}
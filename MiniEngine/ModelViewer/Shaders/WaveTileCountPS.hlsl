@@ -26,17 +26,17 @@ struct VSOutput
     sample float3 bitangent : bitangent;
 };
 
-Texture2D<float3> texDiffuse        : register(t0);
-Texture2D<float3> texSpecular        : register(t1);
-//Texture2D<float4> texEmissive        : register(t2);
-Texture2D<float3> texNormal            : register(t3);
-//Texture2D<float4> texLightmap        : register(t4);
-//Texture2D<float4> texReflection    : register(t5);
+Texture2DArray<float3> texDiffuse        : register(t0);
+Texture2DArray<float3> texSpecular        : register(t1);
+//Texture2DArray<float4> texEmissive        : register(t2);
+Texture2DArray<float3> texNormal            : register(t3);
+//Texture2DArray<float4> texLightmap        : register(t4);
+//Texture2DArray<float4> texReflection    : register(t5);
 Texture2D<float> texSSAO            : register(t64);
 Texture2D<float> texShadow            : register(t65);
 
 StructuredBuffer<LightData> lightBuffer : register(t66);
-Texture2DArray<float> lightShadowArrayTex : register(t67);
+Texture2D<float> lightShadowAtlasTex : register(t67);
 ByteAddressBuffer lightGrid : register(t68);
 
 cbuffer PSConstants : register(b0)
@@ -61,9 +61,9 @@ float3 main(VSOutput vsOutput) : SV_Target0
     uint tileIndex = GetTileIndex(tilePos, TileCount.x);
     uint tileOffset = GetTileOffset(tileIndex);
 
-    // There are three counts in one UINT
-    uint tileLightCount = lightGrid.Load(tileOffset + 0);
-    tileLightCount = (tileLightCount & 0xFF) + ((tileLightCount >> 8) & 0xFF) + ((tileLightCount >> 16) & 0xFF);
+    // There are four counts in the second UINT of the tile header
+    uint tileLightCount = lightGrid.Load(tileOffset + 4);
+    tileLightCount = (tileLightCount & 0xFF) + ((tileLightCount >> 8) & 0xFF) + ((tileLightCount >> 16) & 0xFF) + ((tileLightCount >> 24) & 0xFF);
 
     return lerp(float3(0, 1, 0), float3(1, 0, 0), tileLightCount / 32.0);
 }
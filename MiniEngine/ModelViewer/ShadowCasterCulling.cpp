@@ -0,0 +1,382 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "ShadowCasterCulling.h"
+#include "PipelineState.h"
+#include "RootSignature.h"
+#include "CommandContext.h"
+#include "CommandSignature.h"
+#include "BufferManager.h"
+#include "DynamicResolution.h"
+#include "Camera.h"
+#include "CascadedShadowCamera.h"
+#include "Model.h"
+#include "./ForwardPlusLighting.h"
+#include "./VirtualShadowMap.h"
+#include "./DrawStatistics.h"
+#include <algorithm>
+
+#include "CompiledShaders/ShadowCasterCullCS.h"
+#include "CompiledShaders/ShadowReceiverMaskCS.h"
+
+using namespace Math;
+using namespace Graphics;
+
+// must keep in sync with HLSL
+struct MeshInfo
+{
+    XMFLOAT3 BoundsMin;
+    uint32_t IndexCount;
+    XMFLOAT3 BoundsMax;
+    uint32_t StartIndex;
+    uint32_t BaseVertex;        // In the depth-only vertex stream
+    uint32_t MaterialIndex;
+    uint32_t Pad[2];
+    XMFLOAT4 Sphere;
+    XMFLOAT4 Cone;
+};
+
+struct DrawCommand
+{
+    uint32_t BaseVertex;
+    uint32_t MaterialIndex;
+    uint32_t ViewMask;
+    D3D12_DRAW_INDEXED_ARGUMENTS DrawArgs;
+};
+
+namespace ShadowCasterCulling
+{
+    BoolVar Enable("Application/Lighting/GPU Caster Culling", true);
+    BoolVar ReceiverCulling("Application/Lighting/Cull Casters Without Receivers", true);
+    BoolVar MeshletCulling("Application/Lighting/Cull Caster Meshlets", true);
+
+    RootSignature m_CullRootSig;
+    ComputePSO m_CullCS;
+    CommandSignature m_DrawCommandSignature(2);
+
+    StructuredBuffer m_MeshBuffer;
+    StructuredBuffer m_DrawCommandBuffer;
+    uint32_t m_NumMeshes = 0;
+    uint64_t m_NumMeshTriangles = 0;
+
+    // The draw count of every slot, followed by the triangles of every slot's draws.  Draws read the counts, and
+    // the draw statistics copy the triangles.
+    ByteAddressBuffer m_DrawCountBuffer;
+    const D3D12_RESOURCE_STATES kDrawCountState = D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT | D3D12_RESOURCE_STATE_COPY_SOURCE;
+
+    // Meshlets of the opaque meshes
+    StructuredBuffer m_MeshletBuffer;
+    uint32_t m_NumMeshlets = 0;
+    uint64_t m_NumMeshletTriangles = 0;
+
+    // Every slot has room for a draw per mesh or per meshlet
+    uint32_t m_MaxDrawsPerSlot = 0;
+
+    // The candidates culled into each slot and their triangles in all of its views
+    uint32_t m_SlotCandidates[kMaxViews];
+    uint64_t m_SlotTriangles[kMaxViews];
+
+    RootSignature m_ReceiverRootSig;
+    ComputePSO m_ReceiverMaskCS;
+    // Per grid cell, the smallest light space depth of any visible receiver, or ~0 for none
+    ByteAddressBuffer m_ReceiverDepth;
+    Matrix4 m_ReceiverViewProj;
+
+    void Cull(GraphicsContext& gfxContext, uint32_t ViewStride, uint32_t NumViews, uint32_t FirstSlot, bool MultiView,
+        bool TestReceivers, const Vector4* LightOrigin);
+}
+
+void ShadowCasterCulling::InitializeResources( const RootSignature& DrawRootSig, const Model& model, const std::vector<bool>& MaterialIsCutout )
+{
+    static_assert(kMaxViews >= GameCore::CascadedShadowCamera::kMaxCascades + Lighting::MaxShadowedLights +
+        VirtualShadowMap::kMaxPageUpdates, "Every sun cascade, light, and virtual shadow page update needs a slot");
+
+    m_CullRootSig.Reset(5, 0);
+    m_CullRootSig[0].InitAsConstantBuffer(0);
+    m_CullRootSig[1].InitAsBufferSRV(0);
+    m_CullRootSig[2].InitAsBufferSRV(1);
+    m_CullRootSig[3].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 0, 2);
+    m_CullRootSig[4].InitAsBufferSRV(2);
+    m_CullRootSig.Finalize(L"Shadow Caster Culling");
+
+    m_CullCS.SetRootSignature(m_CullRootSig);
+    m_CullCS.SetComputeShader(g_pShadowCasterCullCS, sizeof(g_pShadowCasterCullCS));
+    m_CullCS.Finalize();
+
+    m_ReceiverRootSig.Reset(3, 0);
+    m_ReceiverRootSig[0].InitAsConstantBuffer(0);
+    m_ReceiverRootSig[1].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 0, 1);
+    m_ReceiverRootSig[2].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 0, 1);
+    m_ReceiverRootSig.Finalize(L"Shadow Receiver Mask");
+
+    m_ReceiverMaskCS.SetRootSignature(m_ReceiverRootSig);
+    m_ReceiverMaskCS.SetComputeShader(g_pShadowReceiverMaskCS, sizeof(g_pShadowReceiverMaskCS));
+    m_ReceiverMaskCS.Finalize();
+
+    m_ReceiverDepth.Create(L"Shadow Receiver Depth", kReceiverGridSize * kReceiverGridSize, sizeof(uint32_t));
+
+    // Matches the root constants that DrawObjects() sets for the depth vertex shaders
+    m_DrawCommandSignature[0].Constant(4, 0, 3);
+    m_DrawCommandSignature[1].DrawIndexed();
+    m_DrawCommandSignature.Finalize(&DrawRootSig);
+
+    auto MakeMeshInfo = [&model]( const Model::Mesh& mesh )
+    {
+        MeshInfo Info;
+        XMStoreFloat3(&Info.BoundsMin, mesh.boundingBox.min);
+        XMStoreFloat3(&Info.BoundsMax, mesh.boundingBox.max);
+        Info.IndexCount = mesh.indexCount;
+        Info.StartIndex = model.GetStartIndex(mesh.indexDataByteOffset);
+        Info.BaseVertex = model.GetBaseVertex(mesh, true);
+        Info.MaterialIndex = mesh.materialIndex;
+        Info.Pad[0] = Info.Pad[1] = 0;
+
+        // Whole meshes are never back facing
+        Vector3 Center = (mesh.boundingBox.min + mesh.boundingBox.max) * 0.5f;
+        XMStoreFloat4(&Info.Sphere, Vector4(Center, Length(mesh.boundingBox.max - Center)));
+        Info.Cone = XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f);
+        return Info;
+    };
+
+    std::vector<MeshInfo> Meshes;
+    Meshes.reserve(model.m_Header.meshCount);
+
+    for (uint32_t meshIndex = 0; meshIndex < model.m_Header.meshCount; meshIndex++)
+    {
+        const Model::Mesh& mesh = model.m_pMesh[meshIndex];
+        if (MaterialIsCutout[mesh.materialIndex])
+            continue;
+
+        Meshes.push_back(MakeMeshInfo(mesh));
+        m_NumMeshTriangles += mesh.indexCount / 3;
+    }
+
+    // Meshlets are bounded by their spheres and draw their part of the mesh's depth-only indices
+    std::vector<MeshInfo> Meshlets;
+    Meshlets.reserve(model.m_MeshletCount);
+
+    for (uint32_t meshletIndex = 0; meshletIndex < model.m_MeshletCount; meshletIndex++)
+    {
+        const Model::Meshlet& meshlet = model.m_pMeshlet[meshletIndex];
+        const Model::Mesh& mesh = model.m_pMesh[meshlet.meshIndex];
+        if (MaterialIsCutout[mesh.materialIndex])
+            continue;
+
+        MeshInfo Info = MakeMeshInfo(mesh);
+        Vector3 Center(meshlet.center[0], meshlet.center[1], meshlet.center[2]);
+        XMStoreFloat3(&Info.BoundsMin, Center - Scalar(meshlet.radius));
+        XMStoreFloat3(&Info.BoundsMax, Center + Scalar(meshlet.radius));
+        Info.IndexCount = meshlet.indexCount;
+        Info.StartIndex += meshlet.indexOffset;
+        Info.Sphere = XMFLOAT4(meshlet.center[0], meshlet.center[1], meshlet.center[2], meshlet.radius);
+        Info.Cone = XMFLOAT4(meshlet.coneAxis[0], meshlet.coneAxis[1], meshlet.coneAxis[2], meshlet.coneCutoff);
+        Meshlets.push_back(Info);
+        m_NumMeshletTriangles += meshlet.indexCount / 3;
+    }
+
+    m_NumMeshes = (uint32_t)Meshes.size();
+    m_NumMeshlets = (uint32_t)Meshlets.size();
+    m_MaxDrawsPerSlot = std::max(m_NumMeshes, m_NumMeshlets);
+    if (m_NumMeshes == 0)
+        return;
+
+    m_MeshBuffer.Create(L"Shadow Caster Meshes", m_NumMeshes, sizeof(MeshInfo), Meshes.data());
+    if (m_NumMeshlets > 0)
+        m_MeshletBuffer.Create(L"Shadow Caster Meshlets", m_NumMeshlets, sizeof(MeshInfo), Meshlets.data());
+    m_DrawCommandBuffer.Create(L"Shadow Caster Draws", kMaxViews * m_MaxDrawsPerSlot, sizeof(DrawCommand));
+    m_DrawCountBuffer.Create(L"Shadow Caster Draw Counts", 2 * kMaxViews, sizeof(uint32_t));
+}
+
+void ShadowCasterCulling::Shutdown( void )
+{
+    m_DrawCommandSignature.Destroy();
+    m_MeshBuffer.Destroy();
+    m_MeshletBuffer.Destroy();
+    m_DrawCommandBuffer.Destroy();
+    m_DrawCountBuffer.Destroy();
+    m_ReceiverDepth.Destroy();
+    m_NumMeshes = 0;
+    m_NumMeshlets = 0;
+    m_NumMeshTriangles = 0;
+    m_NumMeshletTriangles = 0;
+    m_MaxDrawsPerSlot = 0;
+}
+
+void ShadowCasterCulling::FindReceivers( GraphicsContext& gfxContext, const Camera& Camera, const Matrix4& ReceiverViewProj )
+{
+    ScopedTimer _prof(L"Find Shadow Receivers", gfxContext);
+
+    m_ReceiverViewProj = ReceiverViewProj;
+
+    const uint32_t Width = DynamicResolution::GetWidth();
+    const uint32_t Height = DynamicResolution::GetHeight();
+
+    __declspec(align(16)) struct
+    {
+        Matrix4 ClipToReceiver;
+        uint32_t ViewportSize[2];
+        uint32_t GridSize;
+    } csConstants;
+    csConstants.ClipToReceiver = ReceiverViewProj * Invert(Camera.GetViewProjMatrix());
+    csConstants.ViewportSize[0] = Width;
+    csConstants.ViewportSize[1] = Height;
+    csConstants.GridSize = kReceiverGridSize;
+
+    ComputeContext& Context = gfxContext.GetComputeContext();
+
+    Context.TransitionResource(m_ReceiverDepth, D3D12_RESOURCE_STATE_COPY_DEST, true);
+    Context.FillBuffer(m_ReceiverDepth, 0, 0xFFFFFFFFu, m_ReceiverDepth.GetBufferSize());
+
+    Context.TransitionResource(m_ReceiverDepth, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    Context.TransitionResource(g_SceneDepthBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, true);
+
+    Context.SetRootSignature(m_ReceiverRootSig);
+    Context.SetPipelineState(m_ReceiverMaskCS);
+    Context.SetDynamicConstantBufferView(0, sizeof(csConstants), &csConstants);
+    Context.SetDynamicDescriptor(1, 0, g_SceneDepthBuffer.GetDepthSRV());
+    Context.SetDynamicDescriptor(2, 0, m_ReceiverDepth.GetUAV());
+    Context.Dispatch2D(Width, Height, 8, 8);
+
+    Context.TransitionResource(m_ReceiverDepth, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+}
+
+void ShadowCasterCulling::CullViews( GraphicsContext& gfxContext, const GpuBuffer& Views, uint32_t ViewStride,
+    uint32_t NumViews, uint32_t FirstSlot, bool TestReceivers )
+{
+    if (m_NumMeshes == 0)
+        return;
+
+    gfxContext.GetComputeContext().SetRootSignature(m_CullRootSig);
+    gfxContext.GetComputeContext().SetBufferSRV(2, Views);
+    Cull(gfxContext, ViewStride, NumViews, FirstSlot, false, TestReceivers, nullptr);
+}
+
+void ShadowCasterCulling::CullViews( GraphicsContext& gfxContext, const Matrix4* Views, uint32_t NumViews, uint32_t FirstSlot )
+{
+    if (m_NumMeshes == 0)
+        return;
+
+    gfxContext.GetComputeContext().SetRootSignature(m_CullRootSig);
+    gfxContext.GetComputeContext().SetDynamicSRV(2, sizeof(Matrix4) * NumViews, Views);
+    Cull(gfxContext, sizeof(Matrix4), NumViews, FirstSlot, false, false, nullptr);
+}
+
+void ShadowCasterCulling::CullMultiView( GraphicsContext& gfxContext, const GpuBuffer& Views, uint32_t ViewStride,
+    uint32_t NumViews, uint32_t Slot, bool TestReceivers, const Vector4* LightOrigin )
+{
+    if (m_NumMeshes == 0)
+        return;
+
+    gfxContext.GetComputeContext().SetRootSignature(m_CullRootSig);
+    gfxContext.GetComputeContext().SetBufferSRV(2, Views);
+    Cull(gfxContext, ViewStride, NumViews, Slot, true, TestReceivers, LightOrigin);
+}
+
+void ShadowCasterCulling::CullMultiView( GraphicsContext& gfxContext, const Matrix4* Views, uint32_t NumViews, uint32_t Slot,
+    const Vector4* LightOrigin )
+{
+    if (m_NumMeshes == 0)
+        return;
+
+    gfxContext.GetComputeContext().SetRootSignature(m_CullRootSig);
+    gfxContext.GetComputeContext().SetDynamicSRV(2, sizeof(Matrix4) * NumViews, Views);
+    Cull(gfxContext, sizeof(Matrix4), NumViews, Slot, true, false, LightOrigin);
+}
+
+void ShadowCasterCulling::Cull( GraphicsContext& gfxContext, uint32_t ViewStride, uint32_t NumViews, uint32_t FirstSlot, bool MultiView,
+    bool TestReceivers, const Vector4* LightOrigin )
+{
+    ScopedTimer _prof(L"Cull Shadow Casters", gfxContext);
+
+    ASSERT(NumViews > 0);
+    ASSERT(MultiView ? NumViews <= 32 && FirstSlot < kMaxViews : FirstSlot + NumViews <= kMaxViews);
+
+    const uint32_t NumSlots = MultiView ? 1 : NumViews;
+
+    // Meshlets index the depth-only stream, which every caster draw uses
+    const bool UseMeshlets = MeshletCulling && m_NumMeshlets > 0;
+    const uint32_t NumItems = UseMeshlets ? m_NumMeshlets : m_NumMeshes;
+
+    __declspec(align(16)) struct
+    {
+        uint32_t NumMeshes;
+        uint32_t ViewStride;
+        uint32_t FirstSlot;
+        uint32_t NumViews;
+        uint32_t MultiView;
+        uint32_t SlotStride;
+        uint32_t ConeTest;
+        uint32_t TriangleCountOffset;
+        Matrix4 ReceiverViewProj;
+        uint32_t ReceiverGridSize;
+        uint32_t ReceiverTest;
+        Vector4 LightOrigin;
+    } csConstants;
+    csConstants.NumMeshes = NumItems;
+    csConstants.ViewStride = ViewStride;
+    csConstants.FirstSlot = FirstSlot;
+    csConstants.NumViews = NumViews;
+    csConstants.MultiView = MultiView ? 1u : 0u;
+    csConstants.SlotStride = m_MaxDrawsPerSlot;
+    csConstants.ConeTest = UseMeshlets && LightOrigin != nullptr ? 1u : 0u;
+    csConstants.TriangleCountOffset = kMaxViews * sizeof(uint32_t);
+    csConstants.ReceiverViewProj = m_ReceiverViewProj;
+    csConstants.ReceiverGridSize = kReceiverGridSize;
+    csConstants.ReceiverTest = TestReceivers && ReceiverCulling ? 1u : 0u;
+    csConstants.LightOrigin = Vector4(kZero);
+    if (LightOrigin != nullptr)
+    {
+        // The cone test wants a unit light direction
+        csConstants.LightOrigin = *LightOrigin;
+        if ((float)LightOrigin->GetW() == 0.0f)
+            csConstants.LightOrigin = Vector4(Normalize(Vector3(*LightOrigin)), 0.0f);
+    }
+
+    ComputeContext& Context = gfxContext.GetComputeContext();
+
+    // Only reset the counts of the slots being culled so that other slots keep their draws
+    Context.TransitionResource(m_DrawCountBuffer, D3D12_RESOURCE_STATE_COPY_DEST, true);
+    Context.FillBuffer(m_DrawCountBuffer, FirstSlot * sizeof(uint32_t), 0.0f, NumSlots * sizeof(uint32_t));
+    Context.FillBuffer(m_DrawCountBuffer, (kMaxViews + FirstSlot) * sizeof(uint32_t), 0.0f, NumSlots * sizeof(uint32_t));
+
+    Context.TransitionResource(m_DrawCountBuffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    Context.TransitionResource(m_DrawCommandBuffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, true);
+
+    Context.SetPipelineState(m_CullCS);
+    Context.SetDynamicConstantBufferView(0, sizeof(csConstants), &csConstants);
+    Context.SetBufferSRV(1, UseMeshlets ? m_MeshletBuffer : m_MeshBuffer);
+    Context.TransitionResource(m_ReceiverDepth, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    Context.SetBufferSRV(4, m_ReceiverDepth);
+    Context.SetDynamicDescriptor(3, 0, m_DrawCommandBuffer.GetUAV());
+    Context.SetDynamicDescriptor(3, 1, m_DrawCountBuffer.GetUAV());
+    Context.Dispatch(Math::DivideByMultiple(NumItems, 64), NumSlots, 1);
+
+    Context.TransitionResource(m_DrawCommandBuffer, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT);
+    Context.TransitionResource(m_DrawCountBuffer, kDrawCountState);
+
+    // A multi-view slot's candidates may be drawn in each of its views
+    const uint64_t ItemTriangles = UseMeshlets ? m_NumMeshletTriangles : m_NumMeshTriangles;
+    for (uint32_t Slot = FirstSlot; Slot < FirstSlot + NumSlots; ++Slot)
+    {
+        m_SlotCandidates[Slot] = NumItems;
+        m_SlotTriangles[Slot] = ItemTriangles * (MultiView ? NumViews : 1);
+    }
+}
+
+void ShadowCasterCulling::DrawCasters( GraphicsContext& gfxContext, uint32_t Slot )
+{
+    if (m_NumMeshes == 0)
+        return;
+
+    gfxContext.ExecuteIndirect(m_DrawCommandSignature, m_DrawCommandBuffer, Slot * m_MaxDrawsPerSlot * sizeof(DrawCommand),
+        m_MaxDrawsPerSlot, &m_DrawCountBuffer, Slot * sizeof(uint32_t));
+
+    DrawStatistics::AddCulledDraws(gfxContext, m_SlotCandidates[Slot], m_SlotTriangles[Slot], m_DrawCountBuffer,
+        (kMaxViews + Slot) * sizeof(uint32_t));
+}
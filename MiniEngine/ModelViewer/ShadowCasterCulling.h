@@ -0,0 +1,75 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+class Model;
+class RootSignature;
+class GpuBuffer;
+class GraphicsContext;
+class BoolVar;
+namespace Math
+{
+    class Vector4;
+    class Matrix4;
+    class Camera;
+}
+
+// Culls the opaque shadow casters against many shadow views at once on the GPU and draws the
+// survivors with ExecuteIndirect.  Each view is assigned a slot; the draws culled into a slot stay
+// valid until that slot is culled again.  Alpha tested casters need per-material descriptors, which
+// indirect draws cannot change, so they are still drawn from the CPU.  The culled draws use the model's
+// depth-only vertex stream, and when the model has meshlets they draw meshlets rather than whole meshes.
+namespace ShadowCasterCulling
+{
+    extern BoolVar Enable;
+    extern BoolVar ReceiverCulling;
+    extern BoolVar MeshletCulling;
+
+    enum { kMaxViews = 168 };
+
+    // Resolution of the light space grid of visible receivers
+    enum { kReceiverGridSize = 128 };
+
+    // The command signature sets the root constants of DrawRootSig, so draws must use that root signature
+    void InitializeResources(const RootSignature& DrawRootSig, const Model& model, const std::vector<bool>& MaterialIsCutout);
+    void Shutdown(void);
+
+    // Records which parts of the sun's light space hold receivers visible in g_SceneDepthBuffer, for culls
+    // that pass TestReceivers.  ReceiverViewProj is a sun shadow projection that frames the scene.  The
+    // depth pre-pass must be complete, and the result is only valid for views rendered this frame.
+    void FindReceivers(GraphicsContext& gfxContext, const Math::Camera& Camera, const Math::Matrix4& ReceiverViewProj);
+
+    // Cull against view-projection matrices stored ViewStride bytes apart in a GPU buffer, which must be
+    // readable as a non-pixel shader resource.  With TestReceivers, casters whose shadow falls on no
+    // receiver found by FindReceivers() are culled as well.
+    void CullViews(GraphicsContext& gfxContext, const GpuBuffer& Views, uint32_t ViewStride,
+        uint32_t NumViews, uint32_t FirstSlot, bool TestReceivers = false);
+
+    // Cull against view-projection matrices from the CPU
+    void CullViews(GraphicsContext& gfxContext, const Math::Matrix4* Views, uint32_t NumViews, uint32_t FirstSlot);
+
+    // Cull against up to 32 views that are rendered together, writing one draw per visible mesh (or meshlet)
+    // into a single slot.  Each draw has an instance for every view that sees it, with the views passed
+    // as a bit mask in the third root constant.
+    // Given the light, meshlets whose triangles all face away from it are culled too.  LightOrigin holds
+    // the light's position with w = 1, or the direction its light travels with w = 0.
+    void CullMultiView(GraphicsContext& gfxContext, const GpuBuffer& Views, uint32_t ViewStride,
+        uint32_t NumViews, uint32_t Slot, bool TestReceivers = false, const Math::Vector4* LightOrigin = nullptr);
+
+    // Multi-view culling against view-projection matrices from the CPU
+    void CullMultiView(GraphicsContext& gfxContext, const Math::Matrix4* Views, uint32_t NumViews, uint32_t Slot,
+        const Math::Vector4* LightOrigin = nullptr);
+
+    // Draw the casters that survived culling for one slot with the currently bound shadow PSO
+    void DrawCasters(GraphicsContext& gfxContext, uint32_t Slot);
+}
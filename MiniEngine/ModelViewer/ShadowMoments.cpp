@@ -0,0 +1,132 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "ShadowMoments.h"
+#include "PipelineState.h"
+#include "RootSignature.h"
+#include "CommandContext.h"
+#include "ColorBuffer.h"
+#include "ShadowBuffer.h"
+
+#include "CompiledShaders/ShadowMomentsCS.h"
+
+using namespace Graphics;
+
+// must keep in sync with ShadowMoments.hlsli
+static const float kSunMomentExponent = 40.0f;
+static const float kLightMomentExponent = 5.54f;
+
+namespace ShadowMoments
+{
+    BoolVar Enable("Application/Lighting/Moment Shadows/Enable", false);
+    NumVar LightBleedReduction("Application/Lighting/Moment Shadows/Light Bleed Reduction", 0.2f, 0.0f, 0.9f, 0.05f);
+
+    ColorBuffer m_SunMoments;
+    ColorBuffer m_LightAtlasMoments;
+
+    RootSignature m_RootSig;
+    ComputePSO m_MomentsCS;
+
+    void Convert(ComputeContext& Context, uint32_t X, uint32_t Y, uint32_t Width, uint32_t Height, float Exponent);
+}
+
+void ShadowMoments::InitializeResources( const ShadowBuffer& SunShadowMap, const ShadowBuffer& LightAtlas )
+{
+    m_RootSig.Reset(3, 0);
+    m_RootSig[0].InitAsConstantBuffer(0);
+    m_RootSig[1].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 0, 1);
+    m_RootSig[2].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 0, 1);
+    m_RootSig.Finalize(L"Shadow Moments");
+
+    m_MomentsCS.SetRootSignature(m_RootSig);
+    m_MomentsCS.SetComputeShader(g_pShadowMomentsCS, sizeof(g_pShadowMomentsCS));
+    m_MomentsCS.Finalize();
+
+    // The sun exponent needs full float precision.  The atlas is much larger, so it trades a smaller
+    // exponent (and more light bleeding) for half the memory.
+    ResizeSunMoments(SunShadowMap);
+    m_LightAtlasMoments.Create(L"Light Shadow Atlas Moments", (uint32_t)LightAtlas.GetWidth(), (uint32_t)LightAtlas.GetHeight(),
+        1, DXGI_FORMAT_R16G16_FLOAT);
+}
+
+void ShadowMoments::ResizeSunMoments( const ShadowBuffer& SunShadowMap )
+{
+    m_SunMoments.Create(L"Sun Shadow Moments", (uint32_t)SunShadowMap.GetWidth(), (uint32_t)SunShadowMap.GetHeight(),
+        0, DXGI_FORMAT_R32G32_FLOAT);
+}
+
+void ShadowMoments::Shutdown( void )
+{
+    m_SunMoments.Destroy();
+    m_LightAtlasMoments.Destroy();
+}
+
+void ShadowMoments::ConvertSunShadow( ComputeContext& Context, ShadowBuffer& SunShadowMap )
+{
+    ScopedTimer _prof(L"Sun Shadow Moments", Context);
+
+    Context.SetRootSignature(m_RootSig);
+    Context.SetPipelineState(m_MomentsCS);
+    Context.TransitionResource(SunShadowMap, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    Context.TransitionResource(m_SunMoments, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, true);
+    Context.SetDynamicDescriptor(1, 0, SunShadowMap.GetSRV());
+    Context.SetDynamicDescriptor(2, 0, m_SunMoments.GetUAV());
+
+    Convert(Context, 0, 0, (uint32_t)SunShadowMap.GetWidth(), (uint32_t)SunShadowMap.GetHeight(), kSunMomentExponent);
+
+    m_SunMoments.GenerateMipMaps(Context);
+    Context.TransitionResource(m_SunMoments, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+}
+
+void ShadowMoments::ConvertLightTiles( ComputeContext& Context, ShadowBuffer& LightAtlas,
+    const ShadowAtlasAllocator::Tile* Tiles, uint32_t NumTiles )
+{
+    if (NumTiles == 0)
+        return;
+
+    ScopedTimer _prof(L"Light Shadow Moments", Context);
+
+    Context.SetRootSignature(m_RootSig);
+    Context.SetPipelineState(m_MomentsCS);
+    Context.TransitionResource(LightAtlas, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    Context.TransitionResource(m_LightAtlasMoments, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, true);
+    Context.SetDynamicDescriptor(1, 0, LightAtlas.GetSRV());
+    Context.SetDynamicDescriptor(2, 0, m_LightAtlasMoments.GetUAV());
+
+    // Tiles never overlap, so the dispatches need no barriers between them
+    for (uint32_t i = 0; i < NumTiles; ++i)
+    {
+        if (Tiles[i].Size > 0)
+            Convert(Context, Tiles[i].X, Tiles[i].Y, Tiles[i].Size, Tiles[i].Size, kLightMomentExponent);
+    }
+
+    Context.TransitionResource(m_LightAtlasMoments, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+}
+
+void ShadowMoments::Convert( ComputeContext& Context, uint32_t X, uint32_t Y, uint32_t Width, uint32_t Height, float Exponent )
+{
+    __declspec(align(16)) struct
+    {
+        int32_t SrcMin[2];
+        int32_t SrcMax[2];
+        uint32_t DstOffset[2];
+        float Exponent;
+    } csConstants;
+
+    csConstants.SrcMin[0] = (int32_t)X;
+    csConstants.SrcMin[1] = (int32_t)Y;
+    csConstants.SrcMax[0] = (int32_t)(X + Width - 1);
+    csConstants.SrcMax[1] = (int32_t)(Y + Height - 1);
+    csConstants.DstOffset[0] = X;
+    csConstants.DstOffset[1] = Y;
+    csConstants.Exponent = Exponent;
+
+    Context.SetDynamicConstantBufferView(0, sizeof(csConstants), &csConstants);
+    Context.Dispatch2D(Width, Height, 8, 8);
+}
@@ -0,0 +1,46 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#pragma once
+
+#include <cstdint>
+#include "ShadowAtlasAllocator.h"
+
+class ColorBuffer;
+class ShadowBuffer;
+class ComputeContext;
+class BoolVar;
+class NumVar;
+
+// Optional exponential variance representation of the sun shadow map and the cone light shadow
+// atlas.  Depth is converted to prefiltered moments after rendering so that the color pass can
+// replace its PCF kernel with a single filtered fetch.  The sun map gets a full mip chain and is
+// sampled anisotropically; the atlas keeps one mip so that tiles never filter into each other.
+namespace ShadowMoments
+{
+    extern BoolVar Enable;
+    extern NumVar LightBleedReduction;
+
+    extern ColorBuffer m_SunMoments;
+    extern ColorBuffer m_LightAtlasMoments;
+
+    // Sized after the sun shadow map and the light atlas, so call after Lighting::InitializeResources()
+    void InitializeResources(const ShadowBuffer& SunShadowMap, const ShadowBuffer& LightAtlas);
+    void Shutdown(void);
+
+    // Recreates the sun moments after the sun shadow map is resized.  The GPU must be idle.
+    void ResizeSunMoments(const ShadowBuffer& SunShadowMap);
+
+    // Converts and blurs a whole sun shadow map, then rebuilds the mip chain
+    void ConvertSunShadow(ComputeContext& Context, ShadowBuffer& SunShadowMap);
+
+    // Converts and blurs tiles of the light atlas.  Each tile only reads its own texels.
+    void ConvertLightTiles(ComputeContext& Context, ShadowBuffer& LightAtlas,
+        const ShadowAtlasAllocator::Tile* Tiles, uint32_t NumTiles);
+}
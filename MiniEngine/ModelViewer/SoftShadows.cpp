@@ -0,0 +1,121 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "SoftShadows.h"
+#include "PipelineState.h"
+#include "RootSignature.h"
+#include "CommandContext.h"
+#include "ColorBuffer.h"
+#include "ShadowBuffer.h"
+
+#include "CompiledShaders/ShadowDepthPyramidCS.h"
+
+using namespace Graphics;
+
+// must keep in sync with SoftShadows.hlsli
+enum { kPyramidLevels = 4, kPyramidBlockSize = 16 };
+
+namespace SoftShadows
+{
+    BoolVar Enable("Application/Lighting/Soft Shadows/Enable", false);
+    IntVar BlockerSamples("Application/Lighting/Soft Shadows/Blocker Search Samples", 16, 4, 64, 4);
+    IntVar FilterSamples("Application/Lighting/Soft Shadows/Filter Samples", 24, 4, 64, 4);
+    NumVar SunAngularDiameter("Application/Lighting/Soft Shadows/Sun Angular Diameter", 0.53f, 0.05f, 5.0f, 0.05f);
+    NumVar ConeLightSize("Application/Lighting/Soft Shadows/Cone Light Size", 0.004f, 0.0f, 0.05f, 0.0005f);
+    NumVar MaxSearchRadius("Application/Lighting/Soft Shadows/Max Search Radius (texels)", 16.0f, 1.0f, 24.0f, 1.0f);
+
+    ColorBuffer m_SunDepthPyramid;
+    ColorBuffer m_LightAtlasDepthPyramid;
+
+    RootSignature m_RootSig;
+    ComputePSO m_PyramidCS;
+
+    void BuildPyramid(ComputeContext& Context, ColorBuffer& Pyramid, uint32_t X, uint32_t Y, uint32_t Width, uint32_t Height);
+}
+
+void SoftShadows::InitializeResources( const ShadowBuffer& SunShadowMap, const ShadowBuffer& LightAtlas )
+{
+    m_RootSig.Reset(3, 0);
+    m_RootSig[0].InitAsConstants(0, 2);
+    m_RootSig[1].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 0, 1);
+    m_RootSig[2].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 0, kPyramidLevels);
+    m_RootSig.Finalize(L"Shadow Depth Pyramid");
+
+    m_PyramidCS.SetRootSignature(m_RootSig);
+    m_PyramidCS.SetComputeShader(g_pShadowDepthPyramidCS, sizeof(g_pShadowDepthPyramidCS));
+    m_PyramidCS.Finalize();
+
+    ResizeSunPyramid(SunShadowMap);
+    m_LightAtlasDepthPyramid.Create(L"Light Shadow Atlas Depth Pyramid", (uint32_t)LightAtlas.GetWidth() / 2,
+        (uint32_t)LightAtlas.GetHeight() / 2, kPyramidLevels, DXGI_FORMAT_R32G32_FLOAT);
+}
+
+void SoftShadows::ResizeSunPyramid( const ShadowBuffer& SunShadowMap )
+{
+    m_SunDepthPyramid.Create(L"Sun Shadow Depth Pyramid", (uint32_t)SunShadowMap.GetWidth() / 2,
+        (uint32_t)SunShadowMap.GetHeight() / 2, kPyramidLevels, DXGI_FORMAT_R32G32_FLOAT);
+}
+
+void SoftShadows::Shutdown( void )
+{
+    m_SunDepthPyramid.Destroy();
+    m_LightAtlasDepthPyramid.Destroy();
+}
+
+void SoftShadows::BuildSunPyramid( ComputeContext& Context, ShadowBuffer& SunShadowMap )
+{
+    ScopedTimer _prof(L"Sun Shadow Depth Pyramid", Context);
+
+    Context.SetRootSignature(m_RootSig);
+    Context.SetPipelineState(m_PyramidCS);
+    Context.TransitionResource(SunShadowMap, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    Context.TransitionResource(m_SunDepthPyramid, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, true);
+    Context.SetDynamicDescriptor(1, 0, SunShadowMap.GetSRV());
+
+    BuildPyramid(Context, m_SunDepthPyramid, 0, 0, (uint32_t)SunShadowMap.GetWidth(), (uint32_t)SunShadowMap.GetHeight());
+
+    Context.TransitionResource(m_SunDepthPyramid, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+}
+
+void SoftShadows::BuildLightTilePyramids( ComputeContext& Context, ShadowBuffer& LightAtlas,
+    const ShadowAtlasAllocator::Tile* Tiles, uint32_t NumTiles )
+{
+    if (NumTiles == 0)
+        return;
+
+    ScopedTimer _prof(L"Light Shadow Depth Pyramids", Context);
+
+    Context.SetRootSignature(m_RootSig);
+    Context.SetPipelineState(m_PyramidCS);
+    Context.TransitionResource(LightAtlas, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    Context.TransitionResource(m_LightAtlasDepthPyramid, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, true);
+    Context.SetDynamicDescriptor(1, 0, LightAtlas.GetSRV());
+
+    // Tiles never overlap, so the dispatches need no barriers between them
+    for (uint32_t i = 0; i < NumTiles; ++i)
+    {
+        if (Tiles[i].Size > 0)
+            BuildPyramid(Context, m_LightAtlasDepthPyramid, Tiles[i].X, Tiles[i].Y, Tiles[i].Size, Tiles[i].Size);
+    }
+
+    Context.TransitionResource(m_LightAtlasDepthPyramid, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+}
+
+void SoftShadows::BuildPyramid( ComputeContext& Context, ColorBuffer& Pyramid, uint32_t X, uint32_t Y, uint32_t Width, uint32_t Height )
+{
+    ASSERT(X % kPyramidBlockSize == 0 && Y % kPyramidBlockSize == 0, "Pyramid blocks must not straddle tiles");
+
+    D3D12_CPU_DESCRIPTOR_HANDLE MipUAVs[kPyramidLevels];
+    for (uint32_t Mip = 0; Mip < kPyramidLevels; ++Mip)
+        MipUAVs[Mip] = Pyramid.GetMipUAV(Mip);
+
+    Context.SetConstants(0, X, Y);
+    Context.SetDynamicDescriptors(2, 0, kPyramidLevels, MipUAVs);
+    Context.Dispatch(Math::DivideByMultiple(Width, kPyramidBlockSize), Math::DivideByMultiple(Height, kPyramidBlockSize), 1);
+}
@@ -0,0 +1,49 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#pragma once
+
+#include <cstdint>
+#include "ShadowAtlasAllocator.h"
+
+class ColorBuffer;
+class ShadowBuffer;
+class ComputeContext;
+class BoolVar;
+class NumVar;
+class IntVar;
+
+// Contact-hardening (PCSS) filtering for the sun shadow map and the cone light shadow atlas.  The
+// blocker search is bounded by a min/max depth pyramid built after the shadows are rendered, which
+// lets fully lit and fully shadowed pixels return after a few loads.
+namespace SoftShadows
+{
+    extern BoolVar Enable;
+    extern IntVar BlockerSamples;
+    extern IntVar FilterSamples;
+    extern NumVar SunAngularDiameter;
+    extern NumVar ConeLightSize;
+    extern NumVar MaxSearchRadius;
+
+    extern ColorBuffer m_SunDepthPyramid;
+    extern ColorBuffer m_LightAtlasDepthPyramid;
+
+    // Sized after the sun shadow map and the light atlas, so call after Lighting::InitializeResources()
+    void InitializeResources(const ShadowBuffer& SunShadowMap, const ShadowBuffer& LightAtlas);
+    void Shutdown(void);
+
+    // Recreates the sun pyramid after the sun shadow map is resized.  The GPU must be idle.
+    void ResizeSunPyramid(const ShadowBuffer& SunShadowMap);
+
+    void BuildSunPyramid(ComputeContext& Context, ShadowBuffer& SunShadowMap);
+
+    // Tiles must be aligned to 16 texels
+    void BuildLightTilePyramids(ComputeContext& Context, ShadowBuffer& LightAtlas,
+        const ShadowAtlasAllocator::Tile* Tiles, uint32_t NumTiles);
+}
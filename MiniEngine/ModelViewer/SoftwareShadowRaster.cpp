@@ -0,0 +1,248 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "SoftwareShadowRaster.h"
+#include "PipelineState.h"
+#include "RootSignature.h"
+#include "CommandContext.h"
+#include "CommandListManager.h"
+#include "GraphicsCommon.h"
+#include "ColorBuffer.h"
+#include "ShadowBuffer.h"
+#include "GraphicsCore.h"
+#include "EngineProfiling.h"
+#include "Model.h"
+#include "FrameArena.h"
+#include <algorithm>
+
+#include "CompiledShaders/SoftwareShadowRasterCS.h"
+#include "CompiledShaders/SoftwareShadowResolveVS.h"
+#include "CompiledShaders/SoftwareShadowResolvePS.h"
+
+using namespace Math;
+using namespace Graphics;
+
+// must keep in sync with HLSL
+struct MeshletWork
+{
+    uint32_t StartIndex;        // In the depth-only index buffer
+    uint32_t TriangleCount;
+    uint32_t VertexAddress;     // Byte offset of the mesh's vertices in the depth-only stream
+    uint32_t Pad;
+};
+
+namespace SoftwareShadowRaster
+{
+    BoolVar Enable("Application/Lighting/Software Raster/Enable", true);
+    IntVar MaxMeshletTexels("Application/Lighting/Software Raster/Max Meshlet Texels", 8, 2, 32);
+    NumVar MaxTriangleArea("Application/Lighting/Software Raster/Max Triangle Area", 2.0f, 0.25f, 16.0f, 0.25f);
+
+    // A group per meshlet and a thread per triangle
+    enum { kGroupSize = 128, kMaxGroupsPerDispatch = 65535 };
+    static_assert(Model::maxMeshletTriangles <= kGroupSize, "Every triangle of a meshlet needs a thread");
+
+    RootSignature m_RasterRootSig;
+    ComputePSO m_RasterCS;
+    RootSignature m_ResolveRootSig;
+    GraphicsPSO m_ResolvePSO[2];    // D16 and D32 shadow maps
+
+    // The largest light space depth written to each texel, as a float's bits, or 0 for none
+    ColorBuffer m_SoftwareDepth;
+
+    const Model* m_Model = nullptr;
+    std::vector<bool> m_MeshIsCutout;
+    std::vector<MeshletWork> m_Work;
+}
+
+void SoftwareShadowRaster::InitializeResources( const Model& model, const std::vector<bool>& MaterialIsCutout )
+{
+    m_RasterRootSig.Reset(5, 0);
+    m_RasterRootSig[0].InitAsConstantBuffer(0);
+    m_RasterRootSig[1].InitAsBufferSRV(0);
+    m_RasterRootSig[2].InitAsBufferSRV(1);
+    m_RasterRootSig[3].InitAsBufferSRV(2);
+    m_RasterRootSig[4].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 0, 1);
+    m_RasterRootSig.Finalize(L"Software Shadow Raster");
+
+    m_RasterCS.SetRootSignature(m_RasterRootSig);
+    m_RasterCS.SetComputeShader(g_pSoftwareShadowRasterCS, sizeof(g_pSoftwareShadowRasterCS));
+    m_RasterCS.Finalize();
+
+    m_ResolveRootSig.Reset(1, 0);
+    m_ResolveRootSig[0].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 0, 1, D3D12_SHADER_VISIBILITY_PIXEL);
+    m_ResolveRootSig.Finalize(L"Software Shadow Resolve");
+
+    // Depth testing keeps the nearer of the hardware and the compute casters wherever they overlap
+    const DXGI_FORMAT Formats[2] = { DXGI_FORMAT_D16_UNORM, DXGI_FORMAT_D32_FLOAT };
+    for (uint32_t i = 0; i < 2; ++i)
+    {
+        m_ResolvePSO[i].SetRootSignature(m_ResolveRootSig);
+        m_ResolvePSO[i].SetRasterizerState(RasterizerTwoSided);
+        m_ResolvePSO[i].SetBlendState(BlendNoColorWrite);
+        m_ResolvePSO[i].SetDepthStencilState(DepthStateReadWrite);
+        m_ResolvePSO[i].SetSampleMask(0xFFFFFFFF);
+        m_ResolvePSO[i].SetInputLayout(0, nullptr);
+        m_ResolvePSO[i].SetPrimitiveTopologyType(D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE);
+        m_ResolvePSO[i].SetVertexShader(g_pSoftwareShadowResolveVS, sizeof(g_pSoftwareShadowResolveVS));
+        m_ResolvePSO[i].SetPixelShader(g_pSoftwareShadowResolvePS, sizeof(g_pSoftwareShadowResolvePS));
+        m_ResolvePSO[i].SetRenderTargetFormats(0, nullptr, Formats[i]);
+        m_ResolvePSO[i].Finalize();
+    }
+
+    m_Model = &model;
+    m_MeshIsCutout.resize(model.m_Header.meshCount);
+    for (uint32_t meshIndex = 0; meshIndex < model.m_Header.meshCount; ++meshIndex)
+        m_MeshIsCutout[meshIndex] = MaterialIsCutout[model.m_pMesh[meshIndex].materialIndex];
+}
+
+void SoftwareShadowRaster::Shutdown( void )
+{
+    m_SoftwareDepth.Destroy();
+    m_Model = nullptr;
+    m_MeshIsCutout.clear();
+    m_Work.clear();
+}
+
+bool SoftwareShadowRaster::Render( GraphicsContext& gfxContext, const Matrix4& ViewProj, ShadowBuffer& Target,
+    const std::vector<uint8_t>* MeshLOD, std::vector<uint8_t>& MeshIsSoftware )
+{
+    const uint32_t NumMeshes = m_Model == nullptr ? 0 : m_Model->m_Header.meshCount;
+    MeshIsSoftware.assign(NumMeshes, 0);
+
+    if (!Enable || NumMeshes == 0 || m_Model->m_MeshletCount == 0)
+        return false;
+
+    const Model& model = *m_Model;
+    const uint32_t Width = (uint32_t)Target.GetWidth();
+    const uint32_t Height = (uint32_t)Target.GetHeight();
+
+    // An orthographic projection scales every distance by at most its larger row length, in clip units
+    const Vector3 RowX(ViewProj.GetX().GetX(), ViewProj.GetY().GetX(), ViewProj.GetZ().GetX());
+    const Vector3 RowY(ViewProj.GetX().GetY(), ViewProj.GetY().GetY(), ViewProj.GetZ().GetY());
+    const float TexelsPerUnit = std::max(0.5f * Width * Length(RowX), 0.5f * Height * Length(RowY));
+    const float MaxDiameter = (float)MaxMeshletTexels;
+    const float MaxArea = MaxTriangleArea;
+
+    // A mesh is only rasterized here when all of its meshlets are small enough
+    uint8_t* Eligible = FrameArena::AllocateArray<uint8_t>(NumMeshes);
+    for (uint32_t meshIndex = 0; meshIndex < NumMeshes; ++meshIndex)
+    {
+        Eligible[meshIndex] = !m_MeshIsCutout[meshIndex] && !model.IsMeshDynamic(meshIndex) &&
+            (MeshLOD == nullptr || (*MeshLOD)[meshIndex] == 0);
+    }
+
+    for (uint32_t meshletIndex = 0; meshletIndex < model.m_MeshletCount; ++meshletIndex)
+    {
+        const Model::Meshlet& meshlet = model.m_pMeshlet[meshletIndex];
+        const float Diameter = 2.0f * meshlet.radius * TexelsPerUnit;
+        const uint32_t TriangleCount = std::max(meshlet.indexCount / 3, 1u);
+        const float MeanArea = 0.25f * XM_PI * Diameter * Diameter / TriangleCount;
+        if (Diameter > MaxDiameter || MeanArea > MaxArea)
+            Eligible[meshlet.meshIndex] = 0;
+    }
+
+    m_Work.clear();
+    for (uint32_t meshletIndex = 0; meshletIndex < model.m_MeshletCount; ++meshletIndex)
+    {
+        const Model::Meshlet& meshlet = model.m_pMeshlet[meshletIndex];
+        if (!Eligible[meshlet.meshIndex] || meshlet.indexCount < 3)
+            continue;
+
+        const Model::Mesh& mesh = model.m_pMesh[meshlet.meshIndex];
+        MeshletWork Work;
+        Work.StartIndex = model.GetStartIndex(mesh.indexDataByteOffset) + meshlet.indexOffset;
+        Work.TriangleCount = meshlet.indexCount / 3;
+        Work.VertexAddress = (uint32_t)mesh.vertexDataByteOffsetDepth;
+        Work.Pad = 0;
+        m_Work.push_back(Work);
+        MeshIsSoftware[meshlet.meshIndex] = 1;
+    }
+
+    EngineProfiling::SetCounter("Software Raster Meshlets", (uint32_t)m_Work.size());
+    if (m_Work.empty())
+        return false;
+
+    ScopedTimer _prof(L"Software Shadow Raster", gfxContext);
+
+    if (m_SoftwareDepth.GetResource() == nullptr || m_SoftwareDepth.GetWidth() != Width || m_SoftwareDepth.GetHeight() != Height)
+    {
+        // The previous scratch texture may still be in use by frames in flight
+        if (m_SoftwareDepth.GetResource() != nullptr)
+            g_CommandManager.IdleGPU();
+        m_SoftwareDepth.Create(L"Software Shadow Depth", Width, Height, 1, DXGI_FORMAT_R32_UINT);
+    }
+
+    const bool FloatDepth = Target.GetFormat() == DXGI_FORMAT_D32_FLOAT;
+    const D3D12_RASTERIZER_DESC& Rasterizer = FloatDepth ? RasterizerShadowD32 : RasterizerShadow;
+    const Model::VertexDecode Decode = model.GetVertexDecode();
+    const Model::Attrib& Position = model.m_pMesh[0].attribDepth[Model::attrib_position];
+
+    __declspec(align(16)) struct
+    {
+        Matrix4 ViewProj;
+        float PositionScale[3];
+        uint32_t Quantized;
+        float PositionBias[3];
+        uint32_t VertexStride;
+        float TargetSize[2];
+        uint32_t PositionOffset;
+        uint32_t FirstMeshlet;
+        float DepthBias;
+        float SlopeScaledDepthBias;
+        uint32_t FloatDepth;
+        uint32_t MaxExtent;
+        uint32_t Index32;
+    } csConstants;
+    csConstants.ViewProj = ViewProj;
+    std::copy(Decode.positionScale, Decode.positionScale + 3, csConstants.PositionScale);
+    csConstants.Quantized = Position.format != Model::attrib_format_float;
+    std::copy(Decode.positionBias, Decode.positionBias + 3, csConstants.PositionBias);
+    csConstants.VertexStride = model.m_VertexStrideDepth;
+    csConstants.TargetSize[0] = (float)Width;
+    csConstants.TargetSize[1] = (float)Height;
+    csConstants.PositionOffset = Position.offset;
+    csConstants.DepthBias = (float)Rasterizer.DepthBias;
+    csConstants.SlopeScaledDepthBias = Rasterizer.SlopeScaledDepthBias;
+    csConstants.FloatDepth = FloatDepth;
+    // The selection bounds every triangle by its meshlet, and this bounds the loops should it be wrong
+    csConstants.MaxExtent = (uint32_t)MaxMeshletTexels + 2;
+    csConstants.Index32 = model.GetIndexSize() == sizeof(uint32_t);
+
+    ComputeContext& Context = gfxContext.GetComputeContext();
+
+    Context.TransitionResource(m_SoftwareDepth, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, true);
+    Context.ClearUAV(m_SoftwareDepth);
+
+    Context.SetRootSignature(m_RasterRootSig);
+    Context.SetPipelineState(m_RasterCS);
+    Context.SetBufferSRV(1, model.m_IndexBufferDepth);
+    Context.SetBufferSRV(2, model.m_VertexBufferDepth);
+    Context.SetDynamicSRV(3, sizeof(MeshletWork) * m_Work.size(), m_Work.data());
+    Context.SetDynamicDescriptor(4, 0, m_SoftwareDepth.GetUAV());
+
+    const uint32_t NumMeshlets = (uint32_t)m_Work.size();
+    for (uint32_t First = 0; First < NumMeshlets; First += kMaxGroupsPerDispatch)
+    {
+        csConstants.FirstMeshlet = First;
+        Context.SetDynamicConstantBufferView(0, sizeof(csConstants), &csConstants);
+        Context.Dispatch(std::min<uint32_t>(NumMeshlets - First, kMaxGroupsPerDispatch));
+    }
+
+    gfxContext.TransitionResource(m_SoftwareDepth, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+    gfxContext.TransitionResource(Target, D3D12_RESOURCE_STATE_DEPTH_WRITE, true);
+
+    gfxContext.SetRootSignature(m_ResolveRootSig);
+    gfxContext.SetPipelineState(m_ResolvePSO[FloatDepth ? 1 : 0]);
+    gfxContext.SetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    gfxContext.SetDynamicDescriptor(0, 0, m_SoftwareDepth.GetSRV());
+    Target.SetRenderTarget(gfxContext);
+    gfxContext.Draw(3);
+
+    return true;
+}
@@ -0,0 +1,49 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+class Model;
+class ShadowBuffer;
+class GraphicsContext;
+class BoolVar;
+class NumVar;
+class IntVar;
+namespace Math
+{
+    class Matrix4;
+}
+
+// Rasterizes the shadow casters made of tiny triangles in a compute shader instead of the hardware
+// rasterizer, which shades whole 2x2 quads and loses most of its throughput on triangles that cover a texel
+// or less.  A mesh is drawn this way when every meshlet of it projects to only a few texels, so each thread
+// of a meshlet's group walks a small bounding box for its triangle.  Depths are combined with an atomic max
+// (shadow maps are reversed, 1 nearest the light) into a scratch texture, then written into the shadow map
+// with a full screen depth pass, and the hardware draws every other mesh as before.
+namespace SoftwareShadowRaster
+{
+    extern BoolVar Enable;
+    extern IntVar MaxMeshletTexels;
+    extern NumVar MaxTriangleArea;
+
+    void InitializeResources(const Model& model, const std::vector<bool>& MaterialIsCutout);
+    void Shutdown(void);
+
+    // Picks the static opaque meshes whose meshlets all fit in MaxMeshletTexels texels of Target, with
+    // triangles covering no more than MaxTriangleArea texels on average, and rasterizes them into Target under
+    // the orthographic ViewProj.  Meshes that MeshLOD (when given) coarsens are left to the hardware, since
+    // meshlets only split the full detail indices.  MeshIsSoftware is set for the meshes drawn here, which the
+    // hardware draws must skip.  Target must have been begun for rendering.  Returns false when no mesh was
+    // picked; otherwise the graphics root signature and pipeline state are left changed.
+    bool Render(GraphicsContext& gfxContext, const Math::Matrix4& ViewProj, ShadowBuffer& Target,
+        const std::vector<uint8_t>* MeshLOD, std::vector<uint8_t>& MeshIsSoftware);
+}
@@ -0,0 +1,169 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "StaticBundles.h"
+#include "RootSignature.h"
+#include "CommandContext.h"
+#include "CommandListManager.h"
+#include "DynamicDescriptorHeap.h"
+#include "GraphicsCore.h"
+#include "EngineTuning.h"
+#include "Model.h"
+#include "./DrawStatistics.h"
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+using namespace Graphics;
+using Microsoft::WRL::ComPtr;
+
+namespace StaticBundles
+{
+    BoolVar Enable("Application/Draw Bundles/Enable", true);
+
+    struct Bundle
+    {
+        ComPtr<ID3D12CommandAllocator> Allocator;
+        ComPtr<ID3D12GraphicsCommandList> CommandList;
+        uint32_t Version;
+        UINT64 MaterialTables;
+        uint32_t NumDraws;
+        uint64_t NumTriangles;
+    };
+
+    struct CacheKey
+    {
+        Key Pass;
+        ID3D12PipelineState* PSO;
+
+        bool operator<( const CacheKey& Other ) const
+        {
+            return std::tie(Pass.Filter, Pass.NumViews, Pass.FirstMesh, Pass.EndMesh, Pass.DepthOnlyStream, Pass.BindMaterials, PSO) <
+                std::tie(Other.Pass.Filter, Other.Pass.NumViews, Other.Pass.FirstMesh, Other.Pass.EndMesh,
+                    Other.Pass.DepthOnlyStream, Other.Pass.BindMaterials, Other.PSO);
+        }
+    };
+
+    const RootSignature* m_RootSig = nullptr;
+    std::mutex m_Mutex;
+    std::map<CacheKey, Bundle> m_Bundles;
+    uint32_t m_GeometryVersion = 0;
+
+    // Dropped bundles wait for every command list that could replay them, which all end after the fence
+    std::vector<std::pair<uint64_t, Bundle>> m_RetiredBundles;
+
+    void Retire(Bundle& bundle);
+    void Record(Bundle& bundle, ID3D12PipelineState* PSO, D3D12_GPU_DESCRIPTOR_HANDLE MaterialTables,
+        const RecordFunc& RecordDraws);
+}
+
+void StaticBundles::Initialize( const RootSignature& DrawRootSig )
+{
+    m_RootSig = &DrawRootSig;
+}
+
+void StaticBundles::Shutdown( void )
+{
+    m_Bundles.clear();
+    m_RetiredBundles.clear();
+    m_RootSig = nullptr;
+}
+
+void StaticBundles::Retire( Bundle& bundle )
+{
+    m_RetiredBundles.emplace_back(g_CommandManager.GetGraphicsQueue().GetNextFenceValue(), std::move(bundle));
+    bundle = Bundle();
+}
+
+void StaticBundles::Invalidate( void )
+{
+    std::lock_guard<std::mutex> LockGuard(m_Mutex);
+
+    for (auto& Entry : m_Bundles)
+        Retire(Entry.second);
+    m_Bundles.clear();
+}
+
+void StaticBundles::Update( const Model& model )
+{
+    if (m_GeometryVersion != model.GetStaticGeometryVersion())
+    {
+        Invalidate();
+        m_GeometryVersion = model.GetStaticGeometryVersion();
+    }
+
+    std::lock_guard<std::mutex> LockGuard(m_Mutex);
+
+    auto Completed = std::remove_if(m_RetiredBundles.begin(), m_RetiredBundles.end(),
+        []( const std::pair<uint64_t, Bundle>& Retired ) { return g_CommandManager.IsFenceComplete(Retired.first); });
+    m_RetiredBundles.erase(Completed, m_RetiredBundles.end());
+}
+
+void StaticBundles::Record( Bundle& bundle, ID3D12PipelineState* PSO, D3D12_GPU_DESCRIPTOR_HANDLE MaterialTables,
+    const RecordFunc& RecordDraws )
+{
+    ASSERT_SUCCEEDED(g_Device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_BUNDLE, MY_IID_PPV_ARGS(&bundle.Allocator)));
+    ASSERT_SUCCEEDED(g_Device->CreateCommandList(1, D3D12_COMMAND_LIST_TYPE_BUNDLE, bundle.Allocator.Get(), PSO,
+        MY_IID_PPV_ARGS(&bundle.CommandList)));
+    bundle.CommandList->SetName(L"StaticBundles::Bundle");
+
+    // A bundle that sets descriptor tables must set the caller's heaps, and setting the caller's root signature
+    // keeps the arguments it inherits
+    ID3D12DescriptorHeap* Heaps[] = {
+        DynamicDescriptorHeap::GetShaderVisibleHeap(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV),
+        DynamicDescriptorHeap::GetShaderVisibleHeap(D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER) };
+    bundle.CommandList->SetDescriptorHeaps(_countof(Heaps), Heaps);
+    bundle.CommandList->SetGraphicsRootSignature(m_RootSig->GetSignature());
+    bundle.CommandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+    bundle.MaterialTables = MaterialTables.ptr;
+    bundle.NumDraws = 0;
+    bundle.NumTriangles = 0;
+    RecordDraws(bundle.CommandList.Get(), MaterialTables, bundle.NumDraws, bundle.NumTriangles);
+
+    ASSERT_SUCCEEDED(bundle.CommandList->Close());
+}
+
+void StaticBundles::Draw( GraphicsContext& Context, const Key& key, const RecordFunc& RecordDraws )
+{
+    ASSERT(m_RootSig != nullptr, "StaticBundles::Initialize() has not been called");
+
+    CacheKey Cached = { key, Context.GetPipelineState() };
+    ASSERT(Cached.PSO != nullptr, "Bundles are recorded with the bound PSO");
+
+    // Passes without material tables replay on any copy of the persistent region
+    const D3D12_GPU_DESCRIPTOR_HANDLE MaterialTables = key.BindMaterials ? Context.GetPersistentDescriptorTable(0) :
+        D3D12_GPU_DESCRIPTOR_HANDLE{ 0 };
+
+    ID3D12GraphicsCommandList* CommandList;
+    uint32_t NumDraws;
+    uint64_t NumTriangles;
+    {
+        std::lock_guard<std::mutex> LockGuard(m_Mutex);
+
+        Bundle& Entry = m_Bundles[Cached];
+        if (Entry.CommandList == nullptr || Entry.Version != key.Version || Entry.MaterialTables != MaterialTables.ptr)
+        {
+            if (Entry.CommandList != nullptr)
+                Retire(Entry);
+
+            Record(Entry, Cached.PSO, MaterialTables, RecordDraws);
+            Entry.Version = key.Version;
+        }
+
+        CommandList = Entry.CommandList.Get();
+        NumDraws = Entry.NumDraws;
+        NumTriangles = Entry.NumTriangles;
+    }
+
+    Context.ExecuteBundle(CommandList);
+    DrawStatistics::AddDraws(NumDraws, NumTriangles);
+}
@@ -0,0 +1,59 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+
+class Model;
+class RootSignature;
+class GraphicsContext;
+class BoolVar;
+
+// The draws of the static meshes recorded once into D3D12 bundles, for the passes that the DrawList cannot
+// submit with ExecuteIndirect.  A pass replays the bundle of its key and the bound PSO, and records it the first
+// time.  Bundles bind material tables from the persistent descriptor region, so they are recorded again when the
+// region is refreshed, and all of them are dropped when the model's static meshes change.
+namespace StaticBundles
+{
+    extern BoolVar Enable;
+
+    // Everything the recorded draws depend on besides the PSO.  Version identifies what the caller recorded them
+    // from, such as the levels of detail, and a bundle recorded with another version is recorded again.
+    struct Key
+    {
+        uint32_t Filter;
+        uint32_t NumViews;
+        uint32_t FirstMesh;
+        uint32_t EndMesh;
+        uint32_t Version;
+        bool DepthOnlyStream;
+        bool BindMaterials;
+    };
+
+    // Records the draws into Bundle, whose root signature, topology and descriptor heaps are already set.  Material
+    // tables start at MaterialTables, in the persistent region of the context the bundle is replayed on.
+    typedef std::function<void(ID3D12GraphicsCommandList* Bundle, D3D12_GPU_DESCRIPTOR_HANDLE MaterialTables,
+        uint32_t& NumDraws, uint64_t& NumTriangles)> RecordFunc;
+
+    // Bundles set DrawRootSig, so the passes replaying them must use it
+    void Initialize(const RootSignature& DrawRootSig);
+    void Shutdown(void);
+
+    // Drops every bundle, once the GPU has finished with it
+    void Invalidate(void);
+
+    // Invalidates the bundles when the static meshes have changed, and frees the ones the GPU is done with
+    void Update(const Model& model);
+
+    // Replays the bundle of the key for the bound PSO, recording it with Record when there is none yet.  May be
+    // called from several contexts at once.
+    void Draw(GraphicsContext& Context, const Key& key, const RecordFunc& Record);
+}
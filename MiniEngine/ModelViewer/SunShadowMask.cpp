@@ -0,0 +1,137 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "SunShadowMask.h"
+#include "PipelineState.h"
+#include "RootSignature.h"
+#include "CommandContext.h"
+#include "SamplerManager.h"
+#include "GraphicsCommon.h"
+#include "BufferManager.h"
+#include "Camera.h"
+
+#include "CompiledShaders/SunShadowMaskCS.h"
+#include "CompiledShaders/SunShadowMaskUpsampleCS.h"
+
+using namespace Graphics;
+using namespace Math;
+
+namespace SunShadowMask
+{
+    BoolVar Enable("Application/Lighting/Shadow Mask/Enable", false);
+    BoolVar HalfResolution("Application/Lighting/Shadow Mask/Half Resolution", false);
+    BoolVar ContactShadows("Application/Lighting/Shadow Mask/Contact Shadows", true);
+    NumVar ContactLength("Application/Lighting/Shadow Mask/Contact Length", 16.0f, 1.0f, 100.0f, 1.0f);
+    NumVar ContactThickness("Application/Lighting/Shadow Mask/Contact Thickness", 8.0f, 0.5f, 50.0f, 0.5f);
+    IntVar ContactSteps("Application/Lighting/Shadow Mask/Contact Steps", 12, 4, 32);
+
+    RootSignature m_RootSig;
+    ComputePSO m_MaskCS;
+    ComputePSO m_UpsampleCS;
+}
+
+void SunShadowMask::InitializeResources( void )
+{
+    SamplerDesc MomentSamplerDesc;
+    MomentSamplerDesc.MaxAnisotropy = 8;
+    MomentSamplerDesc.SetTextureAddressMode(D3D12_TEXTURE_ADDRESS_MODE_CLAMP);
+
+    SamplerDesc ShadowWrapSamplerDesc = SamplerShadowDesc;
+    ShadowWrapSamplerDesc.AddressU = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
+    ShadowWrapSamplerDesc.AddressV = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
+
+    m_RootSig.Reset(5, 3);
+    m_RootSig.InitStaticSampler(1, SamplerShadowDesc);
+    m_RootSig.InitStaticSampler(2, MomentSamplerDesc);
+    m_RootSig.InitStaticSampler(3, ShadowWrapSamplerDesc);
+    m_RootSig[0].InitAsConstantBuffer(0);
+    m_RootSig[1].InitAsConstantBuffer(1);
+    m_RootSig[2].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 0, 2);
+    m_RootSig[3].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 64, 13);
+    m_RootSig[4].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 0, 1);
+    m_RootSig.Finalize(L"Sun Shadow Mask");
+
+    m_MaskCS.SetRootSignature(m_RootSig);
+    m_MaskCS.SetComputeShader(g_pSunShadowMaskCS, sizeof(g_pSunShadowMaskCS));
+    m_MaskCS.Finalize();
+
+    m_UpsampleCS.SetRootSignature(m_RootSig);
+    m_UpsampleCS.SetComputeShader(g_pSunShadowMaskUpsampleCS, sizeof(g_pSunShadowMaskUpsampleCS));
+    m_UpsampleCS.Finalize();
+}
+
+void SunShadowMask::Render( ComputeContext& Context, const Camera& ViewCamera, const D3D12_VIEWPORT& Viewport,
+    const Matrix4& SunShadowMatrix, const void* ShadingConstants, size_t ConstantsSize,
+    const D3D12_CPU_DESCRIPTOR_HANDLE* ShadowSRVs, uint32_t NumSRVs )
+{
+    ASSERT(NumSRVs <= 13);
+
+    ScopedTimer _prof(L"Sun Shadow Mask", Context);
+
+    const bool Half = HalfResolution;
+    ColorBuffer& Target = Half ? g_SunShadowMaskHalf : g_SunShadowMask;
+
+    __declspec(align(16)) struct
+    {
+        Matrix4 InvViewProj;
+        Matrix4 ViewProj;
+        Matrix4 SunShadowMatrix;
+        XMFLOAT3 CameraPosition;
+        float ZMagic;
+        float ViewportOffset[2];
+        float InvViewportSize[2];
+        uint32_t MaskSize[2];
+        uint32_t SampleScale;
+        float ContactLength;
+        float ContactThickness;
+        uint32_t ContactSteps;
+        float RcpFarClip;
+    } csConstants;
+
+    csConstants.InvViewProj = Invert(ViewCamera.GetViewProjMatrix());
+    csConstants.ViewProj = ViewCamera.GetViewProjMatrix();
+    csConstants.SunShadowMatrix = SunShadowMatrix;
+    XMStoreFloat3(&csConstants.CameraPosition, ViewCamera.GetPosition());
+    csConstants.ZMagic = (ViewCamera.GetFarClip() - ViewCamera.GetNearClip()) / ViewCamera.GetNearClip();
+    csConstants.ViewportOffset[0] = Viewport.TopLeftX;
+    csConstants.ViewportOffset[1] = Viewport.TopLeftY;
+    csConstants.InvViewportSize[0] = 1.0f / Viewport.Width;
+    csConstants.InvViewportSize[1] = 1.0f / Viewport.Height;
+    csConstants.MaskSize[0] = g_SunShadowMask.GetWidth();
+    csConstants.MaskSize[1] = g_SunShadowMask.GetHeight();
+    csConstants.SampleScale = Half ? 2 : 1;
+    csConstants.ContactLength = ContactShadows ? (float)ContactLength : 0.0f;
+    csConstants.ContactThickness = ContactThickness;
+    csConstants.ContactSteps = (uint32_t)ContactSteps;
+    csConstants.RcpFarClip = 1.0f / ViewCamera.GetFarClip();
+
+    Context.SetRootSignature(m_RootSig);
+    Context.SetPipelineState(m_MaskCS);
+    Context.SetDynamicConstantBufferView(0, ConstantsSize, ShadingConstants);
+    Context.SetDynamicConstantBufferView(1, sizeof(csConstants), &csConstants);
+
+    Context.TransitionResource(g_SceneDepthBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    Context.TransitionResource(Target, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, true);
+    Context.SetDynamicDescriptor(2, 0, g_SceneDepthBuffer.GetDepthSRV());
+    Context.SetDynamicDescriptors(3, 0, NumSRVs, ShadowSRVs);
+    Context.SetDynamicDescriptor(4, 0, Target.GetUAV());
+    Context.Dispatch2D(Target.GetWidth(), Target.GetHeight());
+
+    if (Half)
+    {
+        Context.SetPipelineState(m_UpsampleCS);
+        Context.TransitionResource(g_SunShadowMaskHalf, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        Context.TransitionResource(g_SunShadowMask, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, true);
+        Context.SetDynamicDescriptor(2, 1, g_SunShadowMaskHalf.GetSRV());
+        Context.SetDynamicDescriptor(4, 0, g_SunShadowMask.GetUAV());
+        Context.Dispatch2D(g_SunShadowMask.GetWidth(), g_SunShadowMask.GetHeight());
+    }
+
+    Context.TransitionResource(g_SunShadowMask, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+}
@@ -0,0 +1,48 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#pragma once
+
+#include <cstdint>
+
+class ComputeContext;
+class BoolVar;
+class NumVar;
+class IntVar;
+namespace Math
+{
+    class Matrix4;
+    class Camera;
+}
+
+// Deferred sun shadows.  After the depth pre-pass, a compute shader evaluates the sun shadow once per
+// depth buffer pixel into Graphics::g_SunShadowMask, which the color pass then reads with a single
+// load instead of filtering the shadow map for every shaded sample, overdraw included.  At half
+// resolution the mask is upsampled with depth-aware weights.
+//
+// Contact shadows march the depth buffer a short distance toward the sun and darken the mask where the ray
+// is blocked.  They keep small casters grounded when the shadow map is too coarse to resolve them.
+namespace SunShadowMask
+{
+    extern BoolVar Enable;
+    extern BoolVar HalfResolution;
+    extern BoolVar ContactShadows;
+    extern NumVar ContactLength;
+    extern NumVar ContactThickness;
+    extern IntVar ContactSteps;
+
+    void InitializeResources(void);
+
+    // ShadingConstants is the color pass constant buffer and ShadowSRVs the first NumSRVs entries of its
+    // table at t64.  The sun shadow resources they reference must be readable as non-pixel shader
+    // resources.  Leaves g_SunShadowMask ready for the pixel shader.
+    void Render(ComputeContext& Context, const Math::Camera& ViewCamera, const D3D12_VIEWPORT& Viewport,
+        const Math::Matrix4& SunShadowMatrix, const void* ShadingConstants, size_t ConstantsSize,
+        const D3D12_CPU_DESCRIPTOR_HANDLE* ShadowSRVs, uint32_t NumSRVs);
+}
@@ -0,0 +1,130 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "TextureFeedback.h"
+#include "CommandContext.h"
+#include "CommandListManager.h"
+#include "GraphicsCore.h"
+#include "ReadbackBuffer.h"
+#include "EngineProfiling.h"
+#include "Model.h"
+
+using namespace Graphics;
+
+namespace TextureFeedback
+{
+    BoolVar Enable("Application/Texture Streaming/Feedback", true);
+
+    enum { kReadbackLatency = 3 };
+
+    // One word per material.  Readbacks learn their fence at the start of the next frame, which is after every
+    // command list of the frame that wrote them has been submitted.
+    ByteAddressBuffer m_Feedback;
+    ReadbackBuffer m_FeedbackReadback[kReadbackLatency];
+    uint64_t m_ReadbackFence[kReadbackLatency];
+    uint32_t m_ReadbackHead = 0;
+    uint32_t m_ReadbackTail = 0;
+    uint32_t m_NumPendingReadbacks = 0;
+    uint32_t m_NumMaterials = 0;
+    uint32_t m_FrameIndex = 0;
+    bool m_Active = false;
+}
+
+void TextureFeedback::InitializeResources( const Model& model )
+{
+    m_NumMaterials = model.m_Header.materialCount;
+
+    // Every frame clears the buffer after its readback, so it only needs clearing once here
+    m_Feedback.Create(L"Texture Feedback", m_NumMaterials, sizeof(uint32_t));
+    for (uint32_t i = 0; i < kReadbackLatency; ++i)
+    {
+        m_FeedbackReadback[i].Create(L"Texture Feedback Readback", m_NumMaterials, sizeof(uint32_t));
+        m_ReadbackFence[i] = 0;
+    }
+
+    GraphicsContext& InitContext = GraphicsContext::Begin(L"Clear Texture Feedback");
+    InitContext.TransitionResource(m_Feedback, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, true);
+    InitContext.ClearUAV(m_Feedback);
+    InitContext.Finish(true);
+}
+
+void TextureFeedback::Shutdown( void )
+{
+    m_Feedback.Destroy();
+    for (uint32_t i = 0; i < kReadbackLatency; ++i)
+        m_FeedbackReadback[i].Destroy();
+    m_ReadbackHead = m_ReadbackTail = m_NumPendingReadbacks = 0;
+}
+
+void TextureFeedback::Update( const Model& model )
+{
+    m_Active = Enable && model.HasStreamedTextures();
+    ++m_FrameIndex;
+
+    // The previous frame's command lists are all submitted by now
+    if (m_NumPendingReadbacks > 0)
+    {
+        const uint32_t Newest = (m_ReadbackHead + kReadbackLatency - 1) % kReadbackLatency;
+        if (m_ReadbackFence[Newest] == 0)
+            m_ReadbackFence[Newest] = g_CommandManager.GetGraphicsQueue().GetNextFenceValue() - 1;
+    }
+
+    int32_t Newest = -1;
+    while (m_NumPendingReadbacks > 0 && g_CommandManager.IsFenceComplete(m_ReadbackFence[m_ReadbackTail]))
+    {
+        Newest = (int32_t)m_ReadbackTail;
+        m_ReadbackTail = (m_ReadbackTail + 1) % kReadbackLatency;
+        --m_NumPendingReadbacks;
+    }
+
+    if (Newest < 0 || !m_Active)
+        return;
+
+    // Unseen materials leave their textures to age out
+    const uint32_t* Feedback = (const uint32_t*)m_FeedbackReadback[Newest].Map();
+    for (uint32_t materialIdx = 0; materialIdx < m_NumMaterials; ++materialIdx)
+    {
+        if (Feedback[materialIdx] != 0)
+            model.RequestTextureResolution(materialIdx, (float)(Feedback[materialIdx] - 1) / 16.0f);
+    }
+    m_FeedbackReadback[Newest].Unmap();
+}
+
+void TextureFeedback::Bind( GraphicsContext& Context, uint32_t RootIndex )
+{
+    Context.SetBufferUAV(RootIndex, m_Feedback);
+}
+
+void TextureFeedback::GetShaderParams( uint32_t Params[4] )
+{
+    // Stepping by an odd number visits every pixel of the tile once in 64 frames
+    const uint32_t TilePixel = (m_FrameIndex * 37) & 63;
+    Params[0] = m_Active ? 1 : 0;
+    Params[1] = TilePixel & 7;
+    Params[2] = TilePixel >> 3;
+    Params[3] = 0;
+}
+
+void TextureFeedback::Resolve( GraphicsContext& gfxContext )
+{
+    // Drop this frame's feedback if the CPU has fallen so far behind that every readback is in flight
+    if (!m_Active || m_NumPendingReadbacks == kReadbackLatency)
+        return;
+
+    ScopedTimer _prof(L"Texture Feedback", gfxContext);
+
+    gfxContext.CopyBuffer(m_FeedbackReadback[m_ReadbackHead], m_Feedback);
+    gfxContext.TransitionResource(m_Feedback, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, true);
+    gfxContext.ClearUAV(m_Feedback);
+    gfxContext.InsertUAVBarrier(m_Feedback);
+
+    m_ReadbackFence[m_ReadbackHead] = 0;
+    m_ReadbackHead = (m_ReadbackHead + 1) % kReadbackLatency;
+    ++m_NumPendingReadbacks;
+}
@@ -0,0 +1,38 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#pragma once
+
+#include <cstdint>
+
+class Model;
+class GraphicsContext;
+class BoolVar;
+
+// Tells texture streaming which mips the color pass needs.  For one pixel in each 8x8 tile, a different one
+// every frame, the pixel shader keeps the finest resolution that each material's textures are sampled at with
+// an atomic max.  The buffer is read back a few frames later and turned into requests for the model's streamed
+// textures, so mips arrive a little after they come into view.
+namespace TextureFeedback
+{
+    extern BoolVar Enable;
+
+    void InitializeResources(const Model& model);
+    void Shutdown(void);
+
+    // Requests mips from the newest feedback that has come back.  Call at the start of the frame.
+    void Update(const Model& model);
+
+    // The color pass writes to the buffer through a root UAV
+    void Bind(GraphicsContext& Context, uint32_t RootIndex);
+    void GetShaderParams(uint32_t Params[4]);
+
+    // Queues the readback of the finished color pass and clears the feedback for the next frame
+    void Resolve(GraphicsContext& gfxContext);
+}
@@ -0,0 +1,116 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "VariableRateShading.h"
+#include "PipelineState.h"
+#include "RootSignature.h"
+#include "CommandContext.h"
+#include "SamplerManager.h"
+#include "GraphicsCore.h"
+#include "BufferManager.h"
+#include "DynamicResolution.h"
+
+#include "CompiledShaders/ShadingRateCS.h"
+
+using namespace Graphics;
+
+namespace VariableRateShading
+{
+    BoolVar Enable("Application/Variable Rate Shading/Enable", false);
+    NumVar ContrastThreshold("Application/Variable Rate Shading/Contrast Threshold", 0.02f, 0.0f, 0.2f, 0.005f);
+    NumVar DarkLuminance("Application/Variable Rate Shading/Dark Luminance", 0.05f, 0.0f, 0.5f, 0.01f);
+    NumVar MotionThreshold("Application/Variable Rate Shading/Motion Threshold (px)", 8.0f, 1.0f, 64.0f, 1.0f);
+
+    RootSignature m_RootSig;
+    ComputePSO m_RateCS;
+}
+
+void VariableRateShading::InitializeResources( void )
+{
+    if (!g_bVariableRateShadingTier2)
+        return;
+
+    SamplerDesc PointSamplerDesc;
+    PointSamplerDesc.Filter = D3D12_FILTER_MIN_MAG_MIP_POINT;
+    PointSamplerDesc.SetTextureAddressMode(D3D12_TEXTURE_ADDRESS_MODE_CLAMP);
+
+    m_RootSig.Reset(3, 1);
+    m_RootSig.InitStaticSampler(0, PointSamplerDesc);
+    m_RootSig[0].InitAsConstantBuffer(0);
+    m_RootSig[1].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 0, 3);
+    m_RootSig[2].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 0, 1);
+    m_RootSig.Finalize(L"Variable Rate Shading");
+
+    m_RateCS.SetRootSignature(m_RootSig);
+    m_RateCS.SetComputeShader(g_pShadingRateCS, sizeof(g_pShadingRateCS));
+    m_RateCS.Finalize();
+}
+
+bool VariableRateShading::IsActive( void )
+{
+    return Enable && g_bVariableRateShadingTier2;
+}
+
+void VariableRateShading::Render( ComputeContext& Context, bool ShadowMaskValid )
+{
+    ASSERT(IsActive());
+    ASSERT(g_ShadingRateTileSize >= 4, "Each thread takes 4x4 samples of its tile");
+
+    ScopedTimer _prof(L"Shading Rate Image", Context);
+
+    const uint32_t Width = DynamicResolution::GetWidth(), Height = DynamicResolution::GetHeight();
+    const uint32_t TileSize = g_ShadingRateTileSize;
+
+    __declspec(align(16)) struct
+    {
+        uint32_t RateImageSize[2];
+        uint32_t RenderMax[2];
+        float LumaScale[2];
+        float RcpLumaSize[2];
+        uint32_t TileSize;
+        float ContrastThreshold;
+        float DarkLuminance;
+        float MotionThreshold;
+        uint32_t UseShadowMask;
+    } csConstants;
+
+    csConstants.RateImageSize[0] = (Width + TileSize - 1) / TileSize;
+    csConstants.RateImageSize[1] = (Height + TileSize - 1) / TileSize;
+    csConstants.RenderMax[0] = Width - 1;
+    csConstants.RenderMax[1] = Height - 1;
+
+    // Last frame's luminance was written at its output size
+    csConstants.LumaScale[0] = (float)DynamicResolution::GetOutputWidth() / Width;
+    csConstants.LumaScale[1] = (float)DynamicResolution::GetOutputHeight() / Height;
+    csConstants.RcpLumaSize[0] = 1.0f / g_LumaBuffer.GetWidth();
+    csConstants.RcpLumaSize[1] = 1.0f / g_LumaBuffer.GetHeight();
+    csConstants.TileSize = TileSize;
+    csConstants.ContrastThreshold = ContrastThreshold;
+    csConstants.DarkLuminance = DarkLuminance;
+    csConstants.MotionThreshold = MotionThreshold;
+    csConstants.UseShadowMask = ShadowMaskValid ? 1 : 0;
+
+    Context.SetRootSignature(m_RootSig);
+    Context.SetPipelineState(m_RateCS);
+    Context.SetDynamicConstantBufferView(0, sizeof(csConstants), &csConstants);
+
+    // The color pass reads the shadow mask after this
+    Context.TransitionResource(g_LumaBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    Context.TransitionResource(g_VelocityBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    Context.TransitionResource(g_SunShadowMask,
+        D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+    Context.TransitionResource(g_ShadingRateImage, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, true);
+    Context.SetDynamicDescriptor(1, 0, g_LumaBuffer.GetSRV());
+    Context.SetDynamicDescriptor(1, 1, g_VelocityBuffer.GetSRV());
+    Context.SetDynamicDescriptor(1, 2, g_SunShadowMask.GetSRV());
+    Context.SetDynamicDescriptor(2, 0, g_ShadingRateImage.GetUAV());
+    Context.Dispatch2D(csConstants.RateImageSize[0], csConstants.RateImageSize[1]);
+
+    Context.TransitionResource(g_ShadingRateImage, D3D12_RESOURCE_STATE_SHADING_RATE_SOURCE);
+}
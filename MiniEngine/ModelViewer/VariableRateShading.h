@@ -0,0 +1,30 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#pragma once
+
+class ComputeContext;
+class BoolVar;
+
+// Tier 2 variable rate shading for the color pass.  Before it, a compute shader fills
+// Graphics::g_ShadingRateImage from last frame's luminance and velocity and this frame's sun shadow
+// mask, so that flat, fast moving and dark shadowed tiles shade fewer pixel shader invocations.
+namespace VariableRateShading
+{
+    extern BoolVar Enable;
+
+    void InitializeResources(void);
+
+    // Whether the option is on and the device supports a shading rate image
+    bool IsActive(void);
+
+    // Leaves g_ShadingRateImage ready for GraphicsContext::SetShadingRateImage().  The sun shadow mask is
+    // only read when ShadowMaskValid is set.
+    void Render(ComputeContext& Context, bool ShadowMaskValid);
+}
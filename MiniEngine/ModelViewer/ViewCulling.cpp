@@ -0,0 +1,424 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "ViewCulling.h"
+#include "PipelineState.h"
+#include "RootSignature.h"
+#include "CommandContext.h"
+#include "GraphicsCore.h"
+#include "BufferManager.h"
+#include "DynamicResolution.h"
+#include "AsyncReadback.h"
+#include "EngineProfiling.h"
+#include "Camera.h"
+#include "Model.h"
+#include "Math/BatchBounds.h"
+#include <algorithm>
+
+#include "CompiledShaders/ViewOcclusionDepthCS.h"
+
+using namespace Math;
+using namespace Graphics;
+
+namespace ViewCulling
+{
+    BoolVar FrustumCulling("Application/View Culling/Frustum", true);
+    BoolVar OcclusionCulling("Application/View Culling/Occlusion", true);
+    BoolVar FrontToBackSort("Application/View Culling/Front To Back", true);
+
+    enum { kTileSize = 16 };
+
+    RootSignature m_RootSig;
+    ComputePSO m_OcclusionDepthCS;
+
+    // The farthest depth of each tile, and the newest tiles read back with the view they were rendered from
+    StructuredBuffer m_TileDepth;
+    uint32_t m_MaxTiles = 0;
+    struct TileReadback
+    {
+        Matrix4 ViewProj;
+        uint32_t TilesX;
+        uint32_t TilesY;
+        uint32_t Width;     // The render size, which dynamic resolution changes
+        uint32_t Height;
+        std::vector<float> Depth;
+    };
+    TileReadback m_Readback;
+    bool m_NewReadback = false;
+
+    // Hi-Z pyramid of the newest readback.  Level 0 holds the tiles, and every texel of the levels above holds
+    // the farthest depth of the 2x2 texels below it.  Empty while there is no readback to test against.
+    struct PyramidLevel
+    {
+        uint32_t Width;
+        uint32_t Height;
+        std::vector<float> Depth;
+    };
+    std::vector<PyramidLevel> m_DepthPyramid;
+    Matrix4 m_PyramidViewProj;
+    uint32_t m_PyramidWidth = 0;
+    uint32_t m_PyramidHeight = 0;
+
+    AABBSoA m_Boxes;
+    std::vector<uint64_t> m_FrustumMask;
+    ProjectedBoxSoA m_ProjectedBoxes;
+
+    // The boxes seen from this frame's camera, projected once for the sort and the occluders, and the sort keys
+    // with their scratch copy
+    ProjectedBoxSoA m_CameraBoxes;
+    uint64_t m_CameraBoxesFrame = ~0ull;
+    std::vector<uint64_t> m_SortKeys;
+    std::vector<uint64_t> m_SortScratch;
+
+    void ReadOcclusionDepth(void);
+    bool IsOccluded(uint32_t meshIndex);
+    void ProjectCameraBoxes(const Camera& camera, uint32_t NumMeshes);
+    void RadixSort(std::vector<uint64_t>& Keys, std::vector<uint64_t>& Scratch);
+}
+
+void ViewCulling::InitializeResources( const Model& model )
+{
+    m_RootSig.Reset(3, 0);
+    m_RootSig[0].InitAsConstantBuffer(0);
+    m_RootSig[1].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 0, 1);
+    m_RootSig[2].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 0, 1);
+    m_RootSig.Finalize(L"View Culling");
+
+    m_OcclusionDepthCS.SetRootSignature(m_RootSig);
+    m_OcclusionDepthCS.SetComputeShader(g_pViewOcclusionDepthCS, sizeof(g_pViewOcclusionDepthCS));
+    m_OcclusionDepthCS.Finalize();
+
+    const uint32_t TilesX = ((uint32_t)g_SceneDepthBuffer.GetWidth() + kTileSize - 1) / kTileSize;
+    const uint32_t TilesY = ((uint32_t)g_SceneDepthBuffer.GetHeight() + kTileSize - 1) / kTileSize;
+    m_MaxTiles = TilesX * TilesY;
+
+    m_TileDepth.Create(L"View Occlusion Tile Depth", m_MaxTiles, sizeof(float));
+    m_NewReadback = false;
+
+    const uint32_t NumMeshes = model.m_Header.meshCount;
+    m_Boxes.Resize(NumMeshes);
+    for (uint32_t meshIndex = 0; meshIndex < NumMeshes; ++meshIndex)
+        m_Boxes.Set(meshIndex, model.m_pMesh[meshIndex].boundingBox.min, model.m_pMesh[meshIndex].boundingBox.max);
+    m_FrustumMask.resize((NumMeshes + 63) / 64);
+    m_ProjectedBoxes.Resize(NumMeshes);
+    m_CameraBoxes.Resize(NumMeshes);
+    m_CameraBoxesFrame = ~0ull;
+}
+
+void ViewCulling::Shutdown( void )
+{
+    m_TileDepth.Destroy();
+    m_Readback.Depth.clear();
+    m_NewReadback = false;
+    m_DepthPyramid.clear();
+    m_Boxes.Resize(0);
+    m_FrustumMask.clear();
+    m_ProjectedBoxes.Resize(0);
+    m_CameraBoxes.Resize(0);
+    m_SortKeys.clear();
+    m_SortScratch.clear();
+}
+
+void ViewCulling::CaptureOcclusionDepth( GraphicsContext& gfxContext, const Camera& camera )
+{
+    if (!OcclusionCulling)
+        return;
+
+    const uint32_t TilesX = (DynamicResolution::GetWidth() + kTileSize - 1) / kTileSize;
+    const uint32_t TilesY = (DynamicResolution::GetHeight() + kTileSize - 1) / kTileSize;
+    if (TilesX * TilesY > m_MaxTiles)
+        return;
+
+    __declspec(align(16)) struct
+    {
+        uint32_t ViewportSize[2];
+        uint32_t TilesPerRow;
+    } csConstants;
+
+    csConstants.ViewportSize[0] = DynamicResolution::GetWidth();
+    csConstants.ViewportSize[1] = DynamicResolution::GetHeight();
+    csConstants.TilesPerRow = TilesX;
+
+    ComputeContext& Context = gfxContext.GetComputeContext();
+
+    {
+        ScopedTimer _prof(L"Occlusion Depth", gfxContext);
+
+        Context.SetRootSignature(m_RootSig);
+        Context.SetPipelineState(m_OcclusionDepthCS);
+        Context.SetDynamicConstantBufferView(0, sizeof(csConstants), &csConstants);
+
+        Context.TransitionResource(g_SceneDepthBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        Context.TransitionResource(m_TileDepth, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, true);
+
+        Context.SetDynamicDescriptor(1, 0, g_SceneDepthBuffer.GetDepthSRV());
+        Context.SetDynamicDescriptor(2, 0, m_TileDepth.GetUAV());
+        Context.Dispatch(TilesX, TilesY, 1);
+        Context.TransitionResource(m_TileDepth, D3D12_RESOURCE_STATE_COPY_SOURCE, true);
+
+        // The frame's depth is dropped if the CPU has fallen so far behind that every readback is in flight
+        const Matrix4 ViewProj = camera.GetViewProjMatrix();
+        const uint32_t Width = csConstants.ViewportSize[0];
+        const uint32_t Height = csConstants.ViewportSize[1];
+        AsyncReadback::Request(Context, m_TileDepth, 0, TilesX * TilesY * sizeof(float),
+            [=]( const void* Data, size_t Size )
+        {
+            m_Readback.ViewProj = ViewProj;
+            m_Readback.TilesX = TilesX;
+            m_Readback.TilesY = TilesY;
+            m_Readback.Width = Width;
+            m_Readback.Height = Height;
+            m_Readback.Depth.assign((const float*)Data, (const float*)Data + Size / sizeof(float));
+            m_NewReadback = true;
+        });
+    }
+}
+
+void ViewCulling::ReadOcclusionDepth( void )
+{
+    if (!m_NewReadback)
+        return;
+
+    m_NewReadback = false;
+
+    PyramidLevel Level;
+    Level.Width = m_Readback.TilesX;
+    Level.Height = m_Readback.TilesY;
+    Level.Depth.swap(m_Readback.Depth);
+
+    m_DepthPyramid.clear();
+    m_DepthPyramid.push_back(std::move(Level));
+    m_PyramidViewProj = m_Readback.ViewProj;
+    m_PyramidWidth = m_Readback.Width;
+    m_PyramidHeight = m_Readback.Height;
+
+    while (m_DepthPyramid.back().Width > 1 || m_DepthPyramid.back().Height > 1)
+    {
+        const PyramidLevel& Below = m_DepthPyramid.back();
+
+        PyramidLevel Above;
+        Above.Width = (Below.Width + 1) / 2;
+        Above.Height = (Below.Height + 1) / 2;
+        Above.Depth.resize(Above.Width * Above.Height);
+
+        // Odd edges repeat their last texel
+        for (uint32_t y = 0; y < Above.Height; ++y)
+        {
+            const uint32_t y0 = y * 2, y1 = std::min(y * 2 + 1, Below.Height - 1);
+            for (uint32_t x = 0; x < Above.Width; ++x)
+            {
+                const uint32_t x0 = x * 2, x1 = std::min(x * 2 + 1, Below.Width - 1);
+                Above.Depth[y * Above.Width + x] = std::min(
+                    std::min(Below.Depth[y0 * Below.Width + x0], Below.Depth[y0 * Below.Width + x1]),
+                    std::min(Below.Depth[y1 * Below.Width + x0], Below.Depth[y1 * Below.Width + x1]));
+            }
+        }
+
+        m_DepthPyramid.push_back(std::move(Above));
+    }
+}
+
+// Tests the box's screen rectangle and nearest depth in the view the depth was rendered from, which CullMeshes
+// projected every box into.  Depth is reversed, so nearer is larger.
+bool ViewCulling::IsOccluded( uint32_t meshIndex )
+{
+    const float MinU = m_ProjectedBoxes.MinU[meshIndex], MaxU = m_ProjectedBoxes.MaxU[meshIndex];
+    const float MinV = m_ProjectedBoxes.MinV[meshIndex], MaxV = m_ProjectedBoxes.MaxV[meshIndex];
+    const float NearestDepth = m_ProjectedBoxes.NearestDepth[meshIndex];
+
+    // Nothing is known about what lay outside of the view, and boxes that cross the near plane are in front of
+    // everything
+    if (MinU < 0.0f || MinV < 0.0f || MaxU > 1.0f || MaxV > 1.0f)
+        return false;
+
+    const PyramidLevel& Tiles = m_DepthPyramid[0];
+    const float ViewportWidth = (float)m_PyramidWidth, ViewportHeight = (float)m_PyramidHeight;
+    uint32_t X0 = std::min((uint32_t)(MinU * ViewportWidth / kTileSize), Tiles.Width - 1);
+    uint32_t X1 = std::min((uint32_t)(MaxU * ViewportWidth / kTileSize), Tiles.Width - 1);
+    uint32_t Y0 = std::min((uint32_t)(MinV * ViewportHeight / kTileSize), Tiles.Height - 1);
+    uint32_t Y1 = std::min((uint32_t)(MaxV * ViewportHeight / kTileSize), Tiles.Height - 1);
+
+    // Climb to the first level where the rectangle covers at most 2x2 texels
+    uint32_t Level = 0;
+    while (X1 - X0 > 1 || Y1 - Y0 > 1)
+    {
+        X0 >>= 1; X1 >>= 1;
+        Y0 >>= 1; Y1 >>= 1;
+        ++Level;
+    }
+
+    const PyramidLevel& Pyramid = m_DepthPyramid[Level];
+    float FarthestDepth = 1.0f;
+    for (uint32_t y = Y0; y <= Y1; ++y)
+        for (uint32_t x = X0; x <= X1; ++x)
+            FarthestDepth = std::min(FarthestDepth, Pyramid.Depth[y * Pyramid.Width + x]);
+
+    return NearestDepth < FarthestDepth;
+}
+
+void ViewCulling::CullMeshes( const Model& model, const Camera& camera, std::vector<bool>& MeshIsVisible )
+{
+    ScopedTimer _prof(L"View Culling");
+
+    const uint32_t NumMeshes = model.m_Header.meshCount;
+    MeshIsVisible.assign(NumMeshes, true);
+
+    if (OcclusionCulling)
+        ReadOcclusionDepth();
+    else
+        m_DepthPyramid.clear();
+
+    uint32_t NumFrustumCulled = 0;
+    if (FrustumCulling && NumMeshes > 0)
+    {
+        camera.GetWorldSpaceFrustum().IntersectBoxes(m_Boxes, NumMeshes, m_FrustumMask.data());
+        for (uint32_t meshIndex = 0; meshIndex < NumMeshes; ++meshIndex)
+        {
+            if (!(m_FrustumMask[meshIndex / 64] & (1ull << (meshIndex % 64))))
+            {
+                MeshIsVisible[meshIndex] = false;
+                ++NumFrustumCulled;
+            }
+        }
+    }
+
+    uint32_t NumOcclusionCulled = 0;
+    if (!m_DepthPyramid.empty() && NumMeshes > 0)
+    {
+        ProjectBoxes(m_PyramidViewProj, m_Boxes, NumMeshes, m_ProjectedBoxes);
+        for (uint32_t meshIndex = 0; meshIndex < NumMeshes; ++meshIndex)
+        {
+            if (MeshIsVisible[meshIndex] && IsOccluded(meshIndex))
+            {
+                MeshIsVisible[meshIndex] = false;
+                ++NumOcclusionCulled;
+            }
+        }
+    }
+
+    EngineProfiling::SetCounter("Meshes Drawn", NumMeshes - NumFrustumCulled - NumOcclusionCulled);
+    EngineProfiling::SetCounter("Meshes Frustum Culled", NumFrustumCulled);
+    EngineProfiling::SetCounter("Meshes Occlusion Culled", NumOcclusionCulled);
+}
+
+void ViewCulling::ProjectCameraBoxes( const Camera& camera, uint32_t NumMeshes )
+{
+    if (m_CameraBoxesFrame == Graphics::GetFrameCount())
+        return;
+
+    ProjectBoxes(camera.GetViewProjMatrix(), m_Boxes, NumMeshes, m_CameraBoxes);
+    m_CameraBoxesFrame = Graphics::GetFrameCount();
+}
+
+// Least significant byte first, eight bits a pass.  Passes where every key has the same byte leave the order
+// as it is, so they are skipped, and the mesh indices at the bottom of the keys rarely need more than two.
+void ViewCulling::RadixSort( std::vector<uint64_t>& Keys, std::vector<uint64_t>& Scratch )
+{
+    const size_t Count = Keys.size();
+    Scratch.resize(Count);
+
+    uint32_t Histogram[8][256] = {};
+    for (size_t i = 0; i < Count; ++i)
+        for (uint32_t Pass = 0; Pass < 8; ++Pass)
+            Histogram[Pass][(Keys[i] >> (Pass * 8)) & 0xFF]++;
+
+    for (uint32_t Pass = 0; Pass < 8; ++Pass)
+    {
+        uint32_t* Offsets = Histogram[Pass];
+        if (Offsets[(Keys[0] >> (Pass * 8)) & 0xFF] == Count)
+            continue;
+
+        uint32_t Sum = 0;
+        for (uint32_t Digit = 0; Digit < 256; ++Digit)
+        {
+            const uint32_t DigitCount = Offsets[Digit];
+            Offsets[Digit] = Sum;
+            Sum += DigitCount;
+        }
+
+        for (size_t i = 0; i < Count; ++i)
+            Scratch[Offsets[(Keys[i] >> (Pass * 8)) & 0xFF]++] = Keys[i];
+        Keys.swap(Scratch);
+    }
+}
+
+void ViewCulling::SortMeshes( const Model& model, const Camera& camera, const std::vector<bool>& MaterialIsCutout,
+    const std::vector<bool>& MeshIsVisible, std::vector<uint32_t>& MeshOrder )
+{
+    const uint32_t NumMeshes = model.m_Header.meshCount;
+    if (!FrontToBackSort || NumMeshes == 0)
+    {
+        MeshOrder.clear();
+        return;
+    }
+
+    ScopedTimer _prof(L"Sort Meshes");
+
+    ProjectCameraBoxes(camera, NumMeshes);
+
+    // Keys hold, from the top, the cutout bit, the distance band, the material and the mesh.  Reversed depth is
+    // positive and falls with distance, so the exponent and top two mantissa bits of its float make bands a
+    // quarter of an octave deep, and inverting them puts the nearest first.  Boxes across the near plane are
+    // the nearest of all, and hidden meshes take the last band.
+    enum { kBandShift = 21, kBandBits = 10, kHiddenBand = (1 << kBandBits) - 1 };
+    const uint32_t kOneBits = 0x3F800000u;
+    m_SortKeys.resize(NumMeshes);
+    for (uint32_t meshIndex = 0; meshIndex < NumMeshes; ++meshIndex)
+    {
+        const uint32_t materialIndex = model.m_pMesh[meshIndex].materialIndex;
+
+        uint32_t Band = kHiddenBand;
+        if (MeshIsVisible[meshIndex])
+        {
+            float NearestDepth = m_CameraBoxes.MinU[meshIndex] == -FLT_MAX ? 1.0f : m_CameraBoxes.NearestDepth[meshIndex];
+            NearestDepth = std::min(std::max(NearestDepth, 0.0f), 1.0f);
+            uint32_t DepthBits;
+            memcpy(&DepthBits, &NearestDepth, sizeof(DepthBits));
+            Band = (kOneBits >> kBandShift) - (DepthBits >> kBandShift);
+        }
+
+        m_SortKeys[meshIndex] = (uint64_t)(MaterialIsCutout[materialIndex] ? 1 : 0) << 63 | (uint64_t)Band << 52 |
+            (uint64_t)(materialIndex & 0xFFFFF) << 32 | meshIndex;
+    }
+
+    RadixSort(m_SortKeys, m_SortScratch);
+
+    MeshOrder.resize(NumMeshes);
+    for (uint32_t i = 0; i < NumMeshes; ++i)
+        MeshOrder[i] = (uint32_t)m_SortKeys[i];
+}
+
+void ViewCulling::FindOccluders( const Model& model, const Camera& camera, float MinScreenArea,
+    const std::vector<bool>& MeshIsVisible, std::vector<bool>& MeshIsOccluder )
+{
+    const uint32_t NumMeshes = model.m_Header.meshCount;
+    MeshIsOccluder.assign(NumMeshes, false);
+    if (NumMeshes == 0)
+        return;
+
+    ProjectCameraBoxes(camera, NumMeshes);
+
+    for (uint32_t meshIndex = 0; meshIndex < NumMeshes; ++meshIndex)
+    {
+        if (!MeshIsVisible[meshIndex])
+            continue;
+
+        // A box across the near plane surrounds the camera, so it may cover any part of the screen
+        const float MinU = m_CameraBoxes.MinU[meshIndex];
+        if (MinU == -FLT_MAX)
+        {
+            MeshIsOccluder[meshIndex] = true;
+            continue;
+        }
+
+        const float Width = std::min(m_CameraBoxes.MaxU[meshIndex], 1.0f) - std::max(MinU, 0.0f);
+        const float Height = std::min(m_CameraBoxes.MaxV[meshIndex], 1.0f) - std::max(m_CameraBoxes.MinV[meshIndex], 0.0f);
+        MeshIsOccluder[meshIndex] = Width > 0.0f && Height > 0.0f && Width * Height >= MinScreenArea;
+    }
+}
@@ -0,0 +1,52 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+class Model;
+class GraphicsContext;
+class BoolVar;
+namespace Math
+{
+    class Camera;
+}
+
+// Culls the meshes of the main view on the CPU.  Bounding boxes are tested against the view frustum in
+// batches, and the survivors against a Hi-Z pyramid of the depth of a recent frame.  The depth
+// is reduced to tiles on the GPU and read back a few frames later, so meshes that come out from behind an
+// occluder can take that long to appear.
+namespace ViewCulling
+{
+    extern BoolVar FrustumCulling;
+    extern BoolVar OcclusionCulling;
+    extern BoolVar FrontToBackSort;
+
+    void InitializeResources(const Model& model);
+    void Shutdown(void);
+
+    // Flags the meshes the camera may see and reports culled and drawn counts to the profiler
+    void CullMeshes(const Model& model, const Math::Camera& camera, std::vector<bool>& MeshIsVisible);
+
+    // Orders every mesh for the camera's passes:  opaque ahead of cutout, then front to back in bands of
+    // distance, then by material within a band, so that the depth test rejects more of the hidden pixels.
+    // Hidden meshes go last.  MeshOrder is left empty, for the order of the file, when sorting is off.
+    void SortMeshes(const Model& model, const Math::Camera& camera, const std::vector<bool>& MaterialIsCutout,
+        const std::vector<bool>& MeshIsVisible, std::vector<uint32_t>& MeshOrder);
+
+    // Flags the visible meshes whose boxes cover at least MinScreenArea of the screen, as a fraction of it, to
+    // stand in for the whole depth pre-pass when it is restricted to the large occluders
+    void FindOccluders(const Model& model, const Math::Camera& camera, float MinScreenArea,
+        const std::vector<bool>& MeshIsVisible, std::vector<bool>& MeshIsOccluder);
+
+    // Reduces the finished depth pre-pass to tiles and queues their readback
+    void CaptureOcclusionDepth(GraphicsContext& gfxContext, const Math::Camera& camera);
+}
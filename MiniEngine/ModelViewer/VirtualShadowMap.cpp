@@ -0,0 +1,448 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "VirtualShadowMap.h"
+#include "PipelineState.h"
+#include "RootSignature.h"
+#include "CommandContext.h"
+#include "CommandListManager.h"
+#include "GraphicsCore.h"
+#include "BufferManager.h"
+#include "DynamicResolution.h"
+#include "ShadowBuffer.h"
+#include "ReadbackBuffer.h"
+#include "GpuMemoryTracker.h"
+#include "ShadowCamera.h"
+#include "Camera.h"
+#include <algorithm>
+
+#include "CompiledShaders/VirtualShadowPagesCS.h"
+
+using namespace Math;
+using namespace Graphics;
+
+namespace VirtualShadowMap
+{
+    BoolVar Enable("Application/Lighting/Virtual Shadow Map/Enable", false);
+    IntVar MaxPageUpdates("Application/Lighting/Virtual Shadow Map/Max Page Updates", 16, 1, kMaxPageUpdates);
+
+    ShadowBuffer m_VirtualShadowMap;
+
+    enum { kReadbackLatency = 3 };
+    static const uint16_t kNotResident = 0xFFFF;
+    static const uint32_t kFreeSlot = 0xFFFFFFFF;
+
+    bool m_Supported = false;
+
+    Microsoft::WRL::ComPtr<ID3D12Heap> m_PagePool;
+    RootSignature m_RootSig;
+    ComputePSO m_PageRequestCS;
+
+    ByteAddressBuffer m_PageRequests;
+    ReadbackBuffer m_RequestReadback[kReadbackLatency];
+    uint64_t m_RequestFence[kReadbackLatency];
+    uint32_t m_ReadbackHead = 0;
+    uint32_t m_ReadbackTail = 0;
+    uint32_t m_NumPendingReadbacks = 0;
+
+    uint32_t m_PageWidth = 0;
+    uint32_t m_PageHeight = 0;
+    uint32_t m_PagesX = 0;
+    uint32_t m_PagesY = 0;
+
+    std::vector<uint16_t> m_PageSlot;           // Pool slot behind each page, or kNotResident
+    std::vector<uint32_t> m_PageLastRequest;    // Frame of the last readback that requested each page
+    std::vector<bool> m_PageDirty;
+    std::vector<uint32_t> m_SlotPage;           // Page held by each pool slot, or kFreeSlot
+    std::vector<uint32_t> m_RequestedPages;     // Requested pages that are not resident yet
+    uint32_t m_LastReadbackFrame = 0;
+    uint32_t m_DirtyCursor = 0;
+
+    void ReadRequests(void);
+    void EvictAll(ID3D12CommandQueue* Queue);
+    uint32_t AllocateSlot(uint32_t& EvictedPage);
+}
+
+void VirtualShadowMap::InitializeResources( void )
+{
+    D3D12_FEATURE_DATA_D3D12_OPTIONS Options = {};
+    m_Supported = SUCCEEDED(g_Device->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS, &Options, sizeof(Options))) &&
+        Options.TiledResourcesTier >= D3D12_TILED_RESOURCES_TIER_2;
+
+    if (!m_Supported)
+    {
+        Utility::Print("Virtual shadow maps require tiled resources tier 2 and are disabled.\n");
+        return;
+    }
+
+    m_RootSig.Reset(3, 0);
+    m_RootSig[0].InitAsConstantBuffer(0);
+    m_RootSig[1].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 0, 1);
+    m_RootSig[2].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 0, 1);
+    m_RootSig.Finalize(L"Virtual Shadow Map");
+
+    m_PageRequestCS.SetRootSignature(m_RootSig);
+    m_PageRequestCS.SetComputeShader(g_pVirtualShadowPagesCS, sizeof(g_pVirtualShadowPagesCS));
+    m_PageRequestCS.Finalize();
+
+    m_VirtualShadowMap.CreateReserved(L"Virtual Sun Shadow Map", kVirtualSize, kVirtualSize);
+
+    // Pages are whatever a 64KB tile of the shadow format holds
+    D3D12_PACKED_MIP_INFO PackedMipInfo;
+    D3D12_TILE_SHAPE TileShape;
+    D3D12_SUBRESOURCE_TILING Tiling;
+    UINT NumTiles, NumSubresources = 1;
+    g_Device->GetResourceTiling(m_VirtualShadowMap.GetResource(), &NumTiles, &PackedMipInfo, &TileShape,
+        &NumSubresources, 0, &Tiling);
+
+    m_PageWidth = TileShape.WidthInTexels;
+    m_PageHeight = TileShape.HeightInTexels;
+    m_PagesX = Tiling.WidthInTiles;
+    m_PagesY = Tiling.HeightInTiles;
+    const uint32_t NumPages = m_PagesX * m_PagesY;
+
+    D3D12_HEAP_DESC HeapDesc = {};
+    HeapDesc.SizeInBytes = (UINT64)kPoolPages * D3D12_TILED_RESOURCE_TILE_SIZE_IN_BYTES;
+    HeapDesc.Properties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
+    HeapDesc.Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES;
+    ASSERT_SUCCEEDED(g_Device->CreateHeap(&HeapDesc, MY_IID_PPV_ARGS(m_PagePool.GetAddressOf())));
+    GpuMemoryTracker::TrackHeap(m_PagePool.Get(), GpuMemoryTracker::kShadowMaps);
+
+    m_PageRequests.Create(L"Virtual Shadow Page Requests", NumPages, sizeof(uint32_t));
+    for (uint32_t i = 0; i < kReadbackLatency; ++i)
+    {
+        m_RequestReadback[i].Create(L"Virtual Shadow Page Request Readback", NumPages, sizeof(uint32_t));
+        m_RequestFence[i] = 0;
+    }
+
+    m_PageSlot.assign(NumPages, kNotResident);
+    m_PageLastRequest.assign(NumPages, 0);
+    m_PageDirty.assign(NumPages, false);
+    m_SlotPage.assign(kPoolPages, kFreeSlot);
+    m_RequestedPages.clear();
+}
+
+void VirtualShadowMap::Shutdown( void )
+{
+    if (!m_Supported)
+        return;
+
+    m_VirtualShadowMap.Destroy();
+    m_PageRequests.Destroy();
+    for (uint32_t i = 0; i < kReadbackLatency; ++i)
+        m_RequestReadback[i].Destroy();
+    m_PagePool = nullptr;
+}
+
+bool VirtualShadowMap::IsSupported( void )
+{
+    return m_Supported;
+}
+
+bool VirtualShadowMap::IsEnabled( void )
+{
+    return Enable && m_Supported;
+}
+
+void VirtualShadowMap::RequestPages( GraphicsContext& gfxContext, const Camera& ViewCamera, const GameCore::ShadowCamera& Shadow )
+{
+    ScopedTimer _prof(L"Request Shadow Pages", gfxContext);
+
+    __declspec(align(16)) struct
+    {
+        Matrix4 InvViewProj;
+        Matrix4 ShadowMatrix;
+        uint32_t ViewportSize[2];
+        uint32_t PageSize[2];
+        uint32_t PagesPerRow;
+        float VirtualSize;
+    } csConstants;
+
+    csConstants.InvViewProj = Invert(ViewCamera.GetViewProjMatrix());
+    csConstants.ShadowMatrix = Shadow.GetShadowMatrix();
+    csConstants.ViewportSize[0] = DynamicResolution::GetWidth();
+    csConstants.ViewportSize[1] = DynamicResolution::GetHeight();
+    csConstants.PageSize[0] = m_PageWidth;
+    csConstants.PageSize[1] = m_PageHeight;
+    csConstants.PagesPerRow = m_PagesX;
+    csConstants.VirtualSize = (float)kVirtualSize;
+
+    ComputeContext& Context = gfxContext.GetComputeContext();
+
+    Context.SetRootSignature(m_RootSig);
+    Context.SetPipelineState(m_PageRequestCS);
+    Context.SetDynamicConstantBufferView(0, sizeof(csConstants), &csConstants);
+
+    Context.TransitionResource(g_SceneDepthBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    Context.TransitionResource(m_PageRequests, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, true);
+    Context.ClearUAV(m_PageRequests);
+
+    Context.SetDynamicDescriptor(1, 0, g_SceneDepthBuffer.GetDepthSRV());
+    Context.SetDynamicDescriptor(2, 0, m_PageRequests.GetUAV());
+    Context.Dispatch2D(DynamicResolution::GetWidth(), DynamicResolution::GetHeight());
+
+    // Drop this frame's requests if the CPU has fallen so far behind that every readback is in flight
+    if (m_NumPendingReadbacks == kReadbackLatency)
+        return;
+
+    Context.CopyBuffer(m_RequestReadback[m_ReadbackHead], m_PageRequests);
+    m_RequestFence[m_ReadbackHead] = gfxContext.Flush();
+    m_ReadbackHead = (m_ReadbackHead + 1) % kReadbackLatency;
+    ++m_NumPendingReadbacks;
+}
+
+void VirtualShadowMap::ReadRequests( void )
+{
+    // Only the newest completed readback matters.  Older ones are superseded.
+    int32_t Newest = -1;
+    while (m_NumPendingReadbacks > 0 && g_CommandManager.IsFenceComplete(m_RequestFence[m_ReadbackTail]))
+    {
+        Newest = (int32_t)m_ReadbackTail;
+        m_ReadbackTail = (m_ReadbackTail + 1) % kReadbackLatency;
+        --m_NumPendingReadbacks;
+    }
+
+    if (Newest < 0)
+        return;
+
+    const uint32_t Frame = (uint32_t)Graphics::GetFrameCount();
+    const uint32_t NumPages = m_PagesX * m_PagesY;
+
+    m_RequestedPages.clear();
+
+    const uint32_t* Requests = (const uint32_t*)m_RequestReadback[Newest].Map();
+    for (uint32_t Page = 0; Page < NumPages; ++Page)
+    {
+        if (Requests[Page] == 0)
+            continue;
+
+        m_PageLastRequest[Page] = Frame;
+        if (m_PageSlot[Page] == kNotResident)
+            m_RequestedPages.push_back(Page);
+    }
+    m_RequestReadback[Newest].Unmap();
+
+    m_LastReadbackFrame = Frame;
+}
+
+void VirtualShadowMap::EvictAll( ID3D12CommandQueue* Queue )
+{
+    std::vector<D3D12_TILED_RESOURCE_COORDINATE> Coordinates;
+    for (uint32_t Slot = 0; Slot < kPoolPages; ++Slot)
+    {
+        const uint32_t Page = m_SlotPage[Slot];
+        if (Page == kFreeSlot)
+            continue;
+
+        D3D12_TILED_RESOURCE_COORDINATE Coord = { Page % m_PagesX, Page / m_PagesX, 0, 0 };
+        Coordinates.push_back(Coord);
+        m_PageSlot[Page] = kNotResident;
+        m_PageDirty[Page] = false;
+        m_SlotPage[Slot] = kFreeSlot;
+    }
+
+    if (Coordinates.empty())
+        return;
+
+    D3D12_TILE_RANGE_FLAGS RangeFlags = D3D12_TILE_RANGE_FLAG_NULL;
+    UINT RangeTileCount = (UINT)Coordinates.size();
+    Queue->UpdateTileMappings(m_VirtualShadowMap.GetResource(), (UINT)Coordinates.size(), Coordinates.data(), nullptr,
+        nullptr, 1, &RangeFlags, nullptr, &RangeTileCount, D3D12_TILE_MAPPING_FLAG_NONE);
+}
+
+uint32_t VirtualShadowMap::AllocateSlot( uint32_t& EvictedPage )
+{
+    EvictedPage = kFreeSlot;
+
+    // Prefer a free slot, then the page that has gone unrequested the longest.  Pages requested by the
+    // newest readback are on screen and must stay.
+    uint32_t BestSlot = kFreeSlot;
+    uint32_t OldestRequest = m_LastReadbackFrame;
+    for (uint32_t Slot = 0; Slot < kPoolPages; ++Slot)
+    {
+        const uint32_t Page = m_SlotPage[Slot];
+        if (Page == kFreeSlot)
+            return Slot;
+
+        if (m_PageLastRequest[Page] < OldestRequest)
+        {
+            OldestRequest = m_PageLastRequest[Page];
+            BestSlot = Slot;
+        }
+    }
+
+    if (BestSlot != kFreeSlot)
+    {
+        EvictedPage = m_SlotPage[BestSlot];
+        m_PageSlot[EvictedPage] = kNotResident;
+        m_PageDirty[EvictedPage] = false;
+        m_SlotPage[BestSlot] = kFreeSlot;
+    }
+    return BestSlot;
+}
+
+uint32_t VirtualShadowMap::UpdatePages( const GameCore::ShadowCamera& Shadow, uint32_t* PageList, uint32_t MaxPages )
+{
+    ASSERT(MaxPages <= kMaxPageUpdates);
+
+    ID3D12CommandQueue* Queue = g_CommandManager.GetGraphicsQueue().GetCommandQueue();
+
+    // Every page moves with the projection, so nothing resident is worth keeping
+    if (Shadow.HasMatrixChanged())
+        EvictAll(Queue);
+
+    ReadRequests();
+
+    D3D12_TILED_RESOURCE_COORDINATE Evicted[kMaxPageUpdates];
+    D3D12_TILED_RESOURCE_COORDINATE Mapped[kMaxPageUpdates];
+    UINT MappedSlots[kMaxPageUpdates];
+    UINT NumEvicted = 0;
+    UINT NumMapped = 0;
+
+    // Newly requested pages first, since those pixels are still using the fallback
+    while (NumMapped < MaxPages && !m_RequestedPages.empty())
+    {
+        const uint32_t Page = m_RequestedPages.back();
+        if (m_PageSlot[Page] != kNotResident)
+        {
+            m_RequestedPages.pop_back();
+            continue;
+        }
+
+        uint32_t EvictedPage;
+        const uint32_t Slot = AllocateSlot(EvictedPage);
+        if (Slot == kFreeSlot)
+            break;
+
+        m_RequestedPages.pop_back();
+
+        if (EvictedPage != kFreeSlot)
+        {
+            D3D12_TILED_RESOURCE_COORDINATE Coord = { EvictedPage % m_PagesX, EvictedPage / m_PagesX, 0, 0 };
+            Evicted[NumEvicted++] = Coord;
+        }
+
+        D3D12_TILED_RESOURCE_COORDINATE Coord = { Page % m_PagesX, Page / m_PagesX, 0, 0 };
+        Mapped[NumMapped] = Coord;
+        MappedSlots[NumMapped] = Slot;
+        PageList[NumMapped++] = Page;
+
+        m_PageSlot[Page] = (uint16_t)Slot;
+        m_PageDirty[Page] = false;
+        m_SlotPage[Slot] = Page;
+    }
+
+    // Unmap evicted pages so that they fall back instead of aliasing their replacements
+    if (NumEvicted > 0)
+    {
+        D3D12_TILE_RANGE_FLAGS RangeFlags = D3D12_TILE_RANGE_FLAG_NULL;
+        Queue->UpdateTileMappings(m_VirtualShadowMap.GetResource(), NumEvicted, Evicted, nullptr,
+            nullptr, 1, &RangeFlags, nullptr, &NumEvicted, D3D12_TILE_MAPPING_FLAG_NONE);
+    }
+
+    if (NumMapped > 0)
+    {
+        UINT RangeTileCounts[kMaxPageUpdates];
+        for (uint32_t i = 0; i < NumMapped; ++i)
+            RangeTileCounts[i] = 1;
+
+        Queue->UpdateTileMappings(m_VirtualShadowMap.GetResource(), NumMapped, Mapped, nullptr,
+            m_PagePool.Get(), NumMapped, nullptr, MappedSlots, RangeTileCounts, D3D12_TILE_MAPPING_FLAG_NONE);
+    }
+
+    // Fill the rest of the budget with invalidated pages, continuing where the last frame stopped
+    uint32_t NumPages = NumMapped;
+    for (uint32_t i = 0; i < kPoolPages && NumPages < MaxPages; ++i)
+    {
+        const uint32_t Slot = (m_DirtyCursor + i) % kPoolPages;
+        const uint32_t Page = m_SlotPage[Slot];
+        if (Page != kFreeSlot && m_PageDirty[Page])
+        {
+            m_PageDirty[Page] = false;
+            PageList[NumPages++] = Page;
+            m_DirtyCursor = Slot + 1;
+        }
+    }
+
+    return NumPages;
+}
+
+void VirtualShadowMap::InvalidateAll( void )
+{
+    for (uint32_t Slot = 0; Slot < kPoolPages; ++Slot)
+    {
+        if (m_SlotPage[Slot] != kFreeSlot)
+            m_PageDirty[m_SlotPage[Slot]] = true;
+    }
+}
+
+void VirtualShadowMap::InvalidateBox( const GameCore::ShadowCamera& Shadow, const Vector3& MinBound, const Vector3& MaxBound )
+{
+    if (!m_Supported)
+        return;
+
+    // Bound the box's footprint in texture space by projecting its corners
+    float MinU = 1.0f, MinV = 1.0f, MaxU = 0.0f, MaxV = 0.0f;
+    for (uint32_t c = 0; c < 8; ++c)
+    {
+        Vector3 Corner(c & 1 ? MaxBound.GetX() : MinBound.GetX(), c & 2 ? MaxBound.GetY() : MinBound.GetY(),
+            c & 4 ? MaxBound.GetZ() : MinBound.GetZ());
+        Vector4 Coord = Shadow.GetShadowMatrix() * Corner;
+        MinU = std::min(MinU, (float)Coord.GetX());
+        MinV = std::min(MinV, (float)Coord.GetY());
+        MaxU = std::max(MaxU, (float)Coord.GetX());
+        MaxV = std::max(MaxV, (float)Coord.GetY());
+    }
+
+    if (MaxU < 0.0f || MaxV < 0.0f || MinU >= 1.0f || MinV >= 1.0f)
+        return;
+
+    const uint32_t X0 = (uint32_t)(std::max(MinU, 0.0f) * kVirtualSize) / m_PageWidth;
+    const uint32_t Y0 = (uint32_t)(std::max(MinV, 0.0f) * kVirtualSize) / m_PageHeight;
+    const uint32_t X1 = std::min((uint32_t)(MaxU * kVirtualSize) / m_PageWidth, m_PagesX - 1);
+    const uint32_t Y1 = std::min((uint32_t)(MaxV * kVirtualSize) / m_PageHeight, m_PagesY - 1);
+
+    for (uint32_t Y = Y0; Y <= Y1; ++Y)
+    {
+        for (uint32_t X = X0; X <= X1; ++X)
+        {
+            const uint32_t Page = Y * m_PagesX + X;
+            if (m_PageSlot[Page] != kNotResident)
+                m_PageDirty[Page] = true;
+        }
+    }
+}
+
+D3D12_RECT VirtualShadowMap::GetPageRect( uint32_t Page )
+{
+    const LONG X = (LONG)((Page % m_PagesX) * m_PageWidth);
+    const LONG Y = (LONG)((Page / m_PagesX) * m_PageHeight);
+    D3D12_RECT Rect = { X, Y, X + (LONG)m_PageWidth, Y + (LONG)m_PageHeight };
+    return Rect;
+}
+
+Matrix4 VirtualShadowMap::GetPageViewProjMatrix( const GameCore::ShadowCamera& Shadow, uint32_t Page )
+{
+    // Scale and offset clip space so that the page's rectangle fills [-1, 1]
+    const D3D12_RECT Rect = GetPageRect(Page);
+    const float Left = Rect.left * 2.0f / kVirtualSize - 1.0f;
+    const float Right = Rect.right * 2.0f / kVirtualSize - 1.0f;
+    const float Top = 1.0f - Rect.top * 2.0f / kVirtualSize;
+    const float Bottom = 1.0f - Rect.bottom * 2.0f / kVirtualSize;
+
+    const float ScaleX = 2.0f / (Right - Left);
+    const float ScaleY = 2.0f / (Top - Bottom);
+    Matrix4 Crop(
+        Vector4(ScaleX, 0.0f, 0.0f, 0.0f),
+        Vector4(0.0f, ScaleY, 0.0f, 0.0f),
+        Vector4(0.0f, 0.0f, 1.0f, 0.0f),
+        Vector4(-(Right + Left) * 0.5f * ScaleX, -(Top + Bottom) * 0.5f * ScaleY, 0.0f, 1.0f));
+
+    return Crop * Shadow.GetViewProjMatrix();
+}
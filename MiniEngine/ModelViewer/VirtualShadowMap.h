@@ -0,0 +1,67 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#pragma once
+
+#include <cstdint>
+
+class ShadowBuffer;
+class GraphicsContext;
+class BoolVar;
+class IntVar;
+namespace Math
+{
+    class Vector3;
+    class Matrix4;
+    class Camera;
+}
+namespace GameCore
+{
+    class ShadowCamera;
+}
+
+// A very high resolution sun shadow map backed by a reserved resource.  Pixels in view request the
+// pages they project into.  Requests are read back a few frames later and physical 64KB pages from a
+// fixed pool are mapped behind them, evicting the least recently requested pages when the pool is
+// full.  Only newly mapped and invalidated pages are rendered, so memory and per-frame cost stay flat
+// regardless of the virtual resolution.  Pixels whose pages are not resident yet fall back to the
+// regular sun shadow map.  Requires tiled resources tier 2.
+namespace VirtualShadowMap
+{
+    extern BoolVar Enable;
+    extern IntVar MaxPageUpdates;
+
+    enum { kVirtualSize = 16384, kPoolPages = 1024, kMaxPageUpdates = 32 };
+
+    extern ShadowBuffer m_VirtualShadowMap;
+
+    void InitializeResources(void);
+    void Shutdown(void);
+
+    // Without tiled resources tier 2, nothing is created and the map is never enabled
+    bool IsSupported(void);
+    bool IsEnabled(void);
+
+    // Call after the depth pre-pass.  Shadow is the camera of the virtual shadow map.  This flushes
+    // the context so that the readback can be fenced.
+    void RequestPages(GraphicsContext& gfxContext, const Math::Camera& ViewCamera, const GameCore::ShadowCamera& Shadow);
+
+    // Maps pages that were requested by earlier frames and writes the pages that must be rendered this
+    // frame to PageList, newly mapped pages first.  Returns the number of pages, at most MaxPages.
+    // Newly mapped pages hold garbage until rendered, so every returned page must be rendered.
+    uint32_t UpdatePages(const GameCore::ShadowCamera& Shadow, uint32_t* PageList, uint32_t MaxPages);
+
+    // Re-render resident pages on their next update without evicting them
+    void InvalidateAll(void);
+    void InvalidateBox(const GameCore::ShadowCamera& Shadow, const Math::Vector3& MinBound, const Math::Vector3& MaxBound);
+
+    // Texel rectangle covered by a page, and a projection that maps that rectangle to the full viewport
+    D3D12_RECT GetPageRect(uint32_t Page);
+    Math::Matrix4 GetPageViewProjMatrix(const GameCore::ShadowCamera& Shadow, uint32_t Page);
+}
@@ -0,0 +1,236 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "VolumetricLighting.h"
+#include "ForwardPlusLighting.h"
+#include "PipelineState.h"
+#include "RootSignature.h"
+#include "CommandContext.h"
+#include "CommandListManager.h"
+#include "SamplerManager.h"
+#include "GraphicsCommon.h"
+#include "GraphicsCore.h"
+#include "BufferManager.h"
+#include "DynamicResolution.h"
+#include "Camera.h"
+#include <algorithm>
+
+#include "CompiledShaders/VolumetricScatterCS.h"
+#include "CompiledShaders/VolumetricIntegrateCS.h"
+#include "CompiledShaders/VolumetricApplyVS.h"
+#include "CompiledShaders/VolumetricApplyPS.h"
+
+using namespace Graphics;
+using namespace Math;
+
+namespace VolumetricLighting
+{
+    BoolVar Enable("Application/Lighting/Volumetric/Enable", false);
+    BoolVar AsyncCompute("Application/Lighting/Volumetric/Async Compute", true);
+    NumVar Density("Application/Lighting/Volumetric/Density", 0.0005f, 0.0f, 0.01f, 0.0001f);
+    NumVar HeightFalloff("Application/Lighting/Volumetric/Height Falloff", 0.002f, 0.0f, 0.1f, 0.001f);
+    NumVar BaseHeight("Application/Lighting/Volumetric/Base Height", 0.0f, -1000.0f, 2000.0f, 50.0f);
+    NumVar Anisotropy("Application/Lighting/Volumetric/Anisotropy", 0.3f, -0.9f, 0.9f, 0.1f);
+    NumVar MaxDistance("Application/Lighting/Volumetric/Max Distance", 3000.0f, 100.0f, 10000.0f, 100.0f);
+    NumVar HistoryWeight("Application/Lighting/Volumetric/History Weight", 0.9f, 0.0f, 0.98f, 0.02f);
+
+    RootSignature m_RootSig;
+    ComputePSO m_ScatterCS;
+    ComputePSO m_IntegrateCS;
+    GraphicsPSO m_ApplyPSO;
+
+    // The lit froxels alternate between two volumes, so last frame's are the history
+    ColorBuffer m_ScatterVolume[2];
+    ColorBuffer m_IntegratedVolume;
+    uint32_t m_CurrentVolume = 0;
+    bool m_HistoryValid = false;
+    Matrix4 m_PrevViewProj;
+
+    // Keep in sync with VolumetricLightingRS.hlsli
+    __declspec(align(16)) struct VolumeConstants
+    {
+        Matrix4 InvViewProj;
+        Matrix4 PrevViewProj;
+        Matrix4 SunShadowMatrix;
+        XMFLOAT3 CameraPosition;
+        float NearClip;
+        uint32_t VolumeSize[3];
+        float VolumeDepthScale;
+        float InvViewportSize[2];
+        float TileDim;
+        float DepthJitter;
+        float Density;
+        float HeightFalloff;
+        float BaseHeight;
+        float Anisotropy;
+        float HistoryWeight;
+        float RcpFarClip;
+    } m_Constants;
+}
+
+void VolumetricLighting::InitializeResources( void )
+{
+    SamplerDesc MomentSamplerDesc;
+    MomentSamplerDesc.MaxAnisotropy = 8;
+    MomentSamplerDesc.SetTextureAddressMode(D3D12_TEXTURE_ADDRESS_MODE_CLAMP);
+
+    SamplerDesc ShadowWrapSamplerDesc = SamplerShadowDesc;
+    ShadowWrapSamplerDesc.AddressU = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
+    ShadowWrapSamplerDesc.AddressV = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
+
+    m_RootSig.Reset(6, 4);
+    m_RootSig.InitStaticSampler(0, SamplerLinearClampDesc);
+    m_RootSig.InitStaticSampler(1, SamplerShadowDesc);
+    m_RootSig.InitStaticSampler(2, MomentSamplerDesc);
+    m_RootSig.InitStaticSampler(3, ShadowWrapSamplerDesc);
+    m_RootSig[0].InitAsConstantBuffer(0);
+    m_RootSig[1].InitAsConstantBuffer(1);
+    m_RootSig[2].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 0, 2);
+    m_RootSig[3].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 64, 13);
+    m_RootSig[4].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 78, 3);
+    m_RootSig[5].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 0, 1);
+    m_RootSig.Finalize(L"Volumetric Lighting");
+
+    m_ScatterCS.SetRootSignature(m_RootSig);
+    m_ScatterCS.SetComputeShader(g_pVolumetricScatterCS, sizeof(g_pVolumetricScatterCS));
+    m_ScatterCS.Finalize();
+
+    m_IntegrateCS.SetRootSignature(m_RootSig);
+    m_IntegrateCS.SetComputeShader(g_pVolumetricIntegrateCS, sizeof(g_pVolumetricIntegrateCS));
+    m_IntegrateCS.Finalize();
+
+    // Premultiplied alpha blending with an alpha of one minus the transmittance scales the scene by it
+    m_ApplyPSO.SetRootSignature(m_RootSig);
+    m_ApplyPSO.SetRasterizerState(RasterizerTwoSided);
+    m_ApplyPSO.SetBlendState(BlendPreMultiplied);
+    m_ApplyPSO.SetDepthStencilState(DepthStateDisabled);
+    m_ApplyPSO.SetSampleMask(0xFFFFFFFF);
+    m_ApplyPSO.SetInputLayout(0, nullptr);
+    m_ApplyPSO.SetPrimitiveTopologyType(D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE);
+    m_ApplyPSO.SetVertexShader(g_pVolumetricApplyVS, sizeof(g_pVolumetricApplyVS));
+    m_ApplyPSO.SetPixelShader(g_pVolumetricApplyPS, sizeof(g_pVolumetricApplyPS));
+    m_ApplyPSO.SetRenderTargetFormat(g_SceneColorBuffer.GetFormat(), DXGI_FORMAT_UNKNOWN);
+    m_ApplyPSO.Finalize();
+}
+
+void VolumetricLighting::Shutdown( void )
+{
+    m_ScatterVolume[0].Destroy();
+    m_ScatterVolume[1].Destroy();
+    m_IntegratedVolume.Destroy();
+    m_HistoryValid = false;
+}
+
+void VolumetricLighting::Render( ComputeContext& Context, const Camera& ViewCamera, const D3D12_VIEWPORT& Viewport,
+    const Matrix4& SunShadowMatrix, const void* ShadingConstants, size_t ConstantsSize,
+    const D3D12_CPU_DESCRIPTOR_HANDLE* ShadowSRVs, uint32_t NumSRVs, const D3D12_CPU_DESCRIPTOR_HANDLE* ClusterSRVs )
+{
+    ASSERT(NumSRVs <= 13);
+
+    ScopedTimer _prof(L"Volumetric Lighting", Context);
+
+    // A froxel per light grid tile
+    const uint32_t TileDim = Lighting::LightGridDim;
+    const uint32_t Width = Math::DivideByMultiple(DynamicResolution::GetWidth(), TileDim);
+    const uint32_t Height = Math::DivideByMultiple(DynamicResolution::GetHeight(), TileDim);
+
+    if (m_IntegratedVolume.GetResource() == nullptr || m_IntegratedVolume.GetWidth() != Width ||
+        m_IntegratedVolume.GetHeight() != Height)
+    {
+        // The previous volumes may still be in use by frames in flight
+        if (m_IntegratedVolume.GetResource() != nullptr)
+            g_CommandManager.IdleGPU();
+        m_ScatterVolume[0].CreateVolume(L"Volumetric Scattering 0", Width, Height, kSlices, DXGI_FORMAT_R16G16B16A16_FLOAT);
+        m_ScatterVolume[1].CreateVolume(L"Volumetric Scattering 1", Width, Height, kSlices, DXGI_FORMAT_R16G16B16A16_FLOAT);
+        m_IntegratedVolume.CreateVolume(L"Volumetric Integrated", Width, Height, kSlices, DXGI_FORMAT_R16G16B16A16_FLOAT);
+        m_HistoryValid = false;
+    }
+
+    ColorBuffer& Current = m_ScatterVolume[m_CurrentVolume];
+    ColorBuffer& History = m_ScatterVolume[m_CurrentVolume ^ 1];
+
+    const float NearClip = ViewCamera.GetNearClip();
+
+    m_Constants.InvViewProj = Invert(ViewCamera.GetViewProjMatrix());
+    m_Constants.PrevViewProj = m_PrevViewProj;
+    m_Constants.SunShadowMatrix = SunShadowMatrix;
+    XMStoreFloat3(&m_Constants.CameraPosition, ViewCamera.GetPosition());
+    m_Constants.NearClip = NearClip;
+    m_Constants.VolumeSize[0] = Width;
+    m_Constants.VolumeSize[1] = Height;
+    m_Constants.VolumeSize[2] = kSlices;
+    m_Constants.VolumeDepthScale = std::log2(std::max((float)MaxDistance, NearClip * 2.0f) / NearClip);
+    m_Constants.InvViewportSize[0] = 1.0f / Viewport.Width;
+    m_Constants.InvViewportSize[1] = 1.0f / Viewport.Height;
+    m_Constants.TileDim = (float)TileDim;
+    // The golden ratio sequence spreads the samples evenly through each slice over a few frames
+    m_Constants.DepthJitter = std::fmod((float)Graphics::GetFrameCount() * 0.618034f, 1.0f);
+    m_Constants.Density = Density;
+    m_Constants.HeightFalloff = HeightFalloff;
+    m_Constants.BaseHeight = BaseHeight;
+    m_Constants.Anisotropy = Anisotropy;
+    m_Constants.HistoryWeight = m_HistoryValid ? (float)HistoryWeight : 0.0f;
+    m_Constants.RcpFarClip = 1.0f / ViewCamera.GetFarClip();
+
+    m_PrevViewProj = ViewCamera.GetViewProjMatrix();
+    m_HistoryValid = true;
+    m_CurrentVolume ^= 1;
+
+    Context.SetRootSignature(m_RootSig);
+    Context.SetDynamicConstantBufferView(0, ConstantsSize, ShadingConstants);
+    Context.SetDynamicConstantBufferView(1, sizeof(m_Constants), &m_Constants);
+    Context.SetDynamicDescriptors(3, 0, NumSRVs, ShadowSRVs);
+    Context.SetDynamicDescriptors(4, 0, 3, ClusterSRVs);
+
+    {
+        ScopedTimer _prof2(L"Scattering", Context);
+
+        Context.SetPipelineState(m_ScatterCS);
+        Context.TransitionResource(History, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        Context.TransitionResource(Current, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, true);
+        Context.SetDynamicDescriptor(2, 0, History.GetSRV());
+        Context.SetDynamicDescriptor(5, 0, Current.GetUAV());
+        Context.Dispatch3D(Width, Height, kSlices, 8, 8, 1);
+    }
+
+    {
+        ScopedTimer _prof2(L"Integration", Context);
+
+        Context.SetPipelineState(m_IntegrateCS);
+        Context.TransitionResource(Current, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        Context.TransitionResource(m_IntegratedVolume, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, true);
+        Context.SetDynamicDescriptor(2, 0, Current.GetSRV());
+        Context.SetDynamicDescriptor(5, 0, m_IntegratedVolume.GetUAV());
+        Context.Dispatch2D(Width, Height);
+    }
+
+    // The graphics queue makes it a pixel shader resource once it has waited for this work
+    Context.TransitionResource(m_IntegratedVolume, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+}
+
+void VolumetricLighting::Apply( GraphicsContext& Context, ColorBuffer& LinearDepth, const D3D12_VIEWPORT& Viewport,
+    const D3D12_RECT& Scissor )
+{
+    ScopedTimer _prof(L"Apply Volumetric Lighting", Context);
+
+    Context.SetRootSignature(m_RootSig);
+    Context.SetPipelineState(m_ApplyPSO);
+    Context.SetDynamicConstantBufferView(1, sizeof(m_Constants), &m_Constants);
+
+    Context.TransitionResource(m_IntegratedVolume, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+    Context.TransitionResource(LinearDepth, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+    Context.TransitionResource(g_SceneColorBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET);
+    Context.SetDynamicDescriptor(2, 0, m_IntegratedVolume.GetSRV());
+    Context.SetDynamicDescriptor(2, 1, LinearDepth.GetSRV());
+
+    Context.SetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    Context.SetRenderTarget(g_SceneColorBuffer.GetRTV());
+    Context.SetViewportAndScissor(Viewport, Scissor);
+    Context.Draw(3);
+}
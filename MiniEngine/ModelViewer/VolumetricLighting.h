@@ -0,0 +1,56 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#pragma once
+
+#include <cstdint>
+
+class ComputeContext;
+class GraphicsContext;
+class ColorBuffer;
+class BoolVar;
+class NumVar;
+namespace Math
+{
+    class Matrix4;
+    class Camera;
+}
+
+// Volumetric lighting in a froxel volume aligned with the Forward+ light grid: a froxel per grid tile across
+// and kSlices exponentially spaced slices in depth.  Each froxel is lit once, by the sun through its shadow map
+// and by the lights of the cluster it lies in through the light shadow atlas, and blended with last frame's
+// result.  The volume is then integrated front to back, and the color pass output is fogged with it.
+namespace VolumetricLighting
+{
+    extern BoolVar Enable;
+    extern BoolVar AsyncCompute;
+    extern NumVar Density;
+    extern NumVar HeightFalloff;
+    extern NumVar BaseHeight;
+    extern NumVar Anisotropy;
+    extern NumVar MaxDistance;
+    extern NumVar HistoryWeight;
+
+    enum { kSlices = 64 };
+
+    void InitializeResources(void);
+    void Shutdown(void);
+
+    // Lights and integrates the volume, here or on a compute queue context.  ShadingConstants is the color pass
+    // constant buffer, ShadowSRVs the first NumSRVs entries of its table at t64 and ClusterSRVs its two light
+    // cluster entries and the light shadow data that follows them.  The shadow and light resources they reference must be readable as non-pixel shader
+    // resources, with the light clusters filled in front of the geometry (see Lighting::m_FillFrontClusters).
+    void Render(ComputeContext& Context, const Math::Camera& ViewCamera, const D3D12_VIEWPORT& Viewport,
+        const Math::Matrix4& SunShadowMatrix, const void* ShadingConstants, size_t ConstantsSize,
+        const D3D12_CPU_DESCRIPTOR_HANDLE* ShadowSRVs, uint32_t NumSRVs, const D3D12_CPU_DESCRIPTOR_HANDLE* ClusterSRVs);
+
+    // Fogs g_SceneColorBuffer with the volume this frame's Render() integrated.  When that ran on the compute
+    // queue, the graphics queue must have waited for it.
+    void Apply(GraphicsContext& Context, ColorBuffer& LinearDepth, const D3D12_VIEWPORT& Viewport, const D3D12_RECT& Scissor);
+}
@@ -6,12 +6,14 @@
 #include <thread>
 #include <vector>
 #include <algorithm>
+#include <cfloat>
 #include <intrin.h>
 
 #include FT_FREETYPE_H
+#include FT_OUTLINE_H
 
 #define kMajorVersion    1
-#define kMinorVersion    0
+#define kMinorVersion    1
 
 #define kMaxTextureDimension 4096
 
@@ -27,6 +29,8 @@ struct GlyphInfo
     uint16_t width;     // The width of the glyph (not counting horizontal spacing) 
     int16_t bearing;    // The leading space before the glyph (sometimes negative)
     uint16_t advance;   // The total distance to advance the pen after printing
+    uint16_t top;       // The distance from the top of the line to the top of the glyph's texture space
+    uint16_t height;    // The height of the glyph's texture space, which covers its ink within the line
 };
 
 __declspec(thread) FT_Library g_FreeTypeLib = 0;    // FreeType2 library wrapper
@@ -39,6 +43,7 @@ bool g_fixNumberWidths = false; // Prints all numbers with fixed spacing
 uint16_t g_maxGlyphHeight = 0;  // Max height of glyph = ascender - descender
 int16_t g_fontOffset = 0;       // Baseline offset to center the text vertically
 uint16_t g_fontAdvanceY = 0;    // Distance from baseline to baseline (line height)
+uint16_t g_numChannels = 1;     // 4 for a multi-channel distance field with the true distance in alpha
 
 float* g_DistanceMap = 0;
 uint32_t g_MapWidth = 0;
@@ -126,6 +131,8 @@ struct Canvas
     uint32_t rows;        // Number of rows in the canvas
     uint32_t xOff;        // Amount to offset the x coordinate when reading
     uint32_t yOff;        // Amount to offset the y coordinate when reading
+    int32_t left;        // Position of the bitmap's upper-left pixel in outline space
+    int32_t top;
 };
 
 // Access the high res glyph canvas
@@ -142,8 +149,8 @@ inline bool ReadCanvasBit( const Canvas& canvas, uint32_t x, uint32_t y )
     return (canvas.bitmap[p] & (0x80 >> k)) ? true : false;
 }
 
-// Setup pixel reads from the glyph canvas
-inline Canvas LoadCanvas(FT_GlyphSlot glyph)
+// Setup pixel reads from the glyph canvas, whose texture space begins glyphTop below the top of the line
+inline Canvas LoadCanvas(FT_GlyphSlot glyph, uint16_t glyphTop)
 {
     Canvas ret;
     ret.bitmap = glyph->bitmap.buffer;
@@ -151,7 +158,9 @@ inline Canvas LoadCanvas(FT_GlyphSlot glyph)
     ret.width = glyph->bitmap.width;
     ret.rows = glyph->bitmap.rows;
     ret.xOff = g_borderSize * 16;
-    ret.yOff = g_borderSize * 16 + g_maxGlyphHeight + g_fontOffset - (glyph->metrics.horiBearingY >> 6);
+    ret.yOff = g_borderSize * 16 + g_maxGlyphHeight + g_fontOffset - (glyph->metrics.horiBearingY >> 6) - glyphTop;
+    ret.left = glyph->bitmap_left;
+    ret.top = glyph->bitmap_top;
     return ret;
 }
 
@@ -235,6 +244,235 @@ float DistanceFromOutside(const Canvas& canvas, uint32_t xCoord, uint32_t yCoord
     return sqrt((float)bestDistSq) / (float)radius;
 }
 
+// Multi-channel distance fields keep corners sharp under magnification.  The outline is split into
+// edges at its corners and neighboring edges are given different color channels, so that the median
+// of the three channel distances still meets at a point where the true distance would be rounded off.
+struct EdgeSegment
+{
+    float x0, y0;       // Line segment in outline space (canvas pixels, y up)
+    float x1, y1;
+    uint8_t color;      // Mask of the channels the segment contributes to
+    bool startsEdge;    // The first segment of an outline edge, the only place a corner can be
+    bool endsEdge;
+};
+
+enum { kRed = 1, kGreen = 2, kBlue = 4, kYellow = kRed | kGreen, kMagenta = kRed | kBlue, kCyan = kGreen | kBlue, kWhite = 7 };
+
+// Curves are flattened into this many line segments
+#define kCurveSteps 8
+
+// The sine of the smallest angle between edges that counts as a corner (3 degrees)
+#define kCornerSine 0.0523f
+
+struct OutlineBuilder
+{
+    vector<vector<EdgeSegment>>* contours;
+    float x, y;
+    bool startEdge;
+};
+
+inline void AddSegment( OutlineBuilder& builder, float x1, float y1 )
+{
+    // Skip degenerate segments, but keep the start of the edge for the next one
+    if (fabs(x1 - builder.x) + fabs(y1 - builder.y) < 1e-4f)
+        return;
+
+    EdgeSegment segment = { builder.x, builder.y, x1, y1, kWhite, builder.startEdge, false };
+    builder.contours->back().push_back(segment);
+    builder.x = x1;
+    builder.y = y1;
+    builder.startEdge = false;
+}
+
+int OutlineMoveTo( const FT_Vector* to, void* user )
+{
+    OutlineBuilder& builder = *(OutlineBuilder*)user;
+    builder.contours->emplace_back();
+    builder.x = to->x / 64.0f;
+    builder.y = to->y / 64.0f;
+    return 0;
+}
+
+int OutlineLineTo( const FT_Vector* to, void* user )
+{
+    OutlineBuilder& builder = *(OutlineBuilder*)user;
+    builder.startEdge = true;
+    AddSegment(builder, to->x / 64.0f, to->y / 64.0f);
+    return 0;
+}
+
+int OutlineConicTo( const FT_Vector* control, const FT_Vector* to, void* user )
+{
+    OutlineBuilder& builder = *(OutlineBuilder*)user;
+    const float x0 = builder.x, y0 = builder.y;
+    const float cx = control->x / 64.0f, cy = control->y / 64.0f;
+    const float x2 = to->x / 64.0f, y2 = to->y / 64.0f;
+
+    builder.startEdge = true;
+    for (uint32_t i = 1; i <= kCurveSteps; ++i)
+    {
+        const float t = (float)i / kCurveSteps, s = 1.0f - t;
+        AddSegment(builder, s * s * x0 + 2.0f * s * t * cx + t * t * x2, s * s * y0 + 2.0f * s * t * cy + t * t * y2);
+    }
+    return 0;
+}
+
+int OutlineCubicTo( const FT_Vector* control1, const FT_Vector* control2, const FT_Vector* to, void* user )
+{
+    OutlineBuilder& builder = *(OutlineBuilder*)user;
+    const float x0 = builder.x, y0 = builder.y;
+    const float cx1 = control1->x / 64.0f, cy1 = control1->y / 64.0f;
+    const float cx2 = control2->x / 64.0f, cy2 = control2->y / 64.0f;
+    const float x3 = to->x / 64.0f, y3 = to->y / 64.0f;
+
+    builder.startEdge = true;
+    for (uint32_t i = 1; i <= kCurveSteps; ++i)
+    {
+        const float t = (float)i / kCurveSteps, s = 1.0f - t;
+        const float a = s * s * s, b = 3.0f * s * s * t, c = 3.0f * s * t * t, d = t * t * t;
+        AddSegment(builder, a * x0 + b * cx1 + c * cx2 + d * x3, a * y0 + b * cy1 + c * cy2 + d * y3);
+    }
+    return 0;
+}
+
+// Give the edges between corners alternating colors.  Any two neighbors share exactly one channel.
+void ColorContour( vector<EdgeSegment>& contour )
+{
+    const size_t n = contour.size();
+
+    vector<size_t> corners;
+    for (size_t i = 0; i < n; ++i)
+    {
+        if (!contour[i].startsEdge)
+            continue;
+
+        const EdgeSegment& prev = contour[(i + n - 1) % n];
+        const EdgeSegment& next = contour[i];
+        float ax = prev.x1 - prev.x0, ay = prev.y1 - prev.y0;
+        float bx = next.x1 - next.x0, by = next.y1 - next.y0;
+        const float ra = 1.0f / sqrt(ax * ax + ay * ay), rb = 1.0f / sqrt(bx * bx + by * by);
+        ax *= ra; ay *= ra; bx *= rb; by *= rb;
+
+        if (ax * bx + ay * by <= 0.0f || fabs(ax * by - ay * bx) > kCornerSine)
+            corners.push_back(i);
+    }
+
+    static const uint8_t kPalette[3] = { kCyan, kMagenta, kYellow };
+
+    // Smooth contours have no corners to preserve
+    if (corners.empty())
+    {
+        for (size_t i = 0; i < n; ++i)
+            contour[i].color = kWhite;
+    }
+    // A teardrop.  Split it in three so the corner still sees two colors.
+    else if (corners.size() == 1)
+    {
+        for (size_t j = 0; j < n; ++j)
+            contour[(corners[0] + j) % n].color = kPalette[j * 3 / n];
+    }
+    else
+    {
+        // When there is one spline more than a multiple of three, the last one can't be cyan (like the
+        // first) or yellow (like the one before it), but magenta shares a channel with both.
+        const size_t numSplines = corners.size();
+        size_t spline = 0;
+        for (size_t j = 0; j < n; ++j)
+        {
+            const size_t i = (corners[0] + j) % n;
+            if (spline + 1 < numSplines && i == corners[spline + 1])
+                ++spline;
+
+            if (numSplines % 3 == 1 && spline == numSplines - 1)
+                contour[i].color = kMagenta;
+            else
+                contour[i].color = kPalette[spline % 3];
+        }
+    }
+}
+
+// Returns the orientation of the outline:  +1 when the filled area is to the right of the contours
+float LoadOutline( FT_Outline& outline, vector<EdgeSegment>& segments )
+{
+    vector<vector<EdgeSegment>> contours;
+    OutlineBuilder builder = { &contours, 0.0f, 0.0f, true };
+
+    FT_Outline_Funcs funcs;
+    funcs.move_to = OutlineMoveTo;
+    funcs.line_to = OutlineLineTo;
+    funcs.conic_to = OutlineConicTo;
+    funcs.cubic_to = OutlineCubicTo;
+    funcs.shift = 0;
+    funcs.delta = 0;
+
+    if (FT_Outline_Decompose(&outline, &funcs, &builder))
+        throw exception("Unable to decompose glyph outline");
+
+    segments.clear();
+    for (auto& contour : contours)
+    {
+        for (size_t i = 0; i < contour.size(); ++i)
+            contour[i].endsEdge = contour[(i + 1) % contour.size()].startsEdge;
+
+        ColorContour(contour);
+        segments.insert(segments.end(), contour.begin(), contour.end());
+    }
+
+    return FT_Outline_Get_Orientation(&outline) == FT_ORIENTATION_POSTSCRIPT ? -1.0f : 1.0f;
+}
+
+// Signed distance to the nearest edge of each channel, in outline space, positive inside.  Ties go to
+// the segment that the point faces most squarely, and an edge end that is nearest is extended as a
+// line (the pseudo-distance) so that the channels don't bend around the corner.
+void MultiChannelDistance( const vector<EdgeSegment>& segments, float px, float py, float orientation, float distance[3] )
+{
+    struct Nearest
+    {
+        float dist;
+        float dot;
+        float side;
+        float pseudo;
+    } nearest[3];
+
+    for (uint32_t c = 0; c < 3; ++c)
+        nearest[c] = { FLT_MAX, 1.0f, -1.0f, FLT_MAX };
+
+    for (const EdgeSegment& seg : segments)
+    {
+        const float dx = seg.x1 - seg.x0, dy = seg.y1 - seg.y0;
+        const float wx = px - seg.x0, wy = py - seg.y0;
+        const float len = sqrt(dx * dx + dy * dy);
+        const float t = (wx * dx + wy * dy) / (len * len);
+        const float tc = min(max(t, 0.0f), 1.0f);
+        const float vx = wx - tc * dx, vy = wy - tc * dy;
+        const float dist = sqrt(vx * vx + vy * vy);
+
+        // How far off square the point lies from the segment end
+        const float dot = (t == tc || dist == 0.0f) ? 0.0f : fabs(vx * dx + vy * dy) / (dist * len);
+        const float cross = (dx * wy - dy * wx) / len;
+        const float side = -cross * orientation > 0.0f ? 1.0f : -1.0f;
+        const bool extend = (t < 0.0f && seg.startsEdge) || (t > 1.0f && seg.endsEdge);
+
+        for (uint32_t c = 0; c < 3; ++c)
+        {
+            if ((seg.color & (1 << c)) == 0)
+                continue;
+
+            Nearest& n = nearest[c];
+            if (dist < n.dist - 1e-3f || (dist < n.dist + 1e-3f && dot < n.dot))
+                n = { dist, dot, side, extend ? min(dist, fabs(cross)) : dist };
+        }
+    }
+
+    for (uint32_t c = 0; c < 3; ++c)
+        distance[c] = nearest[c].side * nearest[c].pseudo;
+}
+
+inline float Median( float a, float b, float c )
+{
+    return max(min(a, b), min(max(a, b), c));
+}
+
 // Get width and spacing of a given glyph to compute necessary space and layout in final texture.
 inline uint16_t GetGlyphMetrics( wchar_t c, GlyphInfo& info )
 {
@@ -246,60 +484,126 @@ inline uint16_t GetGlyphMetrics( wchar_t c, GlyphInfo& info )
     info.width = (uint16_t)(metrics.width >> 6);
     info.advance =  (uint16_t)(metrics.horiAdvance >> 6);
 
+    // Only reserve texture space for the rows of the line the glyph actually covers
+    const int32_t lineHeight = align16(g_maxGlyphHeight);
+    int32_t inkTop = g_maxGlyphHeight + g_fontOffset - (int32_t)(metrics.horiBearingY >> 6);
+    int32_t inkBottom = inkTop + (int32_t)(metrics.height >> 6);
+    inkTop = max(0, min(inkTop, lineHeight)) & ~15;
+    inkBottom = align16(max(inkTop, min(inkBottom, lineHeight)));
+    info.top = (uint16_t)inkTop;
+    info.height = (uint16_t)(inkBottom - inkTop);
+
     return (uint16_t)info.width;
 }
 
-// Compute glyph layout in bitmap for a given texture width.  If the height exceeds a certain
-// threshold, you should recompute the layout with a larger texture width.
-uint32_t UnwrapUVs(uint32_t textureWidth)
+// Compute glyph layout in bitmap for a given texture width with bottom-left skyline packing, tallest
+// glyphs first.  Returns the texture height needed.  If it exceeds a certain threshold, you should
+// recompute the layout with a larger texture width.
+uint32_t PackGlyphs(uint32_t textureWidth)
 {
-    uint16_t glyphBorder = g_borderSize * 16;
-    uint16_t rowSize = align16(g_maxGlyphHeight);
+    // The skyline is the top of the packed glyphs, left to right, in texels
+    struct Span
+    {
+        uint32_t x, y, width;
+    };
+    vector<Span> skyline(1, Span{ 0, 0, textureWidth });
 
-    // Set the starting point for the drawing 
-    uint32_t x = glyphBorder;
-    uint32_t y = glyphBorder;
+    vector<uint16_t> order(g_numGlyphs);
+    for (uint16_t i = 0; i < g_numGlyphs; ++i)
+        order[i] = i;
+    stable_sort(order.begin(), order.end(), [](uint16_t a, uint16_t b) { return g_glyphs[a].height > g_glyphs[b].height; });
 
-    for (uint16_t i = 0; i < g_numGlyphs; ++i) 
+    uint32_t textureHeight = 0;
+
+    for (uint16_t i : order)
     {
         // We need a pixel border to surround the character because the distance field must enclose
         // the bitmap.
-        uint32_t deltaX = align16(g_glyphs[i].width) + glyphBorder;
-
-        // Check for line wrap
-        if (x + deltaX > textureWidth * 16) 
+        const uint32_t cellWidth = align16(g_glyphs[i].width) / 16 + g_borderSize * 2;
+        const uint32_t cellHeight = g_glyphs[i].height / 16 + g_borderSize * 2;
+        if (cellWidth > textureWidth)
+            return UINT32_MAX;
+
+        // Find the lowest spot the cell fits, leftmost among equals
+        size_t bestSpan = 0;
+        uint32_t bestY = UINT32_MAX;
+        for (size_t s = 0; s < skyline.size() && skyline[s].x + cellWidth <= textureWidth; ++s)
         {
-            x = glyphBorder;
-            y += rowSize + glyphBorder * 2;
+            uint32_t y = 0;
+            for (size_t t = s; t < skyline.size() && skyline[t].x < skyline[s].x + cellWidth; ++t)
+                y = max(y, skyline[t].y);
+
+            if (y < bestY)
+            {
+                bestY = y;
+                bestSpan = s;
+            }
         }
 
         // The actual character UVs don't include the border pixels
-        g_glyphs[i].u = (uint16_t)x;
-        g_glyphs[i].v = (uint16_t)y;
+        const uint32_t x = skyline[bestSpan].x;
+        g_glyphs[i].u = (uint16_t)((x + g_borderSize) * 16);
+        g_glyphs[i].v = (uint16_t)((bestY + g_borderSize) * 16);
+        textureHeight = max(textureHeight, bestY + cellHeight);
+
+        // Raise the skyline over the cell
+        const uint32_t right = x + cellWidth;
+        while (bestSpan < skyline.size() && skyline[bestSpan].x + skyline[bestSpan].width <= right)
+            skyline.erase(skyline.begin() + bestSpan);
+        if (bestSpan < skyline.size() && skyline[bestSpan].x < right)
+        {
+            skyline[bestSpan].width -= right - skyline[bestSpan].x;
+            skyline[bestSpan].x = right;
+        }
+        skyline.insert(skyline.begin() + bestSpan, Span{ x, bestY + cellHeight, cellWidth });
 
-        x += deltaX + glyphBorder;
+        for (size_t s = 1; s < skyline.size(); )
+        {
+            if (skyline[s - 1].y == skyline[s].y)
+            {
+                skyline[s - 1].width += skyline[s].width;
+                skyline.erase(skyline.begin() + s);
+            }
+            else
+                ++s;
+        }
     }
 
-    return (y + rowSize + glyphBorder) / 16;
+    return textureHeight;
 }
 
 void PaintCharacters( float* distanceMap, uint32_t width, uint32_t /*height*/ )
 {
+    vector<EdgeSegment> segments;
+    float orientation = 1.0f;
+
     int32_t i = -1;
     while ((i = _InterlockedExchangeAdd((volatile long*)&g_nextGlyphIdx, 1)) < g_numGlyphs)
     {
         // Get the character info
         const GlyphInfo& ch = g_glyphs[i];
 
-        if (FT_Load_Char( g_FreeTypeFace, ch.c, FT_LOAD_RENDER | FT_LOAD_MONOCHROME | FT_LOAD_TARGET_MONO ))
+        if (g_numChannels > 1)
+        {
+            // Keep the outline for the channel distances, then render it for the true distance
+            if (FT_Load_Char( g_FreeTypeFace, ch.c, FT_LOAD_NO_BITMAP | FT_LOAD_TARGET_MONO ))
+                throw exception("Character outline loading failed internally");
+
+            orientation = LoadOutline(g_FreeTypeFace->glyph->outline, segments);
+
+            if (FT_Render_Glyph( g_FreeTypeFace->glyph, FT_RENDER_MODE_MONO ))
+                throw exception("Character bitmap rendering failed internally");
+        }
+        else if (FT_Load_Char( g_FreeTypeFace, ch.c, FT_LOAD_RENDER | FT_LOAD_MONOCHROME | FT_LOAD_TARGET_MONO ))
             throw exception("Character bitmap rendering failed internally");
 
-        Canvas canvas = LoadCanvas(g_FreeTypeFace->glyph);
+        Canvas canvas = LoadCanvas(g_FreeTypeFace->glyph, ch.top);
 
         uint32_t charWidth = align16(ch.width) / 16;
-        uint32_t charHeight = align16(g_maxGlyphHeight) / 16;
+        uint32_t charHeight = ch.height / 16;
         uint32_t startX = ch.u / 16 - g_borderSize;
         uint32_t startY = ch.v / 16 - g_borderSize;
+        const float radius = g_maxDistance * 16.0f;
 
         // Convert high-res bitmap to low-res distance map
         for (uint32_t x = 0; x < charWidth + g_borderSize * 2; ++x)
@@ -312,10 +616,30 @@ void PaintCharacters( float* distanceMap, uint32_t width, uint32_t /*height*/ )
                 bool inside = ReadCanvasBit(canvas, left, top) & ReadCanvasBit(canvas, left + 1, top) &
                     ReadCanvasBit(canvas, left, top + 1) & ReadCanvasBit(canvas, left + 1, top + 1);
 
-                if (inside)
-                    distanceMap[startX + x + (startY + y) * width] = +DistanceFromInside(canvas, x, y);
-                else
-                    distanceMap[startX + x + (startY + y) * width] = -DistanceFromOutside(canvas, x, y);
+                float distance = inside ? +DistanceFromInside(canvas, x, y) : -DistanceFromOutside(canvas, x, y);
+                float* texel = distanceMap + (startX + x + (startY + y) * width) * g_numChannels;
+
+                if (g_numChannels == 1)
+                {
+                    texel[0] = distance;
+                    continue;
+                }
+
+                // The texel center in outline space
+                const float px = canvas.left + (float)(x * 16 + 8) - (float)canvas.xOff;
+                const float py = canvas.top - ((float)(y * 16 + 8) - (float)canvas.yOff);
+                MultiChannelDistance(segments, px, py, orientation, texel);
+
+                for (uint32_t c = 0; c < 3; ++c)
+                    texel[c] = min(max(texel[c] / radius, -1.0f), 1.0f);
+
+                // Where the channels disagree with the true distance about the side of the edge, the
+                // median would produce artifacts.  Fall back to the true distance, as also beyond the
+                // search radius, so that filtering across into a neighboring glyph can't make ink.
+                if ((Median(texel[0], texel[1], texel[2]) > 0.0f) != inside || fabs(distance) >= 1.0f)
+                    texel[0] = texel[1] = texel[2] = distance;
+
+                texel[3] = distance;
             }
         }
     }
@@ -416,8 +740,7 @@ void CompileFont(const string& outputName)
         }
     }
 
-    // This implicitly embeds space in the font texture, which wastes memory.  What would be better is to just store
-    // the font height (i.e. the line spacing) in the final file header, and pack the texture as tightly as possible.
+    // Each glyph's texture space is trimmed to the rows of the line it inks, so the line height only bounds it.
     g_fontAdvanceY = (uint16_t)(g_FreeTypeFace->size->metrics.height >> 6);
     g_maxGlyphHeight = (uint16_t)((g_FreeTypeFace->size->metrics.ascender - g_FreeTypeFace->size->metrics.descender) >> 6);
     g_fontOffset = (int16_t)(g_FreeTypeFace->size->metrics.descender >> 6);
@@ -452,9 +775,9 @@ void CompileFont(const string& outputName)
 
     // Compute the smallest rectangular texture with height < width that can contain the result.  Use
     // widths that are a power of two to accelerate the search.
-    for (g_MapWidth = 512; g_MapWidth <= kMaxTextureDimension; g_MapWidth *= 2)
+    for (g_MapWidth = 128; g_MapWidth <= kMaxTextureDimension; g_MapWidth *= 2)
     {
-        g_MapHeight = UnwrapUVs(g_MapWidth);
+        g_MapHeight = PackGlyphs(g_MapWidth);
 
         // Found a good size
         if (g_MapHeight <= g_MapWidth)
@@ -467,8 +790,9 @@ void CompileFont(const string& outputName)
 
     // Render the glyphs and generate heightmaps.  Place heightmaps in the
     // locations set aside in the texture.
-    g_DistanceMap = new float[g_MapWidth * g_MapHeight];
-    for (size_t x = g_MapWidth * g_MapHeight; x > 0; --x)
+    const uint32_t numTexels = g_MapWidth * g_MapHeight;
+    g_DistanceMap = new float[numTexels * g_numChannels];
+    for (size_t x = numTexels * g_numChannels; x > 0; --x)
         g_DistanceMap[x - 1] = -1.0f;
 
     // Make sure all of the parameters are flushed to memory before we trigger the threads to paint.
@@ -485,14 +809,19 @@ void CompileFont(const string& outputName)
         for_each( Threads.begin(), Threads.end(), []( std::thread& T ) { T.join(); } );
     }
 
-    uint8_t* compressedMap8 = new uint8_t[g_MapWidth * g_MapHeight];
+    uint8_t* compressedMap8 = new uint8_t[numTexels * g_numChannels];
 
-    for (uint32_t i = 0; i < g_MapWidth * g_MapHeight; ++i)
-        compressedMap8[i] = (uint8_t)(g_DistanceMap[i] * 127.0f + 127.0f);    // (Omit 255)
+    // Preview the distance the text shader reconstructs, which is the median of a multi-channel texel
+    for (uint32_t i = 0; i < numTexels; ++i)
+    {
+        const float* texel = g_DistanceMap + i * g_numChannels;
+        const float distance = g_numChannels == 1 ? texel[0] : Median(texel[0], texel[1], texel[2]);
+        compressedMap8[i] = (uint8_t)(distance * 127.0f + 127.0f);    // (Omit 255)
+    }
 
     WritePreviewBMP(outputName, compressedMap8, g_MapWidth, g_MapHeight);
 
-    for (uint32_t i = 0; i < g_MapWidth * g_MapHeight; ++i)
+    for (uint32_t i = 0; i < numTexels * g_numChannels; ++i)
         compressedMap8[i] = (int8_t)(g_DistanceMap[i] * 127.0f);
 
     // Append ".fnt" to file name
@@ -518,6 +847,8 @@ void CompileFont(const string& outputName)
         uint16_t advanceY;
         uint16_t numGlyphs;
         uint16_t searchDist;
+        uint16_t numChannels;   // 1 (R8) or 4 (RGBA8, a multi-channel field with the true distance in alpha)
+        uint16_t reserved;
     } header;
 
     header.majorVersion = kMajorVersion;
@@ -529,6 +860,8 @@ void CompileFont(const string& outputName)
     header.advanceY = g_fontAdvanceY;
     header.numGlyphs = g_numGlyphs;
     header.searchDist = g_maxDistance * 16;
+    header.numChannels = g_numChannels;
+    header.reserved = 0;
     file.write((const char*)&header, sizeof(FontHeader));
 
     for (size_t i = 0; i < g_numGlyphs; ++i)
@@ -537,7 +870,7 @@ void CompileFont(const string& outputName)
     for (size_t i = 0; i < g_numGlyphs; ++i)
         file.write( (const char*)&g_glyphs[i].c + 2, sizeof(GlyphInfo) - 2 );
 
-    file.write((const char*)compressedMap8, g_MapWidth * g_MapHeight);
+    file.write((const char*)compressedMap8, numTexels * g_numChannels);
 
     file.close();
 
@@ -563,7 +896,9 @@ void main( int argc, const char** argv )
             if (argv[arg][0] != '-')
                 throw exception("Malformed option");
 
-            if (arg + 1 == argc)
+            if (strcmp("-msdf", argv[arg]) == 0)
+                g_numChannels = 4;
+            else if (arg + 1 == argc)
                 throw exception("Missing operand");
             else if (strcmp("-size", argv[arg]) == 0)
                 size = atoi(argv[++arg]);
@@ -591,6 +926,7 @@ void main( int argc, const char** argv )
             "-size <integer>\n\tThe font pixel resolution.\n"
             "-radius <integer>\n\tThe search radius.\n\tDefaults to font size / 8.\n"
             "-border_size <integer>\n\tExtra spacing around glyphs for various effects.\n\tDefaults to the search radius.\n"
+            "-msdf\n\tGenerate a multi-channel distance field that keeps corners sharp.\n\tTakes four times the memory.\n"
             "\n\nExample:  %s myfont.ttf -character_set Japanese.txt -output japanese\n\n", e.what(), argv[0], argv[0]);
         return;
     }
@@ -620,6 +956,7 @@ void main( int argc, const char** argv )
     printf("Font Name: \"%s\"\n", inputFile.c_str());
     printf("Font Size: %u\n", size);
     printf("Border Size: %u\n", g_borderSize);
+    printf("Channels: %u\n", g_numChannels);
     if (extendedASCII)
         printf("Character Set: %s + Extended ASCII\n", characterSet.c_str());
     else
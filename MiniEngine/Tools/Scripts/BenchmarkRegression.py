@@ -0,0 +1,231 @@
+# -*- coding: utf-8 -*-
+'''
+Copyright (c) Microsoft. All rights reserved.
+This code is licensed under the MIT License (MIT).
+THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+
+Compares the BenchmarkReport.json files of repeated ModelViewer -benchmark runs with the runs stored in a history
+folder, and exits with 1 when the frame time or any pass time of any configuration got significantly slower.
+History is kept apart for each GPU and driver version, since results of other ones say nothing about a change.
+
+For each time, the per run means of the new runs and of the latest baseline runs are compared with Welch's t-test.
+A time regressed when the lower bound of the one-sided confidence interval of its increase is above both the
+relative threshold and the minimum in milliseconds, so that noise and negligible changes are never flagged.  A
+single new run borrows the variance of the baseline runs, so nightly runs may be made one at a time.  Passing runs
+are added to the history, which -accept also does for regressed ones when a slowdown is intended.
+
+usage: BenchmarkRegression.py [-history folder] [-baseline runs] [-confidence level] [-threshold percent]
+                              [-minms ms] [-statistic avg|p50|p95|p99] [-label text] [-accept] [-nostore]
+                              reports...
+'''
+
+import json
+import math
+import os
+import re
+import shutil
+import sys
+import time
+
+def log_beta(a, b):
+    return math.lgamma(a) + math.lgamma(b) - math.lgamma(a + b)
+
+def beta_fraction(a, b, x):
+    '''Continued fraction of the regularized incomplete beta function, from Numerical Recipes'''
+    tiny = 1e-30
+    c = 1.0
+    d = 1.0 - (a + b) * x / (a + 1.0)
+    d = 1.0 / (d if abs(d) > tiny else tiny)
+    result = d
+    for m in range(1, 200):
+        for numerator in (m * (b - m) * x / ((a + 2 * m - 1) * (a + 2 * m)),
+                          -(a + m) * (a + b + m) * x / ((a + 2 * m) * (a + 2 * m + 1))):
+            d = 1.0 + numerator * d
+            d = 1.0 / (d if abs(d) > tiny else tiny)
+            c = 1.0 + numerator / c
+            c = c if abs(c) > tiny else tiny
+            result *= d * c
+        if abs(d * c - 1.0) < 1e-12:
+            break
+    return result
+
+def incomplete_beta(a, b, x):
+    if x <= 0.0:
+        return 0.0
+    if x >= 1.0:
+        return 1.0
+    front = math.exp(a * math.log(x) + b * math.log(1.0 - x) - log_beta(a, b))
+    if x < (a + 1.0) / (a + b + 2.0):
+        return front * beta_fraction(a, b, x) / a
+    return 1.0 - front * beta_fraction(b, a, 1.0 - x) / b
+
+def t_cdf(t, dof):
+    tail = 0.5 * incomplete_beta(dof / 2.0, 0.5, dof / (dof + t * t))
+    return 1.0 - tail if t > 0.0 else tail
+
+def t_quantile(p, dof):
+    '''Inverts the CDF by bisection, which is plenty for a handful of quantiles'''
+    low, high = -1000.0, 1000.0
+    for _ in range(100):
+        mid = 0.5 * (low + high)
+        if t_cdf(mid, dof) < p:
+            low = mid
+        else:
+            high = mid
+    return 0.5 * (low + high)
+
+def mean_and_variance(samples):
+    mean = sum(samples) / len(samples)
+    if len(samples) < 2:
+        return mean, None
+    return mean, sum((x - mean) ** 2 for x in samples) / (len(samples) - 1)
+
+def compare(baseline, current, confidence):
+    '''Returns the mean increase and the lower bound of its one-sided confidence interval, or None for the bound
+    when neither side has the repeat runs to estimate the variance from'''
+    baseMean, baseVar = mean_and_variance(baseline)
+    newMean, newVar = mean_and_variance(current)
+    increase = newMean - baseMean
+    if baseVar == None and newVar == None:
+        return increase, None
+    baseVar = newVar if baseVar == None else baseVar
+    newVar = baseVar if newVar == None else newVar
+
+    baseTerm = baseVar / len(baseline)
+    newTerm = newVar / len(current)
+    error = math.sqrt(baseTerm + newTerm)
+    if error == 0.0:
+        return increase, increase
+
+    # Welch-Satterthwaite degrees of freedom, counting a side whose variance was borrowed like the other side
+    dofTerms = [term * term / (n - 1) for term, n in ((baseTerm, len(baseline)), (newTerm, len(current))) if n > 1]
+    dof = (baseTerm + newTerm) ** 2 / sum(dofTerms)
+    return increase, increase - t_quantile(confidence, dof) * error
+
+def collect_times(report, statistic):
+    '''Maps "configuration/time" to the chosen statistic of each time measured by the report'''
+    times = {}
+    for config in report['configurations']:
+        entries = [('Frame', config['frameTimeMs'])] + list(config['gpuPassTimeMs'].items())
+        for name, stats in entries:
+            if stats != None:
+                times[config['name'] + '/' + name] = stats[statistic]
+    return times
+
+def history_folder(root, adapter):
+    gpu = '{0}_{1:04X}_{2:04X}'.format(adapter['name'], adapter['vendorId'], adapter['deviceId'])
+    return os.path.join(root, re.sub(r'[^A-Za-z0-9_.-]+', '_', gpu), adapter['driver'])
+
+def load_history(folder, count):
+    '''The latest runs come last, since stored names start with the time of storing'''
+    if not os.path.isdir(folder):
+        return []
+    names = sorted(name for name in os.listdir(folder) if name.endswith('.json'))
+    return [json.load(open(os.path.join(folder, name), 'r')) for name in names[-count:]]
+
+def check(reports, historyRoot, baselineRuns, confidence, threshold, minMs, statistic):
+    '''Prints the change of every time and returns whether any of them regressed'''
+    folder = history_folder(historyRoot, reports[0]['adapter'])
+    history = load_history(folder, baselineRuns)
+    print('{0} {1}, driver {2}: {3} new runs, {4} baseline runs'.format(reports[0]['adapter']['name'],
+        statistic, reports[0]['adapter']['driver'], len(reports), len(history)))
+    if len(history) == 0:
+        print('No baseline for this GPU and driver yet')
+        return False
+
+    current = [collect_times(report, statistic) for report in reports]
+    baseline = [collect_times(report, statistic) for report in history]
+
+    regressed = False
+    print('{0:<48} {1:>9} {2:>9} {3:>8} {4:>10}'.format('time', 'baseline', 'new', 'change', 'lower bound'))
+    for name in sorted(current[0]):
+        newSamples = [times[name] for times in current if name in times]
+        baseSamples = [times[name] for times in baseline if name in times]
+        if len(baseSamples) == 0:
+            continue
+
+        baseMean = sum(baseSamples) / len(baseSamples)
+        increase, lowerBound = compare(baseSamples, newSamples, confidence)
+        if lowerBound == None:
+            verdict = 'needs repeat runs'
+        elif lowerBound > max(baseMean * threshold / 100.0, minMs):
+            verdict = 'REGRESSED'
+            regressed = True
+        else:
+            verdict = ''
+
+        print('{0:<48} {1:9.3f} {2:9.3f} {3:+7.1f}% {4:>10} {5}'.format(name, baseMean, baseMean + increase,
+            100.0 * increase / baseMean if baseMean > 0.0 else 0.0,
+            '' if lowerBound == None else '{0:+.3f}'.format(lowerBound), verdict))
+    return regressed
+
+def store(reports, filenames, historyRoot, label):
+    folder = history_folder(historyRoot, reports[0]['adapter'])
+    os.makedirs(folder, exist_ok=True)
+    stamp = time.strftime('%Y%m%d_%H%M%S')
+    suffix = '_' + re.sub(r'[^A-Za-z0-9_.-]+', '_', label) if label else ''
+    index = 0
+    for filename in filenames:
+        # Runs stored within the same second are numbered on from the ones already there
+        while any(name.startswith('{0}_{1:02}'.format(stamp, index)) for name in os.listdir(folder)):
+            index += 1
+        shutil.copy(filename, os.path.join(folder, '{0}_{1:02}{2}.json'.format(stamp, index, suffix)))
+    print('Stored {0} runs in {1}'.format(len(filenames), folder))
+
+if __name__ == "__main__":
+    historyRoot = 'BenchmarkHistory'
+    baselineRuns = 10
+    confidence = 0.95
+    threshold = 2.0
+    minMs = 0.05
+    statistic = 'avg'
+    label = None
+    accept = False
+    noStore = False
+
+    args = sys.argv[1:]
+    while len(args) >= 1 and args[0].startswith('-'):
+        if args[0] == '-accept':
+            accept = True
+            args = args[1:]
+            continue
+        elif args[0] == '-nostore':
+            noStore = True
+            args = args[1:]
+            continue
+        elif len(args) < 2:
+            break
+        elif args[0] == '-history':
+            historyRoot = args[1]
+        elif args[0] == '-baseline':
+            baselineRuns = int(args[1])
+        elif args[0] == '-confidence':
+            confidence = float(args[1])
+        elif args[0] == '-threshold':
+            threshold = float(args[1])
+        elif args[0] == '-minms':
+            minMs = float(args[1])
+        elif args[0] == '-statistic' and args[1] in ('avg', 'p50', 'p95', 'p99'):
+            statistic = args[1]
+        elif args[0] == '-label':
+            label = args[1]
+        else:
+            break
+        args = args[2:]
+
+    if len(args) == 0 or args[0].startswith('-') or baselineRuns < 1 or not 0.5 < confidence < 1.0:
+        print(__doc__)
+        sys.exit(2)
+
+    reports = [json.load(open(filename, 'r')) for filename in args]
+    if any(report['adapter'] != reports[0]['adapter'] for report in reports):
+        print('The reports were measured on different GPUs or drivers')
+        sys.exit(2)
+
+    regressed = check(reports, historyRoot, baselineRuns, confidence, threshold, minMs, statistic)
+    if not noStore and (accept or not regressed):
+        store(reports, args, historyRoot, label)
+    sys.exit(1 if regressed else 0)
@@ -0,0 +1,148 @@
+# -*- coding: utf-8 -*-
+'''
+Copyright (c) Microsoft. All rights reserved.
+This code is licensed under the MIT License (MIT).
+THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+
+Writes block-compressed ".zblk" copies of asset files, which Utility::ReadFileSync() and
+TextureManager::LoadDDSFromFileAsync() prefer to the originals.  Each block is compressed on its own so that
+the engine can decompress the blocks in parallel.  See BlockFileHeader in Core/FileUtility.cpp.
+
+usage: CompressBlocks.py [-codec deflate|lz4|stored] [-level n] [-blocksize KB] files...
+'''
+
+import struct
+import sys
+import zlib
+from concurrent.futures import ThreadPoolExecutor
+
+try:
+    import lz4.block
+except ImportError:
+    lz4 = None
+
+MAGIC = b'ZBLK'
+VERSION = 1
+CODECS = { 'stored' : 0, 'deflate' : 1, 'lz4' : 2 }
+HEADER = struct.Struct('<4sHHIIQ')
+
+def write_length(out, length):
+    '''Writes the part of an LZ4 length beyond the 15 that fits in the token'''
+    while length >= 255:
+        out.append(255)
+        length -= 255
+    out.append(length)
+
+def lz4_compress_block(data):
+    '''Greedy LZ4 block compression, used when the lz4 package is not installed.  It is much slower than the
+    package and compresses a little worse, but writes the same format.'''
+    size = len(data)
+    out = bytearray()
+    table = {}
+    anchor = 0
+    pos = 0
+
+    # The format requires the last match to start 12 bytes before the end and the last 5 bytes to be literals
+    while pos < size - 12:
+        key = data[pos : pos + 4]
+        candidate = table.get(key, -1)
+        table[key] = pos
+        if candidate < 0 or pos - candidate > 65535:
+            pos += 1
+            continue
+
+        length = 4
+        while pos + length < size - 5 and data[candidate + length] == data[pos + length]:
+            length += 1
+
+        literals = pos - anchor
+        out.append(min(literals, 15) << 4 | min(length - 4, 15))
+        if literals >= 15:
+            write_length(out, literals - 15)
+        out += data[anchor : pos]
+        out += struct.pack('<H', pos - candidate)
+        if length - 4 >= 15:
+            write_length(out, length - 19)
+
+        pos += length
+        anchor = pos
+
+    literals = size - anchor
+    out.append(min(literals, 15) << 4)
+    if literals >= 15:
+        write_length(out, literals - 15)
+    out += data[anchor:]
+    return bytes(out)
+
+def compress_block(data, codec, level):
+    if codec == 'stored':
+        return data
+    elif codec == 'deflate':
+        compressor = zlib.compressobj(level, zlib.DEFLATED, -15)
+        return compressor.compress(data) + compressor.flush()
+    elif lz4 != None:
+        return lz4.block.compress(data, mode='high_compression', compression=level, store_size=False)
+    else:
+        return lz4_compress_block(data)
+
+def compress_file(filename, codec='deflate', level=6, blockSize=256 * 1024):
+    contents = open(filename, 'rb').read()
+    if len(contents) == 0:
+        print('skipping empty file ' + filename)
+        return
+
+    blockCount = (len(contents) + blockSize - 1) // blockSize
+    blocks = [contents[i * blockSize : (i + 1) * blockSize] for i in range(blockCount)]
+
+    # zlib and lz4 release the interpreter lock while compressing
+    with ThreadPoolExecutor() as executor:
+        compressed = list(executor.map(lambda block: compress_block(block, codec, level), blocks))
+
+    offset = HEADER.size + (blockCount + 1) * 8
+    offsets = []
+    for block in compressed:
+        offsets.append(offset)
+        offset += len(block)
+    offsets.append(offset)
+
+    outfile = open(filename + '.zblk', 'wb')
+    outfile.write(HEADER.pack(MAGIC, VERSION, CODECS[codec], blockSize, blockCount, len(contents)))
+    outfile.write(struct.pack('<{0}Q'.format(blockCount + 1), *offsets))
+    for block in compressed:
+        outfile.write(block)
+    outfile.close()
+
+    print('{0}: {1} -> {2} bytes in {3} blocks'.format(filename, len(contents), offset, blockCount))
+
+if __name__ == "__main__":
+    codec = 'deflate'
+    level = None
+    blockSize = 256 * 1024
+
+    args = sys.argv[1:]
+    while len(args) >= 2 and args[0].startswith('-'):
+        if args[0] == '-codec' and args[1] in CODECS:
+            codec = args[1]
+        elif args[0] == '-level':
+            level = int(args[1])
+        elif args[0] == '-blocksize':
+            blockSize = int(args[1]) * 1024
+        else:
+            break
+        args = args[2:]
+
+    if len(args) == 0 or args[0].startswith('-') or blockSize <= 0:
+        print(__doc__)
+        sys.exit(1)
+
+    if codec == 'lz4' and lz4 == None:
+        print('The lz4 package is not installed, so the slower built-in LZ4 compressor is used')
+
+    if level == None:
+        level = 9 if codec == 'lz4' else 6
+
+    for filename in args:
+        compress_file(filename, codec, level, blockSize)
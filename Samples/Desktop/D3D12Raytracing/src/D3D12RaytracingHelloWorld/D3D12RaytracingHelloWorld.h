@@ -13,6 +13,7 @@
 
 #include "DXSample.h"
 #include "StepTimer.h"
+#include "PerformanceTimers.h"
 #include "RaytracingHlslCompat.h"
 
 namespace GlobalRootSignatureParams {
@@ -23,6 +24,14 @@ namespace GlobalRootSignatureParams {
     };
 }
 
+namespace GpuTimers {
+    enum Enum {
+        Raytracing = 0,
+        CopyToBackbuffer,
+        Count
+    };
+}
+
 namespace LocalRootSignatureParams {
     enum Value {
         ViewportConstantSlot = 0,
@@ -116,6 +125,15 @@ private:
     RaytracingAPI m_raytracingAPI;
     bool m_forceComputeFallback;
     StepTimer m_timer;
+    DX::GPUTimer m_gpuTimers[GpuTimers::Count];
+    float m_accelerationStructureBuildTime;     // CPU time of the build, including the wait for the GPU, in milliseconds.
+
+    // Benchmark mode
+    static const UINT c_benchmarkWarmupFrames = 30;  // Skipped while the GPU clocks settle and the timer readbacks fill.
+    UINT m_benchmarkFrame;
+    double m_benchmarkFrameTime;                // Sums over the benchmarked frames, in milliseconds.
+    double m_benchmarkRaytracingTime;
+    double m_benchmarkCopyTime;
 
     void EnableDirectXRaytracing(IDXGIAdapter1* adapter);
     void ParseCommandLineArgs(WCHAR* argv[], int argc);
@@ -139,6 +157,8 @@ private:
     void UpdateForSizeChange(UINT clientWidth, UINT clientHeight);
     void CopyRaytracingOutputToBackbuffer();
     void CalculateFrameStats();
+    void UpdateBenchmark();
+    LPCWSTR GetRaytracingAPIName();
     UINT AllocateDescriptor(D3D12_CPU_DESCRIPTOR_HANDLE* cpuDescriptor, UINT descriptorIndexToUse = UINT_MAX);
     WRAPPED_GPU_POINTER CreateFallbackWrappedPointer(ID3D12Resource* resource, UINT bufferNumElements);
 };
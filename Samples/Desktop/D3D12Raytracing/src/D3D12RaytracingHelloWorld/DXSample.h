@@ -53,6 +53,7 @@ public:
 
 protected:
     void SetCustomWindowText(LPCWSTR text);
+    void PrintBenchmarkResults(LPCWSTR text);
 
     // Viewport dimensions.
     UINT m_width;
@@ -65,6 +66,9 @@ protected:
     // Override to be able to start without Dx11on12 UI for PIX. PIX doesn't support 11 on 12. 
     bool m_enableUI;
 
+    // Benchmark mode renders this many frames, prints the results and quits. Zero when disabled.
+    UINT m_benchmarkFrameCount;
+
     // D3D device resources
     UINT m_adapterIDoverride;
     std::unique_ptr<DX::DeviceResources> m_deviceResources;
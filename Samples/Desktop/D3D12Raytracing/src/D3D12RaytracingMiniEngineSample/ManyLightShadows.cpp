@@ -0,0 +1,272 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "ManyLightShadows.h"
+#include "ForwardPlusLighting.h"
+#include "PipelineState.h"
+#include "RootSignature.h"
+#include "CommandContext.h"
+#include "BufferManager.h"
+#include "Camera.h"
+#include "GraphicsCore.h"
+#include "GraphicsCommon.h"
+#include "TemporalEffects.h"
+#include "EngineTuning.h"
+
+#include "CompiledShaders/ManyLightTemporalResampleCS.h"
+#include "CompiledShaders/ManyLightSpatialResampleCS.h"
+#include "CompiledShaders/ManyLightShadowTemporalCS.h"
+#include "CompiledShaders/ManyLightShadowDenoiseCS.h"
+
+using namespace Math;
+using namespace Graphics;
+
+namespace ManyLightShadows
+{
+    BoolVar RayTraced("Application/Raytracing/Many Light Shadows/Ray Traced", true);
+    IntVar CandidateCount("Application/Raytracing/Many Light Shadows/Candidates", 8, 1, 32);
+    IntVar MaxHistory("Application/Raytracing/Many Light Shadows/Temporal Reuse", 20, 0, 64, 4);
+    IntVar SpatialCount("Application/Raytracing/Many Light Shadows/Spatial Reuse", 3, 0, 8);
+    NumVar SpatialRadius("Application/Raytracing/Many Light Shadows/Spatial Radius", 16.0f, 1.0f, 64.0f, 1.0f);
+    NumVar TemporalBlend("Application/Raytracing/Many Light Shadows/Temporal Blend", 0.9f, 0.0f, 0.98f, 0.02f);
+    IntVar FilterRadius("Application/Raytracing/Many Light Shadows/Filter Radius", 2, 0, 4);
+    NumVar FilterSigma("Application/Raytracing/Many Light Shadows/Filter Sigma", 1.5f, 0.5f, 4.0f, 0.25f);
+    NumVar DepthTolerance("Application/Raytracing/Many Light Shadows/Depth Tolerance", 0.05f, 0.005f, 0.5f, 0.005f);
+
+    RootSignature m_RootSig;
+    ComputePSO m_TemporalResampleCS;
+    ComputePSO m_SpatialResampleCS;
+    ComputePSO m_TemporalCS;
+    ComputePSO m_DenoiseCS;
+
+    // The spatial pass writes the reservoirs that next frame's temporal pass merges, so they need no ping-ponging
+    ColorBuffer m_Reservoirs;
+    ColorBuffer m_TemporalReservoirs;
+    ColorBuffer m_TraceBuffer;
+    ColorBuffer m_History[2];
+    ColorBuffer m_ShadowRatio;
+
+    uint64_t m_ReservoirFrame = 0;
+    uint64_t m_HistoryFrame = 0;
+
+    // The same transform as the camera velocity, from full resolution pixels and linear depth to last frame's
+    Matrix4 GetCurToPrevXForm(const Camera& camera)
+    {
+        const float RcpHalfDimX = 2.0f / g_SceneColorBuffer.GetWidth();
+        const float RcpHalfDimY = 2.0f / g_SceneColorBuffer.GetHeight();
+        const float RcpZMagic = camera.GetNearClip() / (camera.GetFarClip() - camera.GetNearClip());
+
+        Matrix4 preMult = Matrix4(
+            Vector4( RcpHalfDimX, 0.0f, 0.0f, 0.0f ),
+            Vector4( 0.0f, -RcpHalfDimY, 0.0f, 0.0f ),
+            Vector4( 0.0f, 0.0f, RcpZMagic, 0.0f ),
+            Vector4( -1.0f, 1.0f, -RcpZMagic, 1.0f )
+        );
+
+        Matrix4 postMult = Matrix4(
+            Vector4( 1.0f / RcpHalfDimX, 0.0f, 0.0f, 0.0f ),
+            Vector4( 0.0f, -1.0f / RcpHalfDimY, 0.0f, 0.0f ),
+            Vector4( 0.0f, 0.0f, 1.0f, 0.0f ),
+            Vector4( 1.0f / RcpHalfDimX, 1.0f / RcpHalfDimY, 0.0f, 1.0f ) );
+
+        return postMult * camera.GetReprojectionMatrix() * preMult;
+    }
+}
+
+void ManyLightShadows::InitializeResources( void )
+{
+    m_RootSig.Reset(3, 1);
+    m_RootSig[0].InitAsConstantBuffer(0);
+    m_RootSig[1].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 0, 6);
+    m_RootSig[2].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 0, 1);
+    m_RootSig.InitStaticSampler(0, SamplerLinearClampDesc);
+    m_RootSig.Finalize(L"ManyLightShadowsRS");
+
+#define CreatePSO( ObjName, ShaderByteCode ) \
+    ObjName.SetRootSignature(m_RootSig); \
+    ObjName.SetComputeShader(ShaderByteCode, sizeof(ShaderByteCode) ); \
+    ObjName.Finalize();
+
+    CreatePSO(m_TemporalResampleCS, g_pManyLightTemporalResampleCS);
+    CreatePSO(m_SpatialResampleCS, g_pManyLightSpatialResampleCS);
+    CreatePSO(m_TemporalCS, g_pManyLightShadowTemporalCS);
+    CreatePSO(m_DenoiseCS, g_pManyLightShadowDenoiseCS);
+
+#undef CreatePSO
+
+    const uint32_t Width = g_SceneColorBuffer.GetWidth();
+    const uint32_t Height = g_SceneColorBuffer.GetHeight();
+
+    m_Reservoirs.Create(L"Light Reservoirs", Width, Height, 1, DXGI_FORMAT_R32G32_UINT);
+    m_TemporalReservoirs.Create(L"Light Reservoirs Temporal", Width, Height, 1, DXGI_FORMAT_R32G32_UINT);
+    m_TraceBuffer.Create(L"Light Shadow Ray Trace", Width, Height, 1, DXGI_FORMAT_R8_UNORM);
+    m_History[0].Create(L"Light Shadow History 0", Width, Height, 1, DXGI_FORMAT_R16_FLOAT);
+    m_History[1].Create(L"Light Shadow History 1", Width, Height, 1, DXGI_FORMAT_R16_FLOAT);
+    m_ShadowRatio.Create(L"Light Shadow Ratio", Width, Height, 1, DXGI_FORMAT_R8_UNORM);
+}
+
+bool ManyLightShadows::IsRayTraced( void )
+{
+    return RayTraced;
+}
+
+void ManyLightShadows::SelectLights( ComputeContext& Context, const Camera& camera )
+{
+    ScopedTimer _prof(L"Select Lights", Context);
+
+    // SSAO linearizes this frame's depth into g_LinearDepth[Src]
+    uint32_t Src = TemporalEffects::GetFrameIndexMod2();
+    ColorBuffer& LinearDepth = g_LinearDepth[Src];
+    ColorBuffer& PrevLinearDepth = g_LinearDepth[Src ^ 1];
+
+    // Last frame's picks are only merged when they were made last frame
+    const uint64_t Frame = Graphics::GetFrameCount();
+    const bool HistoryValid = m_ReservoirFrame + 1 == Frame;
+    m_ReservoirFrame = Frame;
+
+    __declspec(align(16)) struct
+    {
+        Matrix4 ClipToWorld;
+        Matrix4 CurToPrevXForm;
+        float ViewerPos[3];
+        float InvTileDim;
+        float RcpBufferDim[2];
+        uint32_t TileCountX;
+        uint32_t FrameIndex;
+        uint32_t CandidateCount;
+        uint32_t MaxHistory;
+        uint32_t SpatialCount;
+        float SpatialRadius;
+        float DepthTolerance;
+    } csConstants;
+
+    csConstants.ClipToWorld = Invert(camera.GetViewProjMatrix());
+    csConstants.CurToPrevXForm = GetCurToPrevXForm(camera);
+    csConstants.ViewerPos[0] = camera.GetPosition().GetX();
+    csConstants.ViewerPos[1] = camera.GetPosition().GetY();
+    csConstants.ViewerPos[2] = camera.GetPosition().GetZ();
+    csConstants.InvTileDim = 1.0f / Lighting::LightGridDim;
+    csConstants.RcpBufferDim[0] = 1.0f / g_SceneColorBuffer.GetWidth();
+    csConstants.RcpBufferDim[1] = 1.0f / g_SceneColorBuffer.GetHeight();
+    csConstants.TileCountX = Math::DivideByMultiple(g_SceneColorBuffer.GetWidth(), Lighting::LightGridDim);
+    csConstants.FrameIndex = (uint32_t)Frame;
+    csConstants.CandidateCount = (uint32_t)CandidateCount;
+    csConstants.MaxHistory = HistoryValid ? (uint32_t)MaxHistory : 0;
+    csConstants.SpatialCount = (uint32_t)SpatialCount;
+    csConstants.SpatialRadius = SpatialRadius;
+    csConstants.DepthTolerance = DepthTolerance;
+
+    Context.SetRootSignature(m_RootSig);
+    Context.SetDynamicConstantBufferView(0, sizeof(csConstants), &csConstants);
+
+    Context.TransitionResource(Lighting::m_LightBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    Context.TransitionResource(Lighting::m_LightGrid, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    Context.TransitionResource(g_SceneDepthBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    Context.TransitionResource(LinearDepth, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    Context.TransitionResource(PrevLinearDepth, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+
+    {
+        Context.TransitionResource(m_Reservoirs, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        Context.TransitionResource(m_TemporalReservoirs, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, true);
+
+        D3D12_CPU_DESCRIPTOR_HANDLE SRVs[] = { Lighting::m_LightBuffer.GetSRV(), Lighting::m_LightGrid.GetSRV(),
+            g_SceneDepthBuffer.GetDepthSRV(), LinearDepth.GetSRV(), m_Reservoirs.GetSRV(), PrevLinearDepth.GetSRV() };
+
+        Context.SetPipelineState(m_TemporalResampleCS);
+        Context.SetDynamicDescriptors(1, 0, _countof(SRVs), SRVs);
+        Context.SetDynamicDescriptor(2, 0, m_TemporalReservoirs.GetUAV());
+        Context.Dispatch2D(m_TemporalReservoirs.GetWidth(), m_TemporalReservoirs.GetHeight());
+    }
+
+    {
+        Context.TransitionResource(m_TemporalReservoirs, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        Context.TransitionResource(m_Reservoirs, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, true);
+
+        D3D12_CPU_DESCRIPTOR_HANDLE SRVs[] = { Lighting::m_LightBuffer.GetSRV(), Lighting::m_LightGrid.GetSRV(),
+            g_SceneDepthBuffer.GetDepthSRV(), LinearDepth.GetSRV(), m_TemporalReservoirs.GetSRV() };
+
+        Context.SetPipelineState(m_SpatialResampleCS);
+        Context.SetDynamicDescriptors(1, 0, _countof(SRVs), SRVs);
+        Context.SetDynamicDescriptor(2, 0, m_Reservoirs.GetUAV());
+        Context.Dispatch2D(m_Reservoirs.GetWidth(), m_Reservoirs.GetHeight());
+    }
+
+    Context.TransitionResource(m_Reservoirs, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+}
+
+void ManyLightShadows::Resolve( ComputeContext& Context, const Camera& camera )
+{
+    ScopedTimer _prof(L"Resolve Light Shadow Rays", Context);
+
+    // Same ping-ponging as the TAA history
+    uint32_t Src = TemporalEffects::GetFrameIndexMod2();
+    uint32_t Dst = Src ^ 1;
+    ColorBuffer& LinearDepth = g_LinearDepth[Src];
+    ColorBuffer& PrevLinearDepth = g_LinearDepth[Dst];
+
+    const uint64_t Frame = Graphics::GetFrameCount();
+    const bool HistoryValid = m_HistoryFrame + 1 == Frame;
+    m_HistoryFrame = Frame;
+
+    Context.SetRootSignature(m_RootSig);
+
+    {
+        __declspec(align(16)) struct
+        {
+            Matrix4 CurToPrevXForm;
+            float RcpBufferDim[2];
+            float TemporalBlend;
+            float DepthTolerance;
+        } csConstants;
+
+        csConstants.CurToPrevXForm = GetCurToPrevXForm(camera);
+        csConstants.RcpBufferDim[0] = 1.0f / m_TraceBuffer.GetWidth();
+        csConstants.RcpBufferDim[1] = 1.0f / m_TraceBuffer.GetHeight();
+        csConstants.TemporalBlend = HistoryValid ? (float)TemporalBlend : 0.0f;
+        csConstants.DepthTolerance = DepthTolerance;
+
+        Context.TransitionResource(m_TraceBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        Context.TransitionResource(m_History[Src], D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        Context.TransitionResource(LinearDepth, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        Context.TransitionResource(PrevLinearDepth, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        Context.TransitionResource(m_History[Dst], D3D12_RESOURCE_STATE_UNORDERED_ACCESS, true);
+
+        D3D12_CPU_DESCRIPTOR_HANDLE SRVs[] = { m_TraceBuffer.GetSRV(), m_History[Src].GetSRV(), LinearDepth.GetSRV(), PrevLinearDepth.GetSRV() };
+
+        Context.SetPipelineState(m_TemporalCS);
+        Context.SetDynamicConstantBufferView(0, sizeof(csConstants), &csConstants);
+        Context.SetDynamicDescriptors(1, 0, _countof(SRVs), SRVs);
+        Context.SetDynamicDescriptor(2, 0, m_History[Dst].GetUAV());
+        Context.Dispatch2D(m_TraceBuffer.GetWidth(), m_TraceBuffer.GetHeight());
+    }
+
+    {
+        __declspec(align(16)) struct
+        {
+            int32_t FilterRadius;
+            float RcpSigmaSq;
+            float DepthTolerance;
+        } csConstants;
+
+        csConstants.FilterRadius = FilterRadius;
+        csConstants.RcpSigmaSq = 1.0f / (2.0f * FilterSigma * FilterSigma);
+        csConstants.DepthTolerance = DepthTolerance;
+
+        Context.TransitionResource(m_History[Dst], D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        Context.TransitionResource(m_ShadowRatio, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, true);
+
+        D3D12_CPU_DESCRIPTOR_HANDLE SRVs[] = { m_History[Dst].GetSRV(), LinearDepth.GetSRV() };
+
+        Context.SetPipelineState(m_DenoiseCS);
+        Context.SetDynamicConstantBufferView(0, sizeof(csConstants), &csConstants);
+        Context.SetDynamicDescriptors(1, 0, _countof(SRVs), SRVs);
+        Context.SetDynamicDescriptor(2, 0, m_ShadowRatio.GetUAV());
+        Context.Dispatch2D(m_ShadowRatio.GetWidth(), m_ShadowRatio.GetHeight());
+    }
+}
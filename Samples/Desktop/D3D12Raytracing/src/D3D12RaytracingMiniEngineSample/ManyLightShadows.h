@@ -0,0 +1,45 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#pragma once
+
+class ColorBuffer;
+class ComputeContext;
+namespace Math
+{
+    class Camera;
+}
+
+// Stochastic shadows for the Forward+ lights.  Each pixel picks one light of its light grid tile with a probability
+// that follows the light's unshadowed contribution, reusing the picks of its neighbors and of last frame, and traces
+// a single shadow ray to it.  The filtered visibility estimates the shadowed share of the tile's lighting, which the
+// color pass applies to the sum of the unshadowed lights, so the ray count does not grow with the number of lights.
+namespace ManyLightShadows
+{
+    // The light picked for each pixel, read by the shadow rays
+    extern ColorBuffer m_Reservoirs;
+
+    // The full resolution ray target
+    extern ColorBuffer m_TraceBuffer;
+
+    // The filtered visibility, read by the color pass
+    extern ColorBuffer m_ShadowRatio;
+
+    void InitializeResources(void);
+
+    // Whether the local lights are shadowed by rays rather than by their shadow maps
+    bool IsRayTraced(void);
+
+    // Picks the light that each pixel traces.  Reads the light grid and this and last frame's linear depth, so it
+    // runs after the light grid is filled.
+    void SelectLights(ComputeContext& Context, const Math::Camera& Camera);
+
+    // Accumulates the ray target into the history and filters it into m_ShadowRatio
+    void Resolve(ComputeContext& Context, const Math::Camera& Camera);
+}
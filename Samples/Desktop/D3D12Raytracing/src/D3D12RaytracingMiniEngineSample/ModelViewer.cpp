@@ -21,6 +21,7 @@
 #include "BufferManager.h"
 #include "Camera.h"
 #include "Model.h"
+#include "ModelSkinning.h"
 #include "GpuBuffer.h"
 #include "CommandContext.h"
 #include "SamplerManager.h"
@@ -35,7 +36,15 @@
 #include "ShadowCamera.h"
 #include "ParticleEffectManager.h"
 #include "GameInput.h"
+#include "ReadbackBuffer.h"
+#include "GpuMemoryTracker.h"
 #include "./ForwardPlusLighting.h"
+#include "./RaytracedShadows.h"
+#include "./RaytracedAO.h"
+#include "./ManyLightShadows.h"
+#include "./ShadowInstanceCulling.h"
+#include "./ReflectionRayBinning.h"
+#include "./ScreenSpaceReflections.h"
 #include <atlbase.h>
 #include <atlbase.h>
 
@@ -51,6 +60,10 @@
 #include "CompiledShaders/DiffuseHitShaderLib.h"
 #include "CompiledShaders/RayGenerationShadowsLib.h"
 #include "CompiledShaders/MissShadowsLib.h"
+#include "CompiledShaders/RayGenerationHybridShadowsLib.h"
+#include "CompiledShaders/RayGenerationSortedReflectionsLib.h"
+#include "CompiledShaders/RayGenerationAmbientOcclusionLib.h"
+#include "CompiledShaders/RayGenerationManyLightShadowsLib.h"
 
 #include "RaytracingHlslCompat.h"
 #include "ModelViewerRayTracing.h"
@@ -74,6 +87,8 @@ __declspec(align(16)) struct HitShaderConstants
     Matrix4 modelToShadow;
     UINT32 IsReflection;
     UINT32 UseShadowRays;
+    UINT32 UseShadowMask;
+    UINT32 UseReflectionRayList;
 };
 
 ByteAddressBuffer          g_hitConstantBuffer;
@@ -84,10 +99,17 @@ D3D12_CPU_DESCRIPTOR_HANDLE g_SceneMeshInfo;
 D3D12_CPU_DESCRIPTOR_HANDLE g_SceneIndices;
 
 D3D12_GPU_DESCRIPTOR_HANDLE g_OutputUAV;
+D3D12_GPU_DESCRIPTOR_HANDLE g_ShadowTraceUAVs[RaytracedShadows::kNumResolutions - 1];
 D3D12_GPU_DESCRIPTOR_HANDLE g_DepthAndNormalsTable;
+D3D12_GPU_DESCRIPTOR_HANDLE g_HybridShadowMaskUAV;
+D3D12_GPU_DESCRIPTOR_HANDLE g_AmbientOcclusionTraceUAV;
+D3D12_GPU_DESCRIPTOR_HANDLE g_LightShadowTraceUAV;
+D3D12_GPU_DESCRIPTOR_HANDLE g_LightShadowRaysTable;
+D3D12_GPU_DESCRIPTOR_HANDLE g_HybridShadowRaysTable;
+D3D12_GPU_DESCRIPTOR_HANDLE g_HybridShadowMaskTable;
+D3D12_GPU_DESCRIPTOR_HANDLE g_ReflectionRaysTable;
 D3D12_GPU_DESCRIPTOR_HANDLE g_SceneSrvs;
 
-std::vector<CComPtr<ID3D12Resource>>   g_bvh_bottomLevelAccelerationStructures;
 CComPtr<ID3D12Resource>   g_bvh_topLevelAccelerationStructure;
 WRAPPED_GPU_POINTER g_bvh_topLevelAccelerationStructurePointer;
 
@@ -102,6 +124,10 @@ enum RaytracingTypes
     Shadows,
     DiffuseHitShader,
     Reflection,
+    HybridShadows,
+    SortedReflection,
+    AmbientOcclusion,
+    LightShadows,
     NumTypes
 };
 
@@ -109,17 +135,40 @@ const static UINT MaxRayRecursion = 2;
 
 const static UINT c_NumCameraPositions = 5;
 
+// Hit group tables are created once for each distinct content, so pipelines whose records come out the same
+// share a single table
+class HitShaderTableCache
+{
+public:
+    const ByteAddressBuffer& GetTable(const std::vector<byte> &records)
+    {
+        for (auto &table : m_Tables)
+        {
+            if (table.first == records)
+                return *table.second;
+        }
+
+        m_Tables.emplace_back(records, std::make_unique<ByteAddressBuffer>());
+        m_Tables.back().second->Create(L"Hit Shader Table", 1, (UINT)records.size(), records.data());
+        return *m_Tables.back().second;
+    }
+
+private:
+    std::vector<std::pair<std::vector<byte>, std::unique_ptr<ByteAddressBuffer>>> m_Tables;
+};
+
+HitShaderTableCache g_hitShaderTables;
+
 struct RaytracingDispatchRayInputs
 {
     RaytracingDispatchRayInputs() {}
     RaytracingDispatchRayInputs(
         ID3D12RaytracingFallbackDevice &device,
         ID3D12RaytracingFallbackStateObject *pPSO,
-        void *pHitGroupShaderTable,
+        const ByteAddressBuffer &hitShaderTable,
         UINT HitGroupStride,
-        UINT HitGroupTableSize,
         LPCWSTR rayGenExportName,
-        LPCWSTR missExportName) : m_pPSO(pPSO)
+        LPCWSTR missExportName) : m_pPSO(pPSO), m_pHitShaderTable(&hitShaderTable)
     {
         const UINT shaderTableSize = device.GetShaderIdentifierSize();
         void *pRayGenShaderData = pPSO->GetShaderIdentifier(rayGenExportName);
@@ -136,8 +185,6 @@ struct RaytracingDispatchRayInputs
         
         memcpy(pAlignedShaderTableData, pMissShaderData, shaderTableSize);
         m_MissShaderTable.Create(L"Miss Shader Table", 1, shaderTableSize, alignedShaderTableData.data());
-        
-        m_HitShaderTable.Create(L"Hit Shader Table", 1, HitGroupTableSize, pHitGroupShaderTable);
     }
 
     D3D12_DISPATCH_RAYS_DESC GetDispatchRayDesc(UINT DispatchWidth, UINT DispatchHeight)
@@ -146,8 +193,8 @@ struct RaytracingDispatchRayInputs
 
         dispatchRaysDesc.RayGenerationShaderRecord.StartAddress = m_RayGenShaderTable.GetGpuVirtualAddress();
         dispatchRaysDesc.RayGenerationShaderRecord.SizeInBytes = m_RayGenShaderTable.GetBufferSize();
-        dispatchRaysDesc.HitGroupTable.StartAddress = m_HitShaderTable.GetGpuVirtualAddress();
-        dispatchRaysDesc.HitGroupTable.SizeInBytes = m_HitShaderTable.GetBufferSize();
+        dispatchRaysDesc.HitGroupTable.StartAddress = m_pHitShaderTable->GetGpuVirtualAddress();
+        dispatchRaysDesc.HitGroupTable.SizeInBytes = m_pHitShaderTable->GetBufferSize();
         dispatchRaysDesc.HitGroupTable.StrideInBytes = m_HitGroupStride;
         dispatchRaysDesc.MissShaderTable.StartAddress = m_MissShaderTable.GetGpuVirtualAddress();
         dispatchRaysDesc.MissShaderTable.SizeInBytes = m_MissShaderTable.GetBufferSize();
@@ -162,7 +209,7 @@ struct RaytracingDispatchRayInputs
     CComPtr<ID3D12RaytracingFallbackStateObject> m_pPSO;
     ByteAddressBuffer   m_RayGenShaderTable;
     ByteAddressBuffer   m_MissShaderTable;
-    ByteAddressBuffer   m_HitShaderTable;
+    const ByteAddressBuffer *m_pHitShaderTable = nullptr;
 };
 
 struct MaterialRootConstant
@@ -177,7 +224,7 @@ class D3D12RaytracingMiniEngineSample : public GameCore::IGameApp
 {
 public:
 
-    D3D12RaytracingMiniEngineSample( void ) {}
+    D3D12RaytracingMiniEngineSample( void ) : m_AnimationTime(0.0f) {}
 
     virtual void Startup( void ) override;
     virtual void Cleanup( void ) override;
@@ -197,6 +244,9 @@ private:
     void RenderObjects( GraphicsContext& Context, const Matrix4& ViewProjMat, eObjectFilter Filter = kAll );
     void RaytraceDiffuse(GraphicsContext& context, const Math::Camera& camera, ColorBuffer& colorTarget);
     void RaytraceShadows(GraphicsContext& context, const Math::Camera& camera, ColorBuffer& colorTarget, DepthBuffer& depth);
+    void RaytraceHybridShadows(GraphicsContext& context, const Math::Camera& camera, DepthBuffer& depth);
+    void RaytraceAmbientOcclusion(GraphicsContext& context, const Math::Camera& camera, DepthBuffer& depth);
+    void RaytraceLightShadows(GraphicsContext& context, const Math::Camera& camera, DepthBuffer& depth);
     void RaytraceReflections(GraphicsContext& context, const Math::Camera& camera, ColorBuffer& colorTarget, DepthBuffer& depth, ColorBuffer& normals);
 
     Camera m_Camera;
@@ -218,8 +268,10 @@ private:
     D3D12_CPU_DESCRIPTOR_HANDLE m_ShadowSampler;
     D3D12_CPU_DESCRIPTOR_HANDLE m_BiasedDefaultSampler;
 
-    D3D12_CPU_DESCRIPTOR_HANDLE m_ExtraTextures[6];
+    D3D12_CPU_DESCRIPTOR_HANDLE m_ExtraTextures[7];
     Model m_Model;
+    ModelSkinning m_Skinning;
+    float m_AnimationTime;
     std::vector<bool> m_pMaterialIsCutout;
     std::vector<bool> m_pMaterialIsReflective;
 
@@ -300,6 +352,11 @@ NumVar ShadowDimZ("Application/Lighting/Shadow Dim Z", 3000, 1000, 10000, 100 );
 
 BoolVar ShowWaveTileCounts("Application/Forward+/Show Wave Tile Counts", false);
 
+// Skinned models play one of their animations.  A clip past the model's last holds the bind pose.
+BoolVar EnableAnimation("Application/Animation/Enable", true);
+IntVar AnimationClip("Application/Animation/Clip", 0, 0, 255);
+NumVar AnimationSpeed("Application/Animation/Speed", 1.0f, 0.0f, 4.0f, 0.1f);
+
 const char* rayTracingModes[] = {
     "Off", 
     "Bary Rays", 
@@ -307,7 +364,10 @@ const char* rayTracingModes[] = {
     "Shadow Rays", 
     "Diffuse&ShadowMaps",
     "Diffuse&ShadowRays",
-    "Reflection Rays"};
+    "Reflection Rays",
+    "Diffuse&HybridShadows",
+    "RT Ambient Occlusion",
+    "Many Light Shadows"};
 enum RaytracingMode
 {
     RTM_OFF,
@@ -317,6 +377,9 @@ enum RaytracingMode
     RTM_DIFFUSE_WITH_SHADOWMAPS,
     RTM_DIFFUSE_WITH_SHADOWRAYS,
     RTM_REFLECTIONS,
+    RTM_DIFFUSE_WITH_HYBRID_SHADOWS,
+    RTM_AMBIENT_OCCLUSION,
+    RTM_MANY_LIGHT_SHADOWS,
 };
 EnumVar rayTracingMode("Application/Raytracing/RayTraceMode", RTM_DIFFUSE_WITH_SHADOWMAPS, _countof(rayTracingModes), rayTracingModes);
 
@@ -391,6 +454,438 @@ private:
 
 std::unique_ptr<DescriptorHeapStack> g_pRaytracingDescriptorHeap;
 
+// Bottom level acceleration structures compacted into regions of one pooled buffer.  Each is built into
+// temporary memory at its worst case size, then copied into the pool at the compacted size read back from
+// the GPU, and the temporary memory is released.
+//
+// On the Fallback Layer the pool is also saved next to the model it was built from, and loaded from there on
+// the next run instead of being built.  Its bottom levels keep every reference as an offset from their own
+// start, so the saved bytes are valid wherever they are uploaded.  The driver's layout is its own, so the
+// driver path always builds.
+class BottomLevelAccelerationStructurePool
+{
+public:
+    // Blocks until the compacted copies finish.  The inputs need
+    // D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_ALLOW_COMPACTION.  The cache is skipped when
+    // sourceFileName is null.
+    void Build(
+        DescriptorHeapStack &descriptorHeap,
+        const D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS *pInputs,
+        UINT numBottomLevels,
+        const char *sourceFileName = nullptr)
+    {
+        const size_t alignment = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BYTE_ALIGNMENT;
+
+        const bool useCache = sourceFileName != nullptr && !g_pRaytracingDevice->UsingRaytracingDriver();
+        std::string cacheFileName;
+        std::vector<CacheLevel> cacheLevels;
+        CacheHeader cacheHeader = {};
+        if (useCache)
+        {
+            cacheFileName = std::string(sourceFileName) + ".blas";
+            cacheLevels.resize(numBottomLevels);
+            for (UINT i = 0; i < numBottomLevels; i++)
+            {
+                cacheLevels[i] = GetCacheLevel(pInputs[i]);
+            }
+            memcpy(cacheHeader.magic, kCacheMagic, sizeof(cacheHeader.magic));
+            cacheHeader.version = kCacheVersion;
+            cacheHeader.numBottomLevels = numBottomLevels;
+            cacheHeader.sourceWriteTime = GetWriteTime(sourceFileName);
+
+            if (Load(descriptorHeap, cacheFileName, cacheHeader, cacheLevels))
+            {
+                return;
+            }
+        }
+
+        // Builds recorded in one call may run together, so each gets scratch memory of its own
+        std::vector<D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC> buildDescs(numBottomLevels);
+        std::vector<UINT64> tempOffsets(numBottomLevels);
+        std::vector<UINT64> scratchOffsets(numBottomLevels);
+        UINT64 tempSize = 0;
+        UINT64 scratchSize = 0;
+        for (UINT i = 0; i < numBottomLevels; i++)
+        {
+            D3D12_RAYTRACING_ACCELERATION_STRUCTURE_PREBUILD_INFO prebuildInfo;
+            g_pRaytracingDevice->GetRaytracingAccelerationStructurePrebuildInfo(&pInputs[i], &prebuildInfo);
+
+            buildDescs[i].Inputs = pInputs[i];
+            tempOffsets[i] = tempSize;
+            scratchOffsets[i] = scratchSize;
+            tempSize += AlignUp(prebuildInfo.ResultDataMaxSizeInBytes, alignment);
+            scratchSize += AlignUp(prebuildInfo.ScratchDataSizeInBytes, alignment);
+        }
+
+        CComPtr<ID3D12Resource> pTempBuffer;
+        CreateAccelerationStructureBuffer(tempSize, &pTempBuffer);
+
+        ByteAddressBuffer scratchBuffer;
+        scratchBuffer.Create(L"Bottom Level Scratch Buffer", (UINT)scratchSize, 1);
+
+        // The Fallback Layer writes each compacted size as a UINT32 where the driver writes a
+        // D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_COMPACTED_SIZE_DESC
+        const bool usingDriver = g_pRaytracingDevice->UsingRaytracingDriver();
+        const UINT sizeStride = usingDriver ? sizeof(UINT64) : sizeof(UINT32);
+        ByteAddressBuffer compactedSizeBuffer;
+        compactedSizeBuffer.Create(L"Compacted Size Buffer", numBottomLevels, sizeStride);
+        ReadbackBuffer compactedSizeReadback;
+        compactedSizeReadback.Create(L"Compacted Size Readback", numBottomLevels, sizeStride);
+
+        std::vector<D3D12_GPU_VIRTUAL_ADDRESS> tempAddresses(numBottomLevels);
+        for (UINT i = 0; i < numBottomLevels; i++)
+        {
+            tempAddresses[i] = pTempBuffer->GetGPUVirtualAddress() + tempOffsets[i];
+            buildDescs[i].DestAccelerationStructureData = tempAddresses[i];
+            buildDescs[i].ScratchAccelerationStructureData = scratchBuffer.GetGpuVirtualAddress() + scratchOffsets[i];
+        }
+
+        {
+            GraphicsContext& buildContext = GraphicsContext::Begin(L"Build Bottom Level Acceleration Structures");
+            CComPtr<ID3D12RaytracingFallbackCommandList> pRaytracingCommandList = GetRaytracingCommandList(buildContext, descriptorHeap);
+            buildContext.TransitionResource(compactedSizeBuffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, true);
+
+            pRaytracingCommandList->BuildRaytracingAccelerationStructures(numBottomLevels, buildDescs.data());
+
+            auto uavBarrier = CD3DX12_RESOURCE_BARRIER::UAV(nullptr);
+            buildContext.GetCommandList()->ResourceBarrier(1, &uavBarrier);
+
+            D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_DESC postbuildInfoDesc = {};
+            postbuildInfoDesc.DestBuffer = compactedSizeBuffer.GetGpuVirtualAddress();
+            postbuildInfoDesc.InfoType = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_COMPACTED_SIZE;
+            pRaytracingCommandList->EmitRaytracingAccelerationStructurePostbuildInfo(&postbuildInfoDesc, numBottomLevels, tempAddresses.data());
+
+            buildContext.CopyBufferRegion(compactedSizeReadback, 0, compactedSizeBuffer, 0, numBottomLevels * sizeStride);
+            buildContext.Finish(true);
+        }
+
+        m_offsets.resize(numBottomLevels);
+        UINT64 poolSize = 0;
+        const BYTE *pCompactedSizes = (const BYTE *)compactedSizeReadback.Map();
+        for (UINT i = 0; i < numBottomLevels; i++)
+        {
+            const UINT64 compactedSize = usingDriver ?
+                ((const UINT64 *)pCompactedSizes)[i] :
+                ((const UINT32 *)pCompactedSizes)[i];
+            m_offsets[i] = poolSize;
+            poolSize += AlignUp(compactedSize, alignment);
+        }
+        compactedSizeReadback.Unmap();
+
+        CreateAccelerationStructureBuffer(poolSize, &m_pPoolBuffer);
+        m_descriptorIndex = descriptorHeap.AllocateBufferUav(*m_pPoolBuffer);
+
+        {
+            GraphicsContext& compactContext = GraphicsContext::Begin(L"Compact Bottom Level Acceleration Structures");
+            CComPtr<ID3D12RaytracingFallbackCommandList> pRaytracingCommandList = GetRaytracingCommandList(compactContext, descriptorHeap);
+            for (UINT i = 0; i < numBottomLevels; i++)
+            {
+                pRaytracingCommandList->CopyRaytracingAccelerationStructure(
+                    GetGpuVirtualAddress(i),
+                    tempAddresses[i],
+                    D3D12_RAYTRACING_ACCELERATION_STRUCTURE_COPY_MODE_COMPACT);
+            }
+            compactContext.Finish(true);
+        }
+
+        Utility::Printf("Compacted %u bottom level acceleration structures from %llu to %llu bytes, saving %llu bytes\n",
+            numBottomLevels, tempSize, poolSize, tempSize - poolSize);
+
+        if (useCache && cacheHeader.sourceWriteTime != 0)
+        {
+            cacheHeader.poolSize = poolSize;
+            for (UINT i = 0; i < numBottomLevels; i++)
+            {
+                cacheLevels[i].offset = m_offsets[i];
+            }
+            Save(cacheFileName, cacheHeader, cacheLevels);
+        }
+    }
+
+    D3D12_GPU_VIRTUAL_ADDRESS GetGpuVirtualAddress(UINT index) const
+    {
+        return m_pPoolBuffer->GetGPUVirtualAddress() + m_offsets[index];
+    }
+
+    // The Fallback Layer reaches a region of the pool through the descriptor of the whole pool
+    WRAPPED_GPU_POINTER GetWrappedPointer(UINT index) const
+    {
+        if (g_pRaytracingDevice->UsingRaytracingDriver())
+        {
+            return g_pRaytracingDevice->GetWrappedPointerSimple(m_descriptorIndex, GetGpuVirtualAddress(index));
+        }
+        return g_pRaytracingDevice->GetWrappedPointerFromDescriptorHeapIndex(m_descriptorIndex, (UINT32)m_offsets[index]);
+    }
+
+private:
+    static const char kCacheMagic[4];
+    static const UINT32 kCacheVersion = 1;
+
+    struct CacheHeader
+    {
+        char magic[4];
+        UINT32 version;
+        UINT32 numBottomLevels;
+        UINT32 padding;
+        UINT64 sourceWriteTime;
+        UINT64 poolSize;
+    };
+
+    // What the cached bottom level was built over.  The geometry itself is identified by the source file.
+    struct CacheLevel
+    {
+        UINT32 flags;
+        UINT32 vertexCount;
+        UINT32 indexCount;
+        UINT32 vertexStride;
+        UINT64 offset;
+    };
+
+    static CacheLevel GetCacheLevel(const D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS &inputs)
+    {
+        CacheLevel level = {};
+        level.flags = (UINT32)inputs.Flags;
+        for (UINT i = 0; i < inputs.NumDescs; i++)
+        {
+            const D3D12_RAYTRACING_GEOMETRY_TRIANGLES_DESC &triangles = inputs.pGeometryDescs[i].Triangles;
+            level.vertexCount += triangles.VertexCount;
+            level.indexCount += triangles.IndexCount;
+            level.vertexStride = (UINT32)triangles.VertexBuffer.StrideInBytes;
+        }
+        return level;
+    }
+
+    static UINT64 GetWriteTime(const char *fileName)
+    {
+        WIN32_FILE_ATTRIBUTE_DATA attributes;
+        if (!GetFileAttributesExA(fileName, GetFileExInfoStandard, &attributes))
+            return 0;
+
+        return (UINT64)attributes.ftLastWriteTime.dwHighDateTime << 32 | attributes.ftLastWriteTime.dwLowDateTime;
+    }
+
+    // Fails when there is no cache, or when it was built from another version of the source or other inputs
+    bool Load(
+        DescriptorHeapStack &descriptorHeap,
+        const std::string &cacheFileName,
+        const CacheHeader &expectedHeader,
+        const std::vector<CacheLevel> &expectedLevels)
+    {
+        FILE *file = nullptr;
+        if (expectedHeader.sourceWriteTime == 0 || 0 != fopen_s(&file, cacheFileName.c_str(), "rb"))
+            return false;
+
+        const UINT numBottomLevels = expectedHeader.numBottomLevels;
+        CacheHeader header;
+        std::vector<CacheLevel> levels(numBottomLevels);
+        std::vector<BYTE> poolData;
+        bool ok = 1 == fread(&header, sizeof(header), 1, file) &&
+            0 == memcmp(header.magic, expectedHeader.magic, sizeof(header.magic)) &&
+            header.version == expectedHeader.version &&
+            header.numBottomLevels == numBottomLevels &&
+            header.sourceWriteTime == expectedHeader.sourceWriteTime &&
+            header.poolSize > 0 && header.poolSize <= UINT_MAX &&
+            numBottomLevels == fread(levels.data(), sizeof(CacheLevel), numBottomLevels, file);
+
+        for (UINT i = 0; ok && i < numBottomLevels; i++)
+        {
+            ok = levels[i].flags == expectedLevels[i].flags &&
+                levels[i].vertexCount == expectedLevels[i].vertexCount &&
+                levels[i].indexCount == expectedLevels[i].indexCount &&
+                levels[i].vertexStride == expectedLevels[i].vertexStride &&
+                levels[i].offset < header.poolSize;
+        }
+
+        if (ok)
+        {
+            poolData.resize((size_t)header.poolSize);
+            ok = 1 == fread(poolData.data(), poolData.size(), 1, file);
+        }
+        fclose(file);
+
+        if (!ok)
+        {
+            Utility::Printf("Rebuilding the stale bottom level acceleration structure cache %s\n", cacheFileName.c_str());
+            return false;
+        }
+
+        // The pool stays in the acceleration structure state, so the bytes are staged and copied in
+        ByteAddressBuffer stagingBuffer;
+        stagingBuffer.Create(L"Bottom Level Cache Staging Buffer", (UINT)(header.poolSize / 4), 4, poolData.data());
+
+        CreateAccelerationStructureBuffer(header.poolSize, &m_pPoolBuffer);
+        m_descriptorIndex = descriptorHeap.AllocateBufferUav(*m_pPoolBuffer);
+
+        {
+            GraphicsContext& uploadContext = GraphicsContext::Begin(L"Upload Cached Bottom Level Acceleration Structures");
+            uploadContext.TransitionResource(stagingBuffer, D3D12_RESOURCE_STATE_COPY_SOURCE, true);
+            CopyPoolBuffer(uploadContext, m_pPoolBuffer, stagingBuffer.GetResource(), header.poolSize, D3D12_RESOURCE_STATE_COPY_DEST);
+            uploadContext.Finish(true);
+        }
+
+        m_offsets.resize(numBottomLevels);
+        for (UINT i = 0; i < numBottomLevels; i++)
+        {
+            m_offsets[i] = levels[i].offset;
+        }
+
+        Utility::Printf("Loaded %u bottom level acceleration structures, %llu bytes, from %s\n",
+            numBottomLevels, header.poolSize, cacheFileName.c_str());
+        return true;
+    }
+
+    void Save(const std::string &cacheFileName, const CacheHeader &header, const std::vector<CacheLevel> &levels)
+    {
+        ReadbackBuffer poolReadback;
+        poolReadback.Create(L"Bottom Level Cache Readback", (UINT)(header.poolSize / 4), 4);
+
+        {
+            GraphicsContext& readbackContext = GraphicsContext::Begin(L"Read Back Bottom Level Acceleration Structures");
+            CopyPoolBuffer(readbackContext, poolReadback.GetResource(), m_pPoolBuffer, header.poolSize, D3D12_RESOURCE_STATE_COPY_SOURCE);
+            readbackContext.Finish(true);
+        }
+
+        FILE *file = nullptr;
+        if (0 != fopen_s(&file, cacheFileName.c_str(), "wb"))
+        {
+            Utility::Printf("Cannot write the bottom level acceleration structure cache %s\n", cacheFileName.c_str());
+            return;
+        }
+
+        const void *pPoolData = poolReadback.Map();
+        bool ok = 1 == fwrite(&header, sizeof(header), 1, file) &&
+            levels.size() == fwrite(levels.data(), sizeof(CacheLevel), levels.size(), file) &&
+            1 == fwrite(pPoolData, (size_t)header.poolSize, 1, file);
+        poolReadback.Unmap();
+        fclose(file);
+
+        // A partial cache would only be rejected on the next load
+        if (!ok)
+        {
+            remove(cacheFileName.c_str());
+        }
+    }
+
+    // Copies between the pool and a buffer, moving the pool out of the acceleration structure state and back
+    static void CopyPoolBuffer(
+        GraphicsContext& context,
+        ID3D12Resource *pDest,
+        ID3D12Resource *pSrc,
+        UINT64 size,
+        D3D12_RESOURCE_STATES poolCopyState)
+    {
+        ID3D12Resource *pPool = poolCopyState == D3D12_RESOURCE_STATE_COPY_DEST ? pDest : pSrc;
+        const D3D12_RESOURCE_STATES poolState = g_pRaytracingDevice->GetAccelerationStructureResourceState();
+
+        auto toCopy = CD3DX12_RESOURCE_BARRIER::Transition(pPool, poolState, poolCopyState);
+        context.GetCommandList()->ResourceBarrier(1, &toCopy);
+        context.GetCommandList()->CopyBufferRegion(pDest, 0, pSrc, 0, size);
+        auto fromCopy = CD3DX12_RESOURCE_BARRIER::Transition(pPool, poolCopyState, poolState);
+        context.GetCommandList()->ResourceBarrier(1, &fromCopy);
+    }
+
+    static void CreateAccelerationStructureBuffer(UINT64 size, ID3D12Resource **ppResource)
+    {
+        D3D12_HEAP_PROPERTIES defaultHeapDesc = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
+        auto bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(size, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+        ASSERT_SUCCEEDED(g_Device->CreateCommittedResource(
+            &defaultHeapDesc,
+            D3D12_HEAP_FLAG_NONE,
+            &bufferDesc,
+            g_pRaytracingDevice->GetAccelerationStructureResourceState(),
+            nullptr,
+            IID_PPV_ARGS(ppResource)));
+        GpuMemoryTracker::TrackResource(*ppResource, GpuMemoryTracker::kBuffers);
+    }
+
+    static CComPtr<ID3D12RaytracingFallbackCommandList> GetRaytracingCommandList(GraphicsContext& context, DescriptorHeapStack &descriptorHeap)
+    {
+        CComPtr<ID3D12RaytracingFallbackCommandList> pRaytracingCommandList;
+        g_pRaytracingDevice->QueryRaytracingCommandList(context.GetCommandList(), IID_PPV_ARGS(&pRaytracingCommandList));
+
+        ID3D12DescriptorHeap *descriptorHeaps[] = { &descriptorHeap.GetDescriptorHeap() };
+        pRaytracingCommandList->SetDescriptorHeaps(ARRAYSIZE(descriptorHeaps), descriptorHeaps);
+        return pRaytracingCommandList;
+    }
+
+    CComPtr<ID3D12Resource> m_pPoolBuffer;
+    std::vector<UINT64> m_offsets;
+    UINT m_descriptorIndex = 0;
+};
+
+const char BottomLevelAccelerationStructurePool::kCacheMagic[4] = { 'B', 'L', 'A', 'S' };
+
+BottomLevelAccelerationStructurePool g_bvh_bottomLevelAccelerationStructurePool;
+
+// A bottom level for each mesh, so that one mesh changing only touches its own.  Skinned meshes refit theirs in
+// place over each frame's skinned stream.  The top levels are rebuilt every frame from the instances: one over
+// the whole scene, and one for shadow rays from visible points, without the instances that cannot shadow them.
+std::vector<D3D12_RAYTRACING_GEOMETRY_DESC> g_bvh_geometryDescs;
+std::vector<D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS> g_bvh_bottomLevelInputs;
+std::vector<UINT> g_bvh_dynamicBottomLevels;
+std::vector<UINT64> g_bvh_bottomLevelUpdateScratchOffsets;
+ByteAddressBuffer g_bvh_bottomLevelUpdateScratchBuffer;
+
+std::vector<D3D12_RAYTRACING_FALLBACK_INSTANCE_DESC> g_bvh_instanceDescs;
+D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS g_bvh_topLevelInputs;
+ByteAddressBuffer g_bvh_topLevelScratchBuffer;
+UINT64 g_bvh_topLevelScratchSize;
+CComPtr<ID3D12Resource> g_bvh_shadowTopLevelAccelerationStructure;
+WRAPPED_GPU_POINTER g_bvh_shadowTopLevelAccelerationStructurePointer;
+
+void UpdateAccelerationStructures(GraphicsContext& context, const Math::Camera& camera, const Vector3& sunDirection)
+{
+    ScopedTimer _prof(L"Update Acceleration Structures", context);
+
+    const UINT numInstances = (UINT)g_bvh_instanceDescs.size();
+    ShadowInstanceCulling::CullInstances(context.GetComputeContext(), g_bvh_instanceDescs.data(), camera, sunDirection,
+        RaytracedShadows::GetTanSunAngularRadius());
+
+    DynAlloc instances = context.ReserveUploadMemory(sizeof(D3D12_RAYTRACING_FALLBACK_INSTANCE_DESC) * numInstances);
+    memcpy(instances.DataPtr, g_bvh_instanceDescs.data(), sizeof(D3D12_RAYTRACING_FALLBACK_INSTANCE_DESC) * numInstances);
+
+    context.FlushResourceBarriers();
+
+    CComPtr<ID3D12RaytracingFallbackCommandList> pRaytracingCommandList;
+    g_pRaytracingDevice->QueryRaytracingCommandList(context.GetCommandList(), IID_PPV_ARGS(&pRaytracingCommandList));
+
+    ID3D12DescriptorHeap *pDescriptorHeaps[] = { &g_pRaytracingDescriptorHeap->GetDescriptorHeap() };
+    pRaytracingCommandList->SetDescriptorHeaps(ARRAYSIZE(pDescriptorHeaps), pDescriptorHeaps);
+
+    auto uavBarrier = CD3DX12_RESOURCE_BARRIER::UAV(nullptr);
+
+    const UINT numRefits = (UINT)g_bvh_dynamicBottomLevels.size();
+    if (numRefits > 0)
+    {
+        std::vector<D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC> refitDescs(numRefits);
+        for (UINT i = 0; i < numRefits; i++)
+        {
+            const UINT bottomLevel = g_bvh_dynamicBottomLevels[i];
+            refitDescs[i] = {};
+            refitDescs[i].Inputs = g_bvh_bottomLevelInputs[bottomLevel];
+            refitDescs[i].Inputs.Flags |= D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PERFORM_UPDATE;
+            refitDescs[i].SourceAccelerationStructureData = g_bvh_bottomLevelAccelerationStructurePool.GetGpuVirtualAddress(bottomLevel);
+            refitDescs[i].DestAccelerationStructureData = refitDescs[i].SourceAccelerationStructureData;
+            refitDescs[i].ScratchAccelerationStructureData =
+                g_bvh_bottomLevelUpdateScratchBuffer.GetGpuVirtualAddress() + g_bvh_bottomLevelUpdateScratchOffsets[i];
+        }
+        pRaytracingCommandList->BuildRaytracingAccelerationStructures(numRefits, refitDescs.data());
+        context.GetCommandList()->ResourceBarrier(1, &uavBarrier);
+    }
+
+    D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC topLevelDescs[2] = {};
+    topLevelDescs[0].Inputs = g_bvh_topLevelInputs;
+    topLevelDescs[0].Inputs.InstanceDescs = instances.GpuAddress;
+    topLevelDescs[0].DestAccelerationStructureData = g_bvh_topLevelAccelerationStructure->GetGPUVirtualAddress();
+    topLevelDescs[0].ScratchAccelerationStructureData = g_bvh_topLevelScratchBuffer.GetGpuVirtualAddress();
+    topLevelDescs[1].Inputs = g_bvh_topLevelInputs;
+    topLevelDescs[1].Inputs.InstanceDescs = ShadowInstanceCulling::GetCulledInstances().GetGpuVirtualAddress();
+    topLevelDescs[1].DestAccelerationStructureData = g_bvh_shadowTopLevelAccelerationStructure->GetGPUVirtualAddress();
+    topLevelDescs[1].ScratchAccelerationStructureData = g_bvh_topLevelScratchBuffer.GetGpuVirtualAddress() + g_bvh_topLevelScratchSize;
+    pRaytracingCommandList->BuildRaytracingAccelerationStructures(_countof(topLevelDescs), topLevelDescs);
+    context.GetCommandList()->ResourceBarrier(1, &uavBarrier);
+}
+
 StructuredBuffer    g_hitShaderMeshInfoBuffer;
 
 static
@@ -400,15 +895,19 @@ void InitializeSceneInfo(
     //
     // Mesh info
     //
+    // The hit shaders fetch three 16-bit indices per triangle through 32-bit byte addresses
+    ASSERT(model.GetIndexSize() == sizeof(uint16_t), "Convert the model with -index16 for ray tracing");
+
     std::vector<RayTraceMeshInfo>   meshInfoData(model.m_Header.meshCount);
     for (UINT i=0; i < model.m_Header.meshCount; ++i)
     {
-        meshInfoData[i].m_indexOffsetBytes = model.m_pMesh[i].indexDataByteOffset;
-        meshInfoData[i].m_uvAttributeOffsetBytes = model.m_pMesh[i].vertexDataByteOffset + model.m_pMesh[i].attrib[Model::attrib_texcoord0].offset;
-        meshInfoData[i].m_normalAttributeOffsetBytes = model.m_pMesh[i].vertexDataByteOffset + model.m_pMesh[i].attrib[Model::attrib_normal].offset;
-        meshInfoData[i].m_positionAttributeOffsetBytes = model.m_pMesh[i].vertexDataByteOffset + model.m_pMesh[i].attrib[Model::attrib_position].offset;
-        meshInfoData[i].m_tangentAttributeOffsetBytes = model.m_pMesh[i].vertexDataByteOffset + model.m_pMesh[i].attrib[Model::attrib_tangent].offset;
-        meshInfoData[i].m_bitangentAttributeOffsetBytes = model.m_pMesh[i].vertexDataByteOffset + model.m_pMesh[i].attrib[Model::attrib_bitangent].offset;
+        const UINT vertexDataByteOffset = (UINT)model.m_pMesh[i].vertexDataByteOffset;
+        meshInfoData[i].m_indexOffsetBytes = (UINT)model.m_pMesh[i].indexDataByteOffset;
+        meshInfoData[i].m_uvAttributeOffsetBytes = vertexDataByteOffset + model.m_pMesh[i].attrib[Model::attrib_texcoord0].offset;
+        meshInfoData[i].m_normalAttributeOffsetBytes = vertexDataByteOffset + model.m_pMesh[i].attrib[Model::attrib_normal].offset;
+        meshInfoData[i].m_positionAttributeOffsetBytes = vertexDataByteOffset + model.m_pMesh[i].attrib[Model::attrib_position].offset;
+        meshInfoData[i].m_tangentAttributeOffsetBytes = vertexDataByteOffset + model.m_pMesh[i].attrib[Model::attrib_tangent].offset;
+        meshInfoData[i].m_bitangentAttributeOffsetBytes = vertexDataByteOffset + model.m_pMesh[i].attrib[Model::attrib_bitangent].offset;
         meshInfoData[i].m_attributeStrideBytes = model.m_pMesh[i].vertexStride;
         meshInfoData[i].m_materialInstanceId = model.m_pMesh[i].materialIndex;
         ASSERT(meshInfoData[i].m_materialInstanceId < 27);
@@ -424,7 +923,7 @@ void InitializeSceneInfo(
 }
 
 static
-void InitializeViews(const Model& model)
+void InitializeViews(const Model& model, const StructuredBuffer& vertexBuffer)
 {
     D3D12_CPU_DESCRIPTOR_HANDLE uavHandle;
     UINT uavDescriptorIndex;
@@ -432,6 +931,25 @@ void InitializeViews(const Model& model)
     Graphics::g_Device->CopyDescriptorsSimple(1, uavHandle, g_SceneColorBuffer.GetUAV(), D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
     g_OutputUAV = g_pRaytracingDescriptorHeap->GetGpuHandle(uavDescriptorIndex);
 
+    for (UINT i = 0; i < RaytracedShadows::kNumResolutions - 1; i++)
+    {
+        g_pRaytracingDescriptorHeap->AllocateDescriptor(uavHandle, uavDescriptorIndex);
+        Graphics::g_Device->CopyDescriptorsSimple(1, uavHandle, RaytracedShadows::m_TraceBuffer[i].GetUAV(), D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+        g_ShadowTraceUAVs[i] = g_pRaytracingDescriptorHeap->GetGpuHandle(uavDescriptorIndex);
+    }
+
+    g_pRaytracingDescriptorHeap->AllocateDescriptor(uavHandle, uavDescriptorIndex);
+    Graphics::g_Device->CopyDescriptorsSimple(1, uavHandle, RaytracedShadows::m_HybridShadowMask.GetUAV(), D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+    g_HybridShadowMaskUAV = g_pRaytracingDescriptorHeap->GetGpuHandle(uavDescriptorIndex);
+
+    g_pRaytracingDescriptorHeap->AllocateDescriptor(uavHandle, uavDescriptorIndex);
+    Graphics::g_Device->CopyDescriptorsSimple(1, uavHandle, RaytracedAO::m_TraceBuffer.GetUAV(), D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+    g_AmbientOcclusionTraceUAV = g_pRaytracingDescriptorHeap->GetGpuHandle(uavDescriptorIndex);
+
+    g_pRaytracingDescriptorHeap->AllocateDescriptor(uavHandle, uavDescriptorIndex);
+    Graphics::g_Device->CopyDescriptorsSimple(1, uavHandle, ManyLightShadows::m_TraceBuffer.GetUAV(), D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+    g_LightShadowTraceUAV = g_pRaytracingDescriptorHeap->GetGpuHandle(uavDescriptorIndex);
+
     {
         D3D12_CPU_DESCRIPTOR_HANDLE srvHandle;
         UINT srvDescriptorIndex;
@@ -445,6 +963,73 @@ void InitializeViews(const Model& model)
 
     }
 
+    {
+        // Depth, ray list and ray count for the hybrid shadow rays
+        D3D12_CPU_DESCRIPTOR_HANDLE srvHandle;
+        UINT srvDescriptorIndex;
+        g_pRaytracingDescriptorHeap->AllocateDescriptor(srvHandle, srvDescriptorIndex);
+        Graphics::g_Device->CopyDescriptorsSimple(1, srvHandle, g_SceneDepthBuffer.GetDepthSRV(), D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+        g_HybridShadowRaysTable = g_pRaytracingDescriptorHeap->GetGpuHandle(srvDescriptorIndex);
+
+        UINT unused;
+        g_pRaytracingDescriptorHeap->AllocateDescriptor(srvHandle, unused);
+        Graphics::g_Device->CopyDescriptorsSimple(1, srvHandle, RaytracedShadows::m_HybridRayList.GetSRV(), D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+
+        g_pRaytracingDescriptorHeap->AllocateDescriptor(srvHandle, unused);
+        Graphics::g_Device->CopyDescriptorsSimple(1, srvHandle, RaytracedShadows::m_HybridRayList.GetCounterBuffer().GetSRV(), D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+    }
+
+    {
+        // Depth, normals and the resolved hybrid shadow mask for the diffuse pass
+        D3D12_CPU_DESCRIPTOR_HANDLE srvHandle;
+        UINT srvDescriptorIndex;
+        g_pRaytracingDescriptorHeap->AllocateDescriptor(srvHandle, srvDescriptorIndex);
+        Graphics::g_Device->CopyDescriptorsSimple(1, srvHandle, g_SceneDepthBuffer.GetDepthSRV(), D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+        g_HybridShadowMaskTable = g_pRaytracingDescriptorHeap->GetGpuHandle(srvDescriptorIndex);
+
+        UINT unused;
+        g_pRaytracingDescriptorHeap->AllocateDescriptor(srvHandle, unused);
+        Graphics::g_Device->CopyDescriptorsSimple(1, srvHandle, g_SceneNormalBuffer.GetSRV(), D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+
+        g_pRaytracingDescriptorHeap->AllocateDescriptor(srvHandle, unused);
+        Graphics::g_Device->CopyDescriptorsSimple(1, srvHandle, RaytracedShadows::m_HybridShadowMask.GetSRV(), D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+    }
+
+    {
+        // Depth, the picked lights and the light buffer for the local light shadow rays
+        D3D12_CPU_DESCRIPTOR_HANDLE srvHandle;
+        UINT srvDescriptorIndex;
+        g_pRaytracingDescriptorHeap->AllocateDescriptor(srvHandle, srvDescriptorIndex);
+        Graphics::g_Device->CopyDescriptorsSimple(1, srvHandle, g_SceneDepthBuffer.GetDepthSRV(), D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+        g_LightShadowRaysTable = g_pRaytracingDescriptorHeap->GetGpuHandle(srvDescriptorIndex);
+
+        UINT unused;
+        g_pRaytracingDescriptorHeap->AllocateDescriptor(srvHandle, unused);
+        Graphics::g_Device->CopyDescriptorsSimple(1, srvHandle, ManyLightShadows::m_Reservoirs.GetSRV(), D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+
+        g_pRaytracingDescriptorHeap->AllocateDescriptor(srvHandle, unused);
+        Graphics::g_Device->CopyDescriptorsSimple(1, srvHandle, Lighting::m_LightBuffer.GetSRV(), D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+    }
+
+    {
+        // Depth, normals, ray count and ray list for the binned reflection rays
+        D3D12_CPU_DESCRIPTOR_HANDLE srvHandle;
+        UINT srvDescriptorIndex;
+        g_pRaytracingDescriptorHeap->AllocateDescriptor(srvHandle, srvDescriptorIndex);
+        Graphics::g_Device->CopyDescriptorsSimple(1, srvHandle, g_SceneDepthBuffer.GetDepthSRV(), D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+        g_ReflectionRaysTable = g_pRaytracingDescriptorHeap->GetGpuHandle(srvDescriptorIndex);
+
+        UINT unused;
+        g_pRaytracingDescriptorHeap->AllocateDescriptor(srvHandle, unused);
+        Graphics::g_Device->CopyDescriptorsSimple(1, srvHandle, g_SceneNormalBuffer.GetSRV(), D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+
+        g_pRaytracingDescriptorHeap->AllocateDescriptor(srvHandle, unused);
+        Graphics::g_Device->CopyDescriptorsSimple(1, srvHandle, ReflectionRayBinning::m_RayList.GetCounterBuffer().GetSRV(), D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+
+        g_pRaytracingDescriptorHeap->AllocateDescriptor(srvHandle, unused);
+        Graphics::g_Device->CopyDescriptorsSimple(1, srvHandle, ReflectionRayBinning::m_RayList.GetSRV(), D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+    }
+
     {
         D3D12_CPU_DESCRIPTOR_HANDLE srvHandle;
         UINT srvDescriptorIndex;
@@ -456,7 +1041,7 @@ void InitializeViews(const Model& model)
         g_pRaytracingDescriptorHeap->AllocateDescriptor(srvHandle, unused);
         Graphics::g_Device->CopyDescriptorsSimple(1, srvHandle, g_SceneIndices, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
 
-        g_pRaytracingDescriptorHeap->AllocateBufferSrv(*const_cast<ID3D12Resource*>(model.m_VertexBuffer.GetResource()));
+        g_pRaytracingDescriptorHeap->AllocateBufferSrv(*const_cast<ID3D12Resource*>(vertexBuffer.GetResource()));
 
         g_pRaytracingDescriptorHeap->AllocateDescriptor(srvHandle, unused);
         Graphics::g_Device->CopyDescriptorsSimple(1, srvHandle, g_ShadowBuffer.GetSRV(), D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
@@ -537,7 +1122,7 @@ void InitializeRaytracingStateObjects(const Model &model, UINT numMeshes)
 
     D3D12_DESCRIPTOR_RANGE1 srvDescriptorRange = {};
     srvDescriptorRange.BaseShaderRegister = 12;
-    srvDescriptorRange.NumDescriptors = 2;
+    srvDescriptorRange.NumDescriptors = 4;
     srvDescriptorRange.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
     srvDescriptorRange.Flags = D3D12_DESCRIPTOR_RANGE_FLAG_NONE;
 
@@ -670,12 +1255,12 @@ void InitializeRaytracingStateObjects(const Model &model, UINT numMeshes)
     const UINT shaderRecordSizeInBytes = ALIGN(D3D12_RAYTRACING_SHADER_RECORD_BYTE_ALIGNMENT, offsetToMaterialConstants + sizeof(MaterialRootConstant));
     
     std::vector<byte> pHitShaderTable(shaderRecordSizeInBytes * numMeshes);
-    auto GetShaderTable = [=](const Model &model, ID3D12RaytracingFallbackStateObject *pPSO, byte *pShaderTable)
+    auto GetShaderTable = [&](const Model &model, ID3D12RaytracingFallbackStateObject *pPSO) -> const ByteAddressBuffer&
     {
         void *pHitGroupIdentifierData = pPSO->GetShaderIdentifier(hitGroupExportName);
         for (UINT i = 0; i < numMeshes; i++)
         {
-            byte *pShaderRecord = i * shaderRecordSizeInBytes + pShaderTable;
+            byte *pShaderRecord = i * shaderRecordSizeInBytes + pHitShaderTable.data();
             memcpy(pShaderRecord, pHitGroupIdentifierData, shaderIdentifierSize);
 
             UINT materialIndex = model.m_pMesh[i].materialIndex;
@@ -685,21 +1270,30 @@ void InitializeRaytracingStateObjects(const Model &model, UINT numMeshes)
             material.MaterialID = i;
             memcpy(pShaderRecord + offsetToMaterialConstants, &material, sizeof(material));
         }
+        return g_hitShaderTables.GetTable(pHitShaderTable);
+    };
+
+    // The barycentric and shadow hit shaders read no local root arguments, so every geometry shares one record
+    // holding just the identifier.  A stride of 0 sends all hit group indices to it.
+    const UINT sharedShaderRecordSizeInBytes = ALIGN(D3D12_RAYTRACING_SHADER_RECORD_BYTE_ALIGNMENT, shaderIdentifierSize);
+    std::vector<byte> sharedHitShaderTable(sharedShaderRecordSizeInBytes);
+    auto GetSharedShaderTable = [&](ID3D12RaytracingFallbackStateObject *pPSO) -> const ByteAddressBuffer&
+    {
+        memcpy(sharedHitShaderTable.data(), pPSO->GetShaderIdentifier(hitGroupExportName), shaderIdentifierSize);
+        return g_hitShaderTables.GetTable(sharedHitShaderTable);
     };
 
     {
         CComPtr<ID3D12RaytracingFallbackStateObject> pbarycentricPSO;
         g_pRaytracingDevice->CreateStateObject(&stateObject, IID_PPV_ARGS(&pbarycentricPSO));
-        GetShaderTable(model, pbarycentricPSO, pHitShaderTable.data());
-        g_RaytracingInputs[Primarybarycentric] = RaytracingDispatchRayInputs(*g_pRaytracingDevice, pbarycentricPSO, pHitShaderTable.data(), shaderRecordSizeInBytes, (UINT)pHitShaderTable.size(), rayGenShaderExportName, missExportName);
+        g_RaytracingInputs[Primarybarycentric] = RaytracingDispatchRayInputs(*g_pRaytracingDevice, pbarycentricPSO, GetSharedShaderTable(pbarycentricPSO), 0, rayGenShaderExportName, missExportName);
     }
 
     {
         rayGenDxilLibSubobject = CreateDxilLibrary(rayGenShaderExportName, g_pRayGenerationShaderSSRLib, sizeof(g_pRayGenerationShaderSSRLib), rayGenDxilLibDesc, rayGenExportDesc);
         CComPtr<ID3D12RaytracingFallbackStateObject> pReflectionbarycentricPSO;
         g_pRaytracingDevice->CreateStateObject(&stateObject, IID_PPV_ARGS(&pReflectionbarycentricPSO));
-        GetShaderTable(model, pReflectionbarycentricPSO, pHitShaderTable.data());
-        g_RaytracingInputs[Reflectionbarycentric] = RaytracingDispatchRayInputs(*g_pRaytracingDevice, pReflectionbarycentricPSO, pHitShaderTable.data(), shaderRecordSizeInBytes, (UINT)pHitShaderTable.size(), rayGenShaderExportName, missExportName);
+        g_RaytracingInputs[Reflectionbarycentric] = RaytracingDispatchRayInputs(*g_pRaytracingDevice, pReflectionbarycentricPSO, GetSharedShaderTable(pReflectionbarycentricPSO), 0, rayGenShaderExportName, missExportName);
     }
 
     {
@@ -708,8 +1302,31 @@ void InitializeRaytracingStateObjects(const Model &model, UINT numMeshes)
 
         CComPtr<ID3D12RaytracingFallbackStateObject> pShadowsPSO;
         g_pRaytracingDevice->CreateStateObject(&stateObject, IID_PPV_ARGS(&pShadowsPSO));
-        GetShaderTable(model, pShadowsPSO, pHitShaderTable.data());
-        g_RaytracingInputs[Shadows] = RaytracingDispatchRayInputs(*g_pRaytracingDevice, pShadowsPSO, pHitShaderTable.data(), shaderRecordSizeInBytes, (UINT)pHitShaderTable.size(), rayGenShaderExportName, missExportName);
+        g_RaytracingInputs[Shadows] = RaytracingDispatchRayInputs(*g_pRaytracingDevice, pShadowsPSO, GetSharedShaderTable(pShadowsPSO), 0, rayGenShaderExportName, missExportName);
+    }
+
+    {
+        rayGenDxilLibSubobject = CreateDxilLibrary(rayGenShaderExportName, g_pRayGenerationHybridShadowsLib, sizeof(g_pRayGenerationHybridShadowsLib), rayGenDxilLibDesc, rayGenExportDesc);
+
+        CComPtr<ID3D12RaytracingFallbackStateObject> pHybridShadowsPSO;
+        g_pRaytracingDevice->CreateStateObject(&stateObject, IID_PPV_ARGS(&pHybridShadowsPSO));
+        g_RaytracingInputs[HybridShadows] = RaytracingDispatchRayInputs(*g_pRaytracingDevice, pHybridShadowsPSO, GetSharedShaderTable(pHybridShadowsPSO), 0, rayGenShaderExportName, missExportName);
+    }
+
+    {
+        rayGenDxilLibSubobject = CreateDxilLibrary(rayGenShaderExportName, g_pRayGenerationAmbientOcclusionLib, sizeof(g_pRayGenerationAmbientOcclusionLib), rayGenDxilLibDesc, rayGenExportDesc);
+
+        CComPtr<ID3D12RaytracingFallbackStateObject> pAmbientOcclusionPSO;
+        g_pRaytracingDevice->CreateStateObject(&stateObject, IID_PPV_ARGS(&pAmbientOcclusionPSO));
+        g_RaytracingInputs[AmbientOcclusion] = RaytracingDispatchRayInputs(*g_pRaytracingDevice, pAmbientOcclusionPSO, GetSharedShaderTable(pAmbientOcclusionPSO), 0, rayGenShaderExportName, missExportName);
+    }
+
+    {
+        rayGenDxilLibSubobject = CreateDxilLibrary(rayGenShaderExportName, g_pRayGenerationManyLightShadowsLib, sizeof(g_pRayGenerationManyLightShadowsLib), rayGenDxilLibDesc, rayGenExportDesc);
+
+        CComPtr<ID3D12RaytracingFallbackStateObject> pLightShadowsPSO;
+        g_pRaytracingDevice->CreateStateObject(&stateObject, IID_PPV_ARGS(&pLightShadowsPSO));
+        g_RaytracingInputs[LightShadows] = RaytracingDispatchRayInputs(*g_pRaytracingDevice, pLightShadowsPSO, GetSharedShaderTable(pLightShadowsPSO), 0, rayGenShaderExportName, missExportName);
     }
 
     {
@@ -719,8 +1336,7 @@ void InitializeRaytracingStateObjects(const Model &model, UINT numMeshes)
 
         CComPtr<ID3D12RaytracingFallbackStateObject> pDiffusePSO;
         g_pRaytracingDevice->CreateStateObject(&stateObject, IID_PPV_ARGS(&pDiffusePSO));
-        GetShaderTable(model, pDiffusePSO, pHitShaderTable.data());
-        g_RaytracingInputs[DiffuseHitShader] = RaytracingDispatchRayInputs(*g_pRaytracingDevice, pDiffusePSO, pHitShaderTable.data(), shaderRecordSizeInBytes, (UINT)pHitShaderTable.size(), rayGenShaderExportName, missExportName);
+        g_RaytracingInputs[DiffuseHitShader] = RaytracingDispatchRayInputs(*g_pRaytracingDevice, pDiffusePSO, GetShaderTable(model, pDiffusePSO), shaderRecordSizeInBytes, rayGenShaderExportName, missExportName);
     }
 
    {
@@ -730,8 +1346,15 @@ void InitializeRaytracingStateObjects(const Model &model, UINT numMeshes)
 
         CComPtr<ID3D12RaytracingFallbackStateObject> pReflectionPSO;
         g_pRaytracingDevice->CreateStateObject(&stateObject, IID_PPV_ARGS(&pReflectionPSO));
-        GetShaderTable(model, pReflectionPSO, pHitShaderTable.data());
-        g_RaytracingInputs[Reflection] = RaytracingDispatchRayInputs(*g_pRaytracingDevice, pReflectionPSO, pHitShaderTable.data(), shaderRecordSizeInBytes, (UINT)pHitShaderTable.size(), rayGenShaderExportName, missExportName);
+        g_RaytracingInputs[Reflection] = RaytracingDispatchRayInputs(*g_pRaytracingDevice, pReflectionPSO, GetShaderTable(model, pReflectionPSO), shaderRecordSizeInBytes, rayGenShaderExportName, missExportName);
+    }
+
+    {
+        rayGenDxilLibSubobject = CreateDxilLibrary(rayGenShaderExportName, g_pRayGenerationSortedReflectionsLib, sizeof(g_pRayGenerationSortedReflectionsLib), rayGenDxilLibDesc, rayGenExportDesc);
+
+        CComPtr<ID3D12RaytracingFallbackStateObject> pSortedReflectionPSO;
+        g_pRaytracingDevice->CreateStateObject(&stateObject, IID_PPV_ARGS(&pSortedReflectionPSO));
+        g_RaytracingInputs[SortedReflection] = RaytracingDispatchRayInputs(*g_pRaytracingDevice, pSortedReflectionPSO, GetShaderTable(model, pSortedReflectionPSO), shaderRecordSizeInBytes, rayGenShaderExportName, missExportName);
     }
 
    for (auto &raytracingPipelineState : g_RaytracingInputs)
@@ -744,7 +1367,7 @@ void InitializeRaytracingStateObjects(const Model &model, UINT numMeshes)
 
 void D3D12RaytracingMiniEngineSample::Startup( void )
 {
-    D3D12CreateRaytracingFallbackDevice(g_Device, CreateRaytracingFallbackDeviceFlags::None, 0, IID_PPV_ARGS(&g_pRaytracingDevice));
+    D3D12CreateRaytracingFallbackDevice(g_Device, CreateRaytracingFallbackDeviceFlags::EnableShaderCache, 0, IID_PPV_ARGS(&g_pRaytracingDevice));
     g_SceneNormalBuffer.Create(L"Main Normal Buffer", g_SceneColorBuffer.GetWidth(), g_SceneColorBuffer.GetHeight(), 1, DXGI_FORMAT_R16G16B16A16_FLOAT);
 
     g_pRaytracingDescriptorHeap = std::unique_ptr<DescriptorHeapStack>(
@@ -835,13 +1458,20 @@ void D3D12RaytracingMiniEngineSample::Startup( void )
     m_WaveTileCountPSO.Finalize();
 
     Lighting::InitializeResources();
+    RaytracedShadows::InitializeResources();
+    RaytracedAO::InitializeResources();
+    ManyLightShadows::InitializeResources();
+    ReflectionRayBinning::InitializeResources();
+    ScreenSpaceReflections::InitializeResources();
 
     m_ExtraTextures[0] = g_SSAOFullScreen.GetSRV();
     m_ExtraTextures[1] = g_ShadowBuffer.GetSRV();
+    m_ExtraTextures[6] = ManyLightShadows::m_ShadowRatio.GetSRV();
 
 #define ASSET_DIRECTORY "../../../../../MiniEngine/ModelViewer/"
     TextureManager::Initialize(ASSET_DIRECTORY L"Textures/");
-    bool bModelLoadSuccess = m_Model.Load(ASSET_DIRECTORY "Models/sponza.h3d");
+    const char *modelFileName = ASSET_DIRECTORY "Models/sponza.h3d";
+    bool bModelLoadSuccess = m_Model.Load(modelFileName);
     ASSERT(bModelLoadSuccess, "Failed to load model");
     ASSERT(m_Model.m_Header.meshCount > 0, "Model contains no meshes");
 
@@ -875,25 +1505,34 @@ void D3D12RaytracingMiniEngineSample::Startup( void )
     g_hitConstantBuffer.Create(L"Hit Constant Buffer", 1, sizeof(HitShaderConstants));
     g_dynamicConstantBuffer.Create(L"Dynamic Constant Buffer", 1, sizeof(DynamicCB));
 
+    // The acceleration structures are first built over the skinned bind pose
+    m_Skinning.Create(m_Model);
+    const bool skinned = m_Skinning.IsValid();
+    if (skinned)
+    {
+        GraphicsContext& skinContext = GraphicsContext::Begin(L"Skin Bind Pose");
+        m_Skinning.Update(skinContext.GetComputeContext(), ~0u, 0.0f);
+        skinContext.Finish(true);
+    }
+    const StructuredBuffer& vertexBuffer = skinned ? m_Skinning.GetVertexBuffer() : m_Model.m_VertexBuffer;
+
+    // The local light shadow rays read the light buffer
+    Lighting::CreateRandomLights(m_Model.GetBoundingBox().min, m_Model.GetBoundingBox().max);
+
+    m_ExtraTextures[2] = Lighting::m_LightBuffer.GetSRV();
+    m_ExtraTextures[3] = Lighting::m_LightShadowArray.GetSRV();
+    m_ExtraTextures[4] = Lighting::m_LightGrid.GetSRV();
+    m_ExtraTextures[5] = Lighting::m_LightGridBitMask.GetSRV();
+
     InitializeSceneInfo(m_Model);
-    InitializeViews(m_Model);
+    InitializeViews(m_Model, vertexBuffer);
     UINT numMeshes = m_Model.m_Header.meshCount;
 
-    const UINT numBottomLevels = 1;
+    const UINT numBottomLevels = numMeshes;
 
-    D3D12_RAYTRACING_ACCELERATION_STRUCTURE_PREBUILD_INFO topLevelPrebuildInfo;
-    D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC topLevelAccelerationStructureDesc = {};
-    D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS &topLevelInputs = topLevelAccelerationStructureDesc.Inputs;
-    topLevelInputs.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL;
-    topLevelInputs.NumDescs = numBottomLevels;
-    topLevelInputs.Flags = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_TRACE;
-    topLevelInputs.pGeometryDescs = nullptr;
-    topLevelInputs.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
-    g_pRaytracingDevice->GetRaytracingAccelerationStructurePrebuildInfo(&topLevelInputs, &topLevelPrebuildInfo);
-    
     const D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAGS buildFlag = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_TRACE;
-    std::vector<D3D12_RAYTRACING_GEOMETRY_DESC> geometryDescs(m_Model.m_Header.meshCount);
-    UINT64 scratchBufferSizeNeeded = topLevelPrebuildInfo.ScratchDataSizeInBytes;
+    std::vector<D3D12_RAYTRACING_GEOMETRY_DESC> &geometryDescs = g_bvh_geometryDescs;
+    geometryDescs.resize(numMeshes);
     for (UINT i = 0; i < numMeshes; i++)
     {
         auto &mesh = m_Model.m_pMesh[i];
@@ -905,112 +1544,96 @@ void D3D12RaytracingMiniEngineSample::Startup( void )
         D3D12_RAYTRACING_GEOMETRY_TRIANGLES_DESC &trianglesDesc = desc.Triangles;
         trianglesDesc.VertexFormat = DXGI_FORMAT_R32G32B32_FLOAT;
         trianglesDesc.VertexCount = mesh.vertexCount;
-        trianglesDesc.VertexBuffer.StartAddress = m_Model.m_VertexBuffer.GetGpuVirtualAddress() + (mesh.vertexDataByteOffset + mesh.attrib[Model::attrib_position].offset);
+        trianglesDesc.VertexBuffer.StartAddress = vertexBuffer.GetGpuVirtualAddress() + (mesh.vertexDataByteOffset + mesh.attrib[Model::attrib_position].offset);
         trianglesDesc.IndexBuffer = m_Model.m_IndexBuffer.GetGpuVirtualAddress() + mesh.indexDataByteOffset;
         trianglesDesc.VertexBuffer.StrideInBytes = mesh.vertexStride;
         trianglesDesc.IndexCount = mesh.indexCount;
-        trianglesDesc.IndexFormat = DXGI_FORMAT_R16_UINT;
+        trianglesDesc.IndexFormat = m_Model.GetIndexFormat();
         trianglesDesc.Transform3x4 = 0;
     }
 
-    std::vector<UINT64> bottomLevelAccelerationStructureSize(numBottomLevels);
-    std::vector<D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC> bottomLevelAccelerationStructureDescs(numBottomLevels);
+    std::vector<D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS> &bottomLevelInputs = g_bvh_bottomLevelInputs;
+    bottomLevelInputs.resize(numBottomLevels);
     for (UINT i = 0; i < numBottomLevels; i++)
     {
-        D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC &bottomLevelAccelerationStructureDesc = bottomLevelAccelerationStructureDescs[i];
-        D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS &bottomLevelInputs = bottomLevelAccelerationStructureDesc.Inputs;
-        bottomLevelInputs.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL;
-        bottomLevelInputs.NumDescs = numMeshes;
-        bottomLevelInputs.pGeometryDescs = &geometryDescs[i];
-        bottomLevelInputs.Flags = buildFlag;
-        bottomLevelInputs.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
-
-        D3D12_RAYTRACING_ACCELERATION_STRUCTURE_PREBUILD_INFO bottomLevelprebuildInfo;
-        g_pRaytracingDevice->GetRaytracingAccelerationStructurePrebuildInfo(&bottomLevelInputs, &bottomLevelprebuildInfo);
-
-        bottomLevelAccelerationStructureSize[i] = bottomLevelprebuildInfo.ResultDataMaxSizeInBytes;
-        scratchBufferSizeNeeded = std::max(bottomLevelprebuildInfo.ScratchDataSizeInBytes, scratchBufferSizeNeeded);
+        bottomLevelInputs[i].Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL;
+        bottomLevelInputs[i].NumDescs = 1;
+        bottomLevelInputs[i].pGeometryDescs = &geometryDescs[i];
+        bottomLevelInputs[i].Flags = buildFlag | D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_ALLOW_COMPACTION;
+        if (skinned && m_Model.IsMeshSkinned(i))
+        {
+            bottomLevelInputs[i].Flags |= D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_ALLOW_UPDATE;
+            g_bvh_dynamicBottomLevels.push_back(i);
+        }
+        bottomLevelInputs[i].DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
     }
+    g_bvh_bottomLevelAccelerationStructurePool.Build(*g_pRaytracingDescriptorHeap, bottomLevelInputs.data(), numBottomLevels, modelFileName);
 
-    ByteAddressBuffer scratchBuffer;
-    scratchBuffer.Create(L"Acceleration Structure Scratch Buffer", (UINT)scratchBufferSizeNeeded, 1);
-
-    D3D12_HEAP_PROPERTIES defaultHeapDesc = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
-    auto topLevelDesc = CD3DX12_RESOURCE_DESC::Buffer(topLevelPrebuildInfo.ResultDataMaxSizeInBytes, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
-    g_Device->CreateCommittedResource(
-        &defaultHeapDesc,
-        D3D12_HEAP_FLAG_NONE,
-        &topLevelDesc,
-        g_pRaytracingDevice->GetAccelerationStructureResourceState(),
-        nullptr,
-        IID_PPV_ARGS(&g_bvh_topLevelAccelerationStructure));
-
-    topLevelAccelerationStructureDesc.DestAccelerationStructureData = g_bvh_topLevelAccelerationStructure->GetGPUVirtualAddress();
-    topLevelAccelerationStructureDesc.ScratchAccelerationStructureData = scratchBuffer.GetGpuVirtualAddress();
-
-    std::vector<D3D12_RAYTRACING_FALLBACK_INSTANCE_DESC> instanceDescs(numBottomLevels);
-    g_bvh_bottomLevelAccelerationStructures.resize(numBottomLevels);
-    for (UINT i = 0; i < bottomLevelAccelerationStructureDescs.size(); i++)
+    // The skinned bottom levels are refit in one batch, so each needs scratch memory of its own
+    UINT64 updateScratchSize = 0;
+    for (UINT bottomLevel : g_bvh_dynamicBottomLevels)
     {
-        auto &bottomLevelStructure = g_bvh_bottomLevelAccelerationStructures[i];
-
-        auto bottomLevelDesc = CD3DX12_RESOURCE_DESC::Buffer(bottomLevelAccelerationStructureSize[i], D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
-        g_Device->CreateCommittedResource(
-            &defaultHeapDesc,
-            D3D12_HEAP_FLAG_NONE, 
-            &bottomLevelDesc, 
-            g_pRaytracingDevice->GetAccelerationStructureResourceState(),
-            nullptr, 
-            IID_PPV_ARGS(&bottomLevelStructure));
-
-        bottomLevelAccelerationStructureDescs[i].DestAccelerationStructureData = bottomLevelStructure->GetGPUVirtualAddress();
-        bottomLevelAccelerationStructureDescs[i].ScratchAccelerationStructureData = scratchBuffer.GetGpuVirtualAddress();
+        D3D12_RAYTRACING_ACCELERATION_STRUCTURE_PREBUILD_INFO bottomLevelPrebuildInfo;
+        g_pRaytracingDevice->GetRaytracingAccelerationStructurePrebuildInfo(&bottomLevelInputs[bottomLevel], &bottomLevelPrebuildInfo);
+        g_bvh_bottomLevelUpdateScratchOffsets.push_back(updateScratchSize);
+        updateScratchSize += AlignUp(bottomLevelPrebuildInfo.UpdateScratchDataSizeInBytes, D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BYTE_ALIGNMENT);
+    }
+    if (updateScratchSize > 0)
+        g_bvh_bottomLevelUpdateScratchBuffer.Create(L"Bottom Level Update Scratch Buffer", (UINT)updateScratchSize, 1);
 
+    std::vector<D3D12_RAYTRACING_FALLBACK_INSTANCE_DESC> &instanceDescs = g_bvh_instanceDescs;
+    instanceDescs.resize(numBottomLevels);
+    for (UINT i = 0; i < numBottomLevels; i++)
+    {
         D3D12_RAYTRACING_FALLBACK_INSTANCE_DESC &instanceDesc = instanceDescs[i];
-        UINT descriptorIndex = g_pRaytracingDescriptorHeap->AllocateBufferUav(*bottomLevelStructure);
-        
+
         // Identity matrix
         ZeroMemory(instanceDesc.Transform, sizeof(instanceDesc.Transform));
         instanceDesc.Transform[0][0] = 1.0f;
         instanceDesc.Transform[1][1] = 1.0f;
         instanceDesc.Transform[2][2] = 1.0f;
         
-        instanceDesc.AccelerationStructure = g_pRaytracingDevice->GetWrappedPointerSimple(descriptorIndex, g_bvh_bottomLevelAccelerationStructures[i]->GetGPUVirtualAddress());
+        instanceDesc.AccelerationStructure = g_bvh_bottomLevelAccelerationStructurePool.GetWrappedPointer(i);
         instanceDesc.Flags = 0;
-        instanceDesc.InstanceID = 0;
+        instanceDesc.InstanceID = i;
         instanceDesc.InstanceMask = 1;
         instanceDesc.InstanceContributionToHitGroupIndex = i;
     }
 
-    ByteAddressBuffer instanceDataBuffer;
-    instanceDataBuffer.Create(L"Instance Data Buffer", numBottomLevels, sizeof(D3D12_RAYTRACING_FALLBACK_INSTANCE_DESC), instanceDescs.data());
-
-    topLevelInputs.InstanceDescs = instanceDataBuffer.GetGpuVirtualAddress();
+    D3D12_RAYTRACING_ACCELERATION_STRUCTURE_PREBUILD_INFO topLevelPrebuildInfo;
+    D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS &topLevelInputs = g_bvh_topLevelInputs;
+    topLevelInputs = {};
+    topLevelInputs.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL;
+    topLevelInputs.NumDescs = numBottomLevels;
+    topLevelInputs.Flags = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_BUILD;
+    topLevelInputs.pGeometryDescs = nullptr;
     topLevelInputs.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
+    g_pRaytracingDevice->GetRaytracingAccelerationStructurePrebuildInfo(&topLevelInputs, &topLevelPrebuildInfo);
 
-    GraphicsContext& gfxContext = GraphicsContext::Begin(L"Create Acceleration Structure");
-    ID3D12GraphicsCommandList *pCommandList = gfxContext.GetCommandList();
-
-    CComPtr<ID3D12RaytracingFallbackCommandList> pRaytracingCommandList;
-    g_pRaytracingDevice->QueryRaytracingCommandList(pCommandList, IID_PPV_ARGS(&pRaytracingCommandList));
-
-    ID3D12DescriptorHeap *descriptorHeaps[] = { &g_pRaytracingDescriptorHeap->GetDescriptorHeap() };
-    pRaytracingCommandList->SetDescriptorHeaps(ARRAYSIZE(descriptorHeaps), descriptorHeaps);
+    // Both top levels are built back to back each frame, each in its own half of the scratch buffer
+    g_bvh_topLevelScratchSize = AlignUp(topLevelPrebuildInfo.ScratchDataSizeInBytes, D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BYTE_ALIGNMENT);
+    g_bvh_topLevelScratchBuffer.Create(L"Acceleration Structure Scratch Buffer", (UINT)(g_bvh_topLevelScratchSize * 2), 1);
 
-    auto uavBarrier = CD3DX12_RESOURCE_BARRIER::UAV(nullptr);
-    for (UINT i = 0; i < bottomLevelAccelerationStructureDescs.size(); i++)
+    D3D12_HEAP_PROPERTIES defaultHeapDesc = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
+    auto topLevelDesc = CD3DX12_RESOURCE_DESC::Buffer(topLevelPrebuildInfo.ResultDataMaxSizeInBytes, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+    CComPtr<ID3D12Resource>* topLevels[] = { &g_bvh_topLevelAccelerationStructure, &g_bvh_shadowTopLevelAccelerationStructure };
+    WRAPPED_GPU_POINTER* topLevelPointers[] = { &g_bvh_topLevelAccelerationStructurePointer, &g_bvh_shadowTopLevelAccelerationStructurePointer };
+    for (UINT i = 0; i < _countof(topLevels); i++)
     {
-        pRaytracingCommandList->BuildRaytracingAccelerationStructure(&bottomLevelAccelerationStructureDescs[i], 0, nullptr);
-    }
-    pCommandList->ResourceBarrier(1, &uavBarrier);
+        g_Device->CreateCommittedResource(
+            &defaultHeapDesc,
+            D3D12_HEAP_FLAG_NONE,
+            &topLevelDesc,
+            g_pRaytracingDevice->GetAccelerationStructureResourceState(),
+            nullptr,
+            IID_PPV_ARGS(&*topLevels[i]));
 
-    pRaytracingCommandList->BuildRaytracingAccelerationStructure(&topLevelAccelerationStructureDesc, 0, nullptr);
-    
-    g_bvh_topLevelAccelerationStructurePointer = g_pRaytracingDevice->GetWrappedPointerSimple(
-        g_pRaytracingDescriptorHeap->AllocateBufferUav(*g_bvh_topLevelAccelerationStructure),
-        g_bvh_topLevelAccelerationStructure->GetGPUVirtualAddress());
+        *topLevelPointers[i] = g_pRaytracingDevice->GetWrappedPointerSimple(
+            g_pRaytracingDescriptorHeap->AllocateBufferUav(**topLevels[i]),
+            (*topLevels[i])->GetGPUVirtualAddress());
+    }
 
-    gfxContext.Finish(true);
+    ShadowInstanceCulling::InitializeResources(m_Model);
 
     InitializeRaytracingStateObjects(m_Model, numMeshes);
 
@@ -1055,17 +1678,11 @@ void D3D12RaytracingMiniEngineSample::Startup( void )
     PostEffects::EnableHDR = false;//true;
     PostEffects::EnableAdaptation = false;//true;
     SSAO::Enable = true;
-
-    Lighting::CreateRandomLights(m_Model.GetBoundingBox().min, m_Model.GetBoundingBox().max);
-
-    m_ExtraTextures[2] = Lighting::m_LightBuffer.GetSRV();
-    m_ExtraTextures[3] = Lighting::m_LightShadowArray.GetSRV();
-    m_ExtraTextures[4] = Lighting::m_LightGrid.GetSRV();
-    m_ExtraTextures[5] = Lighting::m_LightGridBitMask.GetSRV();
 }
 
 void D3D12RaytracingMiniEngineSample::Cleanup( void )
 {
+    m_Skinning.Destroy();
     m_Model.Clear();
 }
 
@@ -1096,6 +1713,12 @@ void D3D12RaytracingMiniEngineSample::Update( float deltaT )
       rayTracingMode = RTM_DIFFUSE_WITH_SHADOWRAYS;
     else if(GameInput::IsFirstPressed(GameInput::kKey_7))
       rayTracingMode = RTM_REFLECTIONS;
+    else if(GameInput::IsFirstPressed(GameInput::kKey_8))
+      rayTracingMode = RTM_DIFFUSE_WITH_HYBRID_SHADOWS;
+    else if(GameInput::IsFirstPressed(GameInput::kKey_9))
+      rayTracingMode = RTM_AMBIENT_OCCLUSION;
+    else if(GameInput::IsFirstPressed(GameInput::kKey_0))
+      rayTracingMode = RTM_MANY_LIGHT_SHADOWS;
     
     static bool freezeCamera = false;
     
@@ -1128,6 +1751,9 @@ void D3D12RaytracingMiniEngineSample::Update( float deltaT )
     float sinphi = sinf(m_SunInclination * 3.14159f * 0.5f);
     m_SunDirection = Normalize(Vector3( costheta * cosphi, sinphi, sintheta * cosphi ));
 
+    if (EnableAnimation)
+        m_AnimationTime += deltaT * AnimationSpeed;
+
     // We use viewport offsets to jitter sample positions from frame to frame (for TAA.)
     // D3D has a design quirk with fractional offsets such that the implicit scissor
     // region of a viewport is floor(TopLeftXY) and floor(TopLeftXY + WidthHeight), so
@@ -1165,15 +1791,13 @@ void D3D12RaytracingMiniEngineSample::RenderObjects( GraphicsContext& gfxContext
 
     uint32_t materialIdx = 0xFFFFFFFFul;
 
-    uint32_t VertexStride = m_Model.m_VertexStride;
-
     for (uint32_t meshIndex = 0; meshIndex < m_Model.m_Header.meshCount; meshIndex++)
     {
         const Model::Mesh& mesh = m_Model.m_pMesh[meshIndex];
 
         uint32_t indexCount = mesh.indexCount;
-        uint32_t startIndex = mesh.indexDataByteOffset / sizeof(uint16_t);
-        uint32_t baseVertex = mesh.vertexDataByteOffset / VertexStride;
+        uint32_t startIndex = m_Model.GetStartIndex(mesh.indexDataByteOffset);
+        uint32_t baseVertex = m_Model.GetBaseVertex(mesh, false);
 
         if (mesh.materialIndex != materialIdx)
         {
@@ -1242,6 +1866,7 @@ void D3D12RaytracingMiniEngineSample::RenderScene(void)
     const bool skipDiffusePass = 
         rayTracingMode == RTM_DIFFUSE_WITH_SHADOWMAPS ||
         rayTracingMode == RTM_DIFFUSE_WITH_SHADOWRAYS ||
+        rayTracingMode == RTM_DIFFUSE_WITH_HYBRID_SHADOWS ||
         rayTracingMode == RTM_TRAVERSAL;
         
     const bool skipShadowMap = 
@@ -1265,6 +1890,14 @@ void D3D12RaytracingMiniEngineSample::RenderScene(void)
         s_ShowLightCounts = ShowWaveTileCounts;
     }
 
+    {
+        GraphicsContext& updateContext = GraphicsContext::Begin(L"Update Acceleration Structures");
+        if (m_Skinning.IsValid())
+            m_Skinning.Update(updateContext.GetComputeContext(), AnimationClip, m_AnimationTime);
+        UpdateAccelerationStructures(updateContext, m_Camera, m_SunDirection);
+        updateContext.Finish();
+    }
+
     GraphicsContext& gfxContext = GraphicsContext::Begin(L"Scene Render");
 
     ParticleEffects::Update(gfxContext.GetComputeContext(), Graphics::GetFrameTime());
@@ -1282,6 +1915,7 @@ void D3D12RaytracingMiniEngineSample::RenderScene(void)
         uint32_t TileCount[4];
         uint32_t FirstLightIndex[4];
         uint32_t FrameIndexMod2;
+        uint32_t LocalLightMode;
     } psConstants;
 
     psConstants.sunDirection = m_SunDirection;
@@ -1296,13 +1930,17 @@ void D3D12RaytracingMiniEngineSample::RenderScene(void)
     psConstants.FirstLightIndex[1] = Lighting::m_FirstConeShadowedLight;
     psConstants.FrameIndexMod2 = FrameIndex;
 
+    // Only the many-light mode shades the Forward+ lights: 0 leaves them out, 1 shadows them with their shadow
+    // maps and 2 with the ray traced shadow ratio
+    psConstants.LocalLightMode = rayTracingMode != RTM_MANY_LIGHT_SHADOWS ? 0 : ManyLightShadows::IsRayTraced() ? 2 : 1;
+
     // Set the default state for command lists
     auto& pfnSetupGraphicsState = [&](void)
     {
         gfxContext.SetRootSignature(m_RootSig);
         gfxContext.SetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
         gfxContext.SetIndexBuffer(m_Model.m_IndexBuffer.IndexBufferView());
-        gfxContext.SetVertexBuffer(0, m_Model.m_VertexBuffer.VertexBufferView());
+        gfxContext.SetVertexBuffer(0, (m_Skinning.IsValid() ? m_Skinning.GetVertexBuffer() : m_Model.m_VertexBuffer).VertexBufferView());
     };
 
     pfnSetupGraphicsState();
@@ -1338,12 +1976,28 @@ void D3D12RaytracingMiniEngineSample::RenderScene(void)
         }
     }
 
-    SSAO::Render(gfxContext, m_Camera);
+    if (rayTracingMode == RTM_AMBIENT_OCCLUSION)
+    {
+        // Ray traced AO takes the place of SSAO, which then only linearizes depth
+        const bool EnableSSAO = SSAO::Enable;
+        SSAO::Enable = false;
+        SSAO::Render(gfxContext, m_Camera);
+        SSAO::Enable = EnableSSAO;
+
+        RaytraceAmbientOcclusion(gfxContext, m_Camera, g_SceneDepthBuffer);
+    }
+    else
+    {
+        SSAO::Render(gfxContext, m_Camera);
+    }
 
     if (!skipDiffusePass)
     {
         Lighting::FillLightGrid(gfxContext, m_Camera);
 
+        if (psConstants.LocalLightMode == 2)
+            RaytraceLightShadows(gfxContext, m_Camera, g_SceneDepthBuffer);
+
         if (!SSAO::DebugDraw)
         {
             ScopedTimer _prof(L"Main Render", gfxContext);
@@ -1393,6 +2047,9 @@ void D3D12RaytracingMiniEngineSample::RenderScene(void)
                 ScopedTimer _prof(L"Render Color", gfxContext);
 
                 gfxContext.TransitionResource(g_SSAOFullScreen, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+                gfxContext.TransitionResource(ManyLightShadows::m_ShadowRatio, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+                gfxContext.TransitionResource(Lighting::m_LightBuffer, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+                gfxContext.TransitionResource(Lighting::m_LightGrid, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
 
                 gfxContext.SetDynamicDescriptors(3, 0, ARRAYSIZE(m_ExtraTextures), m_ExtraTextures);
                 gfxContext.SetDynamicConstantBufferView(1, sizeof(psConstants), &psConstants);
@@ -1547,6 +2204,12 @@ void D3D12RaytracingMiniEngineSample::RaytraceShadows(
 {
     ScopedTimer _p0(L"Raytracing Shadows", context);
 
+    // At reduced resolution the rays land in a smaller target and are resolved into the color buffer afterwards
+    const uint32_t rayScale = RaytracedShadows::GetRayScale();
+    const bool reducedResolution = rayScale > 1;
+    ColorBuffer& rayTarget = reducedResolution ? RaytracedShadows::GetTraceBuffer() : colorTarget;
+    D3D12_GPU_DESCRIPTOR_HANDLE rayTargetUAV = reducedResolution ? g_ShadowTraceUAVs[RaytracedShadows::RayResolution - 1] : g_OutputUAV;
+
     DynamicCB inputs = g_dynamicCb;
     auto m0 = camera.GetViewProjMatrix();
     auto m1 = Transpose(Invert(m0));
@@ -1554,6 +2217,9 @@ void D3D12RaytracingMiniEngineSample::RaytraceShadows(
     memcpy(&inputs.worldCameraPosition, &camera.GetPosition(), sizeof(inputs.worldCameraPosition));
     inputs.resolution.x = (float)colorTarget.GetWidth();
     inputs.resolution.y = (float)colorTarget.GetHeight();
+    inputs.sunTanAngularRadius = RaytracedShadows::GetTanSunAngularRadius();
+    inputs.frameIndex = (uint32_t)Graphics::GetFrameCount();
+    inputs.shadowRayScale = rayScale;
 
     HitShaderConstants hitShaderConstants = {};
     hitShaderConstants.sunDirection = m_SunDirection;
@@ -1575,7 +2241,7 @@ void D3D12RaytracingMiniEngineSample::RaytraceShadows(
     ctx.TransitionResource(g_hitConstantBuffer, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
     ctx.TransitionResource(depth, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
     ctx.TransitionResource(g_ShadowBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
-    ctx.TransitionResource(colorTarget, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    ctx.TransitionResource(rayTarget, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
     ctx.FlushResourceBarriers();
 
     CComPtr<ID3D12RaytracingFallbackCommandList> pRaytracingCommandList;
@@ -1587,13 +2253,185 @@ void D3D12RaytracingMiniEngineSample::RaytraceShadows(
     pCommandList->SetComputeRootSignature(g_GlobalRaytracingRootSignature);
     pCommandList->SetComputeRootConstantBufferView(1, g_hitConstantBuffer.GetGpuVirtualAddress());
     pCommandList->SetComputeRootConstantBufferView(2, g_dynamicConstantBuffer->GetGPUVirtualAddress());
-    pCommandList->SetComputeRootDescriptorTable(4, g_OutputUAV);
+    pCommandList->SetComputeRootDescriptorTable(4, rayTargetUAV);
     pCommandList->SetComputeRootDescriptorTable(3, g_DepthAndNormalsTable);
-    pRaytracingCommandList->SetTopLevelAccelerationStructure(7, g_bvh_topLevelAccelerationStructurePointer);
+    pRaytracingCommandList->SetTopLevelAccelerationStructure(7, g_bvh_shadowTopLevelAccelerationStructurePointer);
 
-    D3D12_DISPATCH_RAYS_DESC dispatchRaysDesc = g_RaytracingInputs[Shadows].GetDispatchRayDesc(colorTarget.GetWidth(), colorTarget.GetHeight());
+    D3D12_DISPATCH_RAYS_DESC dispatchRaysDesc = g_RaytracingInputs[Shadows].GetDispatchRayDesc(rayTarget.GetWidth(), rayTarget.GetHeight());
     pRaytracingCommandList->SetPipelineState1(g_RaytracingInputs[Shadows].m_pPSO);
     pRaytracingCommandList->DispatchRays(&dispatchRaysDesc);
+
+    if (reducedResolution)
+    {
+        // The compute passes below use the context's own descriptor heap again
+        ctx.SetDescriptorHeap(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, nullptr);
+        RaytracedShadows::Resolve(ctx, g_SceneNormalBuffer, colorTarget);
+    }
+}
+
+void D3D12RaytracingMiniEngineSample::RaytraceHybridShadows(
+    GraphicsContext& context,
+    const Math::Camera& camera,
+    DepthBuffer& depth)
+{
+    ScopedTimer _p0(L"Raytracing Hybrid Shadows", context);
+
+    ComputeContext& ctx = context.GetComputeContext();
+    ID3D12GraphicsCommandList *pCommandList = context.GetCommandList();
+
+    // Resolve the shadow map into the mask and gather the pixels that need a ray
+    RaytracedShadows::ClassifyHybridShadows(ctx, camera, m_SunShadow.GetShadowMatrix(), g_ShadowBuffer);
+
+    DynamicCB inputs = g_dynamicCb;
+    auto m0 = camera.GetViewProjMatrix();
+    auto m1 = Transpose(Invert(m0));
+    memcpy(&inputs.cameraToWorld, &m1, sizeof(inputs.cameraToWorld));
+    memcpy(&inputs.worldCameraPosition, &camera.GetPosition(), sizeof(inputs.worldCameraPosition));
+    inputs.resolution.x = (float)depth.GetWidth();
+    inputs.resolution.y = (float)depth.GetHeight();
+
+    HitShaderConstants hitShaderConstants = {};
+    hitShaderConstants.sunDirection = m_SunDirection;
+    hitShaderConstants.IsReflection = false;
+    hitShaderConstants.UseShadowRays = false;
+    hitShaderConstants.UseShadowMask = false;
+    ctx.WriteBuffer(g_hitConstantBuffer, 0, &hitShaderConstants, sizeof(hitShaderConstants));
+    ctx.WriteBuffer(g_dynamicConstantBuffer, 0, &inputs, sizeof(inputs));
+
+    StructuredBuffer& rayList = RaytracedShadows::m_HybridRayList;
+    ctx.TransitionResource(g_dynamicConstantBuffer, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
+    ctx.TransitionResource(g_hitConstantBuffer, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
+    ctx.TransitionResource(depth, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    ctx.TransitionResource(rayList, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    ctx.TransitionResource(rayList.GetCounterBuffer(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    ctx.TransitionResource(RaytracedShadows::m_HybridShadowMask, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    ctx.FlushResourceBarriers();
+
+    CComPtr<ID3D12RaytracingFallbackCommandList> pRaytracingCommandList;
+    g_pRaytracingDevice->QueryRaytracingCommandList(pCommandList, IID_PPV_ARGS(&pRaytracingCommandList));
+
+    ID3D12DescriptorHeap *pDescriptorHeaps[] = { &g_pRaytracingDescriptorHeap->GetDescriptorHeap() };
+    pRaytracingCommandList->SetDescriptorHeaps(ARRAYSIZE(pDescriptorHeaps), pDescriptorHeaps);
+
+    pCommandList->SetComputeRootSignature(g_GlobalRaytracingRootSignature);
+    pCommandList->SetComputeRootConstantBufferView(1, g_hitConstantBuffer.GetGpuVirtualAddress());
+    pCommandList->SetComputeRootConstantBufferView(2, g_dynamicConstantBuffer.GetGpuVirtualAddress());
+    pCommandList->SetComputeRootDescriptorTable(3, g_HybridShadowRaysTable);
+    pCommandList->SetComputeRootDescriptorTable(4, g_HybridShadowMaskUAV);
+    pRaytracingCommandList->SetTopLevelAccelerationStructure(7, g_bvh_shadowTopLevelAccelerationStructurePointer);
+
+    // There is no indirect DispatchRays, so dispatch the ray budget and let the ray generation shader
+    // skip the threads past the end of the list.
+    D3D12_DISPATCH_RAYS_DESC dispatchRaysDesc = g_RaytracingInputs[HybridShadows].GetDispatchRayDesc(depth.GetWidth(), RaytracedShadows::GetHybridRayRows());
+    pRaytracingCommandList->SetPipelineState1(g_RaytracingInputs[HybridShadows].m_pPSO);
+    pRaytracingCommandList->DispatchRays(&dispatchRaysDesc);
+}
+
+void D3D12RaytracingMiniEngineSample::RaytraceAmbientOcclusion(
+    GraphicsContext& context,
+    const Math::Camera& camera,
+    DepthBuffer& depth)
+{
+    ScopedTimer _p0(L"Raytracing Ambient Occlusion", context);
+
+    DynamicCB inputs = g_dynamicCb;
+    auto m0 = camera.GetViewProjMatrix();
+    auto m1 = Transpose(Invert(m0));
+    memcpy(&inputs.cameraToWorld, &m1, sizeof(inputs.cameraToWorld));
+    memcpy(&inputs.worldCameraPosition, &camera.GetPosition(), sizeof(inputs.worldCameraPosition));
+    inputs.resolution.x = (float)depth.GetWidth();
+    inputs.resolution.y = (float)depth.GetHeight();
+    inputs.frameIndex = (uint32_t)Graphics::GetFrameCount();
+    inputs.aoRayCount = RaytracedAO::GetRaysPerPixel();
+    inputs.aoRayLength = RaytracedAO::GetRayLength();
+
+    ComputeContext& ctx = context.GetComputeContext();
+    ID3D12GraphicsCommandList *pCommandList = context.GetCommandList();
+
+    ctx.WriteBuffer(g_dynamicConstantBuffer, 0, &inputs, sizeof(inputs));
+    ctx.TransitionResource(g_dynamicConstantBuffer, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
+    ctx.TransitionResource(g_hitConstantBuffer, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
+    ctx.TransitionResource(depth, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    ctx.TransitionResource(g_SceneNormalBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    ctx.TransitionResource(RaytracedAO::m_TraceBuffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    ctx.FlushResourceBarriers();
+
+    CComPtr<ID3D12RaytracingFallbackCommandList> pRaytracingCommandList;
+    g_pRaytracingDevice->QueryRaytracingCommandList(pCommandList, IID_PPV_ARGS(&pRaytracingCommandList));
+
+    ID3D12DescriptorHeap *pDescriptorHeaps[] = { &g_pRaytracingDescriptorHeap->GetDescriptorHeap() };
+    pRaytracingCommandList->SetDescriptorHeaps(ARRAYSIZE(pDescriptorHeaps), pDescriptorHeaps);
+
+    // The rays go every way from the surface, so they need the whole scene rather than the shadow top level
+    pCommandList->SetComputeRootSignature(g_GlobalRaytracingRootSignature);
+    pCommandList->SetComputeRootConstantBufferView(1, g_hitConstantBuffer.GetGpuVirtualAddress());
+    pCommandList->SetComputeRootConstantBufferView(2, g_dynamicConstantBuffer.GetGpuVirtualAddress());
+    pCommandList->SetComputeRootDescriptorTable(3, g_DepthAndNormalsTable);
+    pCommandList->SetComputeRootDescriptorTable(4, g_AmbientOcclusionTraceUAV);
+    pRaytracingCommandList->SetTopLevelAccelerationStructure(7, g_bvh_topLevelAccelerationStructurePointer);
+
+    ColorBuffer& rayTarget = RaytracedAO::m_TraceBuffer;
+    D3D12_DISPATCH_RAYS_DESC dispatchRaysDesc = g_RaytracingInputs[AmbientOcclusion].GetDispatchRayDesc(rayTarget.GetWidth(), rayTarget.GetHeight());
+    pRaytracingCommandList->SetPipelineState1(g_RaytracingInputs[AmbientOcclusion].m_pPSO);
+    pRaytracingCommandList->DispatchRays(&dispatchRaysDesc);
+
+    // The compute passes below use the context's own descriptor heap again
+    ctx.SetDescriptorHeap(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, nullptr);
+    RaytracedAO::Resolve(ctx, camera);
+}
+
+void D3D12RaytracingMiniEngineSample::RaytraceLightShadows(
+    GraphicsContext& context,
+    const Math::Camera& camera,
+    DepthBuffer& depth)
+{
+    ScopedTimer _p0(L"Raytracing Light Shadows", context);
+
+    ComputeContext& ctx = context.GetComputeContext();
+    ManyLightShadows::SelectLights(ctx, camera);
+
+    DynamicCB inputs = g_dynamicCb;
+    auto m0 = camera.GetViewProjMatrix();
+    auto m1 = Transpose(Invert(m0));
+    memcpy(&inputs.cameraToWorld, &m1, sizeof(inputs.cameraToWorld));
+    memcpy(&inputs.worldCameraPosition, &camera.GetPosition(), sizeof(inputs.worldCameraPosition));
+    inputs.resolution.x = (float)depth.GetWidth();
+    inputs.resolution.y = (float)depth.GetHeight();
+    inputs.frameIndex = (uint32_t)Graphics::GetFrameCount();
+
+    ID3D12GraphicsCommandList *pCommandList = context.GetCommandList();
+
+    ctx.WriteBuffer(g_dynamicConstantBuffer, 0, &inputs, sizeof(inputs));
+    ctx.TransitionResource(g_dynamicConstantBuffer, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
+    ctx.TransitionResource(g_hitConstantBuffer, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
+    ctx.TransitionResource(depth, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    ctx.TransitionResource(ManyLightShadows::m_Reservoirs, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    ctx.TransitionResource(Lighting::m_LightBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    ctx.TransitionResource(ManyLightShadows::m_TraceBuffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    ctx.FlushResourceBarriers();
+
+    CComPtr<ID3D12RaytracingFallbackCommandList> pRaytracingCommandList;
+    g_pRaytracingDevice->QueryRaytracingCommandList(pCommandList, IID_PPV_ARGS(&pRaytracingCommandList));
+
+    ID3D12DescriptorHeap *pDescriptorHeaps[] = { &g_pRaytracingDescriptorHeap->GetDescriptorHeap() };
+    pRaytracingCommandList->SetDescriptorHeaps(ARRAYSIZE(pDescriptorHeaps), pDescriptorHeaps);
+
+    // The lights sit all around the scene, so the rays need the whole scene rather than the sun's shadow top level
+    pCommandList->SetComputeRootSignature(g_GlobalRaytracingRootSignature);
+    pCommandList->SetComputeRootConstantBufferView(1, g_hitConstantBuffer.GetGpuVirtualAddress());
+    pCommandList->SetComputeRootConstantBufferView(2, g_dynamicConstantBuffer.GetGpuVirtualAddress());
+    pCommandList->SetComputeRootDescriptorTable(3, g_LightShadowRaysTable);
+    pCommandList->SetComputeRootDescriptorTable(4, g_LightShadowTraceUAV);
+    pRaytracingCommandList->SetTopLevelAccelerationStructure(7, g_bvh_topLevelAccelerationStructurePointer);
+
+    ColorBuffer& rayTarget = ManyLightShadows::m_TraceBuffer;
+    D3D12_DISPATCH_RAYS_DESC dispatchRaysDesc = g_RaytracingInputs[LightShadows].GetDispatchRayDesc(rayTarget.GetWidth(), rayTarget.GetHeight());
+    pRaytracingCommandList->SetPipelineState1(g_RaytracingInputs[LightShadows].m_pPSO);
+    pRaytracingCommandList->DispatchRays(&dispatchRaysDesc);
+
+    // The compute passes below use the context's own descriptor heap again
+    ctx.SetDescriptorHeap(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, nullptr);
+    ManyLightShadows::Resolve(ctx, camera);
 }
 
 void D3D12RaytracingMiniEngineSample::RaytraceDiffuse(
@@ -1620,6 +2458,7 @@ void D3D12RaytracingMiniEngineSample::RaytraceDiffuse(
     hitShaderConstants.modelToShadow = Transpose(m_SunShadow.GetShadowMatrix());
     hitShaderConstants.IsReflection = false;
     hitShaderConstants.UseShadowRays = rayTracingMode == RTM_DIFFUSE_WITH_SHADOWRAYS;
+    hitShaderConstants.UseShadowMask = rayTracingMode == RTM_DIFFUSE_WITH_HYBRID_SHADOWS;
     context.WriteBuffer(g_hitConstantBuffer, 0, &hitShaderConstants, sizeof(hitShaderConstants));
     context.WriteBuffer(g_dynamicConstantBuffer, 0, &inputs, sizeof(inputs));
 
@@ -1628,6 +2467,8 @@ void D3D12RaytracingMiniEngineSample::RaytraceDiffuse(
     context.TransitionResource(g_hitConstantBuffer, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
     context.TransitionResource(g_ShadowBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
     context.TransitionResource(colorTarget, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    if (hitShaderConstants.UseShadowMask)
+        context.TransitionResource(RaytracedShadows::m_HybridShadowMask, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
     context.FlushResourceBarriers();
 
     ID3D12GraphicsCommandList * pCommandList = context.GetCommandList();
@@ -1642,6 +2483,8 @@ void D3D12RaytracingMiniEngineSample::RaytraceDiffuse(
     pCommandList->SetComputeRootDescriptorTable(0, g_SceneSrvs);
     pCommandList->SetComputeRootConstantBufferView(1, g_hitConstantBuffer.GetGpuVirtualAddress());
     pCommandList->SetComputeRootConstantBufferView(2, g_dynamicConstantBuffer.GetGpuVirtualAddress());
+    if (hitShaderConstants.UseShadowMask)
+        pCommandList->SetComputeRootDescriptorTable(3, g_HybridShadowMaskTable);
     pCommandList->SetComputeRootDescriptorTable(4, g_OutputUAV);
     pRaytracingCommandList->SetTopLevelAccelerationStructure(7, g_bvh_topLevelAccelerationStructurePointer);
 
@@ -1676,9 +2519,30 @@ void D3D12RaytracingMiniEngineSample::RaytraceReflections(
     hitShaderConstants.modelToShadow = Transpose(m_SunShadow.GetShadowMatrix());
     hitShaderConstants.IsReflection = true;
     hitShaderConstants.UseShadowRays = false;
+    hitShaderConstants.UseReflectionRayList = ReflectionRayBinning::Enable || ScreenSpaceReflections::Enable;
     context.WriteBuffer(g_hitConstantBuffer, 0, &hitShaderConstants, sizeof(hitShaderConstants));
     context.WriteBuffer(g_dynamicConstantBuffer, 0, &inputs, sizeof(inputs));
 
+    StructuredBuffer& rayList = ReflectionRayBinning::m_RayList;
+    if (ScreenSpaceReflections::Enable)
+    {
+        // Resolve what the screen can, and only trace the rays it can't
+        ScreenSpaceReflections::TraceReflections(context.GetComputeContext(), camera, colorTarget, normals, m_Model.GetBoundingBox().min, m_Model.GetBoundingBox().max);
+        if (ReflectionRayBinning::Enable)
+            ReflectionRayBinning::SortReflectionRays(context.GetComputeContext());
+    }
+    else if (ReflectionRayBinning::Enable)
+    {
+        // Generate the rays into a list and sort it, so that rays traced together fetch the same BVH nodes
+        ReflectionRayBinning::BinReflectionRays(context.GetComputeContext(), camera, normals, m_Model.GetBoundingBox().min, m_Model.GetBoundingBox().max);
+    }
+
+    if (hitShaderConstants.UseReflectionRayList)
+    {
+        context.TransitionResource(rayList, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        context.TransitionResource(rayList.GetCounterBuffer(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    }
+
     context.TransitionResource(g_dynamicConstantBuffer, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
     context.TransitionResource(g_SSAOFullScreen, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
     context.TransitionResource(depth, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
@@ -1700,13 +2564,25 @@ void D3D12RaytracingMiniEngineSample::RaytraceReflections(
     pCommandList->SetComputeRootDescriptorTable(0, g_SceneSrvs);
     pCommandList->SetComputeRootConstantBufferView(1, g_hitConstantBuffer.GetGpuVirtualAddress());
     pCommandList->SetComputeRootConstantBufferView(2, g_dynamicConstantBuffer.GetGpuVirtualAddress());
-    pCommandList->SetComputeRootDescriptorTable(3, g_DepthAndNormalsTable);
+    pCommandList->SetComputeRootDescriptorTable(3, hitShaderConstants.UseReflectionRayList ? g_ReflectionRaysTable : g_DepthAndNormalsTable);
     pCommandList->SetComputeRootDescriptorTable(4, g_OutputUAV);
     pRaytracingCommandList->SetTopLevelAccelerationStructure(7, g_bvh_topLevelAccelerationStructurePointer);
 
-    D3D12_DISPATCH_RAYS_DESC dispatchRaysDesc = g_RaytracingInputs[Reflection].GetDispatchRayDesc(colorTarget.GetWidth(), colorTarget.GetHeight());
-    pRaytracingCommandList->SetPipelineState1(g_RaytracingInputs[Reflection].m_pPSO);
-    pRaytracingCommandList->DispatchRays(&dispatchRaysDesc);
+    if (hitShaderConstants.UseReflectionRayList)
+    {
+        // The ray list maps to 8x8 tiles of the dispatch, so both axes are rounded up to whole tiles.  Threads past
+        // the end of the list return without tracing.
+        D3D12_DISPATCH_RAYS_DESC dispatchRaysDesc = g_RaytracingInputs[SortedReflection].GetDispatchRayDesc(
+            Math::AlignUp(colorTarget.GetWidth(), 8), Math::AlignUp(colorTarget.GetHeight(), 8));
+        pRaytracingCommandList->SetPipelineState1(g_RaytracingInputs[SortedReflection].m_pPSO);
+        pRaytracingCommandList->DispatchRays(&dispatchRaysDesc);
+    }
+    else
+    {
+        D3D12_DISPATCH_RAYS_DESC dispatchRaysDesc = g_RaytracingInputs[Reflection].GetDispatchRayDesc(colorTarget.GetWidth(), colorTarget.GetHeight());
+        pRaytracingCommandList->SetPipelineState1(g_RaytracingInputs[Reflection].m_pPSO);
+        pRaytracingCommandList->DispatchRays(&dispatchRaysDesc);
+    }
 }
 
 void D3D12RaytracingMiniEngineSample::RenderUI(class GraphicsContext& gfxContext)
@@ -1754,6 +2630,11 @@ void D3D12RaytracingMiniEngineSample::Raytrace(class GraphicsContext& gfxContext
         RaytraceDiffuse(gfxContext, m_Camera, g_SceneColorBuffer);
         break;
 
+    case RTM_DIFFUSE_WITH_HYBRID_SHADOWS:
+        RaytraceHybridShadows(gfxContext, m_Camera, g_SceneDepthBuffer);
+        RaytraceDiffuse(gfxContext, m_Camera, g_SceneColorBuffer);
+        break;
+
     case RTM_REFLECTIONS:
         RaytraceReflections(gfxContext, m_Camera, g_SceneColorBuffer, g_SceneDepthBuffer, g_SceneNormalBuffer);
         break;
@@ -22,6 +22,11 @@ struct DynamicCB
     float3   worldCameraPosition;
     uint     padding;
     float2   resolution;
+    float    sunTanAngularRadius;   // Spreads shadow rays over the sun's disk; 0 traces hard shadows
+    uint     frameIndex;            // Reseeds the shadow ray jitter every frame
+    uint     shadowRayScale;        // Full resolution pixels covered by one shadow ray along each axis
+    uint     aoRayCount;            // Ambient occlusion rays traced from each half resolution pixel
+    float    aoRayLength;           // Occluders farther than this along an ambient occlusion ray are ignored
 };
 #ifdef HLSL
 #ifndef SINGLE
@@ -41,6 +46,8 @@ cbuffer HitShaderConstants : register(b0)
     float4x4 ModelToShadow;
     uint IsReflection;
     uint UseShadowRays;
+    uint UseShadowMask;     // Read the sun shadow from the hybrid shadow mask
+    uint UseReflectionRayList;  // Rays were traced in the order of the binned reflection ray list
 }
 
 cbuffer b1 : register(b1)
@@ -62,4 +69,38 @@ inline void GenerateCameraRay(uint2 index, out float3 origin, out float3 directi
     origin = g_dynamic.worldCameraPosition;
     direction = normalize(world - origin);
 }
+
+// Binned reflection rays, with the packed pixel (x | y << 16) in x and the binning key in y
+StructuredBuffer<uint2> g_reflectionRayList : register(t15);
+
+// The fallback layer runs rays in 8x8 groups, so consecutive list entries go to 8x8 tiles of the dispatch for
+// the rays of a group to stay together.  The dispatch is a multiple of 8 along both axes.
+inline uint GetReflectionRayIndex()
+{
+    uint2 index = DispatchRaysIndex().xy;
+    uint tileIndex = (index.y / 8) * (DispatchRaysDimensions().x / 8) + index.x / 8;
+    return tileIndex * 64 + (index.y % 8) * 8 + index.x % 8;
+}
+
+// The pixel that the current ray shades
+inline uint2 GetRayPixel()
+{
+    if (UseReflectionRayList)
+    {
+        uint packedPixel = g_reflectionRayList[GetReflectionRayIndex()].x;
+        return uint2(packedPixel & 0xFFFF, packedPixel >> 16);
+    }
+    return DispatchRaysIndex().xy;
+}
+
+// Seeds the per-pixel ray jitter, changing every frame
+uint HashPixel(uint2 pixel, uint frame)
+{
+    uint h = pixel.x * 73856093u ^ pixel.y * 19349663u ^ frame * 83492791u;
+    h = (h ^ 61u) ^ (h >> 16);
+    h *= 9u;
+    h ^= h >> 4;
+    h *= 0x27d4eb2du;
+    return h ^ (h >> 15);
+}
 #endif
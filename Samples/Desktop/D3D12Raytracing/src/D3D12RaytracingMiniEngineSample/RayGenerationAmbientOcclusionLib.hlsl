@@ -0,0 +1,100 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#define HLSL
+#include "ModelViewerRaytracing.h"
+
+Texture2D<float>    depth    : register(t12);
+
+float3 GetWorldPosition(uint2 pixel)
+{
+    float2 screenPos = (pixel + 0.5) / g_dynamic.resolution * 2.0 - 1.0;
+
+    // Invert Y for DirectX-style coordinates
+    screenPos.y = -screenPos.y;
+
+    float sceneDepth = depth.Load(int3(pixel, 0));
+    float4 unprojected = mul(g_dynamic.cameraToWorld, float4(screenPos, sceneDepth, 1));
+    return unprojected.xyz / unprojected.w;
+}
+
+// Of the differences toward the two neighbors along an axis, the one that stays on the same surface
+float3 GetSurfaceTangent(float3 world, float3 before, float3 after)
+{
+    float3 backward = world - before;
+    float3 forward = after - world;
+    return dot(backward, backward) < dot(forward, forward) ? backward : forward;
+}
+
+[shader("raygeneration")]
+void RayGen()
+{
+    uint2 DTid = DispatchRaysIndex().xy;
+
+    // Each ray target texel is traced from the center pixel of the 2x2 block it covers
+    uint2 maxPixel = (uint2)g_dynamic.resolution - 1;
+    uint2 pixel = min(DTid * 2 + 1, maxPixel);
+
+    // Nothing occludes the sky
+    if (depth.Load(int3(pixel, 0)) == 0.0)
+    {
+        g_screenOutput[DTid] = float4(1, 1, 1, 1);
+        return;
+    }
+
+    // The color pass has not written normals yet, so they come from the depth buffer
+    float3 world = GetWorldPosition(pixel);
+    float3 ddxWorld = GetSurfaceTangent(world, GetWorldPosition(pixel - uint2(1, 0)), GetWorldPosition(min(pixel + uint2(1, 0), maxPixel)));
+    float3 ddyWorld = GetSurfaceTangent(world, GetWorldPosition(pixel - uint2(0, 1)), GetWorldPosition(min(pixel + uint2(0, 1), maxPixel)));
+    float3 normal = normalize(cross(ddyWorld, ddxWorld));
+    if (dot(normal, g_dynamic.worldCameraPosition - world) < 0.0)
+        normal = -normal;
+
+    float3 up = abs(normal.y) < 0.99 ? float3(0, 1, 0) : float3(1, 0, 0);
+    float3 T = normalize(cross(up, normal));
+    float3 B = cross(normal, T);
+
+    // Depth precision falls off with distance, and the ray start moves out with it
+    float tMin = 0.1f + 0.001f * length(g_dynamic.worldCameraPosition - world);
+
+    uint rayCount = max(g_dynamic.aoRayCount, 1);
+    uint h = HashPixel(pixel, g_dynamic.frameIndex);
+    float visibility = 0.0;
+
+    for (uint i = 0; i < rayCount; i++)
+    {
+        // Cosine weighted, so the fraction of rays that escape is the ambient occlusion term
+        float2 u = float2(h & 0xFFFF, h >> 16) / 65536.0;
+        h = HashPixel(uint2(h, i), g_dynamic.frameIndex);
+
+        float r = sqrt(u.x);
+        float phi = 6.283185307 * u.y;
+        float3 direction = T * (r * cos(phi)) + B * (r * sin(phi)) + normal * sqrt(1.0 - u.x);
+
+        RayDesc rayDesc = { world,
+            tMin,
+            direction,
+            g_dynamic.aoRayLength };
+        // Occluded unless the miss shader runs, so no closest hit shader is needed
+        RayPayload payload = { true, 0 };
+#if ENABLE_ACCELERATION_STRUCTURE_VISUALIZATION
+        const uint rayFlags = RAY_FLAG_ACCEPT_FIRST_HIT_AND_END_SEARCH;
+#else
+        const uint rayFlags = RAY_FLAG_ACCEPT_FIRST_HIT_AND_END_SEARCH | RAY_FLAG_FORCE_OPAQUE | RAY_FLAG_SKIP_CLOSEST_HIT_SHADER;
+#endif
+        TraceRay(g_accel, rayFlags, ~0,0,1,0, rayDesc, payload);
+
+        if (payload.RayHitT == FLT_MAX)
+            visibility += 1.0;
+    }
+
+    g_screenOutput[DTid] = visibility / rayCount;
+}
@@ -0,0 +1,54 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#define HLSL
+#include "ModelViewerRaytracing.h"
+
+Texture2D<float>        depth           : register(t12);
+StructuredBuffer<uint>  shadowRayList   : register(t13);
+ByteAddressBuffer       shadowRayCount  : register(t14);
+
+// Fires shadow rays only for the pixels that the shadow map classification could not resolve.  The list holds
+// packed pixel coordinates; each ray overwrites the shadow map result in the shadow mask (g_screenOutput).
+[shader("raygeneration")]
+void RayGen()
+{
+    uint rayIndex = DispatchRaysIndex().y * DispatchRaysDimensions().x + DispatchRaysIndex().x;
+    if (rayIndex >= shadowRayCount.Load(0))
+        return;
+
+    uint packedPixel = shadowRayList[rayIndex];
+    uint2 pixel = uint2(packedPixel & 0xFFFF, packedPixel >> 16);
+    float2 xy = pixel + 0.5;
+
+    // Screen position for the ray
+    float2 screenPos = xy / g_dynamic.resolution * 2.0 - 1.0;
+
+    // Invert Y for DirectX-style coordinates
+    screenPos.y = -screenPos.y;
+
+    float sceneDepth = depth.Load(int3(pixel, 0));
+
+    // Unproject into the world position using depth
+    float4 unprojected = mul(g_dynamic.cameraToWorld, float4(screenPos, sceneDepth, 1));
+    float3 world = unprojected.xyz / unprojected.w;
+
+    RayDesc rayDesc = { world,
+        0.1f,
+        SunDirection,
+        FLT_MAX };
+
+    // The miss shader would write to DispatchRaysIndex(), which is not a pixel here. Occluded unless it runs.
+    RayPayload payload = { true, 0 };
+    TraceRay(g_accel, RAY_FLAG_ACCEPT_FIRST_HIT_AND_END_SEARCH | RAY_FLAG_FORCE_OPAQUE | RAY_FLAG_SKIP_CLOSEST_HIT_SHADER, ~0,0,1,0, rayDesc, payload);
+
+    g_screenOutput[pixel] = payload.RayHitT < FLT_MAX ? 0.0 : 1.0;
+}
@@ -0,0 +1,71 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#define HLSL
+#include "ModelViewerRaytracing.h"
+#include "Shaders/LightGrid.hlsli"
+
+Texture2D<float>    depth           : register(t12);
+Texture2D<uint2>    lightReservoirs : register(t13);
+StructuredBuffer<LightData> lightBuffer : register(t14);
+
+float3 GetWorldPosition(uint2 pixel)
+{
+    float2 screenPos = (pixel + 0.5) / g_dynamic.resolution * 2.0 - 1.0;
+
+    // Invert Y for DirectX-style coordinates
+    screenPos.y = -screenPos.y;
+
+    float sceneDepth = depth.Load(int3(pixel, 0));
+    float4 unprojected = mul(g_dynamic.cameraToWorld, float4(screenPos, sceneDepth, 1));
+    return unprojected.xyz / unprojected.w;
+}
+
+[shader("raygeneration")]
+void RayGen()
+{
+    uint2 pixel = DispatchRaysIndex().xy;
+
+    // One past the light picked for the pixel by the resampling passes, 0 when no light reaches it
+    uint light = lightReservoirs[pixel].x & 0xFFFF;
+    if (light == 0 || depth.Load(int3(pixel, 0)) == 0.0)
+    {
+        g_screenOutput[pixel] = float4(1, 1, 1, 1);
+        return;
+    }
+
+    float3 world = GetWorldPosition(pixel);
+    float3 toLight = lightBuffer[light - 1].pos - world;
+    float lightDist = length(toLight);
+
+    // Depth precision falls off with distance, and the ray start moves out with it
+    float tMin = 0.1f + 0.001f * length(g_dynamic.worldCameraPosition - world);
+    if (lightDist <= 2.0 * tMin)
+    {
+        g_screenOutput[pixel] = float4(1, 1, 1, 1);
+        return;
+    }
+
+    RayDesc rayDesc = { world,
+        tMin,
+        toLight / lightDist,
+        lightDist - tMin };
+    // Occluded unless the miss shader runs, so no closest hit shader is needed
+    RayPayload payload = { true, 0 };
+#if ENABLE_ACCELERATION_STRUCTURE_VISUALIZATION
+    const uint rayFlags = RAY_FLAG_ACCEPT_FIRST_HIT_AND_END_SEARCH;
+#else
+    const uint rayFlags = RAY_FLAG_ACCEPT_FIRST_HIT_AND_END_SEARCH | RAY_FLAG_FORCE_OPAQUE | RAY_FLAG_SKIP_CLOSEST_HIT_SHADER;
+#endif
+    TraceRay(g_accel, rayFlags, ~0,0,1,0, rayDesc, payload);
+
+    g_screenOutput[pixel] = payload.RayHitT == FLT_MAX ? 1.0 : 0.0;
+}
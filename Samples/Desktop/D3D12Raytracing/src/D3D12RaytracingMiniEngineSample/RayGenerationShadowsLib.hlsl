@@ -14,11 +14,33 @@
 
 Texture2D<float>    depth    : register(t12);
 
+// Picks a direction inside the cone subtended by the sun so that shadow edges soften with distance from the occluder
+float3 JitterSunDirection(float3 L, uint2 pixel)
+{
+    if (g_dynamic.sunTanAngularRadius == 0.0)
+        return L;
+
+    uint h = HashPixel(pixel, g_dynamic.frameIndex);
+    float2 u = float2(h & 0xFFFF, h >> 16) / 65536.0;
+
+    float3 up = abs(L.y) < 0.99 ? float3(0, 1, 0) : float3(1, 0, 0);
+    float3 T = normalize(cross(up, L));
+    float3 B = cross(L, T);
+
+    float r = sqrt(u.x) * g_dynamic.sunTanAngularRadius;
+    float phi = 6.283185307 * u.y;
+    return normalize(L + (T * cos(phi) + B * sin(phi)) * r);
+}
+
 [shader("raygeneration")]
 void RayGen()
 {
     uint2 DTid = DispatchRaysIndex().xy;
-    float2 xy = DTid.xy + 0.5;
+
+    // At reduced resolution each ray is traced from the center pixel of the block it covers
+    uint scale = max(g_dynamic.shadowRayScale, 1);
+    uint2 pixel = DTid * scale + scale / 2;
+    float2 xy = pixel + 0.5;
 
     // Screen position for the ray
     float2 screenPos = xy / g_dynamic.resolution * 2.0 - 1.0;
@@ -36,18 +58,23 @@ void RayGen()
     float3 world = unprojected.xyz / unprojected.w;
 
     // R
-    float3 direction = SunDirection;
+    float3 direction = JitterSunDirection(SunDirection, pixel);
     float3 origin = world;
 
     RayDesc rayDesc = { origin,
         0.1f,
         direction,
         FLT_MAX };
-    RayPayload payload = { false, FLT_MAX };
+    // Occluded unless the miss shader runs, so no closest hit shader is needed
+    RayPayload payload = { false, 0 };
 #if ENABLE_ACCELERATION_STRUCTURE_VISUALIZATION
+    // Visualization happens in the full traversal
     payload.SkipShading = true;
+    const uint rayFlags = RAY_FLAG_ACCEPT_FIRST_HIT_AND_END_SEARCH;
+#else
+    const uint rayFlags = RAY_FLAG_ACCEPT_FIRST_HIT_AND_END_SEARCH | RAY_FLAG_FORCE_OPAQUE | RAY_FLAG_SKIP_CLOSEST_HIT_SHADER;
 #endif
-    TraceRay(g_accel, RAY_FLAG_ACCEPT_FIRST_HIT_AND_END_SEARCH, ~0,0,1,0, rayDesc, payload);
+    TraceRay(g_accel, rayFlags, ~0,0,1,0, rayDesc, payload);
 
     if (payload.RayHitT < FLT_MAX)
     {
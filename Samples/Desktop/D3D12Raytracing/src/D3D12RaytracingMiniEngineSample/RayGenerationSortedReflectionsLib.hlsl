@@ -0,0 +1,62 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#define HLSL
+#include "ModelViewerRaytracing.h"
+
+Texture2D<float>    depth               : register(t12);
+Texture2D<float4>   normals             : register(t13);
+ByteAddressBuffer   reflectionRayCount  : register(t14);
+
+// Traces the reflection rays in the order of the binned ray list (g_reflectionRayList) instead of in pixel order.
+// The hit shader shades the pixel that the list gives for the ray, through GetRayPixel().
+[shader("raygeneration")]
+void RayGen()
+{
+    if (GetReflectionRayIndex() >= reflectionRayCount.Load(0))
+        return;
+
+    uint2 pixel = GetRayPixel();
+    float2 xy = pixel + 0.5;
+
+    // Screen position for the ray
+    float2 screenPos = xy / g_dynamic.resolution * 2.0 - 1.0;
+
+    // Invert Y for DirectX-style coordinates
+    screenPos.y = -screenPos.y;
+
+    // Only reflective pixels are in the list
+    float sceneDepth = depth.Load(int3(pixel, 0));
+    float3 normal = normals.Load(int3(pixel, 0)).xyz;
+
+    // Unproject into the world position using depth
+    float4 unprojected = mul(g_dynamic.cameraToWorld, float4(screenPos, sceneDepth, 1));
+    float3 world = unprojected.xyz / unprojected.w;
+
+    float3 primaryRayDirection = normalize(g_dynamic.worldCameraPosition - world);
+
+    // R
+    float3 direction = normalize(-primaryRayDirection - 2 * dot(-primaryRayDirection, normal) * normal);
+    float3 origin = world - primaryRayDirection * 0.1f;     // Lift off the surface a bit
+
+    RayDesc rayDesc = { origin,
+        0.0f,
+        direction,
+        FLT_MAX };
+
+    RayPayload payload;
+    payload.SkipShading = false;
+#if ENABLE_ACCELERATION_STRUCTURE_VISUALIZATION
+    payload.SkipShading = true;
+#endif
+    payload.RayHitT = FLT_MAX;
+    TraceRay(g_accel, RAY_FLAG_CULL_BACK_FACING_TRIANGLES, ~0,0,1,0, rayDesc, payload);
+}
@@ -0,0 +1,166 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "RaytracedAO.h"
+#include "PipelineState.h"
+#include "RootSignature.h"
+#include "CommandContext.h"
+#include "BufferManager.h"
+#include "Camera.h"
+#include "GraphicsCore.h"
+#include "GraphicsCommon.h"
+#include "TemporalEffects.h"
+#include "EngineTuning.h"
+
+#include "CompiledShaders/RaytracedAOTemporalCS.h"
+#include "CompiledShaders/RaytracedAOUpsampleCS.h"
+
+using namespace Math;
+using namespace Graphics;
+
+namespace RaytracedAO
+{
+    IntVar RaysPerPixel("Application/Raytracing/Ambient Occlusion/Rays Per Pixel", 1, 1, 2);
+    NumVar RayLength("Application/Raytracing/Ambient Occlusion/Ray Length", 100.0f, 10.0f, 500.0f, 10.0f);
+    NumVar TemporalBlend("Application/Raytracing/Ambient Occlusion/Temporal Blend", 0.9f, 0.0f, 0.98f, 0.02f);
+    NumVar DepthTolerance("Application/Raytracing/Ambient Occlusion/Depth Tolerance", 0.05f, 0.005f, 0.5f, 0.005f);
+
+    RootSignature m_RootSig;
+    ComputePSO m_TemporalCS;
+    ComputePSO m_UpsampleCS;
+
+    ColorBuffer m_TraceBuffer;
+    ColorBuffer m_History[2];
+
+    uint64_t m_HistoryFrame = 0;
+}
+
+void RaytracedAO::InitializeResources( void )
+{
+    m_RootSig.Reset(3, 1);
+    m_RootSig[0].InitAsConstantBuffer(0);
+    m_RootSig[1].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 0, 4);
+    m_RootSig[2].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 0, 1);
+    m_RootSig.InitStaticSampler(0, SamplerLinearClampDesc);
+    m_RootSig.Finalize(L"RaytracedAORS");
+
+    m_TemporalCS.SetRootSignature(m_RootSig);
+    m_TemporalCS.SetComputeShader(g_pRaytracedAOTemporalCS, sizeof(g_pRaytracedAOTemporalCS));
+    m_TemporalCS.Finalize();
+
+    m_UpsampleCS.SetRootSignature(m_RootSig);
+    m_UpsampleCS.SetComputeShader(g_pRaytracedAOUpsampleCS, sizeof(g_pRaytracedAOUpsampleCS));
+    m_UpsampleCS.Finalize();
+
+    const uint32_t TraceWidth = (g_SceneColorBuffer.GetWidth() + 1) / 2;
+    const uint32_t TraceHeight = (g_SceneColorBuffer.GetHeight() + 1) / 2;
+
+    m_TraceBuffer.Create(L"AO Ray Trace", TraceWidth, TraceHeight, 1, DXGI_FORMAT_R8_UNORM);
+    m_History[0].Create(L"AO Ray History 0", TraceWidth, TraceHeight, 1, DXGI_FORMAT_R16_FLOAT);
+    m_History[1].Create(L"AO Ray History 1", TraceWidth, TraceHeight, 1, DXGI_FORMAT_R16_FLOAT);
+}
+
+uint32_t RaytracedAO::GetRaysPerPixel( void )
+{
+    return (uint32_t)RaysPerPixel;
+}
+
+float RaytracedAO::GetRayLength( void )
+{
+    return RayLength;
+}
+
+void RaytracedAO::Resolve( ComputeContext& Context, const Camera& camera )
+{
+    ScopedTimer _prof(L"Resolve AO Rays", Context);
+
+    // Same ping-ponging as the TAA history.  SSAO linearizes this frame's depth into g_LinearDepth[Src].
+    uint32_t Src = TemporalEffects::GetFrameIndexMod2();
+    uint32_t Dst = Src ^ 1;
+    ColorBuffer& LinearDepth = g_LinearDepth[Src];
+    ColorBuffer& PrevLinearDepth = g_LinearDepth[Dst];
+
+    // Drop the history when it was not written last frame
+    const uint64_t Frame = Graphics::GetFrameCount();
+    const bool HistoryValid = m_HistoryFrame + 1 == Frame;
+    m_HistoryFrame = Frame;
+
+    Context.SetRootSignature(m_RootSig);
+
+    {
+        // The same transform as the camera velocity, from full resolution pixels and linear depth
+        const float RcpHalfDimX = 2.0f / LinearDepth.GetWidth();
+        const float RcpHalfDimY = 2.0f / LinearDepth.GetHeight();
+        const float RcpZMagic = camera.GetNearClip() / (camera.GetFarClip() - camera.GetNearClip());
+
+        Matrix4 preMult = Matrix4(
+            Vector4( RcpHalfDimX, 0.0f, 0.0f, 0.0f ),
+            Vector4( 0.0f, -RcpHalfDimY, 0.0f, 0.0f ),
+            Vector4( 0.0f, 0.0f, RcpZMagic, 0.0f ),
+            Vector4( -1.0f, 1.0f, -RcpZMagic, 1.0f )
+        );
+
+        Matrix4 postMult = Matrix4(
+            Vector4( 1.0f / RcpHalfDimX, 0.0f, 0.0f, 0.0f ),
+            Vector4( 0.0f, -1.0f / RcpHalfDimY, 0.0f, 0.0f ),
+            Vector4( 0.0f, 0.0f, 1.0f, 0.0f ),
+            Vector4( 1.0f / RcpHalfDimX, 1.0f / RcpHalfDimY, 0.0f, 1.0f ) );
+
+        __declspec(align(16)) struct
+        {
+            Matrix4 CurToPrevXForm;
+            float RcpTraceDim[2];
+            float RcpBufferDim[2];
+            float TemporalBlend;
+            float DepthTolerance;
+        } csConstants;
+
+        csConstants.CurToPrevXForm = postMult * camera.GetReprojectionMatrix() * preMult;
+        csConstants.RcpTraceDim[0] = 1.0f / m_TraceBuffer.GetWidth();
+        csConstants.RcpTraceDim[1] = 1.0f / m_TraceBuffer.GetHeight();
+        csConstants.RcpBufferDim[0] = 1.0f / LinearDepth.GetWidth();
+        csConstants.RcpBufferDim[1] = 1.0f / LinearDepth.GetHeight();
+        csConstants.TemporalBlend = HistoryValid ? (float)TemporalBlend : 0.0f;
+        csConstants.DepthTolerance = DepthTolerance;
+
+        Context.TransitionResource(m_TraceBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        Context.TransitionResource(m_History[Src], D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        Context.TransitionResource(LinearDepth, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        Context.TransitionResource(PrevLinearDepth, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        Context.TransitionResource(m_History[Dst], D3D12_RESOURCE_STATE_UNORDERED_ACCESS, true);
+
+        D3D12_CPU_DESCRIPTOR_HANDLE SRVs[] = { m_TraceBuffer.GetSRV(), m_History[Src].GetSRV(), LinearDepth.GetSRV(), PrevLinearDepth.GetSRV() };
+
+        Context.SetPipelineState(m_TemporalCS);
+        Context.SetDynamicConstantBufferView(0, sizeof(csConstants), &csConstants);
+        Context.SetDynamicDescriptors(1, 0, _countof(SRVs), SRVs);
+        Context.SetDynamicDescriptor(2, 0, m_History[Dst].GetUAV());
+        Context.Dispatch2D(m_TraceBuffer.GetWidth(), m_TraceBuffer.GetHeight());
+    }
+
+    {
+        __declspec(align(16)) struct
+        {
+            float DepthTolerance;
+        } csConstants;
+
+        csConstants.DepthTolerance = DepthTolerance;
+
+        Context.TransitionResource(m_History[Dst], D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        Context.TransitionResource(g_SSAOFullScreen, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, true);
+
+        D3D12_CPU_DESCRIPTOR_HANDLE SRVs[] = { m_History[Dst].GetSRV(), LinearDepth.GetSRV() };
+
+        Context.SetPipelineState(m_UpsampleCS);
+        Context.SetDynamicConstantBufferView(0, sizeof(csConstants), &csConstants);
+        Context.SetDynamicDescriptors(1, 0, _countof(SRVs), SRVs);
+        Context.SetDynamicDescriptor(2, 0, g_SSAOFullScreen.GetUAV());
+        Context.Dispatch2D(g_SSAOFullScreen.GetWidth(), g_SSAOFullScreen.GetHeight());
+    }
+}
@@ -0,0 +1,38 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#pragma once
+
+#include <cstdint>
+
+class ColorBuffer;
+class ComputeContext;
+namespace Math
+{
+    class Camera;
+}
+
+// Ray traced ambient occlusion in place of SSAO.  A few short rays per half resolution pixel are traced over the
+// hemisphere of the normal reconstructed from depth, accumulated over time and upsampled into g_SSAOFullScreen.
+namespace RaytracedAO
+{
+    // The half resolution ray target
+    extern ColorBuffer m_TraceBuffer;
+
+    void InitializeResources(void);
+
+    std::uint32_t GetRaysPerPixel(void);
+
+    // Maximum distance of the rays in world units
+    float GetRayLength(void);
+
+    // Accumulates the ray target into the history and upsamples it into g_SSAOFullScreen.  Reads this and last
+    // frame's linear depth, so it runs after SSAO has linearized depth.
+    void Resolve(ComputeContext& Context, const Math::Camera& Camera);
+}
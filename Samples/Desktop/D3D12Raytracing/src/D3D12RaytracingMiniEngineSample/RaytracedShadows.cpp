@@ -0,0 +1,247 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "RaytracedShadows.h"
+#include "PipelineState.h"
+#include "RootSignature.h"
+#include "CommandContext.h"
+#include "BufferManager.h"
+#include "ShadowBuffer.h"
+#include "Camera.h"
+#include "GraphicsCore.h"
+#include "GraphicsCommon.h"
+#include "TemporalEffects.h"
+#include "EngineTuning.h"
+#include <cmath>
+
+#include "CompiledShaders/ShadowTemporalCS.h"
+#include "CompiledShaders/ShadowDenoiseCS.h"
+#include "CompiledShaders/HybridShadowClassifyCS.h"
+
+using namespace Math;
+using namespace Graphics;
+
+namespace RaytracedShadows
+{
+    const char* RayResolutionLabels[] = { "Full", "Half", "Quarter" };
+    EnumVar RayResolution("Application/Raytracing/Shadow Rays/Resolution", kFullResolution, kNumResolutions, RayResolutionLabels);
+    NumVar SunAngularRadius("Application/Raytracing/Shadow Rays/Sun Angular Radius", 0.5f, 0.0f, 5.0f, 0.05f);
+    NumVar TemporalBlend("Application/Raytracing/Shadow Rays/Temporal Blend", 0.9f, 0.0f, 0.98f, 0.02f);
+    NumVar DepthTolerance("Application/Raytracing/Shadow Rays/Depth Tolerance", 0.05f, 0.005f, 0.5f, 0.005f);
+    BoolVar EnableDenoiser("Application/Raytracing/Shadow Rays/Denoise", true);
+
+    NumVar HybridRayBudget("Application/Raytracing/Hybrid Shadows/Ray Budget", 0.25f, 0.05f, 1.0f, 0.05f);
+    NumVar HybridPenumbraThreshold("Application/Raytracing/Hybrid Shadows/Penumbra Threshold", 0.02f, 0.0f, 0.5f, 0.01f);
+    NumVar HybridDepthDiscontinuity("Application/Raytracing/Hybrid Shadows/Depth Discontinuity", 0.1f, 0.01f, 1.0f, 0.01f);
+
+    RootSignature m_RootSig;
+    ComputePSO m_TemporalCS;
+    ComputePSO m_DenoiseCS;
+    ComputePSO m_HybridClassifyCS;
+
+    ColorBuffer m_TraceBuffer[kNumResolutions - 1];
+    ColorBuffer m_History[kNumResolutions - 1][2];
+
+    int32_t m_HistoryResolution = kFullResolution;
+    uint64_t m_HistoryFrame = 0;
+
+    ColorBuffer m_HybridShadowMask;
+    StructuredBuffer m_HybridRayList;
+}
+
+void RaytracedShadows::InitializeResources( void )
+{
+    m_RootSig.Reset(3, 2);
+    m_RootSig[0].InitAsConstantBuffer(0);
+    m_RootSig[1].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 0, 5);
+    m_RootSig[2].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 0, 2);
+    m_RootSig.InitStaticSampler(0, SamplerLinearClampDesc);
+    m_RootSig.InitStaticSampler(1, SamplerShadowDesc);
+    m_RootSig.Finalize(L"RaytracedShadowsRS");
+
+    m_TemporalCS.SetRootSignature(m_RootSig);
+    m_TemporalCS.SetComputeShader(g_pShadowTemporalCS, sizeof(g_pShadowTemporalCS));
+    m_TemporalCS.Finalize();
+
+    m_DenoiseCS.SetRootSignature(m_RootSig);
+    m_DenoiseCS.SetComputeShader(g_pShadowDenoiseCS, sizeof(g_pShadowDenoiseCS));
+    m_DenoiseCS.Finalize();
+
+    m_HybridClassifyCS.SetRootSignature(m_RootSig);
+    m_HybridClassifyCS.SetComputeShader(g_pHybridShadowClassifyCS, sizeof(g_pHybridShadowClassifyCS));
+    m_HybridClassifyCS.Finalize();
+
+    const uint32_t Width = g_SceneColorBuffer.GetWidth();
+    const uint32_t Height = g_SceneColorBuffer.GetHeight();
+
+    for (uint32_t i = 0; i < kNumResolutions - 1; ++i)
+    {
+        const uint32_t Scale = 2u << i;
+        const uint32_t TraceWidth = (Width + Scale - 1) / Scale;
+        const uint32_t TraceHeight = (Height + Scale - 1) / Scale;
+
+        m_TraceBuffer[i].Create(L"Shadow Ray Trace", TraceWidth, TraceHeight, 1, DXGI_FORMAT_R8_UNORM);
+        m_History[i][0].Create(L"Shadow Ray History 0", TraceWidth, TraceHeight, 1, DXGI_FORMAT_R16_FLOAT);
+        m_History[i][1].Create(L"Shadow Ray History 1", TraceWidth, TraceHeight, 1, DXGI_FORMAT_R16_FLOAT);
+    }
+
+    // Every pixel can be ambiguous, so the list never overflows
+    m_HybridShadowMask.Create(L"Hybrid Shadow Mask", Width, Height, 1, DXGI_FORMAT_R8_UNORM);
+    m_HybridRayList.Create(L"Hybrid Shadow Ray List", Width * Height, sizeof(uint32_t));
+}
+
+uint32_t RaytracedShadows::GetRayScale( void )
+{
+    return 1u << (int32_t)RayResolution;
+}
+
+float RaytracedShadows::GetTanSunAngularRadius( void )
+{
+    if (RayResolution == kFullResolution)
+        return 0.0f;
+
+    return std::tan(SunAngularRadius * 3.14159265f / 180.0f);
+}
+
+ColorBuffer& RaytracedShadows::GetTraceBuffer( void )
+{
+    ASSERT(RayResolution != kFullResolution, "Full resolution shadow rays are written straight to the color buffer");
+    return m_TraceBuffer[RayResolution - 1];
+}
+
+void RaytracedShadows::Resolve( ComputeContext& Context, ColorBuffer& Normals, ColorBuffer& Output )
+{
+    ScopedTimer _prof(L"Resolve Shadow Rays", Context);
+
+    const int32_t Level = RayResolution - 1;
+    const uint32_t Scale = GetRayScale();
+    ColorBuffer& Trace = m_TraceBuffer[Level];
+
+    // Same ping-ponging as the TAA history.  SSAO linearizes this frame's depth into g_LinearDepth[Src].
+    uint32_t Src = TemporalEffects::GetFrameIndexMod2();
+    uint32_t Dst = Src ^ 1;
+    ColorBuffer& LinearDepth = g_LinearDepth[Src];
+    ColorBuffer& PrevLinearDepth = g_LinearDepth[Dst];
+
+    // Drop the history when it was written at another resolution or not written last frame
+    const uint64_t Frame = Graphics::GetFrameCount();
+    const bool HistoryValid = m_HistoryResolution == RayResolution && m_HistoryFrame + 1 == Frame;
+    m_HistoryResolution = RayResolution;
+    m_HistoryFrame = Frame;
+
+    Context.SetRootSignature(m_RootSig);
+
+    {
+        __declspec(align(16)) struct
+        {
+            float RcpTraceDim[2];
+            float RcpBufferDim[2];
+            uint32_t RayScale;
+            float TemporalBlend;
+            float DepthTolerance;
+        } csConstants;
+
+        csConstants.RcpTraceDim[0] = 1.0f / Trace.GetWidth();
+        csConstants.RcpTraceDim[1] = 1.0f / Trace.GetHeight();
+        csConstants.RcpBufferDim[0] = 1.0f / Output.GetWidth();
+        csConstants.RcpBufferDim[1] = 1.0f / Output.GetHeight();
+        csConstants.RayScale = Scale;
+        csConstants.TemporalBlend = HistoryValid ? (float)TemporalBlend : 0.0f;
+        csConstants.DepthTolerance = DepthTolerance;
+
+        Context.TransitionResource(Trace, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        Context.TransitionResource(m_History[Level][Src], D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        Context.TransitionResource(g_VelocityBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        Context.TransitionResource(LinearDepth, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        Context.TransitionResource(PrevLinearDepth, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        Context.TransitionResource(m_History[Level][Dst], D3D12_RESOURCE_STATE_UNORDERED_ACCESS, true);
+
+        D3D12_CPU_DESCRIPTOR_HANDLE SRVs[] = { Trace.GetSRV(), m_History[Level][Src].GetSRV(), g_VelocityBuffer.GetSRV(),
+            LinearDepth.GetSRV(), PrevLinearDepth.GetSRV() };
+
+        Context.SetPipelineState(m_TemporalCS);
+        Context.SetDynamicConstantBufferView(0, sizeof(csConstants), &csConstants);
+        Context.SetDynamicDescriptors(1, 0, _countof(SRVs), SRVs);
+        Context.SetDynamicDescriptor(2, 0, m_History[Level][Dst].GetUAV());
+        Context.Dispatch2D(Trace.GetWidth(), Trace.GetHeight());
+    }
+
+    {
+        __declspec(align(16)) struct
+        {
+            uint32_t RayScale;
+            int32_t FilterRadius;
+            float RcpSigmaSq;
+            float DepthTolerance;
+        } csConstants;
+
+        // Without the denoiser this is a plain depth-aware upsample of the four nearest rays
+        csConstants.RayScale = Scale;
+        csConstants.FilterRadius = EnableDenoiser ? 3 : 1;
+        csConstants.RcpSigmaSq = EnableDenoiser ? 1.0f / 4.0f : 1.0f;
+        csConstants.DepthTolerance = DepthTolerance;
+
+        Context.TransitionResource(m_History[Level][Dst], D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        Context.TransitionResource(Normals, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        Context.TransitionResource(Output, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, true);
+
+        D3D12_CPU_DESCRIPTOR_HANDLE SRVs[] = { m_History[Level][Dst].GetSRV(), LinearDepth.GetSRV(), Normals.GetSRV() };
+
+        Context.SetPipelineState(m_DenoiseCS);
+        Context.SetDynamicConstantBufferView(0, sizeof(csConstants), &csConstants);
+        Context.SetDynamicDescriptors(1, 0, _countof(SRVs), SRVs);
+        Context.SetDynamicDescriptor(2, 0, Output.GetUAV());
+        Context.Dispatch2D(Output.GetWidth(), Output.GetHeight());
+    }
+}
+
+uint32_t RaytracedShadows::GetHybridRayRows( void )
+{
+    return (uint32_t)std::ceil(g_SceneColorBuffer.GetHeight() * HybridRayBudget);
+}
+
+void RaytracedShadows::ClassifyHybridShadows( ComputeContext& Context, const Camera& camera, const Matrix4& ShadowMatrix, ShadowBuffer& ShadowMap )
+{
+    ScopedTimer _prof(L"Classify Hybrid Shadows", Context);
+
+    __declspec(align(16)) struct
+    {
+        Matrix4 ClipToShadow;
+        float RcpBufferDim[2];
+        float ShadowTexelSize;
+        float DepthDiscontinuity;
+        float PenumbraMin;
+        float PenumbraMax;
+    } csConstants;
+
+    csConstants.ClipToShadow = ShadowMatrix * Invert(camera.GetViewProjMatrix());
+    csConstants.RcpBufferDim[0] = 1.0f / g_SceneDepthBuffer.GetWidth();
+    csConstants.RcpBufferDim[1] = 1.0f / g_SceneDepthBuffer.GetHeight();
+    csConstants.ShadowTexelSize = 1.0f / ShadowMap.GetWidth();
+    csConstants.DepthDiscontinuity = HybridDepthDiscontinuity;
+    csConstants.PenumbraMin = HybridPenumbraThreshold;
+    csConstants.PenumbraMax = 1.0f - HybridPenumbraThreshold;
+
+    Context.SetRootSignature(m_RootSig);
+    Context.SetPipelineState(m_HybridClassifyCS);
+
+    Context.ResetCounter(m_HybridRayList);
+    Context.TransitionResource(g_SceneDepthBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    Context.TransitionResource(ShadowMap, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    Context.TransitionResource(m_HybridShadowMask, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    Context.TransitionResource(m_HybridRayList, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, true);
+
+    D3D12_CPU_DESCRIPTOR_HANDLE SRVs[] = { g_SceneDepthBuffer.GetDepthSRV(), ShadowMap.GetSRV() };
+    D3D12_CPU_DESCRIPTOR_HANDLE UAVs[] = { m_HybridShadowMask.GetUAV(), m_HybridRayList.GetUAV() };
+
+    Context.SetDynamicConstantBufferView(0, sizeof(csConstants), &csConstants);
+    Context.SetDynamicDescriptors(1, 0, _countof(SRVs), SRVs);
+    Context.SetDynamicDescriptors(2, 0, _countof(UAVs), UAVs);
+    Context.Dispatch2D(g_SceneDepthBuffer.GetWidth(), g_SceneDepthBuffer.GetHeight());
+}
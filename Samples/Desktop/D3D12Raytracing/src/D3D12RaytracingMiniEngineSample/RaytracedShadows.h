@@ -0,0 +1,61 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#pragma once
+
+#include <cstdint>
+
+class ColorBuffer;
+class ShadowBuffer;
+class StructuredBuffer;
+class ComputeContext;
+class EnumVar;
+namespace Math
+{
+    class Camera;
+    class Matrix4;
+}
+
+// Reduced resolution ray traced sun shadows.  Rays are jittered across the sun's disk, accumulated over time
+// and then filtered back up to full resolution with an edge-aware blur.
+namespace RaytracedShadows
+{
+    enum { kFullResolution, kHalfResolution, kQuarterResolution, kNumResolutions };
+
+    extern EnumVar RayResolution;
+
+    // Ray targets for the half and quarter resolution modes
+    extern ColorBuffer m_TraceBuffer[kNumResolutions - 1];
+
+    void InitializeResources(void);
+
+    // Full resolution pixels covered by one shadow ray along each axis
+    std::uint32_t GetRayScale(void);
+
+    // Tangent of the sun's angular radius.  Full resolution rays are not accumulated, so they stay hard.
+    float GetTanSunAngularRadius(void);
+
+    // The ray target for the current resolution.  Only valid at reduced resolution.
+    ColorBuffer& GetTraceBuffer(void);
+
+    // Accumulates the current ray target into the history, then denoises and upsamples it into Output.
+    // Normals are the world-space normals written by the color pass.
+    void Resolve(ComputeContext& Context, ColorBuffer& Normals, ColorBuffer& Output);
+
+    // Hybrid shadows resolve the sun shadow from the shadow map and only trace rays where it is ambiguous.
+    // The mask holds the shadow term of every pixel, and the ray list the packed coordinates (x | y << 16)
+    // of the pixels whose shadow rays should overwrite it.
+    extern ColorBuffer m_HybridShadowMask;
+    extern StructuredBuffer m_HybridRayList;
+
+    void ClassifyHybridShadows(ComputeContext& Context, const Math::Camera& Camera, const Math::Matrix4& ShadowMatrix, ShadowBuffer& ShadowMap);
+
+    // Rows of full resolution width to dispatch for the ray list.  List entries past this budget keep their shadow map result.
+    std::uint32_t GetHybridRayRows(void);
+}
@@ -0,0 +1,99 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "ReflectionRayBinning.h"
+#include "PipelineState.h"
+#include "RootSignature.h"
+#include "CommandContext.h"
+#include "BufferManager.h"
+#include "Camera.h"
+#include "GraphicsCore.h"
+#include "RadixSort.h"
+#include "EngineTuning.h"
+
+#include "CompiledShaders/ReflectionRayBinningCS.h"
+
+using namespace Math;
+using namespace Graphics;
+
+namespace ReflectionRayBinning
+{
+    BoolVar Enable("Application/Raytracing/Reflections/Bin Rays", false);
+
+    RootSignature m_RootSig;
+    ComputePSO m_BinningCS;
+
+    StructuredBuffer m_RayList;
+    StructuredBuffer m_ScratchList;
+}
+
+void ReflectionRayBinning::InitializeResources( void )
+{
+    m_RootSig.Reset(3);
+    m_RootSig[0].InitAsConstantBuffer(0);
+    m_RootSig[1].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 0, 2);
+    m_RootSig[2].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 0, 1);
+    m_RootSig.Finalize(L"ReflectionRayBinningRS");
+
+    m_BinningCS.SetRootSignature(m_RootSig);
+    m_BinningCS.SetComputeShader(g_pReflectionRayBinningCS, sizeof(g_pReflectionRayBinningCS));
+    m_BinningCS.Finalize();
+
+    // Every pixel can be reflective, so the list never overflows
+    const uint32_t NumPixels = g_SceneColorBuffer.GetWidth() * g_SceneColorBuffer.GetHeight();
+    ASSERT(NumPixels <= RadixSort::kMaxElements, "Too many pixels to bin the reflection rays");
+
+    m_RayList.Create(L"Reflection Ray List", NumPixels, 2 * sizeof(uint32_t));
+    m_ScratchList.Create(L"Reflection Ray Sort Scratch", NumPixels, 2 * sizeof(uint32_t));
+}
+
+void ReflectionRayBinning::BinReflectionRays( ComputeContext& Context, const Camera& camera, ColorBuffer& Normals,
+    const Vector3& SceneMin, const Vector3& SceneMax )
+{
+    ScopedTimer _prof(L"Bin Reflection Rays", Context);
+
+    __declspec(align(16)) struct
+    {
+        Matrix4 ClipToWorld;
+        Vector3 CameraPosition;
+        Vector3 SceneMin;
+        Vector3 RcpSceneExtent;
+        float RcpBufferDim[2];
+    } csConstants;
+
+    csConstants.ClipToWorld = Invert(camera.GetViewProjMatrix());
+    csConstants.CameraPosition = camera.GetPosition();
+    csConstants.SceneMin = SceneMin;
+    csConstants.RcpSceneExtent = Recip(Max(SceneMax - SceneMin, Vector3(1e-6f)));
+    csConstants.RcpBufferDim[0] = 1.0f / g_SceneDepthBuffer.GetWidth();
+    csConstants.RcpBufferDim[1] = 1.0f / g_SceneDepthBuffer.GetHeight();
+
+    Context.SetRootSignature(m_RootSig);
+    Context.SetPipelineState(m_BinningCS);
+
+    Context.ResetCounter(m_RayList);
+    Context.TransitionResource(g_SceneDepthBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    Context.TransitionResource(Normals, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    Context.TransitionResource(m_RayList, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, true);
+
+    D3D12_CPU_DESCRIPTOR_HANDLE SRVs[] = { g_SceneDepthBuffer.GetDepthSRV(), Normals.GetSRV() };
+
+    Context.SetDynamicConstantBufferView(0, sizeof(csConstants), &csConstants);
+    Context.SetDynamicDescriptors(1, 0, _countof(SRVs), SRVs);
+    Context.SetDynamicDescriptor(2, 0, m_RayList.GetUAV());
+    Context.Dispatch2D(g_SceneDepthBuffer.GetWidth(), g_SceneDepthBuffer.GetHeight());
+
+    SortReflectionRays(Context);
+}
+
+void ReflectionRayBinning::SortReflectionRays( ComputeContext& Context )
+{
+    // The key is in the upper word, with the pixel as its index
+    RadixSort::Sort(Context, m_RayList, m_ScratchList, m_RayList.GetCounterBuffer(), 0, true);
+}
@@ -0,0 +1,40 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#pragma once
+
+class ColorBuffer;
+class StructuredBuffer;
+class ComputeContext;
+class BoolVar;
+namespace Math
+{
+    class Vector3;
+    class Camera;
+}
+
+// Reflection rays are incoherent, so tracing them in pixel order has neighboring rays fetch unrelated BVH nodes.
+// Binning generates the rays into a list first and sorts it by direction octant and then by the Morton code of
+// the ray origins, so the rays traced together start close by and head the same way.
+namespace ReflectionRayBinning
+{
+    extern BoolVar Enable;
+
+    // Packed pixel coordinates (x | y << 16) and binning keys of the reflection rays, sorted by key
+    extern StructuredBuffer m_RayList;
+
+    void InitializeResources(void);
+
+    // Appends the ray of every reflective pixel to the list and sorts it.  Normals are the world-space normals
+    // written by the color pass, with the reflectivity in w.
+    void BinReflectionRays(ComputeContext& Context, const Math::Camera& Camera, ColorBuffer& Normals, const Math::Vector3& SceneMin, const Math::Vector3& SceneMax);
+
+    // Sorts a list that was filled elsewhere, such as by ScreenSpaceReflections
+    void SortReflectionRays(ComputeContext& Context);
+}
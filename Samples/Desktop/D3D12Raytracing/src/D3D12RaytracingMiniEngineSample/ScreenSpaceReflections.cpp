@@ -0,0 +1,146 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "ScreenSpaceReflections.h"
+#include "ReflectionRayBinning.h"
+#include "PipelineState.h"
+#include "RootSignature.h"
+#include "CommandContext.h"
+#include "BufferManager.h"
+#include "Camera.h"
+#include "GraphicsCore.h"
+#include "SinglePassDownsample.h"
+#include "EngineTuning.h"
+#include <algorithm>
+
+#include "CompiledShaders/ScreenSpaceReflectionsCS.h"
+
+using namespace Math;
+using namespace Graphics;
+
+namespace ScreenSpaceReflections
+{
+    BoolVar Enable("Application/Raytracing/Reflections/Screen Space First", true);
+    NumVar Thickness("Application/Raytracing/Reflections/Screen Space Thickness", 0.02f, 0.0f, 0.5f, 0.005f);
+    IntVar MaxSteps("Application/Raytracing/Reflections/Screen Space Steps", 64, 8, 256, 8);
+
+    enum { kMaxLevels = SinglePassDownsample::kMaxMips };
+
+    RootSignature m_RootSig;
+    ComputePSO m_TraceCS;
+
+    ColorBuffer m_HiZBuffer;
+    uint32_t m_HiZLevels = 0;
+    ColorBuffer m_SceneColorCopy;
+}
+
+void ScreenSpaceReflections::InitializeResources( void )
+{
+    m_RootSig.Reset(3);
+    m_RootSig[0].InitAsConstantBuffer(0);
+    m_RootSig[1].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 0, 4);
+    m_RootSig[2].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 0, 2);
+    m_RootSig.Finalize(L"ScreenSpaceReflectionsRS");
+
+    m_TraceCS.SetRootSignature(m_RootSig);
+    m_TraceCS.SetComputeShader(g_pScreenSpaceReflectionsCS, sizeof(g_pScreenSpaceReflectionsCS));
+    m_TraceCS.Finalize();
+
+    // The first mip is half of the depth buffer rounded up to a power of two, so every cell of every level
+    // covers a whole power of two of texels
+    auto NextPowerOfTwo = []( uint32_t x ) { uint32_t p = 1; while (p < x) p *= 2; return p; };
+    const uint32_t HiZWidth = std::max(NextPowerOfTwo((uint32_t)g_SceneDepthBuffer.GetWidth()) / 2, 1u);
+    const uint32_t HiZHeight = std::max(NextPowerOfTwo((uint32_t)g_SceneDepthBuffer.GetHeight()) / 2, 1u);
+    m_HiZLevels = 1;
+    while ((HiZWidth | HiZHeight) >> m_HiZLevels)
+        ++m_HiZLevels;
+    m_HiZLevels = std::min<uint32_t>(m_HiZLevels, kMaxLevels);
+    m_HiZBuffer.Create(L"Reflection Hi-Z Pyramid", HiZWidth, HiZHeight, m_HiZLevels, DXGI_FORMAT_R32_FLOAT);
+
+    m_SceneColorCopy.Create(L"Reflection Scene Color", g_SceneColorBuffer.GetWidth(), g_SceneColorBuffer.GetHeight(), 1,
+        g_SceneColorBuffer.GetFormat());
+}
+
+void ScreenSpaceReflections::TraceReflections( ComputeContext& Context, const Camera& camera, ColorBuffer& ColorTarget,
+    ColorBuffer& Normals, const Vector3& SceneMin, const Vector3& SceneMax )
+{
+    ScopedTimer _prof(L"Screen Space Reflections", Context);
+
+    {
+        ScopedTimer _prof2(L"Build Hi-Z", Context);
+
+        // Every texel holds the nearest depth of the 2x2 texels below it, and reversed depth makes that the
+        // largest.  Texels past the depth buffer read 0, the far plane, which never stops a ray.
+        Context.TransitionResource(g_SceneDepthBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        Context.TransitionResource(m_HiZBuffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, true);
+
+        D3D12_CPU_DESCRIPTOR_HANDLE Levels[kMaxLevels];
+        for (uint32_t Level = 0; Level < m_HiZLevels; ++Level)
+            Levels[Level] = m_HiZBuffer.GetMipUAV(Level);
+
+        SinglePassDownsample::Downsample(Context, SinglePassDownsample::kMaximum, g_SceneDepthBuffer.GetDepthSRV(),
+            m_HiZBuffer.GetWidth() * 2, m_HiZBuffer.GetHeight() * 2, Levels, m_HiZLevels);
+    }
+
+    // Hits read the color of other pixels, so they read it from before any reflection was added
+    Context.TransitionResource(ColorTarget, D3D12_RESOURCE_STATE_COPY_SOURCE);
+    Context.TransitionResource(m_SceneColorCopy, D3D12_RESOURCE_STATE_COPY_DEST);
+    Context.CopySubresource(m_SceneColorCopy, 0, ColorTarget, 0);
+
+    __declspec(align(16)) struct
+    {
+        Matrix4 ViewProj;
+        Matrix4 ClipToWorld;
+        Vector3 CameraPosition;
+        Vector3 SceneMin;
+        Vector3 RcpSceneExtent;
+        float BufferDim[2];
+        float RcpBufferDim[2];
+        float NearClip;
+        float MaxRayLength;
+        float Thickness;
+        uint32_t MaxSteps;
+        uint32_t HiZLevels;
+    } csConstants;
+
+    csConstants.ViewProj = camera.GetViewProjMatrix();
+    csConstants.ClipToWorld = Invert(camera.GetViewProjMatrix());
+    csConstants.CameraPosition = camera.GetPosition();
+    csConstants.SceneMin = SceneMin;
+    csConstants.RcpSceneExtent = Recip(Max(SceneMax - SceneMin, Vector3(1e-6f)));
+    csConstants.BufferDim[0] = (float)ColorTarget.GetWidth();
+    csConstants.BufferDim[1] = (float)ColorTarget.GetHeight();
+    csConstants.RcpBufferDim[0] = 1.0f / ColorTarget.GetWidth();
+    csConstants.RcpBufferDim[1] = 1.0f / ColorTarget.GetHeight();
+    csConstants.NearClip = camera.GetNearClip();
+    csConstants.MaxRayLength = Length(SceneMax - SceneMin);
+    csConstants.Thickness = (float)Thickness;
+    csConstants.MaxSteps = (uint32_t)(int32_t)MaxSteps;
+    csConstants.HiZLevels = m_HiZLevels;
+
+    StructuredBuffer& RayList = ReflectionRayBinning::m_RayList;
+
+    Context.SetRootSignature(m_RootSig);
+    Context.SetPipelineState(m_TraceCS);
+
+    Context.ResetCounter(RayList);
+    Context.TransitionResource(Normals, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    Context.TransitionResource(m_SceneColorCopy, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    Context.TransitionResource(m_HiZBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    Context.TransitionResource(RayList, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    Context.TransitionResource(ColorTarget, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, true);
+
+    D3D12_CPU_DESCRIPTOR_HANDLE SRVs[] = { g_SceneDepthBuffer.GetDepthSRV(), Normals.GetSRV(), m_SceneColorCopy.GetSRV(), m_HiZBuffer.GetSRV() };
+    D3D12_CPU_DESCRIPTOR_HANDLE UAVs[] = { RayList.GetUAV(), ColorTarget.GetUAV() };
+
+    Context.SetDynamicConstantBufferView(0, sizeof(csConstants), &csConstants);
+    Context.SetDynamicDescriptors(1, 0, _countof(SRVs), SRVs);
+    Context.SetDynamicDescriptors(2, 0, _countof(UAVs), UAVs);
+    Context.Dispatch2D(ColorTarget.GetWidth(), ColorTarget.GetHeight());
+}
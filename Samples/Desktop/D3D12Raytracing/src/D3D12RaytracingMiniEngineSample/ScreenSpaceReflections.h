@@ -0,0 +1,34 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#pragma once
+
+class ColorBuffer;
+class ComputeContext;
+class BoolVar;
+namespace Math
+{
+    class Vector3;
+    class Camera;
+}
+
+// Most reflections in an interior land on something that is already on screen.  The reflection rays are first
+// marched through a Hi-Z pyramid of the depth buffer, and only those the screen can't resolve are appended to
+// ReflectionRayBinning::m_RayList for DispatchRays to trace.
+namespace ScreenSpaceReflections
+{
+    extern BoolVar Enable;
+
+    void InitializeResources(void);
+
+    // Adds the reflections found on screen to the color target and fills the reflection ray list with the rest,
+    // unsorted.  Normals are the world-space normals written by the color pass, with the reflectivity in w.
+    void TraceReflections(ComputeContext& Context, const Math::Camera& Camera, ColorBuffer& ColorTarget, ColorBuffer& Normals,
+        const Math::Vector3& SceneMin, const Math::Vector3& SceneMax);
+}
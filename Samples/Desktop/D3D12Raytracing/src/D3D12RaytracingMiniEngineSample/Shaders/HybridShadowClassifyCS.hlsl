@@ -0,0 +1,83 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Resolves the sun shadow from the shadow map for every pixel and appends the pixels where the shadow map cannot
+// be trusted (inside a filtered penumbra, or on a depth discontinuity) to a list of pixels that need shadow rays.
+//
+
+Texture2D<float> SceneDepth : register(t0);
+Texture2D<float> texShadow : register(t1);
+RWTexture2D<float> OutShadowMask : register(u0);
+RWStructuredBuffer<uint> ShadowRayList : register(u1);
+
+SamplerComparisonState shadowSampler : register(s1);
+
+cbuffer CSConstants : register(b0)
+{
+    float4x4 ClipToShadow;
+    float2 RcpBufferDim;
+    float ShadowTexelSize;
+    float DepthDiscontinuity;   // Relative depth difference to a neighbor that marks a silhouette
+    float PenumbraMin;          // Filtered shadow map results strictly between these need a ray
+    float PenumbraMax;
+}
+
+// Same filter as the hit shader so that pixels without rays match the shadow map mode
+float GetFilteredShadow(float3 ShadowCoord)
+{
+    const float Dilation = 2.0;
+    float d1 = Dilation * ShadowTexelSize * 0.125;
+    float d2 = Dilation * ShadowTexelSize * 0.875;
+    float d3 = Dilation * ShadowTexelSize * 0.625;
+    float d4 = Dilation * ShadowTexelSize * 0.375;
+    return (
+        2.0 * texShadow.SampleCmpLevelZero(shadowSampler, ShadowCoord.xy, ShadowCoord.z) +
+        texShadow.SampleCmpLevelZero(shadowSampler, ShadowCoord.xy + float2(-d2, d1), ShadowCoord.z) +
+        texShadow.SampleCmpLevelZero(shadowSampler, ShadowCoord.xy + float2(-d1, -d2), ShadowCoord.z) +
+        texShadow.SampleCmpLevelZero(shadowSampler, ShadowCoord.xy + float2(d2, -d1), ShadowCoord.z) +
+        texShadow.SampleCmpLevelZero(shadowSampler, ShadowCoord.xy + float2(d1, d2), ShadowCoord.z) +
+        texShadow.SampleCmpLevelZero(shadowSampler, ShadowCoord.xy + float2(-d4, d3), ShadowCoord.z) +
+        texShadow.SampleCmpLevelZero(shadowSampler, ShadowCoord.xy + float2(-d3, -d4), ShadowCoord.z) +
+        texShadow.SampleCmpLevelZero(shadowSampler, ShadowCoord.xy + float2(d4, -d3), ShadowCoord.z) +
+        texShadow.SampleCmpLevelZero(shadowSampler, ShadowCoord.xy + float2(d3, d4), ShadowCoord.z)
+        ) / 10.0;
+}
+
+[numthreads(8, 8, 1)]
+void main(uint3 DTid : SV_DispatchThreadID)
+{
+    uint2 BufferDim;
+    SceneDepth.GetDimensions(BufferDim.x, BufferDim.y);
+    if (any(DTid.xy >= BufferDim))
+        return;
+
+    int2 ST = DTid.xy;
+    float Depth = SceneDepth[ST];
+
+    // Nothing to shadow on the far plane
+    if (Depth == 0.0)
+    {
+        OutShadowMask[ST] = 1.0;
+        return;
+    }
+
+    float2 ScreenPos = (ST + 0.5) * RcpBufferDim * float2(2, -2) + float2(-1, 1);
+    float4 ShadowCoord = mul(ClipToShadow, float4(ScreenPos, Depth, 1));
+    float Shadow = GetFilteredShadow(ShadowCoord.xyz / ShadowCoord.w);
+
+    OutShadowMask[ST] = Shadow * Shadow;
+
+    float DepthW = SceneDepth[max(ST - int2(1, 0), 0)];
+    float DepthE = SceneDepth[min(ST + int2(1, 0), int2(BufferDim) - 1)];
+    float DepthN = SceneDepth[max(ST - int2(0, 1), 0)];
+    float DepthS = SceneDepth[min(ST + int2(0, 1), int2(BufferDim) - 1)];
+    float MaxDelta = max(max(abs(DepthW - Depth), abs(DepthE - Depth)), max(abs(DepthN - Depth), abs(DepthS - Depth)));
+
+    if ((Shadow > PenumbraMin && Shadow < PenumbraMax) || MaxDelta > DepthDiscontinuity * Depth)
+        ShadowRayList[ShadowRayList.IncrementCounter()] = ST.x | ST.y << 16;
+}
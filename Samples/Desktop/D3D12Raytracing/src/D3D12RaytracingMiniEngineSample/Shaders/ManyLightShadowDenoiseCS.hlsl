@@ -0,0 +1,53 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Filters the accumulated light visibility into the ratio that scales the local lights of the color pass.  Taps
+// are weighted by distance and linear depth similarity so that the blur does not bleed across geometric edges.
+//
+
+Texture2D<float> InShadow : register(t0);
+Texture2D<float> LinearDepth : register(t1);
+RWTexture2D<float> OutShadow : register(u0);
+
+cbuffer CSConstants : register(b0)
+{
+    int FilterRadius;       // In pixels; 0 copies
+    float RcpSigmaSq;       // Spatial falloff in pixels
+    float DepthTolerance;   // Relative linear depth difference that halves a tap's weight
+}
+
+[numthreads(8, 8, 1)]
+void main(uint3 DTid : SV_DispatchThreadID)
+{
+    uint2 BufferDim;
+    InShadow.GetDimensions(BufferDim.x, BufferDim.y);
+
+    int2 ST = DTid.xy;
+    float Depth = LinearDepth[ST];
+
+    float ShadowSum = 0.0;
+    float WeightSum = 0.0;
+
+    for (int y = -FilterRadius; y <= FilterRadius; ++y)
+    {
+        for (int x = -FilterRadius; x <= FilterRadius; ++x)
+        {
+            int2 TapST = clamp(ST + int2(x, y), 0, int2(BufferDim) - 1);
+            float TapDepth = LinearDepth[TapST];
+
+            float DepthWeight = exp2(-abs(TapDepth - Depth) / (DepthTolerance * Depth + 1e-6));
+            float Weight = exp2(-(x * x + y * y) * RcpSigmaSq) * DepthWeight;
+
+            ShadowSum += InShadow[TapST] * Weight;
+            WeightSum += Weight;
+        }
+    }
+
+    // The center tap always has full weight
+    OutShadow[ST] = ShadowSum / WeightSum;
+}
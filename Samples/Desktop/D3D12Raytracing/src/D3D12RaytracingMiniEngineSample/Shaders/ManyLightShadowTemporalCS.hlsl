@@ -0,0 +1,71 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Accumulates the visibility of each pixel's picked light over time.  Like the ray traced AO, it runs before the
+// velocity buffer is written, so the history is reprojected through the camera motion and rejected where the
+// linear depth it lands on no longer matches.
+//
+
+Texture2D<float> CurShadow : register(t0);
+Texture2D<float> PreShadow : register(t1);
+Texture2D<float> CurDepth : register(t2);
+Texture2D<float> PreDepth : register(t3);
+RWTexture2D<float> OutShadow : register(u0);
+
+SamplerState LinearSampler : register(s0);
+
+cbuffer CSConstants : register(b0)
+{
+    matrix CurToPrevXForm;  // Full resolution pixels and linear depth to last frame's
+    float2 RcpBufferDim;    // 1 / full resolution size
+    float TemporalBlend;    // 0 when the history is invalid
+    float DepthTolerance;   // Relative linear depth error that counts as a disocclusion
+}
+
+[numthreads(8, 8, 1)]
+void main(uint3 DTid : SV_DispatchThreadID)
+{
+    uint2 BufferDim;
+    CurShadow.GetDimensions(BufferDim.x, BufferDim.y);
+
+    int2 ST = DTid.xy;
+    float Current = CurShadow[ST];
+
+    // Each pixel traced a single ray, so the clamp is loose enough to keep soft edges from flickering
+    float MinShadow = Current;
+    float MaxShadow = Current;
+    float MeanShadow = 0.0;
+    [unroll]
+    for (int y = -1; y <= 1; ++y)
+    {
+        [unroll]
+        for (int x = -1; x <= 1; ++x)
+        {
+            float Neighbor = CurShadow[clamp(ST + int2(x, y), 0, int2(BufferDim) - 1)];
+            MinShadow = min(MinShadow, Neighbor);
+            MaxShadow = max(MaxShadow, Neighbor);
+            MeanShadow += Neighbor;
+        }
+    }
+
+    float Depth = CurDepth[ST];
+    float4 PrevHPos = mul(CurToPrevXForm, float4((ST + 0.5) * Depth, 1.0, Depth));
+    float2 HistoryUV = PrevHPos.xy / PrevHPos.w * RcpBufferDim;
+
+    float4 DepthError = abs(PreDepth.Gather(LinearSampler, HistoryUV) - PrevHPos.w);
+    float MinError = min(min(DepthError.x, DepthError.y), min(DepthError.z, DepthError.w));
+
+    float Blend = TemporalBlend;
+    if (MinError > DepthTolerance * PrevHPos.w || any(HistoryUV != saturate(HistoryUV)))
+        Blend = 0.0;
+
+    float History = clamp(PreShadow.SampleLevel(LinearSampler, HistoryUV, 0), MinShadow, MaxShadow);
+
+    // A disoccluded pixel starts from its neighborhood rather than its one ray
+    OutShadow[ST] = Blend > 0.0 ? lerp(Current, History, Blend) : MeanShadow / 9.0;
+}
@@ -0,0 +1,158 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Shared by the light resampling passes of the many-light shadows.  Each pixel keeps a reservoir holding one light
+// of its light grid tile, picked with a probability that follows the light's unshadowed contribution.  The light
+// is stored one past its index in the low 16 bits of x, so that 0 marks an empty reservoir, with the number of
+// candidates it has seen in the high bits and its resampling weight in y.
+//
+
+#include "LightGrid.hlsli"
+
+StructuredBuffer<LightData> LightBuffer : register(t0);
+ByteAddressBuffer LightGrid : register(t1);
+Texture2D<float> SceneDepth : register(t2);
+Texture2D<float> LinearDepth : register(t3);
+Texture2D<uint2> InReservoirs : register(t4);
+Texture2D<float> PrevLinearDepth : register(t5);
+RWTexture2D<uint2> OutReservoirs : register(u0);
+
+cbuffer CSConstants : register(b0)
+{
+    matrix ClipToWorld;
+    matrix CurToPrevXForm;  // Full resolution pixels and linear depth to last frame's
+    float3 ViewerPos;
+    float InvTileDim;
+    float2 RcpBufferDim;
+    uint TileCountX;
+    uint FrameIndex;
+    uint CandidateCount;    // Tile lights drawn per pixel
+    uint MaxHistory;        // Cap on the candidates carried over from last frame; 0 disables temporal reuse
+    uint SpatialCount;      // Neighboring reservoirs merged; 0 disables spatial reuse
+    float SpatialRadius;    // In pixels
+    float DepthTolerance;   // Relative linear depth difference beyond which a reservoir is not reused
+}
+
+struct Reservoir
+{
+    uint Light;         // One past the light index, 0 when empty
+    uint M;             // Candidates seen
+    float WeightSum;
+    float Target;       // Target weight of the picked light at this pixel
+    float W;            // Resampling weight of the picked light
+};
+
+Reservoir EmptyReservoir()
+{
+    Reservoir r;
+    r.Light = 0;
+    r.M = 0;
+    r.WeightSum = 0.0;
+    r.Target = 0.0;
+    r.W = 0.0;
+    return r;
+}
+
+Reservoir UnpackReservoir(uint2 Packed)
+{
+    Reservoir r = EmptyReservoir();
+    r.Light = Packed.x & 0xFFFF;
+    r.M = Packed.x >> 16;
+    r.W = asfloat(Packed.y);
+    return r;
+}
+
+uint2 PackReservoir(Reservoir r)
+{
+    return uint2(r.Light | (min(r.M, 0xFFFF) << 16), asuint(r.W));
+}
+
+void UpdateReservoir(inout Reservoir r, uint Light, float Target, float Weight, float Random)
+{
+    r.WeightSum += Weight;
+    if (Random * r.WeightSum < Weight)
+    {
+        r.Light = Light;
+        r.Target = Target;
+    }
+}
+
+void FinalizeReservoir(inout Reservoir r)
+{
+    r.W = r.Target > 0.0 ? r.WeightSum / (r.M * r.Target) : 0.0;
+    if (r.W == 0.0)
+        r.Light = 0;
+}
+
+uint SeedRandom(uint2 Pixel, uint Frame)
+{
+    uint h = Pixel.x * 73856093u ^ Pixel.y * 19349663u ^ Frame * 83492791u;
+    h = (h ^ 61u) ^ (h >> 16);
+    h *= 9u;
+    h ^= h >> 4;
+    h *= 0x27d4eb2du;
+    return h ^ (h >> 15);
+}
+
+float NextRandom(inout uint State)
+{
+    State = State * 1664525u + 1013904223u;
+    return (State >> 8) * (1.0 / 16777216.0);
+}
+
+// The light's unshadowed diffuse contribution in luminance, with the same falloff as the forward shading
+float GetTargetWeight(LightData Light, float3 WorldPos, float3 Normal)
+{
+    float3 LightDir = Light.pos - WorldPos;
+    float InvLightDist = rsqrt(dot(LightDir, LightDir));
+    LightDir *= InvLightDist;
+
+    float DistanceFalloff = Light.radiusSq * (InvLightDist * InvLightDist);
+    DistanceFalloff = max(0, DistanceFalloff - rsqrt(DistanceFalloff));
+
+    float ConeFalloff = 1.0;
+    if (Light.type != 0)
+        ConeFalloff = saturate((dot(-LightDir, Light.coneDir) - Light.coneAngles.y) * Light.coneAngles.x);
+
+    float Luminance = dot(Light.color, float3(0.2126, 0.7152, 0.0722));
+    return Luminance * DistanceFalloff * ConeFalloff * saturate(dot(Normal, LightDir));
+}
+
+float3 GetWorldPosition(int2 Pixel)
+{
+    float2 ScreenPos = (Pixel + 0.5) * RcpBufferDim * float2(2.0, -2.0) + float2(-1.0, 1.0);
+    float4 Unprojected = mul(ClipToWorld, float4(ScreenPos, SceneDepth[Pixel], 1.0));
+    return Unprojected.xyz / Unprojected.w;
+}
+
+// Of the differences toward the two neighbors along an axis, the one that stays on the same surface
+float3 GetSurfaceTangent(float3 WorldPos, float3 Before, float3 After)
+{
+    float3 Backward = WorldPos - Before;
+    float3 Forward = After - WorldPos;
+    return dot(Backward, Backward) < dot(Forward, Forward) ? Backward : Forward;
+}
+
+int2 GetMaxPixel()
+{
+    uint2 BufferDim;
+    SceneDepth.GetDimensions(BufferDim.x, BufferDim.y);
+    return int2(BufferDim) - 1;
+}
+
+// The color pass has not written normals yet, so they come from the depth buffer
+float3 GetWorldNormal(int2 Pixel, float3 WorldPos)
+{
+    int2 MaxPixel = GetMaxPixel();
+    float3 DdxWorld = GetSurfaceTangent(WorldPos,
+        GetWorldPosition(max(Pixel - int2(1, 0), 0)), GetWorldPosition(min(Pixel + int2(1, 0), MaxPixel)));
+    float3 DdyWorld = GetSurfaceTangent(WorldPos,
+        GetWorldPosition(max(Pixel - int2(0, 1), 0)), GetWorldPosition(min(Pixel + int2(0, 1), MaxPixel)));
+    float3 Normal = normalize(cross(DdyWorld, DdxWorld));
+    return dot(Normal, ViewerPos - WorldPos) < 0.0 ? -Normal : Normal;
+}
@@ -0,0 +1,59 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Merges the reservoirs of a few random neighbors on the same surface into each pixel's, with their lights
+// weighed again at this pixel.  The result is the light that the shadow ray goes to, and next frame's history.
+//
+
+#include "ManyLightShadows.hlsli"
+
+[numthreads(8, 8, 1)]
+void main(uint3 DTid : SV_DispatchThreadID)
+{
+    int2 Pixel = DTid.xy;
+
+    if (SceneDepth[Pixel] == 0.0)
+    {
+        OutReservoirs[Pixel] = 0;
+        return;
+    }
+
+    float3 WorldPos = GetWorldPosition(Pixel);
+    float3 Normal = GetWorldNormal(Pixel, WorldPos);
+    float Depth = LinearDepth[Pixel];
+    uint Random = SeedRandom(Pixel, FrameIndex ^ 0x5bd1e995);
+    int2 MaxPixel = GetMaxPixel();
+
+    Reservoir r = EmptyReservoir();
+
+    for (uint i = 0; i <= SpatialCount; ++i)
+    {
+        // The pixel's own reservoir first
+        int2 TapPixel = Pixel;
+        if (i > 0)
+        {
+            float Radius = SpatialRadius * sqrt(NextRandom(Random));
+            float Angle = 6.283185307 * NextRandom(Random);
+            TapPixel = clamp(Pixel + int2(round(Radius * float2(cos(Angle), sin(Angle)))), 0, MaxPixel);
+
+            if (abs(LinearDepth[TapPixel] - Depth) > DepthTolerance * Depth)
+                continue;
+        }
+
+        Reservoir Tap = UnpackReservoir(InReservoirs[TapPixel]);
+        if (Tap.Light != 0)
+        {
+            float Target = GetTargetWeight(LightBuffer[Tap.Light - 1], WorldPos, Normal);
+            UpdateReservoir(r, Tap.Light, Target, Target * Tap.W * Tap.M, NextRandom(Random));
+        }
+        r.M += Tap.M;
+    }
+
+    FinalizeReservoir(r);
+    OutReservoirs[Pixel] = PackReservoir(r);
+}
@@ -0,0 +1,75 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Picks a light for each pixel from a fixed number of candidates drawn uniformly from its light grid tile, then
+// merges last frame's reservoir, reprojected through the camera motion.  The cost is independent of how many
+// lights reach the tile.
+//
+
+#include "ManyLightShadows.hlsli"
+
+[numthreads(8, 8, 1)]
+void main(uint3 DTid : SV_DispatchThreadID)
+{
+    int2 Pixel = DTid.xy;
+
+    // Nothing is lit in the sky
+    if (SceneDepth[Pixel] == 0.0)
+    {
+        OutReservoirs[Pixel] = 0;
+        return;
+    }
+
+    float3 WorldPos = GetWorldPosition(Pixel);
+    float3 Normal = GetWorldNormal(Pixel, WorldPos);
+    uint Random = SeedRandom(Pixel, FrameIndex);
+
+    // Sphere, cone and shadowed cone lights follow one another in the tile
+    uint TileOffset = GetTileOffset(GetTileIndex(GetTilePos(Pixel, InvTileDim), TileCountX));
+    uint TileLightCounts = LightGrid.Load(TileOffset);
+    uint TileLightCount = (TileLightCounts & 0xFF) + ((TileLightCounts >> 8) & 0xFF) + ((TileLightCounts >> 16) & 0xFF);
+
+    Reservoir r = EmptyReservoir();
+    if (TileLightCount > 0)
+    {
+        for (uint i = 0; i < CandidateCount; ++i)
+        {
+            uint Slot = min((uint)(NextRandom(Random) * TileLightCount), TileLightCount - 1);
+            uint LightIndex = LightGrid.Load(TileOffset + 4 + Slot * 4);
+            float Target = GetTargetWeight(LightBuffer[LightIndex], WorldPos, Normal);
+
+            // Divided by the uniform candidate probability
+            UpdateReservoir(r, LightIndex + 1, Target, Target * TileLightCount, NextRandom(Random));
+        }
+        r.M = CandidateCount;
+    }
+
+    if (MaxHistory > 0)
+    {
+        float Depth = LinearDepth[Pixel];
+        float4 PrevHPos = mul(CurToPrevXForm, float4((Pixel + 0.5) * Depth, 1.0, Depth));
+        float2 PrevUV = PrevHPos.xy / PrevHPos.w * RcpBufferDim;
+        int2 PrevPixel = (int2)floor(PrevHPos.xy / PrevHPos.w);
+
+        if (all(PrevUV == saturate(PrevUV)) && abs(PrevLinearDepth[PrevPixel] - PrevHPos.w) <= DepthTolerance * PrevHPos.w)
+        {
+            // Weighted by its candidate count, capped so that the history keeps adapting
+            Reservoir Prev = UnpackReservoir(InReservoirs[PrevPixel]);
+            Prev.M = min(Prev.M, MaxHistory);
+            if (Prev.Light != 0)
+            {
+                float Target = GetTargetWeight(LightBuffer[Prev.Light - 1], WorldPos, Normal);
+                UpdateReservoir(r, Prev.Light, Target, Target * Prev.W * Prev.M, NextRandom(Random));
+            }
+            r.M += Prev.M;
+        }
+    }
+
+    FinalizeReservoir(r);
+    OutReservoirs[Pixel] = PackReservoir(r);
+}
@@ -49,6 +49,7 @@ StructuredBuffer<LightData> lightBuffer : register(t66);
 Texture2DArray<float> lightShadowArrayTex : register(t67);
 ByteAddressBuffer lightGrid : register(t68);
 ByteAddressBuffer lightGridBitMask : register(t69);
+Texture2D<float> texLightShadowRatio : register(t70);
 
 cbuffer PSConstants : register(b0)
 {
@@ -61,8 +62,14 @@ cbuffer PSConstants : register(b0)
     uint4 TileCount;
     uint4 FirstLightIndex;
     uint FrameIndexMod2;
+    uint LocalLightMode;
 }
 
+// How the lights of the pixel's light grid tile are shaded
+#define LOCAL_LIGHTS_OFF 0
+#define LOCAL_LIGHTS_SHADOW_MAPS 1  // Shadowed cone lights read their shadow maps
+#define LOCAL_LIGHTS_RAY_TRACED 2   // All of them are scaled by the ray traced shadow ratio
+
 cbuffer MaterialInfo : register(b1)
 {
     uint AreNormalsNeeded;
@@ -360,6 +367,52 @@ MRT main(VSOutput vsOutput)
     float3 viewDir = normalize(vsOutput.viewDir);
     colorSum += ApplyDirectionalLight(diffuseAlbedo, specularAlbedo, specularMask, gloss, normal, viewDir, SunDirection, SunColor, vsOutput.shadowCoord);
 
+    if (LocalLightMode != LOCAL_LIGHTS_OFF)
+    {
+        uint2 tilePos = GetTilePos(pixelPos, InvTileDim.xy);
+        uint tileIndex = GetTileIndex(tilePos, TileCount.x);
+        uint tileOffset = GetTileOffset(tileIndex);
+
+        uint tileLightCount = lightGrid.Load(tileOffset + 0);
+        uint tileLightCountSphere = (tileLightCount >> 0) & 0xff;
+        uint tileLightCountCone = (tileLightCount >> 8) & 0xff;
+        uint tileLightCountConeShadowed = (tileLightCount >> 16) & 0xff;
+
+        uint tileLightLoadOffset = tileOffset + 4;
+        float3 localLightSum = 0;
+
+        for (uint n = 0; n < tileLightCountSphere; n++, tileLightLoadOffset += 4)
+        {
+            uint lightIndex = lightGrid.Load(tileLightLoadOffset);
+            LightData lightData = lightBuffer[lightIndex];
+            localLightSum += ApplyPointLight(POINT_LIGHT_PARAMS);
+        }
+
+        for (uint n = 0; n < tileLightCountCone; n++, tileLightLoadOffset += 4)
+        {
+            uint lightIndex = lightGrid.Load(tileLightLoadOffset);
+            LightData lightData = lightBuffer[lightIndex];
+            localLightSum += ApplyConeLight(SPOT_LIGHT_PARAMS);
+        }
+
+        for (uint n = 0; n < tileLightCountConeShadowed; n++, tileLightLoadOffset += 4)
+        {
+            uint lightIndex = lightGrid.Load(tileLightLoadOffset);
+            LightData lightData = lightBuffer[lightIndex];
+            if (LocalLightMode == LOCAL_LIGHTS_SHADOW_MAPS)
+                localLightSum += ApplyConeShadowedLight(SHADOWED_LIGHT_PARAMS);
+            else
+                localLightSum += ApplyConeLight(SPOT_LIGHT_PARAMS);
+        }
+
+        // The ratio of the shadowed to the unshadowed lighting, estimated from one ray toward a light picked in
+        // proportion to its contribution
+        if (LocalLightMode == LOCAL_LIGHTS_RAY_TRACED)
+            localLightSum *= texLightShadowRatio[pixelPos];
+
+        colorSum += localLightSum;
+    }
+
     mrt.Color = colorSum;
 
     if (AreNormalsNeeded)
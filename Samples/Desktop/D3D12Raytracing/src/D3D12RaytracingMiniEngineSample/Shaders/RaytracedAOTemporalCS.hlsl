@@ -0,0 +1,72 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Accumulates the half resolution ambient occlusion rays over time.  The AO is traced before the velocity buffer
+// is written, so the history is reprojected through the camera motion instead, and rejected where the linear
+// depth it lands on no longer matches.
+//
+
+Texture2D<float> CurAO : register(t0);
+Texture2D<float> PreAO : register(t1);
+Texture2D<float> CurDepth : register(t2);
+Texture2D<float> PreDepth : register(t3);
+RWTexture2D<float> OutAO : register(u0);
+
+SamplerState LinearSampler : register(s0);
+
+cbuffer CSConstants : register(b0)
+{
+    matrix CurToPrevXForm;  // Full resolution pixels and linear depth to last frame's
+    float2 RcpTraceDim;     // 1 / ray target size
+    float2 RcpBufferDim;    // 1 / full resolution size
+    float TemporalBlend;    // 0 when the history is invalid
+    float DepthTolerance;   // Relative linear depth error that counts as a disocclusion
+}
+
+[numthreads(8, 8, 1)]
+void main(uint3 DTid : SV_DispatchThreadID)
+{
+    uint2 TraceDim;
+    CurAO.GetDimensions(TraceDim.x, TraceDim.y);
+
+    int2 ST = DTid.xy;
+    float Current = CurAO[ST];
+
+    // Clamp the history to the current neighborhood so that moving occluders do not leave trails
+    float MinAO = Current;
+    float MaxAO = Current;
+    [unroll]
+    for (int y = -1; y <= 1; ++y)
+    {
+        [unroll]
+        for (int x = -1; x <= 1; ++x)
+        {
+            float Neighbor = CurAO[clamp(ST + int2(x, y), 0, int2(TraceDim) - 1)];
+            MinAO = min(MinAO, Neighbor);
+            MaxAO = max(MaxAO, Neighbor);
+        }
+    }
+
+    // The rays were traced from the center pixel of each 2x2 block
+    uint2 PixelST = ST * 2 + 1;
+    float Depth = CurDepth[PixelST];
+    float4 PrevHPos = mul(CurToPrevXForm, float4((PixelST + 0.5) * Depth, 1.0, Depth));
+    float2 PrevPixel = PrevHPos.xy / PrevHPos.w;
+    float2 HistoryUV = PrevPixel * 0.5 * RcpTraceDim;
+
+    float4 DepthError = abs(PreDepth.Gather(LinearSampler, PrevPixel * RcpBufferDim) - PrevHPos.w);
+    float MinError = min(min(DepthError.x, DepthError.y), min(DepthError.z, DepthError.w));
+
+    float Blend = TemporalBlend;
+    if (MinError > DepthTolerance * PrevHPos.w || any(HistoryUV != saturate(HistoryUV)))
+        Blend = 0.0;
+
+    float History = clamp(PreAO.SampleLevel(LinearSampler, HistoryUV, 0), MinAO, MaxAO);
+
+    OutAO[ST] = lerp(Current, History, Blend);
+}
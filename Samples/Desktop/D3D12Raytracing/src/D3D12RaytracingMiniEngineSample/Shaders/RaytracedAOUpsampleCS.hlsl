@@ -0,0 +1,71 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Upsamples the accumulated ambient occlusion from the four nearest rays to full resolution.  Taps are weighted
+// bilinearly and by linear depth similarity so that occlusion does not bleed across geometric edges.
+//
+
+Texture2D<float> InAO : register(t0);
+Texture2D<float> LinearDepth : register(t1);
+RWTexture2D<float> OutAO : register(u0);
+
+cbuffer CSConstants : register(b0)
+{
+    float DepthTolerance;   // Relative linear depth difference that halves a tap's weight
+}
+
+[numthreads(8, 8, 1)]
+void main(uint3 DTid : SV_DispatchThreadID)
+{
+    uint2 TraceDim, BufferDim;
+    InAO.GetDimensions(TraceDim.x, TraceDim.y);
+    LinearDepth.GetDimensions(BufferDim.x, BufferDim.y);
+
+    uint2 PixelST = DTid.xy;
+    float Depth = LinearDepth[PixelST];
+
+    // Position of this pixel in ray target texels.  Texel T was traced from pixel 2 * T + 1.
+    float2 TraceST = ((float2)PixelST - 1.0) * 0.5;
+    int2 BaseST = (int2)floor(TraceST);
+    float2 Frac = TraceST - BaseST;
+
+    float AOSum = 0.0;
+    float WeightSum = 0.0;
+    float NearestDist = 1e6;
+    float NearestAO = 1.0;
+
+    [unroll]
+    for (int y = 0; y <= 1; ++y)
+    {
+        [unroll]
+        for (int x = 0; x <= 1; ++x)
+        {
+            int2 TapST = clamp(BaseST + int2(x, y), 0, int2(TraceDim) - 1);
+            uint2 TapPixel = min(TapST * 2 + 1, BufferDim - 1);
+
+            float AO = InAO[TapST];
+            float TapDepth = LinearDepth[TapPixel];
+
+            float2 Bilinear = float2(x ? Frac.x : 1.0 - Frac.x, y ? Frac.y : 1.0 - Frac.y);
+            float DepthDist = abs(TapDepth - Depth);
+            float Weight = Bilinear.x * Bilinear.y * exp2(-DepthDist / (DepthTolerance * Depth + 1e-6));
+
+            AOSum += AO * Weight;
+            WeightSum += Weight;
+
+            // Fall back to the nearest tap in depth when no tap lies on the same surface
+            if (DepthDist < NearestDist)
+            {
+                NearestDist = DepthDist;
+                NearestAO = AO;
+            }
+        }
+    }
+
+    OutAO[PixelST] = WeightSum > 1e-4 ? AOSum / WeightSum : NearestAO;
+}
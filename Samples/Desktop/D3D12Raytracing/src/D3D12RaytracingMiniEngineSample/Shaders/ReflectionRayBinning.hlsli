@@ -0,0 +1,29 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// The key that the reflection ray list is sorted by.  Shared by the shaders that append to the list.
+//
+
+// Spreads the low 10 bits of each component out to every third bit
+uint3 SpreadBits(uint3 Value)
+{
+    Value = (Value * 0x00010001u) & 0xFF0000FFu;
+    Value = (Value * 0x00000101u) & 0x0F00F00Fu;
+    Value = (Value * 0x00000011u) & 0xC30C30C3u;
+    Value = (Value * 0x00000005u) & 0x49249249u;
+    return Value;
+}
+
+// The octant in the top bits, above a 27-bit Morton code of the origin within the scene bounds
+uint GetBinningKey(float3 Origin, float3 Direction, float3 SceneMin, float3 RcpSceneExtent)
+{
+    uint Octant = (Direction.x < 0.0 ? 1 : 0) | (Direction.y < 0.0 ? 2 : 0) | (Direction.z < 0.0 ? 4 : 0);
+    uint3 Cell = (uint3)clamp((Origin - SceneMin) * RcpSceneExtent * 512.0, 0.0, 511.0);
+    uint3 Morton = SpreadBits(Cell);
+    return Octant << 27 | Morton.x << 2 | Morton.y << 1 | Morton.z;
+}
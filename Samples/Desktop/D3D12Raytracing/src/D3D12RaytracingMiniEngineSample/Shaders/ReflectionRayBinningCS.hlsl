@@ -0,0 +1,48 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Appends the reflection ray of every reflective pixel to a list, keyed so that sorting the list bins the rays
+// by direction octant and then by the Morton code of their origins.  Rays traced next to each other after the
+// sort then start close together and head the same way, so they fetch mostly the same BVH nodes.
+//
+
+#include "ReflectionRayBinning.hlsli"
+
+Texture2D<float> SceneDepth : register(t0);
+Texture2D<float4> SceneNormals : register(t1);
+RWStructuredBuffer<uint2> ReflectionRayList : register(u0);
+
+cbuffer CSConstants : register(b0)
+{
+    float4x4 ClipToWorld;
+    float3 CameraPosition;
+    float3 SceneMin;
+    float3 RcpSceneExtent;
+    float2 RcpBufferDim;
+}
+
+[numthreads(8, 8, 1)]
+void main(uint3 DTid : SV_DispatchThreadID)
+{
+    uint2 BufferDim;
+    SceneDepth.GetDimensions(BufferDim.x, BufferDim.y);
+    if (any(DTid.xy >= BufferDim))
+        return;
+
+    // Same test as the ray generation shader; only reflective surfaces trace a ray
+    float4 NormalData = SceneNormals[DTid.xy];
+    if (NormalData.w == 0.0)
+        return;
+
+    float2 ScreenPos = (DTid.xy + 0.5) * RcpBufferDim * float2(2, -2) + float2(-1, 1);
+    float4 Unprojected = mul(ClipToWorld, float4(ScreenPos, SceneDepth[DTid.xy], 1));
+    float3 World = Unprojected.xyz / Unprojected.w;
+    float3 Direction = reflect(normalize(World - CameraPosition), NormalData.xyz);
+
+    ReflectionRayList[ReflectionRayList.IncrementCounter()] = uint2(DTid.x | DTid.y << 16, GetBinningKey(World, Direction, SceneMin, RcpSceneExtent));
+}
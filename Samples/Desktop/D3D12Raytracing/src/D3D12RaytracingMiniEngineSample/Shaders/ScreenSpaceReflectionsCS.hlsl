@@ -0,0 +1,160 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Marches the reflection ray of every reflective pixel through the Hi-Z pyramid, which holds the nearest depth
+// of each cell.  The ray skips whole cells while it stays in front of them and steps down a level where it
+// reaches one.  A hit adds the lit scene color it lands on to the pixel.  Rays that leave the screen, run out
+// of steps, or land somewhere the screen can't tell them about are appended to the reflection ray list to be
+// traced instead.
+//
+
+#include "ReflectionRayBinning.hlsli"
+
+Texture2D<float> SceneDepth : register(t0);
+Texture2D<float4> SceneNormals : register(t1);
+Texture2D<float3> SceneColor : register(t2);        // A copy of the color buffer without reflections
+Texture2D<float> HiZ : register(t3);                // Mip n holds the nearest depth of 2^(n+1) texel cells
+RWStructuredBuffer<uint2> ReflectionRayList : register(u0);
+RWTexture2D<float3> OutColor : register(u1);
+
+cbuffer CSConstants : register(b0)
+{
+    float4x4 ViewProj;
+    float4x4 ClipToWorld;
+    float3 CameraPosition;
+    float3 SceneMin;
+    float3 RcpSceneExtent;
+    float2 BufferDim;
+    float2 RcpBufferDim;
+    float NearClip;
+    float MaxRayLength;
+    float Thickness;        // How far behind a surface, relative to its distance, a ray still hits it
+    uint MaxSteps;
+    uint HiZLevels;
+}
+
+// Level 0 is the depth buffer, and each level above it one mip of the pyramid
+float LoadNearestDepth(uint2 Cell, uint Level)
+{
+    return Level == 0 ? SceneDepth[Cell] : HiZ.Load(int3(Cell, Level - 1));
+}
+
+float3 ToScreen(float4 Clip)
+{
+    return float3((Clip.xy / Clip.w * float2(0.5, -0.5) + 0.5) * BufferDim, Clip.z / Clip.w);
+}
+
+float3 ToWorld(float3 Screen)
+{
+    float4 Unprojected = mul(ClipToWorld, float4(Screen.xy * RcpBufferDim * float2(2, -2) + float2(-1, 1), Screen.z, 1));
+    return Unprojected.xyz / Unprojected.w;
+}
+
+// Returns whether the ray hit, and the texel it landed on
+bool TraceHiZ(float3 Origin, float3 Delta, float TMax, out uint2 HitTexel)
+{
+    // Keep the steps finite along an axis the ray doesn't move on
+    Delta.xy = abs(Delta.xy) < 1e-5 ? 1e-5 : Delta.xy;
+    const float2 CrossOffset = Delta.xy > 0 ? 0.001 : -0.001;
+    const float2 CrossStep = Delta.xy > 0 ? 1.0 : 0.0;
+
+    // Start past the ray's own texel
+    uint Level = 0;
+    float2 Boundary = floor(Origin.xy) + CrossStep + CrossOffset;
+    float2 TBoundary = (Boundary - Origin.xy) / Delta.xy;
+    float T = min(TBoundary.x, TBoundary.y);
+
+    HitTexel = 0;
+    for (uint Step = 0; Step < MaxSteps && T < TMax; ++Step)
+    {
+        const float3 Position = Origin + T * Delta;
+        const float CellSize = (float)(1u << Level);
+        const float2 Cell = floor(Position.xy / CellSize);
+        const float CellDepth = LoadNearestDepth((uint2)Cell, Level);
+
+        // Depth is reversed, so the ray is behind everything in the cell when its depth is no greater
+        if (Position.z <= CellDepth)
+        {
+            if (Level == 0)
+            {
+                HitTexel = (uint2)Cell;
+                return true;
+            }
+            --Level;
+            continue;
+        }
+
+        Boundary = (Cell + CrossStep) * CellSize + CrossOffset;
+        TBoundary = (Boundary - Origin.xy) / Delta.xy;
+        const float TExit = min(TBoundary.x, TBoundary.y);
+
+        // Moving away from the camera, the ray reaches the nearest depth of the cell somewhere along it
+        const float TReach = Delta.z < 0.0 ? (CellDepth - Origin.z) / Delta.z : TExit;
+        if (TReach < TExit)
+        {
+            T = max(T, TReach);
+            if (Level == 0)
+            {
+                HitTexel = (uint2)Cell;
+                return true;
+            }
+            --Level;
+        }
+        else
+        {
+            T = TExit;
+            Level = min(Level + 1, HiZLevels);
+        }
+    }
+    return false;
+}
+
+[numthreads(8, 8, 1)]
+void main(uint3 DTid : SV_DispatchThreadID)
+{
+    if (any(DTid.xy >= (uint2)BufferDim))
+        return;
+
+    // Same test as the ray generation shader; only reflective surfaces trace a ray
+    float4 NormalData = SceneNormals[DTid.xy];
+    if (NormalData.w == 0.0)
+        return;
+
+    float3 World = ToWorld(float3(DTid.xy + 0.5, SceneDepth[DTid.xy]));
+    float3 Direction = reflect(normalize(World - CameraPosition), NormalData.xyz);
+
+    // End the ray in front of the near plane, then clip it to the screen
+    float4 ClipStart = mul(ViewProj, float4(World, 1));
+    float4 ClipEnd = mul(ViewProj, float4(World + Direction * MaxRayLength, 1));
+    if (ClipEnd.w < NearClip)
+        ClipEnd = lerp(ClipStart, ClipEnd, (ClipStart.w - NearClip) / (ClipStart.w - ClipEnd.w));
+
+    float3 Origin = ToScreen(ClipStart);
+    float3 Delta = ToScreen(ClipEnd) - Origin;
+    float2 TEdges = (Delta.xy > 0 ? BufferDim - Origin.xy : -Origin.xy) / Delta.xy;
+    float TMax = min(1.0, min(Delta.x != 0 ? TEdges.x : 1.0, Delta.y != 0 ? TEdges.y : 1.0));
+
+    uint2 HitTexel;
+    if (TraceHiZ(Origin, Delta, TMax, HitTexel))
+    {
+        // The screen only shows the front of what the ray lands on.  A ray that passed far behind it, or that
+        // hit its back, needs the BVH to find what it really hits.
+        float3 HitWorld = ToWorld(float3(HitTexel + 0.5, SceneDepth[HitTexel]));
+        float3 RayWorld = World + Direction * dot(HitWorld - World, Direction);
+        float SurfaceDistance = distance(HitWorld, CameraPosition);
+        bool InFront = distance(RayWorld, CameraPosition) - SurfaceDistance <= Thickness * SurfaceDistance;
+        bool FrontFacing = dot(SceneNormals[HitTexel].xyz, Direction) < 0.0;
+        if (InFront && FrontFacing && SceneDepth[HitTexel] > 0.0)
+        {
+            OutColor[DTid.xy] = SceneColor[DTid.xy] + NormalData.w * SceneColor[HitTexel];
+            return;
+        }
+    }
+
+    ReflectionRayList[ReflectionRayList.IncrementCounter()] = uint2(DTid.x | DTid.y << 16, GetBinningKey(World, Direction, SceneMin, RcpSceneExtent));
+}
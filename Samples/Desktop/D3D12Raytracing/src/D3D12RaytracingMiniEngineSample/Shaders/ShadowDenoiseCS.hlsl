@@ -0,0 +1,79 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Filters the accumulated shadow rays and upsamples them to full resolution.  Taps are weighted by distance,
+// linear depth and normal similarity so that the blur does not bleed across geometric edges.
+//
+
+Texture2D<float> InShadow : register(t0);
+Texture2D<float> LinearDepth : register(t1);
+Texture2D<float4> Normals : register(t2);
+RWTexture2D<float3> OutColor : register(u0);
+
+cbuffer CSConstants : register(b0)
+{
+    uint RayScale;          // Full resolution pixels per ray along each axis
+    int FilterRadius;       // In ray target texels; 1 only upsamples
+    float RcpSigmaSq;       // Spatial falloff in ray target texels
+    float DepthTolerance;   // Relative linear depth difference that halves a tap's weight
+}
+
+[numthreads(8, 8, 1)]
+void main(uint3 DTid : SV_DispatchThreadID)
+{
+    uint2 TraceDim;
+    InShadow.GetDimensions(TraceDim.x, TraceDim.y);
+
+    uint2 PixelST = DTid.xy;
+    float Depth = LinearDepth[PixelST];
+    float3 Normal = Normals[PixelST].xyz;
+
+    // Position of this pixel in ray target texels.  Texel T was traced from pixel T * RayScale + RayScale / 2.
+    float2 TraceST = ((float2)PixelST - RayScale / 2) / RayScale;
+    int2 BaseST = (int2)floor(TraceST);
+
+    float ShadowSum = 0.0;
+    float WeightSum = 0.0;
+    float NearestDist = 1e6;
+    float NearestShadow = 1.0;
+
+    for (int y = 1 - FilterRadius; y <= FilterRadius; ++y)
+    {
+        for (int x = 1 - FilterRadius; x <= FilterRadius; ++x)
+        {
+            int2 TapST = clamp(BaseST + int2(x, y), 0, int2(TraceDim) - 1);
+            uint2 TapPixel = TapST * RayScale + RayScale / 2;
+
+            float Shadow = InShadow[TapST];
+            float TapDepth = LinearDepth[TapPixel];
+            float3 TapNormal = Normals[TapPixel].xyz;
+
+            float2 Offset = TapST - TraceST;
+            float DistSq = dot(Offset, Offset);
+
+            float DepthWeight = exp2(-abs(TapDepth - Depth) / (DepthTolerance * Depth + 1e-6));
+            float NormalWeight = pow(saturate(dot(Normal, TapNormal)), 8.0);
+            float Weight = exp2(-DistSq * RcpSigmaSq) * DepthWeight * NormalWeight;
+
+            ShadowSum += Shadow * Weight;
+            WeightSum += Weight;
+
+            // Fall back to the nearest tap in depth when no tap lies on the same surface
+            float DepthDist = abs(TapDepth - Depth);
+            if (DepthDist < NearestDist)
+            {
+                NearestDist = DepthDist;
+                NearestShadow = Shadow;
+            }
+        }
+    }
+
+    float Result = WeightSum > 1e-4 ? ShadowSum / WeightSum : NearestShadow;
+
+    OutColor[PixelST] = Result;
+}
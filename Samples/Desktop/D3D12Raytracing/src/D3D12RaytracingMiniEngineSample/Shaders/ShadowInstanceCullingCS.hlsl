@@ -0,0 +1,65 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Copies the ray tracing instances, clearing the instance mask of each one whose world space box lies outside
+// the view frustum swept toward the sun.  Each instance is a D3D12_RAYTRACING_FALLBACK_INSTANCE_DESC.
+//
+
+struct InstanceBounds
+{
+    float4 Center;
+    float4 Extent;
+};
+
+ByteAddressBuffer Instances : register(t0);
+StructuredBuffer<InstanceBounds> Bounds : register(t1);
+RWByteAddressBuffer CulledInstances : register(u0);
+
+cbuffer CSConstants : register(b0)
+{
+    float4 Planes[12];          // Facing inward
+    uint NumPlanes;
+    uint NumInstances;
+}
+
+static const uint kInstanceStride = 64;
+
+[numthreads(64, 1, 1)]
+void main(uint3 DTid : SV_DispatchThreadID)
+{
+    const uint Index = DTid.x;
+    if (Index >= NumInstances)
+        return;
+
+    // The rows of the object to world transform, then the ID and mask, the hit group offset and flags, and
+    // the bottom level's pointer
+    const uint Address = Index * kInstanceStride;
+    const float4 Row0 = asfloat(Instances.Load4(Address));
+    const float4 Row1 = asfloat(Instances.Load4(Address + 16));
+    const float4 Row2 = asfloat(Instances.Load4(Address + 32));
+    uint4 Tail = Instances.Load4(Address + 48);
+
+    const float3 ObjectCenter = Bounds[Index].Center.xyz;
+    const float3 ObjectExtent = Bounds[Index].Extent.xyz;
+    const float3 Center = float3(dot(Row0.xyz, ObjectCenter), dot(Row1.xyz, ObjectCenter), dot(Row2.xyz, ObjectCenter)) +
+        float3(Row0.w, Row1.w, Row2.w);
+    const float3 Extent = float3(dot(abs(Row0.xyz), ObjectExtent), dot(abs(Row1.xyz), ObjectExtent), dot(abs(Row2.xyz), ObjectExtent));
+
+    bool Inside = true;
+    for (uint i = 0; i < NumPlanes; ++i)
+        Inside = Inside && dot(Planes[i].xyz, Center) + dot(abs(Planes[i].xyz), Extent) + Planes[i].w >= 0.0;
+
+    // The mask is the top byte of the word holding the instance ID
+    if (!Inside)
+        Tail.x &= 0x00FFFFFF;
+
+    CulledInstances.Store4(Address, asuint(Row0));
+    CulledInstances.Store4(Address + 16, asuint(Row1));
+    CulledInstances.Store4(Address + 32, asuint(Row2));
+    CulledInstances.Store4(Address + 48, Tail);
+}
@@ -0,0 +1,73 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Accumulates jittered, reduced resolution shadow rays over time.  The history is reprojected with the camera
+// velocity buffer and rejected where the reprojected linear depth no longer matches.
+//
+
+#include "PixelPacking_Velocity.hlsli"
+
+Texture2D<float> CurShadow : register(t0);
+Texture2D<float> PreShadow : register(t1);
+Texture2D<packed_velocity_t> VelocityBuffer : register(t2);
+Texture2D<float> CurDepth : register(t3);
+Texture2D<float> PreDepth : register(t4);
+RWTexture2D<float> OutShadow : register(u0);
+
+SamplerState LinearSampler : register(s0);
+
+cbuffer CSConstants : register(b0)
+{
+    float2 RcpTraceDim;     // 1 / ray target size
+    float2 RcpBufferDim;    // 1 / full resolution size
+    uint RayScale;          // Full resolution pixels per ray along each axis
+    float TemporalBlend;    // 0 when the history is invalid
+    float DepthTolerance;   // Relative linear depth error that counts as a disocclusion
+}
+
+[numthreads(8, 8, 1)]
+void main(uint3 DTid : SV_DispatchThreadID)
+{
+    uint2 TraceDim;
+    CurShadow.GetDimensions(TraceDim.x, TraceDim.y);
+
+    int2 ST = DTid.xy;
+    float Current = CurShadow[ST];
+
+    // Clamp the history to the current neighborhood so that moving shadows do not leave trails
+    float MinShadow = Current;
+    float MaxShadow = Current;
+    [unroll]
+    for (int y = -1; y <= 1; ++y)
+    {
+        [unroll]
+        for (int x = -1; x <= 1; ++x)
+        {
+            float Neighbor = CurShadow[clamp(ST + int2(x, y), 0, int2(TraceDim) - 1)];
+            MinShadow = min(MinShadow, Neighbor);
+            MaxShadow = max(MaxShadow, Neighbor);
+        }
+    }
+
+    // The ray was traced from the center pixel of its block
+    uint2 PixelST = ST * RayScale + RayScale / 2;
+    float3 Velocity = UnpackVelocity(VelocityBuffer[PixelST]);
+    float2 HistoryUV = (ST + 0.5 + Velocity.xy / RayScale) * RcpTraceDim;
+
+    float ExpectedDepth = CurDepth[PixelST] + Velocity.z;
+    float4 DepthError = abs(PreDepth.Gather(LinearSampler, (PixelST + Velocity.xy + 0.5) * RcpBufferDim) - ExpectedDepth);
+    float MinError = min(min(DepthError.x, DepthError.y), min(DepthError.z, DepthError.w));
+
+    float Blend = TemporalBlend;
+    if (MinError > DepthTolerance * ExpectedDepth || any(HistoryUV != saturate(HistoryUV)))
+        Blend = 0.0;
+
+    float History = clamp(PreShadow.SampleLevel(LinearSampler, HistoryUV, 0), MinShadow, MaxShadow);
+
+    OutShadow[ST] = lerp(Current, History, Blend);
+}
@@ -0,0 +1,177 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "ShadowInstanceCulling.h"
+#include "PipelineState.h"
+#include "RootSignature.h"
+#include "CommandContext.h"
+#include "Camera.h"
+#include "GraphicsCore.h"
+#include "EngineTuning.h"
+#include "Model.h"
+#include "D3D12RaytracingFallback.h"
+#include <vector>
+
+#include "CompiledShaders/ShadowInstanceCullingCS.h"
+
+using namespace Math;
+using namespace Graphics;
+
+namespace ShadowInstanceCulling
+{
+    BoolVar Enable("Application/Raytracing/Shadow Rays/Cull Instances", true);
+
+    // The six frustum planes and at most six silhouette edges
+    enum { kMaxPlanes = 12 };
+
+    RootSignature m_RootSig;
+    ComputePSO m_CullCS;
+
+    StructuredBuffer m_InstanceBounds;
+    ByteAddressBuffer m_CulledInstances;
+    uint32_t m_NumInstances = 0;
+    float m_SceneDiagonal = 0.0f;
+
+    // Planes face inward, so points inside the volume have non-negative distances to all of them
+    uint32_t BuildSweptFrustum(const Frustum& ViewFrustum, Vector3 Sweep, float Dilation, Vector4* Planes);
+}
+
+void ShadowInstanceCulling::InitializeResources( const Model& model )
+{
+    m_RootSig.Reset(4, 0);
+    m_RootSig[0].InitAsConstantBuffer(0);
+    m_RootSig[1].InitAsBufferSRV(0);
+    m_RootSig[2].InitAsBufferSRV(1);
+    m_RootSig[3].InitAsBufferUAV(0);
+    m_RootSig.Finalize(L"ShadowInstanceCullingRS");
+
+    m_CullCS.SetRootSignature(m_RootSig);
+    m_CullCS.SetComputeShader(g_pShadowInstanceCullingCS, sizeof(g_pShadowInstanceCullingCS));
+    m_CullCS.Finalize();
+
+    // Centers and half extents
+    m_NumInstances = model.m_Header.meshCount;
+    std::vector<Vector4> Bounds(m_NumInstances * 2);
+    for (uint32_t i = 0; i < m_NumInstances; ++i)
+    {
+        const Model::BoundingBox& Box = model.m_pMesh[i].boundingBox;
+        Bounds[i * 2] = Vector4((Box.min + Box.max) * 0.5f, 0.0f);
+        Bounds[i * 2 + 1] = Vector4((Box.max - Box.min) * 0.5f, 0.0f);
+    }
+    m_InstanceBounds.Create(L"Instance Bounds", m_NumInstances, sizeof(Vector4) * 2, Bounds.data());
+    m_CulledInstances.Create(L"Shadow Culled Instances", m_NumInstances, sizeof(D3D12_RAYTRACING_FALLBACK_INSTANCE_DESC));
+
+    const Model::BoundingBox& SceneBox = model.GetBoundingBox();
+    m_SceneDiagonal = Length(SceneBox.max - SceneBox.min);
+}
+
+uint32_t ShadowInstanceCulling::BuildSweptFrustum( const Frustum& ViewFrustum, Vector3 Sweep, float Dilation, Vector4* Planes )
+{
+    // The two corners of each edge and the two faces that meet there
+    static const Frustum::CornerID kEdgeCorners[12][2] =
+    {
+        { Frustum::kNearLowerLeft, Frustum::kNearUpperLeft }, { Frustum::kNearLowerRight, Frustum::kNearUpperRight },
+        { Frustum::kNearUpperLeft, Frustum::kNearUpperRight }, { Frustum::kNearLowerLeft, Frustum::kNearLowerRight },
+        { Frustum::kFarLowerLeft, Frustum::kFarUpperLeft }, { Frustum::kFarLowerRight, Frustum::kFarUpperRight },
+        { Frustum::kFarUpperLeft, Frustum::kFarUpperRight }, { Frustum::kFarLowerLeft, Frustum::kFarLowerRight },
+        { Frustum::kNearLowerLeft, Frustum::kFarLowerLeft }, { Frustum::kNearUpperLeft, Frustum::kFarUpperLeft },
+        { Frustum::kNearLowerRight, Frustum::kFarLowerRight }, { Frustum::kNearUpperRight, Frustum::kFarUpperRight },
+    };
+    static const Frustum::PlaneID kEdgePlanes[12][2] =
+    {
+        { Frustum::kNearPlane, Frustum::kLeftPlane }, { Frustum::kNearPlane, Frustum::kRightPlane },
+        { Frustum::kNearPlane, Frustum::kTopPlane }, { Frustum::kNearPlane, Frustum::kBottomPlane },
+        { Frustum::kFarPlane, Frustum::kLeftPlane }, { Frustum::kFarPlane, Frustum::kRightPlane },
+        { Frustum::kFarPlane, Frustum::kTopPlane }, { Frustum::kFarPlane, Frustum::kBottomPlane },
+        { Frustum::kLeftPlane, Frustum::kBottomPlane }, { Frustum::kLeftPlane, Frustum::kTopPlane },
+        { Frustum::kRightPlane, Frustum::kBottomPlane }, { Frustum::kRightPlane, Frustum::kTopPlane },
+    };
+
+    uint32_t NumPlanes = 0;
+
+    // Points leave through the faces that look toward the sun, so only the others still bound the sweep
+    bool Kept[6];
+    for (int i = 0; i < 6; ++i)
+    {
+        BoundingPlane Plane = ViewFrustum.GetFrustumPlane((Frustum::PlaneID)i);
+        float Scale = 1.0f / Length(Plane.GetNormal());
+        Kept[i] = Dot(Plane.GetNormal(), Sweep) >= 0.0f;
+        if (Kept[i])
+        {
+            Vector4 Normalized = Vector4(Plane) * Scale;
+            Planes[NumPlanes++] = Vector4(Vector3(Normalized), Normalized.GetW() + Dilation);
+        }
+    }
+
+    Vector3 Centroid(kZero);
+    for (int i = 0; i < 8; ++i)
+        Centroid = Centroid + ViewFrustum.GetFrustumCorner((Frustum::CornerID)i);
+    Centroid = Centroid * 0.125f;
+
+    // Between a kept face and a dropped one, the volume is bounded by the plane through the edge along the sweep.
+    // Edges parallel to the sweep have no such plane, and leaving it out only makes the volume larger.
+    for (int i = 0; i < 12 && NumPlanes < kMaxPlanes; ++i)
+    {
+        if (Kept[kEdgePlanes[i][0]] == Kept[kEdgePlanes[i][1]])
+            continue;
+
+        Vector3 P0 = ViewFrustum.GetFrustumCorner(kEdgeCorners[i][0]);
+        Vector3 P1 = ViewFrustum.GetFrustumCorner(kEdgeCorners[i][1]);
+        Vector3 Normal = Cross(P1 - P0, Sweep);
+        float NormalLength = Length(Normal);
+        if (NormalLength < 1e-6f * Length(P1 - P0))
+            continue;
+
+        Normal = Normal / NormalLength;
+        if (Dot(Normal, Centroid - P0) < 0.0f)
+            Normal = -Normal;
+        Planes[NumPlanes++] = Vector4(Normal, -Dot(Normal, P0) + Dilation);
+    }
+
+    return NumPlanes;
+}
+
+void ShadowInstanceCulling::CullInstances( ComputeContext& Context, const D3D12_RAYTRACING_FALLBACK_INSTANCE_DESC* Instances,
+    const Camera& Camera, const Vector3& SunDirection, float TanSunAngularRadius )
+{
+    ScopedTimer _prof(L"Cull Shadow Instances", Context);
+
+    __declspec(align(16)) struct
+    {
+        Vector4 Planes[kMaxPlanes];
+        uint32_t NumPlanes;
+        uint32_t NumInstances;
+    } csConstants;
+
+    // No planes keeps every instance
+    csConstants.NumPlanes = 0;
+    csConstants.NumInstances = m_NumInstances;
+    if (Enable)
+    {
+        const float Dilation = TanSunAngularRadius * m_SceneDiagonal;
+        csConstants.NumPlanes = BuildSweptFrustum(Camera.GetWorldSpaceFrustum(), SunDirection, Dilation, csConstants.Planes);
+    }
+
+    Context.SetRootSignature(m_RootSig);
+    Context.SetPipelineState(m_CullCS);
+    Context.TransitionResource(m_InstanceBounds, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    Context.TransitionResource(m_CulledInstances, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, true);
+    Context.SetDynamicConstantBufferView(0, sizeof(csConstants), &csConstants);
+    Context.SetDynamicSRV(1, sizeof(D3D12_RAYTRACING_FALLBACK_INSTANCE_DESC) * m_NumInstances, Instances);
+    Context.SetBufferSRV(2, m_InstanceBounds);
+    Context.SetBufferUAV(3, m_CulledInstances);
+    Context.Dispatch1D(m_NumInstances, 64);
+
+    Context.TransitionResource(m_CulledInstances, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, true);
+}
+
+const ByteAddressBuffer& ShadowInstanceCulling::GetCulledInstances( void )
+{
+    return m_CulledInstances;
+}
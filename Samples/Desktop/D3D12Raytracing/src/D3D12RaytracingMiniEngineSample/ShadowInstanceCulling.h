@@ -0,0 +1,43 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#pragma once
+
+#include <cstdint>
+
+class Model;
+class ByteAddressBuffer;
+class ComputeContext;
+class BoolVar;
+struct D3D12_RAYTRACING_FALLBACK_INSTANCE_DESC;
+namespace Math
+{
+    class Camera;
+    class Vector3;
+}
+
+// Culls the scene's ray tracing instances to those that can shadow a point the camera sees.  Shadow rays from
+// visible points only travel through the view frustum swept toward the sun, so each instance's world space
+// bounds are tested against that volume on the GPU.  Culled instances keep their place in the list with an
+// instance mask of zero, so a top level built from it keeps the scene's hit group offsets.
+namespace ShadowInstanceCulling
+{
+    extern BoolVar Enable;
+
+    // One instance per mesh, bounded by the mesh's object space box
+    void InitializeResources(const Model& model);
+
+    // Writes the culled copy of Instances.  Shadow rays jittered across the sun's disk stray from the sweep by
+    // up to TanSunAngularRadius per unit of length, which widens the volume.  Leaves the culled list readable
+    // by acceleration structure builds.
+    void CullInstances(ComputeContext& Context, const D3D12_RAYTRACING_FALLBACK_INSTANCE_DESC* Instances,
+        const Math::Camera& Camera, const Math::Vector3& SunDirection, float TanSunAngularRadius);
+
+    const ByteAddressBuffer& GetCulledInstances(void);
+}
@@ -15,6 +15,7 @@
 [shader("miss")]
 void Miss(inout RayPayload payload)
 {
+    payload.RayHitT = FLT_MAX;
     if (!payload.SkipShading)
     {
         g_screenOutput[DispatchRaysIndex().xy] = float4(0, 0, 0, 1);
@@ -169,7 +169,7 @@ bool RayAABBIntersectionTest(Ray ray, float3 aabb[2], out float tmin, out float
     tmax3.z = (aabb[sign3.z].z - ray.origin.z) / ray.direction.z;
     
     tmin = max(max(tmin3.x, tmin3.y), tmin3.z);
-    tmax = min(min(tmax3.x, tmax3.z), tmax3.z);
+    tmax = min(min(tmax3.x, tmax3.y), tmax3.z);
     
     return tmax > tmin && tmax >= RayTMin() && tmin <= RayTCurrent();
 }
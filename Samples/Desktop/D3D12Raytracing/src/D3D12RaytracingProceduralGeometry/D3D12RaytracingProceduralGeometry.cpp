@@ -52,12 +52,18 @@ D3D12RaytracingProceduralGeometry::D3D12RaytracingProceduralGeometry(UINT width,
 	m_animateCamera(false),
 	m_animateGeometry(true),
 	m_animateLight(false),
+	m_profileIntersectionShaders(false),
 	m_isDxrSupported(false),
 	m_descriptorsAllocated(0),
 	m_descriptorSize(0),
 	m_missShaderTableStrideInBytes(UINT_MAX),
 	m_hitGroupShaderTableStrideInBytes(UINT_MAX),
-	m_forceComputeFallback(false)
+	m_forceComputeFallback(false),
+	m_accelerationStructureBuildTime(0),
+	m_benchmarkFrame(0),
+	m_benchmarkFrameTime(0),
+	m_benchmarkRaytracingTime(0),
+	m_benchmarkCopyTime(0)
 {
 	m_forceComputeFallback = false;
 	SelectRaytracingAPI(RaytracingAPI::FallbackLayer);
@@ -201,7 +207,7 @@ void D3D12RaytracingProceduralGeometry::InitializeScene()
 			float diffuseCoef = 0.9f,
 			float specularCoef = 0.7f,
 			float specularPower = 50.0f,
-			float stepScale = 1.0f)
+			float lipschitzConstant = 1.0f)
 		{
 			auto& attributes = m_aabbMaterialCB[primitiveIndex];
 			attributes.albedo = albedo;
@@ -209,7 +215,7 @@ void D3D12RaytracingProceduralGeometry::InitializeScene()
 			attributes.diffuseCoef = diffuseCoef;
 			attributes.specularCoef = specularCoef;
 			attributes.specularPower = specularPower;
-			attributes.stepScale = stepScale;
+			attributes.lipschitzConstant = lipschitzConstant;
 		};
 
 
@@ -242,10 +248,10 @@ void D3D12RaytracingProceduralGeometry::InitializeScene()
 			SetAttributes(offset + MiniSpheres, green);
 			SetAttributes(offset + IntersectedRoundCube, green);
 			SetAttributes(offset + SquareTorus, ChromiumReflectance, 1);
-			SetAttributes(offset + TwistedTorus, yellow, 0, 1.0f, 0.7f, 50, 0.5f);
+			SetAttributes(offset + TwistedTorus, yellow, 0, 1.0f, 0.7f, 50, 2.0f);
 			SetAttributes(offset + Cog, yellow, 0, 1.0f, 0.1f, 2);
 			SetAttributes(offset + Cylinder, red);
-			SetAttributes(offset + FractalPyramid, green, 0, 1, 0.1f, 4, 0.8f);
+			SetAttributes(offset + FractalPyramid, green, 0, 1, 0.1f, 4, 1.25f);
 		}
 	}
 
@@ -284,6 +290,12 @@ void D3D12RaytracingProceduralGeometry::InitializeScene()
 		lightDiffuseColor = XMFLOAT4(d, d, d, 1.0f);
 		m_sceneCB->lightDiffuseColor = XMLoadFloat4(&lightDiffuseColor);
 	}
+
+	// Setup ray marching step budgets. 
+	{
+		m_sceneCB->maxRadianceRaySteps = c_defaultMaxRadianceRaySteps;
+		m_sceneCB->maxShadowRaySteps = c_defaultMaxShadowRaySteps;
+	}
 }
 
 // Create constant buffers. 
@@ -376,6 +388,7 @@ void D3D12RaytracingProceduralGeometry::CreateRootSignatures()
 		rootParameters[GlobalRootSignature::Slot::SceneConstant].InitAsConstantBufferView(0);
 		rootParameters[GlobalRootSignature::Slot::AABBattributeBuffer].InitAsShaderResourceView(3);
 		rootParameters[GlobalRootSignature::Slot::VertexBuffers].InitAsDescriptorTable(1, &ranges[1]);
+		rootParameters[GlobalRootSignature::Slot::ProfilingConstant].InitAsConstants(SizeOfInUint32(ProfilingConstantBuffer), 3);
 		CD3DX12_ROOT_SIGNATURE_DESC globalRootSignatureDesc(ARRAYSIZE(rootParameters), rootParameters);
 		SerializeAndCreateRaytracingRootSignature(globalRootSignatureDesc, &m_raytracingGlobalRootSignature);
 	}
@@ -1024,6 +1037,10 @@ AccelerationStructureBuffers D3D12RaytracingProceduralGeometry::BuildTopLevelAS(
 // Build acceleration structure needed for raytracing. 
 void D3D12RaytracingProceduralGeometry::BuildAccelerationStructures()
 {
+	// The build runs once with a wait for its completion, so it is timed on the CPU. 
+	CPUTimer buildTimer;
+	buildTimer.Start();
+
 	auto device = m_deviceResources->GetD3DDevice();
 	auto commandList = m_deviceResources->GetCommandList();
 	auto commandQueue = m_deviceResources->GetCommandQueue();
@@ -1062,6 +1079,9 @@ void D3D12RaytracingProceduralGeometry::BuildAccelerationStructures()
 	// Wait for GPU to finish as the locally created temporary GPU resources will get released once we go out of scope. 
 	m_deviceResources->WaitForGpu();
 
+	buildTimer.Stop();
+	m_accelerationStructureBuildTime = static_cast<float>(buildTimer.GetElapsedMS());
+
 	// Store the AS buffers. The rest of the buffers will be released once we exit the function. 
 	for (UINT i = 0; i < BottomLevelASType::Count; i++)
 	{
@@ -1265,6 +1285,25 @@ void D3D12RaytracingProceduralGeometry::OnKeyDown(UINT8 key)
 	case 'L':
 		m_animateLight = !m_animateLight;
 		break;
+	case 'P':
+		m_profileIntersectionShaders = !m_profileIntersectionShaders;
+		for (UINT t = GpuTimers::NoIntersectionShaders; t < GpuTimers::Count; t++)
+		{
+			m_gpuTimers[t].Reset();
+		}
+		break;
+	case VK_UP:
+		m_sceneCB->maxRadianceRaySteps = min(2 * m_sceneCB->maxRadianceRaySteps, c_maxRaySteps);
+		break;
+	case VK_DOWN:
+		m_sceneCB->maxRadianceRaySteps = max(m_sceneCB->maxRadianceRaySteps / 2, c_minRaySteps);
+		break;
+	case VK_RIGHT:
+		m_sceneCB->maxShadowRaySteps = min(2 * m_sceneCB->maxShadowRaySteps, c_maxRaySteps);
+		break;
+	case VK_LEFT:
+		m_sceneCB->maxShadowRaySteps = max(m_sceneCB->maxShadowRaySteps / 2, c_minRaySteps);
+		break;
 		break;
 	}
 
@@ -1281,6 +1320,10 @@ void D3D12RaytracingProceduralGeometry::OnUpdate()
 {
 	m_timer.Tick();
 	CalculateFrameStats();
+	if (m_benchmarkFrameCount > 0)
+	{
+		UpdateBenchmark();
+	}
 	float elapsedTime = static_cast<float>(m_timer.GetElapsedSeconds());
 	auto frameIndex = m_deviceResources->GetCurrentFrameIndex();
 	auto prevFrameIndex = m_deviceResources->GetPreviousFrameIndex();
@@ -1357,9 +1400,31 @@ void D3D12RaytracingProceduralGeometry::DoRaytracing()
 		dispatchDesc->Depth = 1;
 		raytracingCommandList->SetPipelineState1(stateObject);
 
-		m_gpuTimers[GpuTimers::Raytracing].Start(commandList);
-		raytracingCommandList->DispatchRays(dispatchDesc);
-		m_gpuTimers[GpuTimers::Raytracing].Stop(commandList);
+		auto TimedDispatchRays = [&](GpuTimers::Enum gpuTimer, UINT enabledIntersectionShaderTypes)
+		{
+			commandList->SetComputeRoot32BitConstant(GlobalRootSignature::Slot::ProfilingConstant, enabledIntersectionShaderTypes, 0);
+			m_gpuTimers[gpuTimer].Start(commandList);
+			raytracingCommandList->DispatchRays(dispatchDesc);
+			m_gpuTimers[gpuTimer].Stop(commandList);
+		};
+
+		// Profiling passes. 
+		// A single DispatchRays() invokes all the intersection shader types, so each type is timed in a pass of its own 
+		// where the other types report no hits right away. Subtracting a pass where none of them tests its primitives 
+		// leaves the type's own cost. The passes write the same output, so serialize them to keep the timings apart. 
+		if (m_profileIntersectionShaders)
+		{
+			auto uavBarrier = CD3DX12_RESOURCE_BARRIER::UAV(m_raytracingOutput.Get());
+			TimedDispatchRays(GpuTimers::NoIntersectionShaders, 0);
+			commandList->ResourceBarrier(1, &uavBarrier);
+			for (UINT t = 0; t < IntersectionShaderType::Count; t++)
+			{
+				TimedDispatchRays(static_cast<GpuTimers::Enum>(GpuTimers::AnalyticPrimitives + t), 1 << t);
+				commandList->ResourceBarrier(1, &uavBarrier);
+			}
+		}
+
+		TimedDispatchRays(GpuTimers::Raytracing, ~0u);
 	};
 
 	auto SetCommonPipelineState = [&](auto* descriptorSetCommandList)
@@ -1508,7 +1573,10 @@ void D3D12RaytracingProceduralGeometry::OnRender()
 	}
 
 	DoRaytracing();
+
+	m_gpuTimers[GpuTimers::CopyToBackbuffer].Start(commandList);
 	CopyRaytracingOutputToBackbuffer();
+	m_gpuTimers[GpuTimers::CopyToBackbuffer].Stop(commandList);
 
 	// End frame. 
 	for (auto& gpuTimer : m_gpuTimers)
@@ -1540,7 +1608,16 @@ void D3D12RaytracingProceduralGeometry::OnDeviceRestored()
 	CreateWindowSizeDependentResources();
 }
 
-// Compute the average frames per second and million rays per second. 
+LPCWSTR D3D12RaytracingProceduralGeometry::GetRaytracingAPIName()
+{
+	if (m_raytracingAPI == RaytracingAPI::FallbackLayer)
+	{
+		return m_fallbackDevice->UsingRaytracingDriver() ? L"(FL-DXR)" : L"(FL)";
+	}
+	return L"(DXR)";
+}
+
+// Compute the average frames per second, the per-stage GPU times and million rays per second. 
 void D3D12RaytracingProceduralGeometry::CalculateFrameStats()
 {
 	static int frameCnt = 0;
@@ -1558,33 +1635,69 @@ void D3D12RaytracingProceduralGeometry::CalculateFrameStats()
 		frameCnt = 0;
 		prevTime = totalTime;
 		float raytracingTime = static_cast<float>(m_gpuTimers[GpuTimers::Raytracing].GetElapsedMS());
+		float copyTime = static_cast<float>(m_gpuTimers[GpuTimers::CopyToBackbuffer].GetElapsedMS());
 		float MRaysPerSecond = NumMRaysPerSecond(m_width, m_height, raytracingTime);
 
 		wstringstream windowText;
-		if (m_raytracingAPI == RaytracingAPI::FallbackLayer)
+		windowText << GetRaytracingAPIName() << setprecision(2) << fixed
+			<< L"    fps: " << fps
+			<< L"    DispatchRays(): " << raytracingTime << "ms"
+			<< L"    Copy: " << copyTime << L"ms"
+			<< L"    AS build: " << m_accelerationStructureBuildTime << L"ms"
+			<< L"     ~Million Primary Rays/s: " << MRaysPerSecond
+			<< L"    Ray march steps: " << m_sceneCB->maxRadianceRaySteps << L"/" << m_sceneCB->maxShadowRaySteps;
+		if (m_profileIntersectionShaders)
 		{
-			if (m_fallbackDevice->UsingRaytracingDriver())
+			// GPU time of each intersection shader type over that of the pass with none of them testing their primitives. 
+			const wchar_t* intersectionShaderTypeNames[IntersectionShaderType::Count] = { L"Analytic", L"Volumetric", L"Signed distance" };
+			float baselineTime = m_gpuTimers[GpuTimers::NoIntersectionShaders].GetAverageMS();
+			for (UINT t = 0; t < IntersectionShaderType::Count; t++)
 			{
-				windowText << L"(FL-DXR)";
+				float intersectionShaderTime = m_gpuTimers[GpuTimers::AnalyticPrimitives + t].GetAverageMS() - baselineTime;
+				windowText << L"    " << intersectionShaderTypeNames[t] << L": " << intersectionShaderTime << L"ms";
 			}
-			else
-			{
-				windowText << L"(FL)";
-			}
-		}
-		else
-		{
-			windowText << L"(DXR)";
 		}
-		windowText << setprecision(2) << fixed
-			<< L"    fps: " << fps
-			<< L"    DispatchRays(): " << raytracingTime << "ms"
-			<< L"     ~Million Primary Rays/s: " << MRaysPerSecond
+		windowText
 			<< L"    GPU[" << m_deviceResources->GetAdapterID() << L"]: " << m_deviceResources->GetAdapterDescription();
 		SetCustomWindowText(windowText.str().c_str());
 	}
 }
 
+// Accumulate the timings of the benchmarked frames, then print their averages and quit. 
+void D3D12RaytracingProceduralGeometry::UpdateBenchmark()
+{
+	// The timers read back a few frames late, so skip the frames without results along with the warmup. 
+	if (m_benchmarkFrame++ < c_benchmarkWarmupFrames)
+	{
+		return;
+	}
+
+	m_benchmarkFrameTime += 1000 * m_timer.GetElapsedSeconds();
+	m_benchmarkRaytracingTime += m_gpuTimers[GpuTimers::Raytracing].GetElapsedMS();
+	m_benchmarkCopyTime += m_gpuTimers[GpuTimers::CopyToBackbuffer].GetElapsedMS();
+
+	if (m_benchmarkFrame == c_benchmarkWarmupFrames + m_benchmarkFrameCount)
+	{
+		float frameTime = static_cast<float>(m_benchmarkFrameTime / m_benchmarkFrameCount);
+		float raytracingTime = static_cast<float>(m_benchmarkRaytracingTime / m_benchmarkFrameCount);
+		float copyTime = static_cast<float>(m_benchmarkCopyTime / m_benchmarkFrameCount);
+
+		wstringstream results;
+		results << GetRaytracingAPIName() << setprecision(3) << fixed
+			<< L"    frames: " << m_benchmarkFrameCount
+			<< L"    resolution: " << m_width << L"x" << m_height
+			<< L"    frame: " << frameTime << L"ms"
+			<< L"    DispatchRays(): " << raytracingTime << L"ms"
+			<< L"    Copy: " << copyTime << L"ms"
+			<< L"    AS build: " << m_accelerationStructureBuildTime << L"ms"
+			<< L"    ~Million Primary Rays/s: " << NumMRaysPerSecond(m_width, m_height, raytracingTime)
+			<< L"    Ray march steps: " << m_sceneCB->maxRadianceRaySteps << L"/" << m_sceneCB->maxShadowRaySteps
+			<< L"    GPU[" << m_deviceResources->GetAdapterID() << L"]: " << m_deviceResources->GetAdapterDescription();
+		PrintBenchmarkResults(results.str().c_str());
+		PostQuitMessage(0);
+	}
+}
+
 // Handle OnSizeChanged message event. 
 void D3D12RaytracingProceduralGeometry::OnSizeChanged(UINT width, UINT height, bool minimized)
 {
@@ -53,6 +53,10 @@ private:
     const UINT NUM_BLAS = 2;          // Triangle + AABB bottom-level AS.
     const float c_aabbWidth = 2;      // AABB width.
     const float c_aabbDistance = 2;   // Distance between AABBs.
+    const UINT c_defaultMaxRadianceRaySteps = 256;  // Ray marching step budgets through procedural primitives.
+    const UINT c_defaultMaxShadowRaySteps = 64;
+    const UINT c_minRaySteps = 8;
+    const UINT c_maxRaySteps = 1024;
 
     // Raytracing Fallback Layer (FL) attributes
     ComPtr<ID3D12RaytracingFallbackDevice> m_fallbackDevice;
@@ -114,6 +118,7 @@ private:
 
     // Application state
     DX::GPUTimer m_gpuTimers[GpuTimers::Count];
+    float m_accelerationStructureBuildTime;     // CPU time of the build, including the wait for the GPU, in milliseconds.
     RaytracingAPI m_raytracingAPI;
     bool m_forceComputeFallback;
     StepTimer m_timer;
@@ -121,10 +126,18 @@ private:
     bool m_animateGeometry;
     bool m_animateCamera;
     bool m_animateLight;
+    bool m_profileIntersectionShaders;
     XMVECTOR m_eye;
     XMVECTOR m_at;
     XMVECTOR m_up;
 
+    // Benchmark mode
+    static const UINT c_benchmarkWarmupFrames = 30;  // Skipped while the GPU clocks settle and the timer readbacks fill.
+    UINT m_benchmarkFrame;
+    double m_benchmarkFrameTime;                // Sums over the benchmarked frames, in milliseconds.
+    double m_benchmarkRaytracingTime;
+    double m_benchmarkCopyTime;
+
     void EnableDirectXRaytracing(IDXGIAdapter1* adapter);
     void ParseCommandLineArgs(WCHAR* argv[], int argc);
     void UpdateCameraMatrices();
@@ -162,6 +175,8 @@ private:
     void UpdateForSizeChange(UINT clientWidth, UINT clientHeight);
     void CopyRaytracingOutputToBackbuffer();
     void CalculateFrameStats();
+    void UpdateBenchmark();
+    LPCWSTR GetRaytracingAPIName();
     UINT AllocateDescriptor(D3D12_CPU_DESCRIPTOR_HANDLE* cpuDescriptor, UINT descriptorIndexToUse = UINT_MAX);
     UINT CreateBufferSRV(D3DBuffer* buffer, UINT numElements, UINT elementSize);
     WRAPPED_GPU_POINTER CreateFallbackWrappedPointer(ID3D12Resource* resource, UINT bufferNumElements);
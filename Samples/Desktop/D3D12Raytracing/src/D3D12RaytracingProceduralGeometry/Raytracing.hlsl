@@ -40,6 +40,9 @@ StructuredBuffer<PrimitiveInstancePerFrameBuffer> g_AABBPrimitiveAttributes : re
 ConstantBuffer<PrimitiveConstantBuffer> l_materialCB : register(b1);
 ConstantBuffer<PrimitiveInstanceConstantBuffer> l_aabbCB: register(b2);
 
+// Profiling resources
+ConstantBuffer<ProfilingConstantBuffer> g_profilingCB : register(b3);
+
 //*************************************************************************** 
 //*****------ TraceRay wrappers for radiance and shadow rays. -------******** 
 //*************************************************************************** 
@@ -199,22 +202,113 @@ Ray GetRayInAABBPrimitiveLocalSpace()
 	return ray;
 }
 
+// Test whether the profiling root constant lets an intersection shader type test its primitives.
+bool IsIntersectionShaderTypeEnabled(in UINT intersectionShaderType)
+{
+	return (g_profilingCB.enabledIntersectionShaderTypes & (1 << intersectionShaderType)) != 0;
+}
+
+// Clip a local space ray to the primitive's <-1,1> AABB and the <RayTMin(), RayTCurrent()> segment.
+// Returns false if a closer hit has already been found in front of the AABB, so the march can be skipped.
+bool ClipRayToLocalAABB(in Ray ray, out float tmin, out float tmax)
+{
+	// Pad the AABB slightly so surfaces lying on its faces are not clipped away.
+	const float extent = 1.001;
+	float3 aabb[2] = {
+		float3(-extent, -extent, -extent),
+		float3(extent, extent, extent)
+	};
+	if (!RayAABBIntersectionTest(ray, aabb, tmin, tmax))
+	{
+		return false;
+	}
+	tmin = max(tmin, RayTMin());
+	tmax = min(tmax, RayTCurrent());
+	return tmin <= tmax;
+}
+
+// Ray marching step budget for the ray type being traced.
+UINT GetMaxRaySteps()
+{
+	return IsShadowRay() ? g_sceneCB.maxShadowRaySteps : g_sceneCB.maxRadianceRaySteps;
+}
+
+// Transform a local space hit normal to world space and report the hit.
+// Shadow rays skip the closest hit shaders, so their hits carry no normal.
+void ReportLocalSpaceHit(in float thit, in ProceduralPrimitiveAttributes attr)
+{
+	if (!IsShadowRay())
+	{
+		PrimitiveInstancePerFrameBuffer aabbAttribute = g_AABBPrimitiveAttributes[l_aabbCB.instanceIndex];
+		attr.normal = mul(attr.normal, (float3x3) aabbAttribute.localSpaceToBottomLevelAS);
+		attr.normal = normalize(mul((float3x3) ObjectToWorld3x4(), attr.normal));
+	}
+
+	ReportHit(thit, /*hitKind*/ 0, attr);
+}
+
 [shader("intersection")]
 void MyIntersectionShader_AnalyticPrimitive()
 {
+	if (!IsIntersectionShaderTypeEnabled(0))
+	{
+		return;
+	}
+
+	Ray localRay = GetRayInAABBPrimitiveLocalSpace();
+	AnalyticPrimitive::Enum primitiveType = (AnalyticPrimitive::Enum) l_aabbCB.primitiveType;
 
+	float thit;
+	ProceduralPrimitiveAttributes attr;
+	if (RayAnalyticGeometryIntersectionTest(localRay, primitiveType, thit, attr))
+	{
+		ReportLocalSpaceHit(thit, attr);
+	}
 }
 
 [shader("intersection")]
 void MyIntersectionShader_VolumetricPrimitive()
 {
+	if (!IsIntersectionShaderTypeEnabled(1))
+	{
+		return;
+	}
 
+	Ray localRay = GetRayInAABBPrimitiveLocalSpace();
+	VolumetricPrimitive::Enum primitiveType = (VolumetricPrimitive::Enum) l_aabbCB.primitiveType;
+
+	float thit;
+	ProceduralPrimitiveAttributes attr;
+	if (RayVolumetricGeometryIntersectionTest(localRay, primitiveType, thit, attr, g_sceneCB.elapsedTime, GetMaxRaySteps()))
+	{
+		ReportLocalSpaceHit(thit, attr);
+	}
 }
 
 [shader("intersection")]
 void MyIntersectionShader_SignedDistancePrimitive()
 {
+	if (!IsIntersectionShaderTypeEnabled(2))
+	{
+		return;
+	}
 
+	Ray localRay = GetRayInAABBPrimitiveLocalSpace();
+	SignedDistancePrimitive::Enum primitiveType = (SignedDistancePrimitive::Enum) l_aabbCB.primitiveType;
+
+	// Skip the march when a closer hit has already been found in front of the AABB.
+	float tmin, tmax;
+	if (!ClipRayToLocalAABB(localRay, tmin, tmax))
+	{
+		return;
+	}
+
+	float thit;
+	ProceduralPrimitiveAttributes attr;
+	if (RaySignedDistancePrimitiveTest(localRay, primitiveType, thit, attr, tmin, tmax, l_materialCB.lipschitzConstant, GetMaxRaySteps()))
+	{
+		ReportLocalSpaceHit(thit, attr);
+	}
 }
 
 #endif // RAYTRACING_HLSL
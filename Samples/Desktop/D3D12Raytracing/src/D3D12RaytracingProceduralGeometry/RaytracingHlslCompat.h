@@ -77,6 +77,15 @@ struct SceneConstantBuffer
 	XMVECTOR lightDiffuseColor;
 	float    reflectance;
 	float    elapsedTime;                 // Elapsed application time. 
+	UINT     maxRadianceRaySteps;         // Ray marching step budget of a radiance ray through a signed distance or volumetric primitive.
+	UINT     maxShadowRaySteps;           // Ray marching step budget of a shadow ray, which only tests for occlusion.
+};
+
+// Profiling root constant selecting which intersection shader types test their primitives.
+// Bit i is set for the IntersectionShaderType i, the others report no hits right away.
+struct ProfilingConstantBuffer
+{
+	UINT enabledIntersectionShaderTypes;
 };
 
 // Attributes per primitive type. 
@@ -87,9 +96,9 @@ struct PrimitiveConstantBuffer
 	float diffuseCoef;
 	float specularCoef;
 	float specularPower;
-	float stepScale;                      // Step scale for ray marching of signed distance primitives.  
-										  // - Some object transformations don't preserve the distances and  
-										  //   thus require shorter steps. 
+	float lipschitzConstant;              // Bound on how fast a signed distance primitive's distance changes with position.
+										  // - Some object transformations don't preserve the distances and
+										  //   thus require shorter steps, ray marching steps by distance / lipschitzConstant.
 	XMFLOAT3 padding;
 };
 
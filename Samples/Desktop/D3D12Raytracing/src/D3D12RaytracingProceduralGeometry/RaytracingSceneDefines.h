@@ -21,6 +21,7 @@ namespace GlobalRootSignature {
             SceneConstant,
             AABBattributeBuffer,
             VertexBuffers,
+            ProfilingConstant,
             Count
         };
     }
@@ -84,6 +85,11 @@ namespace GeometryType {
 namespace GpuTimers {
     enum Enum {
         Raytracing = 0,
+        CopyToBackbuffer,
+        NoIntersectionShaders,      // Profiling pass with every intersection shader reporting no hits right away.
+        AnalyticPrimitives,         // Profiling passes with a single intersection shader type testing its primitives.
+        VolumetricPrimitives,
+        SignedDistancePrimitives,
         Count
     };
 }
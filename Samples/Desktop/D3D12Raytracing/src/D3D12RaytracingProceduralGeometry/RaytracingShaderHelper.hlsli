@@ -143,6 +143,12 @@ bool IsAValidHit(in Ray ray, in float thit, in float3 hitSurfaceNormal)
     return IsInRange(thit, RayTMin(), RayTCurrent()) && !IsCulled(ray, hitSurfaceNormal);
 }
 
+// Shadow rays only test for occlusion, so they skip the closest hit shaders and don't need the hit's normal.
+bool IsShadowRay()
+{
+    return (RayFlags() & RAY_FLAG_SKIP_CLOSEST_HIT_SHADER) != 0;
+}
+
 // Texture coordinates on a horizontal plane.
 float2 TexCoords(in float3 position)
 {
@@ -282,24 +282,54 @@ float3 sdCalculateNormal(in float3 pos, in SignedDistancePrimitive::Enum sdPrimi
         e.xxx * GetDistanceFromSignedDistancePrimitive(pos + e.xxx, sdPrimitive));
 }
 
-// Test ray against a signed distance primitive.
+// Over-relaxation factor of the sphere tracing steps, 1 disables it.
+// Ref: Keinert et al., Enhanced Sphere Tracing, 2014
+#define SPHERE_TRACING_OVER_RELAXATION 1.6
+
+// Test ray against a signed distance primitive within the ray segment <tmin, tmax>.
 // Ref: https://www.scratchapixel.com/lessons/advanced-rendering/rendering-distance-fields/basic-sphere-tracer
-bool RaySignedDistancePrimitiveTest(in Ray ray, in SignedDistancePrimitive::Enum sdPrimitive, out float thit, out ProceduralPrimitiveAttributes attr, in float stepScale = 1.0f)
+bool RaySignedDistancePrimitiveTest(in Ray ray, in SignedDistancePrimitive::Enum sdPrimitive, out float thit, out ProceduralPrimitiveAttributes attr, in float tmin, in float tmax, in float lipschitzConstant, in UINT maxSteps)
 {
-    const float threshold = 0.0001;
-    float t = RayTMin();
-    const UINT MaxSteps = 512;
+    // Shadow rays only test for occlusion, so they accept a hit at a looser, conservative distance.
+    const bool isShadowRay = IsShadowRay();
+    const float threshold = isShadowRay ? 0.001 : 0.0001;
+
+    // The distance divided by the Lipschitz constant bounds the empty sphere around a position.
+    // The local space ray direction isn't normalized, so the radius is converted to ray units.
+    const float distanceToT = 1 / (lipschitzConstant * length(ray.direction));
+
+    float omega = SPHERE_TRACING_OVER_RELAXATION;
+    float t = tmin;
+    float prevRadius = 0;
+    float stepLength = 0;
 
     // Do sphere tracing through the AABB.
     UINT i = 0;
-    while (i++ < MaxSteps && t <= RayTCurrent())
+    while (i++ < maxSteps && t <= tmax)
     {
         float3 position = ray.origin + t * ray.direction;
-        float distance = GetDistanceFromSignedDistancePrimitive(position, sdPrimitive);
+        float radius = distanceToT * GetDistanceFromSignedDistancePrimitive(position, sdPrimitive);
+
+        // An over-relaxed step is only safe if the empty spheres at the last and current positions overlap.
+        // Otherwise, go back to the edge of the last sphere and continue with unrelaxed steps.
+        if (omega > 1 && abs(radius) + prevRadius < stepLength)
+        {
+            t -= stepLength - prevRadius;
+            stepLength = prevRadius;
+            omega = 1;
+            continue;
+        }
 
         // Has the ray intersected the primitive? 
-        if (distance <= threshold * t)
+        if (radius <= threshold * t)
         {
+            if (isShadowRay)
+            {
+                thit = t;
+                attr.normal = float3(0, 0, 0);
+                return true;
+            }
+
             float3 hitSurfaceNormal = sdCalculateNormal(position, sdPrimitive);
             if (IsAValidHit(ray, t, hitSurfaceNormal))
             {
@@ -309,11 +339,11 @@ bool RaySignedDistancePrimitiveTest(in Ray ray, in SignedDistancePrimitive::Enum
             }
         }
 
-        // Since distance is the minimum distance to the primitive, 
+        // Since the radius is the minimum distance to the primitive, 
         // we can safely jump by that amount without intersecting the primitive.
-        // We allow for scaling of steps per primitive type due to any pre-applied 
-        // transformations that don't preserve true distances.
-        t += stepScale * distance;
+        prevRadius = abs(radius);
+        stepLength = omega * radius;
+        t += stepLength;
     }
     return false;
 }
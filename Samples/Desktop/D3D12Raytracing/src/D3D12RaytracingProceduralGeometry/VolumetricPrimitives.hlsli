@@ -37,7 +37,7 @@ float CalculateMetaballPotential(in float3 position, in Metaball blob, out float
 {
     distance = length(position - blob.center);
     
-    if (distance <= blob.radius)
+    if (distance < blob.radius)
     {
         float d = distance;
 
@@ -121,6 +121,7 @@ void InitializeAnimatedMetaballs(out Metaball blobs[N_METABALLS], in float elaps
 
 // Find all metaballs that ray intersects.
 // The passed in array is sorted to the first nActiveMetaballs.
+// Without the sorting, the metaballs the ray misses get a zero radius so that the field skips them.
 void FindIntersectingMetaballs(in Ray ray, out float tmin, out float tmax, inout Metaball blobs[N_METABALLS], out UINT nActiveMetaballs)
 {
     // Find the entry and exit points for all metaball bounding spheres combined.
@@ -141,14 +142,41 @@ void FindIntersectingMetaballs(in Ray ray, out float tmin, out float tmax, inout
             nActiveMetaballs = N_METABALLS;
 #endif
         }
+#if !LIMIT_TO_ACTIVE_METABALLS
+        else
+        {
+            blobs[i].radius = 0;
+        }
+#endif
     }
     tmin = max(tmin, RayTMin());
     tmax = min(tmax, RayTCurrent());
 }
 
+// Calculate a bound on the field potential's gradient, i.e. how fast the potential can change with position.
+// The quintic polynomial's slope peaks at 30/16 halfway to a metaball's radius.
+float CalculateMetaballsLipschitzConstant(in Metaball blobs[N_METABALLS], in UINT nActiveMetaballs)
+{
+    float lipschitzConstant = 0;
+#if USE_DYNAMIC_LOOPS
+    for (UINT j = 0; j < nActiveMetaballs; j++)
+#else
+    for (UINT j = 0; j < N_METABALLS; j++)
+#endif
+    {
+        if (blobs[j].radius > 0)
+        {
+            lipschitzConstant += 1.875 / blobs[j].radius;
+        }
+    }
+    return lipschitzConstant;
+}
+
 // Test if a ray with RayFlags and segment <RayTMin(), RayTCurrent()> intersects metaball field.
-// The test sphere traces through the metaball field until it hits a threshold isosurface. 
-bool RayMetaballsIntersectionTest(in Ray ray, out float thit, out ProceduralPrimitiveAttributes attr, in float elapsedTime)
+// The test sphere traces through the metaball field until it hits a threshold isosurface.
+// The potential can't reach the threshold closer than (threshold - potential) / lipschitzConstant, so the march
+// takes steps of that length, but no shorter than the segment split into maxSteps so that the budget always covers it.
+bool RayMetaballsIntersectionTest(in Ray ray, out float thit, out ProceduralPrimitiveAttributes attr, in float elapsedTime, in UINT maxSteps)
 {
     Metaball blobs[N_METABALLS];
     InitializeAnimatedMetaballs(blobs, elapsedTime, 12.0f);
@@ -157,36 +185,38 @@ bool RayMetaballsIntersectionTest(in Ray ray, out float thit, out ProceduralPrim
     UINT nActiveMetaballs = 0;  // Number of metaballs's that the ray intersects.
     FindIntersectingMetaballs(ray, tmin, tmax, blobs, nActiveMetaballs);
 
-    UINT MAX_STEPS = 128;
+    // Has the ray missed all the metaballs?
+    if (nActiveMetaballs == 0 || tmin > tmax)
+    {
+        return false;
+    }
+
+    // Field potential threshold defining the isosurface.
+    // Threshold - valid range is (0, 1>, the larger the threshold the smaller the blob.
+    const float Threshold = 0.25f;
+
+    const bool isShadowRay = IsShadowRay();
+    const float potentialToTStep = 1 / (CalculateMetaballsLipschitzConstant(blobs, nActiveMetaballs) * length(ray.direction));
     float t = tmin;
-    float minTStep = (tmax - tmin) / (MAX_STEPS / 1);
+    float minTStep = (tmax - tmin) / maxSteps;
     UINT iStep = 0;
 
-    while (iStep++ < MAX_STEPS)
+    while (iStep++ < maxSteps && t <= tmax)
     {
         float3 position = ray.origin + t * ray.direction;
-        float fieldPotentials[N_METABALLS];    // Field potentials for each metaball.
-        float sumFieldPotential = 0;           // Sum of all metaball field potentials.
-            
-        // Calculate field potentials from all metaballs.
-#if USE_DYNAMIC_LOOPS
-        for (UINT j = 0; j < nActiveMetaballs; j++)
-#else
-        for (UINT j = 0; j < N_METABALLS; j++)
-#endif
-        {
-            float distance;
-            fieldPotentials[j] = CalculateMetaballPotential(position, blobs[j], distance);
-            sumFieldPotential += fieldPotentials[j];
-         }
-
-        // Field potential threshold defining the isosurface.
-        // Threshold - valid range is (0, 1>, the larger the threshold the smaller the blob.
-        const float Threshold = 0.25f;
+        float sumFieldPotential = CalculateMetaballsPotential(position, blobs, nActiveMetaballs);
 
         // Have we crossed the isosurface?
         if (sumFieldPotential >= Threshold)
         {
+            // Shadow rays only test for occlusion.
+            if (isShadowRay)
+            {
+                thit = t;
+                attr.normal = float3(0, 0, 0);
+                return true;
+            }
+
             float3 normal = CalculateMetaballsNormal(position, blobs, nActiveMetaballs);
             if (IsAValidHit(ray, t, normal))
             {
@@ -195,7 +225,7 @@ bool RayMetaballsIntersectionTest(in Ray ray, out float thit, out ProceduralPrim
                 return true;
             }
         }
-        t += minTStep;
+        t += max((Threshold - sumFieldPotential) * potentialToTStep, minTStep);
     }
 
     return false;
@@ -22,6 +22,7 @@ DXSample::DXSample(UINT width, UINT height, std::wstring name) :
     m_title(name),
     m_aspectRatio(0.0f),
     m_enableUI(true),
+    m_benchmarkFrameCount(0),
     m_adapterIDoverride(UINT_MAX)
 {
     WCHAR assetsPath[512];
@@ -56,6 +57,20 @@ void DXSample::SetCustomWindowText(LPCWSTR text)
     SetWindowText(Win32Application::GetHwnd(), windowText.c_str());
 }
 
+// Helper function for printing benchmark results to the debug output and the console the sample was started from.
+void DXSample::PrintBenchmarkResults(LPCWSTR text)
+{
+    std::wstring results = m_title + L": " + text + L"\n";
+    OutputDebugString(results.c_str());
+
+    if (AttachConsole(ATTACH_PARENT_PROCESS))
+    {
+        DWORD charsWritten;
+        WriteConsole(GetStdHandle(STD_OUTPUT_HANDLE), results.c_str(), static_cast<DWORD>(results.size()), &charsWritten, nullptr);
+        FreeConsole();
+    }
+}
+
 // Helper function for parsing any supplied command line args.
 _Use_decl_annotations_
 void DXSample::ParseCommandLineArgs(WCHAR* argv[], int argc)
@@ -77,6 +92,15 @@ void DXSample::ParseCommandLineArgs(WCHAR* argv[], int argc)
             m_adapterIDoverride = _wtoi(argv[i + 1]);
             i++;
         }
+        // -benchmark [frames]
+        else if (_wcsnicmp(argv[i], L"-benchmark", wcslen(argv[i])) == 0 ||
+            _wcsnicmp(argv[i], L"/benchmark", wcslen(argv[i])) == 0)
+        {
+            ThrowIfFalse(i + 1 < argc, L"Incorrect argument format passed in.");
+
+            m_benchmarkFrameCount = _wtoi(argv[i + 1]);
+            i++;
+        }
     }
 
 }
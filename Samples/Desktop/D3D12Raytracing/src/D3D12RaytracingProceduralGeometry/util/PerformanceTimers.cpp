@@ -143,12 +143,11 @@ void GPUTimer::BeginFrame(_In_ ID3D12GraphicsCommandList* commandList)
 void GPUTimer::EndFrame(_In_ ID3D12GraphicsCommandList* commandList)
 {
     // Resolve query for the current frame.
-    static UINT resolveToFrameID = 0;
-    UINT64 resolveToBaseAddress = resolveToFrameID * c_timerSlots * sizeof(UINT64);
+    UINT64 resolveToBaseAddress = m_resolveToFrameID * c_timerSlots * sizeof(UINT64);
     commandList->ResolveQueryData(m_heap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, 0, c_timerSlots, m_buffer.Get(), resolveToBaseAddress);
 
     // Grab read-back data for the queries from a finished frame m_maxframeCount ago.                                                           
-    UINT readBackFrameID = (resolveToFrameID + 1) % (m_maxframeCount + 1);
+    UINT readBackFrameID = (m_resolveToFrameID + 1) % (m_maxframeCount + 1);
     SIZE_T readBackBaseOffset = readBackFrameID * c_timerSlots * sizeof(UINT64);
     D3D12_RANGE dataRange =
     {
@@ -172,7 +171,7 @@ void GPUTimer::EndFrame(_In_ ID3D12GraphicsCommandList* commandList)
         m_avg[j] = UpdateRunningAverage(m_avg[j], value);
     }
 
-    resolveToFrameID = readBackFrameID;
+    m_resolveToFrameID = readBackFrameID;
 }
 
 void GPUTimer::Start(_In_ ID3D12GraphicsCommandList* commandList, uint32_t timerid)
@@ -220,6 +219,7 @@ void GPUTimer::RestoreDevice(_In_ ID3D12Device* device, _In_ ID3D12CommandQueue*
 {
     assert(device != 0 && commandQueue != 0);
     m_maxframeCount = maxFrameCount;
+    m_resolveToFrameID = 0;
 
     // Filter a debug warning coming when accessing a readback resource for the timing queries.
     // The readback resource handles multiple frames data via per-frame offsets within the same resource and CPU
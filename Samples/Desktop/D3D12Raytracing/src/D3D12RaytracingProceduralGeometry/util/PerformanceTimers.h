@@ -71,13 +71,15 @@ namespace DX
             m_gpuFreqInv(1.f),
             m_avg{},
             m_timing{},
-            m_maxframeCount(0)
+            m_maxframeCount(0),
+            m_resolveToFrameID(0)
         {}
 
         GPUTimer(ID3D12Device* device, ID3D12CommandQueue* commandQueue, UINT maxFrameCount) :
             m_gpuFreqInv(1.f),
             m_avg{},
-            m_timing{}
+            m_timing{},
+            m_resolveToFrameID(0)
         {
             RestoreDevice(device, commandQueue, maxFrameCount);
         }
@@ -124,6 +126,7 @@ namespace DX
         float                                   m_avg[c_maxTimers];
         UINT64                                  m_timing[c_timerSlots];
         size_t                                  m_maxframeCount;
+        UINT                                    m_resolveToFrameID;   // Per timer, as each one resolves into its own readback buffer.
 
     };
 }
\ No newline at end of file
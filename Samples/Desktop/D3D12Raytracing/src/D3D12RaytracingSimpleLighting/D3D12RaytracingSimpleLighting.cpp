@@ -26,9 +26,15 @@ D3D12RaytracingSimpleLighting::D3D12RaytracingSimpleLighting(UINT width, UINT he
     DXSample(width, height, name),
     m_raytracingOutputResourceUAVDescriptorHeapIndex(UINT_MAX),
     m_curRotationAngleRad(0.0f),
-    m_isDxrSupported(false)
+    m_isDxrSupported(false),
+    m_accelerationStructureBuildTime(0),
+    m_benchmarkFrame(0),
+    m_benchmarkFrameTime(0),
+    m_benchmarkRaytracingTime(0),
+    m_benchmarkCopyTime(0)
 {
     m_forceComputeFallback = false;
+    m_shortStackTraversal = false;
     SelectRaytracingAPI(RaytracingAPI::FallbackLayer);
     UpdateForSizeChange(width, height);
 }
@@ -180,6 +186,15 @@ void D3D12RaytracingSimpleLighting::CreateConstantBuffers()
 // Create resources that depend on the device.
 void D3D12RaytracingSimpleLighting::CreateDeviceDependentResources()
 {
+    auto device = m_deviceResources->GetD3DDevice();
+    auto commandQueue = m_deviceResources->GetCommandQueue();
+
+    // Create the GPU timers for the ray dispatch and the copy to the backbuffer.
+    for (auto& gpuTimer : m_gpuTimers)
+    {
+        gpuTimer.RestoreDevice(device, commandQueue, FrameCount);
+    }
+
     // Initialize raytracing pipeline.
 
     // Create raytracing interfaces: raytracing device and commandlist.
@@ -267,9 +282,13 @@ void D3D12RaytracingSimpleLighting::CreateRaytracingInterfaces()
 
     if (m_raytracingAPI == RaytracingAPI::FallbackLayer)
     {
-        CreateRaytracingFallbackDeviceFlags createDeviceFlags = m_forceComputeFallback ? 
-                                                    CreateRaytracingFallbackDeviceFlags::ForceComputeFallback : 
-                                                    CreateRaytracingFallbackDeviceFlags::None;
+        DWORD createDeviceFlags = m_forceComputeFallback ? 
+                                    CreateRaytracingFallbackDeviceFlags::ForceComputeFallback : 
+                                    CreateRaytracingFallbackDeviceFlags::None;
+        if (m_shortStackTraversal)
+        {
+            createDeviceFlags |= CreateRaytracingFallbackDeviceFlags::EnableShortStackTraversal;
+        }
         ThrowIfFailed(D3D12CreateRaytracingFallbackDevice(device, createDeviceFlags, 0, IID_PPV_ARGS(&m_fallbackDevice)));
         m_fallbackDevice->QueryRaytracingCommandList(commandList, IID_PPV_ARGS(&m_fallbackCommandList));
     }
@@ -493,6 +512,10 @@ void D3D12RaytracingSimpleLighting::BuildGeometry()
 // Build acceleration structures needed for raytracing.
 void D3D12RaytracingSimpleLighting::BuildAccelerationStructures()
 {
+    // The build runs once with a wait for its completion, so it is timed on the CPU.
+    CPUTimer buildTimer;
+    buildTimer.Start();
+
     auto device = m_deviceResources->GetD3DDevice();
     auto commandList = m_deviceResources->GetCommandList();
     auto commandQueue = m_deviceResources->GetCommandQueue();
@@ -659,6 +682,9 @@ void D3D12RaytracingSimpleLighting::BuildAccelerationStructures()
 
     // Wait for GPU to finish as the locally created temporary GPU resources will get released once we go out of scope.
     m_deviceResources->WaitForGpu();
+
+    buildTimer.Stop();
+    m_accelerationStructureBuildTime = static_cast<float>(buildTimer.GetElapsedMS());
 }
 
 // Build shader tables.
@@ -784,6 +810,10 @@ void D3D12RaytracingSimpleLighting::OnUpdate()
 {
     m_timer.Tick();
     CalculateFrameStats();
+    if (m_benchmarkFrameCount > 0)
+    {
+        UpdateBenchmark();
+    }
     float elapsedTime = static_cast<float>(m_timer.GetElapsedSeconds());
     auto frameIndex = m_deviceResources->GetCurrentFrameIndex();
     auto prevFrameIndex = m_deviceResources->GetPreviousFrameIndex();
@@ -827,6 +857,14 @@ void D3D12RaytracingSimpleLighting::ParseCommandLineArgs(WCHAR* argv[], int argc
             m_raytracingAPI = RaytracingAPI::DirectXRaytracing;
         }
     }
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (_wcsnicmp(argv[i], L"-shortStack", wcslen(argv[i])) == 0)
+        {
+            m_shortStackTraversal = true;
+        }
+    }
 }
 
 void D3D12RaytracingSimpleLighting::DoRaytracing()
@@ -925,6 +963,11 @@ void D3D12RaytracingSimpleLighting::ReleaseWindowSizeDependentResources()
 // Release all resources that depend on the device.
 void D3D12RaytracingSimpleLighting::ReleaseDeviceDependentResources()
 {
+    for (auto& gpuTimer : m_gpuTimers)
+    {
+        gpuTimer.ReleaseDevice();
+    }
+
     m_fallbackDevice.Reset();
     m_fallbackCommandList.Reset();
     m_fallbackStateObject.Reset();
@@ -972,9 +1015,28 @@ void D3D12RaytracingSimpleLighting::OnRender()
         return;
     }
 
+    auto commandList = m_deviceResources->GetCommandList();
+
+    // Begin frame.
     m_deviceResources->Prepare();
+    for (auto& gpuTimer : m_gpuTimers)
+    {
+        gpuTimer.BeginFrame(commandList);
+    }
+
+    m_gpuTimers[GpuTimers::Raytracing].Start(commandList);
     DoRaytracing();
+    m_gpuTimers[GpuTimers::Raytracing].Stop(commandList);
+
+    m_gpuTimers[GpuTimers::CopyToBackbuffer].Start(commandList);
     CopyRaytracingOutputToBackbuffer();
+    m_gpuTimers[GpuTimers::CopyToBackbuffer].Stop(commandList);
+
+    // End frame.
+    for (auto& gpuTimer : m_gpuTimers)
+    {
+        gpuTimer.EndFrame(commandList);
+    }
 
     m_deviceResources->Present(D3D12_RESOURCE_STATE_PRESENT);
 }
@@ -1000,7 +1062,20 @@ void D3D12RaytracingSimpleLighting::OnDeviceRestored()
     CreateWindowSizeDependentResources();
 }
 
-// Compute the average frames per second and million rays per second.
+LPCWSTR D3D12RaytracingSimpleLighting::GetRaytracingAPIName()
+{
+    if (m_raytracingAPI == RaytracingAPI::FallbackLayer)
+    {
+        if (m_fallbackDevice->UsingRaytracingDriver())
+        {
+            return L"(FL-DXR)";
+        }
+        return m_shortStackTraversal ? L"(FL short stack)" : L"(FL)";
+    }
+    return L"(DXR)";
+}
+
+// Compute the average frames per second, the per-stage GPU times and million rays per second.
 void D3D12RaytracingSimpleLighting::CalculateFrameStats()
 {
     static int frameCnt = 0;
@@ -1017,32 +1092,56 @@ void D3D12RaytracingSimpleLighting::CalculateFrameStats()
         frameCnt = 0;
         elapsedTime = totalTime;
 
-        float MRaysPerSecond = (m_width * m_height * fps) / static_cast<float>(1e6);
+        float raytracingTime = static_cast<float>(m_gpuTimers[GpuTimers::Raytracing].GetElapsedMS());
+        float copyTime = static_cast<float>(m_gpuTimers[GpuTimers::CopyToBackbuffer].GetElapsedMS());
+        float MRaysPerSecond = NumMRaysPerSecond(m_width, m_height, raytracingTime);
 
         wstringstream windowText;
-
-        if (m_raytracingAPI == RaytracingAPI::FallbackLayer)
-        {
-            if (m_fallbackDevice->UsingRaytracingDriver())
-            {
-                windowText << L"(FL-DXR)";
-            }
-            else
-            {
-                windowText << L"(FL)";
-            }
-        }
-        else
-        {
-            windowText << L"(DXR)";
-        }
-        windowText << setprecision(2) << fixed
-            << L"    fps: " << fps << L"     ~Million Primary Rays/s: " << MRaysPerSecond
+        windowText << GetRaytracingAPIName() << setprecision(2) << fixed
+            << L"    fps: " << fps
+            << L"    DispatchRays(): " << raytracingTime << L"ms"
+            << L"    Copy: " << copyTime << L"ms"
+            << L"    AS build: " << m_accelerationStructureBuildTime << L"ms"
+            << L"     ~Million Primary Rays/s: " << MRaysPerSecond
             << L"    GPU[" << m_deviceResources->GetAdapterID() << L"]: " << m_deviceResources->GetAdapterDescription();
         SetCustomWindowText(windowText.str().c_str());
     }
 }
 
+// Accumulate the timings of the benchmarked frames, then print their averages and quit.
+void D3D12RaytracingSimpleLighting::UpdateBenchmark()
+{
+    // The timers read back a few frames late, so skip the frames without results along with the warmup.
+    if (m_benchmarkFrame++ < c_benchmarkWarmupFrames)
+    {
+        return;
+    }
+
+    m_benchmarkFrameTime += 1000 * m_timer.GetElapsedSeconds();
+    m_benchmarkRaytracingTime += m_gpuTimers[GpuTimers::Raytracing].GetElapsedMS();
+    m_benchmarkCopyTime += m_gpuTimers[GpuTimers::CopyToBackbuffer].GetElapsedMS();
+
+    if (m_benchmarkFrame == c_benchmarkWarmupFrames + m_benchmarkFrameCount)
+    {
+        float frameTime = static_cast<float>(m_benchmarkFrameTime / m_benchmarkFrameCount);
+        float raytracingTime = static_cast<float>(m_benchmarkRaytracingTime / m_benchmarkFrameCount);
+        float copyTime = static_cast<float>(m_benchmarkCopyTime / m_benchmarkFrameCount);
+
+        wstringstream results;
+        results << GetRaytracingAPIName() << setprecision(3) << fixed
+            << L"    frames: " << m_benchmarkFrameCount
+            << L"    resolution: " << m_width << L"x" << m_height
+            << L"    frame: " << frameTime << L"ms"
+            << L"    DispatchRays(): " << raytracingTime << L"ms"
+            << L"    Copy: " << copyTime << L"ms"
+            << L"    AS build: " << m_accelerationStructureBuildTime << L"ms"
+            << L"    ~Million Primary Rays/s: " << NumMRaysPerSecond(m_width, m_height, raytracingTime)
+            << L"    GPU[" << m_deviceResources->GetAdapterID() << L"]: " << m_deviceResources->GetAdapterDescription();
+        PrintBenchmarkResults(results.str().c_str());
+        PostQuitMessage(0);
+    }
+}
+
 // Handle OnSizeChanged message event.
 void D3D12RaytracingSimpleLighting::OnSizeChanged(UINT width, UINT height, bool minimized)
 {
@@ -13,6 +13,7 @@
 
 #include "DXSample.h"
 #include "StepTimer.h"
+#include "PerformanceTimers.h"
 #include "RaytracingHlslCompat.h"
 
 namespace GlobalRootSignatureParams {
@@ -25,6 +26,14 @@ namespace GlobalRootSignatureParams {
     };
 }
 
+namespace GpuTimers {
+    enum Enum {
+        Raytracing = 0,
+        CopyToBackbuffer,
+        Count
+    };
+}
+
 namespace LocalRootSignatureParams {
     enum Value {
         CubeConstantSlot = 0,
@@ -131,7 +140,17 @@ private:
     // Application state
     RaytracingAPI m_raytracingAPI;
     bool m_forceComputeFallback;
+    bool m_shortStackTraversal;
     StepTimer m_timer;
+    DX::GPUTimer m_gpuTimers[GpuTimers::Count];
+    float m_accelerationStructureBuildTime;     // CPU time of the build, including the wait for the GPU, in milliseconds.
+
+    // Benchmark mode
+    static const UINT c_benchmarkWarmupFrames = 30;  // Skipped while the GPU clocks settle and the timer readbacks fill.
+    UINT m_benchmarkFrame;
+    double m_benchmarkFrameTime;                // Sums over the benchmarked frames, in milliseconds.
+    double m_benchmarkRaytracingTime;
+    double m_benchmarkCopyTime;
     float m_curRotationAngleRad;
     XMVECTOR m_eye;
     XMVECTOR m_at;
@@ -162,6 +181,8 @@ private:
     void UpdateForSizeChange(UINT clientWidth, UINT clientHeight);
     void CopyRaytracingOutputToBackbuffer();
     void CalculateFrameStats();
+    void UpdateBenchmark();
+    LPCWSTR GetRaytracingAPIName();
     UINT AllocateDescriptor(D3D12_CPU_DESCRIPTOR_HANDLE* cpuDescriptor, UINT descriptorIndexToUse = UINT_MAX);
     UINT CreateBufferSRV(D3DBuffer* buffer, UINT numElements, UINT elementSize);
     WRAPPED_GPU_POINTER CreateFallbackWrappedPointer(ID3D12Resource* resource, UINT bufferNumElements);
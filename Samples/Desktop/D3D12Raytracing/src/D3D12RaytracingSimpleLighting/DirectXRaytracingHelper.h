@@ -301,4 +301,11 @@ inline bool IsDirectXRaytracingSupported(IDXGIAdapter1* adapter)
     return SUCCEEDED(D3D12CreateDevice(adapter, D3D_FEATURE_LEVEL_11_0, IID_PPV_ARGS(&testDevice)))
         && SUCCEEDED(testDevice->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS5, &featureSupportData, sizeof(featureSupportData)))
         && featureSupportData.RaytracingTier != D3D12_RAYTRACING_TIER_NOT_SUPPORTED;
+}
+
+inline float NumMRaysPerSecond(UINT width, UINT height, float dispatchRaysTimeMs)
+{
+    float resolutionMRays = static_cast<float>(width * height);
+    float raytracingTimeInSeconds = 0.001f * dispatchRaysTimeMs;
+    return resolutionMRays / (raytracingTimeInSeconds * static_cast<float>(1e6));
 }
\ No newline at end of file
@@ -485,7 +485,13 @@ bool D3D12MemoryManagement::HandleMessage(HWND hwnd, UINT Message, WPARAM wParam
     return false;
 }
 
-void D3D12MemoryManagement::CalculateImagePagingData(const RectF* pViewportBounds, const Image* pImage, UINT8* pVisibleMip, UINT8* pPrefetchMip)
+void D3D12MemoryManagement::CalculateImagePagingData(
+    const RectF* pViewportBounds,
+    const Image* pImage,
+    UINT8* pVisibleMip,
+    UINT8* pPrefetchMip,
+    RectF* pVisibleRegion,
+    RectF* pPrefetchRegion)
 {
     float ImageScale = (pImage->Bounds.Right - pImage->Bounds.Left) * m_pSceneCamera->GetZoom();
     UINT8 RequiredMip = (UINT8)CalculateRequiredMipLevel(pImage->pResource, ImageScale);
@@ -522,6 +528,18 @@ void D3D12MemoryManagement::CalculateImagePagingData(const RectF* pViewportBound
 
     *pVisibleMip = VisibleMip;
     *pPrefetchMip = PrefetchMip;
+
+    //
+    // Calculate the parts of the image that are visible and within the prefetch distance.
+    // In tiled residency mode, only the tiles covering these regions are paged in.
+    //
+    static const RectF EmptyRegion = {};
+
+    RectF PrefetchBounds = *pViewportBounds;
+    InflateRectangle(PrefetchBounds, ScaledPrefetchDistance);
+
+    *pVisibleRegion = IsVisible ? CalculateImageRegion(pImage->Bounds, *pViewportBounds) : EmptyRegion;
+    *pPrefetchRegion = IsNearlyVisible ? CalculateImageRegion(pImage->Bounds, PrefetchBounds) : EmptyRegion;
 }
 
 HRESULT D3D12MemoryManagement::RenderScene(const RectF& ViewportBounds)
@@ -537,13 +555,23 @@ HRESULT D3D12MemoryManagement::RenderScene(const RectF& ViewportBounds)
         //
         UINT8 VisibleMip;
         UINT8 PrefetchMip;
-        CalculateImagePagingData(&SceneBounds, &Img, &VisibleMip, &PrefetchMip);
+        RectF VisibleRegion;
+        RectF PrefetchRegion;
+        CalculateImagePagingData(&SceneBounds, &Img, &VisibleMip, &PrefetchMip, &VisibleRegion, &PrefetchRegion);
 
         //
         // If the visibility or prefetch values have changed, notify the paging thread
-        // so it can update this resource's priority.
+        // so it can update this resource's priority. In tiled residency mode, a change
+        // in the visible or prefetch regions may require new tiles as well.
         //
-        if (pResource->VisibleMip != VisibleMip || pResource->PrefetchMip != PrefetchMip)
+        bool RegionsChanged = UsesTiledResidency(pResource) &&
+            (memcmp(&pResource->VisibleRegion, &VisibleRegion, sizeof(RectF)) != 0 ||
+             memcmp(&pResource->PrefetchRegion, &PrefetchRegion, sizeof(RectF)) != 0);
+
+        pResource->VisibleRegion = VisibleRegion;
+        pResource->PrefetchRegion = PrefetchRegion;
+
+        if (pResource->VisibleMip != VisibleMip || pResource->PrefetchMip != PrefetchMip || RegionsChanged)
         {
             pResource->VisibleMip = VisibleMip;
             pResource->PrefetchMip = PrefetchMip;
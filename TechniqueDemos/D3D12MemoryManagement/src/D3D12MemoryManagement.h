@@ -84,7 +84,9 @@ protected:
         const RectF* pViewportBounds,
         const Image* pImage,
         UINT8* pVisibleMip,
-        UINT8* pPrefetchMip);
+        UINT8* pPrefetchMip,
+        RectF* pVisibleRegion,
+        RectF* pPrefetchRegion);
 
 public:
     D3D12MemoryManagement();
@@ -18,12 +18,6 @@
 
 #define SWAPCHAIN_BACK_BUFFER_FORMAT DXGI_FORMAT_R8G8B8A8_UNORM
 
-//
-// Maximum size of a single paging operation. Mipmaps greater than 32MB in size will be
-// broken up into multiple transfers.
-//
-#define MAX_TRANSFER_SIZE _32MB
-
 LRESULT CALLBACK WndProc(HWND hwnd, UINT Message, WPARAM wParam, LPARAM lParam)
 {
     DX12Framework* pApplication = (DX12Framework*)GetWindowLongPtr(hwnd, GWLP_USERDATA);
@@ -291,6 +285,27 @@ void DX12Framework::DestroyResourceDeviceState(Resource* pResource)
             SafeRelease(pDeviceState->Mips[0].ppHeaps[i]);
         }
         delete[] pDeviceState->Mips[0].ppHeaps;
+
+        //
+        // Return any resident tiles to the tile pool. The tile slot lists of all standard
+        // mipmaps share a single allocation.
+        //
+        if (pDeviceState->Mips[0].pTileSlots)
+        {
+            for (UINT8 Mip = 0; Mip < pResource->PackedMipHeapIndex; ++Mip)
+            {
+                ResourceMip* pResourceMip = &pDeviceState->Mips[Mip];
+                UINT NumTiles = pResourceMip->Desc.WidthInTiles * pResourceMip->Desc.HeightInTiles;
+                for (UINT i = 0; i < NumTiles; ++i)
+                {
+                    if (pResourceMip->pTileSlots[i] != TILE_NOT_RESIDENT)
+                    {
+                        FreeTileSlot(pResourceMip->pTileSlots[i]);
+                    }
+                }
+            }
+            delete[] pDeviceState->Mips[0].pTileSlots;
+        }
         free(pDeviceState);
         pResource->pDeviceState = nullptr;
     }
@@ -713,6 +728,8 @@ void DX12Framework::DestroyDeviceDependentStateInternal()
         }
     }
 
+    DestroyTilePool();
+
     {
         LIST_ENTRY* pVersionedBufferEntry = m_DynamicBufferListHead.Flink;
         while (pVersionedBufferEntry != &m_DynamicBufferListHead)
@@ -1267,6 +1284,7 @@ HRESULT DX12Framework::CreateResourceDeviceState(Resource* pResource, UINT NumMi
 
     ID3D12Resource* pTiledResource = nullptr;
     ID3D12Heap** ppHeaps = nullptr;
+    UINT* pTileSlots = nullptr;
     ResourceDeviceState* pDeviceState = nullptr;
 
     //
@@ -1315,9 +1333,10 @@ HRESULT DX12Framework::CreateResourceDeviceState(Resource* pResource, UINT NumMi
     //
     UINT NumTiles;
     D3D12_PACKED_MIP_INFO PackedMipInfo;
+    D3D12_TILE_SHAPE TileShape;
     D3D12_SUBRESOURCE_TILING SubresourceTiling[MAX_MIP_COUNT];
     UINT NumResourceTilings = MAX_MIP_COUNT;
-    m_pDevice->GetResourceTiling(pTiledResource, &NumTiles, &PackedMipInfo, nullptr, &NumResourceTilings, 0, SubresourceTiling);
+    m_pDevice->GetResourceTiling(pTiledResource, &NumTiles, &PackedMipInfo, &TileShape, &NumResourceTilings, 0, SubresourceTiling);
 
     //
     // Save off the number of packed and non-packed (standard) mipmaps.
@@ -1412,8 +1431,48 @@ HRESULT DX12Framework::CreateResourceDeviceState(Resource* pResource, UINT NumMi
         pDeviceState->Mips[i].ppHeaps = ppHeaps + pDeviceState->Mips[i].Desc.HeapStartIndex;
     }
 
+    //
+    // In tiled residency mode, allocate the tile slot list for every standard mipmap.
+    // None of the tiles are resident yet.
+    //
+    if (m_bTiledResidency && PackedMipInfo.NumPackedMips > 0 && NumberOfStandardMipIndices > 0)
+    {
+        UINT NumStandardTiles = 0;
+        for (size_t i = 0; i < NumberOfStandardMipIndices; ++i)
+        {
+            NumStandardTiles += pDeviceState->Mips[i].Desc.WidthInTiles * pDeviceState->Mips[i].Desc.HeightInTiles;
+        }
+
+        try
+        {
+            pTileSlots = new UINT[NumStandardTiles];
+        }
+        catch (std::bad_alloc&)
+        {
+            LOG_ERROR("Out of memory allocating tile slot array");
+            hr = E_OUTOFMEMORY;
+            goto cleanup;
+        }
+
+        for (UINT i = 0; i < NumStandardTiles; ++i)
+        {
+            pTileSlots[i] = TILE_NOT_RESIDENT;
+        }
+
+        UINT* pMipTileSlots = pTileSlots;
+        for (size_t i = 0; i < NumberOfStandardMipIndices; ++i)
+        {
+            pDeviceState->Mips[i].pTileSlots = pMipTileSlots;
+            pMipTileSlots += pDeviceState->Mips[i].Desc.WidthInTiles * pDeviceState->Mips[i].Desc.HeightInTiles;
+        }
+    }
+
     pDeviceState->pD3DResource = pTiledResource;
     pDeviceState->NumHeaps = CurrentHeapCount;
+    pDeviceState->Width = Width;
+    pDeviceState->Height = Height;
+    pDeviceState->TileWidthInTexels = TileShape.WidthInTexels;
+    pDeviceState->TileHeightInTexels = TileShape.HeightInTexels;
 
     pResource->PackedMipTileCount = PackedMipInfo.NumTilesForPackedMips;
     pResource->NumStandardMips = PackedMipInfo.NumStandardMips;
@@ -1452,6 +1511,10 @@ cleanup:
     {
         delete[] ppHeaps;
     }
+    if (pTileSlots)
+    {
+        delete[] pTileSlots;
+    }
     SafeRelease(pTiledResource);
 
     if (pDeviceState)
@@ -1554,31 +1617,17 @@ HRESULT DX12Framework::GetBitmapFrameInfo(IWICBitmapFrameDecode* pFrame, BitmapF
 }
 
 //
-// LoadMip is in charge of creating resource data. If necessary, LoadMip will create the
-// heaps (physical memory) for the mipmap, update the virtual address mappings, and copy
-// the pixel data from the WIC image source.
+// Opens the image source for a single mipmap of the resource, which is used by LoadMip
+// and LoadTiles to copy pixel data out of the image file.
 //
-HRESULT DX12Framework::LoadMip(Resource* pResource, UINT32 Mip)
+HRESULT DX12Framework::OpenMipSource(Resource* pResource, UINT32 Mip, MipSource* pSource)
 {
     HRESULT hr;
 
-    LOG_MESSAGE("Loading mip %d", Mip);
-
-    UINT32 MipHeap = Mip;
-
-    UINT NumMips = GetResourceMipCount(pResource);
-    if (Mip >= NumMips)
-    {
-        LOG_WARNING("Trying to load mip %d for pResource 0x%p, but the image file only contains %d mip levels", Mip, pResource, NumMips);
-        return S_FALSE;
-    }
-
-    BitmapFrameInfo MipFrameInfo = {};
+    BitmapFrameInfo& MipFrameInfo = pSource->FrameInfo;
 
     ComPtr<IWICDdsDecoder> pDdsDecoder;
     ComPtr<IWICBitmapFrameDecode> pBitmapFrame;
-    ComPtr<IWICDdsFrameDecode> pDdsFrame;
-    ComPtr<IWICBitmapSource> pSourceBitmap;
 
     //
     // Different behavior is performed depending on whether this is a generated image,
@@ -1596,14 +1645,14 @@ HRESULT DX12Framework::LoadMip(Resource* pResource, UINT32 Mip)
                 return hr;
             }
 
-            hr = pBitmapFrame.As(&pDdsFrame);
+            hr = pBitmapFrame.As(&pSource->pDdsFrame);
             if (FAILED(hr))
             {
                 LOG_ERROR("Failed to query DDS frame for mip %d, hr=0x%.8x", Mip, hr);
                 return hr;
             }
 
-            hr = GetDdsFrameInfo(pDdsFrame.Get(), &MipFrameInfo);
+            hr = GetDdsFrameInfo(pSource->pDdsFrame.Get(), &MipFrameInfo);
             if (FAILED(hr))
             {
                 LOG_ERROR("Failed to load frame information for mip %d, hr=0x%.8x", Mip, hr);
@@ -1651,7 +1700,7 @@ HRESULT DX12Framework::LoadMip(Resource* pResource, UINT32 Mip)
                 return hr;
             }
 
-            pSourceBitmap = pConverter;
+            pSource->pSourceBitmap = pConverter;
         }
     }
     else
@@ -1665,6 +1714,63 @@ HRESULT DX12Framework::LoadMip(Resource* pResource, UINT32 Mip)
         MipFrameInfo.HeightInBlocks = resourceDesc.Height >> Mip;
     }
 
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT DX12Framework::CopyMipSourceRect(Resource* pResource, const MipSource& Source, WICRect* pRect, UINT RowPitch, UINT BufferSizeInBytes, BYTE* pBuffer)
+{
+    //
+    // The copy differs slightly based on whether or not this is a DDS file with block compressed data.
+    //
+    if (Source.pDdsFrame)
+    {
+        return Source.pDdsFrame->CopyBlocks(pRect, RowPitch, BufferSizeInBytes, pBuffer);
+    }
+    else if (Source.pSourceBitmap)
+    {
+        return Source.pSourceBitmap->CopyPixels(pRect, RowPitch, BufferSizeInBytes, pBuffer);
+    }
+
+    return GenerateMip(
+        pResource->GeneratedImageIndex,
+        Source.FrameInfo.WidthInBlocks,
+        Source.FrameInfo.HeightInBlocks,
+        pRect,
+        RowPitch,
+        BufferSizeInBytes,
+        (UINT*)pBuffer);
+}
+
+//
+// LoadMip is in charge of creating resource data. If necessary, LoadMip will create the
+// heaps (physical memory) for the mipmap, update the virtual address mappings, and copy
+// the pixel data from the WIC image source.
+//
+HRESULT DX12Framework::LoadMip(Resource* pResource, UINT32 Mip)
+{
+    HRESULT hr;
+
+    LOG_MESSAGE("Loading mip %d", Mip);
+
+    UINT32 MipHeap = Mip;
+
+    UINT NumMips = GetResourceMipCount(pResource);
+    if (Mip >= NumMips)
+    {
+        LOG_WARNING("Trying to load mip %d for pResource 0x%p, but the image file only contains %d mip levels", Mip, pResource, NumMips);
+        return S_FALSE;
+    }
+
+    MipSource Source = {};
+    hr = OpenMipSource(pResource, Mip, &Source);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    const BitmapFrameInfo& MipFrameInfo = Source.FrameInfo;
+
     UINT NumTiles;
     UINT WidthInTiles;
 
@@ -1869,21 +1975,7 @@ HRESULT DX12Framework::LoadMip(Resource* pResource, UINT32 Mip)
         SourceRect.Width = MipFrameInfo.WidthInBlocks;
         SourceRect.Height = TransferHeightInBlocks;
 
-        //
-        // The copy differs slightly based on whether or not this is a DDS file with block compressed data.
-        //
-        if (pDdsFrame)
-        {
-            hr = pDdsFrame->CopyBlocks(&SourceRect, Layout.Footprint.RowPitch, Layout.Footprint.RowPitch * TransferHeightInBlocks, ((BYTE*)pUploadData));
-        }
-        else if (pSourceBitmap.Get())
-        {
-            hr = pSourceBitmap->CopyPixels(&SourceRect, Layout.Footprint.RowPitch, Layout.Footprint.RowPitch * TransferHeightInBlocks, ((BYTE*)pUploadData));
-        }
-        else
-        {
-            hr = GenerateMip(pResource->GeneratedImageIndex, &SourceRect, Layout.Footprint.RowPitch, Layout.Footprint.RowPitch * TransferHeightInBlocks, (UINT*)pUploadData);
-        }
+        hr = CopyMipSourceRect(pResource, Source, &SourceRect, Layout.Footprint.RowPitch, Layout.Footprint.RowPitch * TransferHeightInBlocks, (BYTE*)pUploadData);
         if (FAILED(hr))
         {
             LOG_ERROR("Failed to copy frame data to upload staging buffer, hr=0x%.8x", hr);
@@ -1940,12 +2032,12 @@ HRESULT DX12Framework::LoadMip(Resource* pResource, UINT32 Mip)
 }
 
 _Use_decl_annotations_
-HRESULT DX12Framework::GenerateMip(UINT ImageIndex, WICRect* pRect, UINT RowPitch, UINT BufferSizeInBytes, UINT* pBuffer)
+HRESULT DX12Framework::GenerateMip(UINT ImageIndex, UINT MipWidth, UINT MipHeight, WICRect* pRect, UINT RowPitch, UINT BufferSizeInBytes, UINT* pBuffer)
 {
     const UINT RowWidth = RowPitch >> 2;
     const UINT BufferSize = BufferSizeInBytes >> 2;
-    const UINT CellWidth = max(pRect->Width >> 3, 1);        // The width of a cell in the checkboard texture.
-    const UINT CellHeight = max(pRect->Height >> 3, 1);        // The height of a cell in the checkerboard texture.
+    const UINT CellWidth = max(MipWidth >> 3, 1);        // The width of a cell in the checkboard texture.
+    const UINT CellHeight = max(MipHeight >> 3, 1);      // The height of a cell in the checkerboard texture.
     const BYTE Gray = 0x88;
     const UINT Color = GetGeneratedImageColor(ImageIndex);
 
@@ -1960,8 +2052,12 @@ HRESULT DX12Framework::GenerateMip(UINT ImageIndex, WICRect* pRect, UINT RowPitc
         UINT Index = y * RowWidth;
         for (int x = 0; x < pRect->Width; x++)
         {
-            UINT i = x / CellWidth;
-            UINT j = y / CellHeight;
+            //
+            // Cells are sized by the whole mipmap, so that a rectangle covering only part of
+            // it, such as a single tile, still lines up with the rest of the checkerboard.
+            //
+            UINT i = (pRect->X + x) / CellWidth;
+            UINT j = (pRect->Y + y) / CellHeight;
 
             if (i % 2 == j % 2)
             {
@@ -2071,7 +2167,6 @@ void DX12Framework::FillRectangle(const RectF* pDest, const ColorF* pColor)
 void DX12Framework::FillRectangle(const RectF* pDest, const ColorF* pColor, Resource* pResource)
 {
     RenderFrame* pCurrentFrame = m_RenderContext.GetCurrentFrame();
-    ID3D12GraphicsCommandList* pCommandList = pCurrentFrame->pCommandList;
 
     //
     // Texture has not been loaded, use default gray.
@@ -2091,52 +2186,89 @@ void DX12Framework::FillRectangle(const RectF* pDest, const ColorF* pColor, Reso
     UINT Mip = ReferenceResource(pResource, pCurrentFrame, pResource->VisibleMip);
     SetShader(pCurrentFrame, &m_TextureShader);
 
-    typedef TextureShader::VertexFormat VertexType;
+    static const RectF FullTexture = { 0.0f, 0.0f, 1.0f, 1.0f };
+    D3D12_GPU_DESCRIPTOR_HANDLE Srv = CreateMipSrv(pCurrentFrame, pResource, Mip);
+    DrawTexturedQuad(pCurrentFrame, pDest, &FullTexture, pColor, Srv);
 
-    VertexType Vertices[] =
+    //
+    // In tiled residency mode, the rectangle above only shows the packed mipmaps. The more
+    // detailed tiles that are resident are drawn on top of it.
+    //
+    if (UsesTiledResidency(pResource))
     {
-        { { pDest->Left,  pDest->Top,    1.0f }, { 0.0f, 0.0f }, { pColor->R, pColor->G, pColor->B, pColor->A } }, // Top Left
-        { { pDest->Right, pDest->Bottom, 1.0f }, { 1.0f, 1.0f }, { pColor->R, pColor->G, pColor->B, pColor->A } }, // Bottom Right
-        { { pDest->Left,  pDest->Bottom, 1.0f }, { 0.0f, 1.0f }, { pColor->R, pColor->G, pColor->B, pColor->A } }, // Bottom Left
-
-        { { pDest->Right, pDest->Bottom, 1.0f }, { 1.0f, 1.0f }, { pColor->R, pColor->G, pColor->B, pColor->A } }, // Bottom Right
-        { { pDest->Left,  pDest->Top,    1.0f }, { 0.0f, 0.0f }, { pColor->R, pColor->G, pColor->B, pColor->A } }, // Top Left
-        { { pDest->Right, pDest->Top,    1.0f }, { 1.0f, 0.0f }, { pColor->R, pColor->G, pColor->B, pColor->A } }, // Top Right
-    };
-
-    VertexType* pVertices;
-    UINT32 Offset;
-    HRESULT hrVertexBuffer = pCurrentFrame->VertexBuffer.Allocate(sizeof(VertexType), 6, (void**)&pVertices, &Offset);
+        DrawResidentTiles(pCurrentFrame, pDest, pColor, pResource);
+    }
+}
 
+D3D12_GPU_DESCRIPTOR_HANDLE DX12Framework::CreateMipSrv(RenderFrame* pFrame, Resource* pResource, UINT Mip)
+{
     D3D12_GPU_DESCRIPTOR_HANDLE GpuHandle;
     D3D12_CPU_DESCRIPTOR_HANDLE CpuHandle;
-    HRESULT hrSrvDescriptor = pCurrentFrame->SrvCbvHeap.Allocate(1, &GpuHandle, &CpuHandle);
+    HRESULT hrSrvDescriptor = pFrame->SrvCbvHeap.Allocate(1, &GpuHandle, &CpuHandle);
 
-    if (hrVertexBuffer == E_OUTOFMEMORY)
+    if (hrSrvDescriptor == E_OUTOFMEMORY)
     {
         //
-        // If we ran out of space in our vertex buffer, we need to rename it in order to allocate
-        // more vertices. Rename operations are guaranteed to succeed. Although in most cases
-        // the system will have enough memory to simply allocate a new buffer, we are
+        // If we ran out of space in our descriptor heap, we need to rename it in order to
+        // allocate more descriptors. Rename operations are guaranteed to succeed. Although in
+        // most cases the system will have enough memory to simply allocate a new heap, we are
         // capable of simply flushing the pipeline until the last frame was referenced,
-        // allowing us to reuse the current buffer.
+        // allowing us to reuse the current heap.
         //
-        RenameDynamicBuffer(&pCurrentFrame->VertexBuffer);
-        ResetShader(pCurrentFrame);
-        hrVertexBuffer = pCurrentFrame->VertexBuffer.Allocate(sizeof(VertexType), 6, (void**)&pVertices, &Offset);
-        assert(SUCCEEDED(hrVertexBuffer));
+        RenameDynamicDescriptorHeap(&pFrame->SrvCbvHeap);
+        ResetShader(pFrame);
+        hrSrvDescriptor = pFrame->SrvCbvHeap.Allocate(1, &GpuHandle, &CpuHandle);
+        assert(SUCCEEDED(hrSrvDescriptor));
     }
 
-    if (hrSrvDescriptor == E_OUTOFMEMORY)
+    D3D12_SHADER_RESOURCE_VIEW_DESC SrvDesc = {};
+
+    SrvDesc.Texture2D.MostDetailedMip = Mip;
+    SrvDesc.Texture2D.MipLevels = GetResourceMipCount(pResource) - SrvDesc.Texture2D.MostDetailedMip;
+
+    D3D12_RESOURCE_DESC Desc = pResource->pDeviceState->pD3DResource->GetDesc();
+
+    SrvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+    SrvDesc.Format = Desc.Format;
+    SrvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+
+    m_pDevice->CreateShaderResourceView(pResource->pDeviceState->pD3DResource, &SrvDesc, CpuHandle);
+
+    return GpuHandle;
+}
+
+void DX12Framework::DrawTexturedQuad(RenderFrame* pFrame, const RectF* pDest, const RectF* pTexCoords, const ColorF* pColor, D3D12_GPU_DESCRIPTOR_HANDLE Srv)
+{
+    ID3D12GraphicsCommandList* pCommandList = pFrame->pCommandList;
+
+    typedef TextureShader::VertexFormat VertexType;
+
+    const RectF& T = *pTexCoords;
+    VertexType Vertices[] =
+    {
+        { { pDest->Left,  pDest->Top,    1.0f }, { T.Left,  T.Top },    { pColor->R, pColor->G, pColor->B, pColor->A } }, // Top Left
+        { { pDest->Right, pDest->Bottom, 1.0f }, { T.Right, T.Bottom }, { pColor->R, pColor->G, pColor->B, pColor->A } }, // Bottom Right
+        { { pDest->Left,  pDest->Bottom, 1.0f }, { T.Left,  T.Bottom }, { pColor->R, pColor->G, pColor->B, pColor->A } }, // Bottom Left
+
+        { { pDest->Right, pDest->Bottom, 1.0f }, { T.Right, T.Bottom }, { pColor->R, pColor->G, pColor->B, pColor->A } }, // Bottom Right
+        { { pDest->Left,  pDest->Top,    1.0f }, { T.Left,  T.Top },    { pColor->R, pColor->G, pColor->B, pColor->A } }, // Top Left
+        { { pDest->Right, pDest->Top,    1.0f }, { T.Right, T.Top },    { pColor->R, pColor->G, pColor->B, pColor->A } }, // Top Right
+    };
+
+    VertexType* pVertices;
+    UINT32 Offset;
+    HRESULT hrVertexBuffer = pFrame->VertexBuffer.Allocate(sizeof(VertexType), 6, (void**)&pVertices, &Offset);
+
+    if (hrVertexBuffer == E_OUTOFMEMORY)
     {
         //
-        // The same concept applies to descriptor heaps as buffers. We can guarantee
+        // The same concept applies to buffers as descriptor heaps. We can guarantee
         // a successful rename operation and make forward progress at all times.
         //
-        RenameDynamicDescriptorHeap(&pCurrentFrame->SrvCbvHeap);
-        ResetShader(pCurrentFrame);
-        hrSrvDescriptor = pCurrentFrame->SrvCbvHeap.Allocate(1, &GpuHandle, &CpuHandle);
-        assert(SUCCEEDED(hrSrvDescriptor));
+        RenameDynamicBuffer(&pFrame->VertexBuffer);
+        ResetShader(pFrame);
+        hrVertexBuffer = pFrame->VertexBuffer.Allocate(sizeof(VertexType), 6, (void**)&pVertices, &Offset);
+        assert(SUCCEEDED(hrVertexBuffer));
     }
 
     //
@@ -2144,25 +2276,7 @@ void DX12Framework::FillRectangle(const RectF* pDest, const ColorF* pColor, Reso
     //
     memcpy(pVertices, Vertices, sizeof(Vertices));
 
-    //
-    // Assign SRV.
-    //
-    {
-        D3D12_SHADER_RESOURCE_VIEW_DESC SrvDesc = {};
-
-        SrvDesc.Texture2D.MostDetailedMip = Mip;
-        SrvDesc.Texture2D.MipLevels = GetResourceMipCount(pResource) - SrvDesc.Texture2D.MostDetailedMip;
-
-        D3D12_RESOURCE_DESC Desc = pResource->pDeviceState->pD3DResource->GetDesc();
-
-        SrvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-        SrvDesc.Format = Desc.Format;
-        SrvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-
-        m_pDevice->CreateShaderResourceView(pResource->pDeviceState->pD3DResource, &SrvDesc, CpuHandle);
-    }
-
-    pCommandList->SetGraphicsRootDescriptorTable(1, GpuHandle);
+    pCommandList->SetGraphicsRootDescriptorTable(1, Srv);
     pCommandList->DrawInstanced(6, 1, Offset / sizeof(VertexType), 0);
 }
 
@@ -2481,6 +2595,15 @@ HRESULT DX12Framework::PageInNextLevelOfDetail(Resource* pResource)
     UINT8 ResidentMip = pResource->MostDetailedMipResident;
     assert(ResidentMip != 0);
 
+    //
+    // Once the packed mipmaps are resident, tiled residency pages in tiles of the
+    // standard mipmaps instead of whole mipmaps.
+    //
+    if (UsesTiledResidency(pResource) && ResidentMip == pResource->PackedMipHeapIndex)
+    {
+        return PageInTiles(pResource);
+    }
+
     UINT8 Mip = ResidentMip - 1;
 
     assert(IsMoreDetailedMip(ResidentMip, Mip));
@@ -2571,6 +2694,14 @@ bool DX12Framework::TrimToTarget(ResourceTrimPass MaxPass, UINT64 TargetUsage)
     // by allowing the paging thread to issue trimming calls to page in the visible mip,
     // which may trim the prefetched mip.
     //
+    // In tiled residency mode, tiles are trimmed first. Resources without packed mipmaps
+    // still page whole mipmaps, and are trimmed below.
+    //
+    if (m_bTiledResidency && TrimTilesToTarget(MaxPass, TargetUsage))
+    {
+        return true;
+    }
+
     for (ResourceTrimPass CurrentPass = ERTP_NonPrefetchable;
         CurrentPass <= MaxPass;
         CurrentPass = static_cast<ResourceTrimPass>(CurrentPass + 1))
@@ -2728,5 +2859,9 @@ void DX12Framework::LoadConfig(int argc, LPCSTR argv[])
         {
             m_bUseSharedStagingSurface = true;
         }
+        else if (_strcmpi(pArg, "-tiledresidency") == 0)
+        {
+            m_bTiledResidency = true;
+        }
     }
 }
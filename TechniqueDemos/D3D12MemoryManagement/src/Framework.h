@@ -49,6 +49,27 @@ struct BitmapFrameInfo
     GUID TargetPixelFormat;
 };
 
+//
+// The decoder state used to copy pixel data out of a single mipmap of an image. Generated
+// images have neither a DDS frame nor a source bitmap.
+//
+struct MipSource
+{
+    BitmapFrameInfo FrameInfo;
+    ComPtr<IWICDdsFrameDecode> pDdsFrame;
+    ComPtr<IWICBitmapSource> pSourceBitmap;
+};
+
+//
+// A heap in the tile pool used by tiled residency mode. Each bit of the free mask
+// corresponds to one tile in the heap, and is set while that tile is unused.
+//
+struct TilePoolHeap
+{
+    ID3D12Heap* pHeap;
+    UINT FreeMask;
+};
+
 class DX12Framework
 {
     friend class RenderContext;
@@ -82,11 +103,28 @@ private:
     void TrimMip(Resource* pResource, UINT8 Mip);
     HRESULT GetDdsFrameInfo(IWICDdsFrameDecode* pFrame, BitmapFrameInfo* pFormatInfo);
     HRESULT GetBitmapFrameInfo(IWICBitmapFrameDecode* pFrame, BitmapFrameInfo* pFormatInfo);
+    HRESULT OpenMipSource(Resource* pResource, UINT32 Mip, MipSource* pSource);
+    HRESULT CopyMipSourceRect(Resource* pResource, const MipSource& Source, WICRect* pRect, UINT RowPitch, UINT BufferSizeInBytes, _Out_writes_bytes_(BufferSizeInBytes) BYTE* pBuffer);
     HRESULT LoadMip(Resource* pResource, UINT32 Mip);
-    HRESULT GenerateMip(UINT ImageIndex, WICRect* pRect, UINT RowPitch, UINT BufferSizeInBytes, _In_reads_bytes_(BufferSizeInBytes) UINT* pBuffer);
+    HRESULT GenerateMip(UINT ImageIndex, UINT MipWidth, UINT MipHeight, WICRect* pRect, UINT RowPitch, UINT BufferSizeInBytes, _In_reads_bytes_(BufferSizeInBytes) UINT* pBuffer);
     void RemoveResourceCommitment(Resource* pResource);
     void AddResourceCommitment(Resource* pResource);
 
+    //
+    // Tiled residency
+    //
+    HRESULT AllocateTileSlot(UINT* pSlot);
+    void FreeTileSlot(UINT Slot);
+    void ReleaseEmptyTileHeaps();
+    void DestroyTilePool();
+    HRESULT LoadTiles(Resource* pResource, UINT8 Mip, _In_reads_(NumTiles) const UINT* pTiles, UINT NumTiles);
+    HRESULT PageInTiles(Resource* pResource);
+    void TrimTile(Resource* pResource, UINT8 Mip, UINT Tile);
+    bool TrimTilesToTarget(ResourceTrimPass MaxPass, UINT64 TargetUsage);
+    void DrawResidentTiles(RenderFrame* pFrame, const RectF* pDest, const ColorF* pColor, Resource* pResource);
+    D3D12_GPU_DESCRIPTOR_HANDLE CreateMipSrv(RenderFrame* pFrame, Resource* pResource, UINT Mip);
+    void DrawTexturedQuad(RenderFrame* pFrame, const RectF* pDest, const RectF* pTexCoords, const ColorF* pColor, D3D12_GPU_DESCRIPTOR_HANDLE Srv);
+
 
     //
     // Dynamic buffers
@@ -178,6 +216,12 @@ protected:
     LIST_ENTRY m_UncommittedListHead;
     LIST_ENTRY m_CommitmentListHeads[MAX_MIP_COUNT];
 
+    //
+    // Tile pool for tiled residency mode. Released heaps leave null entries, which
+    // are reused before the pool grows.
+    //
+    std::vector<TilePoolHeap> m_TilePool;
+
     TextureShader m_TextureShader;
     ColorShader m_ColorShader;
     const Shader* m_pCurrentShader = nullptr;
@@ -204,6 +248,7 @@ protected:
     UINT m_GlitchCount = 0;
 
     bool m_bUseSharedStagingSurface = false;
+    bool m_bTiledResidency = false;
     bool m_bPresentOnVsync = true;
 
     HRESULT m_SimulatedRenderResult = S_OK;
@@ -250,11 +295,22 @@ public:
     }
     HRESULT PageInNextLevelOfDetail(Resource* pResource);
     bool TrimToTarget(ResourceTrimPass TrimLimit, UINT64 TargetUsage);
+    UINT FindMissingTiles(Resource* pResource, UINT8 FinestMip, const RectF& Region, UINT8* pMip, _Out_writes_opt_(MaxTiles) UINT* pTiles, UINT MaxTiles);
     inline bool TrimToBudget(ResourceTrimPass TrimLimit)
     {
         return TrimToTarget(TrimLimit, m_LocalVideoMemoryInfo.Budget);
     }
 
+    //
+    // In tiled residency mode, standard mipmaps of resources with packed mipmaps are
+    // committed one tile at a time, as the tiles become visible or fall within the
+    // prefetch region, instead of a whole mipmap at a time.
+    //
+    inline bool UsesTiledResidency(const Resource* pResource) const
+    {
+        return m_bTiledResidency && pResource->NumPackedMips != 0;
+    }
+
     //
     // Camera
     //
@@ -372,6 +372,27 @@ void PagingWorkerThread::PrioritizeResource(Resource* pResource)
     bool AnyPackedMipsMissing = MostDetailedMipResident > GetLeastDetailedMipHeapIndex(pResource);
     bool IsInPrefetchZone = (PrefetchMip != UNDEFINED_MIPMAP_INDEX);
 
+    if (!AnyPackedMipsMissing && m_pFramework->UsesTiledResidency(pResource))
+    {
+        //
+        // In tiled residency mode, the standard mipmaps are paged in a batch of tiles at
+        // a time, and only the tiles covering the visible and prefetch regions are wanted.
+        // Tiles outside of these regions are never prefetched at low priority.
+        //
+        UINT8 Mip;
+        if (m_pFramework->FindMissingTiles(pResource, VisibleMip, pResource->VisibleRegion, &Mip, nullptr, 1) > 0)
+        {
+            InsertTailList(&m_PriorityQueues[ERP_High], &pResource->PagingEntry);
+            pResource->TrimLimit = ERTP_NonVisible;
+        }
+        else if (m_pFramework->FindMissingTiles(pResource, PrefetchMip, pResource->PrefetchRegion, &Mip, nullptr, 1) > 0)
+        {
+            InsertTailList(&m_PriorityQueues[ERP_Medium], &pResource->PagingEntry);
+            pResource->TrimLimit = ERTP_NonPrefetchable;
+        }
+        return;
+    }
+
     if (AnyPackedMipsMissing && IsInPrefetchZone)
     {
         //
@@ -471,7 +492,17 @@ Resource* PagingWorkerThread::SelectResource()
             UINT64 MipSize = 0;
             if (NextMip < pResource->PackedMipHeapIndex)
             {
-                MipSize = GetNonPackedMipSize(pResource, NextMip);
+                //
+                // In tiled residency mode, at most one batch of tiles is committed per operation.
+                //
+                if (m_pFramework->UsesTiledResidency(pResource))
+                {
+                    MipSize = MAX_TILES_PER_PAGING_OPERATION * TILE_SIZE;
+                }
+                else
+                {
+                    MipSize = GetNonPackedMipSize(pResource, NextMip);
+                }
             }
 
             //
@@ -37,6 +37,11 @@ struct ResourceMip
     MipDescription Desc;
     ID3D12Heap** ppHeaps;
     UINT64 ReferenceFence;
+
+    // In tiled residency mode, the tile pool slot backing each tile of a standard
+    // mipmap, in row-major order. Tiles which are not committed are TILE_NOT_RESIDENT.
+    UINT* pTileSlots;
+    UINT NumResidentTiles;
 };
 
 //
@@ -80,6 +85,12 @@ struct ResourceDeviceState
     ID3D12Resource* pD3DResource;
     UINT32 NumHeaps;
 
+    // The dimensions of the most detailed mipmap, and of a single tile, in texels.
+    UINT Width;
+    UINT Height;
+    UINT TileWidthInTexels;
+    UINT TileHeightInTexels;
+
     //
     // Mips must always be the last element, since it is actually a dynamic array.
     // The actual count of the array is equal to the number of unique mip heaps.
@@ -163,6 +174,12 @@ struct Resource
     // priority resources from trimming higher priority ones.
     ResourceTrimPass TrimLimit;
 
+    // The regions of the resource, in texture coordinates, which are visible on screen
+    // and which should be prefetched. In tiled residency mode, the paging thread only
+    // commits the tiles covering these regions.
+    RectF VisibleRegion;
+    RectF PrefetchRegion;
+
     //
     // Device dependent state information.
     //
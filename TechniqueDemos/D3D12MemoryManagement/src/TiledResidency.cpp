@@ -0,0 +1,662 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "stdafx.h"
+
+//
+//-------------------------------------------------------------------------------------------------
+// Tiled residency mode (-tiledresidency) commits the standard mipmaps of a resource one 64KB
+// tile at a time, instead of a whole mipmap at a time. The render thread reports the regions of
+// each resource that are visible on screen and that fall within the prefetch distance, and the
+// paging thread commits only the tiles covering those regions, working on tiles with the same
+// priorities it otherwise uses for whole mipmaps.
+//
+// Tiles are always paged in from the least detailed mipmap to the most detailed one, and are
+// always trimmed from the most detailed mipmap first, so that the parent of a resident tile is
+// always resident. The packed mipmaps are still paged in whole, as the minimum working set.
+//-------------------------------------------------------------------------------------------------
+//
+
+static const UINT AllPoolTilesFree = (1u << TILES_PER_POOL_HEAP) - 1;
+
+HRESULT DX12Framework::AllocateTileSlot(UINT* pSlot)
+{
+    //
+    // Tiles are handed out from the first heap with any free tiles, which keeps the pool
+    // packed into as few heaps as possible, so that trimming is more likely to empty one.
+    //
+    size_t ReleasedIndex = m_TilePool.size();
+    for (size_t i = 0; i < m_TilePool.size(); ++i)
+    {
+        TilePoolHeap& PoolHeap = m_TilePool[i];
+        if (PoolHeap.pHeap == nullptr)
+        {
+            ReleasedIndex = min(ReleasedIndex, i);
+            continue;
+        }
+
+        if (PoolHeap.FreeMask != 0)
+        {
+            DWORD Index;
+            _BitScanForward(&Index, PoolHeap.FreeMask);
+            PoolHeap.FreeMask &= ~(1u << Index);
+
+            *pSlot = static_cast<UINT>(i) * TILES_PER_POOL_HEAP + Index;
+            return S_OK;
+        }
+    }
+
+    //
+    // Every heap in the pool is full, so create a new one. The heap carries the same
+    // restrictions as the heaps used for whole mipmaps.
+    //
+    D3D12_HEAP_DESC heapDesc = {};
+    heapDesc.SizeInBytes = TILE_POOL_HEAP_SIZE;
+    heapDesc.Alignment = 0;
+    heapDesc.Properties.Type = D3D12_HEAP_TYPE_DEFAULT;
+    heapDesc.Properties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+    heapDesc.Properties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+    heapDesc.Flags = D3D12_HEAP_FLAG_DENY_RT_DS_TEXTURES | D3D12_HEAP_FLAG_DENY_BUFFERS;
+
+    ID3D12Heap* pHeap;
+    HRESULT hr = m_pDevice->CreateHeap(&heapDesc, IID_PPV_ARGS(&pHeap));
+    if (FAILED(hr))
+    {
+        LOG_ERROR("Failed to create D3D12 tile pool heap, hr=0x%.8x", hr);
+        return hr;
+    }
+
+    TilePoolHeap NewHeap = { pHeap, AllPoolTilesFree & ~1u };
+    if (ReleasedIndex < m_TilePool.size())
+    {
+        m_TilePool[ReleasedIndex] = NewHeap;
+    }
+    else
+    {
+        try
+        {
+            m_TilePool.push_back(NewHeap);
+        }
+        catch (std::bad_alloc&)
+        {
+            LOG_ERROR("Out of memory growing the tile pool");
+            pHeap->Release();
+            return E_OUTOFMEMORY;
+        }
+    }
+
+    *pSlot = static_cast<UINT>(ReleasedIndex) * TILES_PER_POOL_HEAP;
+    return S_OK;
+}
+
+void DX12Framework::FreeTileSlot(UINT Slot)
+{
+    TilePoolHeap& PoolHeap = m_TilePool[Slot / TILES_PER_POOL_HEAP];
+    assert((PoolHeap.FreeMask & (1u << (Slot % TILES_PER_POOL_HEAP))) == 0);
+
+    PoolHeap.FreeMask |= 1u << (Slot % TILES_PER_POOL_HEAP);
+}
+
+void DX12Framework::ReleaseEmptyTileHeaps()
+{
+    //
+    // Freeing a tile does not reduce the process's memory usage until every tile in its
+    // heap is free, and the heap itself is released.
+    //
+    bool bAnyEmpty = false;
+    for (const TilePoolHeap& PoolHeap : m_TilePool)
+    {
+        bAnyEmpty |= (PoolHeap.pHeap && PoolHeap.FreeMask == AllPoolTilesFree);
+    }
+
+    if (!bAnyEmpty)
+    {
+        return;
+    }
+
+    //
+    // The tiles were unmapped on the paging queue, so an empty paging frame is flushed
+    // to make sure the queue no longer references the heaps before they are released.
+    //
+    m_PagingContext.Begin();
+    m_PagingContext.Execute();
+    m_PagingContext.End();
+    m_PagingContext.Flush();
+
+    for (TilePoolHeap& PoolHeap : m_TilePool)
+    {
+        if (PoolHeap.pHeap && PoolHeap.FreeMask == AllPoolTilesFree)
+        {
+            SafeRelease(PoolHeap.pHeap);
+        }
+    }
+}
+
+void DX12Framework::DestroyTilePool()
+{
+    for (TilePoolHeap& PoolHeap : m_TilePool)
+    {
+        SafeRelease(PoolHeap.pHeap);
+    }
+    m_TilePool.clear();
+}
+
+_Use_decl_annotations_
+UINT DX12Framework::FindMissingTiles(Resource* pResource, UINT8 FinestMip, const RectF& Region, UINT8* pMip, UINT* pTiles, UINT MaxTiles)
+{
+    if (FinestMip == UNDEFINED_MIPMAP_INDEX)
+    {
+        return 0;
+    }
+
+    //
+    // Search from the least detailed standard mipmap down to the requested one, and return
+    // the missing tiles from the first mipmap that has any. This guarantees that a tile's
+    // parent is resident before the tile itself is paged in.
+    //
+    for (int Mip = static_cast<int>(pResource->PackedMipHeapIndex) - 1; Mip >= static_cast<int>(FinestMip); --Mip)
+    {
+        RECT TileRange;
+        if (!GetTileRangeForRegion(pResource, static_cast<UINT8>(Mip), Region, &TileRange))
+        {
+            return 0;
+        }
+
+        const ResourceMip* pResourceMip = &pResource->pDeviceState->Mips[Mip];
+        UINT WidthInTiles = pResourceMip->Desc.WidthInTiles;
+        UINT NumTiles = 0;
+
+        for (LONG y = TileRange.top; y < TileRange.bottom && NumTiles < MaxTiles; ++y)
+        {
+            for (LONG x = TileRange.left; x < TileRange.right && NumTiles < MaxTiles; ++x)
+            {
+                UINT Tile = y * WidthInTiles + x;
+                if (pResourceMip->pTileSlots[Tile] == TILE_NOT_RESIDENT)
+                {
+                    if (pTiles)
+                    {
+                        pTiles[NumTiles] = Tile;
+                    }
+                    ++NumTiles;
+                }
+            }
+        }
+
+        if (NumTiles > 0)
+        {
+            *pMip = static_cast<UINT8>(Mip);
+            return NumTiles;
+        }
+    }
+
+    return 0;
+}
+
+HRESULT DX12Framework::PageInTiles(Resource* pResource)
+{
+    UINT Tiles[MAX_TILES_PER_PAGING_OPERATION];
+    UINT8 Mip;
+
+    //
+    // Visible tiles always take precedence over prefetched ones.
+    //
+    UINT NumTiles = FindMissingTiles(pResource, pResource->VisibleMip, pResource->VisibleRegion, &Mip, Tiles, _countof(Tiles));
+    if (NumTiles == 0)
+    {
+        NumTiles = FindMissingTiles(pResource, pResource->PrefetchMip, pResource->PrefetchRegion, &Mip, Tiles, _countof(Tiles));
+    }
+
+    if (NumTiles == 0)
+    {
+        return S_OK;
+    }
+
+    return LoadTiles(pResource, Mip, Tiles, NumTiles);
+}
+
+_Use_decl_annotations_
+HRESULT DX12Framework::LoadTiles(Resource* pResource, UINT8 Mip, const UINT* pTiles, UINT NumTiles)
+{
+    HRESULT hr;
+
+    LOG_MESSAGE("Loading %d tiles of mip %d", NumTiles, Mip);
+
+    assert(NumTiles <= MAX_TILES_PER_PAGING_OPERATION);
+
+    ResourceDeviceState* pDeviceState = pResource->pDeviceState;
+    ResourceMip* pResourceMip = &pDeviceState->Mips[Mip];
+    UINT WidthInTiles = pResourceMip->Desc.WidthInTiles;
+
+    MipSource Source = {};
+    hr = OpenMipSource(pResource, Mip, &Source);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    const BitmapFrameInfo& MipFrameInfo = Source.FrameInfo;
+
+    //
+    // Each tile is staged in its own footprint in the upload buffer, so the whole batch can
+    // be transferred with a single paging frame.
+    //
+    D3D12_RESOURCE_DESC Desc = pDeviceState->pD3DResource->GetDesc();
+
+    D3D12_PLACED_SUBRESOURCE_FOOTPRINT MipLayout;
+    UINT NumRows;
+    UINT64 RowSizeInBytes;
+    m_pDevice->GetCopyableFootprints(&Desc, Mip, 1, 0, &MipLayout, &NumRows, &RowSizeInBytes, nullptr);
+
+    UINT BytesPerBlock = static_cast<UINT>(RowSizeInBytes / MipFrameInfo.WidthInBlocks);
+    UINT TileWidthInBlocks = pDeviceState->TileWidthInTexels / MipFrameInfo.BlockWidth;
+    UINT TileHeightInBlocks = pDeviceState->TileHeightInTexels / MipFrameInfo.BlockHeight;
+
+    UINT TileRowPitch = TileWidthInBlocks * BytesPerBlock;
+    TileRowPitch = (TileRowPitch + D3D12_TEXTURE_DATA_PITCH_ALIGNMENT - 1) & ~(D3D12_TEXTURE_DATA_PITCH_ALIGNMENT - 1);
+
+    UINT TileUploadSize = TileRowPitch * TileHeightInBlocks;
+    TileUploadSize = (TileUploadSize + D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT - 1) & ~(D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT - 1);
+    UINT64 UploadBufferSize = static_cast<UINT64>(TileUploadSize) * NumTiles;
+
+    ID3D12Resource* pUploadSurface;
+    void* pUploadData;
+
+    //
+    // A batch of tiles is always much smaller than MAX_TRANSFER_SIZE, so it fits in the
+    // shared staging surface when it is enabled.
+    //
+    ComPtr<ID3D12Resource> pUploadBuffer;
+    if (m_bUseSharedStagingSurface)
+    {
+        pUploadSurface = m_pStagingSurface;
+        pUploadData = m_pStagingSurfaceData;
+    }
+    else
+    {
+        hr = m_pDevice->CreateCommittedResource(
+            &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+            D3D12_HEAP_FLAG_NONE,
+            &CD3DX12_RESOURCE_DESC::Buffer(UploadBufferSize),
+            D3D12_RESOURCE_STATE_GENERIC_READ,
+            nullptr,
+            IID_PPV_ARGS(&pUploadBuffer));
+        if (FAILED(hr))
+        {
+            LOG_ERROR("Failed to create upload buffer, hr=0x%.8x", hr);
+            return hr;
+        }
+
+        CD3DX12_RANGE readRange(0, 0);
+        hr = pUploadBuffer->Map(0, &readRange, &pUploadData);
+        if (FAILED(hr))
+        {
+            LOG_ERROR("Failed to map upload buffer, hr=0x%.8x", hr);
+            return hr;
+        }
+
+        pUploadSurface = pUploadBuffer.Get();
+    }
+
+    m_PagingContext.Begin();
+    Frame* pPagingFrame = m_PagingContext.GetCurrentFrame();
+
+    UINT Slots[MAX_TILES_PER_PAGING_OPERATION];
+    UINT NumLoaded = 0;
+
+    for (; NumLoaded < NumTiles; ++NumLoaded)
+    {
+        UINT Tile = pTiles[NumLoaded];
+        UINT X = Tile % WidthInTiles;
+        UINT Y = Tile / WidthInTiles;
+
+        hr = AllocateTileSlot(&Slots[NumLoaded]);
+        if (FAILED(hr))
+        {
+            break;
+        }
+
+        //
+        // Tiles along the right and bottom edges of the mipmap may only be partially filled.
+        //
+        WICRect SourceRect;
+        SourceRect.X = X * TileWidthInBlocks;
+        SourceRect.Y = Y * TileHeightInBlocks;
+        SourceRect.Width = min(TileWidthInBlocks, MipFrameInfo.WidthInBlocks - SourceRect.X);
+        SourceRect.Height = min(TileHeightInBlocks, MipFrameInfo.HeightInBlocks - SourceRect.Y);
+
+        UINT UploadOffset = NumLoaded * TileUploadSize;
+        hr = CopyMipSourceRect(pResource, Source, &SourceRect, TileRowPitch, TileRowPitch * SourceRect.Height, (BYTE*)pUploadData + UploadOffset);
+        if (FAILED(hr))
+        {
+            LOG_ERROR("Failed to copy tile data to upload staging buffer, hr=0x%.8x", hr);
+            FreeTileSlot(Slots[NumLoaded]);
+            break;
+        }
+
+        //
+        // Map the tile to its slot in the tile pool, then copy its texels in.
+        //
+        D3D12_TILED_RESOURCE_COORDINATE Coordinates = {};
+        Coordinates.Subresource = Mip;
+        Coordinates.X = X;
+        Coordinates.Y = Y;
+
+        D3D12_TILE_REGION_SIZE RegionSize = {};
+        RegionSize.NumTiles = 1;
+
+        D3D12_TILE_RANGE_FLAGS RangeFlags = D3D12_TILE_RANGE_FLAG_NONE;
+        UINT RangeOffset = Slots[NumLoaded] % TILES_PER_POOL_HEAP;
+        UINT RangeCount = 1;
+        m_PagingContext.GetCommandQueue()->UpdateTileMappings(
+            pDeviceState->pD3DResource,
+            1,
+            &Coordinates,
+            &RegionSize,
+            m_TilePool[Slots[NumLoaded] / TILES_PER_POOL_HEAP].pHeap,
+            1,
+            &RangeFlags,
+            &RangeOffset,
+            &RangeCount,
+            D3D12_TILE_MAPPING_FLAG_NO_HAZARD);
+
+        D3D12_PLACED_SUBRESOURCE_FOOTPRINT TileLayout = {};
+        TileLayout.Offset = UploadOffset;
+        TileLayout.Footprint.Format = Desc.Format;
+        TileLayout.Footprint.Width = SourceRect.Width * MipFrameInfo.BlockWidth;
+        TileLayout.Footprint.Height = SourceRect.Height * MipFrameInfo.BlockHeight;
+        TileLayout.Footprint.Depth = 1;
+        TileLayout.Footprint.RowPitch = TileRowPitch;
+
+        CD3DX12_TEXTURE_COPY_LOCATION Dst(pDeviceState->pD3DResource, Mip);
+        CD3DX12_TEXTURE_COPY_LOCATION Src(pUploadSurface, TileLayout);
+        pPagingFrame->pCommandList->CopyTextureRegion(&Dst, X * pDeviceState->TileWidthInTexels, Y * pDeviceState->TileHeightInTexels, 0, &Src, nullptr);
+    }
+
+    HRESULT hrExecute = m_PagingContext.Execute();
+    m_PagingContext.End();
+    m_PagingContext.Flush();
+
+    if (FAILED(hrExecute))
+    {
+        LOG_WARNING("Failed to transfer tiles for resource 0x%p, mip %d. hr=0x%.8x", pResource, Mip, hrExecute);
+        for (UINT i = 0; i < NumLoaded; ++i)
+        {
+            FreeTileSlot(Slots[i]);
+        }
+        return hrExecute;
+    }
+
+    //
+    // The tiles are only published to the render thread once their contents have been
+    // transferred.
+    //
+    EnterCriticalSection(&pResource->ReferenceLock);
+    for (UINT i = 0; i < NumLoaded; ++i)
+    {
+        pResourceMip->pTileSlots[pTiles[i]] = Slots[i];
+    }
+    pResourceMip->NumResidentTiles += NumLoaded;
+    LeaveCriticalSection(&pResource->ReferenceLock);
+
+    return (NumLoaded > 0) ? S_OK : hr;
+}
+
+void DX12Framework::TrimTile(Resource* pResource, UINT8 Mip, UINT Tile)
+{
+    ResourceDeviceState* pDeviceState = pResource->pDeviceState;
+    ResourceMip* pResourceMip = &pDeviceState->Mips[Mip];
+    UINT Slot = pResourceMip->pTileSlots[Tile];
+
+    UINT64 WaitFence = 0;
+
+    //
+    // Once the tile is marked as not resident, the render thread stops drawing it, so
+    // we only need to wait for the frames that have already referenced its mipmap.
+    //
+    EnterCriticalSection(&pResource->ReferenceLock);
+    pResourceMip->pTileSlots[Tile] = TILE_NOT_RESIDENT;
+    --pResourceMip->NumResidentTiles;
+    if (pResourceMip->ReferenceFence > m_RenderContext.GetLastCompletedFence())
+    {
+        WaitFence = pResourceMip->ReferenceFence;
+    }
+    LeaveCriticalSection(&pResource->ReferenceLock);
+
+    if (WaitFence > 0)
+    {
+        m_RenderContext.WaitForFence(WaitFence);
+    }
+
+    D3D12_TILED_RESOURCE_COORDINATE Coordinates = {};
+    Coordinates.Subresource = Mip;
+    Coordinates.X = Tile % pResourceMip->Desc.WidthInTiles;
+    Coordinates.Y = Tile / pResourceMip->Desc.WidthInTiles;
+
+    D3D12_TILE_REGION_SIZE RegionSize = {};
+    RegionSize.NumTiles = 1;
+
+    D3D12_TILE_RANGE_FLAGS RangeFlags = D3D12_TILE_RANGE_FLAG_NULL;
+    UINT RangeCount = 1;
+    m_PagingContext.GetCommandQueue()->UpdateTileMappings(
+        pDeviceState->pD3DResource,
+        1,
+        &Coordinates,
+        &RegionSize,
+        nullptr,
+        1,
+        &RangeFlags,
+        nullptr,
+        &RangeCount,
+        D3D12_TILE_MAPPING_FLAG_NO_HAZARD);
+
+    FreeTileSlot(Slot);
+}
+
+//
+// Returns true if any of the four tiles covering the same region in the next more detailed
+// mipmap are resident.
+//
+static bool HasResidentChildTiles(const Resource* pResource, UINT8 Mip, UINT X, UINT Y)
+{
+    if (Mip == 0)
+    {
+        return false;
+    }
+
+    const ResourceMip* pChildMip = &pResource->pDeviceState->Mips[Mip - 1];
+    if (pChildMip->NumResidentTiles == 0)
+    {
+        return false;
+    }
+
+    for (UINT ChildY = Y * 2; ChildY < min(Y * 2 + 2, pChildMip->Desc.HeightInTiles); ++ChildY)
+    {
+        for (UINT ChildX = X * 2; ChildX < min(X * 2 + 2, pChildMip->Desc.WidthInTiles); ++ChildX)
+        {
+            if (pChildMip->pTileSlots[ChildY * pChildMip->Desc.WidthInTiles + ChildX] != TILE_NOT_RESIDENT)
+            {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+static bool IsTileInRange(const RECT& TileRange, UINT X, UINT Y)
+{
+    return static_cast<LONG>(X) >= TileRange.left && static_cast<LONG>(X) < TileRange.right &&
+        static_cast<LONG>(Y) >= TileRange.top && static_cast<LONG>(Y) < TileRange.bottom;
+}
+
+bool DX12Framework::TrimTilesToTarget(ResourceTrimPass MaxPass, UINT64 TargetUsage)
+{
+    //
+    // The trimming passes mirror those used for whole mipmaps, but are applied per tile: a
+    // tile within the prefetch region is kept until the NonVisible pass, and a tile within
+    // the visible region is kept until the Visible pass.
+    //
+    for (ResourceTrimPass CurrentPass = ERTP_NonPrefetchable;
+        CurrentPass <= MaxPass;
+        CurrentPass = static_cast<ResourceTrimPass>(CurrentPass + 1))
+    {
+        for (UINT8 Mip = 0; Mip < MAX_MIP_COUNT; ++Mip)
+        {
+            LIST_ENTRY* pEntry = m_ResourceListHead.Flink;
+            while (pEntry != &m_ResourceListHead)
+            {
+                Resource* pResource = CONTAINING_RECORD(pEntry, Resource, ListEntry);
+                pEntry = pEntry->Flink;
+
+                if (!UsesTiledResidency(pResource) || Mip >= pResource->PackedMipHeapIndex)
+                {
+                    continue;
+                }
+
+                ResourceMip* pResourceMip = &pResource->pDeviceState->Mips[Mip];
+                if (pResourceMip->NumResidentTiles == 0)
+                {
+                    continue;
+                }
+
+                RECT VisibleRange;
+                RECT PrefetchRange;
+                bool HasVisibleTiles = pResource->VisibleMip <= Mip &&
+                    GetTileRangeForRegion(pResource, Mip, pResource->VisibleRegion, &VisibleRange);
+                bool HasPrefetchTiles = pResource->PrefetchMip <= Mip &&
+                    GetTileRangeForRegion(pResource, Mip, pResource->PrefetchRegion, &PrefetchRange);
+
+                UINT WidthInTiles = pResourceMip->Desc.WidthInTiles;
+                UINT NumTiles = WidthInTiles * pResourceMip->Desc.HeightInTiles;
+                bool bTrimmed = false;
+
+                for (UINT Tile = 0; Tile < NumTiles && pResourceMip->NumResidentTiles > 0; ++Tile)
+                {
+                    if (pResourceMip->pTileSlots[Tile] == TILE_NOT_RESIDENT)
+                    {
+                        continue;
+                    }
+
+                    UINT X = Tile % WidthInTiles;
+                    UINT Y = Tile / WidthInTiles;
+
+                    bool IsVisible = HasVisibleTiles && IsTileInRange(VisibleRange, X, Y);
+                    bool IsPrefetched = HasPrefetchTiles && IsTileInRange(PrefetchRange, X, Y);
+
+                    if ((CurrentPass == ERTP_NonPrefetchable && (IsVisible || IsPrefetched)) ||
+                        (CurrentPass == ERTP_NonVisible && IsVisible))
+                    {
+                        continue;
+                    }
+
+                    //
+                    // Keep the tile if any of its children are still resident. They were kept
+                    // by an earlier mipmap in this pass, and will be trimmed first in a later one.
+                    //
+                    if (HasResidentChildTiles(pResource, Mip, X, Y))
+                    {
+                        continue;
+                    }
+
+                    TrimTile(pResource, Mip, Tile);
+                    bTrimmed = true;
+                }
+
+                if (bTrimmed)
+                {
+                    //
+                    // Trimming tiles means that there is some paging work that now must be done.
+                    //
+                    m_pWorkerThread->PrioritizeResource(pResource);
+
+                    ReleaseEmptyTileHeaps();
+                    UpdateVideoMemoryInfo();
+                    if (m_LocalVideoMemoryInfo.CurrentUsage < TargetUsage)
+                    {
+                        return true;
+                    }
+                }
+            }
+        }
+    }
+
+    return false;
+}
+
+void DX12Framework::DrawResidentTiles(RenderFrame* pFrame, const RectF* pDest, const ColorF* pColor, Resource* pResource)
+{
+    UINT8 VisibleMip = pResource->VisibleMip;
+    if (VisibleMip == UNDEFINED_MIPMAP_INDEX)
+    {
+        return;
+    }
+
+    float DestWidth = pDest->Right - pDest->Left;
+    float DestHeight = pDest->Bottom - pDest->Top;
+
+    //
+    // Draw the resident tiles within the visible region from the least detailed mipmap to
+    // the requested one, so that more detailed tiles cover the ones underneath. Each tile
+    // samples only its own mipmap and the ones below it, which are always resident under
+    // the tile. Filtering at the edges of a tile whose neighbor is not resident may sample
+    // unmapped texels, but the prefetch region keeps those edges off screen in most cases.
+    //
+    for (int Mip = static_cast<int>(pResource->PackedMipHeapIndex) - 1; Mip >= static_cast<int>(VisibleMip); --Mip)
+    {
+        RECT TileRange;
+        if (!GetTileRangeForRegion(pResource, static_cast<UINT8>(Mip), pResource->VisibleRegion, &TileRange))
+        {
+            return;
+        }
+
+        ResourceMip* pResourceMip = &pResource->pDeviceState->Mips[Mip];
+        UINT WidthInTiles = pResourceMip->Desc.WidthInTiles;
+
+        D3D12_GPU_DESCRIPTOR_HANDLE Srv = {};
+        bool bReferenced = false;
+
+        //
+        // Drawing a tile marks its mipmap with the rendering fence, the same as referencing
+        // a whole mipmap, so that the paging thread can wait for it before trimming.
+        //
+        EnterCriticalSection(&pResource->ReferenceLock);
+
+        for (LONG y = TileRange.top; y < TileRange.bottom && pResourceMip->NumResidentTiles > 0; ++y)
+        {
+            for (LONG x = TileRange.left; x < TileRange.right; ++x)
+            {
+                if (pResourceMip->pTileSlots[y * WidthInTiles + x] == TILE_NOT_RESIDENT)
+                {
+                    continue;
+                }
+
+                if (!bReferenced)
+                {
+                    Srv = CreateMipSrv(pFrame, pResource, Mip);
+                    pResourceMip->ReferenceFence = pFrame->CompletionFence;
+                    bReferenced = true;
+                }
+
+                RectF TexCoords = GetTileRegion(pResource, static_cast<UINT8>(Mip), x, y);
+
+                RectF Dest;
+                Dest.Left = pDest->Left + TexCoords.Left * DestWidth;
+                Dest.Top = pDest->Top + TexCoords.Top * DestHeight;
+                Dest.Right = pDest->Left + TexCoords.Right * DestWidth;
+                Dest.Bottom = pDest->Top + TexCoords.Bottom * DestHeight;
+
+                DrawTexturedQuad(pFrame, &Dest, &TexCoords, pColor, Srv);
+            }
+        }
+
+        LeaveCriticalSection(&pResource->ReferenceLock);
+    }
+}
@@ -116,6 +116,23 @@ inline bool RectNearlyIntersects(const RectF& a, const RectF& b, float Tolerence
         a.Top - Tolerence < b.Bottom && a.Bottom + Tolerence> b.Top;
 }
 
+//
+// Calculates the part of an image covered by the provided bounds, in the image's texture
+// coordinates. The result is empty if the bounds do not intersect the image.
+//
+inline RectF CalculateImageRegion(const RectF& ImageBounds, const RectF& Bounds)
+{
+    float Width = ImageBounds.Right - ImageBounds.Left;
+    float Height = ImageBounds.Bottom - ImageBounds.Top;
+
+    RectF Region;
+    Region.Left = (max(Bounds.Left, ImageBounds.Left) - ImageBounds.Left) / Width;
+    Region.Top = (max(Bounds.Top, ImageBounds.Top) - ImageBounds.Top) / Height;
+    Region.Right = (min(Bounds.Right, ImageBounds.Right) - ImageBounds.Left) / Width;
+    Region.Bottom = (min(Bounds.Bottom, ImageBounds.Bottom) - ImageBounds.Top) / Height;
+    return Region;
+}
+
 //
 // Inflates a rectangle by the specified size on all sides.
 //
@@ -205,6 +222,48 @@ inline UINT64 GetNonPackedMipSize(_In_ const Resource* pResource, UINT MipHeapIn
     return (UINT64)pMip->Desc.WidthInTiles * (UINT64)pMip->Desc.HeightInTiles * TILE_SIZE;
 }
 
+//
+// Calculates the range of tiles in a standard mipmap which cover the provided region of
+// the resource, in texture coordinates. The right and bottom of the range are exclusive.
+// Returns false if the region does not cover any tiles.
+//
+inline bool GetTileRangeForRegion(_In_ const Resource* pResource, UINT8 Mip, const RectF& Region, _Out_ RECT* pTileRange)
+{
+    const ResourceDeviceState* pDeviceState = pResource->pDeviceState;
+    const MipDescription* pDesc = &pDeviceState->Mips[Mip].Desc;
+
+    float TilesPerU = (float)max(pDeviceState->Width >> Mip, 1u) / pDeviceState->TileWidthInTexels;
+    float TilesPerV = (float)max(pDeviceState->Height >> Mip, 1u) / pDeviceState->TileHeightInTexels;
+
+    pTileRange->left = (LONG)max(floorf(Region.Left * TilesPerU), 0.0f);
+    pTileRange->top = (LONG)max(floorf(Region.Top * TilesPerV), 0.0f);
+    pTileRange->right = (LONG)min(ceilf(Region.Right * TilesPerU), (float)pDesc->WidthInTiles);
+    pTileRange->bottom = (LONG)min(ceilf(Region.Bottom * TilesPerV), (float)pDesc->HeightInTiles);
+
+    return pTileRange->left < pTileRange->right && pTileRange->top < pTileRange->bottom;
+}
+
+//
+// Calculates the region of the resource, in texture coordinates, covered by a single tile
+// of a standard mipmap. Tiles along the right and bottom edges may be partially filled.
+//
+inline RectF GetTileRegion(_In_ const Resource* pResource, UINT8 Mip, UINT X, UINT Y)
+{
+    const ResourceDeviceState* pDeviceState = pResource->pDeviceState;
+
+    UINT MipWidth = max(pDeviceState->Width >> Mip, 1u);
+    UINT MipHeight = max(pDeviceState->Height >> Mip, 1u);
+    UINT TileWidth = pDeviceState->TileWidthInTexels;
+    UINT TileHeight = pDeviceState->TileHeightInTexels;
+
+    RectF Region;
+    Region.Left = (float)(X * TileWidth) / MipWidth;
+    Region.Top = (float)(Y * TileHeight) / MipHeight;
+    Region.Right = (float)min((X + 1) * TileWidth, MipWidth) / MipWidth;
+    Region.Bottom = (float)min((Y + 1) * TileHeight, MipHeight) / MipHeight;
+    return Region;
+}
+
 //
 // Gets a friendly string for the provided D3D feature level.
 //
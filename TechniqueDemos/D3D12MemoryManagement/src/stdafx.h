@@ -28,6 +28,21 @@
 #define TILE_SIZE _64KB
 #define MAX_HEAP_SIZE _16MB
 
+//
+// Maximum size of a single paging operation. Mipmaps greater than 32MB in size will be
+// broken up into multiple transfers.
+//
+#define MAX_TRANSFER_SIZE _32MB
+
+//
+// In tiled residency mode, standard mipmaps are committed one tile at a time from
+// a pool of small heaps, and each paging operation commits a small batch of tiles.
+//
+#define TILE_POOL_HEAP_SIZE _1MB
+#define TILES_PER_POOL_HEAP (TILE_POOL_HEAP_SIZE / TILE_SIZE)
+#define MAX_TILES_PER_PAGING_OPERATION 16
+#define TILE_NOT_RESIDENT 0xFFFFFFFF
+
 //
 // Specifies the default size of a buffer in a dynamic buffer.
 //